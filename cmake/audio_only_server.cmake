@@ -0,0 +1,20 @@
+# An audio-only server build of the extension, for workers that join group
+# calls for audio only. It leaves out desktop capture and the camera and
+# platform video code, links no video codecs, and builds tg_owt without the
+# platform audio device modules. The smaller shared object loads faster and
+# takes less memory in every worker process.
+#
+# Include this before adding tg_owt, which picks up its audio backends
+# setting.
+
+include_guard(GLOBAL)
+
+option(TGCALLS_AUDIO_ONLY_SERVER "Audio-only server build: no video codecs, desktop capture or platform audio devices." OFF)
+
+if (TGCALLS_AUDIO_ONLY_SERVER)
+    if (APPLE)
+        message(FATAL_ERROR "TGCALLS_AUDIO_ONLY_SERVER is for Linux and Windows servers.")
+    endif()
+    set(TG_OWT_BUILD_AUDIO_BACKENDS OFF CACHE BOOL "Build webrtc audio backends." FORCE)
+    set(TG_OWT_USE_PIPEWIRE OFF CACHE BOOL "Use pipewire for desktop capture." FORCE)
+endif()
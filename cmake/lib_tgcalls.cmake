@@ -1,3 +1,6 @@
+include(${CMAKE_CURRENT_LIST_DIR}/audio_only_server.cmake)
+include(${CMAKE_CURRENT_LIST_DIR}/release_perf.cmake)
+
 add_library(lib_tgcalls STATIC)
 
 if (WIN32)
@@ -8,6 +11,8 @@ else()
     init_target(lib_tgcalls cxx_std_14) # Can't use std::optional::value on macOS.
 endif()
 
+init_release_perf(lib_tgcalls)
+
 set(tgcalls_dir ${third_party_loc}/lib_tgcalls)
 set(tgcalls_loc ${tgcalls_dir}/tgcalls)
 
@@ -21,16 +26,33 @@ nice_target_sources(lib_tgcalls ${tgcalls_loc}
 PRIVATE
     AudioDeviceHelper.cpp
     AudioDeviceHelper.h
+    AudioDsp.cpp
+    AudioDsp.h
+    CallStatsSnapshotBuilder.cpp
+    CallStatsSnapshotBuilder.h
     CodecSelectHelper.cpp
     CodecSelectHelper.h
+    CountedThread.cpp
+    CountedThread.h
+    CpuAccounting.cpp
+    CpuAccounting.h
+    CpuAffinity.cpp
+    CpuAffinity.h
     CryptoHelper.cpp
     CryptoHelper.h
     EncryptedConnection.cpp
     EncryptedConnection.h
     FakeAudioDeviceModule.cpp
     FakeAudioDeviceModule.h
+    HotPathCounters.cpp
+    HotPathCounters.h
+    HotPathLog.h
     InstanceImpl.cpp
     InstanceImpl.h
+    InvokeAudit.cpp
+    InvokeAudit.h
+    LatencyTrace.cpp
+    LatencyTrace.h
     LogSinkImpl.cpp
     LogSinkImpl.h
     Manager.cpp
@@ -41,13 +63,30 @@ PRIVATE
     Message.h
     NetworkManager.cpp
     NetworkManager.h
+    OverloadController.cpp
+    OverloadController.h
+    QueuedVideoSink.cpp
+    QueuedVideoSink.h
     SctpDataChannelProviderInterfaceImpl.cpp
     SctpDataChannelProviderInterfaceImpl.h
+    SharedNetworkEnvironment.cpp
+    SharedNetworkEnvironment.h
+    SimulatedClock.cpp
+    SimulatedClock.h
     StaticThreads.cpp
     StaticThreads.h
+    StrandExecutor.cpp
+    StrandExecutor.h
+    ThreadHopQueue.h
     ThreadLocalObject.h
+    ThreadScheduling.cpp
+    ThreadScheduling.h
+    TraceRecorder.cpp
+    TraceRecorder.h
     TurnCustomizerImpl.cpp
     TurnCustomizerImpl.h
+    TurnNonceCache.cpp
+    TurnNonceCache.h
     VideoCaptureInterface.cpp
     VideoCaptureInterface.h
     VideoCaptureInterfaceImpl.cpp
@@ -63,16 +102,75 @@ PRIVATE
     desktop_capturer/DesktopCaptureSourceManager.cpp
 
     # Group calls
+    group/BatchedUdpSocket.cpp
+    group/BatchedUdpSocket.h
+    group/BroadcastPartCache.cpp
+    group/BroadcastPartCache.h
+    group/BroadcastPartDecoder.cpp
+    group/BroadcastPartDecoder.h
+    group/GroupAudioEncoderFactory.cpp
+    group/GroupAudioEncoderFactory.h
+    group/GroupAudioMixer.cpp
+    group/GroupAudioMixer.h
+    group/GroupCertificatePool.cpp
+    group/GroupCertificatePool.h
+    group/GroupEngineContext.cpp
+    group/GroupEngineContext.h
+    group/GroupFieldTrials.cpp
+    group/GroupFieldTrials.h
+    group/GroupInstanceArena.cpp
+    group/GroupInstanceArena.h
+    group/GroupInstanceAwait.h
     group/GroupInstanceCustomImpl.cpp
     group/GroupInstanceCustomImpl.h
     group/GroupInstanceImpl.h
+    group/GroupAudioBridge.cpp
+    group/GroupAudioBridge.h
     group/GroupJoinPayloadInternal.cpp
     group/GroupJoinPayloadInternal.h
     group/GroupJoinPayload.h
     group/GroupNetworkManager.cpp
     group/GroupNetworkManager.h
+    group/GroupOpusPacketSource.cpp
+    group/GroupOpusPacketSource.h
+    group/GroupPacketBufferPool.cpp
+    group/GroupPacketBufferPool.h
+    group/GroupSharedAudioDecoder.cpp
+    group/GroupSharedAudioDecoder.h
+    group/GroupSharedAudioEncoder.cpp
+    group/GroupSharedAudioEncoder.h
+    group/GroupSharedUdpSockets.cpp
+    group/GroupSharedUdpSockets.h
+    group/GroupTimerWheel.cpp
+    group/GroupTimerWheel.h
+    group/GroupVideoDecoderFactory.cpp
+    group/GroupVideoDecoderFactory.h
+    group/GroupVideoEncoderFactory.cpp
+    group/GroupVideoEncoderFactory.h
+    group/JsonStream.cpp
+    group/JsonStream.h
+    group/LoopbackSfu.cpp
+    group/LoopbackSfu.h
+    group/NetworkImpairment.cpp
+    group/NetworkImpairment.h
+    group/ParallelDecodingAudioMixer.cpp
+    group/ParallelDecodingAudioMixer.h
+    group/MissingSsrcPacketBuffer.h
+    group/SsrcExpiryWheel.h
     group/StreamingPart.cpp
     group/StreamingPart.h
+    group/VideoStreamingPart.cpp
+    group/VideoStreamingPart.h
+
+    # 1:1 calls v2
+    v2/InstanceV2Impl.cpp
+    v2/InstanceV2Impl.h
+    v2/NativeNetworkingImpl.cpp
+    v2/NativeNetworkingImpl.h
+    v2/Signaling.cpp
+    v2/Signaling.h
+    v2/SignalingEncryption.cpp
+    v2/SignalingEncryption.h
 
     platform/PlatformInterface.h
 
@@ -154,9 +252,11 @@ PRIVATE
 )
 
 target_link_libraries(lib_tgcalls
+PUBLIC
+    # Also used by the file audio device to decode compressed input.
+    external_ffmpeg
 PRIVATE
     external_webrtc
-    external_ffmpeg
     # external_rnnoise
 )
 
@@ -168,6 +268,16 @@ PRIVATE
     RTC_ENABLE_VP9
 )
 
+# Compiles out the verbose and info lines logged per packet, frame or
+# signaling message; see HotPathLog.h.
+option(TGCALLS_STRIP_HOT_PATH_LOGS "Leave verbose and info logs out of the packet and frame paths." OFF)
+if (TGCALLS_STRIP_HOT_PATH_LOGS)
+    target_compile_definitions(lib_tgcalls
+    PRIVATE
+        TGCALLS_STRIP_HOT_PATH_LOGS
+    )
+endif()
+
 if (WIN32)
     target_compile_definitions(lib_tgcalls
     PRIVATE
@@ -232,6 +342,30 @@ remove_target_sources(lib_tgcalls ${tgcalls_loc}
     reference/InstanceImplReference.h
 )
 
+if (TGCALLS_AUDIO_ONLY_SERVER)
+    nice_target_sources(lib_tgcalls ${tgcalls_loc}
+    PRIVATE
+        platform/fake/FakeInterface.cpp
+        platform/fake/FakeInterface.h
+    )
+    remove_target_sources(lib_tgcalls ${tgcalls_loc}
+        desktop_capturer/DesktopCaptureSource.h
+        desktop_capturer/DesktopCaptureSource.cpp
+        desktop_capturer/DesktopCaptureSourceHelper.h
+        desktop_capturer/DesktopCaptureSourceHelper.cpp
+        desktop_capturer/DesktopCaptureSourceManager.h
+        desktop_capturer/DesktopCaptureSourceManager.cpp
+        platform/tdesktop/DesktopInterface.cpp
+        platform/tdesktop/DesktopInterface.h
+        platform/tdesktop/VideoCapturerInterfaceImpl.cpp
+        platform/tdesktop/VideoCapturerInterfaceImpl.h
+        platform/tdesktop/VideoCapturerTrackSource.cpp
+        platform/tdesktop/VideoCapturerTrackSource.h
+        platform/tdesktop/VideoCameraCapturer.cpp
+        platform/tdesktop/VideoCameraCapturer.h
+    )
+endif()
+
 target_include_directories(lib_tgcalls
 PUBLIC
     ${tgcalls_dir}
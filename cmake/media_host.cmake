@@ -0,0 +1,47 @@
+# The media host: an executable running group calls for a Python client in
+# another process, with their audio in shared memory (media_host/).
+#
+# It is built from the extension's own sources, less the module and what
+# only the module uses. Those still include pybind11 for the Python-facing
+# descriptors, so it links the embedded interpreter, which it never starts.
+#
+# Include this after lib_tgcalls and pybind11 are added.
+
+include_guard(GLOBAL)
+
+option(TGCALLS_MEDIA_HOST "Build the out-of-process media host (Linux and macOS)." OFF)
+
+if (TGCALLS_MEDIA_HOST)
+    if (WIN32)
+        message(FATAL_ERROR "TGCALLS_MEDIA_HOST needs Unix sockets and POSIX shared memory.")
+    endif()
+
+    set(media_host_loc ${CMAKE_CURRENT_LIST_DIR}/../media_host)
+
+    file(GLOB media_host_src_files ${src_loc}/*.cpp)
+    list(FILTER media_host_src_files EXCLUDE REGEX "/(tgcalls|NativeInstance|CallManager|LoadTest|[A-Za-z]+Benchmark)\\.cpp$")
+
+    add_executable(tgcalls_media_host
+        ${media_host_loc}/MediaHost.cpp
+        ${media_host_loc}/HostedCall.cpp
+        ${media_host_loc}/HostedCall.h
+        ${media_host_src_files}
+    )
+    init_target(tgcalls_media_host)
+    init_release_perf(tgcalls_media_host)
+
+    target_include_directories(tgcalls_media_host
+    PRIVATE
+        ${src_loc}
+        ${media_host_loc}
+    )
+    target_link_libraries(tgcalls_media_host
+    PRIVATE
+        lib_tgcalls
+        pybind11::embed
+    )
+    if (LINUX)
+        # shm_open() on older glibc.
+        target_link_libraries(tgcalls_media_host PRIVATE rt)
+    endif()
+endif()
@@ -0,0 +1,82 @@
+# Optimized builds of the extension, lib_tgcalls and tg_owt together.
+#
+# TGCALLS_RELEASE_PERF turns on LTO across all three, which only works when
+# they're built by the same compiler in one configure, and
+# -fno-semantic-interposition, so calls between the extension's own
+# functions aren't forced through the PLT.
+#
+# TGCALLS_PGO adds profile-guided optimization on top:
+#   generate - an instrumented build, writing its profile to TGCALLS_PGO_DIR;
+#              run pgo_train.py with it, which drives runLoadTest();
+#   use      - a build optimized with that profile. Clang needs it merged
+#              into TGCALLS_PGO_DIR/default.profdata, which pgo_train.py
+#              does with llvm-profdata.
+#
+# Include this before adding tg_owt, whose init_target() picks it up, and
+# call init_release_perf() on the extension's target.
+
+include_guard(GLOBAL)
+
+option(TGCALLS_RELEASE_PERF "LTO and no semantic interposition across the extension, lib_tgcalls and tg_owt." OFF)
+set(TGCALLS_PGO "" CACHE STRING "Profile-guided optimization: empty, generate or use.")
+set(TGCALLS_PGO_DIR "${CMAKE_BINARY_DIR}/pgo" CACHE PATH "Where the PGO profile is written and read.")
+
+if (TGCALLS_RELEASE_PERF)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT ipo_supported OUTPUT ipo_error LANGUAGES C CXX)
+    if (NOT ipo_supported)
+        message(WARNING "TGCALLS_RELEASE_PERF: no LTO with this toolchain: ${ipo_error}")
+    endif()
+    # Seen from every directory, tg_owt's included.
+    set(TGCALLS_IPO_SUPPORTED ${ipo_supported} CACHE INTERNAL "")
+endif()
+
+if (NOT TGCALLS_PGO STREQUAL "" AND NOT TGCALLS_PGO STREQUAL "generate" AND NOT TGCALLS_PGO STREQUAL "use")
+    message(FATAL_ERROR "TGCALLS_PGO must be empty, 'generate' or 'use', not '${TGCALLS_PGO}'.")
+endif()
+if (TGCALLS_PGO STREQUAL "use" AND CMAKE_CXX_COMPILER_ID MATCHES "Clang" AND NOT EXISTS "${TGCALLS_PGO_DIR}/default.profdata")
+    message(FATAL_ERROR "TGCALLS_PGO=use: no ${TGCALLS_PGO_DIR}/default.profdata, run pgo_train.py first.")
+endif()
+
+function(init_release_perf target_name)
+    if (MSVC)
+        return()
+    endif()
+
+    if (TGCALLS_RELEASE_PERF)
+        if (TGCALLS_IPO_SUPPORTED)
+            set_target_properties(${target_name} PROPERTIES
+                INTERPROCEDURAL_OPTIMIZATION_RELEASE ON
+                INTERPROCEDURAL_OPTIMIZATION_RELWITHDEBINFO ON
+            )
+        endif()
+        if (NOT APPLE)
+            target_compile_options(${target_name}
+            PRIVATE
+                -fno-semantic-interposition
+                -fno-plt
+            )
+        endif()
+    endif()
+
+    if (TGCALLS_PGO STREQUAL "generate")
+        set(pgo_options -fprofile-generate=${TGCALLS_PGO_DIR})
+        if (CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+            # Counters are updated from every webrtc thread at once.
+            list(APPEND pgo_options -fprofile-update=atomic)
+        endif()
+        target_compile_options(${target_name} PRIVATE ${pgo_options})
+        target_link_options(${target_name} PRIVATE ${pgo_options})
+        target_compile_definitions(${target_name} PRIVATE TGCALLS_PGO_GENERATE)
+    elseif (TGCALLS_PGO STREQUAL "use")
+        if (CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+            set(pgo_options -fprofile-use=${TGCALLS_PGO_DIR}/default.profdata -Wno-profile-instr-unprofiled)
+        else()
+            # Code the training run never reached stays optimized as usual
+            # rather than for size.
+            set(pgo_options -fprofile-use=${TGCALLS_PGO_DIR} -fprofile-partial-training -Wno-missing-profile)
+        endif()
+        target_compile_options(${target_name} PRIVATE ${pgo_options})
+        target_link_options(${target_name} PRIVATE ${pgo_options})
+    endif()
+endfunction()
@@ -0,0 +1,105 @@
+#include "HostedCall.h"
+
+#include <cstring>
+
+#include <tgcalls/StaticThreads.h>
+
+#include "GroupCallReaper.h"
+#include "WrappedAudioDeviceModuleImpl.h"
+
+namespace {
+
+// Audio the client wrote to the send ring; see RingSource.
+class SharedRingSource {
+public:
+  explicit SharedRingSource(std::shared_ptr<HostedCallAudio> audio) : _audio(std::move(audio)) {}
+
+  AudioFormat Format() const { return _audio->format; }
+
+  bool Start(const AudioFormat &) { return true; }
+
+  void Stop() {}
+
+  PcmReadResult Read(int8_t *buffer, size_t length, const int8_t **) {
+    size_t read = _audio->sendRing->Read(reinterpret_cast<uint8_t *>(buffer), length);
+    if (read < length) {
+      memset(buffer + read, 0, length - read);
+      _audio->underruns++;
+    }
+    return PcmReadResult::kFrame;
+  }
+
+  // The client pauses by muting, which stops the capture side in webrtc.
+  bool Idle() const { return false; }
+
+  AudioIdleSignal *IdleSignal() const { return nullptr; }
+
+private:
+  std::shared_ptr<HostedCallAudio> _audio;
+};
+
+// Audio of the call queued in the receive ring; see RingSink.
+class SharedRingSink {
+public:
+  explicit SharedRingSink(std::shared_ptr<HostedCallAudio> audio) : _audio(std::move(audio)) {}
+
+  AudioFormat Format() const { return _audio->format; }
+
+  bool Start(const AudioFormat &) { return true; }
+
+  void Stop() {}
+
+  void Write(const int8_t *frame, size_t length) {
+    size_t written = _audio->receiveRing->Write(reinterpret_cast<const uint8_t *>(frame), length);
+    if (written < length) {
+      _audio->overruns++;
+    }
+  }
+
+  bool Idle() const { return false; }
+
+  AudioIdleSignal *IdleSignal() const { return nullptr; }
+
+private:
+  std::shared_ptr<HostedCallAudio> _audio;
+};
+
+}  // namespace
+
+std::unique_ptr<HostedCall> HostedCall::Create(const std::string &ringPrefix, AudioFormat format,
+                                               size_t ringCapacity, Events events) {
+  auto audio = std::make_shared<HostedCallAudio>();
+  audio->format = format;
+  audio->sendRing = SharedAudioRing::Create(ringPrefix + "-send", ringCapacity);
+  audio->receiveRing = SharedAudioRing::Create(ringPrefix + "-receive", ringCapacity);
+  if (!audio->sendRing || !audio->receiveRing) {
+    return nullptr;
+  }
+
+  tgcalls::GroupInstanceDescriptor descriptor;
+  descriptor.threads = tgcalls::Threads::getThreads();
+  descriptor.networkStateUpdated = [networkState = std::move(events.networkState)](
+                                       tgcalls::GroupNetworkState state) {
+    networkState(state.isConnected);
+  };
+  descriptor.createAudioDeviceModule = [audio](webrtc::TaskQueueFactory *taskQueueFactory)
+      -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+    return WrappedAudioDeviceModuleImpl::Create(
+        webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory,
+        SharedRingSource(audio), SharedRingSink(audio), &audio->clockStats, nullptr);
+  };
+  // As for the extension's devices: the audio is produced, not captured.
+  descriptor.disableOutgoingAudioProcessing = true;
+
+  std::unique_ptr<HostedCall> call(new HostedCall());
+  call->_audio = std::move(audio);
+  call->_instance = std::make_unique<tgcalls::GroupInstanceCustomImpl>(std::move(descriptor));
+  call->_instance->emitJoinPayload(std::move(events.joinPayload));
+  return call;
+}
+
+HostedCall::~HostedCall() {
+  // Off the control loop, like the extension's calls. The device holds on
+  // to |_audio|, so the rings stay mapped until it's gone.
+  GroupCallReaper::Get().Reap(std::move(_instance));
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <tgcalls/group/GroupInstanceCustomImpl.h>
+
+#include "AudioDeadlineClock.h"
+#include "AudioFormat.h"
+#include "SharedAudioRing.h"
+
+// The audio of one hosted call: the two shared rings its device exchanges
+// 10 ms frames through, in the call's one format.
+struct HostedCallAudio {
+  AudioFormat format;
+
+  // Written by the client, played into the call.
+  std::unique_ptr<SharedAudioRing> sendRing;
+  // Received from the call, read by the client.
+  std::unique_ptr<SharedAudioRing> receiveRing;
+
+  // 10 ms frames that were short because |sendRing| ran dry, and frames
+  // that were truncated because |receiveRing| was full.
+  std::atomic<uint64_t> underruns{0};
+  std::atomic<uint64_t> overruns{0};
+
+  AudioClockStats clockStats;
+};
+
+// A GroupInstanceCustomImpl run by the media host on behalf of a client,
+// with its audio device backed by shared rings instead of Python.
+class HostedCall {
+public:
+  struct Events {
+    std::function<void(tgcalls::GroupJoinPayload const &)> joinPayload;
+    std::function<void(bool isConnected)> networkState;
+  };
+
+  // Creates the rings, named |ringPrefix| + "-send" / "-receive", and
+  // starts the call, which emits its join payload once ready. Returns
+  // nullptr if the rings can't be created.
+  static std::unique_ptr<HostedCall> Create(const std::string &ringPrefix, AudioFormat format,
+                                            size_t ringCapacity, Events events);
+
+  ~HostedCall();
+
+  HostedCall(const HostedCall &) = delete;
+  HostedCall &operator=(const HostedCall &) = delete;
+
+  void setJoinResponsePayload(std::string const &payload) { _instance->setJoinResponsePayload(payload); }
+  void setIsMuted(bool isMuted) { _instance->setIsMuted(isMuted); }
+
+  const HostedCallAudio &audio() const { return *_audio; }
+
+private:
+  HostedCall() = default;
+
+  std::shared_ptr<HostedCallAudio> _audio;
+  std::unique_ptr<tgcalls::GroupInstanceCustomImpl> _instance;
+};
@@ -0,0 +1,280 @@
+// The media host: runs group calls out of the client's process, so every
+// host process has its own threads and its own crash domain and no media
+// callback ever waits for a Python GIL.
+//
+// A client (media_host_client.py) connects to --socket and sends requests,
+// one JSON object per line:
+//
+//   {"id": 1, "method": "createCall", "params": {"call": "c1"}}
+//
+// and gets one line back per request, {"id": 1, "result": {...}} or
+// {"id": 1, "error": "..."}. Events come as {"event": ..., "call": ...}
+// lines in between. A call's audio moves through two SharedAudioRings, whose
+// names createCall returns; only signaling goes through the socket.
+//
+// One client at a time; its calls end when it disconnects.
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <rtc_base/ssl_adapter.h>
+#include <tgcalls/third-party/json11.hpp>
+
+#include "HostedCall.h"
+
+namespace {
+
+constexpr size_t kDefaultRingCapacity = 48000 * 2 * 2 * 2;
+
+std::atomic<bool> terminating{false};
+
+void HandleTerminate(int) {
+  terminating = true;
+}
+
+// Lines to the client, from the control loop and from the webrtc threads
+// emitting events.
+class ClientConnection {
+public:
+  explicit ClientConnection(int fd) : _fd(fd) {}
+
+  ~ClientConnection() { close(_fd); }
+
+  void Send(json11::Json const &message) {
+    std::string line = message.dump();
+    line += '\n';
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t sent = 0;
+    while (sent < line.size() && !_closed) {
+      ssize_t result = send(_fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+      if (result < 0 && errno == EINTR) {
+        continue;
+      }
+      if (result <= 0) {
+        // The control loop sees the hangup and ends the calls.
+        _closed = true;
+        break;
+      }
+      sent += static_cast<size_t>(result);
+    }
+  }
+
+private:
+  int _fd;
+  std::mutex _mutex;
+  bool _closed = false;
+};
+
+class MediaHost {
+public:
+  explicit MediaHost(std::shared_ptr<ClientConnection> client) : _client(std::move(client)) {}
+
+  // Handles one request line.
+  void Handle(std::string const &line) {
+    std::string parseError;
+    auto request = json11::Json::parse(line, parseError);
+    if (!parseError.empty() || !request.is_object()) {
+      _client->Send(json11::Json::object{{"id", nullptr}, {"error", "malformed request: " + parseError}});
+      return;
+    }
+
+    auto const &id = request["id"];
+    try {
+      auto result = Dispatch(request["method"].string_value(), request["params"]);
+      _client->Send(json11::Json::object{{"id", id}, {"result", result}});
+    } catch (std::exception const &e) {
+      _client->Send(json11::Json::object{{"id", id}, {"error", e.what()}});
+    }
+  }
+
+private:
+  json11::Json Dispatch(std::string const &method, json11::Json const &params) {
+    const std::string callId = params["call"].string_value();
+    if (callId.empty()) {
+      throw std::invalid_argument("call is required");
+    }
+
+    if (method == "createCall") {
+      return CreateCall(callId, params);
+    }
+
+    auto it = _calls.find(callId);
+    if (it == _calls.end()) {
+      throw std::invalid_argument("no such call: " + callId);
+    }
+    HostedCall &call = *it->second;
+
+    if (method == "setJoinResponse") {
+      call.setJoinResponsePayload(params["payload"].string_value());
+      return nullptr;
+    } else if (method == "setMuted") {
+      call.setIsMuted(params["muted"].bool_value());
+      return nullptr;
+    } else if (method == "getStats") {
+      auto const &audio = call.audio();
+      return json11::Json::object{
+          {"underruns", static_cast<double>(audio.underruns.load())},
+          {"overruns", static_cast<double>(audio.overruns.load())},
+          {"lateTicks", static_cast<double>(audio.clockStats.lateTicks.load())},
+          {"droppedTicks", static_cast<double>(audio.clockStats.droppedTicks.load())},
+      };
+    } else if (method == "stopCall") {
+      _calls.erase(it);
+      return nullptr;
+    }
+    throw std::invalid_argument("unknown method: " + method);
+  }
+
+  json11::Json CreateCall(std::string const &callId, json11::Json const &params) {
+    if (_calls.count(callId) != 0) {
+      throw std::invalid_argument("call exists: " + callId);
+    }
+    for (char c : callId) {
+      if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+        throw std::invalid_argument("call ids may only contain letters, digits, - and _");
+      }
+    }
+
+    AudioFormat format;
+    if (params["sampleRate"].is_number()) {
+      format.sampleRate = AudioFormat::CheckedSampleRate(params["sampleRate"].int_value());
+    }
+    if (params["channels"].is_number()) {
+      format.channels = AudioFormat::CheckedChannels(static_cast<size_t>(params["channels"].int_value()));
+    }
+    size_t ringCapacity = kDefaultRingCapacity;
+    if (params["ringCapacity"].is_number() && params["ringCapacity"].int_value() > 0) {
+      ringCapacity = static_cast<size_t>(params["ringCapacity"].int_value());
+    }
+
+    HostedCall::Events events;
+    events.joinPayload = [client = _client, callId](tgcalls::GroupJoinPayload const &payload) {
+      client->Send(json11::Json::object{
+          {"event", "joinPayload"},
+          {"call", callId},
+          {"audioSsrc", static_cast<double>(payload.audioSsrc)},
+          {"payload", payload.json},
+      });
+    };
+    events.networkState = [client = _client, callId](bool isConnected) {
+      client->Send(json11::Json::object{
+          {"event", "networkState"},
+          {"call", callId},
+          {"connected", isConnected},
+      });
+    };
+
+    // Unique across host processes sharing the machine.
+    const std::string ringPrefix = "/tgcalls-host-" + std::to_string(getpid()) + "-" + callId;
+    auto call = HostedCall::Create(ringPrefix, format, ringCapacity, std::move(events));
+    if (!call) {
+      throw std::runtime_error("failed to create the shared rings of " + callId);
+    }
+
+    json11::Json result = json11::Json::object{
+        {"sendRing", call->audio().sendRing->name()},
+        {"receiveRing", call->audio().receiveRing->name()},
+        {"sampleRate", format.sampleRate},
+        {"channels", static_cast<int>(format.channels)},
+    };
+    _calls.emplace(callId, std::move(call));
+    return result;
+  }
+
+  std::shared_ptr<ClientConnection> _client;
+  std::map<std::string, std::unique_ptr<HostedCall>> _calls;
+};
+
+// Serves the client on |fd| until it hangs up or the host is terminated.
+void Serve(int fd) {
+  auto client = std::make_shared<ClientConnection>(fd);
+  MediaHost host(client);
+
+  std::string pending;
+  char buffer[4096];
+  while (!terminating) {
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      break;
+    }
+    pending.append(buffer, static_cast<size_t>(received));
+
+    size_t start = 0;
+    size_t end;
+    while ((end = pending.find('\n', start)) != std::string::npos) {
+      if (end > start) {
+        host.Handle(pending.substr(start, end - start));
+      }
+      start = end + 1;
+    }
+    pending.erase(0, start);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::string socketPath;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+      socketPath = argv[++i];
+    }
+  }
+  if (socketPath.empty()) {
+    fprintf(stderr, "usage: %s --socket PATH\n", argv[0]);
+    return 2;
+  }
+
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    fprintf(stderr, "socket path too long: %s\n", socketPath.c_str());
+    return 2;
+  }
+  memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+  // Without SA_RESTART, so a blocked recv() or accept() returns.
+  struct sigaction action{};
+  action.sa_handler = HandleTerminate;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  unlink(socketPath.c_str());
+  if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+      listen(listener, 1) != 0) {
+    perror("media host socket");
+    return 1;
+  }
+
+  rtc::InitializeSSL();
+
+  while (!terminating) {
+    int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) {
+      continue;
+    }
+    Serve(client);
+  }
+
+  close(listener);
+  unlink(socketPath.c_str());
+  return 0;
+}
@@ -0,0 +1,124 @@
+"""Client of the media host (tgcalls_media_host).
+
+Controls group calls running in a media host process over its Unix socket,
+and moves their audio through the shared rings the host creates for each
+call, opened with tgcalls.SharedAudioRing:
+
+    host = MediaHostClient('/run/tgcalls/host0.sock', on_event=print)
+    call = host.create_call('c1')
+    # on_event gets {'event': 'joinPayload', 'call': 'c1', 'payload': ...}
+    host.set_join_response('c1', response_json)
+    call.send_ring.write(pcm)
+    pcm = call.receive_ring.read(3840)
+
+Events come on the client's reader thread, so on_event should hand them
+off rather than block.
+"""
+
+import itertools
+import json
+import socket
+import threading
+from concurrent.futures import Future
+
+
+class MediaHostError(RuntimeError):
+    pass
+
+
+class HostedCall:
+    def __init__(self, call_id, result, tgcalls):
+        self.call_id = call_id
+        self.sample_rate = result['sampleRate']
+        self.channels = result['channels']
+        # Written here and played into the call, and the call's audio.
+        self.send_ring = tgcalls.SharedAudioRing.open(result['sendRing'])
+        self.receive_ring = tgcalls.SharedAudioRing.open(result['receiveRing'])
+
+
+class MediaHostClient:
+    def __init__(self, socket_path, on_event=None, timeout=10.0):
+        import tgcalls
+        self._tgcalls = tgcalls
+        self._on_event = on_event
+        self._timeout = timeout
+        self._ids = itertools.count(1)
+        self._pending = {}
+        self._lock = threading.Lock()
+
+        self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._socket.connect(socket_path)
+        self._reader = threading.Thread(target=self._read, name='media-host-client', daemon=True)
+        self._reader.start()
+
+    def create_call(self, call_id, sample_rate=None, channels=None, ring_capacity=None):
+        params = {'call': call_id}
+        if sample_rate is not None:
+            params['sampleRate'] = sample_rate
+        if channels is not None:
+            params['channels'] = channels
+        if ring_capacity is not None:
+            params['ringCapacity'] = ring_capacity
+        return HostedCall(call_id, self._request('createCall', params), self._tgcalls)
+
+    def set_join_response(self, call_id, payload):
+        self._request('setJoinResponse', {'call': call_id, 'payload': payload})
+
+    def set_muted(self, call_id, muted):
+        self._request('setMuted', {'call': call_id, 'muted': muted})
+
+    def get_stats(self, call_id):
+        return self._request('getStats', {'call': call_id})
+
+    def stop_call(self, call_id):
+        self._request('stopCall', {'call': call_id})
+
+    def close(self):
+        """Disconnects, which ends every call of this client in the host."""
+        self._socket.shutdown(socket.SHUT_RDWR)
+        self._reader.join()
+        self._socket.close()
+
+    def _request(self, method, params):
+        future = Future()
+        with self._lock:
+            request_id = next(self._ids)
+            self._pending[request_id] = future
+            line = json.dumps({'id': request_id, 'method': method, 'params': params}) + '\n'
+            self._socket.sendall(line.encode())
+        return future.result(self._timeout)
+
+    def _read(self):
+        buffered = b''
+        while True:
+            try:
+                data = self._socket.recv(65536)
+            except OSError:
+                data = b''
+            if not data:
+                break
+            buffered += data
+            *lines, buffered = buffered.split(b'\n')
+            for line in lines:
+                if line:
+                    self._dispatch(json.loads(line))
+
+        with self._lock:
+            pending, self._pending = self._pending, {}
+        for future in pending.values():
+            future.set_exception(MediaHostError('media host disconnected'))
+
+    def _dispatch(self, message):
+        if 'event' in message:
+            if self._on_event is not None:
+                self._on_event(message)
+            return
+
+        with self._lock:
+            future = self._pending.pop(message.get('id'), None)
+        if future is None:
+            return
+        if 'error' in message:
+            future.set_exception(MediaHostError(message['error']))
+        else:
+            future.set_result(message.get('result'))
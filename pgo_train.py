@@ -0,0 +1,72 @@
+"""Training run for a TGCALLS_PGO=generate build, and CPU-per-call comparison.
+
+With an instrumented build of the extension, runs tgcalls.runLoadTest() over
+a loopback SFU, with and without the shared audio clock, writes the profile
+and, for Clang, merges it into default.profdata for a TGCALLS_PGO=use build.
+
+With any other build, only reports CPU per call, so the same command run
+against a plain and a release-perf build measures what the latter saves.
+"""
+
+import argparse
+import glob
+import os
+import shutil
+import subprocess
+import sys
+
+
+def run(tgcalls, args, use_shared_audio_clock):
+    config = tgcalls.LoadTestConfig()
+    config.calls = args.calls
+    config.useLoopbackSfu = True
+    config.speakers = args.speakers
+    config.warmupMs = args.warmup_ms
+    config.durationMs = args.duration_ms
+    config.inputFilename = args.input
+    config.useSharedAudioClock = use_shared_audio_clock
+    result = tgcalls.runLoadTest(config)
+    print(f'calls={result.calls} sharedAudioClock={use_shared_audio_clock} '
+          f'cpuPercentPerCall={result.cpuPercentPerCall:.2f} '
+          f'connected={result.connectedCalls} concealmentEvents={result.concealmentEvents}')
+    return result.cpuPercentPerCall
+
+
+def merge_clang_profile(pgo_dir):
+    raw = glob.glob(os.path.join(pgo_dir, '*.profraw'))
+    if not raw:
+        return
+    profdata = shutil.which('llvm-profdata')
+    if profdata is None:
+        sys.exit('llvm-profdata not found, needed to merge the Clang profile')
+    output = os.path.join(pgo_dir, 'default.profdata')
+    subprocess.run([profdata, 'merge', '-o', output, *raw], check=True)
+    print(f'merged {len(raw)} profiles into {output}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--module-path', default='', help='directory of the built tgcalls extension')
+    parser.add_argument('--pgo-dir', default='', help='TGCALLS_PGO_DIR of the build, to merge a Clang profile')
+    parser.add_argument('--input', default='', help='raw s16le 48 kHz stereo audio the calls send')
+    parser.add_argument('--calls', type=int, default=50)
+    parser.add_argument('--speakers', type=int, default=5)
+    parser.add_argument('--warmup-ms', type=int, default=5000)
+    parser.add_argument('--duration-ms', type=int, default=60000)
+    args = parser.parse_args()
+
+    if args.module_path:
+        sys.path.insert(0, args.module_path)
+    import tgcalls
+
+    results = [run(tgcalls, args, False), run(tgcalls, args, True)]
+    print(f'mean cpuPercentPerCall={sum(results) / len(results):.2f}')
+
+    if tgcalls.writeProfile():
+        print('profile written')
+        if args.pgo_dir:
+            merge_clang_profile(args.pgo_dir)
+
+
+if __name__ == '__main__':
+    main()
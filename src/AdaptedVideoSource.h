@@ -0,0 +1,38 @@
+#pragma once
+
+#include <api/video/video_frame.h>
+#include <media/base/adapted_video_track_source.h>
+
+// Track source for video produced in this process. Frames are adapted to
+// what the encoder asks for before they are copied or converted, so the ones
+// it would drop cost nothing; adapt() and deliver() may be called from any
+// one thread.
+class AdaptedVideoSource : public rtc::AdaptedVideoTrackSource {
+public:
+  // Whether the encoder wants a |width| x |height| frame at |timestampUs|,
+  // and the crop and size it wants it at.
+  bool adapt(int width, int height, int64_t timestampUs,
+             int *adaptedWidth, int *adaptedHeight, int *cropWidth, int *cropHeight, int *cropX, int *cropY) {
+    return AdaptFrame(width, height, timestampUs, adaptedWidth, adaptedHeight, cropWidth, cropHeight, cropX, cropY);
+  }
+
+  void deliver(const webrtc::VideoFrame &frame) {
+    OnFrame(frame);
+  }
+
+  SourceState state() const override {
+    return kLive;
+  }
+
+  bool remote() const override {
+    return false;
+  }
+
+  bool is_screencast() const override {
+    return false;
+  }
+
+  absl::optional<bool> needs_denoising() const override {
+    return false;
+  }
+};
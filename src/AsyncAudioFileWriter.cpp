@@ -0,0 +1,172 @@
+#include "AsyncAudioFileWriter.h"
+
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+
+#if defined(WEBRTC_POSIX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+#include <tgcalls/HotPathCounters.h>
+
+namespace {
+
+// O_DIRECT needs buffers, offsets and sizes aligned to the logical block
+// size; 4 KiB covers every device we care about.
+const size_t kDirectIoAlignment = 4096;
+
+// Upper bound on how long written frames wait in memory.
+const auto kFlushInterval = std::chrono::milliseconds(200);
+
+}  // namespace
+
+AsyncAudioFileWriter::AsyncAudioFileWriter(std::string filename,
+                                           AudioWriterStats *stats,
+                                           bool directIo,
+                                           size_t bufferBytes)
+    : _filename(std::move(filename)),
+      _stats(stats),
+      _directIo(directIo),
+      _ring(bufferBytes) {}
+
+#if defined(WEBRTC_POSIX)
+
+AsyncAudioFileWriter::~AsyncAudioFileWriter() {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  if (_thread) {
+    _thread->Stop();
+    _thread.reset();
+  }
+  if (_fd >= 0) {
+    close(_fd);
+  }
+  free(_chunk);
+}
+
+bool AsyncAudioFileWriter::Open() {
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#if defined(O_DIRECT)
+  if (_directIo) {
+    flags |= O_DIRECT;
+  }
+#else
+  _directIo = false;
+#endif
+
+  _fd = open(_filename.c_str(), flags, 0644);
+  if (_fd < 0 && _directIo) {
+    // Not every filesystem supports O_DIRECT (tmpfs, for one).
+    RTC_LOG(LS_WARNING) << "O_DIRECT unavailable, using buffered writes for: " << _filename;
+    _directIo = false;
+    _fd = open(_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+  if (_fd < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open playout file: " << _filename;
+    return false;
+  }
+
+  if (posix_memalign(reinterpret_cast<void **>(&_chunk), kDirectIoAlignment, kChunkBytes) != 0) {
+    _chunk = nullptr;
+    close(_fd);
+    _fd = -1;
+    return false;
+  }
+
+  _thread.reset(new rtc::PlatformThread(
+      ThreadFunc, this, "tgcalls_audio_writer", rtc::kNormalPriority));
+  _thread->Start();
+  return true;
+}
+
+#else
+
+AsyncAudioFileWriter::~AsyncAudioFileWriter() = default;
+
+bool AsyncAudioFileWriter::Open() {
+  RTC_LOG(LS_WARNING) << "Asynchronous playout capture is not supported on this platform";
+  return false;
+}
+
+#endif
+
+bool AsyncAudioFileWriter::Write(const int8_t *frame, size_t length) {
+  if (_ring.WriteAvailable() < length) {
+    if (_stats) {
+      _stats->droppedFrames++;
+    }
+    tgcalls::HotPathCounters::onFrameDropped(tgcalls::HotPathCounters::FrameKind::PlayoutFile);
+    return false;
+  }
+
+  _ring.Write(reinterpret_cast<const uint8_t *>(frame), length);
+  tgcalls::HotPathCounters::onFrameDelivered(tgcalls::HotPathCounters::FrameKind::PlayoutFile);
+  if (_stats) {
+    _stats->backlogBytes = _ring.ReadAvailable();
+  }
+  return true;
+}
+
+void AsyncAudioFileWriter::ThreadFunc(void *pThis) {
+  static_cast<AsyncAudioFileWriter *>(pThis)->Run();
+}
+
+void AsyncAudioFileWriter::Run() {
+  bool failed = false;
+
+  while (true) {
+    bool stopping = _stopped;
+
+    while (!failed && _ring.ReadAvailable() >= kChunkBytes) {
+      _ring.Read(_chunk, kChunkBytes);
+      failed = !WriteChunk(kChunkBytes);
+    }
+
+    if (stopping) {
+      break;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wakeUp.wait_for(lock, kFlushInterval, [this] { return _stopped.load(); });
+  }
+
+  // Whatever is left is smaller than a chunk.
+  size_t tail = _ring.Read(_chunk, kChunkBytes);
+  if (!failed && tail > 0) {
+#if defined(O_DIRECT)
+    if (_directIo && tail % kDirectIoAlignment != 0) {
+      // The final short write cannot satisfy O_DIRECT alignment.
+      fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) & ~O_DIRECT);
+    }
+#endif
+    WriteChunk(tail);
+  }
+}
+
+bool AsyncAudioFileWriter::WriteChunk(size_t length) {
+#if defined(WEBRTC_POSIX)
+  size_t offset = 0;
+  while (offset < length) {
+    ssize_t written = write(_fd, _chunk + offset, length - offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      RTC_LOG(LS_ERROR) << "Failed to write playout file: " << _filename;
+      return false;
+    }
+    offset += static_cast<size_t>(written);
+  }
+#endif
+  if (_stats) {
+    _stats->backlogBytes = _ring.ReadAvailable();
+  }
+  return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "AudioOutputWriter.h"
+#include "SpscRingBuffer.h"
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+// Writes playout capture to disk from a background thread.
+//
+// The realtime playout thread only copies each frame into a preallocated
+// ring; the I/O thread flushes it in large chunks, optionally bypassing the
+// page cache with O_DIRECT on Linux. A slow disk then costs dropped frames
+// in the recording instead of missed playout ticks.
+class AsyncAudioFileWriter : public AudioOutputWriter {
+public:
+  // Four seconds of 48 kHz stereo s16le.
+  static constexpr size_t kDefaultBufferBytes = 48000 * 2 * 2 * 4;
+  // Flush granularity; a multiple of any common O_DIRECT alignment.
+  static constexpr size_t kChunkBytes = 64 * 1024;
+
+  AsyncAudioFileWriter(std::string filename,
+                       AudioWriterStats *stats,
+                       bool directIo = false,
+                       size_t bufferBytes = kDefaultBufferBytes);
+
+  // Flushes everything still buffered and closes the file.
+  ~AsyncAudioFileWriter() override;
+
+  // Creates the file and starts the I/O thread. Not supported on platforms
+  // without POSIX file descriptors.
+  bool Open() override;
+
+  // Queues one frame without blocking. Frames are never split: if the whole
+  // frame does not fit, it is dropped and counted.
+  bool Write(const int8_t *frame, size_t length) override;
+
+private:
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  // Writes |length| bytes from |_chunk|. Returns false on an I/O error.
+  bool WriteChunk(size_t length);
+
+  std::string _filename;
+  AudioWriterStats *_stats;
+  bool _directIo;
+  SpscRingBuffer _ring;
+
+  int _fd = -1;
+  uint8_t *_chunk = nullptr;
+
+  std::atomic<bool> _stopped{false};
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
@@ -0,0 +1,50 @@
+#include "AsyncFuture.h"
+
+#include <rtc_base/logging.h>
+
+#include "CallbackDispatcher.h"
+
+std::shared_ptr<AsyncFuture> AsyncFuture::Create(std::shared_ptr<CallbackDispatcher> dispatcher) {
+  auto loop = py::module_::import("asyncio").attr("get_running_loop")();
+  auto future = loop.attr("create_future")();
+  return std::make_shared<AsyncFuture>(std::move(dispatcher), std::move(loop), std::move(future));
+}
+
+AsyncFuture::AsyncFuture(std::shared_ptr<CallbackDispatcher> dispatcher, py::object loop, py::object future)
+    : _dispatcher(std::move(dispatcher)), _loop(std::move(loop)), _future(std::move(future)) {
+}
+
+AsyncFuture::~AsyncFuture() {
+  py::gil_scoped_acquire acquire;
+  if (!_isResolved.exchange(true)) {
+    Complete("set_exception", py::reinterpret_borrow<py::object>(PyExc_RuntimeError)(
+        "the group call ended before the operation completed"));
+  }
+  _future = py::object();
+  _loop = py::object();
+}
+
+void AsyncFuture::Resolve(std::function<py::object()> makeResult) {
+  // Dropped by a stopped dispatcher, this leaves the future to the
+  // destructor's RuntimeError.
+  _dispatcher->Post([self = shared_from_this(), makeResult = std::move(makeResult)] {
+    if (!self->_isResolved.exchange(true)) {
+      self->Complete("set_result", makeResult());
+    }
+  });
+}
+
+void AsyncFuture::Complete(const char *method, py::object value) {
+  // The dispatcher thread isn't the loop's unless an EventQueue is set, so
+  // the future is always completed through call_soon_threadsafe().
+  try {
+    _loop.attr("call_soon_threadsafe")(py::cpp_function([future = _future, method, value = std::move(value)] {
+      if (!future.attr("done")().cast<bool>()) {
+        future.attr(method)(value);
+      }
+    }));
+  } catch (py::error_already_set &e) {
+    // The loop is closed; nobody awaits the future anymore.
+    RTC_LOG(LS_WARNING) << "AsyncFuture: " << e.what();
+  }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include <pybind11/pybind11.h>
+
+class CallbackDispatcher;
+
+namespace py = pybind11;
+
+// An asyncio future of the running loop that native threads resolve. The
+// result is made through the call's CallbackDispatcher, with the GIL held,
+// and set on the loop's thread, unless the future was cancelled meanwhile.
+// Dropped unresolved, e.g. with a completion the call never got to, it sets
+// a RuntimeError instead, so an await doesn't hang when the call goes away.
+class AsyncFuture : public std::enable_shared_from_this<AsyncFuture> {
+public:
+  // With the GIL held, on the thread of a running loop.
+  static std::shared_ptr<AsyncFuture> Create(std::shared_ptr<CallbackDispatcher> dispatcher);
+
+  AsyncFuture(std::shared_ptr<CallbackDispatcher> dispatcher, py::object loop, py::object future);
+  // Takes the GIL, from whatever thread drops the last reference.
+  ~AsyncFuture();
+
+  AsyncFuture(AsyncFuture const &) = delete;
+  AsyncFuture &operator=(AsyncFuture const &) = delete;
+
+  py::object future() const { return _future; }
+
+  // Any thread; |makeResult| runs with the GIL held, on the dispatcher's
+  // thread or loop. Later calls are ignored.
+  void Resolve(std::function<py::object()> makeResult);
+
+private:
+  // With the GIL held.
+  void Complete(const char *method, py::object value);
+
+  std::shared_ptr<CallbackDispatcher> _dispatcher;
+  py::object _loop;
+  py::object _future;
+  // Set with the GIL held.
+  std::atomic<bool> _isResolved{false};
+};
@@ -0,0 +1,86 @@
+#include "AudioBlock.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <common_audio/include/audio_util.h>
+
+namespace {
+
+bool IsCContiguous(const py::buffer_info &info) {
+  py::ssize_t stride = info.itemsize;
+  for (py::ssize_t i = info.ndim - 1; i >= 0; i--) {
+    if (info.shape[i] > 1 && info.strides[i] != stride) {
+      return false;
+    }
+    stride *= info.shape[i];
+  }
+  return true;
+}
+
+}  // namespace
+
+AudioBlock::AudioBlock(size_t channels, size_t frames, bool isFloat)
+    : _channels(channels), _frames(frames), _isFloat(isFloat) {
+  if (isFloat) {
+    _floatSamples.resize(channels * frames);
+  } else {
+    _samples.resize(channels * frames);
+  }
+}
+
+std::shared_ptr<AudioBlock> AudioBlock::Read(SpscRingBuffer &ring, size_t channels, size_t frames, bool isFloat) {
+  channels = std::max(channels, size_t(1));
+  frames = std::min(frames, ring.ReadAvailable() / (channels * sizeof(int16_t)));
+  auto block = std::make_shared<AudioBlock>(channels, frames, isFloat);
+  const size_t length = channels * frames * sizeof(int16_t);
+  if (!isFloat) {
+    ring.Read(reinterpret_cast<uint8_t *>(block->_samples.data()), length);
+    return block;
+  }
+  // The int16 samples go through a scratch buffer kept per thread, so
+  // popping float32 allocates nothing but the block itself.
+  thread_local std::vector<int16_t> scratch;
+  scratch.resize(channels * frames);
+  ring.Read(reinterpret_cast<uint8_t *>(scratch.data()), length);
+  webrtc::S16ToFloat(scratch.data(), scratch.size(), block->_floatSamples.data());
+  return block;
+}
+
+std::shared_ptr<AudioBlock> AudioBlock::FromSamples(const int16_t *samples, size_t channels, size_t frames, bool isFloat) {
+  auto block = std::make_shared<AudioBlock>(channels, frames, isFloat);
+  if (isFloat) {
+    webrtc::S16ToFloat(samples, channels * frames, block->_floatSamples.data());
+  } else {
+    std::copy(samples, samples + channels * frames, block->_samples.begin());
+  }
+  return block;
+}
+
+py::buffer_info AudioBlock::buffer() {
+  const auto itemSize = static_cast<py::ssize_t>(_isFloat ? sizeof(float) : sizeof(int16_t));
+  void *data = _isFloat ? static_cast<void *>(_floatSamples.data()) : static_cast<void *>(_samples.data());
+  const auto format = _isFloat ? py::format_descriptor<float>::format() : py::format_descriptor<int16_t>::format();
+  return py::buffer_info(
+      data, itemSize, format, 2,
+      {static_cast<py::ssize_t>(_frames), static_cast<py::ssize_t>(_channels)},
+      {static_cast<py::ssize_t>(_channels) * itemSize, itemSize});
+}
+
+PcmInput::PcmInput(const py::buffer &buffer) : _info(buffer.request()) {
+  if (!IsCContiguous(_info)) {
+    throw std::invalid_argument("audio buffers must be C-contiguous");
+  }
+  const auto count = static_cast<size_t>(_info.size);
+  if (_info.format == py::format_descriptor<float>::format()) {
+    _converted.resize(count);
+    webrtc::FloatToS16(static_cast<const float *>(_info.ptr), count, _converted.data());
+    _data = reinterpret_cast<const uint8_t *>(_converted.data());
+    _size = count * sizeof(int16_t);
+  } else if (_info.itemsize == sizeof(int16_t) || _info.itemsize == 1) {
+    _data = static_cast<const uint8_t *>(_info.ptr);
+    _size = count * static_cast<size_t>(_info.itemsize);
+  } else {
+    throw std::invalid_argument("audio buffers must hold int16 or float32 samples, or s16le bytes");
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+
+#include "SpscRingBuffer.h"
+
+namespace py = pybind11;
+
+// Interleaved PCM owned by C++ and handed to Python as it is: the buffer
+// protocol exposes it shaped (frames, channels), as int16 or as float32 in
+// [-1, 1). numpy.asarray(block) and memoryview(block) view it in place and
+// keep it alive, so popping audio makes no bytes object and no copy of it.
+class AudioBlock {
+public:
+  AudioBlock(size_t channels, size_t frames, bool isFloat);
+
+  // Up to |frames| whole frames of s16le from |ring|, which the caller is
+  // the only consumer of; float32 is converted from them natively.
+  static std::shared_ptr<AudioBlock> Read(SpscRingBuffer &ring, size_t channels, size_t frames, bool isFloat);
+  static std::shared_ptr<AudioBlock> FromSamples(const int16_t *samples, size_t channels, size_t frames, bool isFloat);
+
+  size_t channels() const { return _channels; }
+  size_t frames() const { return _frames; }
+  bool isFloat() const { return _isFloat; }
+
+  py::buffer_info buffer();
+
+private:
+  size_t _channels = 0;
+  size_t _frames = 0;
+  bool _isFloat = false;
+  std::vector<int16_t> _samples;
+  std::vector<float> _floatSamples;
+};
+
+// Samples of a buffer pushed from Python, as s16le: int16 buffers as they
+// are, float32 ones in [-1, 1] converted natively, and bytes-like ones taken
+// as s16le already. Any C-contiguous shape, so (frames, channels) arrays
+// work as well as flat ones.
+class PcmInput {
+public:
+  explicit PcmInput(const py::buffer &buffer);
+
+  const uint8_t *data() const { return _data; }
+  size_t size() const { return _size; }
+
+private:
+  py::buffer_info _info;
+  std::vector<int16_t> _converted;
+  const uint8_t *_data = nullptr;
+  size_t _size = 0;
+};
@@ -0,0 +1,88 @@
+#include "AudioDeadlineClock.h"
+
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+#include <time.h>
+#endif
+
+#include <tgcalls/SimulatedClock.h>
+
+AudioDeadlineClock::AudioDeadlineClock(AudioClockStats *stats,
+                                       int64_t periodNanos,
+                                       int maxCatchUpTicks)
+    : _stats(stats),
+      _periodNanos(periodNanos),
+      _maxCatchUpTicks(maxCatchUpTicks < 1 ? 1 : maxCatchUpTicks),
+      _nextDeadlineNanos(0) {}
+
+void AudioDeadlineClock::Reset() {
+  _nextDeadlineNanos = NowNanos();
+}
+
+int AudioDeadlineClock::WaitForNextTick() {
+  if (_nextDeadlineNanos == 0) {
+    Reset();
+  }
+
+  int64_t now = NowNanos();
+  if (now < _nextDeadlineNanos) {
+    SleepUntilNanos(_nextDeadlineNanos);
+    _nextDeadlineNanos += _periodNanos;
+    return 1;
+  }
+
+  // We are at or past the deadline: every period elapsed since then is a
+  // tick that is due right now.
+  int64_t dueTicks = (now - _nextDeadlineNanos) / _periodNanos + 1;
+  int64_t processTicks = dueTicks;
+  if (processTicks > _maxCatchUpTicks) {
+    processTicks = _maxCatchUpTicks;
+    if (_stats) {
+      _stats->droppedTicks += static_cast<uint64_t>(dueTicks - processTicks);
+      tgcalls::HotPathCounters::onAudioTicksDropped(_stats->device, static_cast<uint64_t>(dueTicks - processTicks));
+    }
+  }
+  if (_stats && processTicks > 1) {
+    _stats->lateTicks += static_cast<uint64_t>(processTicks - 1);
+    tgcalls::HotPathCounters::onAudioTicksLate(_stats->device, static_cast<uint64_t>(processTicks - 1));
+  }
+  _nextDeadlineNanos += dueTicks * _periodNanos;
+
+  return static_cast<int>(processTicks);
+}
+
+int64_t AudioDeadlineClock::NowNanos() {
+  if (tgcalls::SimulatedClock::isEnabled()) {
+    return tgcalls::SimulatedClock::nowNanos();
+  }
+#if defined(CLOCK_MONOTONIC)
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void AudioDeadlineClock::SleepUntilNanos(int64_t deadlineNanos) {
+  if (tgcalls::SimulatedClock::isEnabled()) {
+    tgcalls::SimulatedClock::sleepUntilNanos(deadlineNanos);
+    return;
+  }
+#if defined(__linux__) || defined(__FreeBSD__)
+  timespec ts{};
+  ts.tv_sec = static_cast<time_t>(deadlineNanos / 1000000000LL);
+  ts.tv_nsec = static_cast<long>(deadlineNanos % 1000000000LL);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+  }
+#else
+  int64_t delta = deadlineNanos - NowNanos();
+  if (delta > 0) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(delta));
+  }
+#endif
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <tgcalls/HotPathCounters.h>
+
+// Counters of ticks that were not served on time by an AudioDeadlineClock.
+// Shared between the audio device threads and Python, so all fields are atomic.
+// The process-wide HotPathCounters get them too, under |device|.
+struct AudioClockStats {
+  explicit AudioClockStats(tgcalls::HotPathCounters::AudioDevice device = tgcalls::HotPathCounters::AudioDevice::Other)
+      : device(device) {}
+
+  const tgcalls::HotPathCounters::AudioDevice device;
+  // Ticks that were processed after their deadline (caught up in a burst).
+  std::atomic<uint64_t> lateTicks{0};
+  // Ticks that were skipped entirely because the catch-up limit was exceeded.
+  std::atomic<uint64_t> droppedTicks{0};
+};
+
+// Monotonic absolute-deadline clock for the 10 ms audio device ticks.
+//
+// Deadlines are computed as |start + n * period| rather than "now + period",
+// so the time spent processing a frame never accumulates into drift. When the
+// thread falls behind, up to |maxCatchUpTicks| frames are processed back to
+// back; anything older than that is dropped and the schedule jumps forward.
+class AudioDeadlineClock {
+public:
+  static constexpr int64_t kDefaultPeriodNanos = 10 * 1000 * 1000;
+  static constexpr int kDefaultMaxCatchUpTicks = 4;
+
+  explicit AudioDeadlineClock(AudioClockStats *stats = nullptr,
+                              int64_t periodNanos = kDefaultPeriodNanos,
+                              int maxCatchUpTicks = kDefaultMaxCatchUpTicks);
+
+  // Restarts the schedule so that the first tick is due immediately.
+  void Reset();
+
+  // Blocks until the next deadline and returns the number of ticks that must
+  // be processed now (always in range [1, maxCatchUpTicks]).
+  int WaitForNextTick();
+
+  int64_t PeriodNanos() const { return _periodNanos; }
+
+  // Current CLOCK_MONOTONIC time in nanoseconds, or the virtual time of
+  // tgcalls::SimulatedClock once it is enabled.
+  static int64_t NowNanos();
+
+  // Sleeps until the absolute time |deadlineNanos| of NowNanos().
+  static void SleepUntilNanos(int64_t deadlineNanos);
+
+private:
+  AudioClockStats *_stats;
+  int64_t _periodNanos;
+  int _maxCatchUpTicks;
+  int64_t _nextDeadlineNanos;
+};
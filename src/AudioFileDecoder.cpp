@@ -0,0 +1,352 @@
+#include "AudioFileDecoder.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+
+namespace {
+
+// How often the decoding thread checks for free space in the ring. The ring
+// holds far more than this, so polling never starves the capture thread.
+const auto kRefillInterval = std::chrono::milliseconds(10);
+
+}  // namespace
+
+AudioFileDecoder::AudioFileDecoder(std::string filename, AudioFormat format, size_t readAheadBytes)
+    : _filename(std::move(filename)),
+      _format(format),
+      _ring(readAheadBytes) {}
+
+AudioFileDecoder::~AudioFileDecoder() {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  if (_thread) {
+    _thread->Stop();
+    _thread.reset();
+  }
+  Close();
+}
+
+bool AudioFileDecoder::Open() {
+  if (!OpenInput()) {
+    return false;
+  }
+
+  _thread.reset(new rtc::PlatformThread(
+      ThreadFunc, this, "tgcalls_audio_decoder", rtc::kNormalPriority));
+  _thread->Start();
+  return true;
+}
+
+bool AudioFileDecoder::DecodeFile(const std::string &filename, AudioFormat format,
+                                  std::vector<int8_t> *output) {
+  AudioFileDecoder decoder(filename, format, 0);
+  if (!decoder.OpenInput()) {
+    return false;
+  }
+
+  output->clear();
+  bool more = true;
+  while (more) {
+    more = decoder.DecodeNextFrame();
+    output->insert(output->end(), decoder._pending.begin(), decoder._pending.end());
+    decoder._pending.clear();
+  }
+  return !output->empty();
+}
+
+bool AudioFileDecoder::OpenInput() {
+  int ret = avformat_open_input(&_formatContext, _filename.c_str(), nullptr, nullptr);
+  if (ret < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open audio input file: " << _filename;
+    return false;
+  }
+
+  ret = avformat_find_stream_info(_formatContext, nullptr);
+  if (ret < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to read stream info: " << _filename;
+    Close();
+    return false;
+  }
+
+  _streamIndex = av_find_best_stream(_formatContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+  if (_streamIndex < 0) {
+    RTC_LOG(LS_ERROR) << "No audio stream in input file: " << _filename;
+    Close();
+    return false;
+  }
+
+  AVCodecParameters *codecParameters = _formatContext->streams[_streamIndex]->codecpar;
+  const AVCodec *codec = avcodec_find_decoder(codecParameters->codec_id);
+  if (!codec) {
+    RTC_LOG(LS_ERROR) << "Unsupported audio codec in input file: " << _filename;
+    Close();
+    return false;
+  }
+
+  _codecContext = avcodec_alloc_context3(codec);
+  if (!_codecContext ||
+      avcodec_parameters_to_context(_codecContext, codecParameters) < 0 ||
+      avcodec_open2(_codecContext, codec, nullptr) < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open audio decoder for input file: " << _filename;
+    Close();
+    return false;
+  }
+
+  int64_t inputLayout = _codecContext->channel_layout
+      ? static_cast<int64_t>(_codecContext->channel_layout)
+      : av_get_default_channel_layout(_codecContext->channels);
+  _resampler = swr_alloc_set_opts(
+      nullptr,
+      _format.channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO,
+      AV_SAMPLE_FMT_S16, _format.sampleRate,
+      inputLayout, _codecContext->sample_fmt, _codecContext->sample_rate,
+      0, nullptr);
+  if (!_resampler || swr_init(_resampler) < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to set up resampler for input file: " << _filename;
+    Close();
+    return false;
+  }
+
+  _frame = av_frame_alloc();
+  _packet = av_packet_alloc();
+  if (!_frame || !_packet) {
+    Close();
+    return false;
+  }
+
+  RTC_LOG(LS_INFO) << "Decoding " << avcodec_get_name(codecParameters->codec_id)
+                   << " input file: " << _filename;
+  return true;
+}
+
+size_t AudioFileDecoder::Read(int8_t *data, size_t length) {
+  uint64_t request = _seekRequest;
+  if (_seekDone != request) {
+    // Discard PCM decoded before the seek. Once the decoder has stopped
+    // writing, the ring holds nothing newer, so it can be released.
+    bool stopped = _seekStopped == request;
+    uint8_t discard[4096];
+    while (_ring.Read(discard, sizeof(discard)) > 0) {
+    }
+    if (stopped && _seekDrained != request) {
+      _seekDrained = request;
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wakeUp.notify_one();
+    }
+    return 0;
+  }
+  return _ring.Read(reinterpret_cast<uint8_t *>(data), length);
+}
+
+bool AudioFileDecoder::Finished() const {
+  return _seekDone == _seekRequest && _endOfFile && _ring.ReadAvailable() == 0;
+}
+
+void AudioFileDecoder::Rewind() {
+  Seek(0);
+}
+
+void AudioFileDecoder::Seek(int64_t positionMs) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _seekTargetMs = positionMs < 0 ? 0 : positionMs;
+  _seekRequest++;
+  _wakeUp.notify_one();
+}
+
+void AudioFileDecoder::ThreadFunc(void *pThis) {
+  static_cast<AudioFileDecoder *>(pThis)->Run();
+}
+
+void AudioFileDecoder::Run() {
+  bool decoderFinished = false;
+  auto seekRequested = [this] { return _seekRequest != _seekDone; };
+
+  while (!_stopped) {
+    uint64_t request = _seekRequest;
+    if (request != _seekDone) {
+      _seekStopped = request;
+      if (_seekDrained != request) {
+        // Wait for the capture thread to drop what was decoded before.
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wakeUp.wait_for(lock, kRefillInterval, [this, request] {
+          return _stopped || _seekDrained == request || _seekRequest != request;
+        });
+        continue;
+      }
+      SeekToTarget();
+      decoderFinished = false;
+      _endOfFile = false;
+      _seekDone = request;
+    }
+
+    if (_pendingOffset < _pending.size()) {
+      _pendingOffset += _ring.Write(_pending.data() + _pendingOffset, _pending.size() - _pendingOffset);
+    }
+
+    if (_pendingOffset < _pending.size()) {
+      // The ring is full; wait for the capture thread to drain it.
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wakeUp.wait_for(lock, kRefillInterval, [this, &seekRequested] { return _stopped || seekRequested(); });
+      continue;
+    }
+
+    if (decoderFinished) {
+      std::unique_lock<std::mutex> lock(_mutex);
+      // Seek() may already have asked for the next pass.
+      if (!seekRequested()) {
+        _endOfFile = true;
+      }
+      _wakeUp.wait(lock, [this, &seekRequested] { return _stopped || seekRequested(); });
+      continue;
+    }
+
+    _pending.clear();
+    _pendingOffset = 0;
+    if (!DecodeNextFrame()) {
+      decoderFinished = true;
+    }
+    SkipPendingSamples();
+  }
+}
+
+bool AudioFileDecoder::DecodeNextFrame() {
+  while (true) {
+    int ret = avcodec_receive_frame(_codecContext, _frame);
+    if (ret == 0) {
+      bool resampled = ResampleFrame();
+      av_frame_unref(_frame);
+      return resampled;
+    }
+
+    if (ret == AVERROR_EOF) {
+      // Drain what the resampler still buffers.
+      int outSamples = swr_get_out_samples(_resampler, 0);
+      if (outSamples > 0) {
+        _pending.resize(outSamples * (_format.channels * 2));
+        uint8_t *out = _pending.data();
+        int converted = swr_convert(_resampler, &out, outSamples, nullptr, 0);
+        _pending.resize(converted > 0 ? converted * (_format.channels * 2) : 0);
+      }
+      return false;
+    }
+
+    if (ret != AVERROR(EAGAIN) || _flushingDecoder) {
+      RTC_LOG(LS_ERROR) << "Audio decoding failed for input file: " << _filename;
+      return false;
+    }
+
+    ret = av_read_frame(_formatContext, _packet);
+    if (ret < 0) {
+      // End of input: flush the frames the decoder still holds.
+      avcodec_send_packet(_codecContext, nullptr);
+      _flushingDecoder = true;
+      continue;
+    }
+
+    if (_packet->stream_index == _streamIndex) {
+      // Corrupt packets are skipped rather than ending the stream.
+      avcodec_send_packet(_codecContext, _packet);
+    }
+    av_packet_unref(_packet);
+  }
+}
+
+bool AudioFileDecoder::ResampleFrame() {
+  if (_seekSkipPending) {
+    // The demuxer lands on a packet at or before the target; work out how
+    // many samples lie in between from where decoding actually resumed.
+    _seekSkipPending = false;
+    AVStream *stream = _formatContext->streams[_streamIndex];
+    int64_t pts = _frame->best_effort_timestamp;
+    if (pts != AV_NOPTS_VALUE) {
+      if (stream->start_time != AV_NOPTS_VALUE) {
+        pts -= stream->start_time;
+      }
+      int64_t resumedAt = av_rescale_q(pts, stream->time_base, AVRational{1, _format.sampleRate});
+      _seekSkipSamples -= resumedAt;
+    } else {
+      _seekSkipSamples = 0;
+    }
+  }
+
+  int outSamples = swr_get_out_samples(_resampler, _frame->nb_samples);
+  if (outSamples <= 0) {
+    return true;
+  }
+
+  _pending.resize(outSamples * (_format.channels * 2));
+  uint8_t *out = _pending.data();
+  int converted = swr_convert(_resampler, &out, outSamples,
+                              const_cast<const uint8_t **>(_frame->extended_data),
+                              _frame->nb_samples);
+  if (converted < 0) {
+    RTC_LOG(LS_ERROR) << "Audio resampling failed for input file: " << _filename;
+    _pending.clear();
+    return false;
+  }
+  _pending.resize(converted * (_format.channels * 2));
+  return true;
+}
+
+void AudioFileDecoder::SkipPendingSamples() {
+  if (_seekSkipPending || _seekSkipSamples <= 0) {
+    return;
+  }
+
+  size_t sampleBytes = _format.channels * 2;
+  size_t skip = std::min(static_cast<size_t>(_seekSkipSamples) * sampleBytes, _pending.size());
+  _pending.erase(_pending.begin(), _pending.begin() + skip);
+  _seekSkipSamples -= static_cast<int64_t>(skip / sampleBytes);
+}
+
+void AudioFileDecoder::SeekToTarget() {
+  _pending.clear();
+  _pendingOffset = 0;
+  _flushingDecoder = false;
+
+  int64_t targetMs = _seekTargetMs;
+  AVStream *stream = _formatContext->streams[_streamIndex];
+  int64_t timestamp = av_rescale_q(targetMs, AVRational{1, 1000}, stream->time_base);
+  if (stream->start_time != AV_NOPTS_VALUE) {
+    timestamp += stream->start_time;
+  }
+
+  av_seek_frame(_formatContext, _streamIndex, timestamp, AVSEEK_FLAG_BACKWARD);
+  avcodec_flush_buffers(_codecContext);
+  swr_init(_resampler);
+
+  _seekSkipSamples = targetMs * _format.sampleRate / 1000;
+  _seekSkipPending = _seekSkipSamples > 0;
+}
+
+void AudioFileDecoder::Close() {
+  if (_packet) {
+    av_packet_free(&_packet);
+  }
+  if (_frame) {
+    av_frame_free(&_frame);
+  }
+  if (_resampler) {
+    swr_free(&_resampler);
+  }
+  if (_codecContext) {
+    avcodec_free_context(&_codecContext);
+  }
+  if (_formatContext) {
+    avformat_close_input(&_formatContext);
+  }
+}
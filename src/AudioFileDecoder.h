@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "SpscRingBuffer.h"
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+struct SwrContext;
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+// Decodes any audio file FFmpeg can demux (opus, mp3, aac, flac, ...) into
+// s16le PCM of the requested format.
+//
+// Decoding runs ahead on a background thread into a lock-free ring, so the
+// realtime capture thread only ever copies already decoded PCM and never
+// waits for the demuxer or the codec.
+class AudioFileDecoder {
+public:
+  // One second of default format output.
+  static constexpr size_t kDefaultReadAheadBytes = 48000 * 2 * 2;
+
+  explicit AudioFileDecoder(std::string filename,
+                            AudioFormat format = AudioFormat(),
+                            size_t readAheadBytes = kDefaultReadAheadBytes);
+  ~AudioFileDecoder();
+
+  // Opens the input and starts the decoding thread. Returns false if the file
+  // cannot be opened or has no decodable audio stream.
+  bool Open();
+
+  // Decodes the whole of |filename| on the calling thread into |output|.
+  static bool DecodeFile(const std::string &filename, AudioFormat format,
+                         std::vector<int8_t> *output);
+
+  // Copies up to |length| bytes of decoded PCM without blocking and returns
+  // how many were available. Called from the capture thread only.
+  size_t Read(int8_t *data, size_t length);
+
+  // True once the whole file has been decoded and read.
+  bool Finished() const;
+
+  // Restarts decoding from the beginning of the file.
+  void Rewind();
+
+  // Continues playback at |positionMs|, sample-accurately. Returns at once;
+  // Read() yields nothing until the decoder has caught up. Called from the
+  // capture thread only.
+  void Seek(int64_t positionMs);
+
+private:
+  // Sets up demuxer, decoder and resampler without starting the thread.
+  bool OpenInput();
+
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  // Decodes and resamples the next frame into |_pending|. Returns false on
+  // end of file or on an unrecoverable error.
+  bool DecodeNextFrame();
+
+  bool ResampleFrame();
+
+  // Seeks the demuxer to |_seekTargetMs| and arranges for the samples before
+  // it to be dropped.
+  void SeekToTarget();
+
+  // Drops the samples still to be skipped after a seek from |_pending|.
+  void SkipPendingSamples();
+
+  void Close();
+
+  std::string _filename;
+  AudioFormat _format;
+  SpscRingBuffer _ring;
+
+  AVFormatContext *_formatContext = nullptr;
+  AVCodecContext *_codecContext = nullptr;
+  SwrContext *_resampler = nullptr;
+  AVFrame *_frame = nullptr;
+  AVPacket *_packet = nullptr;
+  int _streamIndex = -1;
+  bool _flushingDecoder = false;
+
+  // Resampled PCM that did not fit into |_ring| yet.
+  std::vector<uint8_t> _pending;
+  size_t _pendingOffset = 0;
+
+  // Samples before the seek target still to be dropped, once the first
+  // frame after the seek tells where decoding resumed.
+  bool _seekSkipPending = false;
+  int64_t _seekSkipSamples = 0;
+
+  std::atomic<bool> _stopped{false};
+  std::atomic<bool> _endOfFile{false};
+
+  // Seek handshake, counted in requests so no read-ahead PCM from before a
+  // seek is ever played: the decoder stops writing (|_seekStopped|), the
+  // capture thread drains the ring (|_seekDrained|), then the decoder seeks
+  // and resumes (|_seekDone|).
+  std::atomic<int64_t> _seekTargetMs{0};
+  std::atomic<uint64_t> _seekRequest{0};
+  std::atomic<uint64_t> _seekStopped{0};
+  std::atomic<uint64_t> _seekDrained{0};
+  std::atomic<uint64_t> _seekDone{0};
+
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
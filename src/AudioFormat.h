@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+
+// PCM format (s16le) exchanged with a custom audio device in one direction.
+// AudioDeviceBuffer resamples to and from whatever webrtc uses internally, so
+// e.g. a mono 16 kHz bot never has to upmix in Python.
+struct AudioFormat {
+  int sampleRate = 48000;
+  size_t channels = 2;
+
+  size_t FramesPer10Ms() const { return static_cast<size_t>(sampleRate / 100); }
+
+  size_t BytesPer10Ms() const { return FramesPer10Ms() * channels * 2; }
+
+  static bool IsSupportedSampleRate(int sampleRate) {
+    return sampleRate == 8000 || sampleRate == 16000 || sampleRate == 24000 ||
+           sampleRate == 32000 || sampleRate == 48000;
+  }
+
+  static int CheckedSampleRate(int sampleRate) {
+    if (!IsSupportedSampleRate(sampleRate)) {
+      throw std::invalid_argument("sample rate must be 8000, 16000, 24000, 32000 or 48000");
+    }
+    return sampleRate;
+  }
+
+  static size_t CheckedChannels(size_t channels) {
+    if (channels != 1 && channels != 2) {
+      throw std::invalid_argument("channels must be 1 (mono) or 2 (stereo)");
+    }
+    return channels;
+  }
+};
@@ -0,0 +1,54 @@
+#include "AudioFrameSlab.h"
+
+#include <algorithm>
+#include <cstring>
+
+AudioFrameSlab::AudioFrameSlab(size_t slotCount)
+    : _slots(std::max<size_t>(slotCount, 1)),
+      _released(_slots.size(), 0) {}
+
+bool AudioFrameSlab::Write(const tgcalls::AudioFrame &frame) {
+  const size_t samples = frame.num_samples * frame.num_channels;
+  if (samples > kMaxSlotSamples) {
+    return false;
+  }
+
+  const uint64_t written = _written.load(std::memory_order_relaxed);
+  if (written - _freed.load(std::memory_order_acquire) >= _slots.size()) {
+    return false;
+  }
+
+  Slot &slot = _slots[written % _slots.size()];
+  memcpy(slot.samples, frame.audio_samples, samples * sizeof(int16_t));
+  slot.samplesPerChannel = frame.num_samples;
+  slot.channels = frame.num_channels;
+  slot.sampleRate = static_cast<int>(frame.samples_per_sec);
+  slot.elapsedTimeMs = frame.elapsed_time_ms;
+
+  _written.store(written + 1, std::memory_order_release);
+  return true;
+}
+
+int64_t AudioFrameSlab::Acquire() {
+  if (_acquired == _written.load(std::memory_order_acquire)) {
+    return -1;
+  }
+  return static_cast<int64_t>(_acquired++);
+}
+
+void AudioFrameSlab::Release(int64_t index) {
+  _released[static_cast<size_t>(index) % _slots.size()] = 1;
+
+  // Frees the run of released slots at the head; only the consumer gets
+  // here, so |_freed| has no other writer.
+  uint64_t freed = _freed.load(std::memory_order_relaxed);
+  while (freed < _acquired && _released[freed % _slots.size()]) {
+    _released[freed % _slots.size()] = 0;
+    freed++;
+  }
+  _freed.store(freed, std::memory_order_release);
+}
+
+size_t AudioFrameSlab::ReadAvailable() const {
+  return static_cast<size_t>(_written.load(std::memory_order_acquire) - _acquired);
+}
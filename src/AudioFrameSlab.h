@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <tgcalls/AudioFrame.h>
+
+// A ring of preallocated 10 ms frame slots for one producer thread and one
+// consumer.
+//
+// The producer copies each frame into the next free slot. The consumer
+// acquires filled slots in order, reads them in place for as long as it
+// needs, and releases them, in any order, when done; a slot is only reused
+// once it and every slot before it have been released. Nothing is allocated
+// after construction.
+class AudioFrameSlab {
+public:
+  // Interleaved samples a slot holds: 10 ms of 48 kHz stereo.
+  static constexpr size_t kMaxSlotSamples = 480 * 2;
+
+  struct Slot {
+    int16_t samples[kMaxSlotSamples];
+    size_t samplesPerChannel = 0;
+    size_t channels = 0;
+    int sampleRate = 0;
+    int64_t elapsedTimeMs = 0;
+  };
+
+  explicit AudioFrameSlab(size_t slotCount);
+
+  // Producer side. False if every slot is in use or the frame doesn't fit
+  // a slot; the frame is dropped then.
+  bool Write(const tgcalls::AudioFrame &frame);
+
+  // Consumer side. The next filled slot, or -1 if there is none yet.
+  int64_t Acquire();
+  const Slot &slot(int64_t index) const { return _slots[static_cast<size_t>(index) % _slots.size()]; }
+  // Hands an acquired slot back; each one exactly once.
+  void Release(int64_t index);
+
+  // Filled slots not acquired yet; consumer side too.
+  size_t ReadAvailable() const;
+  size_t slotCount() const { return _slots.size(); }
+
+private:
+  std::vector<Slot> _slots;
+  // Consumer only: released out of order, waiting for the slots before
+  // them.
+  std::vector<uint8_t> _released;
+
+  // Monotonic slot counters; |_freed| trails |_acquired|, which trails
+  // |_written|.
+  alignas(64) std::atomic<uint64_t> _written{0};
+  alignas(64) std::atomic<uint64_t> _freed{0};
+  uint64_t _acquired = 0;
+};
@@ -0,0 +1,167 @@
+#include "AudioGlitchDetector.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <rtc_base/time_utils.h>
+
+#include "CallbackDispatcher.h"
+
+namespace {
+
+// A jump between frames counts when it is at least this big, a quarter of
+// full scale, and many times the slope next to it, so loud low notes and
+// sharp onsets within the audio don't.
+constexpr int32_t kMinDiscontinuity = 8192;
+constexpr int32_t kDiscontinuityToSlope = 8;
+constexpr int32_t kMinSlope = 256;
+
+}  // namespace
+
+AudioGlitchDetector::AudioGlitchDetector(AudioClockStats *clockStats)
+    : _clockStats(clockStats) {}
+
+void AudioGlitchDetector::OnCaptureFrame(const int16_t *samples, size_t count, int channels, bool isSilent, bool isShort) {
+  if (isShort) {
+    _stats.shortReads.fetch_add(1, std::memory_order_relaxed);
+    Report(AudioGlitchKind::ShortRead);
+  }
+  if (CheckSilentGap(_capture, isSilent)) {
+    _stats.captureSilentGaps.fetch_add(1, std::memory_order_relaxed);
+    Report(AudioGlitchKind::CaptureSilentGap);
+  }
+  if (CheckDiscontinuity(_capture, samples, count, channels)) {
+    _stats.captureDiscontinuities.fetch_add(1, std::memory_order_relaxed);
+    Report(AudioGlitchKind::CaptureDiscontinuity);
+  }
+  MaybeSend();
+}
+
+void AudioGlitchDetector::OnPlayoutFrame(const int16_t *samples, size_t count, int channels, bool isSilent, uint64_t concealments) {
+  for (uint64_t i = 0; i < concealments; i++) {
+    _stats.concealments.fetch_add(1, std::memory_order_relaxed);
+    Report(AudioGlitchKind::Concealment);
+  }
+  if (CheckSilentGap(_playout, isSilent)) {
+    _stats.playoutSilentGaps.fetch_add(1, std::memory_order_relaxed);
+    Report(AudioGlitchKind::PlayoutSilentGap);
+  }
+  if (CheckDiscontinuity(_playout, samples, count, channels)) {
+    _stats.playoutDiscontinuities.fetch_add(1, std::memory_order_relaxed);
+    Report(AudioGlitchKind::PlayoutDiscontinuity);
+  }
+  MaybeSend();
+}
+
+void AudioGlitchDetector::SetCallback(Callback callback) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _callback = std::move(callback);
+  _pending.clear();
+  // Only ticks late from now on are reported.
+  if (_clockStats) {
+    _sentLateTicks = _clockStats->lateTicks.load();
+    _sentDroppedTicks = _clockStats->droppedTicks.load();
+  }
+  _hasCallback = static_cast<bool>(_callback);
+}
+
+void AudioGlitchDetector::SetDispatcher(std::shared_ptr<CallbackDispatcher> dispatcher) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _dispatcher = std::move(dispatcher);
+}
+
+bool AudioGlitchDetector::CheckDiscontinuity(Path &path, const int16_t *samples, size_t count, int channels) {
+  if (channels <= 0 || count < static_cast<size_t>(channels) * 2) {
+    path.hasLast = false;
+    return false;
+  }
+  const size_t frames = count / channels;
+  const int checked = std::min(channels, 2);
+  bool found = false;
+  for (int c = 0; c < checked; c++) {
+    const int32_t first = samples[c];
+    const int32_t second = samples[channels + c];
+    if (path.hasLast) {
+      const int32_t jump = std::abs(first - path.last[c]);
+      const int32_t slope = std::max({std::abs(path.lastSlope[c]), std::abs(second - first), kMinSlope});
+      if (jump >= kMinDiscontinuity && jump > slope * kDiscontinuityToSlope) {
+        found = true;
+      }
+    }
+    path.last[c] = samples[(frames - 1) * channels + c];
+    path.lastSlope[c] = path.last[c] - samples[(frames - 2) * channels + c];
+  }
+  path.hasLast = true;
+  return found;
+}
+
+bool AudioGlitchDetector::CheckSilentGap(Path &path, bool isSilent) {
+  if (isSilent) {
+    if (path.silentFrames >= 0 && path.silentFrames <= kMaxGapFrames) {
+      path.silentFrames++;
+    }
+    return false;
+  }
+  const bool isGap = path.silentFrames > 0 && path.silentFrames <= kMaxGapFrames;
+  path.silentFrames = 0;
+  return isGap;
+}
+
+void AudioGlitchDetector::Report(AudioGlitchKind kind) {
+  if (!_hasCallback.load(std::memory_order_relaxed)) {
+    return;
+  }
+  AudioGlitchEvent event;
+  event.kind = kind;
+  event.timestampMs = rtc::TimeMillis();
+  std::lock_guard<std::mutex> lock(_mutex);
+  _pending.push_back(event);
+}
+
+void AudioGlitchDetector::MaybeSend() {
+  if (!_hasCallback.load(std::memory_order_relaxed)) {
+    return;
+  }
+  const int64_t nowMs = rtc::TimeMillis();
+  if (nowMs < _nextSendMs.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  std::vector<AudioGlitchEvent> events;
+  Callback callback;
+  std::shared_ptr<CallbackDispatcher> dispatcher;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (nowMs < _nextSendMs.load(std::memory_order_relaxed) || !_callback) {
+      return;
+    }
+    _nextSendMs = nowMs + kBatchIntervalMs;
+
+    if (_clockStats) {
+      const uint64_t lateTicks = _clockStats->lateTicks.load();
+      const uint64_t droppedTicks = _clockStats->droppedTicks.load();
+      if (lateTicks > _sentLateTicks) {
+        _pending.push_back({AudioGlitchKind::LateTicks, nowMs, lateTicks - _sentLateTicks});
+      }
+      if (droppedTicks > _sentDroppedTicks) {
+        _pending.push_back({AudioGlitchKind::DroppedTicks, nowMs, droppedTicks - _sentDroppedTicks});
+      }
+      _sentLateTicks = lateTicks;
+      _sentDroppedTicks = droppedTicks;
+    }
+    if (_pending.empty()) {
+      return;
+    }
+    events.swap(_pending);
+    callback = _callback;
+    dispatcher = _dispatcher;
+  }
+
+  if (dispatcher) {
+    dispatcher->Post([callback = std::move(callback), events = std::move(events)]() mutable {
+      callback(std::move(events));
+    });
+  } else {
+    callback(std::move(events));
+  }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "AudioDeadlineClock.h"
+
+class CallbackDispatcher;
+
+// Counters of audible discontinuities on the two paths of a PcmAudioDevice,
+// shared with Python. Capture is the audio the device sends into the call,
+// playout the audio it gets from it.
+struct AudioGlitchStats {
+  // Capture frames the source could not fill and padded with silence: a
+  // decoder or network input behind, a gap between queued inputs, a Python
+  // callback or ring running dry.
+  std::atomic<uint64_t> shortReads{0};
+  // Runs of digital silence, a few frames long, between frames with audio.
+  std::atomic<uint64_t> captureSilentGaps{0};
+  std::atomic<uint64_t> playoutSilentGaps{0};
+  // Jumps between one frame's last sample and the next frame's first far
+  // bigger than the slope on either side.
+  std::atomic<uint64_t> captureDiscontinuities{0};
+  std::atomic<uint64_t> playoutDiscontinuities{0};
+  // Times a stream in the playout mix started concealing missing audio:
+  // NetEq expansion, or a broadcast running out of decoded frames.
+  std::atomic<uint64_t> concealments{0};
+};
+
+enum class AudioGlitchKind {
+  LateTicks,
+  DroppedTicks,
+  ShortRead,
+  CaptureSilentGap,
+  PlayoutSilentGap,
+  CaptureDiscontinuity,
+  PlayoutDiscontinuity,
+  Concealment,
+};
+
+struct AudioGlitchEvent {
+  AudioGlitchKind kind = AudioGlitchKind::ShortRead;
+  // rtc::TimeMillis() when it was noticed; late and dropped ticks are
+  // noticed when the batch is sent.
+  int64_t timestampMs = 0;
+  // Occurrences in the event: ticks for the tick kinds, 1 otherwise.
+  uint64_t count = 1;
+};
+
+// Finds glitches in the frames a PcmAudioDevice exchanges and counts them in
+// |stats()|. With a callback set, they are also sent to it as events, in
+// batches at most once a second. Late and dropped ticks are taken from the
+// device's AudioClockStats when a batch is sent.
+//
+// OnCaptureFrame() and OnPlayoutFrame() are called from the device's capture
+// and playout ticks respectively; each path keeps state of its own.
+class AudioGlitchDetector {
+public:
+  // Longer runs of silence are taken for pauses in the audio.
+  static constexpr int kMaxGapFrames = 5;
+  static constexpr int64_t kBatchIntervalMs = 1000;
+
+  using Callback = std::function<void(std::vector<AudioGlitchEvent>)>;
+
+  explicit AudioGlitchDetector(AudioClockStats *clockStats);
+
+  // |isShort| if the source padded the frame.
+  void OnCaptureFrame(const int16_t *samples, size_t count, int channels, bool isSilent, bool isShort);
+  // |concealments| started while the frame was mixed.
+  void OnPlayoutFrame(const int16_t *samples, size_t count, int channels, bool isSilent, uint64_t concealments);
+
+  // Null stops the events.
+  void SetCallback(Callback callback);
+  // Set by NativeInstance when the call starts; events go through it
+  // rather than being sent from the audio threads.
+  void SetDispatcher(std::shared_ptr<CallbackDispatcher> dispatcher);
+
+  const AudioGlitchStats &stats() const { return _stats; }
+
+private:
+  struct Path {
+    // Silent frames in a row; -1 until the first frame with audio.
+    int silentFrames = -1;
+    bool hasLast = false;
+    int16_t last[2] = {0, 0};
+    int32_t lastSlope[2] = {0, 0};
+  };
+
+  // Returns true if the frame starts with a discontinuity.
+  static bool CheckDiscontinuity(Path &path, const int16_t *samples, size_t count, int channels);
+  // Returns true if |isSilent| ends a short run of silence.
+  static bool CheckSilentGap(Path &path, bool isSilent);
+
+  void Report(AudioGlitchKind kind);
+  void MaybeSend();
+
+  AudioClockStats *_clockStats;
+  AudioGlitchStats _stats;
+  Path _capture;
+  Path _playout;
+
+  // Whether a callback is set, so ticks skip |_mutex| otherwise.
+  std::atomic<bool> _hasCallback{false};
+  std::atomic<int64_t> _nextSendMs{0};
+  std::mutex _mutex;
+  Callback _callback;
+  std::shared_ptr<CallbackDispatcher> _dispatcher;
+  std::vector<AudioGlitchEvent> _pending;
+  uint64_t _sentLateTicks = 0;
+  uint64_t _sentDroppedTicks = 0;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+// Wakes the threads of a PcmAudioDevice that are parked while it is idle,
+// i.e. stopped or with both directions paused. Whoever changes what the
+// device's idle condition reads notifies after the change; the parked thread
+// checks the condition under the signal's lock, so no change is missed.
+class AudioIdleSignal {
+public:
+  // Bounds a wait on a condition that changed without a notification, e.g.
+  // through a pause callable set from Python.
+  static constexpr std::chrono::milliseconds kMaxWait{1000};
+
+  void Notify() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+    }
+    _condition.notify_all();
+  }
+
+  // Blocks for as long as |idle| returns true.
+  template <typename Predicate>
+  void WaitWhile(Predicate idle) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (idle()) {
+      _condition.wait_for(lock, kMaxWait);
+    }
+  }
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _condition;
+};
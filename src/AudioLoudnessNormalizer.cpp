@@ -0,0 +1,235 @@
+#include "AudioLoudnessNormalizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "AudioMixer.h"
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Blocks quieter than this never count (BS.1770's absolute gate), nor those
+// more than 10 LU below the rest (its relative gate).
+constexpr float kAbsoluteGateLufs = -70.0f;
+constexpr float kRelativeGate = 0.1f;
+
+float EnergyToLufs(double energy) {
+  return static_cast<float>(-0.691 + 10.0 * std::log10(energy));
+}
+
+float DbToGain(float db) {
+  return std::pow(10.0f, db / 20.0f);
+}
+
+}  // namespace
+
+void AudioLoudnessNormalizer::Prepare(const AudioFormat &format) {
+  _channels = format.channels;
+  _frames = format.FramesPer10Ms();
+  _sampleRate = format.sampleRate;
+  _samples.resize(_frames * _channels);
+  _filterState.resize(4 * _channels);
+  _energies.resize(kWindowMs / 10);
+
+  // The K-weighting of BS.1770: a high shelf for the head, then a high pass,
+  // recomputed for any sample rate.
+  const double fs = format.sampleRate;
+  {
+    const double f0 = 1681.974450955533;
+    const double gainDb = 3.999843853973347;
+    const double q = 0.7071752369554196;
+    const double k = std::tan(kPi * f0 / fs);
+    const double vh = std::pow(10.0, gainDb / 20.0);
+    const double vb = std::pow(vh, 0.4996667741545416);
+    const double a0 = 1.0 + k / q + k * k;
+    _shelf.b0 = static_cast<float>((vh + vb * k / q + k * k) / a0);
+    _shelf.b1 = static_cast<float>(2.0 * (k * k - vh) / a0);
+    _shelf.b2 = static_cast<float>((vh - vb * k / q + k * k) / a0);
+    _shelf.a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+    _shelf.a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+  }
+  {
+    const double f0 = 38.13547087602444;
+    const double q = 0.5003270373238773;
+    const double k = std::tan(kPi * f0 / fs);
+    const double a0 = 1.0 + k / q + k * k;
+    _highPass.b0 = 1.0f;
+    _highPass.b1 = -2.0f;
+    _highPass.b2 = 1.0f;
+    _highPass.a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+    _highPass.a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+  }
+
+  _lookahead = static_cast<size_t>(format.sampleRate) * kLookaheadMs / 1000;
+  _delay.resize(_lookahead * _channels);
+  _minGains.resize(_lookahead + 1);
+  _minTimes.resize(_lookahead + 1);
+  _heldGains.resize(_lookahead);
+  // Recovers from a peak over about 100 ms.
+  _releaseCoefficient = 1.0f - std::exp(-1.0f / (0.1f * format.sampleRate));
+
+  Reset();
+}
+
+void AudioLoudnessNormalizer::Reset() {
+  std::fill(_filterState.begin(), _filterState.end(), 0.0f);
+  _nextEnergy = 0;
+  _energyCount = 0;
+  _gainDb = 0;
+  _gain = 1;
+
+  std::fill(_delay.begin(), _delay.end(), 0.0f);
+  std::fill(_heldGains.begin(), _heldGains.end(), 1.0f);
+  _heldSum = static_cast<double>(_lookahead);
+  _held = 1;
+  _minHead = 0;
+  _minCount = 0;
+  _time = 0;
+}
+
+void AudioLoudnessNormalizer::Process(int16_t *frame) {
+  if (!_active) {
+    Reset();
+    _active = true;
+  }
+
+  const size_t samples = _frames * _channels;
+  float *x = _samples.data();
+  for (size_t i = 0; i < samples; i++) {
+    x[i] = frame[i];
+  }
+
+  // The energy is measured on the input, so the gain doesn't feed back
+  // into it. Samples are in s16 units, hence the scale to full scale.
+  const float energy = WeightedEnergy() / (32768.0f * 32768.0f);
+  _energies[_nextEnergy] = energy;
+  _nextEnergy = (_nextEnergy + 1) % _energies.size();
+  _energyCount = std::min(_energyCount + 1, _energies.size());
+
+  const float loudness = GatedLoudness();
+  if (!std::isnan(loudness)) {
+    const float wanted = std::max(-kMaxCutDb, std::min(kMaxBoostDb, _settings->targetLufs.load(std::memory_order_relaxed) - loudness));
+    const float step = kSlewDbPerSecond / 100.0f;
+    _gainDb += std::max(-step, std::min(step, wanted - _gainDb));
+    _settings->loudnessLufs.store(loudness, std::memory_order_relaxed);
+  }
+  _settings->gainDb.store(_gainDb, std::memory_order_relaxed);
+
+  // Ramped from the previous frame's gain to this one's over the frame.
+  const float gain = DbToGain(_gainDb);
+  const float gainStep = (gain - _gain) / static_cast<float>(_frames);
+  if (_channels == 2) {
+    for (size_t i = 0; i < _frames; i++) {
+      const float g = _gain + gainStep * static_cast<float>(i + 1);
+      x[2 * i] *= g;
+      x[2 * i + 1] *= g;
+    }
+  } else {
+    for (size_t i = 0; i < _frames; i++) {
+      x[i] *= _gain + gainStep * static_cast<float>(i + 1);
+    }
+  }
+  _gain = gain;
+
+  Limit();
+  AudioMixer::SaturateToS16(x, frame, samples);
+}
+
+float AudioLoudnessNormalizer::WeightedEnergy() {
+  const float *x = _samples.data();
+  double sum = 0;
+  for (size_t c = 0; c < _channels; c++) {
+    float *state = _filterState.data() + 4 * c;
+    float s1 = state[0], s2 = state[1], s3 = state[2], s4 = state[3];
+    float channelSum = 0;
+    for (size_t i = 0; i < _frames; i++) {
+      const float in = x[i * _channels + c];
+      const float shelved = _shelf.b0 * in + s1;
+      s1 = _shelf.b1 * in - _shelf.a1 * shelved + s2;
+      s2 = _shelf.b2 * in - _shelf.a2 * shelved;
+      const float weighted = _highPass.b0 * shelved + s3;
+      s3 = _highPass.b1 * shelved - _highPass.a1 * weighted + s4;
+      s4 = _highPass.b2 * shelved - _highPass.a2 * weighted;
+      channelSum += weighted * weighted;
+    }
+    state[0] = s1;
+    state[1] = s2;
+    state[2] = s3;
+    state[3] = s4;
+    sum += channelSum;
+  }
+  return static_cast<float>(sum / static_cast<double>(_frames));
+}
+
+float AudioLoudnessNormalizer::GatedLoudness() const {
+  static const float absoluteGate = std::pow(10.0f, (kAbsoluteGateLufs + 0.691f) / 10.0f);
+
+  double sum = 0;
+  size_t count = 0;
+  for (size_t i = 0; i < _energyCount; i++) {
+    if (_energies[i] > absoluteGate) {
+      sum += _energies[i];
+      count++;
+    }
+  }
+  if (count == 0) {
+    return std::numeric_limits<float>::quiet_NaN();
+  }
+
+  const double relativeGate = sum / static_cast<double>(count) * kRelativeGate;
+  double gatedSum = 0;
+  size_t gatedCount = 0;
+  for (size_t i = 0; i < _energyCount; i++) {
+    if (_energies[i] > absoluteGate && _energies[i] > relativeGate) {
+      gatedSum += _energies[i];
+      gatedCount++;
+    }
+  }
+  return EnergyToLufs(gatedSum / static_cast<double>(gatedCount));
+}
+
+void AudioLoudnessNormalizer::Limit() {
+  const float ceiling = 32768.0f * DbToGain(std::min(0.0f, _settings->ceilingDb.load(std::memory_order_relaxed)));
+  const size_t capacity = _minGains.size();
+  float *x = _samples.data();
+
+  for (size_t i = 0; i < _frames; i++, _time++) {
+    float peak = 0;
+    for (size_t c = 0; c < _channels; c++) {
+      peak = std::max(peak, std::fabs(x[i * _channels + c]));
+    }
+    const float needed = peak > ceiling ? ceiling / peak : 1.0f;
+
+    // The minimum of what the last |_lookahead| + 1 samples need, kept as
+    // an increasing run of (time, gain).
+    while (_minCount > 0 && _minGains[(_minHead + _minCount - 1) % capacity] >= needed) {
+      _minCount--;
+    }
+    const size_t back = (_minHead + _minCount) % capacity;
+    _minGains[back] = needed;
+    _minTimes[back] = _time;
+    _minCount++;
+    if (_minTimes[_minHead] + _lookahead < _time) {
+      _minHead = (_minHead + 1) % capacity;
+      _minCount--;
+    }
+
+    _held = std::min(_minGains[_minHead], _held + (1.0f - _held) * _releaseCoefficient);
+
+    // Averaged over the lookahead, every gain a delayed sample gets is at
+    // most what it needs, so it never exceeds the ceiling.
+    const size_t slot = _time % _lookahead;
+    _heldSum += _held - _heldGains[slot];
+    _heldGains[slot] = _held;
+    const float gain = static_cast<float>(_heldSum / static_cast<double>(_lookahead));
+
+    float *delayed = _delay.data() + slot * _channels;
+    for (size_t c = 0; c < _channels; c++) {
+      const float in = x[i * _channels + c];
+      x[i * _channels + c] = delayed[c] * gain;
+      delayed[c] = in;
+    }
+  }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AudioFormat.h"
+
+// Settings of a device's AudioLoudnessNormalizer, owned by its descriptor
+// and changed from Python at any time; the capture thread picks them up at
+// the next 10 ms frame.
+struct AudioLoudnessSettings {
+  std::atomic<bool> enabled{false};
+  std::atomic<float> targetLufs{-16.0f};
+  // Sample peak the limiter never lets through.
+  std::atomic<float> ceilingDb{-1.0f};
+
+  // Short-term loudness of the input and the gain applied to reach the
+  // target, as of the last frame.
+  std::atomic<float> loudnessLufs{-70.0f};
+  std::atomic<float> gainDb{0.0f};
+};
+
+// Brings the audio sent into a call to a common loudness on the fly, so
+// files don't have to be normalized offline.
+//
+// Loudness is measured as in EBU R128 / ITU-R BS.1770: K-weighted, over the
+// last 3 s (short-term), with its absolute and relative gates, so silence
+// and pauses don't pump the gain up. The gain follows it slowly and is
+// ramped within every frame; a lookahead limiter after it catches the peaks
+// a boost would clip, at the cost of kLookaheadMs of latency while enabled.
+class AudioLoudnessNormalizer {
+public:
+  static constexpr int kWindowMs = 3000;
+  static constexpr int kLookaheadMs = 5;
+  static constexpr float kMaxBoostDb = 12.0f;
+  static constexpr float kMaxCutDb = 24.0f;
+  // How fast the gain follows the measured loudness.
+  static constexpr float kSlewDbPerSecond = 6.0f;
+
+  // |settings| may be null, in which case Process() is never called.
+  explicit AudioLoudnessNormalizer(AudioLoudnessSettings *settings) : _settings(settings) {}
+
+  // Whether frames go through Process().
+  bool Enabled() const {
+    return _settings && _settings->enabled.load(std::memory_order_relaxed);
+  }
+
+  // Sizes the buffers and filters for |format|. Call before recording
+  // starts.
+  void Prepare(const AudioFormat &format);
+
+  // Normalizes one 10 ms frame in place. The first frame after a pause of
+  // Enabled() starts from a clean state.
+  void Process(int16_t *frame);
+
+  // Called for frames that bypass the normalizer.
+  void Bypass() { _active = false; }
+
+private:
+  struct Biquad {
+    float b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+  };
+
+  void Reset();
+  // Mean square of the K-weighted frame, summed over channels.
+  float WeightedEnergy();
+  // Short-term loudness over the gated window, or NaN when all of it is
+  // gated out.
+  float GatedLoudness() const;
+  void Limit();
+
+  AudioLoudnessSettings *const _settings;
+  bool _active = false;
+
+  size_t _channels = 0;
+  size_t _frames = 0;
+  int _sampleRate = 0;
+
+  std::vector<float> _samples;
+
+  Biquad _shelf;
+  Biquad _highPass;
+  // Two transposed direct form II states per filter and channel.
+  std::vector<float> _filterState;
+
+  // Energies of the last kWindowMs, one per frame.
+  std::vector<float> _energies;
+  size_t _nextEnergy = 0;
+  size_t _energyCount = 0;
+
+  float _gainDb = 0;
+  float _gain = 1;
+
+  // Limiter: the delayed input, the sliding minimum of the gain each sample
+  // needs over the lookahead, and the running average smoothing it.
+  size_t _lookahead = 0;
+  std::vector<float> _delay;
+  std::vector<float> _minGains;
+  std::vector<uint64_t> _minTimes;
+  size_t _minHead = 0;
+  size_t _minCount = 0;
+  std::vector<float> _heldGains;
+  double _heldSum = 0;
+  float _held = 1;
+  float _releaseCoefficient = 0;
+  uint64_t _time = 0;
+};
@@ -0,0 +1,148 @@
+#include "AudioMixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AUDIO_MIXER_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define AUDIO_MIXER_NEON 1
+#endif
+
+AudioMixer::AudioMixer(size_t inputs, size_t capacity) {
+  if (inputs == 0) {
+    throw std::invalid_argument("the mixer needs at least one input");
+  }
+  _inputs.reserve(inputs);
+  for (size_t i = 0; i < inputs; i++) {
+    _inputs.emplace_back(new Input(capacity));
+  }
+}
+
+AudioMixer::Input &AudioMixer::input(size_t index) {
+  if (index >= _inputs.size()) {
+    throw std::out_of_range("no such mixer input");
+  }
+  return *_inputs[index];
+}
+
+const AudioMixer::Input &AudioMixer::input(size_t index) const {
+  if (index >= _inputs.size()) {
+    throw std::out_of_range("no such mixer input");
+  }
+  return *_inputs[index];
+}
+
+void AudioMixer::SetDuckGain(float gain) {
+  _duckGain.store(ClampGain(std::min(gain, 1.0f)), std::memory_order_relaxed);
+}
+
+float AudioMixer::ClampGain(float gain) {
+  if (!(gain > 0.0f)) {
+    return 0.0f;
+  }
+  return std::min(gain, kMaxGain);
+}
+
+void AudioMixer::Prepare(size_t samples) {
+  _scratch.resize(samples);
+  _sum.resize(samples);
+}
+
+void AudioMixer::Mix(int16_t *out, size_t samples) {
+  if (_sum.size() < samples) {
+    // Not prepared for this block size; only happens if Prepare() was skipped.
+    Prepare(samples);
+  }
+
+  bool duckingInputActive = false;
+  for (auto &input : _inputs) {
+    if (input->ducksOthers.load(std::memory_order_relaxed) &&
+        !input->muted.load(std::memory_order_relaxed) &&
+        input->ring.ReadAvailable() > 0) {
+      duckingInputActive = true;
+      break;
+    }
+  }
+  if (duckingInputActive) {
+    _duckHold = kDuckHoldBlocks;
+  } else if (_duckHold > 0) {
+    _duckHold--;
+  }
+  bool ducking = _duckHold > 0;
+  _ducking.store(ducking, std::memory_order_relaxed);
+  float duckGain = _duckGain.load(std::memory_order_relaxed);
+
+  float *sum = _sum.data();
+  std::fill(sum, sum + samples, 0.0f);
+
+  for (auto &input : _inputs) {
+    size_t read = input->ring.Read(reinterpret_cast<uint8_t *>(_scratch.data()),
+                                   samples * sizeof(int16_t));
+    float target = input->muted.load(std::memory_order_relaxed)
+                       ? 0.0f
+                       : input->gain.load(std::memory_order_relaxed);
+    if (ducking && !input->ducksOthers.load(std::memory_order_relaxed)) {
+      target *= duckGain;
+    }
+
+    size_t count = read / sizeof(int16_t);
+    if (count == 0) {
+      input->appliedGain = target;
+      continue;
+    }
+    if (count < samples) {
+      input->underruns++;
+    }
+
+    // Ramp linearly from the previous block's gain across the whole block.
+    const int16_t *in = _scratch.data();
+    float gain = input->appliedGain;
+    float step = (target - gain) / static_cast<float>(samples);
+    if (step == 0.0f) {
+      for (size_t i = 0; i < count; i++) {
+        sum[i] += static_cast<float>(in[i]) * gain;
+      }
+    } else {
+      for (size_t i = 0; i < count; i++) {
+        sum[i] += static_cast<float>(in[i]) * (gain + step * static_cast<float>(i));
+      }
+    }
+    input->appliedGain = target;
+  }
+
+  SaturateToS16(sum, out, samples);
+}
+
+void AudioMixer::SaturateToS16(const float *in, int16_t *out, size_t samples) {
+  size_t i = 0;
+  // Sums stay far inside the int32 range (kMaxGain and a handful of inputs),
+  // so converting first and narrowing with saturation is exact.
+#if defined(AUDIO_MIXER_SSE2)
+  for (; i + 8 <= samples; i += 8) {
+    __m128i low = _mm_cvtps_epi32(_mm_loadu_ps(in + i));
+    __m128i high = _mm_cvtps_epi32(_mm_loadu_ps(in + i + 4));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(low, high));
+  }
+#elif defined(AUDIO_MIXER_NEON)
+  const float32x4_t half = vdupq_n_f32(0.5f);
+  for (; i + 8 <= samples; i += 8) {
+    // vcvtq rounds towards zero; bias by half away from zero first.
+    float32x4_t a = vld1q_f32(in + i);
+    float32x4_t b = vld1q_f32(in + i + 4);
+    a = vaddq_f32(a, vbslq_f32(vcltq_f32(a, vdupq_n_f32(0.0f)), vnegq_f32(half), half));
+    b = vaddq_f32(b, vbslq_f32(vcltq_f32(b, vdupq_n_f32(0.0f)), vnegq_f32(half), half));
+    int16x4_t low = vqmovn_s32(vcvtq_s32_f32(a));
+    int16x4_t high = vqmovn_s32(vcvtq_s32_f32(b));
+    vst1q_s16(out + i, vcombine_s16(low, high));
+  }
+#endif
+  for (; i < samples; i++) {
+    float sample = std::max(-32768.0f, std::min(32767.0f, in[i]));
+    out[i] = static_cast<int16_t>(std::lrint(sample));
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "SpscRingBuffer.h"
+
+// Sums several s16le inputs into one 10 ms block with per-input gain and
+// ducking, natively and once per block.
+//
+// Every input is an SpscRingBuffer filled by one producer thread; Mix() is
+// the only consumer. Gains and flags are atomics, so they can be changed at
+// any time; their changes are ramped over one block to avoid clicks.
+class AudioMixer {
+public:
+  static constexpr float kMaxGain = 4.0f;
+  // Blocks ducking stays on after the last block of a ducking input, so
+  // short gaps between e.g. TTS chunks don't pump the music back up.
+  static constexpr int kDuckHoldBlocks = 20;
+
+  struct Input {
+    explicit Input(size_t capacity) : ring(capacity) {}
+
+    SpscRingBuffer ring;
+    std::atomic<float> gain{1.0f};
+    std::atomic<bool> muted{false};
+    // While this input has audio, every input that doesn't duck is scaled
+    // by the mixer's duck gain.
+    std::atomic<bool> ducksOthers{false};
+    // Blocks this input only partly filled.
+    std::atomic<uint64_t> underruns{0};
+
+    // Gain applied at the end of the previous block; Mix() thread only.
+    float appliedGain = 1.0f;
+  };
+
+  AudioMixer(size_t inputs, size_t capacity);
+
+  size_t InputCount() const { return _inputs.size(); }
+
+  // Throws std::out_of_range for an unknown index.
+  Input &input(size_t index);
+  const Input &input(size_t index) const;
+
+  float DuckGain() const { return _duckGain.load(std::memory_order_relaxed); }
+  void SetDuckGain(float gain);
+
+  bool IsDucking() const { return _ducking.load(std::memory_order_relaxed); }
+
+  static float ClampGain(float gain);
+
+  // Sizes scratch buffers for blocks of up to |samples| interleaved samples,
+  // so Mix() never allocates. Call before mixing starts.
+  void Prepare(size_t samples);
+
+  // Mixes the next |samples| interleaved samples of every input into |out|,
+  // saturating to the s16 range. Inputs that run dry contribute silence.
+  void Mix(int16_t *out, size_t samples);
+
+  // out[i] = saturate(round(in[i])), vectorised where the target allows.
+  static void SaturateToS16(const float *in, int16_t *out, size_t samples);
+
+private:
+  std::vector<std::unique_ptr<Input>> _inputs;
+  std::atomic<float> _duckGain{0.25f};
+  std::atomic<bool> _ducking{false};
+  int _duckHold = 0;
+  float _appliedDuckGain = 1.0f;
+
+  std::vector<int16_t> _scratch;
+  std::vector<float> _sum;
+};
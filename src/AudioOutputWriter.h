@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Counters of an AudioOutputWriter, readable from Python.
+struct AudioWriterStats {
+  // Bytes accepted from the playout thread but not yet written to disk.
+  std::atomic<uint64_t> backlogBytes{0};
+  // 10 ms frames thrown away because the writer could not keep up.
+  std::atomic<uint64_t> droppedFrames{0};
+};
+
+// Sink for playout capture that does its I/O off the playout thread.
+class AudioOutputWriter {
+public:
+  virtual ~AudioOutputWriter() = default;
+
+  // Creates the output and starts the writer thread.
+  virtual bool Open() = 0;
+
+  // Queues one 48 kHz stereo s16le frame without blocking. Returns false if
+  // the frame had to be dropped.
+  virtual bool Write(const int8_t *frame, size_t length) = 0;
+};
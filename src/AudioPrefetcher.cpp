@@ -0,0 +1,117 @@
+#include "AudioPrefetcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <rtc_base/platform_thread.h>
+
+namespace {
+
+// How long the prefetch thread waits when the buffer is full or the producer
+// had nothing to give.
+const auto kRefillInterval = std::chrono::milliseconds(5);
+
+}  // namespace
+
+AudioPrefetcher::AudioPrefetcher(Fetch fetch,
+                                 AudioFormat format,
+                                 size_t lookaheadBytes,
+                                 size_t batchBytes,
+                                 AudioLookaheadStats *stats)
+    : _fetch(std::move(fetch)),
+      _frameBytes(format.channels * sizeof(int16_t)),
+      _lookaheadBytes(std::max(lookaheadBytes, format.BytesPer10Ms())),
+      _batchBytes(std::max(std::min(batchBytes, lookaheadBytes), _frameBytes)),
+      _stats(stats),
+      _ring(_lookaheadBytes),
+      _batch(_batchBytes) {}
+
+AudioPrefetcher::~AudioPrefetcher() {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  if (_thread) {
+    _thread->Stop();
+    _thread.reset();
+  }
+}
+
+void AudioPrefetcher::Start() {
+  _thread.reset(new rtc::PlatformThread(
+      ThreadFunc, this, "tgcalls_audio_prefetch", rtc::kHighPriority));
+  _thread->Start();
+}
+
+void AudioPrefetcher::ThreadFunc(void *pThis) {
+  static_cast<AudioPrefetcher *>(pThis)->Run();
+}
+
+void AudioPrefetcher::Run() {
+  while (!_stopped) {
+    size_t buffered = _ring.ReadAvailable();
+    size_t fetched = 0;
+    if (buffered + _batchBytes <= _lookaheadBytes) {
+      fetched = _fetch(_batch.data(), _batchBytes);
+      // Keep whole sample frames so the channels never get out of phase.
+      fetched -= fetched % _frameBytes;
+      _ring.Write(reinterpret_cast<const uint8_t *>(_batch.data()), fetched);
+      if (_stats) {
+        _stats->fillBytes = _ring.ReadAvailable();
+      }
+    }
+
+    if (fetched < _batchBytes) {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wakeUp.wait_for(lock, kRefillInterval, [this] { return _stopped.load(); });
+    }
+  }
+}
+
+bool AudioPrefetcher::Read(int8_t *data, size_t length) {
+  size_t buffered = _ring.ReadAvailable();
+  if (_buffering && buffered + _batchBytes > _lookaheadBytes) {
+    _buffering = false;
+  }
+
+  size_t read = 0;
+  if (!_buffering) {
+    read = _ring.Read(reinterpret_cast<uint8_t *>(data), length);
+  }
+  if (_stats) {
+    _stats->fillBytes = _ring.ReadAvailable();
+  }
+
+  if (read == length) {
+    _lastFrame.assign(data, data + length);
+    _hasLastFrame = true;
+    _hasPlayed = true;
+    return true;
+  }
+
+  if (!_buffering) {
+    // Ran dry: wait for a full buffer again before resuming playback.
+    _buffering = true;
+    if (_stats) {
+      _stats->underruns++;
+    }
+  }
+
+  if (read == 0 && _hasLastFrame && _lastFrame.size() == length) {
+    // Fade the last good frame out over one frame.
+    auto *out = reinterpret_cast<int16_t *>(data);
+    auto *in = reinterpret_cast<const int16_t *>(_lastFrame.data());
+    size_t samples = length / sizeof(int16_t);
+    for (size_t i = 0; i < samples; i++) {
+      out[i] = static_cast<int16_t>(in[i] * static_cast<int32_t>(samples - i) / static_cast<int32_t>(samples));
+    }
+    _hasLastFrame = false;
+    return false;
+  }
+
+  memset(data + read, 0, length - read);
+  _hasLastFrame = false;
+  return !_hasPlayed;
+}
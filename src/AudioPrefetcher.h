@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "SpscRingBuffer.h"
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+struct AudioLookaheadStats {
+  // Bytes waiting in the lookahead buffer.
+  std::atomic<size_t> fillBytes{0};
+  // 10 ms frames that could not be filled completely from the buffer.
+  std::atomic<uint64_t> underruns{0};
+};
+
+// Jitter buffer in front of a producer that may be late, e.g. a Python
+// callback. A background thread asks |fetch| for |batchBytes| at a time and
+// keeps up to |lookaheadBytes| buffered; the capture thread only copies 10 ms
+// frames out of a lock-free ring.
+//
+// Playback starts (and restarts after an underrun) once the buffer is full.
+// Missing audio fades out from the last frame instead of dropping to
+// silence with a click.
+class AudioPrefetcher {
+public:
+  // Copies at most |length| bytes into |data| and returns how many it wrote.
+  using Fetch = std::function<size_t(int8_t *data, size_t length)>;
+
+  AudioPrefetcher(Fetch fetch,
+                  AudioFormat format,
+                  size_t lookaheadBytes,
+                  size_t batchBytes,
+                  AudioLookaheadStats *stats);
+
+  ~AudioPrefetcher();
+
+  void Start();
+
+  // Fills |length| bytes of |data|. Called from the capture thread only.
+  // Returns false if the buffer ran dry and part of the frame is silence
+  // or fading out, not counting the buffering before playback first starts.
+  bool Read(int8_t *data, size_t length);
+
+private:
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  Fetch _fetch;
+  size_t _frameBytes;
+  size_t _lookaheadBytes;
+  size_t _batchBytes;
+  AudioLookaheadStats *_stats;
+  SpscRingBuffer _ring;
+
+  std::vector<int8_t> _batch;
+  // Last complete frame, for the fade out on underrun.
+  std::vector<int8_t> _lastFrame;
+  bool _hasLastFrame = false;
+  bool _buffering = true;
+  bool _hasPlayed = false;
+
+  std::atomic<bool> _stopped{false};
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
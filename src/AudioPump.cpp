@@ -0,0 +1,181 @@
+#include "AudioPump.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+#include <tgcalls/ThreadScheduling.h>
+
+namespace {
+
+// Upper bound for the pump pool: every thread wakes once per 10 ms, so more
+// than a handful only adds wakeups without improving throughput.
+const size_t kMaxAudioPumpThreads = 4;
+
+}  // namespace
+
+AudioPumpClient::AudioPumpClient(std::function<bool()> onTick,
+                                 AudioClockStats *stats)
+    : _onTick(std::move(onTick)), _stats(stats) {}
+
+class AudioPump::Worker {
+public:
+  explicit Worker(size_t index)
+      : _clock(&_stats),
+        _thread(new rtc::PlatformThread(
+            ThreadFunc, this,
+            "tgcalls_audio_pump_" + std::to_string(index),
+            rtc::kRealtimePriority)) {
+    _thread->Start();
+  }
+
+  size_t ClientCount() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _clients.size();
+  }
+
+  void Add(AudioPumpClient *client) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_clients.empty()) {
+      _clock.Reset();
+    }
+    _clients.push_back(client);
+    _wakeUp.notify_one();
+  }
+
+  bool Remove(AudioPumpClient *client) {
+    // Ticks are delivered with |_mutex| held, so taking it here also waits
+    // for an in-flight batch that may still reference |client|.
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto it = std::find(_clients.begin(), _clients.end(), client);
+    if (it == _clients.end()) {
+      return false;
+    }
+    _clients.erase(it);
+    return true;
+  }
+
+private:
+  static void ThreadFunc(void *pThis) {
+    static_cast<Worker *>(pThis)->Run();
+  }
+
+  void Run() {
+    tgcalls::ThreadScheduling::applyToCurrentThread(tgcalls::ThreadRole::AudioPump);
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wakeUp.wait(lock, [this] { return !_clients.empty(); });
+      }
+
+      const uint64_t lateBefore = _stats.lateTicks.load();
+      const uint64_t droppedBefore = _stats.droppedTicks.load();
+      const int ticks = _clock.WaitForNextTick();
+      const uint64_t late = _stats.lateTicks.load() - lateBefore;
+      const uint64_t dropped = _stats.droppedTicks.load() - droppedBefore;
+
+      std::unique_lock<std::mutex> lock(_mutex);
+      for (auto *client : _clients) {
+        if (client->stats()) {
+          client->stats()->lateTicks += late;
+          client->stats()->droppedTicks += dropped;
+        }
+      }
+      for (int i = 0; i < ticks; i++) {
+        for (size_t j = 0; j < _clients.size();) {
+          if (_clients[j]->Tick()) {
+            j++;
+          } else {
+            _clients.erase(_clients.begin() + j);
+          }
+        }
+      }
+    }
+  }
+
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+  std::vector<AudioPumpClient *> _clients;
+
+  AudioClockStats _stats;
+  AudioDeadlineClock _clock;
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
+
+AudioPump *AudioPump::Shared() {
+  // Intentionally leaked: pump threads run for the whole process lifetime and
+  // must outlive any device that is torn down during interpreter shutdown.
+  static AudioPump *pump = new AudioPump(std::max<size_t>(
+      1, std::min<size_t>(std::thread::hardware_concurrency(), kMaxAudioPumpThreads)));
+  return pump;
+}
+
+AudioPump::AudioPump(size_t threadCount) {
+  for (size_t i = 0; i < threadCount; i++) {
+    _workers.emplace_back(new Worker(i));
+  }
+  RTC_LOG(LS_INFO) << "Started shared audio pump with " << threadCount << " threads";
+}
+
+void AudioPump::Register(AudioPumpClient *client) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (const auto &worker : _workers) {
+    worker->Remove(client);
+  }
+
+  Worker *target = _workers.front().get();
+  size_t targetLoad = target->ClientCount();
+  for (const auto &worker : _workers) {
+    size_t load = worker->ClientCount();
+    if (load < targetLoad) {
+      target = worker.get();
+      targetLoad = load;
+    }
+  }
+  target->Add(client);
+}
+
+void AudioPump::Unregister(AudioPumpClient *client) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (const auto &worker : _workers) {
+    if (worker->Remove(client)) {
+      return;
+    }
+  }
+}
+
+AudioPumpTasks::~AudioPumpTasks() {
+  for (const auto &task : _tasks) {
+    AudioPump::Shared()->Unregister(task.client.get());
+  }
+}
+
+void AudioPumpTasks::Schedule(std::function<double()> task) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  // Those finished are dropped by the pump in the batch they finish in;
+  // unregistering waits for that batch before they are destroyed.
+  for (size_t i = 0; i < _tasks.size();) {
+    if (_tasks[i].finished->load()) {
+      AudioPump::Shared()->Unregister(_tasks[i].client.get());
+      _tasks.erase(_tasks.begin() + i);
+    } else {
+      i++;
+    }
+  }
+
+  auto finished = std::make_shared<std::atomic<bool>>(false);
+  auto client = std::make_unique<AudioPumpClient>(
+      [task = std::move(task), finished] {
+        if (task() >= 0) {
+          return true;
+        }
+        *finished = true;
+        return false;
+      },
+      _stats);
+  AudioPump::Shared()->Register(client.get());
+  _tasks.push_back({std::move(client), std::move(finished)});
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "AudioDeadlineClock.h"
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+// A unit of work driven by the shared audio clock: one playout or one
+// recording direction of a custom audio device.
+class AudioPumpClient {
+public:
+  // |onTick| processes one 10 ms frame and returns false once the client has
+  // nothing more to do (e.g. the input file ended); the pump then drops it.
+  explicit AudioPumpClient(std::function<bool()> onTick,
+                           AudioClockStats *stats = nullptr);
+
+  bool Tick() const { return _onTick(); }
+
+  AudioClockStats *stats() const { return _stats; }
+
+private:
+  std::function<bool()> _onTick;
+  AudioClockStats *_stats;
+};
+
+// Process-wide pool of audio pump threads. Instead of every FileAudioDevice /
+// RawAudioDevice owning a realtime thread per direction, registered clients
+// are ticked in a batch by one of a few shared threads, each following a
+// single AudioDeadlineClock.
+class AudioPump {
+public:
+  static AudioPump *Shared();
+
+  // Attaches |client| to the least loaded pump thread. The first tick is
+  // delivered on that thread's next deadline. Registering an already
+  // registered client moves it instead of ticking it twice.
+  void Register(AudioPumpClient *client);
+
+  // Detaches |client|. Once this returns, the client is guaranteed not to be
+  // ticked again, so it is safe to destroy. Must not be called from a tick.
+  void Unregister(AudioPumpClient *client);
+
+  size_t ThreadCount() const { return _workers.size(); }
+
+private:
+  class Worker;
+
+  explicit AudioPump(size_t threadCount);
+  ~AudioPump() = delete;
+
+  std::mutex _mutex;
+  std::vector<std::unique_ptr<Worker>> _workers;
+};
+
+// Runs the tasks of a device built on tgcalls::FakeAudioDeviceModule on the
+// shared pump, as its scheduler: each task is ticked every 10 ms, whatever
+// wait it returns, until it returns a negative one.
+class AudioPumpTasks {
+public:
+  explicit AudioPumpTasks(AudioClockStats *stats = nullptr) : _stats(stats) {}
+  // Unregisters the tasks still running.
+  ~AudioPumpTasks();
+
+  AudioPumpTasks(const AudioPumpTasks &) = delete;
+  AudioPumpTasks &operator=(const AudioPumpTasks &) = delete;
+
+  // Must not be called from a tick.
+  void Schedule(std::function<double()> task);
+
+private:
+  struct Task {
+    std::unique_ptr<AudioPumpClient> client;
+    std::shared_ptr<std::atomic<bool>> finished;
+  };
+
+  AudioClockStats *_stats;
+  std::mutex _mutex;
+  std::vector<Task> _tasks;
+};
@@ -0,0 +1,159 @@
+#include "AudioTimeStretcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+constexpr float kPi = 3.14159265f;
+
+}  // namespace
+
+float AudioTimeStretcher::CheckedSpeed(float speed) {
+  if (!(speed >= kMinSpeed && speed <= kMaxSpeed)) {
+    throw std::invalid_argument("playback speed must be between 0.5 and 2.0");
+  }
+  return speed;
+}
+
+void AudioTimeStretcher::Prepare(const AudioFormat &format) {
+  _channels = format.channels;
+  _hop = format.FramesPer10Ms();
+  _tolerance = static_cast<size_t>(format.sampleRate) * kToleranceMs / 1000;
+  _decimation = std::max<size_t>(1, static_cast<size_t>(format.sampleRate) / 8000);
+
+  // At most the tolerance behind the next segment, the segment and its
+  // tolerance ahead, and one pushed frame more.
+  size_t capacity = 2 * _tolerance + 4 * _hop;
+  _samples.resize(capacity * _channels);
+  _mono.resize(capacity);
+
+  // Raised cosine, so the two segments' gains always add up to one.
+  _fade.resize(_hop);
+  for (size_t i = 0; i < _hop; i++) {
+    _fade[i] = 0.5f - 0.5f * std::cos(kPi * (i + 0.5f) / _hop);
+  }
+  Reset();
+}
+
+void AudioTimeStretcher::Reset() {
+  _size = 0;
+  _continuation = 0;
+  _analysisPosition = 0;
+}
+
+bool AudioTimeStretcher::NeedsInput(float speed) const {
+  if (_size < _continuation + _hop) {
+    return true;
+  }
+  if (speed == 1.0f) {
+    return false;
+  }
+  auto target = static_cast<size_t>(std::lround(_analysisPosition));
+  return _size < target + _tolerance + _hop;
+}
+
+void AudioTimeStretcher::Push(const int16_t *frame) {
+  if ((_size + _hop) > _mono.size()) {
+    // Only when not prepared for this format.
+    _mono.resize(_size + _hop);
+    _samples.resize(_mono.size() * _channels);
+  }
+
+  memcpy(_samples.data() + _size * _channels, frame, _hop * _channels * sizeof(int16_t));
+  for (size_t i = 0; i < _hop; i++) {
+    float sum = 0;
+    for (size_t c = 0; c < _channels; c++) {
+      sum += frame[i * _channels + c];
+    }
+    _mono[_size + i] = sum;
+  }
+  _size += _hop;
+}
+
+void AudioTimeStretcher::Process(float speed, int16_t *out) {
+  if (speed == 1.0f) {
+    memcpy(out, _samples.data() + _continuation * _channels, _hop * _channels * sizeof(int16_t));
+    _continuation += _hop;
+    _analysisPosition = static_cast<double>(_continuation);
+    Discard();
+    return;
+  }
+
+  auto target = static_cast<size_t>(std::lround(_analysisPosition));
+  auto from = target > _tolerance ? target - _tolerance : 0;
+  auto to = std::min(target + _tolerance, _size - _hop);
+  auto segment = BestSegment(from, to);
+
+  const int16_t *previous = _samples.data() + _continuation * _channels;
+  const int16_t *next = _samples.data() + segment * _channels;
+  for (size_t i = 0; i < _hop; i++) {
+    float fade = _fade[i];
+    for (size_t c = 0; c < _channels; c++) {
+      size_t index = i * _channels + c;
+      float value = previous[index] + (next[index] - previous[index]) * fade;
+      out[index] = static_cast<int16_t>(std::lround(std::min(32767.0f, std::max(-32768.0f, value))));
+    }
+  }
+
+  _continuation = segment + _hop;
+  _analysisPosition += static_cast<double>(speed) * _hop;
+  Discard();
+}
+
+size_t AudioTimeStretcher::BestSegment(size_t from, size_t to) const {
+  const float *continuation = _mono.data() + _continuation;
+  auto score = [&](size_t start, size_t step) {
+    const float *candidate = _mono.data() + start;
+    float correlation = 0;
+    float energy = 0;
+    for (size_t i = 0; i < _hop; i += step) {
+      correlation += continuation[i] * candidate[i];
+      energy += candidate[i] * candidate[i];
+    }
+    return correlation / std::sqrt(energy + 1.0f);
+  };
+
+  // Coarsely at about 8 kHz, then around the best match at full rate.
+  size_t best = from;
+  float bestScore = score(from, _decimation);
+  for (size_t start = from + _decimation; start <= to; start += _decimation) {
+    float current = score(start, _decimation);
+    if (current > bestScore) {
+      best = start;
+      bestScore = current;
+    }
+  }
+  if (_decimation == 1) {
+    return best;
+  }
+
+  size_t coarse = best;
+  size_t refineFrom = coarse > from + _decimation ? coarse - _decimation + 1 : from;
+  size_t refineTo = std::min(coarse + _decimation - 1, to);
+  bestScore = score(coarse, 1);
+  for (size_t start = refineFrom; start <= refineTo; start++) {
+    float current = score(start, 1);
+    if (current > bestScore) {
+      best = start;
+      bestScore = current;
+    }
+  }
+  return best;
+}
+
+void AudioTimeStretcher::Discard() {
+  auto position = static_cast<size_t>(_analysisPosition);
+  auto drop = std::min(_continuation, position > _tolerance ? position - _tolerance : 0);
+  if (drop == 0) {
+    return;
+  }
+
+  memmove(_samples.data(), _samples.data() + drop * _channels, (_size - drop) * _channels * sizeof(int16_t));
+  memmove(_mono.data(), _mono.data() + drop, (_size - drop) * sizeof(float));
+  _size -= drop;
+  _continuation -= drop;
+  _analysisPosition -= static_cast<double>(drop);
+}
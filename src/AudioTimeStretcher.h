@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "AudioFormat.h"
+
+// Changes the playback speed of s16le audio without changing its pitch, with
+// WSOLA over 10 ms blocks: every output block crossfades the natural
+// continuation of the previous one into the input segment near where |speed|
+// says playback should be, picked by cross-correlation so the waveforms line
+// up.
+//
+// Input is pushed a 10 ms frame at a time, as long as NeedsInput() says so;
+// at 2x that is two frames for every frame Process() writes. The speed may
+// change between any two blocks.
+//
+// NetEq's Accelerate isn't reused: it removes a single pitch period from
+// speech when its jitter buffer grows, and can't hold a constant rate on
+// arbitrary (music) input.
+class AudioTimeStretcher {
+public:
+  static constexpr float kMinSpeed = 0.5f;
+  static constexpr float kMaxSpeed = 2.0f;
+  // How far from its nominal position a segment may be taken, which covers
+  // one pitch period down to ~80 Hz.
+  static constexpr int kToleranceMs = 6;
+
+  // Throws std::invalid_argument outside [kMinSpeed, kMaxSpeed].
+  static float CheckedSpeed(float speed);
+
+  // Sizes the buffers for |format|, so pushing and processing never
+  // allocate. Also resets.
+  void Prepare(const AudioFormat &format);
+
+  // Drops all buffered input, e.g. after a seek.
+  void Reset();
+
+  // True while input was pushed that hasn't been played yet.
+  bool HasPending() const { return _size > _continuation; }
+
+  // Whether Process() needs another input frame first.
+  bool NeedsInput(float speed) const;
+
+  // Appends one 10 ms frame of input.
+  void Push(const int16_t *frame);
+
+  // Writes one 10 ms frame of output at |speed|. At 1x, plays what's
+  // buffered unchanged, so going back to normal speed is seamless.
+  void Process(float speed, int16_t *out);
+
+private:
+  // The start of the segment best continuing the previous one, within
+  // [from, to].
+  size_t BestSegment(size_t from, size_t to) const;
+  // Lets go of input no future segment can start from.
+  void Discard();
+
+  size_t _channels = 0;
+  // Frames per block, and the search tolerance either side, in frames.
+  size_t _hop = 0;
+  size_t _tolerance = 0;
+  // Step of the coarse search, about 8 kHz worth.
+  size_t _decimation = 1;
+
+  // Buffered input: interleaved, and summed to mono for the search.
+  std::vector<int16_t> _samples;
+  std::vector<float> _mono;
+  size_t _size = 0;
+  // Where the natural continuation of the last block starts.
+  size_t _continuation = 0;
+  // Where the next block should start at the requested speed.
+  double _analysisPosition = 0;
+
+  std::vector<float> _fade;
+};
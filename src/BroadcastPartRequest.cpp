@@ -0,0 +1,68 @@
+#include "BroadcastPartRequest.h"
+
+#include <cstring>
+#include <stdexcept>
+
+BroadcastPartRequest::BroadcastPartRequest(int64_t timestampMilliseconds, int64_t durationMilliseconds, Done done)
+    : _timestampMilliseconds(timestampMilliseconds),
+      _durationMilliseconds(durationMilliseconds),
+      _done(std::move(done)) {}
+
+BroadcastPartRequest::BroadcastPartRequest(int64_t timestampMilliseconds, int64_t durationMilliseconds,
+                                           int32_t videoChannelId,
+                                           tgcalls::VideoChannelDescription::Quality videoQuality, Done done)
+    : _timestampMilliseconds(timestampMilliseconds),
+      _durationMilliseconds(durationMilliseconds),
+      _isVideo(true),
+      _videoChannelId(videoChannelId),
+      _videoQuality(videoQuality),
+      _done(std::move(done)) {}
+
+bool BroadcastPartRequest::isFinished() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return !_done;
+}
+
+void BroadcastPartRequest::allocate(size_t size) {
+  _data.resize(size);
+}
+
+void BroadcastPartRequest::complete(tgcalls::BroadcastPart::Status status, double responseTimestamp) {
+  Done done;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    done = std::move(_done);
+    _done = nullptr;
+  }
+  if (!done) {
+    return;
+  }
+  tgcalls::BroadcastPart part;
+  part.timestampMilliseconds = _timestampMilliseconds;
+  part.responseTimestamp = responseTimestamp;
+  part.status = status;
+  if (status == tgcalls::BroadcastPart::Status::Success) {
+    part.oggData = std::move(_data);
+  }
+  _data = std::vector<uint8_t>();
+  done(std::move(part));
+}
+
+void BroadcastPartRequest::complete(tgcalls::BroadcastPart::Status status, double responseTimestamp,
+                                    const py::buffer &data) {
+  py::buffer_info info = data.request();
+  if (info.ndim != 1 || info.strides[0] != info.itemsize) {
+    throw std::invalid_argument("complete requires a contiguous one-dimensional buffer");
+  }
+  auto size = static_cast<size_t>(info.size * info.itemsize);
+  _data.resize(size);
+  if (size) {
+    std::memcpy(_data.data(), info.ptr, size);
+  }
+  complete(status, responseTimestamp);
+}
+
+void BroadcastPartRequest::cancel() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _done = nullptr;
+}
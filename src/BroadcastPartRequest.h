@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+
+#include <tgcalls/group/GroupInstanceImpl.h>
+
+namespace py = pybind11;
+
+// One broadcast part asked for by a group call in broadcast mode, handed to
+// Python to fetch and completed from there, at any later time.
+//
+// The part is read into the request's own buffer: allocate() sizes it and
+// the request itself is a writable buffer, so e.g. file.readinto(request) or
+// a socket's recv_into() fill it in place, and complete() moves it into the
+// call with no copy. Buffers exported before complete() must not be used
+// after it.
+class BroadcastPartRequest : public tgcalls::BroadcastPartTask {
+public:
+    using Done = std::function<void(tgcalls::BroadcastPart &&)>;
+
+    BroadcastPartRequest(int64_t timestampMilliseconds, int64_t durationMilliseconds, Done done);
+    // A video part of the broadcast channel |videoChannelId|.
+    BroadcastPartRequest(int64_t timestampMilliseconds, int64_t durationMilliseconds, int32_t videoChannelId,
+                         tgcalls::VideoChannelDescription::Quality videoQuality, Done done);
+
+    int64_t timestampMilliseconds() const { return _timestampMilliseconds; }
+    int64_t durationMilliseconds() const { return _durationMilliseconds; }
+    bool isVideo() const { return _isVideo; }
+    int32_t videoChannelId() const { return _videoChannelId; }
+    tgcalls::VideoChannelDescription::Quality videoQuality() const { return _videoQuality; }
+
+    // True once the call no longer wants the part, or it was completed.
+    bool isFinished() const;
+
+    void allocate(size_t size);
+    std::vector<uint8_t> &data() { return _data; }
+
+    // Delivers the part; only the first call has an effect. |data|, if set,
+    // replaces the allocated buffer with one copy of it.
+    void complete(tgcalls::BroadcastPart::Status status, double responseTimestamp);
+    void complete(tgcalls::BroadcastPart::Status status, double responseTimestamp, const py::buffer &data);
+
+    // Called by the group call on its media thread.
+    void cancel() override;
+
+private:
+    const int64_t _timestampMilliseconds;
+    const int64_t _durationMilliseconds;
+    const bool _isVideo = false;
+    const int32_t _videoChannelId = 0;
+    const tgcalls::VideoChannelDescription::Quality _videoQuality = tgcalls::VideoChannelDescription::Quality::Thumbnail;
+
+    // Only touched from Python, with the GIL held.
+    std::vector<uint8_t> _data;
+
+    mutable std::mutex _mutex;
+    Done _done;
+};
@@ -0,0 +1,168 @@
+#include "CallManager.h"
+
+#include <stdexcept>
+
+namespace {
+
+void CheckSizes(size_t ids, size_t values) {
+  if (ids != values) {
+    throw std::invalid_argument("expected one value per id");
+  }
+}
+
+}  // namespace
+
+void CallManager::add(int64_t id, py::object instance) {
+  auto native = instance.cast<NativeInstance *>();
+  Entry replaced{std::move(instance), native};
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::swap(_instances[id], replaced);
+}
+
+void CallManager::remove(int64_t id) {
+  // Dropped outside |_mutex|: the last reference tears the call down, which
+  // releases the GIL and may wait for threads that want it.
+  Entry removed;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto it = _instances.find(id);
+    if (it == _instances.end()) {
+      return;
+    }
+    removed = std::move(it->second);
+    _instances.erase(it);
+  }
+}
+
+size_t CallManager::size() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _instances.size();
+}
+
+std::vector<int64_t> CallManager::ids() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::vector<int64_t> result;
+  result.reserve(_instances.size());
+  for (const auto &it : _instances) {
+    result.push_back(it.first);
+  }
+  return result;
+}
+
+tgcalls::GroupInstanceCustomImpl *CallManager::groupCall(int64_t id) const {
+  const auto it = _instances.find(id);
+  if (it == _instances.end() || !it->second.instance->isGroupCallNativeCreated()) {
+    return nullptr;
+  }
+  return it->second.instance->instanceHolder->groupNativeInstance.get();
+}
+
+void CallManager::setIsMuted(std::vector<int64_t> const &ids, std::vector<bool> const &isMuted) {
+  CheckSizes(ids.size(), isMuted.size());
+  std::vector<tgcalls::GroupInstanceCustomImpl *> calls;
+  std::vector<bool> values;
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (size_t i = 0; i < ids.size(); i++) {
+    if (const auto call = groupCall(ids[i])) {
+      calls.push_back(call);
+      values.push_back(isMuted[i]);
+    }
+  }
+
+  lock.unlock();
+  py::gil_scoped_release release;
+  tgcalls::GroupInstanceCustomImpl::setIsMuted(calls, values);
+}
+
+void CallManager::setVolume(std::vector<int64_t> const &ids, std::vector<uint32_t> const &ssrcs,
+                            std::vector<double> const &volumes) {
+  CheckSizes(ids.size(), ssrcs.size());
+  CheckSizes(ids.size(), volumes.size());
+  std::vector<std::pair<tgcalls::GroupInstanceCustomImpl *, size_t>> calls;
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (size_t i = 0; i < ids.size(); i++) {
+    if (const auto call = groupCall(ids[i])) {
+      calls.emplace_back(call, i);
+    }
+  }
+
+  // Volumes of a call are applied together already, whatever their number.
+  lock.unlock();
+  py::gil_scoped_release release;
+  for (const auto &it : calls) {
+    it.first->setVolume(ssrcs[it.second], volumes[it.second]);
+  }
+}
+
+void CallManager::startAudioDeviceModules(std::vector<int64_t> const &ids) {
+  std::vector<tgcalls::GroupInstanceCustomImpl *> calls;
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (const auto id : ids) {
+    if (const auto call = groupCall(id)) {
+      calls.push_back(call);
+    }
+  }
+
+  lock.unlock();
+  py::gil_scoped_release release;
+  tgcalls::GroupInstanceCustomImpl::performWithAudioDeviceModule(
+      calls, [](const rtc::scoped_refptr<tgcalls::WrappedAudioDeviceModule> &audioDeviceModule) {
+        if (!audioDeviceModule) {
+          return;
+        }
+        if (!audioDeviceModule->Recording()) {
+          audioDeviceModule->StartRecording();
+        }
+        if (!audioDeviceModule->Playing()) {
+          audioDeviceModule->StartPlayout();
+        }
+      });
+}
+
+void CallManager::stopAudioDeviceModules(std::vector<int64_t> const &ids) {
+  std::vector<tgcalls::GroupInstanceCustomImpl *> calls;
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (const auto id : ids) {
+    if (const auto call = groupCall(id)) {
+      calls.push_back(call);
+    }
+  }
+
+  lock.unlock();
+  py::gil_scoped_release release;
+  tgcalls::GroupInstanceCustomImpl::performWithAudioDeviceModule(
+      calls, [](const rtc::scoped_refptr<tgcalls::WrappedAudioDeviceModule> &audioDeviceModule) {
+        if (!audioDeviceModule) {
+          return;
+        }
+        audioDeviceModule->StopRecording();
+        audioDeviceModule->StopPlayout();
+      });
+}
+
+std::map<int64_t, tgcalls::GroupInstanceCustomImpl::MediaStats> CallManager::collectStats(
+    std::vector<int64_t> const &ids) {
+  std::vector<int64_t> found;
+  std::vector<tgcalls::GroupInstanceCustomImpl const *> calls;
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (const auto id : ids) {
+    if (const auto call = groupCall(id)) {
+      found.push_back(id);
+      calls.push_back(call);
+    }
+  }
+
+  lock.unlock();
+
+  std::vector<tgcalls::GroupInstanceCustomImpl::MediaStats> stats;
+  {
+    py::gil_scoped_release release;
+    stats = tgcalls::GroupInstanceCustomImpl::getMediaStats(calls);
+  }
+
+  std::map<int64_t, tgcalls::GroupInstanceCustomImpl::MediaStats> result;
+  for (size_t i = 0; i < found.size(); i++) {
+    result.emplace(found[i], std::move(stats[i]));
+  }
+  return result;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+
+#include "NativeInstance.h"
+
+namespace py = pybind11;
+
+// Controls many NativeInstances with one Python call per action instead of
+// one per instance: each batch goes to the running group calls among |ids|
+// with one task per set of tgcalls threads they use, and the GIL is released
+// meanwhile. Instances are kept alive while added; ids without one, or
+// without a running group call, are skipped. Safe to share between Python
+// threads without the GIL, as on a free-threaded build.
+class CallManager {
+public:
+  CallManager() = default;
+  // Drops the instances; call with the GIL held.
+  ~CallManager() = default;
+
+  void add(int64_t id, py::object instance);
+  void remove(int64_t id);
+  std::vector<int64_t> ids() const;
+  size_t size() const;
+
+  // |isMuted| has an entry per id.
+  void setIsMuted(std::vector<int64_t> const &ids, std::vector<bool> const &isMuted);
+  // Sets the volume of |ssrcs[i]| in the call of |ids[i]|.
+  void setVolume(std::vector<int64_t> const &ids, std::vector<uint32_t> const &ssrcs,
+                 std::vector<double> const &volumes);
+  void startAudioDeviceModules(std::vector<int64_t> const &ids);
+  void stopAudioDeviceModules(std::vector<int64_t> const &ids);
+
+  // Stats of the running group calls among |ids|, keyed by id.
+  std::map<int64_t, tgcalls::GroupInstanceCustomImpl::MediaStats> collectStats(std::vector<int64_t> const &ids);
+
+private:
+  struct Entry {
+    py::object object;
+    NativeInstance *instance = nullptr;
+  };
+
+  // Called with |_mutex| held; the group calls stay valid until their
+  // instances are stopped or removed, as they did under the GIL.
+  tgcalls::GroupInstanceCustomImpl *groupCall(int64_t id) const;
+
+  mutable std::mutex _mutex;
+  std::map<int64_t, Entry> _instances;
+};
@@ -0,0 +1,92 @@
+#include "CallbackDispatcher.h"
+
+#include <optional>
+
+#include <pybind11/pybind11.h>
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+#include <tgcalls/TraceRecorder.h>
+
+namespace py = pybind11;
+
+CallbackDispatcher::CallbackDispatcher()
+    : _thread(new rtc::PlatformThread(
+          ThreadFunc, this, "tgcalls_callback_dispatcher",
+          rtc::kNormalPriority)) {
+  _thread->Start();
+}
+
+CallbackDispatcher::~CallbackDispatcher() {
+  Stop();
+}
+
+void CallbackDispatcher::Post(std::function<void()> callback) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (_stopped) {
+    return;
+  }
+  if (_eventQueue) {
+    _eventQueue->Post([isAlive = _isAlive, callback = std::move(callback)] {
+      if (isAlive->load()) {
+        callback();
+      }
+    });
+    return;
+  }
+  _queue.push_back(std::move(callback));
+  _wakeUp.notify_one();
+}
+
+void CallbackDispatcher::SetEventQueue(std::shared_ptr<EventQueue> queue) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _eventQueue = std::move(queue);
+}
+
+void CallbackDispatcher::Stop() {
+  std::vector<std::function<void()>> dropped;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_stopped) {
+      return;
+    }
+    _stopped = true;
+    _isAlive->store(false);
+    dropped.swap(_queue);
+    _wakeUp.notify_one();
+  }
+  _thread->Stop();
+}
+
+void CallbackDispatcher::ThreadFunc(void *pThis) {
+  static_cast<CallbackDispatcher *>(pThis)->Run();
+}
+
+void CallbackDispatcher::Run() {
+  std::vector<std::function<void()>> batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wakeUp.wait(lock, [this] { return _stopped || !_queue.empty(); });
+      if (_stopped) {
+        return;
+      }
+      batch.swap(_queue);
+    }
+
+    std::optional<py::gil_scoped_acquire> acquire;
+    {
+      tgcalls::TraceScope trace("python", "acquireGil");
+      acquire.emplace();
+    }
+    for (auto &callback : batch) {
+      tgcalls::TraceScope trace("python", "callback");
+      try {
+        callback();
+      } catch (py::error_already_set &e) {
+        RTC_LOG(LS_ERROR) << "Python callback raised: " << e.what();
+      }
+    }
+    // Callbacks may own Python objects, so release them with the GIL held.
+    batch.clear();
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "EventQueue.h"
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+// Delivers Python callbacks from a single dedicated thread.
+//
+// webrtc threads only enqueue work here; the dispatcher thread drains the
+// queue in batches and takes the GIL once per batch instead of once per
+// callback, from whatever thread the event happened to arrive on. With an
+// EventQueue set, callbacks go to the asyncio loop watching it instead.
+class CallbackDispatcher {
+public:
+  CallbackDispatcher();
+  ~CallbackDispatcher();
+
+  // Queues |callback| for delivery. Silently dropped after Stop().
+  void Post(std::function<void()> callback);
+
+  // Callbacks posted afterwards go to |queue|, or back to the dispatcher
+  // thread if it is null.
+  void SetEventQueue(std::shared_ptr<EventQueue> queue);
+
+  // Stops the thread and drops everything still queued. Must be called
+  // without the GIL held, since an in-flight batch may be waiting for it.
+  void Stop();
+
+private:
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+  std::vector<std::function<void()>> _queue;
+  bool _stopped = false;
+  std::shared_ptr<EventQueue> _eventQueue;
+  // Cleared by Stop(), so what is still in |_eventQueue| isn't called.
+  std::shared_ptr<std::atomic<bool>> _isAlive = std::make_shared<std::atomic<bool>>(true);
+
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
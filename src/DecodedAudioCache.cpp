@@ -0,0 +1,151 @@
+#include "DecodedAudioCache.h"
+
+#include <sys/stat.h>
+
+#include <rtc_base/logging.h>
+#include <rtc_base/system/file_wrapper.h>
+
+#include "AudioFileDecoder.h"
+#include "DecodedAudioDiskCache.h"
+
+DecodedAudioCache *DecodedAudioCache::Shared() {
+  // Intentionally leaked, like the audio pump: devices may still hold
+  // entries while the interpreter shuts down.
+  static DecodedAudioCache *cache = new DecodedAudioCache();
+  return cache;
+}
+
+std::shared_ptr<const DecodedAudioCache::Pcm> DecodedAudioCache::Get(
+    const std::string &filename, const std::string &key, bool isCompressed,
+    AudioFormat format) {
+  std::string entryKey = key;
+  if (entryKey.empty()) {
+    struct stat info{};
+    if (stat(filename.c_str(), &info) != 0) {
+      RTC_LOG(LS_ERROR) << "Failed to open audio input file: " << filename;
+      return nullptr;
+    }
+    entryKey = filename + ":" + std::to_string(static_cast<int64_t>(info.st_mtime));
+  }
+  // Decoded entries depend on the output format, raw ones are used as is.
+  entryKey += isCompressed
+      ? ":decoded:" + std::to_string(format.sampleRate) + ":" + std::to_string(format.channels)
+      : ":raw";
+
+  std::promise<std::shared_ptr<const Pcm>> promise;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto it = _entries.find(entryKey);
+    if (it != _entries.end()) {
+      _hits++;
+      _lru.splice(_lru.begin(), _lru, it->second.lruPosition);
+      auto pcm = it->second.pcm;
+      lock.unlock();
+      return pcm.get();
+    }
+
+    _misses++;
+    _lru.push_front(entryKey);
+    Entry &entry = _entries[entryKey];
+    entry.pcm = promise.get_future().share();
+    entry.lruPosition = _lru.begin();
+  }
+
+  auto pcm = Load(filename, isCompressed, format);
+
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto it = _entries.find(entryKey);
+    if (it != _entries.end() && !it->second.ready) {
+      if (pcm) {
+        it->second.ready = true;
+        it->second.bytes = pcm->size();
+        _bytes += pcm->size();
+        EvictLocked();
+      } else {
+        // Do not cache failures; the next caller retries.
+        _lru.erase(it->second.lruPosition);
+        _entries.erase(it);
+      }
+    }
+  }
+
+  promise.set_value(pcm);
+  return pcm;
+}
+
+std::shared_ptr<const DecodedAudioCache::Pcm> DecodedAudioCache::Load(
+    const std::string &filename, bool isCompressed, AudioFormat format) {
+  std::vector<int8_t> samples;
+  if (isCompressed) {
+    auto diskCache = DecodedAudioDiskCache::Shared();
+    std::string entryName;
+    if (diskCache->IsEnabled()) {
+      entryName = DecodedAudioDiskCache::EntryName(filename, format);
+      if (auto mapping = diskCache->Find(entryName)) {
+        return std::make_shared<Pcm>(std::move(mapping));
+      }
+    }
+    if (!AudioFileDecoder::DecodeFile(filename, format, &samples)) {
+      return nullptr;
+    }
+    diskCache->Store(entryName, samples);
+    return std::make_shared<Pcm>(std::move(samples));
+  }
+
+  auto file = webrtc::FileWrapper::OpenReadOnly(filename);
+  long size = file.is_open() ? file.FileSize() : -1;
+  if (size <= 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open audio input file: " << filename;
+    return nullptr;
+  }
+  samples.resize(static_cast<size_t>(size));
+  samples.resize(file.Read(samples.data(), samples.size()));
+  return std::make_shared<Pcm>(std::move(samples));
+}
+
+void DecodedAudioCache::SetByteBudget(size_t byteBudget) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _byteBudget = byteBudget;
+  EvictLocked();
+}
+
+DecodedAudioCache::Stats DecodedAudioCache::GetStats() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  Stats stats;
+  stats.hits = _hits;
+  stats.misses = _misses;
+  stats.evictions = _evictions;
+  stats.entries = _entries.size();
+  stats.bytes = _bytes;
+  stats.byteBudget = _byteBudget;
+  return stats;
+}
+
+void DecodedAudioCache::Clear() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (auto it = _entries.begin(); it != _entries.end();) {
+    if (it->second.ready) {
+      _bytes -= it->second.bytes;
+      _lru.erase(it->second.lruPosition);
+      it = _entries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void DecodedAudioCache::EvictLocked() {
+  auto position = _lru.end();
+  while (_bytes > _byteBudget && position != _lru.begin()) {
+    --position;
+    auto it = _entries.find(*position);
+    if (!it->second.ready) {
+      continue;
+    }
+    _bytes -= it->second.bytes;
+    _evictions++;
+    _entries.erase(it);
+    position = _lru.erase(position);
+  }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "MappedAudioFile.h"
+
+// Process-wide cache of fully decoded s16le input audio.
+//
+// Calls playing the same asset share one decoded copy. Entries are reference
+// counted: evicting one only drops the cache's reference, devices still
+// playing it keep their copy alive. Cached bytes are bounded by an LRU budget.
+//
+// Once DecodedAudioDiskCache has a directory, decoded entries also go to
+// disk, and a later miss maps them from there instead of decoding again.
+class DecodedAudioCache {
+public:
+  // Decoded PCM, either in memory or mapped from the disk cache.
+  class Pcm {
+  public:
+    explicit Pcm(std::vector<int8_t> samples)
+        : _samples(std::move(samples)), _data(_samples.data()), _size(_samples.size()) {}
+    explicit Pcm(std::shared_ptr<MappedAudioFile> mapping)
+        : _mapping(std::move(mapping)), _data(_mapping->data()), _size(_mapping->size()) {}
+
+    const int8_t *data() const { return _data; }
+    size_t size() const { return _size; }
+
+  private:
+    std::vector<int8_t> _samples;
+    std::shared_ptr<MappedAudioFile> _mapping;
+    const int8_t *_data = nullptr;
+    size_t _size = 0;
+  };
+
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t byteBudget = 0;
+  };
+
+  static constexpr size_t kDefaultByteBudget = 256 * 1024 * 1024;
+
+  static DecodedAudioCache *Shared();
+
+  // Returns the decoded audio of |filename|, decoding it on the calling
+  // thread on a miss. Concurrent misses for the same entry decode once.
+  // Entries are keyed by |key| if given, otherwise by path and mtime.
+  // Returns nullptr if the file cannot be read or decoded.
+  std::shared_ptr<const Pcm> Get(const std::string &filename,
+                                 const std::string &key,
+                                 bool isCompressed,
+                                 AudioFormat format = AudioFormat());
+
+  void SetByteBudget(size_t byteBudget);
+
+  Stats GetStats();
+
+  void Clear();
+
+private:
+  struct Entry {
+    std::shared_future<std::shared_ptr<const Pcm>> pcm;
+    size_t bytes = 0;
+    bool ready = false;
+    std::list<std::string>::iterator lruPosition;
+  };
+
+  DecodedAudioCache() = default;
+
+  static std::shared_ptr<const Pcm> Load(const std::string &filename, bool isCompressed,
+                                         AudioFormat format);
+
+  // Drops least recently used ready entries until the budget is met.
+  void EvictLocked();
+
+  std::mutex _mutex;
+  std::map<std::string, Entry> _entries;
+  // Most recently used at the front.
+  std::list<std::string> _lru;
+  size_t _bytes = 0;
+  size_t _byteBudget = kDefaultByteBudget;
+  uint64_t _hits = 0;
+  uint64_t _misses = 0;
+  uint64_t _evictions = 0;
+};
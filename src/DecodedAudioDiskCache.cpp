@@ -0,0 +1,254 @@
+#include "DecodedAudioDiskCache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <ctime>
+
+#if defined(WEBRTC_POSIX)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <rtc_base/logging.h>
+#include <rtc_base/system/file_wrapper.h>
+
+namespace {
+
+// Bumped whenever the decoded output of the same file may change.
+constexpr char kEntryVersion[] = "v1";
+constexpr char kEntrySuffix[] = ".pcm";
+constexpr char kTemporaryPrefix[] = ".tmp-";
+// Temporary files older than this belong to writers that died.
+constexpr int64_t kStaleTemporarySeconds = 3600;
+
+constexpr size_t kHashChunkBytes = 1024 * 1024;
+
+bool EndsWith(const std::string &value, const std::string &suffix) {
+  return value.size() >= suffix.size() &&
+         value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}  // namespace
+
+DecodedAudioDiskCache *DecodedAudioDiskCache::Shared() {
+  // Intentionally leaked, like DecodedAudioCache.
+  static DecodedAudioDiskCache *cache = new DecodedAudioDiskCache();
+  return cache;
+}
+
+bool DecodedAudioDiskCache::IsEnabled() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return !_directory.empty();
+}
+
+std::string DecodedAudioDiskCache::EntryName(const std::string &filename, AudioFormat format) {
+  auto file = webrtc::FileWrapper::OpenReadOnly(filename);
+  if (!file.is_open()) {
+    return std::string();
+  }
+
+  // 64-bit FNV-1a; the length and format in the name make a collision of
+  // two assets that are actually in use together practically impossible.
+  uint64_t hash = 14695981039346656037ULL;
+  uint64_t length = 0;
+  std::vector<uint8_t> chunk(kHashChunkBytes);
+  while (true) {
+    size_t read = file.Read(chunk.data(), chunk.size());
+    for (size_t i = 0; i < read; i++) {
+      hash = (hash ^ chunk[i]) * 1099511628211ULL;
+    }
+    length += read;
+    if (read < chunk.size()) {
+      break;
+    }
+  }
+  if (length == 0) {
+    return std::string();
+  }
+
+  char name[96];
+  snprintf(name, sizeof(name), "%s-%016" PRIx64 "-%" PRIu64 "-%d-%zu%s",
+           kEntryVersion, hash, length, format.sampleRate, format.channels, kEntrySuffix);
+  return name;
+}
+
+#if defined(WEBRTC_POSIX)
+
+void DecodedAudioDiskCache::SetDirectory(const std::string &directory, size_t byteBudget) {
+  if (!directory.empty() && mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+    RTC_LOG(LS_ERROR) << "Failed to create the decoded audio disk cache directory: " << directory;
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _directory = directory;
+    _byteBudget = byteBudget;
+    _bytes = 0;
+  }
+  if (!directory.empty()) {
+    std::unique_lock<std::mutex> lock(_scanMutex);
+    EvictLocked(directory, byteBudget);
+  }
+}
+
+std::shared_ptr<MappedAudioFile> DecodedAudioDiskCache::Find(const std::string &name) {
+  std::string directory;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    directory = _directory;
+  }
+  if (directory.empty() || name.empty()) {
+    return nullptr;
+  }
+
+  const auto path = directory + "/" + name;
+  struct stat info{};
+  std::shared_ptr<MappedAudioFile> mapping;
+  if (stat(path.c_str(), &info) == 0 && info.st_size > 0) {
+    mapping = MappedAudioFile::Open(path);
+  }
+  if (mapping) {
+    // Only the access time, so the shared mapping of the path stays valid.
+    struct timespec times[2] = {{0, UTIME_NOW}, {0, UTIME_OMIT}};
+    utimensat(AT_FDCWD, path.c_str(), times, 0);
+  }
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (mapping) {
+    _hits++;
+  } else {
+    _misses++;
+  }
+  return mapping;
+}
+
+void DecodedAudioDiskCache::Store(const std::string &name, const std::vector<int8_t> &pcm) {
+  std::string directory;
+  size_t byteBudget = 0;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    directory = _directory;
+    byteBudget = _byteBudget;
+  }
+  if (directory.empty() || name.empty() || pcm.empty() || pcm.size() > byteBudget) {
+    return;
+  }
+
+  static std::atomic<uint64_t> temporaryCounter{0};
+  const auto temporaryPath = directory + "/" + kTemporaryPrefix + std::to_string(getpid()) + "-" +
+                             std::to_string(temporaryCounter++);
+  const auto path = directory + "/" + name;
+
+  auto file = webrtc::FileWrapper::OpenWriteOnly(temporaryPath);
+  bool written = file.is_open() && file.Write(pcm.data(), pcm.size());
+  written = file.Close() && written;
+  if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+    RTC_LOG(LS_WARNING) << "Failed to write decoded audio disk cache entry: " << path;
+    unlink(temporaryPath.c_str());
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stores++;
+  }
+  std::unique_lock<std::mutex> lock(_scanMutex);
+  EvictLocked(directory, byteBudget);
+}
+
+void DecodedAudioDiskCache::EvictLocked(const std::string &directory, size_t byteBudget) {
+  struct Entry {
+    std::string path;
+    size_t bytes = 0;
+    int64_t accessTime = 0;
+  };
+
+  DIR *handle = opendir(directory.c_str());
+  if (!handle) {
+    return;
+  }
+  std::vector<Entry> entries;
+  size_t bytes = 0;
+  const int64_t now = static_cast<int64_t>(time(nullptr));
+  while (const auto item = readdir(handle)) {
+    const std::string name = item->d_name;
+    const bool isTemporary = name.compare(0, sizeof(kTemporaryPrefix) - 1, kTemporaryPrefix) == 0;
+    if (!isTemporary && !EndsWith(name, kEntrySuffix)) {
+      continue;
+    }
+    Entry entry;
+    entry.path = directory + "/" + name;
+    struct stat info{};
+    if (stat(entry.path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+      continue;
+    }
+    if (isTemporary) {
+      if (now - static_cast<int64_t>(info.st_mtime) > kStaleTemporarySeconds) {
+        unlink(entry.path.c_str());
+      }
+      continue;
+    }
+    entry.bytes = static_cast<size_t>(info.st_size);
+    entry.accessTime = static_cast<int64_t>(info.st_atime);
+    bytes += entry.bytes;
+    entries.push_back(std::move(entry));
+  }
+  closedir(handle);
+
+  // Oldest first.
+  std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+    return a.accessTime < b.accessTime;
+  });
+  uint64_t evictions = 0;
+  for (const auto &entry : entries) {
+    if (bytes <= byteBudget) {
+      break;
+    }
+    // Calls still playing the entry keep their mapping.
+    if (unlink(entry.path.c_str()) == 0) {
+      bytes -= entry.bytes;
+      evictions++;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _evictions += evictions;
+  if (_directory == directory) {
+    _bytes = bytes;
+  }
+}
+
+#else
+
+void DecodedAudioDiskCache::SetDirectory(const std::string &directory, size_t byteBudget) {
+  if (!directory.empty()) {
+    RTC_LOG(LS_WARNING) << "The decoded audio disk cache is not supported on this platform";
+  }
+}
+
+std::shared_ptr<MappedAudioFile> DecodedAudioDiskCache::Find(const std::string &name) {
+  return nullptr;
+}
+
+void DecodedAudioDiskCache::Store(const std::string &name, const std::vector<int8_t> &pcm) {}
+
+void DecodedAudioDiskCache::EvictLocked(const std::string &directory, size_t byteBudget) {}
+
+#endif
+
+DecodedAudioDiskCache::Stats DecodedAudioDiskCache::GetStats() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  Stats stats;
+  stats.hits = _hits;
+  stats.misses = _misses;
+  stats.stores = _stores;
+  stats.evictions = _evictions;
+  stats.bytes = _bytes;
+  stats.byteBudget = _byteBudget;
+  return stats;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "MappedAudioFile.h"
+
+// On-disk cache of decoded input audio that survives process restarts.
+//
+// Entries are plain s16le files named by a hash of the source file's
+// contents and the output format, so a restarted worker, or any process
+// sharing the directory, maps audio decoded before instead of decoding it
+// again. Entries are written to a temporary file and renamed into place, so
+// readers never see a partial one. Every use touches an entry's access time;
+// once the directory holds more than its byte budget, the least recently used
+// entries are deleted. Disabled until a directory is set.
+class DecodedAudioDiskCache {
+public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t stores = 0;
+    uint64_t evictions = 0;
+    size_t bytes = 0;
+    size_t byteBudget = 0;
+  };
+
+  static constexpr size_t kDefaultByteBudget = 2048ULL * 1024 * 1024;
+
+  static DecodedAudioDiskCache *Shared();
+
+  // Creates |directory| if needed and evicts down to |byteBudget|. An empty
+  // |directory| disables the cache.
+  void SetDirectory(const std::string &directory, size_t byteBudget = kDefaultByteBudget);
+
+  bool IsEnabled();
+
+  // Names the entry of |filename| decoded to |format|, reading the whole
+  // file to hash it. Empty if the file cannot be read.
+  static std::string EntryName(const std::string &filename, AudioFormat format);
+
+  // Maps the entry |name|, or returns nullptr if there is none.
+  std::shared_ptr<MappedAudioFile> Find(const std::string &name);
+
+  // Writes |pcm| as the entry |name|, then evicts down to the budget.
+  void Store(const std::string &name, const std::vector<int8_t> &pcm);
+
+  Stats GetStats();
+
+private:
+  DecodedAudioDiskCache() = default;
+
+  // Deletes least recently used entries, and temporary files left behind by
+  // crashed writers, until the budget is met. Called with |_scanMutex| held.
+  void EvictLocked(const std::string &directory, size_t byteBudget);
+
+  std::mutex _mutex;
+  std::string _directory;
+  size_t _byteBudget = kDefaultByteBudget;
+  uint64_t _hits = 0;
+  uint64_t _misses = 0;
+  uint64_t _stores = 0;
+  uint64_t _evictions = 0;
+  size_t _bytes = 0;
+
+  // Serializes directory scans, which run without |_mutex|.
+  std::mutex _scanMutex;
+};
@@ -0,0 +1,125 @@
+#include "EventQueue.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+#include <pybind11/pybind11.h>
+#include <rtc_base/logging.h>
+#include <tgcalls/TraceRecorder.h>
+
+namespace py = pybind11;
+
+EventQueue::EventQueue() {
+#if defined(__linux__)
+  _readFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  _writeFd = _readFd;
+#else
+  int fds[2];
+  if (pipe(fds) == 0) {
+    for (int fd : fds) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    _readFd = fds[0];
+    _writeFd = fds[1];
+  }
+#endif
+  if (_readFd < 0) {
+    throw std::runtime_error("failed to create the event queue descriptor");
+  }
+}
+
+EventQueue::~EventQueue() {
+  Close();
+  if (_writeFd != _readFd) {
+    close(_writeFd);
+  }
+  close(_readFd);
+}
+
+void EventQueue::Post(std::function<void()> callback) {
+  if (_closed.load(std::memory_order_acquire)) {
+    return;
+  }
+  auto node = new Node{std::move(callback)};
+  node->next = _head.load(std::memory_order_relaxed);
+  while (!_head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+  // Whoever finds the list empty wakes the loop; the others join the batch.
+  if (!node->next) {
+    Signal();
+  }
+}
+
+size_t EventQueue::Dispatch() {
+  // Cleared before the list is taken, so a callback posted meanwhile either
+  // is in this batch or signals again.
+  ClearSignal();
+  auto node = TakeAll();
+  size_t count = 0;
+  while (node) {
+    try {
+      tgcalls::TraceScope trace("python", "callback");
+      node->callback();
+    } catch (py::error_already_set &e) {
+      RTC_LOG(LS_ERROR) << "Python callback raised: " << e.what();
+    }
+    auto next = node->next;
+    // Callbacks may own Python objects, so they go with the GIL held.
+    delete node;
+    node = next;
+    count++;
+  }
+  return count;
+}
+
+void EventQueue::Close() {
+  _closed.store(true, std::memory_order_release);
+  Free(TakeAll());
+}
+
+EventQueue::Node *EventQueue::TakeAll() {
+  // Pushed newest first.
+  Node *node = _head.exchange(nullptr, std::memory_order_acquire);
+  Node *reversed = nullptr;
+  while (node) {
+    auto next = node->next;
+    node->next = reversed;
+    reversed = node;
+    node = next;
+  }
+  return reversed;
+}
+
+void EventQueue::Signal() {
+  const uint64_t one = 1;
+  // EAGAIN means it is readable already.
+  while (write(_writeFd, &one, _writeFd == _readFd ? sizeof(one) : 1) < 0 && errno == EINTR) {
+  }
+}
+
+void EventQueue::ClearSignal() {
+  uint64_t value;
+  while (true) {
+    const auto result = read(_readFd, &value, sizeof(value));
+    if (result > 0 || (result < 0 && errno == EINTR)) {
+      continue;
+    }
+    break;
+  }
+}
+
+void EventQueue::Free(Node *node) {
+  while (node) {
+    auto next = node->next;
+    delete node;
+    node = next;
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Hands callbacks from native threads to the thread of an asyncio loop.
+//
+// Native threads push callbacks onto a lock-free list; the one that finds
+// it empty makes fileno() readable, so a batch costs one syscall however
+// many callbacks it holds. The loop watches fileno() with add_reader() and
+// runs Dispatch(), which calls the whole batch in order with the GIL it
+// already holds:
+//
+//   loop.add_reader(queue.fileno(), queue.dispatch)
+//
+// An eventfd on Linux, a pipe elsewhere.
+class EventQueue {
+public:
+  EventQueue();
+  // Drops what is still queued; call with the GIL held.
+  ~EventQueue();
+
+  // Any thread. Silently dropped after Close().
+  void Post(std::function<void()> callback);
+
+  // Loop thread, with the GIL held. Runs every queued callback and returns
+  // how many there were.
+  size_t Dispatch();
+
+  int fileno() const { return _readFd; }
+
+  // Stops queueing and drops what is queued; fileno() stays valid until
+  // the queue is destroyed, so remove the reader first.
+  void Close();
+
+private:
+  struct Node {
+    std::function<void()> callback;
+    Node *next = nullptr;
+  };
+
+  // Takes the list, oldest first.
+  Node *TakeAll();
+  void Signal();
+  void ClearSignal();
+  static void Free(Node *node);
+
+  std::atomic<Node *> _head{nullptr};
+  std::atomic<bool> _closed{false};
+  int _readFd = -1;
+  int _writeFd = -1;
+};
@@ -1,6 +1,24 @@
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "AsyncAudioFileWriter.h"
+#include "AudioDeadlineClock.h"
+#include "AudioFormat.h"
+#include "AudioGlitchDetector.h"
+#include "AudioIdleSignal.h"
+#include "AudioLoudnessNormalizer.h"
+#include "AudioTimeStretcher.h"
+#include "OggOpusFileWriter.h"
+#include "CallbackDispatcher.h"
+#include "FileInput.h"
+#include "FileInputQueue.h"
+#include "MappedAudioFile.h"
+#include "NetworkAudioOutputWriter.h"
 
 
 class FileAudioDeviceDescriptor {
@@ -8,9 +26,133 @@ public:
     std::function<std::string()> _getInputFilename = nullptr;
     std::function<std::string()> _getOutputFilename = nullptr;
 
+    // Format of the 10 ms frames the device exchanges; 48 kHz stereo unless
+    // set otherwise before the call starts.
+    AudioFormat _recordingFormat;
+    AudioFormat _playoutFormat;
+
     std::function<bool()> _isEndlessPlayout = nullptr;
+    // When true, the input file is demuxed and decoded with FFmpeg (opus,
+    // mp3, aac, flac, ...) instead of being read as raw s16le in |_recordingFormat|.
+    std::function<bool()> _isCompressedInput = nullptr;
+    // When true, the raw input file is memory mapped and read in place;
+    // pages are requested |_mappedInputPrefetchBytes| ahead of playback.
+    std::function<bool()> _isMappedInput = nullptr;
+    size_t _mappedInputPrefetchBytes = MappedAudioFile::kDefaultPrefetchBytes;
+    // When true, the whole input is decoded once into the process-wide
+    // DecodedAudioCache and shared with every call playing the same asset, or
+    // mapped from the DecodedAudioDiskCache when it was decoded before.
+    // |_inputCacheKey| overrides the default path + mtime key.
+    std::function<bool()> _isCachedInput = nullptr;
+    std::string _inputCacheKey;
+    // When true, the input filename is the URL of a live stream (HTTP, HLS,
+    // RTMP, Icecast, ...), pulled, decoded and reconnected in the
+    // background; see NetworkAudioInput.
+    std::function<bool()> _isNetworkInput = nullptr;
+    NetworkAudioInput::Options _networkInputOptions;
+    std::shared_ptr<NetworkAudioInput::Stats> _networkInputStats = std::make_shared<NetworkAudioInput::Stats>();
+
+    // When true, playout capture is written by a background I/O thread
+    // instead of synchronously from the playout thread; |_isDirectIoOutput|
+    // additionally bypasses the page cache on Linux.
+    std::function<bool()> _isAsyncOutput = nullptr;
+    bool _isDirectIoOutput = false;
+
+    // When true, playout capture is encoded to Opus in an Ogg container on a
+    // background thread instead of being written as raw PCM.
+    std::function<bool()> _isOpusOutput = nullptr;
+    int _outputOpusBitrate = OggOpusFileWriter::kDefaultBitrate;
+    int _outputOggPageIntervalMs = OggOpusFileWriter::kDefaultPageIntervalMs;
+    // When true, the output filename is a URL (RTMP, Icecast, HLS, ...) the
+    // playout mix is encoded and streamed to from a background thread; see
+    // NetworkAudioOutputWriter.
+    std::function<bool()> _isNetworkOutput = nullptr;
+    NetworkAudioOutputWriter::Options _networkOutputOptions;
+    std::shared_ptr<NetworkAudioOutputWriter::Stats> _networkOutputStats = std::make_shared<NetworkAudioOutputWriter::Stats>();
+    // Inputs played after the current one ends, back to back. Filled with
+    // enqueueInput() from Python.
+    std::shared_ptr<FileInputQueue> _inputQueue = std::make_shared<FileInputQueue>();
+
+    // Seek target set by seek(), applied by the capture thread at the next
+    // 10 ms boundary; -1 when there is none. |_inputPositionMs| is updated
+    // every frame.
+    std::atomic<int64_t> _seekRequestMs{-1};
+    std::atomic<int64_t> _inputPositionMs{0};
+
+    // Playback speed of the input, between AudioTimeStretcher::kMinSpeed and
+    // kMaxSpeed; picked up at the next 10 ms boundary.
+    std::atomic<float> _playbackSpeed{1.0f};
+
     std::function<bool()> _isPlayoutPaused = nullptr;
     std::function<bool()> _isRecordingPaused = nullptr;
 
+    // Plain state set from Python, used wherever the matching callable above
+    // is left unset. Polling it never takes the GIL, so the capture and
+    // playout threads stay off the interpreter on every tick.
+    std::atomic<bool> _playoutPaused{false};
+    std::atomic<bool> _recordingPaused{false};
+    std::atomic<bool> _endlessPlayout{false};
+    // Notified when either flag changes; the device threads park on it
+    // while both are set.
+    AudioIdleSignal _idleSignal;
+    std::string _inputFilename;
+    std::string _outputFilename;
+    mutable std::mutex _filenameMutex;
+
     std::function<void(std::string)> _playoutEndedCallback = nullptr;
+
+    // Set by NativeInstance; |_playoutEndedCallback| is delivered through it
+    // instead of being called from the capture thread.
+    std::shared_ptr<CallbackDispatcher> _callbackDispatcher;
+
+    AudioClockStats _clockStats{tgcalls::HotPathCounters::AudioDevice::File};
+    // Loudness normalization of the input before it is sent.
+    AudioLoudnessSettings _loudness;
+    AudioGlitchDetector _glitches{&_clockStats};
+
+    bool _playoutIsPaused() const {
+        return _isPlayoutPaused ? _isPlayoutPaused() : _playoutPaused.load(std::memory_order_relaxed);
+    }
+    bool _recordingIsPaused() const {
+        return _isRecordingPaused ? _isRecordingPaused() : _recordingPaused.load(std::memory_order_relaxed);
+    }
+    // Paused through the flags rather than the callables, whose changes
+    // don't notify |_idleSignal|.
+    bool _playoutIsIdle() const {
+        return !_isPlayoutPaused && _playoutPaused.load(std::memory_order_relaxed);
+    }
+    bool _recordingIsIdle() const {
+        return !_isRecordingPaused && _recordingPaused.load(std::memory_order_relaxed);
+    }
+    bool _playoutIsEndless() const {
+        return _isEndlessPlayout ? _isEndlessPlayout() : _endlessPlayout.load(std::memory_order_relaxed);
+    }
+    std::string _currentInputFilename() const {
+        if (_getInputFilename) {
+            return _getInputFilename();
+        }
+        std::lock_guard<std::mutex> lock(_filenameMutex);
+        return _inputFilename;
+    }
+    std::string _currentOutputFilename() const {
+        if (_getOutputFilename) {
+            return _getOutputFilename();
+        }
+        std::lock_guard<std::mutex> lock(_filenameMutex);
+        return _outputFilename;
+    }
+
+    FileInput::Options _inputOptions() const {
+        FileInput::Options options;
+        options.isCompressed = _isCompressedInput && _isCompressedInput();
+        options.isMapped = _isMappedInput && _isMappedInput();
+        options.mappedPrefetchBytes = _mappedInputPrefetchBytes;
+        options.isCached = _isCachedInput && _isCachedInput();
+        options.cacheKey = _inputCacheKey;
+        options.isNetwork = _isNetworkInput && _isNetworkInput();
+        options.network = _networkInputOptions;
+        options.networkStats = _networkInputStats;
+        return options;
+    }
+    AudioWriterStats _writerStats;
 };
@@ -0,0 +1,110 @@
+#include "FileInput.h"
+
+#include <rtc_base/logging.h>
+
+FileInput::FileInput(std::string filename, Kind kind, const AudioFormat &format)
+    : _filename(std::move(filename)),
+      _kind(kind),
+      _format(format) {}
+
+std::unique_ptr<FileInput> FileInput::Open(const std::string &filename,
+                                           const Options &options,
+                                           const AudioFormat &format) {
+  if (options.isNetwork) {
+    std::unique_ptr<FileInput> input(new FileInput(filename, Kind::kNetwork, format));
+    input->_network.reset(new NetworkAudioInput(filename, format, options.network, options.networkStats));
+    input->_network->Start();
+    RTC_LOG(LS_INFO) << "Opened network input: " << filename;
+    return input;
+  }
+
+  if (options.isCached) {
+    std::unique_ptr<FileInput> input(new FileInput(filename, Kind::kMemory, format));
+    input->_pcm = DecodedAudioCache::Shared()->Get(
+        filename, options.cacheKey, options.isCompressed, format);
+    if (!input->_pcm) {
+      return nullptr;
+    }
+    input->_data = input->_pcm->data();
+    input->_size = input->_pcm->size();
+    RTC_LOG(LS_INFO) << "Opened cached input file: " << filename;
+    return input;
+  }
+
+  if (options.isCompressed) {
+    std::unique_ptr<FileInput> input(new FileInput(filename, Kind::kDecoded, format));
+    input->_decoder.reset(new AudioFileDecoder(filename, format, format.BytesPer10Ms() * 100));
+    if (!input->_decoder->Open()) {
+      return nullptr;
+    }
+    RTC_LOG(LS_INFO) << "Opened compressed input file: " << filename;
+    return input;
+  }
+
+  if (options.isMapped) {
+    std::unique_ptr<FileInput> input(new FileInput(filename, Kind::kMemory, format));
+    input->_mapping = MappedAudioFile::Open(filename);
+    if (!input->_mapping) {
+      return nullptr;
+    }
+    input->_data = input->_mapping->data();
+    input->_size = input->_mapping->size();
+    input->_prefetchBytes = options.mappedPrefetchBytes;
+    RTC_LOG(LS_INFO) << "Opened mapped input file: " << filename;
+    return input;
+  }
+
+  std::unique_ptr<FileInput> input(new FileInput(filename, Kind::kRaw, format));
+  input->_file = webrtc::FileWrapper::OpenReadOnly(filename.c_str());
+  if (!input->_file.is_open()) {
+    RTC_LOG(LS_ERROR) << "Failed to open audio input file: " << filename;
+    return nullptr;
+  }
+  RTC_LOG(LS_INFO) << "Opened input file: " << filename;
+  return input;
+}
+
+void FileInput::Rewind() {
+  _position = 0;
+  switch (_kind) {
+    case Kind::kRaw:
+      _file.Rewind();
+      _fileEnded = false;
+      break;
+    case Kind::kMemory:
+      _offset = 0;
+      _prefetchedUntil = 0;
+      break;
+    case Kind::kDecoded:
+      _decoder->Rewind();
+      break;
+    case Kind::kNetwork:
+      break;
+  }
+}
+
+void FileInput::Seek(int64_t positionMs) {
+  if (positionMs < 0) {
+    positionMs = 0;
+  }
+  size_t sampleBytes = _format.channels * sizeof(int16_t);
+  size_t position = static_cast<size_t>(positionMs) * _format.sampleRate / 1000 * sampleBytes;
+
+  switch (_kind) {
+    case Kind::kRaw:
+      _file.SeekTo(static_cast<int64_t>(position));
+      _fileEnded = false;
+      break;
+    case Kind::kMemory:
+      position = std::min(position, _size - _size % sampleBytes);
+      _offset = position;
+      _prefetchedUntil = 0;
+      break;
+    case Kind::kDecoded:
+      _decoder->Seek(positionMs);
+      break;
+    case Kind::kNetwork:
+      return;
+  }
+  _position = position;
+}
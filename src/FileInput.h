@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <rtc_base/system/file_wrapper.h>
+
+#include "AudioFileDecoder.h"
+#include "AudioFormat.h"
+#include "DecodedAudioCache.h"
+#include "MappedAudioFile.h"
+#include "NetworkAudioInput.h"
+
+// One opened input file of any supported kind: raw PCM read on every tick,
+// memory mapped raw PCM, PCM shared through the DecodedAudioCache, a
+// compressed file decoded ahead by AudioFileDecoder, or a live stream from a
+// URL read by NetworkAudioInput.
+class FileInput {
+public:
+  struct Options {
+    // Demux and decode with FFmpeg instead of reading raw s16le.
+    bool isCompressed = false;
+    // Memory map raw input, requesting |mappedPrefetchBytes| ahead.
+    bool isMapped = false;
+    size_t mappedPrefetchBytes = MappedAudioFile::kDefaultPrefetchBytes;
+    // Decode once into the process-wide cache; |cacheKey| overrides the
+    // default path + mtime key.
+    bool isCached = false;
+    std::string cacheKey;
+    // Open the filename as a URL of a live stream, reconnecting whenever it
+    // drops; it never ends, and seeking does nothing.
+    bool isNetwork = false;
+    NetworkAudioInput::Options network;
+    std::shared_ptr<NetworkAudioInput::Stats> networkStats;
+  };
+
+  // Returns nullptr if |filename| cannot be opened.
+  static std::unique_ptr<FileInput> Open(const std::string &filename,
+                                         const Options &options,
+                                         const AudioFormat &format);
+
+  const std::string &filename() const { return _filename; }
+
+  // Playback position within the input.
+  int64_t PositionMs() const {
+    return static_cast<int64_t>(_position) * 10 / static_cast<int64_t>(_format.BytesPer10Ms());
+  }
+
+  // Copies up to |length| bytes into |buffer| and returns how many were
+  // available. When a whole frame is available in memory and |frame| is not
+  // null, |*frame| points at it instead and |buffer| is left untouched.
+  size_t Read(int8_t *buffer, size_t length, const int8_t **frame) {
+    switch (_kind) {
+      case Kind::kRaw: {
+        size_t read = _file.Read(buffer, length);
+        if (read < length) {
+          _fileEnded = true;
+        }
+        _position += read;
+        return read;
+      }
+      case Kind::kMemory: {
+        if (_mapping) {
+          if (_offset + _prefetchBytes / 2 >= _prefetchedUntil) {
+            _mapping->Prefetch(_offset, _prefetchBytes);
+            _prefetchedUntil = _offset + _prefetchBytes;
+          }
+        }
+        size_t read = std::min(_size - _offset, length);
+        if (frame && read == length) {
+          *frame = _data + _offset;
+        } else {
+          memcpy(buffer, _data + _offset, read);
+        }
+        _offset += read;
+        _position = _offset;
+        return read;
+      }
+      case Kind::kDecoded: {
+        size_t read = _decoder->Read(buffer, length);
+        _position += read;
+        return read;
+      }
+      case Kind::kNetwork: {
+        size_t read = _network->Read(buffer, length);
+        _position += read;
+        return read;
+      }
+    }
+    return 0;
+  }
+
+  // True once the whole input has been read.
+  bool Finished() const {
+    switch (_kind) {
+      case Kind::kRaw:
+        return _fileEnded;
+      case Kind::kMemory:
+        return _offset == _size;
+      case Kind::kDecoded:
+        return _decoder->Finished();
+      case Kind::kNetwork:
+        return false;
+    }
+    return true;
+  }
+
+  // Plays the input again from the beginning.
+  void Rewind();
+
+  // Continues playback at |positionMs|, rounded down to a whole sample. Never
+  // blocks; a decoded input catches up in the background.
+  void Seek(int64_t positionMs);
+
+private:
+  enum class Kind { kRaw, kMemory, kDecoded, kNetwork };
+
+  FileInput(std::string filename, Kind kind, const AudioFormat &format);
+
+  std::string _filename;
+  Kind _kind;
+  AudioFormat _format;
+  // Bytes of PCM played so far, or where the last seek went.
+  size_t _position = 0;
+
+  webrtc::FileWrapper _file;
+  bool _fileEnded = false;
+
+  std::shared_ptr<MappedAudioFile> _mapping;
+  std::shared_ptr<const DecodedAudioCache::Pcm> _pcm;
+  const int8_t *_data = nullptr;
+  size_t _size = 0;
+  size_t _offset = 0;
+  size_t _prefetchBytes = 0;
+  size_t _prefetchedUntil = 0;
+
+  std::unique_ptr<AudioFileDecoder> _decoder;
+
+  std::unique_ptr<NetworkAudioInput> _network;
+};
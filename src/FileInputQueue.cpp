@@ -0,0 +1,136 @@
+#include "FileInputQueue.h"
+
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+
+FileInputQueue::FileInputQueue() = default;
+
+FileInputQueue::~FileInputQueue() {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  if (_thread) {
+    _thread->Stop();
+    _thread.reset();
+  }
+}
+
+void FileInputQueue::Enqueue(std::string filename, FileInput::Options options) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _items.push_back(Item{std::move(filename), std::move(options)});
+  EnsureThread();
+  _wakeUp.notify_one();
+}
+
+void FileInputQueue::Clear() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _items.clear();
+  _readyItem.reset();
+  if (_ready) {
+    _retired.push_back(std::move(_ready));
+    _wakeUp.notify_one();
+  }
+  _clearGeneration++;
+}
+
+size_t FileInputQueue::Size() const {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _items.size() + (_ready ? 1 : 0) + (_preparing ? 1 : 0);
+}
+
+void FileInputQueue::SetFormat(const AudioFormat &format) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  bool changed = !_hasFormat || _format.sampleRate != format.sampleRate ||
+                 _format.channels != format.channels;
+  _format = format;
+  _hasFormat = true;
+  if (!changed) {
+    return;
+  }
+
+  _formatGeneration++;
+  if (_ready) {
+    _retired.push_back(std::move(_ready));
+    _items.push_front(std::move(*_readyItem));
+    _readyItem.reset();
+  }
+  _wakeUp.notify_one();
+}
+
+std::unique_ptr<FileInput> FileInputQueue::TakeReady() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _readyItem.reset();
+  _wakeUp.notify_one();
+  return std::move(_ready);
+}
+
+void FileInputQueue::Retire(std::unique_ptr<FileInput> input) {
+  if (!input) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(_mutex);
+  EnsureThread();
+  _retired.push_back(std::move(input));
+  _wakeUp.notify_one();
+}
+
+void FileInputQueue::EnsureThread() {
+  if (_thread) {
+    return;
+  }
+  _thread.reset(new rtc::PlatformThread(
+      ThreadFunc, this, "tgcalls_input_queue", rtc::kNormalPriority));
+  _thread->Start();
+}
+
+void FileInputQueue::ThreadFunc(void *pThis) {
+  static_cast<FileInputQueue *>(pThis)->Run();
+}
+
+void FileInputQueue::Run() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    _wakeUp.wait(lock, [this] {
+      return _stopped || !_retired.empty() ||
+             (_hasFormat && !_ready && !_items.empty());
+    });
+    if (_stopped) {
+      break;
+    }
+
+    if (!_retired.empty()) {
+      auto retired = std::move(_retired);
+      lock.unlock();
+      retired.clear();
+      lock.lock();
+      continue;
+    }
+
+    Item item = std::move(_items.front());
+    _items.pop_front();
+    AudioFormat format = _format;
+    uint64_t clearGeneration = _clearGeneration;
+    uint64_t formatGeneration = _formatGeneration;
+    _preparing = true;
+    lock.unlock();
+
+    auto input = FileInput::Open(item.filename, item.options, format);
+
+    lock.lock();
+    _preparing = false;
+    if (!input) {
+      RTC_LOG(LS_ERROR) << "Skipping queued input that failed to open: " << item.filename;
+    } else if (clearGeneration != _clearGeneration) {
+      _retired.push_back(std::move(input));
+    } else if (formatGeneration != _formatGeneration) {
+      // Opened in a stale format; open it again next.
+      _retired.push_back(std::move(input));
+      _items.push_front(std::move(item));
+    } else {
+      _ready = std::move(input);
+      _readyItem.reset(new Item(std::move(item)));
+    }
+  }
+}
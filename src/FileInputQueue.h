@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "FileInput.h"
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+// Inputs queued to play after the current one without a gap.
+//
+// A background thread opens the next queued file (starting its decoder, or
+// decoding it into the cache) ahead of time, so the capture thread only has
+// to swap a ready FileInput in when the current one ends. Finished inputs
+// are handed back and destroyed on the same thread, keeping decoder joins
+// off the capture thread.
+class FileInputQueue {
+public:
+  FileInputQueue();
+  ~FileInputQueue();
+
+  void Enqueue(std::string filename, FileInput::Options options);
+
+  // Drops every queued input, including the one opened ahead.
+  void Clear();
+
+  // Queued inputs, including the one being opened or ready.
+  size_t Size() const;
+
+  // Sets the format queued inputs are opened in. Called by the device when
+  // recording starts; a ready input in another format is opened again.
+  void SetFormat(const AudioFormat &format);
+
+  // The next input if it is open already. Never blocks on I/O.
+  std::unique_ptr<FileInput> TakeReady();
+
+  // Destroys |input| on the background thread.
+  void Retire(std::unique_ptr<FileInput> input);
+
+private:
+  struct Item {
+    std::string filename;
+    FileInput::Options options;
+  };
+
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  // Starts the background thread on first use. Requires |_mutex|.
+  void EnsureThread();
+
+  mutable std::mutex _mutex;
+  std::condition_variable _wakeUp;
+  std::deque<Item> _items;
+  std::unique_ptr<Item> _readyItem;
+  std::unique_ptr<FileInput> _ready;
+  std::vector<std::unique_ptr<FileInput>> _retired;
+  AudioFormat _format;
+  bool _hasFormat = false;
+  bool _preparing = false;
+  // Bumped by Clear() and SetFormat() so an input opened meanwhile is
+  // dropped or opened again.
+  uint64_t _clearGeneration = 0;
+  uint64_t _formatGeneration = 0;
+  bool _stopped = false;
+
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
@@ -0,0 +1,478 @@
+#include "FileVideoSource.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+#include <api/video/i420_buffer.h>
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+#include <rtc_base/ref_counted_object.h>
+#include <rtc_base/time_utils.h>
+
+#include "libyuv.h"
+
+#include "FileAudioDeviceDescriptor.h"
+
+namespace {
+
+// Buffers queued for or held by the encoder at once.
+constexpr size_t kFramePoolSize = 8;
+
+// How often a source synced to audio checks the audio position while it
+// waits for it, and how far apart the two may drift before the video seeks
+// to the audio instead of waiting or dropping frames.
+constexpr int64_t kAudioPollIntervalUs = 5 * rtc::kNumMicrosecsPerMillisec;
+constexpr int64_t kResyncMs = 1000;
+
+// How long the thread sleeps at the end of a file before checking for a
+// seek again.
+constexpr int64_t kIdleIntervalUs = 20 * rtc::kNumMicrosecsPerMillisec;
+
+AVPixelFormat GetHardwareFormat(AVCodecContext *context, const AVPixelFormat *formats) {
+  const int hardwareFormat = *static_cast<const int *>(context->opaque);
+  for (auto format = formats; *format != AV_PIX_FMT_NONE; format++) {
+    if (*format == hardwareFormat) {
+      return *format;
+    }
+  }
+  // The stream needs something the device can't decode; use software.
+  for (auto format = formats; *format != AV_PIX_FMT_NONE; format++) {
+    const AVPixFmtDescriptor *descriptor = av_pix_fmt_desc_get(*format);
+    if (descriptor && !(descriptor->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+      return *format;
+    }
+  }
+  return AV_PIX_FMT_NONE;
+}
+
+int EvenAtLeastTwo(int64_t value) {
+  return std::max(2, static_cast<int>(value) & ~1);
+}
+
+}  // namespace
+
+FileVideoSource::FileVideoSource(std::string filename, Options options)
+    : _filename(std::move(filename)),
+      _options(std::move(options)),
+      _source(new rtc::RefCountedObject<AdaptedVideoSource>()),
+      _pool(false, kFramePoolSize),
+      _scaledPool(false, kFramePoolSize) {}
+
+FileVideoSource::~FileVideoSource() {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  if (_thread) {
+    _thread->Stop();
+    _thread.reset();
+  }
+  Close();
+}
+
+void FileVideoSource::SyncTo(std::shared_ptr<FileAudioDeviceDescriptor> audio) {
+  _audio = std::move(audio);
+}
+
+bool FileVideoSource::Open() {
+  if (!OpenInput()) {
+    return false;
+  }
+
+  _thread.reset(new rtc::PlatformThread(
+      ThreadFunc, this, "tgcalls_video_decoder", rtc::kNormalPriority));
+  _thread->Start();
+  return true;
+}
+
+void FileVideoSource::Seek(int64_t positionMs) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _seekRequestMs = positionMs < 0 ? 0 : positionMs;
+  _wakeUp.notify_one();
+}
+
+std::function<webrtc::VideoTrackSourceInterface *()> FileVideoSource::GetVideoSource() const {
+  return [source = _source]() -> webrtc::VideoTrackSourceInterface * {
+    return source.get();
+  };
+}
+
+bool FileVideoSource::OpenInput() {
+  int ret = avformat_open_input(&_formatContext, _filename.c_str(), nullptr, nullptr);
+  if (ret < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open video input file: " << _filename;
+    return false;
+  }
+
+  ret = avformat_find_stream_info(_formatContext, nullptr);
+  if (ret < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to read stream info: " << _filename;
+    Close();
+    return false;
+  }
+
+  _streamIndex = av_find_best_stream(_formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+  if (_streamIndex < 0) {
+    RTC_LOG(LS_ERROR) << "No video stream in input file: " << _filename;
+    Close();
+    return false;
+  }
+  AVStream *stream = _formatContext->streams[_streamIndex];
+  const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+  if (!codec) {
+    RTC_LOG(LS_ERROR) << "Unsupported video codec in input file: " << _filename;
+    Close();
+    return false;
+  }
+  // Audio and other streams are played elsewhere, if at all; the demuxer
+  // needn't hand out their packets.
+  for (unsigned int i = 0; i < _formatContext->nb_streams; i++) {
+    if (static_cast<int>(i) != _streamIndex) {
+      _formatContext->streams[i]->discard = AVDISCARD_ALL;
+    }
+  }
+
+  _codecContext = avcodec_alloc_context3(codec);
+  if (!_codecContext || avcodec_parameters_to_context(_codecContext, stream->codecpar) < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to set up video decoder for input file: " << _filename;
+    Close();
+    return false;
+  }
+  SetUpHardwareDecoder(codec);
+  if (avcodec_open2(_codecContext, codec, nullptr) < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open video decoder for input file: " << _filename;
+    Close();
+    return false;
+  }
+
+  AVRational frameRate = av_guess_frame_rate(_formatContext, stream, nullptr);
+  if (frameRate.num > 0 && frameRate.den > 0) {
+    _frameDurationMs = std::max<int64_t>(1, 1000 * static_cast<int64_t>(frameRate.den) / frameRate.num);
+  }
+  ComputeOutputSize();
+
+  _frame = av_frame_alloc();
+  _softwareFrame = av_frame_alloc();
+  _packet = av_packet_alloc();
+  if (!_frame || !_softwareFrame || !_packet) {
+    Close();
+    return false;
+  }
+
+  RTC_LOG(LS_INFO) << "Decoding " << avcodec_get_name(stream->codecpar->codec_id)
+                   << (_hardwareDevice ? " on " + _options.hwaccel : std::string())
+                   << " video input file: " << _filename << " to "
+                   << _outputWidth << "x" << _outputHeight;
+  return true;
+}
+
+void FileVideoSource::SetUpHardwareDecoder(const AVCodec *codec) {
+  if (_options.hwaccel.empty()) {
+    return;
+  }
+
+  AVHWDeviceType type = av_hwdevice_find_type_by_name(_options.hwaccel.c_str());
+  if (type == AV_HWDEVICE_TYPE_NONE) {
+    RTC_LOG(LS_WARNING) << "Unknown hardware decoder " << _options.hwaccel << ", decoding in software";
+    return;
+  }
+  for (int i = 0;; i++) {
+    const AVCodecHWConfig *config = avcodec_get_hw_config(codec, i);
+    if (!config) {
+      RTC_LOG(LS_WARNING) << codec->name << " can't be decoded on " << _options.hwaccel << ", decoding in software";
+      return;
+    }
+    if ((config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) && config->device_type == type) {
+      _hardwarePixelFormat = config->pix_fmt;
+      break;
+    }
+  }
+
+  const char *device = _options.hwaccelDevice.empty() ? nullptr : _options.hwaccelDevice.c_str();
+  if (av_hwdevice_ctx_create(&_hardwareDevice, type, device, nullptr, 0) < 0) {
+    RTC_LOG(LS_WARNING) << "Failed to open " << _options.hwaccel << " device, decoding in software";
+    _hardwareDevice = nullptr;
+    _hardwarePixelFormat = -1;
+    return;
+  }
+  _codecContext->hw_device_ctx = av_buffer_ref(_hardwareDevice);
+  _codecContext->opaque = &_hardwarePixelFormat;
+  _codecContext->get_format = GetHardwareFormat;
+}
+
+void FileVideoSource::ComputeOutputSize() {
+  int64_t width = std::max(_codecContext->width, 2);
+  int64_t height = std::max(_codecContext->height, 2);
+  if (_options.width > 0 && _options.height > 0) {
+    width = _options.width;
+    height = _options.height;
+  } else if (_options.width > 0) {
+    height = height * _options.width / width;
+    width = _options.width;
+  } else if (_options.height > 0) {
+    width = width * _options.height / height;
+    height = _options.height;
+  }
+  _outputWidth = EvenAtLeastTwo(width);
+  _outputHeight = EvenAtLeastTwo(height);
+}
+
+void FileVideoSource::ThreadFunc(void *pThis) {
+  static_cast<FileVideoSource *>(pThis)->Run();
+}
+
+void FileVideoSource::Run() {
+  bool hasFrame = false;
+  bool decodedSinceLoop = false;
+  int64_t lastDueUs = 0;
+
+  while (!_stopped) {
+    int64_t seekMs = _seekRequestMs.exchange(-1);
+    if (seekMs >= 0) {
+      SeekTo(seekMs);
+      hasFrame = false;
+    }
+
+    if (!hasFrame) {
+      if (!DecodeNextFrame()) {
+        if (_options.loop && !_audio && decodedSinceLoop) {
+          decodedSinceLoop = false;
+          SeekTo(0);
+          continue;
+        }
+        _finished = true;
+        if (_audio) {
+          // The audio may seek back into the file, or start it over.
+          int64_t audioMs = _audio->_inputPositionMs.load(std::memory_order_relaxed);
+          if (audioMs + kResyncMs < _positionMs.load(std::memory_order_relaxed)) {
+            SeekTo(audioMs);
+            continue;
+          }
+        }
+        Wait(kIdleIntervalUs);
+        continue;
+      }
+      _finished = false;
+      decodedSinceLoop = true;
+      if (_skipUntilMs >= 0) {
+        if (_framePtsMs + _frameDurationMs <= _skipUntilMs) {
+          continue;
+        }
+        _skipUntilMs = -1;
+      }
+      hasFrame = true;
+    }
+
+    int64_t now = rtc::TimeMicros();
+    if (_audio) {
+      int64_t audioMs = _audio->_inputPositionMs.load(std::memory_order_relaxed);
+      int64_t aheadMs = _framePtsMs - audioMs;
+      if (aheadMs > kResyncMs || aheadMs < -kResyncMs) {
+        SeekTo(audioMs);
+        hasFrame = false;
+        continue;
+      }
+      if (aheadMs > 0) {
+        Wait(std::min(aheadMs * rtc::kNumMicrosecsPerMillisec, kAudioPollIntervalUs));
+        continue;
+      }
+      if (aheadMs + _frameDurationMs < 0) {
+        // The audio is already past this frame.
+        _droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        hasFrame = false;
+        continue;
+      }
+    } else {
+      if (!_hasClock) {
+        // Continues the previous schedule after a loop or a seek, so the
+        // first frame isn't shown early.
+        _hasClock = true;
+        _clockStartUs = lastDueUs ? std::max(now, lastDueUs + _frameDurationMs * rtc::kNumMicrosecsPerMillisec) : now;
+        _clockStartPtsMs = _framePtsMs;
+      }
+      int64_t dueUs = _clockStartUs + (_framePtsMs - _clockStartPtsMs) * rtc::kNumMicrosecsPerMillisec;
+      if (dueUs > now) {
+        Wait(dueUs - now);
+        continue;
+      }
+      if (now - dueUs > kResyncMs * rtc::kNumMicrosecsPerMillisec) {
+        // Stalled, or the timestamps jumped: start the schedule over here
+        // rather than rushing through what was missed.
+        _hasClock = false;
+        lastDueUs = 0;
+        continue;
+      }
+      lastDueUs = dueUs;
+    }
+
+    _positionMs.store(_framePtsMs, std::memory_order_relaxed);
+    Present(_frame);
+    hasFrame = false;
+  }
+}
+
+bool FileVideoSource::DecodeNextFrame() {
+  while (true) {
+    int ret = avcodec_receive_frame(_codecContext, _frame);
+    if (ret == 0) {
+      break;
+    }
+    if (ret == AVERROR_EOF) {
+      return false;
+    }
+    if (ret != AVERROR(EAGAIN)) {
+      RTC_LOG(LS_ERROR) << "Failed to decode video input file: " << _filename;
+      return false;
+    }
+    if (_flushingDecoder) {
+      return false;
+    }
+
+    ret = av_read_frame(_formatContext, _packet);
+    if (ret < 0) {
+      _flushingDecoder = true;
+      avcodec_send_packet(_codecContext, nullptr);
+      continue;
+    }
+    if (_packet->stream_index == _streamIndex) {
+      avcodec_send_packet(_codecContext, _packet);
+    }
+    av_packet_unref(_packet);
+  }
+
+  if (_frame->format == _hardwarePixelFormat) {
+    if (av_hwframe_transfer_data(_softwareFrame, _frame, 0) < 0) {
+      RTC_LOG(LS_ERROR) << "Failed to download a frame from " << _options.hwaccel << ": " << _filename;
+      av_frame_unref(_frame);
+      return false;
+    }
+    av_frame_copy_props(_softwareFrame, _frame);
+    av_frame_unref(_frame);
+    av_frame_move_ref(_frame, _softwareFrame);
+  }
+
+  AVStream *stream = _formatContext->streams[_streamIndex];
+  int64_t pts = _frame->best_effort_timestamp;
+  if (pts == AV_NOPTS_VALUE) {
+    _framePtsMs += _frameDurationMs;
+  } else {
+    if (stream->start_time != AV_NOPTS_VALUE) {
+      pts -= stream->start_time;
+    }
+    _framePtsMs = av_rescale_q(pts, stream->time_base, AVRational{1, 1000});
+  }
+  return true;
+}
+
+void FileVideoSource::SeekTo(int64_t positionMs) {
+  positionMs = std::max<int64_t>(0, positionMs);
+  AVStream *stream = _formatContext->streams[_streamIndex];
+  int64_t target = av_rescale_q(positionMs, AVRational{1, 1000}, stream->time_base);
+  if (stream->start_time != AV_NOPTS_VALUE) {
+    target += stream->start_time;
+  }
+  if (av_seek_frame(_formatContext, _streamIndex, target, AVSEEK_FLAG_BACKWARD) < 0) {
+    RTC_LOG(LS_WARNING) << "Failed to seek video input file to " << positionMs << " ms: " << _filename;
+  }
+  avcodec_flush_buffers(_codecContext);
+  _flushingDecoder = false;
+  _skipUntilMs = positionMs;
+  _hasClock = false;
+  _finished = false;
+}
+
+void FileVideoSource::Wait(int64_t timeoutUs) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _wakeUp.wait_for(lock, std::chrono::microseconds(timeoutUs), [this] {
+    return _stopped || _seekRequestMs.load(std::memory_order_relaxed) >= 0;
+  });
+}
+
+void FileVideoSource::Present(const AVFrame *frame) {
+  int64_t timestampUs = rtc::TimeMicros();
+  int adaptedWidth = 0;
+  int adaptedHeight = 0;
+  int cropWidth = 0;
+  int cropHeight = 0;
+  int cropX = 0;
+  int cropY = 0;
+  if (!_source->adapt(_outputWidth, _outputHeight, timestampUs,
+                      &adaptedWidth, &adaptedHeight, &cropWidth, &cropHeight, &cropX, &cropY)) {
+    _droppedFrames.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  bool isScaled = adaptedWidth != _outputWidth || adaptedHeight != _outputHeight;
+  auto buffer = _pool.CreateI420Buffer(_outputWidth, _outputHeight);
+  auto scaled = isScaled ? _scaledPool.CreateI420Buffer(adaptedWidth, adaptedHeight) : buffer;
+  if (!buffer || !scaled || !ScaleInto(frame, buffer.get())) {
+    _droppedFrames.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (isScaled) {
+    scaled->CropAndScaleFrom(*buffer, cropX, cropY, cropWidth, cropHeight);
+  }
+
+  _source->deliver(webrtc::VideoFrame::Builder()
+                       .set_video_frame_buffer(scaled)
+                       .set_timestamp_us(timestampUs)
+                       .set_rotation(webrtc::kVideoRotation_0)
+                       .build());
+  _sentFrames.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool FileVideoSource::ScaleInto(const AVFrame *frame, webrtc::I420Buffer *buffer) {
+  if (frame->format == AV_PIX_FMT_YUV420P || frame->format == AV_PIX_FMT_YUVJ420P) {
+    return libyuv::I420Scale(frame->data[0], frame->linesize[0], frame->data[1], frame->linesize[1],
+                             frame->data[2], frame->linesize[2], frame->width, frame->height,
+                             buffer->MutableDataY(), buffer->StrideY(), buffer->MutableDataU(), buffer->StrideU(),
+                             buffer->MutableDataV(), buffer->StrideV(), buffer->width(), buffer->height(),
+                             libyuv::kFilterBox) == 0;
+  }
+
+  // Hardware decoders hand out NV12 or P010, and software ones anything.
+  _scaler = sws_getCachedContext(_scaler, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                 buffer->width(), buffer->height(), AV_PIX_FMT_YUV420P,
+                                 SWS_BILINEAR, nullptr, nullptr, nullptr);
+  if (!_scaler) {
+    return false;
+  }
+  uint8_t *planes[4] = {buffer->MutableDataY(), buffer->MutableDataU(), buffer->MutableDataV(), nullptr};
+  int strides[4] = {buffer->StrideY(), buffer->StrideU(), buffer->StrideV(), 0};
+  return sws_scale(_scaler, frame->data, frame->linesize, 0, frame->height, planes, strides) > 0;
+}
+
+void FileVideoSource::Close() {
+  if (_scaler) {
+    sws_freeContext(_scaler);
+    _scaler = nullptr;
+  }
+  if (_packet) {
+    av_packet_free(&_packet);
+  }
+  if (_softwareFrame) {
+    av_frame_free(&_softwareFrame);
+  }
+  if (_frame) {
+    av_frame_free(&_frame);
+  }
+  if (_codecContext) {
+    avcodec_free_context(&_codecContext);
+  }
+  if (_hardwareDevice) {
+    av_buffer_unref(&_hardwareDevice);
+  }
+  if (_formatContext) {
+    avformat_close_input(&_formatContext);
+  }
+}
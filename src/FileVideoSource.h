@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <api/scoped_refptr.h>
+#include <common_video/include/video_frame_buffer_pool.h>
+
+#include "AdaptedVideoSource.h"
+
+struct AVBufferRef;
+struct AVCodec;
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct SwsContext;
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+class FileAudioDeviceDescriptor;
+
+// Outgoing group call video decoded from any file FFmpeg can demux, the
+// video counterpart of a compressed FileAudioDeviceDescriptor input.
+//
+// A background thread decodes, on a hardware decoder if asked to, and
+// presents every frame when it is due: on its own monotonic clock, or, when
+// synced to a file audio device, once that device's input has played up to
+// it. Frames are scaled into pooled I420 buffers with libyuv, or with
+// swscale for formats other than planar 4:2:0, and dropped before any of
+// that when the encoder doesn't want them.
+class FileVideoSource {
+public:
+  struct Options {
+    // Output size; 0 keeps the file's. With only one of them set, the other
+    // follows the file's aspect ratio.
+    int width = 0;
+    int height = 0;
+    // Starts over at the end of the file. Not used while synced to audio,
+    // whose position is followed instead.
+    bool loop = false;
+    // FFmpeg hardware device type to decode on, e.g. "vaapi" or "cuda", and
+    // optionally the device to open. Decoding falls back to software when
+    // empty or when the codec or device doesn't support it.
+    std::string hwaccel;
+    std::string hwaccelDevice;
+  };
+
+  FileVideoSource(std::string filename, Options options);
+  ~FileVideoSource();
+
+  // Follows the input position of |audio| instead of pacing on its own
+  // clock: frames wait for the audio, late ones are dropped and the video
+  // seeks along when the audio seeks. Must be called before Open().
+  void SyncTo(std::shared_ptr<FileAudioDeviceDescriptor> audio);
+
+  // Opens the input and starts the decoding thread. Returns false if the file
+  // cannot be opened or has no decodable video stream.
+  bool Open();
+
+  // Continues at the first frame at or after |positionMs|. Unsynced only;
+  // a synced source takes its position from the audio.
+  void Seek(int64_t positionMs);
+
+  // Presentation time of the last frame sent, in file time.
+  int64_t PositionMs() const { return _positionMs.load(std::memory_order_relaxed); }
+  // True once the last frame of a non-looping file has been presented.
+  bool Finished() const { return _finished.load(std::memory_order_relaxed); }
+  uint64_t SentFrames() const { return _sentFrames.load(std::memory_order_relaxed); }
+  // Frames the encoder didn't want, that came too late for the audio or
+  // found every pooled buffer in use.
+  uint64_t DroppedFrames() const { return _droppedFrames.load(std::memory_order_relaxed); }
+
+  // For GroupInstanceDescriptor::getVideoSource and setVideoSource().
+  std::function<webrtc::VideoTrackSourceInterface*()> GetVideoSource() const;
+
+private:
+  // Sets up demuxer and decoder without starting the thread.
+  bool OpenInput();
+  void SetUpHardwareDecoder(const AVCodec *codec);
+  void ComputeOutputSize();
+
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  // Decodes the next frame into |_frame|, downloading it from the hardware
+  // decoder if needed, and sets |_framePtsMs|. Returns false at the end of
+  // the file or on an unrecoverable error.
+  bool DecodeNextFrame();
+  void SeekTo(int64_t positionMs);
+  // Waits up to |timeoutUs|, or until stopped or asked to seek.
+  void Wait(int64_t timeoutUs);
+
+  void Present(const AVFrame *frame);
+  bool ScaleInto(const AVFrame *frame, webrtc::I420Buffer *buffer);
+
+  void Close();
+
+  std::string _filename;
+  Options _options;
+  std::shared_ptr<FileAudioDeviceDescriptor> _audio;
+
+  rtc::scoped_refptr<AdaptedVideoSource> _source;
+  // Frames at the output size, and scaled further to what the encoder
+  // asks for; each pool only holds buffers of one size.
+  webrtc::VideoFrameBufferPool _pool;
+  webrtc::VideoFrameBufferPool _scaledPool;
+
+  AVFormatContext *_formatContext = nullptr;
+  AVCodecContext *_codecContext = nullptr;
+  AVBufferRef *_hardwareDevice = nullptr;
+  // An AVPixelFormat; the decoder's get_format callback reads it.
+  int _hardwarePixelFormat = -1;
+  SwsContext *_scaler = nullptr;
+  AVFrame *_frame = nullptr;
+  AVFrame *_softwareFrame = nullptr;
+  AVPacket *_packet = nullptr;
+  int _streamIndex = -1;
+  bool _flushingDecoder = false;
+  int _outputWidth = 0;
+  int _outputHeight = 0;
+
+  // Decoding thread only.
+  int64_t _framePtsMs = 0;
+  int64_t _frameDurationMs = 40;
+  // Frames before this after a seek are decoded but not shown.
+  int64_t _skipUntilMs = -1;
+  // Own clock: |_clockStartPtsMs| is due at |_clockStartUs|.
+  bool _hasClock = false;
+  int64_t _clockStartUs = 0;
+  int64_t _clockStartPtsMs = 0;
+
+  std::atomic<int64_t> _seekRequestMs{-1};
+  std::atomic<int64_t> _positionMs{0};
+  std::atomic<bool> _finished{false};
+  std::atomic<uint64_t> _sentFrames{0};
+  std::atomic<uint64_t> _droppedFrames{0};
+  std::atomic<bool> _stopped{false};
+
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
@@ -0,0 +1,160 @@
+#include "FrameAudioDeviceDescriptor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <modules/audio_device/include/audio_device.h>
+
+#include "AudioPump.h"
+
+namespace {
+
+class FrameAudioRenderer final : public tgcalls::FakeAudioDeviceModule::Renderer {
+public:
+  explicit FrameAudioRenderer(std::shared_ptr<FrameAudioDeviceDescriptor> descriptor)
+      : _descriptor(std::move(descriptor)) {}
+
+  bool Render(const tgcalls::AudioFrame &frame) override {
+    if (_descriptor->_isRecordingPaused) {
+      return true;
+    }
+    // Dropped whole rather than truncated, so the channels stay in phase.
+    const size_t length = frame.num_samples * frame.bytes_per_sample;
+    if (_descriptor->_recordedRing.WriteAvailable() < length) {
+      _descriptor->_overruns++;
+      return true;
+    }
+    _descriptor->_recordedRing.Write(reinterpret_cast<const uint8_t *>(frame.audio_samples), length);
+    return true;
+  }
+
+  void AddFrameChannel(uint32_t ssrc, const tgcalls::AudioFrame &frame) override {
+    if (_descriptor->_participants) {
+      _descriptor->_participants->OnFrame(ssrc, frame);
+    }
+  }
+
+private:
+  std::shared_ptr<FrameAudioDeviceDescriptor> _descriptor;
+};
+
+class FrameAudioRecorder final : public tgcalls::FakeAudioDeviceModule::Recorder {
+public:
+  explicit FrameAudioRecorder(std::shared_ptr<FrameAudioDeviceDescriptor> descriptor)
+      : _descriptor(std::move(descriptor)),
+        _format(_descriptor->_format),
+        _samples(_format.FramesPer10Ms() * _format.channels) {}
+
+  tgcalls::AudioFrame Record() override {
+    tgcalls::AudioFrame frame{};
+    frame.audio_samples = _samples.data();
+    frame.bytes_per_sample = sizeof(int16_t) * _format.channels;
+    frame.num_channels = _format.channels;
+    frame.samples_per_sec = _format.sampleRate;
+    if (_descriptor->_isPlayoutPaused) {
+      return frame;
+    }
+
+    auto *data = reinterpret_cast<uint8_t *>(_samples.data());
+    const size_t length = _format.BytesPer10Ms();
+    const size_t read = _descriptor->_playedRing.Read(data, length);
+    if (read < length) {
+      _descriptor->_underruns++;
+      if (read == 0) {
+        return frame;
+      }
+      memset(data + read, 0, length - read);
+    }
+    frame.num_samples = _format.FramesPer10Ms();
+    return frame;
+  }
+
+private:
+  std::shared_ptr<FrameAudioDeviceDescriptor> _descriptor;
+  AudioFormat _format;
+  std::vector<int16_t> _samples;
+};
+
+}  // namespace
+
+FrameAudioDeviceDescriptor::FrameAudioDeviceDescriptor(size_t capacity)
+    : _playedRing(capacity),
+      _recordedRing(capacity) {}
+
+int FrameAudioDeviceDescriptor::CheckedSampleRate(int sampleRate) {
+  if (sampleRate == 24000) {
+    throw std::invalid_argument("sample rate must be 8000, 16000, 32000 or 48000");
+  }
+  return AudioFormat::CheckedSampleRate(sampleRate);
+}
+
+size_t FrameAudioDeviceDescriptor::_push(const uint8_t *data, size_t length) {
+  // Truncate to whole sample frames so the channels never get out of phase.
+  length -= length % (_format.channels * sizeof(int16_t));
+  size_t written = _playedRing.Write(data, length);
+  if (written < length) {
+    _overruns++;
+  }
+  return written;
+}
+
+size_t FrameAudioDeviceDescriptor::push(const py::bytes &frame) {
+  char *data = nullptr;
+  py::ssize_t length = 0;
+  PyBytes_AsStringAndSize(frame.ptr(), &data, &length);
+  return _push(reinterpret_cast<const uint8_t *>(data), static_cast<size_t>(length));
+}
+
+size_t FrameAudioDeviceDescriptor::pushBuffer(const py::buffer &buffer) {
+  PcmInput input(buffer);
+  return _push(input.data(), input.size());
+}
+
+py::bytes FrameAudioDeviceDescriptor::pop(size_t length) {
+  // Python is the ring's only consumer, so nothing else consumes between
+  // sizing the bytes object and filling it.
+  length = std::min(length, _recordedRing.ReadAvailable());
+  auto frame = py::reinterpret_steal<py::bytes>(
+      PyBytes_FromStringAndSize(nullptr, static_cast<py::ssize_t>(length)));
+  if (!frame) {
+    throw py::error_already_set();
+  }
+  _recordedRing.Read(reinterpret_cast<uint8_t *>(PyBytes_AS_STRING(frame.ptr())), length);
+  return frame;
+}
+
+std::shared_ptr<AudioBlock> FrameAudioDeviceDescriptor::popBlock(size_t frames, bool asFloat) {
+  return AudioBlock::Read(_recordedRing, _format.channels, frames, asFloat);
+}
+
+size_t FrameAudioDeviceDescriptor::popInto(const py::buffer &buffer) {
+  py::buffer_info info = buffer.request(true);
+  if (info.ndim != 1 || info.strides[0] != info.itemsize) {
+    throw std::invalid_argument("popInto requires a contiguous one-dimensional buffer");
+  }
+  return _recordedRing.Read(static_cast<uint8_t *>(info.ptr), static_cast<size_t>(info.size * info.itemsize));
+}
+
+std::shared_ptr<tgcalls::FakeAudioDeviceModule::Renderer> FrameAudioDeviceDescriptor::CreateRenderer(
+    std::shared_ptr<FrameAudioDeviceDescriptor> descriptor) {
+  return std::make_shared<FrameAudioRenderer>(std::move(descriptor));
+}
+
+rtc::scoped_refptr<webrtc::AudioDeviceModule> FrameAudioDeviceDescriptor::CreateAudioDeviceModule(
+    std::shared_ptr<FrameAudioDeviceDescriptor> descriptor,
+    std::shared_ptr<tgcalls::FakeAudioDeviceModule::Renderer> renderer,
+    webrtc::TaskQueueFactory *taskQueueFactory) {
+  tgcalls::FakeAudioDeviceModule::Options options;
+  options.samples_per_sec = descriptor->_format.sampleRate;
+  options.num_channels = descriptor->_format.channels;
+  // The module stops both tasks before the scheduler goes.
+  auto tasks = std::make_shared<AudioPumpTasks>(&descriptor->_clockStats);
+  options.scheduler_ = [tasks, descriptor](tgcalls::FakeAudioDeviceModule::Task task) {
+    tasks->Schedule(std::move(task));
+  };
+  auto recorder = std::make_shared<FrameAudioRecorder>(std::move(descriptor));
+  return tgcalls::FakeAudioDeviceModule::Creator(std::move(renderer), std::move(recorder), std::move(options))(
+      taskQueueFactory);
+}
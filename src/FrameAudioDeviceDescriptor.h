@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include <pybind11/pybind11.h>
+
+#include <api/scoped_refptr.h>
+#include <tgcalls/FakeAudioDeviceModule.h>
+
+#include "AudioBlock.h"
+#include "AudioDeadlineClock.h"
+#include "AudioFormat.h"
+#include "IncomingAudioTap.h"
+#include "SpscRingBuffer.h"
+
+namespace py = pybind11;
+
+namespace webrtc {
+class AudioDeviceModule;
+class TaskQueueFactory;
+}  // namespace webrtc
+
+// Raw s16le PCM exchanged through rings like RingAudioDeviceDescriptor, on
+// the lighter tgcalls::FakeAudioDeviceModule rather than AudioDeviceModuleImpl
+// and its AudioDeviceBuffer: the call's mix is written to the ring as webrtc
+// hands it over, and frames are sent from the ring as they are, with no
+// intermediate buffers. Always ticked by the shared audio pump.
+//
+// With |_participants| set, the decoded frame of every participant in the
+// mix also goes to it, through the renderer's AddFrameChannel(), as the
+// frame is mixed; subscribe the SSRCs of interest there.
+class FrameAudioDeviceDescriptor {
+public:
+    // Two seconds of 48 kHz stereo s16le in each direction.
+    static constexpr size_t kDefaultCapacity = 48000 * 2 * 2 * 2;
+
+    explicit FrameAudioDeviceDescriptor(size_t capacity = kDefaultCapacity);
+
+    // Of the frames in both directions; 48 kHz stereo unless set otherwise
+    // before the call starts. FakeAudioDeviceModule has no 24 kHz.
+    AudioFormat _format;
+
+    // Audio pushed by Python and played into the call.
+    SpscRingBuffer _playedRing;
+    // The call's mix, waiting to be popped by Python.
+    SpscRingBuffer _recordedRing;
+    std::shared_ptr<IncomingAudioTap> _participants;
+
+    std::atomic<bool> _isPlayoutPaused{false};
+    std::atomic<bool> _isRecordingPaused{false};
+
+    // 10 ms frames that were short because |_playedRing| ran dry; nothing
+    // is sent for those it had no audio for at all.
+    std::atomic<uint64_t> _underruns{0};
+    // Pushes or frames that were truncated because the target ring was full.
+    std::atomic<uint64_t> _overruns{0};
+
+    AudioClockStats _clockStats;
+
+    static int CheckedSampleRate(int sampleRate);
+
+    size_t push(const py::bytes &);
+    size_t pushBuffer(const py::buffer &);
+    py::bytes pop(size_t);
+    size_t popInto(const py::buffer &);
+    // Up to |frames| whole frames of playout, as int16 or float32.
+    std::shared_ptr<AudioBlock> popBlock(size_t frames, bool asFloat);
+
+    // The device's renderer, to be handed the participants' frames as well,
+    // and the module playing through it.
+    static std::shared_ptr<tgcalls::FakeAudioDeviceModule::Renderer> CreateRenderer(
+        std::shared_ptr<FrameAudioDeviceDescriptor>);
+    static rtc::scoped_refptr<webrtc::AudioDeviceModule> CreateAudioDeviceModule(
+        std::shared_ptr<FrameAudioDeviceDescriptor>,
+        std::shared_ptr<tgcalls::FakeAudioDeviceModule::Renderer>,
+        webrtc::TaskQueueFactory *);
+
+private:
+    size_t _push(const uint8_t *, size_t);
+};
@@ -0,0 +1,70 @@
+#include "GroupCallReaper.h"
+
+#include <rtc_base/platform_thread.h>
+
+GroupCallReaper &GroupCallReaper::Get() {
+  static GroupCallReaper reaper;
+  return reaper;
+}
+
+GroupCallReaper::GroupCallReaper()
+    : _thread(new rtc::PlatformThread(ThreadFunc, this, "tgcalls_call_reaper", rtc::kNormalPriority)) {
+  _thread->Start();
+}
+
+GroupCallReaper::~GroupCallReaper() {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  _thread->Stop();
+}
+
+std::shared_future<void> GroupCallReaper::Reap(std::unique_ptr<tgcalls::GroupInstanceCustomImpl> instance,
+                                               std::function<void()> done) {
+  Job job;
+  job.instance = std::move(instance);
+  job.done = std::move(done);
+  auto future = job.destroyed.get_future().share();
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  _jobs.push_back(std::move(job));
+  _pending++;
+  _wakeUp.notify_one();
+  return future;
+}
+
+size_t GroupCallReaper::pending() const {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _pending;
+}
+
+void GroupCallReaper::ThreadFunc(void *pThis) {
+  static_cast<GroupCallReaper *>(pThis)->Run();
+}
+
+void GroupCallReaper::Run() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wakeUp.wait(lock, [this] { return _stopped || !_jobs.empty(); });
+      // Queued calls are still destroyed when stopping.
+      if (_jobs.empty()) {
+        return;
+      }
+      job = std::move(_jobs.front());
+      _jobs.pop_front();
+    }
+
+    job.instance = nullptr;
+    if (job.done) {
+      job.done();
+    }
+    job.destroyed.set_value();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _pending--;
+  }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+
+#include <tgcalls/group/GroupInstanceCustomImpl.h>
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+// Destroys group calls on a thread of its own, so ending one doesn't block
+// the caller: tearing a call down waits for its channels to be destroyed on
+// the worker thread, for the audio device threads to join and for DTLS to
+// close. Calls are destroyed one after another, in the order given.
+class GroupCallReaper {
+public:
+  // Shared by every NativeInstance in the process.
+  static GroupCallReaper &Get();
+
+  GroupCallReaper();
+  // Destroys what is still queued.
+  ~GroupCallReaper();
+
+  // Queues |instance| for destruction; |done|, if any, is called on the
+  // reaper thread once it is destroyed. The future is ready then as well.
+  std::shared_future<void> Reap(std::unique_ptr<tgcalls::GroupInstanceCustomImpl> instance,
+                                std::function<void()> done = nullptr);
+
+  // Calls queued or being destroyed.
+  size_t pending() const;
+
+private:
+  struct Job {
+    std::unique_ptr<tgcalls::GroupInstanceCustomImpl> instance;
+    std::function<void()> done;
+    std::promise<void> destroyed;
+  };
+
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  mutable std::mutex _mutex;
+  std::condition_variable _wakeUp;
+  std::deque<Job> _jobs;
+  size_t _pending = 0;
+  bool _stopped = false;
+
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
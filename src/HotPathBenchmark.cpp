@@ -0,0 +1,260 @@
+#include "HotPathBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+
+#include <absl/container/flat_hash_map.h>
+#include <api/rtp_headers.h>
+#include <modules/rtp_rtcp/source/rtp_packet.h>
+#include <modules/rtp_rtcp/source/rtp_utility.h>
+#include <rtc_base/copy_on_write_buffer.h>
+#include <rtc_base/event.h>
+#include <rtc_base/thread.h>
+
+#include <tgcalls/AudioDsp.h>
+#include <tgcalls/ThreadLocalObject.h>
+#include <tgcalls/group/MissingSsrcPacketBuffer.h>
+#include <tgcalls/group/StreamingPart.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Samples of a 10 ms frame at 48 kHz, as packetized and metered per SSRC.
+constexpr int kFrameSamples = 480;
+// Packets kept for unknown SSRCs by GroupInstanceCustomImpl.
+constexpr int kMissingPacketLimit = 50;
+// Tasks posted before waiting for the media thread to catch up, so the
+// queue doesn't grow without bound.
+constexpr int kPerformBatch = 1024;
+
+// Keeps the measured work from being optimized away.
+volatile size_t sink = 0;
+
+HotPathBenchmarkResult MakeResult(std::string name, uint64_t operations, Clock::duration duration) {
+  HotPathBenchmarkResult result;
+  result.name = std::move(name);
+  result.operations = operations;
+  const auto seconds = std::chrono::duration<double>(duration).count();
+  if (seconds > 0.0 && operations > 0) {
+    result.operationsPerSecond = operations / seconds;
+    result.nanosecondsPerOperation = seconds * 1e9 / operations;
+  }
+  return result;
+}
+
+std::vector<uint32_t> MakeSsrcs(int count, std::mt19937 &random) {
+  std::vector<uint32_t> ssrcs(count);
+  for (auto &ssrc : ssrcs) {
+    ssrc = static_cast<uint32_t>(random());
+  }
+  return ssrcs;
+}
+
+rtc::CopyOnWriteBuffer MakeOpusPacket(uint32_t ssrc, uint16_t sequenceNumber) {
+  webrtc::RtpPacket packet(nullptr, 12 + 80);
+  packet.SetPayloadType(111);
+  packet.SetSequenceNumber(sequenceNumber);
+  packet.SetTimestamp(sequenceNumber * kFrameSamples);
+  packet.SetSsrc(ssrc);
+  uint8_t *payload = packet.SetPayloadSize(80);
+  std::fill(payload, payload + 80, static_cast<uint8_t>(sequenceNumber));
+  return packet.Buffer();
+}
+
+// What commitBroadcastPackets() does for each channel of a decoded 10 ms
+// frame: an L16 RTP packet with the samples in network order.
+HotPathBenchmarkResult BenchmarkBroadcastPacketize(int iterations, const std::vector<uint32_t> &ssrcs, const std::vector<int16_t> &pcm) {
+  const int channels = std::min(static_cast<int>(ssrcs.size()), 16);
+  std::vector<rtc::CopyOnWriteBuffer> packets;
+  packets.reserve(channels);
+
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    packets.clear();
+    for (int channel = 0; channel < channels; channel++) {
+      webrtc::RtpPacket packet(nullptr, 12 + kFrameSamples * 2);
+      packet.SetMarker(false);
+      packet.SetPayloadType(112);
+      packet.SetSequenceNumber(static_cast<uint16_t>(i));
+      packet.SetTimestamp(i * kFrameSamples);
+      packet.SetSsrc(ssrcs[channel]);
+      uint8_t *payload = packet.SetPayloadSize(kFrameSamples * 2);
+      tgcalls::AudioByteSwapS16(pcm.data(), kFrameSamples, payload);
+      packets.push_back(packet.Buffer());
+    }
+    sink = sink + packets.size();
+  }
+  return MakeResult("broadcastPacketize", static_cast<uint64_t>(iterations) * channels, Clock::now() - start);
+}
+
+// The RTP header parse and channel lookup receivePacket() does for every
+// incoming packet.
+HotPathBenchmarkResult BenchmarkReceiveSsrcLookup(int iterations, const std::vector<uint32_t> &ssrcs) {
+  absl::flat_hash_map<uint32_t, int> channelBySsrc;
+  std::vector<rtc::CopyOnWriteBuffer> packets;
+  packets.reserve(ssrcs.size());
+  for (size_t i = 0; i < ssrcs.size(); i++) {
+    channelBySsrc.emplace(ssrcs[i], static_cast<int>(i));
+    packets.push_back(MakeOpusPacket(ssrcs[i], static_cast<uint16_t>(i)));
+  }
+
+  uint64_t operations = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    for (const auto &packet : packets) {
+      webrtc::RtpUtility::RtpHeaderParser parser(packet.data(), packet.size());
+      webrtc::RTPHeader header;
+      if (parser.RTCP() || !parser.Parse(&header)) {
+        continue;
+      }
+      auto it = channelBySsrc.find(header.ssrc);
+      if (it != channelBySsrc.end()) {
+        sink = sink + it->second;
+      }
+    }
+    operations += packets.size();
+  }
+  return MakeResult("receiveSsrcLookup", operations, Clock::now() - start);
+}
+
+// Packets of every SSRC buffered as unknown, then taken out again as the
+// SSRCs are resolved. Operations are one add() or one delivered packet.
+HotPathBenchmarkResult BenchmarkMissingSsrcBuffer(int iterations, const std::vector<uint32_t> &ssrcs) {
+  std::vector<rtc::CopyOnWriteBuffer> packets;
+  packets.reserve(ssrcs.size());
+  for (size_t i = 0; i < ssrcs.size(); i++) {
+    packets.push_back(MakeOpusPacket(ssrcs[i], static_cast<uint16_t>(i)));
+  }
+
+  tgcalls::MissingSsrcPacketBuffer buffer(kMissingPacketLimit);
+  uint64_t operations = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    for (size_t j = 0; j < ssrcs.size(); j++) {
+      buffer.add(ssrcs[j], packets[j]);
+    }
+    operations += ssrcs.size();
+    for (const auto ssrc : ssrcs) {
+      operations += buffer.get(ssrc).size();
+    }
+  }
+  return MakeResult("missingSsrcBuffer", operations, Clock::now() - start);
+}
+
+// The per-SSRC peak incoming audio levels are metered from, for every
+// 10 ms frame.
+HotPathBenchmarkResult BenchmarkLevelMetering(int iterations, const std::vector<uint32_t> &ssrcs, const std::vector<int16_t> &pcm) {
+  const auto frames = static_cast<int>(pcm.size() / kFrameSamples);
+  uint64_t operations = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < iterations; i++) {
+    int16_t peak = 0;
+    for (size_t j = 0; j < ssrcs.size(); j++) {
+      const int16_t *samples = pcm.data() + ((i + j) % frames) * kFrameSamples;
+      peak = std::max(peak, tgcalls::AudioAbsPeak(samples, kFrameSamples));
+    }
+    sink = sink + peak;
+    operations += ssrcs.size();
+  }
+  return MakeResult("levelMetering", operations, Clock::now() - start);
+}
+
+// Tasks posted to an object living on another thread, the way calls
+// reach their media thread state. Includes the time the thread takes to
+// run them.
+HotPathBenchmarkResult BenchmarkThreadLocalPerform(int iterations) {
+  struct Counter {
+    uint64_t value = 0;
+  };
+
+  auto thread = rtc::Thread::Create();
+  thread->SetName("HotPathBenchmark", nullptr);
+  thread->Start();
+
+  uint64_t operations = 0;
+  Clock::duration duration{0};
+  {
+    tgcalls::ThreadLocalObject<Counter> object(thread.get(), [] {
+      return new Counter();
+    });
+    rtc::Event ready;
+    object.perform(RTC_FROM_HERE, [&ready](Counter *) {
+      ready.Set();
+    });
+    ready.Wait(rtc::Event::kForever);
+
+    auto start = Clock::now();
+    int done = 0;
+    while (done < iterations) {
+      const int count = std::min(kPerformBatch, iterations - done);
+      for (int i = 0; i < count; i++) {
+        object.perform(RTC_FROM_HERE, [](Counter *counter) {
+          counter->value++;
+        });
+      }
+      rtc::Event drained;
+      object.perform(RTC_FROM_HERE, [&drained](Counter *) {
+        drained.Set();
+      });
+      drained.Wait(rtc::Event::kForever);
+      done += count;
+    }
+    duration = Clock::now() - start;
+    operations = static_cast<uint64_t>(done);
+  }
+  thread->Stop();
+  return MakeResult("threadLocalPerform", operations, duration);
+}
+
+} // namespace
+
+std::vector<HotPathBenchmarkResult> RunHotPathBenchmark(int iterations, int ssrcs) {
+  iterations = std::max(1, iterations);
+  ssrcs = std::max(1, std::min(ssrcs, 100000));
+
+  std::mt19937 random(std::random_device{}());
+  const auto ssrcList = MakeSsrcs(ssrcs, random);
+  // A second of speech-like noise to packetize and meter.
+  std::vector<int16_t> pcm(kFrameSamples * 100);
+  std::normal_distribution<float> noise(0.0f, 3000.0f);
+  for (auto &sample : pcm) {
+    sample = static_cast<int16_t>(std::max(-32768.0f, std::min(32767.0f, noise(random))));
+  }
+
+  // Per-SSRC cases loop over every SSRC each iteration, so they get fewer
+  // iterations to stay comparable in run time.
+  const int perSsrcIterations = std::max(1, iterations / ssrcs);
+
+  std::vector<HotPathBenchmarkResult> results;
+  results.push_back(BenchmarkBroadcastPacketize(iterations, ssrcList, pcm));
+  results.push_back(BenchmarkReceiveSsrcLookup(perSsrcIterations, ssrcList));
+  results.push_back(BenchmarkMissingSsrcBuffer(perSsrcIterations, ssrcList));
+  results.push_back(BenchmarkLevelMetering(perSsrcIterations, ssrcList, pcm));
+  results.push_back(BenchmarkThreadLocalPerform(iterations));
+  return results;
+}
+
+HotPathBenchmarkResult RunStreamingPartBenchmark(std::vector<uint8_t> part, int repetitions) {
+  repetitions = std::max(1, repetitions);
+
+  std::vector<int16_t> planes;
+  uint64_t frames = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < repetitions; i++) {
+    auto data = part;
+    tgcalls::StreamingPart streamingPart(std::move(data));
+    const auto channels = streamingPart.getSsrcs().size();
+    if (channels == 0) {
+      break;
+    }
+    planes.resize(channels * tgcalls::StreamingPart::kSamplesPer10ms);
+    while (streamingPart.read10msPerChannel(planes.data()) > 0) {
+      frames++;
+    }
+    sink = sink + planes[0];
+  }
+  return MakeResult("streamingPartDecode", frames, Clock::now() - start);
+}
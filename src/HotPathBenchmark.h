@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Measures, on the calling thread, the per-packet and per-frame work of
+// group calls that the other benchmarks don't cover: broadcast L16
+// packetization, the RTP parse and SSRC lookup every incoming packet goes
+// through, the buffer for packets of unknown SSRCs, level metering, and
+// media thread task posting.
+struct HotPathBenchmarkResult {
+  std::string name;
+  uint64_t operations = 0;
+  // On one core.
+  double operationsPerSecond = 0.0;
+  double nanosecondsPerOperation = 0.0;
+};
+
+// Runs each case |iterations| times, with |ssrcs| distinct SSRCs where
+// packets are looked up or buffered by SSRC.
+std::vector<HotPathBenchmarkResult> RunHotPathBenchmark(int iterations, int ssrcs);
+
+// Decodes the broadcast part |part|, as received from a
+// requestBroadcastPart callback, |repetitions| times. Operations are 10 ms
+// frames of every channel, so operationsPerSecond / 100 is how many seconds
+// of the part decode per second.
+HotPathBenchmarkResult RunStreamingPartBenchmark(std::vector<uint8_t> part, int repetitions);
@@ -0,0 +1,215 @@
+#include "IncomingAudioTap.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <tgcalls/HotPathCounters.h>
+
+IncomingAudioTap::IncomingAudioTap(size_t capacity)
+    : _capacity(capacity),
+      _participants(std::make_shared<const Participants>()) {}
+
+TappedAudioFrame::TappedAudioFrame(uint32_t ssrc, std::shared_ptr<AudioFrameSlab> slab, int64_t index)
+    : _ssrc(ssrc), _slab(std::move(slab)), _index(index) {}
+
+TappedAudioFrame::~TappedAudioFrame() {
+  release();
+}
+
+const AudioFrameSlab::Slot &TappedAudioFrame::slot() const {
+  if (!_slab) {
+    throw std::runtime_error("the frame was released");
+  }
+  return _slab->slot(_index);
+}
+
+int TappedAudioFrame::sampleRate() const {
+  return slot().sampleRate;
+}
+
+size_t TappedAudioFrame::channels() const {
+  return slot().channels;
+}
+
+size_t TappedAudioFrame::samplesPerChannel() const {
+  return slot().samplesPerChannel;
+}
+
+int64_t TappedAudioFrame::elapsedTimeMs() const {
+  return slot().elapsedTimeMs;
+}
+
+py::buffer_info TappedAudioFrame::buffer() const {
+  const auto &frame = slot();
+  return py::buffer_info(
+      const_cast<int16_t *>(frame.samples), sizeof(int16_t), py::format_descriptor<int16_t>::format(), 1,
+      {static_cast<py::ssize_t>(frame.samplesPerChannel * frame.channels)},
+      {static_cast<py::ssize_t>(sizeof(int16_t))}, true);
+}
+
+std::shared_ptr<AudioBlock> TappedAudioFrame::toFloat() const {
+  const auto &frame = slot();
+  return AudioBlock::FromSamples(frame.samples, frame.channels, frame.samplesPerChannel, true);
+}
+
+void TappedAudioFrame::release() {
+  if (_slab) {
+    _slab->Release(_index);
+    _slab.reset();
+  }
+}
+
+void IncomingAudioTap::add(uint32_t ssrc, std::shared_ptr<Participant> participant) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto current = std::atomic_load(&_participants);
+  if (current->count(ssrc)) {
+    return;
+  }
+  auto updated = std::make_shared<Participants>(*current);
+  updated->emplace(ssrc, std::move(participant));
+  std::atomic_store(&_participants, std::shared_ptr<const Participants>(std::move(updated)));
+}
+
+void IncomingAudioTap::subscribe(uint32_t ssrc) {
+  auto participant = std::make_shared<Participant>();
+  participant->ring = std::make_unique<SpscRingBuffer>(_capacity);
+  add(ssrc, std::move(participant));
+}
+
+void IncomingAudioTap::subscribeFrames(uint32_t ssrc, size_t slots) {
+  auto participant = std::make_shared<Participant>();
+  participant->slab = std::make_shared<AudioFrameSlab>(slots);
+  add(ssrc, std::move(participant));
+}
+
+void IncomingAudioTap::unsubscribe(uint32_t ssrc) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto current = std::atomic_load(&_participants);
+  if (!current->count(ssrc)) {
+    return;
+  }
+  auto updated = std::make_shared<Participants>(*current);
+  updated->erase(ssrc);
+  std::atomic_store(&_participants, std::shared_ptr<const Participants>(std::move(updated)));
+}
+
+std::vector<uint32_t> IncomingAudioTap::subscribed() const {
+  auto participants = std::atomic_load(&_participants);
+  std::vector<uint32_t> ssrcs;
+  ssrcs.reserve(participants->size());
+  for (const auto &it : *participants) {
+    ssrcs.push_back(it.first);
+  }
+  return ssrcs;
+}
+
+std::shared_ptr<IncomingAudioTap::Participant> IncomingAudioTap::find(uint32_t ssrc) const {
+  auto participants = std::atomic_load(&_participants);
+  auto it = participants->find(ssrc);
+  return it == participants->end() ? nullptr : it->second;
+}
+
+std::shared_ptr<TappedAudioFrame> IncomingAudioTap::acquireFrame(uint32_t ssrc) {
+  auto participant = find(ssrc);
+  if (!participant || !participant->slab) {
+    return nullptr;
+  }
+  // Serialized by the GIL, like releases, so the slab has one consumer.
+  const int64_t index = participant->slab->Acquire();
+  if (index < 0) {
+    return nullptr;
+  }
+  return std::make_shared<TappedAudioFrame>(ssrc, participant->slab, index);
+}
+
+size_t IncomingAudioTap::framesAvailable(uint32_t ssrc) const {
+  auto participant = find(ssrc);
+  return participant && participant->slab ? participant->slab->ReadAvailable() : 0;
+}
+
+py::bytes IncomingAudioTap::pop(uint32_t ssrc, size_t length) {
+  auto participant = find(ssrc);
+  if (!participant || !participant->ring) {
+    return py::bytes();
+  }
+  // Python is the ring's only consumer, so nothing else consumes between
+  // sizing the bytes object and filling it.
+  length = std::min(length, participant->ring->ReadAvailable());
+  auto frame = py::reinterpret_steal<py::bytes>(
+      PyBytes_FromStringAndSize(nullptr, static_cast<py::ssize_t>(length)));
+  if (!frame) {
+    throw py::error_already_set();
+  }
+  participant->ring->Read(reinterpret_cast<uint8_t *>(PyBytes_AS_STRING(frame.ptr())), length);
+  return frame;
+}
+
+size_t IncomingAudioTap::popInto(uint32_t ssrc, const py::buffer &buffer) {
+  py::buffer_info info = buffer.request(true);
+  if (info.ndim != 1 || info.strides[0] != info.itemsize) {
+    throw std::invalid_argument("popInto requires a contiguous one-dimensional buffer");
+  }
+  auto participant = find(ssrc);
+  if (!participant || !participant->ring) {
+    return 0;
+  }
+  return participant->ring->Read(static_cast<uint8_t *>(info.ptr), static_cast<size_t>(info.size * info.itemsize));
+}
+
+std::shared_ptr<AudioBlock> IncomingAudioTap::popBlock(uint32_t ssrc, size_t frames, bool asFloat) {
+  auto participant = find(ssrc);
+  const size_t channels = participant ? participant->channels.load() : 0;
+  if (!participant || !participant->ring || channels == 0) {
+    return std::make_shared<AudioBlock>(std::max(channels, size_t(1)), 0, asFloat);
+  }
+  return AudioBlock::Read(*participant->ring, channels, frames, asFloat);
+}
+
+size_t IncomingAudioTap::available(uint32_t ssrc) const {
+  auto participant = find(ssrc);
+  return participant && participant->ring ? participant->ring->ReadAvailable() : 0;
+}
+
+int IncomingAudioTap::sampleRate(uint32_t ssrc) const {
+  auto participant = find(ssrc);
+  return participant ? participant->sampleRate.load() : 0;
+}
+
+size_t IncomingAudioTap::channels(uint32_t ssrc) const {
+  auto participant = find(ssrc);
+  return participant ? participant->channels.load() : 0;
+}
+
+uint64_t IncomingAudioTap::overruns(uint32_t ssrc) const {
+  auto participant = find(ssrc);
+  return participant ? participant->overruns.load() : 0;
+}
+
+void IncomingAudioTap::OnFrame(uint32_t ssrc, const tgcalls::AudioFrame &frame) {
+  auto participant = find(ssrc);
+  if (!participant || frame.bytes_per_sample != 2 || !frame.audio_samples) {
+    return;
+  }
+  participant->sampleRate.store(static_cast<int>(frame.samples_per_sec), std::memory_order_relaxed);
+  participant->channels.store(frame.num_channels, std::memory_order_relaxed);
+
+  if (participant->slab) {
+    if (!participant->slab->Write(frame)) {
+      participant->overruns++;
+      tgcalls::HotPathCounters::onFrameDropped(tgcalls::HotPathCounters::FrameKind::IncomingAudio);
+      return;
+    }
+    tgcalls::HotPathCounters::onFrameDelivered(tgcalls::HotPathCounters::FrameKind::IncomingAudio);
+    return;
+  }
+
+  // Only whole frames go in, so the channels never get out of phase.
+  size_t length = frame.num_samples * frame.num_channels * sizeof(int16_t);
+  if (participant->ring->WriteAvailable() < length) {
+    participant->overruns++;
+    tgcalls::HotPathCounters::onFrameDropped(tgcalls::HotPathCounters::FrameKind::IncomingAudio);
+    return;
+  }
+  participant->ring->Write(reinterpret_cast<const uint8_t *>(frame.audio_samples), length);
+  tgcalls::HotPathCounters::onFrameDelivered(tgcalls::HotPathCounters::FrameKind::IncomingAudio);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+
+#include <tgcalls/AudioFrame.h>
+
+#include "AudioBlock.h"
+#include "AudioFrameSlab.h"
+#include "SpscRingBuffer.h"
+
+namespace py = pybind11;
+
+// A 10 ms frame of a participant subscribed with subscribeFrames(), read in
+// place from its slot: memoryview(frame) is a view of int16 samples, not a
+// copy. The slot is reused once the frame is released, or garbage
+// collected, so no view may outlive that.
+class TappedAudioFrame {
+public:
+  TappedAudioFrame(uint32_t ssrc, std::shared_ptr<AudioFrameSlab> slab, int64_t index);
+  ~TappedAudioFrame();
+
+  TappedAudioFrame(const TappedAudioFrame &) = delete;
+  TappedAudioFrame &operator=(const TappedAudioFrame &) = delete;
+
+  uint32_t ssrc() const { return _ssrc; }
+  int sampleRate() const;
+  size_t channels() const;
+  size_t samplesPerChannel() const;
+  int64_t elapsedTimeMs() const;
+
+  // Interleaved samples; throws once released.
+  py::buffer_info buffer() const;
+  // A float32 copy shaped (samplesPerChannel, channels), converted natively.
+  std::shared_ptr<AudioBlock> toFloat() const;
+  void release();
+  bool released() const { return !_slab; }
+
+private:
+  const AudioFrameSlab::Slot &slot() const;
+
+  uint32_t _ssrc;
+  std::shared_ptr<AudioFrameSlab> _slab;
+  int64_t _index;
+};
+
+// Decoded audio of individual participants, before it is mixed for playout.
+//
+// Python subscribes to the SSRCs it cares about; the webrtc audio thread
+// appends each of their 10 ms frames to a per-participant ring, and Python
+// pops whatever has accumulated whenever convenient. Frames of other SSRCs
+// are dropped after a single lookup, and no frame ever takes the GIL.
+//
+// Subscribed with subscribeFrames() instead, a participant's frames go to a
+// ring of preallocated frame slots, which Python acquires one frame at a
+// time, reads in place and releases, with no allocation or copy per frame.
+class IncomingAudioTap {
+public:
+    // Two seconds of 48 kHz stereo s16le per participant.
+    static constexpr size_t kDefaultCapacity = 48000 * 2 * 2 * 2;
+    // Two seconds of 10 ms frames.
+    static constexpr size_t kDefaultFrameSlots = 200;
+
+    explicit IncomingAudioTap(size_t capacity = kDefaultCapacity);
+
+    void subscribe(uint32_t ssrc);
+    void subscribeFrames(uint32_t ssrc, size_t slots = kDefaultFrameSlots);
+    void unsubscribe(uint32_t ssrc);
+    std::vector<uint32_t> subscribed() const;
+
+    // The oldest frame of |ssrc| not acquired yet; null if there is none, or
+    // if |ssrc| isn't subscribed with frames.
+    std::shared_ptr<TappedAudioFrame> acquireFrame(uint32_t ssrc);
+    size_t framesAvailable(uint32_t ssrc) const;
+
+    // s16le interleaved PCM of |ssrc|, up to |length| bytes. Empty for an
+    // SSRC that is not subscribed.
+    py::bytes pop(uint32_t ssrc, size_t length);
+    size_t popInto(uint32_t ssrc, const py::buffer &);
+    // Up to |frames| whole frames of |ssrc|, as int16 or float32. Empty for
+    // an SSRC that is not subscribed or hasn't received a frame yet.
+    std::shared_ptr<AudioBlock> popBlock(uint32_t ssrc, size_t frames, bool asFloat);
+    size_t available(uint32_t ssrc) const;
+
+    // Format of the last frame received from |ssrc|; 0 before the first one.
+    int sampleRate(uint32_t ssrc) const;
+    size_t channels(uint32_t ssrc) const;
+    // Frames dropped because the participant's ring, or every frame slot,
+    // was full.
+    uint64_t overruns(uint32_t ssrc) const;
+
+    // Called by the webrtc audio thread for every decoded incoming frame.
+    void OnFrame(uint32_t ssrc, const tgcalls::AudioFrame &frame);
+
+private:
+    // Has either a ring or frame slots.
+    struct Participant {
+        std::unique_ptr<SpscRingBuffer> ring;
+        std::shared_ptr<AudioFrameSlab> slab;
+        std::atomic<int> sampleRate{0};
+        std::atomic<size_t> channels{0};
+        std::atomic<uint64_t> overruns{0};
+    };
+
+    using Participants = std::map<uint32_t, std::shared_ptr<Participant>>;
+
+    std::shared_ptr<Participant> find(uint32_t ssrc) const;
+    void add(uint32_t ssrc, std::shared_ptr<Participant> participant);
+
+    size_t _capacity;
+    // Serializes subscribe() and unsubscribe(); the map itself is replaced
+    // as a whole so the audio thread never waits on it.
+    std::mutex _mutex;
+    std::shared_ptr<const Participants> _participants;
+};
@@ -0,0 +1,218 @@
+#include "IncomingVideoSink.h"
+
+#include <algorithm>
+
+#include <rtc_base/time_utils.h>
+#include <tgcalls/HotPathCounters.h>
+
+IncomingVideoFrame::IncomingVideoFrame(rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer, int64_t timestampUs, int rotation)
+    : _buffer(std::move(buffer)), _timestampUs(timestampUs), _rotation(rotation) {}
+
+int IncomingVideoFrame::width() const {
+  return _buffer->width();
+}
+
+int IncomingVideoFrame::height() const {
+  return _buffer->height();
+}
+
+std::string IncomingVideoFrame::format() const {
+  return _buffer->type() == webrtc::VideoFrameBuffer::Type::kNV12 ? "NV12" : "I420";
+}
+
+size_t IncomingVideoFrame::planeCount() const {
+  return _buffer->type() == webrtc::VideoFrameBuffer::Type::kNV12 ? 2 : 3;
+}
+
+py::buffer_info IncomingVideoFrame::planeBuffer(size_t index) const {
+  if (index >= planeCount()) {
+    throw py::index_error("plane index out of range");
+  }
+
+  const uint8_t *data = nullptr;
+  int stride = 0;
+  int rows = 0;
+  int rowBytes = 0;
+  if (_buffer->type() == webrtc::VideoFrameBuffer::Type::kNV12) {
+    const auto nv12 = _buffer->GetNV12();
+    if (index == 0) {
+      data = nv12->DataY();
+      stride = nv12->StrideY();
+      rows = nv12->height();
+      rowBytes = nv12->width();
+    } else {
+      data = nv12->DataUV();
+      stride = nv12->StrideUV();
+      rows = nv12->ChromaHeight();
+      rowBytes = nv12->ChromaWidth() * 2;
+    }
+  } else {
+    const auto i420 = _buffer->GetI420();
+    if (index == 0) {
+      data = i420->DataY();
+      stride = i420->StrideY();
+      rows = i420->height();
+      rowBytes = i420->width();
+    } else {
+      data = index == 1 ? i420->DataU() : i420->DataV();
+      stride = index == 1 ? i420->StrideU() : i420->StrideV();
+      rows = i420->ChromaHeight();
+      rowBytes = i420->ChromaWidth();
+    }
+  }
+
+  return py::buffer_info(
+      const_cast<uint8_t *>(data), sizeof(uint8_t), py::format_descriptor<uint8_t>::format(), 2,
+      {static_cast<py::ssize_t>(rows), static_cast<py::ssize_t>(rowBytes)},
+      {static_cast<py::ssize_t>(stride), static_cast<py::ssize_t>(sizeof(uint8_t))}, true);
+}
+
+IncomingVideoPlane IncomingVideoFrame::plane(size_t index) const {
+  if (index >= planeCount()) {
+    throw py::index_error("plane index out of range");
+  }
+  IncomingVideoPlane plane;
+  plane.frame = shared_from_this();
+  plane.index = index;
+  return plane;
+}
+
+IncomingVideoSink::IncomingVideoSink(Callback callback, double maxFps, int maxWidth, int maxHeight)
+    : _callback(std::move(callback)),
+      _minFrameIntervalUs(maxFps > 0.0 ? static_cast<int64_t>(rtc::kNumMicrosecsPerSec / maxFps) : 0),
+      _maxWidth(std::max(0, maxWidth)),
+      _maxHeight(std::max(0, maxHeight)) {}
+
+void IncomingVideoSink::setDispatcher(std::shared_ptr<CallbackDispatcher> dispatcher) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _dispatcher = std::move(dispatcher);
+}
+
+uint64_t IncomingVideoSink::delivered() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _delivered;
+}
+
+uint64_t IncomingVideoSink::dropped() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _dropped;
+}
+
+void IncomingVideoSink::setMaxSize(int maxWidth, int maxHeight) {
+  _maxWidth.store(std::max(0, maxWidth), std::memory_order_relaxed);
+  _maxHeight.store(std::max(0, maxHeight), std::memory_order_relaxed);
+}
+
+rtc::VideoSinkWants IncomingVideoSink::wants() const {
+  int maxWidth = _maxWidth.load(std::memory_order_relaxed);
+  int maxHeight = _maxHeight.load(std::memory_order_relaxed);
+  rtc::VideoSinkWants wants;
+  if (maxWidth > 0 && maxHeight > 0) {
+    wants.max_pixel_count = maxWidth * maxHeight;
+  } else if (maxWidth > 0) {
+    wants.max_pixel_count = maxWidth * (maxWidth * 9 / 16);
+  } else if (maxHeight > 0) {
+    wants.max_pixel_count = (maxHeight * 16 / 9) * maxHeight;
+  }
+  return wants;
+}
+
+bool IncomingVideoSink::acceptFrame(int64_t timestampUs) {
+  if (_minFrameIntervalUs <= 0) {
+    return true;
+  }
+  // A quarter of an interval of slack, so that jitter doesn't drop frames
+  // of a stream that is already at the limit.
+  if (_nextFrameUs != 0 && timestampUs + _minFrameIntervalUs / 4 < _nextFrameUs) {
+    return false;
+  }
+  if (_nextFrameUs == 0 || timestampUs - _nextFrameUs > _minFrameIntervalUs) {
+    _nextFrameUs = timestampUs + _minFrameIntervalUs;
+  } else {
+    _nextFrameUs += _minFrameIntervalUs;
+  }
+  return true;
+}
+
+rtc::scoped_refptr<webrtc::VideoFrameBuffer> IncomingVideoSink::prepareBuffer(rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer) const {
+  int maxWidth = _maxWidth.load(std::memory_order_relaxed);
+  int maxHeight = _maxHeight.load(std::memory_order_relaxed);
+  if (buffer->type() == webrtc::VideoFrameBuffer::Type::kNative) {
+    // Frames of a hardware decoder come back as its NV12 without the
+    // conversion ToI420() would add.
+    webrtc::VideoFrameBuffer::Type nv12[] = {webrtc::VideoFrameBuffer::Type::kNV12};
+    if (auto mapped = buffer->GetMappedFrameBuffer(nv12)) {
+      buffer = std::move(mapped);
+    }
+  }
+  double scale = 1.0;
+  if (maxWidth > 0 && buffer->width() > maxWidth) {
+    scale = std::min(scale, static_cast<double>(maxWidth) / buffer->width());
+  }
+  if (maxHeight > 0 && buffer->height() > maxHeight) {
+    scale = std::min(scale, static_cast<double>(maxHeight) / buffer->height());
+  }
+  if (scale < 1.0) {
+    // Even dimensions keep the chroma planes exactly half size.
+    int width = std::max(2, static_cast<int>(buffer->width() * scale) & ~1);
+    int height = std::max(2, static_cast<int>(buffer->height() * scale) & ~1);
+    buffer = buffer->Scale(width, height);
+  }
+
+  switch (buffer->type()) {
+    case webrtc::VideoFrameBuffer::Type::kI420:
+    case webrtc::VideoFrameBuffer::Type::kNV12:
+      return buffer;
+    default:
+      return buffer->ToI420();
+  }
+}
+
+void IncomingVideoSink::OnFrame(const webrtc::VideoFrame &frame) {
+  int64_t timestampUs = frame.timestamp_us() != 0 ? frame.timestamp_us() : rtc::TimeMicros();
+  if (!acceptFrame(timestampUs)) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _dropped++;
+    return;
+  }
+
+  auto buffer = prepareBuffer(frame.video_frame_buffer());
+  if (!buffer) {
+    return;
+  }
+  auto pending = std::make_shared<IncomingVideoFrame>(std::move(buffer), timestampUs, static_cast<int>(frame.rotation()));
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (!_dispatcher) {
+    return;
+  }
+  if (_pending) {
+    _dropped++;
+    tgcalls::HotPathCounters::onFrameDropped(tgcalls::HotPathCounters::FrameKind::Video);
+  }
+  _pending = std::move(pending);
+  if (_isPosted) {
+    return;
+  }
+  _isPosted = true;
+  _dispatcher->Post([self = shared_from_this()] {
+    self->deliver();
+  });
+}
+
+void IncomingVideoSink::deliver() {
+  std::shared_ptr<IncomingVideoFrame> frame;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    frame = std::move(_pending);
+    _pending = nullptr;
+    _isPosted = false;
+    if (frame) {
+      _delivered++;
+      tgcalls::HotPathCounters::onFrameDelivered(tgcalls::HotPathCounters::FrameKind::Video);
+    }
+  }
+  if (frame) {
+    _callback(std::move(frame));
+  }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <pybind11/pybind11.h>
+
+#include <api/scoped_refptr.h>
+#include <api/video/video_frame.h>
+#include <api/video/video_frame_buffer.h>
+#include <api/video/video_sink_interface.h>
+#include <api/video/video_source_interface.h>
+
+#include "CallbackDispatcher.h"
+
+namespace py = pybind11;
+
+struct IncomingVideoPlane;
+
+// A decoded video frame, I420 or NV12. Its planes are read in place from
+// the decoder's buffer, which stays alive as long as the frame or any view
+// of one of its planes does.
+class IncomingVideoFrame : public std::enable_shared_from_this<IncomingVideoFrame> {
+public:
+  IncomingVideoFrame(rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer, int64_t timestampUs, int rotation);
+
+  int width() const;
+  int height() const;
+  int64_t timestampUs() const { return _timestampUs; }
+  // Clockwise degrees the frame has to be rotated by to be shown upright.
+  int rotation() const { return _rotation; }
+  // "I420" (planes Y, U, V) or "NV12" (planes Y, UV).
+  std::string format() const;
+  size_t planeCount() const;
+
+  // Read-only 2-D uint8 view of a plane: its rows, each as wide as the
+  // plane (twice the chroma width for NV12's interleaved UV), with the
+  // buffer's row stride.
+  py::buffer_info planeBuffer(size_t index) const;
+  IncomingVideoPlane plane(size_t index) const;
+
+private:
+  rtc::scoped_refptr<webrtc::VideoFrameBuffer> _buffer;
+  int64_t _timestampUs;
+  int _rotation;
+};
+
+// One plane of an IncomingVideoFrame, exposed through the buffer protocol;
+// memoryview(plane) is a view, not a copy.
+struct IncomingVideoPlane {
+  std::shared_ptr<const IncomingVideoFrame> frame;
+  size_t index = 0;
+};
+
+// Hands the frames of one incoming video stream to Python.
+//
+// Frames over |maxFps| are dropped and frames larger than |maxWidth| x
+// |maxHeight| are scaled down on the decoder thread, before anything is
+// queued. Only the latest frame is kept while the callback is behind, so a
+// slow consumer skips frames instead of building up latency. 0 disables a
+// limit.
+class IncomingVideoSink : public rtc::VideoSinkInterface<webrtc::VideoFrame>,
+                          public std::enable_shared_from_this<IncomingVideoSink> {
+public:
+  using Callback = std::function<void(std::shared_ptr<IncomingVideoFrame>)>;
+
+  IncomingVideoSink(Callback callback, double maxFps, int maxWidth, int maxHeight);
+
+  // Set by NativeInstance before the sink is attached to a call.
+  void setDispatcher(std::shared_ptr<CallbackDispatcher> dispatcher);
+
+  // Frames handed to the callback, and the ones skipped by the frame rate
+  // limit or because the callback was behind.
+  uint64_t delivered() const;
+  uint64_t dropped() const;
+
+  // Changes the size limit, 0 for none; takes effect with the next frame.
+  // Add the sink to the call again for it to ask for a matching quality.
+  void setMaxSize(int maxWidth, int maxHeight);
+
+  // The size limit as a pixel count, taking 16:9 video when only one side is
+  // limited, so that the call doesn't ask for more than the sink keeps.
+  rtc::VideoSinkWants wants() const;
+
+  void OnFrame(const webrtc::VideoFrame &frame) override;
+
+private:
+  bool acceptFrame(int64_t timestampUs);
+  rtc::scoped_refptr<webrtc::VideoFrameBuffer> prepareBuffer(rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer) const;
+  void deliver();
+
+  Callback _callback;
+  int64_t _minFrameIntervalUs;
+  std::atomic<int> _maxWidth;
+  std::atomic<int> _maxHeight;
+
+  // Decoder thread only.
+  int64_t _nextFrameUs = 0;
+
+  mutable std::mutex _mutex;
+  std::shared_ptr<CallbackDispatcher> _dispatcher;
+  std::shared_ptr<IncomingVideoFrame> _pending;
+  bool _isPosted = false;
+  uint64_t _delivered = 0;
+  uint64_t _dropped = 0;
+};
@@ -0,0 +1,78 @@
+#include "JoinAdmission.h"
+
+#include <algorithm>
+#include <chrono>
+
+void JoinAdmission::Slot::Release() {
+  std::call_once(_released, [this] {
+    _admission->Release(_key);
+  });
+}
+
+JoinAdmission &JoinAdmission::Get() {
+  static JoinAdmission admission;
+  return admission;
+}
+
+void JoinAdmission::SetLimit(size_t limit) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _limit = limit;
+  _released.notify_all();
+}
+
+size_t JoinAdmission::limit() const {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return _limit;
+}
+
+std::shared_ptr<JoinAdmission::Slot> JoinAdmission::Acquire(rtc::Thread *networkThread) {
+  const auto start = std::chrono::steady_clock::now();
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  auto &queue = _queues[networkThread];
+  const uint64_t ticket = queue.nextTicket++;
+  _released.wait(lock, [&] {
+    return ticket == queue.nextAdmitted && (_limit == 0 || queue.joining < _limit);
+  });
+  queue.nextAdmitted++;
+  queue.joining++;
+  // The join behind this one may fit as well.
+  _released.notify_all();
+
+  const auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  _admitted++;
+  _measured++;
+  _totalWaitMs += waitMs;
+  _maxWaitMs = std::max<int64_t>(_maxWaitMs, waitMs);
+
+  return std::shared_ptr<Slot>(new Slot(this, networkThread));
+}
+
+void JoinAdmission::Release(rtc::Thread *key) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _queues[key].joining--;
+  _released.notify_all();
+}
+
+JoinAdmissionStats JoinAdmission::stats() const {
+  std::unique_lock<std::mutex> lock(_mutex);
+  JoinAdmissionStats stats;
+  for (const auto &it : _queues) {
+    stats.waiting += static_cast<size_t>(it.second.nextTicket - it.second.nextAdmitted);
+    stats.joining += it.second.joining;
+  }
+  stats.admitted = _admitted;
+  if (_measured > 0) {
+    stats.averageWaitMs = static_cast<double>(_totalWaitMs) / static_cast<double>(_measured);
+  }
+  stats.maxWaitMs = _maxWaitMs;
+  return stats;
+}
+
+void JoinAdmission::ResetStats() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _measured = 0;
+  _totalWaitMs = 0;
+  _maxWaitMs = 0;
+}
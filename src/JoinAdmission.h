@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace rtc {
+  class Thread;
+}  // namespace rtc
+
+struct JoinAdmissionStats {
+  // Joins waiting for a slot, and joins admitted that haven't emitted their
+  // join payload yet.
+  size_t waiting = 0;
+  size_t joining = 0;
+  uint64_t admitted = 0;
+  // Time admitted joins spent waiting, since the last reset.
+  double averageWaitMs = 0;
+  int64_t maxWaitMs = 0;
+};
+
+// Limits how many group calls join at once on each network thread, so a
+// restart that starts every call together doesn't starve the threads with
+// certificate generation, engine setup and ICE gathering. The rest wait in
+// startGroupCall() (without the GIL), first come first served.
+//
+// A join holds its slot from creating the call until the call emits its
+// join payload, or until it is destroyed first. Shared by every
+// NativeInstance in the process; without a limit, nothing waits.
+class JoinAdmission {
+public:
+  // Releases its slot when destroyed, if Release() wasn't called before.
+  class Slot {
+  public:
+    ~Slot() { Release(); }
+
+    Slot(const Slot &) = delete;
+    Slot &operator=(const Slot &) = delete;
+
+    // Lets the next waiting join in. Callable from any thread, once or
+    // more.
+    void Release();
+
+  private:
+    friend class JoinAdmission;
+
+    Slot(JoinAdmission *admission, rtc::Thread *key) : _admission(admission), _key(key) {}
+
+    JoinAdmission *const _admission;
+    rtc::Thread *const _key;
+    std::once_flag _released;
+  };
+
+  static JoinAdmission &Get();
+
+  // Concurrent joins per network thread; 0, the default, for no limit.
+  void SetLimit(size_t limit);
+  size_t limit() const;
+
+  // Blocks until a join on |networkThread| may start.
+  std::shared_ptr<Slot> Acquire(rtc::Thread *networkThread);
+
+  JoinAdmissionStats stats() const;
+  void ResetStats();
+
+private:
+  struct Queue {
+    size_t joining = 0;
+    // Tickets of the next join to admit and of the next to arrive.
+    uint64_t nextAdmitted = 0;
+    uint64_t nextTicket = 0;
+  };
+
+  void Release(rtc::Thread *key);
+
+  mutable std::mutex _mutex;
+  std::condition_variable _released;
+  size_t _limit = 0;
+  std::map<rtc::Thread *, Queue> _queues;
+
+  uint64_t _admitted = 0;
+  uint64_t _measured = 0;
+  int64_t _totalWaitMs = 0;
+  int64_t _maxWaitMs = 0;
+};
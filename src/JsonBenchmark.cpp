@@ -0,0 +1,173 @@
+#include "JsonBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include <tgcalls/group/GroupJoinPayloadInternal.h>
+#include <tgcalls/group/JsonStream.h>
+#include <tgcalls/third-party/json11.hpp>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char kSenderVideoConstraints[] =
+    R"({"colibriClass":"SenderVideoConstraints","videoConstraints":{"idealHeight":360,"preferredHeight":360}})";
+
+const char kDominantSpeaker[] =
+    R"({"colibriClass":"DominantSpeakerEndpointChangeEvent","dominantSpeakerEndpoint":"4f6a2b1c",)"
+    R"("previousSpeakers":["9d3e7a10","0b4c8f22","77e1d5a9"],"silence":false})";
+
+const char kJoinResponse[] =
+    R"({"transport":{"xmlns":"urn:xmpp:jingle:transports:ice-udp:1","rtcp-mux":true,"ufrag":"6f2dq1g3kd8ta5",)"
+    R"("pwd":"1s7bqd6ek3bmm4p1a5s7ra3gr0","fingerprints":[{"fingerprint":"4B:3A:7F:5C:0E:80:6B:0C:3E:1A:99:)"
+    R"(B2:74:5D:3A:44:64:2C:05:91:A0:07:E5:6F:C3:49:1A:80:B1:C2:3F:E0","setup":"actpass","hash":"sha-256"}],)"
+    R"("candidates":[{"generation":"0","component":"1","protocol":"udp","port":"10000","ip":"203.0.113.10",)"
+    R"("foundation":"1","id":"5e1bc3a40","priority":"2130706431","type":"host","network":"0"},)"
+    R"({"generation":"0","component":"1","protocol":"udp","port":"10000","ip":"2001:db8::10",)"
+    R"("foundation":"2","id":"5e1bc3a41","priority":"2130706431","type":"host","network":"0"}]},)"
+    R"("video":{"endpoint":"4f6a2b1c","server_sources":[-271614463],"payload-types":[)"
+    R"({"id":100,"name":"VP8","clockrate":90000,"channels":0,"parameters":{},"rtcp-fbs":[{"type":"goog-remb"},)"
+    R"({"type":"transport-cc"},{"type":"ccm fir"},{"type":"nack"},{"type":"nack pli"}]},)"
+    R"({"id":101,"name":"rtx","clockrate":90000,"channels":0,"parameters":{"apt":"100"}}],)"
+    R"("rtp-hdrexts":[{"id":2,"uri":"http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time"},)"
+    R"({"id":3,"uri":"http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01"},)"
+    R"({"id":13,"uri":"urn:3gpp:video-orientation"}]}})";
+
+// Keeps the measured work from being optimized away.
+volatile size_t sink = 0;
+
+JsonBenchmarkResult Measure(std::string name, int iterations, std::function<size_t()> document, std::function<size_t()> streaming) {
+  JsonBenchmarkResult result;
+  result.name = std::move(name);
+  result.iterations = static_cast<uint64_t>(iterations);
+
+  const auto run = [&](const std::function<size_t()> &work) {
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+      sink = sink + work();
+    }
+    const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return seconds > 0.0 ? iterations / seconds : 0.0;
+  };
+  result.documentPerSecond = run(document);
+  result.streamingPerSecond = run(streaming);
+  return result;
+}
+
+size_t ColibriClassLength(const std::string &message) {
+  tgcalls::JsonReader reader(message);
+  absl::string_view colibriClass;
+  reader.readObject([&](absl::string_view key) {
+    if (key == "colibriClass" && reader.type() == tgcalls::JsonReader::Type::String) {
+      reader.readString(colibriClass);
+    } else {
+      reader.skipValue();
+    }
+  });
+  return reader.finish() ? colibriClass.size() : 0;
+}
+
+size_t DocumentColibriClassLength(const std::string &message) {
+  std::string error;
+  const auto json = json11::Json::parse(message, error);
+  return json["colibriClass"].string_value().size();
+}
+
+} // namespace
+
+std::vector<JsonBenchmarkResult> RunJsonBenchmark(int iterations, int endpoints) {
+  iterations = std::max(1, iterations);
+  endpoints = std::max(0, std::min(endpoints, 1000));
+
+  std::vector<JsonBenchmarkResult> results;
+
+  const std::string senderVideoConstraints = kSenderVideoConstraints;
+  results.push_back(Measure("SenderVideoConstraints", iterations, [&] {
+    std::string error;
+    const auto json = json11::Json::parse(senderVideoConstraints, error);
+    return size_t(json["videoConstraints"]["idealHeight"].int_value());
+  }, [&] {
+    tgcalls::JsonReader reader(senderVideoConstraints);
+    int32_t idealHeight = 0;
+    reader.readObject([&](absl::string_view key) {
+      if (key == "videoConstraints" && reader.type() == tgcalls::JsonReader::Type::Object) {
+        reader.readObject([&](absl::string_view key) {
+          if (key == "idealHeight" && reader.type() == tgcalls::JsonReader::Type::Number) {
+            reader.readInt(idealHeight);
+          } else {
+            reader.skipValue();
+          }
+        });
+      } else {
+        reader.skipValue();
+      }
+    });
+    return reader.finish() ? size_t(idealHeight) : 0;
+  }));
+
+  const std::string dominantSpeaker = kDominantSpeaker;
+  results.push_back(Measure("DominantSpeakerEndpointChangeEvent", iterations, [&] {
+    return DocumentColibriClassLength(dominantSpeaker);
+  }, [&] {
+    return ColibriClassLength(dominantSpeaker);
+  }));
+
+  // The document side only parses; picking the fields out of it took
+  // the old parser more work still.
+  const std::string joinResponse = kJoinResponse;
+  results.push_back(Measure("GroupJoinResponsePayload", iterations, [&] {
+    std::string error;
+    return json11::Json::parse(joinResponse, error).object_items().size();
+  }, [&] {
+    const auto payload = tgcalls::GroupJoinResponsePayload::parse(joinResponse);
+    return payload ? payload->transport.candidates.size() : 0;
+  }));
+
+  std::vector<std::string> endpointIds;
+  for (int i = 0; i < endpoints; i++) {
+    endpointIds.push_back("endpoint" + std::to_string(i));
+  }
+  results.push_back(Measure("ReceiverVideoConstraints", iterations, [&] {
+    json11::Json::object json;
+    json.insert(std::make_pair("colibriClass", json11::Json("ReceiverVideoConstraints")));
+    json11::Json::object constraints;
+    json11::Json::array onStageEndpoints;
+    for (const auto &endpointId : endpointIds) {
+      json11::Json::object constraint;
+      constraint.insert(std::make_pair("minHeight", json11::Json(180)));
+      constraint.insert(std::make_pair("maxHeight", json11::Json(360)));
+      constraints.insert(std::make_pair(endpointId, json11::Json(std::move(constraint))));
+    }
+    json.insert(std::make_pair("onStageEndpoints", json11::Json(std::move(onStageEndpoints))));
+    json.insert(std::make_pair("constraints", json11::Json(std::move(constraints))));
+    return json11::Json(std::move(json)).dump().size();
+  }, [&] {
+    std::string result;
+    result.reserve(128 + 64 * endpointIds.size());
+    tgcalls::JsonWriter json(result);
+    json.beginObject();
+    json.key("colibriClass");
+    json.stringValue("ReceiverVideoConstraints");
+    json.key("constraints");
+    json.beginObject();
+    for (const auto &endpointId : endpointIds) {
+      json.key(endpointId);
+      json.beginObject();
+      json.key("minHeight");
+      json.intValue(180);
+      json.key("maxHeight");
+      json.intValue(360);
+      json.endObject();
+    }
+    json.endObject();
+    json.key("onStageEndpoints");
+    json.beginArray();
+    json.endArray();
+    json.endObject();
+    return result.size();
+  }));
+
+  return results;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compares, on the calling thread, the json11 document parser group calls
+// used to handle colibri data channel messages and join payloads with the
+// streaming JsonReader / JsonWriter that replaced it.
+struct JsonBenchmarkResult {
+  std::string name;
+  uint64_t iterations = 0;
+  // Messages per second on one core.
+  double documentPerSecond = 0.0;
+  double streamingPerSecond = 0.0;
+};
+
+// Runs |iterations| rounds of each case: parsing a SenderVideoConstraints
+// and a dominant speaker message, parsing a join response, and writing
+// ReceiverVideoConstraints for |endpoints| video endpoints.
+std::vector<JsonBenchmarkResult> RunJsonBenchmark(int iterations, int endpoints);
@@ -0,0 +1,317 @@
+#include "LoadTest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <thread>
+
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include <rtc_base/time_utils.h>
+
+#include <tgcalls/StaticThreads.h>
+#include <tgcalls/group/GroupInstanceCustomImpl.h>
+#include <tgcalls/group/LoopbackSfu.h>
+#include <tgcalls/group/StreamingPart.h>
+
+#include "FileAudioDeviceDescriptor.h"
+#include "WrappedAudioDeviceModuleImpl.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// How often stats are collected while measuring, so the counters of
+// channels dropped by speaker churn aren't lost.
+constexpr int kSampleIntervalMs = 500;
+
+// Serves the parts of a call from memory on a clock that starts with it,
+// answering NotReady for parts still in the future like the server does.
+class LoopbackBroadcastServer {
+public:
+  LoopbackBroadcastServer(std::shared_ptr<const std::vector<std::vector<uint8_t>>> parts, int partDurationMs, size_t firstPart)
+      : _parts(std::move(parts)), _partDurationMs(partDurationMs), _firstPart(firstPart), _startMs(rtc::TimeMillis()) {
+  }
+
+  std::shared_ptr<tgcalls::BroadcastPartTask> request(int64_t timestampMilliseconds, std::function<void(tgcalls::BroadcastPart &&)> done) {
+    const auto nowMs = rtc::TimeMillis() - _startMs;
+    tgcalls::BroadcastPart part;
+    part.timestampMilliseconds = timestampMilliseconds;
+    part.responseTimestamp = nowMs / 1000.0;
+    if (timestampMilliseconds <= nowMs && !_parts->empty()) {
+      const auto index = static_cast<size_t>(timestampMilliseconds / _partDurationMs) + _firstPart;
+      part.status = tgcalls::BroadcastPart::Status::Success;
+      part.oggData = (*_parts)[index % _parts->size()];
+    } else {
+      part.status = tgcalls::BroadcastPart::Status::NotReady;
+    }
+    done(std::move(part));
+    // Already complete, so there's nothing to cancel.
+    return nullptr;
+  }
+
+private:
+  const std::shared_ptr<const std::vector<std::vector<uint8_t>>> _parts;
+  const int _partDurationMs;
+  const size_t _firstPart;
+  const int64_t _startMs;
+};
+
+struct LoadTestCall {
+  std::shared_ptr<FileAudioDeviceDescriptor> device;
+  std::shared_ptr<LoopbackBroadcastServer> server;
+  std::unique_ptr<tgcalls::GroupInstanceCustomImpl> instance;
+  int64_t startedAtMs = 0;
+  // Set on the media thread the first time the call connects over RTC.
+  std::shared_ptr<std::atomic<int64_t>> connectedAtMs = std::make_shared<std::atomic<int64_t>>(0);
+  // Concealment events last seen per incoming SSRC.
+  std::map<uint32_t, uint64_t> concealmentEvents;
+  // Jitter buffer delays of the incoming streams, summed over the samples.
+  int64_t jitterBufferDelayMs = 0;
+  int64_t jitterBufferSamples = 0;
+};
+
+struct ProcessUsage {
+  double cpuSeconds = 0.0;
+  int64_t voluntaryContextSwitches = 0;
+  int64_t involuntaryContextSwitches = 0;
+};
+
+ProcessUsage GetProcessUsage() {
+  ProcessUsage usage;
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+  rusage value{};
+  if (getrusage(RUSAGE_SELF, &value) == 0) {
+    usage.cpuSeconds = value.ru_utime.tv_sec + value.ru_utime.tv_usec / 1e6 + value.ru_stime.tv_sec + value.ru_stime.tv_usec / 1e6;
+    usage.voluntaryContextSwitches = value.ru_nvcsw;
+    usage.involuntaryContextSwitches = value.ru_nivcsw;
+  }
+#endif
+  return usage;
+}
+
+int64_t GetResidentBytes() {
+#if defined(__linux__)
+  FILE *file = fopen("/proc/self/statm", "r");
+  if (!file) {
+    return 0;
+  }
+  long size = 0;
+  long resident = 0;
+  const auto read = fscanf(file, "%ld %ld", &size, &resident);
+  fclose(file);
+  return read == 2 ? static_cast<int64_t>(resident) * sysconf(_SC_PAGESIZE) : 0;
+#else
+  return 0;
+#endif
+}
+
+// Joins |sfu| over RTC when given, otherwise starts in broadcast mode.
+std::unique_ptr<tgcalls::GroupInstanceCustomImpl> CreateCall(LoadTestCall &call, bool useSharedAudioClock,
+                                                            std::shared_ptr<tgcalls::LoopbackSfu> sfu) {
+  tgcalls::GroupInstanceDescriptor descriptor{
+      .threads = tgcalls::Threads::getThreads(),
+      .networkStateUpdated = [connectedAtMs = call.connectedAtMs](tgcalls::GroupNetworkState state) {
+        int64_t notConnected = 0;
+        if (state.isConnected) {
+          connectedAtMs->compare_exchange_strong(notConnected, rtc::TimeMillis());
+        }
+      },
+      .audioLevelsUpdated = [](tgcalls::GroupLevelsUpdate const &) {},
+      .createAudioDeviceModule =
+      [device = call.device, useSharedAudioClock](webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+        return WrappedAudioDeviceModuleImpl::Create(
+            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, device, useSharedAudioClock);
+      },
+      .disableOutgoingAudioProcessing = true,
+  };
+  if (!sfu) {
+    descriptor.requestBroadcastPart = [server = call.server](int64_t timestampMilliseconds, int64_t,
+                                                             std::function<void(tgcalls::BroadcastPart &&)> done) {
+      return server->request(timestampMilliseconds, std::move(done));
+    };
+  }
+
+  call.startedAtMs = rtc::TimeMillis();
+  auto instance = std::make_unique<tgcalls::GroupInstanceCustomImpl>(std::move(descriptor));
+  if (!sfu) {
+    instance->setConnectionMode(tgcalls::GroupConnectionMode::GroupConnectionModeBroadcast, false);
+    return instance;
+  }
+  instance->setConnectionMode(tgcalls::GroupConnectionMode::GroupConnectionModeRtc, false);
+  // The SFU is destroyed before the calls, so a response can't outlive them.
+  instance->emitJoinPayload([weakSfu = std::weak_ptr<tgcalls::LoopbackSfu>(sfu), instance = instance.get()](tgcalls::GroupJoinPayload const &payload) {
+    const auto sfu = weakSfu.lock();
+    if (!sfu) {
+      return;
+    }
+    sfu->join(payload.json, [instance](std::string const &response) {
+      if (!response.empty()) {
+        instance->setJoinResponsePayload(response);
+      }
+    });
+  });
+  return instance;
+}
+
+// Adds the concealment events |call| had since it was last sampled, and
+// sums up its current jitter buffer delays.
+uint64_t SampleMediaStats(LoadTestCall &call) {
+  const auto stats = call.instance->getMediaStats();
+  uint64_t added = 0;
+  for (size_t i = 0; i < stats.incomingAudioSsrcs.size(); i++) {
+    call.jitterBufferDelayMs += stats.incomingAudioJitterBufferDelayMs[i];
+    call.jitterBufferSamples++;
+    const auto events = stats.incomingAudioConcealmentEvents[i];
+    auto &last = call.concealmentEvents[stats.incomingAudioSsrcs[i]];
+    // Fewer than before means the channel was recreated in between.
+    added += events >= last ? events - last : events;
+    last = events;
+  }
+  return added;
+}
+
+} // namespace
+
+LoadTestResult RunLoadTest(LoadTestConfig config) {
+  config.calls = std::max(1, config.calls);
+  config.warmupMs = std::max(0, config.warmupMs);
+  config.durationMs = std::max(kSampleIntervalMs, config.durationMs);
+  config.partDurationMs = std::max(10, config.partDurationMs);
+  config.speakers = std::max(0, std::min(config.speakers, config.calls));
+
+  const auto parts = std::make_shared<const std::vector<std::vector<uint8_t>>>(std::move(config.broadcastParts));
+  std::vector<std::vector<uint32_t>> ssrcsByPart;
+  for (const auto &part : *parts) {
+    auto data = part;
+    tgcalls::StreamingPart streamingPart(std::move(data));
+    ssrcsByPart.push_back(streamingPart.getSsrcs());
+  }
+
+  const auto residentBefore = GetResidentBytes();
+  auto sfu = config.useLoopbackSfu ? std::make_shared<tgcalls::LoopbackSfu>(tgcalls::Threads::getThreads()) : nullptr;
+  if (sfu) {
+    sfu->setImpairment(config.uplinkImpairment, config.downlinkImpairment);
+  }
+  std::vector<LoadTestCall> calls(config.calls);
+  for (int i = 0; i < config.calls; i++) {
+    auto &call = calls[i];
+    call.device = std::make_shared<FileAudioDeviceDescriptor>();
+    call.device->_inputFilename = config.inputFilename;
+    call.device->_endlessPlayout = true;
+    call.server = std::make_shared<LoopbackBroadcastServer>(parts, config.partDurationMs, i);
+    call.instance = CreateCall(call, config.useSharedAudioClock, sfu);
+    if (sfu) {
+      call.instance->setIsMuted(i >= config.speakers);
+    }
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(config.warmupMs));
+
+  LoadTestResult result;
+  result.calls = config.calls;
+  result.residentBytesPerCall = residentBefore > 0 ? (GetResidentBytes() - residentBefore) / config.calls : 0;
+  if (sfu) {
+    int64_t connectMs = 0;
+    for (const auto &call : calls) {
+      if (const auto connectedAtMs = call.connectedAtMs->load()) {
+        result.connectedCalls++;
+        connectMs += connectedAtMs - call.startedAtMs;
+      }
+    }
+    result.meanConnectMs = result.connectedCalls > 0 ? (double)connectMs / result.connectedCalls : 0.0;
+  }
+
+  uint64_t packetsBefore = 0;
+  uint64_t threadHopsBefore = 0;
+  uint64_t lateTicksBefore = 0;
+  uint64_t droppedTicksBefore = 0;
+  for (auto &call : calls) {
+    const auto delivery = call.instance->getPacketDeliveryStats();
+    packetsBefore += delivery.packets;
+    threadHopsBefore += delivery.threadHops;
+    lateTicksBefore += call.device->_clockStats.lateTicks.load();
+    droppedTicksBefore += call.device->_clockStats.droppedTicks.load();
+    SampleMediaStats(call);
+    call.jitterBufferDelayMs = 0;
+    call.jitterBufferSamples = 0;
+  }
+
+  const auto usageBefore = GetProcessUsage();
+  const auto start = Clock::now();
+  const auto end = start + std::chrono::milliseconds(config.durationMs);
+  auto nextChurn = start + std::chrono::milliseconds(config.speakerChurnIntervalMs);
+  size_t churnedPart = 0;
+  int firstSpeaker = 0;
+  while (true) {
+    const auto next = std::min(end, Clock::now() + std::chrono::milliseconds(kSampleIntervalMs));
+    std::this_thread::sleep_until(next);
+
+    for (auto &call : calls) {
+      result.concealmentEvents += SampleMediaStats(call);
+    }
+    if (next >= end) {
+      break;
+    }
+    if (config.speakerChurnIntervalMs <= 0 || next < nextChurn) {
+      continue;
+    }
+    nextChurn += std::chrono::milliseconds(config.speakerChurnIntervalMs);
+    if (sfu) {
+      firstSpeaker = (firstSpeaker + config.speakers) % config.calls;
+      for (int i = 0; i < config.calls; i++) {
+        const auto offset = (i - firstSpeaker + config.calls) % config.calls;
+        calls[i].instance->setIsMuted(offset >= config.speakers);
+      }
+    } else if (!ssrcsByPart.empty()) {
+      for (size_t i = 0; i < calls.size(); i++) {
+        calls[i].instance->removeSsrcs(ssrcsByPart[(churnedPart + i) % ssrcsByPart.size()]);
+      }
+      churnedPart++;
+    }
+  }
+  const auto usageAfter = GetProcessUsage();
+  const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  uint64_t packets = 0;
+  uint64_t threadHops = 0;
+  uint64_t lateTicks = 0;
+  uint64_t droppedTicks = 0;
+  int64_t jitterBufferDelayMs = 0;
+  int64_t jitterBufferSamples = 0;
+  for (auto &call : calls) {
+    const auto delivery = call.instance->getPacketDeliveryStats();
+    packets += delivery.packets;
+    threadHops += delivery.threadHops;
+    lateTicks += call.device->_clockStats.lateTicks.load();
+    droppedTicks += call.device->_clockStats.droppedTicks.load();
+    jitterBufferDelayMs += call.jitterBufferDelayMs;
+    jitterBufferSamples += call.jitterBufferSamples;
+  }
+
+  result.measuredSeconds = seconds;
+  result.cpuPercentPerCall = (usageAfter.cpuSeconds - usageBefore.cpuSeconds) / seconds / config.calls * 100.0;
+  result.voluntaryContextSwitchesPerSecond = (usageAfter.voluntaryContextSwitches - usageBefore.voluntaryContextSwitches) / seconds;
+  result.involuntaryContextSwitchesPerSecond = (usageAfter.involuntaryContextSwitches - usageBefore.involuntaryContextSwitches) / seconds;
+  result.packetsPerSecond = (packets - packetsBefore) / seconds;
+  result.threadHopsPerSecond = (threadHops - threadHopsBefore) / seconds;
+  result.lateAudioTicks = lateTicks - lateTicksBefore;
+  result.droppedAudioTicks = droppedTicks - droppedTicksBefore;
+  result.meanJitterBufferDelayMs = jitterBufferSamples > 0 ? (double)jitterBufferDelayMs / jitterBufferSamples : 0.0;
+  if (sfu) {
+    const auto sfuStats = sfu->getStats();
+    result.meanImpairmentDelayMs = sfuStats.meanImpairmentDelayMs;
+    result.impairmentLostPackets = sfuStats.impairmentLostPackets;
+    result.impairmentQueueDroppedPackets = sfuStats.impairmentQueueDroppedPackets;
+  }
+
+  sfu = nullptr;
+  calls.clear();
+  return result;
+}
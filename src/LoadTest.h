@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tgcalls/group/NetworkImpairment.h>
+
+// Runs many group calls in this process, with no network, to measure how
+// many fit on a core.
+//
+// By default every call is in broadcast mode, fed broadcast parts straight
+// from memory, so it decodes, mixes and plays out incoming audio like a
+// live call does, but never encodes any. With |useLoopbackSfu|, the calls
+// instead join a tgcalls::LoopbackSfu over RTC and hear each other: all of
+// them encode their input file while unmuted and decode the others.
+struct LoadTestConfig {
+  int calls = 10;
+  bool useLoopbackSfu = false;
+  // With the loopback SFU, how many calls are unmuted at a time; the rest
+  // are muted and each churn interval the next ones take over.
+  int speakers = 3;
+  // Calls run this long before measuring, to get past joining and the
+  // first parts, then are measured for |durationMs|.
+  int warmupMs = 3000;
+  int durationMs = 30000;
+  // Broadcast parts, as a requestBroadcastPart callback receives them, of
+  // |partDurationMs| each. Calls take them in turn, each starting from a
+  // different one, so mixing parts with different SSRCs changes who speaks.
+  std::vector<std::vector<uint8_t>> broadcastParts;
+  int partDurationMs = 1000;
+  // Every interval, each call in broadcast mode drops the channels of the
+  // SSRCs of one part, as when participants leave, and they come back with
+  // their next packets; with the loopback SFU, the speakers change. 0
+  // disables it.
+  int speakerChurnIntervalMs = 2000;
+  // Raw s16le 48 kHz stereo played as the calls' outgoing audio, looped;
+  // silence when empty.
+  std::string inputFilename;
+  // Drive the calls' audio devices from the process-wide AudioPump instead
+  // of two threads per call.
+  bool useSharedAudioClock = false;
+  // With the loopback SFU, the network between each call and the SFU, to
+  // compare the cost of NetEq concealment, FEC and loss across profiles.
+  tgcalls::NetworkImpairment uplinkImpairment;
+  tgcalls::NetworkImpairment downlinkImpairment;
+};
+
+struct LoadTestResult {
+  int calls = 0;
+  double measuredSeconds = 0.0;
+  // Process CPU time per call, in percent of one core.
+  double cpuPercentPerCall = 0.0;
+  // Context switches of the whole process per second, voluntary ones being
+  // threads going to sleep and waking up again.
+  double voluntaryContextSwitchesPerSecond = 0.0;
+  double involuntaryContextSwitchesPerSecond = 0.0;
+  // With the loopback SFU, the calls connected by the end of warmup and
+  // their mean time from start to connected.
+  int connectedCalls = 0;
+  double meanConnectMs = 0.0;
+  // Growth of the resident set from before the calls started until the end
+  // of warmup, per call; 0 where it can't be read.
+  int64_t residentBytesPerCall = 0;
+  // Incoming packets delivered to the calls' media engines, over all calls.
+  double packetsPerSecond = 0.0;
+  double threadHopsPerSecond = 0.0;
+  // Audio glitches over all calls while measuring: NetEq concealment events
+  // of incoming streams, and audio device ticks that ran late or were
+  // skipped.
+  uint64_t concealmentEvents = 0;
+  uint64_t lateAudioTicks = 0;
+  uint64_t droppedAudioTicks = 0;
+  // Latency: the mean jitter buffer delay of the incoming streams, sampled
+  // while measuring, and with the loopback SFU, the mean delay its
+  // impairments added, and the packets they lost or dropped over the run.
+  double meanJitterBufferDelayMs = 0.0;
+  double meanImpairmentDelayMs = 0.0;
+  uint64_t impairmentLostPackets = 0;
+  uint64_t impairmentQueueDroppedPackets = 0;
+};
+
+// Blocks for the whole run; the calls are stopped before it returns.
+LoadTestResult RunLoadTest(LoadTestConfig config);
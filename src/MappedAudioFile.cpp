@@ -0,0 +1,102 @@
+#include "MappedAudioFile.h"
+
+#include <map>
+#include <mutex>
+
+#if defined(WEBRTC_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <rtc_base/logging.h>
+
+namespace {
+
+std::mutex mappingsMutex;
+std::map<std::string, std::weak_ptr<MappedAudioFile>> mappings;
+
+}  // namespace
+
+MappedAudioFile::MappedAudioFile(const int8_t *data, size_t size, int64_t inode, int64_t modifiedTime)
+    : _data(data), _size(size), _inode(inode), _modifiedTime(modifiedTime) {}
+
+#if defined(WEBRTC_POSIX)
+
+std::shared_ptr<MappedAudioFile> MappedAudioFile::Open(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open audio input file: " << path;
+    return nullptr;
+  }
+
+  struct stat info{};
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    RTC_LOG(LS_ERROR) << "Cannot map empty or unreadable audio input file: " << path;
+    close(fd);
+    return nullptr;
+  }
+
+  std::unique_lock<std::mutex> lock(mappingsMutex);
+  auto it = mappings.find(path);
+  if (it != mappings.end()) {
+    auto existing = it->second.lock();
+    if (existing && existing->_inode == static_cast<int64_t>(info.st_ino) &&
+        existing->_modifiedTime == static_cast<int64_t>(info.st_mtime) &&
+        existing->_size == static_cast<size_t>(info.st_size)) {
+      close(fd);
+      return existing;
+    }
+  }
+
+  size_t size = static_cast<size_t>(info.st_size);
+#if defined(POSIX_FADV_SEQUENTIAL)
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file.
+  close(fd);
+  if (data == MAP_FAILED) {
+    RTC_LOG(LS_ERROR) << "Failed to map audio input file: " << path;
+    return nullptr;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  std::shared_ptr<MappedAudioFile> mapping(new MappedAudioFile(
+      static_cast<const int8_t *>(data), size,
+      static_cast<int64_t>(info.st_ino), static_cast<int64_t>(info.st_mtime)));
+  mappings[path] = mapping;
+  return mapping;
+}
+
+MappedAudioFile::~MappedAudioFile() {
+  munmap(const_cast<int8_t *>(_data), _size);
+}
+
+void MappedAudioFile::Prefetch(size_t offset, size_t length) const {
+  if (offset >= _size) {
+    return;
+  }
+  if (length > _size - offset) {
+    length = _size - offset;
+  }
+
+  // madvise wants a page aligned start address.
+  static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t alignedOffset = offset - offset % pageSize;
+  madvise(const_cast<int8_t *>(_data) + alignedOffset, length + (offset - alignedOffset), MADV_WILLNEED);
+}
+
+#else
+
+std::shared_ptr<MappedAudioFile> MappedAudioFile::Open(const std::string &path) {
+  RTC_LOG(LS_WARNING) << "Memory mapped input is not supported on this platform";
+  return nullptr;
+}
+
+MappedAudioFile::~MappedAudioFile() = default;
+
+void MappedAudioFile::Prefetch(size_t offset, size_t length) const {}
+
+#endif
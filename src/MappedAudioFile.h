@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Read-only memory mapping of a raw PCM input file.
+//
+// Mappings are shared by path: every device playing the same (unchanged) file
+// gets the same instance, so they also share its page-cache pages.
+class MappedAudioFile {
+public:
+  // How far ahead of the read position pages are requested by default.
+  static constexpr size_t kDefaultPrefetchBytes = 1024 * 1024;
+
+  // Returns the shared mapping of |path|, or nullptr if it cannot be mapped
+  // (missing or empty file, or a platform without mmap).
+  static std::shared_ptr<MappedAudioFile> Open(const std::string &path);
+
+  ~MappedAudioFile();
+
+  MappedAudioFile(const MappedAudioFile &) = delete;
+  MappedAudioFile &operator=(const MappedAudioFile &) = delete;
+
+  const int8_t *data() const { return _data; }
+  size_t size() const { return _size; }
+
+  // Asks the kernel to start reading [offset, offset + length) in the
+  // background. Never blocks on I/O.
+  void Prefetch(size_t offset, size_t length) const;
+
+private:
+  MappedAudioFile(const int8_t *data, size_t size, int64_t inode, int64_t modifiedTime);
+
+  const int8_t *_data;
+  size_t _size;
+
+  // Identify the file version the mapping was made from, so a file replaced
+  // on disk is mapped again instead of serving stale audio.
+  int64_t _inode;
+  int64_t _modifiedTime;
+};
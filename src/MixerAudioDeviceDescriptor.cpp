@@ -0,0 +1,29 @@
+#include "MixerAudioDeviceDescriptor.h"
+
+#include <stdexcept>
+
+MixerAudioDeviceDescriptor::MixerAudioDeviceDescriptor(size_t inputs, size_t capacity)
+    : _mixer(inputs, capacity) {}
+
+size_t MixerAudioDeviceDescriptor::_push(size_t input, const uint8_t *data, size_t length) {
+  auto &ring = _mixer.input(input).ring;
+  // Truncate to whole sample frames so the channels never get out of phase.
+  length -= length % (_recordingFormat.channels * sizeof(int16_t));
+  size_t written = ring.Write(data, length);
+  if (written < length) {
+    _overruns++;
+  }
+  return written;
+}
+
+size_t MixerAudioDeviceDescriptor::push(size_t input, const py::bytes &frame) {
+  char *data = nullptr;
+  py::ssize_t length = 0;
+  PyBytes_AsStringAndSize(frame.ptr(), &data, &length);
+  return _push(input, reinterpret_cast<const uint8_t *>(data), static_cast<size_t>(length));
+}
+
+size_t MixerAudioDeviceDescriptor::pushBuffer(size_t input, const py::buffer &buffer) {
+  PcmInput pcm(buffer);
+  return _push(input, pcm.data(), pcm.size());
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+
+#include <pybind11/pybind11.h>
+
+#include "AudioBlock.h"
+#include "AudioDeadlineClock.h"
+#include "AudioFormat.h"
+#include "AudioIdleSignal.h"
+#include "AudioMixer.h"
+
+namespace py = pybind11;
+
+// Several streams pushed by Python (music, a jingle, TTS, ...) mixed natively
+// into the audio sent into the call, once per 10 ms. Each input has its own
+// gain, and inputs marked as ducking lower the others while they play. The
+// call's own audio is discarded.
+class MixerAudioDeviceDescriptor {
+public:
+    // Two seconds of 48 kHz stereo s16le per input.
+    static constexpr size_t kDefaultCapacity = 48000 * 2 * 2 * 2;
+
+    explicit MixerAudioDeviceDescriptor(size_t inputs = 2, size_t capacity = kDefaultCapacity);
+
+    // Format of every input and of the mixed frames; 48 kHz stereo unless
+    // set otherwise before the call starts.
+    AudioFormat _recordingFormat;
+
+    AudioMixer _mixer;
+
+    std::atomic<bool> _isPlayoutPaused{false};
+    // Notified when the flag changes; the device threads park on it while
+    // it is set, as the call's audio is discarded anyway.
+    AudioIdleSignal _idleSignal;
+
+    // Pushes that were truncated because the input's ring was full.
+    std::atomic<uint64_t> _overruns{0};
+
+    AudioClockStats _clockStats{tgcalls::HotPathCounters::AudioDevice::Mixer};
+
+    size_t push(size_t input, const py::bytes &);
+    size_t pushBuffer(size_t input, const py::buffer &);
+
+private:
+    size_t _push(size_t input, const uint8_t *, size_t);
+};
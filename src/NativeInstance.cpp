@@ -1,28 +1,73 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
 
-#include <rtc_base/ssl_adapter.h>
+#include <tgcalls/LogSinkImpl.h>
+#include <tgcalls/OverloadController.h>
+#include <tgcalls/QueuedVideoSink.h>
+#include <tgcalls/v2/InstanceV2Impl.h>
+#include <rtc_base/thread.h>
 
 #include "NativeInstance.h"
 
 namespace py = pybind11;
 
-auto noticeDisplayed = false;
+namespace {
+
+// Set by the first NativeInstance, whichever thread creates it. Printing
+// may release the GIL, so the notice isn't printed under a lock.
+std::atomic<bool> noticeDisplayed{false};
+// The instance registry isn't safe to write while other threads read it.
+std::once_flag registered;
+
+// One memcpy, where pybind11's casters to std::vector<uint8_t> convert the
+// object element by element.
+template <typename Container>
+Container copyBuffer(const py::buffer &buffer) {
+  py::buffer_info info = buffer.request();
+  if (info.ndim != 1 || info.strides[0] != info.itemsize) {
+    throw std::invalid_argument("a contiguous one-dimensional buffer is required");
+  }
+  const auto data = static_cast<const char *>(info.ptr);
+  return Container(data, data + info.size * info.itemsize);
+}
+
+}  // namespace
 
 NativeInstance::NativeInstance(bool logToStdErr, string logPath)
-    : _logToStdErr(logToStdErr), _logPath(std::move(logPath)) {
-  if (!noticeDisplayed) {
+    : _logToStdErr(logToStdErr), _logPath(std::move(logPath)),
+      _callbackDispatcher(std::make_shared<CallbackDispatcher>()) {
+  if (!noticeDisplayed.exchange(true)) {
     auto ver = std::string(PROJECT_VER);
     auto dev = std::count(ver.begin(), ver.end(), '.') == 3 ? " DEV" : "";
     py::print("tgcalls v" + ver + dev + ", Copyright (C) 2020-2021 Il`ya (Marshal) <https://github.com/MarshalX>");
     py::print("Licensed under the terms of the GNU Lesser General Public License v3 (LGPLv3) \n\n");
-
-    noticeDisplayed = true;
   }
-  rtc::InitializeSSL();
+  std::call_once(registered, [] {
 //    tgcalls::Register<tgcalls::InstanceImpl>();
+    tgcalls::Register<tgcalls::InstanceV2Impl>();
+  });
+
 }
 
-NativeInstance::~NativeInstance() = default;
+NativeInstance::~NativeInstance() {
+  // Tearing the call down joins audio and dispatcher threads that may be
+  // blocked waiting for the GIL.
+  py::gil_scoped_release release;
+  _prewarmedGroupCalls.clear();
+  {
+    std::lock_guard<std::mutex> lock(_teardownMutex);
+    _suspendedGroupCall.reset();
+  }
+  instanceHolder = nullptr;
+  for (const auto &teardown : _pendingTeardowns) {
+    teardown.wait();
+  }
+  _callbackDispatcher->Stop();
+}
 
 void NativeInstance::setupGroupCall(
     std::function<void(tgcalls::GroupJoinPayload)> &emitJoinPayloadCallback,
@@ -33,66 +78,382 @@ void NativeInstance::setupGroupCall(
   _outgoingAudioBitrateKbit = outgoingAudioBitrateKbit;
 }
 
-void NativeInstance::createInstanceHolder(
+std::unique_ptr<tgcalls::GroupInstanceCustomImpl> NativeInstance::createGroupInstance(
     std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory *)> createAudioDeviceModule,
-    std::string initialInputDeviceId = "",
-    std::string initialOutputDeviceId = ""
+    std::string initialInputDeviceId,
+    std::string initialOutputDeviceId,
+    std::shared_ptr<JoinAdmission::Slot> &admissionSlot,
+    bool prewarming
 ) {
+  auto threads = tgcalls::Threads::getThreads();
+  admissionSlot = JoinAdmission::Get().Acquire(threads->getNetworkThread());
+
   tgcalls::GroupInstanceDescriptor descriptor{
-      .threads = tgcalls::StaticThreads::getThreads(),
-      .config = tgcalls::GroupConfig{.need_log = true,
-          .logPath = {std::move(_logPath)},
+      .threads = std::move(threads),
+      .config = tgcalls::GroupConfig{.need_log = !_logPath.empty() || !tgcalls::LogSinkImpl::Options().sharedLogPath.empty(),
+          .logPath = {_logPath},
           .logToStdErr = _logToStdErr},
       .networkStateUpdated =
       [=](tgcalls::GroupNetworkState groupNetworkState) {
-        _networkStateUpdated(groupNetworkState.isConnected);
+        _callbackDispatcher->Post([this, isConnected = groupNetworkState.isConnected] {
+          _networkStateUpdated(isConnected);
+        });
       },
       .audioLevelsUpdated =
-      [=](tgcalls::GroupLevelsUpdate const &update) {}, // its necessary for audio analyzing (VAD)
+      [participantLevels = _participantLevels, speakerMonitor = _speakerMonitor,
+       callId = _speakerMonitorCallId](tgcalls::GroupLevelsUpdate const &update) {
+        if (participantLevels) {
+          participantLevels->Apply(update);
+        }
+        if (speakerMonitor) {
+          speakerMonitor->Apply(callId, update);
+        }
+      }, // its necessary for audio analyzing (VAD)
+      .audioLevelsUpdateIntervalMs=_audioLevelsIntervalMs,
+      // The monitor needs speech reported every tick, changed or not.
+      .audioLevelsDeltaUpdates=_participantLevels != nullptr && _speakerMonitor == nullptr,
+      // Nothing is decoded for the monitor to run VAD on.
+      .enableIncomingVad=_enableIncomingVad && _speakerMonitor == nullptr,
       .initialInputDeviceId = std::move(initialInputDeviceId),
       .initialOutputDeviceId = std::move(initialOutputDeviceId),
+      .useDummyChannel = _useDummyChannel,
+      .disableIncomingChannels = _speakerMonitor != nullptr,
       .createAudioDeviceModule = std::move(createAudioDeviceModule),
       .outgoingAudioBitrateKbit=_outgoingAudioBitrateKbit,
+      .outgoingAudioProfile=_outgoingAudioProfile,
       .disableOutgoingAudioProcessing=true,
+      .outgoingVoiceGate=_outgoingVoiceGate,
+      .disablePlayoutMixing=_disablePlayoutMixing,
+      .incomingAudioChannelPoolSize=_incomingAudioChannelPoolSize,
+      .incomingAudioChannelIdleTimeoutMs=_incomingAudioChannelIdleTimeoutMs,
+      .ssrcStateIdleTimeoutMs=_ssrcStateIdleTimeoutMs,
+      .maxDecodedIncomingAudioStreams=_maxDecodedIncomingAudioStreams,
+      .parallelAudioDecodingDeadlineUs=_parallelAudioDecodingDeadlineUs,
+      .incomingAudioProfile=_incomingAudioProfile,
+      .audioMixer=_audioMixer,
       // deprecated
 //      .participantDescriptionsRequired =
 //      [=](std::vector<uint32_t> const &ssrcs) {
 //        _participantDescriptionsRequired(ssrcs);
 //      },
-      //        .requestBroadcastPart = [=](int64_t time, int64_t period,
-      //        std::function<void(tgcalls::BroadcastPart &&)> done) {},
   };
 
+  if (_requestBroadcastPartCallback) {
+    descriptor.requestBroadcastPart = [this](int64_t timestampMilliseconds, int64_t durationMilliseconds,
+                                             std::function<void(tgcalls::BroadcastPart &&)> done)
+        -> std::shared_ptr<tgcalls::BroadcastPartTask> {
+      auto request = std::make_shared<BroadcastPartRequest>(timestampMilliseconds, durationMilliseconds,
+                                                            std::move(done));
+      _callbackDispatcher->Post([this, request] {
+        _requestBroadcastPartCallback(request);
+      });
+      return request;
+    };
+  }
+
+  if (_requestVideoBroadcastPartCallback) {
+    descriptor.requestVideoBroadcastPart = [this](int64_t timestampMilliseconds, int64_t durationMilliseconds,
+                                                  int32_t channelId, tgcalls::VideoChannelDescription::Quality quality,
+                                                  std::function<void(tgcalls::BroadcastPart &&)> done)
+        -> std::shared_ptr<tgcalls::BroadcastPartTask> {
+      auto request = std::make_shared<BroadcastPartRequest>(timestampMilliseconds, durationMilliseconds, channelId,
+                                                            quality, std::move(done));
+      _callbackDispatcher->Post([this, request] {
+        _requestVideoBroadcastPartCallback(request);
+      });
+      return request;
+    };
+  }
+
+  if (_useSharedEngineContext) {
+    descriptor.engineContext = sharedEngineContext();
+  }
+  if (_useCertificatePool) {
+    descriptor.certificatePool = sharedCertificatePool();
+  }
+  descriptor.useBatchedUdpSockets = _useBatchedUdpSockets;
+  descriptor.audioOnly = _audioOnly;
+  descriptor.constantBitrateAudio = _constantBitrateAudio;
+  descriptor.connectionModeCrossfadeMs = _connectionModeCrossfadeMs;
+  descriptor.broadcastPartCacheKey = _broadcastPartCacheKey;
+  descriptor.broadcastDecodedSsrcs = _broadcastDecodedSsrcs;
+  descriptor.videoEncoderConfig = _videoEncoderConfig;
+  descriptor.videoDecoderConfig = _videoDecoderConfig;
+  descriptor.fieldTrials = _fieldTrials;
+  descriptor.sharedAudioEncoder = _sharedAudioEncoder;
+  descriptor.sharedAudioDecoder = _sharedAudioDecoder;
+  descriptor.outgoingAudioBridge = _outgoingAudioBridge;
+  descriptor.outgoingOpusSource = _outgoingOpusSource;
+  descriptor.initialEnableNoiseSuppression = _noiseSuppressionEnabled;
+  descriptor.latencyTrace = _latencyTrace;
+  if (_migrationState) {
+    descriptor.outgoingAudioSsrc = _migrationState->call.outgoingAudioSsrc;
+    descriptor.initialBroadcastTimestampMilliseconds = _migrationState->call.nextBroadcastTimestampMilliseconds;
+  }
+  if (_useSharedUdpSockets) {
+    descriptor.sharedUdpSockets = sharedUdpSockets();
+  }
+
+  if (_groupCallStartedCallback) {
+    descriptor.startCompleted = [this] {
+      _callbackDispatcher->Post([this] {
+        _groupCallStartedCallback();
+      });
+    };
+  }
+  if (prewarming) {
+    // Nothing is gathered until the call is claimed, so its join is over
+    // once it has started.
+    descriptor.startCompleted = [admissionSlot, started = std::move(descriptor.startCompleted)] {
+      admissionSlot->Release();
+      if (started) {
+        started();
+      }
+    };
+  }
+
+  if (_callStatsCallback) {
+    descriptor.statsUpdated = [this](tgcalls::CallStatsSnapshot const &snapshot) {
+      _callbackDispatcher->Post([this, snapshot] {
+        _callStatsCallback(snapshot);
+      });
+    };
+    descriptor.statsUpdateIntervalMs = _callStatsIntervalMs;
+  }
+
+  if (auto getVideoSource = _audioOnly ? nullptr : outgoingVideoSource()) {
+    descriptor.getVideoSource = std::move(getVideoSource);
+    descriptor.videoContentType = tgcalls::VideoContentType::Generic;
+  }
+
+  if (_incomingAudioTap || _startingFrameAudioRenderer) {
+    descriptor.onAudioFrame = [tap = _incomingAudioTap, renderer = _startingFrameAudioRenderer](
+        uint32_t ssrc, const tgcalls::AudioFrame &frame) {
+      if (tap) {
+        tap->OnFrame(ssrc, frame);
+      }
+      if (renderer) {
+        renderer->AddFrameChannel(ssrc, frame);
+      }
+    };
+  }
+
+  if (_opusRtpRecorder || _audioBridgeSource) {
+    descriptor.onIncomingOpusPacket = [recorder = _opusRtpRecorder, bridge = _audioBridgeSource](
+        uint32_t ssrc, uint16_t sequenceNumber, uint32_t timestamp, const uint8_t *payload, size_t size) {
+      if (recorder) {
+        recorder->OnPacket(ssrc, sequenceNumber, timestamp, payload, size);
+      }
+      if (bridge) {
+        bridge->onIncomingOpusPacket(ssrc, sequenceNumber, timestamp, payload, size);
+      }
+    };
+  }
+
+  if (_videoRtpRecorder) {
+    descriptor.onIncomingVideoPacket = [recorder = _videoRtpRecorder](
+        std::string const &endpointId, tgcalls::GroupIncomingVideoPacket const &packet) {
+      recorder->OnPacket(endpointId, packet);
+    };
+  }
+
+  return std::make_unique<tgcalls::GroupInstanceCustomImpl>(std::move(descriptor));
+}
+
+std::unique_ptr<tgcalls::GroupInstanceCustomImpl> NativeInstance::claimPrewarmedGroupCall(
+    std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory *)> createAudioDeviceModule
+) {
+  PrewarmedGroupCall call;
+  bool isSuspended = false;
+  {
+    std::lock_guard<std::mutex> lock(_teardownMutex);
+    if (_suspendedGroupCall) {
+      call = std::move(*_suspendedGroupCall);
+      _suspendedGroupCall.reset();
+      isSuspended = true;
+    }
+  }
+  if (!isSuspended) {
+    if (_prewarmedGroupCalls.empty()) {
+      return nullptr;
+    }
+    call = std::move(_prewarmedGroupCalls.front());
+    _prewarmedGroupCalls.pop_front();
+  }
+
+  // Queued until the call has started, then run on the worker thread, where
+  // |device| was filled in.
+  call.instance->performWithAudioDeviceModule(
+      [device = call.device, createAudioDeviceModule = std::move(createAudioDeviceModule)](
+          rtc::scoped_refptr<tgcalls::WrappedAudioDeviceModule>) {
+        if (device->adm) {
+          device->adm->Switch(createAudioDeviceModule(device->taskQueueFactory));
+        }
+      });
+  if (isSuspended) {
+    call.instance->setIsMuted(false);
+  }
+  _groupCallDevice = std::move(call.device);
+  return std::move(call.instance);
+}
+
+void NativeInstance::reapSuspendedGroupCall(uint64_t generation) {
+  std::lock_guard<std::mutex> lock(_teardownMutex);
+  if (!_suspendedGroupCall || (generation != 0 && generation != _suspendedGroupCallGeneration)) {
+    return;
+  }
+  _pendingTeardowns.push_back(GroupCallReaper::Get().Reap(std::move(_suspendedGroupCall->instance)));
+  _suspendedGroupCall.reset();
+}
+
+void NativeInstance::createInstanceHolder(
+    std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory *)> createAudioDeviceModule,
+    std::string initialInputDeviceId = "",
+    std::string initialOutputDeviceId = ""
+) {
+  const bool canClaim = initialInputDeviceId.empty() && initialOutputDeviceId.empty() && !_migrationState &&
+                        !_startingFrameAudioRenderer;
+  if (!canClaim) {
+    reapSuspendedGroupCall();
+  }
+  auto instance = canClaim ? claimPrewarmedGroupCall(createAudioDeviceModule) : nullptr;
+  // Prewarmed calls did the expensive part of joining already.
+  std::shared_ptr<JoinAdmission::Slot> admissionSlot;
+  if (!instance) {
+    // Behind a switchable device, so that suspendGroupCall() can release
+    // the real one.
+    auto device = std::make_shared<PrewarmedGroupCall::Device>();
+    instance = createGroupInstance(
+        [device, createAudioDeviceModule = std::move(createAudioDeviceModule)](
+            webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+          auto impl = createAudioDeviceModule(taskQueueFactory);
+          if (!impl) {
+            return nullptr;
+          }
+          device->taskQueueFactory = taskQueueFactory;
+          device->adm = new rtc::RefCountedObject<SwitchableAudioDeviceModule>(impl);
+          return device->adm;
+        }, std::move(initialInputDeviceId), std::move(initialOutputDeviceId), admissionSlot);
+    // Unless the participants' frames go to this device's renderer, which
+    // another device wouldn't get.
+    _groupCallDevice = _startingFrameAudioRenderer ? nullptr : std::move(device);
+  }
+
   instanceHolder = std::make_unique<InstanceHolder>();
-  instanceHolder->groupNativeInstance = std::make_unique<tgcalls::GroupInstanceCustomImpl>(std::move(descriptor));
+  instanceHolder->groupNativeInstance = std::move(instance);
+  _groupCallInput.reset();
   instanceHolder->groupNativeInstance->emitJoinPayload(
       [=](tgcalls::GroupJoinPayload payload) {
-        _emitJoinPayloadCallback(std::move(payload));
+        if (admissionSlot) {
+          admissionSlot->Release();
+        }
+        _callbackDispatcher->Post([this, payload = std::move(payload)] {
+          _emitJoinPayloadCallback(payload);
+        });
       }
   );
+
+  if (_migrationState) {
+    auto &call = _migrationState->call;
+    tgcalls::GroupInstanceCustomImpl::ParticipantsUpdate update;
+    update.addedSsrcs = std::move(call.incomingAudioSsrcs);
+    update.volumes = std::move(call.volumes);
+    instanceHolder->groupNativeInstance->updateParticipants(std::move(update));
+    // The server's side of the transport stays the same for the call, so
+    // connectivity checks run from now on and succeed as soon as the
+    // server has the rejoin; its response is applied as usual then.
+    if (!call.joinResponsePayload.empty()) {
+      instanceHolder->groupNativeInstance->setJoinResponsePayload(call.joinResponsePayload);
+    }
+    _migrationState.reset();
+  }
 }
 
-void NativeInstance::startGroupCall(std::shared_ptr<FileAudioDeviceDescriptor> fileAudioDeviceDescriptor) {
+void NativeInstance::refuseJoinIfOverloaded() {
+  if (tgcalls::OverloadController::isRefusingJoins()) {
+    tgcalls::OverloadController::onJoinRefused();
+    throw std::runtime_error("the host is overloaded and refuses new group calls");
+  }
+}
+
+void NativeInstance::startGroupCall(std::shared_ptr<FileAudioDeviceDescriptor> fileAudioDeviceDescriptor,
+                                    bool useSharedAudioClock) {
+  refuseJoinIfOverloaded();
   _fileAudioDeviceDescriptor = std::move(fileAudioDeviceDescriptor);
+  _fileAudioDeviceDescriptor->_callbackDispatcher = _callbackDispatcher;
+  _fileAudioDeviceDescriptor->_glitches.SetDispatcher(_callbackDispatcher);
+  auto input = _fileAudioDeviceDescriptor;
+  if (_migrationState && _migrationState->inputPositionMs >= 0) {
+    // Picked up when the input is opened, before the first frame.
+    _fileAudioDeviceDescriptor->_seekRequestMs = _migrationState->inputPositionMs;
+  }
   createInstanceHolder(
-      [&](webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+      [&, useSharedAudioClock, latencyTrace = _latencyTrace](webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
         return WrappedAudioDeviceModuleImpl::Create(
-            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, std::move(_fileAudioDeviceDescriptor)
+            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, std::move(_fileAudioDeviceDescriptor), useSharedAudioClock, latencyTrace
         );
       });
+  _groupCallInput = std::move(input);
 }
 
-void NativeInstance::startGroupCall(std::shared_ptr<RawAudioDeviceDescriptor> rawAudioDeviceDescriptor) {
+void NativeInstance::startGroupCall(std::shared_ptr<RawAudioDeviceDescriptor> rawAudioDeviceDescriptor,
+                                    bool useSharedAudioClock) {
+  refuseJoinIfOverloaded();
   _rawAudioDeviceDescriptor = std::move(rawAudioDeviceDescriptor);
+  _rawAudioDeviceDescriptor->_glitches.SetDispatcher(_callbackDispatcher);
   createInstanceHolder(
-      [&](webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+      [&, useSharedAudioClock, latencyTrace = _latencyTrace](webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+        return WrappedAudioDeviceModuleImpl::Create(
+            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, std::move(_rawAudioDeviceDescriptor), useSharedAudioClock, latencyTrace
+        );
+      });
+}
+
+void NativeInstance::startGroupCall(std::shared_ptr<RingAudioDeviceDescriptor> ringAudioDeviceDescriptor,
+                                    bool useSharedAudioClock) {
+  refuseJoinIfOverloaded();
+  _ringAudioDeviceDescriptor = std::move(ringAudioDeviceDescriptor);
+  createInstanceHolder(
+      [&, useSharedAudioClock, latencyTrace = _latencyTrace](webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
         return WrappedAudioDeviceModuleImpl::Create(
-            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, std::move(_rawAudioDeviceDescriptor)
+            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, std::move(_ringAudioDeviceDescriptor), useSharedAudioClock, latencyTrace
         );
       });
 }
 
+void NativeInstance::startGroupCall(std::shared_ptr<MixerAudioDeviceDescriptor> mixerAudioDeviceDescriptor,
+                                    bool useSharedAudioClock) {
+  refuseJoinIfOverloaded();
+  _mixerAudioDeviceDescriptor = std::move(mixerAudioDeviceDescriptor);
+  createInstanceHolder(
+      [&, useSharedAudioClock, latencyTrace = _latencyTrace](webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+        return WrappedAudioDeviceModuleImpl::Create(
+            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, std::move(_mixerAudioDeviceDescriptor), useSharedAudioClock, latencyTrace
+        );
+      });
+}
+
+void NativeInstance::startGroupCall(std::shared_ptr<FrameAudioDeviceDescriptor> frameAudioDeviceDescriptor) {
+  refuseJoinIfOverloaded();
+  _frameAudioDeviceDescriptor = std::move(frameAudioDeviceDescriptor);
+  auto renderer = FrameAudioDeviceDescriptor::CreateRenderer(_frameAudioDeviceDescriptor);
+  if (_frameAudioDeviceDescriptor->_participants) {
+    _startingFrameAudioRenderer = renderer;
+  }
+  try {
+    createInstanceHolder(
+        [descriptor = _frameAudioDeviceDescriptor, renderer](webrtc::TaskQueueFactory *taskQueueFactory) {
+          return FrameAudioDeviceDescriptor::CreateAudioDeviceModule(descriptor, renderer, taskQueueFactory);
+        });
+  } catch (...) {
+    _startingFrameAudioRenderer = nullptr;
+    throw;
+  }
+  _startingFrameAudioRenderer = nullptr;
+}
+
 void NativeInstance::startGroupCall(std::string initialInputDeviceId = "", std::string initialOutputDeviceId = "") {
+  refuseJoinIfOverloaded();
   createInstanceHolder(
       [&](webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
         return webrtc::AudioDeviceModule::Create(
@@ -101,30 +462,217 @@ void NativeInstance::startGroupCall(std::string initialInputDeviceId = "", std::
       }, std::move(initialInputDeviceId), std::move(initialOutputDeviceId));
 }
 
-void NativeInstance::stopGroupCall() const {
+void NativeInstance::stopGroupCall() {
   instanceHolder->groupNativeInstance = nullptr;
+  _groupCallDevice = nullptr;
+  if (_speakerMonitor) {
+    _speakerMonitor->RemoveCall(_speakerMonitorCallId);
+  }
+}
+
+void NativeInstance::stopGroupCallAsync(std::function<void()> done) {
+  std::unique_lock<std::mutex> lock(_teardownMutex);
+  _pendingTeardowns.erase(std::remove_if(_pendingTeardowns.begin(), _pendingTeardowns.end(),
+                                         [](const std::shared_future<void> &teardown) {
+                                           return teardown.wait_for(std::chrono::seconds(0)) ==
+                                                  std::future_status::ready;
+                                         }),
+                          _pendingTeardowns.end());
+  if (!isGroupCallNativeCreated()) {
+    lock.unlock();
+    if (done) {
+      done();
+    }
+    return;
+  }
+
+  std::function<void()> onDestroyed;
+  if (done) {
+    // Copied once here, with the GIL held, so the reaper thread only has to
+    // copy a shared_ptr.
+    auto callback = std::make_shared<std::function<void()>>(std::move(done));
+    onDestroyed = [callback, dispatcher = _callbackDispatcher] {
+      dispatcher->Post([callback] {
+        (*callback)();
+      });
+    };
+  }
+  _pendingTeardowns.push_back(
+      GroupCallReaper::Get().Reap(std::move(instanceHolder->groupNativeInstance), std::move(onDestroyed)));
+  lock.unlock();
+  _groupCallDevice = nullptr;
+  if (_speakerMonitor) {
+    _speakerMonitor->RemoveCall(_speakerMonitorCallId);
+  }
+}
+
+void NativeInstance::suspendGroupCall(int keepWarmMs) {
+  if (!isGroupCallNativeCreated()) {
+    return;
+  }
+  reapSuspendedGroupCall();
+  if (keepWarmMs <= 0 || !_groupCallDevice) {
+    stopGroupCallAsync(nullptr);
+    return;
+  }
+
+  PrewarmedGroupCall call;
+  call.instance = std::move(instanceHolder->groupNativeInstance);
+  call.device = std::move(_groupCallDevice);
+  if (_speakerMonitor) {
+    _speakerMonitor->RemoveCall(_speakerMonitorCallId);
+  }
+  call.instance->setIsMuted(true);
+  // Releases the input and output at once; the dummy device keeps the
+  // engine's playout and recording running for the rejoin.
+  call.instance->performWithAudioDeviceModule(
+      [device = call.device](rtc::scoped_refptr<tgcalls::WrappedAudioDeviceModule>) {
+        if (!device->adm) {
+          return;
+        }
+        if (auto dummy = webrtc::AudioDeviceModule::Create(webrtc::AudioDeviceModule::kDummyAudio,
+                                                           device->taskQueueFactory)) {
+          device->adm->Switch(dummy);
+        }
+      });
+
+  auto mediaThread = call.instance->mediaThread();
+  uint64_t generation = 0;
+  {
+    std::lock_guard<std::mutex> lock(_teardownMutex);
+    generation = ++_suspendedGroupCallGeneration;
+    _suspendedGroupCall = std::move(call);
+  }
+  mediaThread->PostDelayedTask(RTC_FROM_HERE, [this, generation, dispatcher = _callbackDispatcher] {
+    dispatcher->Post([this, generation] {
+      reapSuspendedGroupCall(generation);
+    });
+  }, static_cast<uint32_t>(keepWarmMs));
+}
+
+bool NativeInstance::hasSuspendedGroupCall() const {
+  std::lock_guard<std::mutex> lock(_teardownMutex);
+  return _suspendedGroupCall.has_value();
 }
 
 bool NativeInstance::isGroupCallNativeCreated() const {
   return instanceHolder != nullptr && instanceHolder->groupNativeInstance != nullptr;
 }
 
+tgcalls::GroupInstanceCustomImpl &NativeInstance::runningGroupCall() const {
+  if (!isGroupCallNativeCreated()) {
+    throw std::runtime_error("the group call isn't running");
+  }
+  return *instanceHolder->groupNativeInstance;
+}
+
+py::object NativeInstance::emitJoinPayloadFuture() const {
+  auto &call = runningGroupCall();
+  auto future = AsyncFuture::Create(_callbackDispatcher);
+  call.emitJoinPayload([future](tgcalls::GroupJoinPayload const &payload) {
+    future->Resolve([payload] {
+      return py::cast(payload);
+    });
+  });
+  return future->future();
+}
+
+py::object NativeInstance::connectedFuture() const {
+  auto &call = runningGroupCall();
+  auto future = AsyncFuture::Create(_callbackDispatcher);
+  call.whenConnected([future] {
+    future->Resolve([] {
+      return py::none();
+    });
+  });
+  return future->future();
+}
+
+py::object NativeInstance::queuedTasksFuture() const {
+  auto &call = runningGroupCall();
+  auto future = AsyncFuture::Create(_callbackDispatcher);
+  call.afterQueuedTasks([future] {
+    future->Resolve([] {
+      return py::none();
+    });
+  });
+  return future->future();
+}
+
+py::object NativeInstance::stopGroupCallFuture() {
+  auto future = AsyncFuture::Create(_callbackDispatcher);
+  stopGroupCallAsync([future] {
+    future->Resolve([] {
+      return py::none();
+    });
+  });
+  return future->future();
+}
+
 void NativeInstance::emitJoinPayload(std::function<void(tgcalls::GroupJoinPayload)> const &f) const {
-  instanceHolder->groupNativeInstance->emitJoinPayload(f);
+  // Copied once here, with the GIL held, so the webrtc thread only has to
+  // copy a shared_ptr.
+  auto callback = std::make_shared<std::function<void(tgcalls::GroupJoinPayload)>>(f);
+  auto dispatcher = _callbackDispatcher;
+  instanceHolder->groupNativeInstance->emitJoinPayload(
+      [callback, dispatcher](tgcalls::GroupJoinPayload payload) {
+        dispatcher->Post([callback, payload = std::move(payload)] {
+          (*callback)(payload);
+        });
+      });
 }
 
-void NativeInstance::setJoinResponsePayload(std::string const &payload) const {
-  instanceHolder->groupNativeInstance->setJoinResponsePayload(payload);
+void NativeInstance::setJoinResponsePayload(const py::object &payload) const {
+  std::string data;
+  if (PyUnicode_Check(payload.ptr())) {
+    Py_ssize_t length = 0;
+    const char *utf8 = PyUnicode_AsUTF8AndSize(payload.ptr(), &length);
+    if (!utf8) {
+      throw py::error_already_set();
+    }
+    data.assign(utf8, static_cast<size_t>(length));
+  } else {
+    data = copyBuffer<std::string>(payload.cast<py::buffer>());
+  }
+
+  py::gil_scoped_release release;
+  instanceHolder->groupNativeInstance->setJoinResponsePayload(data);
 }
 
 void NativeInstance::setIsMuted(bool isMuted) const {
   instanceHolder->groupNativeInstance->setIsMuted(isMuted);
 }
 
+void NativeInstance::setIsNoiseSuppressionEnabled(bool enabled) {
+  _noiseSuppressionEnabled = enabled;
+  if (isGroupCallNativeCreated()) {
+    instanceHolder->groupNativeInstance->setIsNoiseSuppressionEnabled(enabled);
+  }
+}
+
 void NativeInstance::setVolume(uint32_t ssrc, double volume) const {
   instanceHolder->groupNativeInstance->setVolume(ssrc, volume);
 }
 
+void NativeInstance::removeSsrcs(std::vector<uint32_t> ssrcs) const {
+  if (!isGroupCallNativeCreated()) {
+    return;
+  }
+  instanceHolder->groupNativeInstance->removeSsrcs(std::move(ssrcs));
+}
+
+void NativeInstance::updateParticipants(std::vector<uint32_t> addedSsrcs, std::vector<uint32_t> removedSsrcs,
+                                        std::map<uint32_t, double> const &volumes) const {
+  if (!isGroupCallNativeCreated()) {
+    return;
+  }
+  tgcalls::GroupInstanceCustomImpl::ParticipantsUpdate update;
+  update.addedSsrcs = std::move(addedSsrcs);
+  update.removedSsrcs = std::move(removedSsrcs);
+  update.volumes.assign(volumes.begin(), volumes.end());
+  instanceHolder->groupNativeInstance->updateParticipants(std::move(update));
+}
+
 void NativeInstance::setConnectionMode(
     tgcalls::GroupConnectionMode connectionMode,
     bool keepBroadcastIfWasEnabled) const {
@@ -223,6 +771,86 @@ void NativeInstance::setAudioInputDevice(std::string id) const {
 void NativeInstance::startCall(vector<RtcServer> servers,
                                std::array<uint8_t, 256> authKey,
                                bool isOutgoing, string logPath) {
+  startCallInstance("3.0.0", std::move(servers), authKey, isOutgoing, std::move(logPath), nullptr);
+}
+
+void NativeInstance::startCall(vector<RtcServer> servers,
+                               std::array<uint8_t, 256> authKey,
+                               bool isOutgoing, string logPath,
+                               std::shared_ptr<FileAudioDeviceDescriptor> fileAudioDeviceDescriptor,
+                               bool useSharedAudioClock) {
+  fileAudioDeviceDescriptor->_callbackDispatcher = _callbackDispatcher;
+  fileAudioDeviceDescriptor->_glitches.SetDispatcher(_callbackDispatcher);
+  startCallInstance("4.0.0", std::move(servers), authKey, isOutgoing, std::move(logPath),
+      [fileAudioDeviceDescriptor = std::move(fileAudioDeviceDescriptor), useSharedAudioClock, latencyTrace = _latencyTrace](
+          webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+        return WrappedAudioDeviceModuleImpl::Create(
+            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, fileAudioDeviceDescriptor, useSharedAudioClock, latencyTrace
+        );
+      });
+}
+
+void NativeInstance::startCall(vector<RtcServer> servers,
+                               std::array<uint8_t, 256> authKey,
+                               bool isOutgoing, string logPath,
+                               std::shared_ptr<RawAudioDeviceDescriptor> rawAudioDeviceDescriptor,
+                               bool useSharedAudioClock) {
+  rawAudioDeviceDescriptor->_glitches.SetDispatcher(_callbackDispatcher);
+  startCallInstance("4.0.0", std::move(servers), authKey, isOutgoing, std::move(logPath),
+      [rawAudioDeviceDescriptor = std::move(rawAudioDeviceDescriptor), useSharedAudioClock, latencyTrace = _latencyTrace](
+          webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+        return WrappedAudioDeviceModuleImpl::Create(
+            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, rawAudioDeviceDescriptor, useSharedAudioClock, latencyTrace
+        );
+      });
+}
+
+void NativeInstance::startCall(vector<RtcServer> servers,
+                               std::array<uint8_t, 256> authKey,
+                               bool isOutgoing, string logPath,
+                               std::shared_ptr<RingAudioDeviceDescriptor> ringAudioDeviceDescriptor,
+                               bool useSharedAudioClock) {
+  startCallInstance("4.0.0", std::move(servers), authKey, isOutgoing, std::move(logPath),
+      [ringAudioDeviceDescriptor = std::move(ringAudioDeviceDescriptor), useSharedAudioClock, latencyTrace = _latencyTrace](
+          webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+        return WrappedAudioDeviceModuleImpl::Create(
+            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, ringAudioDeviceDescriptor, useSharedAudioClock, latencyTrace
+        );
+      });
+}
+
+void NativeInstance::startCall(vector<RtcServer> servers,
+                               std::array<uint8_t, 256> authKey,
+                               bool isOutgoing, string logPath,
+                               std::shared_ptr<MixerAudioDeviceDescriptor> mixerAudioDeviceDescriptor,
+                               bool useSharedAudioClock) {
+  startCallInstance("4.0.0", std::move(servers), authKey, isOutgoing, std::move(logPath),
+      [mixerAudioDeviceDescriptor = std::move(mixerAudioDeviceDescriptor), useSharedAudioClock, latencyTrace = _latencyTrace](
+          webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+        return WrappedAudioDeviceModuleImpl::Create(
+            webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory, mixerAudioDeviceDescriptor, useSharedAudioClock, latencyTrace
+        );
+      });
+}
+
+void NativeInstance::startCall(vector<RtcServer> servers,
+                               std::array<uint8_t, 256> authKey,
+                               bool isOutgoing, string logPath,
+                               std::shared_ptr<FrameAudioDeviceDescriptor> frameAudioDeviceDescriptor) {
+  auto renderer = FrameAudioDeviceDescriptor::CreateRenderer(frameAudioDeviceDescriptor);
+  startCallInstance("4.0.0", std::move(servers), authKey, isOutgoing, std::move(logPath),
+      [frameAudioDeviceDescriptor = std::move(frameAudioDeviceDescriptor), renderer = std::move(renderer)](
+          webrtc::TaskQueueFactory *taskQueueFactory) {
+        return FrameAudioDeviceDescriptor::CreateAudioDeviceModule(frameAudioDeviceDescriptor, renderer, taskQueueFactory);
+      });
+}
+
+void NativeInstance::startCallInstance(
+    std::string const &version,
+    vector<RtcServer> servers,
+    std::array<uint8_t, 256> const &authKey,
+    bool isOutgoing, string logPath,
+    std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory *)> createAudioDeviceModule) {
   auto encryptionKeyValue = std::make_shared<std::array<uint8_t, 256>>();
   std::memcpy(encryptionKeyValue->data(), &authKey, 256);
 
@@ -251,8 +879,6 @@ void NativeInstance::startCall(vector<RtcServer> servers,
           .enableAGC = true,
           .enableVolumeControl = true,
           .logPath = {std::move(logPath)},
-          .statsLogPath = {"/Users/marshal/projects/tgcalls/python-binding/"
-                           "pytgcalls/tgcalls-stat.txt"},
           .maxApiLayer = 92,
           .enableHighBitrateVideo = false,
           .preferredVideoCodecs = std::vector<std::string>(),
@@ -290,64 +916,401 @@ void NativeInstance::startCall(vector<RtcServer> servers,
       },
       .signalingDataEmitted =
       [=](const std::vector<uint8_t> &data) {
-        //                py::print("signalingDataEmitted");
-        signalingDataEmittedCallback(data);
+        _callbackDispatcher->Post([this, data] {
+          signalingDataEmittedCallback(data);
+        });
       },
+      .createAudioDeviceModule = std::move(createAudioDeviceModule),
   };
 
-  for (int i = 0, size = servers.size(); i < size; ++i) {
-    RtcServer rtcServer = std::move(servers.at(i));
-
-    const auto host = rtcServer.ip;
-    const auto hostv6 = rtcServer.ipv6;
-    const auto port = uint16_t(rtcServer.port);
-
-    if (rtcServer.isStun) {
-      const auto pushStun = [&](const string &host) {
-        descriptor.rtcServers.push_back(
-            tgcalls::RtcServer{.host = host, .port = port, .isTurn = false});
-      };
-      pushStun(host);
-      pushStun(hostv6);
-
-      //            descriptor.rtcServers.push_back(rtcServer.toTgcalls(false,
-      //            false));
-      //            descriptor.rtcServers.push_back(rtcServer.toTgcalls(true,
-      //            false));
-    }
-
-    //        && !rtcServer.login.empty() && !rtcServer.password.empty()
-    const auto username = rtcServer.login;
-    const auto password = rtcServer.password;
-    if (rtcServer.isTurn) {
-      const auto pushTurn = [&](const string &host) {
-        descriptor.rtcServers.push_back(tgcalls::RtcServer{
-            .host = host,
-            .port = port,
-            .login = username,
-            .password = password,
-            .isTurn = true,
-        });
-      };
-      pushTurn(host);
-      pushTurn(hostv6);
-
-      //            descriptor.rtcServers.push_back(rtcServer.toTgcalls());
-      //            descriptor.rtcServers.push_back(rtcServer.toTgcalls(true));
-    }
+  if (_callStatsCallback) {
+    descriptor.statsUpdated = [this](tgcalls::CallStatsSnapshot const &snapshot) {
+      _callbackDispatcher->Post([this, snapshot] {
+        _callStatsCallback(snapshot);
+      });
+    };
+    descriptor.statsUpdateIntervalMs = _callStatsIntervalMs;
   }
 
+  descriptor.rtcServers = BuildRtcServerList(servers, _rtcServerListOptions);
+
   instanceHolder = std::make_unique<InstanceHolder>();
   instanceHolder->nativeInstance =
-      tgcalls::Meta::Create("3.0.0", std::move(descriptor));
+      tgcalls::Meta::Create(version, std::move(descriptor));
   instanceHolder->_videoCapture = videoCapture;
   instanceHolder->nativeInstance->setNetworkType(tgcalls::NetworkType::WiFi);
   instanceHolder->nativeInstance->setRequestedVideoAspect(1);
   instanceHolder->nativeInstance->setMuteMicrophone(false);
 }
 
-void NativeInstance::receiveSignalingData(std::vector<uint8_t> &data) const {
-  instanceHolder->nativeInstance->receiveSignalingData(data);
+void NativeInstance::receiveSignalingData(const py::buffer &data) const {
+  auto bytes = copyBuffer<std::vector<uint8_t>>(data);
+
+  py::gil_scoped_release release;
+  instanceHolder->nativeInstance->receiveSignalingData(bytes);
+}
+
+void NativeInstance::setIncomingAudioTap(std::shared_ptr<IncomingAudioTap> tap) {
+  _incomingAudioTap = std::move(tap);
+}
+
+void NativeInstance::setOpusRtpRecorder(std::shared_ptr<OpusRtpRecorder> recorder) {
+  _opusRtpRecorder = std::move(recorder);
+}
+
+void NativeInstance::setVideoRtpRecorder(std::shared_ptr<VideoRtpRecorder> recorder) {
+  _videoRtpRecorder = std::move(recorder);
+}
+
+void NativeInstance::setAudioBridgeSource(std::shared_ptr<tgcalls::GroupAudioBridge> bridge) {
+  _audioBridgeSource = std::move(bridge);
+}
+
+void NativeInstance::setRequestedVideoChannels(std::vector<tgcalls::VideoChannelDescription> channels) const {
+  if (!isGroupCallNativeCreated()) {
+    return;
+  }
+  instanceHolder->groupNativeInstance->setRequestedVideoChannels(std::move(channels));
+}
+
+void NativeInstance::setBroadcastDecodedSsrcs(std::vector<uint32_t> ssrcs) {
+  _broadcastDecodedSsrcs = ssrcs;
+  if (!isGroupCallNativeCreated()) {
+    return;
+  }
+  instanceHolder->groupNativeInstance->setBroadcastDecodedSsrcs(std::move(ssrcs));
+}
+
+void NativeInstance::setVideoSource(std::shared_ptr<RawVideoDeviceDescriptor> source) {
+  _rawVideoDeviceDescriptor = std::move(source);
+  _fileVideoSource = nullptr;
+  updateOutgoingVideoSource();
+}
+
+void NativeInstance::setVideoSource(std::shared_ptr<FileVideoSource> source) {
+  _fileVideoSource = std::move(source);
+  _rawVideoDeviceDescriptor = nullptr;
+  updateOutgoingVideoSource();
+}
+
+std::function<webrtc::VideoTrackSourceInterface *()> NativeInstance::outgoingVideoSource() const {
+  if (_rawVideoDeviceDescriptor) {
+    return _rawVideoDeviceDescriptor->getVideoSource();
+  }
+  if (_fileVideoSource) {
+    return _fileVideoSource->GetVideoSource();
+  }
+  return nullptr;
+}
+
+void NativeInstance::updateOutgoingVideoSource() const {
+  if (!isGroupCallNativeCreated()) {
+    return;
+  }
+  instanceHolder->groupNativeInstance->setVideoSource(outgoingVideoSource());
+}
+
+void NativeInstance::addIncomingVideoSink(std::string const &endpointId, std::shared_ptr<IncomingVideoSink> sink,
+                                          size_t queueDepth) {
+  if (!isGroupCallNativeCreated() || !sink) {
+    return;
+  }
+  auto &sinks = _incomingVideoSinks[endpointId];
+  for (const auto &attached : sinks) {
+    if (attached.sink == sink) {
+      instanceHolder->groupNativeInstance->addIncomingVideoOutput(endpointId, attached.output, sink->wants());
+      return;
+    }
+  }
+
+  sink->setDispatcher(_callbackDispatcher);
+  AttachedVideoSink attached;
+  attached.sink = sink;
+  if (queueDepth == 0) {
+    attached.output = sink;
+  } else {
+    attached.output = std::make_shared<tgcalls::QueuedVideoSink>(sink, queueDepth);
+  }
+  sinks.push_back(attached);
+  instanceHolder->groupNativeInstance->addIncomingVideoOutput(endpointId, attached.output, sink->wants());
+}
+
+void NativeInstance::removeIncomingVideoSinks(std::string const &endpointId) {
+  _incomingVideoSinks.erase(endpointId);
+}
+
+void NativeInstance::setPlayoutMixingDisabled(bool disabled) {
+  _disablePlayoutMixing = disabled;
+}
+
+void NativeInstance::setMaxDecodedIncomingAudioStreams(int count) {
+  _maxDecodedIncomingAudioStreams = count;
+}
+
+void NativeInstance::setParallelAudioDecoding(int deadlineUs) {
+  _parallelAudioDecodingDeadlineUs = std::max(0, deadlineUs);
+}
+
+void NativeInstance::setConnectionModeCrossfade(int crossfadeMs) {
+  _connectionModeCrossfadeMs = crossfadeMs;
+}
+
+void NativeInstance::setBroadcastPartCacheKey(std::string key) {
+  _broadcastPartCacheKey = std::move(key);
+}
+
+void NativeInstance::setDummyChannelEnabled(bool enabled) {
+  _useDummyChannel = enabled;
+}
+
+void NativeInstance::setOutgoingAudioProfile(tgcalls::GroupAudioEncoderProfile profile) {
+  _outgoingAudioProfile = profile;
+}
+
+void NativeInstance::setOutgoingVoiceGate(tgcalls::GroupVoiceGate gate) {
+  _outgoingVoiceGate = gate;
+}
+
+void NativeInstance::setIncomingAudioProfile(tgcalls::GroupAudioReceiveProfile profile) {
+  _incomingAudioProfile = profile;
+}
+
+void NativeInstance::setAudioMixer(tgcalls::GroupAudioMixerConfig config) {
+  _audioMixer = config;
+}
+
+void NativeInstance::setSharedAudioEncoder(std::shared_ptr<tgcalls::GroupSharedAudioEncoder> encoder) {
+  _sharedAudioEncoder = std::move(encoder);
+}
+
+void NativeInstance::setSharedAudioDecoder(std::shared_ptr<tgcalls::GroupSharedAudioDecoder> decoder) {
+  _sharedAudioDecoder = std::move(decoder);
+}
+
+void NativeInstance::setOutgoingAudioBridge(std::shared_ptr<tgcalls::GroupAudioBridge> bridge) {
+  _outgoingAudioBridge = std::move(bridge);
+}
+
+void NativeInstance::setOutgoingOpusSource(std::shared_ptr<OggOpusFileSource> source) {
+  _outgoingOpusSource = std::move(source);
+}
+
+void NativeInstance::setVideoEncoderConfig(std::string hardwareEncoder, std::string hardwareDevice, int maxThreads,
+                                           tgcalls::GroupVideoEncoderConfig::Complexity complexity,
+                                           bool parallelSimulcast) {
+  _videoEncoderConfig.hardwareEncoder = std::move(hardwareEncoder);
+  _videoEncoderConfig.hardwareDevice = std::move(hardwareDevice);
+  _videoEncoderConfig.maxThreads = std::max(maxThreads, 0);
+  _videoEncoderConfig.complexity = complexity;
+  _videoEncoderConfig.parallelSimulcast = parallelSimulcast;
+}
+
+void NativeInstance::setVideoDecoderConfig(std::string hardwareDeviceType, std::string hardwareDevice) {
+  _videoDecoderConfig.hardwareDeviceType = std::move(hardwareDeviceType);
+  _videoDecoderConfig.hardwareDevice = std::move(hardwareDevice);
+}
+
+void NativeInstance::setFieldTrials(std::string trials) {
+  _fieldTrials = std::move(trials);
+}
+
+void NativeInstance::setRtcServerOptions(RtcServerFamily family, size_t maxTurnServers) {
+  _rtcServerListOptions.family = family;
+  _rtcServerListOptions.maxTurnServers = maxTurnServers;
+}
+
+void NativeInstance::setAudioLevelsCallback(ParticipantLevels::Callback callback, int intervalMs, bool nativeVad) {
+  if (callback) {
+    _participantLevels = std::make_shared<ParticipantLevels>(std::move(callback), _callbackDispatcher);
+  } else {
+    _participantLevels = nullptr;
+  }
+  _audioLevelsIntervalMs = intervalMs;
+  _enableIncomingVad = nativeVad;
+}
+
+void NativeInstance::setSpeakerMonitor(std::shared_ptr<SpeakerMonitor> monitor, int64_t callId) {
+  _speakerMonitor = std::move(monitor);
+  _speakerMonitorCallId = callId;
+}
+
+void NativeInstance::setEventQueue(std::shared_ptr<EventQueue> queue) {
+  _callbackDispatcher->SetEventQueue(std::move(queue));
+}
+
+void NativeInstance::setCallStatsCallback(std::function<void(tgcalls::CallStatsSnapshot)> callback, int intervalMs) {
+  _callStatsCallback = std::move(callback);
+  _callStatsIntervalMs = intervalMs;
+}
+
+void NativeInstance::setLatencyTracingEnabled(bool enabled) {
+  if (!enabled) {
+    _latencyTrace = nullptr;
+  } else if (!_latencyTrace) {
+    _latencyTrace = std::make_shared<tgcalls::LatencyTrace>();
+  }
+}
+
+std::vector<tgcalls::LatencyTrace::StageSummary> NativeInstance::getLatencyTrace() const {
+  return _latencyTrace ? _latencyTrace->summarize() : std::vector<tgcalls::LatencyTrace::StageSummary>();
+}
+
+void NativeInstance::resetLatencyTrace() {
+  if (_latencyTrace) {
+    _latencyTrace->reset();
+  }
+}
+
+void NativeInstance::setUseSharedEngineContext(bool enabled) {
+  _useSharedEngineContext = enabled;
+}
+
+void NativeInstance::setAudioOnly(bool enabled) {
+  _audioOnly = enabled;
+}
+
+void NativeInstance::setConstantBitrateAudio(bool enabled) {
+  _constantBitrateAudio = enabled;
+}
+
+void NativeInstance::setGroupCallStartedCallback(std::function<void()> f) {
+  _groupCallStartedCallback = std::move(f);
+}
+
+void NativeInstance::setRequestBroadcastPartCallback(std::function<void(std::shared_ptr<BroadcastPartRequest>)> f) {
+  _requestBroadcastPartCallback = std::move(f);
+}
+
+void NativeInstance::setRequestVideoBroadcastPartCallback(std::function<void(std::shared_ptr<BroadcastPartRequest>)> f) {
+  _requestVideoBroadcastPartCallback = std::move(f);
+}
+
+void NativeInstance::prewarmGroupCalls(size_t count) {
+  while (_prewarmedGroupCalls.size() < count) {
+    PrewarmedGroupCall call;
+    call.device = std::make_shared<PrewarmedGroupCall::Device>();
+    std::shared_ptr<JoinAdmission::Slot> admissionSlot;
+    call.instance = createGroupInstance(
+        [device = call.device](webrtc::TaskQueueFactory *taskQueueFactory) -> rtc::scoped_refptr<webrtc::AudioDeviceModule> {
+          auto dummy = webrtc::AudioDeviceModule::Create(webrtc::AudioDeviceModule::kDummyAudio, taskQueueFactory);
+          if (!dummy) {
+            return nullptr;
+          }
+          device->taskQueueFactory = taskQueueFactory;
+          device->adm = new rtc::RefCountedObject<SwitchableAudioDeviceModule>(dummy);
+          return device->adm;
+        }, "", "", admissionSlot, true);
+    _prewarmedGroupCalls.push_back(std::move(call));
+  }
+}
+
+size_t NativeInstance::prewarmedGroupCallCount() const {
+  return _prewarmedGroupCalls.size();
+}
+
+void NativeInstance::clearPrewarmedGroupCalls() {
+  _prewarmedGroupCalls.clear();
+}
+
+tgcalls::GroupInstanceCustomImpl::StartupLatency NativeInstance::getStartupLatency() const {
+  if (!isGroupCallNativeCreated()) {
+    return {};
+  }
+  return instanceHolder->groupNativeInstance->getStartupLatency();
+}
+
+tgcalls::GroupInstanceCustomImpl::ReconnectStats NativeInstance::getReconnectStats() const {
+  if (!isGroupCallNativeCreated()) {
+    return {};
+  }
+  return instanceHolder->groupNativeInstance->getReconnectStats();
+}
+
+tgcalls::GroupInstanceCustomImpl::NoiseSuppressionStats NativeInstance::getNoiseSuppressionStats() const {
+  if (!isGroupCallNativeCreated()) {
+    return {};
+  }
+  return instanceHolder->groupNativeInstance->getNoiseSuppressionStats();
+}
+
+tgcalls::GroupInstanceCustomImpl::AudioMixerStats NativeInstance::getAudioMixerStats() const {
+  if (!isGroupCallNativeCreated()) {
+    return {};
+  }
+  return instanceHolder->groupNativeInstance->getAudioMixerStats();
+}
+
+tgcalls::GroupInstanceCustomImpl::MediaStats NativeInstance::getMediaStats() const {
+  if (!isGroupCallNativeCreated()) {
+    return {};
+  }
+  return instanceHolder->groupNativeInstance->getMediaStats();
+}
+
+tgcalls::GroupInstanceCustomImpl::MemoryUsage NativeInstance::getMemoryUsage() const {
+  if (!isGroupCallNativeCreated()) {
+    return {};
+  }
+  return instanceHolder->groupNativeInstance->getMemoryUsage();
+}
+
+tgcalls::CpuAccount::Usage NativeInstance::getCpuUsage() const {
+  if (!isGroupCallNativeCreated()) {
+    return {};
+  }
+  return instanceHolder->groupNativeInstance->getCpuUsage();
+}
+
+GroupCallMigrationState NativeInstance::exportMigrationState() const {
+  GroupCallMigrationState state;
+  if (!isGroupCallNativeCreated()) {
+    return state;
+  }
+  state.call = instanceHolder->groupNativeInstance->getMigrationState();
+  if (auto input = _groupCallInput.lock()) {
+    state.inputPositionMs = input->_inputPositionMs.load();
+  }
+  return state;
+}
+
+void NativeInstance::setMigrationState(GroupCallMigrationState state) {
+  _migrationState = std::move(state);
+}
+
+std::shared_ptr<tgcalls::GroupEngineContext> NativeInstance::sharedEngineContext() {
+  static const auto context = std::make_shared<tgcalls::GroupEngineContext>();
+  return context;
+}
+
+void NativeInstance::setUseCertificatePool(bool enabled) {
+  _useCertificatePool = enabled;
+}
+
+std::shared_ptr<tgcalls::GroupCertificatePool> NativeInstance::sharedCertificatePool() {
+  static const auto pool = std::make_shared<tgcalls::GroupCertificatePool>();
+  return pool;
+}
+
+void NativeInstance::setUseBatchedUdpSockets(bool enabled) {
+  _useBatchedUdpSockets = enabled;
+}
+
+void NativeInstance::setUseSharedUdpSockets(bool enabled) {
+  _useSharedUdpSockets = enabled;
+}
+
+std::shared_ptr<tgcalls::GroupSharedUdpSockets> NativeInstance::sharedUdpSockets() {
+  static const auto sockets = std::make_shared<tgcalls::GroupSharedUdpSockets>();
+  return sockets;
+}
+
+void NativeInstance::setIncomingAudioChannelPool(int poolSize, int idleTimeoutMs) {
+  _incomingAudioChannelPoolSize = poolSize;
+  _incomingAudioChannelIdleTimeoutMs = idleTimeoutMs;
+}
+
+void NativeInstance::setSsrcStateIdleTimeout(int timeoutMs) {
+  _ssrcStateIdleTimeoutMs = timeoutMs;
 }
 
 void NativeInstance::setSignalingDataEmittedCallback(
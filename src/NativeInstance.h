@@ -1,17 +1,67 @@
 #pragma once
 
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+
 #include <pybind11/pybind11.h>
 
 #include <modules/audio_device/include/audio_device.h>
+#include <tgcalls/LatencyTrace.h>
 #include <tgcalls/ThreadLocalObject.h>
+#include <tgcalls/group/GroupAudioBridge.h>
+#include <tgcalls/group/GroupCertificatePool.h>
+#include <tgcalls/group/GroupSharedAudioDecoder.h>
+#include <tgcalls/group/GroupSharedAudioEncoder.h>
+#include <tgcalls/group/GroupSharedUdpSockets.h>
+#include <tgcalls/group/GroupEngineContext.h>
 
 #include "config.h"
+#include "AsyncFuture.h"
+#include "BroadcastPartRequest.h"
+#include "FileVideoSource.h"
+#include "FrameAudioDeviceDescriptor.h"
+#include "GroupCallReaper.h"
+#include "CallbackDispatcher.h"
+#include "IncomingAudioTap.h"
+#include "IncomingVideoSink.h"
 #include "InstanceHolder.h"
+#include "JoinAdmission.h"
+#include "OggOpusFileSource.h"
+#include "OpusRtpRecorder.h"
+#include "ParticipantLevels.h"
+#include "RawVideoDeviceDescriptor.h"
 #include "RtcServer.h"
+#include "SpeakerMonitor.h"
+#include "SwitchableAudioDeviceModule.h"
+#include "VideoRtpRecorder.h"
 #include "WrappedAudioDeviceModuleImpl.h"
 
 namespace py = pybind11;
 
+// What the instance of a group call leaving a node hands to the one taking
+// over elsewhere; see exportMigrationState().
+struct GroupCallMigrationState {
+    tgcalls::GroupInstanceCustomImpl::MigrationState call;
+    // Playback position of the file device's input; -1 for other devices.
+    int64_t inputPositionMs = -1;
+};
+
+// A group call built ahead of startGroupCall() on a dummy audio device: its
+// DTLS certificate, media engine and call exist, but it hasn't joined. Also
+// a call left by suspendGroupCall(), whose transport is connected as well.
+struct PrewarmedGroupCall {
+    struct Device {
+        // Set on the worker thread when the instance creates its ADM.
+        rtc::scoped_refptr<SwitchableAudioDeviceModule> adm;
+        webrtc::TaskQueueFactory *taskQueueFactory = nullptr;
+    };
+
+    std::unique_ptr<tgcalls::GroupInstanceCustomImpl> instance;
+    std::shared_ptr<Device> device;
+};
+
 class NativeInstance {
 public:
     std::unique_ptr<InstanceHolder> instanceHolder;
@@ -20,19 +70,191 @@ public:
     string _logPath;
 
     int _outgoingAudioBitrateKbit = 128;
+    // Receive-only group calls: playout gets silence and incoming audio is
+    // only decoded for |_incomingAudioTap|, if any.
+    bool _disablePlayoutMixing = false;
+    // Warm receive channels and the silence after which a speaker's channel
+    // is released; both apply to calls started afterwards.
+    int _incomingAudioChannelPoolSize = 2;
+    int _incomingAudioChannelIdleTimeoutMs = 1000;
+    // Per-SSRC state of participants silent this long is dropped, in calls
+    // started afterwards; 0 keeps it.
+    int _ssrcStateIdleTimeoutMs = 60000;
+    // Loudest / most recent speakers decoded at once.
+    int _maxDecodedIncomingAudioStreams = 5;
+    // Incoming streams of calls started afterwards are decoded in parallel
+    // before each playout mix when non-zero; see
+    // setParallelAudioDecoding().
+    int _parallelAudioDecodingDeadlineUs = 0;
+    // Whether calls started afterwards create the dummy incoming channel.
+    bool _useDummyChannel = true;
+    // RTC / broadcast crossfade of setConnectionMode(), in calls started
+    // afterwards.
+    int _connectionModeCrossfadeMs = 300;
+    // Broadcast parts of calls started afterwards are fetched and decoded
+    // once between every call in the process with the same key.
+    std::string _broadcastPartCacheKey;
+    // Broadcast SSRCs decoded by the current call and those started
+    // afterwards; empty for all.
+    std::vector<uint32_t> _broadcastDecodedSsrcs;
+    // Jitter buffering of every incoming stream of calls started afterwards.
+    tgcalls::GroupAudioReceiveProfile _incomingAudioProfile;
+    // Playout mixing of calls started afterwards; see setAudioMixer().
+    tgcalls::GroupAudioMixerConfig _audioMixer;
+    // Outgoing Opus encoding of calls started afterwards; bitrates it leaves
+    // at 0 come from |_outgoingAudioBitrateKbit|.
+    tgcalls::GroupAudioEncoderProfile _outgoingAudioProfile;
+    // Silence gating of the recorded input of calls started afterwards.
+    tgcalls::GroupVoiceGate _outgoingVoiceGate;
+    // Shared with the other calls sending the same audio, if any.
+    std::shared_ptr<tgcalls::GroupSharedAudioEncoder> _sharedAudioEncoder;
+    // Shared with the other calls receiving the same participants, if any.
+    std::shared_ptr<tgcalls::GroupSharedAudioDecoder> _sharedAudioDecoder;
+    // Relays a participant of another call as the outgoing audio of calls
+    // started afterwards, instead of what they capture.
+    std::shared_ptr<tgcalls::GroupAudioBridge> _outgoingAudioBridge;
+    // Sent as the outgoing audio of the next call started, instead of what
+    // it captures.
+    std::shared_ptr<OggOpusFileSource> _outgoingOpusSource;
+    // Outgoing video encoders of calls started afterwards.
+    tgcalls::GroupVideoEncoderConfig _videoEncoderConfig;
+    // Incoming video decoders of calls started afterwards.
+    tgcalls::GroupVideoDecoderConfig _videoDecoderConfig;
+    // WebRTC field trials of calls started afterwards, over the defaults.
+    std::string _fieldTrials;
+    // How startCall() turns its servers into the call's STUN / TURN list.
+    RtcServerListOptions _rtcServerListOptions;
+    // Capture noise suppression, for the running call and those started
+    // afterwards; a call can only toggle it if it started with it on.
+    bool _noiseSuppressionEnabled = false;
 
     std::function<void(const std::vector<uint8_t> &data)> signalingDataEmittedCallback;
 
     std::function<void(tgcalls::GroupJoinPayload payload)> _emitJoinPayloadCallback = nullptr;
     std::function<void(bool)> _networkStateUpdated = nullptr;
+    // Called once a group call has created its media engine; until then
+    // only its join payload is available.
+    std::function<void()> _groupCallStartedCallback = nullptr;
+    // Asked for every broadcast part a group call in broadcast mode needs;
+    // the part is delivered with BroadcastPartRequest::complete(). Without
+    // it, broadcast mode never receives any audio.
+    std::function<void(std::shared_ptr<BroadcastPartRequest>)> _requestBroadcastPartCallback = nullptr;
+    // The same for the video parts of participants whose video is requested
+    // and has an output attached. Without it, broadcast mode has no video.
+    std::function<void(std::shared_ptr<BroadcastPartRequest>)> _requestVideoBroadcastPartCallback = nullptr;
+
+    // Every callback into Python raised from a webrtc thread goes through
+    // here, so those threads never wait for the GIL themselves.
+    std::shared_ptr<CallbackDispatcher> _callbackDispatcher;
 
     std::shared_ptr<FileAudioDeviceDescriptor> _fileAudioDeviceDescriptor;
     std::shared_ptr<RawAudioDeviceDescriptor> _rawAudioDeviceDescriptor;
+    std::shared_ptr<RingAudioDeviceDescriptor> _ringAudioDeviceDescriptor;
+    // Receives the decoded audio of subscribed participants of group calls
+    // started after it is set.
+    std::shared_ptr<IncomingAudioTap> _incomingAudioTap;
+    // Records the incoming Opus of group calls started after it is set,
+    // without decoding it.
+    std::shared_ptr<OpusRtpRecorder> _opusRtpRecorder;
+    // Records the incoming video of group calls started after it is set,
+    // without decoding it.
+    std::shared_ptr<VideoRtpRecorder> _videoRtpRecorder;
+    // Fed the incoming Opus of group calls started after it is set, to relay
+    // one of their participants into another call.
+    std::shared_ptr<tgcalls::GroupAudioBridge> _audioBridgeSource;
+    std::shared_ptr<MixerAudioDeviceDescriptor> _mixerAudioDeviceDescriptor;
+    std::shared_ptr<FrameAudioDeviceDescriptor> _frameAudioDeviceDescriptor;
+    // Of the frame device being started, while startGroupCall() creates the
+    // call, which hands it the participants' frames.
+    std::shared_ptr<tgcalls::FakeAudioDeviceModule::Renderer> _startingFrameAudioRenderer;
+    // Outgoing video of group calls, at most one of them: sent by calls
+    // started after it is set, and by the running one when set with
+    // setVideoSource().
+    std::shared_ptr<RawVideoDeviceDescriptor> _rawVideoDeviceDescriptor;
+    std::shared_ptr<FileVideoSource> _fileVideoSource;
+    struct AttachedVideoSink {
+        std::shared_ptr<IncomingVideoSink> sink;
+        // What the call delivers to: |sink| or a queue in front of it.
+        std::shared_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> output;
+    };
+    // The group call only holds weak references to its video sinks; these
+    // keep them, and the queues delivering to them, attached until
+    // removeIncomingVideoSinks().
+    std::map<std::string, std::vector<AttachedVideoSink>> _incomingVideoSinks;
+    // Receives every participant's level and speaking state in group calls
+    // started after it is set; see setAudioLevelsCallback().
+    std::shared_ptr<ParticipantLevels> _participantLevels;
+    int _audioLevelsIntervalMs = 100;
+    bool _enableIncomingVad = false;
+    // Group calls started after it is set create no incoming audio
+    // channels and report who is speaking to it, as |_speakerMonitorCallId|.
+    std::shared_ptr<SpeakerMonitor> _speakerMonitor;
+    int64_t _speakerMonitorCallId = 0;
+    // Receives periodic stats of the calls started after it is set; see
+    // setCallStatsCallback().
+    std::function<void(tgcalls::CallStatsSnapshot)> _callStatsCallback = nullptr;
+    int _callStatsIntervalMs = 5000;
+    // Shared with the audio devices and group calls started while tracing
+    // is enabled; see setLatencyTracingEnabled().
+    std::shared_ptr<tgcalls::LatencyTrace> _latencyTrace;
+    // Group calls started afterwards share codec factories and probed video
+    // formats with every other call that does, via sharedEngineContext().
+    bool _useSharedEngineContext = false;
+    // Group calls started afterwards join without video; see
+    // GroupInstanceDescriptor::audioOnly.
+    bool _audioOnly = false;
+    // Group calls started afterwards send audio at a fixed bitrate, without
+    // transport-wide congestion control; see
+    // GroupInstanceDescriptor::constantBitrateAudio.
+    bool _constantBitrateAudio = false;
+    // Group calls started afterwards take their DTLS certificate from
+    // sharedCertificatePool() instead of generating it while joining.
+    bool _useCertificatePool = false;
+    // Group calls started afterwards move UDP datagrams in batches; see
+    // tgcalls::BatchedPacketSocketFactory.
+    bool _useBatchedUdpSockets = false;
+    // Group calls started afterwards share UDP sockets with every other
+    // call that does, via sharedUdpSockets().
+    bool _useSharedUdpSockets = false;
+    // Group calls handed to GroupCallReaper by stopGroupCallAsync(), waited
+    // for by the destructor: they call back into this instance until gone.
+    std::vector<std::shared_future<void>> _pendingTeardowns;
+    // Guards |_pendingTeardowns| and the suspended call, which expire on the
+    // callback dispatcher while startGroupCall() runs without the GIL.
+    mutable std::mutex _teardownMutex;
+    // Claimed front first by startGroupCall(); built with the settings and
+    // callbacks in effect when prewarmGroupCalls() was called.
+    std::deque<PrewarmedGroupCall> _prewarmedGroupCalls;
+    // The running group call's device, which suspendGroupCall() swaps out.
+    std::shared_ptr<PrewarmedGroupCall::Device> _groupCallDevice;
+    // Left by suspendGroupCall() and claimed by the next startGroupCall()
+    // ahead of the prewarmed calls; its expiry only reaps it while
+    // |_suspendedGroupCallGeneration| is still the one it was set for.
+    // Under |_teardownMutex|.
+    std::optional<PrewarmedGroupCall> _suspendedGroupCall;
+    uint64_t _suspendedGroupCallGeneration = 0;
+    // Taken over by the next startGroupCall(); see setMigrationState().
+    std::optional<GroupCallMigrationState> _migrationState;
+    // The input of the running group call, when it plays a file.
+    std::weak_ptr<FileAudioDeviceDescriptor> _groupCallInput;
 
     NativeInstance(bool, string);
     ~NativeInstance();
 
     void startCall(vector<RtcServer> servers, std::array<uint8_t, 256> authKey, bool isOutgoing, std::string logPath);
+    // 1:1 calls on InstanceV2, with the audio of a custom device instead of
+    // the platform audio layer.
+    void startCall(vector<RtcServer> servers, std::array<uint8_t, 256> authKey, bool isOutgoing, std::string logPath,
+                   std::shared_ptr<FileAudioDeviceDescriptor>, bool useSharedAudioClock = false);
+    void startCall(vector<RtcServer> servers, std::array<uint8_t, 256> authKey, bool isOutgoing, std::string logPath,
+                   std::shared_ptr<RawAudioDeviceDescriptor>, bool useSharedAudioClock = false);
+    void startCall(vector<RtcServer> servers, std::array<uint8_t, 256> authKey, bool isOutgoing, std::string logPath,
+                   std::shared_ptr<RingAudioDeviceDescriptor>, bool useSharedAudioClock = false);
+    void startCall(vector<RtcServer> servers, std::array<uint8_t, 256> authKey, bool isOutgoing, std::string logPath,
+                   std::shared_ptr<MixerAudioDeviceDescriptor>, bool useSharedAudioClock = false);
+    // Always on the shared audio clock.
+    void startCall(vector<RtcServer> servers, std::array<uint8_t, 256> authKey, bool isOutgoing, std::string logPath,
+                   std::shared_ptr<FrameAudioDeviceDescriptor>);
 
     void setupGroupCall(
             std::function<void(tgcalls::GroupJoinPayload)> &,
@@ -40,14 +262,50 @@ public:
             int
     );
 
-    void startGroupCall(std::shared_ptr<FileAudioDeviceDescriptor>);
-    void startGroupCall(std::shared_ptr<RawAudioDeviceDescriptor>);
+    // Throw while the OverloadController refuses new joins.
+    void startGroupCall(std::shared_ptr<FileAudioDeviceDescriptor>, bool useSharedAudioClock = false);
+    void startGroupCall(std::shared_ptr<RawAudioDeviceDescriptor>, bool useSharedAudioClock = false);
+    void startGroupCall(std::shared_ptr<RingAudioDeviceDescriptor>, bool useSharedAudioClock = false);
+    void startGroupCall(std::shared_ptr<MixerAudioDeviceDescriptor>, bool useSharedAudioClock = false);
+    // Always on the shared audio clock. Not claimed from the prewarmed calls
+    // when the descriptor takes the participants' frames, which those were
+    // built without.
+    void startGroupCall(std::shared_ptr<FrameAudioDeviceDescriptor>);
     void startGroupCall(std::string, std::string);
-    void stopGroupCall() const;
+    void stopGroupCall();
+    // Returns at once; the call is destroyed on GroupCallReaper's thread,
+    // after which |done|, if any, is called.
+    void stopGroupCallAsync(std::function<void()> done);
+    // Leaves the running group call but keeps its transport, DTLS session
+    // and media engine for |keepWarmMs|: it is muted and its audio device
+    // is swapped for a dummy one. A startGroupCall() within that time takes
+    // it over on the new device and emits the same join payload, so the
+    // rejoin skips ICE gathering, DTLS and engine setup; the caller leaves
+    // and rejoins the chat itself as usual. Past that time, or with 0, it
+    // is destroyed as by stopGroupCallAsync().
+    void suspendGroupCall(int keepWarmMs);
+    bool hasSuspendedGroupCall() const;
     bool isGroupCallNativeCreated() const;
 
+    // Awaitables of the group call's lifecycle: asyncio futures of the
+    // running loop, so many joins can be pipelined from one loop without a
+    // thread blocked on any. Each raises RuntimeError if the call goes away
+    // before it completes.
+    py::object emitJoinPayloadFuture() const;
+    py::object connectedFuture() const;
+    // Done once what was queued before, e.g. setJoinResponsePayload() or a
+    // device change, is applied.
+    py::object queuedTasksFuture() const;
+    py::object stopGroupCallFuture();
+
     void setIsMuted(bool isMuted) const;
+    void setIsNoiseSuppressionEnabled(bool enabled);
     void setVolume(uint32_t ssrc, double volume) const;
+    void removeSsrcs(std::vector<uint32_t> ssrcs) const;
+    // Adds, removes and sets the volume of many participants in one media
+    // thread task.
+    void updateParticipants(std::vector<uint32_t> addedSsrcs, std::vector<uint32_t> removedSsrcs,
+                            std::map<uint32_t, double> const &volumes) const;
     void emitJoinPayload(std::function<void(tgcalls::GroupJoinPayload payload)> const &) const;
     void setConnectionMode(tgcalls::GroupConnectionMode, bool) const;
 
@@ -63,14 +321,200 @@ public:
     void setAudioOutputDevice(std::string id) const;
     void setAudioInputDevice(std::string id) const;
 
-    void receiveSignalingData(std::vector<uint8_t> &data) const;
-    void setJoinResponsePayload(std::string const &) const;
+    // Both take any contiguous bytes-like object, copied once with the GIL
+    // held and handed over without it; the payload also takes a str.
+    void receiveSignalingData(const py::buffer &data) const;
+    void setJoinResponsePayload(const py::object &payload) const;
+    void setIncomingAudioTap(std::shared_ptr<IncomingAudioTap> tap);
+    void setOpusRtpRecorder(std::shared_ptr<OpusRtpRecorder> recorder);
+    void setVideoRtpRecorder(std::shared_ptr<VideoRtpRecorder> recorder);
+    void setAudioBridgeSource(std::shared_ptr<tgcalls::GroupAudioBridge> bridge);
+    // Video is only received for the channels requested here; each call
+    // replaces the previous set.
+    void setRequestedVideoChannels(std::vector<tgcalls::VideoChannelDescription> channels) const;
+    // Decodes only these speakers of broadcast parts, from the next part on,
+    // skipping the others' Opus streams; empty decodes everyone.
+    void setBroadcastDecodedSsrcs(std::vector<uint32_t> ssrcs);
+    // Sends the decoded video of |endpointId| to |sink|, or the local
+    // camera's when it is our own endpoint.
+    // Sends |source| as the group call's outgoing video, or stops sending
+    // video without one. Calls started afterwards send it from the start.
+    void setVideoSource(std::shared_ptr<RawVideoDeviceDescriptor> source);
+    void setVideoSource(std::shared_ptr<FileVideoSource> source);
+    // An endpoint's video is only decoded while it has sinks, and requested
+    // at no higher quality than the largest of their size limits needs.
+    // Adding a sink again sends its current size limit and keeps its queue.
+    // With a non-zero |queueDepth|, |sink| is called from a thread of its
+    // own with up to that many frames waiting, so that it can't hold up the
+    // decoder and the endpoint's other sinks.
+    void addIncomingVideoSink(std::string const &endpointId, std::shared_ptr<IncomingVideoSink> sink, size_t queueDepth = 0);
+    void removeIncomingVideoSinks(std::string const &endpointId);
+    void setPlayoutMixingDisabled(bool disabled);
+    void setIncomingAudioChannelPool(int poolSize, int idleTimeoutMs);
+    void setSsrcStateIdleTimeout(int timeoutMs);
+    void setMaxDecodedIncomingAudioStreams(int count);
+    // Decodes the incoming streams of calls started afterwards on a small
+    // pool before each playout mix, so that a room with many speakers
+    // doesn't hold up playout; those not decoded |deadlineUs| into the mix
+    // are concealed for it. 0 decodes them one after another while mixing.
+    void setParallelAudioDecoding(int deadlineUs);
+    // How long switching between RTC and broadcast, keeping the mode switched
+    // from until the new one connects, crossfades their audio; 0 cuts over.
+    void setConnectionModeCrossfade(int crossfadeMs);
+    // Calls started afterwards share broadcast parts with the others that
+    // use |key|, e.g. the chat's id, so N listeners of one chat cost about
+    // one; empty shares nothing. See tgcalls::BroadcastPartCache.
+    void setBroadcastPartCacheKey(std::string key);
+    // Calls started afterwards skip the incoming channel kept only so
+    // playout runs; worth it for calls that never play anything.
+    void setDummyChannelEnabled(bool enabled);
+    // DTX, FEC, packet duration, bitrate range and complexity of outgoing
+    // audio, for calls started afterwards.
+    void setOutgoingAudioProfile(tgcalls::GroupAudioEncoderProfile profile);
+    // Calls started afterwards stop sending the recorded input while it is
+    // silent; see tgcalls::GroupVoiceGate.
+    void setOutgoingVoiceGate(tgcalls::GroupVoiceGate gate);
+    void setIncomingAudioProfile(tgcalls::GroupAudioReceiveProfile profile);
+    // Calls started afterwards mix only their loudest incoming streams and
+    // don't decode those at volume 0; see tgcalls::GroupAudioMixer.
+    void setAudioMixer(tgcalls::GroupAudioMixerConfig config);
+    // Encodes outgoing audio once for every call given the same |encoder|,
+    // which should all take their input from the same audio device; None
+    // encodes it per call again. Applies to calls started afterwards.
+    void setSharedAudioEncoder(std::shared_ptr<tgcalls::GroupSharedAudioEncoder> encoder);
+    // Decodes each participant's audio once for every call given the same
+    // |decoder| that receives it, e.g. several accounts in one voice chat;
+    // None decodes it per call again. Applies to calls started afterwards.
+    void setSharedAudioDecoder(std::shared_ptr<tgcalls::GroupSharedAudioDecoder> decoder);
+    void setOutgoingAudioBridge(std::shared_ptr<tgcalls::GroupAudioBridge> bridge);
+    // Sends the packets of |source| as they are, instead of encoding the
+    // captured audio, which only paces them; None encodes it again. Applies
+    // to calls started afterwards; a source feeds a single call.
+    void setOutgoingOpusSource(std::shared_ptr<OggOpusFileSource> source);
+    // H.264 on the FFmpeg encoder |hardwareEncoder|, e.g. "h264_vaapi" or
+    // "h264_nvenc", when non-empty, and thread and effort limits for the
+    // software encoders. |parallelSimulcast| encodes the simulcast layers of
+    // outgoing video on a thread each, at the same time. Applies to calls
+    // started afterwards.
+    void setVideoEncoderConfig(std::string hardwareEncoder, std::string hardwareDevice, int maxThreads,
+                               tgcalls::GroupVideoEncoderConfig::Complexity complexity,
+                               bool parallelSimulcast);
+    // Incoming video decoded on the FFmpeg hardware device |hardwareDeviceType|,
+    // "vaapi" or "cuda", when non-empty, falling back to software for what it
+    // can't decode. Applies to calls started afterwards.
+    void setVideoDecoderConfig(std::string hardwareDeviceType, std::string hardwareDevice);
+    // WebRTC field trials, as "Name/Value/Name/Value/", of group calls
+    // started afterwards: pacer, bandwidth estimation, audio allocation and
+    // the like can differ between calls. Empty keeps the defaults.
+    void setFieldTrials(std::string trials);
+    // Address family preference and TURN entry cap of 1:1 calls started
+    // afterwards; see BuildRtcServerList().
+    void setRtcServerOptions(RtcServerFamily family, size_t maxTurnServers);
+    void setAudioLevelsCallback(ParticipantLevels::Callback callback, int intervalMs, bool nativeVad);
+    // Group calls started afterwards receive no audio at all: |monitor| gets
+    // their participants' speaking state from RTP headers, as |callId|. The
+    // audio levels callback still gets levels and header speech flags.
+    void setSpeakerMonitor(std::shared_ptr<SpeakerMonitor> monitor, int64_t callId);
+    // Every callback into Python is called by |queue|'s asyncio loop from
+    // now on, instead of by a thread of the instance; null reverts that.
+    void setEventQueue(std::shared_ptr<EventQueue> queue);
+    void setUseSharedEngineContext(bool enabled);
+    void setAudioOnly(bool enabled);
+    void setConstantBitrateAudio(bool enabled);
+    void setGroupCallStartedCallback(std::function<void()> f);
+    // Every |intervalMs|, hands the stats of a running group or 1:1 call
+    // started after this to |callback|; nothing is written to disk.
+    void setCallStatsCallback(std::function<void(tgcalls::CallStatsSnapshot)> callback, int intervalMs);
+    // Calls started while enabled time each stage of their audio path, from
+    // capture to the socket and from the socket to playout; see
+    // tgcalls::LatencyTrace. Disabling detaches later calls only.
+    void setLatencyTracingEnabled(bool enabled);
+    // Per stage count, p50, p99 and max in microseconds; empty when disabled.
+    std::vector<tgcalls::LatencyTrace::StageSummary> getLatencyTrace() const;
+    void resetLatencyTrace();
+    void setRequestBroadcastPartCallback(std::function<void(std::shared_ptr<BroadcastPartRequest>)> f);
+    void setRequestVideoBroadcastPartCallback(std::function<void(std::shared_ptr<BroadcastPartRequest>)> f);
+    // Builds group calls until |count| are waiting to be claimed, so a later
+    // startGroupCall() only has to hand one its audio device and emit its
+    // join payload. Calls started with explicit device ids don't use them.
+    void prewarmGroupCalls(size_t count);
+    size_t prewarmedGroupCallCount() const;
+    void clearPrewarmedGroupCalls();
+    // Milliseconds from startGroupCall(), or from prewarmGroupCalls() for a
+    // prewarmed call, to each join milestone; -1 for the ones not reached yet.
+    tgcalls::GroupInstanceCustomImpl::StartupLatency getStartupLatency() const;
+    tgcalls::GroupInstanceCustomImpl::ReconnectStats getReconnectStats() const;
+    // What capture noise suppression costs the running call, per 10 ms frame.
+    tgcalls::GroupInstanceCustomImpl::NoiseSuppressionStats getNoiseSuppressionStats() const;
+    // Streams the running call's playout mixer decoded and mixed.
+    tgcalls::GroupInstanceCustomImpl::AudioMixerStats getAudioMixerStats() const;
+    // Send and receive stats of the running group call, gathered in one
+    // pass over its channels; per-participant values come as parallel lists.
+    tgcalls::GroupInstanceCustomImpl::MediaStats getMediaStats() const;
+    // Bytes the running group call holds in tgcalls' buffers and tables,
+    // and the channels whose memory webrtc doesn't report.
+    tgcalls::GroupInstanceCustomImpl::MemoryUsage getMemoryUsage() const;
+    // CPU time the running group call has taken on the pooled threads and
+    // its audio device, with CPU accounting enabled before it started.
+    tgcalls::CpuAccount::Usage getCpuUsage() const;
+    // Live migration: the running group call's state, for another instance
+    // of the call, in another process or on another node, to resume from.
+    GroupCallMigrationState exportMigrationState() const;
+    // Makes the next startGroupCall() resume from |state|: it joins with the
+    // same audio SSRC, starts receiving the same participants at once,
+    // connects with the previous join response while the caller rejoins,
+    // continues the broadcast and seeks the file input to where it was.
+    // Prewarmed calls aren't used for it, their SSRC being drawn already.
+    void setMigrationState(GroupCallMigrationState state);
+
+    // Process-wide context shared by the group calls that opt in.
+    static std::shared_ptr<tgcalls::GroupEngineContext> sharedEngineContext();
+    void setUseCertificatePool(bool enabled);
+    // Process-wide certificate pool; see tgcalls::GroupCertificatePool.
+    static std::shared_ptr<tgcalls::GroupCertificatePool> sharedCertificatePool();
+    void setUseBatchedUdpSockets(bool enabled);
+    void setUseSharedUdpSockets(bool enabled);
+    // Process-wide shared sockets; see tgcalls::GroupSharedUdpSockets.
+    static std::shared_ptr<tgcalls::GroupSharedUdpSockets> sharedUdpSockets();
     void setSignalingDataEmittedCallback(const std::function<void(const std::vector<uint8_t> &data)> &f);
 
 private:
+    // The source set with setVideoSource(), or nullptr for none.
+    std::function<webrtc::VideoTrackSourceInterface*()> outgoingVideoSource() const;
+    void updateOutgoingVideoSource() const;
+    // Waits for JoinAdmission first; |admissionSlot| is the join's slot,
+    // released by the call itself once started when |prewarming|.
+    std::unique_ptr<tgcalls::GroupInstanceCustomImpl> createGroupInstance(
+        std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory*)>,
+        std::string,
+        std::string,
+        std::shared_ptr<JoinAdmission::Slot> &admissionSlot,
+        bool prewarming = false
+    );
+    // Takes the suspended call, or else the oldest prewarmed call, if any,
+    // and moves it onto the audio device |createAudioDeviceModule| returns.
+    std::unique_ptr<tgcalls::GroupInstanceCustomImpl> claimPrewarmedGroupCall(
+        std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory*)> createAudioDeviceModule
+    );
+    // Hands the suspended call to GroupCallReaper, if any and, unless 0,
+    // if suspended as |generation|.
+    void reapSuspendedGroupCall(uint64_t generation = 0);
     void createInstanceHolder(
         std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory*)>,
         std::string,
         std::string
     );
+    static void refuseJoinIfOverloaded();
+    // Throws if the group call isn't running, for the futures.
+    tgcalls::GroupInstanceCustomImpl &runningGroupCall() const;
+    // Creates the 1:1 call of protocol |version|; without
+    // |createAudioDeviceModule| it uses the platform audio layer.
+    void startCallInstance(
+        std::string const &version,
+        vector<RtcServer> servers,
+        std::array<uint8_t, 256> const &authKey,
+        bool isOutgoing,
+        std::string logPath,
+        std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory*)> createAudioDeviceModule
+    );
 };
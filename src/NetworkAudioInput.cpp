@@ -0,0 +1,316 @@
+#include "NetworkAudioInput.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+#include <rtc_base/time_utils.h>
+
+namespace {
+
+// How often the decoding thread checks for free space in the ring.
+const auto kRefillInterval = std::chrono::milliseconds(10);
+
+// A connection that played this long resets the reconnect delay.
+const int64_t kStableConnectionMs = 30000;
+
+// Headroom of the ring over |maxBufferMs|, so the decoder rarely waits on a
+// capture thread that is about to skip.
+const int kRingSlackMs = 1000;
+
+std::once_flag networkInitialized;
+
+}  // namespace
+
+NetworkAudioInput::NetworkAudioInput(std::string url, AudioFormat format, Options options, std::shared_ptr<Stats> stats)
+    : _url(std::move(url)),
+      _format(format),
+      _options(options),
+      _stats(stats ? std::move(stats) : std::make_shared<Stats>()),
+      _bufferBytes(static_cast<size_t>(std::max(options.bufferMs, 10) / 10) * format.BytesPer10Ms()),
+      _maxBufferBytes(std::max(_bufferBytes, static_cast<size_t>(std::max(options.maxBufferMs, 10) / 10) * format.BytesPer10Ms())),
+      _ring(_maxBufferBytes + kRingSlackMs / 10 * format.BytesPer10Ms()) {}
+
+NetworkAudioInput::~NetworkAudioInput() {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  if (_thread) {
+    _thread->Stop();
+    _thread.reset();
+  }
+  CloseStream();
+  _stats->connected = false;
+  _stats->bufferedMs = 0;
+}
+
+void NetworkAudioInput::Start() {
+  std::call_once(networkInitialized, [] {
+    avformat_network_init();
+  });
+
+  _thread.reset(new rtc::PlatformThread(
+      ThreadFunc, this, "tgcalls_net_in", rtc::kNormalPriority));
+  _thread->Start();
+}
+
+size_t NetworkAudioInput::Read(int8_t *data, size_t length) {
+  const size_t sampleBytes = _format.channels * sizeof(int16_t);
+  size_t available = _ring.ReadAvailable();
+  if (available > _maxBufferBytes) {
+    // Back to the nominal delay rather than just under the limit, so a fast
+    // server clock costs one skip now and then instead of one every frame.
+    size_t skip = available - _bufferBytes;
+    skip -= skip % sampleBytes;
+    _ring.Skip(skip);
+    available -= skip;
+    _stats->skippedMs += skip * 10 / _format.BytesPer10Ms();
+  }
+
+  size_t read = 0;
+  if (_buffering) {
+    if (available >= _bufferBytes) {
+      _buffering = false;
+    }
+  }
+  if (!_buffering) {
+    read = _ring.Read(reinterpret_cast<uint8_t *>(data), length);
+    if (read < length) {
+      _buffering = true;
+      _stats->underruns++;
+    }
+  }
+  _stats->bufferedMs = static_cast<int64_t>((available - read) * 10 / _format.BytesPer10Ms());
+  return read;
+}
+
+void NetworkAudioInput::ThreadFunc(void *pThis) {
+  static_cast<NetworkAudioInput *>(pThis)->Run();
+}
+
+void NetworkAudioInput::Run() {
+  int delayMs = std::max(_options.reconnectDelayMs, 10);
+  while (!_stopped) {
+    if (!OpenStream()) {
+      _stats->failures++;
+      if (!Wait(delayMs)) {
+        break;
+      }
+      delayMs = std::min(delayMs * 2, std::max(_options.maxReconnectDelayMs, delayMs));
+      continue;
+    }
+
+    _stats->connects++;
+    _stats->connected = true;
+    const int64_t connectedAt = rtc::TimeMillis();
+    while (!_stopped) {
+      if (_pendingOffset < _pending.size()) {
+        _pendingOffset += _ring.Write(_pending.data() + _pendingOffset, _pending.size() - _pendingOffset);
+      }
+      if (_pendingOffset < _pending.size()) {
+        // The capture thread stopped reading; it skips what's too old.
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wakeUp.wait_for(lock, kRefillInterval, [this] { return _stopped.load(); });
+        continue;
+      }
+
+      _pending.clear();
+      _pendingOffset = 0;
+      if (!DecodeNextFrame()) {
+        break;
+      }
+    }
+    _stats->connected = false;
+    CloseStream();
+    if (_stopped) {
+      break;
+    }
+
+    _stats->failures++;
+    if (rtc::TimeMillis() - connectedAt >= kStableConnectionMs) {
+      delayMs = std::max(_options.reconnectDelayMs, 10);
+    }
+    RTC_LOG(LS_WARNING) << "Network audio input lost, reconnecting in " << delayMs << " ms: " << _url;
+    if (!Wait(delayMs)) {
+      break;
+    }
+    delayMs = std::min(delayMs * 2, std::max(_options.maxReconnectDelayMs, delayMs));
+  }
+}
+
+bool NetworkAudioInput::Wait(int delayMs) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  return !_wakeUp.wait_for(lock, std::chrono::milliseconds(delayMs), [this] { return _stopped.load(); });
+}
+
+int NetworkAudioInput::InterruptCallback(void *pThis) {
+  return static_cast<NetworkAudioInput *>(pThis)->_stopped.load() ? 1 : 0;
+}
+
+bool NetworkAudioInput::OpenStream() {
+  _formatContext = avformat_alloc_context();
+  if (!_formatContext) {
+    return false;
+  }
+  _formatContext->interrupt_callback.callback = InterruptCallback;
+  _formatContext->interrupt_callback.opaque = this;
+
+  // Protocols ignore the options they don't know.
+  AVDictionary *options = nullptr;
+  av_dict_set_int(&options, "rw_timeout", static_cast<int64_t>(std::max(_options.timeoutMs, 100)) * 1000, 0);
+  av_dict_set(&options, "reconnect", "1", 0);
+  av_dict_set(&options, "reconnect_streamed", "1", 0);
+  av_dict_set(&options, "reconnect_delay_max", "2", 0);
+  int ret = avformat_open_input(&_formatContext, _url.c_str(), nullptr, &options);
+  av_dict_free(&options);
+  if (ret < 0) {
+    // |_formatContext| is freed on failure.
+    RTC_LOG(LS_ERROR) << "Failed to open network audio input: " << _url;
+    return false;
+  }
+
+  ret = avformat_find_stream_info(_formatContext, nullptr);
+  if (ret < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to read stream info: " << _url;
+    CloseStream();
+    return false;
+  }
+
+  _streamIndex = av_find_best_stream(_formatContext, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+  if (_streamIndex < 0) {
+    RTC_LOG(LS_ERROR) << "No audio stream in network input: " << _url;
+    CloseStream();
+    return false;
+  }
+
+  AVCodecParameters *codecParameters = _formatContext->streams[_streamIndex]->codecpar;
+  const AVCodec *codec = avcodec_find_decoder(codecParameters->codec_id);
+  if (!codec) {
+    RTC_LOG(LS_ERROR) << "Unsupported audio codec in network input: " << _url;
+    CloseStream();
+    return false;
+  }
+
+  _codecContext = avcodec_alloc_context3(codec);
+  if (!_codecContext ||
+      avcodec_parameters_to_context(_codecContext, codecParameters) < 0 ||
+      avcodec_open2(_codecContext, codec, nullptr) < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open audio decoder for network input: " << _url;
+    CloseStream();
+    return false;
+  }
+
+  _frame = av_frame_alloc();
+  _packet = av_packet_alloc();
+  if (!_frame || !_packet) {
+    CloseStream();
+    return false;
+  }
+
+  RTC_LOG(LS_INFO) << "Decoding " << avcodec_get_name(codecParameters->codec_id)
+                   << " network input: " << _url;
+  return true;
+}
+
+bool NetworkAudioInput::DecodeNextFrame() {
+  while (!_stopped) {
+    int ret = avcodec_receive_frame(_codecContext, _frame);
+    if (ret == 0) {
+      bool resampled = ResampleFrame();
+      av_frame_unref(_frame);
+      return resampled;
+    }
+    if (ret != AVERROR(EAGAIN)) {
+      return false;
+    }
+
+    ret = av_read_frame(_formatContext, _packet);
+    if (ret < 0) {
+      // A live stream has no end worth draining the decoder for.
+      return false;
+    }
+    if (_packet->stream_index == _streamIndex) {
+      // Corrupt packets are skipped rather than ending the stream.
+      avcodec_send_packet(_codecContext, _packet);
+    }
+    av_packet_unref(_packet);
+  }
+  return false;
+}
+
+bool NetworkAudioInput::ResampleFrame() {
+  const uint64_t layout = _frame->channel_layout
+      ? _frame->channel_layout
+      : static_cast<uint64_t>(av_get_default_channel_layout(_frame->channels));
+  if (!_resampler || _frame->sample_rate != _inputSampleRate || _frame->format != _inputSampleFormat || layout != _inputLayout) {
+    if (_resampler) {
+      swr_free(&_resampler);
+    }
+    _resampler = swr_alloc_set_opts(
+        nullptr,
+        _format.channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO,
+        AV_SAMPLE_FMT_S16, _format.sampleRate,
+        static_cast<int64_t>(layout), static_cast<AVSampleFormat>(_frame->format), _frame->sample_rate,
+        0, nullptr);
+    if (!_resampler || swr_init(_resampler) < 0) {
+      RTC_LOG(LS_ERROR) << "Failed to set up resampler for network input: " << _url;
+      return false;
+    }
+    _inputSampleRate = _frame->sample_rate;
+    _inputSampleFormat = _frame->format;
+    _inputLayout = layout;
+  }
+
+  int outSamples = swr_get_out_samples(_resampler, _frame->nb_samples);
+  if (outSamples <= 0) {
+    return true;
+  }
+
+  _pending.resize(outSamples * (_format.channels * 2));
+  uint8_t *out = _pending.data();
+  int converted = swr_convert(_resampler, &out, outSamples,
+                              const_cast<const uint8_t **>(_frame->extended_data),
+                              _frame->nb_samples);
+  if (converted < 0) {
+    RTC_LOG(LS_ERROR) << "Audio resampling failed for network input: " << _url;
+    _pending.clear();
+    return false;
+  }
+  _pending.resize(converted * (_format.channels * 2));
+  return true;
+}
+
+void NetworkAudioInput::CloseStream() {
+  if (_packet) {
+    av_packet_free(&_packet);
+  }
+  if (_frame) {
+    av_frame_free(&_frame);
+  }
+  if (_resampler) {
+    swr_free(&_resampler);
+  }
+  _inputSampleRate = 0;
+  _inputSampleFormat = -1;
+  _inputLayout = 0;
+  if (_codecContext) {
+    avcodec_free_context(&_codecContext);
+  }
+  if (_formatContext) {
+    avformat_close_input(&_formatContext);
+  }
+  _streamIndex = -1;
+  _pending.clear();
+  _pendingOffset = 0;
+}
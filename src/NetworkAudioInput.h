@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "SpscRingBuffer.h"
+
+struct AVFormatContext;
+struct AVCodecContext;
+struct AVFrame;
+struct AVPacket;
+struct SwrContext;
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+// Live audio from any URL FFmpeg can open (HTTP, HLS, RTMP, Icecast, ...),
+// decoded into s16le PCM of the requested format.
+//
+// A background thread connects, decodes into a lock-free ring, and reconnects
+// with a growing delay whenever the stream fails or ends, so neither the
+// capture thread nor the one opening the input ever waits on the network.
+// Read() holds the audio back until |bufferMs| of it has arrived, and again
+// after every underrun, to absorb network jitter; beyond |maxBufferMs| the
+// oldest audio is skipped, so a server whose clock runs fast doesn't leave
+// the call further and further behind live.
+class NetworkAudioInput {
+public:
+  struct Options {
+    int bufferMs = 1000;
+    int maxBufferMs = 4000;
+    // Doubled after every failed attempt up to the maximum, and reset once
+    // a connection has played for a while.
+    int reconnectDelayMs = 500;
+    int maxReconnectDelayMs = 10000;
+    // Opening or reading the stream that stalls this long fails, and it
+    // reconnects.
+    int timeoutMs = 10000;
+  };
+
+  // Shared with the descriptor, which reports it to Python.
+  struct Stats {
+    std::atomic<bool> connected{false};
+    std::atomic<uint64_t> connects{0};
+    // Failed connects, and connections lost or ended.
+    std::atomic<uint64_t> failures{0};
+    // Times playback ran dry and buffered again.
+    std::atomic<uint64_t> underruns{0};
+    // Audio skipped because the buffer grew past |maxBufferMs|.
+    std::atomic<uint64_t> skippedMs{0};
+    std::atomic<int64_t> bufferedMs{0};
+  };
+
+  NetworkAudioInput(std::string url, AudioFormat format, Options options, std::shared_ptr<Stats> stats);
+  ~NetworkAudioInput();
+
+  // Starts connecting in the background.
+  void Start();
+
+  // Copies up to |length| bytes of decoded PCM without blocking and returns
+  // how many were available. Called from the capture thread only.
+  size_t Read(int8_t *data, size_t length);
+
+private:
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  // Opens |_url| and sets up the decoder. Interrupted by |_stopped|.
+  bool OpenStream();
+
+  // Decodes and resamples the next frame into |_pending|. Returns false
+  // once the stream failed or ended.
+  bool DecodeNextFrame();
+
+  bool ResampleFrame();
+
+  void CloseStream();
+
+  // Waits |delayMs| or until stopped; returns false if stopped.
+  bool Wait(int delayMs);
+
+  static int InterruptCallback(void *);
+
+  const std::string _url;
+  const AudioFormat _format;
+  const Options _options;
+  const std::shared_ptr<Stats> _stats;
+  const size_t _bufferBytes;
+  const size_t _maxBufferBytes;
+  SpscRingBuffer _ring;
+
+  // Capture thread only: holding audio back until |_bufferBytes| arrived.
+  bool _buffering = true;
+
+  AVFormatContext *_formatContext = nullptr;
+  AVCodecContext *_codecContext = nullptr;
+  SwrContext *_resampler = nullptr;
+  AVFrame *_frame = nullptr;
+  AVPacket *_packet = nullptr;
+  int _streamIndex = -1;
+  // What |_resampler| was set up for; HLS variants can change it midway.
+  int _inputSampleRate = 0;
+  int _inputSampleFormat = -1;
+  uint64_t _inputLayout = 0;
+
+  // Resampled PCM that did not fit into |_ring| yet.
+  std::vector<uint8_t> _pending;
+  size_t _pendingOffset = 0;
+
+  std::atomic<bool> _stopped{false};
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
@@ -0,0 +1,416 @@
+#include "NetworkAudioOutputWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/audio_fifo.h>
+#include <libavutil/channel_layout.h>
+#include <libavutil/samplefmt.h>
+#include <libswresample/swresample.h>
+}
+
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+#include <rtc_base/time_utils.h>
+
+namespace {
+
+// How often the writer thread picks up what the playout thread queued.
+const auto kEncodeInterval = std::chrono::milliseconds(20);
+
+// A connection that streamed this long resets the reconnect delay.
+const int64_t kStableConnectionMs = 30000;
+
+// How long the destructor lets a slow connection take the rest of the audio
+// and the trailer before interrupting it.
+const int64_t kCloseGraceMs = 1000;
+
+std::once_flag networkInitialized;
+
+bool IsRtmpUrl(const std::string &url) {
+  return url.rfind("rtmp://", 0) == 0 || url.rfind("rtmps://", 0) == 0;
+}
+
+// The format's own rate when the encoder takes it, else the closest higher
+// one, so nothing is lost to resampling down.
+int PickSampleRate(const AVCodec *codec, int sampleRate) {
+  if (!codec->supported_samplerates) {
+    return sampleRate;
+  }
+  int higher = 0;
+  int lower = 0;
+  for (const int *rate = codec->supported_samplerates; *rate; ++rate) {
+    if (*rate == sampleRate) {
+      return sampleRate;
+    } else if (*rate > sampleRate) {
+      higher = higher ? std::min(higher, *rate) : *rate;
+    } else {
+      lower = std::max(lower, *rate);
+    }
+  }
+  return higher ? higher : (lower ? lower : sampleRate);
+}
+
+}  // namespace
+
+NetworkAudioOutputWriter::NetworkAudioOutputWriter(std::string url,
+                                                   AudioFormat format,
+                                                   AudioWriterStats *stats,
+                                                   Options options,
+                                                   std::shared_ptr<Stats> networkStats)
+    : _url(std::move(url)),
+      _format(format),
+      _stats(stats),
+      _options(std::move(options)),
+      _networkStats(networkStats ? std::move(networkStats) : std::make_shared<Stats>()),
+      _ring(static_cast<size_t>(std::max(_options.maxBacklogMs, 100) / 10) * format.BytesPer10Ms()),
+      _pcm(format.BytesPer10Ms()) {}
+
+NetworkAudioOutputWriter::~NetworkAudioOutputWriter() {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stoppedAtMs = rtc::TimeMillis();
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  if (_thread) {
+    _thread->Stop();
+    _thread.reset();
+  }
+  CloseStream();
+  _networkStats->connected = false;
+}
+
+bool NetworkAudioOutputWriter::Open() {
+  std::call_once(networkInitialized, [] {
+    avformat_network_init();
+  });
+
+  const char *formatName = nullptr;
+  if (!_options.format.empty()) {
+    formatName = _options.format.c_str();
+  } else if (IsRtmpUrl(_url)) {
+    formatName = "flv";
+  }
+  _outputFormat = av_guess_format(formatName, _url.c_str(), nullptr);
+  if (!_outputFormat) {
+    RTC_LOG(LS_ERROR) << "No muxer for network output, set its format: " << _url;
+    return false;
+  }
+
+  _codec = _options.codec.empty()
+      ? avcodec_find_encoder(_outputFormat->audio_codec)
+      : avcodec_find_encoder_by_name(_options.codec.c_str());
+  if (!_codec || _codec->type != AVMEDIA_TYPE_AUDIO) {
+    RTC_LOG(LS_ERROR) << "No audio encoder for network output: " << _url;
+    return false;
+  }
+
+  _thread.reset(new rtc::PlatformThread(
+      ThreadFunc, this, "tgcalls_net_out", rtc::kNormalPriority));
+  _thread->Start();
+
+  RTC_LOG(LS_INFO) << "Streaming " << _codec->name << " in " << _outputFormat->name
+                   << " at " << _options.bitrate << " bps to: " << _url;
+  return true;
+}
+
+bool NetworkAudioOutputWriter::Write(const int8_t *frame, size_t length) {
+  if (_ring.WriteAvailable() < length) {
+    if (_stats) {
+      _stats->droppedFrames++;
+    }
+    return false;
+  }
+
+  _ring.Write(reinterpret_cast<const uint8_t *>(frame), length);
+  if (_stats) {
+    _stats->backlogBytes = _ring.ReadAvailable();
+  }
+  return true;
+}
+
+void NetworkAudioOutputWriter::ThreadFunc(void *pThis) {
+  static_cast<NetworkAudioOutputWriter *>(pThis)->Run();
+}
+
+void NetworkAudioOutputWriter::Run() {
+  int delayMs = std::max(_options.reconnectDelayMs, 10);
+  while (!_stopped) {
+    if (!OpenStream()) {
+      CloseStream();
+      _networkStats->failures++;
+      if (!Wait(delayMs)) {
+        break;
+      }
+      delayMs = std::min(delayMs * 2, std::max(_options.maxReconnectDelayMs, delayMs));
+      continue;
+    }
+
+    // What queued up while connecting is late already.
+    DiscardBacklog();
+    _networkStats->connects++;
+    _networkStats->connected = true;
+    const int64_t connectedAt = rtc::TimeMillis();
+    bool failed = false;
+    while (true) {
+      bool stopping = _stopped;
+      if (!SendAvailable()) {
+        failed = true;
+        break;
+      }
+      if (stopping) {
+        FinishStream();
+        break;
+      }
+
+      std::unique_lock<std::mutex> lock(_mutex);
+      _wakeUp.wait_for(lock, kEncodeInterval, [this] { return _stopped.load(); });
+    }
+    _networkStats->connected = false;
+    CloseStream();
+    if (!failed) {
+      break;
+    }
+
+    _networkStats->failures++;
+    if (rtc::TimeMillis() - connectedAt >= kStableConnectionMs) {
+      delayMs = std::max(_options.reconnectDelayMs, 10);
+    }
+    RTC_LOG(LS_WARNING) << "Network audio output lost, reconnecting in " << delayMs << " ms: " << _url;
+    if (!Wait(delayMs)) {
+      break;
+    }
+    delayMs = std::min(delayMs * 2, std::max(_options.maxReconnectDelayMs, delayMs));
+  }
+}
+
+bool NetworkAudioOutputWriter::Wait(int delayMs) {
+  const int64_t until = rtc::TimeMillis() + delayMs;
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (!_stopped) {
+    DiscardBacklog();
+    const int64_t left = until - rtc::TimeMillis();
+    if (left <= 0) {
+      return true;
+    }
+    _wakeUp.wait_for(lock, std::min(std::chrono::milliseconds(left), kEncodeInterval),
+                     [this] { return _stopped.load(); });
+  }
+  return false;
+}
+
+void NetworkAudioOutputWriter::DiscardBacklog() {
+  // Frames are queued whole, so this never splits one.
+  const size_t skipped = _ring.Skip(_ring.ReadAvailable());
+  _networkStats->discardedMs += skipped * 10 / _format.BytesPer10Ms();
+  if (_stats) {
+    _stats->backlogBytes = _ring.ReadAvailable();
+  }
+}
+
+int NetworkAudioOutputWriter::InterruptCallback(void *pThis) {
+  auto writer = static_cast<NetworkAudioOutputWriter *>(pThis);
+  if (!writer->_stopped) {
+    return 0;
+  }
+  return rtc::TimeMillis() - writer->_stoppedAtMs >= kCloseGraceMs ? 1 : 0;
+}
+
+bool NetworkAudioOutputWriter::OpenStream() {
+  int ret = avformat_alloc_output_context2(&_formatContext, _outputFormat, nullptr, _url.c_str());
+  if (ret < 0 || !_formatContext) {
+    return false;
+  }
+  _formatContext->interrupt_callback.callback = InterruptCallback;
+  _formatContext->interrupt_callback.opaque = this;
+
+  const uint64_t layout = _format.channels == 1 ? AV_CH_LAYOUT_MONO : AV_CH_LAYOUT_STEREO;
+  _codecContext = avcodec_alloc_context3(_codec);
+  if (!_codecContext) {
+    return false;
+  }
+  _codecContext->sample_fmt = _codec->sample_fmts ? _codec->sample_fmts[0] : AV_SAMPLE_FMT_S16;
+  _codecContext->sample_rate = PickSampleRate(_codec, _format.sampleRate);
+  _codecContext->channel_layout = layout;
+  _codecContext->channels = static_cast<int>(_format.channels);
+  _codecContext->bit_rate = _options.bitrate;
+  _codecContext->time_base = AVRational{1, _codecContext->sample_rate};
+  if (_outputFormat->flags & AVFMT_GLOBALHEADER) {
+    _codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+  if (avcodec_open2(_codecContext, _codec, nullptr) < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open " << _codec->name << " encoder for network output: " << _url;
+    return false;
+  }
+  // PCM encoders take any frame size; 10 ms keeps latency down.
+  _frameSamples = _codecContext->frame_size > 0 ? _codecContext->frame_size : _codecContext->sample_rate / 100;
+
+  _stream = avformat_new_stream(_formatContext, nullptr);
+  if (!_stream || avcodec_parameters_from_context(_stream->codecpar, _codecContext) < 0) {
+    return false;
+  }
+  _stream->time_base = _codecContext->time_base;
+
+  if (!(_outputFormat->flags & AVFMT_NOFILE)) {
+    // Protocols ignore the options they don't know; Icecast and HTTP take
+    // the content type from the muxer.
+    AVDictionary *options = nullptr;
+    av_dict_set_int(&options, "rw_timeout", static_cast<int64_t>(std::max(_options.timeoutMs, 100)) * 1000, 0);
+    if (_outputFormat->mime_type) {
+      av_dict_set(&options, "content_type", _outputFormat->mime_type, 0);
+    }
+    ret = avio_open2(&_formatContext->pb, _url.c_str(), AVIO_FLAG_WRITE,
+                     &_formatContext->interrupt_callback, &options);
+    av_dict_free(&options);
+    if (ret < 0) {
+      RTC_LOG(LS_ERROR) << "Failed to connect network output: " << _url;
+      return false;
+    }
+  }
+  if (avformat_write_header(_formatContext, nullptr) < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to start network output: " << _url;
+    return false;
+  }
+
+  _resampler = swr_alloc_set_opts(
+      nullptr,
+      static_cast<int64_t>(layout), _codecContext->sample_fmt, _codecContext->sample_rate,
+      static_cast<int64_t>(layout), AV_SAMPLE_FMT_S16, _format.sampleRate,
+      0, nullptr);
+  if (!_resampler || swr_init(_resampler) < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to set up resampler for network output: " << _url;
+    return false;
+  }
+
+  _fifo = av_audio_fifo_alloc(_codecContext->sample_fmt, _codecContext->channels, _frameSamples * 2);
+  _converted = av_frame_alloc();
+  _frame = av_frame_alloc();
+  _packet = av_packet_alloc();
+  if (!_fifo || !_converted || !_frame || !_packet) {
+    return false;
+  }
+
+  // Twice a chunk's worth: whatever the resampler holds back comes out with
+  // the next one.
+  _convertedCapacity = _codecContext->sample_rate / 50;
+  for (AVFrame *frame : {_converted, _frame}) {
+    frame->format = _codecContext->sample_fmt;
+    frame->channel_layout = layout;
+    frame->channels = _codecContext->channels;
+    frame->sample_rate = _codecContext->sample_rate;
+  }
+  _converted->nb_samples = _convertedCapacity;
+  _frame->nb_samples = _frameSamples;
+  if (av_frame_get_buffer(_converted, 0) < 0 || av_frame_get_buffer(_frame, 0) < 0) {
+    return false;
+  }
+
+  _pts = 0;
+  return true;
+}
+
+bool NetworkAudioOutputWriter::SendAvailable() {
+  const size_t chunkBytes = _format.BytesPer10Ms();
+  const int chunkSamples = _format.sampleRate / 100;
+  while (_ring.ReadAvailable() >= chunkBytes) {
+    _ring.Read(_pcm.data(), chunkBytes);
+    const uint8_t *input = _pcm.data();
+    int converted = swr_convert(_resampler, _converted->data, _convertedCapacity, &input, chunkSamples);
+    if (converted < 0 ||
+        av_audio_fifo_write(_fifo, reinterpret_cast<void **>(_converted->data), converted) < converted ||
+        !EncodeFifo(false)) {
+      return false;
+    }
+  }
+  if (_stats) {
+    _stats->backlogBytes = _ring.ReadAvailable();
+  }
+  return true;
+}
+
+void NetworkAudioOutputWriter::FinishStream() {
+  int converted = swr_convert(_resampler, _converted->data, _convertedCapacity, nullptr, 0);
+  if (converted > 0) {
+    av_audio_fifo_write(_fifo, reinterpret_cast<void **>(_converted->data), converted);
+  }
+  if (EncodeFifo(true) && SendFrame(nullptr)) {
+    av_write_trailer(_formatContext);
+  }
+}
+
+bool NetworkAudioOutputWriter::EncodeFifo(bool flush) {
+  while (av_audio_fifo_size(_fifo) >= _frameSamples || (flush && av_audio_fifo_size(_fifo) > 0)) {
+    if (av_frame_make_writable(_frame) < 0) {
+      return false;
+    }
+    int read = av_audio_fifo_read(_fifo, reinterpret_cast<void **>(_frame->data), _frameSamples);
+    if (read < 0) {
+      return false;
+    }
+    if (read < _frameSamples) {
+      // Most encoders only take whole frames; pad the last with silence.
+      av_samples_set_silence(_frame->data, read, _frameSamples - read,
+                             _codecContext->channels, _codecContext->sample_fmt);
+    }
+    _frame->pts = _pts;
+    _pts += _frameSamples;
+    if (!SendFrame(_frame)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool NetworkAudioOutputWriter::SendFrame(AVFrame *frame) {
+  int ret = avcodec_send_frame(_codecContext, frame);
+  if (ret < 0) {
+    RTC_LOG(LS_ERROR) << "Audio encoding failed for network output: " << _url;
+    return false;
+  }
+  while ((ret = avcodec_receive_packet(_codecContext, _packet)) == 0) {
+    av_packet_rescale_ts(_packet, _codecContext->time_base, _stream->time_base);
+    _packet->stream_index = _stream->index;
+    _networkStats->sentBytes += static_cast<uint64_t>(_packet->size);
+    // Takes the packet's reference, also on failure.
+    if (av_interleaved_write_frame(_formatContext, _packet) < 0) {
+      RTC_LOG(LS_ERROR) << "Failed to send to network output: " << _url;
+      return false;
+    }
+  }
+  return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF;
+}
+
+void NetworkAudioOutputWriter::CloseStream() {
+  if (_packet) {
+    av_packet_free(&_packet);
+  }
+  if (_frame) {
+    av_frame_free(&_frame);
+  }
+  if (_converted) {
+    av_frame_free(&_converted);
+  }
+  if (_fifo) {
+    av_audio_fifo_free(_fifo);
+    _fifo = nullptr;
+  }
+  if (_resampler) {
+    swr_free(&_resampler);
+  }
+  if (_codecContext) {
+    avcodec_free_context(&_codecContext);
+  }
+  if (_formatContext) {
+    if (!(_outputFormat->flags & AVFMT_NOFILE)) {
+      avio_closep(&_formatContext->pb);
+    }
+    avformat_free_context(_formatContext);
+    _formatContext = nullptr;
+  }
+  _stream = nullptr;
+}
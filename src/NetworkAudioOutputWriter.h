@@ -0,0 +1,153 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "AudioOutputWriter.h"
+#include "SpscRingBuffer.h"
+
+struct AVAudioFifo;
+struct AVCodec;
+struct AVCodecContext;
+struct AVFormatContext;
+struct AVFrame;
+struct AVOutputFormat;
+struct AVPacket;
+struct AVStream;
+struct SwrContext;
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+// Restreams playout capture, the call's mixed audio, to any URL FFmpeg can
+// publish to: RTMP, Icecast, HLS, ... The mix is encoded once, however many
+// people listen on the other end.
+//
+// Like OggOpusFileWriter, the playout thread only copies frames into a ring.
+// A background thread encodes, muxes and sends; when the connection is slower
+// than real time the ring fills up and frames are dropped instead of holding
+// up playout. A failed or stalled connection is reopened with a growing
+// delay, and audio played in the meantime is thrown away so the stream
+// resumes live rather than behind.
+class NetworkAudioOutputWriter : public AudioOutputWriter {
+public:
+  struct Options {
+    // FFmpeg muxer, e.g. "flv" for RTMP or "mp3", "ogg", "adts" for Icecast.
+    // When empty, rtmp:// URLs use "flv" and anything else is guessed from
+    // the URL's extension.
+    std::string format;
+    // FFmpeg encoder, e.g. "aac", "libmp3lame", "libopus". When empty, the
+    // muxer's default audio codec is used.
+    std::string codec;
+    int bitrate = 128000;
+    // Audio the playout thread may queue ahead of a slow connection before
+    // frames are dropped.
+    int maxBacklogMs = 4000;
+    // Doubled after every failed attempt up to the maximum, and reset once
+    // a connection has streamed for a while.
+    int reconnectDelayMs = 1000;
+    int maxReconnectDelayMs = 30000;
+    // Connecting or sending that stalls this long fails, and it reconnects.
+    int timeoutMs = 10000;
+  };
+
+  // Shared with the descriptor, which reports it to Python.
+  struct Stats {
+    std::atomic<bool> connected{false};
+    std::atomic<uint64_t> connects{0};
+    // Failed connects, and connections lost.
+    std::atomic<uint64_t> failures{0};
+    // Encoded bytes handed to the muxer.
+    std::atomic<uint64_t> sentBytes{0};
+    // Audio thrown away while disconnected.
+    std::atomic<uint64_t> discardedMs{0};
+  };
+
+  NetworkAudioOutputWriter(std::string url,
+                           AudioFormat format,
+                           AudioWriterStats *stats,
+                           Options options,
+                           std::shared_ptr<Stats> networkStats);
+
+  // Sends what is still buffered and ends the stream, giving up after a
+  // second if the connection is stuck.
+  ~NetworkAudioOutputWriter() override;
+
+  // Fails only if the muxer or encoder is unknown; connecting happens in the
+  // background.
+  bool Open() override;
+
+  bool Write(const int8_t *frame, size_t length) override;
+
+private:
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  // Opens |_url| and sets up the encoder and resampler.
+  bool OpenStream();
+
+  // Encodes and sends everything buffered. Returns false once the
+  // connection failed.
+  bool SendAvailable();
+
+  // Pads and encodes the last partial frame, drains the encoder and writes
+  // the trailer.
+  void FinishStream();
+
+  // Moves |_fifo| into the encoder |_frameSamples| at a time, or the
+  // remainder too when |flush| is set.
+  bool EncodeFifo(bool flush);
+
+  bool SendFrame(AVFrame *frame);
+
+  void CloseStream();
+
+  // Throws away what the playout thread queued, which is too late to send.
+  void DiscardBacklog();
+
+  // Waits |delayMs| or until stopped, discarding playout meanwhile; returns
+  // false if stopped.
+  bool Wait(int delayMs);
+
+  static int InterruptCallback(void *);
+
+  const std::string _url;
+  const AudioFormat _format;
+  AudioWriterStats *_stats;
+  const Options _options;
+  const std::shared_ptr<Stats> _networkStats;
+  SpscRingBuffer _ring;
+
+  const AVOutputFormat *_outputFormat = nullptr;
+  const AVCodec *_codec = nullptr;
+
+  AVFormatContext *_formatContext = nullptr;
+  AVStream *_stream = nullptr;
+  AVCodecContext *_codecContext = nullptr;
+  SwrContext *_resampler = nullptr;
+  AVAudioFifo *_fifo = nullptr;
+  // Resampler output of one 10 ms input chunk.
+  AVFrame *_converted = nullptr;
+  int _convertedCapacity = 0;
+  AVFrame *_frame = nullptr;
+  AVPacket *_packet = nullptr;
+  int _frameSamples = 0;
+  int64_t _pts = 0;
+
+  std::vector<uint8_t> _pcm;
+
+  std::atomic<bool> _stopped{false};
+  std::atomic<int64_t> _stoppedAtMs{0};
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
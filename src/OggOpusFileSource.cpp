@@ -0,0 +1,225 @@
+#include "OggOpusFileSource.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Granule positions always count 48 kHz samples (RFC 7845, section 4).
+const int64_t kGranuleSamplesPerMs = 48;
+
+const size_t kOggHeaderBytes = 27;
+const uint8_t kOggContinued = 0x01;
+const uint8_t kOggBeginOfStream = 0x02;
+const uint8_t kOggEndOfStream = 0x04;
+
+// Packets larger than this are not sent; RFC 7845 allows up to 61,440 bytes
+// per packet in a file, a datagram carries far less.
+const size_t kMaxPacketBytes = 1275 * 3 + 7;
+
+uint32_t GetLE32(const uint8_t *data) {
+  return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+}
+
+int64_t GetLE64(const uint8_t *data) {
+  return static_cast<int64_t>(uint64_t(GetLE32(data)) | (uint64_t(GetLE32(data + 4)) << 32));
+}
+
+// Offset of the next capture pattern after |offset|, or |size|.
+size_t FindPageAfter(const uint8_t *data, size_t size, size_t offset) {
+  for (offset++; offset + 4 <= size; offset++) {
+    if (data[offset] == 'O' && memcmp(data + offset, "OggS", 4) == 0) {
+      return offset;
+    }
+  }
+  return size;
+}
+
+bool IsPageAt(const uint8_t *data, size_t size, size_t offset) {
+  return offset + kOggHeaderBytes <= size && memcmp(data + offset, "OggS", 4) == 0 && data[offset + 4] == 0;
+}
+
+// Bytes of the page at |offset|, header included; 0 if it is cut short.
+size_t PageBytes(const uint8_t *data, size_t size, size_t offset) {
+  const int segmentCount = data[offset + 26];
+  size_t bytes = kOggHeaderBytes + segmentCount;
+  if (offset + bytes > size) {
+    return 0;
+  }
+  for (int i = 0; i < segmentCount; i++) {
+    bytes += data[offset + kOggHeaderBytes + i];
+  }
+  return offset + bytes <= size ? bytes : 0;
+}
+
+}  // namespace
+
+std::shared_ptr<OggOpusFileSource> OggOpusFileSource::Open(const std::string &path, bool loop) {
+  auto mapping = MappedAudioFile::Open(path);
+  if (!mapping) {
+    return nullptr;
+  }
+  std::shared_ptr<OggOpusFileSource> source(new OggOpusFileSource(std::move(mapping), loop));
+  if (!source->ReadHeaders()) {
+    return nullptr;
+  }
+  return source;
+}
+
+OggOpusFileSource::OggOpusFileSource(std::shared_ptr<MappedAudioFile> mapping, bool loop)
+    : _mapping(std::move(mapping)),
+      _data(reinterpret_cast<const uint8_t *>(_mapping->data())),
+      _size(_mapping->size()),
+      _loop(loop) {}
+
+bool OggOpusFileSource::ReadHeaders() {
+  // The first page starts the Opus stream and holds its OpusHead alone.
+  if (!IsPageAt(_data, _size, 0) || !(_data[5] & kOggBeginOfStream) || PageBytes(_data, _size, 0) == 0) {
+    return false;
+  }
+  _serial = GetLE32(_data + 14);
+
+  rtc::Buffer head;
+  if (!ReadPacket(head) || head.size() < 19 || memcmp(head.data(), "OpusHead", 8) != 0) {
+    return false;
+  }
+  // Major version 0 only (RFC 7845, section 5.1).
+  if ((head[8] & 0xf0) != 0) {
+    return false;
+  }
+  _channels = head[9];
+  _preSkip = head[10] | (head[11] << 8);
+  const int mappingFamily = head[18];
+  if (mappingFamily == 0) {
+    if (_channels < 1 || _channels > 2) {
+      return false;
+    }
+  } else if (mappingFamily != 1 || head.size() < 21 || head[19] != 1 || _channels > 2) {
+    return false;
+  }
+
+  rtc::Buffer tags;
+  if (!ReadPacket(tags) || tags.size() < 8 || memcmp(tags.data(), "OpusTags", 8) != 0) {
+    return false;
+  }
+  // Audio starts on a page of its own.
+  _firstAudioPageOffset = _nextPageOffset;
+  _segment = _segmentCount;
+
+  _durationMs = std::max<int64_t>(LastGranulePosition() - _preSkip, 0) / kGranuleSamplesPerMs;
+  return true;
+}
+
+bool OggOpusFileSource::NextPage() {
+  _segments = nullptr;
+  _segment = _segmentCount = 0;
+  while (!_isLastPage && _nextPageOffset < _size) {
+    const size_t offset = _nextPageOffset;
+    const size_t bytes = IsPageAt(_data, _size, offset) ? PageBytes(_data, _size, offset) : 0;
+    if (bytes == 0) {
+      // Corrupt or cut short: on to the next capture pattern, if any.
+      _nextPageOffset = FindPageAfter(_data, _size, offset);
+      continue;
+    }
+    _nextPageOffset = offset + bytes;
+    if (GetLE32(_data + offset + 14) != _serial) {
+      continue;
+    }
+
+    if (_nextPageOffset + MappedAudioFile::kDefaultPrefetchBytes / 2 >= _prefetchedUntil) {
+      _mapping->Prefetch(_nextPageOffset, MappedAudioFile::kDefaultPrefetchBytes);
+      _prefetchedUntil = _nextPageOffset + MappedAudioFile::kDefaultPrefetchBytes;
+    }
+
+    _pageFlags = _data[offset + 5];
+    _isLastPage = (_pageFlags & kOggEndOfStream) != 0;
+    _segments = _data + offset + kOggHeaderBytes;
+    _segmentCount = _data[offset + 26];
+    _packetOffset = offset + kOggHeaderBytes + _segmentCount;
+    return true;
+  }
+  return false;
+}
+
+bool OggOpusFileSource::ReadPacket(rtc::Buffer &packet) {
+  packet.Clear();
+  while (true) {
+    if (_segment == _segmentCount) {
+      const bool isContinuing = !packet.empty();
+      if (!NextPage()) {
+        return false;
+      }
+      const bool isContinued = (_pageFlags & kOggContinued) != 0;
+      if (isContinued != isContinuing) {
+        // A page went missing: drop the packet it split, or what continues
+        // one that was never started.
+        packet.Clear();
+        if (isContinued) {
+          while (_segment < _segmentCount && _segments[_segment] == 255) {
+            _packetOffset += _segments[_segment++];
+          }
+          if (_segment < _segmentCount) {
+            _packetOffset += _segments[_segment++];
+          }
+        }
+      }
+      continue;
+    }
+    const uint8_t lacing = _segments[_segment++];
+    packet.AppendData(_data + _packetOffset, lacing);
+    _packetOffset += lacing;
+    if (lacing < 255) {
+      return true;
+    }
+  }
+}
+
+int64_t OggOpusFileSource::LastGranulePosition() const {
+  // The last page is at most 65,307 bytes from the end.
+  const size_t searchFrom = _size > 65307 + kOggHeaderBytes ? _size - 65307 - kOggHeaderBytes : 0;
+  int64_t granule = 0;
+  for (size_t offset = searchFrom; offset + kOggHeaderBytes <= _size; offset++) {
+    if (IsPageAt(_data, _size, offset) && GetLE32(_data + offset + 14) == _serial && PageBytes(_data, _size, offset) != 0) {
+      const auto pageGranule = GetLE64(_data + offset + 6);
+      if (pageGranule >= 0) {
+        granule = pageGranule;
+      }
+    }
+  }
+  return granule;
+}
+
+bool OggOpusFileSource::nextPacket(rtc::Buffer &payload, uint32_t &samples) {
+  if (_finished.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  bool hasRestarted = false;
+  while (true) {
+    if (!ReadPacket(payload)) {
+      if (!_loop || hasRestarted) {
+        // Ended, or has nothing to send at all.
+        _finished.store(true, std::memory_order_relaxed);
+        return false;
+      }
+      hasRestarted = true;
+      _nextPageOffset = _firstAudioPageOffset;
+      _segment = _segmentCount = 0;
+      _isLastPage = false;
+      _prefetchedUntil = 0;
+      _loopSamples.store(0, std::memory_order_relaxed);
+      continue;
+    }
+    samples = payload.size() <= kMaxPacketBytes ? tgcalls::opusPacketSamples(payload.data(), payload.size()) : 0;
+    if (samples != 0) {
+      break;
+    }
+  }
+  _loopSamples.fetch_add(samples, std::memory_order_relaxed);
+  _sentPackets.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+int64_t OggOpusFileSource::positionMs() const {
+  const auto samples = _loopSamples.load(std::memory_order_relaxed) - _preSkip;
+  return samples > 0 ? samples / kGranuleSamplesPerMs : 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <tgcalls/group/GroupOpusPacketSource.h>
+
+#include "MappedAudioFile.h"
+
+// The packets of an Ogg Opus file (RFC 7845), for a call to send as they are
+// instead of decoding, processing and encoding the file again; see
+// tgcalls::GroupOpusPacketSource. Each packet is handed out once the
+// previous one's duration has been captured, so a file plays at the pace its
+// granule positions count.
+//
+// The file is memory mapped and read ahead of the packets sent. Only a
+// single Opus stream is sent: other logical streams of the file are skipped,
+// and so is what follows the Opus stream's end.
+class OggOpusFileSource : public tgcalls::GroupOpusPacketSource {
+public:
+  // Returns nullptr if |path| can't be mapped or doesn't start with an Opus
+  // stream of a single Opus stream (channel mapping family 0, or 1 with one
+  // stream). A looping source starts over at its end.
+  static std::shared_ptr<OggOpusFileSource> Open(const std::string &path, bool loop = false);
+
+  OggOpusFileSource(const OggOpusFileSource &) = delete;
+  OggOpusFileSource &operator=(const OggOpusFileSource &) = delete;
+
+  bool nextPacket(rtc::Buffer &payload, uint32_t &samples) override;
+
+  // Of the file's audio, past its pre-skip.
+  int64_t positionMs() const;
+  int64_t durationMs() const { return _durationMs; }
+  int channels() const { return _channels; }
+  uint64_t sentPackets() const { return _sentPackets.load(std::memory_order_relaxed); }
+  // Set once the end of a source that doesn't loop has been reached.
+  bool finished() const { return _finished.load(std::memory_order_relaxed); }
+
+private:
+  explicit OggOpusFileSource(std::shared_ptr<MappedAudioFile> mapping, bool loop);
+
+  bool ReadHeaders();
+  // Appends the next packet of the Opus stream to |packet|.
+  bool ReadPacket(rtc::Buffer &packet);
+  // Moves to the next valid page of the Opus stream at or after
+  // |_nextPageOffset|.
+  bool NextPage();
+  // Granule position of the last page of the Opus stream.
+  int64_t LastGranulePosition() const;
+
+  const std::shared_ptr<MappedAudioFile> _mapping;
+  const uint8_t *const _data;
+  const size_t _size;
+  const bool _loop;
+
+  uint32_t _serial = 0;
+  int _channels = 0;
+  int _preSkip = 0;
+  int64_t _durationMs = 0;
+  size_t _firstAudioPageOffset = 0;
+
+  // The current page's header type, its segment table and the segment read
+  // next.
+  uint8_t _pageFlags = 0;
+  const uint8_t *_segments = nullptr;
+  int _segmentCount = 0;
+  int _segment = 0;
+  size_t _packetOffset = 0;
+  size_t _nextPageOffset = 0;
+  bool _isLastPage = false;
+  size_t _prefetchedUntil = 0;
+
+  std::atomic<int64_t> _loopSamples{0};
+  std::atomic<uint64_t> _sentPackets{0};
+  std::atomic<bool> _finished{false};
+};
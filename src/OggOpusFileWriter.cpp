@@ -0,0 +1,141 @@
+#include "OggOpusFileWriter.h"
+
+#include <chrono>
+#include <cstring>
+
+#include <modules/audio_coding/codecs/opus/opus_interface.h>
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+
+namespace {
+
+// Opus packet duration; 20 ms is the best quality/overhead trade-off.
+const int kPacketsPerSecond = 50;
+// Granule positions always count 48 kHz samples (RFC 7845, section 4).
+const int64_t kGranuleSamplesPerPacket = 48000 / kPacketsPerSecond;
+// Largest packet the encoder is allowed to produce.
+const size_t kMaxPacketBytes = 4000;
+// Seconds of input that may wait for the encoder.
+const size_t kBufferSeconds = 4;
+
+const auto kEncodeInterval = std::chrono::milliseconds(20);
+
+}  // namespace
+
+OggOpusFileWriter::OggOpusFileWriter(std::string filename,
+                                     AudioFormat format,
+                                     AudioWriterStats *stats,
+                                     int bitrate,
+                                     int pageIntervalMs)
+    : _filename(std::move(filename)),
+      _format(format),
+      _samplesPerPacket(static_cast<size_t>(format.sampleRate / kPacketsPerSecond)),
+      _bytesPerPacket(_samplesPerPacket * format.channels * sizeof(int16_t)),
+      _stats(stats),
+      _bitrate(bitrate),
+      _ring(format.BytesPer10Ms() * 100 * kBufferSeconds),
+      _stream(format.channels, format.sampleRate, pageIntervalMs),
+      _pcm(_samplesPerPacket * format.channels),
+      _packet(kMaxPacketBytes) {}
+
+OggOpusFileWriter::~OggOpusFileWriter() {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  if (_thread) {
+    _thread->Stop();
+    _thread.reset();
+  }
+  if (_encoder) {
+    WebRtcOpus_EncoderFree(_encoder);
+  }
+  _stream.Close();
+}
+
+bool OggOpusFileWriter::Open() {
+  if (_format.sampleRate == 32000) {
+    RTC_LOG(LS_ERROR) << "Opus does not support 32 kHz, cannot record: " << _filename;
+    return false;
+  }
+  // Application 1 favours faithfulness over speech intelligibility, which
+  // suits recordings of mixed music and voice.
+  if (WebRtcOpus_EncoderCreate(&_encoder, _format.channels, 1, _format.sampleRate) != 0) {
+    RTC_LOG(LS_ERROR) << "Failed to create Opus encoder for: " << _filename;
+    _encoder = nullptr;
+    return false;
+  }
+  WebRtcOpus_SetBitRate(_encoder, _bitrate);
+
+  if (!_stream.Open(_filename)) {
+    RTC_LOG(LS_ERROR) << "Failed to open playout file: " << _filename;
+    return false;
+  }
+
+  _thread.reset(new rtc::PlatformThread(
+      ThreadFunc, this, "tgcalls_opus_writer", rtc::kNormalPriority));
+  _thread->Start();
+
+  RTC_LOG(LS_INFO) << "Recording Opus at " << _bitrate << " bps to: " << _filename;
+  return true;
+}
+
+bool OggOpusFileWriter::Write(const int8_t *frame, size_t length) {
+  if (_ring.WriteAvailable() < length) {
+    if (_stats) {
+      _stats->droppedFrames++;
+    }
+    return false;
+  }
+
+  _ring.Write(reinterpret_cast<const uint8_t *>(frame), length);
+  if (_stats) {
+    _stats->backlogBytes = _ring.ReadAvailable();
+  }
+  return true;
+}
+
+void OggOpusFileWriter::ThreadFunc(void *pThis) {
+  static_cast<OggOpusFileWriter *>(pThis)->Run();
+}
+
+void OggOpusFileWriter::Run() {
+  while (true) {
+    bool stopping = _stopped;
+
+    while (_ring.ReadAvailable() >= _bytesPerPacket) {
+      _ring.Read(reinterpret_cast<uint8_t *>(_pcm.data()), _bytesPerPacket);
+      EncodePacket();
+    }
+    if (_stats) {
+      _stats->backlogBytes = _ring.ReadAvailable();
+    }
+
+    if (stopping) {
+      break;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wakeUp.wait_for(lock, kEncodeInterval, [this] { return _stopped.load(); });
+  }
+
+  // Pad the last partial packet with silence so no audio is lost.
+  size_t tail = _ring.Read(reinterpret_cast<uint8_t *>(_pcm.data()), _bytesPerPacket);
+  if (tail > 0) {
+    memset(reinterpret_cast<uint8_t *>(_pcm.data()) + tail, 0, _bytesPerPacket - tail);
+    EncodePacket();
+  }
+  _stream.Close();
+}
+
+void OggOpusFileWriter::EncodePacket() {
+  int encoded = WebRtcOpus_Encode(_encoder, _pcm.data(), _samplesPerPacket,
+                                  _packet.size(), _packet.data());
+  if (encoded <= 0) {
+    RTC_LOG(LS_WARNING) << "Opus encoding failed, dropping 20 ms of: " << _filename;
+    return;
+  }
+
+  _stream.WritePacket(_packet.data(), static_cast<size_t>(encoded), kGranuleSamplesPerPacket);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "AudioOutputWriter.h"
+#include "OggOpusStream.h"
+#include "SpscRingBuffer.h"
+
+struct WebRtcOpusEncInst;
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+// Records playout capture as Opus in an Ogg container (RFC 7845).
+//
+// Like AsyncAudioFileWriter, the playout thread only copies frames into a
+// ring. A background thread encodes 20 ms packets and writes an Ogg page
+// whenever |pageIntervalMs| of audio has accumulated, so at most that much is
+// lost if the process dies mid-recording.
+class OggOpusFileWriter : public AudioOutputWriter {
+public:
+  static constexpr int kDefaultBitrate = 64000;
+  static constexpr int kDefaultPageIntervalMs = OggOpusStream::kDefaultPageIntervalMs;
+
+  // Opus has no 32 kHz mode, so Open() fails for that format.
+  OggOpusFileWriter(std::string filename,
+                    AudioFormat format,
+                    AudioWriterStats *stats,
+                    int bitrate = kDefaultBitrate,
+                    int pageIntervalMs = kDefaultPageIntervalMs);
+
+  // Encodes what is still buffered, writes the final page and closes.
+  ~OggOpusFileWriter() override;
+
+  bool Open() override;
+
+  bool Write(const int8_t *frame, size_t length) override;
+
+private:
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  // Encodes one 20 ms frame from |_pcm| and writes it to |_stream|.
+  void EncodePacket();
+
+  std::string _filename;
+  AudioFormat _format;
+  size_t _samplesPerPacket;
+  size_t _bytesPerPacket;
+  AudioWriterStats *_stats;
+  int _bitrate;
+  SpscRingBuffer _ring;
+
+  OggOpusStream _stream;
+  WebRtcOpusEncInst *_encoder = nullptr;
+
+  std::vector<int16_t> _pcm;
+  std::vector<uint8_t> _packet;
+
+  std::atomic<bool> _stopped{false};
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+
+  std::unique_ptr<rtc::PlatformThread> _thread;
+};
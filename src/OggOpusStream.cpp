@@ -0,0 +1,148 @@
+#include "OggOpusStream.h"
+
+#include <random>
+
+namespace {
+
+// Granule positions always count 48 kHz samples (RFC 7845, section 4).
+const int64_t kGranuleSamplesPerMs = 48;
+// Encoder lookahead at 48 kHz, which decoders skip (RFC 7845, section 4.2).
+const uint16_t kPreSkip = 312;
+
+const uint8_t kOggContinued = 0x01;
+const uint8_t kOggBeginOfStream = 0x02;
+const uint8_t kOggEndOfStream = 0x04;
+
+uint32_t OggCrc(const uint8_t *data, size_t length) {
+  static const auto table = [] {
+    std::vector<uint32_t> result(256);
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t value = i << 24;
+      for (int bit = 0; bit < 8; bit++) {
+        value = (value & 0x80000000u) ? (value << 1) ^ 0x04c11db7u : value << 1;
+      }
+      result[i] = value;
+    }
+    return result;
+  }();
+
+  uint32_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    crc = (crc << 8) ^ table[((crc >> 24) ^ data[i]) & 0xff];
+  }
+  return crc;
+}
+
+void PutLE(std::vector<uint8_t> &out, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+}  // namespace
+
+OggOpusStream::OggOpusStream(int channels, int inputSampleRate, int pageIntervalMs)
+    : _channels(channels),
+      _inputSampleRate(inputSampleRate),
+      _pageIntervalSamples((pageIntervalMs < 20 ? 20 : pageIntervalMs) * kGranuleSamplesPerMs) {}
+
+OggOpusStream::~OggOpusStream() {
+  Close();
+}
+
+bool OggOpusStream::Open(const std::string &filename) {
+  _file = webrtc::FileWrapper::OpenWriteOnly(filename);
+  if (!_file.is_open()) {
+    return false;
+  }
+  _serial = std::random_device()();
+  WriteHeaders();
+  return true;
+}
+
+void OggOpusStream::WritePacket(const uint8_t *data, size_t length, int samples) {
+  if (!_file.is_open()) {
+    return;
+  }
+  _granulePosition += samples;
+  _pageSamples += samples;
+  AppendPacket(data, length);
+
+  if (_pageSamples >= _pageIntervalSamples) {
+    FlushPage();
+  }
+}
+
+void OggOpusStream::Close() {
+  if (!_file.is_open()) {
+    return;
+  }
+  FlushPage(kOggEndOfStream);
+  _file.Close();
+}
+
+void OggOpusStream::AppendPacket(const uint8_t *data, size_t length) {
+  // Lacing values: a run of 255s terminated by one value below 255.
+  size_t lacingValues = length / 255 + 1;
+  if (_pageSegments.size() + lacingValues > 255) {
+    FlushPage();
+  }
+
+  for (size_t i = 0; i < length / 255; i++) {
+    _pageSegments.push_back(255);
+  }
+  _pageSegments.push_back(static_cast<uint8_t>(length % 255));
+  _pageData.insert(_pageData.end(), data, data + length);
+}
+
+void OggOpusStream::FlushPage(uint8_t flags) {
+  if (_pageSegments.empty() && !(flags & kOggEndOfStream)) {
+    return;
+  }
+
+  std::vector<uint8_t> page;
+  page.reserve(27 + _pageSegments.size() + _pageData.size());
+  page.insert(page.end(), {'O', 'g', 'g', 'S', 0});
+  page.push_back(flags & ~kOggContinued);
+  PutLE(page, static_cast<uint64_t>(_granulePosition), 8);
+  PutLE(page, _serial, 4);
+  PutLE(page, _pageSequence++, 4);
+  PutLE(page, 0, 4);  // CRC, filled in below.
+  page.push_back(static_cast<uint8_t>(_pageSegments.size()));
+  page.insert(page.end(), _pageSegments.begin(), _pageSegments.end());
+  page.insert(page.end(), _pageData.begin(), _pageData.end());
+
+  uint32_t crc = OggCrc(page.data(), page.size());
+  for (int i = 0; i < 4; i++) {
+    page[22 + i] = static_cast<uint8_t>(crc >> (8 * i));
+  }
+
+  _file.Write(page.data(), page.size());
+  _file.Flush();
+  _bytesWritten += page.size();
+
+  _pageSegments.clear();
+  _pageData.clear();
+  _pageSamples = 0;
+}
+
+void OggOpusStream::WriteHeaders() {
+  // Identification header, alone on the first page.
+  std::vector<uint8_t> head = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd', 1,
+                               static_cast<uint8_t>(_channels)};
+  PutLE(head, kPreSkip, 2);
+  PutLE(head, static_cast<uint32_t>(_inputSampleRate), 4);
+  PutLE(head, 0, 2);  // Output gain.
+  head.push_back(0);  // Channel mapping family: mono/stereo.
+  AppendPacket(head.data(), head.size());
+  FlushPage(kOggBeginOfStream);
+
+  // Comment header, also on a page of its own.
+  static const char kVendor[] = "tgcalls";
+  std::vector<uint8_t> tags = {'O', 'p', 'u', 's', 'T', 'a', 'g', 's'};
+  PutLE(tags, sizeof(kVendor) - 1, 4);
+  tags.insert(tags.end(), kVendor, kVendor + sizeof(kVendor) - 1);
+  PutLE(tags, 0, 4);  // No user comments.
+  AppendPacket(tags.data(), tags.size());
+  FlushPage();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <rtc_base/system/file_wrapper.h>
+
+// Writes Opus packets to a file as an Ogg Opus stream (RFC 7845): the two
+// header pages, then pages of packets, each written out once it holds
+// |pageIntervalMs| of audio, so at most that much is lost if the process
+// dies mid-recording.
+class OggOpusStream {
+public:
+  static constexpr int kDefaultPageIntervalMs = 1000;
+
+  OggOpusStream(int channels, int inputSampleRate, int pageIntervalMs = kDefaultPageIntervalMs);
+  // Closes the stream if it is still open.
+  ~OggOpusStream();
+
+  // Creates |filename| and writes the headers.
+  bool Open(const std::string &filename);
+  bool IsOpen() const { return _file.is_open(); }
+
+  // |samples| is the packet's duration at 48 kHz.
+  void WritePacket(const uint8_t *data, size_t length, int samples);
+
+  // Writes the last page, marked as the end of the stream, and closes.
+  void Close();
+
+  // Bytes written to the file so far.
+  uint64_t BytesWritten() const { return _bytesWritten; }
+
+private:
+  void AppendPacket(const uint8_t *data, size_t length);
+
+  // Writes the buffered page. |flags| are Ogg header type bits.
+  void FlushPage(uint8_t flags = 0);
+
+  void WriteHeaders();
+
+  int _channels;
+  int _inputSampleRate;
+  int64_t _pageIntervalSamples;
+
+  webrtc::FileWrapper _file;
+
+  // Current Ogg page.
+  std::vector<uint8_t> _pageSegments;
+  std::vector<uint8_t> _pageData;
+  int64_t _pageSamples = 0;
+  uint32_t _serial = 0;
+  uint32_t _pageSequence = 0;
+  int64_t _granulePosition = 0;
+  uint64_t _bytesWritten = 0;
+};
@@ -0,0 +1,262 @@
+#include "OpusRtpRecorder.h"
+
+#include <chrono>
+#include <cstring>
+
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+#include <rtc_base/time_utils.h>
+
+namespace {
+
+// Opus RTP timestamps are always at 48 kHz (RFC 7587).
+const int kSamplesPerMs = 48;
+// Larger payloads are not Opus packets of a voice chat.
+const size_t kMaxPayloadBytes = 1500;
+// Packets up to this far behind the ones written are late, anything older
+// is a new stream.
+const int32_t kMaxLateSamples = 1000 * kSamplesPerMs;
+
+const auto kWriteInterval = std::chrono::milliseconds(100);
+
+struct PacketHeader {
+  uint32_t ssrc;
+  uint32_t timestamp;
+  int64_t arrivalMs;
+  uint32_t size;
+};
+
+// Duration of an Opus packet at 48 kHz from its TOC byte and frame count
+// (RFC 6716, section 3.1); 0 if it is malformed.
+int OpusPacketSamples(const uint8_t *data, size_t size) {
+  if (size < 1) {
+    return 0;
+  }
+  const int config = data[0] >> 3;
+  int frameSamples;
+  if (config < 12) {
+    static const int kSilk[] = {480, 960, 1920, 2880};
+    frameSamples = kSilk[config & 3];
+  } else if (config < 16) {
+    frameSamples = (config & 1) ? 960 : 480;
+  } else {
+    static const int kCelt[] = {120, 240, 480, 960};
+    frameSamples = kCelt[config & 3];
+  }
+  int frames;
+  switch (data[0] & 3) {
+    case 0:
+      frames = 1;
+      break;
+    case 1:
+    case 2:
+      frames = 2;
+      break;
+    default:
+      if (size < 2) {
+        return 0;
+      }
+      frames = data[1] & 0x3f;
+      break;
+  }
+  const int samples = frameSamples * frames;
+  // At most 120 ms per packet.
+  return samples <= 5760 ? samples : 0;
+}
+
+// A TOC byte alone, of a fullband CELT frame of |samples|: a frame with no
+// data, which decoders conceal.
+uint8_t EmptyPacket(int samples) {
+  switch (samples) {
+    case 120: return 28 << 3;
+    case 240: return 29 << 3;
+    case 480: return 30 << 3;
+    default: return 31 << 3;
+  }
+}
+
+}  // namespace
+
+OpusRtpRecorder::OpusRtpRecorder(std::string directory, size_t queueBytes)
+    : _directory(std::move(directory)),
+      _ring(queueBytes) {}
+
+OpusRtpRecorder::~OpusRtpRecorder() {
+  Stop();
+}
+
+bool OpusRtpRecorder::Open() {
+  const auto indexFilename = _directory + "/index.csv";
+  _index = fopen(indexFilename.c_str(), "w");
+  if (!_index) {
+    RTC_LOG(LS_ERROR) << "Failed to open recording index: " << indexFilename;
+    return false;
+  }
+  fputs("ssrc,file,startMs\n", _index);
+  fflush(_index);
+
+  _startMs = rtc::TimeMillis();
+  _thread.reset(new rtc::PlatformThread(
+      ThreadFunc, this, "tgcalls_rtp_recorder", rtc::kNormalPriority));
+  _thread->Start();
+  _isRecording = true;
+
+  RTC_LOG(LS_INFO) << "Recording incoming Opus to: " << _directory;
+  return true;
+}
+
+void OpusRtpRecorder::Stop() {
+  _isRecording = false;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  if (_thread) {
+    _thread->Stop();
+    _thread.reset();
+  }
+  if (_index) {
+    fclose(_index);
+    _index = nullptr;
+  }
+}
+
+void OpusRtpRecorder::OnPacket(uint32_t ssrc, uint16_t, uint32_t timestamp, const uint8_t *payload, size_t size) {
+  if (!_isRecording.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (size == 0 || size > kMaxPayloadBytes) {
+    _droppedPackets++;
+    return;
+  }
+
+  uint8_t record[sizeof(PacketHeader) + kMaxPayloadBytes];
+  PacketHeader header{ssrc, timestamp, rtc::TimeMillis(), static_cast<uint32_t>(size)};
+  memcpy(record, &header, sizeof(header));
+  memcpy(record + sizeof(header), payload, size);
+
+  const size_t length = sizeof(header) + size;
+  if (_ring.WriteAvailable() < length) {
+    _overruns++;
+    return;
+  }
+  _ring.Write(record, length);
+}
+
+void OpusRtpRecorder::ThreadFunc(void *pThis) {
+  static_cast<OpusRtpRecorder *>(pThis)->Run();
+}
+
+void OpusRtpRecorder::Run() {
+  while (true) {
+    bool stopping = _stopped;
+
+    Drain();
+
+    if (stopping) {
+      break;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wakeUp.wait_for(lock, kWriteInterval, [this] { return _stopped.load(); });
+  }
+
+  CloseTracks();
+}
+
+void OpusRtpRecorder::Drain() {
+  uint8_t payload[kMaxPayloadBytes];
+  PacketHeader header;
+  // The network thread writes a packet in one go, so a header is always
+  // followed by its payload.
+  while (_ring.ReadAvailable() >= sizeof(header)) {
+    _ring.Read(reinterpret_cast<uint8_t *>(&header), sizeof(header));
+    _ring.Read(payload, header.size);
+    WritePacket(header.ssrc, header.timestamp, header.arrivalMs, payload, header.size);
+  }
+
+  uint64_t bytes = _closedBytes;
+  for (const auto &it : _tracks) {
+    if (it.second.stream) {
+      bytes += it.second.stream->BytesWritten();
+    }
+  }
+  _bytesWritten = bytes;
+}
+
+void OpusRtpRecorder::WritePacket(uint32_t ssrc, uint32_t timestamp, int64_t arrivalMs, const uint8_t *payload, size_t size) {
+  const int samples = OpusPacketSamples(payload, size);
+  if (samples == 0) {
+    _droppedPackets++;
+    return;
+  }
+
+  auto &track = _tracks[ssrc];
+  if (track.stream) {
+    const int32_t gap = static_cast<int32_t>(timestamp - track.nextTimestamp);
+    if (gap < 0 && gap >= -kMaxLateSamples) {
+      _droppedPackets++;
+      return;
+    }
+    if (gap < 0 || gap > kMaxGapSeconds * 1000 * kSamplesPerMs) {
+      track.stream->Close();
+      _closedBytes += track.stream->BytesWritten();
+      track.stream.reset();
+      track.segment++;
+    } else {
+      // Anything under the shortest frame is left out.
+      for (int remaining = gap; remaining >= 120; ) {
+        const int fill = remaining >= 960 ? 960 : remaining >= 480 ? 480 : remaining >= 240 ? 240 : 120;
+        const uint8_t empty = EmptyPacket(fill);
+        track.stream->WritePacket(&empty, 1, fill);
+        _filledPackets++;
+        remaining -= fill;
+      }
+    }
+  }
+  if (!track.stream) {
+    // Stereo if the first packet is.
+    const int channels = (payload[0] & 0x04) ? 2 : 1;
+    track.stream = std::make_unique<OggOpusStream>(channels, 48000);
+    if (!StartTrack(track, ssrc, arrivalMs)) {
+      track.stream.reset();
+      _droppedPackets++;
+      return;
+    }
+  }
+
+  track.stream->WritePacket(payload, size, samples);
+  track.nextTimestamp = timestamp + samples;
+  _packets++;
+}
+
+bool OpusRtpRecorder::StartTrack(Track &track, uint32_t ssrc, int64_t arrivalMs) {
+  auto filename = std::to_string(ssrc);
+  if (track.segment > 0) {
+    filename += "-" + std::to_string(track.segment);
+  }
+  filename += ".opus";
+  if (!track.stream->Open(_directory + "/" + filename)) {
+    RTC_LOG(LS_ERROR) << "Failed to open recording file: " << _directory << "/" << filename;
+    return false;
+  }
+  _files++;
+  if (_index) {
+    fprintf(_index, "%u,%s,%lld\n", ssrc, filename.c_str(), static_cast<long long>(arrivalMs - _startMs));
+    fflush(_index);
+  }
+  return true;
+}
+
+void OpusRtpRecorder::CloseTracks() {
+  for (auto &it : _tracks) {
+    if (it.second.stream) {
+      it.second.stream->Close();
+      _closedBytes += it.second.stream->BytesWritten();
+      it.second.stream.reset();
+    }
+  }
+  _tracks.clear();
+  _bytesWritten = _closedBytes;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "OggOpusStream.h"
+#include "SpscRingBuffer.h"
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+// Records every participant of a group call to an Ogg Opus file of its own,
+// straight from the Opus packets received: nothing is decoded or encoded,
+// and participants are recorded whether their audio is decoded or not.
+//
+// The call's network thread only copies packets into a ring; a thread of
+// the recorder writes them. A participant's file starts with its first
+// packet. Gaps in its RTP timestamps, from DTX or lost packets, are filled
+// with empty packets that decoders conceal, so the file keeps the sender's
+// timeline; packets older than one already written are dropped. A gap of
+// more than |kMaxGapSeconds|, or a timestamp far in the past, as when a
+// participant rejoins with the same SSRC, starts a new file.
+//
+// |directory|/index.csv gets a line per file, "ssrc,file,startMs", where
+// startMs is when its first packet arrived, in milliseconds from Open(),
+// so the tracks can be aligned with each other.
+//
+// Attach a recorder to a single call at a time.
+class OpusRtpRecorder {
+public:
+  static constexpr int kMaxGapSeconds = 600;
+  // About ten seconds of a dozen speakers at 32 kbps.
+  static constexpr size_t kDefaultQueueBytes = 1 << 19;
+
+  explicit OpusRtpRecorder(std::string directory, size_t queueBytes = kDefaultQueueBytes);
+  // Stops recording if it still is.
+  ~OpusRtpRecorder();
+
+  bool Open();
+  // Writes what is queued and closes every file; packets received
+  // afterwards are ignored.
+  void Stop();
+
+  // Called by the call's network thread for every incoming Opus packet.
+  void OnPacket(uint32_t ssrc, uint16_t sequenceNumber, uint32_t timestamp, const uint8_t *payload, size_t size);
+
+  // Packets written, empty packets written for gaps, packets dropped as
+  // late, duplicate or malformed, and packets lost because the queue was
+  // full.
+  uint64_t packets() const { return _packets.load(); }
+  uint64_t filledPackets() const { return _filledPackets.load(); }
+  uint64_t droppedPackets() const { return _droppedPackets.load(); }
+  uint64_t overruns() const { return _overruns.load(); }
+  uint64_t files() const { return _files.load(); }
+  uint64_t bytesWritten() const { return _bytesWritten.load(); }
+
+private:
+  struct Track {
+    std::unique_ptr<OggOpusStream> stream;
+    int segment = 0;
+    // RTP timestamp the next packet is expected at.
+    uint32_t nextTimestamp = 0;
+  };
+
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  // Writes the packets in |_ring|.
+  void Drain();
+
+  void WritePacket(uint32_t ssrc, uint32_t timestamp, int64_t arrivalMs, const uint8_t *payload, size_t size);
+
+  bool StartTrack(Track &track, uint32_t ssrc, int64_t arrivalMs);
+
+  void CloseTracks();
+
+  std::string _directory;
+  SpscRingBuffer _ring;
+  int64_t _startMs = 0;
+
+  FILE *_index = nullptr;
+  std::map<uint32_t, Track> _tracks;
+  uint64_t _closedBytes = 0;
+
+  std::atomic<bool> _isRecording{false};
+  std::atomic<bool> _stopped{false};
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+  std::unique_ptr<rtc::PlatformThread> _thread;
+
+  std::atomic<uint64_t> _packets{0};
+  std::atomic<uint64_t> _filledPackets{0};
+  std::atomic<uint64_t> _droppedPackets{0};
+  std::atomic<uint64_t> _overruns{0};
+  std::atomic<uint64_t> _files{0};
+  std::atomic<uint64_t> _bytesWritten{0};
+};
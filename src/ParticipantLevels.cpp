@@ -0,0 +1,65 @@
+#include "ParticipantLevels.h"
+
+#include <algorithm>
+
+ParticipantLevels::ParticipantLevels(Callback callback, std::shared_ptr<CallbackDispatcher> dispatcher)
+    : _callback(std::move(callback)), _dispatcher(std::move(dispatcher)) {}
+
+void ParticipantLevels::Resize(size_t count) {
+  if (_state.ssrcs.size() >= count) {
+    return;
+  }
+  _state.ssrcs.resize(count, 0);
+  _state.levels.resize(count, 0);
+  _state.speaking.resize((count + 7) / 8, 0);
+}
+
+void ParticipantLevels::Apply(const tgcalls::GroupLevelsUpdate &update) {
+  if (!update.isDelta) {
+    std::fill(_state.ssrcs.begin(), _state.ssrcs.end(), 0);
+    std::fill(_state.levels.begin(), _state.levels.end(), 0);
+    std::fill(_state.speaking.begin(), _state.speaking.end(), 0);
+  }
+
+  for (const auto &it : update.updates) {
+    Resize(it.index + 1);
+
+    float level = std::max(0.0f, std::min(1.0f, it.value.level));
+    bool isSpeaking = it.value.voice && !it.value.isMuted;
+    // A delta with nothing left in it is a participant that stopped being
+    // reported; its slot is free from now on.
+    bool isReleased = update.isDelta && it.ssrc != 0 && level <= 0.0f && !it.value.voice;
+
+    _state.ssrcs[it.index] = isReleased ? 0 : it.ssrc;
+    _state.levels[it.index] = static_cast<uint8_t>(level * 255.0f + 0.5f);
+    uint8_t bit = static_cast<uint8_t>(1u << (it.index % 8));
+    if (isSpeaking) {
+      _state.speaking[it.index / 8] |= bit;
+    } else {
+      _state.speaking[it.index / 8] &= static_cast<uint8_t>(~bit);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  _pending = _state;
+  if (_isPosted) {
+    return;
+  }
+  _isPosted = true;
+  _dispatcher->Post([self = shared_from_this()] {
+    self->Deliver();
+  });
+}
+
+void ParticipantLevels::Deliver() {
+  State state;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    state = std::move(_pending);
+    _pending = State();
+    _isPosted = false;
+  }
+  _callback(state.ssrcs,
+            py::bytes(reinterpret_cast<const char *>(state.levels.data()), state.levels.size()),
+            py::bytes(reinterpret_cast<const char *>(state.speaking.data()), state.speaking.size()));
+}
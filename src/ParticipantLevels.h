@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+
+#include <tgcalls/group/GroupInstanceImpl.h>
+
+#include "CallbackDispatcher.h"
+
+namespace py = pybind11;
+
+// Audio levels and speaking state of every participant, kept as dense arrays
+// indexed by tgcalls' stable level index and handed to Python once per tick.
+//
+// Index 0 is the local participant. For every other index, |ssrcs| holds the
+// participant's SSRC, or 0 while the slot is free. |levels| has one byte per
+// index (0-255 for levels 0.0-1.0) and |speaking| one bit per index, LSB
+// first. If Python falls behind, ticks are coalesced into the latest one.
+class ParticipantLevels : public std::enable_shared_from_this<ParticipantLevels> {
+public:
+    using Callback = std::function<void(const std::vector<uint32_t> &ssrcs, const py::bytes &levels, const py::bytes &speaking)>;
+
+    ParticipantLevels(Callback callback, std::shared_ptr<CallbackDispatcher> dispatcher);
+
+    // Called on the tgcalls media thread with every levels update, full or
+    // delta.
+    void Apply(const tgcalls::GroupLevelsUpdate &update);
+
+private:
+    struct State {
+        std::vector<uint32_t> ssrcs;
+        std::vector<uint8_t> levels;
+        std::vector<uint8_t> speaking;
+    };
+
+    void Resize(size_t count);
+    void Deliver();
+
+    Callback _callback;
+    std::shared_ptr<CallbackDispatcher> _dispatcher;
+
+    // Media thread only.
+    State _state;
+
+    std::mutex _mutex;
+    State _pending;
+    bool _isPosted = false;
+};
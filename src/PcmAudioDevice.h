@@ -0,0 +1,715 @@
+/*
+ *  Copyright (c) 2014 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include <memory>
+#include <string>
+
+#include <modules/audio_device/audio_device_impl.h>
+#include <modules/audio_device/audio_device_generic.h>
+#include <rtc_base/checks.h>
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+#include <rtc_base/synchronization/mutex.h>
+#include <rtc_base/time_utils.h>
+#include <tgcalls/CpuAccounting.h>
+#include <tgcalls/HotPathCounters.h>
+#include <tgcalls/LatencyTrace.h>
+#include <tgcalls/ThreadScheduling.h>
+#include <tgcalls/TraceRecorder.h>
+
+#include "AudioDeadlineClock.h"
+#include "AudioFormat.h"
+#include "AudioGlitchDetector.h"
+#include "AudioIdleSignal.h"
+#include "AudioLoudnessNormalizer.h"
+#include "AudioPump.h"
+#include "PcmAudioSinks.h"
+#include "PcmAudioSources.h"
+
+// A fake audio device exchanging 10 ms s16le frames with two policies chosen
+// at compile time:
+//
+//  - |Source| provides the audio sent into the call (the device's recording
+//    side): file, mmap, decoder, ring buffer, Python callback or null.
+//  - |Sink| takes the audio received from the call (the device's playout
+//    side): file, ring buffer, Python callback or null.
+//
+// See PcmAudioSources.h and PcmAudioSinks.h for the policy interface. The
+// ticks call the policies directly, so their I/O is inlined into the loop.
+//
+// Once the source has given kSilentFramesBeforeSkipping frames of digital
+// silence in a row, further silent frames aren't delivered, as when it's
+// paused, so an idle device costs webrtc no resampling or encoding.
+//
+// With |loudness| set, the recorded frames go through an
+// AudioLoudnessNormalizer before webrtc gets them, while it is enabled.
+//
+// The device's own playout and capture threads are started with the first
+// StartPlayout() / StartRecording() and live as long as it does. Stopped, or
+// with both the source and the sink idle, they park on the policies'
+// AudioIdleSignal instead of ticking, so stopping and starting the module is
+// cheap and an idle call wakes no thread.
+//
+// With |useSharedAudioClock| the device does not spawn its own threads and
+// is ticked by the process-wide AudioPump instead. With a |latencyTrace| the
+// time spent handing each frame to and pulling it from the engine is
+// recorded there, and with |glitches| both paths are checked for glitches.
+// The ticks are charged to the CpuAccount current when the device is made.
+template <typename Source, typename Sink>
+class PcmAudioDevice : public webrtc::AudioDeviceGeneric {
+public:
+  // Half a second, long enough for the encoder to have sent the silence
+  // and for pauses in speech to go through untouched.
+  static constexpr int kSilentFramesBeforeSkipping = 50;
+
+  PcmAudioDevice(Source source, Sink sink, AudioClockStats *clockStats,
+                 AudioLoudnessSettings *loudness = nullptr,
+                 bool useSharedAudioClock = false,
+                 std::shared_ptr<tgcalls::LatencyTrace> latencyTrace = nullptr,
+                 AudioGlitchDetector *glitches = nullptr);
+
+  ~PcmAudioDevice() override;
+
+  // Retrieve the currently utilized audio layer
+  int32_t ActiveAudioLayer(
+      webrtc::AudioDeviceModule::AudioLayer &audioLayer) const override {
+    return -1;
+  }
+
+  // Main initializaton and termination
+  InitStatus Init() override { return InitStatus::OK; }
+
+  int32_t Terminate() override { return 0; }
+
+  bool Initialized() const override { return true; }
+
+  // Device enumeration
+  int16_t PlayoutDevices() override { return 1; }
+
+  int16_t RecordingDevices() override { return 1; }
+
+  int32_t PlayoutDeviceName(uint16_t index,
+                            char name[webrtc::kAdmMaxDeviceNameSize],
+                            char guid[webrtc::kAdmMaxGuidSize]) override {
+    return DeviceName(index, name, guid);
+  }
+
+  int32_t RecordingDeviceName(uint16_t index,
+                              char name[webrtc::kAdmMaxDeviceNameSize],
+                              char guid[webrtc::kAdmMaxGuidSize]) override {
+    return DeviceName(index, name, guid);
+  }
+
+  // Device selection
+  int32_t SetPlayoutDevice(uint16_t index) override {
+    if (index == 0) {
+      _playout_index = index;
+      return 0;
+    }
+    return -1;
+  }
+
+  int32_t SetPlayoutDevice(
+      webrtc::AudioDeviceModule::WindowsDeviceType device) override {
+    return -1;
+  }
+
+  int32_t SetRecordingDevice(uint16_t index) override {
+    if (index == 0) {
+      _record_index = index;
+      return _record_index;
+    }
+    return -1;
+  }
+
+  int32_t SetRecordingDevice(
+      webrtc::AudioDeviceModule::WindowsDeviceType device) override {
+    return -1;
+  }
+
+  // Audio transport initialization
+  int32_t PlayoutIsAvailable(bool &available) override {
+    available = _playout_index == 0;
+    return available ? _playout_index : -1;
+  }
+
+  int32_t InitPlayout() override;
+
+  bool PlayoutIsInitialized() const override {
+    return _playoutFramesIn10MS != 0;
+  }
+
+  int32_t RecordingIsAvailable(bool &available) override {
+    available = _record_index == 0;
+    return available ? _record_index : -1;
+  }
+
+  int32_t InitRecording() override;
+
+  bool RecordingIsInitialized() const override {
+    return _recordingFramesIn10MS != 0;
+  }
+
+  // Audio transport control
+  int32_t StartPlayout() override;
+
+  int32_t StopPlayout() override;
+
+  bool Playing() const override { return _playing.load(); }
+
+  int32_t StartRecording() override;
+
+  int32_t StopRecording() override;
+
+  bool Recording() const override { return _recording.load(); }
+
+  // Audio mixer initialization
+  int32_t InitSpeaker() override { return -1; }
+
+  bool SpeakerIsInitialized() const override { return false; }
+
+  int32_t InitMicrophone() override { return 0; }
+
+  bool MicrophoneIsInitialized() const override { return true; }
+
+  // Speaker volume controls
+  int32_t SpeakerVolumeIsAvailable(bool &available) override { return -1; }
+
+  int32_t SetSpeakerVolume(uint32_t volume) override { return -1; }
+
+  int32_t SpeakerVolume(uint32_t &volume) const override { return -1; }
+
+  int32_t MaxSpeakerVolume(uint32_t &maxVolume) const override { return -1; }
+
+  int32_t MinSpeakerVolume(uint32_t &minVolume) const override { return -1; }
+
+  // Microphone volume controls
+  int32_t MicrophoneVolumeIsAvailable(bool &available) override { return -1; }
+
+  int32_t SetMicrophoneVolume(uint32_t volume) override { return -1; }
+
+  int32_t MicrophoneVolume(uint32_t &volume) const override { return -1; }
+
+  int32_t MaxMicrophoneVolume(uint32_t &maxVolume) const override { return -1; }
+
+  int32_t MinMicrophoneVolume(uint32_t &minVolume) const override { return -1; }
+
+  // Speaker mute control
+  int32_t SpeakerMuteIsAvailable(bool &available) override { return -1; }
+
+  int32_t SetSpeakerMute(bool enable) override { return -1; }
+
+  int32_t SpeakerMute(bool &enabled) const override { return -1; }
+
+  // Microphone mute control
+  int32_t MicrophoneMuteIsAvailable(bool &available) override { return -1; }
+
+  int32_t SetMicrophoneMute(bool enable) override { return -1; }
+
+  int32_t MicrophoneMute(bool &enabled) const override { return -1; }
+
+  // Stereo support. The channel count is fixed by the policies.
+  int32_t StereoPlayoutIsAvailable(bool &available) override {
+    available = _sink.Format().channels == 2;
+    return 0;
+  }
+
+  int32_t SetStereoPlayout(bool enable) override {
+    return enable == (_sink.Format().channels == 2) ? 0 : -1;
+  }
+
+  int32_t StereoPlayout(bool &enabled) const override {
+    enabled = _sink.Format().channels == 2;
+    return 0;
+  }
+
+  int32_t StereoRecordingIsAvailable(bool &available) override {
+    available = _source.Format().channels == 2;
+    return 0;
+  }
+
+  int32_t SetStereoRecording(bool enable) override {
+    return enable == (_source.Format().channels == 2) ? 0 : -1;
+  }
+
+  int32_t StereoRecording(bool &enabled) const override {
+    enabled = _source.Format().channels == 2;
+    return 0;
+  }
+
+  // Delay information and control
+  int32_t PlayoutDelay(uint16_t &delayMS) const override { return 0; }
+
+  void AttachAudioBuffer(webrtc::AudioDeviceBuffer *audioBuffer) override;
+
+private:
+  static int32_t DeviceName(uint16_t index,
+                            char name[webrtc::kAdmMaxDeviceNameSize],
+                            char guid[webrtc::kAdmMaxGuidSize]);
+
+  static void RecThreadFunc(void *);
+
+  static void PlayThreadFunc(void *);
+
+  bool RecThreadProcess();
+
+  bool PlayThreadProcess();
+
+  // Process exactly one 10 ms frame. Return false when the thread must stop.
+  bool RecordTick();
+
+  // Whether the frame is all zeroes.
+  static bool IsSilent(const int8_t *frame, size_t length);
+
+  // Whether the threads park rather than tick.
+  bool Idle() const { return _source.Idle() && _sink.Idle(); }
+
+  bool PlayoutTick();
+
+  int32_t _playout_index = 0;
+  int32_t _record_index = 0;
+  webrtc::AudioDeviceBuffer *_ptrAudioBuffer = nullptr;
+  std::unique_ptr<int8_t[]> _recordingBuffer;
+  std::unique_ptr<int8_t[]> _playoutBuffer;
+
+  AudioFormat _recordingFormat;
+  AudioFormat _playoutFormat;
+
+  size_t _recordingBufferSizeIn10MS = 0;
+  size_t _recordingFramesIn10MS = 0;
+  size_t _playoutFramesIn10MS = 0;
+  size_t _playoutBufferSize = 0;
+  int _silentFrames = 0;
+
+  std::unique_ptr<rtc::PlatformThread> _ptrThreadRec;
+  std::unique_ptr<rtc::PlatformThread> _ptrThreadPlay;
+  // Each guards its own path's buffer, format, and source or sink, and is
+  // held by its ticks, so that stopping waits for the tick in progress. The
+  // paths never take each other's, so a slow sink can't hold up capture.
+  webrtc::Mutex _playoutMutex;
+  webrtc::Mutex _recordingMutex;
+
+  std::atomic<bool> _playing{false};
+  std::atomic<bool> _recording{false};
+  // The source ended; the capture thread parks until the next start.
+  std::atomic<bool> _recordingEnded{false};
+  std::atomic<bool> _terminating{false};
+
+  Source _source;
+  Sink _sink;
+
+  // The policies' signal, or the device's own when they have none.
+  AudioIdleSignal _ownIdleSignal;
+  AudioIdleSignal *_idleSignal;
+
+  AudioDeadlineClock _playoutClock;
+  AudioDeadlineClock _recordingClock;
+
+  AudioLoudnessNormalizer _loudness;
+
+  bool _useSharedAudioClock;
+  AudioPumpClient _playoutPumpClient;
+  AudioPumpClient _recordingPumpClient;
+
+  std::shared_ptr<tgcalls::LatencyTrace> _latencyTrace;
+  AudioGlitchDetector *_glitches;
+  std::shared_ptr<tgcalls::CpuAccount> _cpuAccount;
+};
+
+using FileAudioDevice = PcmAudioDevice<FileSource, FileSink>;
+using RawAudioDevice = PcmAudioDevice<CallbackSource, CallbackSink>;
+using RingAudioDevice = PcmAudioDevice<RingSource, RingSink>;
+using MixerAudioDevice = PcmAudioDevice<MixerSource, NullSink>;
+
+template <typename Source, typename Sink>
+PcmAudioDevice<Source, Sink>::PcmAudioDevice(Source source, Sink sink,
+                                             AudioClockStats *clockStats,
+                                             AudioLoudnessSettings *loudness,
+                                             bool useSharedAudioClock,
+                                             std::shared_ptr<tgcalls::LatencyTrace> latencyTrace,
+                                             AudioGlitchDetector *glitches)
+    : _source(std::move(source)),
+      _sink(std::move(sink)),
+      _idleSignal(_source.IdleSignal() ? _source.IdleSignal()
+                  : _sink.IdleSignal() ? _sink.IdleSignal()
+                                       : &_ownIdleSignal),
+      _playoutClock(clockStats),
+      _recordingClock(clockStats),
+      _loudness(loudness),
+      _useSharedAudioClock(useSharedAudioClock),
+      _playoutPumpClient([this] { return _playing && PlayoutTick(); }, clockStats),
+      _recordingPumpClient([this] { return _recording && RecordTick(); }, clockStats),
+      _latencyTrace(std::move(latencyTrace)),
+      _glitches(glitches),
+      _cpuAccount(tgcalls::CpuAccounting::current()) {}
+
+template <typename Source, typename Sink>
+PcmAudioDevice<Source, Sink>::~PcmAudioDevice() {
+  if (_useSharedAudioClock) {
+    AudioPump::Shared()->Unregister(&_playoutPumpClient);
+    AudioPump::Shared()->Unregister(&_recordingPumpClient);
+  }
+
+  _terminating = true;
+  _idleSignal->Notify();
+  if (_ptrThreadPlay) {
+    _ptrThreadPlay->Stop();
+  }
+  if (_ptrThreadRec) {
+    _ptrThreadRec->Stop();
+  }
+}
+
+template <typename Source, typename Sink>
+int32_t PcmAudioDevice<Source, Sink>::DeviceName(uint16_t index,
+                                                 char name[webrtc::kAdmMaxDeviceNameSize],
+                                                 char guid[webrtc::kAdmMaxGuidSize]) {
+  const char *kName = "dummy_device";
+  const char *kGuid = "dummy_device_unique_id";
+  if (index < 1) {
+    memset(name, 0, webrtc::kAdmMaxDeviceNameSize);
+    memset(guid, 0, webrtc::kAdmMaxGuidSize);
+    memcpy(name, kName, strlen(kName));
+    memcpy(guid, kGuid, strlen(kGuid));
+    return 0;
+  }
+  return -1;
+}
+
+template <typename Source, typename Sink>
+int32_t PcmAudioDevice<Source, Sink>::InitPlayout() {
+  webrtc::MutexLock lock(&_playoutMutex);
+
+  if (_playing) {
+    return -1;
+  }
+
+  _playoutFormat = _sink.Format();
+  _playoutFramesIn10MS = _playoutFormat.FramesPer10Ms();
+  _playoutBufferSize = _playoutFormat.BytesPer10Ms();
+
+  if (_ptrAudioBuffer) {
+    // Update webrtc audio buffer with the selected parameters
+    _ptrAudioBuffer->SetPlayoutSampleRate(_playoutFormat.sampleRate);
+    _ptrAudioBuffer->SetPlayoutChannels(_playoutFormat.channels);
+  }
+  return 0;
+}
+
+template <typename Source, typename Sink>
+int32_t PcmAudioDevice<Source, Sink>::InitRecording() {
+  webrtc::MutexLock lock(&_recordingMutex);
+
+  if (_recording) {
+    return -1;
+  }
+
+  _recordingFormat = _source.Format();
+  _recordingFramesIn10MS = _recordingFormat.FramesPer10Ms();
+
+  if (_ptrAudioBuffer) {
+    _ptrAudioBuffer->SetRecordingSampleRate(_recordingFormat.sampleRate);
+    _ptrAudioBuffer->SetRecordingChannels(_recordingFormat.channels);
+  }
+  return 0;
+}
+
+template <typename Source, typename Sink>
+int32_t PcmAudioDevice<Source, Sink>::StartPlayout() {
+  {
+    webrtc::MutexLock lock(&_playoutMutex);
+    if (_playing) {
+      return 0;
+    }
+
+    _playoutBuffer.reset(new int8_t[_playoutBufferSize]);
+    if (!_sink.Start(_playoutFormat)) {
+      _playoutBuffer.reset();
+      return -1;
+    }
+    _playing = true;
+  }
+
+  if (_useSharedAudioClock) {
+    AudioPump::Shared()->Register(&_playoutPumpClient);
+  } else if (!_ptrThreadPlay) {
+    _ptrThreadPlay.reset(new rtc::PlatformThread(
+        PlayThreadFunc, this, "webrtc_audio_module_play_thread",
+        rtc::kRealtimePriority));
+    _ptrThreadPlay->Start();
+  } else {
+    _idleSignal->Notify();
+  }
+
+  RTC_LOG(LS_INFO) << "Started playout capture";
+  return 0;
+}
+
+template <typename Source, typename Sink>
+int32_t PcmAudioDevice<Source, Sink>::StopPlayout() {
+  // Ticks check the flag under the lock, so once it is taken below none
+  // will touch the sink again; the playout thread then parks.
+  _playing = false;
+  if (_useSharedAudioClock) {
+    AudioPump::Shared()->Unregister(&_playoutPumpClient);
+  }
+
+  webrtc::MutexLock lock(&_playoutMutex);
+  _sink.Stop();
+  _playoutBuffer.reset();
+
+  RTC_LOG(LS_INFO) << "Stopped playout capture";
+  return 0;
+}
+
+template <typename Source, typename Sink>
+int32_t PcmAudioDevice<Source, Sink>::StartRecording() {
+  {
+    webrtc::MutexLock lock(&_recordingMutex);
+    if (_recording) {
+      return 0;
+    }
+
+    _recordingBufferSizeIn10MS = _recordingFormat.BytesPer10Ms();
+    _recordingBuffer.reset(new int8_t[_recordingBufferSizeIn10MS]);
+    _silentFrames = 0;
+    _loudness.Prepare(_recordingFormat);
+    _loudness.Bypass();
+    if (!_source.Start(_recordingFormat)) {
+      _recordingBuffer.reset();
+      return -1;
+    }
+    _recordingEnded = false;
+    _recording = true;
+  }
+
+  if (_useSharedAudioClock) {
+    AudioPump::Shared()->Register(&_recordingPumpClient);
+  } else if (!_ptrThreadRec) {
+    _ptrThreadRec.reset(new rtc::PlatformThread(
+        RecThreadFunc, this, "webrtc_audio_module_capture_thread",
+        rtc::kRealtimePriority));
+    _ptrThreadRec->Start();
+  } else {
+    _idleSignal->Notify();
+  }
+
+  RTC_LOG(LS_INFO) << "Started recording";
+  return 0;
+}
+
+template <typename Source, typename Sink>
+int32_t PcmAudioDevice<Source, Sink>::StopRecording() {
+  _recording = false;
+  if (_useSharedAudioClock) {
+    AudioPump::Shared()->Unregister(&_recordingPumpClient);
+  }
+
+  webrtc::MutexLock lock(&_recordingMutex);
+  _source.Stop();
+  _recordingBuffer.reset();
+
+  RTC_LOG(LS_INFO) << "Stopped recording";
+  return 0;
+}
+
+template <typename Source, typename Sink>
+void PcmAudioDevice<Source, Sink>::AttachAudioBuffer(webrtc::AudioDeviceBuffer *audioBuffer) {
+  webrtc::MutexLock playoutLock(&_playoutMutex);
+  webrtc::MutexLock recordingLock(&_recordingMutex);
+
+  _ptrAudioBuffer = audioBuffer;
+
+  // Inform the AudioBuffer about default settings for this implementation.
+  // Set all values to zero here since the actual settings will be done by
+  // InitPlayout and InitRecording later.
+  _ptrAudioBuffer->SetRecordingSampleRate(0);
+  _ptrAudioBuffer->SetPlayoutSampleRate(0);
+  _ptrAudioBuffer->SetRecordingChannels(0);
+  _ptrAudioBuffer->SetPlayoutChannels(0);
+}
+
+template <typename Source, typename Sink>
+void PcmAudioDevice<Source, Sink>::PlayThreadFunc(void *pThis) {
+  auto *device = static_cast<PcmAudioDevice *>(pThis);
+  tgcalls::ThreadScheduling::applyToCurrentThread(tgcalls::ThreadRole::AudioDevice);
+  while (device->PlayThreadProcess()) {
+  }
+}
+
+template <typename Source, typename Sink>
+void PcmAudioDevice<Source, Sink>::RecThreadFunc(void *pThis) {
+  auto *device = static_cast<PcmAudioDevice *>(pThis);
+  tgcalls::ThreadScheduling::applyToCurrentThread(tgcalls::ThreadRole::AudioDevice);
+  while (device->RecThreadProcess()) {
+  }
+}
+
+template <typename Source, typename Sink>
+bool PcmAudioDevice<Source, Sink>::PlayThreadProcess() {
+  const auto parked = [this] {
+    return !_terminating && (!_playing || Idle());
+  };
+  if (parked()) {
+    _idleSignal->WaitWhile(parked);
+    // Due right away, without catching up on the time parked.
+    _playoutClock.Reset();
+  }
+  if (_terminating) {
+    return false;
+  }
+
+  const int ticks = _playoutClock.WaitForNextTick();
+  for (int i = 0; i < ticks && _playing; i++) {
+    PlayoutTick();
+  }
+
+  return true;
+}
+
+template <typename Source, typename Sink>
+bool PcmAudioDevice<Source, Sink>::RecThreadProcess() {
+  const auto parked = [this] {
+    return !_terminating && (!_recording || _recordingEnded || Idle());
+  };
+  if (parked()) {
+    _idleSignal->WaitWhile(parked);
+    _recordingClock.Reset();
+  }
+  if (_terminating) {
+    return false;
+  }
+
+  const int ticks = _recordingClock.WaitForNextTick();
+  for (int i = 0; i < ticks && _recording; i++) {
+    if (!RecordTick()) {
+      _recordingEnded = true;
+      break;
+    }
+  }
+
+  return true;
+}
+
+template <typename Source, typename Sink>
+bool PcmAudioDevice<Source, Sink>::PlayoutTick() {
+  tgcalls::TraceScope trace("audio", "playoutTick");
+  tgcalls::CpuTimeScope cpuScope(_cpuAccount, tgcalls::CpuAccount::Thread::Audio);
+  webrtc::MutexLock lock(&_playoutMutex);
+  if (!_playing) {
+    return true;
+  }
+
+  // The mix is pulled on this thread, so the expansions it starts here are
+  // this device's.
+  const uint64_t expands = _glitches ? tgcalls::HotPathCounters::threadJitterBufferExpands() : 0;
+  if (_latencyTrace) {
+    const auto startUs = rtc::TimeMicros();
+    _ptrAudioBuffer->RequestPlayoutData(_playoutFramesIn10MS);
+    _latencyTrace->record(tgcalls::LatencyTrace::Stage::Playout, rtc::TimeMicros() - startUs);
+  } else {
+    _ptrAudioBuffer->RequestPlayoutData(_playoutFramesIn10MS);
+  }
+
+  size_t frames = _ptrAudioBuffer->GetPlayoutData(_playoutBuffer.get());
+  RTC_DCHECK_EQ(_playoutFramesIn10MS, frames);
+  _sink.Write(_playoutBuffer.get(), _playoutBufferSize);
+  if (_glitches) {
+    _glitches->OnPlayoutFrame(reinterpret_cast<const int16_t *>(_playoutBuffer.get()),
+                              _playoutBufferSize / sizeof(int16_t), _playoutFormat.channels,
+                              IsSilent(_playoutBuffer.get(), _playoutBufferSize),
+                              tgcalls::HotPathCounters::threadJitterBufferExpands() - expands);
+  }
+
+  return true;
+}
+
+template <typename Source, typename Sink>
+bool PcmAudioDevice<Source, Sink>::RecordTick() {
+  tgcalls::TraceScope trace("audio", "recordTick");
+  tgcalls::CpuTimeScope cpuScope(_cpuAccount, tgcalls::CpuAccount::Thread::Audio);
+  _recordingMutex.Lock();
+  if (!_recording) {
+    _recordingMutex.Unlock();
+    return true;
+  }
+
+  const int8_t *frame = _recordingBuffer.get();
+  PcmReadResult result = _source.Read(_recordingBuffer.get(), _recordingBufferSizeIn10MS, &frame);
+  if (result != PcmReadResult::kFrame && result != PcmReadResult::kShortFrame) {
+    _recordingMutex.Unlock();
+    return result != PcmReadResult::kEnded;
+  }
+
+  const bool isSilent = IsSilent(frame, _recordingBufferSizeIn10MS);
+  if (_glitches) {
+    _glitches->OnCaptureFrame(reinterpret_cast<const int16_t *>(frame),
+                              _recordingBufferSizeIn10MS / sizeof(int16_t), _recordingFormat.channels,
+                              isSilent, result == PcmReadResult::kShortFrame);
+  }
+  if (!isSilent) {
+    _silentFrames = 0;
+  } else if (_silentFrames < kSilentFramesBeforeSkipping) {
+    _silentFrames++;
+  } else {
+    _recordingMutex.Unlock();
+    return true;
+  }
+
+  if (_loudness.Enabled()) {
+    if (frame != _recordingBuffer.get()) {
+      // Owned by the source, which may play it again.
+      memcpy(_recordingBuffer.get(), frame, _recordingBufferSizeIn10MS);
+      frame = _recordingBuffer.get();
+    }
+    _loudness.Process(reinterpret_cast<int16_t *>(_recordingBuffer.get()));
+  } else {
+    _loudness.Bypass();
+  }
+
+  _ptrAudioBuffer->SetRecordedBuffer(frame, _recordingFramesIn10MS);
+  // Delivered unlocked: the encoder may take a while, and stopping needn't
+  // wait for it.
+  _recordingMutex.Unlock();
+  if (_latencyTrace) {
+    // Marked first: the encoder queue may send the packet before the
+    // delivery returns.
+    const auto startUs = rtc::TimeMicros();
+    _latencyTrace->onFrameCaptured(startUs);
+    _ptrAudioBuffer->DeliverRecordedData();
+    _latencyTrace->record(tgcalls::LatencyTrace::Stage::Capture, rtc::TimeMicros() - startUs);
+  } else {
+    _ptrAudioBuffer->DeliverRecordedData();
+  }
+  return true;
+}
+
+template <typename Source, typename Sink>
+bool PcmAudioDevice<Source, Sink>::IsSilent(const int8_t *frame, size_t length) {
+  // OR-ed a word at a time, which the compiler vectorizes; frames are whole
+  // s16 samples, so at most a few bytes are left over.
+  uint64_t bits = 0;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, frame + i, sizeof(word));
+    bits |= word;
+  }
+  for (; i < length; i++) {
+    bits |= static_cast<uint8_t>(frame[i]);
+  }
+  return bits == 0;
+}
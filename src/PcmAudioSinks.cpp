@@ -0,0 +1,52 @@
+#include "PcmAudioSinks.h"
+
+#include <rtc_base/logging.h>
+
+#include "AsyncAudioFileWriter.h"
+#include "NetworkAudioOutputWriter.h"
+#include "OggOpusFileWriter.h"
+
+bool FileSink::Start(const AudioFormat &format) {
+  auto isSet = [](const std::function<bool()> &option) {
+    return option && option();
+  };
+
+  auto outputFilename = _descriptor->_currentOutputFilename();
+  if (outputFilename.empty()) {
+    return true;
+  }
+
+  if (isSet(_descriptor->_isNetworkOutput)) {
+    _writer.reset(new NetworkAudioOutputWriter(
+        outputFilename, format, &_descriptor->_writerStats,
+        _descriptor->_networkOutputOptions, _descriptor->_networkOutputStats));
+  } else if (isSet(_descriptor->_isOpusOutput)) {
+    _writer.reset(new OggOpusFileWriter(
+        outputFilename, format, &_descriptor->_writerStats,
+        _descriptor->_outputOpusBitrate, _descriptor->_outputOggPageIntervalMs));
+  } else if (isSet(_descriptor->_isAsyncOutput)) {
+    _writer.reset(new AsyncAudioFileWriter(
+        outputFilename, &_descriptor->_writerStats, _descriptor->_isDirectIoOutput));
+  }
+
+  if (_writer) {
+    if (!_writer->Open()) {
+      _writer.reset();
+      return false;
+    }
+  } else {
+    _file = webrtc::FileWrapper::OpenWriteOnly(outputFilename.c_str());
+    if (!_file.is_open()) {
+      RTC_LOG(LS_ERROR) << "Failed to open playout file: " << outputFilename;
+      return false;
+    }
+  }
+
+  RTC_LOG(LS_INFO) << "Started playout capture to output file: " << outputFilename;
+  return true;
+}
+
+void FileSink::Stop() {
+  _file.Close();
+  _writer.reset();
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <memory>
+
+#include <rtc_base/system/file_wrapper.h>
+
+#include "AudioFormat.h"
+#include "AudioIdleSignal.h"
+#include "AudioOutputWriter.h"
+#include "FileAudioDeviceDescriptor.h"
+#include "RawAudioDeviceDescriptor.h"
+#include "RingAudioDeviceDescriptor.h"
+
+// Sinks take the audio a PcmAudioDevice receives from the call. A sink
+// implements:
+//
+//   AudioFormat Format() const;
+//   bool Start(const AudioFormat &format);  // false fails StartPlayout
+//   void Stop();
+//   void Write(const int8_t *frame, size_t length);
+//   bool Idle() const;
+//   AudioIdleSignal *IdleSignal() const;  // may be null
+//
+// Write() is called once per 10 ms with the device mutex held. Idle() is as
+// for sources.
+
+class NullSink {
+public:
+  AudioFormat Format() const { return AudioFormat(); }
+
+  bool Start(const AudioFormat &) { return true; }
+
+  void Stop() {}
+
+  void Write(const int8_t *, size_t) {}
+
+  bool Idle() const { return true; }
+
+  AudioIdleSignal *IdleSignal() const { return nullptr; }
+};
+
+// Playout capture of a FileAudioDeviceDescriptor: raw PCM written from the
+// playout thread, or an AsyncAudioFileWriter / OggOpusFileWriter /
+// NetworkAudioOutputWriter.
+class FileSink {
+public:
+  explicit FileSink(std::shared_ptr<FileAudioDeviceDescriptor> descriptor)
+      : _descriptor(std::move(descriptor)) {}
+
+  AudioFormat Format() const { return _descriptor->_playoutFormat; }
+
+  bool Start(const AudioFormat &format);
+
+  void Stop();
+
+  void Write(const int8_t *frame, size_t length) {
+    if (_descriptor->_recordingIsPaused()) {
+      return;
+    }
+    if (_writer) {
+      _writer->Write(frame, length);
+    } else if (_file.is_open()) {
+      _file.Write(frame, length);
+    }
+  }
+
+  bool Idle() const { return _descriptor->_recordingIsIdle(); }
+
+  AudioIdleSignal *IdleSignal() const { return &_descriptor->_idleSignal; }
+
+private:
+  std::shared_ptr<FileAudioDeviceDescriptor> _descriptor;
+  webrtc::FileWrapper _file;
+  std::unique_ptr<AudioOutputWriter> _writer;
+};
+
+// Frames handed to Python through a RawAudioDeviceDescriptor callback.
+class CallbackSink {
+public:
+  explicit CallbackSink(std::shared_ptr<RawAudioDeviceDescriptor> descriptor)
+      : _descriptor(std::move(descriptor)) {}
+
+  AudioFormat Format() const { return _descriptor->_playoutFormat; }
+
+  bool Start(const AudioFormat &) { return true; }
+
+  void Stop() {}
+
+  void Write(const int8_t *frame, size_t length) {
+    if (!_descriptor->_recordingIsPaused()) {
+      _descriptor->_setRecordedBuffer(frame, length);
+    }
+  }
+
+  bool Idle() const { return _descriptor->_recordingIsIdle(); }
+
+  AudioIdleSignal *IdleSignal() const { return &_descriptor->_idleSignal; }
+
+private:
+  std::shared_ptr<RawAudioDeviceDescriptor> _descriptor;
+};
+
+// Audio queued in a RingAudioDeviceDescriptor for Python to pop.
+class RingSink {
+public:
+  explicit RingSink(std::shared_ptr<RingAudioDeviceDescriptor> descriptor)
+      : _descriptor(std::move(descriptor)) {}
+
+  AudioFormat Format() const { return _descriptor->_playoutFormat; }
+
+  bool Start(const AudioFormat &) { return true; }
+
+  void Stop() {}
+
+  void Write(const int8_t *frame, size_t length) {
+    if (_descriptor->_isRecordingPaused) {
+      return;
+    }
+    size_t written = _descriptor->_recordedRing.Write(
+        reinterpret_cast<const uint8_t *>(frame), length);
+    if (written < length) {
+      _descriptor->_overruns++;
+    }
+  }
+
+  bool Idle() const { return _descriptor->_isRecordingPaused.load(std::memory_order_relaxed); }
+
+  AudioIdleSignal *IdleSignal() const { return &_descriptor->_idleSignal; }
+
+private:
+  std::shared_ptr<RingAudioDeviceDescriptor> _descriptor;
+};
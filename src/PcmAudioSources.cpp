@@ -0,0 +1,134 @@
+#include "PcmAudioSources.h"
+
+#include <rtc_base/logging.h>
+
+bool FileSource::Start(const AudioFormat &format) {
+  _descriptor->_inputQueue->SetFormat(format);
+  _stretcher.Prepare(format);
+  _stretcherInput.resize(format.BytesPer10Ms());
+
+  auto inputFilename = _descriptor->_currentInputFilename();
+  if (inputFilename.empty()) {
+    return true;
+  }
+
+  _input = FileInput::Open(inputFilename, _descriptor->_inputOptions(), format);
+  if (!_input) {
+    return false;
+  }
+  _descriptor->_inputPositionMs = 0;
+
+  RTC_LOG(LS_INFO) << "Started recording from input file: " << inputFilename;
+  return true;
+}
+
+void FileSource::Stop() {
+  _input.reset();
+  _stretcher.Reset();
+}
+
+PcmReadResult FileSource::ReadStretched(float speed, int8_t *buffer, size_t length) {
+  if (_stretcherInput.size() != length) {
+    _stretcherInput.resize(length);
+  }
+
+  bool isShort = false;
+  while (_stretcher.NeedsInput(speed)) {
+    auto result = ReadInput(_stretcherInput.data(), length, nullptr);
+    if (result == PcmReadResult::kShortFrame) {
+      isShort = true;
+    } else if (result != PcmReadResult::kFrame) {
+      if (result == PcmReadResult::kEnded) {
+        // What's left is less than a block or two of read-ahead.
+        _stretcher.Reset();
+      }
+      return result;
+    }
+    _stretcher.Push(reinterpret_cast<const int16_t *>(_stretcherInput.data()));
+  }
+
+  _stretcher.Process(speed, reinterpret_cast<int16_t *>(buffer));
+  return isShort ? PcmReadResult::kShortFrame : PcmReadResult::kFrame;
+}
+
+PcmReadResult FileSource::FinishFrame(int8_t *buffer, size_t length, size_t read) {
+  // At most one transition per frame, so a broken or tiny input cannot keep
+  // the capture thread spinning.
+  bool moved = false;
+  bool isShort = false;
+  while (read < length && !moved) {
+    if (_input && !_input->Finished()) {
+      // The decoder fell behind; pad with silence rather than stalling the
+      // capture thread.
+      isShort = true;
+      break;
+    }
+
+    if (_input) {
+      NotifyPlayoutEnded(_input->filename());
+    }
+
+    auto next = _descriptor->_inputQueue->TakeReady();
+    if (next) {
+      _descriptor->_inputQueue->Retire(std::move(_input));
+      _input = std::move(next);
+    } else if (_descriptor->_inputQueue->Size() > 0) {
+      // The next input is still being opened.
+      _descriptor->_inputQueue->Retire(std::move(_input));
+      isShort = true;
+      break;
+    } else if (_input && _descriptor->_playoutIsEndless()) {
+      _input->Rewind();
+    } else {
+      _descriptor->_inputQueue->Retire(std::move(_input));
+      if (read == 0) {
+        return PcmReadResult::kEnded;
+      }
+      break;
+    }
+
+    moved = true;
+    read += _input->Read(buffer + read, length - read, nullptr);
+    _descriptor->_inputPositionMs = _input->PositionMs();
+  }
+
+  memset(buffer + read, 0, length - read);
+  return isShort && read < length ? PcmReadResult::kShortFrame : PcmReadResult::kFrame;
+}
+
+void FileSource::NotifyPlayoutEnded(const std::string &filename) {
+  auto descriptor = _descriptor;
+  if (!descriptor->_playoutEndedCallback) {
+    return;
+  }
+
+  if (descriptor->_callbackDispatcher) {
+    descriptor->_callbackDispatcher->Post([descriptor, filename] {
+      descriptor->_playoutEndedCallback(filename);
+    });
+  } else {
+    descriptor->_playoutEndedCallback(filename);
+  }
+}
+
+bool CallbackSource::Start(const AudioFormat &format) {
+  if (_descriptor->_lookaheadMs == 0) {
+    return true;
+  }
+
+  size_t bytesPerMs = format.BytesPer10Ms() / 10;
+  auto descriptor = _descriptor;
+  _prefetcher.reset(new AudioPrefetcher(
+      [descriptor](int8_t *data, size_t length) {
+        return descriptor->_fetchPlayoutBuffer(data, length);
+      },
+      format, _descriptor->_lookaheadMs * bytesPerMs,
+      _descriptor->_prefetchBatchMs * bytesPerMs, &_descriptor->_lookaheadStats));
+  _prefetcher->Start();
+  return true;
+}
+
+void CallbackSource::Stop() {
+  _prefetcher.reset();
+  _descriptor->_lookaheadStats.fillBytes = 0;
+}
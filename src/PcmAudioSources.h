@@ -0,0 +1,237 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AudioFormat.h"
+#include "AudioIdleSignal.h"
+#include "AudioPrefetcher.h"
+#include "AudioTimeStretcher.h"
+#include "FileAudioDeviceDescriptor.h"
+#include "FileInput.h"
+#include "MixerAudioDeviceDescriptor.h"
+#include "RawAudioDeviceDescriptor.h"
+#include "RingAudioDeviceDescriptor.h"
+
+// Sources provide the audio a PcmAudioDevice sends into the call. A source
+// implements:
+//
+//   AudioFormat Format() const;
+//   bool Start(const AudioFormat &format);  // false fails StartRecording
+//   void Stop();
+//   PcmReadResult Read(int8_t *buffer, size_t length, const int8_t **frame);
+//   bool Idle() const;
+//   AudioIdleSignal *IdleSignal() const;  // may be null
+//
+// Read() is called once per 10 ms with the device mutex held. It either fills
+// |buffer| or points |*frame| at |length| bytes it owns, which stay valid
+// until the next call.
+//
+// Idle() is true while the source is paused in a way that notifies
+// IdleSignal() when it ends; when the sink is idle too, the device threads
+// park on that signal instead of ticking.
+enum class PcmReadResult {
+  // A frame is ready.
+  kFrame,
+  // A frame is ready, but the source ran short of input and padded part of
+  // it with silence.
+  kShortFrame,
+  // Nothing to send this tick (paused, no input, looping back).
+  kNoFrame,
+  // The input is over; the capture thread stops.
+  kEnded,
+};
+
+class NullSource {
+public:
+  AudioFormat Format() const { return AudioFormat(); }
+
+  bool Start(const AudioFormat &) { return true; }
+
+  void Stop() {}
+
+  PcmReadResult Read(int8_t *, size_t, const int8_t **) {
+    return PcmReadResult::kNoFrame;
+  }
+
+  bool Idle() const { return true; }
+
+  AudioIdleSignal *IdleSignal() const { return nullptr; }
+};
+
+// The input of a FileAudioDeviceDescriptor. The file is opened on every
+// StartRecording, since Python may switch files (and their kind) between
+// restarts. When it ends, the next input from |_inputQueue| continues in the
+// same frame, so queued tracks play back to back without a gap. Away from 1x,
+// frames go through an AudioTimeStretcher, which reads ahead of playback.
+class FileSource {
+public:
+  explicit FileSource(std::shared_ptr<FileAudioDeviceDescriptor> descriptor)
+      : _descriptor(std::move(descriptor)) {}
+
+  AudioFormat Format() const { return _descriptor->_recordingFormat; }
+
+  bool Start(const AudioFormat &format);
+
+  void Stop();
+
+  PcmReadResult Read(int8_t *buffer, size_t length, const int8_t **frame) {
+    if (_input && _descriptor->_seekRequestMs.load(std::memory_order_relaxed) >= 0) {
+      _input->Seek(_descriptor->_seekRequestMs.exchange(-1));
+      _descriptor->_inputPositionMs = _input->PositionMs();
+      _stretcher.Reset();
+    }
+
+    if (_descriptor->_playoutIsPaused()) {
+      return PcmReadResult::kNoFrame;
+    }
+
+    float speed = _descriptor->_playbackSpeed.load(std::memory_order_relaxed);
+    if (speed == 1.0f && !_stretcher.HasPending()) {
+      _stretcher.Reset();
+      return ReadInput(buffer, length, frame);
+    }
+    return ReadStretched(speed, buffer, length);
+  }
+
+  bool Idle() const { return _descriptor->_playoutIsIdle(); }
+
+  AudioIdleSignal *IdleSignal() const { return &_descriptor->_idleSignal; }
+
+private:
+  PcmReadResult ReadInput(int8_t *buffer, size_t length, const int8_t **frame) {
+    size_t read = 0;
+    if (_input) {
+      read = _input->Read(buffer, length, frame);
+      _descriptor->_inputPositionMs.store(_input->PositionMs(), std::memory_order_relaxed);
+      if (read == length) {
+        return PcmReadResult::kFrame;
+      }
+    } else if (_descriptor->_inputQueue->Size() == 0) {
+      return PcmReadResult::kNoFrame;
+    }
+    return FinishFrame(buffer, length, read);
+  }
+
+  // Reads as many input frames as |_stretcher| needs for one at |speed|.
+  PcmReadResult ReadStretched(float speed, int8_t *buffer, size_t length);
+
+  // Completes a frame the current input could not fill, moving on to the
+  // next input or looping where needed.
+  PcmReadResult FinishFrame(int8_t *buffer, size_t length, size_t read);
+
+  void NotifyPlayoutEnded(const std::string &filename);
+
+  std::shared_ptr<FileAudioDeviceDescriptor> _descriptor;
+  std::unique_ptr<FileInput> _input;
+  AudioTimeStretcher _stretcher;
+  std::vector<int8_t> _stretcherInput;
+};
+
+// Frames requested from Python through a RawAudioDeviceDescriptor callback,
+// either on every tick or ahead of time through an AudioPrefetcher.
+class CallbackSource {
+public:
+  explicit CallbackSource(std::shared_ptr<RawAudioDeviceDescriptor> descriptor)
+      : _descriptor(std::move(descriptor)) {}
+
+  AudioFormat Format() const { return _descriptor->_recordingFormat; }
+
+  bool Start(const AudioFormat &format);
+
+  void Stop();
+
+  PcmReadResult Read(int8_t *buffer, size_t length, const int8_t **frame) {
+    if (_descriptor->_playoutIsPaused()) {
+      return PcmReadResult::kNoFrame;
+    }
+
+    bool full = true;
+    if (_prefetcher) {
+      full = _prefetcher->Read(buffer, length);
+    } else if (_descriptor->_hasPlayoutBufferView()) {
+      // Python fills the view in place; what it leaves is not known.
+      *frame = _descriptor->_getPlayoutBufferView(length);
+    } else {
+      full = _descriptor->_getPlayoutBuffer(buffer, length);
+    }
+    return full ? PcmReadResult::kFrame : PcmReadResult::kShortFrame;
+  }
+
+  bool Idle() const { return _descriptor->_playoutIsIdle(); }
+
+  AudioIdleSignal *IdleSignal() const { return &_descriptor->_idleSignal; }
+
+private:
+  std::shared_ptr<RawAudioDeviceDescriptor> _descriptor;
+  std::unique_ptr<AudioPrefetcher> _prefetcher;
+};
+
+// Audio pushed by Python into a RingAudioDeviceDescriptor.
+class RingSource {
+public:
+  explicit RingSource(std::shared_ptr<RingAudioDeviceDescriptor> descriptor)
+      : _descriptor(std::move(descriptor)) {}
+
+  AudioFormat Format() const { return _descriptor->_recordingFormat; }
+
+  bool Start(const AudioFormat &) { return true; }
+
+  void Stop() {}
+
+  PcmReadResult Read(int8_t *buffer, size_t length, const int8_t **) {
+    if (_descriptor->_isPlayoutPaused) {
+      return PcmReadResult::kNoFrame;
+    }
+
+    size_t read = _descriptor->_playedRing.Read(reinterpret_cast<uint8_t *>(buffer), length);
+    if (read < length) {
+      // Play whatever arrived and pad the rest of the frame with silence.
+      memset(buffer + read, 0, length - read);
+      _descriptor->_underruns++;
+      return PcmReadResult::kShortFrame;
+    }
+    return PcmReadResult::kFrame;
+  }
+
+  bool Idle() const { return _descriptor->_isPlayoutPaused.load(std::memory_order_relaxed); }
+
+  AudioIdleSignal *IdleSignal() const { return &_descriptor->_idleSignal; }
+
+private:
+  std::shared_ptr<RingAudioDeviceDescriptor> _descriptor;
+};
+
+// The mix of every input of a MixerAudioDeviceDescriptor.
+class MixerSource {
+public:
+  explicit MixerSource(std::shared_ptr<MixerAudioDeviceDescriptor> descriptor)
+      : _descriptor(std::move(descriptor)) {}
+
+  AudioFormat Format() const { return _descriptor->_recordingFormat; }
+
+  bool Start(const AudioFormat &format) {
+    _descriptor->_mixer.Prepare(format.FramesPer10Ms() * format.channels);
+    return true;
+  }
+
+  void Stop() {}
+
+  PcmReadResult Read(int8_t *buffer, size_t length, const int8_t **) {
+    if (_descriptor->_isPlayoutPaused) {
+      return PcmReadResult::kNoFrame;
+    }
+
+    _descriptor->_mixer.Mix(reinterpret_cast<int16_t *>(buffer), length / sizeof(int16_t));
+    return PcmReadResult::kFrame;
+  }
+
+  bool Idle() const { return _descriptor->_isPlayoutPaused.load(std::memory_order_relaxed); }
+
+  AudioIdleSignal *IdleSignal() const { return &_descriptor->_idleSignal; }
+
+private:
+  std::shared_ptr<MixerAudioDeviceDescriptor> _descriptor;
+};
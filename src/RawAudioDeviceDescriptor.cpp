@@ -1,12 +1,73 @@
 #include "RawAudioDeviceDescriptor.h"
 
-void RawAudioDeviceDescriptor::_setRecordedBuffer(int8_t *frame, size_t length) const {
+#include <algorithm>
+#include <cstring>
+
+#include <tgcalls/TraceRecorder.h>
+
+int8_t *RawAudioDeviceDescriptor::FrameRing::nextSlot(size_t length) {
+  // Frames have a fixed size, so this only allocates on the first frame.
+  if (data.size() < length * kFrameViewSlots) {
+    data.assign(length * kFrameViewSlots, 0);
+    next = 0;
+  }
+
+  int8_t *slot = data.data() + length * next;
+  next = (next + 1) % kFrameViewSlots;
+  return slot;
+}
+
+void RawAudioDeviceDescriptor::_setRecordedBuffer(const int8_t *frame, size_t length) {
+  tgcalls::TraceScope trace("python", "setRecordedBuffer");
+  if (_setRecordedBufferViewCallback) {
+    int8_t *slot = _recordedFrames.nextSlot(length);
+    memcpy(slot, frame, length);
+
+    py::gil_scoped_acquire acquire;
+    auto view = py::memoryview::from_memory(slot, static_cast<py::ssize_t>(length), true);
+    _setRecordedBufferViewCallback(view, length);
+    return;
+  }
+
   auto bytes = std::string((const char *) frame, sizeof(int8_t) * length);
   _setRecordedBufferCallback(bytes, length);
 }
 
-std::string *RawAudioDeviceDescriptor::_getPlayoutBuffer(size_t length) const {
-  std::string frame = _getPlayedBufferCallback(length);
+bool RawAudioDeviceDescriptor::_getPlayoutBuffer(int8_t *frame, size_t length) const {
+  tgcalls::TraceScope trace("python", "getPlayedBuffer");
+  std::string played = _getPlayedBufferCallback(length);
+
+  size_t copied = std::min(played.size(), length);
+  memcpy(frame, played.data(), copied);
+  memset(frame + copied, 0, length - copied);
+  return copied == length;
+}
+
+size_t RawAudioDeviceDescriptor::_fetchPlayoutBuffer(int8_t *data, size_t length) {
+  if (_hasPlayoutBufferView()) {
+    memcpy(data, _getPlayoutBufferView(length), length);
+    return length;
+  }
+
+  tgcalls::TraceScope trace("python", "getPlayedBuffer");
+  std::string played = _getPlayedBufferCallback(length);
+  size_t copied = std::min(played.size(), length);
+  memcpy(data, played.data(), copied);
+  return copied;
+}
+
+bool RawAudioDeviceDescriptor::_hasPlayoutBufferView() const {
+  return static_cast<bool>(_getPlayedBufferViewCallback);
+}
+
+int8_t *RawAudioDeviceDescriptor::_getPlayoutBufferView(size_t length) {
+  tgcalls::TraceScope trace("python", "getPlayedBuffer");
+  int8_t *slot = _playoutFrames.nextSlot(length);
+  // Whatever Python leaves unwritten is played as silence.
+  memset(slot, 0, length);
 
-  return new std::string{frame};
+  py::gil_scoped_acquire acquire;
+  auto view = py::memoryview::from_memory(slot, static_cast<py::ssize_t>(length), false);
+  _getPlayedBufferViewCallback(view, length);
+  return slot;
 }
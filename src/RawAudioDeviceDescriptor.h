@@ -1,20 +1,98 @@
 #pragma once
 
+#include <atomic>
 #include <string>
+#include <vector>
 #include <functional>
 
 #include <pybind11/pybind11.h>
 
+#include "AudioDeadlineClock.h"
+#include "AudioFormat.h"
+#include "AudioGlitchDetector.h"
+#include "AudioIdleSignal.h"
+#include "AudioLoudnessNormalizer.h"
+#include "AudioPrefetcher.h"
+
 namespace py = pybind11;
 
 class RawAudioDeviceDescriptor {
 public:
+    // Number of reusable frame slots handed out as memoryviews. A view stays
+    // valid until the ring wraps around, i.e. for kFrameViewSlots - 1 more
+    // frames after the callback returns.
+    static constexpr size_t kFrameViewSlots = 4;
+
+    // Format of the 10 ms frames the device exchanges; 48 kHz stereo unless
+    // set otherwise before the call starts.
+    AudioFormat _recordingFormat;
+    AudioFormat _playoutFormat;
+
     std::function<std::string(size_t)> _getPlayedBufferCallback = nullptr;
     std::function<void(const py::bytes &frame, size_t)> _setRecordedBufferCallback = nullptr;
 
+    // Zero-copy variants: Python gets a memoryview over a C++-owned slot
+    // instead of a freshly allocated bytes object. The view is read-only for
+    // recorded frames and writable for played frames, which Python fills in
+    // place. When set, they take precedence over the bytes callbacks.
+    std::function<void(const py::memoryview &frame, size_t)> _setRecordedBufferViewCallback = nullptr;
+    std::function<void(const py::memoryview &frame, size_t)> _getPlayedBufferViewCallback = nullptr;
+
     std::function<bool()> _isPlayoutPaused = nullptr;
     std::function<bool()> _isRecordingPaused = nullptr;
+    // Plain flags set from Python, used when the callables above are left
+    // unset so the audio threads never take the GIL to poll them.
+    std::atomic<bool> _playoutPaused{false};
+    std::atomic<bool> _recordingPaused{false};
+    // Notified when either flag changes; the device threads park on it
+    // while both are set.
+    AudioIdleSignal _idleSignal;
+
+    bool _playoutIsPaused() const {
+        return _isPlayoutPaused ? _isPlayoutPaused() : _playoutPaused.load(std::memory_order_relaxed);
+    }
+    bool _recordingIsPaused() const {
+        return _isRecordingPaused ? _isRecordingPaused() : _recordingPaused.load(std::memory_order_relaxed);
+    }
+    // Paused through the flags rather than the callables, whose changes
+    // don't notify |_idleSignal|.
+    bool _playoutIsIdle() const {
+        return !_isPlayoutPaused && _playoutPaused.load(std::memory_order_relaxed);
+    }
+    bool _recordingIsIdle() const {
+        return !_isRecordingPaused && _recordingPaused.load(std::memory_order_relaxed);
+    }
+
+    // When non-zero, played audio is requested from Python ahead of time in
+    // |_prefetchBatchMs| batches and up to |_lookaheadMs| is buffered, so a
+    // late callback no longer causes a click. Adds |_lookaheadMs| of latency.
+    size_t _lookaheadMs = 0;
+    size_t _prefetchBatchMs = 20;
+
+    AudioClockStats _clockStats{tgcalls::HotPathCounters::AudioDevice::Raw};
+    // Loudness normalization of the audio sent into the call.
+    AudioLoudnessSettings _loudness;
+    AudioLookaheadStats _lookaheadStats;
+    AudioGlitchDetector _glitches{&_clockStats};
+
+    void _setRecordedBuffer(const int8_t*, size_t);
+    // Fills |frame| from _getPlayedBufferCallback, padding short replies
+    // with silence. Returns false for a short reply.
+    bool _getPlayoutBuffer(int8_t* frame, size_t) const;
+    // Copies what Python returns, up to |length| bytes, and returns the size.
+    size_t _fetchPlayoutBuffer(int8_t* data, size_t length);
+
+    bool _hasPlayoutBufferView() const;
+    int8_t* _getPlayoutBufferView(size_t);
+
+private:
+    struct FrameRing {
+        std::vector<int8_t> data;
+        size_t next = 0;
+
+        int8_t* nextSlot(size_t length);
+    };
 
-    void _setRecordedBuffer(int8_t*, size_t) const;
-    std::string* _getPlayoutBuffer(size_t) const;
+    FrameRing _recordedFrames;
+    FrameRing _playoutFrames;
 };
@@ -0,0 +1,175 @@
+#include "RawVideoDeviceDescriptor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <api/video/i420_buffer.h>
+#include <api/video/nv12_buffer.h>
+#include <api/video/video_frame.h>
+#include <rtc_base/ref_counted_object.h>
+#include <rtc_base/time_utils.h>
+
+#include "libyuv.h"
+
+namespace {
+
+// Presentation times further than this from webrtc's clock, e.g. after a
+// source restarted its timeline or stalled, are anchored to it anew.
+constexpr int64_t kMaxTimestampDriftUs = rtc::kNumMicrosecsPerSec;
+
+size_t RequiredSize(RawVideoDeviceDescriptor::PixelFormat format, int stride, int height) {
+  size_t luma = static_cast<size_t>(stride) * height;
+  size_t chromaRows = static_cast<size_t>(height + 1) / 2;
+  switch (format) {
+    case RawVideoDeviceDescriptor::PixelFormat::I420:
+      return luma + 2 * static_cast<size_t>((stride + 1) / 2) * chromaRows;
+    case RawVideoDeviceDescriptor::PixelFormat::NV12:
+      return luma + static_cast<size_t>(stride) * chromaRows;
+    default:
+      return luma;
+  }
+}
+
+int BytesPerPixel(RawVideoDeviceDescriptor::PixelFormat format) {
+  switch (format) {
+    case RawVideoDeviceDescriptor::PixelFormat::RGBA:
+    case RawVideoDeviceDescriptor::PixelFormat::BGRA:
+      return 4;
+    case RawVideoDeviceDescriptor::PixelFormat::RGB24:
+    case RawVideoDeviceDescriptor::PixelFormat::BGR24:
+      return 3;
+    default:
+      return 1;
+  }
+}
+
+} // namespace
+
+RawVideoDeviceDescriptor::RawVideoDeviceDescriptor(size_t poolSize)
+    : _source(new rtc::RefCountedObject<AdaptedVideoSource>()), _pool(false, poolSize), _scaledPool(false, poolSize) {}
+
+RawVideoDeviceDescriptor::~RawVideoDeviceDescriptor() = default;
+
+std::function<webrtc::VideoTrackSourceInterface *()> RawVideoDeviceDescriptor::getVideoSource() const {
+  return [source = _source]() -> webrtc::VideoTrackSourceInterface * {
+    return source.get();
+  };
+}
+
+int64_t RawVideoDeviceDescriptor::mapTimestamp(int64_t timestampUs) {
+  int64_t now = rtc::TimeMicros();
+  int64_t mapped = now;
+  if (timestampUs >= 0) {
+    mapped = timestampUs + _timestampOffsetUs;
+    if (!_hasTimestampOffset || mapped < now - kMaxTimestampDriftUs || mapped > now + kMaxTimestampDriftUs) {
+      _hasTimestampOffset = true;
+      _timestampOffsetUs = now - timestampUs;
+      mapped = now;
+    }
+  }
+  // The encoder drops frames that don't move forward.
+  mapped = std::max(mapped, _lastTimestampUs + 1);
+  _lastTimestampUs = mapped;
+  return mapped;
+}
+
+bool RawVideoDeviceDescriptor::pushFrame(const py::buffer &data, PixelFormat format, int width, int height,
+                                         int64_t timestampUs, int stride) {
+  if (width <= 0 || height <= 0) {
+    throw std::invalid_argument("frame dimensions must be positive");
+  }
+  if (stride == 0) {
+    stride = width * BytesPerPixel(format);
+  } else if (stride < width * BytesPerPixel(format)) {
+    throw std::invalid_argument("stride is smaller than a row of the frame");
+  }
+
+  py::buffer_info info = data.request();
+  if (static_cast<size_t>(info.size * info.itemsize) < RequiredSize(format, stride, height)) {
+    throw std::invalid_argument("buffer is smaller than a frame of the given format and size");
+  }
+  const auto src = static_cast<const uint8_t *>(info.ptr);
+
+  py::gil_scoped_release release;
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  _pushed.fetch_add(1, std::memory_order_relaxed);
+  int64_t frameTimestampUs = mapTimestamp(timestampUs);
+
+  int adaptedWidth = 0;
+  int adaptedHeight = 0;
+  int cropWidth = 0;
+  int cropHeight = 0;
+  int cropX = 0;
+  int cropY = 0;
+  if (!_source->adapt(width, height, frameTimestampUs,
+                      &adaptedWidth, &adaptedHeight, &cropWidth, &cropHeight, &cropX, &cropY)) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  bool isScaled = adaptedWidth != width || adaptedHeight != height;
+  rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer;
+  if (format == PixelFormat::NV12) {
+    auto nv12 = _pool.CreateNV12Buffer(width, height);
+    auto scaled = isScaled ? _scaledPool.CreateNV12Buffer(adaptedWidth, adaptedHeight) : nv12;
+    if (nv12 && scaled) {
+      libyuv::CopyPlane(src, stride, nv12->MutableDataY(), nv12->StrideY(), width, height);
+      libyuv::CopyPlane(src + static_cast<size_t>(stride) * height, stride,
+                        nv12->MutableDataUV(), nv12->StrideUV(), nv12->ChromaWidth() * 2, nv12->ChromaHeight());
+      if (isScaled) {
+        scaled->CropAndScaleFrom(*nv12, cropX, cropY, cropWidth, cropHeight);
+      }
+      buffer = scaled;
+    }
+  } else {
+    auto i420 = _pool.CreateI420Buffer(width, height);
+    auto scaled = isScaled ? _scaledPool.CreateI420Buffer(adaptedWidth, adaptedHeight) : i420;
+    if (i420 && scaled) {
+      uint8_t *y = i420->MutableDataY();
+      uint8_t *u = i420->MutableDataU();
+      uint8_t *v = i420->MutableDataV();
+      switch (format) {
+        case PixelFormat::I420: {
+          int chromaStride = (stride + 1) / 2;
+          const uint8_t *srcU = src + static_cast<size_t>(stride) * height;
+          const uint8_t *srcV = srcU + static_cast<size_t>(chromaStride) * ((height + 1) / 2);
+          libyuv::I420Copy(src, stride, srcU, chromaStride, srcV, chromaStride,
+                           y, i420->StrideY(), u, i420->StrideU(), v, i420->StrideV(), width, height);
+          break;
+        }
+        // libyuv names packed formats by little-endian word order, the
+        // reverse of their byte order.
+        case PixelFormat::RGBA:
+          libyuv::ABGRToI420(src, stride, y, i420->StrideY(), u, i420->StrideU(), v, i420->StrideV(), width, height);
+          break;
+        case PixelFormat::BGRA:
+          libyuv::ARGBToI420(src, stride, y, i420->StrideY(), u, i420->StrideU(), v, i420->StrideV(), width, height);
+          break;
+        case PixelFormat::RGB24:
+          libyuv::RAWToI420(src, stride, y, i420->StrideY(), u, i420->StrideU(), v, i420->StrideV(), width, height);
+          break;
+        case PixelFormat::BGR24:
+          libyuv::RGB24ToI420(src, stride, y, i420->StrideY(), u, i420->StrideU(), v, i420->StrideV(), width, height);
+          break;
+        default:
+          break;
+      }
+      if (isScaled) {
+        scaled->CropAndScaleFrom(*i420, cropX, cropY, cropWidth, cropHeight);
+      }
+      buffer = scaled;
+    }
+  }
+  if (!buffer) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  _source->deliver(webrtc::VideoFrame::Builder()
+                       .set_video_frame_buffer(buffer)
+                       .set_timestamp_us(frameTimestampUs)
+                       .set_rotation(webrtc::kVideoRotation_0)
+                       .build());
+  return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include <pybind11/pybind11.h>
+
+#include <api/scoped_refptr.h>
+#include <common_video/include/video_frame_buffer_pool.h>
+
+#include "AdaptedVideoSource.h"
+
+namespace py = pybind11;
+
+// Outgoing video of a group call pushed frame by frame from Python, for
+// calls that stream generated or decoded video instead of a camera.
+class RawVideoDeviceDescriptor {
+public:
+    enum class PixelFormat {
+        I420,
+        NV12,
+        // Packed, named by byte order in memory.
+        RGBA,
+        BGRA,
+        RGB24,
+        BGR24,
+    };
+
+    // Buffers queued for or held by the encoder at once. A push that finds
+    // them all in use is dropped rather than allocating another.
+    static constexpr size_t kDefaultPoolSize = 8;
+
+    explicit RawVideoDeviceDescriptor(size_t poolSize = kDefaultPoolSize);
+    ~RawVideoDeviceDescriptor();
+
+    // Copies one frame into a pooled buffer, converting packed RGB to I420,
+    // and hands it to the encoder. |stride| is the row stride in bytes of
+    // the luma or packed plane, 0 for tightly packed rows; I420 chroma rows
+    // are half of it and NV12's UV rows the same. |timestampUs| is the
+    // frame's presentation time on any clock, or -1 for the time of the
+    // push; it is moved onto webrtc's clock by the offset of the first
+    // frame. Returns false if the frame was dropped, because the encoder
+    // doesn't want it at this rate or no pooled buffer was free.
+    bool pushFrame(const py::buffer &data, PixelFormat format, int width, int height,
+                   int64_t timestampUs = -1, int stride = 0);
+
+    uint64_t pushed() const { return _pushed.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    // For GroupInstanceDescriptor::getVideoSource and setVideoSource().
+    std::function<webrtc::VideoTrackSourceInterface*()> getVideoSource() const;
+
+private:
+    int64_t mapTimestamp(int64_t timestampUs);
+
+    rtc::scoped_refptr<AdaptedVideoSource> _source;
+
+    std::mutex _mutex;
+    // Frames as pushed, and scaled down to what the encoder asks for; each
+    // pool holds buffers of one size only.
+    webrtc::VideoFrameBufferPool _pool;
+    webrtc::VideoFrameBufferPool _scaledPool;
+    bool _hasTimestampOffset = false;
+    int64_t _timestampOffsetUs = 0;
+    int64_t _lastTimestampUs = 0;
+
+    std::atomic<uint64_t> _pushed{0};
+    std::atomic<uint64_t> _dropped{0};
+};
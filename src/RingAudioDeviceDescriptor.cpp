@@ -0,0 +1,55 @@
+#include "RingAudioDeviceDescriptor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+RingAudioDeviceDescriptor::RingAudioDeviceDescriptor(size_t capacity)
+    : _playedRing(capacity),
+      _recordedRing(capacity) {}
+
+size_t RingAudioDeviceDescriptor::_push(const uint8_t *data, size_t length) {
+  // Truncate to whole sample frames so the channels never get out of phase.
+  length -= length % (_recordingFormat.channels * sizeof(int16_t));
+  size_t written = _playedRing.Write(data, length);
+  if (written < length) {
+    _overruns++;
+  }
+  return written;
+}
+
+size_t RingAudioDeviceDescriptor::push(const py::bytes &frame) {
+  char *data = nullptr;
+  py::ssize_t length = 0;
+  PyBytes_AsStringAndSize(frame.ptr(), &data, &length);
+  return _push(reinterpret_cast<const uint8_t *>(data), static_cast<size_t>(length));
+}
+
+size_t RingAudioDeviceDescriptor::pushBuffer(const py::buffer &buffer) {
+  PcmInput input(buffer);
+  return _push(input.data(), input.size());
+}
+
+py::bytes RingAudioDeviceDescriptor::pop(size_t length) {
+  // Python is the ring's only consumer, so nothing else consumes between
+  // sizing the bytes object and filling it.
+  length = std::min(length, _recordedRing.ReadAvailable());
+  auto frame = py::reinterpret_steal<py::bytes>(
+      PyBytes_FromStringAndSize(nullptr, static_cast<py::ssize_t>(length)));
+  if (!frame) {
+    throw py::error_already_set();
+  }
+  _recordedRing.Read(reinterpret_cast<uint8_t *>(PyBytes_AS_STRING(frame.ptr())), length);
+  return frame;
+}
+
+std::shared_ptr<AudioBlock> RingAudioDeviceDescriptor::popBlock(size_t frames, bool asFloat) {
+  return AudioBlock::Read(_recordedRing, _playoutFormat.channels, frames, asFloat);
+}
+
+size_t RingAudioDeviceDescriptor::popInto(const py::buffer &buffer) {
+  py::buffer_info info = buffer.request(true);
+  if (info.ndim != 1 || info.strides[0] != info.itemsize) {
+    throw std::invalid_argument("popInto requires a contiguous one-dimensional buffer");
+  }
+  return _recordedRing.Read(static_cast<uint8_t *>(info.ptr), static_cast<size_t>(info.size * info.itemsize));
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <pybind11/pybind11.h>
+
+#include "AudioBlock.h"
+#include "AudioDeadlineClock.h"
+#include "AudioFormat.h"
+#include "AudioIdleSignal.h"
+#include "SpscRingBuffer.h"
+
+namespace py = pybind11;
+
+// Raw s16le PCM exchanged through lock-free rings instead of
+// per-frame Python callbacks. Python pushes audio to be sent into the call in
+// chunks of any size and pops the call's audio whenever convenient; the
+// device threads only touch the rings and never take the GIL.
+class RingAudioDeviceDescriptor {
+public:
+    // Two seconds of 48 kHz stereo s16le in each direction.
+    static constexpr size_t kDefaultCapacity = 48000 * 2 * 2 * 2;
+
+    explicit RingAudioDeviceDescriptor(size_t capacity = kDefaultCapacity);
+
+    // Format of the 10 ms frames the device exchanges; 48 kHz stereo unless
+    // set otherwise before the call starts.
+    AudioFormat _recordingFormat;
+    AudioFormat _playoutFormat;
+
+    // Audio pushed by Python and played into the call.
+    SpscRingBuffer _playedRing;
+    // Audio received from the call, waiting to be popped by Python.
+    SpscRingBuffer _recordedRing;
+
+    std::atomic<bool> _isPlayoutPaused{false};
+    std::atomic<bool> _isRecordingPaused{false};
+    // Notified when either flag changes; the device threads park on it
+    // while both are set.
+    AudioIdleSignal _idleSignal;
+
+    // 10 ms frames that were short because |_playedRing| ran dry.
+    std::atomic<uint64_t> _underruns{0};
+    // Pushes or frames that were truncated because the target ring was full.
+    std::atomic<uint64_t> _overruns{0};
+
+    AudioClockStats _clockStats{tgcalls::HotPathCounters::AudioDevice::Ring};
+
+    size_t push(const py::bytes &);
+    size_t pushBuffer(const py::buffer &);
+    py::bytes pop(size_t);
+    size_t popInto(const py::buffer &);
+    // Up to |frames| whole frames of playout, as int16 or float32.
+    std::shared_ptr<AudioBlock> popBlock(size_t frames, bool asFloat);
+
+private:
+    size_t _push(const uint8_t *, size_t);
+};
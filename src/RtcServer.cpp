@@ -1,7 +1,45 @@
 #include "RtcServer.h"
 
+#include <algorithm>
+#include <set>
+#include <tuple>
+
 using namespace std;
 
+namespace {
+
+string Trimmed(string const &value) {
+    const auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+    auto begin = value.begin();
+    auto end = value.end();
+    while (begin != end && isSpace(*begin)) {
+        ++begin;
+    }
+    while (end != begin && isSpace(*(end - 1))) {
+        --end;
+    }
+    return string(begin, end);
+}
+
+bool IsIpv6(string const &host) {
+    return host.find(':') != string::npos;
+}
+
+// Takes from |preferred| and |other| in turn, |preferred| first.
+void Interleave(vector<tgcalls::RtcServer> &preferred, vector<tgcalls::RtcServer> &other,
+                vector<tgcalls::RtcServer> &result) {
+    for (size_t i = 0; i < max(preferred.size(), other.size()); i++) {
+        if (i < preferred.size()) {
+            result.push_back(move(preferred[i]));
+        }
+        if (i < other.size()) {
+            result.push_back(move(other[i]));
+        }
+    }
+}
+
+}  // namespace
+
 RtcServer::RtcServer(string ip, string ipv6, int port, string login, string password, bool isTurn, bool isStun):
         ip(move(ip)), ipv6(move(ipv6)), port(port), login(move(login)), password(move(password)),
         isTurn(isTurn), isStun(isStun)
@@ -27,3 +65,61 @@ tgcalls::RtcServer RtcServer::toTgcalls(bool asIpv6, bool supportTurn) {
 
     return rtcServer;
 };
+
+vector<tgcalls::RtcServer> BuildRtcServerList(vector<RtcServer> const &servers, RtcServerListOptions const &options) {
+    const auto allowIpv4 = options.family != RtcServerFamily::Ipv6Only;
+    const auto allowIpv6 = options.family != RtcServerFamily::Ipv4Only;
+    const auto preferIpv6 = options.family == RtcServerFamily::PreferIpv6 || options.family == RtcServerFamily::Ipv6Only;
+
+    set<tuple<string, uint16_t, bool, string, string>> seen;
+    vector<tgcalls::RtcServer> stun[2];
+    vector<tgcalls::RtcServer> turn[2];
+
+    const auto add = [&](string const &rawHost, RtcServer const &server, bool isTurn) {
+        const auto host = Trimmed(rawHost);
+        if (host.empty() || server.port <= 0 || server.port > 65535) {
+            return;
+        }
+        const auto isIpv6 = IsIpv6(host);
+        if ((isIpv6 && !allowIpv6) || (!isIpv6 && !allowIpv4)) {
+            return;
+        }
+        tgcalls::RtcServer result;
+        result.host = host;
+        result.port = uint16_t(server.port);
+        result.isTurn = isTurn;
+        if (isTurn) {
+            result.login = server.login;
+            result.password = server.password;
+        }
+        if (!seen.emplace(result.host, result.port, result.isTurn, result.login, result.password).second) {
+            return;
+        }
+        const auto preferred = isIpv6 == preferIpv6 ? 0 : 1;
+        (isTurn ? turn : stun)[preferred].push_back(move(result));
+    };
+
+    for (const auto &server : servers) {
+        if (server.isStun) {
+            add(server.ip, server, false);
+            add(server.ipv6, server, false);
+        }
+        if (server.isTurn) {
+            add(server.ip, server, true);
+            add(server.ipv6, server, true);
+        }
+    }
+
+    vector<tgcalls::RtcServer> result;
+    Interleave(stun[0], stun[1], result);
+    vector<tgcalls::RtcServer> turnResult;
+    Interleave(turn[0], turn[1], turnResult);
+    // Every TURN entry is an allocation; the first ones cover both families.
+    if (options.maxTurnServers > 0 && turnResult.size() > options.maxTurnServers) {
+        turnResult.resize(options.maxTurnServers);
+    }
+    for (auto &server : turnResult) {
+        result.push_back(move(server));
+    }
+    return result;
+}
@@ -2,6 +2,8 @@
 
 #include <tgcalls/Instance.h>
 
+#include <vector>
+
 using namespace std;
 
 struct RtcServer
@@ -17,3 +19,23 @@ struct RtcServer
     bool isTurn;
     bool isStun;
 };
+
+enum class RtcServerFamily {
+    PreferIpv4,
+    PreferIpv6,
+    Ipv4Only,
+    Ipv6Only
+};
+
+struct RtcServerListOptions {
+    RtcServerFamily family = RtcServerFamily::PreferIpv4;
+    // TURN entries kept, each an allocation, after interleaving; 0 keeps
+    // them all.
+    size_t maxTurnServers = 4;
+};
+
+// The STUN and TURN entries of |servers| for a call: empty and duplicate
+// hosts dropped, and the two address families interleaved, the preferred
+// one first, so that ICE races both from the start and one unreachable
+// family doesn't hold the other back.
+vector<tgcalls::RtcServer> BuildRtcServerList(vector<RtcServer> const &servers, RtcServerListOptions const &options);
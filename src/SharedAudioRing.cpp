@@ -0,0 +1,195 @@
+#include "SharedAudioRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+
+#if defined(WEBRTC_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <rtc_base/logging.h>
+
+namespace {
+
+// "TGAR", so a segment of something else is never taken for a ring.
+constexpr uint32_t kMagic = 0x52414754;
+constexpr uint32_t kVersion = 1;
+
+// Both processes update the positions in place, which only works for
+// atomics that don't fall back to a lock inside the object.
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring positions must be lock free");
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+// The positions count bytes since creation and are kept a cache line apart,
+// so the producer and the consumer don't keep stealing each other's line.
+struct SharedAudioRing::Header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t capacity;
+  alignas(64) std::atomic<uint64_t> writePos;
+  alignas(64) std::atomic<uint64_t> readPos;
+};
+
+SharedAudioRing::SharedAudioRing(std::string name, bool owner, void *mapping, size_t mappingSize)
+    : _name(std::move(name)),
+      _owner(owner),
+      _mapping(mapping),
+      _mappingSize(mappingSize),
+      _header(static_cast<Header *>(mapping)),
+      _data(static_cast<uint8_t *>(mapping) + sizeof(Header)),
+      _capacity(static_cast<size_t>(_header->capacity)),
+      _mask(_capacity - 1) {}
+
+size_t SharedAudioRing::Write(const uint8_t *data, size_t length) {
+  const uint64_t writePos = _header->writePos.load(std::memory_order_relaxed);
+  const uint64_t readPos = _header->readPos.load(std::memory_order_acquire);
+
+  length = std::min<size_t>(length, _capacity - static_cast<size_t>(writePos - readPos));
+  if (length == 0) {
+    return 0;
+  }
+
+  const size_t offset = static_cast<size_t>(writePos) & _mask;
+  const size_t first = std::min(length, _capacity - offset);
+  memcpy(_data + offset, data, first);
+  memcpy(_data, data + first, length - first);
+
+  _header->writePos.store(writePos + length, std::memory_order_release);
+  return length;
+}
+
+size_t SharedAudioRing::Read(uint8_t *data, size_t length) {
+  const uint64_t readPos = _header->readPos.load(std::memory_order_relaxed);
+  const uint64_t writePos = _header->writePos.load(std::memory_order_acquire);
+
+  length = std::min<size_t>(length, static_cast<size_t>(writePos - readPos));
+  if (length == 0) {
+    return 0;
+  }
+
+  const size_t offset = static_cast<size_t>(readPos) & _mask;
+  const size_t first = std::min(length, _capacity - offset);
+  memcpy(data, _data + offset, first);
+  memcpy(data + first, _data, length - first);
+
+  _header->readPos.store(readPos + length, std::memory_order_release);
+  return length;
+}
+
+size_t SharedAudioRing::ReadAvailable() const {
+  return static_cast<size_t>(_header->writePos.load(std::memory_order_acquire) -
+                             _header->readPos.load(std::memory_order_acquire));
+}
+
+size_t SharedAudioRing::WriteAvailable() const {
+  return _capacity - ReadAvailable();
+}
+
+#if defined(WEBRTC_POSIX)
+
+std::unique_ptr<SharedAudioRing> SharedAudioRing::Create(const std::string &name, size_t capacity) {
+  capacity = RoundUpToPowerOfTwo(std::max<size_t>(capacity, 1));
+  const size_t mappingSize = sizeof(Header) + capacity;
+
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to create shared audio ring: " << name;
+    return nullptr;
+  }
+  if (ftruncate(fd, static_cast<off_t>(mappingSize)) != 0) {
+    RTC_LOG(LS_ERROR) << "Failed to size shared audio ring: " << name;
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  void *mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    RTC_LOG(LS_ERROR) << "Failed to map shared audio ring: " << name;
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  // The magic goes in last, so a concurrent Open() never sees a ring
+  // that's half set up.
+  auto header = new (mapping) Header{};
+  header->version = kVersion;
+  header->capacity = capacity;
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kMagic;
+
+  return std::unique_ptr<SharedAudioRing>(new SharedAudioRing(name, true, mapping, mappingSize));
+}
+
+std::unique_ptr<SharedAudioRing> SharedAudioRing::Open(const std::string &name) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open shared audio ring: " << name;
+    return nullptr;
+  }
+
+  struct stat info{};
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) <= sizeof(Header)) {
+    RTC_LOG(LS_ERROR) << "Not a shared audio ring: " << name;
+    close(fd);
+    return nullptr;
+  }
+
+  const size_t mappingSize = static_cast<size_t>(info.st_size);
+  void *mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    RTC_LOG(LS_ERROR) << "Failed to map shared audio ring: " << name;
+    return nullptr;
+  }
+
+  auto header = static_cast<const Header *>(mapping);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (header->magic != kMagic || header->version != kVersion ||
+      header->capacity == 0 || (header->capacity & (header->capacity - 1)) != 0 ||
+      sizeof(Header) + header->capacity > mappingSize) {
+    RTC_LOG(LS_ERROR) << "Not a shared audio ring: " << name;
+    munmap(mapping, mappingSize);
+    return nullptr;
+  }
+
+  return std::unique_ptr<SharedAudioRing>(new SharedAudioRing(name, false, mapping, mappingSize));
+}
+
+SharedAudioRing::~SharedAudioRing() {
+  munmap(_mapping, _mappingSize);
+  if (_owner) {
+    shm_unlink(_name.c_str());
+  }
+}
+
+#else
+
+std::unique_ptr<SharedAudioRing> SharedAudioRing::Create(const std::string &name, size_t capacity) {
+  RTC_LOG(LS_WARNING) << "Shared audio rings are not supported on this platform";
+  return nullptr;
+}
+
+std::unique_ptr<SharedAudioRing> SharedAudioRing::Open(const std::string &name) {
+  RTC_LOG(LS_WARNING) << "Shared audio rings are not supported on this platform";
+  return nullptr;
+}
+
+SharedAudioRing::~SharedAudioRing() = default;
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// A single-producer single-consumer byte ring in POSIX shared memory, so PCM
+// can move between the media host and its Python client without a socket
+// or a copy through the kernel. Same semantics as SpscRingBuffer; the read
+// and write positions live in the mapping, next to the data.
+//
+// The creating side owns the name and unlinks it when destroyed; the other
+// side opens it by name. Either side may be the producer.
+class SharedAudioRing {
+public:
+  // Returns nullptr if the segment can't be created, e.g. because |name|
+  // exists already, or on a platform without POSIX shared memory.
+  // |capacity| is rounded up to a power of two.
+  static std::unique_ptr<SharedAudioRing> Create(const std::string &name, size_t capacity);
+
+  // Returns nullptr if |name| doesn't exist or isn't a ring.
+  static std::unique_ptr<SharedAudioRing> Open(const std::string &name);
+
+  ~SharedAudioRing();
+
+  SharedAudioRing(const SharedAudioRing &) = delete;
+  SharedAudioRing &operator=(const SharedAudioRing &) = delete;
+
+  // Producer side. Returns how many bytes were written, which is less than
+  // |length| when the ring is full.
+  size_t Write(const uint8_t *data, size_t length);
+
+  // Consumer side. Returns how many bytes were read.
+  size_t Read(uint8_t *data, size_t length);
+
+  size_t ReadAvailable() const;
+  size_t WriteAvailable() const;
+
+  size_t capacity() const { return _capacity; }
+  const std::string &name() const { return _name; }
+
+private:
+  struct Header;
+
+  SharedAudioRing(std::string name, bool owner, void *mapping, size_t mappingSize);
+
+  std::string _name;
+  bool _owner;
+  void *_mapping;
+  size_t _mappingSize;
+  Header *_header;
+  uint8_t *_data;
+  size_t _capacity;
+  size_t _mask;
+};
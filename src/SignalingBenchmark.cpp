@@ -0,0 +1,143 @@
+#include "SignalingBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <tgcalls/v2/Signaling.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+namespace signaling = tgcalls::signaling;
+
+// Keeps the measured work from being optimized away.
+volatile size_t sink = 0;
+
+signaling::PayloadType MakePayloadType(uint32_t id, std::string name, uint32_t clockrate, uint32_t channels) {
+  signaling::PayloadType payloadType;
+  payloadType.id = id;
+  payloadType.name = std::move(name);
+  payloadType.clockrate = clockrate;
+  payloadType.channels = channels;
+  return payloadType;
+}
+
+signaling::Message MakeInitialSetup() {
+  signaling::InitialSetupMessage message;
+  message.ufrag = "Gx3k";
+  message.pwd = "q7Vd0HbL0tN2mPz8r4JwYc1e";
+  message.supportsBinaryEncoding = true;
+
+  signaling::DtlsFingerprint fingerprint;
+  fingerprint.hash = "sha-256";
+  fingerprint.setup = "actpass";
+  fingerprint.fingerprint =
+      "4B:3A:7F:5C:0E:80:6B:0C:3E:1A:99:B2:74:5D:3A:44:64:2C:05:91:A0:07:E5:6F:C3:49:1A:80:B1:C2:3F:E0";
+  message.fingerprints.push_back(fingerprint);
+
+  signaling::MediaContent audio;
+  audio.ssrc = 2918473509u;
+  auto opus = MakePayloadType(111, "opus", 48000, 2);
+  opus.feedbackTypes.push_back({"transport-cc", ""});
+  opus.parameters.push_back({"minptime", "10"});
+  opus.parameters.push_back({"useinbandfec", "1"});
+  audio.payloadTypes.push_back(opus);
+  audio.rtpExtensions.emplace_back("urn:ietf:params:rtp-hdrext:ssrc-audio-level", 1);
+  audio.rtpExtensions.emplace_back("http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time", 2);
+  audio.rtpExtensions.emplace_back("http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01", 3);
+  message.audio = audio;
+
+  signaling::MediaContent video;
+  video.ssrc = 1625371840u;
+  video.ssrcGroups.push_back({{1625371840u, 1625371841u}, "FID"});
+  const char *codecs[] = {"VP8", "VP9", "H264"};
+  uint32_t id = 96;
+  for (const auto codec : codecs) {
+    auto payloadType = MakePayloadType(id, codec, 90000, 0);
+    for (const auto &feedbackType : {signaling::FeedbackType{"goog-remb", ""}, signaling::FeedbackType{"transport-cc", ""},
+                                     signaling::FeedbackType{"ccm", "fir"}, signaling::FeedbackType{"nack", ""},
+                                     signaling::FeedbackType{"nack", "pli"}}) {
+      payloadType.feedbackTypes.push_back(feedbackType);
+    }
+    if (payloadType.name == "H264") {
+      payloadType.parameters.push_back({"level-asymmetry-allowed", "1"});
+      payloadType.parameters.push_back({"packetization-mode", "1"});
+      payloadType.parameters.push_back({"profile-level-id", "42e01f"});
+    }
+    video.payloadTypes.push_back(payloadType);
+
+    auto rtx = MakePayloadType(id + 1, "rtx", 90000, 0);
+    rtx.parameters.push_back({"apt", std::to_string(id)});
+    video.payloadTypes.push_back(rtx);
+    id += 2;
+  }
+  video.rtpExtensions.emplace_back("urn:ietf:params:rtp-hdrext:toffset", 4);
+  video.rtpExtensions.emplace_back("http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time", 2);
+  video.rtpExtensions.emplace_back("urn:3gpp:video-orientation", 13);
+  video.rtpExtensions.emplace_back("http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01", 3);
+  message.video = video;
+
+  signaling::Message result;
+  result.data = std::move(message);
+  return result;
+}
+
+signaling::Message MakeCandidates() {
+  signaling::CandidatesMessage message;
+  for (const auto sdpString : {
+           "candidate:1467250027 1 udp 2122260223 192.168.0.196 46243 typ host generation 0 ufrag Gx3k network-id 1",
+           "candidate:2791372481 1 udp 1686052607 203.0.113.17 46243 typ srflx raddr 192.168.0.196 rport 46243 "
+           "generation 0 ufrag Gx3k network-id 1",
+           "candidate:3009788137 1 udp 41885439 198.51.100.4 3478 typ relay raddr 203.0.113.17 rport 46243 "
+           "generation 0 ufrag Gx3k network-id 1",
+           "candidate:3009788138 1 udp 41819903 2001:db8::4 3478 typ relay raddr 203.0.113.17 rport 46243 "
+           "generation 0 ufrag Gx3k network-id 1"}) {
+    message.iceCandidates.push_back({sdpString});
+  }
+  signaling::Message result;
+  result.data = std::move(message);
+  return result;
+}
+
+signaling::Message MakeMediaState() {
+  signaling::MediaStateMessage message;
+  message.isMuted = true;
+  message.videoState = signaling::MediaStateMessage::VideoState::Active;
+  message.videoRotation = signaling::MediaStateMessage::VideoRotation::Rotation90;
+  signaling::Message result;
+  result.data = message;
+  return result;
+}
+
+SignalingBenchmarkResult Measure(std::string name, int iterations, signaling::Message const &message) {
+  SignalingBenchmarkResult result;
+  result.name = std::move(name);
+  result.iterations = static_cast<uint64_t>(iterations);
+  result.jsonBytes = message.serialize(signaling::Encoding::Json).size();
+  result.binaryBytes = message.serialize(signaling::Encoding::Binary).size();
+
+  const auto run = [&](signaling::Encoding encoding) {
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+      const auto parsed = signaling::Message::parse(message.serialize(encoding));
+      sink = sink + (parsed ? parsed->data.index() + 1 : 0);
+    }
+    const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return seconds > 0.0 ? iterations / seconds : 0.0;
+  };
+  result.jsonRoundTripsPerSecond = run(signaling::Encoding::Json);
+  result.binaryRoundTripsPerSecond = run(signaling::Encoding::Binary);
+  return result;
+}
+
+} // namespace
+
+std::vector<SignalingBenchmarkResult> RunSignalingBenchmark(int iterations) {
+  iterations = std::max(1, iterations);
+
+  std::vector<SignalingBenchmarkResult> results;
+  results.push_back(Measure("InitialSetup", iterations, MakeInitialSetup()));
+  results.push_back(Measure("Candidates", iterations, MakeCandidates()));
+  results.push_back(Measure("MediaState", iterations, MakeMediaState()));
+  return results;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Compares, on the calling thread, the JSON and binary encodings of the
+// v2 1:1 call signaling messages: their size and how fast they go through
+// serialize() and parse().
+struct SignalingBenchmarkResult {
+  std::string name;
+  uint64_t iterations = 0;
+  uint64_t jsonBytes = 0;
+  uint64_t binaryBytes = 0;
+  // Serialize and parse round trips per second on one core.
+  double jsonRoundTripsPerSecond = 0.0;
+  double binaryRoundTripsPerSecond = 0.0;
+};
+
+// Runs |iterations| round trips of an initial setup with audio and video,
+// a candidates message and a media state message in both encodings.
+std::vector<SignalingBenchmarkResult> RunSignalingBenchmark(int iterations);
@@ -0,0 +1,97 @@
+#include "SpeakerMonitor.h"
+
+#include <rtc_base/time_utils.h>
+
+SpeakerMonitor::SpeakerMonitor(Callback callback, int intervalMs, int holdMs)
+    : _callback(std::move(callback)),
+      _intervalMs(intervalMs < 0 ? 0 : intervalMs),
+      _holdMs(holdMs < 0 ? 0 : holdMs) {}
+
+SpeakerMonitor::~SpeakerMonitor() {
+  // A batch in flight may be waiting for the GIL.
+  if (PyGILState_Check()) {
+    py::gil_scoped_release release;
+    _dispatcher.Stop();
+  } else {
+    _dispatcher.Stop();
+  }
+}
+
+void SpeakerMonitor::Apply(int64_t callId, const tgcalls::GroupLevelsUpdate &update) {
+  const auto now = rtc::TimeMillis();
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (const auto &it : update.updates) {
+    // 0 is the local participant.
+    if (it.ssrc == 0 || !it.value.voice) {
+      continue;
+    }
+    auto &speaker = _speakers[std::make_pair(callId, it.ssrc)];
+    speaker.lastVoiceMs = now;
+    if (!speaker.isSpeaking) {
+      speaker.isSpeaking = true;
+      _speakingCount++;
+      _pending.callIds.push_back(callId);
+      _pending.ssrcs.push_back(it.ssrc);
+      _pending.speaking.push_back(1);
+    }
+  }
+
+  auto it = _speakers.lower_bound(std::make_pair(callId, uint32_t(0)));
+  while (it != _speakers.end() && it->first.first == callId) {
+    if (now - it->second.lastVoiceMs < _holdMs) {
+      ++it;
+      continue;
+    }
+    _speakingCount--;
+    _pending.callIds.push_back(callId);
+    _pending.ssrcs.push_back(it->first.second);
+    _pending.speaking.push_back(0);
+    it = _speakers.erase(it);
+  }
+
+  if (_pending.ssrcs.empty() || _isPosted || now - _lastPostMs < _intervalMs) {
+    return;
+  }
+  _isPosted = true;
+  _lastPostMs = now;
+  _dispatcher.Post([weak = std::weak_ptr<SpeakerMonitor>(shared_from_this())] {
+    if (const auto strong = weak.lock()) {
+      strong->Deliver();
+    }
+  });
+}
+
+void SpeakerMonitor::RemoveCall(int64_t callId) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto it = _speakers.lower_bound(std::make_pair(callId, uint32_t(0)));
+  while (it != _speakers.end() && it->first.first == callId) {
+    _speakingCount--;
+    it = _speakers.erase(it);
+  }
+}
+
+size_t SpeakerMonitor::speakingCount() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _speakingCount;
+}
+
+void SpeakerMonitor::SetEventQueue(std::shared_ptr<EventQueue> queue) {
+  _dispatcher.SetEventQueue(std::move(queue));
+}
+
+void SpeakerMonitor::Stop() {
+  _dispatcher.Stop();
+}
+
+void SpeakerMonitor::Deliver() {
+  Changes changes;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    changes = std::move(_pending);
+    _pending = Changes();
+    _isPosted = false;
+  }
+  _callback(changes.callIds, changes.ssrcs,
+            py::bytes(reinterpret_cast<const char *>(changes.speaking.data()), changes.speaking.size()));
+}
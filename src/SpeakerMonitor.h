@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <pybind11/pybind11.h>
+
+#include <tgcalls/group/GroupInstanceImpl.h>
+
+#include "CallbackDispatcher.h"
+
+namespace py = pybind11;
+
+// Who is talking in many group calls at once, for monitoring chats without
+// listening to them: calls started with a monitor decode no audio at all,
+// their participants' speaking state comes from the audio level RTP header
+// extension (RFC 6464) alone.
+//
+// A participant starts speaking with the first packet its sender marked as
+// voice and stops once none came for |holdMs|. Changes of every call are
+// collected and handed to Python together, at most once per |intervalMs|:
+// the callback gets parallel arrays of the call each change is from, as
+// given to NativeInstance::setSpeakerMonitor(), the participant's SSRC, and
+// one byte per change, 1 if it started speaking and 0 if it stopped.
+class SpeakerMonitor : public std::enable_shared_from_this<SpeakerMonitor> {
+public:
+  using Callback = std::function<void(const std::vector<int64_t> &callIds, const std::vector<uint32_t> &ssrcs,
+                                      const py::bytes &speaking)>;
+
+  SpeakerMonitor(Callback callback, int intervalMs = 500, int holdMs = 1000);
+  ~SpeakerMonitor();
+
+  // Called on the tgcalls media thread with every levels update of the
+  // call |callId|; a call's updates come every audio levels interval, so
+  // they also flush what other calls collected.
+  void Apply(int64_t callId, const tgcalls::GroupLevelsUpdate &update);
+
+  // Forgets the participants of |callId|, without reporting them.
+  void RemoveCall(int64_t callId);
+
+  // Participants speaking now, over all calls.
+  size_t speakingCount() const;
+
+  // Changes are delivered by |queue|'s asyncio loop from now on; see
+  // NativeInstance::setEventQueue().
+  void SetEventQueue(std::shared_ptr<EventQueue> queue);
+
+  // Stops delivering; must be called without the GIL held.
+  void Stop();
+
+private:
+  struct Speaker {
+    int64_t lastVoiceMs = 0;
+    bool isSpeaking = false;
+  };
+
+  struct Changes {
+    std::vector<int64_t> callIds;
+    std::vector<uint32_t> ssrcs;
+    std::vector<uint8_t> speaking;
+  };
+
+  void Deliver();
+
+  Callback _callback;
+  const int _intervalMs;
+  const int _holdMs;
+  CallbackDispatcher _dispatcher;
+
+  mutable std::mutex _mutex;
+  std::map<std::pair<int64_t, uint32_t>, Speaker> _speakers;
+  size_t _speakingCount = 0;
+  Changes _pending;
+  int64_t _lastPostMs = 0;
+  bool _isPosted = false;
+};
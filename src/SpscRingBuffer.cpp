@@ -0,0 +1,73 @@
+#include "SpscRingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+SpscRingBuffer::SpscRingBuffer(size_t capacity)
+    : _buffer(RoundUpToPowerOfTwo(std::max<size_t>(capacity, 1))),
+      _mask(_buffer.size() - 1) {}
+
+size_t SpscRingBuffer::Write(const uint8_t *data, size_t length) {
+  const size_t writePos = _writePos.load(std::memory_order_relaxed);
+  const size_t readPos = _readPos.load(std::memory_order_acquire);
+
+  length = std::min(length, _buffer.size() - (writePos - readPos));
+  if (length == 0) {
+    return 0;
+  }
+
+  const size_t offset = writePos & _mask;
+  const size_t first = std::min(length, _buffer.size() - offset);
+  memcpy(_buffer.data() + offset, data, first);
+  memcpy(_buffer.data(), data + first, length - first);
+
+  _writePos.store(writePos + length, std::memory_order_release);
+  return length;
+}
+
+size_t SpscRingBuffer::Read(uint8_t *data, size_t length) {
+  const size_t readPos = _readPos.load(std::memory_order_relaxed);
+  const size_t writePos = _writePos.load(std::memory_order_acquire);
+
+  length = std::min(length, writePos - readPos);
+  if (length == 0) {
+    return 0;
+  }
+
+  const size_t offset = readPos & _mask;
+  const size_t first = std::min(length, _buffer.size() - offset);
+  memcpy(data, _buffer.data() + offset, first);
+  memcpy(data + first, _buffer.data(), length - first);
+
+  _readPos.store(readPos + length, std::memory_order_release);
+  return length;
+}
+
+size_t SpscRingBuffer::Skip(size_t length) {
+  const size_t readPos = _readPos.load(std::memory_order_relaxed);
+  const size_t writePos = _writePos.load(std::memory_order_acquire);
+
+  length = std::min(length, writePos - readPos);
+  _readPos.store(readPos + length, std::memory_order_release);
+  return length;
+}
+
+size_t SpscRingBuffer::ReadAvailable() const {
+  return _writePos.load(std::memory_order_acquire) - _readPos.load(std::memory_order_acquire);
+}
+
+size_t SpscRingBuffer::WriteAvailable() const {
+  return _buffer.size() - ReadAvailable();
+}
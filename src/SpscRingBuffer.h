@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lock-free single-producer/single-consumer byte ring.
+//
+// Exactly one thread may call Write() and exactly one (other) thread may call
+// Read(); the remaining accessors are safe from either side but only give a
+// snapshot. Capacity is rounded up to a power of two.
+class SpscRingBuffer {
+public:
+  explicit SpscRingBuffer(size_t capacity);
+
+  // Copies up to |length| bytes in and returns how many fit.
+  size_t Write(const uint8_t *data, size_t length);
+
+  // Copies up to |length| bytes out and returns how many were available.
+  size_t Read(uint8_t *data, size_t length);
+
+  // Drops up to |length| bytes like Read() would, without copying them.
+  size_t Skip(size_t length);
+
+  size_t ReadAvailable() const;
+  size_t WriteAvailable() const;
+  size_t Capacity() const { return _buffer.size(); }
+
+private:
+  std::vector<uint8_t> _buffer;
+  size_t _mask;
+
+  // Monotonic byte counters; only the low bits index into |_buffer|.
+  alignas(64) std::atomic<size_t> _writePos{0};
+  alignas(64) std::atomic<size_t> _readPos{0};
+};
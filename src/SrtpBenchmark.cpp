@@ -0,0 +1,124 @@
+#include "SrtpBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include <pc/srtp_session.h>
+#include <rtc_base/ssl_stream_adapter.h>
+
+namespace {
+
+// Packets protected before they are all unprotected, so the working set
+// stays in cache like a network thread's would.
+constexpr int kChunkPackets = 256;
+constexpr int kRtpHeaderSize = 12;
+// Room for the largest auth tag of the suites below.
+constexpr int kMaxSrtpOverhead = 16;
+
+SrtpBenchmarkResult RunSuite(int suite, int packets, int payloadSize, std::mt19937 &random) {
+  SrtpBenchmarkResult result;
+  result.suite = rtc::SrtpCryptoSuiteToName(suite);
+
+  int keyLength = 0;
+  int saltLength = 0;
+  if (!rtc::GetSrtpKeyAndSaltLengths(suite, &keyLength, &saltLength)) {
+    return result;
+  }
+  std::vector<uint8_t> key(keyLength + saltLength);
+  for (auto &byte : key) {
+    byte = static_cast<uint8_t>(random());
+  }
+
+  cricket::SrtpSession sender;
+  cricket::SrtpSession receiver;
+  if (!sender.SetSend(suite, key.data(), key.size(), {}) ||
+      !receiver.SetRecv(suite, key.data(), key.size(), {})) {
+    return result;
+  }
+
+  const int packetSize = kRtpHeaderSize + payloadSize;
+  const int bufferSize = packetSize + kMaxSrtpOverhead;
+  std::vector<uint8_t> buffers(static_cast<size_t>(kChunkPackets) * bufferSize);
+  std::vector<int> lengths(kChunkPackets);
+  std::vector<uint8_t> payload(payloadSize);
+  for (auto &byte : payload) {
+    byte = static_cast<uint8_t>(random());
+  }
+
+  using Clock = std::chrono::steady_clock;
+  Clock::duration protectTime{0};
+  Clock::duration unprotectTime{0};
+  uint16_t sequenceNumber = 0;
+  uint32_t timestamp = 0;
+
+  int done = 0;
+  while (done < packets) {
+    int count = std::min(kChunkPackets, packets - done);
+    for (int i = 0; i < count; i++) {
+      uint8_t *packet = buffers.data() + static_cast<size_t>(i) * bufferSize;
+      packet[0] = 0x80;
+      packet[1] = 111;
+      packet[2] = static_cast<uint8_t>(sequenceNumber >> 8);
+      packet[3] = static_cast<uint8_t>(sequenceNumber);
+      packet[4] = static_cast<uint8_t>(timestamp >> 24);
+      packet[5] = static_cast<uint8_t>(timestamp >> 16);
+      packet[6] = static_cast<uint8_t>(timestamp >> 8);
+      packet[7] = static_cast<uint8_t>(timestamp);
+      packet[8] = 0x12;
+      packet[9] = 0x34;
+      packet[10] = 0x56;
+      packet[11] = 0x78;
+      std::copy(payload.begin(), payload.end(), packet + kRtpHeaderSize);
+      sequenceNumber++;
+      timestamp += 960;
+    }
+
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+      uint8_t *packet = buffers.data() + static_cast<size_t>(i) * bufferSize;
+      if (!sender.ProtectRtp(packet, packetSize, bufferSize, &lengths[i])) {
+        return result;
+      }
+    }
+    auto protectedAt = Clock::now();
+    for (int i = 0; i < count; i++) {
+      uint8_t *packet = buffers.data() + static_cast<size_t>(i) * bufferSize;
+      int length = 0;
+      if (!receiver.UnprotectRtp(packet, lengths[i], &length)) {
+        return result;
+      }
+    }
+    auto unprotectedAt = Clock::now();
+
+    protectTime += protectedAt - start;
+    unprotectTime += unprotectedAt - protectedAt;
+    done += count;
+  }
+
+  auto seconds = [](Clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+  };
+  result.packets = static_cast<uint64_t>(done);
+  if (seconds(protectTime) > 0.0) {
+    result.protectPacketsPerSecond = done / seconds(protectTime);
+  }
+  if (seconds(unprotectTime) > 0.0) {
+    result.unprotectPacketsPerSecond = done / seconds(unprotectTime);
+  }
+  return result;
+}
+
+} // namespace
+
+std::vector<SrtpBenchmarkResult> RunSrtpBenchmark(int packets, int payloadSize) {
+  packets = std::max(1, packets);
+  payloadSize = std::max(0, std::min(payloadSize, 1200));
+
+  std::mt19937 random(std::random_device{}());
+  std::vector<SrtpBenchmarkResult> results;
+  for (int suite : {rtc::SRTP_AEAD_AES_128_GCM, rtc::SRTP_AEAD_AES_256_GCM, rtc::SRTP_AES128_CM_SHA1_80}) {
+    results.push_back(RunSuite(suite, packets, payloadSize, random));
+  }
+  return results;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Measures SRTP protect / unprotect throughput of the libsrtp build this
+// module links, on the calling thread, for the suites group calls may
+// negotiate. Useful for checking that AES-GCM runs on the hardware AES
+// paths of the host, and for sizing how many calls a core can carry.
+struct SrtpBenchmarkResult {
+  std::string suite;
+  uint64_t packets = 0;
+  // Packets per second on one core; 0 if the suite isn't available.
+  double protectPacketsPerSecond = 0.0;
+  double unprotectPacketsPerSecond = 0.0;
+};
+
+// Protects and then unprotects |packets| RTP packets with |payloadSize|
+// bytes of payload each, per suite.
+std::vector<SrtpBenchmarkResult> RunSrtpBenchmark(int packets, int payloadSize);
@@ -0,0 +1,47 @@
+#include "SwitchableAudioDeviceModule.h"
+
+#include <rtc_base/logging.h>
+
+SwitchableAudioDeviceModule::SwitchableAudioDeviceModule(rtc::scoped_refptr<webrtc::AudioDeviceModule> impl)
+    : tgcalls::DefaultWrappedAudioDeviceModule(std::move(impl)) {}
+
+bool SwitchableAudioDeviceModule::Switch(rtc::scoped_refptr<webrtc::AudioDeviceModule> impl) {
+  if (!impl || impl->Init() != 0) {
+    RTC_LOG(LS_ERROR) << "SwitchableAudioDeviceModule: the new audio device failed to initialise";
+    return false;
+  }
+
+  const bool wasPlaying = _impl->Playing();
+  const bool wasRecording = _impl->Recording();
+  _impl->StopPlayout();
+  _impl->StopRecording();
+  _impl->RegisterAudioCallback(nullptr);
+  _impl->Terminate();
+
+  _impl = std::move(impl);
+  _impl->RegisterAudioCallback(_audioCallback);
+  _impl->SetStereoPlayout(_stereoPlayout);
+  _impl->SetStereoRecording(_stereoRecording);
+  if (wasPlaying && _impl->InitPlayout() == 0) {
+    _impl->StartPlayout();
+  }
+  if (wasRecording && _impl->InitRecording() == 0) {
+    _impl->StartRecording();
+  }
+  return true;
+}
+
+int32_t SwitchableAudioDeviceModule::RegisterAudioCallback(webrtc::AudioTransport *audioCallback) {
+  _audioCallback = audioCallback;
+  return _impl->RegisterAudioCallback(audioCallback);
+}
+
+int32_t SwitchableAudioDeviceModule::SetStereoPlayout(bool enable) {
+  _stereoPlayout = enable;
+  return _impl->SetStereoPlayout(enable);
+}
+
+int32_t SwitchableAudioDeviceModule::SetStereoRecording(bool enable) {
+  _stereoRecording = enable;
+  return _impl->SetStereoRecording(enable);
+}
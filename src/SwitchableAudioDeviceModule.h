@@ -0,0 +1,30 @@
+#pragma once
+
+#include <modules/audio_device/include/audio_device.h>
+#include <tgcalls/platform/PlatformInterface.h>
+
+// Audio device module whose device can be replaced while the media engine is
+// using it, so a group call can be built ahead of time on a dummy device and
+// handed its real one when it is claimed.
+//
+// The audio callback and the stereo settings the engine configured are kept
+// and applied to the new device, which is also started playing and recording
+// if the old one was. Worker thread only, like any ADM.
+class SwitchableAudioDeviceModule : public tgcalls::DefaultWrappedAudioDeviceModule {
+public:
+    explicit SwitchableAudioDeviceModule(rtc::scoped_refptr<webrtc::AudioDeviceModule> impl);
+
+    // Stops and terminates the current device and initialises |impl| in its
+    // place. Returns false, keeping the current device, if |impl| fails to
+    // initialise.
+    bool Switch(rtc::scoped_refptr<webrtc::AudioDeviceModule> impl);
+
+    int32_t RegisterAudioCallback(webrtc::AudioTransport *audioCallback) override;
+    int32_t SetStereoPlayout(bool enable) override;
+    int32_t SetStereoRecording(bool enable) override;
+
+private:
+    webrtc::AudioTransport *_audioCallback = nullptr;
+    bool _stereoPlayout = false;
+    bool _stereoRecording = false;
+};
@@ -0,0 +1,100 @@
+#include "TransportCryptoBenchmark.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <tgcalls/CryptoHelper.h>
+#include <tgcalls/EncryptedConnection.h>
+
+namespace {
+
+// Packets encrypted before they are all decrypted, so the working set
+// stays in cache like a network thread's would.
+constexpr int kChunkPackets = 256;
+
+using Clock = std::chrono::steady_clock;
+
+double PacketsPerSecond(int packets, Clock::duration duration) {
+  const auto seconds = std::chrono::duration<double>(duration).count();
+  return seconds > 0.0 ? packets / seconds : 0.0;
+}
+
+template <typename Process>
+Clock::duration TimeCtr(int packets, std::vector<uint8_t> &payload, const uint8_t *key, Process &&process) {
+  // Key and iv derived per packet, as EncryptedConnection does.
+  std::array<uint8_t, 16> msgKey{};
+  auto start = Clock::now();
+  for (int i = 0; i < packets; i++) {
+    msgKey[0] = static_cast<uint8_t>(i);
+    msgKey[1] = static_cast<uint8_t>(i >> 8);
+    auto aesKeyIv = tgcalls::PrepareAesKeyIv(key, msgKey.data(), 0);
+    process(tgcalls::MemorySpan{payload.data(), payload.size()}, payload.data(), std::move(aesKeyIv));
+  }
+  return Clock::now() - start;
+}
+
+} // namespace
+
+TransportCryptoBenchmarkResult RunTransportCryptoBenchmark(int packets, int payloadSize) {
+  packets = std::max(1, packets);
+  payloadSize = std::max(1, std::min(payloadSize, 1200));
+
+  std::mt19937 random(std::random_device{}());
+  auto key = std::make_shared<std::array<uint8_t, tgcalls::EncryptionKey::kSize>>();
+  for (auto &byte : *key) {
+    byte = static_cast<uint8_t>(random());
+  }
+  std::vector<uint8_t> payload(payloadSize);
+  for (auto &byte : payload) {
+    byte = static_cast<uint8_t>(random());
+  }
+
+  TransportCryptoBenchmarkResult result;
+  result.packets = static_cast<uint64_t>(packets);
+
+  const auto legacyTime = TimeCtr(packets, payload, key->data(), [](tgcalls::MemorySpan from, void *to, tgcalls::AesKeyIv &&aesKeyIv) {
+    tgcalls::AesProcessCtr(from, to, std::move(aesKeyIv));
+  });
+  result.legacyCtrPacketsPerSecond = PacketsPerSecond(packets, legacyTime);
+
+  tgcalls::AesCtrContext context;
+  const auto evpTime = TimeCtr(packets, payload, key->data(), [&](tgcalls::MemorySpan from, void *to, tgcalls::AesKeyIv &&aesKeyIv) {
+    context.process(from, to, std::move(aesKeyIv));
+  });
+  result.evpCtrPacketsPerSecond = PacketsPerSecond(packets, evpTime);
+
+  const auto noService = [](int, int) {};
+  tgcalls::EncryptedConnection sender(tgcalls::EncryptedConnection::Type::Transport, tgcalls::EncryptionKey(key, true), noService);
+  tgcalls::EncryptedConnection receiver(tgcalls::EncryptedConnection::Type::Transport, tgcalls::EncryptionKey(key, false), noService);
+  const auto plain = rtc::CopyOnWriteBuffer(payload.data(), payload.size());
+  std::vector<rtc::CopyOnWriteBuffer> encrypted(kChunkPackets);
+
+  Clock::duration encryptTime{0};
+  Clock::duration decryptTime{0};
+  int done = 0;
+  while (done < packets) {
+    int count = std::min(kChunkPackets, packets - done);
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) {
+      encrypted[i] = *sender.encryptRawPacket(plain);
+    }
+    auto encryptedAt = Clock::now();
+    for (int i = 0; i < count; i++) {
+      if (!receiver.decryptRawPacket(encrypted[i])) {
+        return result;
+      }
+    }
+    auto decryptedAt = Clock::now();
+
+    encryptTime += encryptedAt - start;
+    decryptTime += decryptedAt - encryptedAt;
+    done += count;
+  }
+  result.encryptPacketsPerSecond = PacketsPerSecond(done, encryptTime);
+  result.decryptPacketsPerSecond = PacketsPerSecond(done, decryptTime);
+  return result;
+}
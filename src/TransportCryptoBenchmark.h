@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+// Measures the MTProto-style packet encryption of 1:1 calls on the calling
+// thread: AES-256-CTR with a fresh key per packet like the transport uses
+// it, through the legacy AES_* calls ("before") and through the EVP
+// context EncryptedConnection keeps ("after"), and full
+// EncryptedConnection encrypt / decrypt round trips.
+struct TransportCryptoBenchmarkResult {
+  uint64_t packets = 0;
+  // Packets per second on one core.
+  double legacyCtrPacketsPerSecond = 0.0;
+  double evpCtrPacketsPerSecond = 0.0;
+  double encryptPacketsPerSecond = 0.0;
+  double decryptPacketsPerSecond = 0.0;
+};
+
+// Runs every measurement over |packets| packets of |payloadSize| bytes.
+TransportCryptoBenchmarkResult RunTransportCryptoBenchmark(int packets, int payloadSize);
@@ -0,0 +1,512 @@
+#include "VideoRtpRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/mem.h>
+}
+
+#include <common_video/h264/h264_common.h>
+#include <modules/rtp_rtcp/source/create_video_rtp_depacketizer.h>
+#include <modules/rtp_rtcp/source/video_rtp_depacketizer.h>
+#include <modules/video_coding/utility/vp9_uncompressed_header_parser.h>
+#include <rtc_base/logging.h>
+#include <rtc_base/platform_thread.h>
+#include <rtc_base/time_utils.h>
+
+namespace {
+
+// Video RTP timestamps are at 90 kHz (RFC 3551).
+const int kRtpClockRate = 90000;
+const int kTimestampsPerMs = kRtpClockRate / 1000;
+// Larger payloads are not of a packet that came through a UDP socket.
+const size_t kMaxPayloadBytes = 1500;
+const size_t kMaxEndpointBytes = 255;
+// Past this many, the oldest missing packet isn't waited for any longer.
+const size_t kMaxPendingPackets = 2048;
+
+const auto kWriteInterval = std::chrono::milliseconds(100);
+
+struct PacketHeader {
+  int64_t arrivalMs;
+  uint32_t ssrc;
+  uint32_t timestamp;
+  uint16_t sequenceNumber;
+  uint8_t codec;
+  uint8_t marker;
+  uint16_t endpointSize;
+  uint16_t size;
+};
+
+webrtc::VideoCodecType CodecType(tgcalls::VideoCodecName codec) {
+  switch (codec) {
+    case tgcalls::VideoCodecName::VP9:
+      return webrtc::kVideoCodecVP9;
+    case tgcalls::VideoCodecName::H264:
+      return webrtc::kVideoCodecH264;
+    default:
+      return webrtc::kVideoCodecVP8;
+  }
+}
+
+AVCodecID CodecId(tgcalls::VideoCodecName codec) {
+  switch (codec) {
+    case tgcalls::VideoCodecName::VP9:
+      return AV_CODEC_ID_VP9;
+    case tgcalls::VideoCodecName::H264:
+      return AV_CODEC_ID_H264;
+    default:
+      return AV_CODEC_ID_VP8;
+  }
+}
+
+// Endpoint IDs come from the server; anything but letters, digits, '-' and
+// '_' is replaced so they make safe file names.
+std::string FileName(const std::string &endpointId) {
+  std::string name = endpointId;
+  for (auto &c : name) {
+    const bool isSafe = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+    if (!isSafe) {
+      c = '_';
+    }
+  }
+  return name.empty() ? "_" : name;
+}
+
+// The SPS and PPS of an H.264 keyframe in Annex B, which the depacketizer
+// turns every NAL unit into, for the MP4 header.
+std::vector<uint8_t> H264ParameterSets(const std::vector<uint8_t> &frame) {
+  static const uint8_t kStartCode[] = {0, 0, 0, 1};
+  std::vector<uint8_t> result;
+  for (const auto &index : webrtc::H264::FindNaluIndices(frame.data(), frame.size())) {
+    if (index.payload_size == 0) {
+      continue;
+    }
+    const auto type = webrtc::H264::ParseNaluType(frame[index.payload_start_offset]);
+    if (type == webrtc::H264::NaluType::kSps || type == webrtc::H264::NaluType::kPps) {
+      result.insert(result.end(), std::begin(kStartCode), std::end(kStartCode));
+      const auto begin = frame.begin() + index.payload_start_offset;
+      result.insert(result.end(), begin, begin + index.payload_size);
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+VideoRtpRecorder::VideoRtpRecorder(std::string directory,
+                                   std::vector<std::string> endpoints,
+                                   size_t queueBytes)
+    : _directory(std::move(directory)),
+      _ring(queueBytes),
+      _endpoints(endpoints.begin(), endpoints.end()) {}
+
+VideoRtpRecorder::~VideoRtpRecorder() {
+  Stop();
+}
+
+bool VideoRtpRecorder::Open() {
+  _packet = av_packet_alloc();
+  if (!_packet) {
+    return false;
+  }
+
+  const auto indexFilename = _directory + "/index.csv";
+  _index = fopen(indexFilename.c_str(), "w");
+  if (!_index) {
+    RTC_LOG(LS_ERROR) << "Failed to open recording index: " << indexFilename;
+    return false;
+  }
+  fputs("endpointId,file,startMs\n", _index);
+  fflush(_index);
+
+  _startMs = rtc::TimeMillis();
+  _thread.reset(new rtc::PlatformThread(
+      ThreadFunc, this, "tgcalls_video_recorder", rtc::kNormalPriority));
+  _thread->Start();
+  _isRecording = true;
+
+  RTC_LOG(LS_INFO) << "Recording incoming video to: " << _directory;
+  return true;
+}
+
+void VideoRtpRecorder::Stop() {
+  _isRecording = false;
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    _wakeUp.notify_one();
+  }
+  if (_thread) {
+    _thread->Stop();
+    _thread.reset();
+  }
+  if (_index) {
+    fclose(_index);
+    _index = nullptr;
+  }
+  if (_packet) {
+    av_packet_free(&_packet);
+  }
+}
+
+void VideoRtpRecorder::SetEndpoints(std::vector<std::string> endpoints) {
+  std::lock_guard<std::mutex> lock(_endpointsMutex);
+  _endpoints = std::set<std::string>(endpoints.begin(), endpoints.end());
+}
+
+void VideoRtpRecorder::OnPacket(const std::string &endpointId, const tgcalls::GroupIncomingVideoPacket &packet) {
+  if (!_isRecording.load(std::memory_order_relaxed)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_endpointsMutex);
+    if (!_endpoints.empty() && _endpoints.find(endpointId) == _endpoints.end()) {
+      return;
+    }
+  }
+  if (packet.size == 0 || packet.size > kMaxPayloadBytes || endpointId.size() > kMaxEndpointBytes) {
+    _droppedPackets++;
+    return;
+  }
+
+  uint8_t record[sizeof(PacketHeader) + kMaxEndpointBytes + kMaxPayloadBytes];
+  PacketHeader header{
+      rtc::TimeMillis(),
+      packet.ssrc,
+      packet.timestamp,
+      packet.sequenceNumber,
+      static_cast<uint8_t>(packet.codec),
+      static_cast<uint8_t>(packet.marker ? 1 : 0),
+      static_cast<uint16_t>(endpointId.size()),
+      static_cast<uint16_t>(packet.size)};
+  memcpy(record, &header, sizeof(header));
+  memcpy(record + sizeof(header), endpointId.data(), endpointId.size());
+  memcpy(record + sizeof(header) + endpointId.size(), packet.payload, packet.size);
+
+  const size_t length = sizeof(header) + endpointId.size() + packet.size;
+  if (_ring.WriteAvailable() < length) {
+    _overruns++;
+    return;
+  }
+  _ring.Write(record, length);
+}
+
+void VideoRtpRecorder::ThreadFunc(void *pThis) {
+  static_cast<VideoRtpRecorder *>(pThis)->Run();
+}
+
+void VideoRtpRecorder::Run() {
+  while (true) {
+    bool stopping = _stopped;
+
+    Drain();
+
+    if (stopping) {
+      break;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _wakeUp.wait_for(lock, kWriteInterval, [this] { return _stopped.load(); });
+  }
+
+  CloseTracks();
+}
+
+void VideoRtpRecorder::Drain() {
+  PacketHeader header;
+  std::string endpointId;
+  // The network thread writes a packet in one go, so a header is always
+  // followed by its endpoint and payload.
+  while (_ring.ReadAvailable() >= sizeof(header)) {
+    _ring.Read(reinterpret_cast<uint8_t *>(&header), sizeof(header));
+    endpointId.resize(header.endpointSize);
+    _ring.Read(reinterpret_cast<uint8_t *>(&endpointId[0]), header.endpointSize);
+    Packet packet;
+    packet.arrivalMs = header.arrivalMs;
+    packet.timestamp = header.timestamp;
+    packet.marker = header.marker != 0;
+    packet.payload.resize(header.size);
+    _ring.Read(packet.payload.data(), header.size);
+    AddPacket(endpointId, header.ssrc, static_cast<tgcalls::VideoCodecName>(header.codec), header.sequenceNumber, std::move(packet));
+  }
+
+  uint64_t bytes = _closedBytes;
+  for (const auto &it : _tracks) {
+    if (it.second.formatContext) {
+      bytes += static_cast<uint64_t>(std::max<int64_t>(0, avio_tell(it.second.formatContext->pb)));
+    }
+  }
+  _bytesWritten = bytes;
+}
+
+void VideoRtpRecorder::AddPacket(const std::string &endpointId, uint32_t ssrc, tgcalls::VideoCodecName codec, uint16_t sequenceNumber, Packet &&packet) {
+  auto &track = _tracks[endpointId];
+  if (track.nextSequenceNumber >= 0 && (ssrc != track.ssrc || codec != track.codec)) {
+    // The sender switched streams, as to another simulcast layer: what is
+    // pending of the previous one won't complete.
+    DropFrame(track);
+    track.pending.clear();
+    track.sequenceNumbers = webrtc::SeqNumUnwrapper<uint16_t>();
+    track.nextSequenceNumber = -1;
+    track.waitsForKeyFrame = true;
+    track.rebases = track.formatContext != nullptr;
+  }
+  if (!track.depacketizer || codec != track.codec) {
+    track.depacketizer = webrtc::CreateVideoRtpDepacketizer(CodecType(codec));
+  }
+  track.ssrc = ssrc;
+  track.codec = codec;
+
+  const int64_t sequence = track.sequenceNumbers.Unwrap(sequenceNumber);
+  if (track.nextSequenceNumber < 0) {
+    track.nextSequenceNumber = sequence;
+  }
+  if (sequence < track.nextSequenceNumber || track.pending.find(sequence) != track.pending.end()) {
+    _droppedPackets++;
+    return;
+  }
+  const int64_t arrivalMs = packet.arrivalMs;
+  track.pending.emplace(sequence, std::move(packet));
+  ProcessPending(endpointId, track, arrivalMs);
+}
+
+void VideoRtpRecorder::ProcessPending(const std::string &endpointId, Track &track, int64_t nowMs) {
+  while (!track.pending.empty()) {
+    auto it = track.pending.begin();
+    if (it->first != track.nextSequenceNumber) {
+      // The first packet after the gap arrived when it was noticed.
+      if (nowMs - it->second.arrivalMs < kMaxReorderMs && track.pending.size() < kMaxPendingPackets) {
+        break;
+      }
+      _lostPackets += static_cast<uint64_t>(it->first - track.nextSequenceNumber);
+      DropFrame(track);
+      track.waitsForKeyFrame = true;
+      track.nextSequenceNumber = it->first;
+    }
+    AddToFrame(endpointId, track, it->second);
+    track.nextSequenceNumber++;
+    track.pending.erase(it);
+  }
+}
+
+void VideoRtpRecorder::AddToFrame(const std::string &endpointId, Track &track, const Packet &packet) {
+  auto parsed = track.depacketizer->Parse(rtc::CopyOnWriteBuffer(packet.payload.data(), packet.payload.size()));
+  if (!parsed) {
+    _droppedPackets++;
+    DropFrame(track);
+    track.waitsForKeyFrame = true;
+    return;
+  }
+  if (track.hasFrame && packet.timestamp != track.frameTimestamp) {
+    // The previous frame's last packet came without the marker bit.
+    CompleteFrame(endpointId, track, packet.arrivalMs);
+  }
+  if (!track.hasFrame) {
+    track.hasFrame = true;
+    track.frameTimestamp = packet.timestamp;
+    track.isKeyFrame = false;
+    track.width = 0;
+    track.height = 0;
+    track.frame.clear();
+  }
+
+  const auto &header = parsed->video_header;
+  if (header.frame_type == webrtc::VideoFrameType::kVideoFrameKey) {
+    track.isKeyFrame = true;
+  }
+  if (header.width != 0 && header.height != 0) {
+    track.width = header.width;
+    track.height = header.height;
+  }
+  track.frame.insert(track.frame.end(), parsed->video_payload.cdata(), parsed->video_payload.cdata() + parsed->video_payload.size());
+  _packets++;
+
+  if (packet.marker) {
+    CompleteFrame(endpointId, track, packet.arrivalMs);
+  }
+}
+
+void VideoRtpRecorder::CompleteFrame(const std::string &endpointId, Track &track, int64_t arrivalMs) {
+  track.hasFrame = false;
+  if (track.waitsForKeyFrame && !track.isKeyFrame) {
+    _droppedFrames++;
+    return;
+  }
+  // A frame missing from the file breaks those that follow it.
+  if (!WriteFrame(endpointId, track, arrivalMs)) {
+    _droppedFrames++;
+    track.waitsForKeyFrame = true;
+    return;
+  }
+  track.waitsForKeyFrame = false;
+  _frames++;
+}
+
+void VideoRtpRecorder::DropFrame(Track &track) {
+  if (track.hasFrame) {
+    track.hasFrame = false;
+    track.frame.clear();
+    _droppedFrames++;
+  }
+}
+
+bool VideoRtpRecorder::WriteFrame(const std::string &endpointId, Track &track, int64_t arrivalMs) {
+  if (track.isKeyFrame && track.codec == tgcalls::VideoCodecName::VP9 && (track.width == 0 || track.height == 0)) {
+    // Without the scalability structure in the payload descriptor.
+    if (const auto info = webrtc::vp9::ParseIntraFrameInfo(track.frame.data(), track.frame.size())) {
+      track.width = info->frame_width;
+      track.height = info->frame_height;
+    }
+  }
+
+  if (track.formatContext && (track.fileCodec != track.codec || arrivalMs - track.lastArrivalMs > kMaxGapSeconds * 1000)) {
+    CloseFile(track);
+    track.segment++;
+  }
+  if (!track.formatContext) {
+    if (!track.isKeyFrame || !StartFile(endpointId, track, arrivalMs)) {
+      return false;
+    }
+    track.timestamps = webrtc::SeqNumUnwrapper<uint32_t>();
+    track.timestampOffset = -track.timestamps.Unwrap(track.frameTimestamp);
+    track.lastPts = -1;
+    track.rebases = false;
+  }
+
+  int64_t timestamp;
+  if (track.rebases) {
+    track.timestamps = webrtc::SeqNumUnwrapper<uint32_t>();
+    timestamp = track.timestamps.Unwrap(track.frameTimestamp);
+    const int64_t elapsed = std::max<int64_t>(1, (arrivalMs - track.lastArrivalMs) * kTimestampsPerMs);
+    track.timestampOffset = track.lastPts + elapsed - timestamp;
+    track.rebases = false;
+  } else {
+    timestamp = track.timestamps.Unwrap(track.frameTimestamp);
+  }
+  const int64_t pts = timestamp + track.timestampOffset;
+  if (pts <= track.lastPts) {
+    return false;
+  }
+
+  if (av_new_packet(_packet, static_cast<int>(track.frame.size())) < 0) {
+    return false;
+  }
+  memcpy(_packet->data, track.frame.data(), track.frame.size());
+  _packet->stream_index = track.stream->index;
+  _packet->pts = av_rescale_q(pts, AVRational{1, kRtpClockRate}, track.stream->time_base);
+  _packet->dts = _packet->pts;
+  _packet->flags = track.isKeyFrame ? AV_PKT_FLAG_KEY : 0;
+  const int result = av_write_frame(track.formatContext, _packet);
+  av_packet_unref(_packet);
+  if (result < 0) {
+    RTC_LOG(LS_WARNING) << "Failed to write a video frame of " << endpointId;
+    return false;
+  }
+
+  track.lastPts = pts;
+  track.lastArrivalMs = arrivalMs;
+  return true;
+}
+
+bool VideoRtpRecorder::StartFile(const std::string &endpointId, Track &track, int64_t arrivalMs) {
+  if (track.width == 0 || track.height == 0) {
+    return false;
+  }
+  const bool isH264 = track.codec == tgcalls::VideoCodecName::H264;
+  std::vector<uint8_t> parameterSets;
+  if (isH264) {
+    parameterSets = H264ParameterSets(track.frame);
+    if (parameterSets.empty()) {
+      return false;
+    }
+  }
+
+  auto filename = FileName(endpointId);
+  if (track.segment > 0) {
+    filename += "-" + std::to_string(track.segment);
+  }
+  filename += isH264 ? ".mp4" : ".webm";
+  const auto path = _directory + "/" + filename;
+
+  AVFormatContext *formatContext = nullptr;
+  if (avformat_alloc_output_context2(&formatContext, nullptr, isH264 ? "mp4" : "webm", path.c_str()) < 0 || !formatContext) {
+    RTC_LOG(LS_ERROR) << "No muxer for recording file: " << path;
+    return false;
+  }
+  AVStream *stream = avformat_new_stream(formatContext, nullptr);
+  if (!stream) {
+    avformat_free_context(formatContext);
+    return false;
+  }
+  stream->time_base = AVRational{1, kRtpClockRate};
+  stream->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+  stream->codecpar->codec_id = CodecId(track.codec);
+  stream->codecpar->width = track.width;
+  stream->codecpar->height = track.height;
+  if (!parameterSets.empty()) {
+    // Freed with the context.
+    stream->codecpar->extradata = static_cast<uint8_t *>(av_mallocz(parameterSets.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+    if (!stream->codecpar->extradata) {
+      avformat_free_context(formatContext);
+      return false;
+    }
+    memcpy(stream->codecpar->extradata, parameterSets.data(), parameterSets.size());
+    stream->codecpar->extradata_size = static_cast<int>(parameterSets.size());
+  }
+
+  if (avio_open(&formatContext->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to open recording file: " << path;
+    avformat_free_context(formatContext);
+    return false;
+  }
+  AVDictionary *options = nullptr;
+  if (isH264) {
+    // Fragmented from every keyframe on, so what was written plays even if
+    // the trailer never is.
+    av_dict_set(&options, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+  }
+  const int result = avformat_write_header(formatContext, &options);
+  av_dict_free(&options);
+  if (result < 0) {
+    RTC_LOG(LS_ERROR) << "Failed to start recording file: " << path;
+    avio_closep(&formatContext->pb);
+    avformat_free_context(formatContext);
+    return false;
+  }
+
+  track.formatContext = formatContext;
+  track.stream = stream;
+  track.fileCodec = track.codec;
+  _files++;
+  if (_index) {
+    fprintf(_index, "%s,%s,%lld\n", endpointId.c_str(), filename.c_str(), static_cast<long long>(arrivalMs - _startMs));
+    fflush(_index);
+  }
+  return true;
+}
+
+void VideoRtpRecorder::CloseFile(Track &track) {
+  if (!track.formatContext) {
+    return;
+  }
+  av_write_trailer(track.formatContext);
+  avio_flush(track.formatContext->pb);
+  _closedBytes += static_cast<uint64_t>(std::max<int64_t>(0, avio_size(track.formatContext->pb)));
+  avio_closep(&track.formatContext->pb);
+  avformat_free_context(track.formatContext);
+  track.formatContext = nullptr;
+  track.stream = nullptr;
+}
+
+void VideoRtpRecorder::CloseTracks() {
+  for (auto &it : _tracks) {
+    CloseFile(it.second);
+  }
+  _tracks.clear();
+  _bytesWritten = _closedBytes;
+}
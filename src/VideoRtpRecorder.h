@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <rtc_base/numerics/sequence_number_util.h>
+#include <tgcalls/group/GroupInstanceImpl.h>
+
+#include "SpscRingBuffer.h"
+
+struct AVFormatContext;
+struct AVPacket;
+struct AVStream;
+
+namespace rtc {
+  class PlatformThread;
+}  // namespace rtc
+
+namespace webrtc {
+  class VideoRtpDepacketizer;
+}  // namespace webrtc
+
+// Records the camera or screencast of selected participants of a group call
+// to a file each, straight from the video RTP received: frames are put back
+// together from their packets and muxed as they are, into WebM for VP8 and
+// VP9 and MP4 for H.264, so nothing is decoded or encoded. A participant's
+// video has to be requested with setRequestedVideoChannels() to be received;
+// without an output attached, it isn't decoded either.
+//
+// Like OpusRtpRecorder, the call's network thread only copies packets into a
+// ring and a thread of the recorder does the rest. Packets are put in order
+// there, waiting up to |kMaxReorderMs| for a missing one, which the receive
+// stream asks to be retransmitted. A file starts with a keyframe, and after a
+// packet is lost for good, or the sender switches streams, frames are
+// dropped until the next keyframe, which the receive stream asks for as
+// well. A change of codec, or a gap of more than |kMaxGapSeconds|, starts a
+// new file. VP9 is expected without spatial layers, as the calls' encoders
+// send it.
+//
+// |directory|/index.csv gets a line per file, "endpointId,file,startMs",
+// where startMs is when its first frame arrived, in milliseconds from
+// Open(), so the tracks can be aligned with each other and with those of an
+// OpusRtpRecorder opened at the same time.
+//
+// Attach a recorder to a single call at a time.
+class VideoRtpRecorder {
+public:
+  static constexpr int kMaxReorderMs = 1000;
+  static constexpr int kMaxGapSeconds = 600;
+  // About ten seconds of three participants at 1.5 Mbps.
+  static constexpr size_t kDefaultQueueBytes = 1 << 23;
+
+  // With no |endpoints|, every participant whose video is received is
+  // recorded.
+  explicit VideoRtpRecorder(std::string directory,
+                            std::vector<std::string> endpoints = {},
+                            size_t queueBytes = kDefaultQueueBytes);
+  // Stops recording if it still is.
+  ~VideoRtpRecorder();
+
+  bool Open();
+  // Writes what is queued and closes every file; packets received
+  // afterwards are ignored.
+  void Stop();
+
+  // Any thread; applies to the packets received from then on.
+  void SetEndpoints(std::vector<std::string> endpoints);
+
+  // Called by the call's network thread for every incoming video packet.
+  void OnPacket(const std::string &endpointId, const tgcalls::GroupIncomingVideoPacket &packet);
+
+  // Packets and frames written, frames dropped while waiting for a keyframe
+  // or as malformed, packets lost for good or dropped as late or duplicate,
+  // and packets lost because the queue was full.
+  uint64_t packets() const { return _packets.load(); }
+  uint64_t frames() const { return _frames.load(); }
+  uint64_t droppedFrames() const { return _droppedFrames.load(); }
+  uint64_t lostPackets() const { return _lostPackets.load(); }
+  uint64_t droppedPackets() const { return _droppedPackets.load(); }
+  uint64_t overruns() const { return _overruns.load(); }
+  uint64_t files() const { return _files.load(); }
+  uint64_t bytesWritten() const { return _bytesWritten.load(); }
+
+private:
+  struct Packet {
+    int64_t arrivalMs = 0;
+    uint32_t timestamp = 0;
+    bool marker = false;
+    std::vector<uint8_t> payload;
+  };
+
+  struct Track {
+    uint32_t ssrc = 0;
+    tgcalls::VideoCodecName codec = tgcalls::VideoCodecName::VP8;
+    std::unique_ptr<webrtc::VideoRtpDepacketizer> depacketizer;
+
+    // By unwrapped sequence number, waiting for the ones before.
+    std::map<int64_t, Packet> pending;
+    webrtc::SeqNumUnwrapper<uint16_t> sequenceNumbers;
+    // -1 until the first packet of the stream.
+    int64_t nextSequenceNumber = -1;
+
+    // The frame being put together.
+    bool hasFrame = false;
+    uint32_t frameTimestamp = 0;
+    bool isKeyFrame = false;
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> frame;
+    bool waitsForKeyFrame = true;
+
+    AVFormatContext *formatContext = nullptr;
+    AVStream *stream = nullptr;
+    tgcalls::VideoCodecName fileCodec = tgcalls::VideoCodecName::VP8;
+    int segment = 0;
+    webrtc::SeqNumUnwrapper<uint32_t> timestamps;
+    // Added to unwrapped RTP timestamps for the file's, at 90 kHz.
+    int64_t timestampOffset = 0;
+    int64_t lastPts = -1;
+    int64_t lastArrivalMs = 0;
+    // Set when the sender switched streams: the next frame is placed by
+    // its arrival time.
+    bool rebases = false;
+  };
+
+  static void ThreadFunc(void *);
+
+  void Run();
+
+  // Handles the packets in |_ring|.
+  void Drain();
+
+  void AddPacket(const std::string &endpointId, uint32_t ssrc, tgcalls::VideoCodecName codec, uint16_t sequenceNumber, Packet &&packet);
+
+  // Passes the packets of |track| that are next in sequence on to the
+  // frame, and skips over missing ones waited for long enough.
+  void ProcessPending(const std::string &endpointId, Track &track, int64_t nowMs);
+
+  void AddToFrame(const std::string &endpointId, Track &track, const Packet &packet);
+
+  void CompleteFrame(const std::string &endpointId, Track &track, int64_t arrivalMs);
+
+  void DropFrame(Track &track);
+
+  bool WriteFrame(const std::string &endpointId, Track &track, int64_t arrivalMs);
+
+  bool StartFile(const std::string &endpointId, Track &track, int64_t arrivalMs);
+
+  void CloseFile(Track &track);
+
+  void CloseTracks();
+
+  std::string _directory;
+  SpscRingBuffer _ring;
+  int64_t _startMs = 0;
+
+  std::mutex _endpointsMutex;
+  std::set<std::string> _endpoints;
+
+  FILE *_index = nullptr;
+  std::map<std::string, Track> _tracks;
+  AVPacket *_packet = nullptr;
+  uint64_t _closedBytes = 0;
+
+  std::atomic<bool> _isRecording{false};
+  std::atomic<bool> _stopped{false};
+  std::mutex _mutex;
+  std::condition_variable _wakeUp;
+  std::unique_ptr<rtc::PlatformThread> _thread;
+
+  std::atomic<uint64_t> _packets{0};
+  std::atomic<uint64_t> _frames{0};
+  std::atomic<uint64_t> _droppedFrames{0};
+  std::atomic<uint64_t> _lostPackets{0};
+  std::atomic<uint64_t> _droppedPackets{0};
+  std::atomic<uint64_t> _overruns{0};
+  std::atomic<uint64_t> _files{0};
+  std::atomic<uint64_t> _bytesWritten{0};
+};
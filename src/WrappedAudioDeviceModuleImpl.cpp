@@ -3,73 +3,76 @@
 rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl>
 WrappedAudioDeviceModuleImpl::Create(
     AudioLayer audio_layer, webrtc::TaskQueueFactory *task_queue_factory,
-    std::shared_ptr<FileAudioDeviceDescriptor> fileAudioDeviceDescriptor) {
+    std::shared_ptr<FileAudioDeviceDescriptor> fileAudioDeviceDescriptor,
+    bool useSharedAudioClock, std::shared_ptr<tgcalls::LatencyTrace> latencyTrace) {
   RTC_LOG(INFO) << __FUNCTION__;
-  return WrappedAudioDeviceModuleImpl::CreateForTest(
-      audio_layer, task_queue_factory, std::move(fileAudioDeviceDescriptor));
+  auto *clockStats = &fileAudioDeviceDescriptor->_clockStats;
+  return Create(audio_layer, task_queue_factory,
+                FileSource(fileAudioDeviceDescriptor), FileSink(fileAudioDeviceDescriptor),
+                clockStats, &fileAudioDeviceDescriptor->_loudness, useSharedAudioClock, std::move(latencyTrace),
+                &fileAudioDeviceDescriptor->_glitches);
 }
 
 rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl>
 WrappedAudioDeviceModuleImpl::Create(
     AudioLayer audio_layer, webrtc::TaskQueueFactory *task_queue_factory,
-    std::shared_ptr<RawAudioDeviceDescriptor> rawAudioDeviceDescriptor) {
+    std::shared_ptr<RawAudioDeviceDescriptor> rawAudioDeviceDescriptor,
+    bool useSharedAudioClock, std::shared_ptr<tgcalls::LatencyTrace> latencyTrace) {
   RTC_LOG(INFO) << __FUNCTION__;
-  return WrappedAudioDeviceModuleImpl::CreateForTest(
-      audio_layer, task_queue_factory, std::move(rawAudioDeviceDescriptor));
+  auto *clockStats = &rawAudioDeviceDescriptor->_clockStats;
+  return Create(audio_layer, task_queue_factory,
+                CallbackSource(rawAudioDeviceDescriptor), CallbackSink(rawAudioDeviceDescriptor),
+                clockStats, &rawAudioDeviceDescriptor->_loudness, useSharedAudioClock, std::move(latencyTrace),
+                &rawAudioDeviceDescriptor->_glitches);
 }
 
 rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl>
-WrappedAudioDeviceModuleImpl::CreateForTest(
+WrappedAudioDeviceModuleImpl::Create(
     AudioLayer audio_layer, webrtc::TaskQueueFactory *task_queue_factory,
-    std::shared_ptr<FileAudioDeviceDescriptor> fileAudioDeviceDescriptor) {
+    std::shared_ptr<RingAudioDeviceDescriptor> ringAudioDeviceDescriptor,
+    bool useSharedAudioClock, std::shared_ptr<tgcalls::LatencyTrace> latencyTrace) {
   RTC_LOG(INFO) << __FUNCTION__;
-
-  // Create the generic reference counted (platform independent) implementation.
-  rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> audioDevice(
-      new rtc::RefCountedObject<webrtc::AudioDeviceModuleImpl>(
-          audio_layer, task_queue_factory));
-
-  // Ensure that the current platform is supported.
-  if (audioDevice->CheckPlatform() == -1) {
-    return nullptr;
-  }
-
-  audioDevice->ResetAudioDevice(new FileAudioDevice(std::move(fileAudioDeviceDescriptor)));
-
-  // Ensure that the generic audio buffer can communicate with the platform
-  // specific parts.
-  if (audioDevice->AttachAudioBuffer() == -1) {
-    return nullptr;
-  }
-
-  return audioDevice;
+  auto *clockStats = &ringAudioDeviceDescriptor->_clockStats;
+  return Create(audio_layer, task_queue_factory,
+                RingSource(ringAudioDeviceDescriptor), RingSink(ringAudioDeviceDescriptor),
+                clockStats, nullptr, useSharedAudioClock, std::move(latencyTrace));
 }
 
 rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl>
-WrappedAudioDeviceModuleImpl::CreateForTest(
+WrappedAudioDeviceModuleImpl::Create(
     AudioLayer audio_layer, webrtc::TaskQueueFactory *task_queue_factory,
-    std::shared_ptr<RawAudioDeviceDescriptor> rawAudioDeviceDescriptor) {
+    std::shared_ptr<MixerAudioDeviceDescriptor> mixerAudioDeviceDescriptor,
+    bool useSharedAudioClock, std::shared_ptr<tgcalls::LatencyTrace> latencyTrace) {
   RTC_LOG(INFO) << __FUNCTION__;
+  auto *clockStats = &mixerAudioDeviceDescriptor->_clockStats;
+  return Create(audio_layer, task_queue_factory,
+                MixerSource(mixerAudioDeviceDescriptor), NullSink(),
+                clockStats, nullptr, useSharedAudioClock, std::move(latencyTrace));
+}
+
+rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl>
+WrappedAudioDeviceModuleImpl::CreateWithDevice(
+    AudioLayer audio_layer, webrtc::TaskQueueFactory *task_queue_factory,
+    webrtc::AudioDeviceGeneric *audioDevice) {
+  std::unique_ptr<webrtc::AudioDeviceGeneric> device(audioDevice);
 
   // Create the generic reference counted (platform independent) implementation.
-  rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> audioDevice(
+  rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> audioDeviceModule(
       new rtc::RefCountedObject<webrtc::AudioDeviceModuleImpl>(
           audio_layer, task_queue_factory));
 
   // Ensure that the current platform is supported.
-  if (audioDevice->CheckPlatform() == -1) {
+  if (audioDeviceModule->CheckPlatform() == -1) {
     return nullptr;
   }
 
-  audioDevice->ResetAudioDevice(new RawAudioDevice(std::move(rawAudioDeviceDescriptor)));
+  audioDeviceModule->ResetAudioDevice(device.release());
 
   // Ensure that the generic audio buffer can communicate with the platform
   // specific parts.
-  if (audioDevice->AttachAudioBuffer() == -1) {
+  if (audioDeviceModule->AttachAudioBuffer() == -1) {
     return nullptr;
   }
 
-  return audioDevice;
+  return audioDeviceModule;
 }
-
-// TODO rewrite this shit (duplication)
\ No newline at end of file
@@ -4,34 +4,75 @@
 #include <rtc_base/ref_counted_object.h>
 #include <modules/audio_device/audio_device_impl.h>
 
-#include "FileAudioDevice.h"
 #include "FileAudioDeviceDescriptor.h"
-#include "RawAudioDevice.h"
+#include "MixerAudioDeviceDescriptor.h"
+#include "PcmAudioDevice.h"
 #include "RawAudioDeviceDescriptor.h"
+#include "RingAudioDeviceDescriptor.h"
 
 namespace rtc {
   class PlatformThread;
 }  // namespace rtc
 
+// Creates audio device modules backed by the custom file/raw/ring/mixer devices. When
+// |useSharedAudioClock| is set, the device is driven by the process-wide
+// AudioPump instead of spawning its own playout and capture threads. A
+// |latencyTrace| receives the device's capture and playout timings.
 class WrappedAudioDeviceModuleImpl : public webrtc::AudioDeviceModule {
 public:
   static rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> Create(
       AudioLayer,
       webrtc::TaskQueueFactory *,
-      std::shared_ptr<FileAudioDeviceDescriptor>);
+      std::shared_ptr<FileAudioDeviceDescriptor>,
+      bool useSharedAudioClock = false,
+      std::shared_ptr<tgcalls::LatencyTrace> latencyTrace = nullptr);
 
   static rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> Create(
       AudioLayer,
       webrtc::TaskQueueFactory *,
-      std::shared_ptr<RawAudioDeviceDescriptor>);
+      std::shared_ptr<RawAudioDeviceDescriptor>,
+      bool useSharedAudioClock = false,
+      std::shared_ptr<tgcalls::LatencyTrace> latencyTrace = nullptr);
 
-  static rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> CreateForTest(
+  static rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> Create(
       AudioLayer,
       webrtc::TaskQueueFactory *,
-      std::shared_ptr<FileAudioDeviceDescriptor>);
+      std::shared_ptr<RingAudioDeviceDescriptor>,
+      bool useSharedAudioClock = false,
+      std::shared_ptr<tgcalls::LatencyTrace> latencyTrace = nullptr);
+
+  static rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> Create(
+      AudioLayer,
+      webrtc::TaskQueueFactory *,
+      std::shared_ptr<MixerAudioDeviceDescriptor>,
+      bool useSharedAudioClock = false,
+      std::shared_ptr<tgcalls::LatencyTrace> latencyTrace = nullptr);
+
+  // Any combination of source and sink policies, e.g. FileSource with
+  // RingSink. |clockStats| and |loudness|, which may be null, must outlive
+  // the module; they are usually owned by a descriptor the policies hold on
+  // to.
+  template <typename Source, typename Sink>
+  static rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> Create(
+      AudioLayer audioLayer,
+      webrtc::TaskQueueFactory *taskQueueFactory,
+      Source source,
+      Sink sink,
+      AudioClockStats *clockStats,
+      AudioLoudnessSettings *loudness,
+      bool useSharedAudioClock = false,
+      std::shared_ptr<tgcalls::LatencyTrace> latencyTrace = nullptr,
+      AudioGlitchDetector *glitches = nullptr) {
+    return CreateWithDevice(audioLayer, taskQueueFactory,
+                            new PcmAudioDevice<Source, Sink>(
+                                std::move(source), std::move(sink), clockStats, loudness,
+                                useSharedAudioClock, std::move(latencyTrace), glitches));
+  }
 
-  static rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> CreateForTest(
+private:
+  // Takes ownership of |audioDevice|.
+  static rtc::scoped_refptr<webrtc::AudioDeviceModuleImpl> CreateWithDevice(
       AudioLayer,
       webrtc::TaskQueueFactory *,
-      std::shared_ptr<RawAudioDeviceDescriptor>);
+      webrtc::AudioDeviceGeneric *audioDevice);
 };
@@ -1,14 +1,49 @@
 #include <cstdio>
+#include <future>
 #include <sstream>
 
 #include <pybind11/smart_holder.h>
 #include <pybind11/stl.h>
 #include <pybind11/functional.h>
 
+#include <rtc_base/ssl_adapter.h>
+
+#include <tgcalls/CpuAccounting.h>
+#include <tgcalls/CpuAffinity.h>
+#include <tgcalls/HotPathCounters.h>
+#include <tgcalls/InvokeAudit.h>
+#include <tgcalls/LogSinkImpl.h>
+#include <tgcalls/OverloadController.h>
+#include <tgcalls/SharedNetworkEnvironment.h>
+#include <tgcalls/SimulatedClock.h>
+#include <tgcalls/StaticThreads.h>
+#include <tgcalls/ThreadScheduling.h>
+#include <tgcalls/TraceRecorder.h>
+#include <tgcalls/TurnNonceCache.h>
+#include <tgcalls/group/BroadcastPartCache.h>
+#include <tgcalls/group/LoopbackSfu.h>
+
 #include "NativeInstance.h"
+#include "CallManager.h"
+#include "DecodedAudioDiskCache.h"
+#include "HotPathBenchmark.h"
+#include "JsonBenchmark.h"
+#include "LoadTest.h"
+#include "SharedAudioRing.h"
+#include "SignalingBenchmark.h"
+#include "SrtpBenchmark.h"
+#include "TransportCryptoBenchmark.h"
 
 namespace py = pybind11;
 
+#ifdef TGCALLS_PGO_GENERATE
+#ifdef __clang__
+extern "C" int __llvm_profile_write_file(void);
+#else
+extern "C" void __gcov_dump(void);
+#endif
+#endif
+
 void ping() {
     py::print("pong");
 }
@@ -17,10 +52,50 @@ PYBIND11_TYPE_CASTER_BASE_HOLDER(T, std::unique_ptr<T>)
 
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(FileAudioDeviceDescriptor)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(RawAudioDeviceDescriptor)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(RingAudioDeviceDescriptor)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(MixerAudioDeviceDescriptor)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(FrameAudioDeviceDescriptor)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(SharedAudioRing)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(IncomingAudioTap)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(TappedAudioFrame)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(AudioBlock)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(OpusRtpRecorder)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(VideoRtpRecorder)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(OggOpusFileSource)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(SpeakerMonitor)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(EventQueue)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(IncomingVideoFrame)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(IncomingVideoSink)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(RawVideoDeviceDescriptor)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(FileVideoSource)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(BroadcastPartRequest)
 
 PYBIND11_TYPE_CASTER_BASE_HOLDER(FileAudioDeviceDescriptor, std::shared_ptr<FileAudioDeviceDescriptor)
 PYBIND11_TYPE_CASTER_BASE_HOLDER(RawAudioDeviceDescriptor, std::shared_ptr<RawAudioDeviceDescriptor>)
-PYBIND11_MODULE(tgcalls, m) {
+PYBIND11_TYPE_CASTER_BASE_HOLDER(RingAudioDeviceDescriptor, std::shared_ptr<RingAudioDeviceDescriptor>)
+PYBIND11_TYPE_CASTER_BASE_HOLDER(MixerAudioDeviceDescriptor, std::shared_ptr<MixerAudioDeviceDescriptor>)
+PYBIND11_TYPE_CASTER_BASE_HOLDER(FrameAudioDeviceDescriptor, std::shared_ptr<FrameAudioDeviceDescriptor>)
+PYBIND11_TYPE_CASTER_BASE_HOLDER(IncomingAudioTap, std::shared_ptr<IncomingAudioTap>)
+PYBIND11_TYPE_CASTER_BASE_HOLDER(IncomingVideoFrame, std::shared_ptr<IncomingVideoFrame>)
+PYBIND11_TYPE_CASTER_BASE_HOLDER(IncomingVideoSink, std::shared_ptr<IncomingVideoSink>)
+PYBIND11_TYPE_CASTER_BASE_HOLDER(RawVideoDeviceDescriptor, std::shared_ptr<RawVideoDeviceDescriptor>)
+PYBIND11_TYPE_CASTER_BASE_HOLDER(FileVideoSource, std::shared_ptr<FileVideoSource>)
+PYBIND11_TYPE_CASTER_BASE_HOLDER(BroadcastPartRequest, std::shared_ptr<BroadcastPartRequest>)
+// Safe without the GIL on a free-threaded build: process-wide state is
+// behind locks or atomics, the callbacks taking Python functions hold them
+// in pybind11's GIL-acquiring wrappers, and CallManager and EventQueue
+// may be shared between threads. A NativeInstance is still to be used from
+// one thread at a time, as with the GIL released in most of its methods
+// already, and the rings of the descriptors from one pushing and one
+// popping thread.
+//
+// Not for subinterpreters with a GIL of their own: callbacks come from
+// webrtc threads through PyGILState, which only reaches the main
+// interpreter, so the module keeps single-phase init and is refused there.
+PYBIND11_MODULE(tgcalls, m, py::mod_gil_not_used()) {
+    // Once per process rather than per NativeInstance.
+    rtc::InitializeSSL();
+
     m.def("ping", &ping);
 
 //    py::add_ostream_redirect(m, "ostream_redirect");
@@ -33,6 +108,12 @@ PYBIND11_MODULE(tgcalls, m) {
         }
     });
 
+    py::enum_<RtcServerFamily>(m, "RtcServerFamily")
+            .value("PreferIpv4", RtcServerFamily::PreferIpv4)
+            .value("PreferIpv6", RtcServerFamily::PreferIpv6)
+            .value("Ipv4Only", RtcServerFamily::Ipv4Only)
+            .value("Ipv6Only", RtcServerFamily::Ipv6Only);
+
     py::class_<RtcServer>(m, "RtcServer")
             .def(py::init<string, string, int, string, string, bool, bool>())
             .def_readwrite("ip", &RtcServer::ip)
@@ -81,21 +162,1356 @@ PYBIND11_MODULE(tgcalls, m) {
             .def_readwrite("ssrcs", &tgcalls::GroupJoinPayloadVideoSourceGroup::ssrcs)
             .def_readwrite("semantics", &tgcalls::GroupJoinPayloadVideoSourceGroup::semantics);
 
+    py::class_<NetworkAudioInput::Options>(m, "NetworkInputOptions")
+            .def(py::init<>())
+            .def_readwrite("bufferMs", &NetworkAudioInput::Options::bufferMs)
+            .def_readwrite("maxBufferMs", &NetworkAudioInput::Options::maxBufferMs)
+            .def_readwrite("reconnectDelayMs", &NetworkAudioInput::Options::reconnectDelayMs)
+            .def_readwrite("maxReconnectDelayMs", &NetworkAudioInput::Options::maxReconnectDelayMs)
+            .def_readwrite("timeoutMs", &NetworkAudioInput::Options::timeoutMs);
+
+    py::class_<NetworkAudioOutputWriter::Options>(m, "NetworkOutputOptions")
+            .def(py::init<>())
+            .def_readwrite("format", &NetworkAudioOutputWriter::Options::format)
+            .def_readwrite("codec", &NetworkAudioOutputWriter::Options::codec)
+            .def_readwrite("bitrate", &NetworkAudioOutputWriter::Options::bitrate)
+            .def_readwrite("maxBacklogMs", &NetworkAudioOutputWriter::Options::maxBacklogMs)
+            .def_readwrite("reconnectDelayMs", &NetworkAudioOutputWriter::Options::reconnectDelayMs)
+            .def_readwrite("maxReconnectDelayMs", &NetworkAudioOutputWriter::Options::maxReconnectDelayMs)
+            .def_readwrite("timeoutMs", &NetworkAudioOutputWriter::Options::timeoutMs);
+
+    py::class_<AudioGlitchStats>(m, "AudioGlitchStats")
+            .def_property_readonly("shortReads", [](const AudioGlitchStats &e) {
+              return e.shortReads.load();
+            })
+            .def_property_readonly("captureSilentGaps", [](const AudioGlitchStats &e) {
+              return e.captureSilentGaps.load();
+            })
+            .def_property_readonly("playoutSilentGaps", [](const AudioGlitchStats &e) {
+              return e.playoutSilentGaps.load();
+            })
+            .def_property_readonly("captureDiscontinuities", [](const AudioGlitchStats &e) {
+              return e.captureDiscontinuities.load();
+            })
+            .def_property_readonly("playoutDiscontinuities", [](const AudioGlitchStats &e) {
+              return e.playoutDiscontinuities.load();
+            })
+            .def_property_readonly("concealments", [](const AudioGlitchStats &e) {
+              return e.concealments.load();
+            });
+
+    py::enum_<AudioGlitchKind>(m, "AudioGlitchKind")
+            .value("LateTicks", AudioGlitchKind::LateTicks)
+            .value("DroppedTicks", AudioGlitchKind::DroppedTicks)
+            .value("ShortRead", AudioGlitchKind::ShortRead)
+            .value("CaptureSilentGap", AudioGlitchKind::CaptureSilentGap)
+            .value("PlayoutSilentGap", AudioGlitchKind::PlayoutSilentGap)
+            .value("CaptureDiscontinuity", AudioGlitchKind::CaptureDiscontinuity)
+            .value("PlayoutDiscontinuity", AudioGlitchKind::PlayoutDiscontinuity)
+            .value("Concealment", AudioGlitchKind::Concealment);
+
+    py::class_<AudioGlitchEvent>(m, "AudioGlitchEvent")
+            .def_readonly("kind", &AudioGlitchEvent::kind)
+            .def_readonly("timestampMs", &AudioGlitchEvent::timestampMs)
+            .def_readonly("count", &AudioGlitchEvent::count);
+
     py::classh<FileAudioDeviceDescriptor>(m, "FileAudioDeviceDescriptor")
             .def(py::init<>())
+            .def_property("recordingSampleRate", [](const FileAudioDeviceDescriptor &e) {
+              return e._recordingFormat.sampleRate;
+            }, [](FileAudioDeviceDescriptor &e, int sampleRate) {
+              e._recordingFormat.sampleRate = AudioFormat::CheckedSampleRate(sampleRate);
+            })
+            .def_property("recordingChannels", [](const FileAudioDeviceDescriptor &e) {
+              return e._recordingFormat.channels;
+            }, [](FileAudioDeviceDescriptor &e, size_t channels) {
+              e._recordingFormat.channels = AudioFormat::CheckedChannels(channels);
+            })
+            .def_property("playoutSampleRate", [](const FileAudioDeviceDescriptor &e) {
+              return e._playoutFormat.sampleRate;
+            }, [](FileAudioDeviceDescriptor &e, int sampleRate) {
+              e._playoutFormat.sampleRate = AudioFormat::CheckedSampleRate(sampleRate);
+            })
+            .def_property("playoutChannels", [](const FileAudioDeviceDescriptor &e) {
+              return e._playoutFormat.channels;
+            }, [](FileAudioDeviceDescriptor &e, size_t channels) {
+              e._playoutFormat.channels = AudioFormat::CheckedChannels(channels);
+            })
             .def_readwrite("getInputFilename", &FileAudioDeviceDescriptor::_getInputFilename)
             .def_readwrite("getOutputFilename", &FileAudioDeviceDescriptor::_getOutputFilename)
             .def_readwrite("isEndlessPlayout", &FileAudioDeviceDescriptor::_isEndlessPlayout)
+            .def_readwrite("isCompressedInput", &FileAudioDeviceDescriptor::_isCompressedInput)
+            .def_readwrite("isMappedInput", &FileAudioDeviceDescriptor::_isMappedInput)
+            .def_readwrite("mappedInputPrefetchBytes", &FileAudioDeviceDescriptor::_mappedInputPrefetchBytes)
+            .def_readwrite("isCachedInput", &FileAudioDeviceDescriptor::_isCachedInput)
+            .def_readwrite("inputCacheKey", &FileAudioDeviceDescriptor::_inputCacheKey)
+            .def_readwrite("isNetworkInput", &FileAudioDeviceDescriptor::_isNetworkInput)
+            .def_readwrite("networkInputOptions", &FileAudioDeviceDescriptor::_networkInputOptions)
+            .def_property_readonly("networkInputConnected", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkInputStats->connected.load();
+            })
+            .def_property_readonly("networkInputConnects", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkInputStats->connects.load();
+            })
+            .def_property_readonly("networkInputFailures", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkInputStats->failures.load();
+            })
+            .def_property_readonly("networkInputUnderruns", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkInputStats->underruns.load();
+            })
+            .def_property_readonly("networkInputSkippedMs", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkInputStats->skippedMs.load();
+            })
+            .def_property_readonly("networkInputBufferedMs", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkInputStats->bufferedMs.load();
+            })
+            .def_readwrite("isAsyncOutput", &FileAudioDeviceDescriptor::_isAsyncOutput)
+            .def_readwrite("isDirectIoOutput", &FileAudioDeviceDescriptor::_isDirectIoOutput)
+            .def_readwrite("isOpusOutput", &FileAudioDeviceDescriptor::_isOpusOutput)
+            .def_readwrite("outputOpusBitrate", &FileAudioDeviceDescriptor::_outputOpusBitrate)
+            .def_readwrite("outputOggPageIntervalMs", &FileAudioDeviceDescriptor::_outputOggPageIntervalMs)
+            .def_readwrite("isNetworkOutput", &FileAudioDeviceDescriptor::_isNetworkOutput)
+            .def_readwrite("networkOutputOptions", &FileAudioDeviceDescriptor::_networkOutputOptions)
+            .def_property_readonly("networkOutputConnected", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkOutputStats->connected.load();
+            })
+            .def_property_readonly("networkOutputConnects", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkOutputStats->connects.load();
+            })
+            .def_property_readonly("networkOutputFailures", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkOutputStats->failures.load();
+            })
+            .def_property_readonly("networkOutputSentBytes", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkOutputStats->sentBytes.load();
+            })
+            .def_property_readonly("networkOutputDiscardedMs", [](const FileAudioDeviceDescriptor &e) {
+              return e._networkOutputStats->discardedMs.load();
+            })
+            .def_property_readonly("outputBacklogBytes", [](const FileAudioDeviceDescriptor &e) {
+              return e._writerStats.backlogBytes.load();
+            })
+            .def_property_readonly("droppedOutputFrames", [](const FileAudioDeviceDescriptor &e) {
+              return e._writerStats.droppedFrames.load();
+            })
+            .def("seek", [](FileAudioDeviceDescriptor &e, int64_t positionMs) {
+              e._seekRequestMs = positionMs < 0 ? 0 : positionMs;
+            }, py::arg("positionMs"))
+            .def("position", [](const FileAudioDeviceDescriptor &e) {
+              return e._inputPositionMs.load();
+            })
+            .def_property("playbackSpeed", [](const FileAudioDeviceDescriptor &e) {
+              return e._playbackSpeed.load();
+            }, [](FileAudioDeviceDescriptor &e, float speed) {
+              e._playbackSpeed = AudioTimeStretcher::CheckedSpeed(speed);
+            })
+            .def("enqueueInput", [](FileAudioDeviceDescriptor &e, std::string filename) {
+              auto options = e._inputOptions();
+              // The cache key names the main input, not queued ones.
+              options.cacheKey.clear();
+              e._inputQueue->Enqueue(std::move(filename), options);
+            }, py::arg("filename"))
+            .def("clearInputQueue", [](FileAudioDeviceDescriptor &e) {
+              e._inputQueue->Clear();
+            })
+            .def_property_readonly("queuedInputs", [](const FileAudioDeviceDescriptor &e) {
+              return e._inputQueue->Size();
+            })
             .def_readwrite("isPlayoutPaused", &FileAudioDeviceDescriptor::_isPlayoutPaused)
             .def_readwrite("isRecordingPaused", &FileAudioDeviceDescriptor::_isRecordingPaused)
-            .def_readwrite("playoutEndedCallback", &FileAudioDeviceDescriptor::_playoutEndedCallback);
+            .def_property("playoutPaused", [](const FileAudioDeviceDescriptor &e) {
+              return e._playoutPaused.load();
+            }, [](FileAudioDeviceDescriptor &e, bool paused) {
+              e._playoutPaused = paused;
+              e._idleSignal.Notify();
+            })
+            .def_property("recordingPaused", [](const FileAudioDeviceDescriptor &e) {
+              return e._recordingPaused.load();
+            }, [](FileAudioDeviceDescriptor &e, bool paused) {
+              e._recordingPaused = paused;
+              e._idleSignal.Notify();
+            })
+            .def_property("endlessPlayout", [](const FileAudioDeviceDescriptor &e) {
+              return e._endlessPlayout.load();
+            }, [](FileAudioDeviceDescriptor &e, bool endless) {
+              e._endlessPlayout = endless;
+            })
+            .def_property("inputFilename", [](const FileAudioDeviceDescriptor &e) {
+              std::lock_guard<std::mutex> lock(e._filenameMutex);
+              return e._inputFilename;
+            }, [](FileAudioDeviceDescriptor &e, std::string filename) {
+              std::lock_guard<std::mutex> lock(e._filenameMutex);
+              e._inputFilename = std::move(filename);
+            })
+            .def_property("outputFilename", [](const FileAudioDeviceDescriptor &e) {
+              std::lock_guard<std::mutex> lock(e._filenameMutex);
+              return e._outputFilename;
+            }, [](FileAudioDeviceDescriptor &e, std::string filename) {
+              std::lock_guard<std::mutex> lock(e._filenameMutex);
+              e._outputFilename = std::move(filename);
+            })
+            .def_readwrite("playoutEndedCallback", &FileAudioDeviceDescriptor::_playoutEndedCallback)
+            .def_property("loudnessNormalization", [](const FileAudioDeviceDescriptor &e) {
+              return e._loudness.enabled.load();
+            }, [](FileAudioDeviceDescriptor &e, bool enabled) {
+              e._loudness.enabled = enabled;
+            })
+            .def_property("loudnessTargetLufs", [](const FileAudioDeviceDescriptor &e) {
+              return e._loudness.targetLufs.load();
+            }, [](FileAudioDeviceDescriptor &e, float lufs) {
+              e._loudness.targetLufs = lufs;
+            })
+            .def_property("limiterCeilingDb", [](const FileAudioDeviceDescriptor &e) {
+              return e._loudness.ceilingDb.load();
+            }, [](FileAudioDeviceDescriptor &e, float db) {
+              e._loudness.ceilingDb = db;
+            })
+            .def_property_readonly("loudnessLufs", [](const FileAudioDeviceDescriptor &e) {
+              return e._loudness.loudnessLufs.load();
+            })
+            .def_property_readonly("loudnessGainDb", [](const FileAudioDeviceDescriptor &e) {
+              return e._loudness.gainDb.load();
+            })
+            .def_property_readonly("lateTicks", [](const FileAudioDeviceDescriptor &e) {
+              return e._clockStats.lateTicks.load();
+            })
+            .def_property_readonly("droppedTicks", [](const FileAudioDeviceDescriptor &e) {
+              return e._clockStats.droppedTicks.load();
+            })
+            .def_property_readonly("glitchStats", [](const FileAudioDeviceDescriptor &e) -> const AudioGlitchStats & {
+              return e._glitches.stats();
+            }, py::return_value_policy::reference_internal)
+            .def("setGlitchCallback", [](FileAudioDeviceDescriptor &e, AudioGlitchDetector::Callback callback) {
+              e._glitches.SetCallback(std::move(callback));
+            }, py::arg("callback").none(true));
 
     py::classh<RawAudioDeviceDescriptor>(m, "RawAudioDeviceDescriptor")
             .def(py::init<>())
+            .def_property("recordingSampleRate", [](const RawAudioDeviceDescriptor &e) {
+              return e._recordingFormat.sampleRate;
+            }, [](RawAudioDeviceDescriptor &e, int sampleRate) {
+              e._recordingFormat.sampleRate = AudioFormat::CheckedSampleRate(sampleRate);
+            })
+            .def_property("recordingChannels", [](const RawAudioDeviceDescriptor &e) {
+              return e._recordingFormat.channels;
+            }, [](RawAudioDeviceDescriptor &e, size_t channels) {
+              e._recordingFormat.channels = AudioFormat::CheckedChannels(channels);
+            })
+            .def_property("playoutSampleRate", [](const RawAudioDeviceDescriptor &e) {
+              return e._playoutFormat.sampleRate;
+            }, [](RawAudioDeviceDescriptor &e, int sampleRate) {
+              e._playoutFormat.sampleRate = AudioFormat::CheckedSampleRate(sampleRate);
+            })
+            .def_property("playoutChannels", [](const RawAudioDeviceDescriptor &e) {
+              return e._playoutFormat.channels;
+            }, [](RawAudioDeviceDescriptor &e, size_t channels) {
+              e._playoutFormat.channels = AudioFormat::CheckedChannels(channels);
+            })
             .def_readwrite("setRecordedBufferCallback", &RawAudioDeviceDescriptor::_setRecordedBufferCallback)
             .def_readwrite("getPlayedBufferCallback", &RawAudioDeviceDescriptor::_getPlayedBufferCallback)
+            .def_readwrite("setRecordedBufferViewCallback", &RawAudioDeviceDescriptor::_setRecordedBufferViewCallback)
+            .def_readwrite("getPlayedBufferViewCallback", &RawAudioDeviceDescriptor::_getPlayedBufferViewCallback)
+            .def_readwrite("lookaheadMs", &RawAudioDeviceDescriptor::_lookaheadMs)
+            .def_readwrite("prefetchBatchMs", &RawAudioDeviceDescriptor::_prefetchBatchMs)
+            .def_property_readonly("lookaheadFillMs", [](const RawAudioDeviceDescriptor &e) {
+              return e._lookaheadStats.fillBytes.load() / (e._recordingFormat.BytesPer10Ms() / 10);
+            })
+            .def_property_readonly("lookaheadUnderruns", [](const RawAudioDeviceDescriptor &e) {
+              return e._lookaheadStats.underruns.load();
+            })
             .def_readwrite("isPlayoutPaused", &RawAudioDeviceDescriptor::_isPlayoutPaused)
-            .def_readwrite("isRecordingPaused", &RawAudioDeviceDescriptor::_isRecordingPaused);
+            .def_readwrite("isRecordingPaused", &RawAudioDeviceDescriptor::_isRecordingPaused)
+            .def_property("playoutPaused", [](const RawAudioDeviceDescriptor &e) {
+              return e._playoutPaused.load();
+            }, [](RawAudioDeviceDescriptor &e, bool paused) {
+              e._playoutPaused = paused;
+              e._idleSignal.Notify();
+            })
+            .def_property("recordingPaused", [](const RawAudioDeviceDescriptor &e) {
+              return e._recordingPaused.load();
+            }, [](RawAudioDeviceDescriptor &e, bool paused) {
+              e._recordingPaused = paused;
+              e._idleSignal.Notify();
+            })
+            .def_property("loudnessNormalization", [](const RawAudioDeviceDescriptor &e) {
+              return e._loudness.enabled.load();
+            }, [](RawAudioDeviceDescriptor &e, bool enabled) {
+              e._loudness.enabled = enabled;
+            })
+            .def_property("loudnessTargetLufs", [](const RawAudioDeviceDescriptor &e) {
+              return e._loudness.targetLufs.load();
+            }, [](RawAudioDeviceDescriptor &e, float lufs) {
+              e._loudness.targetLufs = lufs;
+            })
+            .def_property("limiterCeilingDb", [](const RawAudioDeviceDescriptor &e) {
+              return e._loudness.ceilingDb.load();
+            }, [](RawAudioDeviceDescriptor &e, float db) {
+              e._loudness.ceilingDb = db;
+            })
+            .def_property_readonly("loudnessLufs", [](const RawAudioDeviceDescriptor &e) {
+              return e._loudness.loudnessLufs.load();
+            })
+            .def_property_readonly("loudnessGainDb", [](const RawAudioDeviceDescriptor &e) {
+              return e._loudness.gainDb.load();
+            })
+            .def_property_readonly("lateTicks", [](const RawAudioDeviceDescriptor &e) {
+              return e._clockStats.lateTicks.load();
+            })
+            .def_property_readonly("droppedTicks", [](const RawAudioDeviceDescriptor &e) {
+              return e._clockStats.droppedTicks.load();
+            })
+            .def_property_readonly("glitchStats", [](const RawAudioDeviceDescriptor &e) -> const AudioGlitchStats & {
+              return e._glitches.stats();
+            }, py::return_value_policy::reference_internal)
+            .def("setGlitchCallback", [](RawAudioDeviceDescriptor &e, AudioGlitchDetector::Callback callback) {
+              e._glitches.SetCallback(std::move(callback));
+            }, py::arg("callback").none(true));
+
+    py::classh<RingAudioDeviceDescriptor>(m, "RingAudioDeviceDescriptor")
+            .def(py::init<size_t>(), py::arg("capacity") = RingAudioDeviceDescriptor::kDefaultCapacity)
+            .def_property("recordingSampleRate", [](const RingAudioDeviceDescriptor &e) {
+              return e._recordingFormat.sampleRate;
+            }, [](RingAudioDeviceDescriptor &e, int sampleRate) {
+              e._recordingFormat.sampleRate = AudioFormat::CheckedSampleRate(sampleRate);
+            })
+            .def_property("recordingChannels", [](const RingAudioDeviceDescriptor &e) {
+              return e._recordingFormat.channels;
+            }, [](RingAudioDeviceDescriptor &e, size_t channels) {
+              e._recordingFormat.channels = AudioFormat::CheckedChannels(channels);
+            })
+            .def_property("playoutSampleRate", [](const RingAudioDeviceDescriptor &e) {
+              return e._playoutFormat.sampleRate;
+            }, [](RingAudioDeviceDescriptor &e, int sampleRate) {
+              e._playoutFormat.sampleRate = AudioFormat::CheckedSampleRate(sampleRate);
+            })
+            .def_property("playoutChannels", [](const RingAudioDeviceDescriptor &e) {
+              return e._playoutFormat.channels;
+            }, [](RingAudioDeviceDescriptor &e, size_t channels) {
+              e._playoutFormat.channels = AudioFormat::CheckedChannels(channels);
+            })
+            .def("push", &RingAudioDeviceDescriptor::push)
+            .def("pushBuffer", &RingAudioDeviceDescriptor::pushBuffer)
+            .def("pop", &RingAudioDeviceDescriptor::pop)
+            .def("popInto", &RingAudioDeviceDescriptor::popInto)
+            .def("popBlock", &RingAudioDeviceDescriptor::popBlock, py::arg("frames"), py::arg("asFloat") = false)
+            .def_property_readonly("availableToPush", [](const RingAudioDeviceDescriptor &e) {
+              return e._playedRing.WriteAvailable();
+            })
+            .def_property_readonly("availableToPop", [](const RingAudioDeviceDescriptor &e) {
+              return e._recordedRing.ReadAvailable();
+            })
+            .def_property("isPlayoutPaused", [](const RingAudioDeviceDescriptor &e) {
+              return e._isPlayoutPaused.load();
+            }, [](RingAudioDeviceDescriptor &e, bool paused) {
+              e._isPlayoutPaused = paused;
+              e._idleSignal.Notify();
+            })
+            .def_property("isRecordingPaused", [](const RingAudioDeviceDescriptor &e) {
+              return e._isRecordingPaused.load();
+            }, [](RingAudioDeviceDescriptor &e, bool paused) {
+              e._isRecordingPaused = paused;
+              e._idleSignal.Notify();
+            })
+            .def_property_readonly("underruns", [](const RingAudioDeviceDescriptor &e) {
+              return e._underruns.load();
+            })
+            .def_property_readonly("overruns", [](const RingAudioDeviceDescriptor &e) {
+              return e._overruns.load();
+            })
+            .def_property_readonly("lateTicks", [](const RingAudioDeviceDescriptor &e) {
+              return e._clockStats.lateTicks.load();
+            })
+            .def_property_readonly("droppedTicks", [](const RingAudioDeviceDescriptor &e) {
+              return e._clockStats.droppedTicks.load();
+            });
+
+    // The client side of a media host call's rings; see media_host/.
+    py::classh<SharedAudioRing>(m, "SharedAudioRing")
+            .def_static("open", [](const std::string &name) {
+              auto ring = SharedAudioRing::Open(name);
+              if (!ring) {
+                throw std::runtime_error("cannot open shared audio ring " + name);
+              }
+              return ring;
+            })
+            .def("write", [](SharedAudioRing &e, const py::bytes &data) {
+              char *buffer = nullptr;
+              py::ssize_t length = 0;
+              PyBytes_AsStringAndSize(data.ptr(), &buffer, &length);
+              return e.Write(reinterpret_cast<const uint8_t *>(buffer), static_cast<size_t>(length));
+            })
+            .def("read", [](SharedAudioRing &e, size_t length) {
+              // This side is the ring's only consumer, so what's available
+              // now can all be read.
+              length = std::min(length, e.ReadAvailable());
+              auto data = py::reinterpret_steal<py::bytes>(
+                  PyBytes_FromStringAndSize(nullptr, static_cast<py::ssize_t>(length)));
+              if (!data) {
+                throw py::error_already_set();
+              }
+              e.Read(reinterpret_cast<uint8_t *>(PyBytes_AS_STRING(data.ptr())), length);
+              return data;
+            })
+            .def_property_readonly("name", &SharedAudioRing::name)
+            .def_property_readonly("capacity", &SharedAudioRing::capacity)
+            .def_property_readonly("availableToRead", &SharedAudioRing::ReadAvailable)
+            .def_property_readonly("availableToWrite", &SharedAudioRing::WriteAvailable);
+
+    py::classh<MixerAudioDeviceDescriptor>(m, "MixerAudioDeviceDescriptor")
+            .def(py::init<size_t, size_t>(), py::arg("inputs") = 2,
+                 py::arg("capacity") = MixerAudioDeviceDescriptor::kDefaultCapacity)
+            .def_property("recordingSampleRate", [](const MixerAudioDeviceDescriptor &e) {
+              return e._recordingFormat.sampleRate;
+            }, [](MixerAudioDeviceDescriptor &e, int sampleRate) {
+              e._recordingFormat.sampleRate = AudioFormat::CheckedSampleRate(sampleRate);
+            })
+            .def_property("recordingChannels", [](const MixerAudioDeviceDescriptor &e) {
+              return e._recordingFormat.channels;
+            }, [](MixerAudioDeviceDescriptor &e, size_t channels) {
+              e._recordingFormat.channels = AudioFormat::CheckedChannels(channels);
+            })
+            .def_property_readonly("inputs", [](const MixerAudioDeviceDescriptor &e) {
+              return e._mixer.InputCount();
+            })
+            .def("push", &MixerAudioDeviceDescriptor::push, py::arg("input"), py::arg("data"))
+            .def("pushBuffer", &MixerAudioDeviceDescriptor::pushBuffer, py::arg("input"), py::arg("buffer"))
+            .def("availableToPush", [](const MixerAudioDeviceDescriptor &e, size_t input) {
+              return e._mixer.input(input).ring.WriteAvailable();
+            }, py::arg("input"))
+            .def("setGain", [](MixerAudioDeviceDescriptor &e, size_t input, float gain) {
+              e._mixer.input(input).gain = AudioMixer::ClampGain(gain);
+            }, py::arg("input"), py::arg("gain"))
+            .def("gain", [](const MixerAudioDeviceDescriptor &e, size_t input) {
+              return e._mixer.input(input).gain.load();
+            }, py::arg("input"))
+            .def("setMuted", [](MixerAudioDeviceDescriptor &e, size_t input, bool muted) {
+              e._mixer.input(input).muted = muted;
+            }, py::arg("input"), py::arg("muted"))
+            .def("isMuted", [](const MixerAudioDeviceDescriptor &e, size_t input) {
+              return e._mixer.input(input).muted.load();
+            }, py::arg("input"))
+            .def("setDucksOthers", [](MixerAudioDeviceDescriptor &e, size_t input, bool ducks) {
+              e._mixer.input(input).ducksOthers = ducks;
+            }, py::arg("input"), py::arg("ducks"))
+            .def("ducksOthers", [](const MixerAudioDeviceDescriptor &e, size_t input) {
+              return e._mixer.input(input).ducksOthers.load();
+            }, py::arg("input"))
+            .def("underruns", [](const MixerAudioDeviceDescriptor &e, size_t input) {
+              return e._mixer.input(input).underruns.load();
+            }, py::arg("input"))
+            .def_property("duckGain", [](const MixerAudioDeviceDescriptor &e) {
+              return e._mixer.DuckGain();
+            }, [](MixerAudioDeviceDescriptor &e, float gain) {
+              e._mixer.SetDuckGain(gain);
+            })
+            .def_property_readonly("isDucking", [](const MixerAudioDeviceDescriptor &e) {
+              return e._mixer.IsDucking();
+            })
+            .def_property("isPlayoutPaused", [](const MixerAudioDeviceDescriptor &e) {
+              return e._isPlayoutPaused.load();
+            }, [](MixerAudioDeviceDescriptor &e, bool paused) {
+              e._isPlayoutPaused = paused;
+              e._idleSignal.Notify();
+            })
+            .def_property_readonly("overruns", [](const MixerAudioDeviceDescriptor &e) {
+              return e._overruns.load();
+            })
+            .def_property_readonly("lateTicks", [](const MixerAudioDeviceDescriptor &e) {
+              return e._clockStats.lateTicks.load();
+            })
+            .def_property_readonly("droppedTicks", [](const MixerAudioDeviceDescriptor &e) {
+              return e._clockStats.droppedTicks.load();
+            });
+
+    py::classh<FrameAudioDeviceDescriptor>(m, "FrameAudioDeviceDescriptor")
+            .def(py::init<size_t>(), py::arg("capacity") = FrameAudioDeviceDescriptor::kDefaultCapacity)
+            .def_property("sampleRate", [](const FrameAudioDeviceDescriptor &e) {
+              return e._format.sampleRate;
+            }, [](FrameAudioDeviceDescriptor &e, int sampleRate) {
+              e._format.sampleRate = FrameAudioDeviceDescriptor::CheckedSampleRate(sampleRate);
+            })
+            .def_property("channels", [](const FrameAudioDeviceDescriptor &e) {
+              return e._format.channels;
+            }, [](FrameAudioDeviceDescriptor &e, size_t channels) {
+              e._format.channels = AudioFormat::CheckedChannels(channels);
+            })
+            // Set before the call starts.
+            .def_readwrite("participants", &FrameAudioDeviceDescriptor::_participants)
+            .def("push", &FrameAudioDeviceDescriptor::push)
+            .def("pushBuffer", &FrameAudioDeviceDescriptor::pushBuffer)
+            .def("pop", &FrameAudioDeviceDescriptor::pop)
+            .def("popInto", &FrameAudioDeviceDescriptor::popInto)
+            .def("popBlock", &FrameAudioDeviceDescriptor::popBlock, py::arg("frames"), py::arg("asFloat") = false)
+            .def_property_readonly("availableToPush", [](const FrameAudioDeviceDescriptor &e) {
+              return e._playedRing.WriteAvailable();
+            })
+            .def_property_readonly("availableToPop", [](const FrameAudioDeviceDescriptor &e) {
+              return e._recordedRing.ReadAvailable();
+            })
+            .def_property("isPlayoutPaused", [](const FrameAudioDeviceDescriptor &e) {
+              return e._isPlayoutPaused.load();
+            }, [](FrameAudioDeviceDescriptor &e, bool paused) {
+              e._isPlayoutPaused = paused;
+            })
+            .def_property("isRecordingPaused", [](const FrameAudioDeviceDescriptor &e) {
+              return e._isRecordingPaused.load();
+            }, [](FrameAudioDeviceDescriptor &e, bool paused) {
+              e._isRecordingPaused = paused;
+            })
+            .def_property_readonly("underruns", [](const FrameAudioDeviceDescriptor &e) {
+              return e._underruns.load();
+            })
+            .def_property_readonly("overruns", [](const FrameAudioDeviceDescriptor &e) {
+              return e._overruns.load();
+            })
+            .def_property_readonly("lateTicks", [](const FrameAudioDeviceDescriptor &e) {
+              return e._clockStats.lateTicks.load();
+            })
+            .def_property_readonly("droppedTicks", [](const FrameAudioDeviceDescriptor &e) {
+              return e._clockStats.droppedTicks.load();
+            });
+
+    py::classh<AudioBlock>(m, "AudioBlock", py::buffer_protocol())
+            .def_buffer(&AudioBlock::buffer)
+            .def_property_readonly("channels", &AudioBlock::channels)
+            .def_property_readonly("frames", &AudioBlock::frames)
+            .def_property_readonly("isFloat", &AudioBlock::isFloat);
+
+    py::classh<TappedAudioFrame>(m, "TappedAudioFrame", py::buffer_protocol())
+            .def_buffer(&TappedAudioFrame::buffer)
+            .def_property_readonly("ssrc", &TappedAudioFrame::ssrc)
+            .def_property_readonly("sampleRate", &TappedAudioFrame::sampleRate)
+            .def_property_readonly("channels", &TappedAudioFrame::channels)
+            .def_property_readonly("samplesPerChannel", &TappedAudioFrame::samplesPerChannel)
+            .def_property_readonly("elapsedTimeMs", &TappedAudioFrame::elapsedTimeMs)
+            .def_property_readonly("released", &TappedAudioFrame::released)
+            .def("toFloat", &TappedAudioFrame::toFloat)
+            .def("release", &TappedAudioFrame::release);
+
+    py::classh<IncomingAudioTap>(m, "IncomingAudioTap")
+            .def(py::init<size_t>(), py::arg("capacity") = IncomingAudioTap::kDefaultCapacity)
+            .def("subscribe", &IncomingAudioTap::subscribe, py::arg("ssrc"))
+            .def("subscribeFrames", &IncomingAudioTap::subscribeFrames, py::arg("ssrc"),
+                 py::arg("slots") = IncomingAudioTap::kDefaultFrameSlots)
+            .def("unsubscribe", &IncomingAudioTap::unsubscribe, py::arg("ssrc"))
+            .def_property_readonly("subscribed", &IncomingAudioTap::subscribed)
+            .def("pop", &IncomingAudioTap::pop, py::arg("ssrc"), py::arg("length"))
+            .def("popInto", &IncomingAudioTap::popInto, py::arg("ssrc"), py::arg("buffer"))
+            .def("popBlock", &IncomingAudioTap::popBlock, py::arg("ssrc"), py::arg("frames"), py::arg("asFloat") = false)
+            .def("available", &IncomingAudioTap::available, py::arg("ssrc"))
+            .def("acquireFrame", &IncomingAudioTap::acquireFrame, py::arg("ssrc"))
+            .def("framesAvailable", &IncomingAudioTap::framesAvailable, py::arg("ssrc"))
+            .def("sampleRate", &IncomingAudioTap::sampleRate, py::arg("ssrc"))
+            .def("channels", &IncomingAudioTap::channels, py::arg("ssrc"))
+            .def("overruns", &IncomingAudioTap::overruns, py::arg("ssrc"));
+
+    py::classh<OpusRtpRecorder>(m, "OpusRtpRecorder")
+            .def(py::init<std::string, size_t>(), py::arg("directory"),
+                 py::arg("queueBytes") = OpusRtpRecorder::kDefaultQueueBytes)
+            .def("open", &OpusRtpRecorder::Open)
+            .def("stop", &OpusRtpRecorder::Stop, py::call_guard<py::gil_scoped_release>())
+            .def_property_readonly("packets", &OpusRtpRecorder::packets)
+            .def_property_readonly("filledPackets", &OpusRtpRecorder::filledPackets)
+            .def_property_readonly("droppedPackets", &OpusRtpRecorder::droppedPackets)
+            .def_property_readonly("overruns", &OpusRtpRecorder::overruns)
+            .def_property_readonly("files", &OpusRtpRecorder::files)
+            .def_property_readonly("bytesWritten", &OpusRtpRecorder::bytesWritten);
+
+    py::classh<VideoRtpRecorder>(m, "VideoRtpRecorder")
+            .def(py::init<std::string, std::vector<std::string>, size_t>(), py::arg("directory"),
+                 py::arg("endpoints") = std::vector<std::string>(),
+                 py::arg("queueBytes") = VideoRtpRecorder::kDefaultQueueBytes)
+            .def("open", &VideoRtpRecorder::Open)
+            .def("stop", &VideoRtpRecorder::Stop, py::call_guard<py::gil_scoped_release>())
+            .def("setEndpoints", &VideoRtpRecorder::SetEndpoints, py::arg("endpoints"))
+            .def_property_readonly("packets", &VideoRtpRecorder::packets)
+            .def_property_readonly("frames", &VideoRtpRecorder::frames)
+            .def_property_readonly("droppedFrames", &VideoRtpRecorder::droppedFrames)
+            .def_property_readonly("lostPackets", &VideoRtpRecorder::lostPackets)
+            .def_property_readonly("droppedPackets", &VideoRtpRecorder::droppedPackets)
+            .def_property_readonly("overruns", &VideoRtpRecorder::overruns)
+            .def_property_readonly("files", &VideoRtpRecorder::files)
+            .def_property_readonly("bytesWritten", &VideoRtpRecorder::bytesWritten);
+
+    py::classh<EventQueue>(m, "EventQueue")
+            .def(py::init<>())
+            .def("fileno", &EventQueue::fileno)
+            .def("dispatch", &EventQueue::Dispatch)
+            .def("close", &EventQueue::Close);
+
+    py::classh<SpeakerMonitor>(m, "SpeakerMonitor")
+            .def(py::init<SpeakerMonitor::Callback, int, int>(), py::arg("callback"), py::arg("intervalMs") = 500,
+                 py::arg("holdMs") = 1000)
+            .def_property_readonly("speakingCount", &SpeakerMonitor::speakingCount)
+            .def("setEventQueue", &SpeakerMonitor::SetEventQueue, py::arg("queue"))
+            .def("stop", &SpeakerMonitor::Stop, py::call_guard<py::gil_scoped_release>());
+
+    py::class_<tgcalls::MediaSsrcGroup>(m, "MediaSsrcGroup")
+            .def(py::init<>())
+            .def_readwrite("semantics", &tgcalls::MediaSsrcGroup::semantics)
+            .def_readwrite("ssrcs", &tgcalls::MediaSsrcGroup::ssrcs);
+
+    py::class_<tgcalls::GroupAudioEncoderProfile> audioEncoderProfile(m, "AudioEncoderProfile");
+
+    py::enum_<tgcalls::GroupAudioEncoderProfile::Preset>(audioEncoderProfile, "Preset")
+            .value("Voice", tgcalls::GroupAudioEncoderProfile::Preset::Voice)
+            .value("Music", tgcalls::GroupAudioEncoderProfile::Preset::Music)
+            .value("LowBandwidth", tgcalls::GroupAudioEncoderProfile::Preset::LowBandwidth);
+
+    audioEncoderProfile
+            .def(py::init<>())
+            .def(py::init(&tgcalls::GroupAudioEncoderProfile::preset), py::arg("preset"))
+            .def_readwrite("minBitrateKbit", &tgcalls::GroupAudioEncoderProfile::minBitrateKbit)
+            .def_readwrite("startBitrateKbit", &tgcalls::GroupAudioEncoderProfile::startBitrateKbit)
+            .def_readwrite("maxBitrateKbit", &tgcalls::GroupAudioEncoderProfile::maxBitrateKbit)
+            .def_readwrite("ptimeMs", &tgcalls::GroupAudioEncoderProfile::ptimeMs)
+            .def_readwrite("dtx", &tgcalls::GroupAudioEncoderProfile::dtx)
+            .def_readwrite("fec", &tgcalls::GroupAudioEncoderProfile::fec)
+            .def_readwrite("stereo", &tgcalls::GroupAudioEncoderProfile::stereo)
+            .def_readwrite("complexity", &tgcalls::GroupAudioEncoderProfile::complexity);
+
+    py::class_<tgcalls::GroupVoiceGate>(m, "VoiceGate")
+            .def(py::init<>())
+            .def_readwrite("enabled", &tgcalls::GroupVoiceGate::enabled)
+            .def_readwrite("hangoverMs", &tgcalls::GroupVoiceGate::hangoverMs)
+            .def_readwrite("reportsSilence", &tgcalls::GroupVoiceGate::reportsSilence);
+
+    py::class_<tgcalls::GroupAudioReceiveProfile> audioReceiveProfile(m, "AudioReceiveProfile");
+
+    py::enum_<tgcalls::GroupAudioReceiveProfile::Preset>(audioReceiveProfile, "Preset")
+            .value("Interactive", tgcalls::GroupAudioReceiveProfile::Preset::Interactive)
+            .value("Recording", tgcalls::GroupAudioReceiveProfile::Preset::Recording);
+
+    audioReceiveProfile
+            .def(py::init<>())
+            .def(py::init(&tgcalls::GroupAudioReceiveProfile::preset), py::arg("preset"))
+            .def_readwrite("minDelayMs", &tgcalls::GroupAudioReceiveProfile::minDelayMs)
+            .def_readwrite("maxDelayMs", &tgcalls::GroupAudioReceiveProfile::maxDelayMs)
+            .def_readwrite("fastAccelerate", &tgcalls::GroupAudioReceiveProfile::fastAccelerate)
+            .def_readwrite("maxPackets", &tgcalls::GroupAudioReceiveProfile::maxPackets);
+
+    py::class_<tgcalls::GroupAudioMixerConfig>(m, "AudioMixerConfig")
+            .def(py::init<>())
+            .def_readwrite("isEnabled", &tgcalls::GroupAudioMixerConfig::isEnabled)
+            .def_readwrite("maxMixedSources", &tgcalls::GroupAudioMixerConfig::maxMixedSources)
+            .def_readwrite("hysteresisDb", &tgcalls::GroupAudioMixerConfig::hysteresisDb)
+            .def_readwrite("skipMutedSources", &tgcalls::GroupAudioMixerConfig::skipMutedSources);
+
+    py::class_<tgcalls::VideoChannelDescription> videoChannelDescription(m, "VideoChannelDescription");
+
+    py::enum_<tgcalls::VideoChannelDescription::Quality>(videoChannelDescription, "Quality")
+            .value("Thumbnail", tgcalls::VideoChannelDescription::Quality::Thumbnail)
+            .value("Medium", tgcalls::VideoChannelDescription::Quality::Medium)
+            .value("Full", tgcalls::VideoChannelDescription::Quality::Full);
+
+    videoChannelDescription
+            .def(py::init<>())
+            .def_readwrite("audioSsrc", &tgcalls::VideoChannelDescription::audioSsrc)
+            .def_readwrite("endpointId", &tgcalls::VideoChannelDescription::endpointId)
+            .def_readwrite("ssrcGroups", &tgcalls::VideoChannelDescription::ssrcGroups)
+            .def_readwrite("minQuality", &tgcalls::VideoChannelDescription::minQuality)
+            .def_readwrite("maxQuality", &tgcalls::VideoChannelDescription::maxQuality);
+
+    py::class_<IncomingVideoPlane>(m, "IncomingVideoPlane", py::buffer_protocol())
+            .def_buffer([](IncomingVideoPlane &plane) {
+              return plane.frame->planeBuffer(plane.index);
+            });
+
+    py::classh<IncomingVideoFrame>(m, "IncomingVideoFrame")
+            .def_property_readonly("width", &IncomingVideoFrame::width)
+            .def_property_readonly("height", &IncomingVideoFrame::height)
+            .def_property_readonly("timestampUs", &IncomingVideoFrame::timestampUs)
+            .def_property_readonly("rotation", &IncomingVideoFrame::rotation)
+            .def_property_readonly("format", &IncomingVideoFrame::format)
+            .def_property_readonly("planeCount", &IncomingVideoFrame::planeCount)
+            .def("plane", &IncomingVideoFrame::plane, py::arg("index"));
+
+    py::classh<IncomingVideoSink>(m, "IncomingVideoSink")
+            .def(py::init<IncomingVideoSink::Callback, double, int, int>(),
+                 py::arg("callback"), py::arg("maxFps") = 0.0, py::arg("maxWidth") = 0, py::arg("maxHeight") = 0)
+            .def("setMaxSize", &IncomingVideoSink::setMaxSize, py::arg("maxWidth"), py::arg("maxHeight"))
+            .def_property_readonly("delivered", &IncomingVideoSink::delivered)
+            .def_property_readonly("dropped", &IncomingVideoSink::dropped);
+
+    py::classh<RawVideoDeviceDescriptor> rawVideoDeviceDescriptor(m, "RawVideoDeviceDescriptor");
+
+    py::enum_<RawVideoDeviceDescriptor::PixelFormat>(rawVideoDeviceDescriptor, "PixelFormat")
+            .value("I420", RawVideoDeviceDescriptor::PixelFormat::I420)
+            .value("NV12", RawVideoDeviceDescriptor::PixelFormat::NV12)
+            .value("RGBA", RawVideoDeviceDescriptor::PixelFormat::RGBA)
+            .value("BGRA", RawVideoDeviceDescriptor::PixelFormat::BGRA)
+            .value("RGB24", RawVideoDeviceDescriptor::PixelFormat::RGB24)
+            .value("BGR24", RawVideoDeviceDescriptor::PixelFormat::BGR24);
+
+    rawVideoDeviceDescriptor
+            .def(py::init<size_t>(), py::arg("poolSize") = RawVideoDeviceDescriptor::kDefaultPoolSize)
+            .def("pushFrame", &RawVideoDeviceDescriptor::pushFrame,
+                 py::arg("data"), py::arg("format"), py::arg("width"), py::arg("height"),
+                 py::arg("timestampUs") = -1, py::arg("stride") = 0)
+            .def_property_readonly("pushed", &RawVideoDeviceDescriptor::pushed)
+            .def_property_readonly("dropped", &RawVideoDeviceDescriptor::dropped);
+
+    py::classh<FileVideoSource>(m, "FileVideoSource")
+            .def(py::init([](std::string filename, int width, int height, bool loop, std::string hwaccel,
+                             std::string hwaccelDevice) {
+                   FileVideoSource::Options options;
+                   options.width = width;
+                   options.height = height;
+                   options.loop = loop;
+                   options.hwaccel = std::move(hwaccel);
+                   options.hwaccelDevice = std::move(hwaccelDevice);
+                   return std::make_shared<FileVideoSource>(std::move(filename), std::move(options));
+                 }),
+                 py::arg("filename"), py::arg("width") = 0, py::arg("height") = 0, py::arg("loop") = false,
+                 py::arg("hwaccel") = "", py::arg("hwaccelDevice") = "")
+            .def("syncTo", &FileVideoSource::SyncTo, py::arg("audio"))
+            .def("open", &FileVideoSource::Open, py::call_guard<py::gil_scoped_release>())
+            .def("seek", &FileVideoSource::Seek, py::arg("positionMs"))
+            .def_property_readonly("positionMs", &FileVideoSource::PositionMs)
+            .def_property_readonly("finished", &FileVideoSource::Finished)
+            .def_property_readonly("sentFrames", &FileVideoSource::SentFrames)
+            .def_property_readonly("droppedFrames", &FileVideoSource::DroppedFrames);
+
+    py::class_<DecodedAudioCache::Stats>(m, "DecodedAudioCacheStats")
+            .def_readonly("hits", &DecodedAudioCache::Stats::hits)
+            .def_readonly("misses", &DecodedAudioCache::Stats::misses)
+            .def_readonly("evictions", &DecodedAudioCache::Stats::evictions)
+            .def_readonly("entries", &DecodedAudioCache::Stats::entries)
+            .def_readonly("bytes", &DecodedAudioCache::Stats::bytes)
+            .def_readonly("byteBudget", &DecodedAudioCache::Stats::byteBudget);
+
+    py::class_<DecodedAudioDiskCache::Stats>(m, "DecodedAudioDiskCacheStats")
+            .def_readonly("hits", &DecodedAudioDiskCache::Stats::hits)
+            .def_readonly("misses", &DecodedAudioDiskCache::Stats::misses)
+            .def_readonly("stores", &DecodedAudioDiskCache::Stats::stores)
+            .def_readonly("evictions", &DecodedAudioDiskCache::Stats::evictions)
+            .def_readonly("bytes", &DecodedAudioDiskCache::Stats::bytes)
+            .def_readonly("byteBudget", &DecodedAudioDiskCache::Stats::byteBudget);
+
+    py::class_<tgcalls::GroupEngineContext::Stats>(m, "GroupEngineContextStats")
+            .def_readonly("activeInstances", &tgcalls::GroupEngineContext::Stats::activeInstances)
+            .def_readonly("totalInstances", &tgcalls::GroupEngineContext::Stats::totalInstances)
+            .def_readonly("reusedInstances", &tgcalls::GroupEngineContext::Stats::reusedInstances);
+
+    py::class_<tgcalls::GroupCertificatePool::Stats>(m, "GroupCertificatePoolStats")
+            .def_readonly("readyCertificates", &tgcalls::GroupCertificatePool::Stats::readyCertificates)
+            .def_readonly("generatedCertificates", &tgcalls::GroupCertificatePool::Stats::generatedCertificates)
+            .def_readonly("takenCertificates", &tgcalls::GroupCertificatePool::Stats::takenCertificates)
+            .def_readonly("reusedCertificates", &tgcalls::GroupCertificatePool::Stats::reusedCertificates)
+            .def_readonly("missedCertificates", &tgcalls::GroupCertificatePool::Stats::missedCertificates);
+
+    m.def("configureCertificatePool", [](int poolSize, int64_t reuseIntervalMs) {
+      NativeInstance::sharedCertificatePool()->configure(poolSize, reuseIntervalMs);
+    }, py::arg("poolSize") = 4, py::arg("reuseIntervalMs") = 0);
+    m.def("getCertificatePoolStats", [] {
+      return NativeInstance::sharedCertificatePool()->getStats();
+    });
+
+    py::class_<tgcalls::GroupSharedUdpSockets::Stats>(m, "GroupSharedUdpSocketStats")
+            .def_readonly("sockets", &tgcalls::GroupSharedUdpSockets::Stats::sockets)
+            .def_readonly("callSockets", &tgcalls::GroupSharedUdpSockets::Stats::callSockets)
+            .def_readonly("receivedPackets", &tgcalls::GroupSharedUdpSockets::Stats::receivedPackets)
+            .def_readonly("unroutedPackets", &tgcalls::GroupSharedUdpSockets::Stats::unroutedPackets);
+
+    m.def("configureSharedUdpSockets", [](int maxCallsPerSocket) {
+      NativeInstance::sharedUdpSockets()->configure(maxCallsPerSocket);
+    }, py::arg("maxCallsPerSocket") = 64);
+    m.def("getSharedUdpSocketStats", [] {
+      return NativeInstance::sharedUdpSockets()->getStats();
+    });
+
+    py::class_<tgcalls::SharedNetworkEnvironment::Stats>(m, "SharedNetworkStats")
+            .def_readonly("networkManagers", &tgcalls::SharedNetworkEnvironment::Stats::networkManagers)
+            .def_readonly("networkManagerUsers", &tgcalls::SharedNetworkEnvironment::Stats::networkManagerUsers)
+            .def_readonly("dnsCacheHits", &tgcalls::SharedNetworkEnvironment::Stats::dnsCacheHits)
+            .def_readonly("dnsCacheMisses", &tgcalls::SharedNetworkEnvironment::Stats::dnsCacheMisses)
+            .def_readonly("dnsCacheEntries", &tgcalls::SharedNetworkEnvironment::Stats::dnsCacheEntries);
+
+    m.def("setDnsCacheTtl", &tgcalls::SharedNetworkEnvironment::setDnsCacheTtlMs, py::arg("ttlMs"));
+    m.def("clearDnsCache", &tgcalls::SharedNetworkEnvironment::clearDnsCache);
+    m.def("getSharedNetworkStats", &tgcalls::SharedNetworkEnvironment::stats);
+
+    py::class_<tgcalls::TurnNonceCache::Stats>(m, "TurnNonceCacheStats")
+            .def_readonly("seededAllocations", &tgcalls::TurnNonceCache::Stats::seededAllocations)
+            .def_readonly("acceptedSeeds", &tgcalls::TurnNonceCache::Stats::acceptedSeeds)
+            .def_readonly("rejectedSeeds", &tgcalls::TurnNonceCache::Stats::rejectedSeeds)
+            .def_readonly("entries", &tgcalls::TurnNonceCache::Stats::entries);
+
+    m.def("clearTurnNonceCache", &tgcalls::TurnNonceCache::clear);
+    m.def("getTurnNonceCacheStats", &tgcalls::TurnNonceCache::stats);
+
+    py::class_<tgcalls::GroupSharedAudioEncoder::Stats>(m, "SharedAudioEncoderStats")
+            .def_readonly("calls", &tgcalls::GroupSharedAudioEncoder::Stats::calls)
+            .def_readonly("encodedFrames", &tgcalls::GroupSharedAudioEncoder::Stats::encodedFrames)
+            .def_readonly("sharedFrames", &tgcalls::GroupSharedAudioEncoder::Stats::sharedFrames)
+            .def_readonly("skippedFrames", &tgcalls::GroupSharedAudioEncoder::Stats::skippedFrames);
+
+    py::classh<tgcalls::GroupSharedAudioEncoder>(m, "SharedAudioEncoder")
+            .def(py::init<>())
+            .def("getStats", &tgcalls::GroupSharedAudioEncoder::getStats);
+
+    py::class_<tgcalls::GroupSharedAudioDecoder::Stats>(m, "SharedAudioDecoderStats")
+            .def_readonly("views", &tgcalls::GroupSharedAudioDecoder::Stats::views)
+            .def_readonly("streams", &tgcalls::GroupSharedAudioDecoder::Stats::streams)
+            .def_readonly("decodedFrames", &tgcalls::GroupSharedAudioDecoder::Stats::decodedFrames)
+            .def_readonly("sharedFrames", &tgcalls::GroupSharedAudioDecoder::Stats::sharedFrames)
+            .def_readonly("privateFrames", &tgcalls::GroupSharedAudioDecoder::Stats::privateFrames);
+
+    py::classh<tgcalls::GroupSharedAudioDecoder>(m, "SharedAudioDecoder")
+            .def(py::init<>())
+            .def("getStats", &tgcalls::GroupSharedAudioDecoder::getStats);
+
+    py::class_<tgcalls::GroupAudioBridge::Stats>(m, "AudioBridgeStats")
+            .def_readonly("receivedPackets", &tgcalls::GroupAudioBridge::Stats::receivedPackets)
+            .def_readonly("forwardedPackets", &tgcalls::GroupAudioBridge::Stats::forwardedPackets)
+            .def_readonly("droppedPackets", &tgcalls::GroupAudioBridge::Stats::droppedPackets)
+            .def_readonly("underruns", &tgcalls::GroupAudioBridge::Stats::underruns)
+            .def_readonly("queuedPackets", &tgcalls::GroupAudioBridge::Stats::queuedPackets);
+
+    py::classh<tgcalls::GroupAudioBridge>(m, "AudioBridge")
+            .def(py::init<int>(), py::arg("startPackets") = tgcalls::GroupAudioBridge::kDefaultStartPackets)
+            .def_property("sourceSsrc", &tgcalls::GroupAudioBridge::sourceSsrc, &tgcalls::GroupAudioBridge::setSourceSsrc)
+            .def("getStats", &tgcalls::GroupAudioBridge::getStats);
+
+    py::classh<OggOpusFileSource>(m, "OggOpusFileSource")
+            .def_static("open", [](const std::string &path, bool loop) {
+              auto source = OggOpusFileSource::Open(path, loop);
+              if (!source) {
+                throw std::runtime_error("cannot read Ogg Opus file " + path);
+              }
+              return source;
+            }, py::arg("path"), py::arg("loop") = false)
+            .def_property_readonly("positionMs", &OggOpusFileSource::positionMs)
+            .def_property_readonly("durationMs", &OggOpusFileSource::durationMs)
+            .def_property_readonly("channels", &OggOpusFileSource::channels)
+            .def_property_readonly("sentPackets", &OggOpusFileSource::sentPackets)
+            .def_property_readonly("finished", &OggOpusFileSource::finished);
+
+    py::class_<tgcalls::GroupInstanceCustomImpl::StartupLatency>(m, "GroupStartupLatency")
+            .def_readonly("engineReadyMs", &tgcalls::GroupInstanceCustomImpl::StartupLatency::engineReadyMs)
+            .def_readonly("joinPayloadMs", &tgcalls::GroupInstanceCustomImpl::StartupLatency::joinPayloadMs)
+            .def_readonly("firstRtpMs", &tgcalls::GroupInstanceCustomImpl::StartupLatency::firstRtpMs);
+
+    // Pickles, so it can be sent to the node taking the call over.
+    py::class_<GroupCallMigrationState>(m, "GroupCallMigrationState")
+            .def(py::init<>())
+            .def_property("audioSsrc", [](const GroupCallMigrationState &e) {
+              return e.call.outgoingAudioSsrc;
+            }, [](GroupCallMigrationState &e, uint32_t ssrc) {
+              e.call.outgoingAudioSsrc = ssrc;
+            })
+            .def_property("participantSsrcs", [](const GroupCallMigrationState &e) {
+              return e.call.incomingAudioSsrcs;
+            }, [](GroupCallMigrationState &e, std::vector<uint32_t> ssrcs) {
+              e.call.incomingAudioSsrcs = std::move(ssrcs);
+            })
+            .def_property("volumes", [](const GroupCallMigrationState &e) {
+              return e.call.volumes;
+            }, [](GroupCallMigrationState &e, std::vector<std::pair<uint32_t, double>> volumes) {
+              e.call.volumes = std::move(volumes);
+            })
+            .def_property("broadcastTimestampMs", [](const GroupCallMigrationState &e) {
+              return e.call.nextBroadcastTimestampMilliseconds;
+            }, [](GroupCallMigrationState &e, int64_t timestampMs) {
+              e.call.nextBroadcastTimestampMilliseconds = timestampMs;
+            })
+            .def_property("joinResponsePayload", [](const GroupCallMigrationState &e) {
+              return e.call.joinResponsePayload;
+            }, [](GroupCallMigrationState &e, std::string payload) {
+              e.call.joinResponsePayload = std::move(payload);
+            })
+            .def_readwrite("inputPositionMs", &GroupCallMigrationState::inputPositionMs)
+            .def(py::pickle([](const GroupCallMigrationState &e) {
+              return py::make_tuple(e.call.outgoingAudioSsrc, e.call.incomingAudioSsrcs, e.call.volumes,
+                                    e.call.nextBroadcastTimestampMilliseconds, e.call.joinResponsePayload,
+                                    e.inputPositionMs);
+            }, [](const py::tuple &t) {
+              if (t.size() != 6) {
+                throw std::runtime_error("invalid GroupCallMigrationState");
+              }
+              GroupCallMigrationState state;
+              state.call.outgoingAudioSsrc = t[0].cast<uint32_t>();
+              state.call.incomingAudioSsrcs = t[1].cast<std::vector<uint32_t>>();
+              state.call.volumes = t[2].cast<std::vector<std::pair<uint32_t, double>>>();
+              state.call.nextBroadcastTimestampMilliseconds = t[3].cast<int64_t>();
+              state.call.joinResponsePayload = t[4].cast<std::string>();
+              state.inputPositionMs = t[5].cast<int64_t>();
+              return state;
+            }));
+
+    py::class_<tgcalls::GroupInstanceCustomImpl::ReconnectStats>(m, "GroupReconnectStats")
+            .def_readonly("disconnects", &tgcalls::GroupInstanceCustomImpl::ReconnectStats::disconnects)
+            .def_readonly("cachedPairReconnects", &tgcalls::GroupInstanceCustomImpl::ReconnectStats::cachedPairReconnects)
+            .def_readonly("otherPairReconnects", &tgcalls::GroupInstanceCustomImpl::ReconnectStats::otherPairReconnects)
+            .def_readonly("fastReconnectsExpired", &tgcalls::GroupInstanceCustomImpl::ReconnectStats::fastReconnectsExpired)
+            .def_readonly("bucketBoundsMs", &tgcalls::GroupInstanceCustomImpl::ReconnectStats::bucketBoundsMs)
+            .def_readonly("reconnectTimeHistogram", &tgcalls::GroupInstanceCustomImpl::ReconnectStats::reconnectTimeHistogram);
+
+    py::class_<tgcalls::GroupInstanceCustomImpl::NoiseSuppressionStats>(m, "GroupNoiseSuppressionStats")
+            .def_readonly("isEnabled", &tgcalls::GroupInstanceCustomImpl::NoiseSuppressionStats::isEnabled)
+            .def_readonly("isAvailable", &tgcalls::GroupInstanceCustomImpl::NoiseSuppressionStats::isAvailable)
+            .def_readonly("processedFrames", &tgcalls::GroupInstanceCustomImpl::NoiseSuppressionStats::processedFrames)
+            .def_readonly("totalProcessingTimeUs", &tgcalls::GroupInstanceCustomImpl::NoiseSuppressionStats::totalProcessingTimeUs)
+            .def_readonly("maxProcessingTimeUs", &tgcalls::GroupInstanceCustomImpl::NoiseSuppressionStats::maxProcessingTimeUs)
+            .def_readonly("averageProcessingTimeUs", &tgcalls::GroupInstanceCustomImpl::NoiseSuppressionStats::averageProcessingTimeUs);
+
+    py::class_<tgcalls::GroupInstanceCustomImpl::AudioMixerStats>(m, "GroupAudioMixerStats")
+            .def_readonly("isEnabled", &tgcalls::GroupInstanceCustomImpl::AudioMixerStats::isEnabled)
+            .def_readonly("decodedSources", &tgcalls::GroupInstanceCustomImpl::AudioMixerStats::decodedSources)
+            .def_readonly("mixedSources", &tgcalls::GroupInstanceCustomImpl::AudioMixerStats::mixedSources)
+            .def_readonly("mixes", &tgcalls::GroupInstanceCustomImpl::AudioMixerStats::mixes)
+            .def_readonly("decodedFrames", &tgcalls::GroupInstanceCustomImpl::AudioMixerStats::decodedFrames)
+            .def_readonly("mixedFrames", &tgcalls::GroupInstanceCustomImpl::AudioMixerStats::mixedFrames)
+            .def_readonly("skippedFrames", &tgcalls::GroupInstanceCustomImpl::AudioMixerStats::skippedFrames);
+
+    py::class_<tgcalls::GroupInstanceCustomImpl::MediaStats>(m, "GroupMediaStats")
+            .def_readonly("sendBandwidthBps", &tgcalls::GroupInstanceCustomImpl::MediaStats::sendBandwidthBps)
+            .def_readonly("receiveBandwidthBps", &tgcalls::GroupInstanceCustomImpl::MediaStats::receiveBandwidthBps)
+            .def_readonly("pacerDelayMs", &tgcalls::GroupInstanceCustomImpl::MediaStats::pacerDelayMs)
+            .def_readonly("rttMs", &tgcalls::GroupInstanceCustomImpl::MediaStats::rttMs)
+            .def_readonly("outgoingAudioBytesSent", &tgcalls::GroupInstanceCustomImpl::MediaStats::outgoingAudioBytesSent)
+            .def_readonly("outgoingAudioPacketsSent", &tgcalls::GroupInstanceCustomImpl::MediaStats::outgoingAudioPacketsSent)
+            .def_readonly("outgoingAudioPacketsLost", &tgcalls::GroupInstanceCustomImpl::MediaStats::outgoingAudioPacketsLost)
+            .def_readonly("outgoingAudioFractionLost", &tgcalls::GroupInstanceCustomImpl::MediaStats::outgoingAudioFractionLost)
+            .def_readonly("incomingAudioSsrcs", &tgcalls::GroupInstanceCustomImpl::MediaStats::incomingAudioSsrcs)
+            .def_readonly("incomingAudioPacketsReceived", &tgcalls::GroupInstanceCustomImpl::MediaStats::incomingAudioPacketsReceived)
+            .def_readonly("incomingAudioPacketsLost", &tgcalls::GroupInstanceCustomImpl::MediaStats::incomingAudioPacketsLost)
+            .def_readonly("incomingAudioJitterMs", &tgcalls::GroupInstanceCustomImpl::MediaStats::incomingAudioJitterMs)
+            .def_readonly("incomingAudioJitterBufferDelayMs", &tgcalls::GroupInstanceCustomImpl::MediaStats::incomingAudioJitterBufferDelayMs)
+            .def_readonly("incomingAudioExpandRate", &tgcalls::GroupInstanceCustomImpl::MediaStats::incomingAudioExpandRate)
+            .def_readonly("incomingAudioSpeechExpandRate", &tgcalls::GroupInstanceCustomImpl::MediaStats::incomingAudioSpeechExpandRate)
+            .def_readonly("incomingAudioConcealedSamples", &tgcalls::GroupInstanceCustomImpl::MediaStats::incomingAudioConcealedSamples)
+            .def_readonly("incomingAudioConcealmentEvents", &tgcalls::GroupInstanceCustomImpl::MediaStats::incomingAudioConcealmentEvents)
+            .def_readonly("incomingAudioTotalSamples", &tgcalls::GroupInstanceCustomImpl::MediaStats::incomingAudioTotalSamples);
+
+    py::class_<tgcalls::GroupInstanceCustomImpl::MemoryUsage>(m, "GroupMemoryUsage")
+            .def_readonly("externalAudioBytes", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::externalAudioBytes)
+            .def_readonly("broadcastPartBytes", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::broadcastPartBytes)
+            .def_readonly("missingSsrcPacketBytes", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::missingSsrcPacketBytes)
+            .def_readonly("ssrcTableBytes", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::ssrcTableBytes)
+            .def_readonly("totalBytes", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::totalBytes)
+            .def_readonly("arenaBytes", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::arenaBytes)
+            .def_readonly("audioLevelEntries", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::audioLevelEntries)
+            .def_readonly("reportedLevelEntries", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::reportedLevelEntries)
+            .def_readonly("channelEntries", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::channelEntries)
+            .def_readonly("volumeEntries", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::volumeEntries)
+            .def_readonly("broadcastSequenceEntries", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::broadcastSequenceEntries)
+            .def_readonly("incomingAudioChannels", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::incomingAudioChannels)
+            .def_readonly("pooledIncomingAudioChannels", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::pooledIncomingAudioChannels)
+            .def_readonly("directBroadcastChannels", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::directBroadcastChannels)
+            .def_readonly("incomingVideoChannels", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::incomingVideoChannels)
+            .def_readonly("incomingAudioBufferedMs", &tgcalls::GroupInstanceCustomImpl::MemoryUsage::incomingAudioBufferedMs);
+
+    py::class_<tgcalls::LatencyTrace::StageSummary>(m, "LatencyStage")
+            .def_readonly("name", &tgcalls::LatencyTrace::StageSummary::name)
+            .def_readonly("count", &tgcalls::LatencyTrace::StageSummary::count)
+            .def_readonly("p50Us", &tgcalls::LatencyTrace::StageSummary::p50Us)
+            .def_readonly("p99Us", &tgcalls::LatencyTrace::StageSummary::p99Us)
+            .def_readonly("maxUs", &tgcalls::LatencyTrace::StageSummary::maxUs);
+
+    py::class_<tgcalls::CallStatsSnapshot>(m, "CallStatsSnapshot")
+            .def_readonly("timestampMs", &tgcalls::CallStatsSnapshot::timestampMs)
+            .def_readonly("sendBitrateBps", &tgcalls::CallStatsSnapshot::sendBitrateBps)
+            .def_readonly("receiveBitrateBps", &tgcalls::CallStatsSnapshot::receiveBitrateBps)
+            .def_readonly("rttMs", &tgcalls::CallStatsSnapshot::rttMs)
+            .def_readonly("outgoingPacketsLost", &tgcalls::CallStatsSnapshot::outgoingPacketsLost)
+            .def_readonly("outgoingFractionLost", &tgcalls::CallStatsSnapshot::outgoingFractionLost)
+            .def_readonly("incomingAudioStreams", &tgcalls::CallStatsSnapshot::incomingAudioStreams)
+            .def_readonly("incomingPacketsReceived", &tgcalls::CallStatsSnapshot::incomingPacketsReceived)
+            .def_readonly("incomingPacketsLost", &tgcalls::CallStatsSnapshot::incomingPacketsLost)
+            .def_readonly("incomingJitterMs", &tgcalls::CallStatsSnapshot::incomingJitterMs)
+            .def_readonly("jitterBufferDelayMs", &tgcalls::CallStatsSnapshot::jitterBufferDelayMs)
+            .def_readonly("videoDecodeMs", &tgcalls::CallStatsSnapshot::videoDecodeMs);
+
+    m.def("configureLogging", [](int minSeverity, int64_t maxFileBytes, int maxRotatedFiles, std::string sharedLogPath) {
+      tgcalls::LogSinkOptions options;
+      options.minSeverity = static_cast<rtc::LoggingSeverity>(std::max(0, std::min(minSeverity, int(rtc::LS_NONE))));
+      options.maxFileBytes = maxFileBytes;
+      options.maxRotatedFiles = std::max(0, maxRotatedFiles);
+      options.sharedLogPath = std::move(sharedLogPath);
+      tgcalls::LogSinkImpl::SetOptions(options);
+    }, py::arg("minSeverity") = int(rtc::LS_INFO), py::arg("maxFileBytes") = 0, py::arg("maxRotatedFiles") = 3,
+       py::arg("sharedLogPath") = "");
+
+    m.def("setThreadPoolSize", [](size_t size) {
+      tgcalls::Threads::setPoolSize(size);
+    }, py::arg("size"));
+    m.def("getThreadPoolInstanceCounts", [] {
+      return tgcalls::Threads::getPoolInstanceCounts();
+    });
+
+    py::enum_<tgcalls::GroupVideoEncoderConfig::Complexity>(m, "VideoEncoderComplexity")
+            .value("Normal", tgcalls::GroupVideoEncoderConfig::Complexity::Normal)
+            .value("High", tgcalls::GroupVideoEncoderConfig::Complexity::High)
+            .value("Higher", tgcalls::GroupVideoEncoderConfig::Complexity::Higher)
+            .value("Max", tgcalls::GroupVideoEncoderConfig::Complexity::Max);
+
+    py::enum_<tgcalls::CpuAffinityMode>(m, "ThreadAffinityMode")
+            .value("Off", tgcalls::CpuAffinityMode::Off)
+            .value("PhysicalCore", tgcalls::CpuAffinityMode::PhysicalCore)
+            .value("NumaNode", tgcalls::CpuAffinityMode::NumaNode);
+    m.def("setThreadAffinity", [](tgcalls::CpuAffinityMode mode) {
+      tgcalls::Threads::setCpuAffinity(mode);
+    }, py::arg("mode"));
+
+    py::enum_<tgcalls::ThreadsMode>(m, "ThreadsMode")
+            .value("Pooled", tgcalls::ThreadsMode::Pooled)
+            .value("Strands", tgcalls::ThreadsMode::Strands);
+    m.def("setThreadsMode", [](tgcalls::ThreadsMode mode) {
+      tgcalls::Threads::setMode(mode);
+    }, py::arg("mode"));
+
+    py::enum_<tgcalls::ThreadRole>(m, "ThreadRole")
+            .value("AudioDevice", tgcalls::ThreadRole::AudioDevice)
+            .value("AudioPump", tgcalls::ThreadRole::AudioPump)
+            .value("Network", tgcalls::ThreadRole::Network)
+            .value("Media", tgcalls::ThreadRole::Media)
+            .value("Worker", tgcalls::ThreadRole::Worker)
+            .value("Strand", tgcalls::ThreadRole::Strand);
+
+    py::class_<tgcalls::ThreadSchedule> threadSchedule(m, "ThreadSchedule");
+
+    py::enum_<tgcalls::ThreadSchedule::Policy>(threadSchedule, "Policy")
+            .value("Default", tgcalls::ThreadSchedule::Policy::Default)
+            .value("Other", tgcalls::ThreadSchedule::Policy::Other)
+            .value("Fifo", tgcalls::ThreadSchedule::Policy::Fifo);
+
+    threadSchedule
+            .def(py::init<>())
+            .def_readwrite("policy", &tgcalls::ThreadSchedule::policy)
+            .def_readwrite("fifoPriority", &tgcalls::ThreadSchedule::fifoPriority)
+            .def_readwrite("nice", &tgcalls::ThreadSchedule::nice);
+
+    // Scheduling policy per kind of thread; the pooled threads change at
+    // once, the others as they start.
+    m.def("setThreadSchedule", [](tgcalls::ThreadRole role, const tgcalls::ThreadSchedule &schedule) {
+      tgcalls::ThreadScheduling::set(role, schedule);
+    }, py::arg("role"), py::arg("schedule"));
+    m.def("getThreadSchedule", [](tgcalls::ThreadRole role) {
+      return tgcalls::ThreadScheduling::get(role);
+    }, py::arg("role"));
+
+    m.def("getSharedEngineContextStats", [] {
+      return NativeInstance::sharedEngineContext()->getStats();
+    });
+
+    py::class_<JoinAdmissionStats>(m, "JoinAdmissionStats")
+            .def_readonly("waiting", &JoinAdmissionStats::waiting)
+            .def_readonly("joining", &JoinAdmissionStats::joining)
+            .def_readonly("admitted", &JoinAdmissionStats::admitted)
+            .def_readonly("averageWaitMs", &JoinAdmissionStats::averageWaitMs)
+            .def_readonly("maxWaitMs", &JoinAdmissionStats::maxWaitMs);
+
+    // Group calls joining at once per network thread; startGroupCall() and
+    // prewarmGroupCalls() wait past it. 0 for no limit.
+    m.def("setJoinAdmissionLimit", [](size_t limit) {
+      JoinAdmission::Get().SetLimit(limit);
+    }, py::arg("limit"));
+    m.def("getJoinAdmissionStats", [] {
+      return JoinAdmission::Get().stats();
+    });
+    m.def("resetJoinAdmissionStats", [] {
+      JoinAdmission::Get().ResetStats();
+    });
+
+    // Hot path counters of every call in the process, in the Prometheus text
+    // exposition format.
+    m.def("getHotPathCounters", [] {
+      return tgcalls::HotPathCounters::snapshot();
+    });
+
+    py::class_<tgcalls::InvokeSiteStats>(m, "InvokeSiteStats")
+            .def_readonly("location", &tgcalls::InvokeSiteStats::location)
+            .def_readonly("function", &tgcalls::InvokeSiteStats::function)
+            .def_readonly("thread", &tgcalls::InvokeSiteStats::thread)
+            .def_readonly("invokes", &tgcalls::InvokeSiteStats::invokes)
+            .def_readonly("totalBlockedUs", &tgcalls::InvokeSiteStats::totalBlockedUs)
+            .def_readonly("maxBlockedUs", &tgcalls::InvokeSiteStats::maxBlockedUs);
+
+    // Time spent blocked in invokes onto the pooled threads, per call site,
+    // worst first. Off until enabled.
+    m.def("setInvokeAuditEnabled", [](bool enabled) {
+      tgcalls::InvokeAudit::setEnabled(enabled);
+    }, py::arg("enabled"));
+    m.def("getInvokeAudit", [] {
+      return tgcalls::InvokeAudit::sites();
+    });
+    m.def("resetInvokeAudit", [] {
+      tgcalls::InvokeAudit::reset();
+    });
+
+    py::class_<tgcalls::CpuAccount::Usage>(m, "CpuUsage")
+            .def_readonly("networkUs", &tgcalls::CpuAccount::Usage::networkUs)
+            .def_readonly("mediaUs", &tgcalls::CpuAccount::Usage::mediaUs)
+            .def_readonly("workerUs", &tgcalls::CpuAccount::Usage::workerUs)
+            .def_readonly("audioUs", &tgcalls::CpuAccount::Usage::audioUs)
+            .def_property_readonly("totalUs", &tgcalls::CpuAccount::Usage::totalUs);
+
+    // Thread CPU time per group call, see NativeInstance.getCpuUsage(). Off
+    // until enabled; calls started before then are charged only in part.
+    m.def("setCpuAccountingEnabled", [](bool enabled) {
+      tgcalls::CpuAccounting::setEnabled(enabled);
+    }, py::arg("enabled"));
+    m.def("isCpuAccountingEnabled", [] {
+      return tgcalls::CpuAccounting::isEnabled();
+    });
+
+    using OverloadController = tgcalls::OverloadController;
+
+    py::enum_<OverloadController::Level>(m, "OverloadLevel")
+            .value("Normal", OverloadController::Level::Normal)
+            .value("FewerAudioStreams", OverloadController::Level::FewerAudioStreams)
+            .value("LowerAudioComplexity", OverloadController::Level::LowerAudioComplexity)
+            .value("LowerVideoQuality", OverloadController::Level::LowerVideoQuality)
+            .value("WiderJitterBuffers", OverloadController::Level::WiderJitterBuffers)
+            .value("RefuseJoins", OverloadController::Level::RefuseJoins);
+
+    py::class_<OverloadController::Config>(m, "OverloadConfig")
+            .def(py::init<>())
+            .def_readwrite("checkIntervalMs", &OverloadController::Config::checkIntervalMs)
+            .def_readwrite("maxThreadLagMs", &OverloadController::Config::maxThreadLagMs)
+            .def_readwrite("maxAudioTicksBehind", &OverloadController::Config::maxAudioTicksBehind)
+            .def_readwrite("escalateAfterChecks", &OverloadController::Config::escalateAfterChecks)
+            .def_readwrite("recoverAfterChecks", &OverloadController::Config::recoverAfterChecks)
+            .def_readwrite("maxLevel", &OverloadController::Config::maxLevel)
+            .def_readwrite("maxDecodedIncomingAudioStreams", &OverloadController::Config::maxDecodedIncomingAudioStreams)
+            .def_readwrite("audioComplexity", &OverloadController::Config::audioComplexity)
+            .def_readwrite("jitterBufferMinDelayMs", &OverloadController::Config::jitterBufferMinDelayMs);
+
+    py::class_<OverloadController::Stats>(m, "OverloadStats")
+            .def_readonly("level", &OverloadController::Stats::level)
+            .def_readonly("threadLagMs", &OverloadController::Stats::threadLagMs)
+            .def_readonly("audioTicksBehind", &OverloadController::Stats::audioTicksBehind)
+            .def_readonly("checks", &OverloadController::Stats::checks)
+            .def_readonly("escalations", &OverloadController::Stats::escalations)
+            .def_readonly("recoveries", &OverloadController::Stats::recoveries)
+            .def_readonly("refusedJoins", &OverloadController::Stats::refusedJoins);
+
+    // Step by step degradation of every group call while the pooled threads
+    // or the audio ticks fall behind; startGroupCall() raises at the last
+    // level. Off until enabled.
+    m.def("setOverloadControlEnabled", [](bool enabled) {
+      OverloadController::setEnabled(enabled);
+    }, py::arg("enabled"), py::call_guard<py::gil_scoped_release>());
+    m.def("isOverloadControlEnabled", [] {
+      return OverloadController::isEnabled();
+    });
+    m.def("configureOverloadControl", [](const OverloadController::Config &config) {
+      OverloadController::configure(config);
+    }, py::arg("config"));
+    m.def("getOverloadConfig", [] {
+      return OverloadController::config();
+    });
+    m.def("setOverloadLevel", [](OverloadController::Level level) {
+      OverloadController::setLevel(level);
+    }, py::arg("level"));
+    m.def("getOverloadLevel", [] {
+      return OverloadController::level();
+    });
+    m.def("getOverloadStats", [] {
+      return OverloadController::stats();
+    });
+
+    py::class_<tgcalls::BroadcastPartCache::Stats>(m, "BroadcastPartCacheStats")
+            .def_readonly("requests", &tgcalls::BroadcastPartCache::Stats::requests)
+            .def_readonly("fetches", &tgcalls::BroadcastPartCache::Stats::fetches)
+            .def_readonly("decodes", &tgcalls::BroadcastPartCache::Stats::decodes)
+            .def_readonly("sharedDecodes", &tgcalls::BroadcastPartCache::Stats::sharedDecodes)
+            .def_readonly("cachedParts", &tgcalls::BroadcastPartCache::Stats::cachedParts);
+
+    // Broadcast parts shared between calls with the same cache key, see
+    // NativeInstance.setBroadcastPartCacheKey().
+    m.def("getBroadcastPartCacheStats", [] {
+      return tgcalls::BroadcastPartCache::stats();
+    });
+
+    // Slices of the media, audio device and Python callback threads, for
+    // chrome://tracing or ui.perfetto.dev. Off until started.
+    m.def("startTrace", [](size_t eventsPerThread) {
+      tgcalls::TraceRecorder::start(eventsPerThread);
+    }, py::arg("eventsPerThread") = tgcalls::TraceRecorder::kDefaultEventsPerThread);
+    m.def("stopTrace", [] {
+      tgcalls::TraceRecorder::stop();
+    });
+    m.def("exportTrace", [] {
+      return tgcalls::TraceRecorder::exportJson();
+    });
+
+    // Virtual time for soak tests: 0 stops it but for advanceSimulatedTime(),
+    // which returns once the audio devices have played the ticks due.
+    m.def("setSimulatedTimeSpeed", [](double speed) {
+      tgcalls::SimulatedClock::setSpeed(speed);
+    }, py::arg("speed"));
+    m.def("advanceSimulatedTime", [](int64_t ms) {
+      tgcalls::SimulatedClock::advance(ms * 1000000);
+    }, py::arg("ms"), py::call_guard<py::gil_scoped_release>());
+    m.def("getSimulatedTimeMs", [] {
+      return tgcalls::SimulatedClock::nowNanos() / 1000000;
+    });
+
+    m.def("getDecodedAudioCacheStats", [] {
+      return DecodedAudioCache::Shared()->GetStats();
+    });
+    m.def("setDecodedAudioCacheByteBudget", [](size_t byteBudget) {
+      DecodedAudioCache::Shared()->SetByteBudget(byteBudget);
+    });
+    m.def("clearDecodedAudioCache", [] {
+      DecodedAudioCache::Shared()->Clear();
+    });
+    // Keeps decoded compressed inputs in |directory| across restarts; an
+    // empty one turns that off.
+    m.def("setDecodedAudioDiskCache", [](const std::string &directory, size_t byteBudget) {
+      DecodedAudioDiskCache::Shared()->SetDirectory(directory, byteBudget);
+    }, py::arg("directory"), py::arg("byteBudget") = DecodedAudioDiskCache::kDefaultByteBudget,
+       py::call_guard<py::gil_scoped_release>());
+    m.def("getDecodedAudioDiskCacheStats", [] {
+      return DecodedAudioDiskCache::Shared()->GetStats();
+    });
+
+    py::class_<SrtpBenchmarkResult>(m, "SrtpBenchmarkResult")
+            .def_readonly("suite", &SrtpBenchmarkResult::suite)
+            .def_readonly("packets", &SrtpBenchmarkResult::packets)
+            .def_readonly("protectPacketsPerSecond", &SrtpBenchmarkResult::protectPacketsPerSecond)
+            .def_readonly("unprotectPacketsPerSecond", &SrtpBenchmarkResult::unprotectPacketsPerSecond);
+
+    m.def("benchmarkSrtp", &RunSrtpBenchmark, py::arg("packets") = 200000, py::arg("payloadSize") = 160,
+          py::call_guard<py::gil_scoped_release>());
+
+    py::class_<TransportCryptoBenchmarkResult>(m, "TransportCryptoBenchmarkResult")
+            .def_readonly("packets", &TransportCryptoBenchmarkResult::packets)
+            .def_readonly("legacyCtrPacketsPerSecond", &TransportCryptoBenchmarkResult::legacyCtrPacketsPerSecond)
+            .def_readonly("evpCtrPacketsPerSecond", &TransportCryptoBenchmarkResult::evpCtrPacketsPerSecond)
+            .def_readonly("encryptPacketsPerSecond", &TransportCryptoBenchmarkResult::encryptPacketsPerSecond)
+            .def_readonly("decryptPacketsPerSecond", &TransportCryptoBenchmarkResult::decryptPacketsPerSecond);
+
+    m.def("benchmarkTransportCrypto", &RunTransportCryptoBenchmark, py::arg("packets") = 200000, py::arg("payloadSize") = 160,
+          py::call_guard<py::gil_scoped_release>());
+
+    py::class_<JsonBenchmarkResult>(m, "JsonBenchmarkResult")
+            .def_readonly("name", &JsonBenchmarkResult::name)
+            .def_readonly("iterations", &JsonBenchmarkResult::iterations)
+            .def_readonly("documentPerSecond", &JsonBenchmarkResult::documentPerSecond)
+            .def_readonly("streamingPerSecond", &JsonBenchmarkResult::streamingPerSecond);
+
+    m.def("benchmarkJson", &RunJsonBenchmark, py::arg("iterations") = 100000, py::arg("endpoints") = 25,
+          py::call_guard<py::gil_scoped_release>());
+
+    py::class_<SignalingBenchmarkResult>(m, "SignalingBenchmarkResult")
+            .def_readonly("name", &SignalingBenchmarkResult::name)
+            .def_readonly("iterations", &SignalingBenchmarkResult::iterations)
+            .def_readonly("jsonBytes", &SignalingBenchmarkResult::jsonBytes)
+            .def_readonly("binaryBytes", &SignalingBenchmarkResult::binaryBytes)
+            .def_readonly("jsonRoundTripsPerSecond", &SignalingBenchmarkResult::jsonRoundTripsPerSecond)
+            .def_readonly("binaryRoundTripsPerSecond", &SignalingBenchmarkResult::binaryRoundTripsPerSecond);
+
+    m.def("benchmarkSignaling", &RunSignalingBenchmark, py::arg("iterations") = 10000,
+          py::call_guard<py::gil_scoped_release>());
+
+    py::class_<HotPathBenchmarkResult>(m, "HotPathBenchmarkResult")
+            .def_readonly("name", &HotPathBenchmarkResult::name)
+            .def_readonly("operations", &HotPathBenchmarkResult::operations)
+            .def_readonly("operationsPerSecond", &HotPathBenchmarkResult::operationsPerSecond)
+            .def_readonly("nanosecondsPerOperation", &HotPathBenchmarkResult::nanosecondsPerOperation);
+
+    m.def("benchmarkHotPaths", &RunHotPathBenchmark, py::arg("iterations") = 100000, py::arg("ssrcs") = 1000,
+          py::call_guard<py::gil_scoped_release>());
+    m.def("benchmarkStreamingPart", &RunStreamingPartBenchmark, py::arg("part"), py::arg("repetitions") = 10,
+          py::call_guard<py::gil_scoped_release>());
+
+    py::class_<tgcalls::NetworkImpairment>(m, "NetworkImpairment")
+            .def(py::init<>())
+            .def_readwrite("lossPercent", &tgcalls::NetworkImpairment::lossPercent)
+            .def_readwrite("averageBurstLossLength", &tgcalls::NetworkImpairment::averageBurstLossLength)
+            .def_readwrite("delayMs", &tgcalls::NetworkImpairment::delayMs)
+            .def_readwrite("jitterMs", &tgcalls::NetworkImpairment::jitterMs)
+            .def_readwrite("allowReordering", &tgcalls::NetworkImpairment::allowReordering)
+            .def_readwrite("bandwidthKbps", &tgcalls::NetworkImpairment::bandwidthKbps)
+            .def_readwrite("queueLengthPackets", &tgcalls::NetworkImpairment::queueLengthPackets)
+            .def_readwrite("seed", &tgcalls::NetworkImpairment::seed);
+
+    py::class_<LoadTestConfig>(m, "LoadTestConfig")
+            .def(py::init<>())
+            .def_readwrite("calls", &LoadTestConfig::calls)
+            .def_readwrite("useLoopbackSfu", &LoadTestConfig::useLoopbackSfu)
+            .def_readwrite("speakers", &LoadTestConfig::speakers)
+            .def_readwrite("warmupMs", &LoadTestConfig::warmupMs)
+            .def_readwrite("durationMs", &LoadTestConfig::durationMs)
+            .def_readwrite("broadcastParts", &LoadTestConfig::broadcastParts)
+            .def_readwrite("partDurationMs", &LoadTestConfig::partDurationMs)
+            .def_readwrite("speakerChurnIntervalMs", &LoadTestConfig::speakerChurnIntervalMs)
+            .def_readwrite("inputFilename", &LoadTestConfig::inputFilename)
+            .def_readwrite("useSharedAudioClock", &LoadTestConfig::useSharedAudioClock)
+            .def_readwrite("uplinkImpairment", &LoadTestConfig::uplinkImpairment)
+            .def_readwrite("downlinkImpairment", &LoadTestConfig::downlinkImpairment);
+
+    py::class_<LoadTestResult>(m, "LoadTestResult")
+            .def_readonly("calls", &LoadTestResult::calls)
+            .def_readonly("measuredSeconds", &LoadTestResult::measuredSeconds)
+            .def_readonly("cpuPercentPerCall", &LoadTestResult::cpuPercentPerCall)
+            .def_readonly("voluntaryContextSwitchesPerSecond", &LoadTestResult::voluntaryContextSwitchesPerSecond)
+            .def_readonly("involuntaryContextSwitchesPerSecond", &LoadTestResult::involuntaryContextSwitchesPerSecond)
+            .def_readonly("connectedCalls", &LoadTestResult::connectedCalls)
+            .def_readonly("meanConnectMs", &LoadTestResult::meanConnectMs)
+            .def_readonly("residentBytesPerCall", &LoadTestResult::residentBytesPerCall)
+            .def_readonly("packetsPerSecond", &LoadTestResult::packetsPerSecond)
+            .def_readonly("threadHopsPerSecond", &LoadTestResult::threadHopsPerSecond)
+            .def_readonly("concealmentEvents", &LoadTestResult::concealmentEvents)
+            .def_readonly("lateAudioTicks", &LoadTestResult::lateAudioTicks)
+            .def_readonly("droppedAudioTicks", &LoadTestResult::droppedAudioTicks)
+            .def_readonly("meanJitterBufferDelayMs", &LoadTestResult::meanJitterBufferDelayMs)
+            .def_readonly("meanImpairmentDelayMs", &LoadTestResult::meanImpairmentDelayMs)
+            .def_readonly("impairmentLostPackets", &LoadTestResult::impairmentLostPackets)
+            .def_readonly("impairmentQueueDroppedPackets", &LoadTestResult::impairmentQueueDroppedPackets);
+
+    m.def("runLoadTest", &RunLoadTest, py::arg("config"), py::call_guard<py::gil_scoped_release>());
+    // Writes the PGO profile gathered so far, in an instrumented build only;
+    // see cmake/release_perf.cmake.
+    m.def("writeProfile", [] {
+#ifdef TGCALLS_PGO_GENERATE
+#ifdef __clang__
+      return __llvm_profile_write_file() == 0;
+#else
+      __gcov_dump();
+      return true;
+#endif
+#else
+      return false;
+#endif
+    });
+
+    py::class_<tgcalls::LoopbackSfu::Stats>(m, "LoopbackSfuStats")
+            .def_readonly("endpoints", &tgcalls::LoopbackSfu::Stats::endpoints)
+            .def_readonly("connectedEndpoints", &tgcalls::LoopbackSfu::Stats::connectedEndpoints)
+            .def_readonly("receivedPackets", &tgcalls::LoopbackSfu::Stats::receivedPackets)
+            .def_readonly("receivedBytes", &tgcalls::LoopbackSfu::Stats::receivedBytes)
+            .def_readonly("forwardedPackets", &tgcalls::LoopbackSfu::Stats::forwardedPackets)
+            .def_readonly("dataChannelMessages", &tgcalls::LoopbackSfu::Stats::dataChannelMessages)
+            .def_readonly("impairedPackets", &tgcalls::LoopbackSfu::Stats::impairedPackets)
+            .def_readonly("meanImpairmentDelayMs", &tgcalls::LoopbackSfu::Stats::meanImpairmentDelayMs)
+            .def_readonly("impairmentLostPackets", &tgcalls::LoopbackSfu::Stats::impairmentLostPackets)
+            .def_readonly("impairmentQueueDroppedPackets", &tgcalls::LoopbackSfu::Stats::impairmentQueueDroppedPackets);
+
+    py::class_<tgcalls::LoopbackSfu>(m, "LoopbackSfu")
+            .def(py::init([]() {
+              return std::make_unique<tgcalls::LoopbackSfu>(tgcalls::Threads::getThreads());
+            }))
+            // Returns the join response for setJoinResponsePayload(), or an
+            // empty string if the payload can't be parsed.
+            .def("join", [](tgcalls::LoopbackSfu &sfu, std::string const &joinPayload) {
+              std::promise<std::string> response;
+              auto future = response.get_future();
+              sfu.join(joinPayload, [response = std::make_shared<std::promise<std::string>>(std::move(response))](std::string const &value) {
+                response->set_value(value);
+              });
+              // Also empty if the endpoint is replaced before it's ready.
+              if (future.wait_for(std::chrono::seconds(10)) != std::future_status::ready) {
+                return std::string();
+              }
+              return future.get();
+            }, py::arg("joinPayload"), py::call_guard<py::gil_scoped_release>())
+            .def("leave", &tgcalls::LoopbackSfu::leave, py::arg("audioSsrc"))
+            .def("sendDataChannelMessage", &tgcalls::LoopbackSfu::sendDataChannelMessage, py::arg("message"))
+            .def("setImpairment", &tgcalls::LoopbackSfu::setImpairment, py::arg("uplink"), py::arg("downlink"))
+            .def("getStats", &tgcalls::LoopbackSfu::getStats);
 
     py::class_<tgcalls::GroupInstanceInterface::AudioDevice>(m, "AudioDevice")
             .def_readwrite("name", &tgcalls::GroupInstanceInterface::AudioDevice::name)
@@ -114,28 +1530,176 @@ PYBIND11_MODULE(tgcalls, m) {
             .value("GroupConnectionModeBroadcast", tgcalls::GroupConnectionMode::GroupConnectionModeBroadcast)
             .export_values();
 
+    py::enum_<tgcalls::BroadcastPart::Status>(m, "BroadcastPartStatus")
+            .value("Success", tgcalls::BroadcastPart::Status::Success)
+            .value("NotReady", tgcalls::BroadcastPart::Status::NotReady)
+            .value("ResyncNeeded", tgcalls::BroadcastPart::Status::ResyncNeeded);
+
+    py::classh<BroadcastPartRequest>(m, "BroadcastPartRequest", py::buffer_protocol())
+            .def_property_readonly("timestampMilliseconds", &BroadcastPartRequest::timestampMilliseconds)
+            .def_property_readonly("durationMilliseconds", &BroadcastPartRequest::durationMilliseconds)
+            .def_property_readonly("isVideo", &BroadcastPartRequest::isVideo)
+            .def_property_readonly("videoChannelId", &BroadcastPartRequest::videoChannelId)
+            .def_property_readonly("videoQuality", &BroadcastPartRequest::videoQuality)
+            .def_property_readonly("isFinished", &BroadcastPartRequest::isFinished)
+            .def("allocate", &BroadcastPartRequest::allocate, py::arg("size"))
+            .def("complete", py::overload_cast<tgcalls::BroadcastPart::Status, double>(&BroadcastPartRequest::complete),
+                 py::arg("status"), py::arg("responseTimestamp"))
+            .def("complete", py::overload_cast<tgcalls::BroadcastPart::Status, double, const py::buffer &>(&BroadcastPartRequest::complete),
+                 py::arg("status"), py::arg("responseTimestamp"), py::arg("data"))
+            .def_buffer([](BroadcastPartRequest &request) {
+              auto &data = request.data();
+              return py::buffer_info(data.data(), static_cast<py::ssize_t>(data.size()), false);
+            });
+
+    // Calls that block on webrtc threads must not hold the GIL: those threads
+    // may themselves be waiting for it to run a Python callback.
+    const auto releaseGil = py::call_guard<py::gil_scoped_release>();
+
     py::class_<NativeInstance>(m, "NativeInstance")
             .def(py::init<bool, string>())
-            .def("startCall", &NativeInstance::startCall)
+            .def("startCall", py::overload_cast<vector<RtcServer>, std::array<uint8_t, 256>, bool, std::string>(&NativeInstance::startCall))
+            .def("startCall", py::overload_cast<vector<RtcServer>, std::array<uint8_t, 256>, bool, std::string,
+                     std::shared_ptr<FileAudioDeviceDescriptor>, bool>(&NativeInstance::startCall),
+                 py::arg("servers"), py::arg("authKey"), py::arg("isOutgoing"), py::arg("logPath"),
+                 py::arg("fileAudioDeviceDescriptor"), py::arg("useSharedAudioClock") = false, releaseGil)
+            .def("startCall", py::overload_cast<vector<RtcServer>, std::array<uint8_t, 256>, bool, std::string,
+                     std::shared_ptr<RawAudioDeviceDescriptor>, bool>(&NativeInstance::startCall),
+                 py::arg("servers"), py::arg("authKey"), py::arg("isOutgoing"), py::arg("logPath"),
+                 py::arg("rawAudioDeviceDescriptor"), py::arg("useSharedAudioClock") = false, releaseGil)
+            .def("startCall", py::overload_cast<vector<RtcServer>, std::array<uint8_t, 256>, bool, std::string,
+                     std::shared_ptr<RingAudioDeviceDescriptor>, bool>(&NativeInstance::startCall),
+                 py::arg("servers"), py::arg("authKey"), py::arg("isOutgoing"), py::arg("logPath"),
+                 py::arg("ringAudioDeviceDescriptor"), py::arg("useSharedAudioClock") = false, releaseGil)
+            .def("startCall", py::overload_cast<vector<RtcServer>, std::array<uint8_t, 256>, bool, std::string,
+                     std::shared_ptr<MixerAudioDeviceDescriptor>, bool>(&NativeInstance::startCall),
+                 py::arg("servers"), py::arg("authKey"), py::arg("isOutgoing"), py::arg("logPath"),
+                 py::arg("mixerAudioDeviceDescriptor"), py::arg("useSharedAudioClock") = false, releaseGil)
+            .def("startCall", py::overload_cast<vector<RtcServer>, std::array<uint8_t, 256>, bool, std::string,
+                     std::shared_ptr<FrameAudioDeviceDescriptor>>(&NativeInstance::startCall),
+                 py::arg("servers"), py::arg("authKey"), py::arg("isOutgoing"), py::arg("logPath"),
+                 py::arg("frameAudioDeviceDescriptor"), releaseGil)
             .def("setupGroupCall", &NativeInstance::setupGroupCall)
-            .def("startGroupCall", py::overload_cast<std::shared_ptr<FileAudioDeviceDescriptor>>(&NativeInstance::startGroupCall))
-            .def("startGroupCall", py::overload_cast<std::shared_ptr<RawAudioDeviceDescriptor>>(&NativeInstance::startGroupCall))
-            .def("startGroupCall", py::overload_cast<std::string, std::string>(&NativeInstance::startGroupCall))
+            .def("startGroupCall", py::overload_cast<std::shared_ptr<FileAudioDeviceDescriptor>, bool>(&NativeInstance::startGroupCall),
+                 py::arg("fileAudioDeviceDescriptor"), py::arg("useSharedAudioClock") = false, releaseGil)
+            .def("startGroupCall", py::overload_cast<std::shared_ptr<RawAudioDeviceDescriptor>, bool>(&NativeInstance::startGroupCall),
+                 py::arg("rawAudioDeviceDescriptor"), py::arg("useSharedAudioClock") = false, releaseGil)
+            .def("startGroupCall", py::overload_cast<std::shared_ptr<RingAudioDeviceDescriptor>, bool>(&NativeInstance::startGroupCall),
+                 py::arg("ringAudioDeviceDescriptor"), py::arg("useSharedAudioClock") = false, releaseGil)
+            .def("startGroupCall", py::overload_cast<std::shared_ptr<MixerAudioDeviceDescriptor>, bool>(&NativeInstance::startGroupCall),
+                 py::arg("mixerAudioDeviceDescriptor"), py::arg("useSharedAudioClock") = false, releaseGil)
+            .def("startGroupCall", py::overload_cast<std::shared_ptr<FrameAudioDeviceDescriptor>>(&NativeInstance::startGroupCall),
+                 py::arg("frameAudioDeviceDescriptor"), releaseGil)
+            .def("startGroupCall", py::overload_cast<std::string, std::string>(&NativeInstance::startGroupCall), releaseGil)
             .def("isGroupCallNativeCreated", &NativeInstance::isGroupCallNativeCreated)
-            .def("stopGroupCall", &NativeInstance::stopGroupCall)
-            .def("setIsMuted", &NativeInstance::setIsMuted)
-            .def("setVolume", &NativeInstance::setVolume)
-            .def("restartAudioInputDevice", &NativeInstance::restartAudioInputDevice)
-            .def("restartAudioOutputDevice", &NativeInstance::restartAudioOutputDevice)
-            .def("stopAudioDeviceModule", &NativeInstance::stopAudioDeviceModule)
-            .def("startAudioDeviceModule", &NativeInstance::startAudioDeviceModule)
-            .def("getPlayoutDevices", &NativeInstance::getPlayoutDevices)
-            .def("getRecordingDevices", &NativeInstance::getRecordingDevices)
-            .def("setAudioOutputDevice", &NativeInstance::setAudioOutputDevice)
-            .def("setAudioInputDevice", &NativeInstance::setAudioInputDevice)
-            .def("setJoinResponsePayload", &NativeInstance::setJoinResponsePayload)
-            .def("setConnectionMode", &NativeInstance::setConnectionMode)
+            .def("stopGroupCall", &NativeInstance::stopGroupCall, releaseGil)
+            .def("stopGroupCallAsync", &NativeInstance::stopGroupCallAsync, py::arg("done") = nullptr)
+            .def("suspendGroupCall", &NativeInstance::suspendGroupCall, py::arg("keepWarmMs"))
+            .def("hasSuspendedGroupCall", &NativeInstance::hasSuspendedGroupCall)
+            .def_static("pendingGroupCallTeardowns", [] { return GroupCallReaper::Get().pending(); })
+            .def("emitJoinPayloadFuture", &NativeInstance::emitJoinPayloadFuture)
+            .def("connectedFuture", &NativeInstance::connectedFuture)
+            .def("queuedTasksFuture", &NativeInstance::queuedTasksFuture)
+            .def("stopGroupCallFuture", &NativeInstance::stopGroupCallFuture)
+            .def("setIsMuted", &NativeInstance::setIsMuted, releaseGil)
+            .def("setIsNoiseSuppressionEnabled", &NativeInstance::setIsNoiseSuppressionEnabled, py::arg("enabled"), releaseGil)
+            .def("setVolume", &NativeInstance::setVolume, releaseGil)
+            .def("removeSsrcs", &NativeInstance::removeSsrcs, py::arg("ssrcs"), releaseGil)
+            .def("updateParticipants", &NativeInstance::updateParticipants,
+                 py::arg("addedSsrcs") = std::vector<uint32_t>(), py::arg("removedSsrcs") = std::vector<uint32_t>(),
+                 py::arg("volumes") = std::map<uint32_t, double>(), releaseGil)
+            .def("restartAudioInputDevice", &NativeInstance::restartAudioInputDevice, releaseGil)
+            .def("restartAudioOutputDevice", &NativeInstance::restartAudioOutputDevice, releaseGil)
+            .def("stopAudioDeviceModule", &NativeInstance::stopAudioDeviceModule, releaseGil)
+            .def("startAudioDeviceModule", &NativeInstance::startAudioDeviceModule, releaseGil)
+            .def("getPlayoutDevices", &NativeInstance::getPlayoutDevices, releaseGil)
+            .def("getRecordingDevices", &NativeInstance::getRecordingDevices, releaseGil)
+            .def("setAudioOutputDevice", &NativeInstance::setAudioOutputDevice, releaseGil)
+            .def("setAudioInputDevice", &NativeInstance::setAudioInputDevice, releaseGil)
+            .def("setJoinResponsePayload", &NativeInstance::setJoinResponsePayload, py::arg("payload"))
+            .def("setConnectionMode", &NativeInstance::setConnectionMode, releaseGil)
             .def("emitJoinPayload", &NativeInstance::emitJoinPayload)
-            .def("receiveSignalingData", &NativeInstance::receiveSignalingData)
+            .def("receiveSignalingData", &NativeInstance::receiveSignalingData, py::arg("data"))
+            .def("setIncomingAudioTap", &NativeInstance::setIncomingAudioTap)
+            .def("setOpusRtpRecorder", &NativeInstance::setOpusRtpRecorder)
+            .def("setVideoRtpRecorder", &NativeInstance::setVideoRtpRecorder)
+            .def("setAudioBridgeSource", &NativeInstance::setAudioBridgeSource, py::arg("bridge"))
+            .def("setRequestedVideoChannels", &NativeInstance::setRequestedVideoChannels, releaseGil)
+            .def("setBroadcastDecodedSsrcs", &NativeInstance::setBroadcastDecodedSsrcs, py::arg("ssrcs"), releaseGil)
+            .def("setVideoSource", py::overload_cast<std::shared_ptr<RawVideoDeviceDescriptor>>(&NativeInstance::setVideoSource),
+                 py::arg("source"), releaseGil)
+            .def("setVideoSource", py::overload_cast<std::shared_ptr<FileVideoSource>>(&NativeInstance::setVideoSource),
+                 py::arg("source"), releaseGil)
+            .def("addIncomingVideoSink", &NativeInstance::addIncomingVideoSink, py::arg("endpointId"), py::arg("sink"),
+                 py::arg("queueDepth") = 0)
+            .def("removeIncomingVideoSinks", &NativeInstance::removeIncomingVideoSinks, py::arg("endpointId"))
+            .def("setPlayoutMixingDisabled", &NativeInstance::setPlayoutMixingDisabled)
+            .def("setIncomingAudioChannelPool", &NativeInstance::setIncomingAudioChannelPool,
+                 py::arg("poolSize"), py::arg("idleTimeoutMs") = 1000)
+            .def("setSsrcStateIdleTimeout", &NativeInstance::setSsrcStateIdleTimeout, py::arg("timeoutMs"))
+            .def("setMaxDecodedIncomingAudioStreams", &NativeInstance::setMaxDecodedIncomingAudioStreams)
+            .def("setParallelAudioDecoding", &NativeInstance::setParallelAudioDecoding, py::arg("deadlineUs"))
+            .def("setConnectionModeCrossfade", &NativeInstance::setConnectionModeCrossfade, py::arg("crossfadeMs"))
+            .def("setBroadcastPartCacheKey", &NativeInstance::setBroadcastPartCacheKey, py::arg("key"))
+            .def("setDummyChannelEnabled", &NativeInstance::setDummyChannelEnabled, py::arg("enabled"))
+            .def("setOutgoingAudioProfile", &NativeInstance::setOutgoingAudioProfile, py::arg("profile"))
+            .def("setOutgoingVoiceGate", &NativeInstance::setOutgoingVoiceGate, py::arg("gate"))
+            .def("setIncomingAudioProfile", &NativeInstance::setIncomingAudioProfile, py::arg("profile"))
+            .def("setAudioMixer", &NativeInstance::setAudioMixer, py::arg("config"))
+            .def("setSharedAudioEncoder", &NativeInstance::setSharedAudioEncoder, py::arg("encoder"))
+            .def("setSharedAudioDecoder", &NativeInstance::setSharedAudioDecoder, py::arg("decoder"))
+            .def("setOutgoingAudioBridge", &NativeInstance::setOutgoingAudioBridge, py::arg("bridge"))
+            .def("setOutgoingOpusSource", &NativeInstance::setOutgoingOpusSource, py::arg("source"))
+            .def("setVideoEncoderConfig", &NativeInstance::setVideoEncoderConfig,
+                 py::arg("hardwareEncoder") = "", py::arg("hardwareDevice") = "", py::arg("maxThreads") = 0,
+                 py::arg("complexity") = tgcalls::GroupVideoEncoderConfig::Complexity::Normal,
+                 py::arg("parallelSimulcast") = false)
+            .def("setVideoDecoderConfig", &NativeInstance::setVideoDecoderConfig,
+                 py::arg("hardwareDeviceType") = "", py::arg("hardwareDevice") = "")
+            .def("setFieldTrials", &NativeInstance::setFieldTrials, py::arg("trials"))
+            .def("setRtcServerOptions", &NativeInstance::setRtcServerOptions,
+                 py::arg("family") = RtcServerFamily::PreferIpv4, py::arg("maxTurnServers") = 4)
+            .def("setUseSharedEngineContext", &NativeInstance::setUseSharedEngineContext)
+            .def("setAudioOnly", &NativeInstance::setAudioOnly)
+            .def("setConstantBitrateAudio", &NativeInstance::setConstantBitrateAudio)
+            .def("setUseCertificatePool", &NativeInstance::setUseCertificatePool)
+            .def("setUseBatchedUdpSockets", &NativeInstance::setUseBatchedUdpSockets)
+            .def("setUseSharedUdpSockets", &NativeInstance::setUseSharedUdpSockets)
+            .def("setGroupCallStartedCallback", &NativeInstance::setGroupCallStartedCallback)
+            .def("setCallStatsCallback", &NativeInstance::setCallStatsCallback,
+                 py::arg("callback"), py::arg("intervalMs") = 5000)
+            .def("setLatencyTracingEnabled", &NativeInstance::setLatencyTracingEnabled)
+            .def("getLatencyTrace", &NativeInstance::getLatencyTrace)
+            .def("resetLatencyTrace", &NativeInstance::resetLatencyTrace)
+            .def("setRequestBroadcastPartCallback", &NativeInstance::setRequestBroadcastPartCallback)
+            .def("setRequestVideoBroadcastPartCallback", &NativeInstance::setRequestVideoBroadcastPartCallback)
+            .def("getStartupLatency", &NativeInstance::getStartupLatency, releaseGil)
+            .def("getReconnectStats", &NativeInstance::getReconnectStats, releaseGil)
+            .def("getNoiseSuppressionStats", &NativeInstance::getNoiseSuppressionStats, releaseGil)
+            .def("getAudioMixerStats", &NativeInstance::getAudioMixerStats, releaseGil)
+            .def("getMediaStats", &NativeInstance::getMediaStats, releaseGil)
+            .def("getMemoryUsage", &NativeInstance::getMemoryUsage, releaseGil)
+            .def("getCpuUsage", &NativeInstance::getCpuUsage, releaseGil)
+            .def("exportMigrationState", &NativeInstance::exportMigrationState, releaseGil)
+            .def("setMigrationState", &NativeInstance::setMigrationState)
+            .def("prewarmGroupCalls", &NativeInstance::prewarmGroupCalls, releaseGil)
+            .def("prewarmedGroupCallCount", &NativeInstance::prewarmedGroupCallCount)
+            .def("clearPrewarmedGroupCalls", &NativeInstance::clearPrewarmedGroupCalls, releaseGil)
+            .def("setAudioLevelsCallback", &NativeInstance::setAudioLevelsCallback,
+                 py::arg("callback"), py::arg("intervalMs") = 100, py::arg("nativeVad") = true)
+            .def("setSpeakerMonitor", &NativeInstance::setSpeakerMonitor, py::arg("monitor"), py::arg("callId"))
+            .def("setEventQueue", &NativeInstance::setEventQueue, py::arg("queue"))
             .def("setSignalingDataEmittedCallback", &NativeInstance::setSignalingDataEmittedCallback);
+
+    py::class_<CallManager>(m, "CallManager")
+            .def(py::init<>())
+            .def("add", &CallManager::add, py::arg("id"), py::arg("instance"))
+            .def("remove", &CallManager::remove, py::arg("id"))
+            .def("ids", &CallManager::ids)
+            .def("__len__", &CallManager::size)
+            .def("setIsMuted", &CallManager::setIsMuted, py::arg("ids"), py::arg("isMuted"))
+            .def("setVolume", &CallManager::setVolume, py::arg("ids"), py::arg("ssrcs"), py::arg("volumes"))
+            .def("startAudioDeviceModules", &CallManager::startAudioDeviceModules, py::arg("ids"))
+            .def("stopAudioDeviceModules", &CallManager::stopAudioDeviceModules, py::arg("ids"))
+            .def("collectStats", &CallManager::collectStats, py::arg("ids"));
 }
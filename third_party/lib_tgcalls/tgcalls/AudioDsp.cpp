@@ -0,0 +1,589 @@
+#include "AudioDsp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TGCALLS_AUDIO_DSP_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define TGCALLS_AUDIO_DSP_AVX2 1
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define TGCALLS_AUDIO_DSP_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace tgcalls {
+
+namespace {
+
+struct AudioDspKernels {
+    float (*absPeakFloat)(const float *, size_t);
+    int16_t (*absPeakS16)(const int16_t *, size_t);
+    float (*sumOfSquares)(const float *, size_t);
+    void (*s16ToFloat)(const int16_t *, size_t, float *);
+    void (*floatToS16)(const float *, size_t, int16_t *);
+    void (*normalizedToS16)(const float *, size_t, int16_t *);
+};
+
+// Scalar versions; also used for the tails of the vectorised ones.
+
+float AbsPeakFloatScalar(const float *samples, size_t count) {
+    float peak = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        peak = std::max(peak, std::fabs(samples[i]));
+    }
+    return peak;
+}
+
+int16_t AbsPeakS16Scalar(const int16_t *samples, size_t count) {
+    int peak = 0;
+    for (size_t i = 0; i < count; i++) {
+        peak = std::max(peak, std::abs(static_cast<int>(samples[i])));
+    }
+    return static_cast<int16_t>(std::min(peak, 32767));
+}
+
+float SumOfSquaresScalar(const float *samples, size_t count) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        sum += samples[i] * samples[i];
+    }
+    return sum;
+}
+
+void S16ToFloatScalar(const int16_t *samples, size_t count, float *out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<float>(samples[i]);
+    }
+}
+
+void FloatToS16Scalar(const float *samples, size_t count, int16_t *out) {
+    for (size_t i = 0; i < count; i++) {
+        float sample = std::min(32767.0f, std::max(-32768.0f, samples[i]));
+        out[i] = static_cast<int16_t>(std::lrint(sample));
+    }
+}
+
+int16_t NormalizedToS16(float sample) {
+    float scaled = std::min(32767.0f, std::max(-32768.0f, sample * 32767.0f));
+    return static_cast<int16_t>(std::lrint(scaled));
+}
+
+void NormalizedToS16Scalar(const float *samples, size_t count, int16_t *out) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = NormalizedToS16(samples[i]);
+    }
+}
+
+#if TGCALLS_AUDIO_DSP_SSE2
+
+float HorizontalMax(__m128 value) {
+    value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+    value = _mm_max_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(value);
+}
+
+float HorizontalSum(__m128 value) {
+    value = _mm_add_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(1, 0, 3, 2)));
+    value = _mm_add_ps(value, _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(value);
+}
+
+int16_t HorizontalMax(__m128i value) {
+    value = _mm_max_epi16(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+    value = _mm_max_epi16(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 3, 0, 1)));
+    value = _mm_max_epi16(value, _mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<int16_t>(_mm_extract_epi16(value, 0));
+}
+
+float AbsPeakFloatSse2(const float *samples, size_t count) {
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 peak = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        peak = _mm_max_ps(peak, _mm_and_ps(_mm_loadu_ps(samples + i), absMask));
+    }
+    return std::max(HorizontalMax(peak), AbsPeakFloatScalar(samples + i, count - i));
+}
+
+int16_t AbsPeakS16Sse2(const int16_t *samples, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i peak = zero;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        // max(x, -x) with a saturating negation maps -32768 to 32767.
+        peak = _mm_max_epi16(peak, _mm_max_epi16(value, _mm_subs_epi16(zero, value)));
+    }
+    return std::max(HorizontalMax(peak), AbsPeakS16Scalar(samples + i, count - i));
+}
+
+float SumOfSquaresSse2(const float *samples, size_t count) {
+    __m128 sum = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 value = _mm_loadu_ps(samples + i);
+        sum = _mm_add_ps(sum, _mm_mul_ps(value, value));
+    }
+    return HorizontalSum(sum) + SumOfSquaresScalar(samples + i, count - i);
+}
+
+void S16ToFloatSse2(const int16_t *samples, size_t count, float *out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16);
+        _mm_storeu_ps(out + i, _mm_cvtepi32_ps(low));
+        _mm_storeu_ps(out + i + 4, _mm_cvtepi32_ps(high));
+    }
+    S16ToFloatScalar(samples + i, count - i, out + i);
+}
+
+void FloatToS16Sse2(const float *samples, size_t count, int16_t *out) {
+    // Clamp first: out of range conversions would yield INT32_MIN.
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(samples + i), low), high);
+        __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(samples + i + 4), low), high);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+    }
+    FloatToS16Scalar(samples + i, count - i, out + i);
+}
+
+__m128i NormalizedToS16x8(const float *samples) {
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    const __m128 low = _mm_set1_ps(-32768.0f);
+    const __m128 high = _mm_set1_ps(32767.0f);
+    __m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(samples), scale), low), high);
+    __m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(samples + 4), scale), low), high);
+    return _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+}
+
+void NormalizedToS16Sse2(const float *samples, size_t count, int16_t *out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), NormalizedToS16x8(samples + i));
+    }
+    NormalizedToS16Scalar(samples + i, count - i, out + i);
+}
+
+#endif // TGCALLS_AUDIO_DSP_SSE2
+
+#if TGCALLS_AUDIO_DSP_AVX2
+
+#define TGCALLS_AVX2_TARGET __attribute__((target("avx2")))
+
+TGCALLS_AVX2_TARGET float AbsPeakFloatAvx2(const float *samples, size_t count) {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 peak = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        peak = _mm256_max_ps(peak, _mm256_and_ps(_mm256_loadu_ps(samples + i), absMask));
+    }
+    __m128 half = _mm_max_ps(_mm256_castps256_ps128(peak), _mm256_extractf128_ps(peak, 1));
+    return std::max(HorizontalMax(half), AbsPeakFloatSse2(samples + i, count - i));
+}
+
+TGCALLS_AVX2_TARGET int16_t AbsPeakS16Avx2(const int16_t *samples, size_t count) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i peak = zero;
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(samples + i));
+        peak = _mm256_max_epi16(peak, _mm256_max_epi16(value, _mm256_subs_epi16(zero, value)));
+    }
+    __m128i half = _mm_max_epi16(_mm256_castsi256_si128(peak), _mm256_extracti128_si256(peak, 1));
+    return std::max(HorizontalMax(half), AbsPeakS16Sse2(samples + i, count - i));
+}
+
+TGCALLS_AVX2_TARGET float SumOfSquaresAvx2(const float *samples, size_t count) {
+    __m256 sum = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 value = _mm256_loadu_ps(samples + i);
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(value, value));
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    return HorizontalSum(half) + SumOfSquaresSse2(samples + i, count - i);
+}
+
+TGCALLS_AVX2_TARGET void S16ToFloatAvx2(const int16_t *samples, size_t count, float *out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(value)));
+    }
+    S16ToFloatScalar(samples + i, count - i, out + i);
+}
+
+TGCALLS_AVX2_TARGET void FloatToS16Avx2(const float *samples, size_t count, int16_t *out) {
+    const __m256 low = _mm256_set1_ps(-32768.0f);
+    const __m256 high = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(samples + i), low), high);
+        __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(samples + i + 8), low), high);
+        // packs works per 128-bit lane; restore the sample order afterwards.
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+    }
+    FloatToS16Sse2(samples + i, count - i, out + i);
+}
+
+TGCALLS_AVX2_TARGET void NormalizedToS16Avx2(const float *samples, size_t count, int16_t *out) {
+    const __m256 scale = _mm256_set1_ps(32767.0f);
+    const __m256 low = _mm256_set1_ps(-32768.0f);
+    const __m256 high = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(samples + i), scale), low), high);
+        __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(samples + i + 8), scale), low), high);
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+    }
+    NormalizedToS16Sse2(samples + i, count - i, out + i);
+}
+
+#undef TGCALLS_AVX2_TARGET
+
+#endif // TGCALLS_AUDIO_DSP_AVX2
+
+#if TGCALLS_AUDIO_DSP_NEON
+
+float AbsPeakFloatNeon(const float *samples, size_t count) {
+    float32x4_t peak = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        peak = vmaxq_f32(peak, vabsq_f32(vld1q_f32(samples + i)));
+    }
+    return std::max(vmaxvq_f32(peak), AbsPeakFloatScalar(samples + i, count - i));
+}
+
+int16_t AbsPeakS16Neon(const int16_t *samples, size_t count) {
+    int16x8_t peak = vdupq_n_s16(0);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        peak = vmaxq_s16(peak, vqabsq_s16(vld1q_s16(samples + i)));
+    }
+    return std::max(vmaxvq_s16(peak), AbsPeakS16Scalar(samples + i, count - i));
+}
+
+float SumOfSquaresNeon(const float *samples, size_t count) {
+    float32x4_t sum = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t value = vld1q_f32(samples + i);
+        sum = vmlaq_f32(sum, value, value);
+    }
+    return vaddvq_f32(sum) + SumOfSquaresScalar(samples + i, count - i);
+}
+
+void S16ToFloatNeon(const int16_t *samples, size_t count, float *out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t value = vld1q_s16(samples + i);
+        vst1q_f32(out + i, vcvtq_f32_s32(vmovl_s16(vget_low_s16(value))));
+        vst1q_f32(out + i + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(value))));
+    }
+    S16ToFloatScalar(samples + i, count - i, out + i);
+}
+
+void FloatToS16Neon(const float *samples, size_t count, int16_t *out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // vcvtnq rounds to nearest (even) and saturates; vqmovn narrows
+        // with saturation.
+        int32x4_t a = vcvtnq_s32_f32(vld1q_f32(samples + i));
+        int32x4_t b = vcvtnq_s32_f32(vld1q_f32(samples + i + 4));
+        vst1q_s16(out + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    FloatToS16Scalar(samples + i, count - i, out + i);
+}
+
+
+int16x8_t NormalizedToS16x8(const float *samples) {
+    int32x4_t a = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(samples), 32767.0f));
+    int32x4_t b = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(samples + 4), 32767.0f));
+    return vcombine_s16(vqmovn_s32(a), vqmovn_s32(b));
+}
+
+void NormalizedToS16Neon(const float *samples, size_t count, int16_t *out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        vst1q_s16(out + i, NormalizedToS16x8(samples + i));
+    }
+    NormalizedToS16Scalar(samples + i, count - i, out + i);
+}
+
+#endif // TGCALLS_AUDIO_DSP_NEON
+
+AudioDspKernels SelectKernels() {
+#if TGCALLS_AUDIO_DSP_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return { AbsPeakFloatAvx2, AbsPeakS16Avx2, SumOfSquaresAvx2, S16ToFloatAvx2, FloatToS16Avx2, NormalizedToS16Avx2 };
+    }
+#endif
+#if TGCALLS_AUDIO_DSP_SSE2
+    return { AbsPeakFloatSse2, AbsPeakS16Sse2, SumOfSquaresSse2, S16ToFloatSse2, FloatToS16Sse2, NormalizedToS16Sse2 };
+#elif TGCALLS_AUDIO_DSP_NEON
+    return { AbsPeakFloatNeon, AbsPeakS16Neon, SumOfSquaresNeon, S16ToFloatNeon, FloatToS16Neon, NormalizedToS16Neon };
+#else
+    return { AbsPeakFloatScalar, AbsPeakS16Scalar, SumOfSquaresScalar, S16ToFloatScalar, FloatToS16Scalar, NormalizedToS16Scalar };
+#endif
+}
+
+const AudioDspKernels &Kernels() {
+    static const AudioDspKernels kernels = SelectKernels();
+    return kernels;
+}
+
+} // namespace
+
+float AudioAbsPeak(const float *samples, size_t count) {
+    return Kernels().absPeakFloat(samples, count);
+}
+
+int16_t AudioAbsPeak(const int16_t *samples, size_t count) {
+    return Kernels().absPeakS16(samples, count);
+}
+
+float AudioRms(const float *samples, size_t count) {
+    if (count == 0) {
+        return 0.0f;
+    }
+    return std::sqrt(Kernels().sumOfSquares(samples, count) / static_cast<float>(count));
+}
+
+void AudioS16ToFloatS16(const int16_t *samples, size_t count, float *out) {
+    Kernels().s16ToFloat(samples, count, out);
+}
+
+void AudioFloatS16ToS16(const float *samples, size_t count, int16_t *out) {
+    Kernels().floatToS16(samples, count, out);
+}
+
+void AudioFloatToS16(const float *samples, size_t count, int16_t *out) {
+    Kernels().normalizedToS16(samples, count, out);
+}
+
+namespace {
+
+// Interleaving and channel extraction for one channel count. The count is
+// a parameter of all of them so they share a signature, but the mono,
+// stereo and fixed count ones ignore it.
+
+void InterleaveS16Mono(const int16_t *const *planes, size_t, size_t frames, int16_t *out) {
+    memcpy(out, planes[0], frames * sizeof(int16_t));
+}
+
+void InterleaveS16Stereo(const int16_t *const *planes, size_t, size_t frames, int16_t *out) {
+    const int16_t *left = planes[0];
+    const int16_t *right = planes[1];
+    size_t frame = 0;
+#if TGCALLS_AUDIO_DSP_SSE2
+    for (; frame + 8 <= frames; frame += 8) {
+        __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(left + frame));
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(right + frame));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + frame * 2), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + frame * 2 + 8), _mm_unpackhi_epi16(l, r));
+    }
+#elif TGCALLS_AUDIO_DSP_NEON
+    for (; frame + 8 <= frames; frame += 8) {
+        int16x8x2_t pair = { { vld1q_s16(left + frame), vld1q_s16(right + frame) } };
+        vst2q_s16(out + frame * 2, pair);
+    }
+#endif
+    for (; frame < frames; frame++) {
+        out[frame * 2] = left[frame];
+        out[frame * 2 + 1] = right[frame];
+    }
+}
+
+// With the stride known at compile time, the inner loop is unrolled and
+// every output frame is written in one go.
+template <size_t Channels>
+void InterleaveS16Fixed(const int16_t *const *planes, size_t, size_t frames, int16_t *out) {
+    const int16_t *from[Channels];
+    std::copy(planes, planes + Channels, from);
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (size_t channel = 0; channel < Channels; channel++) {
+            out[frame * Channels + channel] = from[channel][frame];
+        }
+    }
+}
+
+void InterleaveS16Generic(const int16_t *const *planes, size_t channels, size_t frames, int16_t *out) {
+    // Channel-major, so every plane is read sequentially.
+    for (size_t channel = 0; channel < channels; channel++) {
+        const int16_t *plane = planes[channel];
+        int16_t *to = out + channel;
+        for (size_t i = 0; i < frames; i++) {
+            to[i * channels] = plane[i];
+        }
+    }
+}
+
+void InterleaveFloatMono(const float *const *planes, size_t, size_t frames, int16_t *out) {
+    AudioFloatToS16(planes[0], frames, out);
+}
+
+void InterleaveFloatStereo(const float *const *planes, size_t, size_t frames, int16_t *out) {
+    const float *left = planes[0];
+    const float *right = planes[1];
+    size_t frame = 0;
+#if TGCALLS_AUDIO_DSP_SSE2
+    for (; frame + 8 <= frames; frame += 8) {
+        __m128i l = NormalizedToS16x8(left + frame);
+        __m128i r = NormalizedToS16x8(right + frame);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + frame * 2), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + frame * 2 + 8), _mm_unpackhi_epi16(l, r));
+    }
+#elif TGCALLS_AUDIO_DSP_NEON
+    for (; frame + 8 <= frames; frame += 8) {
+        int16x8x2_t pair = { { NormalizedToS16x8(left + frame), NormalizedToS16x8(right + frame) } };
+        vst2q_s16(out + frame * 2, pair);
+    }
+#endif
+    for (; frame < frames; frame++) {
+        out[frame * 2] = NormalizedToS16(left[frame]);
+        out[frame * 2 + 1] = NormalizedToS16(right[frame]);
+    }
+}
+
+template <size_t Channels>
+void InterleaveFloatFixed(const float *const *planes, size_t, size_t frames, int16_t *out) {
+    const float *from[Channels];
+    std::copy(planes, planes + Channels, from);
+    for (size_t frame = 0; frame < frames; frame++) {
+        for (size_t channel = 0; channel < Channels; channel++) {
+            out[frame * Channels + channel] = NormalizedToS16(from[channel][frame]);
+        }
+    }
+}
+
+void InterleaveFloatGeneric(const float *const *planes, size_t channels, size_t frames, int16_t *out) {
+    for (size_t channel = 0; channel < channels; channel++) {
+        const float *plane = planes[channel];
+        int16_t *to = out + channel;
+        for (size_t i = 0; i < frames; i++) {
+            to[i * channels] = NormalizedToS16(plane[i]);
+        }
+    }
+}
+
+void ExtractChannelMono(const int16_t *interleaved, size_t, size_t, size_t frames, int16_t *out) {
+    memcpy(out, interleaved, frames * sizeof(int16_t));
+}
+
+void ExtractChannelStereo(const int16_t *interleaved, size_t, size_t channel, size_t frames, int16_t *out) {
+    size_t frame = 0;
+#if TGCALLS_AUDIO_DSP_SSE2
+    for (; frame + 8 <= frames; frame += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(interleaved + frame * 2));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(interleaved + frame * 2 + 8));
+        // Move the wanted sample of every pair into the low half of its
+        // 32-bit lane, sign extended, then narrow; no value saturates.
+        if (channel == 0) {
+            a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+            b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        } else {
+            a = _mm_srai_epi32(a, 16);
+            b = _mm_srai_epi32(b, 16);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + frame), _mm_packs_epi32(a, b));
+    }
+#elif TGCALLS_AUDIO_DSP_NEON
+    for (; frame + 8 <= frames; frame += 8) {
+        int16x8x2_t pair = vld2q_s16(interleaved + frame * 2);
+        vst1q_s16(out + frame, channel == 0 ? pair.val[0] : pair.val[1]);
+    }
+#endif
+    for (; frame < frames; frame++) {
+        out[frame] = interleaved[frame * 2 + channel];
+    }
+}
+
+template <size_t Channels>
+void ExtractChannelFixed(const int16_t *interleaved, size_t, size_t channel, size_t frames, int16_t *out) {
+    const int16_t *from = interleaved + channel;
+    for (size_t frame = 0; frame < frames; frame++) {
+        out[frame] = from[frame * Channels];
+    }
+}
+
+void ExtractChannelGeneric(const int16_t *interleaved, size_t channels, size_t channel, size_t frames, int16_t *out) {
+    for (size_t frame = 0; frame < frames; frame++) {
+        out[frame] = interleaved[frame * channels + channel];
+    }
+}
+
+template <size_t Channels>
+constexpr AudioChannelKernels FixedChannelKernels() {
+    return { InterleaveS16Fixed<Channels>, InterleaveFloatFixed<Channels>, ExtractChannelFixed<Channels> };
+}
+
+// Indexed by channel count; what Opus multistream carries at most.
+constexpr AudioChannelKernels kChannelKernels[] = {
+    { InterleaveS16Generic, InterleaveFloatGeneric, ExtractChannelGeneric },
+    { InterleaveS16Mono, InterleaveFloatMono, ExtractChannelMono },
+    { InterleaveS16Stereo, InterleaveFloatStereo, ExtractChannelStereo },
+    FixedChannelKernels<3>(),
+    FixedChannelKernels<4>(),
+    FixedChannelKernels<5>(),
+    FixedChannelKernels<6>(),
+    FixedChannelKernels<7>(),
+    FixedChannelKernels<8>(),
+};
+
+} // namespace
+
+const AudioChannelKernels &AudioKernelsForChannels(size_t channels) {
+    constexpr size_t count = sizeof(kChannelKernels) / sizeof(kChannelKernels[0]);
+    return kChannelKernels[channels < count ? channels : 0];
+}
+
+void AudioInterleave(const int16_t *const *planes, size_t channels, size_t frames, int16_t *out) {
+    AudioKernelsForChannels(channels).interleaveS16(planes, channels, frames, out);
+}
+
+void AudioInterleave(const float *const *planes, size_t channels, size_t frames, int16_t *out) {
+    AudioKernelsForChannels(channels).interleaveFloat(planes, channels, frames, out);
+}
+
+void AudioExtractChannel(const int16_t *interleaved, size_t channels, size_t channel, size_t frames, int16_t *out) {
+    AudioKernelsForChannels(channels).extractChannel(interleaved, channels, channel, frames, out);
+}
+
+void AudioByteSwapS16(const int16_t *samples, size_t count, uint8_t *out) {
+    size_t i = 0;
+#if TGCALLS_AUDIO_DSP_SSE2
+    for (; i + 8 <= count; i += 8) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), value);
+    }
+#elif TGCALLS_AUDIO_DSP_NEON
+    for (; i + 8 <= count; i += 8) {
+        uint8x16_t value = vld1q_u8(reinterpret_cast<const uint8_t *>(samples + i));
+        vst1q_u8(out + i * 2, vrev16q_u8(value));
+    }
+#endif
+    for (; i < count; i++) {
+        uint16_t value = static_cast<uint16_t>(samples[i]);
+        out[i * 2] = static_cast<uint8_t>(value >> 8);
+        out[i * 2 + 1] = static_cast<uint8_t>(value & 0xff);
+    }
+}
+
+} // namespace tgcalls
@@ -0,0 +1,58 @@
+#ifndef TGCALLS_AUDIO_DSP_H
+#define TGCALLS_AUDIO_DSP_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tgcalls {
+
+// Small vectorised audio kernels for the per-frame metering and conversion
+// work done for every SSRC. The implementation is picked once at runtime:
+// AVX2 where the CPU has it, otherwise SSE2 on x86, NEON on arm64 and plain
+// C++ elsewhere. Float samples use the webrtc FloatS16 range.
+
+// Largest absolute sample value.
+float AudioAbsPeak(const float *samples, size_t count);
+// Largest absolute sample value, with |-32768| saturated to 32767.
+int16_t AudioAbsPeak(const int16_t *samples, size_t count);
+
+// Root mean square of the samples; 0 for an empty block.
+float AudioRms(const float *samples, size_t count);
+
+// Converts s16 samples to FloatS16 (no scaling).
+void AudioS16ToFloatS16(const int16_t *samples, size_t count, float *out);
+// Rounds FloatS16 samples to the nearest s16, saturating out of range ones.
+void AudioFloatS16ToS16(const float *samples, size_t count, int16_t *out);
+
+// Kernels for broadcast part decoding. These use SSE2 / NEON where
+// available, AVX2 too for the plain conversion, with mono and stereo layouts
+// vectorised and other channel counts handled by scalar loops. Normalised
+// float samples are in [-1, 1].
+
+// Scales normalised float samples to s16, rounding and saturating.
+void AudioFloatToS16(const float *samples, size_t count, int16_t *out);
+// Interleaves |channels| planes of |frames| samples each into |out|.
+void AudioInterleave(const int16_t *const *planes, size_t channels, size_t frames, int16_t *out);
+void AudioInterleave(const float *const *planes, size_t channels, size_t frames, int16_t *out);
+// Copies channel |channel| of |frames| interleaved frames into |out|.
+void AudioExtractChannel(const int16_t *interleaved, size_t channels, size_t channel, size_t frames, int16_t *out);
+
+// The interleaving and extraction kernels of one channel count, for a
+// stream to pick once instead of dispatching on its channel count every
+// frame: the vector ones above for mono and stereo, loops with the stride
+// fixed at compile time for 3 to 8 channels, generic loops otherwise. Each
+// takes the channel count, though only the generic ones use it.
+struct AudioChannelKernels {
+    void (*interleaveS16)(const int16_t *const *planes, size_t channels, size_t frames, int16_t *out);
+    void (*interleaveFloat)(const float *const *planes, size_t channels, size_t frames, int16_t *out);
+    void (*extractChannel)(const int16_t *interleaved, size_t channels, size_t channel, size_t frames, int16_t *out);
+};
+
+const AudioChannelKernels &AudioKernelsForChannels(size_t channels);
+// Writes the samples with their bytes swapped, e.g. for network order L16.
+// |out| may be unaligned.
+void AudioByteSwapS16(const int16_t *samples, size_t count, uint8_t *out);
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,82 @@
+#include "CallStatsSnapshotBuilder.h"
+
+#include <algorithm>
+
+#include "call/call.h"
+#include "pc/channel.h"
+
+namespace tgcalls {
+
+CallStatsSnapshotBuilder::CallStatsSnapshotBuilder(int64_t timestampMs) {
+    _snapshot.timestampMs = timestampMs;
+}
+
+void CallStatsSnapshotBuilder::addCall(webrtc::Call *call) {
+    if (!call) {
+        return;
+    }
+    const auto stats = call->GetStats();
+    _snapshot.sendBitrateBps = stats.send_bandwidth_bps;
+    _snapshot.receiveBitrateBps = stats.recv_bandwidth_bps;
+    if (stats.rtt_ms >= 0) {
+        _snapshot.rttMs = stats.rtt_ms;
+    }
+}
+
+void CallStatsSnapshotBuilder::addVoiceChannel(cricket::VoiceChannel *channel) {
+    if (!channel) {
+        return;
+    }
+    cricket::VoiceMediaInfo info;
+    if (!channel->media_channel()->GetStats(&info, false)) {
+        return;
+    }
+    for (const auto &sender : info.senders) {
+        _snapshot.outgoingPacketsLost += sender.packets_lost;
+        _snapshot.outgoingFractionLost = std::max(_snapshot.outgoingFractionLost, sender.fraction_lost);
+        if (_snapshot.rttMs < 0 && sender.rtt_ms > 0) {
+            _snapshot.rttMs = sender.rtt_ms;
+        }
+    }
+    for (const auto &receiver : info.receivers) {
+        _snapshot.incomingAudioStreams++;
+        _snapshot.incomingPacketsReceived += receiver.packets_rcvd;
+        _snapshot.incomingPacketsLost += receiver.packets_lost;
+        _jitterSumMs += receiver.jitter_ms;
+        _jitterBufferDelaySumMs += receiver.jitter_buffer_ms;
+    }
+}
+
+void CallStatsSnapshotBuilder::addVideoChannel(cricket::VideoChannel *channel) {
+    if (!channel) {
+        return;
+    }
+    cricket::VideoMediaInfo info;
+    if (!channel->media_channel()->GetStats(&info)) {
+        return;
+    }
+    for (const auto &sender : info.senders) {
+        _snapshot.outgoingPacketsLost += sender.packets_lost;
+        _snapshot.outgoingFractionLost = std::max(_snapshot.outgoingFractionLost, sender.fraction_lost);
+    }
+    for (const auto &receiver : info.receivers) {
+        _snapshot.incomingPacketsReceived += receiver.packets_rcvd;
+        _snapshot.incomingPacketsLost += receiver.packets_lost;
+        _decodeSumMs += receiver.decode_ms;
+        _videoReceivers++;
+    }
+}
+
+CallStatsSnapshot CallStatsSnapshotBuilder::finish() const {
+    auto snapshot = _snapshot;
+    if (snapshot.incomingAudioStreams != 0) {
+        snapshot.incomingJitterMs = (int32_t)(_jitterSumMs / snapshot.incomingAudioStreams);
+        snapshot.jitterBufferDelayMs = (int32_t)(_jitterBufferDelaySumMs / snapshot.incomingAudioStreams);
+    }
+    if (_videoReceivers != 0) {
+        snapshot.videoDecodeMs = _decodeSumMs / _videoReceivers;
+    }
+    return snapshot;
+}
+
+} // namespace tgcalls
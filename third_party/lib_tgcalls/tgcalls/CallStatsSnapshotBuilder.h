@@ -0,0 +1,45 @@
+#ifndef TGCALLS_CALL_STATS_SNAPSHOT_BUILDER_H
+#define TGCALLS_CALL_STATS_SNAPSHOT_BUILDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Stats.h"
+
+namespace webrtc {
+class Call;
+} // namespace webrtc
+
+namespace cricket {
+class VoiceChannel;
+class VideoChannel;
+} // namespace cricket
+
+namespace tgcalls {
+
+// Gathers a CallStatsSnapshot from the call and the media channels of one
+// instance. Has to be used on the worker thread of the channels, where
+// their GetStats() runs.
+class CallStatsSnapshotBuilder {
+public:
+    explicit CallStatsSnapshotBuilder(int64_t timestampMs);
+
+    void addCall(webrtc::Call *call);
+    // Senders and receivers both count, whatever direction the channel is.
+    void addVoiceChannel(cricket::VoiceChannel *channel);
+    void addVideoChannel(cricket::VideoChannel *channel);
+
+    CallStatsSnapshot finish() const;
+
+private:
+    CallStatsSnapshot _snapshot;
+    int64_t _jitterSumMs = 0;
+    int64_t _jitterBufferDelaySumMs = 0;
+    int32_t _decodeSumMs = 0;
+    int32_t _videoReceivers = 0;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -8,6 +8,8 @@
 #include "rtc_base/logging.h"
 #include "system_wrappers/include/field_trial.h"
 
+#include <mutex>
+
 namespace tgcalls {
 namespace {
 
@@ -139,6 +141,27 @@ VideoFormatsMessage ComposeSupportedFormats(
 		std::vector<VideoFormat> encoders,
 		std::vector<VideoFormat> decoders,
         const std::vector<std::string> &preferredCodecs) {
+	// The factories' formats don't change within a process, so every call
+	// with the same preferences gets the same list; it's sorted out once.
+	struct CachedFormats {
+		std::vector<VideoFormat> encoders;
+		std::vector<VideoFormat> decoders;
+		std::vector<std::string> preferredCodecs;
+		VideoFormatsMessage result;
+	};
+	static std::mutex cacheMutex;
+	static std::vector<CachedFormats> cache;
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	for (const auto &entry : cache) {
+		if (entry.encoders == encoders
+			&& entry.decoders == decoders
+			&& entry.preferredCodecs == preferredCodecs) {
+			return entry.result;
+		}
+	}
+
+	auto cached = CachedFormats{ encoders, decoders, preferredCodecs };
 	encoders = FilterAndSortEncoders(std::move(encoders), preferredCodecs);
 
 	auto result = VideoFormatsMessage();
@@ -148,6 +171,8 @@ VideoFormatsMessage ComposeSupportedFormats(
 		RTC_LOG(LS_INFO) << "Format: " << format.ToString();
 	}
 	RTC_LOG(LS_INFO) << "First " << result.encodersCount << " formats are supported encoders.";
+	cached.result = result;
+	cache.push_back(std::move(cached));
 	return result;
 }
 
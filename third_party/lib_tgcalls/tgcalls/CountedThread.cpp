@@ -0,0 +1,147 @@
+#include "CountedThread.h"
+
+#include "CpuAccounting.h"
+#include "InvokeAudit.h"
+
+#include "api/task_queue/queued_task.h"
+#include "rtc_base/task_utils/to_queued_task.h"
+#include "rtc_base/thread_message.h"
+#include "rtc_base/time_utils.h"
+
+namespace tgcalls {
+
+namespace {
+
+CpuAccount::Thread accountThread(HotPathCounters::Thread kind) {
+    switch (kind) {
+        case HotPathCounters::Thread::Network:
+            return CpuAccount::Thread::Network;
+        case HotPathCounters::Thread::Media:
+            return CpuAccount::Thread::Media;
+        case HotPathCounters::Thread::Worker:
+            break;
+    }
+    return CpuAccount::Thread::Worker;
+}
+
+// A PostTask() functor posted while an account was current.
+class AccountedTask final : public rtc::rtc_thread_internal::MessageLikeTask {
+public:
+    AccountedTask(rtc::MessageData *task, std::shared_ptr<CpuAccount> account) :
+    _task(task),
+    _account(std::move(account)) {
+    }
+
+    ~AccountedTask() override {
+        delete _task;
+    }
+
+    void Run() override {
+        CpuTimeScope scope(_account);
+        static_cast<rtc::rtc_thread_internal::MessageLikeTask *>(_task)->Run();
+    }
+
+private:
+    rtc::MessageData *const _task;
+    const std::shared_ptr<CpuAccount> _account;
+};
+
+// A webrtc::QueuedTask posted while an account was current.
+class AccountedQueuedTask final : public webrtc::QueuedTask {
+public:
+    AccountedQueuedTask(std::unique_ptr<webrtc::QueuedTask> task, std::shared_ptr<CpuAccount> account) :
+    _task(std::move(task)),
+    _account(std::move(account)) {
+    }
+
+    bool Run() override {
+        CpuTimeScope scope(_account);
+        if (!_task->Run()) {
+            // The task took ownership of itself.
+            _task.release();
+        }
+        return true;
+    }
+
+private:
+    std::unique_ptr<webrtc::QueuedTask> _task;
+    const std::shared_ptr<CpuAccount> _account;
+};
+
+} // namespace
+
+CountedThread::CountedThread(std::unique_ptr<rtc::SocketServer> socketServer, HotPathCounters::Thread kind) :
+rtc::Thread(std::move(socketServer), false),
+_kind(kind) {
+    DoInit();
+
+    _handlersToLearn = 2;
+    rtc::Thread::PostTask(RTC_FROM_HERE, [] {});
+    rtc::Thread::PostTask(webrtc::ToQueuedTask([] {}));
+}
+
+CountedThread::~CountedThread() {
+    // As rtc::Thread asks of its subclasses.
+    Stop();
+}
+
+void CountedThread::Post(const rtc::Location &posted_from, rtc::MessageHandler *phandler, uint32_t id, rtc::MessageData *pdata, bool time_sensitive) {
+    if (_handlersToLearn > 0) {
+        if (_handlersToLearn-- == 2) {
+            _taskHandler = phandler;
+        } else {
+            _queuedTaskHandler = phandler;
+        }
+        delete pdata;
+        return;
+    }
+    HotPathCounters::onTaskPosted(_kind);
+    rtc::Thread::Post(posted_from, phandler, id, account(phandler, pdata), time_sensitive);
+}
+
+void CountedThread::PostDelayed(const rtc::Location &posted_from, int delay_ms, rtc::MessageHandler *phandler, uint32_t id, rtc::MessageData *pdata) {
+    HotPathCounters::onTaskPosted(_kind);
+    rtc::Thread::PostDelayed(posted_from, delay_ms, phandler, id, account(phandler, pdata));
+}
+
+void CountedThread::Send(const rtc::Location &posted_from, rtc::MessageHandler *phandler, uint32_t id, rtc::MessageData *pdata) {
+    if (IsCurrent()) {
+        // Runs inline, blocking nobody.
+        rtc::Thread::Send(posted_from, phandler, id, pdata);
+        return;
+    }
+    const int64_t startUs = rtc::TimeMicros();
+    rtc::Thread::Send(posted_from, phandler, id, pdata);
+    const int64_t blockedUs = rtc::TimeMicros() - startUs;
+    HotPathCounters::onInvoke(_kind, blockedUs);
+    if (InvokeAudit::isEnabled()) {
+        InvokeAudit::record(posted_from.file_name(), posted_from.line_number(), posted_from.function_name(), _kind, blockedUs);
+    }
+}
+
+void CountedThread::Dispatch(rtc::Message *pmsg) {
+    CpuAccounting::setThread(accountThread(_kind));
+    rtc::Thread::Dispatch(pmsg);
+}
+
+rtc::MessageData *CountedThread::account(rtc::MessageHandler *phandler, rtc::MessageData *pdata) {
+    if (!pdata || !CpuAccounting::isEnabled()) {
+        return pdata;
+    }
+    const auto &account = CpuAccounting::current();
+    if (!account) {
+        return pdata;
+    }
+    if (phandler == _taskHandler) {
+        return new AccountedTask(pdata, account);
+    }
+    if (phandler == _queuedTaskHandler) {
+        auto &task = static_cast<rtc::ScopedMessageData<webrtc::QueuedTask> *>(pdata)->data();
+        if (task) {
+            task = std::make_unique<AccountedQueuedTask>(std::move(task), account);
+        }
+    }
+    return pdata;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,40 @@
+#ifndef TGCALLS_COUNTED_THREAD_H
+#define TGCALLS_COUNTED_THREAD_H
+
+#include "rtc_base/thread.h"
+
+#include "HotPathCounters.h"
+
+#include <memory>
+
+namespace tgcalls {
+
+// An rtc::Thread that counts, in HotPathCounters, the tasks and messages
+// posted to it (an Invoke() from another thread posts one as well) and the
+// Invoke()s onto it from other threads, with how long they blocked their
+// callers. With CpuAccounting enabled, tasks posted while a CpuAccount is
+// current are charged to it.
+class CountedThread : public rtc::Thread {
+public:
+    CountedThread(std::unique_ptr<rtc::SocketServer> socketServer, HotPathCounters::Thread kind);
+    ~CountedThread() override;
+
+    void Post(const rtc::Location &posted_from, rtc::MessageHandler *phandler, uint32_t id = 0, rtc::MessageData *pdata = nullptr, bool time_sensitive = false) override;
+    void PostDelayed(const rtc::Location &posted_from, int delay_ms, rtc::MessageHandler *phandler, uint32_t id = 0, rtc::MessageData *pdata = nullptr) override;
+    void Send(const rtc::Location &posted_from, rtc::MessageHandler *phandler, uint32_t id = 0, rtc::MessageData *pdata = nullptr) override;
+    void Dispatch(rtc::Message *pmsg) override;
+
+private:
+    rtc::MessageData *account(rtc::MessageHandler *phandler, rtc::MessageData *pdata);
+
+    const HotPathCounters::Thread _kind;
+    // The handlers rtc::Thread posts tasks with, which it keeps to itself;
+    // learnt by posting one of each kind from the constructor.
+    rtc::MessageHandler *_taskHandler = nullptr;
+    rtc::MessageHandler *_queuedTaskHandler = nullptr;
+    int _handlersToLearn = 0;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,116 @@
+#include "CpuAccounting.h"
+
+#include <time.h>
+
+#include <utility>
+
+namespace tgcalls {
+
+namespace {
+
+struct State {
+    std::shared_ptr<CpuAccount> account;
+    CpuAccount::Thread thread = CpuAccount::Thread::Network;
+    bool isCharging = false;
+    int64_t startNanos = 0;
+    // Of the pooled thread's task.
+    CpuAccount::Thread taskThread = CpuAccount::Thread::Worker;
+};
+
+thread_local State state;
+
+int64_t threadCpuNanos() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+// Charges the time of the current scope up to |now|.
+void chargeUntil(int64_t now) {
+    if (state.isCharging) {
+        state.account->add(state.thread, now - state.startNanos);
+        state.startNanos = now;
+    }
+}
+
+} // namespace
+
+CpuAccount::Usage CpuAccount::usage() const {
+    const auto us = [&](Thread thread) {
+        return _nanos[static_cast<size_t>(thread)].load(std::memory_order_relaxed) / 1000;
+    };
+    Usage usage;
+    usage.networkUs = us(Thread::Network);
+    usage.mediaUs = us(Thread::Media);
+    usage.workerUs = us(Thread::Worker);
+    usage.audioUs = us(Thread::Audio);
+    return usage;
+}
+
+std::atomic<bool> CpuAccounting::_isEnabled{false};
+
+void CpuAccounting::setEnabled(bool enabled) {
+    _isEnabled = enabled;
+}
+
+std::shared_ptr<CpuAccount> const &CpuAccounting::current() {
+    return state.account;
+}
+
+void CpuAccounting::setThread(CpuAccount::Thread thread) {
+    state.taskThread = thread;
+}
+
+CpuAccountScope::CpuAccountScope(std::shared_ptr<CpuAccount> account) {
+    _previousIsCharging = state.isCharging;
+    if (_previousIsCharging) {
+        chargeUntil(threadCpuNanos());
+        state.isCharging = false;
+    }
+    _previous = std::exchange(state.account, std::move(account));
+}
+
+CpuAccountScope::~CpuAccountScope() {
+    state.account = std::move(_previous);
+    if (_previousIsCharging) {
+        state.isCharging = true;
+        state.startNanos = threadCpuNanos();
+    }
+}
+
+CpuTimeScope::CpuTimeScope(std::shared_ptr<CpuAccount> const &account) :
+CpuTimeScope(account, state.taskThread) {
+}
+
+CpuTimeScope::CpuTimeScope(std::shared_ptr<CpuAccount> const &account, CpuAccount::Thread thread) {
+    if (!account || !CpuAccounting::isEnabled()) {
+        return;
+    }
+    _isActive = true;
+    const auto now = threadCpuNanos();
+    chargeUntil(now);
+    _previous = std::exchange(state.account, account);
+    _previousThread = std::exchange(state.thread, thread);
+    _previousIsCharging = std::exchange(state.isCharging, true);
+    state.startNanos = now;
+}
+
+CpuTimeScope::~CpuTimeScope() {
+    if (!_isActive) {
+        return;
+    }
+    const auto now = threadCpuNanos();
+    chargeUntil(now);
+    state.account = std::move(_previous);
+    state.thread = _previousThread;
+    state.isCharging = _previousIsCharging;
+    state.startNanos = now;
+}
+
+} // namespace tgcalls
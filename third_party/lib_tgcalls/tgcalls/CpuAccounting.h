@@ -0,0 +1,107 @@
+#ifndef TGCALLS_CPU_ACCOUNTING_H
+#define TGCALLS_CPU_ACCOUNTING_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace tgcalls {
+
+// Thread CPU time spent on behalf of one call on the threads it shares with
+// other calls.
+class CpuAccount {
+public:
+    enum class Thread {
+        Network,
+        Media,
+        Worker,
+        // The audio device threads, or the shared AudioPump.
+        Audio
+    };
+    static constexpr size_t kThreadCount = 4;
+
+    struct Usage {
+        int64_t networkUs = 0;
+        int64_t mediaUs = 0;
+        int64_t workerUs = 0;
+        int64_t audioUs = 0;
+
+        int64_t totalUs() const {
+            return networkUs + mediaUs + workerUs + audioUs;
+        }
+    };
+
+    void add(Thread thread, int64_t nanos) {
+        _nanos[static_cast<size_t>(thread)].fetch_add(nanos, std::memory_order_relaxed);
+    }
+
+    Usage usage() const;
+
+private:
+    std::atomic<int64_t> _nanos[kThreadCount] = {};
+};
+
+// Opt-in accounting of the CPU time of the pooled threads per call. Tasks
+// posted to a pooled thread or strand while an account is current run with
+// it current again and their thread CPU time charged to it, so the work a
+// call's own tasks start is charged to the call however far it spreads.
+// Off by default: when on, every such task costs an allocation and two
+// clock_gettime(CLOCK_THREAD_CPUTIME_ID) calls.
+class CpuAccounting {
+public:
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled() {
+        return _isEnabled.load(std::memory_order_relaxed);
+    }
+
+    // The account of the calling thread's scope, if any.
+    static std::shared_ptr<CpuAccount> const &current();
+
+    // Set by the pooled threads and strands before each task they run.
+    static void setThread(CpuAccount::Thread thread);
+
+private:
+    static std::atomic<bool> _isEnabled;
+};
+
+// Makes |account| current on the calling thread without charging its time,
+// for calls into a call from threads it doesn't share, and for the objects
+// that take the current account when created. Time charged by an enclosing
+// CpuTimeScope is paused meanwhile.
+class CpuAccountScope {
+public:
+    explicit CpuAccountScope(std::shared_ptr<CpuAccount> account);
+    ~CpuAccountScope();
+
+    CpuAccountScope(CpuAccountScope const &) = delete;
+    CpuAccountScope &operator=(CpuAccountScope const &) = delete;
+
+private:
+    std::shared_ptr<CpuAccount> _previous;
+    bool _previousIsCharging = false;
+};
+
+// Charges the calling thread's CPU time in the scope to |account| as
+// |thread| time while accounting is enabled, and makes it current. Time in
+// a nested scope is charged to that scope's account only.
+class CpuTimeScope {
+public:
+    // As the pooled thread or strand running the task.
+    explicit CpuTimeScope(std::shared_ptr<CpuAccount> const &account);
+    CpuTimeScope(std::shared_ptr<CpuAccount> const &account, CpuAccount::Thread thread);
+    ~CpuTimeScope();
+
+    CpuTimeScope(CpuTimeScope const &) = delete;
+    CpuTimeScope &operator=(CpuTimeScope const &) = delete;
+
+private:
+    bool _isActive = false;
+    std::shared_ptr<CpuAccount> _previous;
+    CpuAccount::Thread _previousThread = CpuAccount::Thread::Network;
+    bool _previousIsCharging = false;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,150 @@
+#include "CpuAffinity.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "rtc_base/logging.h"
+
+namespace tgcalls {
+
+#if defined(__linux__)
+
+namespace {
+
+// Parses a sysfs cpu list such as "0-3,8,10-11".
+CpuSet parseCpuList(std::string const &list) {
+    CpuSet result;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        auto dash = range.find('-');
+        int first = std::atoi(range.c_str());
+        int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; cpu++) {
+            result.push_back(cpu);
+        }
+    }
+    return result;
+}
+
+bool readCpuList(std::string const &path, CpuSet &result) {
+    std::ifstream file(path);
+    std::string list;
+    if (!file || !std::getline(file, list)) {
+        return false;
+    }
+    result = parseCpuList(list);
+    return true;
+}
+
+CpuSet allowedCpus() {
+    CpuSet result;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return result;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            result.push_back(cpu);
+        }
+    }
+    return result;
+}
+
+// Affinity of the process when it was first asked, so an empty set can
+// undo a binding.
+CpuSet const &processCpus() {
+    static const CpuSet cpus = allowedCpus();
+    return cpus;
+}
+
+} // namespace
+
+std::vector<CpuSet> GetCpuSets(CpuAffinityMode mode) {
+    std::vector<CpuSet> result;
+    if (mode == CpuAffinityMode::Off) {
+        return result;
+    }
+
+    const auto &allowed = processCpus();
+    const auto isAllowed = [&](int cpu) {
+        return std::binary_search(allowed.begin(), allowed.end(), cpu);
+    };
+
+    if (mode == CpuAffinityMode::PhysicalCore) {
+        for (int cpu : allowed) {
+            CpuSet siblings;
+            if (!readCpuList("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/thread_siblings_list", siblings)) {
+                siblings = { cpu };
+            }
+            siblings.erase(std::remove_if(siblings.begin(), siblings.end(), [&](int sibling) {
+                return !isAllowed(sibling);
+            }), siblings.end());
+            // Each core is listed once, by its first allowed thread.
+            if (!siblings.empty() && siblings.front() == cpu) {
+                result.push_back(std::move(siblings));
+            }
+        }
+    } else {
+        int nodeCount = 0;
+        for (int node = 0; ; node++) {
+            CpuSet cpus;
+            if (!readCpuList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", cpus)) {
+                break;
+            }
+            nodeCount++;
+            cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&](int cpu) {
+                return !isAllowed(cpu);
+            }), cpus.end());
+            if (!cpus.empty()) {
+                result.push_back(std::move(cpus));
+            }
+        }
+        if (nodeCount == 0) {
+            RTC_LOG(LS_WARNING) << "No NUMA topology in sysfs, CPU affinity is not applied";
+        }
+    }
+    return result;
+}
+
+bool SetCurrentThreadCpuSet(CpuSet const &cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus.empty() ? processCpus() : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) {
+        RTC_LOG(LS_WARNING) << "pthread_setaffinity_np failed: " << result;
+        return false;
+    }
+    return true;
+}
+
+#else
+
+std::vector<CpuSet> GetCpuSets(CpuAffinityMode mode) {
+    return {};
+}
+
+bool SetCurrentThreadCpuSet(CpuSet const &cpus) {
+    return false;
+}
+
+#endif
+
+} // namespace tgcalls
@@ -0,0 +1,29 @@
+#ifndef TGCALLS_CPU_AFFINITY_H
+#define TGCALLS_CPU_AFFINITY_H
+
+#include <vector>
+
+namespace tgcalls {
+
+// CPU numbers a thread may run on.
+using CpuSet = std::vector<int>;
+
+enum class CpuAffinityMode {
+    Off,
+    // One set per physical core, i.e. a core's hyperthreads together.
+    PhysicalCore,
+    NumaNode
+};
+
+// The sets of |mode| among the CPUs this process may use, read from sysfs.
+// Empty for Off, and wherever the topology isn't known (non-Linux).
+std::vector<CpuSet> GetCpuSets(CpuAffinityMode mode);
+
+// Binds the calling thread to |cpus|, or lets it use every CPU of the
+// process again for an empty set. Threads it creates afterwards inherit
+// the binding. False where pinning isn't supported.
+bool SetCurrentThreadCpuSet(CpuSet const &cpus);
+
+} // namespace tgcalls
+
+#endif
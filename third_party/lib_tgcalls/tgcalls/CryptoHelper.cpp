@@ -58,4 +58,37 @@ void AesProcessCtr(MemorySpan from, void *to, AesKeyIv &&aesKeyIv) {
 #endif
 }
 
+AesCtrContext::AesCtrContext() :
+_context(EVP_CIPHER_CTX_new()) {
+	if (_context && !EVP_EncryptInit_ex(_context, EVP_aes_256_ctr(), nullptr, nullptr, nullptr)) {
+		EVP_CIPHER_CTX_free(_context);
+		_context = nullptr;
+	}
+}
+
+AesCtrContext::~AesCtrContext() {
+	if (_context) {
+		EVP_CIPHER_CTX_free(_context);
+	}
+}
+
+void AesCtrContext::process(MemorySpan from, void *to, AesKeyIv &&aesKeyIv) {
+	if (!_context || !EVP_EncryptInit_ex(
+			_context,
+			nullptr,
+			nullptr,
+			reinterpret_cast<const unsigned char*>(aesKeyIv.key.data()),
+			reinterpret_cast<const unsigned char*>(aesKeyIv.iv.data()))) {
+		AesProcessCtr(from, to, std::move(aesKeyIv));
+		return;
+	}
+	auto length = 0;
+	EVP_EncryptUpdate(
+		_context,
+		reinterpret_cast<unsigned char*>(to),
+		&length,
+		reinterpret_cast<const unsigned char*>(from.data),
+		int(from.size));
+}
+
 } // namespace tgcalls
@@ -9,6 +9,7 @@ extern "C" {
 #endif
 #include <openssl/rand.h>
 #include <openssl/crypto.h>
+#include <openssl/evp.h>
 } // extern "C"
 
 #include <array>
@@ -63,6 +64,25 @@ inline std::array<uint8_t, kSha256Size> ConcatSHA256(Parts &&... parts) {
 AesKeyIv PrepareAesKeyIv(const uint8_t *key, const uint8_t *msgKey, int x);
 void AesProcessCtr(MemorySpan from, void *to, AesKeyIv &&aesKeyIv);
 
+// AES-256-CTR through a reused EVP context, which runs on the AES-NI /
+// ARMv8 implementation where the CPU has one and doesn't allocate per
+// packet. The key is new for every packet (it comes from msg_key), so
+// there is no key schedule to cache, only the cipher setup.
+class AesCtrContext {
+public:
+	AesCtrContext();
+	~AesCtrContext();
+
+	AesCtrContext(const AesCtrContext &) = delete;
+	AesCtrContext &operator=(const AesCtrContext &) = delete;
+
+	// Same as AesProcessCtr(); |to| may be |from.data|.
+	void process(MemorySpan from, void *to, AesKeyIv &&aesKeyIv);
+
+private:
+	EVP_CIPHER_CTX *_context = nullptr;
+};
+
 } // namespace tgcalls
 
 #endif
@@ -1,10 +1,13 @@
 #include "EncryptedConnection.h"
 
 #include "CryptoHelper.h"
+#include "HotPathLog.h"
 #include "rtc_base/logging.h"
 #include "rtc_base/byte_buffer.h"
 #include "rtc_base/time_utils.h"
 
+#include <cstring>
+
 namespace tgcalls {
 namespace {
 
@@ -17,6 +20,7 @@ constexpr auto kMaxAllowedCounter = std::numeric_limits<uint32_t>::max()
 static_assert(kMaxAllowedCounter < kSingleMessagePacketSeqBit, "bad");
 static_assert(kMaxAllowedCounter < kMessageRequiresAckSeqBit, "bad");
 
+constexpr auto kMsgKeySize = size_t(16);
 constexpr auto kAckSerializedSize = sizeof(uint32_t) + sizeof(uint8_t);
 constexpr auto kNotAckedMessagesLimit = 64 * 1024;
 constexpr auto kMaxIncomingPacketSize = 128 * 1024; // don't try decrypting more
@@ -34,9 +38,10 @@ constexpr auto kServiceCauseResend = 2;
 static constexpr uint8_t kAckId = uint8_t(-1);
 static constexpr uint8_t kEmptyId = uint8_t(-2);
 
-void AppendSeq(rtc::CopyOnWriteBuffer &buffer, uint32_t seq) {
+void AppendSeq(std::vector<uint8_t> &packet, uint32_t seq) {
     const auto bytes = rtc::HostToNetwork32(seq);
-    buffer.AppendData(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+    const auto data = reinterpret_cast<const uint8_t*>(&bytes);
+    packet.insert(packet.end(), data, data + sizeof(bytes));
 }
 
 void WriteSeq(void *bytes, uint32_t seq) {
@@ -84,19 +89,12 @@ _requestSendService(std::move(requestSendService)) {
 absl::optional<rtc::CopyOnWriteBuffer> EncryptedConnection::encryptRawPacket(rtc::CopyOnWriteBuffer const &buffer) {
     auto seq = ++_counter;
 
-    rtc::ByteBufferWriter writer;
-    writer.WriteUInt32(seq);
-
-    auto result = rtc::CopyOnWriteBuffer();
-    result.AppendData(writer.Data(), writer.Length());
-
-    result.AppendData(buffer);
-
-    auto encryptedPacket = encryptPrepared(result);
-
-    rtc::CopyOnWriteBuffer encryptedBuffer;
-    encryptedBuffer.AppendData(encryptedPacket.bytes.data(), encryptedPacket.bytes.size());
-    return encryptedBuffer;
+    auto result = rtc::CopyOnWriteBuffer(kMsgKeySize + sizeof(seq) + buffer.size());
+    const auto bytes = result.MutableData();
+    WriteSeq(bytes + kMsgKeySize, seq);
+    memcpy(bytes + kMsgKeySize + sizeof(seq), buffer.cdata(), buffer.size());
+    encryptInPlace(bytes, result.size());
+    return result;
 }
 
 absl::optional<rtc::CopyOnWriteBuffer> EncryptedConnection::decryptRawPacket(rtc::CopyOnWriteBuffer const &buffer) {
@@ -112,8 +110,9 @@ absl::optional<rtc::CopyOnWriteBuffer> EncryptedConnection::decryptRawPacket(rtc
 
     auto aesKeyIv = PrepareAesKeyIv(key, msgKey, x);
 
-    auto decryptionBuffer = rtc::Buffer(dataSize);
-    AesProcessCtr(
+    auto &decryptionBuffer = _decryptionBuffer;
+    decryptionBuffer.SetSize(dataSize);
+    _aes.process(
         MemorySpan{ encryptedData, dataSize },
         decryptionBuffer.data(),
         std::move(aesKeyIv));
@@ -139,6 +138,29 @@ absl::optional<rtc::CopyOnWriteBuffer> EncryptedConnection::decryptRawPacket(rtc
 
 auto EncryptedConnection::prepareForSending(const Message &message)
 -> absl::optional<EncryptedPacket> {
+    auto result = EncryptedPacket();
+    const auto counter = prepareForSending(message, result.bytes);
+    if (!counter) {
+        return absl::nullopt;
+    }
+    result.counter = *counter;
+    return result;
+}
+
+auto EncryptedConnection::prepareForSendingService(int cause)
+-> absl::optional<EncryptedPacket> {
+    auto result = EncryptedPacket();
+    const auto counter = prepareForSendingService(cause, result.bytes);
+    if (!counter) {
+        return absl::nullopt;
+    }
+    result.counter = *counter;
+    return result;
+}
+
+absl::optional<uint32_t> EncryptedConnection::prepareForSending(
+        const Message &message,
+        std::vector<uint8_t> &packet) {
     const auto messageRequiresAck = absl::visit([](const auto &data) {
         return std::decay_t<decltype(data)>::kRequiresAck;
     }, message.data);
@@ -151,43 +173,47 @@ auto EncryptedConnection::prepareForSending(const Message &message)
         return absl::nullopt;
     }
     const auto seq = *maybeSeq;
-    auto serialized = SerializeMessageWithSeq(message, seq, singleMessagePacket);
-    if (!enoughSpaceInPacket(serialized, 0)) {
-        return LogError("Too large packet: ", std::to_string(serialized.size()));
+    _serializeWriter.Clear();
+    SerializeMessageWithSeq(_serializeWriter, message, seq, singleMessagePacket);
+    const auto serialized = reinterpret_cast<const uint8_t*>(_serializeWriter.Data());
+    const auto serializedSize = _serializeWriter.Length();
+
+    startPacket(packet);
+    packet.insert(packet.end(), serialized, serialized + serializedSize);
+    if (!enoughSpaceInPacket(packet, 0)) {
+        return LogError("Too large packet: ", std::to_string(serializedSize));
     }
-    const auto notYetAckedCopy = messageRequiresAck
-        ? serialized
-        : rtc::CopyOnWriteBuffer();
     if (!messageRequiresAck) {
-        appendAdditionalMessages(serialized);
-        return encryptPrepared(serialized);
+        appendAdditionalMessages(packet);
+        return encryptInPlace(packet.data(), packet.size());
     }
-    const auto type = uint8_t(serialized.cdata()[4]);
+    const auto type = uint8_t(serialized[4]);
     const auto sendEnqueued = !_myNotYetAckedMessages.empty();
     if (sendEnqueued) {
         // All requiring ack messages should always be sent in order within
         // one packet, starting with the least not-yet-acked one.
         // So if we still have those, we send an empty message with all
         // requiring ack messages that will fit in correct order.
-        RTC_LOG(LS_INFO) << logHeader()
+        TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
             << "Enqueue SEND:type" << type << "#" << CounterFromSeq(seq);
     } else {
-        RTC_LOG(LS_INFO) << logHeader()
+        TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
             << "Add SEND:type" << type << "#" << CounterFromSeq(seq);
-        appendAdditionalMessages(serialized);
+        appendAdditionalMessages(packet);
     }
-    _myNotYetAckedMessages.push_back({ notYetAckedCopy, rtc::TimeMillis() });
+    enqueueNotAcked(serialized, serializedSize);
     if (!sendEnqueued) {
-        return encryptPrepared(serialized);
+        return encryptInPlace(packet.data(), packet.size());
     }
     for (auto &queued : _myNotYetAckedMessages) {
         queued.lastSent = 0;
     }
-    return prepareForSendingService(0);
+    return prepareForSendingService(0, packet);
 }
 
-auto EncryptedConnection::prepareForSendingService(int cause)
--> absl::optional<EncryptedPacket> {
+absl::optional<uint32_t> EncryptedConnection::prepareForSendingService(
+        int cause,
+        std::vector<uint8_t> &packet) {
     if (cause == kServiceCauseAcks) {
         _sendAcksTimerActive = false;
     } else if (cause == kServiceCauseResend) {
@@ -202,14 +228,15 @@ auto EncryptedConnection::prepareForSendingService(int cause)
     if (!seq) {
         return absl::nullopt;
     }
-    auto serialized = SerializeEmptyMessageWithSeq(*seq);
-    assert(enoughSpaceInPacket(serialized, 0));
+    startPacket(packet);
+    AppendEmptyMessageWithSeq(packet, *seq);
+    assert(enoughSpaceInPacket(packet, 0));
 
-    RTC_LOG(LS_INFO) << logHeader()
+    TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
         << "SEND:empty#" << CounterFromSeq(*seq);
 
-    appendAdditionalMessages(serialized);
-    return encryptPrepared(serialized);
+    appendAdditionalMessages(packet);
+    return encryptInPlace(packet.data(), packet.size());
 }
 
 bool EncryptedConnection::haveAdditionalMessages() const {
@@ -239,31 +266,37 @@ size_t EncryptedConnection::packetLimit() const {
     }
 }
 
-bool EncryptedConnection::enoughSpaceInPacket(const rtc::CopyOnWriteBuffer &buffer, size_t amount) const {
+bool EncryptedConnection::enoughSpaceInPacket(const std::vector<uint8_t> &packet, size_t amount) const {
     const auto limit = packetLimit();
     return (amount < limit)
-        && (16 + buffer.size() + amount <= limit);
+        && (packet.size() + amount <= limit);
+}
+
+void EncryptedConnection::startPacket(std::vector<uint8_t> &packet) const {
+    // The plaintext is assembled after room for msg_key and encrypted in
+    // place; clearing keeps the capacity for the next packet.
+    packet.assign(kMsgKeySize, 0);
 }
 
-void EncryptedConnection::appendAcksToSend(rtc::CopyOnWriteBuffer &buffer) {
+void EncryptedConnection::appendAcksToSend(std::vector<uint8_t> &packet) {
     auto i = _acksToSendSeqs.begin();
     while ((i != _acksToSendSeqs.end())
         && enoughSpaceInPacket(
-            buffer,
+            packet,
             kAckSerializedSize)) {
 
-        RTC_LOG(LS_INFO) << logHeader()
+        TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
             << "Add ACK#" << CounterFromSeq(*i);
 
-        AppendSeq(buffer, *i);
-        buffer.AppendData(&kAckId, 1);
+        AppendSeq(packet, *i);
+        packet.push_back(kAckId);
         ++i;
     }
     _acksToSendSeqs.erase(_acksToSendSeqs.begin(), i);
     for (const auto seq : _acksToSendSeqs) {
-        RTC_LOG(LS_INFO) << logHeader()
+        TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
             << "Skip ACK#" << CounterFromSeq(seq)
-            << " (no space, length: " << kAckSerializedSize << ", already: " << buffer.size() << ")";
+            << " (no space, length: " << kAckSerializedSize << ", already: " << (packet.size() - kMsgKeySize) << ")";
     }
 }
 
@@ -272,13 +305,13 @@ size_t EncryptedConnection::fullNotAckedLength() const {
 
     auto result = size_t();
     for (const auto &message : _myNotYetAckedMessages) {
-        result += message.data.size();
+        result += message.size;
     }
     return result;
 }
 
-void EncryptedConnection::appendAdditionalMessages(rtc::CopyOnWriteBuffer &buffer) {
-    appendAcksToSend(buffer);
+void EncryptedConnection::appendAdditionalMessages(std::vector<uint8_t> &packet) {
+    appendAcksToSend(packet);
 
     if (_myNotYetAckedMessages.empty()) {
         return;
@@ -291,23 +324,24 @@ void EncryptedConnection::appendAdditionalMessages(rtc::CopyOnWriteBuffer &buffe
             ? (sent + _delayIntervals.minDelayBeforeMessageResend)
             : 0;
 
-        assert(resending.data.size() >= 5);
-        const auto counter = CounterFromSeq(ReadSeq(resending.data.data()));
-        const auto type = uint8_t(resending.data.data()[4]);
+        assert(resending.size >= 5);
+        const auto data = notAckedData(resending);
+        const auto counter = CounterFromSeq(ReadSeq(data));
+        const auto type = uint8_t(data[4]);
         if (when > now) {
-            RTC_LOG(LS_INFO) << logHeader()
+            TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
                 << "Skip RESEND:type" << type << "#" << counter
                 << " (wait " << (when - now) << "ms).";
             break;
-        } else if (enoughSpaceInPacket(buffer, resending.data.size())) {
-            RTC_LOG(LS_INFO) << logHeader()
+        } else if (enoughSpaceInPacket(packet, resending.size)) {
+            TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
                 << "Add RESEND:type" << type << "#" << counter;
-            buffer.AppendData(resending.data);
+            packet.insert(packet.end(), data, data + resending.size);
             resending.lastSent = now;
         } else {
-            RTC_LOG(LS_INFO) << logHeader()
+            TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
                 << "Skip RESEND:type" << type << "#" << counter
-                << " (no space, length: " << resending.data.size() << ", already: " << buffer.size() << ")";
+                << " (no space, length: " << resending.size << ", already: " << (packet.size() - kMsgKeySize) << ")";
             break;
         }
     }
@@ -319,29 +353,64 @@ void EncryptedConnection::appendAdditionalMessages(rtc::CopyOnWriteBuffer &buffe
     }
 }
 
-auto EncryptedConnection::encryptPrepared(const rtc::CopyOnWriteBuffer &buffer)
--> EncryptedPacket {
-    auto result = EncryptedPacket();
-    result.counter = CounterFromSeq(ReadSeq(buffer.data()));
-    result.bytes.resize(16 + buffer.size());
+uint32_t EncryptedConnection::encryptInPlace(uint8_t *packet, size_t size) {
+    assert(size >= kMsgKeySize + sizeof(uint32_t));
+    const auto data = packet + kMsgKeySize;
+    const auto dataSize = size - kMsgKeySize;
+    const auto counter = CounterFromSeq(ReadSeq(data));
 
     const auto x = (_key.isOutgoing ? 0 : 8) + (_type == Type::Signaling ? 128 : 0);
     const auto key = _key.value->data();
 
     const auto msgKeyLarge = ConcatSHA256(
         MemorySpan{ key + 88 + x, 32 },
-        MemorySpan{ buffer.data(), buffer.size() });
-    const auto msgKey = result.bytes.data();
-    memcpy(msgKey, msgKeyLarge.data() + 8, 16);
+        MemorySpan{ data, dataSize });
+    const auto msgKey = packet;
+    memcpy(msgKey, msgKeyLarge.data() + 8, kMsgKeySize);
 
     auto aesKeyIv = PrepareAesKeyIv(key, msgKey, x);
 
-    AesProcessCtr(
-        MemorySpan{ buffer.data(), buffer.size() },
-        result.bytes.data() + 16,
+    // CTR mode is a keystream XOR, safe to run over its own output.
+    _aes.process(
+        MemorySpan{ data, dataSize },
+        data,
         std::move(aesKeyIv));
 
-    return result;
+    return counter;
+}
+
+const uint8_t *EncryptedConnection::notAckedData(const MessageForResend &message) const {
+    return _notAckedSlab.data() + message.offset;
+}
+
+void EncryptedConnection::enqueueNotAcked(const uint8_t *data, size_t size) {
+    _myNotYetAckedMessages.push_back({ _notAckedSlab.size(), size, rtc::TimeMillis() });
+    _notAckedSlab.insert(_notAckedSlab.end(), data, data + size);
+}
+
+void EncryptedConnection::eraseNotAcked(std::vector<MessageForResend>::iterator i) {
+    _notAckedSlabUnused += i->size;
+    _myNotYetAckedMessages.erase(i);
+    if (_myNotYetAckedMessages.empty()) {
+        _notAckedSlab.clear();
+        _notAckedSlabUnused = 0;
+    } else if (_notAckedSlabUnused > _notAckedSlab.size() / 2) {
+        // Messages lie in the slab in queue order, so moving each one down
+        // over the gaps before it never overwrites one still queued.
+        auto offset = size_t();
+        for (auto &message : _myNotYetAckedMessages) {
+            if (message.offset != offset) {
+                memmove(
+                    _notAckedSlab.data() + offset,
+                    _notAckedSlab.data() + message.offset,
+                    message.size);
+                message.offset = offset;
+            }
+            offset += message.size;
+        }
+        _notAckedSlab.resize(offset);
+        _notAckedSlabUnused = 0;
+    }
 }
 
 bool EncryptedConnection::registerIncomingCounter(uint32_t incomingCounter) {
@@ -382,8 +451,9 @@ auto EncryptedConnection::handleIncomingPacket(const char *bytes, size_t size)
 
     auto aesKeyIv = PrepareAesKeyIv(key, msgKey, x);
 
-    auto decryptionBuffer = rtc::Buffer(dataSize);
-    AesProcessCtr(
+    auto &decryptionBuffer = _decryptionBuffer;
+    decryptionBuffer.SetSize(dataSize);
+    _aes.process(
         MemorySpan{ encryptedData, dataSize },
         decryptionBuffer.data(),
         std::move(aesKeyIv));
@@ -432,7 +502,7 @@ auto EncryptedConnection::processPacket(
             if (additionalMessage) {
                 return LogError("Empty message should be only the first one in the packet.");
             }
-            RTC_LOG(LS_INFO) << logHeader()
+            TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
                 << "Got RECV:empty" << "#" << currentCounter;
             reader.Consume(1);
         } else if (type == kAckId) {
@@ -452,7 +522,7 @@ auto EncryptedConnection::processPacket(
                     newRequiringAckReceived = true;
                 }
                 sendAckPostponed(currentSeq);
-                RTC_LOG(LS_INFO) << logHeader()
+                TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
                     << (skipMessage ? "Repeated RECV:type" : "Got RECV:type") << type << "#" << currentCounter;
             }
             if (!skipMessage) {
@@ -515,7 +585,6 @@ bool EncryptedConnection::registerSentAck(uint32_t counter, bool firstInPacket)
     const auto position = std::lower_bound(list.begin(), list.end(), counter);
     const auto already = (position != list.end()) && (*position == counter);
 
-    const auto was = list;
     if (firstInPacket) {
         list.erase(list.begin(), position);
         if (!already) {
@@ -539,14 +608,15 @@ void EncryptedConnection::ackMyMessage(uint32_t seq) {
     auto type = uint8_t(0);
     auto &list = _myNotYetAckedMessages;
     for (auto i = list.begin(), e = list.end(); i != e; ++i) {
-        assert(i->data.size() >= 5);
-        if (ReadSeq(i->data.cdata()) == seq) {
-            type = uint8_t(i->data.cdata()[4]);
-            list.erase(i);
+        assert(i->size >= 5);
+        const auto data = notAckedData(*i);
+        if (ReadSeq(data) == seq) {
+            type = uint8_t(data[4]);
+            eraseNotAcked(i);
             break;
         }
     }
-    RTC_LOG(LS_INFO) << logHeader()
+    TGCALLS_HOT_PATH_LOG(LS_INFO) << logHeader()
         << (type ? "Got ACK:type" + std::to_string(type) + "#" : "Repeated ACK#")
         << CounterFromSeq(seq);
 }
@@ -565,12 +635,9 @@ auto EncryptedConnection::DelayIntervalsByType(Type type) -> DelayIntervals {
     return result;
 }
 
-rtc::CopyOnWriteBuffer EncryptedConnection::SerializeEmptyMessageWithSeq(uint32_t seq) {
-    auto result = rtc::CopyOnWriteBuffer(5);
-    auto bytes = result.MutableData();
-    WriteSeq(bytes, seq);
-    bytes[4] = kEmptyId;
-    return result;
+void EncryptedConnection::AppendEmptyMessageWithSeq(std::vector<uint8_t> &packet, uint32_t seq) {
+    AppendSeq(packet, seq);
+    packet.push_back(kEmptyId);
 }
 
 } // namespace tgcalls
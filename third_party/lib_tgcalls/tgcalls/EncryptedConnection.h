@@ -3,10 +3,10 @@
 
 #include "Instance.h"
 #include "Message.h"
+#include "CryptoHelper.h"
 
-namespace rtc {
-class ByteBufferReader;
-} // namespace rtc
+#include "rtc_base/buffer.h"
+#include "rtc_base/byte_buffer.h"
 
 namespace tgcalls {
 
@@ -28,6 +28,12 @@ public:
     absl::optional<EncryptedPacket> prepareForSending(const Message &message);
     absl::optional<EncryptedPacket> prepareForSendingService(int cause);
 
+    // Same as above, but the packet is assembled and encrypted in place in
+    // |packet|, whose capacity is kept from one call to the next, so a
+    // caller reusing it sends without allocating. Return the counter.
+    absl::optional<uint32_t> prepareForSending(const Message &message, std::vector<uint8_t> &packet);
+    absl::optional<uint32_t> prepareForSendingService(int cause, std::vector<uint8_t> &packet);
+
     struct DecryptedPacket {
         DecryptedMessage main;
         std::vector<DecryptedMessage> additional;
@@ -45,16 +51,22 @@ private:
         int maxDelayBeforeAckResend = 0;
     };
     struct MessageForResend {
-        rtc::CopyOnWriteBuffer data;
+        // Serialized message at [offset, offset + size) of _notAckedSlab.
+        size_t offset = 0;
+        size_t size = 0;
         int64_t lastSent = 0;
     };
 
-    bool enoughSpaceInPacket(const rtc::CopyOnWriteBuffer &buffer, size_t amount) const;
+    bool enoughSpaceInPacket(const std::vector<uint8_t> &packet, size_t amount) const;
     size_t packetLimit() const;
     size_t fullNotAckedLength() const;
-    void appendAcksToSend(rtc::CopyOnWriteBuffer &buffer);
-    void appendAdditionalMessages(rtc::CopyOnWriteBuffer &buffer);
-    EncryptedPacket encryptPrepared(const rtc::CopyOnWriteBuffer &buffer);
+    void startPacket(std::vector<uint8_t> &packet) const;
+    void appendAcksToSend(std::vector<uint8_t> &packet);
+    void appendAdditionalMessages(std::vector<uint8_t> &packet);
+    uint32_t encryptInPlace(uint8_t *packet, size_t size);
+    const uint8_t *notAckedData(const MessageForResend &message) const;
+    void enqueueNotAcked(const uint8_t *data, size_t size);
+    void eraseNotAcked(std::vector<MessageForResend>::iterator i);
     bool registerIncomingCounter(uint32_t incomingCounter);
     absl::optional<DecryptedPacket> processPacket(const rtc::Buffer &fullBuffer, uint32_t packetSeq);
     bool registerSentAck(uint32_t counter, bool firstInPacket);
@@ -70,7 +82,7 @@ private:
     const char *logHeader() const;
 
     static DelayIntervals DelayIntervalsByType(Type type);
-    static rtc::CopyOnWriteBuffer SerializeEmptyMessageWithSeq(uint32_t seq);
+    static void AppendEmptyMessageWithSeq(std::vector<uint8_t> &packet, uint32_t seq);
 
     Type _type = Type();
     EncryptionKey _key;
@@ -81,6 +93,11 @@ private:
     std::vector<uint32_t> _acksToSendSeqs;
     std::vector<uint32_t> _acksSentCounters;
     std::vector<MessageForResend> _myNotYetAckedMessages;
+    std::vector<uint8_t> _notAckedSlab;
+    size_t _notAckedSlabUnused = 0;
+    rtc::ByteBufferWriter _serializeWriter;
+    rtc::Buffer _decryptionBuffer;
+    AesCtrContext _aes;
     std::function<void(int delayMs, int cause)> _requestSendService;
     bool _resendTimerActive = false;
     bool _sendAcksTimerActive = false;
@@ -48,7 +48,9 @@ class FakeAudioDeviceModuleImpl : public webrtc::webrtc_impl::AudioDeviceModuleD
   }
 
   ~FakeAudioDeviceModuleImpl() override {
+    // Both, or a scheduled recording task outlives the module.
     StopPlayout();
+    StopRecording();
   }
 
   int32_t PlayoutIsAvailable(bool* available) override {
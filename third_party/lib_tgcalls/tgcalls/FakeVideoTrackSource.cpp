@@ -15,13 +15,6 @@ int HEIGHT = 720;
 
 class ChessFrameSource : public FrameSource {
 public:
-  ChessFrameSource() {
-    int N = 100;
-    frames_.reserve(N);
-    for (int i = 0; i < N; i++) {
-      frames_.push_back(genFrame(i, N));
-    }
-  }
   Info info() const override{
     return Info{WIDTH, HEIGHT};
   }
@@ -31,23 +24,18 @@ public:
 //  }
   void next_frame_rgb0(char *buf, double *pts) override {
     *pts = 0;
-    i = (i + 1) % frames_.size();
-    size_t size = WIDTH * HEIGHT * 4;
-    memcpy(buf, frames_[i].rbga.get(), size);
+    i = (i + 1) % N;
+    genFrame(i, N, reinterpret_cast<std::uint8_t *>(buf));
   }
 
 private:
-  struct Frame {
-    webrtc::VideoFrame frame;
-    std::unique_ptr<std::uint8_t[]> rbga;
-  };
-  std::vector<Frame> frames_;
-  size_t i = 0;
-  Frame genFrame(int i, int n) {
+  // Frames of the rotation are drawn as they are sent rather than kept
+  // around, which took hundreds of megabytes at 720p.
+  static constexpr int N = 100;
+  int i = 0;
+  void genFrame(int i, int n, std::uint8_t *bytes) {
     int width = WIDTH;
     int height = HEIGHT;
-    auto bytes_ptr = std::make_unique<std::uint8_t[]>(width * height * 4);
-    auto bytes = bytes_ptr.get();
     auto set_rgb = [&](int x, int y, std::uint8_t r, std::uint8_t g, std::uint8_t b) {
       auto dest = bytes + (x * width + y) * 4;
       dest[0] = r;
@@ -76,13 +64,6 @@ private:
         set_rgb(i, j, color, color, color);
       }
     }
-
-    rtc::scoped_refptr<webrtc::I420Buffer> buffer = webrtc::I420Buffer::Create(width, height);
-
-    libyuv::RGBAToI420(bytes, width * 4, buffer->MutableDataY(), buffer->StrideY(), buffer->MutableDataU(),
-                       buffer->StrideU(), buffer->MutableDataV(), buffer->StrideV(), width, height);
-
-    return Frame{webrtc::VideoFrame::Builder().set_video_frame_buffer(buffer).build(), std::move(bytes_ptr)};
   }
 
 };
@@ -91,11 +72,16 @@ webrtc::VideoFrame FrameSource::next_frame() {
   auto info = this->info();
   auto height = info.height;
   auto width = info.width;
-  auto bytes_ptr = std::make_unique<std::uint8_t[]>(width * height * 4);
+  size_t size = static_cast<size_t>(width) * height * 4;
+  if (rgb0_size_ != size) {
+    rgb0_ = std::make_unique<std::uint8_t[]>(size);
+    rgb0_size_ = size;
+  }
   double pts;
-  next_frame_rgb0(reinterpret_cast<char *>(bytes_ptr.get()), &pts);
-  rtc::scoped_refptr<webrtc::I420Buffer> buffer = webrtc::I420Buffer::Create(width, height);
-  libyuv::ABGRToI420(bytes_ptr.get(), width * 4, buffer->MutableDataY(), buffer->StrideY(), buffer->MutableDataU(),
+  next_frame_rgb0(reinterpret_cast<char *>(rgb0_.get()), &pts);
+  // The pool only grows while the encoder still holds every buffer it has.
+  rtc::scoped_refptr<webrtc::I420Buffer> buffer = pool_.CreateI420Buffer(width, height);
+  libyuv::ABGRToI420(rgb0_.get(), width * 4, buffer->MutableDataY(), buffer->StrideY(), buffer->MutableDataU(),
                      buffer->StrideU(), buffer->MutableDataV(), buffer->StrideV(), width, height);
   return webrtc::VideoFrame::Builder().set_timestamp_us(static_cast<int64_t>(pts * 1000000)).set_video_frame_buffer(buffer).build();
 }
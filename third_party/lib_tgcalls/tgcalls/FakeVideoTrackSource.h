@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <string>
+
+#include "common_video/include/video_frame_buffer_pool.h"
 
 namespace webrtc {
 class VideoTrackSourceInterface;
@@ -24,6 +29,12 @@ public:
 
   static std::unique_ptr<FrameSource> chess();
   static std::unique_ptr<FrameSource> from_file(std::string path);
+
+private:
+  // Reused by next_frame() for every frame of the same size.
+  std::unique_ptr<std::uint8_t[]> rgb0_;
+  size_t rgb0_size_ = 0;
+  webrtc::VideoFrameBufferPool pool_;
 };
 
 class FakeVideoTrackSource {
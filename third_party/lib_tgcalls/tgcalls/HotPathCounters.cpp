@@ -0,0 +1,192 @@
+#include "HotPathCounters.h"
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+
+namespace tgcalls {
+
+namespace {
+
+// Threads past this many share shards, which costs contention only.
+constexpr size_t kShardCount = 32;
+
+// Where each counter, and each of its label values, is in a shard.
+constexpr size_t kAudioTicksLate = 0;
+constexpr size_t kAudioTicksDropped = kAudioTicksLate + 5;
+constexpr size_t kFramesDelivered = kAudioTicksDropped + 5;
+constexpr size_t kFramesDropped = kFramesDelivered + 4;
+constexpr size_t kPacketsReceived = kFramesDropped + 4;
+constexpr size_t kPacketsDropped = kPacketsReceived + 1;
+constexpr size_t kTaskPosts = kPacketsDropped + 6;
+constexpr size_t kInvokes = kTaskPosts + 3;
+constexpr size_t kInvokeBlockedUs = kInvokes + 3;
+constexpr size_t kBroadcastPartsFetched = kInvokeBlockedUs + 3;
+constexpr size_t kBroadcastPartsDecoded = kBroadcastPartsFetched + 1;
+constexpr size_t kBroadcastPartsLate = kBroadcastPartsDecoded + 1;
+constexpr size_t kJitterBufferExpands = kBroadcastPartsLate + 1;
+constexpr size_t kCounterCount = kJitterBufferExpands + 2;
+
+struct Metric {
+    const char *name;
+    const char *help;
+    size_t first;
+    // Null for a counter without labels.
+    const char *label;
+    std::array<const char *, 6> values;
+    // Kept in microseconds, shown in seconds.
+    bool isMicroseconds;
+};
+
+constexpr Metric kMetrics[] = {
+    { "tgcalls_audio_ticks_late_total", "Audio device ticks served late, in a catch-up burst.", kAudioTicksLate,
+        "device", { "file", "raw", "ring", "mixer", "other" }, false },
+    { "tgcalls_audio_ticks_dropped_total", "Audio device ticks skipped past the catch-up limit.", kAudioTicksDropped,
+        "device", { "file", "raw", "ring", "mixer", "other" }, false },
+    { "tgcalls_frames_delivered_total", "Media frames handed on to their consumer.", kFramesDelivered,
+        "kind", { "incoming_audio", "broadcast_audio", "video", "playout_file" }, false },
+    { "tgcalls_frames_dropped_total", "Media frames dropped for a full queue.", kFramesDropped,
+        "kind", { "incoming_audio", "broadcast_audio", "video", "playout_file" }, false },
+    { "tgcalls_packets_received_total", "Packets read from call transports.", kPacketsReceived,
+        nullptr, {}, false },
+    { "tgcalls_packets_dropped_total", "Received packets dropped before reaching webrtc.", kPacketsDropped,
+        "reason", { "sctp", "malformed", "own_ssrc", "not_opus", "incoming_disabled", "unrouted" }, false },
+    { "tgcalls_task_posts_total", "Tasks posted to pooled threads and strands.", kTaskPosts,
+        "thread", { "network", "media", "worker" }, false },
+    { "tgcalls_invokes_total", "Blocking invokes onto pooled threads and strands.", kInvokes,
+        "thread", { "network", "media", "worker" }, false },
+    { "tgcalls_invoke_blocked_seconds_total", "Time callers spent blocked in invokes.", kInvokeBlockedUs,
+        "thread", { "network", "media", "worker" }, true },
+    { "tgcalls_broadcast_parts_fetched_total", "Broadcast parts received with data.", kBroadcastPartsFetched,
+        nullptr, {}, false },
+    { "tgcalls_broadcast_parts_decoded_total", "Broadcast parts decoded.", kBroadcastPartsDecoded,
+        nullptr, {}, false },
+    { "tgcalls_broadcast_parts_late_total", "Broadcast parts that came too late to be played.", kBroadcastPartsLate,
+        nullptr, {}, false },
+    { "tgcalls_jitter_buffer_expands_total", "Times playout started concealing missing audio.", kJitterBufferExpands,
+        "buffer", { "rtc", "broadcast" }, false },
+};
+
+struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, kCounterCount> values{};
+};
+
+Shard shards[kShardCount];
+std::atomic<size_t> nextShard{0};
+
+Shard &currentShard() {
+    thread_local Shard &shard = shards[nextShard.fetch_add(1, std::memory_order_relaxed) % kShardCount];
+    return shard;
+}
+
+void add(size_t counter, uint64_t value) {
+    currentShard().values[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+// See threadJitterBufferExpands().
+thread_local uint64_t threadExpands = 0;
+
+template <typename Enum>
+size_t at(size_t first, Enum value) {
+    return first + static_cast<size_t>(value);
+}
+
+} // namespace
+
+void HotPathCounters::onAudioTicksLate(AudioDevice device, uint64_t ticks) {
+    add(at(kAudioTicksLate, device), ticks);
+}
+
+void HotPathCounters::onAudioTicksDropped(AudioDevice device, uint64_t ticks) {
+    add(at(kAudioTicksDropped, device), ticks);
+}
+
+void HotPathCounters::onFrameDelivered(FrameKind kind) {
+    add(at(kFramesDelivered, kind), 1);
+}
+
+void HotPathCounters::onFrameDropped(FrameKind kind) {
+    add(at(kFramesDropped, kind), 1);
+}
+
+void HotPathCounters::onPacketsReceived(uint64_t packets) {
+    add(kPacketsReceived, packets);
+}
+
+void HotPathCounters::onPacketDropped(PacketDropReason reason) {
+    add(at(kPacketsDropped, reason), 1);
+}
+
+void HotPathCounters::onTaskPosted(Thread thread) {
+    add(at(kTaskPosts, thread), 1);
+}
+
+void HotPathCounters::onInvoke(Thread thread, int64_t blockedUs) {
+    add(at(kInvokes, thread), 1);
+    if (blockedUs > 0) {
+        add(at(kInvokeBlockedUs, thread), static_cast<uint64_t>(blockedUs));
+    }
+}
+
+void HotPathCounters::onBroadcastPartFetched() {
+    add(kBroadcastPartsFetched, 1);
+}
+
+void HotPathCounters::onBroadcastPartDecoded() {
+    add(kBroadcastPartsDecoded, 1);
+}
+
+void HotPathCounters::onBroadcastPartLate() {
+    add(kBroadcastPartsLate, 1);
+}
+
+void HotPathCounters::onJitterBufferExpand(JitterBuffer jitterBuffer) {
+    add(at(kJitterBufferExpands, jitterBuffer), 1);
+    threadExpands++;
+}
+
+uint64_t HotPathCounters::threadJitterBufferExpands() {
+    return threadExpands;
+}
+
+uint64_t HotPathCounters::audioTicksBehind() {
+    uint64_t total = 0;
+    for (const auto &shard : shards) {
+        for (size_t i = kAudioTicksLate; i < kFramesDelivered; i++) {
+            total += shard.values[i].load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+std::string HotPathCounters::snapshot() {
+    std::array<uint64_t, kCounterCount> totals{};
+    for (const auto &shard : shards) {
+        for (size_t i = 0; i < kCounterCount; i++) {
+            totals[i] += shard.values[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    std::string result;
+    char value[32];
+    for (const auto &metric : kMetrics) {
+        result.append("# HELP ").append(metric.name).append(" ").append(metric.help).append("\n");
+        result.append("# TYPE ").append(metric.name).append(" counter\n");
+        for (size_t i = 0; i == 0 || (metric.label && i < metric.values.size() && metric.values[i]); i++) {
+            const auto total = totals[metric.first + i];
+            if (metric.isMicroseconds) {
+                snprintf(value, sizeof(value), "%.6f", static_cast<double>(total) / 1000000.0);
+            } else {
+                snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(total));
+            }
+            result.append(metric.name);
+            if (metric.label) {
+                result.append("{").append(metric.label).append("=\"").append(metric.values[i]).append("\"}");
+            }
+            result.append(" ").append(value).append("\n");
+        }
+    }
+    return result;
+}
+
+} // namespace tgcalls
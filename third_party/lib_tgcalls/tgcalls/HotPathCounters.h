@@ -0,0 +1,97 @@
+#ifndef TGCALLS_HOT_PATH_COUNTERS_H
+#define TGCALLS_HOT_PATH_COUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+namespace tgcalls {
+
+// Process-wide counters of the media hot paths, summed over every call, to
+// alert on capacity problems before they are heard. Each thread adds to a
+// shard of its own with relaxed atomics, so counting is an uncontended add
+// on cache lines no other thread writes to; snapshot() sums the shards when
+// asked. Counters only ever grow.
+class HotPathCounters {
+public:
+    enum class AudioDevice {
+        File,
+        Raw,
+        Ring,
+        Mixer,
+        Other
+    };
+
+    enum class FrameKind {
+        // Decoded participant audio handed to an incoming audio tap.
+        IncomingAudio,
+        // Decoded broadcast audio pulled by the playout mixer directly.
+        BroadcastAudio,
+        // Incoming video frames handed to Python.
+        Video,
+        // Playout frames written to a file asynchronously.
+        PlayoutFile
+    };
+
+    enum class PacketDropReason {
+        // Dropped by the network thread before reaching the media thread.
+        Sctp,
+        Malformed,
+        OwnSsrc,
+        NotOpus,
+        IncomingDisabled,
+        // Received on a shared socket from an address no call claimed.
+        Unrouted
+    };
+
+    enum class Thread {
+        Network,
+        Media,
+        Worker
+    };
+
+    enum class JitterBuffer {
+        // NetEq of an incoming RTC stream, once it starts concealing loss.
+        Rtc,
+        // A direct broadcast source running out of decoded frames.
+        Broadcast
+    };
+
+    // Ticks an AudioDeadlineClock served late in a catch-up burst, and ticks
+    // it skipped.
+    static void onAudioTicksLate(AudioDevice device, uint64_t ticks);
+    static void onAudioTicksDropped(AudioDevice device, uint64_t ticks);
+
+    static void onFrameDelivered(FrameKind kind);
+    static void onFrameDropped(FrameKind kind);
+
+    // Every packet read from a call's transport, before decryption.
+    static void onPacketsReceived(uint64_t packets);
+    static void onPacketDropped(PacketDropReason reason);
+
+    // Tasks and messages posted to a pooled thread or strand, and Invoke()s
+    // onto one from another thread, with how long the caller was blocked.
+    static void onTaskPosted(Thread thread);
+    static void onInvoke(Thread thread, int64_t blockedUs);
+
+    // Parts received with data, parts decoded, and parts that came too late
+    // to be played.
+    static void onBroadcastPartFetched();
+    static void onBroadcastPartDecoded();
+    static void onBroadcastPartLate();
+
+    static void onJitterBufferExpand(JitterBuffer jitterBuffer);
+    // Expansions counted on the calling thread so far, so that an audio
+    // device can tell those its own pulls of the playout mix started.
+    static uint64_t threadJitterBufferExpands();
+
+    // Late and dropped ticks of every audio device so far, summed for
+    // watching them without parsing snapshot().
+    static uint64_t audioTicksBehind();
+
+    // Every counter, in the Prometheus text exposition format.
+    static std::string snapshot();
+};
+
+} // namespace tgcalls
+
+#endif
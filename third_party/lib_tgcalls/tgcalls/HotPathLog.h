@@ -0,0 +1,16 @@
+#ifndef TGCALLS_HOT_PATH_LOG_H
+#define TGCALLS_HOT_PATH_LOG_H
+
+#include "rtc_base/logging.h"
+
+// RTC_LOG for lines logged per packet, frame or signaling message. Like
+// RTC_LOG, it evaluates nothing unless a sink wants the severity, see
+// LogSinkOptions::minSeverity; built with TGCALLS_STRIP_HOT_PATH_LOGS, its
+// verbose and info lines aren't even compiled in. Warnings and errors stay.
+#if defined(TGCALLS_STRIP_HOT_PATH_LOGS)
+#define TGCALLS_HOT_PATH_LOG(sev) (::rtc::sev > ::rtc::LS_INFO) && RTC_LOG(sev)
+#else
+#define TGCALLS_HOT_PATH_LOG(sev) RTC_LOG(sev)
+#endif
+
+#endif
@@ -228,6 +228,10 @@ struct Descriptor {
     std::function<void(float)> remotePrefferedAspectRatioUpdated;
 	std::function<void(const std::vector<uint8_t> &)> signalingDataEmitted;
 	std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory*)> createAudioDeviceModule;
+    // Called every |statsUpdateIntervalMs| with the call's current stats,
+    // once it has started. Only InstanceV2Impl reports them.
+    std::function<void(CallStatsSnapshot const &)> statsUpdated;
+    int statsUpdateIntervalMs = 5000;
 };
 
 class Meta {
@@ -0,0 +1,90 @@
+#include "InvokeAudit.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace tgcalls {
+
+namespace {
+
+struct Site {
+    const char *function = nullptr;
+    uint64_t invokes = 0;
+    int64_t totalBlockedUs = 0;
+    int64_t maxBlockedUs = 0;
+};
+
+using SiteKey = std::tuple<const char *, int, HotPathCounters::Thread>;
+
+struct Sites {
+    std::mutex mutex;
+    std::map<SiteKey, Site> sites;
+};
+
+Sites &auditedSites() {
+    static Sites *sites = new Sites();
+    return *sites;
+}
+
+const char *threadName(HotPathCounters::Thread thread) {
+    switch (thread) {
+        case HotPathCounters::Thread::Network:
+            return "network";
+        case HotPathCounters::Thread::Media:
+            return "media";
+        case HotPathCounters::Thread::Worker:
+            return "worker";
+    }
+    return "unknown";
+}
+
+} // namespace
+
+std::atomic<bool> InvokeAudit::_isEnabled{false};
+
+void InvokeAudit::setEnabled(bool enabled) {
+    _isEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void InvokeAudit::record(const char *file, int line, const char *function, HotPathCounters::Thread thread, int64_t blockedUs) {
+    auto &audited = auditedSites();
+    std::lock_guard<std::mutex> lock(audited.mutex);
+    auto &site = audited.sites[SiteKey(file, line, thread)];
+    site.function = function;
+    site.invokes++;
+    site.totalBlockedUs += blockedUs;
+    site.maxBlockedUs = std::max(site.maxBlockedUs, blockedUs);
+}
+
+std::vector<InvokeSiteStats> InvokeAudit::sites() {
+    std::vector<InvokeSiteStats> result;
+    {
+        auto &audited = auditedSites();
+        std::lock_guard<std::mutex> lock(audited.mutex);
+        result.reserve(audited.sites.size());
+        for (const auto &it : audited.sites) {
+            InvokeSiteStats stats;
+            stats.location = std::string(std::get<0>(it.first)) + ":" + std::to_string(std::get<1>(it.first));
+            stats.function = it.second.function ? it.second.function : "";
+            stats.thread = threadName(std::get<2>(it.first));
+            stats.invokes = it.second.invokes;
+            stats.totalBlockedUs = it.second.totalBlockedUs;
+            stats.maxBlockedUs = it.second.maxBlockedUs;
+            result.push_back(std::move(stats));
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const InvokeSiteStats &lhs, const InvokeSiteStats &rhs) {
+        return lhs.totalBlockedUs > rhs.totalBlockedUs;
+    });
+    return result;
+}
+
+void InvokeAudit::reset() {
+    auto &audited = auditedSites();
+    std::lock_guard<std::mutex> lock(audited.mutex);
+    audited.sites.clear();
+}
+
+} // namespace tgcalls
@@ -0,0 +1,48 @@
+#ifndef TGCALLS_INVOKE_AUDIT_H
+#define TGCALLS_INVOKE_AUDIT_H
+
+#include "HotPathCounters.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tgcalls {
+
+struct InvokeSiteStats {
+    // Where the Invoke() is, as file:line, and the function it is in.
+    std::string location;
+    std::string function;
+    // The thread invoked.
+    std::string thread;
+    uint64_t invokes = 0;
+    int64_t totalBlockedUs = 0;
+    int64_t maxBlockedUs = 0;
+};
+
+// Opt-in accounting of the time callers spend blocked in Invoke()s onto the
+// pooled threads and strands, per call site, to find the ones worth making
+// asynchronous. Off by default: when on, every invoke takes a lock.
+class InvokeAudit {
+public:
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled() {
+        return _isEnabled.load(std::memory_order_relaxed);
+    }
+
+    // |file| and |function| are kept as pointers, as rtc::Location has them.
+    static void record(const char *file, int line, const char *function, HotPathCounters::Thread thread, int64_t blockedUs);
+
+    // Most total time blocked first.
+    static std::vector<InvokeSiteStats> sites();
+    static void reset();
+
+private:
+    static std::atomic<bool> _isEnabled;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,110 @@
+#include "LatencyTrace.h"
+
+#include <algorithm>
+
+namespace tgcalls {
+
+void LatencyTrace::record(Stage stage, int64_t durationUs) {
+    auto &histogram = _stages[static_cast<size_t>(stage)];
+    histogram.buckets[bucketIndex(durationUs)].fetch_add(1, std::memory_order_relaxed);
+    // A single writer per stage, so a plain compare is enough.
+    if (durationUs > histogram.maxUs.load(std::memory_order_relaxed)) {
+        histogram.maxUs.store(durationUs, std::memory_order_relaxed);
+    }
+}
+
+void LatencyTrace::onFrameCaptured(int64_t timeUs) {
+    _pendingCaptureUs.store(timeUs, std::memory_order_relaxed);
+}
+
+void LatencyTrace::onAudioPacketSent(int64_t sendStartUs, int64_t timeUs) {
+    record(Stage::Send, timeUs - sendStartUs);
+    // Only the first packet after a capture is attributed to it; Opus
+    // packs two frames, so every other capture has no packet of its own.
+    const auto captureUs = _pendingCaptureUs.exchange(0, std::memory_order_relaxed);
+    if (captureUs != 0) {
+        record(Stage::CaptureToWire, timeUs - captureUs);
+    }
+}
+
+std::vector<LatencyTrace::StageSummary> LatencyTrace::summarize() const {
+    std::vector<StageSummary> result;
+    result.reserve(kStageCount);
+    for (size_t stage = 0; stage < kStageCount; stage++) {
+        const auto &histogram = _stages[stage];
+        std::array<uint64_t, kBucketCount> counts;
+        StageSummary summary;
+        summary.name = stageName(static_cast<Stage>(stage));
+        for (size_t i = 0; i < kBucketCount; i++) {
+            counts[i] = histogram.buckets[i].load(std::memory_order_relaxed);
+            summary.count += counts[i];
+        }
+        summary.maxUs = histogram.maxUs.load(std::memory_order_relaxed);
+
+        const auto percentile = [&](uint64_t rank) {
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBucketCount; i++) {
+                seen += counts[i];
+                if (seen >= rank) {
+                    return std::min(bucketUpperBound(i), summary.maxUs);
+                }
+            }
+            return summary.maxUs;
+        };
+        if (summary.count != 0) {
+            summary.p50Us = percentile((summary.count + 1) / 2);
+            summary.p99Us = percentile(std::max<uint64_t>(1, (summary.count * 99 + 99) / 100));
+        }
+        result.push_back(std::move(summary));
+    }
+    return result;
+}
+
+void LatencyTrace::reset() {
+    for (auto &histogram : _stages) {
+        for (auto &bucket : histogram.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        histogram.maxUs.store(0, std::memory_order_relaxed);
+    }
+}
+
+const char *LatencyTrace::stageName(Stage stage) {
+    switch (stage) {
+        case Stage::Capture:
+            return "capture";
+        case Stage::CaptureToWire:
+            return "captureToWire";
+        case Stage::Send:
+            return "send";
+        case Stage::Receive:
+            return "receive";
+        case Stage::Playout:
+            return "playout";
+    }
+    return "";
+}
+
+size_t LatencyTrace::bucketIndex(int64_t durationUs) {
+    if (durationUs < 4) {
+        return durationUs > 0 ? static_cast<size_t>(durationUs) : 0;
+    }
+    size_t octave = 2;
+    while (octave < 62 && (durationUs >> (octave + 1)) != 0) {
+        octave++;
+    }
+    const auto sub = static_cast<size_t>((durationUs >> (octave - 2)) & 3);
+    return std::min(kBucketCount - 1, 4 * (octave - 1) + sub);
+}
+
+int64_t LatencyTrace::bucketUpperBound(size_t index) {
+    if (index < 4) {
+        return static_cast<int64_t>(index);
+    }
+    const auto octave = index / 4 + 1;
+    const auto sub = static_cast<int64_t>(index % 4);
+    const auto lower = (4 + sub) << (octave - 2);
+    return lower + (int64_t(1) << (octave - 2)) - 1;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,77 @@
+#ifndef TGCALLS_LATENCY_TRACE_H
+#define TGCALLS_LATENCY_TRACE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tgcalls {
+
+// Opt-in timing of the audio path of one call, kept as a histogram per
+// stage. Each stage is written from a single thread (the audio device's
+// capture or playout thread, or the network thread) and has its own cache
+// lines, so recording is a couple of relaxed atomic adds without any lock
+// or contention; summarize() may be called from any thread.
+class LatencyTrace {
+public:
+    enum class Stage {
+        // Handing a captured 10 ms frame to the AudioDeviceBuffer, which
+        // runs audio processing and queues it for the encoder.
+        Capture,
+        // From the last captured frame until the audio RTP packet it
+        // completed leaves the socket: encoder queue, encoding, pacer and
+        // thread hops included.
+        CaptureToWire,
+        // SRTP protection and the socket send of an audio RTP packet.
+        Send,
+        // From the socket read of an audio RTP packet until it is decrypted
+        // and demuxed on the network thread.
+        Receive,
+        // Pulling a 10 ms frame for playout: NetEq decoding and mixing.
+        Playout,
+    };
+    static constexpr size_t kStageCount = 5;
+
+    struct StageSummary {
+        std::string name;
+        uint64_t count = 0;
+        // Bucket upper bounds, so within ~20% above the true value.
+        int64_t p50Us = 0;
+        int64_t p99Us = 0;
+        int64_t maxUs = 0;
+    };
+
+    void record(Stage stage, int64_t durationUs);
+
+    // Capture thread, once a frame has been delivered.
+    void onFrameCaptured(int64_t timeUs);
+    // Network thread, after an audio RTP packet was sent at |sendStartUs|.
+    void onAudioPacketSent(int64_t sendStartUs, int64_t timeUs);
+
+    std::vector<StageSummary> summarize() const;
+    void reset();
+
+    static const char *stageName(Stage stage);
+
+private:
+    // Four buckets per power of two up to ~8 s.
+    static constexpr size_t kBucketCount = 88;
+
+    static size_t bucketIndex(int64_t durationUs);
+    static int64_t bucketUpperBound(size_t index);
+
+    struct alignas(64) StageHistogram {
+        std::array<std::atomic<uint64_t>, kBucketCount> buckets{};
+        std::atomic<int64_t> maxUs{0};
+    };
+
+    std::array<StageHistogram, kStageCount> _stages;
+    // Time of the last captured frame not yet matched with a sent packet.
+    alignas(64) std::atomic<int64_t> _pendingCaptureUs{0};
+};
+
+} // namespace tgcalls
+
+#endif
@@ -2,21 +2,412 @@
 
 #include "Instance.h"
 
-#ifdef WEBRTC_WIN
-#include "windows.h"
+#include "rtc_base/time_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <ctime>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tgcalls {
+namespace {
+
+// Queued messages beyond this are dropped instead of growing without bound
+// when the disk can't keep up.
+constexpr int64_t kMaxPendingBytes = 32 * 1024 * 1024;
+constexpr auto kWriterInterval = std::chrono::milliseconds(25);
+
+std::mutex &optionsMutex() {
+	static std::mutex mutex;
+	return mutex;
+}
+
+LogSinkOptions &sharedOptions() {
+	static LogSinkOptions options;
+	return options;
+}
+
+std::tm localTime(time_t seconds) {
+	std::tm result;
+#ifdef WEBRTC_WIN
+	localtime_s(&result, &seconds);
 #else // WEBRTC_WIN
-#include <sys/time.h>
+	localtime_r(&seconds, &result);
 #endif // WEBRTC_WIN
+	return result;
+}
 
-namespace tgcalls {
+// The "2021-3-14 9:26:53:" part of a line only changes once a second, so
+// it is formatted again only then.
+class TimestampFormatter {
+public:
+	void append(std::string &to, int64_t timeUs) {
+		const auto seconds = timeUs / 1000000;
+		if (seconds != _seconds) {
+			_seconds = seconds;
+			const auto timeinfo = localTime(static_cast<time_t>(seconds));
+			char buffer[64];
+			const auto length = snprintf(buffer, sizeof(buffer), "%d-%d-%d %d:%d:%d:",
+				timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+				timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+			_prefix.assign(buffer, length > 0 ? static_cast<size_t>(length) : 0);
+		}
+		to.append(_prefix);
+		to.append(std::to_string((timeUs / 1000) % 1000));
+		to.push_back(' ');
+	}
+
+private:
+	int64_t _seconds = -1;
+	std::string _prefix;
+};
+
+} // namespace
+
+// A log file written by the writer thread only.
+class AsyncLogFile {
+public:
+	AsyncLogFile(std::string path, LogSinkOptions const &options) :
+	_path(std::move(path)),
+	_maxFileBytes(options.maxFileBytes),
+	_maxRotatedFiles(options.maxRotatedFiles) {
+		open();
+	}
+
+	~AsyncLogFile() {
+		if (_file) {
+			fclose(_file);
+		}
+	}
+
+	void write(std::string const &line) {
+		if (_maxFileBytes > 0 && _size > 0 && _size + (int64_t)line.size() > _maxFileBytes) {
+			rotate();
+		}
+		if (!_file) {
+			return;
+		}
+		fwrite(line.data(), 1, line.size(), _file);
+		_size += line.size();
+	}
+
+	void flush() {
+		if (_file) {
+			fflush(_file);
+		}
+	}
+
+private:
+	void open() {
+		_file = fopen(_path.c_str(), "wb");
+		if (_file) {
+			setvbuf(_file, nullptr, _IOFBF, 64 * 1024);
+		}
+		_size = 0;
+	}
+
+	std::string rotatedPath(int index) const {
+		return _path + "." + std::to_string(index);
+	}
+
+	void rotate() {
+		if (_file) {
+			fclose(_file);
+			_file = nullptr;
+		}
+		if (_maxRotatedFiles > 0) {
+			std::remove(rotatedPath(_maxRotatedFiles).c_str());
+			for (int i = _maxRotatedFiles - 1; i >= 1; i--) {
+				std::rename(rotatedPath(i).c_str(), rotatedPath(i + 1).c_str());
+			}
+			std::rename(_path.c_str(), rotatedPath(1).c_str());
+		}
+		open();
+	}
+
+	std::string _path;
+	int64_t _maxFileBytes = 0;
+	int _maxRotatedFiles = 0;
+	FILE *_file = nullptr;
+	int64_t _size = 0;
+};
+
+namespace {
+
+struct LogEntry {
+	LogEntry *next = nullptr;
+	AsyncLogFile *file = nullptr;
+	int64_t timeUs = 0;
+	std::string message;
+	// Written in the shared log's tab-separated format when set.
+	char severity = 0;
+	uint32_t callId = 0;
+	// Set by a sink going away: the file is closed once it is the last
+	// entry of it, and the sink is told everything was written.
+	std::shared_ptr<AsyncLogFile> release;
+	std::promise<void> *written = nullptr;
+};
+
+// The process-wide writer. Producers push onto a lock-free stack; the
+// thread takes the whole stack at once every kWriterInterval, restores
+// the order and writes it out with one flush per file.
+class AsyncLogWriter {
+public:
+	static AsyncLogWriter &shared() {
+		// Never destroyed, the thread lives as long as the process.
+		static auto writer = new AsyncLogWriter();
+		return *writer;
+	}
+
+	void push(LogEntry *entry) {
+		if (!entry->written) {
+			const auto pending = _pendingBytes.fetch_add(entry->message.size(), std::memory_order_relaxed);
+			if (pending > kMaxPendingBytes) {
+				_pendingBytes.fetch_sub(entry->message.size(), std::memory_order_relaxed);
+				_droppedMessages.fetch_add(1, std::memory_order_relaxed);
+				delete entry;
+				return;
+			}
+		}
+		entry->next = _head.load(std::memory_order_relaxed);
+		while (!_head.compare_exchange_weak(entry->next, entry, std::memory_order_release, std::memory_order_relaxed)) {
+		}
+	}
+
+private:
+	AsyncLogWriter() : _thread([this] { run(); }) {
+		_thread.detach();
+	}
+
+	void run() {
+		std::vector<LogEntry *> batch;
+		std::vector<AsyncLogFile *> touched;
+		std::string line;
+		while (true) {
+			auto head = _head.exchange(nullptr, std::memory_order_acquire);
+			if (!head) {
+				std::this_thread::sleep_for(kWriterInterval);
+				continue;
+			}
+			batch.clear();
+			for (auto entry = head; entry; entry = entry->next) {
+				batch.push_back(entry);
+			}
+
+			touched.clear();
+			for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+				auto entry = *it;
+				if (!entry->message.empty()) {
+					line.clear();
+					if (const auto dropped = _droppedMessages.exchange(0, std::memory_order_relaxed)) {
+						const auto notice = "(tgcalls) " + std::to_string(dropped) + " log messages dropped\n";
+						if (entry->severity) {
+							appendStructured(line, entry->timeUs, 'W', 0, notice);
+						} else {
+							_timestamps.append(line, entry->timeUs);
+							line.append(notice);
+						}
+					}
+					if (entry->severity) {
+						appendStructured(line, entry->timeUs, entry->severity, entry->callId, entry->message);
+					} else {
+						_timestamps.append(line, entry->timeUs);
+						line.append(entry->message);
+					}
+					entry->file->write(line);
+					_pendingBytes.fetch_sub(entry->message.size(), std::memory_order_relaxed);
+					if (touched.empty() || touched.back() != entry->file) {
+						touched.push_back(entry->file);
+					}
+				}
+				if (entry->release) {
+					entry->release->flush();
+					touched.erase(std::remove(touched.begin(), touched.end(), entry->file), touched.end());
+					entry->release = nullptr;
+				}
+				if (entry->written) {
+					entry->written->set_value();
+				}
+				delete entry;
+			}
+			std::sort(touched.begin(), touched.end());
+			touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+			for (const auto file : touched) {
+				file->flush();
+			}
+		}
+	}
+
+	static void appendStructured(std::string &line, int64_t timeUs, char severity, uint32_t callId, std::string const &message) {
+		line.append(std::to_string(timeUs));
+		line.push_back('\t');
+		line.push_back(severity);
+		line.push_back('\t');
+		if (callId != 0) {
+			line.append(std::to_string(callId));
+		} else {
+			line.push_back('-');
+		}
+		line.push_back('\t');
+		auto length = message.size();
+		while (length != 0 && message[length - 1] == '\n') {
+			length--;
+		}
+		for (size_t i = 0; i < length; i++) {
+			const auto c = message[i];
+			switch (c) {
+				case '\t':
+					line.append("\\t");
+					break;
+				case '\n':
+					line.append("\\n");
+					break;
+				case '\\':
+					line.append("\\\\");
+					break;
+				default:
+					line.push_back(c);
+					break;
+			}
+		}
+		line.push_back('\n');
+	}
+
+	std::atomic<LogEntry *> _head{nullptr};
+	std::atomic<int64_t> _pendingBytes{0};
+	std::atomic<uint64_t> _droppedMessages{0};
+	TimestampFormatter _timestamps;
+	std::thread _thread;
+};
+
+void closeLogFile(std::shared_ptr<AsyncLogFile> &&file) {
+	std::promise<void> written;
+	auto entry = new LogEntry();
+	entry->file = file.get();
+	entry->release = std::move(file);
+	entry->written = &written;
+	AsyncLogWriter::shared().push(entry);
+	written.get_future().wait();
+}
+
+char severityLetter(rtc::LoggingSeverity severity) {
+	switch (severity) {
+		case rtc::LS_VERBOSE:
+			return 'V';
+		case rtc::LS_INFO:
+			return 'I';
+		case rtc::LS_WARNING:
+			return 'W';
+		case rtc::LS_ERROR:
+			return 'E';
+		default:
+			return 'S';
+	}
+}
+
+} // namespace
+
+// The one sink attached to webrtc while any call logs into the shared
+// file; calls only hold a reference to it.
+class SharedLogStream final : public rtc::LogSink {
+public:
+	// The stream of |path|, created if no call is using it.
+	static std::shared_ptr<SharedLogStream> acquire(std::string const &path, LogSinkOptions const &options) {
+		static std::mutex mutex;
+		static std::weak_ptr<SharedLogStream> current;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto stream = current.lock();
+		if (!stream || stream->_path != path) {
+			stream = std::make_shared<SharedLogStream>(path, options);
+			current = stream;
+		}
+		return stream;
+	}
+
+	SharedLogStream(std::string const &path, LogSinkOptions const &options) :
+	_path(path),
+	_file(std::make_shared<AsyncLogFile>(path, options)) {
+		rtc::LogMessage::AddLogToStream(this, options.minSeverity);
+	}
+
+	~SharedLogStream() {
+		rtc::LogMessage::RemoveLogToStream(this);
+		closeLogFile(std::move(_file));
+	}
+
+	uint32_t openCall(std::string const &logPath) {
+		const auto callId = _nextCallId.fetch_add(1, std::memory_order_relaxed);
+		write(rtc::LS_INFO, callId, "call " + std::to_string(callId) + " opened " + logPath);
+		return callId;
+	}
+
+	void closeCall(uint32_t callId) {
+		write(rtc::LS_INFO, callId, "call " + std::to_string(callId) + " closed");
+	}
+
+	void OnLogMessage(const std::string &msg, rtc::LoggingSeverity severity, const char *tag) override {
+		write(severity, 0, std::string(tag) + ": " + msg);
+	}
+
+	void OnLogMessage(const std::string &message, rtc::LoggingSeverity severity) override {
+		write(severity, 0, message);
+	}
+
+	void OnLogMessage(const std::string &message) override {
+		write(rtc::LS_INFO, 0, message);
+	}
+
+private:
+	void write(rtc::LoggingSeverity severity, uint32_t callId, std::string message) {
+		auto entry = new LogEntry();
+		entry->file = _file.get();
+		entry->timeUs = rtc::TimeUTCMicros();
+		entry->message = std::move(message);
+		entry->severity = severityLetter(severity);
+		entry->callId = callId;
+		AsyncLogWriter::shared().push(entry);
+	}
+
+	std::string _path;
+	std::shared_ptr<AsyncLogFile> _file;
+	std::atomic<uint32_t> _nextCallId{1};
+};
 
 LogSinkImpl::LogSinkImpl(const FilePath &logPath) {
-	if (!logPath.data.empty()) {
-		_file.open(logPath.data);
+	const auto options = Options();
+	if (!options.sharedLogPath.empty()) {
+		_shared = SharedLogStream::acquire(options.sharedLogPath, options);
+		_callId = _shared->openCall(logPath.data);
+	} else if (!logPath.data.empty()) {
+		_file = std::make_shared<AsyncLogFile>(logPath.data, options);
 	}
 }
 
+LogSinkImpl::~LogSinkImpl() {
+	if (_shared) {
+		_shared->closeCall(_callId);
+	}
+	if (_file) {
+		closeLogFile(std::move(_file));
+	}
+}
+
+void LogSinkImpl::SetOptions(LogSinkOptions const &options) {
+	std::lock_guard<std::mutex> lock(optionsMutex());
+	sharedOptions() = options;
+}
+
+LogSinkOptions LogSinkImpl::Options() {
+	std::lock_guard<std::mutex> lock(optionsMutex());
+	return sharedOptions();
+}
+
 void LogSinkImpl::OnLogMessage(const std::string &msg, rtc::LoggingSeverity severity, const char *tag) {
 	OnLogMessage(std::string(tag) + ": " + msg);
 }
@@ -26,45 +417,27 @@ void LogSinkImpl::OnLogMessage(const std::string &message, rtc::LoggingSeverity
 }
 
 void LogSinkImpl::OnLogMessage(const std::string &message) {
-	time_t rawTime;
-	time(&rawTime);
-	struct tm timeinfo;
-
-#ifdef WEBRTC_WIN
-	localtime_s(&timeinfo, &rawTime);
-
-	FILETIME ft;
-	unsigned __int64 full = 0;
-	GetSystemTimeAsFileTime(&ft);
-
-	full |= ft.dwHighDateTime;
-	full <<= 32;
-	full |= ft.dwLowDateTime;
-
-	const auto deltaEpochInMicrosecs = 11644473600000000Ui64;
-	full -= deltaEpochInMicrosecs;
-	full /= 10;
-	int32_t milliseconds = (long)(full % 1000000UL) / 1000;
-#else
-	timeval curTime = { 0 };
-	localtime_r(&rawTime, &timeinfo);
-	gettimeofday(&curTime, nullptr);
-	int32_t milliseconds = curTime.tv_usec / 1000;
-#endif
+	if (_shared) {
+		return;
+	}
+	const auto timeUs = rtc::TimeUTCMicros();
+	if (_file) {
+		auto entry = new LogEntry();
+		entry->file = _file.get();
+		entry->timeUs = timeUs;
+		entry->message = message;
+		AsyncLogWriter::shared().push(entry);
+		return;
+	}
 
-	auto &stream = _file.is_open() ? (std::ostream&)_file : _data;
-	stream
-		<< (timeinfo.tm_year + 1900)
-		<< "-" << (timeinfo.tm_mon + 1)
-		<< "-" << (timeinfo.tm_mday)
-		<< " " << timeinfo.tm_hour
-		<< ":" << timeinfo.tm_min
-		<< ":" << timeinfo.tm_sec
-		<< ":" << milliseconds
-		<< " " << message;
+	// webrtc calls sinks one at a time, so the in-memory log needs no lock.
+	std::string line;
+	TimestampFormatter().append(line, timeUs);
+	line.append(message);
+	_data << line;
 
 #if DEBUG
-    printf("%d-%d-%d %d:%d:%d:%d %s\n", timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday, timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, milliseconds, message.c_str());
+	printf("%s\n", line.c_str());
 #endif
 }
 
@@ -2,15 +2,54 @@
 #define TGCALLS_LOG_SINK_IMPL_H
 
 #include "rtc_base/logging.h"
-#include <fstream>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
 
 namespace tgcalls {
 
 struct FilePath;
+class AsyncLogFile;
+class SharedLogStream;
 
+struct LogSinkOptions {
+	// Messages below this are dropped before webrtc even formats them.
+	rtc::LoggingSeverity minSeverity = rtc::LS_INFO;
+	// A log file is rotated once it grows past this many bytes, 0 for
+	// never; the last |maxRotatedFiles| are kept as <path>.1, <path>.2...
+	int64_t maxFileBytes = 0;
+	int maxRotatedFiles = 3;
+	// When set, calls open no files of their own. webrtc's log is process
+	// wide, so every per-call file gets every call's lines anyway; instead
+	// each line is written once to this file, as
+	//
+	//     <unix time us> TAB <severity V/I/W/E> TAB <call id or -> TAB <message>
+	//
+	// with tabs, newlines and backslashes in the message escaped. webrtc's
+	// lines carry no call, so their id is -; each call is tagged on the
+	// "call <id> opened <its log path>" and "call <id> closed" lines.
+	std::string sharedLogPath;
+};
+
+// Logs to a file, or to memory without a path. File output is queued and
+// written by one process-wide thread, so the webrtc thread that logged,
+// often a network or audio one, never waits for the disk.
 class LogSinkImpl final : public rtc::LogSink {
 public:
 	LogSinkImpl(const FilePath &logPath);
+	// Waits until everything logged so far has been written.
+	~LogSinkImpl();
+
+	// Whether this call writes into the shared log, which is attached to
+	// webrtc by itself; the sink then needs no AddLogToStream().
+	bool isShared() const {
+		return _shared != nullptr;
+	}
+
+	// Process-wide; sinks created afterwards use them.
+	static void SetOptions(LogSinkOptions const &options);
+	static LogSinkOptions Options();
 
 	void OnLogMessage(const std::string &msg, rtc::LoggingSeverity severity, const char *tag) override;
 	void OnLogMessage(const std::string &message, rtc::LoggingSeverity severity) override;
@@ -21,7 +60,9 @@ public:
 	}
 
 private:
-	std::ofstream _file;
+	std::shared_ptr<AsyncLogFile> _file;
+	std::shared_ptr<SharedLogStream> _shared;
+	uint32_t _callId = 0;
 	std::ostringstream _data;
 
 };
@@ -8,6 +8,7 @@
 #include "Message.h"
 #include "platform/PlatformInterface.h"
 #include "StaticThreads.h"
+#include "HotPathLog.h"
 
 #include "api/audio_codecs/audio_decoder_factory_template.h"
 #include "api/audio_codecs/audio_encoder_factory_template.h"
@@ -825,7 +826,7 @@ void MediaManager::receiveMessage(DecryptedMessage &&message) {
 		setPeerVideoFormats(std::move(*formats));
 	} else if (const auto audio = absl::get_if<AudioDataMessage>(data)) {
         if (IsRtcp(audio->data.data(), audio->data.size())) {
-            RTC_LOG(LS_VERBOSE) << "Deliver audio RTCP";
+            TGCALLS_HOT_PATH_LOG(LS_VERBOSE) << "Deliver audio RTCP";
         }
         _call->Receiver()->DeliverPacket(webrtc::MediaType::AUDIO, audio->data, -1);
 	} else if (const auto video = absl::get_if<VideoDataMessage>(data)) {
@@ -939,7 +940,7 @@ bool MediaManager::NetworkInterfaceImpl::SendRtcp(rtc::CopyOnWriteBuffer *packet
 
 bool MediaManager::NetworkInterfaceImpl::sendTransportMessage(rtc::CopyOnWriteBuffer *packet, const rtc::PacketOptions& options) {
     if (_isVideo) {
-        RTC_LOG(LS_VERBOSE) << "Send video packet";
+        TGCALLS_HOT_PATH_LOG(LS_VERBOSE) << "Send video packet";
     }
 	_mediaManager->_sendTransportMessage(_isVideo
 		? Message{ VideoDataMessage{ *packet } }
@@ -348,16 +348,24 @@ bool TryDeserializeRecursive(
 } // namespace
 
 
-rtc::CopyOnWriteBuffer SerializeMessageWithSeq(
+void SerializeMessageWithSeq(
+		rtc::ByteBufferWriter &to,
 		const Message &message,
 		uint32_t seq,
 		bool singleMessagePacket) {
-	rtc::ByteBufferWriter writer;
-	writer.WriteUInt32(seq);
+	to.WriteUInt32(seq);
 	absl::visit([&](const auto &data) {
-		writer.WriteUInt8(std::decay_t<decltype(data)>::kId);
-		Serialize(writer, data, singleMessagePacket);
+		to.WriteUInt8(std::decay_t<decltype(data)>::kId);
+		Serialize(to, data, singleMessagePacket);
 	}, message.data);
+}
+
+rtc::CopyOnWriteBuffer SerializeMessageWithSeq(
+		const Message &message,
+		uint32_t seq,
+		bool singleMessagePacket) {
+	rtc::ByteBufferWriter writer;
+	SerializeMessageWithSeq(writer, message, seq, singleMessagePacket);
 
 	auto result = rtc::CopyOnWriteBuffer();
 	result.AppendData(writer.Data(), writer.Length());
@@ -124,6 +124,11 @@ rtc::CopyOnWriteBuffer SerializeMessageWithSeq(
 	const Message &message,
 	uint32_t seq,
 	bool singleMessagePacket);
+void SerializeMessageWithSeq(
+	rtc::ByteBufferWriter &to,
+	const Message &message,
+	uint32_t seq,
+	bool singleMessagePacket);
 absl::optional<Message> DeserializeMessage(
 	rtc::ByteBufferReader &reader,
 	bool singleMessagePacket);
@@ -5,15 +5,16 @@
 #include "p2p/base/basic_packet_socket_factory.h"
 #include "p2p/client/basic_port_allocator.h"
 #include "p2p/base/p2p_transport_channel.h"
-#include "p2p/base/basic_async_resolver_factory.h"
+#include "api/async_resolver_factory.h"
 #include "api/packet_socket_factory.h"
 #include "rtc_base/task_utils/to_queued_task.h"
 #include "p2p/base/ice_credentials_iterator.h"
 #include "api/jsep_ice_candidate.h"
-#include "rtc_base/network_monitor_factory.h"
 
 #include "TurnCustomizerImpl.h"
+#include "TurnNonceCache.h"
 #include "platform/PlatformInterface.h"
+#include "SharedNetworkEnvironment.h"
 
 extern "C" {
 #include <openssl/sha.h>
@@ -90,8 +91,6 @@ _transportMessageReceived(std::move(transportMessageReceived)),
 _sendSignalingMessage(std::move(sendSignalingMessage)),
 _localIceParameters(rtc::CreateRandomString(cricket::ICE_UFRAG_LENGTH), rtc::CreateRandomString(cricket::ICE_PWD_LENGTH)) {
 	assert(_thread->IsCurrent());
-
-    _networkMonitorFactory = PlatformInterface::SharedInstance()->createNetworkMonitorFactory();
 }
 
 NetworkManager::~NetworkManager() {
@@ -109,13 +108,13 @@ NetworkManager::~NetworkManager() {
 void NetworkManager::start() {
     _socketFactory.reset(new rtc::BasicPacketSocketFactory(_thread));
 
-    _networkManager = std::make_unique<rtc::BasicNetworkManager>(_networkMonitorFactory.get());
+    _networkManager = SharedNetworkEnvironment::networkManager(_thread);
     
     if (_enableStunMarking) {
         _turnCustomizer.reset(new TurnCustomizerImpl());
     }
     
-    _portAllocator.reset(new cricket::BasicPortAllocator(_networkManager.get(), _socketFactory.get(), _turnCustomizer.get(), nullptr));
+    _portAllocator.reset(new cricket::BasicPortAllocator(_networkManager.get(), _socketFactory.get(), _turnCustomizer.get(), TurnNonceCache::relayPortFactory()));
 
     uint32_t flags = _portAllocator->flags();
     
@@ -168,7 +167,7 @@ void NetworkManager::start() {
 
     _portAllocator->SetConfiguration(stunServers, turnServers, 2, webrtc::NO_PRUNE, _turnCustomizer.get());
 
-    _asyncResolverFactory = std::make_unique<webrtc::BasicAsyncResolverFactory>();
+    _asyncResolverFactory = SharedNetworkEnvironment::createAsyncResolverFactory();
     _transportChannel.reset(new cricket::P2PTransportChannel("transport", 0, _portAllocator.get(), _asyncResolverFactory.get(), nullptr));
 
     cricket::IceConfig iceConfig;
@@ -224,20 +223,20 @@ void NetworkManager::receiveSignalingMessage(DecryptedMessage &&message) {
 }
 
 uint32_t NetworkManager::sendMessage(const Message &message) {
-	if (const auto prepared = _transport.prepareForSending(message)) {
+	if (const auto counter = _transport.prepareForSending(message, _sendBuffer)) {
 		rtc::PacketOptions packetOptions;
-		_transportChannel->SendPacket((const char *)prepared->bytes.data(), prepared->bytes.size(), packetOptions, 0);
-        addTrafficStats(prepared->bytes.size(), false);
-		return prepared->counter;
+		_transportChannel->SendPacket((const char *)_sendBuffer.data(), _sendBuffer.size(), packetOptions, 0);
+        addTrafficStats(_sendBuffer.size(), false);
+		return *counter;
 	}
 	return 0;
 }
 
 void NetworkManager::sendTransportService(int cause) {
-	if (const auto prepared = _transport.prepareForSendingService(cause)) {
+	if (_transport.prepareForSendingService(cause, _sendBuffer)) {
 		rtc::PacketOptions packetOptions;
-		_transportChannel->SendPacket((const char *)prepared->bytes.data(), prepared->bytes.size(), packetOptions, 0);
-        addTrafficStats(prepared->bytes.size(), false);
+		_transportChannel->SendPacket((const char *)_sendBuffer.data(), _sendBuffer.size(), packetOptions, 0);
+        addTrafficStats(_sendBuffer.size(), false);
 	}
 }
 
@@ -29,7 +29,7 @@ class IceTransportInternal;
 } // namespace cricket
 
 namespace webrtc {
-class BasicAsyncResolverFactory;
+class AsyncResolverFactory;
 class TurnCustomizer;
 } // namespace webrtc
 
@@ -89,17 +89,19 @@ private:
     std::vector<RtcServer> _rtcServers;
     std::unique_ptr<Proxy> _proxy;
 	EncryptedConnection _transport;
+	// Reused for every outgoing transport packet.
+	std::vector<uint8_t> _sendBuffer;
 	bool _isOutgoing = false;
 	std::function<void(const NetworkManager::State &)> _stateUpdated;
 	std::function<void(DecryptedMessage &&)> _transportMessageReceived;
 	std::function<void(Message &&)> _sendSignalingMessage;
 
-    std::unique_ptr<rtc::NetworkMonitorFactory> _networkMonitorFactory;
 	std::unique_ptr<rtc::BasicPacketSocketFactory> _socketFactory;
-	std::unique_ptr<rtc::BasicNetworkManager> _networkManager;
+	// Shared with the other transports on |_thread|.
+	std::shared_ptr<rtc::BasicNetworkManager> _networkManager;
     std::unique_ptr<webrtc::TurnCustomizer> _turnCustomizer;
 	std::unique_ptr<cricket::BasicPortAllocator> _portAllocator;
-	std::unique_ptr<webrtc::BasicAsyncResolverFactory> _asyncResolverFactory;
+	std::unique_ptr<webrtc::AsyncResolverFactory> _asyncResolverFactory;
 	std::unique_ptr<cricket::P2PTransportChannel> _transportChannel;
 
     PeerIceParameters _localIceParameters;
@@ -0,0 +1,199 @@
+#include "OverloadController.h"
+
+#include "HotPathCounters.h"
+#include "StaticThreads.h"
+
+#include "rtc_base/logging.h"
+#include "rtc_base/thread.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace tgcalls {
+
+namespace {
+
+// On the steady clock rather than rtc::TimeMicros(), which a SimulatedClock
+// moves in jumps.
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// A task posted to one pooled thread, and how long it waited to run.
+struct Probe {
+    int64_t postedUs = 0;
+    std::atomic<int64_t> lagUs{-1};
+};
+
+struct Controller {
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    OverloadController::Config config;
+    OverloadController::Stats stats;
+    bool isEnabled = false;
+    std::thread thread;
+
+    // Controller thread only.
+    std::map<rtc::Thread *, std::shared_ptr<Probe>> probes;
+    uint64_t audioTicksBehind = 0;
+    int overloadedChecks = 0;
+    int healthyChecks = 0;
+};
+
+Controller &controller() {
+    static Controller *controller = new Controller();
+    return *controller;
+}
+
+// The longest wait of the probes posted by the last check, counting those
+// still waiting up to now, and the next probes posted. A thread whose probe
+// hasn't run keeps it rather than getting another.
+int64_t measureThreadLagUs(Controller &state) {
+    const int64_t now = nowUs();
+    int64_t maxLagUs = 0;
+    for (const auto &it : state.probes) {
+        const int64_t lagUs = it.second->lagUs.load(std::memory_order_relaxed);
+        maxLagUs = std::max(maxLagUs, lagUs >= 0 ? lagUs : now - it.second->postedUs);
+    }
+
+    std::map<rtc::Thread *, std::shared_ptr<Probe>> probes;
+    Threads::forEachPooledThread([&](rtc::Thread *thread) {
+        const auto it = state.probes.find(thread);
+        if (it != state.probes.end() && it->second->lagUs.load(std::memory_order_relaxed) < 0) {
+            probes.emplace(thread, it->second);
+            return;
+        }
+        auto probe = std::make_shared<Probe>();
+        probe->postedUs = now;
+        thread->PostTask(RTC_FROM_HERE, [probe] {
+            probe->lagUs.store(nowUs() - probe->postedUs, std::memory_order_relaxed);
+        });
+        probes.emplace(thread, std::move(probe));
+    });
+    state.probes = std::move(probes);
+    return maxLagUs;
+}
+
+void check(Controller &state, std::unique_lock<std::mutex> &lock) {
+    lock.unlock();
+    const int64_t threadLagMs = measureThreadLagUs(state) / 1000;
+    const uint64_t audioTicksBehind = HotPathCounters::audioTicksBehind();
+    lock.lock();
+
+    const auto &config = state.config;
+    const uint64_t newTicksBehind = audioTicksBehind - std::min(audioTicksBehind, state.audioTicksBehind);
+    state.audioTicksBehind = audioTicksBehind;
+    state.stats.threadLagMs = threadLagMs;
+    state.stats.audioTicksBehind = newTicksBehind;
+    state.stats.checks++;
+
+    const bool isOverloaded = threadLagMs >= config.maxThreadLagMs || newTicksBehind >= (uint64_t)config.maxAudioTicksBehind;
+    const bool isHealthy = threadLagMs < config.maxThreadLagMs / 2 && newTicksBehind < (uint64_t)std::max(1, config.maxAudioTicksBehind / 2);
+    state.overloadedChecks = isOverloaded ? state.overloadedChecks + 1 : 0;
+    state.healthyChecks = isHealthy ? state.healthyChecks + 1 : 0;
+
+    const auto level = OverloadController::level();
+    auto next = level;
+    if (state.overloadedChecks >= config.escalateAfterChecks && level < config.maxLevel) {
+        next = static_cast<OverloadController::Level>(static_cast<int>(level) + 1);
+        state.stats.escalations++;
+    } else if (state.healthyChecks >= config.recoverAfterChecks && level > OverloadController::Level::Normal) {
+        next = static_cast<OverloadController::Level>(static_cast<int>(level) - 1);
+        state.stats.recoveries++;
+    } else if (level > config.maxLevel) {
+        next = config.maxLevel;
+    }
+    if (next != level) {
+        RTC_LOG(LS_WARNING) << "OverloadController: level " << static_cast<int>(level) << " -> " << static_cast<int>(next) << ", thread lag " << threadLagMs << " ms, " << newTicksBehind << " audio ticks behind";
+        OverloadController::setLevel(next);
+    }
+}
+
+void run(Controller &state) {
+    std::unique_lock<std::mutex> lock(state.mutex);
+    state.audioTicksBehind = HotPathCounters::audioTicksBehind();
+    while (state.isEnabled) {
+        const auto interval = std::chrono::milliseconds(std::max(10, state.config.checkIntervalMs));
+        if (state.wakeUp.wait_for(lock, interval, [&] { return !state.isEnabled; })) {
+            break;
+        }
+        check(state, lock);
+    }
+    state.probes.clear();
+}
+
+} // namespace
+
+std::atomic<OverloadController::Level> OverloadController::_level{OverloadController::Level::Normal};
+
+void OverloadController::setEnabled(bool enabled) {
+    auto &state = controller();
+    std::thread stopped;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.isEnabled == enabled) {
+            return;
+        }
+        state.isEnabled = enabled;
+        if (enabled) {
+            state.thread = std::thread([&state] {
+                run(state);
+            });
+        } else {
+            stopped = std::move(state.thread);
+        }
+    }
+    if (stopped.joinable()) {
+        state.wakeUp.notify_all();
+        stopped.join();
+        setLevel(Level::Normal);
+    }
+}
+
+bool OverloadController::isEnabled() {
+    auto &state = controller();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.isEnabled;
+}
+
+void OverloadController::configure(Config const &config) {
+    auto &state = controller();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.config = config;
+    state.config.escalateAfterChecks = std::max(1, config.escalateAfterChecks);
+    state.config.recoverAfterChecks = std::max(1, config.recoverAfterChecks);
+    state.config.maxDecodedIncomingAudioStreams = std::max(1, config.maxDecodedIncomingAudioStreams);
+    state.config.audioComplexity = std::min(std::max(config.audioComplexity, 0), 10);
+    state.config.jitterBufferMinDelayMs = std::max(0, config.jitterBufferMinDelayMs);
+}
+
+OverloadController::Config OverloadController::config() {
+    auto &state = controller();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.config;
+}
+
+void OverloadController::setLevel(Level level) {
+    _level.store(level, std::memory_order_relaxed);
+}
+
+void OverloadController::onJoinRefused() {
+    auto &state = controller();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stats.refusedJoins++;
+}
+
+OverloadController::Stats OverloadController::stats() {
+    auto &state = controller();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto stats = state.stats;
+    stats.level = level();
+    return stats;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,95 @@
+#ifndef TGCALLS_OVERLOAD_CONTROLLER_H
+#define TGCALLS_OVERLOAD_CONTROLLER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace tgcalls {
+
+// Process-wide degradation of the group calls while the host can't keep up,
+// so that every call loses what matters least rather than all of them
+// breaking up together.
+//
+// Once enabled, a thread of its own checks every |checkIntervalMs| how long
+// a task posted to each pooled thread waited to run, and how many audio
+// device ticks came late or were dropped since the last check. After
+// |escalateAfterChecks| overloaded checks in a row the level goes up by one,
+// after |recoverAfterChecks| healthy ones in a row down by one, so load
+// drops before the next step is taken and the calls recover step by step.
+// Calls pick the level up within half a second.
+class OverloadController {
+public:
+    // Each level applies the ones below it as well.
+    enum class Level {
+        Normal,
+        // Calls decode at most |maxDecodedIncomingAudioStreams| incoming
+        // audio streams, letting the quietest go.
+        FewerAudioStreams,
+        // Opus encoders made from now on use |audioComplexity| at most.
+        LowerAudioComplexity,
+        // Incoming video is asked of the server in thumbnail quality only.
+        LowerVideoQuality,
+        // Incoming audio keeps at least |jitterBufferMinDelayMs| buffered,
+        // riding out a late media thread without concealment.
+        WiderJitterBuffers,
+        // New group calls are refused.
+        RefuseJoins
+    };
+
+    struct Config {
+        int checkIntervalMs = 500;
+        // A check is overloaded when a pooled thread took this long to run
+        // its probe, or when this many audio ticks were late or dropped
+        // since the previous check; healthy when neither reaches half.
+        int maxThreadLagMs = 50;
+        int maxAudioTicksBehind = 5;
+        int escalateAfterChecks = 2;
+        int recoverAfterChecks = 20;
+        // The highest level the checks go to.
+        Level maxLevel = Level::RefuseJoins;
+
+        int maxDecodedIncomingAudioStreams = 2;
+        int audioComplexity = 3;
+        int jitterBufferMinDelayMs = 150;
+    };
+
+    struct Stats {
+        Level level = Level::Normal;
+        // Found by the last check.
+        int64_t threadLagMs = 0;
+        uint64_t audioTicksBehind = 0;
+        uint64_t checks = 0;
+        uint64_t escalations = 0;
+        uint64_t recoveries = 0;
+        uint64_t refusedJoins = 0;
+    };
+
+    // Starts or stops the checks; stopping returns to Normal.
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    static void configure(Config const &config);
+    static Config config();
+
+    static Level level() {
+        return _level.load(std::memory_order_relaxed);
+    }
+
+    // Sets the level by hand, e.g. to try a degradation out; the checks
+    // move it from there while enabled.
+    static void setLevel(Level level);
+
+    static bool isRefusingJoins() {
+        return level() >= Level::RefuseJoins;
+    }
+    static void onJoinRefused();
+
+    static Stats stats();
+
+private:
+    static std::atomic<Level> _level;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,64 @@
+#include "QueuedVideoSink.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace tgcalls {
+
+QueuedVideoSink::QueuedVideoSink(std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink, size_t depth) :
+_state(std::make_shared<State>()) {
+    _state->sink = std::move(sink);
+    _state->depth = std::max<size_t>(1, depth);
+    // Detached, so that destroying the queue from the decoder thread never
+    // waits for the slow sink it exists to isolate.
+    std::thread(run, _state).detach();
+}
+
+QueuedVideoSink::~QueuedVideoSink() {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    _state->stopped = true;
+    _state->frames.clear();
+    _state->wakeUp.notify_one();
+}
+
+void QueuedVideoSink::OnFrame(const webrtc::VideoFrame &frame) {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    if (_state->frames.size() >= _state->depth) {
+        _state->frames.pop_front();
+        _state->dropped++;
+    }
+    _state->frames.push_back(frame);
+    _state->wakeUp.notify_one();
+}
+
+void QueuedVideoSink::OnDiscardedFrame() {
+    if (const auto strong = _state->sink.lock()) {
+        strong->OnDiscardedFrame();
+    }
+}
+
+uint64_t QueuedVideoSink::dropped() const {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    return _state->dropped;
+}
+
+void QueuedVideoSink::run(std::shared_ptr<State> state) {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (true) {
+        state->wakeUp.wait(lock, [&] {
+            return state->stopped || !state->frames.empty();
+        });
+        if (state->stopped) {
+            return;
+        }
+        auto frame = std::move(state->frames.front());
+        state->frames.pop_front();
+        lock.unlock();
+        if (const auto strong = state->sink.lock()) {
+            strong->OnFrame(frame);
+        }
+        lock.lock();
+    }
+}
+
+} // namespace tgcalls
@@ -0,0 +1,51 @@
+#ifndef TGCALLS_QUEUED_VIDEO_SINK_H
+#define TGCALLS_QUEUED_VIDEO_SINK_H
+
+#include "api/video/video_frame.h"
+#include "api/video/video_sink_interface.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace tgcalls {
+
+// Hands frames to a slow sink, such as a recorder or an analyzer, from a
+// thread of its own, so that it no longer delays the decoder thread and the
+// other sinks of the stream. At most |depth| frames wait; when a new one
+// arrives with the queue full, the oldest is dropped.
+//
+// Added in place of the sink it wraps, which it only holds weakly; it is
+// kept alive by whoever added it, like any other sink.
+class QueuedVideoSink final : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
+public:
+    QueuedVideoSink(std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink, size_t depth);
+    // Doesn't wait for a frame being delivered; the thread exits after it.
+    ~QueuedVideoSink();
+
+    void OnFrame(const webrtc::VideoFrame &frame) override;
+    void OnDiscardedFrame() override;
+
+    uint64_t dropped() const;
+
+private:
+    struct State {
+        std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink;
+        size_t depth = 1;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        std::deque<webrtc::VideoFrame> frames;
+        uint64_t dropped = 0;
+        bool stopped = false;
+    };
+
+    static void run(std::shared_ptr<State> state);
+
+    std::shared_ptr<State> _state;
+};
+
+} // namespace tgcalls
+
+#endif
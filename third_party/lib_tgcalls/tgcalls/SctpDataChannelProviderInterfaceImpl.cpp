@@ -1,6 +1,12 @@
 #include "SctpDataChannelProviderInterfaceImpl.h"
 
+#include "HotPathLog.h"
+
 #include "p2p/base/dtls_transport.h"
+#include "rtc_base/task_utils/to_queued_task.h"
+#include "rtc_base/time_utils.h"
+
+#include <algorithm>
 
 namespace tgcalls {
 
@@ -51,17 +57,88 @@ SctpDataChannelProviderInterfaceImpl::~SctpDataChannelProviderInterfaceImpl() {
     _sctpTransportFactory.reset();
 }
 
-void SctpDataChannelProviderInterfaceImpl::sendDataChannelMessage(std::string const &message) {
+void SctpDataChannelProviderInterfaceImpl::sendDataChannelMessage(std::string const &message, std::string const &coalesceKey) {
     assert(_threads->getNetworkThread()->IsCurrent());
 
-    if (_isDataChannelOpen) {
-        RTC_LOG(LS_INFO) << "Outgoing DataChannel message: " << message;
+    if (!_isDataChannelOpen) {
+        RTC_LOG(LS_INFO) << "Could not send an outgoing DataChannel message: the channel is not open";
+        return;
+    }
+    if (coalesceKey.empty()) {
+        sendOrQueue(message, coalesceKey);
+        return;
+    }
+
+    const auto it = std::find_if(_coalescedMessages.begin(), _coalescedMessages.end(), [&](const auto &entry) {
+        return entry.first == coalesceKey;
+    });
+    if (it != _coalescedMessages.end()) {
+        it->second = message;
+    } else {
+        _coalescedMessages.emplace_back(coalesceKey, message);
+    }
+    if (_isCoalescedFlushScheduled) {
+        return;
+    }
+    const auto delayMs = _lastCoalescedFlushMs + kCoalesceIntervalMs - rtc::TimeMillis();
+    if (delayMs <= 0) {
+        flushCoalescedMessages();
+        return;
+    }
+    _isCoalescedFlushScheduled = true;
+    _threads->getNetworkThread()->PostDelayedTask(webrtc::ToQueuedTask(_safety, [this] {
+        _isCoalescedFlushScheduled = false;
+        flushCoalescedMessages();
+    }), delayMs);
+}
+
+void SctpDataChannelProviderInterfaceImpl::flushCoalescedMessages() {
+    _lastCoalescedFlushMs = rtc::TimeMillis();
+    auto messages = std::move(_coalescedMessages);
+    _coalescedMessages.clear();
+    for (const auto &entry : messages) {
+        sendOrQueue(entry.second, entry.first);
+    }
+}
+
+void SctpDataChannelProviderInterfaceImpl::sendOrQueue(std::string const &message, std::string const &coalesceKey) {
+    if (!_isDataChannelOpen) {
+        return;
+    }
+    if (_pendingMessages.empty() && !isBufferFull()) {
+        TGCALLS_HOT_PATH_LOG(LS_INFO) << "Outgoing DataChannel message: " << message;
 
         webrtc::DataBuffer buffer(message);
         _dataChannel->Send(buffer);
-    } else {
-        RTC_LOG(LS_INFO) << "Could not send an outgoing DataChannel message: the channel is not open";
+        return;
     }
+
+    if (!coalesceKey.empty()) {
+        _pendingMessages.erase(std::remove_if(_pendingMessages.begin(), _pendingMessages.end(), [&](const auto &entry) {
+            return entry.first == coalesceKey;
+        }), _pendingMessages.end());
+    }
+    if (_pendingMessages.size() >= kMaxPendingMessages) {
+        RTC_LOG(LS_WARNING) << "Dropping an outgoing DataChannel message: too many waiting for the channel";
+        _pendingMessages.pop_front();
+    }
+    _pendingMessages.emplace_back(coalesceKey, message);
+}
+
+void SctpDataChannelProviderInterfaceImpl::flushPendingMessages() {
+    while (_isDataChannelOpen && !_pendingMessages.empty() && !isBufferFull()) {
+        const auto entry = std::move(_pendingMessages.front());
+        _pendingMessages.pop_front();
+
+        TGCALLS_HOT_PATH_LOG(LS_INFO) << "Outgoing DataChannel message: " << entry.second;
+
+        webrtc::DataBuffer buffer(entry.second);
+        _dataChannel->Send(buffer);
+    }
+}
+
+bool SctpDataChannelProviderInterfaceImpl::isBufferFull() const {
+    return _dataChannel->buffered_amount() > kMaxBufferedBytes;
 }
 
 void SctpDataChannelProviderInterfaceImpl::OnStateChange() {
@@ -71,6 +148,10 @@ void SctpDataChannelProviderInterfaceImpl::OnStateChange() {
     bool isDataChannelOpen = state == webrtc::DataChannelInterface::DataState::kOpen;
     if (_isDataChannelOpen != isDataChannelOpen) {
         _isDataChannelOpen = isDataChannelOpen;
+        if (!_isDataChannelOpen) {
+            _coalescedMessages.clear();
+            _pendingMessages.clear();
+        }
         _onStateChanged(_isDataChannelOpen);
     }
 }
@@ -80,12 +161,18 @@ void SctpDataChannelProviderInterfaceImpl::OnMessage(const webrtc::DataBuffer& b
 
     if (!buffer.binary) {
         std::string messageText(buffer.data.data(), buffer.data.data() + buffer.data.size());
-        RTC_LOG(LS_INFO) << "Incoming DataChannel message: " << messageText;
+        TGCALLS_HOT_PATH_LOG(LS_INFO) << "Incoming DataChannel message: " << messageText;
 
         _onMessageReceived(messageText);
     }
 }
 
+void SctpDataChannelProviderInterfaceImpl::OnBufferedAmountChange(uint64_t sent_data_size) {
+    assert(_threads->getNetworkThread()->IsCurrent());
+
+    flushPendingMessages();
+}
+
 void SctpDataChannelProviderInterfaceImpl::updateIsConnected(bool isConnected) {
     assert(_threads->getNetworkThread()->IsCurrent());
 
@@ -5,9 +5,15 @@
 #include "api/data_channel_interface.h"
 #include "pc/sctp_data_channel.h"
 #include "media/sctp/sctp_transport.h"
+#include "rtc_base/task_utils/pending_task_safety_flag.h"
 
 #include "StaticThreads.h"
 
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace cricket {
 class DtlsTransport;
 } // namespace cricket
@@ -27,10 +33,15 @@ public:
     virtual ~SctpDataChannelProviderInterfaceImpl();
 
     void updateIsConnected(bool isConnected);
-    void sendDataChannelMessage(std::string const &message);
+    // Messages with the same non-empty |coalesceKey|, such as a colibriClass,
+    // replace each other until sent, which is at most every
+    // kCoalesceIntervalMs. While SCTP has a lot buffered, messages wait in a
+    // bounded queue, dropping the oldest ones.
+    void sendDataChannelMessage(std::string const &message, std::string const &coalesceKey = std::string());
 
     virtual void OnStateChange() override;
     virtual void OnMessage(const webrtc::DataBuffer& buffer) override;
+    virtual void OnBufferedAmountChange(uint64_t sent_data_size) override;
     virtual bool SendData(const cricket::SendDataParams& params, const rtc::CopyOnWriteBuffer& payload, cricket::SendDataResult* result) override;
     virtual bool ConnectDataChannel(webrtc::SctpDataChannel *data_channel) override;
     virtual void DisconnectDataChannel(webrtc::SctpDataChannel* data_channel) override;
@@ -43,7 +54,16 @@ private:
     void sctpClosedAbruptly();
     void sctpDataReceived(const cricket::ReceiveDataParams& params, const rtc::CopyOnWriteBuffer& buffer);
 
+    void flushCoalescedMessages();
+    void sendOrQueue(std::string const &message, std::string const &coalesceKey);
+    void flushPendingMessages();
+    bool isBufferFull() const;
+
 private:
+    static constexpr int kCoalesceIntervalMs = 100;
+    static constexpr uint64_t kMaxBufferedBytes = 64 * 1024;
+    static constexpr size_t kMaxPendingMessages = 64;
+
     std::shared_ptr<Threads> _threads;
     std::function<void(bool)> _onStateChanged;
     std::function<void()> _onTerminated;
@@ -56,6 +76,15 @@ private:
     bool _isSctpTransportStarted = false;
     bool _isDataChannelOpen = false;
 
+    // (coalesceKey, message), latest per key, in the order keys came in.
+    std::vector<std::pair<std::string, std::string>> _coalescedMessages;
+    int64_t _lastCoalescedFlushMs = 0;
+    bool _isCoalescedFlushScheduled = false;
+    // (coalesceKey, message) waiting for SCTP to drain.
+    std::deque<std::pair<std::string, std::string>> _pendingMessages;
+
+    webrtc::ScopedTaskSafety _safety;
+
 };
 
 } // namespace tgcalls
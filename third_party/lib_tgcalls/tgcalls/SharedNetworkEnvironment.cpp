@@ -0,0 +1,209 @@
+#include "SharedNetworkEnvironment.h"
+
+#include "platform/PlatformInterface.h"
+
+#include "api/async_resolver_factory.h"
+#include "rtc_base/async_resolver.h"
+#include "rtc_base/network.h"
+#include "rtc_base/network_monitor_factory.h"
+#include "rtc_base/task_utils/pending_task_safety_flag.h"
+#include "rtc_base/task_utils/to_queued_task.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tgcalls {
+
+namespace {
+
+struct SharedNetwork {
+    // Declared first, so it outlives the manager watching through it.
+    std::unique_ptr<rtc::NetworkMonitorFactory> networkMonitorFactory;
+    std::unique_ptr<rtc::BasicNetworkManager> networkManager;
+};
+
+struct CachedAddresses {
+    std::vector<rtc::IPAddress> addresses;
+    int64_t expiresAtMs = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::map<rtc::Thread *, std::weak_ptr<SharedNetwork>> networks;
+    int64_t dnsCacheTtlMs = 60000;
+    // By hostname and address family asked for.
+    std::map<std::pair<std::string, int>, CachedAddresses> addresses;
+    uint64_t dnsCacheHits = 0;
+    uint64_t dnsCacheMisses = 0;
+};
+
+Registry &registry() {
+    // Leaked, like the other process-wide state: transports may outlive
+    // static destruction at exit.
+    static Registry *registry = new Registry();
+    return *registry;
+}
+
+bool findCachedAddresses(rtc::SocketAddress const &address, std::vector<rtc::IPAddress> &addresses) {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    const auto it = state.addresses.find(std::make_pair(address.hostname(), address.family()));
+    if (it == state.addresses.end() || it->second.expiresAtMs <= rtc::TimeMillis()) {
+        state.dnsCacheMisses++;
+        return false;
+    }
+    state.dnsCacheHits++;
+    addresses = it->second.addresses;
+    return true;
+}
+
+void cacheAddresses(rtc::SocketAddress const &address, std::vector<rtc::IPAddress> const &addresses) {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (state.dnsCacheTtlMs <= 0 || addresses.empty()) {
+        return;
+    }
+    const int64_t now = rtc::TimeMillis();
+    for (auto it = state.addresses.begin(); it != state.addresses.end();) {
+        it = it->second.expiresAtMs <= now ? state.addresses.erase(it) : std::next(it);
+    }
+    auto &entry = state.addresses[std::make_pair(address.hostname(), address.family())];
+    entry.addresses = addresses;
+    entry.expiresAtMs = now + state.dnsCacheTtlMs;
+}
+
+// Answers from the cache when it can, reporting the result asynchronously
+// all the same, and resolves with rtc::AsyncResolver otherwise.
+class CachingAsyncResolver : public rtc::AsyncResolverInterface, public sigslot::has_slots<> {
+public:
+    void Start(rtc::SocketAddress const &address) override {
+        _address = address;
+        if (findCachedAddresses(address, _addresses)) {
+            rtc::Thread::Current()->PostTask(webrtc::ToQueuedTask(_safety.flag(), [this] {
+                SignalDone(this);
+            }));
+            return;
+        }
+        _resolver = new rtc::AsyncResolver();
+        _resolver->SignalDone.connect(this, &CachingAsyncResolver::resolved);
+        _resolver->Start(address);
+    }
+
+    bool GetResolvedAddress(int family, rtc::SocketAddress *address) const override {
+        if (_error != 0) {
+            return false;
+        }
+        *address = _address;
+        for (const auto &ip : _addresses) {
+            if (ip.family() == family) {
+                address->SetResolvedIP(ip);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int GetError() const override {
+        return _error;
+    }
+
+    void Destroy(bool wait) override {
+        if (_resolver) {
+            _resolver->SignalDone.disconnect(this);
+            // rtc::AsyncResolver defers its own destruction when this is
+            // called from its SignalDone.
+            _resolver->Destroy(false);
+            _resolver = nullptr;
+        }
+        delete this;
+    }
+
+private:
+    void resolved(rtc::AsyncResolverInterface *resolver) {
+        _error = resolver->GetError();
+        if (_error == 0) {
+            _addresses = _resolver->addresses();
+            cacheAddresses(_address, _addresses);
+        }
+        // May destroy this.
+        SignalDone(this);
+    }
+
+    rtc::SocketAddress _address;
+    std::vector<rtc::IPAddress> _addresses;
+    int _error = 0;
+    rtc::AsyncResolver *_resolver = nullptr;
+    webrtc::ScopedTaskSafety _safety;
+};
+
+class CachingAsyncResolverFactory : public webrtc::AsyncResolverFactory {
+public:
+    rtc::AsyncResolverInterface *Create() override {
+        return new CachingAsyncResolver();
+    }
+};
+
+} // namespace
+
+std::shared_ptr<rtc::BasicNetworkManager> SharedNetworkEnvironment::networkManager(rtc::Thread *networkThread) {
+    assert(networkThread->IsCurrent());
+
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    for (auto it = state.networks.begin(); it != state.networks.end();) {
+        it = it->second.expired() ? state.networks.erase(it) : std::next(it);
+    }
+    auto network = state.networks[networkThread].lock();
+    if (!network) {
+        network = std::make_shared<SharedNetwork>();
+        network->networkMonitorFactory = PlatformInterface::SharedInstance()->createNetworkMonitorFactory();
+        network->networkManager = std::make_unique<rtc::BasicNetworkManager>(network->networkMonitorFactory.get());
+        state.networks[networkThread] = network;
+    }
+    return std::shared_ptr<rtc::BasicNetworkManager>(network, network->networkManager.get());
+}
+
+std::unique_ptr<webrtc::AsyncResolverFactory> SharedNetworkEnvironment::createAsyncResolverFactory() {
+    return std::make_unique<CachingAsyncResolverFactory>();
+}
+
+void SharedNetworkEnvironment::setDnsCacheTtlMs(int64_t ttlMs) {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.dnsCacheTtlMs = std::max<int64_t>(0, ttlMs);
+    if (state.dnsCacheTtlMs == 0) {
+        state.addresses.clear();
+    }
+}
+
+void SharedNetworkEnvironment::clearDnsCache() {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.addresses.clear();
+}
+
+SharedNetworkEnvironment::Stats SharedNetworkEnvironment::stats() {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    Stats stats;
+    for (const auto &it : state.networks) {
+        const auto users = it.second.use_count();
+        if (users > 0) {
+            stats.networkManagers++;
+            stats.networkManagerUsers += static_cast<int>(users);
+        }
+    }
+    stats.dnsCacheHits = state.dnsCacheHits;
+    stats.dnsCacheMisses = state.dnsCacheMisses;
+    stats.dnsCacheEntries = static_cast<int>(state.addresses.size());
+    return stats;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,58 @@
+#ifndef TGCALLS_SHARED_NETWORK_ENVIRONMENT_H
+#define TGCALLS_SHARED_NETWORK_ENVIRONMENT_H
+
+#include <cstdint>
+#include <memory>
+
+namespace rtc {
+class BasicNetworkManager;
+class Thread;
+}
+
+namespace webrtc {
+class AsyncResolverFactory;
+}
+
+namespace tgcalls {
+
+// What every call's transport would otherwise set up on its own, shared by
+// all of them in the process: the enumeration of network interfaces and the
+// resolution of TURN and STUN hostnames.
+//
+// Interfaces are enumerated by one rtc::BasicNetworkManager per network
+// thread, watched by the platform's network monitor, as webrtc's
+// PeerConnectionFactory shares its own; a transport started once the list
+// is known gets it right away instead of enumerating again. Hostnames are
+// resolved once per |dnsCacheTtlMs|: the system resolver doesn't report
+// record TTLs, so cached addresses are kept that long, failures not at all.
+class SharedNetworkEnvironment {
+public:
+    struct Stats {
+        // Network managers alive, and the transports using them.
+        int networkManagers = 0;
+        int networkManagerUsers = 0;
+        // Hostnames answered from the cache and by the system resolver.
+        uint64_t dnsCacheHits = 0;
+        uint64_t dnsCacheMisses = 0;
+        int dnsCacheEntries = 0;
+    };
+
+    // The network manager of the transports on |networkThread|, created on
+    // first use. Network thread only, and the reference has to be dropped
+    // there as well.
+    static std::shared_ptr<rtc::BasicNetworkManager> networkManager(rtc::Thread *networkThread);
+
+    // Resolvers that go through the shared cache; ones created on any
+    // thread may be used on it.
+    static std::unique_ptr<webrtc::AsyncResolverFactory> createAsyncResolverFactory();
+
+    // 0 stops caching and drops what is cached.
+    static void setDnsCacheTtlMs(int64_t ttlMs);
+    static void clearDnsCache();
+
+    static Stats stats();
+};
+
+} // namespace tgcalls
+
+#endif
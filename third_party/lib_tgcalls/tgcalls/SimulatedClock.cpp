@@ -0,0 +1,189 @@
+#include "SimulatedClock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "rtc_base/time_utils.h"
+
+#include "StaticThreads.h"
+
+namespace tgcalls {
+
+namespace {
+
+// How long advance() waits for a woken thread to sleep again. One that
+// takes longer went to wait on something else, such as a device parked with
+// nothing to play, and is not waited for again.
+constexpr auto kSettleTimeout = std::chrono::milliseconds(50);
+
+// The advance() step a thread was last woken by, to tell it is one of the
+// threads that step waits for once it goes back to sleep.
+thread_local uint64_t wokenGeneration = 0;
+
+class VirtualClock : public rtc::ClockInterface {
+public:
+    // rtc::TimeNanos() reads the time on every thread, so readers don't
+    // take |_mutex|: they retry while |_sequence| is odd or changed.
+    int64_t TimeNanos() const override {
+        while (true) {
+            const uint64_t sequence = _sequence.load(std::memory_order_acquire);
+            if (sequence & 1) {
+                continue;
+            }
+            const int64_t now = nowAt(rtc::SystemTimeNanos());
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_sequence.load(std::memory_order_relaxed) == sequence) {
+                return now;
+            }
+        }
+    }
+
+    void setSpeed(double speed, bool install) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const int64_t real = rtc::SystemTimeNanos();
+        beginWrite();
+        _virtualBase.store(install ? real : nowAt(real), std::memory_order_relaxed);
+        _realBase.store(real, std::memory_order_relaxed);
+        _speed.store(std::max(speed, 0.0), std::memory_order_relaxed);
+        endWrite();
+        if (install) {
+            rtc::SetClockForTesting(this);
+        }
+        _wakeUp.notify_all();
+    }
+
+    void advance(int64_t nanos) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        const int64_t target = TimeNanos() + nanos;
+        while (true) {
+            const int64_t now = TimeNanos();
+            if (now >= target) {
+                break;
+            }
+            int64_t next = target;
+            if (!_deadlines.empty()) {
+                next = std::min(next, std::max(now, *_deadlines.begin()));
+            }
+            beginWrite();
+            _virtualBase.store(_virtualBase.load(std::memory_order_relaxed) + (next - now), std::memory_order_relaxed);
+            endWrite();
+
+            _generation++;
+            _awake = std::distance(_deadlines.begin(), _deadlines.upper_bound(next));
+            _wakeUp.notify_all();
+            _settled.wait_for(lock, kSettleTimeout, [this] {
+                return _awake == 0;
+            });
+            _awake = 0;
+        }
+    }
+
+    void sleepUntilNanos(int64_t deadlineNanos) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (TimeNanos() >= deadlineNanos) {
+            return;
+        }
+        if (wokenGeneration == _generation && _awake > 0) {
+            if (--_awake == 0) {
+                _settled.notify_all();
+            }
+        }
+        wokenGeneration = 0;
+
+        const auto deadline = _deadlines.insert(deadlineNanos);
+        while (true) {
+            const int64_t now = TimeNanos();
+            if (now >= deadlineNanos) {
+                break;
+            }
+            const double speed = _speed.load(std::memory_order_relaxed);
+            if (speed > 0) {
+                _wakeUp.wait_for(lock, std::chrono::nanoseconds((int64_t)((double)(deadlineNanos - now) / speed) + 1));
+            } else {
+                _wakeUp.wait(lock);
+            }
+        }
+        _deadlines.erase(deadline);
+        wokenGeneration = _generation;
+    }
+
+private:
+    int64_t nowAt(int64_t real) const {
+        const double speed = _speed.load(std::memory_order_relaxed);
+        const int64_t elapsed = real - _realBase.load(std::memory_order_relaxed);
+        return _virtualBase.load(std::memory_order_relaxed) + (int64_t)((double)elapsed * speed);
+    }
+
+    void beginWrite() {
+        _sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endWrite() {
+        _sequence.fetch_add(1, std::memory_order_release);
+    }
+
+    std::atomic<uint64_t> _sequence{0};
+    std::atomic<int64_t> _virtualBase{0};
+    std::atomic<int64_t> _realBase{0};
+    std::atomic<double> _speed{1.0};
+
+    std::mutex _mutex;
+    std::condition_variable _wakeUp;
+    std::condition_variable _settled;
+    // Deadlines of the threads in sleepUntilNanos().
+    std::multiset<int64_t> _deadlines;
+    uint64_t _generation = 1;
+    // Threads woken by the current advance() step that haven't slept again.
+    size_t _awake = 0;
+};
+
+VirtualClock &clock() {
+    // Never destroyed: rtc::TimeNanos() may be called while the process
+    // exits.
+    static VirtualClock *clock = new VirtualClock();
+    return *clock;
+}
+
+std::mutex enableMutex;
+
+} // namespace
+
+std::atomic<bool> SimulatedClock::enabled_{false};
+
+void SimulatedClock::setSpeed(double speed) {
+    std::lock_guard<std::mutex> lock(enableMutex);
+    clock().setSpeed(speed, !enabled_);
+    enabled_ = true;
+}
+
+void SimulatedClock::advance(int64_t nanos) {
+    if (!isEnabled() || nanos <= 0) {
+        return;
+    }
+    clock().advance(nanos);
+    // Their waits for delayed tasks were timed by the wall clock.
+    Threads::wakeUp();
+}
+
+int64_t SimulatedClock::nowNanos() {
+    return isEnabled() ? clock().TimeNanos() : rtc::SystemTimeNanos();
+}
+
+void SimulatedClock::sleepUntilNanos(int64_t deadlineNanos) {
+    if (isEnabled()) {
+        clock().sleepUntilNanos(deadlineNanos);
+        return;
+    }
+    const int64_t delta = deadlineNanos - rtc::SystemTimeNanos();
+    if (delta > 0) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(delta));
+    }
+}
+
+} // namespace tgcalls
@@ -0,0 +1,54 @@
+#ifndef TGCALLS_SIMULATED_CLOCK_H
+#define TGCALLS_SIMULATED_CLOCK_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace tgcalls {
+
+// Process-wide virtual time for soak and capacity tests, so that hours of
+// playback run in minutes and timing bugs replay the same way every run.
+//
+// Once enabled it is what rtc::TimeMillis() and webrtc::Clock report, and
+// what the audio devices' 10 ms clocks tick by. It stays enabled for the
+// life of the process: virtual time runs ahead of the wall clock, and
+// switching back would make it go backwards.
+//
+// At a speed of 0 time only moves with advance(), which steps from one
+// sleeping thread's deadline to the next and lets the threads due at each
+// step run before taking the next, so every audio tick happens in the same
+// order on every run.
+//
+// Network I/O and the waits of WebRTC's threads stay on the wall clock;
+// delayed tasks of the pooled threads are rechecked whenever advance() moves
+// time. Calls talking to a real server only work at speed 1.
+class SimulatedClock {
+public:
+    // Makes time run |speed| times as fast as the wall clock from now on,
+    // or only with advance() for 0; the first call enables virtual time.
+    // Best done before the first call or device starts.
+    static void setSpeed(double speed);
+
+    static bool isEnabled() {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    // Moves time forward by |nanos| at once, waking the threads due on the
+    // way, and returns once they are all asleep again, or after a short
+    // grace period for threads that went to wait on something else. Does
+    // nothing unless enabled.
+    static void advance(int64_t nanos);
+
+    // CLOCK_MONOTONIC nanoseconds, or virtual ones once enabled.
+    static int64_t nowNanos();
+
+    // Sleeps until |deadlineNanos| of nowNanos().
+    static void sleepUntilNanos(int64_t deadlineNanos);
+
+private:
+    static std::atomic<bool> enabled_;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -1,31 +1,66 @@
 #include "StaticThreads.h"
 
+#include "CountedThread.h"
+#include "CpuAffinity.h"
+#include "StrandExecutor.h"
+#include "ThreadScheduling.h"
+
 #include "rtc_base/thread.h"
+#include "rtc_base/null_socket_server.h"
+#include "rtc_base/internal/default_socket_server.h"
 #include "call/call.h"
 
+#include <atomic>
 #include <mutex>
 #include <algorithm>
+#include <thread>
+#include <utility>
 
 namespace tgcalls {
 
+// Hands out the entry with the fewest users, creating entries lazily up to
+// the pool size. Entries past a reduced size get no new users and are
+// destroyed once idle, from get() or set_pool_size() only: the last user
+// may be released on one of the entry's own threads.
 template <class ValueT, class CreatorT>
 class Pool : public std::enable_shared_from_this<Pool<ValueT, CreatorT>> {
   struct Entry {
     std::unique_ptr<ValueT> value;
     size_t refcnt;
-
-    bool operator < (const Entry &other) const {
-      return refcnt < other.refcnt;
-    }
   };
 
 public:
-  explicit Pool(CreatorT creator) : creator_(std::move(creator)) {
+  explicit Pool(CreatorT creator, size_t size) : creator_(std::move(creator)), size_(std::max<size_t>(size, 1)) {
   }
   std::shared_ptr<ValueT> get() {
     std::unique_lock<std::mutex> lock(mutex_);
-    set_pool_size_locked(1);
-    auto i = std::min_element(entries_.begin(), entries_.end()) - entries_.begin();
+    destroy_idle_locked();
+
+    size_t best = entries_.size();
+    for (size_t i = 0; i < std::min(size_, entries_.size()); i++) {
+      if (!entries_[i].value) {
+        continue;
+      }
+      if (best == entries_.size() || entries_[i].refcnt < entries_[best].refcnt) {
+        best = i;
+      }
+    }
+    if (best == entries_.size() || entries_[best].refcnt > 0) {
+      // Everything live is in use: start another entry if there's room.
+      for (size_t i = 0; i < size_; i++) {
+        if (i == entries_.size()) {
+          entries_.emplace_back(Entry{nullptr, 0});
+        }
+        if (!entries_[i].value) {
+          entries_[i].value = creator_(i + 1);
+          best = i;
+          break;
+        }
+      }
+    }
+
+    auto i = best;
+    entries_[i].refcnt++;
     return std::shared_ptr<ValueT>(entries_[i].value.get(),
       [i, self = this->shared_from_this()](auto *ptr) {
         self->dec_ref(i);
@@ -34,7 +69,29 @@ public:
 
   void set_pool_size(size_t size) {
     std::unique_lock<std::mutex> lock(mutex_);
-    set_pool_size_locked(size);
+    size_ = std::max<size_t>(size, 1);
+    destroy_idle_locked();
+  }
+
+  std::vector<size_t> get_refcounts() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<size_t> result;
+    for (const auto &entry : entries_) {
+      if (entry.value) {
+        result.push_back(entry.refcnt);
+      }
+    }
+    return result;
+  }
+
+  template <class F>
+  void for_each(F &&f) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < entries_.size(); i++) {
+      if (entries_[i].value) {
+        f(i + 1, *entries_[i].value);
+      }
+    }
   }
 
   void dec_ref(size_t i) {
@@ -47,10 +104,16 @@ private:
   std::vector<Entry> entries_;
 
   CreatorT creator_;
+  size_t size_;
 
-  void set_pool_size_locked(size_t size) {
-    for (size_t i = entries_.size(); i < size; i++) {
-      entries_.emplace_back(Entry{creator_(i + 1), 0});
+  void destroy_idle_locked() {
+    for (size_t i = size_; i < entries_.size(); i++) {
+      if (entries_[i].value && entries_[i].refcnt == 0) {
+        entries_[i].value = nullptr;
+      }
+    }
+    while (!entries_.empty() && !entries_.back().value && entries_.back().refcnt == 0) {
+      entries_.pop_back();
     }
   }
 };
@@ -62,10 +125,11 @@ public:
     auto suffix = i == 0 ? "" : "#" + std::to_string(i);
     network_ = create_network("tgc-net" + suffix);
     network_->DisallowAllInvokes();
-    media_ = create("tgc-media" + suffix);
-    worker_ = create("tgc-work"  + suffix);
+    media_ = create("tgc-media" + suffix, HotPathCounters::Thread::Media);
+    worker_ = create("tgc-work"  + suffix, HotPathCounters::Thread::Worker);
     worker_->DisallowAllInvokes();
     worker_->AllowInvokesToThread(network_.get());
+    applySchedules();
   }
 
   rtc::Thread *getNetworkThread() override {
@@ -77,6 +141,41 @@ public:
   rtc::Thread *getWorkerThread() override {
     return worker_.get();
   }
+  // Pins all three threads to |cpus|, once each gets to it.
+  void setCpuSet(CpuSet cpus) {
+    for (auto thread : { network_.get(), media_.get(), worker_.get() }) {
+      thread->PostTask(RTC_FROM_HERE, [cpus] {
+        SetCurrentThreadCpuSet(cpus);
+      });
+    }
+  }
+
+  void applySchedules() {
+    const std::pair<rtc::Thread *, ThreadRole> roles[] = {
+      { network_.get(), ThreadRole::Network },
+      { media_.get(), ThreadRole::Media },
+      { worker_.get(), ThreadRole::Worker },
+    };
+    for (const auto &it : roles) {
+      it.first->PostTask(RTC_FROM_HERE, [role = it.second] {
+        ThreadScheduling::applyToCurrentThread(role);
+      });
+    }
+  }
+
+  void wakeUp() {
+    for (auto thread : { network_.get(), media_.get(), worker_.get() }) {
+      thread->PostTask(RTC_FROM_HERE, [] {
+      });
+    }
+  }
+
+  void forEachThread(std::function<void(rtc::Thread *)> const &f) {
+    for (auto thread : { network_.get(), media_.get(), worker_.get() }) {
+      f(thread);
+    }
+  }
+
   rtc::scoped_refptr<webrtc::SharedModuleThread> getSharedModuleThread() override {
     // This function must be called from a single thread because of SharedModuleThread implementation
     // So we don't care about making it thread safe
@@ -94,11 +193,11 @@ private:
   Thread worker_;
   rtc::scoped_refptr<webrtc::SharedModuleThread> shared_module_thread_;
 
-  static Thread create(const std::string &name) {
-    return init(std::unique_ptr<rtc::Thread>(rtc::Thread::Create()), name);
+  static Thread create(const std::string &name, HotPathCounters::Thread kind) {
+    return init(std::make_unique<CountedThread>(std::make_unique<rtc::NullSocketServer>(), kind), name);
   }
   static Thread create_network(const std::string &name) {
-    return init(std::unique_ptr<rtc::Thread>(rtc::Thread::CreateWithSocketServer()), name);
+    return init(std::make_unique<CountedThread>(rtc::CreateDefaultSocketServer(), HotPathCounters::Thread::Network), name);
   }
 
   static Thread init(Thread value, const std::string &name) {
@@ -108,15 +207,84 @@ private:
   }
 };
 
+// A pooled network thread, with the media and worker threads as strands of
+// |executor|.
+class StrandThreadsImpl : public Threads {
+  using Thread = std::shared_ptr<rtc::Thread>;
+public:
+  StrandThreadsImpl(std::shared_ptr<Threads> network, std::shared_ptr<StrandExecutor> executor, size_t i)
+      : network_(std::move(network)), executor_(std::move(executor)) {
+    auto suffix = "#s" + std::to_string(i);
+    media_ = executor_->createStrand("tgc-media" + suffix, HotPathCounters::Thread::Media);
+    worker_ = executor_->createStrand("tgc-work" + suffix, HotPathCounters::Thread::Worker);
+    worker_->DisallowAllInvokes();
+    worker_->AllowInvokesToThread(network_->getNetworkThread());
+  }
+
+  rtc::Thread *getNetworkThread() override {
+    return network_->getNetworkThread();
+  }
+  rtc::Thread *getMediaThread() override {
+    return media_.get();
+  }
+  rtc::Thread *getWorkerThread() override {
+    return worker_.get();
+  }
+
+  rtc::scoped_refptr<webrtc::SharedModuleThread> getSharedModuleThread() override {
+    // Same as ThreadsImpl's: the pooled one is used by other instances'
+    // worker strands, which may run concurrently with this one.
+    if (!shared_module_thread_) {
+      shared_module_thread_ = webrtc::SharedModuleThread::Create(
+          webrtc::ProcessThread::Create("tgc-module"),
+          [=] { shared_module_thread_ = nullptr; });
+    }
+    return shared_module_thread_;
+  }
+
+private:
+  std::shared_ptr<Threads> network_;
+  std::shared_ptr<StrandExecutor> executor_;
+  Thread media_;
+  Thread worker_;
+  rtc::scoped_refptr<webrtc::SharedModuleThread> shared_module_thread_;
+};
+
+std::atomic<ThreadsMode> threads_mode{ThreadsMode::Pooled};
+std::atomic<size_t> strand_threads_count{0};
+
+std::mutex affinity_mutex;
+std::vector<CpuSet> affinity_cpu_sets;
+
+// Pool set |i|, counted from 1, goes to CPU set |i - 1|, wrapping around.
+CpuSet cpu_set_for(size_t i) {
+  std::unique_lock<std::mutex> lock(affinity_mutex);
+  if (affinity_cpu_sets.empty()) {
+    return {};
+  }
+  return affinity_cpu_sets[(i - 1) % affinity_cpu_sets.size()];
+}
+
 class ThreadsCreator {
 public:
   std::unique_ptr<Threads> operator()(size_t i) {
-   return std::make_unique<ThreadsImpl>(i);
+    auto threads = std::make_unique<ThreadsImpl>(i);
+    auto cpus = cpu_set_for(i);
+    if (!cpus.empty()) {
+      threads->setCpuSet(std::move(cpus));
+    }
+    return threads;
   }
 };
 
+// One network/media/worker triple per two cores: the worker thread carries
+// most of a call's load, the other two much less.
+size_t default_pool_size() {
+  return std::max(1u, std::min(16u, std::thread::hardware_concurrency() / 2));
+}
+
 Pool<Threads, ThreadsCreator> &get_pool() {
-  static auto pool = std::make_shared<Pool<Threads, ThreadsCreator>>(ThreadsCreator());
+  static auto pool = std::make_shared<Pool<Threads, ThreadsCreator>>(ThreadsCreator(), default_pool_size());
   return *pool;
 }
 
@@ -124,8 +292,42 @@ void Threads::setPoolSize(size_t size){
   get_pool().set_pool_size(size);
 }
 std::shared_ptr<Threads> Threads::getThreads(){
+  if (threads_mode == ThreadsMode::Strands) {
+    return std::make_shared<StrandThreadsImpl>(get_pool().get(), StrandExecutor::shared(), ++strand_threads_count);
+  }
   return get_pool().get();
 }
+std::vector<size_t> Threads::getPoolInstanceCounts(){
+  return get_pool().get_refcounts();
+}
+void Threads::setCpuAffinity(CpuAffinityMode mode){
+  {
+    std::unique_lock<std::mutex> lock(affinity_mutex);
+    affinity_cpu_sets = GetCpuSets(mode);
+  }
+  get_pool().for_each([](size_t i, Threads &threads) {
+    static_cast<ThreadsImpl &>(threads).setCpuSet(cpu_set_for(i));
+  });
+}
+
+void Threads::setMode(ThreadsMode mode){
+  threads_mode = mode;
+}
+void Threads::wakeUp(){
+  get_pool().for_each([](size_t i, Threads &threads) {
+    static_cast<ThreadsImpl &>(threads).wakeUp();
+  });
+}
+void Threads::applyScheduling(){
+  get_pool().for_each([](size_t i, Threads &threads) {
+    static_cast<ThreadsImpl &>(threads).applySchedules();
+  });
+}
+void Threads::forEachPooledThread(std::function<void(rtc::Thread *)> const &f){
+  get_pool().for_each([&](size_t i, Threads &threads) {
+    static_cast<ThreadsImpl &>(threads).forEachThread(f);
+  });
+}
 
 namespace StaticThreads {
 
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cstddef>
+#include <functional>
 #include <memory>
+#include <vector>
 
 namespace rtc {
 class Thread;
@@ -14,6 +16,17 @@ class SharedModuleThread;
 
 namespace tgcalls {
 
+enum class CpuAffinityMode;
+
+enum class ThreadsMode {
+  // Instances share the pooled network/media/worker triples.
+  Pooled,
+  // Each instance gets a media and a worker strand of its own, run by a
+  // work-stealing pool of one worker per core, so that a busy call spreads
+  // over idle cores; network threads stay pooled, for their sockets.
+  Strands
+};
+
 class Threads {
 public:
   virtual ~Threads() = default;
@@ -22,9 +35,28 @@ public:
   virtual rtc::Thread *getWorkerThread() = 0;
   virtual rtc::scoped_refptr<webrtc::SharedModuleThread> getSharedModuleThread() = 0;
 
-  // it is not possible to decrease pool size
+  // Defaults to one set of threads per two cores. A smaller size stops new
+  // instances from using the sets past it; they are freed once unused.
   static void setPoolSize(size_t size);
+  // The pooled set with the fewest users, created on demand.
   static std::shared_ptr<Threads> getThreads();
+  // Users of every live pooled set, in creation order.
+  static std::vector<size_t> getPoolInstanceCounts();
+  // Pins every pooled set, current and future, to one physical core or NUMA
+  // node each, round robin; Off unpins them. Threads created from a pinned
+  // thread afterwards, such as an audio device's, share its CPUs.
+  static void setCpuAffinity(CpuAffinityMode mode);
+  // For instances created afterwards; Pooled by default.
+  static void setMode(ThreadsMode mode);
+  // Makes every pooled thread recheck its delayed tasks, e.g. after the
+  // SimulatedClock jumped ahead.
+  static void wakeUp();
+  // Calls |f| with each thread of every live pooled set, under the pool's
+  // lock, so |f| must not block. Strands aren't included.
+  static void forEachPooledThread(std::function<void(rtc::Thread *)> const &f);
+  // Gives every pooled thread its ThreadScheduling role's schedule, once
+  // each gets to it; pooled sets created afterwards get it when created.
+  static void applyScheduling();
 };
 
 namespace StaticThreads {
@@ -25,6 +25,26 @@ struct CallStats {
     std::vector<CallStatsBitrateRecord> bitrateRecords;
 };
 
+// Measurements of a running call, taken in memory while it runs rather than
+// logged when it ends. Bitrates are the congestion controller's estimates.
+// Incoming figures cover the streams being received: packet counts are
+// summed, delays averaged. -1 where nothing was measured.
+struct CallStatsSnapshot {
+    int64_t timestampMs = 0;
+    int32_t sendBitrateBps = 0;
+    int32_t receiveBitrateBps = 0;
+    int64_t rttMs = -1;
+    // Outgoing packets the remote side reported lost.
+    int32_t outgoingPacketsLost = 0;
+    float outgoingFractionLost = 0.0f;
+    int32_t incomingAudioStreams = 0;
+    int64_t incomingPacketsReceived = 0;
+    int64_t incomingPacketsLost = 0;
+    int32_t incomingJitterMs = -1;
+    int32_t jitterBufferDelayMs = -1;
+    int32_t videoDecodeMs = -1;
+};
+
 } // namespace tgcalls
 
 #endif
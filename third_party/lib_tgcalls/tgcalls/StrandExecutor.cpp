@@ -0,0 +1,415 @@
+#include "StrandExecutor.h"
+
+#include "CountedThread.h"
+#include "ThreadScheduling.h"
+
+#include "rtc_base/checks.h"
+#include "rtc_base/event.h"
+#include "rtc_base/platform_thread.h"
+#include "rtc_base/socket_server.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <thread>
+
+namespace tgcalls {
+
+namespace {
+
+constexpr int64_t kNoTimerMs = std::numeric_limits<int64_t>::max();
+
+} // namespace
+
+class Strand : public std::enable_shared_from_this<Strand> {
+public:
+    Strand(StrandExecutor *executor, std::string const &name, HotPathCounters::Thread kind);
+
+    rtc::Thread *thread() {
+        return _thread.get();
+    }
+
+    // Queues the strand, or has it queued again once it finishes running.
+    void wakeUp();
+    // A timer of the strand due at |dueMs| went off.
+    void timerFired(int64_t dueMs);
+    // Runs the strand for a slice, on a worker.
+    void run();
+    // No more runs; waits for the current one, from another thread.
+    void retire();
+
+private:
+    friend class StrandSocketServer;
+
+    enum class State {
+        Idle,
+        Queued,
+        Running,
+        // Woken while running.
+        RunningWoken
+    };
+
+    StrandExecutor *const _executor;
+
+    std::mutex _mutex;
+    std::condition_variable _finishedRunning;
+    State _state = State::Idle;
+    bool _isRetired = false;
+    // The earliest timer pending.
+    int64_t _timerDueMs = kNoTimerMs;
+    // Until the next delayed message, as found by the last run.
+    int _waitMs = rtc::Thread::kForever;
+
+    // Last, for it wakes the strand up when destroyed.
+    std::unique_ptr<rtc::Thread> _thread;
+};
+
+// What rtc::Thread waits and is woken up through. Waiting to process
+// messages ends the strand's run instead; waiting for the reply of an
+// Invoke() blocks the worker.
+class StrandSocketServer : public rtc::SocketServer {
+public:
+    explicit StrandSocketServer(Strand *strand) :
+    _strand(strand) {
+    }
+
+    bool Wait(int cms, bool process_io) override {
+        if (process_io) {
+            _strand->_waitMs = cms;
+            return false;
+        }
+        _strand->_executor->beginBlocking();
+        _event.Wait(cms == kForever ? rtc::Event::kForever : cms);
+        _strand->_executor->endBlocking();
+        return true;
+    }
+
+    void WakeUp() override {
+        _event.Set();
+        _strand->wakeUp();
+    }
+
+    rtc::Socket *CreateSocket(int family, int type) override {
+        RTC_NOTREACHED();
+        return nullptr;
+    }
+
+    rtc::AsyncSocket *CreateAsyncSocket(int family, int type) override {
+        RTC_NOTREACHED();
+        return nullptr;
+    }
+
+private:
+    Strand *const _strand;
+    rtc::Event _event;
+};
+
+Strand::Strand(StrandExecutor *executor, std::string const &name, HotPathCounters::Thread kind) :
+_executor(executor),
+_thread(std::make_unique<CountedThread>(std::make_unique<StrandSocketServer>(this), kind)) {
+    _thread->SetName(name, nullptr);
+}
+
+void Strand::wakeUp() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_isRetired) {
+            return;
+        }
+        switch (_state) {
+            case State::Idle:
+                _state = State::Queued;
+                break;
+            case State::Running:
+                _state = State::RunningWoken;
+                return;
+            default:
+                return;
+        }
+    }
+    if (auto strong = weak_from_this().lock()) {
+        _executor->enqueue(std::move(strong));
+    }
+}
+
+void Strand::timerFired(int64_t dueMs) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_timerDueMs <= dueMs) {
+            _timerDueMs = kNoTimerMs;
+        }
+    }
+    wakeUp();
+}
+
+void Strand::run() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_isRetired) {
+            return;
+        }
+        _state = State::Running;
+    }
+
+    const auto manager = rtc::ThreadManager::Instance();
+    manager->SetCurrentThread(_thread.get());
+    const auto deadline = rtc::TimeMillis() + StrandExecutor::kSliceMs;
+    auto isDrained = false;
+    rtc::Message message;
+    while (true) {
+        if (!_thread->Get(&message)) {
+            isDrained = true;
+            break;
+        }
+        _thread->Dispatch(&message);
+        if (rtc::TimeMillis() >= deadline) {
+            break;
+        }
+    }
+    manager->SetCurrentThread(nullptr);
+
+    auto requeue = false;
+    auto timerDueMs = kNoTimerMs;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_isRetired) {
+            _state = State::Idle;
+        } else if (!isDrained || _state == State::RunningWoken) {
+            _state = State::Queued;
+            requeue = true;
+        } else {
+            _state = State::Idle;
+            if (_waitMs != rtc::Thread::kForever) {
+                const auto dueMs = rtc::TimeMillis() + _waitMs;
+                if (dueMs < _timerDueMs) {
+                    _timerDueMs = timerDueMs = dueMs;
+                }
+            }
+        }
+        _finishedRunning.notify_all();
+    }
+    if (requeue) {
+        _executor->enqueue(shared_from_this());
+    } else if (timerDueMs != kNoTimerMs) {
+        _executor->addTimer(weak_from_this(), timerDueMs);
+    }
+}
+
+void Strand::retire() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _isRetired = true;
+    if (_thread->IsCurrent()) {
+        return;
+    }
+    _finishedRunning.wait(lock, [&] {
+        return _state != State::Running && _state != State::RunningWoken;
+    });
+}
+
+struct StrandExecutor::Worker {
+    StrandExecutor *executor = nullptr;
+    size_t index = 0;
+    std::unique_ptr<rtc::PlatformThread> thread;
+
+    std::mutex mutex;
+    std::deque<std::shared_ptr<Strand>> queue;
+
+    // Strands whose timer went off, woken outside of the executor's lock.
+    std::vector<std::pair<std::shared_ptr<Strand>, int64_t>> due;
+};
+
+thread_local StrandExecutor::Worker *StrandExecutor::_currentWorker = nullptr;
+
+std::shared_ptr<StrandExecutor> StrandExecutor::shared() {
+    static const auto executor = std::make_shared<StrandExecutor>(std::max(1u, std::thread::hardware_concurrency()));
+    return executor;
+}
+
+StrandExecutor::StrandExecutor(size_t workers) :
+_size(std::max<size_t>(workers, 1)),
+_nextTimerMs(kNoTimerMs) {
+    _workers.reserve(_size + kMaxExtraWorkers);
+    for (size_t i = 0; i < _size + kMaxExtraWorkers; i++) {
+        auto worker = std::make_unique<Worker>();
+        worker->executor = this;
+        worker->index = i;
+        _workers.push_back(std::move(worker));
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t i = 0; i < _size; i++) {
+        startWorkerLocked();
+    }
+}
+
+StrandExecutor::~StrandExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+        _wakeUp.notify_all();
+    }
+    for (size_t i = 0; i < _started; i++) {
+        _workers[i]->thread->Stop();
+    }
+}
+
+std::shared_ptr<rtc::Thread> StrandExecutor::createStrand(const std::string &name, HotPathCounters::Thread kind) {
+    auto strand = std::make_shared<Strand>(this, name, kind);
+    const auto thread = strand->thread();
+    return std::shared_ptr<rtc::Thread>(thread, [strand = std::move(strand)](rtc::Thread *) mutable {
+        strand->retire();
+        // Destroyed here or by the worker running it.
+        strand = nullptr;
+    });
+}
+
+size_t StrandExecutor::workerCount() const {
+    return _started;
+}
+
+void StrandExecutor::WorkerFunc(void *worker) {
+    const auto that = static_cast<Worker *>(worker);
+    _currentWorker = that;
+    ThreadScheduling::applyToCurrentThread(ThreadRole::Strand);
+    that->executor->run(*that);
+}
+
+void StrandExecutor::run(Worker &worker) {
+    while (const auto strand = take(worker)) {
+        strand->run();
+    }
+}
+
+std::shared_ptr<Strand> StrandExecutor::take(Worker &worker) {
+    while (true) {
+        const auto now = rtc::TimeMillis();
+        if (_nextTimerMs.load() <= now) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                popTimersLocked(worker, now);
+            }
+            for (const auto &it : worker.due) {
+                it.first->timerFired(it.second);
+            }
+            worker.due.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (!worker.queue.empty()) {
+                auto strand = std::move(worker.queue.front());
+                worker.queue.pop_front();
+                return strand;
+            }
+        }
+        if (auto strand = steal(worker)) {
+            return strand;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_stopping) {
+            return nullptr;
+        }
+        // Counted as sleeping before looking again, so that enqueue()
+        // either gets seen here or wakes a sleeper.
+        _sleeping++;
+        if (!hasQueuedLocked()) {
+            const auto nextTimerMs = _nextTimerMs.load();
+            if (nextTimerMs == kNoTimerMs) {
+                _wakeUp.wait(lock);
+            } else {
+                _wakeUp.wait_for(lock, std::chrono::milliseconds(std::max<int64_t>(0, nextTimerMs - rtc::TimeMillis())));
+            }
+        }
+        _sleeping--;
+    }
+}
+
+std::shared_ptr<Strand> StrandExecutor::steal(Worker &worker) {
+    const auto started = _started.load();
+    for (size_t i = 1; i < started; i++) {
+        auto &victim = *_workers[(worker.index + i) % started];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.queue.empty()) {
+            // The one its worker would get to last.
+            auto strand = std::move(victim.queue.back());
+            victim.queue.pop_back();
+            return strand;
+        }
+    }
+    return nullptr;
+}
+
+void StrandExecutor::popTimersLocked(Worker &worker, int64_t now) {
+    while (!_timers.empty() && _timers.top().dueMs <= now) {
+        if (auto strand = _timers.top().strand.lock()) {
+            worker.due.emplace_back(std::move(strand), _timers.top().dueMs);
+        }
+        _timers.pop();
+    }
+    _nextTimerMs = _timers.empty() ? kNoTimerMs : _timers.top().dueMs;
+}
+
+bool StrandExecutor::hasQueuedLocked() {
+    const auto started = _started.load();
+    for (size_t i = 0; i < started; i++) {
+        auto &worker = *_workers[i];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.queue.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void StrandExecutor::enqueue(std::shared_ptr<Strand> strand) {
+    // A worker keeps what it queues, for others to steal.
+    auto worker = (_currentWorker && _currentWorker->executor == this)
+        ? _currentWorker
+        : _workers[_nextWorker++ % _started].get();
+    {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->queue.push_back(std::move(strand));
+    }
+    if (_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _wakeUp.notify_one();
+    }
+}
+
+void StrandExecutor::addTimer(std::weak_ptr<Strand> strand, int64_t dueMs) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _timers.push(Timer{ dueMs, std::move(strand) });
+    if (dueMs < _nextTimerMs.load()) {
+        _nextTimerMs = dueMs;
+        // A sleeper waits for the previous one.
+        _wakeUp.notify_one();
+    }
+}
+
+void StrandExecutor::beginBlocking() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _blocked++;
+    const auto started = _started.load();
+    if (_sleeping.load() == 0 && started - _blocked < _size && started < _workers.size()) {
+        startWorkerLocked();
+    }
+}
+
+void StrandExecutor::endBlocking() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _blocked--;
+}
+
+void StrandExecutor::startWorkerLocked() {
+    const auto index = _started.load();
+    auto &worker = *_workers[index];
+    worker.thread = std::make_unique<rtc::PlatformThread>(WorkerFunc, &worker, "tgc-strand#" + std::to_string(index + 1), rtc::kNormalPriority);
+    worker.thread->Start();
+    _started = index + 1;
+}
+
+} // namespace tgcalls
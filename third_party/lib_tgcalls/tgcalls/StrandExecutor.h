@@ -0,0 +1,103 @@
+#ifndef TGCALLS_STRAND_EXECUTOR_H
+#define TGCALLS_STRAND_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "HotPathCounters.h"
+
+namespace rtc {
+class Thread;
+class PlatformThread;
+}
+
+namespace tgcalls {
+
+class Strand;
+class StrandSocketServer;
+
+// Runs strands, rtc::Threads without a thread of their own, on a pool of
+// workers: a strand with messages is queued to a worker, which runs it for
+// a slice, and idle workers steal queued strands from busy ones. A strand
+// runs on one worker at a time and looks like an ordinary rtc::Thread to the
+// code on it (IsCurrent(), Invoke(), delayed messages), so what relied on
+// being on one thread still holds.
+//
+// A strand blocked in an Invoke() holds its worker; another worker is
+// started meanwhile so that the strand invoked still gets to run, up to
+// kMaxExtraWorkers. Strands can't have sockets.
+class StrandExecutor {
+public:
+    static constexpr int64_t kSliceMs = 5;
+    static constexpr size_t kMaxExtraWorkers = 64;
+
+    // One worker per core.
+    static std::shared_ptr<StrandExecutor> shared();
+
+    explicit StrandExecutor(size_t workers);
+    // Joins the workers; every strand must be gone.
+    ~StrandExecutor();
+
+    // Dropping the last reference waits for the strand to finish what it
+    // runs, unless done on the strand itself, and drops its queued messages,
+    // as stopping a thread would. Counted in HotPathCounters as |kind|.
+    std::shared_ptr<rtc::Thread> createStrand(const std::string &name, HotPathCounters::Thread kind);
+
+    // Workers started, including those standing in for blocked ones.
+    size_t workerCount() const;
+
+private:
+    friend class Strand;
+    friend class StrandSocketServer;
+    struct Worker;
+
+    struct Timer {
+        int64_t dueMs = 0;
+        std::weak_ptr<Strand> strand;
+
+        bool operator<(Timer const &other) const {
+            return dueMs > other.dueMs;
+        }
+    };
+
+    // The worker of the calling thread, if any.
+    static thread_local Worker *_currentWorker;
+
+    static void WorkerFunc(void *worker);
+    void run(Worker &worker);
+    std::shared_ptr<Strand> take(Worker &worker);
+    std::shared_ptr<Strand> steal(Worker &worker);
+    void popTimersLocked(Worker &worker, int64_t now);
+    bool hasQueuedLocked();
+
+    void enqueue(std::shared_ptr<Strand> strand);
+    void addTimer(std::weak_ptr<Strand> strand, int64_t dueMs);
+    void beginBlocking();
+    void endBlocking();
+    void startWorkerLocked();
+
+    const size_t _size;
+    // Allocated up front, started on demand, so that they can be looked at
+    // without a lock.
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<size_t> _started{0};
+    std::atomic<size_t> _nextWorker{0};
+
+    std::mutex _mutex;
+    std::condition_variable _wakeUp;
+    std::atomic<size_t> _sleeping{0};
+    size_t _blocked = 0;
+    bool _stopping = false;
+    std::priority_queue<Timer> _timers;
+    std::atomic<int64_t> _nextTimerMs;
+};
+
+} // namespace tgcalls
+
+#endif
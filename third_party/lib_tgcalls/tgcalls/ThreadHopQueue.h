@@ -0,0 +1,81 @@
+#ifndef TGCALLS_THREAD_HOP_QUEUE_H
+#define TGCALLS_THREAD_HOP_QUEUE_H
+
+#include "rtc_base/thread.h"
+#include "rtc_base/location.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tgcalls {
+
+// Carries small, frequent events (per-packet levels and the like) to one
+// thread without a posted task per event. Events are appended to a vector
+// that keeps its capacity; the first push into an empty queue posts a single
+// task, which hands everything queued by then to |handler| on |thread|.
+// So the cost is one task per batch, and none of the events allocates.
+template <typename Event>
+class ThreadHopQueue : public std::enable_shared_from_this<ThreadHopQueue<Event>> {
+public:
+    using Handler = std::function<void(Event &)>;
+
+    static std::shared_ptr<ThreadHopQueue> Create(rtc::Thread *thread, Handler handler) {
+        return std::shared_ptr<ThreadHopQueue>(new ThreadHopQueue(thread, std::move(handler)));
+    }
+
+    // Any thread.
+    void push(Event &&event) {
+        bool needsDrain = false;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending.push_back(std::move(event));
+            if (!_isDrainScheduled) {
+                _isDrainScheduled = true;
+                needsDrain = true;
+            }
+        }
+        if (needsDrain) {
+            const auto weak = std::weak_ptr<ThreadHopQueue>(this->shared_from_this());
+            _thread->PostTask(RTC_FROM_HERE, [weak]() {
+                if (const auto strong = weak.lock()) {
+                    strong->drain();
+                }
+            });
+        }
+    }
+
+private:
+    ThreadHopQueue(rtc::Thread *thread, Handler handler) :
+    _thread(thread),
+    _handler(std::move(handler)) {
+    }
+
+    void drain() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending.swap(_draining);
+            _isDrainScheduled = false;
+        }
+        for (auto &event : _draining) {
+            _handler(event);
+        }
+        _draining.clear();
+    }
+
+private:
+    rtc::Thread *_thread = nullptr;
+    Handler _handler;
+
+    std::mutex _mutex;
+    std::vector<Event> _pending;
+    bool _isDrainScheduled = false;
+
+    // |thread| only.
+    std::vector<Event> _draining;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -49,6 +49,37 @@ private:
 		std::shared_ptr<T> _value;
 	};
 
+public:
+	// The object, for a task posted to its thread by hand while this is
+	// alive; like those of perform(), such a task runs before the object is
+	// destroyed. Lets one task reach the objects of many instances.
+	class Reference {
+	public:
+		T *get() const {
+			assert(_valueHolder->_value != nullptr);
+			return _valueHolder->_value.get();
+		}
+
+	private:
+		friend class ThreadLocalObject;
+
+		explicit Reference(ValueHolder *valueHolder) :
+		_valueHolder(valueHolder) {
+		}
+
+		ValueHolder *_valueHolder = nullptr;
+	};
+
+	Reference reference() const {
+		return Reference(_valueHolder.get());
+	}
+
+	rtc::Thread *thread() const {
+		return _thread;
+	}
+
+private:
+
 	rtc::Thread *_thread = nullptr;
 	std::unique_ptr<ValueHolder> _valueHolder;
 
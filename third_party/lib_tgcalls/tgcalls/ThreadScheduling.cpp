@@ -0,0 +1,129 @@
+#include "ThreadScheduling.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <mutex>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "StaticThreads.h"
+
+#include "rtc_base/logging.h"
+
+namespace tgcalls {
+
+namespace {
+
+ThreadSchedule defaultSchedule(ThreadRole role) {
+    ThreadSchedule schedule;
+    switch (role) {
+    case ThreadRole::AudioDevice:
+        schedule.policy = ThreadSchedule::Policy::Other;
+        break;
+    case ThreadRole::AudioPump:
+        schedule.policy = ThreadSchedule::Policy::Fifo;
+        schedule.fifoPriority = 2;
+        break;
+    default:
+        break;
+    }
+    return schedule;
+}
+
+struct Schedules {
+    std::mutex mutex;
+    ThreadSchedule values[ThreadScheduling::kRoleCount];
+    // A warning per role rather than per thread.
+    std::atomic<bool> warned[ThreadScheduling::kRoleCount] = {};
+
+    Schedules() {
+        for (size_t i = 0; i < ThreadScheduling::kRoleCount; i++) {
+            values[i] = defaultSchedule(static_cast<ThreadRole>(i));
+        }
+    }
+};
+
+Schedules &schedules() {
+    static Schedules *schedules = new Schedules();
+    return *schedules;
+}
+
+void warnOnce(ThreadRole role, const char *what, int error) {
+    if (!schedules().warned[static_cast<size_t>(role)].exchange(true)) {
+        RTC_LOG(LS_WARNING) << "ThreadScheduling: " << what << " failed for role " << static_cast<int>(role) << ": " << error;
+    }
+}
+
+} // namespace
+
+void ThreadScheduling::set(ThreadRole role, ThreadSchedule schedule) {
+    schedule.fifoPriority = std::min(std::max(schedule.fifoPriority, 1), 99);
+    schedule.nice = std::min(std::max(schedule.nice, -20), 19);
+    {
+        auto &state = schedules();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.values[static_cast<size_t>(role)] = schedule;
+        state.warned[static_cast<size_t>(role)] = false;
+    }
+    if (role == ThreadRole::Network || role == ThreadRole::Media || role == ThreadRole::Worker) {
+        Threads::applyScheduling();
+    }
+}
+
+ThreadSchedule ThreadScheduling::get(ThreadRole role) {
+    auto &state = schedules();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.values[static_cast<size_t>(role)];
+}
+
+#if defined(__linux__)
+
+bool ThreadScheduling::applyToCurrentThread(ThreadRole role) {
+    const auto schedule = get(role);
+    if (schedule.policy == ThreadSchedule::Policy::Default) {
+        return true;
+    }
+
+    sched_param param;
+    bool isApplied = true;
+    if (schedule.policy == ThreadSchedule::Policy::Fifo) {
+        param.sched_priority = std::min(std::max(schedule.fifoPriority, sched_get_priority_min(SCHED_FIFO)), sched_get_priority_max(SCHED_FIFO));
+        const int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (result == 0) {
+            return true;
+        }
+        warnOnce(role, "SCHED_FIFO", result);
+        isApplied = false;
+    }
+
+    // Leaving a realtime policy for SCHED_OTHER is always allowed.
+    param.sched_priority = 0;
+    const int result = pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    if (result != 0) {
+        warnOnce(role, "SCHED_OTHER", result);
+        return false;
+    }
+    // Linux keeps a nice value per thread.
+    if (setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), schedule.nice) != 0) {
+        warnOnce(role, "setpriority", errno);
+        return false;
+    }
+    return isApplied;
+}
+
+#else
+
+bool ThreadScheduling::applyToCurrentThread(ThreadRole role) {
+    return get(role).policy == ThreadSchedule::Policy::Default;
+}
+
+#endif
+
+} // namespace tgcalls
@@ -0,0 +1,65 @@
+#ifndef TGCALLS_THREAD_SCHEDULING_H
+#define TGCALLS_THREAD_SCHEDULING_H
+
+#include <cstddef>
+
+namespace tgcalls {
+
+// The kinds of threads whose scheduling can be set.
+enum class ThreadRole {
+    // The playout and capture threads of each audio device that isn't on
+    // the shared clock: two per call.
+    AudioDevice,
+    // The shared AudioPump threads, a handful for the process.
+    AudioPump,
+    // The pooled network, media and worker threads.
+    Network,
+    Media,
+    Worker,
+    // StrandExecutor's workers.
+    Strand
+};
+
+struct ThreadSchedule {
+    enum class Policy {
+        // Left as created: the audio threads ask for SCHED_FIFO, which only
+        // takes with CAP_SYS_NICE, the pooled threads run SCHED_OTHER.
+        Default,
+        // SCHED_OTHER at |nice|.
+        Other,
+        // SCHED_FIFO at |fifoPriority|, or SCHED_OTHER at |nice| where the
+        // process may not use it.
+        Fifo
+    };
+
+    Policy policy = Policy::Default;
+    // 1 to 99.
+    int fifoPriority = 1;
+    // -20 to 19; below 0 needs CAP_SYS_NICE as well.
+    int nice = 0;
+};
+
+// Process-wide scheduling of tgcalls' threads by role. The defaults suit a
+// host running many calls: a FIFO thread can starve every SCHED_OTHER one
+// on its core, so only the few AudioPump threads get a low FIFO priority,
+// while the per-call audio device threads run SCHED_OTHER next to the
+// network threads that feed them.
+//
+// Linux only; elsewhere threads keep their priorities.
+class ThreadScheduling {
+public:
+    static constexpr size_t kRoleCount = 6;
+
+    // Applies to the pooled threads at once, to the other roles' threads
+    // as they start.
+    static void set(ThreadRole role, ThreadSchedule schedule);
+    static ThreadSchedule get(ThreadRole role);
+
+    // Called by each thread of |role| when it starts. False if the
+    // schedule couldn't be applied in full.
+    static bool applyToCurrentThread(ThreadRole role);
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,192 @@
+#include "TraceRecorder.h"
+
+#include "rtc_base/platform_thread_types.h"
+#include "rtc_base/time_utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined(WEBRTC_POSIX)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace tgcalls {
+
+namespace {
+
+struct Slot {
+    // Index of the event in the slot, plus one; 0 while it is written.
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char *> category{nullptr};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<int64_t> startUs{0};
+    std::atomic<int64_t> durationUs{0};
+};
+
+struct ThreadBuffer {
+    ThreadBuffer(uint64_t generation, size_t size) :
+    generation(generation),
+    slots(size) {
+    }
+
+    const uint64_t generation;
+    std::vector<Slot> slots;
+    std::atomic<uint64_t> written{0};
+    int64_t threadId = 0;
+    std::string threadName;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::atomic<uint64_t> generation{0};
+    std::atomic<size_t> eventsPerThread{TraceRecorder::kDefaultEventsPerThread};
+};
+
+Registry &registry() {
+    static Registry *registry = new Registry();
+    return *registry;
+}
+
+// The registry keeps it after the thread exits, until the next trace.
+thread_local std::shared_ptr<ThreadBuffer> currentBuffer;
+
+std::string currentThreadName() {
+#if defined(WEBRTC_LINUX) || defined(WEBRTC_MAC)
+    char name[64] = { 0 };
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0) {
+        return name;
+    }
+#endif
+    return std::string();
+}
+
+ThreadBuffer &bufferForGeneration(uint64_t generation) {
+    auto &buffer = currentBuffer;
+    if (!buffer || buffer->generation != generation) {
+        auto &traces = registry();
+        buffer = std::make_shared<ThreadBuffer>(generation, std::max<size_t>(traces.eventsPerThread.load(std::memory_order_relaxed), 1));
+        buffer->threadId = static_cast<int64_t>(rtc::CurrentThreadId());
+        buffer->threadName = currentThreadName();
+
+        std::lock_guard<std::mutex> lock(traces.mutex);
+        traces.buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+void appendEscaped(std::string &result, const char *value) {
+    for (const char *c = value; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            result.push_back('\\');
+            result.push_back(*c);
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(*c));
+            result.append(escaped);
+        } else {
+            result.push_back(*c);
+        }
+    }
+}
+
+} // namespace
+
+std::atomic<bool> TraceRecorder::_isRecording{false};
+
+void TraceRecorder::start(size_t eventsPerThread) {
+    auto &traces = registry();
+    std::lock_guard<std::mutex> lock(traces.mutex);
+    traces.eventsPerThread.store(eventsPerThread, std::memory_order_relaxed);
+    // Threads start a new buffer on their next slice; the old ones go, and
+    // with them those of the threads that have exited since.
+    traces.generation.fetch_add(1, std::memory_order_relaxed);
+    traces.buffers.clear();
+    _isRecording.store(true, std::memory_order_release);
+}
+
+void TraceRecorder::stop() {
+    _isRecording.store(false, std::memory_order_relaxed);
+}
+
+void TraceRecorder::record(const char *category, const char *name, int64_t startUs, int64_t durationUs) {
+    auto &buffer = bufferForGeneration(registry().generation.load(std::memory_order_relaxed));
+    const auto index = buffer.written.load(std::memory_order_relaxed);
+    auto &slot = buffer.slots[index % buffer.slots.size()];
+
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startUs.store(startUs, std::memory_order_relaxed);
+    slot.durationUs.store(durationUs, std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+std::string TraceRecorder::exportJson() {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        auto &traces = registry();
+        std::lock_guard<std::mutex> lock(traces.mutex);
+        buffers = traces.buffers;
+    }
+
+#if defined(WEBRTC_POSIX)
+    const long long processId = getpid();
+#else
+    const long long processId = 0;
+#endif
+
+    std::string result = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool isFirst = true;
+    char line[192];
+    for (const auto &buffer : buffers) {
+        if (!buffer->threadName.empty()) {
+            snprintf(line, sizeof(line), "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%lld,\"tid\":%lld,\"args\":{\"name\":\"", isFirst ? "" : ",", processId, static_cast<long long>(buffer->threadId));
+            result.append(line);
+            appendEscaped(result, buffer->threadName.c_str());
+            result.append("\"}}");
+            isFirst = false;
+        }
+
+        const auto written = buffer->written.load(std::memory_order_acquire);
+        const auto size = buffer->slots.size();
+        for (uint64_t index = written > size ? written - size : 0; index < written; index++) {
+            const auto &slot = buffer->slots[index % size];
+            if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+                continue;
+            }
+            const auto category = slot.category.load(std::memory_order_relaxed);
+            const auto name = slot.name.load(std::memory_order_relaxed);
+            const auto startUs = slot.startUs.load(std::memory_order_relaxed);
+            const auto durationUs = slot.durationUs.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != index + 1) {
+                // Overwritten while it was read.
+                continue;
+            }
+
+            result.append(isFirst ? "{\"ph\":\"X\",\"cat\":\"" : ",{\"ph\":\"X\",\"cat\":\"");
+            appendEscaped(result, category);
+            result.append("\",\"name\":\"");
+            appendEscaped(result, name);
+            snprintf(line, sizeof(line), "\",\"ts\":%lld,\"dur\":%lld,\"pid\":%lld,\"tid\":%lld}", static_cast<long long>(startUs), static_cast<long long>(durationUs), processId, static_cast<long long>(buffer->threadId));
+            result.append(line);
+            isFirst = false;
+        }
+    }
+    result.append("]}");
+    return result;
+}
+
+int64_t TraceRecorder::nowUs() {
+    return rtc::TimeMicros();
+}
+
+} // namespace tgcalls
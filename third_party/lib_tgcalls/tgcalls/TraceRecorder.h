@@ -0,0 +1,70 @@
+#ifndef TGCALLS_TRACE_RECORDER_H
+#define TGCALLS_TRACE_RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace tgcalls {
+
+// Optional, process-wide trace of what the tgcalls threads spend their time
+// on, exported as Chrome trace event JSON for chrome://tracing or Perfetto.
+//
+// Each thread records its slices into a ring of its own, of which it is the
+// only writer, so recording takes no lock; the export reads the rings while
+// they are written, skipping the slots overwritten meanwhile. While no trace
+// is recorded, a TraceScope costs a relaxed load.
+class TraceRecorder {
+public:
+    static constexpr size_t kDefaultEventsPerThread = 8192;
+
+    // Starts a new trace, dropping the previous one. Each thread keeps its
+    // last |eventsPerThread| slices.
+    static void start(size_t eventsPerThread = kDefaultEventsPerThread);
+    static void stop();
+
+    static bool isRecording() {
+        return _isRecording.load(std::memory_order_relaxed);
+    }
+
+    // |category| and |name| are kept as pointers: string literals only.
+    static void record(const char *category, const char *name, int64_t startUs, int64_t durationUs);
+
+    // The current or last trace, as a JSON object.
+    static std::string exportJson();
+
+    static int64_t nowUs();
+
+private:
+    static std::atomic<bool> _isRecording;
+};
+
+// A slice from construction to destruction, recorded if a trace was being
+// recorded when it started.
+class TraceScope {
+public:
+    TraceScope(const char *category, const char *name) :
+    _category(category),
+    _name(name),
+    _startUs(TraceRecorder::isRecording() ? TraceRecorder::nowUs() : 0) {
+    }
+
+    ~TraceScope() {
+        if (_startUs != 0) {
+            TraceRecorder::record(_category, _name, _startUs, TraceRecorder::nowUs() - _startUs);
+        }
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *_category;
+    const char *_name;
+    int64_t _startUs;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,231 @@
+#include "TurnNonceCache.h"
+
+#include "api/transport/stun.h"
+#include "p2p/base/port_allocator.h"
+#include "p2p/base/turn_port.h"
+#include "p2p/client/relay_port_factory_interface.h"
+#include "rtc_base/byte_buffer.h"
+#include "rtc_base/byte_order.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/time_utils.h"
+#include "system_wrappers/include/field_trial.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tgcalls {
+
+namespace {
+
+struct Nonce {
+    std::string realm;
+    std::string nonce;
+    int64_t expiresAtMs = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    // By server address, protocol and credentials.
+    std::map<std::string, Nonce> nonces;
+    TurnNonceCache::Stats stats;
+};
+
+Registry &registry() {
+    // Leaked, like the other process-wide state: ports may outlive static
+    // destruction at exit.
+    static Registry *registry = new Registry();
+    return *registry;
+}
+
+std::string serverKey(cricket::ProtocolAddress const &address, cricket::RelayCredentials const &credentials) {
+    return address.address.ToString() + "/" + cricket::ProtoToString(address.proto) + "/" + credentials.username + ":" + credentials.password;
+}
+
+bool findNonce(std::string const &key, Nonce &nonce) {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    const auto it = state.nonces.find(key);
+    if (it == state.nonces.end()) {
+        return false;
+    }
+    if (it->second.expiresAtMs <= rtc::TimeMillis()) {
+        state.nonces.erase(it);
+        return false;
+    }
+    nonce = it->second;
+    state.stats.seededAllocations++;
+    return true;
+}
+
+void storeNonce(std::string const &key, std::string const &realm, std::string const &nonce) {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    auto &entry = state.nonces[key];
+    entry.realm = realm;
+    entry.nonce = nonce;
+    entry.expiresAtMs = rtc::TimeMillis() + TurnNonceCache::kTtlMs;
+}
+
+void seedAccepted() {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stats.acceptedSeeds++;
+}
+
+void seedRejected(std::string const &key) {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.stats.rejectedSeeds++;
+    state.nonces.erase(key);
+}
+
+// Offset of the attribute |type| in the STUN message |data|, or 0.
+size_t findAttribute(const uint8_t *data, size_t size, uint16_t type) {
+    size_t offset = cricket::kStunHeaderSize;
+    while (offset + 4 <= size) {
+        const uint16_t attributeType = rtc::GetBE16(data + offset);
+        const uint16_t length = rtc::GetBE16(data + offset + 2);
+        if (attributeType == type) {
+            return offset + 4 + length <= size ? offset : 0;
+        }
+        offset += 4 + ((length + 3) & ~3);
+    }
+    return 0;
+}
+
+// A TurnPort whose first allocate request is signed with the nonce cached
+// for its server, and which caches the nonce of its allocation in turn.
+class NonceCachingTurnPort : public cricket::TurnPort {
+public:
+    NonceCachingTurnPort(cricket::CreateRelayPortArgs const &args, rtc::AsyncPacketSocket *socket) :
+    cricket::TurnPort(args.network_thread, args.socket_factory, args.network, socket, args.username, args.password, *args.server_address, args.config->credentials, args.config->priority, args.origin, args.turn_customizer),
+    _key(serverKey(*args.server_address, args.config->credentials)) {
+    }
+
+    NonceCachingTurnPort(cricket::CreateRelayPortArgs const &args, int minPort, int maxPort) :
+    cricket::TurnPort(args.network_thread, args.socket_factory, args.network, minPort, maxPort, args.username, args.password, *args.server_address, args.config->credentials, args.config->priority, args.origin, args.config->tls_alpn_protocols, args.config->tls_elliptic_curves, args.turn_customizer, args.config->tls_cert_verifier),
+    _key(serverKey(*args.server_address, args.config->credentials)) {
+    }
+
+    void PrepareAddress() override {
+        Nonce nonce;
+        if (hash().empty() && findNonce(_key, nonce)) {
+            set_realm(nonce.realm);
+            set_nonce(nonce.nonce);
+            _realm = nonce.realm;
+            _awaitingSeedResponse = true;
+        }
+        cricket::TurnPort::PrepareAddress();
+    }
+
+    bool HandleIncomingPacket(rtc::AsyncPacketSocket *socket, const char *data, size_t size, const rtc::SocketAddress &remote_addr, int64_t packet_time_us) override {
+        const auto bytes = reinterpret_cast<const uint8_t *>(data);
+        const uint16_t type = size >= cricket::kStunHeaderSize ? rtc::GetBE16(bytes) : 0;
+        if ((type != cricket::STUN_ALLOCATE_RESPONSE && type != cricket::STUN_ALLOCATE_ERROR_RESPONSE) || remote_addr != server_address().address) {
+            return cricket::TurnPort::HandleIncomingPacket(socket, data, size, remote_addr, packet_time_us);
+        }
+
+        const bool isSeedResponse = _awaitingSeedResponse;
+        _awaitingSeedResponse = false;
+        if (type == cricket::STUN_ALLOCATE_RESPONSE) {
+            if (isSeedResponse) {
+                seedAccepted();
+            }
+            const bool handled = cricket::TurnPort::HandleIncomingPacket(socket, data, size, remote_addr, packet_time_us);
+            if (!hash().empty() && !_realm.empty()) {
+                storeNonce(_key, _realm, nonce());
+            }
+            return handled;
+        }
+
+        const size_t realm = findAttribute(bytes, size, cricket::STUN_ATTR_REALM);
+        if (realm != 0) {
+            _realm.assign(data + realm + 4, rtc::GetBE16(bytes + realm + 2));
+        }
+        if (!isSeedResponse) {
+            return cricket::TurnPort::HandleIncomingPacket(socket, data, size, remote_addr, packet_time_us);
+        }
+        seedRejected(_key);
+        // TurnPort takes a 401 to a signed request for wrong credentials and
+        // gives up; to the cached nonce it is a stale nonce, and answered as
+        // such with the realm and nonce it carries.
+        const size_t errorCode = findAttribute(bytes, size, cricket::STUN_ATTR_ERROR_CODE);
+        if (errorCode == 0 || rtc::GetBE16(bytes + errorCode + 2) < 4 || bytes[errorCode + 6] != 4 || bytes[errorCode + 7] != 1) {
+            return cricket::TurnPort::HandleIncomingPacket(socket, data, size, remote_addr, packet_time_us);
+        }
+        std::vector<char> staleNonce(data, data + size);
+        staleNonce[errorCode + 7] = 38;
+        return cricket::TurnPort::HandleIncomingPacket(socket, staleNonce.data(), staleNonce.size(), remote_addr, packet_time_us);
+    }
+
+private:
+    const std::string _key;
+    bool _awaitingSeedResponse = false;
+    // Realm of the nonce the port signs with.
+    std::string _realm;
+};
+
+bool allowedServer(cricket::CreateRelayPortArgs const &args) {
+    // As TurnPort::Create checks.
+    if (args.config->credentials.username.size() > cricket::kMaxTurnUsernameLength) {
+        RTC_LOG(LS_ERROR) << "Attempt to use TURN with a too long username of length " << args.config->credentials.username.size();
+        return false;
+    }
+    const int port = args.server_address->address.port();
+    if (port == 53 || port == 80 || port == 443 || port >= 1024) {
+        return true;
+    }
+    if (webrtc::field_trial::IsEnabled("WebRTC-Turn-AllowSystemPorts")) {
+        return true;
+    }
+    RTC_LOG(LS_ERROR) << "Attempt to use TURN to connect to port " << port;
+    return false;
+}
+
+class NonceCachingTurnPortFactory : public cricket::RelayPortFactoryInterface {
+public:
+    std::unique_ptr<cricket::Port> Create(cricket::CreateRelayPortArgs const &args, rtc::AsyncPacketSocket *udp_socket) override {
+        if (!allowedServer(args)) {
+            return nullptr;
+        }
+        auto port = std::make_unique<NonceCachingTurnPort>(args, udp_socket);
+        port->SetTlsCertPolicy(args.config->tls_cert_policy);
+        port->SetTurnLoggingId(args.config->turn_logging_id);
+        return port;
+    }
+
+    std::unique_ptr<cricket::Port> Create(cricket::CreateRelayPortArgs const &args, int min_port, int max_port) override {
+        if (!allowedServer(args)) {
+            return nullptr;
+        }
+        auto port = std::make_unique<NonceCachingTurnPort>(args, min_port, max_port);
+        port->SetTlsCertPolicy(args.config->tls_cert_policy);
+        port->SetTurnLoggingId(args.config->turn_logging_id);
+        return port;
+    }
+};
+
+} // namespace
+
+cricket::RelayPortFactoryInterface *TurnNonceCache::relayPortFactory() {
+    static NonceCachingTurnPortFactory *factory = new NonceCachingTurnPortFactory();
+    return factory;
+}
+
+void TurnNonceCache::clear() {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.nonces.clear();
+}
+
+TurnNonceCache::Stats TurnNonceCache::stats() {
+    auto &state = registry();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    Stats stats = state.stats;
+    stats.entries = static_cast<int>(state.nonces.size());
+    return stats;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,46 @@
+#ifndef TGCALLS_TURN_NONCE_CACHE_H
+#define TGCALLS_TURN_NONCE_CACHE_H
+
+#include <cstdint>
+
+namespace cricket {
+class RelayPortFactoryInterface;
+}
+
+namespace tgcalls {
+
+// TURN authentication shared by every call in the process.
+//
+// A TURN allocation starts with an unauthenticated request the server
+// answers with 401 and the realm and nonce to sign with, so every call
+// pays a round trip to each relay before it gets a relay candidate. Relay
+// ports made by relayPortFactory() remember the realm and nonce of the last
+// allocation with the same server and credentials, and sign their first
+// request with them, for |kTtlMs|. A server that no longer takes the nonce
+// answers 401 or 438, and the port then goes through the usual challenge,
+// as it would have without the cache.
+class TurnNonceCache {
+public:
+    struct Stats {
+        // Allocations that were signed from the cache on the first request,
+        // those the server accepted, and those it challenged again.
+        uint64_t seededAllocations = 0;
+        uint64_t acceptedSeeds = 0;
+        uint64_t rejectedSeeds = 0;
+        // Servers with a nonce cached.
+        int entries = 0;
+    };
+
+    static constexpr int64_t kTtlMs = 5 * 60 * 1000;
+
+    // Makes TURN ports like cricket::TurnPortFactory, for any
+    // cricket::BasicPortAllocator; lives as long as the process.
+    static cricket::RelayPortFactoryInterface *relayPortFactory();
+
+    static void clear();
+    static Stats stats();
+};
+
+} // namespace tgcalls
+
+#endif
@@ -12,6 +12,7 @@
 #include <memory>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include <functional>
@@ -22,8 +23,10 @@
 #include "api/video/video_frame.h"
 #include "modules/desktop_capture/desktop_and_cursor_composer.h"
 #include "modules/desktop_capture/desktop_capturer.h"
+#include "modules/desktop_capture/desktop_region.h"
 #include "system_wrappers/include/clock.h"
 #include "api/video/i420_buffer.h"
+#include "common_video/include/video_frame_buffer_pool.h"
 #include "third_party/libyuv/include/libyuv.h"
 
 #ifdef WEBRTC_MAC
@@ -33,6 +36,13 @@
 namespace tgcalls {
 namespace {
 
+// Frames handed to the sinks that may still be waiting for the encoder.
+constexpr auto kMaxQueuedFrames = 8;
+
+// While nothing on screen changes, the last frame is sent again this often
+// with an empty update rect, which the encoder turns into a tiny frame.
+constexpr auto kStaticRepeatMs = 500;
+
 DesktopSize AspectFitted(DesktopSize from, DesktopSize to) {
     double scale = std::min(
         from.width / std::max(1., double(to.width)),
@@ -43,6 +53,29 @@ DesktopSize AspectFitted(DesktopSize from, DesktopSize to) {
     };
 }
 
+// The updated rects of a |from| sized frame, mapped onto the |to| sized
+// output. Grown by a pixel for what bilinear scaling reads around them and
+// to even coordinates, so that their I420 chroma doesn't mix old and new.
+std::vector<webrtc::DesktopRect> ScaledUpdatedRects(
+        const webrtc::DesktopRegion &region,
+        webrtc::DesktopSize from,
+        webrtc::DesktopSize to) {
+    auto result = std::vector<webrtc::DesktopRect>();
+    const auto scaleX = to.width() / std::max(1., double(from.width()));
+    const auto scaleY = to.height() / std::max(1., double(from.height()));
+    for (webrtc::DesktopRegion::Iterator i(region); !i.IsAtEnd(); i.Advance()) {
+        const auto &rect = i.rect();
+        const auto left = std::max(0, int(std::floor(rect.left() * scaleX)) - 1) & ~1;
+        const auto top = std::max(0, int(std::floor(rect.top() * scaleY)) - 1) & ~1;
+        const auto right = std::min(to.width(), (int(std::ceil(rect.right() * scaleX)) + 2) & ~1);
+        const auto bottom = std::min(to.height(), (int(std::ceil(rect.bottom() * scaleY)) + 2) & ~1);
+        if (left < right && top < bottom) {
+            result.push_back(webrtc::DesktopRect::MakeLTRB(left, top, right, bottom));
+        }
+    }
+    return result;
+}
+
 #ifdef WEBRTC_MAC
 class CaptureScheduler {
 public:
@@ -103,7 +136,20 @@ public:
     void setOnFatalError(std::function<void ()>);
     void setOnPause(std::function<void (bool)>);
 private:
-    rtc::scoped_refptr<webrtc::I420Buffer> i420_buffer_;
+    void sendFrame(
+        rtc::scoped_refptr<webrtc::I420Buffer> buffer,
+        absl::optional<webrtc::VideoFrame::UpdateRect> updateRect,
+        webrtc::Timestamp now);
+
+    // Reused while the captured size stays the same; the pool only hands
+    // out buffers that no sink holds on to anymore.
+    std::unique_ptr<webrtc::BasicDesktopFrame> _scaledFrame;
+    webrtc::VideoFrameBufferPool _bufferPool;
+    // The last frame sent, repeated while nothing changes and the base of
+    // the next one while only parts of the screen do.
+    rtc::scoped_refptr<webrtc::I420Buffer> _lastBuffer;
+    webrtc::DesktopSize _lastSourceSize;
+    int64_t _lastSentMs = 0;
 	std::shared_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> _sink;
 	std::shared_ptr<
         rtc::VideoSinkInterface<webrtc::VideoFrame>> _secondarySink;
@@ -141,7 +187,8 @@ private:
 };
 
 SourceFrameCallbackImpl::SourceFrameCallbackImpl(DesktopSize size, int fps)
-: size_(size) {
+: _bufferPool(false, kMaxQueuedFrames)
+, size_(size) {
 }
 
 void SourceFrameCallbackImpl::OnCaptureResult(
@@ -163,6 +210,7 @@ void SourceFrameCallbackImpl::OnCaptureResult(
         _onPause(false);
     }
 
+    const auto now = webrtc::Clock::GetRealTimeClock()->CurrentTime();
     const auto frameSize = frame->size();
     DesktopSize fittedSize = AspectFitted(
         size_,
@@ -175,64 +223,128 @@ void SourceFrameCallbackImpl::OnCaptureResult(
         fittedSize.width,
         fittedSize.height
     };
+    const auto width = outputSize.width();
+    const auto height = outputSize.height();
+
+    // The capturer reports what changed since its previous frame, which is
+    // what the last one sent was made of as long as the sizes stay put.
+    const auto canReuseLast = _lastBuffer
+        && _lastSourceSize.equals(frameSize)
+        && _lastBuffer->width() == width
+        && _lastBuffer->height() == height;
+    auto dirtyRects = std::vector<webrtc::DesktopRect>();
+    auto dirtyArea = int64_t(0);
+    if (canReuseLast) {
+        dirtyRects = ScaledUpdatedRects(frame->updated_region(), frameSize, outputSize);
+        for (const auto &rect : dirtyRects) {
+            dirtyArea += int64_t(rect.width()) * rect.height();
+        }
+        if (dirtyRects.empty()) {
+            if (now.ms() - _lastSentMs >= kStaticRepeatMs) {
+                sendFrame(_lastBuffer, webrtc::VideoFrame::UpdateRect{ 0, 0, 0, 0 }, now);
+            }
+            return;
+        }
+    }
 
-    webrtc::BasicDesktopFrame outputFrame{ outputSize };
-
-	const auto outputRect = webrtc::DesktopRect::MakeSize(outputSize);
-
-	const auto outputRectData = outputFrame.data() +
-        outputFrame.stride() * outputRect.top() +
-		webrtc::DesktopFrame::kBytesPerPixel * outputRect.left();
-
-
-	libyuv::ARGBScale(
-		frame->data(),
-		frame->stride(),
-		frame->size().width(),
-		frame->size().height(),
-        outputRectData,
-        outputFrame.stride(),
-        outputSize.width(),
-        outputSize.height(),
-		libyuv::kFilterBilinear);
+    if (!_scaledFrame || !_scaledFrame->size().equals(outputSize)) {
+        _scaledFrame = std::make_unique<webrtc::BasicDesktopFrame>(outputSize);
+    }
+    auto &outputFrame = *_scaledFrame;
 
-	int width = outputFrame.size().width();
-	int height = outputFrame.size().height();
-	int stride_y = width;
-	int stride_uv = (width + 1) / 2;
+	const auto i420Buffer = _bufferPool.CreateI420Buffer(width, height);
+	if (!i420Buffer) {
+		return;
+	}
 
-	if (!i420_buffer_
-        || i420_buffer_->width() != width
-        || i420_buffer_->height() != height) {
-		i420_buffer_ = webrtc::I420Buffer::Create(
+    auto updateRect = absl::optional<webrtc::VideoFrame::UpdateRect>();
+    if (canReuseLast && dirtyArea * 2 < int64_t(width) * height) {
+        // Copying the last frame is much cheaper than scaling and
+        // converting all of it; only the updated rects are redone.
+        libyuv::I420Copy(
+            _lastBuffer->DataY(), _lastBuffer->StrideY(),
+            _lastBuffer->DataU(), _lastBuffer->StrideU(),
+            _lastBuffer->DataV(), _lastBuffer->StrideV(),
+            i420Buffer->MutableDataY(), i420Buffer->StrideY(),
+            i420Buffer->MutableDataU(), i420Buffer->StrideU(),
+            i420Buffer->MutableDataV(), i420Buffer->StrideV(),
+            width, height);
+        auto bounds = webrtc::VideoFrame::UpdateRect{ 0, 0, 0, 0 };
+        for (const auto &rect : dirtyRects) {
+            libyuv::ARGBScaleClip(
+                frame->data(),
+                frame->stride(),
+                frameSize.width(),
+                frameSize.height(),
+                outputFrame.data(),
+                outputFrame.stride(),
+                width,
+                height,
+                rect.left(),
+                rect.top(),
+                rect.width(),
+                rect.height(),
+                libyuv::kFilterBilinear);
+            libyuv::ARGBToI420(
+                outputFrame.GetFrameDataAtPos(rect.top_left()),
+                outputFrame.stride(),
+                i420Buffer->MutableDataY() + rect.top() * i420Buffer->StrideY() + rect.left(),
+                i420Buffer->StrideY(),
+                i420Buffer->MutableDataU() + (rect.top() / 2) * i420Buffer->StrideU() + rect.left() / 2,
+                i420Buffer->StrideU(),
+                i420Buffer->MutableDataV() + (rect.top() / 2) * i420Buffer->StrideV() + rect.left() / 2,
+                i420Buffer->StrideV(),
+                rect.width(),
+                rect.height());
+            bounds.Union({ rect.left(), rect.top(), rect.width(), rect.height() });
+        }
+        updateRect = bounds;
+    } else {
+        libyuv::ARGBScale(
+            frame->data(),
+            frame->stride(),
+            frameSize.width(),
+            frameSize.height(),
+            outputFrame.data(),
+            outputFrame.stride(),
             width,
             height,
-            stride_y,
-            stride_uv,
-            stride_uv);
-	}
+            libyuv::kFilterBilinear);
+
+        int i420Result = libyuv::ConvertToI420(
+            outputFrame.data(),
+            width * height,
+            i420Buffer->MutableDataY(), i420Buffer->StrideY(),
+            i420Buffer->MutableDataU(), i420Buffer->StrideU(),
+            i420Buffer->MutableDataV(), i420Buffer->StrideV(),
+            0, 0,
+            width, height,
+            width, height,
+            libyuv::kRotate0,
+            libyuv::FOURCC_ARGB);
+
+        assert(i420Result == 0);
+        (void)i420Result;
+    }
 
-	int i420Result = libyuv::ConvertToI420(
-        outputFrame.data(),
-		width * height,
-		i420_buffer_->MutableDataY(), i420_buffer_->StrideY(),
-		i420_buffer_->MutableDataU(), i420_buffer_->StrideU(),
-		i420_buffer_->MutableDataV(), i420_buffer_->StrideV(),
-		0, 0,
-		width, height,
-		width, height,
-		libyuv::kRotate0,
-		libyuv::FOURCC_ARGB);
-
-
-	assert(i420Result == 0);
-	(void)i420Result;
-	webrtc::VideoFrame nativeVideoFrame = webrtc::VideoFrame(
-		i420_buffer_,
-		webrtc::kVideoRotation_0,
-        webrtc::Clock::GetRealTimeClock()->CurrentTime().us());
+    _lastBuffer = i420Buffer;
+    _lastSourceSize = frameSize;
+    sendFrame(i420Buffer, updateRect, now);
+}
+
+void SourceFrameCallbackImpl::sendFrame(
+        rtc::scoped_refptr<webrtc::I420Buffer> buffer,
+        absl::optional<webrtc::VideoFrame::UpdateRect> updateRect,
+        webrtc::Timestamp now) {
+    _lastSentMs = now.ms();
+    const auto nativeVideoFrame = webrtc::VideoFrame::Builder()
+        .set_video_frame_buffer(std::move(buffer))
+        .set_rotation(webrtc::kVideoRotation_0)
+        .set_timestamp_us(now.us())
+        .set_update_rect(updateRect)
+        .build();
 	if (const auto sink = _sink.get()) {
-		_sink->OnFrame(nativeVideoFrame);
+		sink->OnFrame(nativeVideoFrame);
 	}
 	if (const auto sink = _secondarySink.get()) {
 		sink->OnFrame(nativeVideoFrame);
@@ -0,0 +1,287 @@
+#include "group/BatchedUdpSocket.h"
+
+#include "rtc_base/async_packet_socket.h"
+#include "rtc_base/async_udp_socket.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/physical_socket_server.h"
+#include "rtc_base/task_utils/pending_task_safety_flag.h"
+#include "rtc_base/task_utils/to_queued_task.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <errno.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace tgcalls {
+
+namespace {
+
+#if defined(__linux__)
+
+int BindUdpSocket(rtc::AsyncSocket *socket, const rtc::SocketAddress &localAddress, uint16_t minPort, uint16_t maxPort) {
+    int result = -1;
+    if (minPort == 0 && maxPort == 0) {
+        result = socket->Bind(localAddress);
+    } else {
+        for (int port = minPort; result < 0 && port <= maxPort; ++port) {
+            result = socket->Bind(rtc::SocketAddress(localAddress.ipaddr(), port));
+        }
+    }
+    return result;
+}
+
+// Drop-in replacement for rtc::AsyncUDPSocket over a SocketDispatcher.
+// Everything but the datagram I/O itself (binding, options, errors and
+// read/write event registration) stays with the dispatcher.
+class BatchedUdpSocket : public rtc::AsyncPacketSocket {
+public:
+    // Datagrams moved per recvmmsg() / sendmmsg() call.
+    static constexpr int kBatchSize = 32;
+    // Read buffers are sized for anything ICE, DTLS or RTP may send;
+    // truncated datagrams are dropped like oversized ones on the wire.
+    static constexpr size_t kMaxDatagramSize = 4096;
+    // recvmmsg() rounds per read event, so one busy socket can't keep the
+    // network thread from its other work.
+    static constexpr int kMaxReadRounds = 4;
+
+    BatchedUdpSocket(rtc::Thread *thread, rtc::SocketDispatcher *socket) :
+    _thread(thread),
+    _socket(socket),
+    _descriptor(socket->GetDescriptor()),
+    _readBuffers(kBatchSize * kMaxDatagramSize) {
+        _socket->SignalReadEvent.connect(this, &BatchedUdpSocket::onReadEvent);
+        _socket->SignalWriteEvent.connect(this, &BatchedUdpSocket::onWriteEvent);
+        _pendingSends.reserve(kBatchSize);
+        _sendingBatch.reserve(kBatchSize);
+    }
+
+    rtc::SocketAddress GetLocalAddress() const override {
+        return _socket->GetLocalAddress();
+    }
+
+    rtc::SocketAddress GetRemoteAddress() const override {
+        return _socket->GetRemoteAddress();
+    }
+
+    int Send(const void *data, size_t size, const rtc::PacketOptions &options) override {
+        // Unconnected, like every UDP socket the port allocator creates.
+        return SendTo(data, size, _socket->GetRemoteAddress(), options);
+    }
+
+    int SendTo(const void *data, size_t size, const rtc::SocketAddress &address, const rtc::PacketOptions &options) override {
+        RTC_DCHECK(_thread->IsCurrent());
+
+        PendingSend send;
+        send.data.assign(static_cast<const uint8_t *>(data), static_cast<const uint8_t *>(data) + size);
+        send.address = address;
+        send.sentPacket = rtc::SentPacket(options.packet_id, rtc::TimeMillis(), options.info_signaled_after_sent);
+        CopySocketInformationToPacketInfo(size, *this, true, &send.sentPacket.info);
+        _pendingSends.push_back(std::move(send));
+
+        if (_pendingSends.size() >= kBatchSize) {
+            flushSends();
+        } else if (!_isFlushScheduled) {
+            _isFlushScheduled = true;
+            _thread->PostTask(webrtc::ToQueuedTask(_safety, [this]() {
+                flushSends();
+            }));
+        }
+        // A datagram that fails to go out later is dropped, as it would be
+        // under load anyway; a blocked socket still reports ReadyToSend.
+        return static_cast<int>(size);
+    }
+
+    int Close() override {
+        _pendingSends.clear();
+        return _socket->Close();
+    }
+
+    State GetState() const override {
+        return STATE_BOUND;
+    }
+
+    int GetOption(rtc::Socket::Option option, int *value) override {
+        return _socket->GetOption(option, value);
+    }
+
+    int SetOption(rtc::Socket::Option option, int value) override {
+        return _socket->SetOption(option, value);
+    }
+
+    int GetError() const override {
+        return _socket->GetError();
+    }
+
+    void SetError(int error) override {
+        _socket->SetError(error);
+    }
+
+private:
+    struct PendingSend {
+        std::vector<uint8_t> data;
+        rtc::SocketAddress address;
+        rtc::SentPacket sentPacket;
+    };
+
+    void flushSends() {
+        _isFlushScheduled = false;
+        if (_pendingSends.empty()) {
+            return;
+        }
+        // Sent packet handlers may send again; those queue for the next flush.
+        _sendingBatch.swap(_pendingSends);
+
+        std::array<mmsghdr, kBatchSize> messages;
+        std::array<iovec, kBatchSize> vectors;
+        std::array<sockaddr_storage, kBatchSize> addresses;
+
+        size_t offset = 0;
+        while (offset < _sendingBatch.size()) {
+            size_t count = std::min(_sendingBatch.size() - offset, static_cast<size_t>(kBatchSize));
+            for (size_t i = 0; i < count; i++) {
+                auto &send = _sendingBatch[offset + i];
+                vectors[i].iov_base = send.data.data();
+                vectors[i].iov_len = send.data.size();
+                memset(&messages[i], 0, sizeof(mmsghdr));
+                messages[i].msg_hdr.msg_name = &addresses[i];
+                messages[i].msg_hdr.msg_namelen = static_cast<socklen_t>(send.address.ToSockAddrStorage(&addresses[i]));
+                messages[i].msg_hdr.msg_iov = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int sent = sendmmsg(_descriptor, messages.data(), static_cast<unsigned int>(count), MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent <= 0) {
+                // Let the dispatcher see the error: on a full send buffer
+                // this arms the write event and so SignalReadyToSend.
+                auto &send = _sendingBatch[offset];
+                _socket->SendTo(send.data.data(), send.data.size(), send.address);
+                SignalSentPacket(this, send.sentPacket);
+                if (_socket->IsBlocking()) {
+                    break;
+                }
+                offset++;
+                continue;
+            }
+            for (int i = 0; i < sent; i++) {
+                SignalSentPacket(this, _sendingBatch[offset + i].sentPacket);
+            }
+            offset += sent;
+        }
+        _sendingBatch.clear();
+    }
+
+    void onReadEvent(rtc::AsyncSocket *socket) {
+        RTC_DCHECK(socket == _socket.get());
+
+        std::array<mmsghdr, kBatchSize> messages;
+        std::array<iovec, kBatchSize> vectors;
+        std::array<sockaddr_storage, kBatchSize> addresses;
+
+        for (int round = 0; round < kMaxReadRounds; round++) {
+            for (int i = 0; i < kBatchSize; i++) {
+                vectors[i].iov_base = _readBuffers.data() + i * kMaxDatagramSize;
+                vectors[i].iov_len = kMaxDatagramSize;
+                memset(&messages[i], 0, sizeof(mmsghdr));
+                messages[i].msg_hdr.msg_name = &addresses[i];
+                messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+                messages[i].msg_hdr.msg_iov = &vectors[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int received = recvmmsg(_descriptor, messages.data(), kBatchSize, MSG_DONTWAIT, nullptr);
+            if (received <= 0) {
+                break;
+            }
+            int64_t timestamp = rtc::TimeMicros();
+            for (int i = 0; i < received; i++) {
+                if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                    continue;
+                }
+                rtc::SocketAddress remoteAddress;
+                rtc::SocketAddressFromSockAddrStorage(addresses[i], &remoteAddress);
+                SignalReadPacket(this, reinterpret_cast<const char *>(vectors[i].iov_base), messages[i].msg_len, remoteAddress, timestamp);
+                if (_socket->GetState() == rtc::Socket::CS_CLOSED) {
+                    // Closed from a read handler.
+                    return;
+                }
+            }
+            if (received < kBatchSize) {
+                break;
+            }
+        }
+
+        // The dispatcher disables read events before signalling and only
+        // re-enables them from RecvFrom(), which also picks up a datagram
+        // that arrived after the last batch.
+        rtc::SocketAddress remoteAddress;
+        int64_t timestamp = -1;
+        int length = _socket->RecvFrom(_readBuffers.data(), kMaxDatagramSize, &remoteAddress, &timestamp);
+        if (length >= 0) {
+            SignalReadPacket(this, reinterpret_cast<const char *>(_readBuffers.data()), static_cast<size_t>(length), remoteAddress, timestamp > -1 ? timestamp : rtc::TimeMicros());
+        }
+    }
+
+    void onWriteEvent(rtc::AsyncSocket *socket) {
+        SignalReadyToSend(this);
+    }
+
+    rtc::Thread *_thread = nullptr;
+    std::unique_ptr<rtc::SocketDispatcher> _socket;
+    int _descriptor = -1;
+    std::vector<uint8_t> _readBuffers;
+    std::vector<PendingSend> _pendingSends;
+    std::vector<PendingSend> _sendingBatch;
+    bool _isFlushScheduled = false;
+    webrtc::ScopedTaskSafety _safety;
+};
+
+#endif // __linux__
+
+} // namespace
+
+BatchedPacketSocketFactory::BatchedPacketSocketFactory(rtc::Thread *thread) :
+rtc::BasicPacketSocketFactory(thread),
+_thread(thread) {
+}
+
+BatchedPacketSocketFactory::~BatchedPacketSocketFactory() = default;
+
+bool BatchedPacketSocketFactory::IsSupported() {
+#if defined(__linux__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+rtc::AsyncPacketSocket *BatchedPacketSocketFactory::CreateUdpSocket(const rtc::SocketAddress &localAddress, uint16_t minPort, uint16_t maxPort) {
+#if defined(__linux__)
+    RTC_DCHECK(_thread->IsCurrent());
+
+    // The network thread is created with the default socket server, so its
+    // sockets are SocketDispatchers with a descriptor to batch on.
+    rtc::AsyncSocket *socket = _thread->socketserver()->CreateAsyncSocket(localAddress.family(), SOCK_DGRAM);
+    if (!socket) {
+        return nullptr;
+    }
+    if (BindUdpSocket(socket, localAddress, minPort, maxPort) < 0) {
+        RTC_LOG(LS_ERROR) << "UDP bind failed with error " << socket->GetError();
+        delete socket;
+        return nullptr;
+    }
+    return new BatchedUdpSocket(_thread, static_cast<rtc::SocketDispatcher *>(socket));
+#else
+    return rtc::BasicPacketSocketFactory::CreateUdpSocket(localAddress, minPort, maxPort);
+#endif
+}
+
+} // namespace tgcalls
@@ -0,0 +1,36 @@
+#ifndef TGCALLS_BATCHED_UDP_SOCKET_H
+#define TGCALLS_BATCHED_UDP_SOCKET_H
+
+#include "p2p/base/basic_packet_socket_factory.h"
+
+namespace rtc {
+class Thread;
+} // namespace rtc
+
+namespace tgcalls {
+
+// Packet socket factory whose UDP sockets move datagrams in batches: every
+// read event drains the socket with recvmmsg(), and the packets sent during
+// one network thread task leave with a single sendmmsg() once it returns.
+// A group call with many speakers then takes a couple of syscalls per
+// wakeup instead of one per packet.
+//
+// Linux only, and only for sockets of the thread's PhysicalSocketServer;
+// elsewhere this behaves exactly like rtc::BasicPacketSocketFactory.
+class BatchedPacketSocketFactory : public rtc::BasicPacketSocketFactory {
+public:
+    explicit BatchedPacketSocketFactory(rtc::Thread *thread);
+    ~BatchedPacketSocketFactory() override;
+
+    // True where batched sockets are created instead of rtc::AsyncUDPSocket.
+    static bool IsSupported();
+
+    rtc::AsyncPacketSocket *CreateUdpSocket(const rtc::SocketAddress &localAddress, uint16_t minPort, uint16_t maxPort) override;
+
+private:
+    rtc::Thread *_thread = nullptr;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,294 @@
+#include "group/BroadcastPartCache.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "rtc_base/time_utils.h"
+
+namespace tgcalls {
+
+namespace {
+
+// How long a fetched part is kept for calls that ask for it later. Calls of
+// one chat stay within a few parts of each other, as they all follow the
+// live edge.
+constexpr int64_t kRetainedPartMs = 10000;
+
+using PartId = std::pair<std::string, int64_t>;
+// Parts decoded for different SSRCs don't share PCM.
+using DecodeId = std::pair<PartId, std::vector<uint32_t>>;
+
+class SharedPartTask;
+
+struct FetchEntry {
+    int64_t durationMilliseconds = 0;
+    // Waiting for the part, in the order they asked; the first is fetching.
+    std::vector<std::shared_ptr<SharedPartTask>> waiters;
+    std::shared_ptr<BroadcastPartTask> upstream;
+    // Told apart from a fetch given up on, whose result may still arrive.
+    uint64_t fetchId = 0;
+    bool isFetched = false;
+    BroadcastPart part;
+    int64_t fetchedAtMs = 0;
+};
+
+struct DecodeEntry {
+    bool isDecoding = false;
+    std::weak_ptr<const BroadcastPartDecoder::DecodedPart> decoded;
+    std::vector<std::function<void(BroadcastPartCache::DecodedPart)>> waiters;
+};
+
+// What request() hands to each call: cancelling it only stops that call
+// waiting.
+class SharedPartTask : public BroadcastPartTask {
+public:
+    SharedPartTask(PartId id, BroadcastPartCache::RequestPart requestPart, std::function<void(BroadcastPart &&)> done) :
+    id(std::move(id)),
+    requestPart(std::move(requestPart)),
+    done(std::move(done)) {
+    }
+
+    void cancel() override;
+
+    const PartId id;
+    const BroadcastPartCache::RequestPart requestPart;
+    // Taken by whoever delivers the part, under the cache's mutex.
+    std::function<void(BroadcastPart &&)> done;
+};
+
+class Cache {
+public:
+    std::shared_ptr<BroadcastPartTask> request(PartId id, int64_t durationMilliseconds, BroadcastPartCache::RequestPart const &requestPart, std::function<void(BroadcastPart &&)> done) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _stats.requests++;
+        const int64_t now = rtc::TimeMillis();
+        for (auto it = _fetches.begin(); it != _fetches.end(); ) {
+            if (it->second.isFetched && now - it->second.fetchedAtMs > kRetainedPartMs) {
+                it = _fetches.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        auto &entry = _fetches[id];
+        if (entry.isFetched) {
+            BroadcastPart part = entry.part;
+            // As if the server had answered just now, which paces the next
+            // request the same.
+            part.responseTimestamp += (double)(now - entry.fetchedAtMs) / 1000.0;
+            lock.unlock();
+            done(std::move(part));
+            return nullptr;
+        }
+
+        auto task = std::make_shared<SharedPartTask>(id, requestPart, std::move(done));
+        entry.durationMilliseconds = durationMilliseconds;
+        entry.waiters.push_back(task);
+        if (entry.waiters.size() == 1) {
+            startFetch(id, entry, lock);
+        }
+        return task;
+    }
+
+    void cancel(SharedPartTask *task) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        auto it = _fetches.find(task->id);
+        if (it == _fetches.end()) {
+            return;
+        }
+        auto &entry = it->second;
+        auto waiter = std::find_if(entry.waiters.begin(), entry.waiters.end(), [task](auto const &waiter) {
+            return waiter.get() == task;
+        });
+        if (waiter == entry.waiters.end()) {
+            return;
+        }
+        const bool wasFetching = waiter == entry.waiters.begin();
+        entry.waiters.erase(waiter);
+        task->done = nullptr;
+        if (!wasFetching) {
+            return;
+        }
+
+        auto upstream = std::move(entry.upstream);
+        entry.upstream = nullptr;
+        entry.fetchId++;
+        if (entry.waiters.empty()) {
+            _fetches.erase(it);
+            lock.unlock();
+        } else {
+            // The call that asked first may be leaving, so its callback
+            // can't be relied on to deliver; the next one fetches again.
+            startFetch(task->id, entry, lock);
+        }
+        if (upstream) {
+            upstream->cancel();
+        }
+    }
+
+    void decode(DecodeId id, std::vector<uint8_t> &&oggData, std::function<void(BroadcastPartCache::DecodedPart)> completion) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _stats.decodes++;
+        for (auto it = _decodes.begin(); it != _decodes.end(); ) {
+            if (!it->second.isDecoding && it->second.decoded.expired()) {
+                it = _decodes.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        auto &entry = _decodes[id];
+        if (auto decoded = entry.decoded.lock()) {
+            _stats.sharedDecodes++;
+            lock.unlock();
+            completion(std::move(decoded));
+            return;
+        }
+        entry.waiters.push_back(std::move(completion));
+        if (entry.isDecoding) {
+            _stats.sharedDecodes++;
+            return;
+        }
+        entry.isDecoding = true;
+        lock.unlock();
+
+        BroadcastPartDecoder::decode(std::move(oggData), id.second, [this, id](BroadcastPartDecoder::DecodedPart &&decodedPart) {
+            auto decoded = std::make_shared<const BroadcastPartDecoder::DecodedPart>(std::move(decodedPart));
+            std::vector<std::function<void(BroadcastPartCache::DecodedPart)>> waiters;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                auto &entry = _decodes[id];
+                entry.isDecoding = false;
+                entry.decoded = decoded;
+                waiters = std::move(entry.waiters);
+                entry.waiters.clear();
+            }
+            for (auto &waiter : waiters) {
+                waiter(decoded);
+            }
+        });
+    }
+
+    BroadcastPartCache::Stats stats() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto stats = _stats;
+        stats.cachedParts = 0;
+        for (auto const &it : _fetches) {
+            if (it.second.isFetched) {
+                stats.cachedParts++;
+            }
+        }
+        return stats;
+    }
+
+private:
+    // Fetches through the first waiter's callback. Called with |lock| held,
+    // returns with it released: the callback may deliver the part at once.
+    void startFetch(PartId const &id, FetchEntry &entry, std::unique_lock<std::mutex> &lock) {
+        _stats.fetches++;
+        const uint64_t fetchId = ++entry.fetchId;
+        const auto requestPart = entry.waiters.front()->requestPart;
+        const int64_t durationMilliseconds = entry.durationMilliseconds;
+        lock.unlock();
+
+        auto upstream = requestPart(id.second, durationMilliseconds, [this, id, fetchId](BroadcastPart &&part) {
+            onFetched(id, fetchId, std::move(part));
+        });
+        if (!upstream) {
+            return;
+        }
+
+        lock.lock();
+        auto it = _fetches.find(id);
+        if (it != _fetches.end() && it->second.fetchId == fetchId && !it->second.isFetched) {
+            it->second.upstream = std::move(upstream);
+            lock.unlock();
+        } else {
+            // Given up on, or already delivered, while it was being asked for.
+            lock.unlock();
+            upstream->cancel();
+        }
+    }
+
+    void onFetched(PartId const &id, uint64_t fetchId, BroadcastPart &&part) {
+        std::vector<std::function<void(BroadcastPart &&)>> waiters;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _fetches.find(id);
+            if (it == _fetches.end() || it->second.fetchId != fetchId || it->second.isFetched) {
+                return;
+            }
+            for (auto &waiter : it->second.waiters) {
+                waiters.push_back(std::move(waiter->done));
+                waiter->done = nullptr;
+            }
+            if (part.status == BroadcastPart::Status::Success) {
+                auto &entry = it->second;
+                entry.waiters.clear();
+                entry.upstream = nullptr;
+                entry.isFetched = true;
+                entry.part = part;
+                entry.fetchedAtMs = rtc::TimeMillis();
+            } else {
+                // Not ready yet or out of sync: every call asks again when
+                // its own schedule says so.
+                _fetches.erase(it);
+            }
+        }
+        for (size_t i = 0; i < waiters.size(); i++) {
+            if (!waiters[i]) {
+                continue;
+            }
+            if (i + 1 == waiters.size()) {
+                waiters[i](std::move(part));
+            } else {
+                waiters[i](BroadcastPart(part));
+            }
+        }
+    }
+
+    std::mutex _mutex;
+    std::map<PartId, FetchEntry> _fetches;
+    std::map<DecodeId, DecodeEntry> _decodes;
+    BroadcastPartCache::Stats _stats;
+};
+
+Cache &cache() {
+    // Never destroyed: fetches and decodes may complete while the process
+    // exits.
+    static Cache *cache = new Cache();
+    return *cache;
+}
+
+void SharedPartTask::cancel() {
+    cache().cancel(this);
+}
+
+} // namespace
+
+std::shared_ptr<BroadcastPartTask> BroadcastPartCache::request(std::string const &key, int64_t timestampMilliseconds, int64_t durationMilliseconds, RequestPart const &requestPart, std::function<void(BroadcastPart &&)> done) {
+    if (key.empty()) {
+        return requestPart(timestampMilliseconds, durationMilliseconds, std::move(done));
+    }
+    return cache().request(PartId(key, timestampMilliseconds), durationMilliseconds, requestPart, std::move(done));
+}
+
+void BroadcastPartCache::decode(std::string const &key, int64_t timestampMilliseconds, std::vector<uint32_t> const &decodedSsrcs, std::vector<uint8_t> &&oggData, std::function<void(DecodedPart)> completion) {
+    if (key.empty()) {
+        BroadcastPartDecoder::decode(std::move(oggData), decodedSsrcs, [completion = std::move(completion)](BroadcastPartDecoder::DecodedPart &&decoded) {
+            completion(std::make_shared<const BroadcastPartDecoder::DecodedPart>(std::move(decoded)));
+        });
+        return;
+    }
+    std::vector<uint32_t> sortedSsrcs = decodedSsrcs;
+    std::sort(sortedSsrcs.begin(), sortedSsrcs.end());
+    cache().decode(DecodeId(PartId(key, timestampMilliseconds), std::move(sortedSsrcs)), std::move(oggData), std::move(completion));
+}
+
+BroadcastPartCache::Stats BroadcastPartCache::stats() {
+    return cache().stats();
+}
+
+} // namespace tgcalls
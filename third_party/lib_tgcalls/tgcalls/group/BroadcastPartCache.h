@@ -0,0 +1,58 @@
+#ifndef TGCALLS_BROADCAST_PART_CACHE_H
+#define TGCALLS_BROADCAST_PART_CACHE_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "GroupInstanceImpl.h"
+#include "BroadcastPartDecoder.h"
+
+namespace tgcalls {
+
+// Process-wide sharing of broadcast parts between group calls listening to
+// the same stream, e.g. several accounts in one chat. Calls name the stream
+// with a key; for each part of it only one of them fetches it, and only one
+// decodes it, however many calls play it.
+//
+// Calls with an empty key share nothing and go straight to their own
+// requestBroadcastPart and to BroadcastPartDecoder.
+class BroadcastPartCache {
+public:
+    using RequestPart = std::function<std::shared_ptr<BroadcastPartTask>(int64_t, int64_t, std::function<void(BroadcastPart &&)>)>;
+    using DecodedPart = std::shared_ptr<const BroadcastPartDecoder::DecodedPart>;
+
+    struct Stats {
+        uint64_t requests = 0;
+        // Requests that went to a requestBroadcastPart callback; the others
+        // joined one in flight or took a part fetched before.
+        uint64_t fetches = 0;
+        uint64_t decodes = 0;
+        // Decodes that shared the PCM of another call's.
+        uint64_t sharedDecodes = 0;
+        // Fetched parts kept for calls lagging behind.
+        size_t cachedParts = 0;
+    };
+
+    // Gets the part at |timestampMilliseconds| of |key|'s stream. The first
+    // call asking for it fetches it through its |requestPart|, and the
+    // others wait for that; should the fetching call cancel, the next one
+    // fetches instead. A part fetched successfully in the last few seconds
+    // is handed out at once. |done| gets a copy of the part, on whatever
+    // thread delivered it, or within this call.
+    static std::shared_ptr<BroadcastPartTask> request(std::string const &key, int64_t timestampMilliseconds, int64_t durationMilliseconds, RequestPart const &requestPart, std::function<void(BroadcastPart &&)> done);
+
+    // Decodes a part fetched with request() on a BroadcastPartDecoder thread,
+    // unless the same part of |key| is already decoded or decoding for
+    // another call with the same |decodedSsrcs|, and calls |completion| with
+    // the shared PCM.
+    static void decode(std::string const &key, int64_t timestampMilliseconds, std::vector<uint32_t> const &decodedSsrcs, std::vector<uint8_t> &&oggData, std::function<void(DecodedPart)> completion);
+
+    static Stats stats();
+};
+
+} // namespace tgcalls
+
+#endif
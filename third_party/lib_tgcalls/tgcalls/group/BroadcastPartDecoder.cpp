@@ -0,0 +1,86 @@
+#include "group/BroadcastPartDecoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "rtc_base/thread.h"
+
+namespace tgcalls {
+
+namespace {
+
+class DecoderThreads {
+public:
+    DecoderThreads() {
+        int count = (int)std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+        for (int i = 0; i < count; i++) {
+            auto thread = rtc::Thread::Create();
+            thread->SetName("tgc-bcast-dec#" + std::to_string(i + 1), nullptr);
+            thread->Start();
+            _threads.push_back(std::move(thread));
+        }
+    }
+
+    rtc::Thread *next() {
+        return _threads[_next.fetch_add(1, std::memory_order_relaxed) % _threads.size()].get();
+    }
+
+    int count() const {
+        return (int)_threads.size();
+    }
+
+private:
+    std::vector<std::unique_ptr<rtc::Thread>> _threads;
+    std::atomic<size_t> _next{0};
+};
+
+DecoderThreads &decoderThreads() {
+    // Never destroyed: parts may still be decoding while the process exits.
+    static DecoderThreads *threads = new DecoderThreads();
+    return *threads;
+}
+
+} // namespace
+
+void BroadcastPartDecoder::decode(std::vector<uint8_t> &&oggData, std::vector<uint32_t> const &decodedSsrcs, std::function<void(DecodedPart &&)> completion) {
+    decoderThreads().next()->PostTask(RTC_FROM_HERE, [oggData = std::move(oggData), decodedSsrcs, completion = std::move(completion)]() mutable {
+        StreamingPart part(std::move(oggData), decodedSsrcs);
+
+        DecodedPart decoded;
+        decoded.ssrcs = part.getSsrcs();
+        size_t frameSize = decoded.ssrcs.size() * StreamingPart::kSamplesPer10ms;
+        if (frameSize != 0) {
+            // One spare frame for a duration rounded down.
+            size_t expectedFrames = part.getRemainingMilliseconds() / 10 + 1;
+            decoded.frameSamples.reserve(expectedFrames);
+            decoded.pcm.reserve(expectedFrames * frameSize);
+            while (true) {
+                size_t offset = decoded.pcm.size();
+                decoded.pcm.resize(offset + frameSize);
+                int numSamples = part.read10msPerChannel(decoded.pcm.data() + offset);
+                if (numSamples <= 0) {
+                    decoded.pcm.resize(offset);
+                    break;
+                }
+                decoded.frameSamples.push_back(numSamples);
+            }
+        }
+
+        completion(std::move(decoded));
+    });
+}
+
+void BroadcastPartDecoder::decodeVideo(std::vector<uint8_t> &&data, std::vector<std::string> const &endpointIds, std::function<void(std::vector<VideoStreamingPart::Frame> &&)> completion) {
+    decoderThreads().next()->PostTask(RTC_FROM_HERE, [data = std::move(data), endpointIds, completion = std::move(completion)]() mutable {
+        completion(VideoStreamingPart::decode(std::move(data), endpointIds));
+    });
+}
+
+int BroadcastPartDecoder::threadCount() {
+    return decoderThreads().count();
+}
+
+} // namespace tgcalls
@@ -0,0 +1,52 @@
+#ifndef TGCALLS_BROADCAST_PART_DECODER_H
+#define TGCALLS_BROADCAST_PART_DECODER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "StreamingPart.h"
+#include "VideoStreamingPart.h"
+
+namespace tgcalls {
+
+// Demuxes and decodes broadcast parts on a small process-wide pool of
+// threads, so opening the Ogg container and decoding Opus, or the video of
+// a video part, never run on the media thread of any call.
+class BroadcastPartDecoder {
+public:
+    // Every 10 ms frame of a part in one block: frame after frame, each one
+    // plane of StreamingPart::kSamplesPer10ms samples per SSRC.
+    struct DecodedPart {
+        std::vector<uint32_t> ssrcs;
+        // Samples per plane of each frame; only the last may be short.
+        std::vector<int> frameSamples;
+        std::vector<int16_t> pcm;
+
+        size_t frameCount() const {
+            return frameSamples.size();
+        }
+
+        const int16_t *plane(size_t frame, size_t ssrcIndex) const {
+            return pcm.data() + (frame * ssrcs.size() + ssrcIndex) * StreamingPart::kSamplesPer10ms;
+        }
+    };
+
+    // Decodes |oggData| on one of the pool threads and calls |completion|
+    // there with all of its frames. A part that can't be parsed gives no
+    // frames. With |decodedSsrcs| set, only those SSRCs are decoded; see
+    // StreamingPart.
+    static void decode(std::vector<uint8_t> &&oggData, std::vector<uint32_t> const &decodedSsrcs, std::function<void(DecodedPart &&)> completion);
+
+    // Decodes the video part |data| on one of the pool threads, only the
+    // frames of |endpointIds| or all of them when it is empty, and calls
+    // |completion| there with them; see VideoStreamingPart.
+    static void decodeVideo(std::vector<uint8_t> &&data, std::vector<std::string> const &endpointIds, std::function<void(std::vector<VideoStreamingPart::Frame> &&)> completion);
+
+    static int threadCount();
+};
+
+} // namespace tgcalls
+
+#endif
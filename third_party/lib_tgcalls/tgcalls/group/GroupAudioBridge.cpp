@@ -0,0 +1,267 @@
+#include "group/GroupAudioBridge.h"
+
+#include "group/GroupOpusPacketSource.h"
+
+#include "absl/strings/match.h"
+#include "absl/types/optional.h"
+#include "api/audio_codecs/audio_encoder.h"
+#include "rtc_base/buffer.h"
+#include "rtc_base/ref_counted_object.h"
+
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <mutex>
+
+namespace tgcalls {
+
+namespace {
+
+// Opus RTP timestamps are always at 48 kHz (RFC 7587).
+constexpr int kSampleRateHz = 48000;
+constexpr uint32_t kFrameTicks = kSampleRateHz / 100;
+// Larger payloads are not Opus packets of a voice chat.
+constexpr size_t kMaxPayloadBytes = 1500;
+// Packets up to this far behind the last one sent are late, anything older
+// is a new stream.
+constexpr int32_t kMaxLateTicks = 10 * kSampleRateHz;
+
+} // namespace
+
+class GroupAudioBridge::Queue {
+public:
+    struct Packet {
+        uint32_t timestamp = 0;
+        uint32_t samples = 0;
+        rtc::Buffer payload;
+    };
+
+    explicit Queue(int startPackets) :
+    startPackets(std::max(startPackets, 1)) {
+    }
+
+    // Called with |mutex| held.
+    void clear() {
+        packets.clear();
+        started = false;
+        lastTimestamp.reset();
+    }
+
+    const size_t startPackets;
+
+    mutable std::mutex mutex;
+    uint32_t sourceSsrc = 0;
+    // Ordered by timestamp.
+    std::deque<Packet> packets;
+    // Set once |startPackets| are queued, until the queue runs dry.
+    bool started = false;
+    // Of the last packet sent.
+    absl::optional<uint32_t> lastTimestamp;
+    Stats stats;
+};
+
+namespace {
+
+class BridgedAudioEncoder : public webrtc::AudioEncoder {
+public:
+    BridgedAudioEncoder(std::shared_ptr<GroupAudioBridge::Queue> queue, int payloadType) :
+    _queue(std::move(queue)),
+    _payloadType(payloadType) {
+    }
+
+    int SampleRateHz() const override {
+        return kSampleRateHz;
+    }
+
+    size_t NumChannels() const override {
+        // The capture only clocks the packets out.
+        return 1;
+    }
+
+    int RtpTimestampRateHz() const override {
+        return kSampleRateHz;
+    }
+
+    size_t Num10MsFramesInNextPacket() const override {
+        return 2;
+    }
+
+    size_t Max10MsFramesInAPacket() const override {
+        return 12;
+    }
+
+    int GetTargetBitrate() const override {
+        // Whatever the source sends; this is a typical voice chat bitrate.
+        return 32000;
+    }
+
+    void Reset() override {
+        _pendingTicks = 0;
+    }
+
+    absl::optional<std::pair<webrtc::TimeDelta, webrtc::TimeDelta>> GetFrameLengthRange() const override {
+        return std::make_pair(webrtc::TimeDelta::Millis(10), webrtc::TimeDelta::Millis(120));
+    }
+
+protected:
+    EncodedInfo EncodeImpl(uint32_t rtp_timestamp, rtc::ArrayView<const int16_t> audio, rtc::Buffer *encoded) override {
+        std::lock_guard<std::mutex> lock(_queue->mutex);
+        auto &queue = *_queue;
+
+        if (!queue.started) {
+            if (queue.packets.size() < queue.startPackets) {
+                _pendingTicks = 0;
+                return EncodedInfo();
+            }
+            queue.started = true;
+        }
+        _pendingTicks += kFrameTicks;
+
+        if (queue.packets.empty()) {
+            queue.started = false;
+            queue.stats.underruns++;
+            _pendingTicks = 0;
+            return EncodedInfo();
+        }
+        auto &packet = queue.packets.front();
+        if (packet.samples > _pendingTicks) {
+            return EncodedInfo();
+        }
+
+        encoded->AppendData(packet.payload.data(), packet.payload.size());
+        EncodedInfo info;
+        info.encoded_bytes = packet.payload.size();
+        // |_pendingTicks| ago was the end of the previous packet; the end of
+        // this frame is one frame after |rtp_timestamp|.
+        info.encoded_timestamp = rtp_timestamp + kFrameTicks - _pendingTicks;
+        info.payload_type = _payloadType;
+        info.encoder_type = CodecType::kOpus;
+        info.speech = true;
+        _pendingTicks -= packet.samples;
+
+        queue.lastTimestamp = packet.timestamp;
+        queue.packets.pop_front();
+        queue.stats.forwardedPackets++;
+        return info;
+    }
+
+private:
+    std::shared_ptr<GroupAudioBridge::Queue> _queue;
+    const int _payloadType = 0;
+    // Capture ticks since the end of the last packet sent.
+    uint32_t _pendingTicks = 0;
+};
+
+class BridgedAudioEncoderFactory : public webrtc::AudioEncoderFactory {
+public:
+    BridgedAudioEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory, std::shared_ptr<GroupAudioBridge::Queue> queue) :
+    _factory(std::move(factory)),
+    _queue(std::move(queue)) {
+    }
+
+    std::vector<webrtc::AudioCodecSpec> GetSupportedEncoders() override {
+        return _factory->GetSupportedEncoders();
+    }
+
+    absl::optional<webrtc::AudioCodecInfo> QueryAudioEncoder(const webrtc::SdpAudioFormat &format) override {
+        return _factory->QueryAudioEncoder(format);
+    }
+
+    std::unique_ptr<webrtc::AudioEncoder> MakeAudioEncoder(int payloadType, const webrtc::SdpAudioFormat &format, absl::optional<webrtc::AudioCodecPairId> codecPairId) override {
+        if (!absl::EqualsIgnoreCase(format.name, "opus")) {
+            return _factory->MakeAudioEncoder(payloadType, format, codecPairId);
+        }
+        return std::make_unique<BridgedAudioEncoder>(_queue, payloadType);
+    }
+
+private:
+    rtc::scoped_refptr<webrtc::AudioEncoderFactory> _factory;
+    std::shared_ptr<GroupAudioBridge::Queue> _queue;
+};
+
+} // namespace
+
+GroupAudioBridge::GroupAudioBridge(int startPackets) :
+_queue(std::make_shared<Queue>(std::min(startPackets, kMaxQueuedPackets))) {
+}
+
+GroupAudioBridge::~GroupAudioBridge() = default;
+
+void GroupAudioBridge::setSourceSsrc(uint32_t ssrc) {
+    std::lock_guard<std::mutex> lock(_queue->mutex);
+    if (_queue->sourceSsrc != ssrc) {
+        _queue->sourceSsrc = ssrc;
+        _queue->clear();
+    }
+}
+
+uint32_t GroupAudioBridge::sourceSsrc() const {
+    std::lock_guard<std::mutex> lock(_queue->mutex);
+    return _queue->sourceSsrc;
+}
+
+void GroupAudioBridge::onIncomingOpusPacket(uint32_t ssrc, uint16_t sequenceNumber, uint32_t timestamp, const uint8_t *payload, size_t size) {
+    std::lock_guard<std::mutex> lock(_queue->mutex);
+    auto &queue = *_queue;
+    if (ssrc == 0 || ssrc != queue.sourceSsrc) {
+        return;
+    }
+    queue.stats.receivedPackets++;
+
+    const auto samples = size <= kMaxPayloadBytes ? opusPacketSamples(payload, size) : 0;
+    if (samples == 0) {
+        queue.stats.droppedPackets++;
+        return;
+    }
+    if (queue.lastTimestamp) {
+        const auto sinceSent = static_cast<int32_t>(timestamp - *queue.lastTimestamp);
+        if (sinceSent <= 0 && sinceSent > -kMaxLateTicks) {
+            queue.stats.droppedPackets++;
+            return;
+        } else if (sinceSent <= 0) {
+            // The participant rejoined with the same SSRC.
+            queue.clear();
+        }
+    }
+
+    // Mostly in order already, so the place is found from the back.
+    auto position = queue.packets.end();
+    while (position != queue.packets.begin()) {
+        const auto previous = std::prev(position);
+        const auto difference = static_cast<int32_t>(timestamp - previous->timestamp);
+        if (difference == 0) {
+            queue.stats.droppedPackets++;
+            return;
+        } else if (difference > 0) {
+            break;
+        }
+        position = previous;
+    }
+    Queue::Packet packet;
+    packet.timestamp = timestamp;
+    packet.samples = samples;
+    packet.payload.SetData(payload, size);
+    queue.packets.insert(position, std::move(packet));
+
+    while (queue.packets.size() > static_cast<size_t>(kMaxQueuedPackets)) {
+        queue.lastTimestamp = queue.packets.front().timestamp;
+        queue.packets.pop_front();
+        queue.stats.droppedPackets++;
+    }
+}
+
+rtc::scoped_refptr<webrtc::AudioEncoderFactory> GroupAudioBridge::wrapEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory) {
+    if (!factory) {
+        return factory;
+    }
+    return new rtc::RefCountedObject<BridgedAudioEncoderFactory>(std::move(factory), _queue);
+}
+
+GroupAudioBridge::Stats GroupAudioBridge::getStats() const {
+    std::lock_guard<std::mutex> lock(_queue->mutex);
+    Stats stats = _queue->stats;
+    stats.queuedPackets = static_cast<int>(_queue->packets.size());
+    return stats;
+}
+
+} // namespace tgcalls
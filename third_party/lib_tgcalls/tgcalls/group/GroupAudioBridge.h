@@ -0,0 +1,76 @@
+#ifndef TGCALLS_GROUP_AUDIO_BRIDGE_H
+#define TGCALLS_GROUP_AUDIO_BRIDGE_H
+
+#include <cstdint>
+#include <memory>
+
+#include "api/audio_codecs/audio_encoder_factory.h"
+#include "api/scoped_refptr.h"
+
+namespace tgcalls {
+
+// Relays one participant of a group call into another group call as that
+// call's own outgoing audio, without decoding or encoding it: the Opus
+// packets received from the participant are sent again as they are.
+//
+// The source call passes every incoming Opus packet to onIncomingOpusPacket()
+// (see GroupInstanceDescriptor::onIncomingOpusPacket); those of the selected
+// SSRC are queued. The sink call takes the bridge in
+// GroupInstanceDescriptor::outgoingAudioBridge, which swaps its Opus
+// encoder for one handing out the queued packets in their place. The sink
+// still packetizes, encrypts and paces on its own SSRC, and its capture
+// only clocks the packets out: it has to run and be unmuted, but what it
+// captures is never sent. While the participant is silent nothing is sent,
+// as with DTX.
+//
+// A few packets are buffered before sending starts, against the jitter
+// between the source's network and the sink's capture; packets arriving
+// after a later one was sent are dropped, and the oldest are dropped when
+// the sink falls behind.
+//
+// A bridge feeds a single sink call at a time.
+class GroupAudioBridge {
+public:
+    struct Stats {
+        // Packets of the selected SSRC received and sent by the sink.
+        uint64_t receivedPackets = 0;
+        uint64_t forwardedPackets = 0;
+        // Packets dropped as late, or because the queue was full.
+        uint64_t droppedPackets = 0;
+        // Times the queue ran dry while the participant was speaking.
+        uint64_t underruns = 0;
+        // Packets queued.
+        int queuedPackets = 0;
+    };
+
+    // Packets buffered before sending starts and at most, of 20 ms each.
+    static constexpr int kDefaultStartPackets = 3;
+    static constexpr int kMaxQueuedPackets = 25;
+
+    explicit GroupAudioBridge(int startPackets = kDefaultStartPackets);
+    ~GroupAudioBridge();
+
+    // The participant relayed; 0 relays nobody. What was queued of the
+    // previous one is dropped.
+    void setSourceSsrc(uint32_t ssrc);
+    uint32_t sourceSsrc() const;
+
+    // Called by the source call's network thread for every incoming Opus
+    // packet.
+    void onIncomingOpusPacket(uint32_t ssrc, uint16_t sequenceNumber, uint32_t timestamp, const uint8_t *payload, size_t size);
+
+    // Opus encoders made by the returned factory send the relayed packets;
+    // other codecs come from |factory| as they are.
+    rtc::scoped_refptr<webrtc::AudioEncoderFactory> wrapEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory);
+
+    Stats getStats() const;
+
+    class Queue;
+
+private:
+    std::shared_ptr<Queue> _queue;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,64 @@
+#include "GroupAudioEncoderFactory.h"
+
+#include "OverloadController.h"
+
+#include "absl/strings/match.h"
+#include "api/audio_codecs/opus/audio_encoder_opus.h"
+#include "rtc_base/ref_counted_object.h"
+
+#include <algorithm>
+
+namespace tgcalls {
+
+namespace {
+
+class GroupAudioEncoderFactory : public webrtc::AudioEncoderFactory {
+public:
+    GroupAudioEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory, int complexity) :
+    _factory(std::move(factory)),
+    _complexity(complexity) {
+    }
+
+    std::vector<webrtc::AudioCodecSpec> GetSupportedEncoders() override {
+        return _factory->GetSupportedEncoders();
+    }
+
+    absl::optional<webrtc::AudioCodecInfo> QueryAudioEncoder(const webrtc::SdpAudioFormat &format) override {
+        return _factory->QueryAudioEncoder(format);
+    }
+
+    std::unique_ptr<webrtc::AudioEncoder> MakeAudioEncoder(int payloadType, const webrtc::SdpAudioFormat &format, absl::optional<webrtc::AudioCodecPairId> codecPairId) override {
+        if (absl::EqualsIgnoreCase(format.name, "opus")) {
+            if (auto config = webrtc::AudioEncoderOpus::SdpToConfig(format)) {
+                // Opus otherwise switches to a lower complexity below
+                // about 12 kbps; the profile's applies at every bitrate.
+                if (_complexity >= 0) {
+                    config->complexity = _complexity;
+                    config->low_rate_complexity = _complexity;
+                }
+                if (OverloadController::level() >= OverloadController::Level::LowerAudioComplexity) {
+                    const int complexity = OverloadController::config().audioComplexity;
+                    config->complexity = std::min(config->complexity, complexity);
+                    config->low_rate_complexity = std::min(config->low_rate_complexity, complexity);
+                }
+                return webrtc::AudioEncoderOpus::MakeAudioEncoder(*config, payloadType, codecPairId);
+            }
+        }
+        return _factory->MakeAudioEncoder(payloadType, format, codecPairId);
+    }
+
+private:
+    rtc::scoped_refptr<webrtc::AudioEncoderFactory> _factory;
+    int _complexity = 0;
+};
+
+} // namespace
+
+rtc::scoped_refptr<webrtc::AudioEncoderFactory> makeGroupAudioEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory, GroupAudioEncoderProfile const &profile) {
+    if (!factory) {
+        return factory;
+    }
+    return new rtc::RefCountedObject<GroupAudioEncoderFactory>(std::move(factory), profile.complexity);
+}
+
+} // namespace tgcalls
@@ -0,0 +1,18 @@
+#ifndef TGCALLS_GROUP_AUDIO_ENCODER_FACTORY_H
+#define TGCALLS_GROUP_AUDIO_ENCODER_FACTORY_H
+
+#include "api/audio_codecs/audio_encoder_factory.h"
+#include "api/scoped_refptr.h"
+
+#include "GroupInstanceImpl.h"
+
+namespace tgcalls {
+
+// Applies what |profile| sets beyond the SDP parameters, i.e. its
+// complexity, to the Opus encoders of |factory|, and the lower complexity
+// of the OverloadController to those made while it asks for it.
+rtc::scoped_refptr<webrtc::AudioEncoderFactory> makeGroupAudioEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory, GroupAudioEncoderProfile const &profile);
+
+} // namespace tgcalls
+
+#endif
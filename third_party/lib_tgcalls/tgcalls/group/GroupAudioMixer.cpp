@@ -0,0 +1,181 @@
+#include "group/GroupAudioMixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace tgcalls {
+
+namespace {
+
+constexpr int kNativeSampleRates[] = { 8000, 16000, 32000, 48000 };
+
+} // namespace
+
+GroupAudioMixer::GroupAudioMixer(GroupAudioMixerConfig const &config) :
+_maxMixedSources(std::max(1, config.maxMixedSources)),
+_hysteresisFactor(std::pow(10.0, std::max(0.0, config.hysteresisDb) / 10.0)),
+_skipMutedSources(config.skipMutedSources) {
+}
+
+GroupAudioMixer::~GroupAudioMixer() = default;
+
+bool GroupAudioMixer::AddSource(Source *audioSource) {
+    webrtc::MutexLock lock(&_mutex);
+    for (const auto &source : _sources) {
+        if (source->source == audioSource) {
+            return false;
+        }
+    }
+    auto source = std::make_unique<MixedSource>();
+    source->source = audioSource;
+    _sources.push_back(std::move(source));
+    return true;
+}
+
+void GroupAudioMixer::RemoveSource(Source *audioSource) {
+    webrtc::MutexLock lock(&_mutex);
+    _sources.erase(std::remove_if(_sources.begin(), _sources.end(), [audioSource](std::unique_ptr<MixedSource> const &source) {
+        return source->source == audioSource;
+    }), _sources.end());
+}
+
+// Like AudioMixerImpl: the lowest native rate none of the sources would be
+// resampled down to.
+int GroupAudioMixer::outputSampleRate() const {
+    int preferred = 0;
+    for (const auto &source : _sources) {
+        preferred = std::max(preferred, source->source->PreferredSampleRate());
+    }
+    for (const auto rate : kNativeSampleRates) {
+        if (rate >= preferred && preferred > 0) {
+            return rate;
+        }
+    }
+    return 48000;
+}
+
+void GroupAudioMixer::Mix(size_t numberOfChannels, webrtc::AudioFrame *audioFrameForMixing) {
+    webrtc::MutexLock lock(&_mutex);
+    const int sampleRate = outputSampleRate();
+    const size_t samplesPerChannel = static_cast<size_t>(sampleRate / 100);
+
+    {
+        webrtc::MutexLock gainLock(&_gainMutex);
+        for (auto &source : _sources) {
+            const auto it = _gains.find(static_cast<uint32_t>(source->source->Ssrc()));
+            source->gain = it != _gains.end() ? it->second : 1.0f;
+        }
+    }
+
+    int decodedSources = 0;
+    uint64_t skippedFrames = 0;
+    _candidates.clear();
+    for (auto &source : _sources) {
+        source->energy = 0.0;
+        if (_skipMutedSources && source->gain <= 0.0f) {
+            source->isMixed = false;
+            skippedFrames++;
+            continue;
+        }
+        const auto info = source->source->GetAudioFrameWithInfo(sampleRate, &source->frame);
+        decodedSources++;
+        if (info != Source::AudioFrameInfo::kNormal || source->gain <= 0.0f || source->frame.muted()) {
+            source->isMixed = false;
+            continue;
+        }
+        const int16_t *data = source->frame.data();
+        const size_t samples = source->frame.samples_per_channel_ * source->frame.num_channels_;
+        double energy = 0.0;
+        for (size_t i = 0; i < samples; i++) {
+            energy += double(data[i]) * double(data[i]);
+        }
+        source->energy = energy * double(source->gain) * double(source->gain);
+        _candidates.push_back(source.get());
+    }
+
+    // The loudest first, those already mixed counting as louder.
+    const auto score = [this](MixedSource const *source) {
+        return source->isMixed ? source->energy * _hysteresisFactor : source->energy;
+    };
+    const size_t mixedCount = std::min(_candidates.size(), static_cast<size_t>(_maxMixedSources));
+    std::partial_sort(_candidates.begin(), _candidates.begin() + mixedCount, _candidates.end(), [&](MixedSource const *lhs, MixedSource const *rhs) {
+        return score(lhs) > score(rhs);
+    });
+
+    audioFrameForMixing->UpdateFrame(0, nullptr, samplesPerChannel, sampleRate, webrtc::AudioFrame::kNormalSpeech, webrtc::AudioFrame::kVadUnknown, numberOfChannels);
+
+    int mixedSources = 0;
+    _accumulator.assign(samplesPerChannel * numberOfChannels, 0.0f);
+    for (size_t i = 0; i < _candidates.size(); i++) {
+        auto source = _candidates[i];
+        // Silent frames add nothing, and don't keep a place.
+        source->isMixed = i < mixedCount && source->energy > 0.0;
+        if (source->isMixed) {
+            addFrame(*source, numberOfChannels, samplesPerChannel);
+            mixedSources++;
+        }
+    }
+    if (mixedSources > 0) {
+        int16_t *output = audioFrameForMixing->mutable_data();
+        for (size_t i = 0; i < _accumulator.size(); i++) {
+            const float value = std::min(std::max(_accumulator[i], float(std::numeric_limits<int16_t>::min())), float(std::numeric_limits<int16_t>::max()));
+            output[i] = static_cast<int16_t>(value);
+        }
+    }
+
+    _decodedSources.store(decodedSources, std::memory_order_relaxed);
+    _mixedSources.store(mixedSources, std::memory_order_relaxed);
+    _mixes.fetch_add(1, std::memory_order_relaxed);
+    _decodedFrames.fetch_add(decodedSources, std::memory_order_relaxed);
+    _mixedFrames.fetch_add(mixedSources, std::memory_order_relaxed);
+    _skippedFrames.fetch_add(skippedFrames, std::memory_order_relaxed);
+}
+
+void GroupAudioMixer::addFrame(MixedSource const &source, size_t numberOfChannels, size_t samplesPerChannel) {
+    const int16_t *data = source.frame.data();
+    const size_t channels = source.frame.num_channels_;
+    const size_t samples = std::min(samplesPerChannel, source.frame.samples_per_channel_);
+    const float gain = source.gain;
+    for (size_t i = 0; i < samples; i++) {
+        float *output = &_accumulator[i * numberOfChannels];
+        const int16_t *input = &data[i * channels];
+        if (channels == numberOfChannels) {
+            for (size_t channel = 0; channel < numberOfChannels; channel++) {
+                output[channel] += float(input[channel]) * gain;
+            }
+        } else {
+            // Down to mono, then to every output channel.
+            float value = 0.0f;
+            for (size_t channel = 0; channel < channels; channel++) {
+                value += float(input[channel]);
+            }
+            value = value * gain / float(channels);
+            for (size_t channel = 0; channel < numberOfChannels; channel++) {
+                output[channel] += value;
+            }
+        }
+    }
+}
+
+void GroupAudioMixer::setGain(uint32_t ssrc, double gain) {
+    webrtc::MutexLock lock(&_gainMutex);
+    if (gain == 1.0) {
+        _gains.erase(ssrc);
+    } else {
+        _gains[ssrc] = static_cast<float>(std::max(0.0, gain));
+    }
+}
+
+GroupAudioMixer::Stats GroupAudioMixer::stats() const {
+    Stats stats;
+    stats.decodedSources = _decodedSources.load(std::memory_order_relaxed);
+    stats.mixedSources = _mixedSources.load(std::memory_order_relaxed);
+    stats.mixes = _mixes.load(std::memory_order_relaxed);
+    stats.decodedFrames = _decodedFrames.load(std::memory_order_relaxed);
+    stats.mixedFrames = _mixedFrames.load(std::memory_order_relaxed);
+    stats.skippedFrames = _skippedFrames.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,88 @@
+#ifndef TGCALLS_GROUP_AUDIO_MIXER_H
+#define TGCALLS_GROUP_AUDIO_MIXER_H
+
+#include "api/audio/audio_frame.h"
+#include "api/audio/audio_mixer.h"
+#include "rtc_base/synchronization/mutex.h"
+
+#include "GroupInstanceImpl.h"
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace tgcalls {
+
+// The playout mixer of a group call with a GroupAudioMixerConfig, in place
+// of webrtc's AudioMixerImpl.
+//
+// Each Mix() pulls a frame from every source, except those whose gain is 0
+// when |skipMutedSources| is set: those aren't decoded at all and their
+// NetEq catches up when they are heard again. Of the frames pulled, the
+// |maxMixedSources| with the most energy, after gain, are summed with their
+// gain applied and saturated; a source mixed last time counts as
+// |hysteresisDb| louder, so that two speakers of similar level don't take
+// turns every frame. Gains are set per SSRC with setGain() in place of the
+// receive streams' output volume, which would scale each frame once more.
+class GroupAudioMixer : public webrtc::AudioMixer {
+public:
+    struct Stats {
+        // Of the last mix.
+        int decodedSources = 0;
+        int mixedSources = 0;
+        // Since the call started, in source frames.
+        uint64_t mixes = 0;
+        uint64_t decodedFrames = 0;
+        uint64_t mixedFrames = 0;
+        uint64_t skippedFrames = 0;
+    };
+
+    explicit GroupAudioMixer(GroupAudioMixerConfig const &config);
+    ~GroupAudioMixer() override;
+
+    bool AddSource(Source *audioSource) override;
+    void RemoveSource(Source *audioSource) override;
+    void Mix(size_t numberOfChannels, webrtc::AudioFrame *audioFrameForMixing) override;
+
+    // Any thread; applies from the next mix. 1.0 for SSRCs never set.
+    void setGain(uint32_t ssrc, double gain);
+    Stats stats() const;
+
+private:
+    struct MixedSource {
+        Source *source = nullptr;
+        webrtc::AudioFrame frame;
+        float gain = 1.0f;
+        double energy = 0.0;
+        bool isPulled = false;
+        bool isMixed = false;
+    };
+
+    int outputSampleRate() const;
+    void addFrame(MixedSource const &source, size_t numberOfChannels, size_t samplesPerChannel);
+
+    const int _maxMixedSources = 3;
+    const double _hysteresisFactor = 1.0;
+    const bool _skipMutedSources = true;
+
+    webrtc::Mutex _mutex;
+    std::vector<std::unique_ptr<MixedSource>> _sources;
+    std::vector<MixedSource *> _candidates;
+    std::vector<float> _accumulator;
+
+    mutable webrtc::Mutex _gainMutex;
+    std::map<uint32_t, float> _gains;
+
+    std::atomic<int> _decodedSources{0};
+    std::atomic<int> _mixedSources{0};
+    std::atomic<uint64_t> _mixes{0};
+    std::atomic<uint64_t> _decodedFrames{0};
+    std::atomic<uint64_t> _mixedFrames{0};
+    std::atomic<uint64_t> _skippedFrames{0};
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,127 @@
+#include "group/GroupCertificatePool.h"
+
+#include <algorithm>
+
+#include "rtc_base/rtc_certificate_generator.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+
+namespace tgcalls {
+
+GroupCertificatePool::GroupCertificatePool(int poolSize, int64_t reuseIntervalMs) :
+_thread(rtc::Thread::Create()),
+_poolSize(std::max(0, poolSize)),
+_reuseIntervalMs(std::max<int64_t>(0, reuseIntervalMs)) {
+    _thread->SetName("tgc-group-cert", nullptr);
+    _thread->Start();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    scheduleRefill();
+}
+
+GroupCertificatePool::GroupCertificatePool(rtc::scoped_refptr<rtc::RTCCertificate> certificate) :
+_thread(rtc::Thread::Create()),
+_fixedCertificate(std::move(certificate)) {
+}
+
+GroupCertificatePool::~GroupCertificatePool() {
+    // Waits for a refill in progress; the ones still queued are dropped.
+    _thread->Stop();
+}
+
+void GroupCertificatePool::configure(int poolSize, int64_t reuseIntervalMs) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_fixedCertificate) {
+        return;
+    }
+    _poolSize = std::max(0, poolSize);
+    _reuseIntervalMs = std::max<int64_t>(0, reuseIntervalMs);
+    if (_reuseIntervalMs == 0) {
+        _reusedCertificate = nullptr;
+    }
+    scheduleRefill();
+}
+
+rtc::scoped_refptr<rtc::RTCCertificate> GroupCertificatePool::takeCertificate() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stats.takenCertificates++;
+
+        if (_fixedCertificate) {
+            _stats.reusedCertificates++;
+            return _fixedCertificate;
+        }
+
+        int64_t timestamp = rtc::TimeMillis();
+        if (_reusedCertificate && timestamp - _reusedCertificateTimestamp < _reuseIntervalMs) {
+            _stats.reusedCertificates++;
+            return _reusedCertificate;
+        }
+
+        if (!_readyCertificates.empty()) {
+            auto certificate = std::move(_readyCertificates.front());
+            _readyCertificates.pop_front();
+            if (_reuseIntervalMs > 0) {
+                _reusedCertificate = certificate;
+                _reusedCertificateTimestamp = timestamp;
+            }
+            scheduleRefill();
+            return certificate;
+        }
+
+        _stats.missedCertificates++;
+        scheduleRefill();
+    }
+
+    auto certificate = generateCertificate();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.generatedCertificates++;
+    if (_reuseIntervalMs > 0) {
+        _reusedCertificate = certificate;
+        _reusedCertificateTimestamp = rtc::TimeMillis();
+    }
+    return certificate;
+}
+
+GroupCertificatePool::Stats GroupCertificatePool::getStats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    Stats stats = _stats;
+    stats.readyCertificates = (int)_readyCertificates.size();
+    return stats;
+}
+
+rtc::scoped_refptr<rtc::RTCCertificate> GroupCertificatePool::generateCertificate() {
+    return rtc::RTCCertificateGenerator::GenerateCertificate(rtc::KeyParams(rtc::KT_ECDSA), absl::nullopt);
+}
+
+void GroupCertificatePool::scheduleRefill() {
+    if (_isRefillScheduled || (int)_readyCertificates.size() >= _poolSize) {
+        return;
+    }
+    _isRefillScheduled = true;
+    // The pool owns and stops |_thread|, so the task can't outlive it.
+    _thread->PostTask(RTC_FROM_HERE, [this] {
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if ((int)_readyCertificates.size() >= _poolSize) {
+                    _isRefillScheduled = false;
+                    return;
+                }
+            }
+            auto certificate = generateCertificate();
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (certificate) {
+                _readyCertificates.push_back(std::move(certificate));
+                _stats.generatedCertificates++;
+            } else {
+                _isRefillScheduled = false;
+                return;
+            }
+        }
+    });
+}
+
+} // namespace tgcalls
@@ -0,0 +1,82 @@
+#ifndef TGCALLS_GROUP_CERTIFICATE_POOL_H
+#define TGCALLS_GROUP_CERTIFICATE_POOL_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "api/scoped_refptr.h"
+#include "rtc_base/rtc_certificate.h"
+
+namespace rtc {
+class Thread;
+}
+
+namespace tgcalls {
+
+// DTLS certificates for GroupNetworkManager, generated ahead of time on a
+// background thread so ECDSA key generation never runs on the network
+// thread while a call joins.
+//
+// By default every certificate is handed out once. With a reuse interval,
+// one certificate is given to every instance asking within that interval
+// and rotated afterwards; that saves key generation entirely during join
+// storms, at the cost of calls sharing a fingerprint for a while.
+//
+// Pass the same pool in GroupInstanceDescriptor::certificatePool to every
+// call that should draw from it.
+class GroupCertificatePool {
+public:
+    struct Stats {
+        // Certificates waiting to be handed out.
+        int readyCertificates = 0;
+        uint64_t generatedCertificates = 0;
+        // Certificates handed out, how many of them were a reused one, and
+        // how many had to be generated on the spot because the pool was
+        // empty.
+        uint64_t takenCertificates = 0;
+        uint64_t reusedCertificates = 0;
+        uint64_t missedCertificates = 0;
+    };
+
+    explicit GroupCertificatePool(int poolSize = 4, int64_t reuseIntervalMs = 0);
+    // Hands out |certificate| every time and generates none, for an
+    // instance that uses the certificate of another; see
+    // GroupInstanceCustomImpl::prepareScreencast().
+    explicit GroupCertificatePool(rtc::scoped_refptr<rtc::RTCCertificate> certificate);
+    ~GroupCertificatePool();
+
+    // Takes effect for the next certificate taken; a smaller pool keeps the
+    // certificates it already has. Does nothing for a pool of a single
+    // certificate.
+    void configure(int poolSize, int64_t reuseIntervalMs);
+
+    // Any thread. Generates a certificate in place when none is ready.
+    rtc::scoped_refptr<rtc::RTCCertificate> takeCertificate();
+
+    Stats getStats() const;
+
+private:
+    static rtc::scoped_refptr<rtc::RTCCertificate> generateCertificate();
+
+    // Called with |_mutex| held.
+    void scheduleRefill();
+
+    std::unique_ptr<rtc::Thread> _thread;
+
+    mutable std::mutex _mutex;
+    int _poolSize = 0;
+    int64_t _reuseIntervalMs = 0;
+    bool _isRefillScheduled = false;
+    std::deque<rtc::scoped_refptr<rtc::RTCCertificate>> _readyCertificates;
+    rtc::scoped_refptr<rtc::RTCCertificate> _reusedCertificate;
+    int64_t _reusedCertificateTimestamp = 0;
+    // Set for a pool of a single certificate, whose |_thread| isn't started.
+    rtc::scoped_refptr<rtc::RTCCertificate> _fixedCertificate;
+    Stats _stats;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,135 @@
+#include "group/GroupEngineContext.h"
+
+#include "api/audio_codecs/audio_decoder_factory_template.h"
+#include "api/audio_codecs/audio_encoder_factory_template.h"
+#include "api/audio_codecs/opus/audio_decoder_opus.h"
+#include "api/audio_codecs/opus/audio_encoder_opus.h"
+#include "api/audio_codecs/L16/audio_decoder_L16.h"
+#include "api/audio_codecs/L16/audio_encoder_L16.h"
+#include "api/task_queue/default_task_queue_factory.h"
+#include "api/video_codecs/video_decoder.h"
+#include "api/video_codecs/video_encoder.h"
+#include "platform/PlatformInterface.h"
+
+namespace tgcalls {
+
+namespace {
+
+class SharedVideoEncoderFactory : public webrtc::VideoEncoderFactory {
+public:
+    SharedVideoEncoderFactory(webrtc::VideoEncoderFactory *factory, std::vector<webrtc::SdpVideoFormat> const *formats) :
+    _factory(factory),
+    _formats(formats) {
+    }
+
+    std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+        return *_formats;
+    }
+
+    std::vector<webrtc::SdpVideoFormat> GetImplementations() const override {
+        return _factory->GetImplementations();
+    }
+
+    CodecInfo QueryVideoEncoder(const webrtc::SdpVideoFormat &format) const override {
+        return _factory->QueryVideoEncoder(format);
+    }
+
+    std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(const webrtc::SdpVideoFormat &format) override {
+        return _factory->CreateVideoEncoder(format);
+    }
+
+    std::unique_ptr<EncoderSelectorInterface> GetEncoderSelector() const override {
+        return _factory->GetEncoderSelector();
+    }
+
+private:
+    webrtc::VideoEncoderFactory *_factory = nullptr;
+    std::vector<webrtc::SdpVideoFormat> const *_formats = nullptr;
+};
+
+class SharedVideoDecoderFactory : public webrtc::VideoDecoderFactory {
+public:
+    SharedVideoDecoderFactory(webrtc::VideoDecoderFactory *factory, std::vector<webrtc::SdpVideoFormat> const *formats) :
+    _factory(factory),
+    _formats(formats) {
+    }
+
+    std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+        return *_formats;
+    }
+
+    std::unique_ptr<webrtc::VideoDecoder> CreateVideoDecoder(const webrtc::SdpVideoFormat &format) override {
+        return _factory->CreateVideoDecoder(format);
+    }
+
+private:
+    webrtc::VideoDecoderFactory *_factory = nullptr;
+    std::vector<webrtc::SdpVideoFormat> const *_formats = nullptr;
+};
+
+} // namespace
+
+GroupEngineContext::GroupEngineContext() :
+_taskQueueFactory(webrtc::CreateDefaultTaskQueueFactory()),
+_audioEncoderFactory(webrtc::CreateAudioEncoderFactory<webrtc::AudioEncoderOpus, webrtc::AudioEncoderL16>()),
+_audioDecoderFactory(webrtc::CreateAudioDecoderFactory<webrtc::AudioDecoderOpus, webrtc::AudioDecoderL16>()) {
+}
+
+GroupEngineContext::~GroupEngineContext() {
+}
+
+webrtc::TaskQueueFactory *GroupEngineContext::taskQueueFactory() const {
+    return _taskQueueFactory.get();
+}
+
+rtc::scoped_refptr<webrtc::AudioEncoderFactory> GroupEngineContext::audioEncoderFactory() const {
+    return _audioEncoderFactory;
+}
+
+rtc::scoped_refptr<webrtc::AudioDecoderFactory> GroupEngineContext::audioDecoderFactory() const {
+    return _audioDecoderFactory;
+}
+
+void GroupEngineContext::ensureVideoFactories() {
+    // Probed once: the media engines ask for the formats every time they
+    // configure a channel.
+    if (!_videoEncoderFactory) {
+        _videoEncoderFactory = PlatformInterface::SharedInstance()->makeVideoEncoderFactory();
+        _videoEncoderFormats = _videoEncoderFactory->GetSupportedFormats();
+    }
+    if (!_videoDecoderFactory) {
+        _videoDecoderFactory = PlatformInterface::SharedInstance()->makeVideoDecoderFactory();
+        _videoDecoderFormats = _videoDecoderFactory->GetSupportedFormats();
+    }
+}
+
+std::unique_ptr<webrtc::VideoEncoderFactory> GroupEngineContext::createVideoEncoderFactory() {
+    std::lock_guard<std::mutex> lock(_videoFactoriesMutex);
+    ensureVideoFactories();
+    return std::make_unique<SharedVideoEncoderFactory>(_videoEncoderFactory.get(), &_videoEncoderFormats);
+}
+
+std::unique_ptr<webrtc::VideoDecoderFactory> GroupEngineContext::createVideoDecoderFactory() {
+    std::lock_guard<std::mutex> lock(_videoFactoriesMutex);
+    ensureVideoFactories();
+    return std::make_unique<SharedVideoDecoderFactory>(_videoDecoderFactory.get(), &_videoDecoderFormats);
+}
+
+void GroupEngineContext::attachInstance() {
+    _activeInstances++;
+    _totalInstances++;
+}
+
+void GroupEngineContext::detachInstance() {
+    _activeInstances--;
+}
+
+GroupEngineContext::Stats GroupEngineContext::getStats() const {
+    Stats stats;
+    stats.activeInstances = _activeInstances.load();
+    stats.totalInstances = _totalInstances.load();
+    stats.reusedInstances = stats.totalInstances > 0 ? stats.totalInstances - 1 : 0;
+    return stats;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,75 @@
+#ifndef TGCALLS_GROUP_ENGINE_CONTEXT_H
+#define TGCALLS_GROUP_ENGINE_CONTEXT_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "api/audio_codecs/audio_decoder_factory.h"
+#include "api/audio_codecs/audio_encoder_factory.h"
+#include "api/scoped_refptr.h"
+#include "api/task_queue/task_queue_factory.h"
+#include "api/video_codecs/sdp_video_format.h"
+#include "api/video_codecs/video_decoder_factory.h"
+#include "api/video_codecs/video_encoder_factory.h"
+
+namespace tgcalls {
+
+// Parts of the media stack that several group calls in one process can use
+// together. Every call still builds its own audio device, media engine,
+// Call, audio processing and transports, since those carry per-call state
+// (capture and playout, bandwidth estimation, SSRC routing); what is shared
+// is the stateless machinery around them: codec factories, the probed video
+// formats and the task queue factory.
+//
+// Pass the same context in GroupInstanceDescriptor::engineContext to every
+// call that should share it.
+class GroupEngineContext {
+public:
+    struct Stats {
+        // Calls currently using the context, and all that ever did.
+        int activeInstances = 0;
+        int totalInstances = 0;
+        // Calls that found the shared objects already built and skipped
+        // creating and probing their own codec factories.
+        int reusedInstances = 0;
+    };
+
+    GroupEngineContext();
+    ~GroupEngineContext();
+
+    webrtc::TaskQueueFactory *taskQueueFactory() const;
+    rtc::scoped_refptr<webrtc::AudioEncoderFactory> audioEncoderFactory() const;
+    rtc::scoped_refptr<webrtc::AudioDecoderFactory> audioDecoderFactory() const;
+
+    // Factories for one media engine; they forward to shared ones built on
+    // first use. The context must outlive them.
+    std::unique_ptr<webrtc::VideoEncoderFactory> createVideoEncoderFactory();
+    std::unique_ptr<webrtc::VideoDecoderFactory> createVideoDecoderFactory();
+
+    void attachInstance();
+    void detachInstance();
+
+    Stats getStats() const;
+
+private:
+    void ensureVideoFactories();
+
+    std::unique_ptr<webrtc::TaskQueueFactory> _taskQueueFactory;
+    rtc::scoped_refptr<webrtc::AudioEncoderFactory> _audioEncoderFactory;
+    rtc::scoped_refptr<webrtc::AudioDecoderFactory> _audioDecoderFactory;
+
+    std::mutex _videoFactoriesMutex;
+    std::unique_ptr<webrtc::VideoEncoderFactory> _videoEncoderFactory;
+    std::unique_ptr<webrtc::VideoDecoderFactory> _videoDecoderFactory;
+    std::vector<webrtc::SdpVideoFormat> _videoEncoderFormats;
+    std::vector<webrtc::SdpVideoFormat> _videoDecoderFormats;
+
+    std::atomic<int> _activeInstances{0};
+    std::atomic<int> _totalInstances{0};
+};
+
+} // namespace tgcalls
+
+#endif
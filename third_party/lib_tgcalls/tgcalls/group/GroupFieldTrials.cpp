@@ -0,0 +1,61 @@
+#include "group/GroupFieldTrials.h"
+
+#include "rtc_base/logging.h"
+#include "system_wrappers/include/field_trial.h"
+
+#include <mutex>
+
+namespace tgcalls {
+
+namespace {
+
+void parseTrials(std::string const &trials, std::map<std::string, std::string, std::less<>> &result) {
+    size_t position = 0;
+    while (position < trials.size()) {
+        const auto nameEnd = trials.find('/', position);
+        if (nameEnd == std::string::npos || nameEnd == position) {
+            RTC_LOG(LS_WARNING) << "GroupFieldTrials: ignoring ill-formed trials from " << trials.substr(position);
+            return;
+        }
+        const auto valueEnd = trials.find('/', nameEnd + 1);
+        if (valueEnd == std::string::npos || valueEnd == nameEnd + 1) {
+            RTC_LOG(LS_WARNING) << "GroupFieldTrials: ignoring ill-formed trials from " << trials.substr(position);
+            return;
+        }
+        result[trials.substr(position, nameEnd - position)] = trials.substr(nameEnd + 1, valueEnd - nameEnd - 1);
+        position = valueEnd + 1;
+    }
+}
+
+} // namespace
+
+const char *const GroupFieldTrials::kDefaults =
+    "WebRTC-Audio-OpusMinPacketLossRate/Enabled-1/"
+    "WebRTC-TaskQueuePacer/Enabled/"
+    "WebRTC-VP8ConferenceTemporalLayers/1/"
+//    "WebRTC-Audio-MinimizeResamplingOnMobile/Enabled/"
+    //"WebRTC-MutedStateKillSwitch/Enabled/"
+    //"WebRTC-VP8IosMaxNumberOfThread/max_thread:1/"
+    ;
+
+GroupFieldTrials::GroupFieldTrials(std::string const &trials) {
+    parseTrials(kDefaults, _trials);
+    parseTrials(trials, _trials);
+}
+
+std::string GroupFieldTrials::Lookup(absl::string_view key) const {
+    const auto it = _trials.find(key);
+    if (it != _trials.end()) {
+        return it->second;
+    }
+    return webrtc::field_trial::FindFullName(std::string(key));
+}
+
+void GroupFieldTrials::initDefaults() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        webrtc::field_trial::InitFieldTrialsFromString(kDefaults);
+    });
+}
+
+} // namespace tgcalls
@@ -0,0 +1,37 @@
+#ifndef TGCALLS_GROUP_FIELD_TRIALS_H
+#define TGCALLS_GROUP_FIELD_TRIALS_H
+
+#include <functional>
+#include <map>
+#include <string>
+
+#include "api/transport/webrtc_key_value_config.h"
+
+namespace tgcalls {
+
+// The field trials of one group call: those given to it, in WebRTC's
+// "Name/Value/Name/Value/" form, over the defaults every group call has,
+// over the process-wide ones. Handed to its Call and media engine, which
+// covers the pacer, bandwidth estimation and audio allocation among others.
+//
+// Parts of WebRTC only read the process-wide trials, such as the Opus
+// encoder; those get the defaults, set once per process.
+class GroupFieldTrials : public webrtc::WebRtcKeyValueConfig {
+public:
+    static const char *const kDefaults;
+
+    // Ill-formed |trials| are ignored from where they stop making sense.
+    explicit GroupFieldTrials(std::string const &trials);
+
+    std::string Lookup(absl::string_view key) const override;
+
+    // Sets the process-wide trials to the defaults, unless done already.
+    static void initDefaults();
+
+private:
+    std::map<std::string, std::string, std::less<>> _trials;
+};
+
+} // namespace tgcalls
+
+#endif
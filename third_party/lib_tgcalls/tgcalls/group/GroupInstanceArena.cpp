@@ -0,0 +1,52 @@
+#include "group/GroupInstanceArena.h"
+
+#include <algorithm>
+#include <new>
+
+namespace tgcalls {
+
+GroupInstanceArena::~GroupInstanceArena() {
+    for (const auto chunk : _chunks) {
+        ::operator delete(chunk);
+    }
+}
+
+void *GroupInstanceArena::allocate(size_t size) {
+    if (size == 0 || size > kMaxPooledSize) {
+        return ::operator new(size);
+    }
+    const auto sizeClass = (size - 1) / kGranularity;
+    if (const auto block = _freeBlocks[sizeClass]) {
+        _freeBlocks[sizeClass] = block->next;
+        return block;
+    }
+
+    const auto blockSize = (sizeClass + 1) * kGranularity;
+    if (static_cast<size_t>(_chunkEnd - _chunkPosition) < blockSize) {
+        // What is left of the current chunk is dropped; each chunk is twice
+        // the size of the previous one, up to kMaxChunkSize.
+        const auto chunkSize = _nextChunkSize;
+        _nextChunkSize = std::min(_nextChunkSize * 2, kMaxChunkSize);
+        const auto chunk = static_cast<char *>(::operator new(chunkSize));
+        _chunks.push_back(chunk);
+        _reservedBytes += chunkSize;
+        _chunkPosition = chunk;
+        _chunkEnd = chunk + chunkSize;
+    }
+    const auto block = _chunkPosition;
+    _chunkPosition += blockSize;
+    return block;
+}
+
+void GroupInstanceArena::deallocate(void *pointer, size_t size) {
+    if (size == 0 || size > kMaxPooledSize) {
+        ::operator delete(pointer);
+        return;
+    }
+    const auto sizeClass = (size - 1) / kGranularity;
+    const auto block = static_cast<FreeBlock *>(pointer);
+    block->next = _freeBlocks[sizeClass];
+    _freeBlocks[sizeClass] = block;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,126 @@
+#ifndef TGCALLS_GROUP_INSTANCE_ARENA_H
+#define TGCALLS_GROUP_INSTANCE_ARENA_H
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+
+namespace tgcalls {
+
+// Memory of the tables a group instance keeps for its whole life: the SSRC
+// maps, pending sinks, requests and broadcast parts in flight.
+//
+// Small blocks, such as map nodes and the tables of a few participants,
+// are carved out of chunks that belong to the instance and reused through
+// free lists of a few size classes, instead of being spread over the heap
+// shared by every call and thread of the process. The chunks are freed all
+// at once with the arena, when the instance is torn down. Larger blocks are
+// plain allocations. Not thread safe; the instance uses it on its media
+// thread only.
+class GroupInstanceArena {
+public:
+    GroupInstanceArena() = default;
+    ~GroupInstanceArena();
+
+    GroupInstanceArena(GroupInstanceArena const &) = delete;
+    GroupInstanceArena &operator=(GroupInstanceArena const &) = delete;
+
+    void *allocate(size_t size);
+    void deallocate(void *pointer, size_t size);
+
+    // Chunk memory held, whether in use or free.
+    size_t reservedBytes() const {
+        return _reservedBytes;
+    }
+
+private:
+    static constexpr size_t kGranularity = alignof(std::max_align_t);
+    static constexpr size_t kMaxPooledSize = 512;
+    static constexpr size_t kMinChunkSize = 4 * 1024;
+    static constexpr size_t kMaxChunkSize = 64 * 1024;
+
+    struct FreeBlock {
+        FreeBlock *next = nullptr;
+    };
+
+    std::array<FreeBlock *, kMaxPooledSize / kGranularity> _freeBlocks{};
+    std::vector<char *> _chunks;
+    char *_chunkPosition = nullptr;
+    char *_chunkEnd = nullptr;
+    size_t _nextChunkSize = kMinChunkSize;
+    size_t _reservedBytes = 0;
+};
+
+// Standard allocator on a GroupInstanceArena, which must outlive what is
+// allocated with it.
+template <typename T>
+class GroupInstanceAllocator {
+public:
+    using value_type = T;
+
+    GroupInstanceAllocator(GroupInstanceArena *arena) :
+    _arena(arena) {
+    }
+
+    template <typename U>
+    GroupInstanceAllocator(GroupInstanceAllocator<U> const &other) :
+    _arena(other.arena()) {
+    }
+
+    T *allocate(size_t count) {
+        return static_cast<T *>(_arena->allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T *pointer, size_t count) {
+        _arena->deallocate(pointer, count * sizeof(T));
+    }
+
+    GroupInstanceArena *arena() const {
+        return _arena;
+    }
+
+    template <typename U>
+    bool operator==(GroupInstanceAllocator<U> const &other) const {
+        return _arena == other.arena();
+    }
+
+    template <typename U>
+    bool operator!=(GroupInstanceAllocator<U> const &other) const {
+        return _arena != other.arena();
+    }
+
+private:
+    GroupInstanceArena *_arena = nullptr;
+};
+
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+using GroupInstanceMap = std::map<Key, Value, Compare, GroupInstanceAllocator<std::pair<const Key, Value>>>;
+
+template <typename Key, typename Compare = std::less<Key>>
+using GroupInstanceSet = std::set<Key, Compare, GroupInstanceAllocator<Key>>;
+
+template <typename Key, typename Value>
+using GroupInstanceHashMap = absl::flat_hash_map<
+    Key,
+    Value,
+    typename absl::flat_hash_map<Key, Value>::hasher,
+    typename absl::flat_hash_map<Key, Value>::key_equal,
+    GroupInstanceAllocator<std::pair<const Key, Value>>>;
+
+template <typename Key>
+using GroupInstanceHashSet = absl::flat_hash_set<
+    Key,
+    typename absl::flat_hash_set<Key>::hasher,
+    typename absl::flat_hash_set<Key>::key_equal,
+    GroupInstanceAllocator<Key>>;
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef TGCALLS_GROUP_INSTANCE_AWAIT_H
+#define TGCALLS_GROUP_INSTANCE_AWAIT_H
+
+// C++20 coroutines over the callbacks of GroupInstanceCustomImpl, so that a
+// join reads as a sequence rather than nested completions:
+//
+//   GroupTask join(GroupInstanceCustomImpl &instance, Signaling &signaling) {
+//       auto payload = co_await joinPayload(instance);
+//       if (!payload) co_return;
+//       instance.setJoinResponsePayload(co_await signaling.join(payload->json));
+//       if (!co_await connected(instance)) co_return;
+//       ...
+//   }
+//
+// Every await resumes on the instance's media thread, however the operation
+// completes, so a coroutine's state is only touched there between awaits
+// and many joins can be in flight without a thread blocked on any of them.
+// Only Linux builds lib_tgcalls as C++20; elsewhere this header is empty.
+
+#if __cplusplus >= 202002L && __has_include(<coroutine>)
+
+#define TGCALLS_HAS_GROUP_INSTANCE_AWAIT 1
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#include "rtc_base/location.h"
+#include "rtc_base/thread.h"
+
+#include "GroupInstanceCustomImpl.h"
+
+namespace tgcalls {
+
+// A coroutine that starts at once and frees itself when it returns, for
+// chains of awaits whose results go out through what the coroutine
+// captures. Exceptions aren't carried: lib_tgcalls is built without them.
+struct GroupTask {
+    struct promise_type {
+        GroupTask get_return_object() noexcept {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() noexcept {
+        }
+        void unhandled_exception() noexcept {
+            std::terminate();
+        }
+    };
+};
+
+// The result of an operation without a value of its own.
+struct GroupDone {
+};
+
+// Awaits an operation started with a completion that is called at most
+// once, from any thread, and resumes on |thread| with its result, or with
+// nullopt if the completion was dropped uncalled, e.g. because the call was
+// destroyed first.
+template <typename T>
+class GroupOperation {
+public:
+    using Completion = std::function<void(T)>;
+    using Start = std::function<void(Completion)>;
+
+    GroupOperation(rtc::Thread *thread, Start start) :
+    _thread(thread),
+    _start(std::move(start)) {
+    }
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        auto resumer = std::make_shared<Resumer>(_thread, handle, &_result);
+        // The coroutine may be resumed, and this awaiter freed with it, before
+        // |start| returns.
+        auto start = std::move(_start);
+        start([resumer](T result) {
+            resumer->resume(std::move(result));
+        });
+    }
+
+    std::optional<T> await_resume() {
+        return std::move(_result);
+    }
+
+private:
+    // Shared by the copies of the completion; the last one to go resumes
+    // with nullopt if none was called.
+    class Resumer {
+    public:
+        Resumer(rtc::Thread *thread, std::coroutine_handle<> handle, std::optional<T> *result) :
+        _thread(thread),
+        _handle(handle),
+        _result(result) {
+        }
+
+        ~Resumer() {
+            if (_handle) {
+                post();
+            }
+        }
+
+        void resume(T result) {
+            if (!_handle) {
+                return;
+            }
+            // The coroutine is suspended until the post runs, so its frame
+            // and |_result| with it are still there.
+            _result->emplace(std::move(result));
+            post();
+        }
+
+    private:
+        void post() {
+            _thread->PostTask(RTC_FROM_HERE, [handle = std::exchange(_handle, nullptr)] {
+                handle.resume();
+            });
+        }
+
+        rtc::Thread *_thread = nullptr;
+        std::coroutine_handle<> _handle;
+        std::optional<T> *_result = nullptr;
+    };
+
+    rtc::Thread *_thread = nullptr;
+    Start _start;
+    std::optional<T> _result;
+};
+
+// Resumes on |thread|, e.g. to hop onto the media thread at the start.
+inline GroupOperation<GroupDone> resumeOn(rtc::Thread *thread) {
+    return GroupOperation<GroupDone>(thread, [](GroupOperation<GroupDone>::Completion completion) {
+        completion(GroupDone());
+    });
+}
+
+inline GroupOperation<GroupJoinPayload> joinPayload(GroupInstanceCustomImpl &instance) {
+    return GroupOperation<GroupJoinPayload>(instance.mediaThread(), [&instance](GroupOperation<GroupJoinPayload>::Completion completion) {
+        instance.emitJoinPayload([completion = std::move(completion)](GroupJoinPayload const &payload) {
+            completion(payload);
+        });
+    });
+}
+
+inline GroupOperation<GroupDone> connected(GroupInstanceCustomImpl &instance) {
+    return GroupOperation<GroupDone>(instance.mediaThread(), [&instance](GroupOperation<GroupDone>::Completion completion) {
+        instance.whenConnected([completion = std::move(completion)] {
+            completion(GroupDone());
+        });
+    });
+}
+
+// After setJoinResponsePayload(), device changes or stop() were applied.
+inline GroupOperation<GroupDone> queuedTasks(GroupInstanceCustomImpl &instance) {
+    return GroupOperation<GroupDone>(instance.mediaThread(), [&instance](GroupOperation<GroupDone>::Completion completion) {
+        instance.afterQueuedTasks([completion = std::move(completion)] {
+            completion(GroupDone());
+        });
+    });
+}
+
+} // namespace tgcalls
+
+#endif
+
+#endif
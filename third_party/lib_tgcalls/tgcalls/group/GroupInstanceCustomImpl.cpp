@@ -1,4 +1,8 @@
 #include "GroupInstanceCustomImpl.h"
+#include "GroupCertificatePool.h"
+#include "GroupEngineContext.h"
+#include "GroupFieldTrials.h"
+#include "GroupInstanceArena.h"
 
 #include <memory>
 #include <iomanip>
@@ -12,6 +16,9 @@
 #include "StaticThreads.h"
 #include "GroupNetworkManager.h"
 
+#include "api/audio/audio_mixer.h"
+#include "modules/audio_mixer/audio_mixer_impl.h"
+#include "common_audio/resampler/include/push_resampler.h"
 #include "api/audio_codecs/audio_decoder_factory_template.h"
 #include "api/audio_codecs/audio_encoder_factory_template.h"
 #include "api/audio_codecs/opus/audio_decoder_opus.h"
@@ -24,10 +31,14 @@
 #include "system_wrappers/include/field_trial.h"
 #include "api/video/builtin_video_bitrate_allocator_factory.h"
 #include "call/call.h"
-#include "modules/rtp_rtcp/source/rtp_utility.h"
 #include "api/call/audio_sink.h"
 #include "modules/audio_processing/audio_buffer.h"
+#include "modules/audio_processing/ns/noise_suppressor.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/match.h"
+#include "api/frame_transformer_interface.h"
+#include "api/video/video_source_interface.h"
 #include "modules/audio_processing/agc2/vad_with_level.h"
 #include "pc/channel_manager.h"
 #include "media/base/rtp_data_engine.h"
@@ -36,7 +47,13 @@
 #include "modules/audio_coding/include/audio_coding_module.h"
 #include "common_audio/include/audio_util.h"
 
+#include "AudioDsp.h"
 #include "AudioFrame.h"
+#include "CallStatsSnapshotBuilder.h"
+#include "HotPathCounters.h"
+#include "OverloadController.h"
+#include "TraceRecorder.h"
+#include "ThreadHopQueue.h"
 #include "ThreadLocalObject.h"
 #include "Manager.h"
 #include "NetworkManager.h"
@@ -45,9 +62,18 @@
 #include "LogSinkImpl.h"
 #include "CodecSelectHelper.h"
 #include "StreamingPart.h"
+#include "BroadcastPartDecoder.h"
+#include "BroadcastPartCache.h"
+#include "ParallelDecodingAudioMixer.h"
+#include "GroupAudioMixer.h"
 #include "AudioDeviceHelper.h"
 #include "FakeAudioDeviceModule.h"
 
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <deque>
+#include <limits>
 #include <mutex>
 #include <random>
 #include <sstream>
@@ -63,11 +89,420 @@
 #endif
 
 #include "GroupJoinPayloadInternal.h"
+#include "MissingSsrcPacketBuffer.h"
+#include "SsrcExpiryWheel.h"
+#include "GroupAudioEncoderFactory.h"
+#include "GroupAudioBridge.h"
+#include "GroupOpusPacketSource.h"
+#include "GroupSharedAudioDecoder.h"
+#include "GroupSharedAudioEncoder.h"
+#include "GroupTimerWheel.h"
+#include "GroupVideoDecoderFactory.h"
+#include "GroupVideoEncoderFactory.h"
+#include "JsonStream.h"
 
-#include "third-party/json11.hpp"
 
 namespace tgcalls {
 
+// Fixed-capacity single-producer/single-consumer queue of float S16 samples
+// added with addExternalAudioSamples(). The media thread is the producer;
+// the audio capture thread (AudioCapturePostProcessor and
+// ExternalAudioRecorder both run on it) is the consumer, so the realtime side
+// never takes a lock or moves the buffered samples.
+class ExternalAudioSampleRing {
+public:
+    // Two seconds of 48 kHz mono, rounded up to a power of two.
+    static constexpr size_t kCapacity = 131072;
+
+    ExternalAudioSampleRing() : _samples(kCapacity) {
+    }
+
+    // Appends |count| samples, dropping whatever does not fit. Producer only.
+    void write(const int16_t *samples, size_t count) {
+        size_t writePosition = _writePosition.load(std::memory_order_relaxed);
+        size_t readPosition = _readPosition.load(std::memory_order_acquire);
+        size_t space = kCapacity - (writePosition - readPosition);
+        size_t taken = std::min(count, space);
+        if (taken < count) {
+            _droppedSamples.fetch_add(count - taken, std::memory_order_relaxed);
+        }
+
+        size_t offset = writePosition & (kCapacity - 1);
+        size_t first = std::min(taken, kCapacity - offset);
+        AudioS16ToFloatS16(samples, first, _samples.data() + offset);
+        AudioS16ToFloatS16(samples + first, taken - first, _samples.data());
+        _writePosition.store(writePosition + taken, std::memory_order_release);
+    }
+
+    // Copies up to |count| samples out and returns how many were queued.
+    // Consumer only.
+    size_t read(float *samples, size_t count) {
+        size_t readPosition = _readPosition.load(std::memory_order_relaxed);
+        size_t writePosition = _writePosition.load(std::memory_order_acquire);
+        size_t taken = std::min(count, writePosition - readPosition);
+
+        size_t offset = readPosition & (kCapacity - 1);
+        size_t first = std::min(taken, kCapacity - offset);
+        memcpy(samples, _samples.data() + offset, first * sizeof(float));
+        memcpy(samples + first, _samples.data(), (taken - first) * sizeof(float));
+        _readPosition.store(readPosition + taken, std::memory_order_release);
+        return taken;
+    }
+
+    size_t available() const {
+        return _writePosition.load(std::memory_order_acquire) - _readPosition.load(std::memory_order_acquire);
+    }
+
+    uint64_t droppedSamples() const {
+        return _droppedSamples.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<float> _samples;
+    alignas(64) std::atomic<size_t> _writePosition{0};
+    alignas(64) std::atomic<size_t> _readPosition{0};
+    std::atomic<uint64_t> _droppedSamples{0};
+};
+
+// Counts the tasks that hand received packets over to the worker thread.
+// Updated from the media and network threads; the per second rates are
+// refreshed by the media thread's levels timer.
+class PacketDeliveryCounters {
+public:
+    // Why the network thread dropped an unresolved packet instead of passing
+    // it on to the media thread.
+    enum class DropReason {
+        Sctp,
+        Malformed,
+        OwnSsrc,
+        NotOpus,
+        IncomingDisabled
+    };
+
+    void onThreadHop(size_t packets) {
+        _threadHops.fetch_add(1, std::memory_order_relaxed);
+        _packets.fetch_add(packets, std::memory_order_relaxed);
+    }
+
+    void onDropped(DropReason reason) {
+        _droppedPackets[static_cast<size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+        HotPathCounters::onPacketDropped(hotPathReason(reason));
+    }
+
+    uint64_t droppedPackets(DropReason reason) const {
+        return _droppedPackets[static_cast<size_t>(reason)].load(std::memory_order_relaxed);
+    }
+
+    // Media thread only.
+    void updateRates(int64_t timestamp) {
+        if (_windowStartTimestamp == 0) {
+            _windowStartTimestamp = timestamp;
+            return;
+        }
+        int64_t elapsed = timestamp - _windowStartTimestamp;
+        if (elapsed < 1000) {
+            return;
+        }
+        uint64_t threadHops = _threadHops.load(std::memory_order_relaxed);
+        uint64_t packets = _packets.load(std::memory_order_relaxed);
+        _threadHopsPerSecond.store((double)(threadHops - _windowThreadHops) * 1000.0 / (double)elapsed, std::memory_order_relaxed);
+        _packetsPerSecond.store((double)(packets - _windowPackets) * 1000.0 / (double)elapsed, std::memory_order_relaxed);
+        _windowThreadHops = threadHops;
+        _windowPackets = packets;
+        _windowStartTimestamp = timestamp;
+    }
+
+    uint64_t threadHops() const {
+        return _threadHops.load(std::memory_order_relaxed);
+    }
+
+    uint64_t packets() const {
+        return _packets.load(std::memory_order_relaxed);
+    }
+
+    double threadHopsPerSecond() const {
+        return _threadHopsPerSecond.load(std::memory_order_relaxed);
+    }
+
+    double packetsPerSecond() const {
+        return _packetsPerSecond.load(std::memory_order_relaxed);
+    }
+
+private:
+    static HotPathCounters::PacketDropReason hotPathReason(DropReason reason) {
+        switch (reason) {
+            case DropReason::Sctp:
+                return HotPathCounters::PacketDropReason::Sctp;
+            case DropReason::Malformed:
+                return HotPathCounters::PacketDropReason::Malformed;
+            case DropReason::OwnSsrc:
+                return HotPathCounters::PacketDropReason::OwnSsrc;
+            case DropReason::NotOpus:
+                return HotPathCounters::PacketDropReason::NotOpus;
+            case DropReason::IncomingDisabled:
+                return HotPathCounters::PacketDropReason::IncomingDisabled;
+        }
+        return HotPathCounters::PacketDropReason::Malformed;
+    }
+
+    std::atomic<uint64_t> _threadHops{0};
+    std::atomic<uint64_t> _packets{0};
+    std::atomic<double> _threadHopsPerSecond{0.0};
+    std::atomic<double> _packetsPerSecond{0.0};
+    std::array<std::atomic<uint64_t>, 5> _droppedPackets{};
+
+    int64_t _windowStartTimestamp = 0;
+    uint64_t _windowThreadHops = 0;
+    uint64_t _windowPackets = 0;
+};
+
+// Broadcast playback pipeline state, published by the media thread for
+// GroupInstanceCustomImpl::getBroadcastStats().
+class BroadcastCounters {
+public:
+    void update(int queuedMilliseconds, int decodingParts, int requestedParts, int reorderedParts) {
+        _queuedMilliseconds.store(queuedMilliseconds, std::memory_order_relaxed);
+        _decodingParts.store(decodingParts, std::memory_order_relaxed);
+        _requestedParts.store(requestedParts, std::memory_order_relaxed);
+        _reorderedParts.store(reorderedParts, std::memory_order_relaxed);
+    }
+
+    int queuedMilliseconds() const {
+        return _queuedMilliseconds.load(std::memory_order_relaxed);
+    }
+
+    int decodingParts() const {
+        return _decodingParts.load(std::memory_order_relaxed);
+    }
+
+    int requestedParts() const {
+        return _requestedParts.load(std::memory_order_relaxed);
+    }
+
+    int reorderedParts() const {
+        return _reorderedParts.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int> _queuedMilliseconds{0};
+    std::atomic<int> _decodingParts{0};
+    std::atomic<int> _requestedParts{0};
+    std::atomic<int> _reorderedParts{0};
+};
+
+// Join latency milestones, written once each from whichever thread reaches
+// them and read by GroupInstanceCustomImpl::getStartupLatency().
+class StartupTimings {
+public:
+    StartupTimings() :
+    _createdTimestamp(rtc::TimeMillis()) {
+    }
+
+    void onEngineReady() {
+        mark(_engineReadyMs);
+    }
+
+    void onJoinPayload() {
+        mark(_joinPayloadMs);
+    }
+
+    void onRtpPacket() {
+        if (_firstRtpMs.load(std::memory_order_relaxed) < 0) {
+            mark(_firstRtpMs);
+        }
+    }
+
+    int64_t engineReadyMs() const {
+        return _engineReadyMs.load(std::memory_order_relaxed);
+    }
+
+    int64_t joinPayloadMs() const {
+        return _joinPayloadMs.load(std::memory_order_relaxed);
+    }
+
+    int64_t firstRtpMs() const {
+        return _firstRtpMs.load(std::memory_order_relaxed);
+    }
+
+private:
+    void mark(std::atomic<int64_t> &milestone) {
+        int64_t unset = -1;
+        milestone.compare_exchange_strong(unset, rtc::TimeMillis() - _createdTimestamp, std::memory_order_relaxed);
+    }
+
+    const int64_t _createdTimestamp;
+    std::atomic<int64_t> _engineReadyMs{-1};
+    std::atomic<int64_t> _joinPayloadMs{-1};
+    std::atomic<int64_t> _firstRtpMs{-1};
+};
+
+// Volumes set through the API and not handed to the media thread yet.
+// Repeated updates of an SSRC replace each other, and only the first one
+// after the last take() needs a media thread task to be posted.
+class PendingVolumeUpdates {
+public:
+    // Returns whether the caller has to post a task that calls take().
+    bool set(uint32_t ssrc, double volume) {
+        webrtc::MutexLock lock(&_mutex);
+        bool wasEmpty = _volumes.empty();
+        _volumes[ssrc] = volume;
+        return wasEmpty;
+    }
+
+    std::vector<std::pair<uint32_t, double>> take() {
+        webrtc::MutexLock lock(&_mutex);
+        std::vector<std::pair<uint32_t, double>> volumes(_volumes.begin(), _volumes.end());
+        _volumes.clear();
+        return volumes;
+    }
+
+private:
+    webrtc::Mutex _mutex;
+    std::map<uint32_t, double> _volumes;
+};
+
+// Looks at the parsed headers of the packets the RTP demuxer left unresolved,
+// on the network thread, and drops those receivePacket() would discard
+// anyway, so they never cost a task on the media thread. As it knows the
+// call's own SSRC, it also hands incoming Opus to onIncomingOpusPacket.
+class UnresolvedPacketFilter {
+public:
+    // Without incoming channels, unknown SSRCs never get one, so their
+    // packets have nowhere to go.
+    UnresolvedPacketFilter(std::shared_ptr<PacketDeliveryCounters> packetDeliveryCounters, std::shared_ptr<StartupTimings> startupTimings, bool disableIncomingChannels) :
+    _packetDeliveryCounters(std::move(packetDeliveryCounters)),
+    _startupTimings(std::move(startupTimings)),
+    _disableIncomingChannels(disableIncomingChannels) {
+    }
+
+    // Media thread, whenever the outgoing SSRCs are generated.
+    void setOutgoingAudioSsrc(uint32_t ssrc) {
+        _outgoingAudioSsrc.store(ssrc, std::memory_order_relaxed);
+    }
+
+    // Network thread. False for a packet that was dropped.
+    bool shouldDeliver(rtc::CopyOnWriteBuffer const &packet, GroupRtpPacketHeader const &header) {
+        auto reason = classify(packet.data(), packet.size(), header);
+        if (reason) {
+            _packetDeliveryCounters->onDropped(*reason);
+            return false;
+        }
+        return true;
+    }
+
+    // Network thread. Hands the payload of |packet| to |tap| if it is Opus
+    // RTP of another participant.
+    void tapOpusPacket(rtc::CopyOnWriteBuffer const &packet, GroupRtpPacketHeader const &header, std::function<void(uint32_t, uint16_t, uint32_t, const uint8_t *, size_t)> const &tap) {
+        if (!header.isRtp() || header.payloadType != 111) {
+            return;
+        }
+        if (header.ssrc == _outgoingAudioSsrc.load(std::memory_order_relaxed)) {
+            return;
+        }
+        const size_t overhead = header.headerLength + header.paddingLength;
+        if (overhead >= packet.size()) {
+            return;
+        }
+        tap(header.ssrc, header.sequenceNumber, header.timestamp, packet.data() + header.headerLength, packet.size() - overhead);
+    }
+
+private:
+    absl::optional<PacketDeliveryCounters::DropReason> classify(const uint8_t *data, size_t size, GroupRtpPacketHeader const &header) {
+        using DropReason = PacketDeliveryCounters::DropReason;
+
+        // SCTP common header: source and destination port 5000.
+        if (size >= 4 && data[0] == 0x13 && data[1] == 0x88 && data[2] == 0x13 && data[3] == 0x88) {
+            return DropReason::Sctp;
+        }
+        // Shorter than an RTCP header, or not version 2: neither parser
+        // would take it.
+        if (size < 8 || (data[0] >> 6) != 2) {
+            return DropReason::Malformed;
+        }
+        // The network thread parsed the header already.
+        if (header.type == GroupRtpPacketHeader::Type::Rtcp) {
+            return absl::nullopt;
+        }
+        if (!header.isRtp()) {
+            return DropReason::Malformed;
+        }
+        if (header.ssrc == _outgoingAudioSsrc.load(std::memory_order_relaxed)) {
+            return DropReason::OwnSsrc;
+        }
+        _startupTimings->onRtpPacket();
+        // Only Opus packets of unknown SSRCs get one requested, and every
+        // audio channel is Opus.
+        if (header.payloadType != 111) {
+            return DropReason::NotOpus;
+        }
+        if (_disableIncomingChannels) {
+            return DropReason::IncomingDisabled;
+        }
+        return absl::nullopt;
+    }
+
+    std::shared_ptr<PacketDeliveryCounters> _packetDeliveryCounters;
+    std::shared_ptr<StartupTimings> _startupTimings;
+    const bool _disableIncomingChannels = false;
+    std::atomic<uint32_t> _outgoingAudioSsrc{0};
+};
+
+// Whether capture noise suppression runs, set from the media thread and read
+// on the audio capture thread, and what it costs there, read by
+// GroupInstanceCustomImpl::getNoiseSuppressionStats().
+class NoiseSuppressionConfiguration {
+public:
+    explicit NoiseSuppressionConfiguration(bool isEnabled) :
+    _isEnabled(isEnabled) {
+    }
+
+    bool isEnabled() const {
+        return _isEnabled.load(std::memory_order_relaxed);
+    }
+
+    void setIsEnabled(bool isEnabled) {
+        _isEnabled.store(isEnabled, std::memory_order_relaxed);
+    }
+
+    // Set once the capture processor that suppresses noise exists; calls
+    // that send a screencast, or unprocessed audio and started with noise
+    // suppression off, don't have one.
+    bool isAvailable() const {
+        return _isAvailable.load(std::memory_order_relaxed);
+    }
+
+    void setIsAvailable() {
+        _isAvailable.store(true, std::memory_order_relaxed);
+    }
+
+    void onFrameProcessed(int64_t elapsedNs) {
+        _processedFrames.fetch_add(1, std::memory_order_relaxed);
+        _totalProcessingNs.fetch_add(elapsedNs, std::memory_order_relaxed);
+        int64_t maxNs = _maxProcessingNs.load(std::memory_order_relaxed);
+        while (elapsedNs > maxNs && !_maxProcessingNs.compare_exchange_weak(maxNs, elapsedNs, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t processedFrames() const {
+        return _processedFrames.load(std::memory_order_relaxed);
+    }
+
+    int64_t totalProcessingNs() const {
+        return _totalProcessingNs.load(std::memory_order_relaxed);
+    }
+
+    int64_t maxProcessingNs() const {
+        return _maxProcessingNs.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<bool> _isEnabled{false};
+    std::atomic<bool> _isAvailable{false};
+    std::atomic<uint64_t> _processedFrames{0};
+    std::atomic<int64_t> _totalProcessingNs{0};
+    std::atomic<int64_t> _maxProcessingNs{0};
+};
+
 namespace {
 
 static int stringToInt(std::string const &string) {
@@ -96,6 +531,42 @@ static uint32_t stringToUInt32(std::string const &string) {
     return value;
 }
 
+// Fills in the bitrates a profile leaves to |bitrateKbit| and keeps every
+// value within what Opus and its packetization support.
+static GroupAudioEncoderProfile resolveAudioEncoderProfile(GroupAudioEncoderProfile profile, int bitrateKbit) {
+    if (profile.maxBitrateKbit <= 0) {
+        profile.maxBitrateKbit = bitrateKbit;
+    }
+    if (profile.minBitrateKbit <= 0) {
+        profile.minBitrateKbit = std::min(bitrateKbit, profile.maxBitrateKbit);
+    }
+    if (profile.startBitrateKbit <= 0) {
+        profile.startBitrateKbit = std::min(bitrateKbit, profile.maxBitrateKbit);
+    }
+    profile.maxBitrateKbit = std::min(std::max(profile.maxBitrateKbit, 6), 510);
+    profile.minBitrateKbit = std::min(std::max(profile.minBitrateKbit, 6), profile.maxBitrateKbit);
+    profile.startBitrateKbit = std::min(std::max(profile.startBitrateKbit, profile.minBitrateKbit), profile.maxBitrateKbit);
+    profile.ptimeMs = std::min(std::max(profile.ptimeMs, 10), 120);
+    profile.complexity = std::min(profile.complexity, 10);
+    return profile;
+}
+
+// Whether the call sends audio at a fixed bitrate without transport-wide
+// congestion control; only calls that never send video can.
+static bool isConstantBitrateAudio(GroupInstanceDescriptor const &descriptor) {
+    return descriptor.constantBitrateAudio
+        && (descriptor.audioOnly || descriptor.videoContentType == VideoContentType::None);
+}
+
+// Holds the encoder at the profile's highest bitrate; DTX would make the
+// rate variable again.
+static GroupAudioEncoderProfile makeConstantBitrateProfile(GroupAudioEncoderProfile profile) {
+    profile.minBitrateKbit = profile.maxBitrateKbit;
+    profile.startBitrateKbit = profile.maxBitrateKbit;
+    profile.dtx = false;
+    return profile;
+}
+
 static uint16_t stringToUInt16(std::string const &string) {
     std::stringstream stringStream(string);
     uint16_t value = 0;
@@ -103,12 +574,6 @@ static uint16_t stringToUInt16(std::string const &string) {
     return value;
 }
 
-static std::string formatTimestampMillis(int64_t timestamp) {
-    std::ostringstream stringStream;
-    stringStream << std::fixed << std::setprecision(3) << (double)timestamp / 1000.0;
-    return stringStream.str();
-}
-
 static VideoCaptureInterfaceObject *GetVideoCaptureAssumingSameThread(VideoCaptureInterface *videoCapture) {
     return videoCapture
         ? static_cast<VideoCaptureInterfaceImpl*>(videoCapture)->object()->getSyncAssumingSameThread()
@@ -323,6 +788,218 @@ static std::vector<OutgoingVideoFormat> assignPayloadTypes(std::vector<webrtc::S
     return result;
 }
 
+// What a group call offers of the formats its encoder factory supports, and
+// their payload types. Only depends on those formats, which are the same for
+// every call of a process with the same factory setup, so each distinct list
+// is worked out once.
+struct VideoFormatTables {
+    std::vector<webrtc::SdpVideoFormat> availableFormats;
+    std::vector<OutgoingVideoFormat> payloadTypes;
+};
+
+static std::shared_ptr<const VideoFormatTables> getVideoFormatTables(std::vector<webrtc::SdpVideoFormat> const &supportedFormats) {
+    static std::mutex mutex;
+    static std::vector<std::pair<std::vector<webrtc::SdpVideoFormat>, std::shared_ptr<const VideoFormatTables>>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &entry : cache) {
+        if (entry.first == supportedFormats) {
+            return entry.second;
+        }
+    }
+    auto tables = std::make_shared<VideoFormatTables>();
+    tables->availableFormats = filterSupportedVideoFormats(supportedFormats);
+    tables->payloadTypes = assignPayloadTypes(tables->availableFormats);
+    cache.emplace_back(supportedFormats, tables);
+    return tables;
+}
+
+// Video codec factories that are only built once the engine first asks
+// them for something, which an audio-only call never does. Any thread.
+class LazyVideoEncoderFactory : public webrtc::VideoEncoderFactory {
+public:
+    explicit LazyVideoEncoderFactory(std::function<std::unique_ptr<webrtc::VideoEncoderFactory>()> create) :
+    _create(std::move(create)) {
+    }
+
+    std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+        return factory().GetSupportedFormats();
+    }
+
+    std::vector<webrtc::SdpVideoFormat> GetImplementations() const override {
+        return factory().GetImplementations();
+    }
+
+    CodecInfo QueryVideoEncoder(const webrtc::SdpVideoFormat &format) const override {
+        return factory().QueryVideoEncoder(format);
+    }
+
+    std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(const webrtc::SdpVideoFormat &format) override {
+        return factory().CreateVideoEncoder(format);
+    }
+
+    std::unique_ptr<EncoderSelectorInterface> GetEncoderSelector() const override {
+        return factory().GetEncoderSelector();
+    }
+
+private:
+    webrtc::VideoEncoderFactory &factory() const {
+        std::call_once(_createOnce, [this] {
+            _factory = _create();
+        });
+        return *_factory;
+    }
+
+    const std::function<std::unique_ptr<webrtc::VideoEncoderFactory>()> _create;
+    mutable std::once_flag _createOnce;
+    mutable std::unique_ptr<webrtc::VideoEncoderFactory> _factory;
+};
+
+class LazyVideoDecoderFactory : public webrtc::VideoDecoderFactory {
+public:
+    explicit LazyVideoDecoderFactory(std::function<std::unique_ptr<webrtc::VideoDecoderFactory>()> create) :
+    _create(std::move(create)) {
+    }
+
+    std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+        return factory().GetSupportedFormats();
+    }
+
+    std::unique_ptr<webrtc::VideoDecoder> CreateVideoDecoder(const webrtc::SdpVideoFormat &format) override {
+        return factory().CreateVideoDecoder(format);
+    }
+
+private:
+    webrtc::VideoDecoderFactory &factory() const {
+        std::call_once(_createOnce, [this] {
+            _factory = _create();
+        });
+        return *_factory;
+    }
+
+    const std::function<std::unique_ptr<webrtc::VideoDecoderFactory>()> _create;
+    mutable std::once_flag _createOnce;
+    mutable std::unique_ptr<webrtc::VideoDecoderFactory> _factory;
+};
+
+// Hands the incoming video RTP of the requested video channels to
+// onIncomingVideoPacket on the network thread, with the endpoint it belongs
+// to. Retransmissions go through as the packets they repair, so that what
+// taps them recovers from loss as the receive stream does.
+class IncomingVideoPacketTap {
+public:
+    explicit IncomingVideoPacketTap(std::function<void(std::string const &, GroupIncomingVideoPacket const &)> callback) :
+    _callback(std::move(callback)) {
+    }
+
+    // Media thread, once the payload types the channels receive are known.
+    void setPayloadTypes(std::vector<OutgoingVideoFormat> const &payloadTypes) {
+        webrtc::MutexLock lock(&_mutex);
+        _payloadTypes.clear();
+        for (const auto &payloadType : payloadTypes) {
+            VideoCodecName codec;
+            if (payloadType.videoCodec.name == cricket::kVp8CodecName) {
+                codec = VideoCodecName::VP8;
+            } else if (payloadType.videoCodec.name == cricket::kVp9CodecName) {
+                codec = VideoCodecName::VP9;
+            } else if (payloadType.videoCodec.name == cricket::kH264CodecName) {
+                codec = VideoCodecName::H264;
+            } else {
+                continue;
+            }
+            _payloadTypes[payloadType.videoCodec.id] = PayloadType{ codec, false };
+            _payloadTypes[payloadType.rtxCodec.id] = PayloadType{ codec, true };
+        }
+    }
+
+    // Media thread, as video channels are added and removed.
+    void addEndpoint(GroupParticipantVideoInformation const &videoInformation) {
+        const auto endpointId = std::make_shared<const std::string>(videoInformation.endpointId);
+        webrtc::MutexLock lock(&_mutex);
+        for (const auto &group : videoInformation.ssrcGroups) {
+            for (auto ssrc : group.ssrcs) {
+                _endpoints.emplace(ssrc, Endpoint{ endpointId, ssrc });
+            }
+        }
+        // An "FID" group pairs a stream with the one its retransmissions
+        // come in.
+        for (const auto &group : videoInformation.ssrcGroups) {
+            if (group.semantics == "FID" && group.ssrcs.size() == 2) {
+                _endpoints[group.ssrcs[1]] = Endpoint{ endpointId, group.ssrcs[0] };
+            }
+        }
+    }
+
+    void removeEndpoint(std::string const &endpointId) {
+        webrtc::MutexLock lock(&_mutex);
+        for (auto it = _endpoints.begin(); it != _endpoints.end();) {
+            it = *it->second.endpointId == endpointId ? _endpoints.erase(it) : std::next(it);
+        }
+    }
+
+    // Network thread.
+    void tap(rtc::CopyOnWriteBuffer const &packet, GroupRtpPacketHeader const &header) {
+        if (!header.isRtp()) {
+            return;
+        }
+        std::shared_ptr<const std::string> endpointId;
+        GroupIncomingVideoPacket videoPacket;
+        bool isRetransmission = false;
+        {
+            webrtc::MutexLock lock(&_mutex);
+            const auto endpoint = _endpoints.find(header.ssrc);
+            if (endpoint == _endpoints.end()) {
+                return;
+            }
+            const auto payloadType = _payloadTypes.find(header.payloadType);
+            if (payloadType == _payloadTypes.end()) {
+                return;
+            }
+            endpointId = endpoint->second.endpointId;
+            videoPacket.ssrc = endpoint->second.mediaSsrc;
+            videoPacket.codec = payloadType->second.codec;
+            isRetransmission = payloadType->second.isRetransmission;
+        }
+        const size_t overhead = header.headerLength + header.paddingLength;
+        if (overhead >= packet.size()) {
+            return;
+        }
+        videoPacket.sequenceNumber = header.sequenceNumber;
+        videoPacket.timestamp = header.timestamp;
+        videoPacket.marker = header.marker;
+        videoPacket.payload = packet.data() + header.headerLength;
+        videoPacket.size = packet.size() - overhead;
+        if (isRetransmission) {
+            // The original sequence number, then the original payload; a
+            // bandwidth probe has nothing after it.
+            if (videoPacket.size <= 2) {
+                return;
+            }
+            videoPacket.sequenceNumber = (uint16_t(videoPacket.payload[0]) << 8) | uint16_t(videoPacket.payload[1]);
+            videoPacket.payload += 2;
+            videoPacket.size -= 2;
+        }
+        _callback(*endpointId, videoPacket);
+    }
+
+private:
+    struct PayloadType {
+        VideoCodecName codec = VideoCodecName::VP8;
+        bool isRetransmission = false;
+    };
+
+    struct Endpoint {
+        std::shared_ptr<const std::string> endpointId;
+        uint32_t mediaSsrc = 0;
+    };
+
+    std::function<void(std::string const &, GroupIncomingVideoPacket const &)> _callback;
+
+    webrtc::Mutex _mutex;
+    std::map<int, PayloadType> _payloadTypes;
+    std::map<uint32_t, Endpoint> _endpoints;
+};
+
 struct VideoSsrcs {
     struct SimulcastLayer {
         uint32_t ssrc = 0;
@@ -373,6 +1050,15 @@ struct ChannelId {
     return actualSsrc < rhs.actualSsrc;
   }
 
+  bool operator ==(const ChannelId& rhs) const {
+    return networkSsrc == rhs.networkSsrc && actualSsrc == rhs.actualSsrc;
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const ChannelId& channelId) {
+    return H::combine(std::move(h), channelId.networkSsrc, channelId.actualSsrc);
+  }
+
   std::string name() {
     if (networkSsrc == actualSsrc) {
       return uint32ToString(networkSsrc);
@@ -405,6 +1091,17 @@ struct ChannelSsrcInfo {
     std::string videoEndpointId;
 };
 
+// The last join payload emitted, with what it was built from: the SSRCs,
+// by the revision generateSsrcs() gave them, and the local ICE parameters
+// and certificate. Retries and reconnects emit it again as long as none of
+// them changed. Network thread.
+struct JoinPayloadCache {
+    int ssrcsRevision = -1;
+    PeerIceParameters iceParameters;
+    rtc::scoped_refptr<rtc::RTCCertificate> certificate;
+    GroupJoinPayload payload;
+};
+
 struct RequestedMediaChannelDescriptions {
     std::shared_ptr<RequestMediaChannelDescriptionTask> task;
     std::vector<uint32_t> ssrcs;
@@ -468,10 +1165,8 @@ public:
             return _history.update(0.0f);
         }
         webrtc::AudioFrameView<float> frameView(buffer->channels(), buffer->num_channels(), buffer->num_frames());
-        float peak = 0.0f;
-        for (const auto &x : frameView.channel(0)) {
-            peak = std::max(std::fabs(x), peak);
-        }
+        auto channel = frameView.channel(0);
+        float peak = AudioAbsPeak(channel.data(), channel.size());
         if (peak <= 0.01f) {
             return _history.update(false);
         }
@@ -509,25 +1204,143 @@ private:
     size_t _sampleCount = 0;
 };
 
-class AudioSinkImpl: public webrtc::AudioSinkInterface {
+// Stands in for webrtc's AudioMixerImpl when playout mixing is disabled.
+// Sources are pulled at their own rate, which decodes them and feeds their
+// AudioSinkImpl, but are never resampled or summed; the device gets silence.
+class DecodeOnlyAudioMixer : public webrtc::AudioMixer {
 public:
-    struct Update {
-        float level = 0.0f;
-        bool hasSpeech = false;
-
-        Update(float level_, bool hasSpech_) :
-            level(level_), hasSpeech(hasSpech_) {
-        }
+    explicit DecodeOnlyAudioMixer(bool decodeSources) :
+    _decodeSources(decodeSources) {
+    }
 
-        Update(const Update &other) :
-            level(other.level), hasSpeech(other.hasSpeech) {
+    bool AddSource(Source *audioSource) override {
+        webrtc::MutexLock lock(&_mutex);
+        if (std::find(_sources.begin(), _sources.end(), audioSource) != _sources.end()) {
+            return false;
         }
-    };
+        _sources.push_back(audioSource);
+        return true;
+    }
 
-public:
-    AudioSinkImpl(std::function<void(Update)> update,
-        ChannelId channel_id, std::function<void(uint32_t, const AudioFrame &)> onAudioFrame) :
-    _update(update), _channel_id(channel_id), _onAudioFrame(std::move(onAudioFrame)) {
+    void RemoveSource(Source *audioSource) override {
+        webrtc::MutexLock lock(&_mutex);
+        _sources.erase(std::remove(_sources.begin(), _sources.end(), audioSource), _sources.end());
+    }
+
+    void Mix(size_t numberOfChannels, webrtc::AudioFrame *audioFrameForMixing) override {
+        if (_decodeSources) {
+            webrtc::MutexLock lock(&_mutex);
+            for (auto source : _sources) {
+                source->GetAudioFrameWithInfo(source->PreferredSampleRate(), &_sourceFrame);
+            }
+        }
+        audioFrameForMixing->UpdateFrame(0, nullptr, 480, 48000, webrtc::AudioFrame::kNormalSpeech, webrtc::AudioFrame::kVadUnknown, numberOfChannels);
+    }
+
+private:
+    bool _decodeSources = false;
+    webrtc::Mutex _mutex;
+    std::vector<Source *> _sources;
+    webrtc::AudioFrame _sourceFrame;
+};
+
+// Counts, in HotPathCounters, each time an incoming stream's NetEq starts
+// concealing missing audio, by looking at the frames the playout mixer
+// pulls. Wraps every source added to |mixer|.
+class ExpandCountingAudioMixer : public webrtc::AudioMixer {
+public:
+    explicit ExpandCountingAudioMixer(rtc::scoped_refptr<webrtc::AudioMixer> mixer) :
+    _mixer(std::move(mixer)) {
+    }
+
+    bool AddSource(Source *audioSource) override {
+        webrtc::MutexLock lock(&_mutex);
+        if (_sources.find(audioSource) != _sources.end()) {
+            return false;
+        }
+        auto source = std::make_unique<CountedSource>(audioSource);
+        if (!_mixer->AddSource(source.get())) {
+            return false;
+        }
+        _sources.emplace(audioSource, std::move(source));
+        return true;
+    }
+
+    void RemoveSource(Source *audioSource) override {
+        webrtc::MutexLock lock(&_mutex);
+        const auto it = _sources.find(audioSource);
+        if (it == _sources.end()) {
+            return;
+        }
+        // Not pulled once removed, so it can go right away.
+        _mixer->RemoveSource(it->second.get());
+        _sources.erase(it);
+    }
+
+    void Mix(size_t numberOfChannels, webrtc::AudioFrame *audioFrameForMixing) override {
+        _mixer->Mix(numberOfChannels, audioFrameForMixing);
+    }
+
+private:
+    class CountedSource : public Source {
+    public:
+        explicit CountedSource(Source *source) :
+        _source(source) {
+        }
+
+        AudioFrameInfo GetAudioFrameWithInfo(int sampleRateHz, webrtc::AudioFrame *audioFrame) override {
+            const auto info = _source->GetAudioFrameWithInfo(sampleRateHz, audioFrame);
+            const bool isConcealing = info != AudioFrameInfo::kError
+                && (audioFrame->speech_type_ == webrtc::AudioFrame::kPLC || audioFrame->speech_type_ == webrtc::AudioFrame::kPLCCNG);
+            if (isConcealing && !_isConcealing) {
+                HotPathCounters::onJitterBufferExpand(HotPathCounters::JitterBuffer::Rtc);
+            }
+            _isConcealing = isConcealing;
+            return info;
+        }
+
+        int Ssrc() const override {
+            return _source->Ssrc();
+        }
+
+        int PreferredSampleRate() const override {
+            return _source->PreferredSampleRate();
+        }
+
+    private:
+        Source *_source = nullptr;
+        // Audio thread only.
+        bool _isConcealing = false;
+    };
+
+    rtc::scoped_refptr<webrtc::AudioMixer> _mixer;
+    webrtc::Mutex _mutex;
+    std::map<Source *, std::unique_ptr<CountedSource>> _sources;
+};
+
+class AudioSinkImpl: public webrtc::AudioSinkInterface {
+public:
+    struct Update {
+        float level = 0.0f;
+        bool hasSpeech = false;
+
+        Update(float level_, bool hasSpech_) :
+            level(level_), hasSpeech(hasSpech_) {
+        }
+
+        Update(const Update &other) :
+            level(other.level), hasSpeech(other.hasSpeech) {
+        }
+    };
+
+public:
+    // Frames between two VAD runs when |enableVad| is set; the last result is
+    // held in between.
+    static constexpr int kVadFrameInterval = 5;
+
+    AudioSinkImpl(std::function<void(Update)> update,
+        ChannelId channel_id, std::function<void(uint32_t, const AudioFrame &)> onAudioFrame, bool enableVad = false) :
+    _update(update), _channel_id(channel_id), _onAudioFrame(std::move(onAudioFrame)), _enableVad(enableVad) {
     }
 
     virtual ~AudioSinkImpl() {
@@ -549,37 +1362,32 @@ public:
             const int16_t *samples = (const int16_t *)audio.data;
             int numberOfSamplesInFrame = (int)audio.samples_per_channel;
 
-            int16_t currentPeak = 0;
-            for (int i = 0; i < numberOfSamplesInFrame; i++) {
-                int16_t sample = samples[i];
-                if (sample < 0) {
-                    sample = -sample;
-                }
-                if (_peak < sample) {
-                    _peak = sample;
-                }
-                if (currentPeak < sample) {
-                    currentPeak = sample;
-                }
-                _peakCount += 1;
+            int16_t currentPeak = AudioAbsPeak(samples, numberOfSamplesInFrame);
+            if (_peak < currentPeak) {
+                _peak = currentPeak;
             }
+            _peakCount += numberOfSamplesInFrame;
 
-            /*bool vadResult = false;
-            if (currentPeak > 10) {
-                webrtc::AudioBuffer buffer(audio.sample_rate, 1, 48000, 1, 48000, 1);
-                webrtc::StreamConfig config(audio.sample_rate, 1);
-                buffer.CopyFrom(samples, config);
+            if (_enableVad && _vadFrameCount++ % kVadFrameInterval == 0) {
+                if (currentPeak > 10) {
+                    if (!_vadBuffer || _vadSampleRate != audio.sample_rate) {
+                        _vadSampleRate = audio.sample_rate;
+                        _vadBuffer.reset(new webrtc::AudioBuffer(audio.sample_rate, 1, 48000, 1, 48000, 1));
+                    }
+                    webrtc::StreamConfig config(audio.sample_rate, 1);
+                    _vadBuffer->CopyFrom(samples, config);
 
-                vadResult = _vad.update(&buffer);
-            } else {
-                vadResult = _vad.update();
-            }*/
+                    _vadResult = _vad.update(_vadBuffer.get());
+                } else {
+                    _vadResult = _vad.update();
+                }
+            }
 
             if (_peakCount >= 4400) {
                 float level = ((float)(_peak)) / 8000.0f;
                 _peak = 0;
                 _peakCount = 0;
-                _update(Update(level, level >= 1.0f));
+                _update(Update(level, _enableVad ? _vadResult : level >= 1.0f));
             }
         }
     }
@@ -592,99 +1400,323 @@ private:
   int _peakCount = 0;
     uint16_t _peak = 0;
 
+    bool _enableVad = false;
     CombinedVad _vad;
+    std::unique_ptr<webrtc::AudioBuffer> _vadBuffer;
+    int _vadSampleRate = 0;
+    int _vadFrameCount = 0;
+    bool _vadResult = false;
 
 };
 
-class VideoSinkImpl : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
+// Decoded broadcast audio of one participant, handed straight to the playout
+// mixer instead of being packetised as L16 RTP and decoded again by a
+// receive stream. push() is called on the media thread, the mixer pulls on
+// the audio thread.
+class BroadcastAudioSource : public webrtc::AudioMixer::Source {
 public:
-    VideoSinkImpl(std::string const &endpointId) :
-    _endpointId(endpointId) {
+    // Frames buffered before playback starts, and after every underrun, to
+    // absorb the 20 ms commit cycle.
+    static constexpr size_t kPrebufferFrames = 3;
+    static constexpr size_t kMaxBufferedFrames = 50;
+
+    explicit BroadcastAudioSource(uint32_t ssrc) :
+    _ssrc(ssrc),
+    _frames(kMaxBufferedFrames) {
+        for (auto &frame : _frames) {
+            frame.reserve(StreamingPart::kSamplesPer10ms);
+        }
+        _samples.reserve(StreamingPart::kSamplesPer10ms);
     }
 
-    virtual ~VideoSinkImpl() {
+    void push(const int16_t *samples, size_t numSamples, int sampleRate) {
+        webrtc::MutexLock lock(&_mutex);
+        if (_frameCount >= kMaxBufferedFrames) {
+            _firstFrame = (_firstFrame + 1) % kMaxBufferedFrames;
+            _frameCount--;
+            HotPathCounters::onFrameDropped(HotPathCounters::FrameKind::BroadcastAudio);
+        }
+        // Frames keep their capacity, so this only copies.
+        _frames[(_firstFrame + _frameCount) % kMaxBufferedFrames].assign(samples, samples + numSamples);
+        _frameCount++;
+        _sampleRate = sampleRate;
     }
 
-    virtual void OnFrame(const webrtc::VideoFrame& frame) override {
-        std::unique_lock<std::mutex> lock{ _mutex };
-        int64_t timestamp = rtc::TimeMillis();
-        if (_lastFrame) {
-            if (_lastFrame->video_frame_buffer()->width() != frame.video_frame_buffer()->width()) {
-                int64_t deltaTime = std::abs(_lastFrameSizeChangeTimestamp - timestamp);
-                if (deltaTime < 200) {
-                    RTC_LOG(LS_WARNING) << "VideoSinkImpl: frequent frame size change detected for " << _endpointId << ": " << _lastFrameSizeChangeHeight << " -> " << _lastFrame->video_frame_buffer()->height() << " -> " << frame.video_frame_buffer()->height() << " in " << deltaTime << " ms";
-                }
+    void setVolume(double volume) {
+        _gain.store((float)volume, std::memory_order_relaxed);
+    }
 
-                _lastFrameSizeChangeHeight = _lastFrame->video_frame_buffer()->height();
-                _lastFrameSizeChangeTimestamp = timestamp;
+    AudioFrameInfo GetAudioFrameWithInfo(int sampleRateHz, webrtc::AudioFrame *audioFrame) override {
+        int sampleRate = 0;
+        {
+            webrtc::MutexLock lock(&_mutex);
+            if (_isBuffering && _frameCount < kPrebufferFrames) {
+                return AudioFrameInfo::kMuted;
+            }
+            if (_frameCount == 0) {
+                if (!_isBuffering) {
+                    HotPathCounters::onJitterBufferExpand(HotPathCounters::JitterBuffer::Broadcast);
+                }
+                _isBuffering = true;
+                return AudioFrameInfo::kMuted;
             }
+            _isBuffering = false;
+            _samples.swap(_frames[_firstFrame]);
+            _firstFrame = (_firstFrame + 1) % kMaxBufferedFrames;
+            _frameCount--;
+            sampleRate = _sampleRate;
+        }
+
+        auto &samples = _samples;
+        float gain = _gain.load(std::memory_order_relaxed);
+        if (gain != 1.0f) {
+            for (auto &sample : samples) {
+                sample = (int16_t)std::max(-32768.0f, std::min(32767.0f, (float)sample * gain));
+            }
+        }
+
+        if (sampleRate == sampleRateHz) {
+            audioFrame->UpdateFrame(_timestamp, samples.data(), samples.size(), sampleRate, webrtc::AudioFrame::kNormalSpeech, webrtc::AudioFrame::kVadUnknown, 1);
         } else {
-            _lastFrameSizeChangeHeight = 0;
-            _lastFrameSizeChangeTimestamp = timestamp;
+            if (_resampler.InitializeIfNeeded(sampleRate, sampleRateHz, 1) != 0) {
+                return AudioFrameInfo::kError;
+            }
+            size_t outputSamples = (size_t)(sampleRateHz / 100);
+            audioFrame->UpdateFrame(_timestamp, nullptr, outputSamples, sampleRateHz, webrtc::AudioFrame::kNormalSpeech, webrtc::AudioFrame::kVadUnknown, 1);
+            _resampler.Resample(samples.data(), samples.size(), audioFrame->mutable_data(), outputSamples);
         }
-        _lastFrame = frame;
-        for (int i = (int)(_sinks.size()) - 1; i >= 0; i--) {
-            auto strong = _sinks[i].lock();
-            if (!strong) {
-                _sinks.erase(_sinks.begin() + i);
-            } else {
+        _timestamp += (uint32_t)audioFrame->samples_per_channel();
+        HotPathCounters::onFrameDelivered(HotPathCounters::FrameKind::BroadcastAudio);
+
+        return AudioFrameInfo::kNormal;
+    }
+
+    int Ssrc() const override {
+        return (int)_ssrc;
+    }
+
+    int PreferredSampleRate() const override {
+        return 48000;
+    }
+
+private:
+    uint32_t _ssrc = 0;
+    webrtc::Mutex _mutex;
+    // Ring of |_frameCount| frames from |_firstFrame|; the frame taken for
+    // playout is swapped with |_samples|, so no buffer is ever reallocated.
+    std::vector<std::vector<int16_t>> _frames;
+    size_t _firstFrame = 0;
+    size_t _frameCount = 0;
+    int _sampleRate = 48000;
+    bool _isBuffering = true;
+    std::atomic<float> _gain{1.0f};
+
+    // Audio thread only.
+    std::vector<int16_t> _samples;
+    webrtc::PushResampler<int16_t> _resampler;
+    uint32_t _timestamp = 0;
+};
+
+// A broadcast participant played through the direct path: its source in the
+// playout mixer, if there is one, and the sink computing its levels and
+// feeding the per-SSRC audio tap. Media thread only.
+class DirectBroadcastAudioChannel {
+public:
+    DirectBroadcastAudioChannel(ChannelId channelId, rtc::scoped_refptr<webrtc::AudioMixer> mixer, std::function<void(AudioSinkImpl::Update)> &&onLevel, std::function<void(uint32_t, const AudioFrame &)> onAudioFrame, bool enableVad) :
+    _mixer(std::move(mixer)),
+    _sink(std::move(onLevel), channelId, std::move(onAudioFrame), enableVad) {
+        if (_mixer) {
+            _source = std::make_unique<BroadcastAudioSource>(channelId.actualSsrc);
+            _mixer->AddSource(_source.get());
+        }
+    }
+
+    ~DirectBroadcastAudioChannel() {
+        if (_mixer) {
+            // Waits for a Mix() in progress; the source is unused afterwards.
+            _mixer->RemoveSource(_source.get());
+        }
+    }
+
+    void push(const int16_t *samples, size_t numSamples, int sampleRate) {
+        if (_source) {
+            _source->push(samples, numSamples, sampleRate);
+        }
+
+        webrtc::AudioSinkInterface::Data data(samples, numSamples, sampleRate, 1, 0);
+        _sink.OnData(data);
+
+        _activity = rtc::TimeMillis();
+    }
+
+    void setVolume(double volume) {
+        if (_source) {
+            _source->setVolume(volume);
+        }
+    }
+
+    int64_t getActivity() const {
+        return _activity;
+    }
+
+private:
+    rtc::scoped_refptr<webrtc::AudioMixer> _mixer;
+    std::unique_ptr<BroadcastAudioSource> _source;
+    AudioSinkImpl _sink;
+    int64_t _activity = 0;
+};
+
+// Fans the frames of one stream out to its sinks. The sink list is copy on
+// write: adding or pruning a sink publishes a new list, so the decoder thread
+// walks a snapshot without taking a lock and a sink called from it never
+// holds up addSink(). Sinks too slow to be called inline should be wrapped
+// in a QueuedVideoSink.
+class VideoSinkImpl : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
+public:
+    // With |retainLastFrame|, the last frame is kept and handed to every
+    // sink added later, which then needn't wait for the next one.
+    // |sinksExpired| is called on the thread delivering frames whenever
+    // sinks that went away have been dropped.
+    VideoSinkImpl(std::string const &endpointId, bool retainLastFrame = false, std::function<void()> sinksExpired = nullptr) :
+    _endpointId(endpointId),
+    _retainLastFrame(retainLastFrame),
+    _sinksExpired(std::move(sinksExpired)),
+    _sinks(std::make_shared<Sinks>()) {
+    }
+
+    virtual ~VideoSinkImpl() {
+    }
+
+    virtual void OnFrame(const webrtc::VideoFrame& frame) override {
+        checkFrameSize(frame);
+        if (_retainLastFrame) {
+            std::unique_lock<std::mutex> lock{ _lastFrameMutex };
+            _lastFrame = frame;
+        }
+
+        const auto sinks = std::atomic_load(&_sinks);
+        bool hasExpired = false;
+        for (const auto &sink : *sinks) {
+            if (const auto strong = sink.lock()) {
                 strong->OnFrame(frame);
+            } else {
+                hasExpired = true;
             }
         }
+        if (hasExpired) {
+            removeExpiredSinks();
+        }
     }
 
     virtual void OnDiscardedFrame() override {
-        std::unique_lock<std::mutex> lock{ _mutex };
-        for (int i = (int)(_sinks.size()) - 1; i >= 0; i--) {
-            auto strong = _sinks[i].lock();
-            if (!strong) {
-                _sinks.erase(_sinks.begin() + i);
-            } else {
+        const auto sinks = std::atomic_load(&_sinks);
+        bool hasExpired = false;
+        for (const auto &sink : *sinks) {
+            if (const auto strong = sink.lock()) {
                 strong->OnDiscardedFrame();
+            } else {
+                hasExpired = true;
             }
         }
+        if (hasExpired) {
+            removeExpiredSinks();
+        }
     }
 
     void addSink(std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> impl) {
-        std::unique_lock<std::mutex> lock{ _mutex };
-        _sinks.push_back(impl);
-        if (_lastFrame) {
+        {
+            std::unique_lock<std::mutex> lock{ _sinksMutex };
+            auto updated = std::make_shared<Sinks>(*_sinks);
+            updated->push_back(impl);
+            std::atomic_store(&_sinks, std::shared_ptr<const Sinks>(std::move(updated)));
+        }
+        if (_retainLastFrame) {
+            absl::optional<webrtc::VideoFrame> lastFrame;
+            {
+                std::unique_lock<std::mutex> lock{ _lastFrameMutex };
+                lastFrame = _lastFrame;
+            }
             auto strong = impl.lock();
-            if (strong) {
-                strong->OnFrame(_lastFrame.value());
+            if (strong && lastFrame) {
+                strong->OnFrame(lastFrame.value());
             }
         }
     }
 
 private:
-    std::vector<std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>>> _sinks;
-    absl::optional<webrtc::VideoFrame> _lastFrame;
-    std::mutex _mutex;
-    int64_t _lastFrameSizeChangeTimestamp = 0;
-    int _lastFrameSizeChangeHeight = 0;
+    using Sinks = std::vector<std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>>>;
+
+    // Frames only come from one thread at a time, so the size history needs
+    // no lock.
+    void checkFrameSize(const webrtc::VideoFrame &frame) {
+        int width = frame.video_frame_buffer()->width();
+        int height = frame.video_frame_buffer()->height();
+        if (_lastFrameWidth == width) {
+            _lastFrameHeight = height;
+            return;
+        }
+        // The clock is only read when the size changes, not on every frame.
+        int64_t timestamp = rtc::TimeMillis();
+        if (_lastFrameWidth != 0) {
+            int64_t deltaTime = std::abs(_lastFrameSizeChangeTimestamp - timestamp);
+            if (deltaTime < 200) {
+                RTC_LOG(LS_WARNING) << "VideoSinkImpl: frequent frame size change detected for " << _endpointId << ": " << _lastFrameSizeChangeHeight << " -> " << _lastFrameHeight << " -> " << height << " in " << deltaTime << " ms";
+            }
+
+            _lastFrameSizeChangeHeight = _lastFrameHeight;
+            _lastFrameSizeChangeTimestamp = timestamp;
+        } else {
+            _lastFrameSizeChangeHeight = 0;
+            _lastFrameSizeChangeTimestamp = timestamp;
+        }
+        _lastFrameWidth = width;
+        _lastFrameHeight = height;
+    }
+
+    void removeExpiredSinks() {
+        {
+            std::unique_lock<std::mutex> lock{ _sinksMutex };
+            auto updated = std::make_shared<Sinks>();
+            for (const auto &sink : *_sinks) {
+                if (!sink.expired()) {
+                    updated->push_back(sink);
+                }
+            }
+            std::atomic_store(&_sinks, std::shared_ptr<const Sinks>(std::move(updated)));
+        }
+        if (_sinksExpired) {
+            _sinksExpired();
+        }
+    }
+
     std::string _endpointId;
+    bool _retainLastFrame = false;
+    std::function<void()> _sinksExpired;
 
-};
+    // Replaced under |_sinksMutex|, read with std::atomic_load.
+    std::shared_ptr<const Sinks> _sinks;
+    std::mutex _sinksMutex;
 
-struct NoiseSuppressionConfiguration {
-    NoiseSuppressionConfiguration(bool isEnabled_) :
-    isEnabled(isEnabled_) {
+    std::mutex _lastFrameMutex;
+    absl::optional<webrtc::VideoFrame> _lastFrame;
 
-    }
+    int _lastFrameWidth = 0;
+    int _lastFrameHeight = 0;
+    int64_t _lastFrameSizeChangeTimestamp = 0;
+    int _lastFrameSizeChangeHeight = 0;
 
-    bool isEnabled = false;
 };
 
 #if USE_RNNOISE
 class AudioCapturePostProcessor : public webrtc::CustomProcessing {
 public:
-    AudioCapturePostProcessor(std::function<void(GroupLevelValue const &)> updated, std::shared_ptr<NoiseSuppressionConfiguration> noiseSuppressionConfiguration, std::vector<float> *externalAudioSamples, webrtc::Mutex *externalAudioSamplesMutex) :
+    AudioCapturePostProcessor(std::function<void(GroupLevelValue const &)> updated, std::shared_ptr<NoiseSuppressionConfiguration> noiseSuppressionConfiguration, std::shared_ptr<ExternalAudioSampleRing> externalAudioSamples) :
     _updated(updated),
     _noiseSuppressionConfiguration(noiseSuppressionConfiguration),
-    _externalAudioSamples(externalAudioSamples),
-    _externalAudioSamplesMutex(externalAudioSamplesMutex) {
+    _externalAudioSamples(std::move(externalAudioSamples)) {
         int frameSize = rnnoise_get_frame_size();
         _frameSamples.resize(frameSize);
+        _externalFrameSamples.resize(frameSize);
 
         _denoiseState = rnnoise_create(nullptr);
     }
@@ -713,34 +1745,19 @@ private:
             return;
         }
 
-        float sourcePeak = 0.0f;
-        float *sourceSamples = buffer->channels()[0];
-        for (int i = 0; i < _frameSamples.size(); i++) {
-            sourcePeak = std::max(std::fabs(sourceSamples[i]), sourcePeak);
-        }
+        float sourcePeak = AudioAbsPeak(buffer->channels()[0], _frameSamples.size());
 
-        if (_noiseSuppressionConfiguration->isEnabled) {
+        if (_noiseSuppressionConfiguration->isEnabled()) {
             float vadProbability = 0.0f;
             if (sourcePeak >= 0.01f) {
+                const int64_t startNs = rtc::TimeNanos();
                 vadProbability = rnnoise_process_frame(_denoiseState, _frameSamples.data(), buffer->channels()[0]);
-                if (_noiseSuppressionConfiguration->isEnabled) {
-                    memcpy(buffer->channels()[0], _frameSamples.data(), _frameSamples.size() * sizeof(float));
-                }
+                memcpy(buffer->channels()[0], _frameSamples.data(), _frameSamples.size() * sizeof(float));
+                _noiseSuppressionConfiguration->onFrameProcessed(rtc::TimeNanos() - startNs);
             }
 
-            float peak = 0;
-            int peakCount = 0;
-            const float *samples = buffer->channels_const()[0];
-            for (int i = 0; i < buffer->num_frames(); i++) {
-                float sample = samples[i];
-                if (sample < 0) {
-                    sample = -sample;
-                }
-                if (peak < sample) {
-                    peak = sample;
-                }
-                peakCount += 1;
-            }
+            float peak = AudioAbsPeak(buffer->channels_const()[0], buffer->num_frames());
+            int peakCount = (int)buffer->num_frames();
 
             bool vadStatus = _history.update(vadProbability);
 
@@ -759,19 +1776,8 @@ private:
                 });
             }
         } else {
-            float peak = 0;
-            int peakCount = 0;
-            const float *samples = buffer->channels_const()[0];
-            for (int i = 0; i < buffer->num_frames(); i++) {
-                float sample = samples[i];
-                if (sample < 0) {
-                    sample = -sample;
-                }
-                if (peak < sample) {
-                    peak = sample;
-                }
-                peakCount += 1;
-            }
+            float peak = AudioAbsPeak(buffer->channels_const()[0], buffer->num_frames());
+            int peakCount = (int)buffer->num_frames();
 
             _peakCount += peakCount;
             if (_peak < peak) {
@@ -789,23 +1795,15 @@ private:
             }
         }
 
-        _externalAudioSamplesMutex->Lock();
-        if (!_externalAudioSamples->empty()) {
-            float *bufferData = buffer->channels()[0];
-            int takenSamples = 0;
-            for (int i = 0; i < _externalAudioSamples->size() && i < _frameSamples.size(); i++) {
-                float sample = (*_externalAudioSamples)[i];
-                sample += bufferData[i];
-                sample = std::min(sample, 32768.f);
-                sample = std::max(sample, -32768.f);
-                bufferData[i] = sample;
-                takenSamples++;
-            }
-            if (takenSamples != 0) {
-                _externalAudioSamples->erase(_externalAudioSamples->begin(), _externalAudioSamples->begin() + takenSamples);
-            }
+        size_t takenSamples = _externalAudioSamples->read(_externalFrameSamples.data(), _externalFrameSamples.size());
+        float *bufferData = buffer->channels()[0];
+        for (size_t i = 0; i < takenSamples; i++) {
+            float sample = _externalFrameSamples[i];
+            sample += bufferData[i];
+            sample = std::min(sample, 32768.f);
+            sample = std::max(sample, -32768.f);
+            bufferData[i] = sample;
         }
-        _externalAudioSamplesMutex->Unlock();
     }
 
     virtual std::string ToString() const override {
@@ -826,17 +1824,17 @@ private:
     VadHistory _history;
     SparseVad _vad;
 
-    std::vector<float> *_externalAudioSamples = nullptr;
-    webrtc::Mutex *_externalAudioSamplesMutex = nullptr;
+    std::shared_ptr<ExternalAudioSampleRing> _externalAudioSamples;
+    std::vector<float> _externalFrameSamples;
 };
 #endif
 
 class ExternalAudioRecorder : public FakeAudioDeviceModule::Recorder {
 public:
-    ExternalAudioRecorder(std::vector<float> *externalAudioSamples, webrtc::Mutex *externalAudioSamplesMutex) :
-    _externalAudioSamples(externalAudioSamples),
-    _externalAudioSamplesMutex(externalAudioSamplesMutex) {
+    ExternalAudioRecorder(std::shared_ptr<ExternalAudioSampleRing> externalAudioSamples) :
+    _externalAudioSamples(std::move(externalAudioSamples)) {
         _samples.resize(480);
+        _floatSamples.resize(480);
     }
 
     virtual ~ExternalAudioRecorder() {
@@ -845,20 +1843,14 @@ public:
     virtual AudioFrame Record() override {
         AudioFrame result;
 
-        _externalAudioSamplesMutex->Lock();
-        if (!_externalAudioSamples->empty() && _externalAudioSamples->size() >= 480) {
-            size_t takenSamples = std::min(_samples.size(), _externalAudioSamples->size());
-            webrtc::FloatS16ToS16(_externalAudioSamples->data(), takenSamples, _samples.data());
+        if (_externalAudioSamples->available() >= _samples.size()) {
+            size_t takenSamples = _externalAudioSamples->read(_floatSamples.data(), _floatSamples.size());
+            AudioFloatS16ToS16(_floatSamples.data(), takenSamples, _samples.data());
 
             result.num_samples = takenSamples;
-
-            if (takenSamples != 0) {
-                _externalAudioSamples->erase(_externalAudioSamples->begin(), _externalAudioSamples->begin() + takenSamples);
-            }
         } else {
             result.num_samples = 0;
         }
-        _externalAudioSamplesMutex->Unlock();
 
         result.audio_samples = _samples.data();
         result.bytes_per_sample = 2;
@@ -871,16 +1863,13 @@ public:
     }
 
     virtual int32_t WaitForUs() override {
-        _externalAudioSamplesMutex->Lock();
-        _externalAudioSamplesMutex->Unlock();
-
         return 1000;
     }
 
 private:
-    std::vector<float> *_externalAudioSamples = nullptr;
-    webrtc::Mutex *_externalAudioSamplesMutex = nullptr;
+    std::shared_ptr<ExternalAudioSampleRing> _externalAudioSamples;
     std::vector<int16_t> _samples;
+    std::vector<float> _floatSamples;
 };
 
 #if not USE_RNNOISE
@@ -898,19 +1887,8 @@ private:
       return;
     }
 
-    float peak = 0;
-    int peakCount = 0;
-    const float *samples = buffer->channels_const()[0];
-    for (int i = 0; i < buffer->num_frames(); i++) {
-      float sample = samples[i];
-      if (sample < 0) {
-        sample = -sample;
-      }
-      if (peak < sample) {
-        peak = sample;
-      }
-      peakCount += 1;
-    }
+    float peak = AudioAbsPeak(buffer->channels_const()[0], buffer->num_frames());
+    int peakCount = (int)buffer->num_frames();
 
     bool vadStatus = _vad.update((webrtc::AudioBuffer *)buffer);
 
@@ -947,12 +1925,361 @@ public:
       _updated(updated) {
   }
 
-  virtual ~AudioCaptureAnalyzer() = default;
-};
-#endif
+  virtual ~AudioCaptureAnalyzer() = default;
+};
+
+// Capture noise suppression for builds without RNNoise, on top of what the
+// engine's own NS does: WebRTC's suppressor at a stronger level, whose FFT
+// picks its SSE2 or NEON kernels at runtime. It runs after
+// AudioCaptureAnalyzer, so levels and VAD still see the input, and starts
+// its noise estimate over whenever it is enabled again.
+class NoiseSuppressionPostProcessor : public webrtc::CustomProcessing {
+public:
+    explicit NoiseSuppressionPostProcessor(std::shared_ptr<NoiseSuppressionConfiguration> noiseSuppressionConfiguration) :
+    _noiseSuppressionConfiguration(std::move(noiseSuppressionConfiguration)) {
+    }
+
+private:
+    void Initialize(int sample_rate_hz, int num_channels) override {
+        _sampleRateHz = sample_rate_hz;
+        _suppressor.reset();
+    }
+
+    void Process(webrtc::AudioBuffer *buffer) override {
+        if (!buffer) {
+            return;
+        }
+        if (!_noiseSuppressionConfiguration->isEnabled()) {
+            _suppressor.reset();
+            return;
+        }
+
+        const int64_t startNs = rtc::TimeNanos();
+        if (!_suppressor || _numChannels != buffer->num_channels()) {
+            webrtc::NsConfig config;
+            config.target_level = webrtc::NsConfig::SuppressionLevel::k18dB;
+            _numChannels = buffer->num_channels();
+            _suppressor = std::make_unique<webrtc::NoiseSuppressor>(config, _sampleRateHz, _numChannels);
+        }
+        // The engine merged the bands back before handing the frame over.
+        const bool isMultiBand = buffer->num_bands() > 1;
+        if (isMultiBand) {
+            buffer->SplitIntoFrequencyBands();
+        }
+        _suppressor->Analyze(*buffer);
+        _suppressor->Process(buffer);
+        if (isMultiBand) {
+            buffer->MergeFrequencyBands();
+        }
+        _noiseSuppressionConfiguration->onFrameProcessed(rtc::TimeNanos() - startNs);
+    }
+
+    std::string ToString() const override {
+        return "NoiseSuppressionPostProcessor";
+    }
+
+    void SetRuntimeSetting(webrtc::AudioProcessing::RuntimeSetting setting) override {
+    }
+
+    std::shared_ptr<NoiseSuppressionConfiguration> _noiseSuppressionConfiguration;
+    int _sampleRateHz = 48000;
+    size_t _numChannels = 0;
+    std::unique_ptr<webrtc::NoiseSuppressor> _suppressor;
+};
+#endif
+
+// The capture level of calls that send their input unprocessed, without an
+// AudioProcessing to hang AudioCaptureAnalyzer on: the peak of what the
+// device records, on the same scale, with voice meaning anything above
+// near silence instead of a VAD decision.
+class CaptureLevelAudioDeviceModule : public DefaultWrappedAudioDeviceModule, private webrtc::AudioTransport {
+public:
+    CaptureLevelAudioDeviceModule(rtc::scoped_refptr<webrtc::AudioDeviceModule> impl, std::function<void(GroupLevelValue const &)> updated) :
+    DefaultWrappedAudioDeviceModule(impl),
+    _updated(std::move(updated)) {
+    }
+
+    int32_t RegisterAudioCallback(webrtc::AudioTransport *audioCallback) override {
+        _transport.store(audioCallback);
+        return DefaultWrappedAudioDeviceModule::RegisterAudioCallback(audioCallback ? this : nullptr);
+    }
+
+private:
+    static constexpr float kVoiceLevel = 0.02f;
+
+    int32_t RecordedDataIsAvailable(const void *audioSamples, const size_t nSamples, const size_t nBytesPerSample, const size_t nChannels, const uint32_t samplesPerSec, const uint32_t totalDelayMS, const int32_t clockDrift, const uint32_t currentMicLevel, const bool keyPressed, uint32_t &newMicLevel) override {
+        if (nBytesPerSample == 2 * nChannels) {
+            const auto samples = static_cast<const int16_t *>(audioSamples);
+            int peak = 0;
+            for (size_t i = 0; i < nSamples * nChannels; i++) {
+                peak = std::max(peak, std::abs(int(samples[i])));
+            }
+            _peak = std::max(_peak, peak);
+            _peakCount += int(nSamples);
+            if (_peakCount >= 1200) {
+                float level = _peak / 4000.0f;
+                _peak = 0;
+                _peakCount = 0;
+                _updated(GroupLevelValue{
+                    level,
+                    level > kVoiceLevel,
+                });
+            }
+        }
+        const auto transport = _transport.load();
+        if (!transport) {
+            return 0;
+        }
+        return transport->RecordedDataIsAvailable(audioSamples, nSamples, nBytesPerSample, nChannels, samplesPerSec, totalDelayMS, clockDrift, currentMicLevel, keyPressed, newMicLevel);
+    }
+
+    int32_t NeedMorePlayData(const size_t nSamples, const size_t nBytesPerSample, const size_t nChannels, const uint32_t samplesPerSec, void *audioSamples, size_t &nSamplesOut, int64_t *elapsed_time_ms, int64_t *ntp_time_ms) override {
+        const auto transport = _transport.load();
+        if (!transport) {
+            nSamplesOut = 0;
+            return 0;
+        }
+        return transport->NeedMorePlayData(nSamples, nBytesPerSample, nChannels, samplesPerSec, audioSamples, nSamplesOut, elapsed_time_ms, ntp_time_ms);
+    }
+
+    void PullRenderData(int bits_per_sample, int sample_rate, size_t number_of_channels, size_t number_of_frames, void *audio_data, int64_t *elapsed_time_ms, int64_t *ntp_time_ms) override {
+        if (const auto transport = _transport.load()) {
+            transport->PullRenderData(bits_per_sample, sample_rate, number_of_channels, number_of_frames, audio_data, elapsed_time_ms, ntp_time_ms);
+        }
+    }
+
+    std::function<void(GroupLevelValue const &)> _updated;
+    std::atomic<webrtc::AudioTransport *> _transport{nullptr};
+    // Audio device thread only.
+    int _peak = 0;
+    int _peakCount = 0;
+};
+
+// GroupVoiceGate on the recorded input: frames are handed to the engine
+// while CombinedVad hears speech and for the hangover after it; closed, the
+// last few are held back, to go out ahead of the frame that opens it again.
+class VoiceGateAudioDeviceModule : public DefaultWrappedAudioDeviceModule, private webrtc::AudioTransport {
+public:
+    VoiceGateAudioDeviceModule(rtc::scoped_refptr<webrtc::AudioDeviceModule> impl, GroupVoiceGate const &config, std::function<void(GroupLevelValue const &)> updated) :
+    DefaultWrappedAudioDeviceModule(impl),
+    _hangoverMs(std::max(0, config.hangoverMs)),
+    _updated(config.reportsSilence ? std::move(updated) : nullptr) {
+    }
+
+    int32_t RegisterAudioCallback(webrtc::AudioTransport *audioCallback) override {
+        _transport.store(audioCallback);
+        return DefaultWrappedAudioDeviceModule::RegisterAudioCallback(audioCallback ? this : nullptr);
+    }
+
+private:
+    // As long as CombinedVad takes to decide on speech.
+    static constexpr size_t kHeldFrames = kVadResultHistoryLength;
+
+    struct HeldFrame {
+        std::vector<int16_t> samples;
+        size_t nSamples = 0;
+        size_t nChannels = 0;
+        uint32_t samplesPerSec = 0;
+    };
+
+    int32_t RecordedDataIsAvailable(const void *audioSamples, const size_t nSamples, const size_t nBytesPerSample, const size_t nChannels, const uint32_t samplesPerSec, const uint32_t totalDelayMS, const int32_t clockDrift, const uint32_t currentMicLevel, const bool keyPressed, uint32_t &newMicLevel) override {
+        const auto transport = _transport.load();
+        if (!transport) {
+            return 0;
+        }
+        // Anything but 10 ms of s16 goes through ungated.
+        if (nBytesPerSample != 2 * nChannels || samplesPerSec == 0 || nSamples != samplesPerSec / 100) {
+            return transport->RecordedDataIsAvailable(audioSamples, nSamples, nBytesPerSample, nChannels, samplesPerSec, totalDelayMS, clockDrift, currentMicLevel, keyPressed, newMicLevel);
+        }
+
+        const auto samples = static_cast<const int16_t *>(audioSamples);
+        if (isSpeech(samples, nChannels, samplesPerSec)) {
+            _silentMs = 0;
+            if (!_isOpen) {
+                _isOpen = true;
+                sendHeldFrames(transport, totalDelayMS, clockDrift, currentMicLevel, keyPressed, newMicLevel);
+            }
+        } else if (_isOpen) {
+            _silentMs += 10;
+            if (_silentMs > _hangoverMs) {
+                _isOpen = false;
+                if (_updated) {
+                    _updated(GroupLevelValue{ 0.0f, false });
+                }
+            }
+        }
+
+        if (!_isOpen) {
+            hold(samples, nSamples, nChannels, samplesPerSec);
+            return 0;
+        }
+        return transport->RecordedDataIsAvailable(audioSamples, nSamples, nBytesPerSample, nChannels, samplesPerSec, totalDelayMS, clockDrift, currentMicLevel, keyPressed, newMicLevel);
+    }
+
+    int32_t NeedMorePlayData(const size_t nSamples, const size_t nBytesPerSample, const size_t nChannels, const uint32_t samplesPerSec, void *audioSamples, size_t &nSamplesOut, int64_t *elapsed_time_ms, int64_t *ntp_time_ms) override {
+        const auto transport = _transport.load();
+        if (!transport) {
+            nSamplesOut = 0;
+            return 0;
+        }
+        return transport->NeedMorePlayData(nSamples, nBytesPerSample, nChannels, samplesPerSec, audioSamples, nSamplesOut, elapsed_time_ms, ntp_time_ms);
+    }
+
+    void PullRenderData(int bits_per_sample, int sample_rate, size_t number_of_channels, size_t number_of_frames, void *audio_data, int64_t *elapsed_time_ms, int64_t *ntp_time_ms) override {
+        if (const auto transport = _transport.load()) {
+            transport->PullRenderData(bits_per_sample, sample_rate, number_of_channels, number_of_frames, audio_data, elapsed_time_ms, ntp_time_ms);
+        }
+    }
+
+    bool isSpeech(const int16_t *samples, size_t nChannels, uint32_t samplesPerSec) {
+        if (!_buffer || _bufferSampleRate != samplesPerSec || _bufferChannels != nChannels) {
+            // Downmixed, as the VAD only looks at the first channel.
+            _buffer = std::make_unique<webrtc::AudioBuffer>(samplesPerSec, nChannels, samplesPerSec, 1, samplesPerSec, 1);
+            _bufferSampleRate = samplesPerSec;
+            _bufferChannels = nChannels;
+        }
+        _buffer->CopyFrom(samples, webrtc::StreamConfig(int(samplesPerSec), nChannels));
+        return _vad.update(_buffer.get());
+    }
+
+    void hold(const int16_t *samples, size_t nSamples, size_t nChannels, uint32_t samplesPerSec) {
+        auto &frame = _heldFrames[_nextHeldFrame];
+        frame.samples.assign(samples, samples + nSamples * nChannels);
+        frame.nSamples = nSamples;
+        frame.nChannels = nChannels;
+        frame.samplesPerSec = samplesPerSec;
+        _nextHeldFrame = (_nextHeldFrame + 1) % kHeldFrames;
+        _heldFrameCount = std::min(_heldFrameCount + 1, kHeldFrames);
+    }
+
+    void sendHeldFrames(webrtc::AudioTransport *transport, uint32_t totalDelayMS, int32_t clockDrift, uint32_t currentMicLevel, bool keyPressed, uint32_t &newMicLevel) {
+        size_t index = (_nextHeldFrame + kHeldFrames - _heldFrameCount) % kHeldFrames;
+        for (size_t i = 0; i < _heldFrameCount; i++) {
+            const auto &frame = _heldFrames[index];
+            transport->RecordedDataIsAvailable(frame.samples.data(), frame.nSamples, 2 * frame.nChannels, frame.nChannels, frame.samplesPerSec, totalDelayMS, clockDrift, currentMicLevel, keyPressed, newMicLevel);
+            index = (index + 1) % kHeldFrames;
+        }
+        _heldFrameCount = 0;
+    }
+
+    const int _hangoverMs = 0;
+    std::function<void(GroupLevelValue const &)> _updated;
+    std::atomic<webrtc::AudioTransport *> _transport{nullptr};
+
+    // Audio device thread only.
+    CombinedVad _vad;
+    std::unique_ptr<webrtc::AudioBuffer> _buffer;
+    uint32_t _bufferSampleRate = 0;
+    size_t _bufferChannels = 0;
+    bool _isOpen = false;
+    int _silentMs = 0;
+    std::array<HeldFrame, kHeldFrames> _heldFrames;
+    size_t _nextHeldFrame = 0;
+    size_t _heldFrameCount = 0;
+};
+
+// Keeps playout running once started. Without the dummy incoming channel,
+// the engine would stop it whenever the last incoming stream goes and
+// start it again with the next speaker; it is still stopped on Terminate().
+class PersistentPlayoutAudioDeviceModule : public DefaultWrappedAudioDeviceModule {
+public:
+    explicit PersistentPlayoutAudioDeviceModule(rtc::scoped_refptr<webrtc::AudioDeviceModule> impl) :
+    DefaultWrappedAudioDeviceModule(impl) {
+    }
+
+    int32_t StopPlayout() override {
+        return 0;
+    }
+};
+
+// Receive-only voice channel for one SSRC. Creating the underlying
+// cricket::VoiceChannel is a blocking worker thread round trip, so channels
+// can also be created unbound (warm) and then bound to an SSRC with bind(),
+// which only posts the SSRC specific setup; unbind() makes a channel reusable.
+class IncomingAudioChannel;
+
+// Worker thread work of several incoming audio channels, applied in a single
+// worker thread round trip instead of one task or Invoke per channel.
+// Destroyed channels go first, then the tasks run in the order they were
+// added; those of a destroyed channel are dropped.
+class WorkerThreadBatch {
+public:
+    void add(rtc::scoped_refptr<webrtc::PendingTaskSafetyFlag> safety, std::function<void()> &&task) {
+        _tasks.push_back(std::make_pair(std::move(safety), std::move(task)));
+    }
+
+    void destroy(std::unique_ptr<IncomingAudioChannel> &&channel) {
+        _destroyedChannels.push_back(std::move(channel));
+    }
+
+    // Blocks on the worker thread only if channels have to be destroyed.
+    void commit(rtc::Thread *workerThread);
+
+private:
+    std::vector<std::pair<rtc::scoped_refptr<webrtc::PendingTaskSafetyFlag>, std::function<void()>>> _tasks;
+    std::vector<std::unique_ptr<IncomingAudioChannel>> _destroyedChannels;
+};
+
+// NetEq for the incoming audio channels, with the maximum delay of
+// GroupAudioReceiveProfile, which only the NetEq config has a place for.
+class GroupNetEqFactory : public webrtc::NetEqFactory {
+public:
+    explicit GroupNetEqFactory(int maxDelayMs) :
+    _maxDelayMs(std::max(0, maxDelayMs)) {
+    }
+
+    std::unique_ptr<webrtc::NetEq> CreateNetEq(const webrtc::NetEq::Config &config, const rtc::scoped_refptr<webrtc::AudioDecoderFactory> &decoder_factory, webrtc::Clock *clock) const override {
+        webrtc::NetEq::Config adjustedConfig = config;
+        if (_maxDelayMs > 0) {
+            adjustedConfig.max_delay_ms = std::max(_maxDelayMs, config.min_delay_ms);
+        }
+        return _factory.CreateNetEq(adjustedConfig, decoder_factory, clock);
+    }
+
+private:
+    const int _maxDelayMs = 0;
+    webrtc::DefaultNetEqFactory _factory;
+};
+
+class IncomingAudioChannel : public sigslot::has_slots<> {
+public:
+    IncomingAudioChannel(
+        cricket::ChannelManager *channelManager,
+        webrtc::Call *call,
+        webrtc::RtpTransport *rtpTransport,
+        rtc::UniqueRandomIdGenerator *randomIdGenerator,
+        bool isRawPcm,
+        std::string const &contentName,
+        GroupAudioReceiveProfile const &receiveProfile,
+        std::shared_ptr<Threads> threads) :
+    _threads(threads),
+    _channelManager(channelManager),
+    _call(call),
+    _isRawPcm(isRawPcm) {
+        _creationTimestamp = rtc::TimeMillis();
+
+        threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this, rtpTransport, contentName, randomIdGenerator, &receiveProfile]() {
+            _workerThreadSafety = webrtc::PendingTaskSafetyFlag::Create();
+
+            // The maximum delay is set by GroupNetEqFactory, AudioOptions
+            // have no place for it.
+            cricket::AudioOptions audioOptions;
+            audioOptions.audio_jitter_buffer_fast_accelerate = receiveProfile.fastAccelerate;
+            audioOptions.audio_jitter_buffer_min_delay_ms = receiveProfile.minDelayMs;
+            audioOptions.audio_jitter_buffer_max_packets = receiveProfile.maxPackets;
+
+            _audioChannel = _channelManager->CreateVoiceChannel(_call, cricket::MediaConfig(), rtpTransport, _threads->getWorkerThread(), contentName, false, GroupNetworkManager::getDefaulCryptoOptions(), randomIdGenerator, audioOptions);
+
+            auto outgoingAudioDescription = createContentDescription(webrtc::RtpTransceiverDirection::kRecvOnly);
+            _audioChannel->SetLocalContent(outgoingAudioDescription.get(), webrtc::SdpType::kOffer, nullptr);
+            _audioChannel->SetPayloadTypeDemuxingEnabled(false);
+        });
+
+        //_audioChannel->SignalSentPacket().connect(this, &IncomingAudioChannel::OnSentPacket_w);
+
+        _audioChannel->Enable(true);
+    }
 
-class IncomingAudioChannel : public sigslot::has_slots<> {
-public:
     IncomingAudioChannel(
         cricket::ChannelManager *channelManager,
         webrtc::Call *call,
@@ -962,86 +2289,69 @@ public:
         ChannelId ssrc,
         std::function<void(AudioSinkImpl::Update)> &&onAudioLevelUpdated,
         std::function<void(uint32_t, const AudioFrame &)> onAudioFrame,
+        bool enableVad,
+        GroupAudioReceiveProfile const &receiveProfile,
         std::shared_ptr<Threads> threads) :
-    _threads(threads),
-    _ssrc(ssrc),
-    _channelManager(channelManager),
-    _call(call) {
-        _creationTimestamp = rtc::TimeMillis();
-
-        threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this, rtpTransport, ssrc, onAudioFrame = std::move(onAudioFrame), onAudioLevelUpdated = std::move(onAudioLevelUpdated), randomIdGenerator, isRawPcm]() mutable {
-            cricket::AudioOptions audioOptions;
-            audioOptions.audio_jitter_buffer_fast_accelerate = true;
-            audioOptions.audio_jitter_buffer_min_delay_ms = 50;
-
-            std::string streamId = std::string("stream") + ssrc.name();
-
-            _audioChannel = _channelManager->CreateVoiceChannel(_call, cricket::MediaConfig(), rtpTransport, _threads->getWorkerThread(), std::string("audio") + uint32ToString(ssrc.networkSsrc), false, GroupNetworkManager::getDefaulCryptoOptions(), randomIdGenerator, audioOptions);
-
-            const uint8_t opusPTimeMs = 120;
-
-            cricket::AudioCodec opusCodec(111, "opus", 48000, 0, 2);
-            opusCodec.SetParam(cricket::kCodecParamUseInbandFec, 1);
-            opusCodec.SetParam(cricket::kCodecParamPTime, opusPTimeMs);
-
-            cricket::AudioCodec pcmCodec(112, "l16", 48000, 0, 1);
+    IncomingAudioChannel(channelManager, call, rtpTransport, randomIdGenerator, isRawPcm, std::string("audio") + uint32ToString(ssrc.networkSsrc), receiveProfile, std::move(threads)) {
+        bind(ssrc, std::move(onAudioLevelUpdated), std::move(onAudioFrame), enableVad);
+    }
 
-            auto outgoingAudioDescription = std::make_unique<cricket::AudioContentDescription>();
-            if (!isRawPcm) {
-                outgoingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kAudioLevelUri, 1));
-                outgoingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kAbsSendTimeUri, 2));
-                outgoingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kTransportSequenceNumberUri, 3));
-            }
-            outgoingAudioDescription->set_rtcp_mux(true);
-            outgoingAudioDescription->set_rtcp_reduced_size(true);
-            outgoingAudioDescription->set_direction(webrtc::RtpTransceiverDirection::kRecvOnly);
-            outgoingAudioDescription->set_codecs({ opusCodec, pcmCodec });
-            outgoingAudioDescription->set_bandwidth(1300000);
+    ~IncomingAudioChannel() {
+        //_audioChannel->SignalSentPacket().disconnect(this);
+        if (_audioChannel) {
+            _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
+                destroyOnWorkerThread();
+            });
+        }
+    }
 
-            auto incomingAudioDescription = std::make_unique<cricket::AudioContentDescription>();
-            if (!isRawPcm) {
-                incomingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kAudioLevelUri, 1));
-                incomingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kAbsSendTimeUri, 2));
-                incomingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kTransportSequenceNumberUri, 3));
-            }
-            incomingAudioDescription->set_rtcp_mux(true);
-            incomingAudioDescription->set_rtcp_reduced_size(true);
-            incomingAudioDescription->set_direction(webrtc::RtpTransceiverDirection::kSendOnly);
-            incomingAudioDescription->set_codecs({ opusCodec, pcmCodec });
-            incomingAudioDescription->set_bandwidth(1300000);
+    // Starts receiving |ssrc|. Doesn't wait for the worker thread; packets
+    // delivered to the call after this are handled by the new stream.
+    void bind(ChannelId ssrc, std::function<void(AudioSinkImpl::Update)> &&onAudioLevelUpdated, std::function<void(uint32_t, const AudioFrame &)> onAudioFrame, bool enableVad = false, WorkerThreadBatch *batch = nullptr) {
+        _ssrc = ssrc;
+        _activityTimestamp = 0;
+        _bindTimestamp = rtc::TimeMillis();
+        postToWorkerThread(batch, [this, ssrc, onAudioFrame = std::move(onAudioFrame), onAudioLevelUpdated = std::move(onAudioLevelUpdated), enableVad]() mutable {
+            auto incomingAudioDescription = createContentDescription(webrtc::RtpTransceiverDirection::kSendOnly);
             cricket::StreamParams streamParams = cricket::StreamParams::CreateLegacy(ssrc.networkSsrc);
-            streamParams.set_stream_ids({ streamId });
+            streamParams.set_stream_ids({ std::string("stream") + ssrc.name() });
             incomingAudioDescription->AddStream(streamParams);
-
-            _audioChannel->SetLocalContent(outgoingAudioDescription.get(), webrtc::SdpType::kOffer, nullptr);
             _audioChannel->SetRemoteContent(incomingAudioDescription.get(), webrtc::SdpType::kAnswer, nullptr);
-            _audioChannel->SetPayloadTypeDemuxingEnabled(false);
-
-            outgoingAudioDescription.reset();
-            incomingAudioDescription.reset();
 
-            if (_ssrc.actualSsrc != 1) {
-                std::unique_ptr<AudioSinkImpl> audioLevelSink(new AudioSinkImpl(std::move(onAudioLevelUpdated), _ssrc, std::move(onAudioFrame)));
+            if (ssrc.actualSsrc != 1) {
+                std::unique_ptr<AudioSinkImpl> audioLevelSink(new AudioSinkImpl(std::move(onAudioLevelUpdated), ssrc, std::move(onAudioFrame), enableVad));
                 _audioChannel->media_channel()->SetRawAudioSink(ssrc.networkSsrc, std::move(audioLevelSink));
             }
         });
+    }
 
-        //_audioChannel->SignalSentPacket().connect(this, &IncomingAudioChannel::OnSentPacket_w);
+    // Stops receiving the bound SSRC, tearing down its receive stream but
+    // keeping the channel itself.
+    void unbind(WorkerThreadBatch *batch = nullptr) {
+        postToWorkerThread(batch, [this]() {
+            auto incomingAudioDescription = createContentDescription(webrtc::RtpTransceiverDirection::kSendOnly);
+            _audioChannel->SetRemoteContent(incomingAudioDescription.get(), webrtc::SdpType::kAnswer, nullptr);
+        });
+        _ssrc = ChannelId(0);
+    }
 
-        _audioChannel->Enable(true);
+    bool isRawPcm() const {
+        return _isRawPcm;
     }
 
-    ~IncomingAudioChannel() {
-        //_audioChannel->SignalSentPacket().disconnect(this);
-        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
-            _channelManager->DestroyVoiceChannel(_audioChannel);
-            _audioChannel = nullptr;
+    void setVolume(double value, WorkerThreadBatch *batch = nullptr) {
+        auto ssrc = _ssrc.networkSsrc;
+        postToWorkerThread(batch, [this, ssrc, value]() {
+            _audioChannel->media_channel()->SetOutputVolume(ssrc, value);
         });
     }
 
-    void setVolume(double value) {
-        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this, value]() {
-            _audioChannel->media_channel()->SetOutputVolume(_ssrc.networkSsrc, value);
+    // NetEq's least target delay for the bound SSRC on top of the receive
+    // profile's; 0 for none. Reset when the channel is bound again.
+    void setBaseMinimumDelay(int delayMs, WorkerThreadBatch *batch = nullptr) {
+        auto ssrc = _ssrc.networkSsrc;
+        postToWorkerThread(batch, [this, ssrc, delayMs]() {
+            _audioChannel->media_channel()->SetBaseMinimumPlayoutDelayMs(ssrc, delayMs);
         });
     }
 
@@ -1053,23 +2363,311 @@ public:
         return _activityTimestamp;
     }
 
+    int64_t getBindTimestamp() const {
+        return _bindTimestamp;
+    }
+
+    // Worker thread.
+    void collectStats(CallStatsSnapshotBuilder &builder) {
+        builder.addVoiceChannel(_audioChannel);
+    }
+
+    // Worker thread.
+    void collectStats(GroupInstanceCustomImpl::MediaStats &stats) {
+        if (!_audioChannel) {
+            return;
+        }
+        cricket::VoiceMediaInfo info;
+        if (!_audioChannel->media_channel()->GetStats(&info, false)) {
+            return;
+        }
+        for (const auto &receiver : info.receivers) {
+            stats.incomingAudioSsrcs.push_back(receiver.ssrc());
+            stats.incomingAudioPacketsReceived.push_back(receiver.packets_rcvd);
+            stats.incomingAudioPacketsLost.push_back(receiver.packets_lost);
+            stats.incomingAudioJitterMs.push_back(receiver.jitter_ms);
+            stats.incomingAudioJitterBufferDelayMs.push_back(receiver.jitter_buffer_ms);
+            stats.incomingAudioExpandRate.push_back(receiver.expand_rate);
+            stats.incomingAudioSpeechExpandRate.push_back(receiver.speech_expand_rate);
+            stats.incomingAudioConcealedSamples.push_back(receiver.concealed_samples);
+            stats.incomingAudioConcealmentEvents.push_back(receiver.concealment_events);
+            stats.incomingAudioTotalSamples.push_back(receiver.total_samples_received);
+        }
+    }
+
 private:
+    friend class WorkerThreadBatch;
+
     void OnSentPacket_w(const rtc::SentPacket& sent_packet) {
         _call->OnSentPacket(sent_packet);
     }
 
+    void postToWorkerThread(WorkerThreadBatch *batch, std::function<void()> &&task) {
+        if (batch) {
+            batch->add(_workerThreadSafety, std::move(task));
+        } else {
+            _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafety, std::move(task)));
+        }
+    }
+
+    void destroyOnWorkerThread() {
+        _workerThreadSafety->SetNotAlive();
+        _channelManager->DestroyVoiceChannel(_audioChannel);
+        _audioChannel = nullptr;
+    }
+
+    std::unique_ptr<cricket::AudioContentDescription> createContentDescription(webrtc::RtpTransceiverDirection direction) const {
+        const uint8_t opusPTimeMs = 120;
+
+        cricket::AudioCodec opusCodec(111, "opus", 48000, 0, 2);
+        opusCodec.SetParam(cricket::kCodecParamUseInbandFec, 1);
+        opusCodec.SetParam(cricket::kCodecParamPTime, opusPTimeMs);
+
+        cricket::AudioCodec pcmCodec(112, "l16", 48000, 0, 1);
+
+        auto description = std::make_unique<cricket::AudioContentDescription>();
+        if (!_isRawPcm) {
+            description->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kAudioLevelUri, 1));
+            description->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kAbsSendTimeUri, 2));
+            description->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kTransportSequenceNumberUri, 3));
+        }
+        description->set_rtcp_mux(true);
+        description->set_rtcp_reduced_size(true);
+        description->set_direction(direction);
+        description->set_codecs({ opusCodec, pcmCodec });
+        description->set_bandwidth(1300000);
+        return description;
+    }
+
 private:
     std::shared_ptr<Threads> _threads;
-    ChannelId _ssrc;
+    ChannelId _ssrc{0};
     // Memory is managed by _channelManager
     cricket::VoiceChannel *_audioChannel = nullptr;
     // Memory is managed externally
     cricket::ChannelManager *_channelManager = nullptr;
     webrtc::Call *_call = nullptr;
+    bool _isRawPcm = false;
+    // Worker thread tasks posted by bind(), unbind(), setVolume() and
+    // setBaseMinimumDelay() are dropped once the channel is destroyed.
+    rtc::scoped_refptr<webrtc::PendingTaskSafetyFlag> _workerThreadSafety;
     int64_t _creationTimestamp = 0;
+    int64_t _bindTimestamp = 0;
     int64_t _activityTimestamp = 0;
 };
 
+void WorkerThreadBatch::commit(rtc::Thread *workerThread) {
+    const auto run = [](std::vector<std::pair<rtc::scoped_refptr<webrtc::PendingTaskSafetyFlag>, std::function<void()>>> &tasks) {
+        for (auto &task : tasks) {
+            if (task.first->alive()) {
+                task.second();
+            }
+        }
+    };
+
+    if (!_destroyedChannels.empty()) {
+        workerThread->Invoke<void>(RTC_FROM_HERE, [&]() {
+            for (auto &channel : _destroyedChannels) {
+                channel->destroyOnWorkerThread();
+            }
+            run(_tasks);
+        });
+        _destroyedChannels.clear();
+    } else if (!_tasks.empty()) {
+        workerThread->PostTask(RTC_FROM_HERE, [tasks = std::move(_tasks), run]() mutable {
+            run(tasks);
+        });
+    }
+    _tasks.clear();
+}
+
+// Recent loudness of every incoming audio SSRC, decoded or not, from the RTP
+// audio level extension. Peaks decay with a fixed half-life, so the score
+// favours speakers that are both loud and recent.
+class IncomingAudioLoudness {
+public:
+    static constexpr int64_t kHalfLifeMs = 300;
+    // Entries quieter than this are dropped on pruning.
+    static constexpr float kForgetLevel = 0.001f;
+
+    void update(uint32_t ssrc, float level, int64_t timestamp) {
+        auto &entry = _entries[ssrc];
+        entry.level = std::max(decayed(entry, timestamp), level);
+        entry.timestamp = timestamp;
+
+        if (timestamp - _lastPruneTimestamp >= 1000) {
+            _lastPruneTimestamp = timestamp;
+            for (auto it = _entries.begin(); it != _entries.end(); ) {
+                if (decayed(it->second, timestamp) < kForgetLevel) {
+                    _entries.erase(it++);
+                } else {
+                    it++;
+                }
+            }
+        }
+    }
+
+    float score(uint32_t ssrc, int64_t timestamp) const {
+        const auto it = _entries.find(ssrc);
+        if (it == _entries.end()) {
+            return 0.0f;
+        }
+        return decayed(it->second, timestamp);
+    }
+
+private:
+    struct Entry {
+        float level = 0.0f;
+        int64_t timestamp = 0;
+    };
+
+    static float decayed(Entry const &entry, int64_t timestamp) {
+        if (entry.level <= 0.0f) {
+            return 0.0f;
+        }
+        return entry.level * (float)std::exp2(-(double)(timestamp - entry.timestamp) / (double)kHalfLifeMs);
+    }
+
+    absl::flat_hash_map<uint32_t, Entry> _entries;
+    int64_t _lastPruneTimestamp = 0;
+};
+
+// Sits between the depacketizer and the decoder of an incoming video stream
+// and, while nothing renders the stream, passes only its keyframes on. The
+// stream is still received and reported on, and with a keyframe now and then
+// the receive stream doesn't ask for more every 200 ms, but delta frames
+// aren't decoded until an output is attached again.
+//
+// The delta frames since the last keyframe are kept instead, up to
+// kMaxHeldBytes, and handed to the decoder ahead of the next frame once
+// decoding starts: it then catches up from the keyframe it already decoded
+// without asking the sender for a new one.
+class IncomingVideoDecodeGate : public webrtc::FrameTransformerInterface {
+public:
+    static constexpr size_t kMaxHeldBytes = 2 * 1024 * 1024;
+
+    bool isDecoding() const {
+        return _isDecoding.load(std::memory_order_relaxed);
+    }
+
+    // Returns whether the decoder can catch up from the held frames, so no
+    // keyframe needs to be asked for.
+    bool setIsDecoding(bool isDecoding) {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        _isDecoding.store(isDecoding, std::memory_order_relaxed);
+        if (!isDecoding) {
+            // Holding starts over from the next keyframe.
+            dropHeldFramesLocked();
+        }
+        return isDecoding && _hasKeyFrame;
+    }
+
+    uint64_t skippedFrames() const {
+        return _skippedFrames.load(std::memory_order_relaxed);
+    }
+
+    // Network thread.
+    void Transform(std::unique_ptr<webrtc::TransformableFrameInterface> frame) override {
+        std::vector<std::unique_ptr<webrtc::TransformableFrameInterface>> heldFrames;
+        {
+            std::unique_lock<std::mutex> lock{ _mutex };
+            if (!isDecoding()) {
+                if (static_cast<webrtc::TransformableVideoFrameInterface *>(frame.get())->IsKeyFrame()) {
+                    dropHeldFramesLocked();
+                    _hasKeyFrame = true;
+                } else {
+                    _skippedFrames.fetch_add(1, std::memory_order_relaxed);
+                    holdLocked(std::move(frame));
+                    return;
+                }
+            } else if (!_heldFrames.empty()) {
+                heldFrames.swap(_heldFrames);
+                dropHeldFramesLocked();
+            }
+        }
+
+        for (auto &heldFrame : heldFrames) {
+            deliver(std::move(heldFrame));
+        }
+        deliver(std::move(frame));
+    }
+
+    void RegisterTransformedFrameSinkCallback(rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback, uint32_t ssrc) override {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        _callbacks[ssrc] = std::move(callback);
+    }
+
+    void UnregisterTransformedFrameSinkCallback(uint32_t ssrc) override {
+        std::unique_lock<std::mutex> lock{ _mutex };
+        _callbacks.erase(ssrc);
+    }
+
+private:
+    void holdLocked(std::unique_ptr<webrtc::TransformableFrameInterface> frame) {
+        if (!_hasKeyFrame) {
+            return;
+        }
+        const auto size = frame->GetData().size();
+        if (_heldBytes + size > kMaxHeldBytes) {
+            // Too long since the keyframe; a new one is cheaper then.
+            dropHeldFramesLocked();
+            return;
+        }
+        _heldBytes += size;
+        _heldFrames.push_back(std::move(frame));
+    }
+
+    void dropHeldFramesLocked() {
+        _heldFrames.clear();
+        _heldBytes = 0;
+        _hasKeyFrame = false;
+    }
+
+    void deliver(std::unique_ptr<webrtc::TransformableFrameInterface> frame) {
+        rtc::scoped_refptr<webrtc::TransformedFrameCallback> callback;
+        {
+            std::unique_lock<std::mutex> lock{ _mutex };
+            const auto it = _callbacks.find(frame->GetSsrc());
+            if (it != _callbacks.end()) {
+                callback = it->second;
+            }
+        }
+        if (callback) {
+            callback->OnTransformedFrame(std::move(frame));
+        }
+    }
+
+    std::atomic<bool> _isDecoding{ false };
+    std::atomic<uint64_t> _skippedFrames{ 0 };
+
+    std::mutex _mutex;
+    std::map<uint32_t, rtc::scoped_refptr<webrtc::TransformedFrameCallback>> _callbacks;
+    // The delta frames since the last keyframe passed on while not decoding.
+    std::vector<std::unique_ptr<webrtc::TransformableFrameInterface>> _heldFrames;
+    size_t _heldBytes = 0;
+    bool _hasKeyFrame = false;
+};
+
+// The smallest quality whose layer is at least as large as |maxPixelCount|
+// asks for, taking 16:9 video.
+VideoChannelDescription::Quality videoQualityForPixelCount(int maxPixelCount) {
+    if (maxPixelCount <= 320 * 180) {
+        return VideoChannelDescription::Quality::Thumbnail;
+    } else if (maxPixelCount <= 640 * 360) {
+        return VideoChannelDescription::Quality::Medium;
+    } else {
+        return VideoChannelDescription::Quality::Full;
+    }
+}
+
+struct IncomingVideoOutput {
+    std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink;
+    rtc::VideoSinkWants wants;
+};
+
+// Decoding is started by the first output attached and stopped when the
+// last one goes away; in between, the quality asked of the server is capped
+// at what the largest output needs.
 class IncomingVideoChannel : public sigslot::has_slots<> {
 public:
     IncomingVideoChannel(
@@ -1077,30 +2675,35 @@ public:
         webrtc::Call *call,
         webrtc::RtpTransport *rtpTransport,
         rtc::UniqueRandomIdGenerator *randomIdGenerator,
-        std::vector<webrtc::SdpVideoFormat> const &availableVideoFormats,
+        VideoFormatTables const &videoFormatTables,
         GroupJoinVideoInformation sharedVideoInformation,
         uint32_t audioSsrc,
         VideoChannelDescription::Quality minQuality,
         VideoChannelDescription::Quality maxQuality,
         GroupParticipantVideoInformation const &description,
-        std::shared_ptr<Threads> threads) :
+        std::shared_ptr<Threads> threads,
+        std::function<void()> outputsExpired) :
     _threads(threads),
     _endpointId(description.endpointId),
     _channelManager(channelManager),
     _call(call),
     _requestedMinQuality(minQuality),
-    _requestedMaxQuality(maxQuality) {
-        _videoSink.reset(new VideoSinkImpl(_endpointId));
-
-        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this, rtpTransport, &availableVideoFormats, &description, randomIdGenerator]() mutable {
+    _requestedMaxQuality(maxQuality),
+    _decodeGate(new rtc::RefCountedObject<IncomingVideoDecodeGate>()) {
+        // The last frame is retained for outputs attached later: with the
+        // keyframes decoded while nothing renders, they start with the
+        // latest one at once.
+        _videoSink.reset(new VideoSinkImpl(_endpointId, true, std::move(outputsExpired)));
+        updateMaxQuality();
+
+        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this, rtpTransport, &videoFormatTables, &description, randomIdGenerator]() mutable {
             uint32_t mid = randomIdGenerator->GenerateId();
             std::string streamId = std::string("video") + uint32ToString(mid);
 
             _videoBitrateAllocatorFactory = webrtc::CreateBuiltinVideoBitrateAllocatorFactory();
 
-            auto payloadTypes = assignPayloadTypes(availableVideoFormats);
             std::vector<cricket::VideoCodec> codecs;
-            for (const auto &payloadType : payloadTypes) {
+            for (const auto &payloadType : videoFormatTables.payloadTypes) {
                 codecs.push_back(payloadType.videoCodec);
                 codecs.push_back(payloadType.rtxCodec);
             }
@@ -1162,6 +2765,7 @@ public:
             _videoChannel->SetLocalContent(outgoingVideoDescription.get(), webrtc::SdpType::kOffer, nullptr);
             _videoChannel->SetRemoteContent(incomingVideoDescription.get(), webrtc::SdpType::kAnswer, nullptr);
             _videoChannel->SetPayloadTypeDemuxingEnabled(false);
+            _videoChannel->media_channel()->SetDepacketizerToDecoderFrameTransformer(_mainVideoSsrc, _decodeGate);
             _videoChannel->media_channel()->SetSink(_mainVideoSsrc, _videoSink.get());
             _videoChannel->Enable(true);
         });
@@ -1178,8 +2782,39 @@ public:
         });
     }
 
-    void addSink(std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> impl) {
-        _videoSink->addSink(impl);
+    // Adding an output again only replaces its wants.
+    void addOutput(IncomingVideoOutput const &output) {
+        for (auto &current : _outputs) {
+            if (!current.sink.owner_before(output.sink) && !output.sink.owner_before(current.sink)) {
+                current.wants = output.wants;
+                return;
+            }
+        }
+        _videoSink->addSink(output.sink);
+        _outputs.push_back(output);
+    }
+
+    // Forgets outputs that went away and starts or stops decoding to match.
+    // Returns true if maxQuality() changed.
+    bool updateOutputs() {
+        _outputs.erase(std::remove_if(_outputs.begin(), _outputs.end(), [](IncomingVideoOutput const &output) {
+            return output.sink.expired();
+        }), _outputs.end());
+
+        bool isDecoding = !_outputs.empty();
+        if (isDecoding != _decodeGate->isDecoding()) {
+            RTC_LOG(LS_INFO) << "IncomingVideoChannel: " << (isDecoding ? "started" : "stopped") << " decoding " << _endpointId << ", " << _decodeGate->skippedFrames() << " frames skipped so far";
+            const bool canCatchUp = _decodeGate->setIsDecoding(isDecoding);
+            if (isDecoding && !canCatchUp) {
+                // Rather than wait for the sender's next one. Runs before the
+                // invoke destroying the channel, if any.
+                _threads->getWorkerThread()->PostTask(RTC_FROM_HERE, [channel = _videoChannel, ssrc = _mainVideoSsrc]() {
+                    channel->media_channel()->GenerateKeyFrame(ssrc);
+                });
+            }
+        }
+
+        return updateMaxQuality();
     }
 
     std::string const &endpointId() {
@@ -1194,12 +2829,32 @@ public:
         return _requestedMaxQuality;
     }
 
+    // The quality to ask the server for: the requested maximum, lowered to
+    // what the outputs need.
+    VideoChannelDescription::Quality maxQuality() {
+        return _maxQuality;
+    }
+
     void setRequstedMinQuality(VideoChannelDescription::Quality quality) {
         _requestedMinQuality = quality;
+        updateMaxQuality();
     }
 
     void setRequstedMaxQuality(VideoChannelDescription::Quality quality) {
         _requestedMaxQuality = quality;
+        updateMaxQuality();
+    }
+
+    // Caps maxQuality() below even the requested minimum, while the host is
+    // overloaded. Returns true if maxQuality() changed.
+    bool setOverloadMaxQuality(VideoChannelDescription::Quality quality) {
+        _overloadMaxQuality = quality;
+        return updateMaxQuality();
+    }
+
+    // Worker thread.
+    void collectStats(CallStatsSnapshotBuilder &builder) {
+        builder.addVideoChannel(_videoChannel);
     }
 
 private:
@@ -1207,6 +2862,21 @@ private:
         //_call->OnSentPacket(sent_packet);
     }
 
+    bool updateMaxQuality() {
+        auto quality = VideoChannelDescription::Quality::Thumbnail;
+        for (const auto &output : _outputs) {
+            quality = std::max(quality, videoQualityForPixelCount(output.wants.max_pixel_count));
+        }
+        quality = std::max(std::min(quality, _requestedMaxQuality), _requestedMinQuality);
+        quality = std::min(quality, _overloadMaxQuality);
+
+        if (quality == _maxQuality) {
+            return false;
+        }
+        _maxQuality = quality;
+        return true;
+    }
+
 private:
     std::shared_ptr<Threads> _threads;
     uint32_t _mainVideoSsrc = 0;
@@ -1222,67 +2892,161 @@ private:
 
     VideoChannelDescription::Quality _requestedMinQuality = VideoChannelDescription::Quality::Thumbnail;
     VideoChannelDescription::Quality _requestedMaxQuality = VideoChannelDescription::Quality::Thumbnail;
+    VideoChannelDescription::Quality _maxQuality = VideoChannelDescription::Quality::Thumbnail;
+    VideoChannelDescription::Quality _overloadMaxQuality = VideoChannelDescription::Quality::Full;
+
+    rtc::scoped_refptr<IncomingVideoDecodeGate> _decodeGate;
+    std::vector<IncomingVideoOutput> _outputs;
 };
 
-class MissingSsrcPacketBuffer {
+class RequestedBroadcastPart {
 public:
-    MissingSsrcPacketBuffer(int limit) :
-    _limit(limit) {
+    int64_t timestamp = 0;
+    std::shared_ptr<BroadcastPartTask> task;
+
+    explicit RequestedBroadcastPart(int64_t timestamp_, std::shared_ptr<BroadcastPartTask> task_) :
+        timestamp(timestamp_), task(task_) {
     }
+};
+
+// Audio level of incoming packets of one SSRC, from the network thread.
+struct SsrcAudioLevelEvent {
+    uint32_t ssrc = 0;
+    uint8_t audioLevel = 0;
+    bool isSpeech = false;
+};
 
-    ~MissingSsrcPacketBuffer() {
+// Gathers the audio levels of incoming packets on the network thread and
+// hands them on every kFlushIntervalMs, keeping only the loudest level and
+// any speech flag per SSRC, instead of posting a task per packet.
+class SsrcAudioLevelAccumulator : public std::enable_shared_from_this<SsrcAudioLevelAccumulator> {
+public:
+    static constexpr int kFlushIntervalMs = 30;
+
+    SsrcAudioLevelAccumulator(rtc::Thread *thread, std::function<void(std::vector<SsrcAudioLevelEvent> &&)> onFlush) :
+    _thread(thread),
+    _onFlush(std::move(onFlush)) {
     }
 
-    void add(uint32_t ssrc, rtc::CopyOnWriteBuffer const &packet) {
-        if (_packets.size() == _limit) {
-            _packets.erase(_packets.begin());
+    void add(uint32_t ssrc, uint8_t audioLevel, bool isSpeech) {
+        assert(_thread->IsCurrent());
+
+        auto it = _levels.find(ssrc);
+        if (it == _levels.end()) {
+            SsrcAudioLevelEvent event;
+            event.ssrc = ssrc;
+            event.audioLevel = audioLevel;
+            event.isSpeech = isSpeech;
+            _levels.emplace(ssrc, event);
+        } else {
+            // RFC 6464 levels are -dBov: lower is louder.
+            it->second.audioLevel = std::min(it->second.audioLevel, audioLevel);
+            it->second.isSpeech = it->second.isSpeech || isSpeech;
+        }
+
+        if (!_isFlushScheduled) {
+            _isFlushScheduled = true;
+            const auto weak = std::weak_ptr<SsrcAudioLevelAccumulator>(shared_from_this());
+            _thread->PostDelayedTask(RTC_FROM_HERE, [weak]() {
+                if (const auto strong = weak.lock()) {
+                    strong->flush();
+                }
+            }, kFlushIntervalMs);
         }
-        _packets.push_back(std::make_pair(ssrc, packet));
     }
 
-    std::vector<rtc::CopyOnWriteBuffer> get(uint32_t ssrc) {
-        std::vector<rtc::CopyOnWriteBuffer> result;
-        for (auto it = _packets.begin(); it != _packets.end(); ) {
-            if (it->first == ssrc) {
-                result.push_back(it->second);
-                _packets.erase(it);
-            } else {
-                it++;
-            }
+private:
+    void flush() {
+        _isFlushScheduled = false;
+
+        std::vector<SsrcAudioLevelEvent> events;
+        events.reserve(_levels.size());
+        for (const auto &it : _levels) {
+            events.push_back(it.second);
         }
-        return result;
+        _levels.clear();
+        _onFlush(std::move(events));
     }
 
 private:
-    int _limit = 0;
-    std::vector<std::pair<uint32_t, rtc::CopyOnWriteBuffer>> _packets;
+    rtc::Thread *_thread = nullptr;
+    std::function<void(std::vector<SsrcAudioLevelEvent> &&)> _onFlush;
+    absl::flat_hash_map<uint32_t, SsrcAudioLevelEvent> _levels;
+    bool _isFlushScheduled = false;
+};
 
+// Level computed by an incoming channel's sink, from the audio thread. With
+// |isSpeechOnly| only its speech flag is used.
+struct SinkAudioLevelEvent {
+    ChannelId channelId;
+    AudioSinkImpl::Update update;
+    bool isSpeechOnly = false;
 };
 
-class RequestedBroadcastPart {
-public:
-    int64_t timestamp = 0;
-    std::shared_ptr<BroadcastPartTask> task;
+// 10 ms of every channel of a broadcast part, pointing into the part; valid
+// until the next frame is taken.
+struct DecodedBroadcastFrame {
+    int numSamples = 0;
+    const BroadcastPartDecoder::DecodedPart *part = nullptr;
+    size_t frame = 0;
+    int64_t partTimestampMilliseconds = 0;
 
-    explicit RequestedBroadcastPart(int64_t timestamp_, std::shared_ptr<BroadcastPartTask> task_) :
-        timestamp(timestamp_), task(task_) {
+    size_t channelCount() const {
+        return part->ssrcs.size();
     }
-};
 
-struct DecodedBroadcastPart {
-    struct DecodedBroadcastPartChannel {
-        uint32_t ssrc = 0;
-        std::vector<int16_t> pcmData;
-    };
+    uint32_t ssrc(size_t channel) const {
+        return part->ssrcs[channel];
+    }
 
-    DecodedBroadcastPart(int numSamples_, std::vector<DecodedBroadcastPartChannel> &&_channels) :
-        numSamples(numSamples_), channels(std::move(_channels)) {
+    const int16_t *pcm(size_t channel) const {
+        return part->plane(frame, channel);
     }
+};
 
-    int numSamples = 0;
-    std::vector<DecodedBroadcastPartChannel> channels;
+// A received broadcast part, in playback order. Its frames are filled in on
+// the media thread once a BroadcastPartDecoder thread has decoded it; calls
+// sharing a BroadcastPartCache key share them.
+struct PendingBroadcastPart {
+    int64_t timestampMilliseconds = 0;
+    bool isDecoded = false;
+    BroadcastPartCache::DecodedPart decoded;
+    size_t nextFrame = 0;
+
+    int remainingMilliseconds() const {
+        return decoded ? (int)(decoded->frameCount() - nextFrame) * 10 : 0;
+    }
 };
 
+// A broadcast video part: its timestamp and the endpoint it was fetched for.
+using BroadcastVideoPartId = std::pair<int64_t, std::string>;
+
+// Parts kept queued, decoding or decoded, ahead of playback; older ones are
+// dropped to make room.
+static constexpr size_t kMaxBroadcastPartsAhead = 6;
+
+// Slots of an absl flat hash table and their control bytes; what the values
+// point to isn't included.
+template <typename Table>
+size_t hashTableBytes(Table const &table) {
+    return table.capacity() * (sizeof(typename Table::value_type) + 1);
+}
+
+// Direct broadcast participants silent for this long lose their mixer source.
+static constexpr int64_t kDirectBroadcastChannelTimeoutMs = 2000;
+
+// How long the mode switched from is kept waiting for the new one to
+// connect, and the step of the crossfade between their audio.
+static constexpr int64_t kConnectionModeTransitionTimeoutMs = 3000;
+static constexpr int kBroadcastMixStepMs = 20;
+
+// Unknown SSRCs come in bursts, as when a big chat opens the floor, so they
+// are gathered for a moment and asked for together, with a bounded number
+// of requests to the app in flight.
+static constexpr int kUnknownSsrcsRequestDelayMs = 50;
+static constexpr size_t kMaxUnknownSsrcsPerRequest = 100;
+static constexpr size_t kMaxMediaChannelDescriptionsRequestsInFlight = 2;
+
 std::function<webrtc::VideoTrackSourceInterface*()> videoCaptureToGetVideoSource(std::shared_ptr<VideoCaptureInterface> videoCapture) {
   return [videoCapture]() {
     VideoCaptureInterfaceObject *videoCaptureImpl = GetVideoCaptureAssumingSameThread(videoCapture.get());
@@ -1294,51 +3058,131 @@ std::function<webrtc::VideoTrackSourceInterface*()> videoCaptureToGetVideoSource
 
 class GroupInstanceCustomInternal : public sigslot::has_slots<>, public std::enable_shared_from_this<GroupInstanceCustomInternal> {
 public:
-    GroupInstanceCustomInternal(GroupInstanceDescriptor &&descriptor, std::shared_ptr<Threads> threads) :
+    GroupInstanceCustomInternal(GroupInstanceDescriptor &&descriptor, std::shared_ptr<Threads> threads, std::shared_ptr<ExternalAudioSampleRing> externalAudioSamples, std::shared_ptr<PacketDeliveryCounters> packetDeliveryCounters, std::shared_ptr<StartupTimings> startupTimings, std::shared_ptr<BroadcastCounters> broadcastCounters, std::shared_ptr<GroupReconnectCounters> reconnectCounters, std::shared_ptr<NoiseSuppressionConfiguration> noiseSuppressionConfiguration, std::shared_ptr<CpuAccount> cpuAccount, rtc::scoped_refptr<GroupAudioMixer> audioMixer) :
     _threads(std::move(threads)),
+    _externalAudioSamples(std::move(externalAudioSamples)),
+    _packetDeliveryCounters(std::move(packetDeliveryCounters)),
+    _startupTimings(std::move(startupTimings)),
+    _broadcastCounters(std::move(broadcastCounters)),
+    _reconnectCounters(std::move(reconnectCounters)),
+    _noiseSuppressionConfiguration(std::move(noiseSuppressionConfiguration)),
+    _cpuAccount(std::move(cpuAccount)),
+    _audioMixer(std::move(audioMixer)),
+    _unresolvedPacketFilter(std::make_shared<UnresolvedPacketFilter>(_packetDeliveryCounters, _startupTimings, descriptor.disableIncomingChannels)),
+    _incomingVideoPacketTap(descriptor.onIncomingVideoPacket ? std::make_shared<IncomingVideoPacketTap>(descriptor.onIncomingVideoPacket) : nullptr),
+    _startCompleted(std::move(descriptor.startCompleted)),
     _networkStateUpdated(descriptor.networkStateUpdated),
     _audioLevelsUpdated(descriptor.audioLevelsUpdated),
+    _audioLevelsUpdateIntervalMs(std::max(10, descriptor.audioLevelsUpdateIntervalMs)),
+    _audioLevelsDeltaUpdates(descriptor.audioLevelsDeltaUpdates),
+    _statsUpdated(descriptor.statsUpdated),
+    _statsUpdateIntervalMs(std::max(100, descriptor.statsUpdateIntervalMs)),
+    _enableIncomingVad(descriptor.enableIncomingVad),
     _onAudioFrame(descriptor.onAudioFrame),
+    _onIncomingOpusPacket(descriptor.onIncomingOpusPacket),
     _requestMediaChannelDescriptions(descriptor.requestMediaChannelDescriptions),
     _requestBroadcastPart(descriptor.requestBroadcastPart),
+    _requestVideoBroadcastPart(descriptor.requestVideoBroadcastPart),
     _videoCapture(descriptor.videoCapture),
-    _videoCaptureSink(new VideoSinkImpl("VideoCapture")),
+    _videoCaptureSink(new VideoSinkImpl("VideoCapture", true)),
     _getVideoSource(descriptor.getVideoSource),
     _disableIncomingChannels(descriptor.disableIncomingChannels),
     _useDummyChannel(descriptor.useDummyChannel),
-    _outgoingAudioBitrateKbit(descriptor.outgoingAudioBitrateKbit),
+    _outgoingAudioProfile(isConstantBitrateAudio(descriptor)
+        ? makeConstantBitrateProfile(resolveAudioEncoderProfile(descriptor.outgoingAudioProfile, descriptor.outgoingAudioBitrateKbit))
+        : resolveAudioEncoderProfile(descriptor.outgoingAudioProfile, descriptor.outgoingAudioBitrateKbit)),
+    _constantBitrateAudio(isConstantBitrateAudio(descriptor)),
     _disableOutgoingAudioProcessing(descriptor.disableOutgoingAudioProcessing),
+    _outgoingVoiceGate(descriptor.outgoingVoiceGate),
+    _disablePlayoutMixing(descriptor.disablePlayoutMixing),
+    _directBroadcastAudio(descriptor.directBroadcastAudio),
+    _incomingAudioChannelPoolSize(std::max(0, descriptor.incomingAudioChannelPoolSize)),
+    _incomingAudioChannelIdleTimeoutMs(std::max(0, descriptor.incomingAudioChannelIdleTimeoutMs)),
+    _ssrcStateIdleTimeoutMs(std::max(0, descriptor.ssrcStateIdleTimeoutMs)),
+    _ssrcStateExpiry(_ssrcStateIdleTimeoutMs, kSsrcStateExpiryTickMs),
+    _maxDecodedIncomingAudioStreams(std::max(1, descriptor.maxDecodedIncomingAudioStreams)),
+    _parallelAudioDecodingDeadlineUs(std::max(0, descriptor.parallelAudioDecodingDeadlineUs)),
+    _incomingAudioProfile(descriptor.incomingAudioProfile),
     _minOutgoingVideoBitrateKbit(descriptor.minOutgoingVideoBitrateKbit),
-    _videoContentType(descriptor.videoContentType),
+    _videoContentType(descriptor.audioOnly ? VideoContentType::None : descriptor.videoContentType),
+    _audioOnly(descriptor.audioOnly),
     _videoCodecPreferences(std::move(descriptor.videoCodecPreferences)),
+    _videoEncoderConfig(descriptor.videoEncoderConfig),
+    _videoDecoderConfig(descriptor.videoDecoderConfig),
     _eventLog(std::make_unique<webrtc::RtcEventLogNull>()),
-    _taskQueueFactory(webrtc::CreateDefaultTaskQueueFactory()),
+    _engineContext(descriptor.engineContext),
+    _certificatePool(descriptor.certificatePool),
+    _useBatchedUdpSockets(descriptor.useBatchedUdpSockets),
+    _sharedUdpSockets(descriptor.sharedUdpSockets),
+    _sharedAudioEncoder(descriptor.sharedAudioEncoder),
+    _sharedAudioDecoder(descriptor.sharedAudioDecoder),
+    _outgoingAudioBridge(descriptor.outgoingAudioBridge),
+    _outgoingOpusSource(descriptor.outgoingOpusSource),
+    _latencyTrace(descriptor.latencyTrace),
+    _taskQueueFactory(descriptor.engineContext ? nullptr : webrtc::CreateDefaultTaskQueueFactory()),
+    _fieldTrials(descriptor.fieldTrials),
     _createAudioDeviceModule(descriptor.createAudioDeviceModule),
     _initialInputDeviceId(std::move(descriptor.initialInputDeviceId)),
     _initialOutputDeviceId(std::move(descriptor.initialOutputDeviceId)),
     _missingPacketBuffer(50) {
         assert(_threads->getMediaThread()->IsCurrent());
 
-        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this] {
-            _workerThreadSafery = webrtc::PendingTaskSafetyFlag::Create();
-        });
-        _threads->getNetworkThread()->Invoke<void>(RTC_FROM_HERE, [this] {
-            _networkThreadSafery = webrtc::PendingTaskSafetyFlag::Create();
-        });
+        // Both flags bind to their thread on first use, so creating them
+        // here doesn't cost a blocking hop to each thread.
+        _workerThreadSafery = webrtc::PendingTaskSafetyFlag::CreateDetached();
+        _networkThreadSafery = webrtc::PendingTaskSafetyFlag::CreateDetached();
 
         if (_videoCapture) {
           assert(!_getVideoSource);
           _getVideoSource = videoCaptureToGetVideoSource(std::move(descriptor.videoCapture));
         }
+        _migratedOutgoingAudioSsrc = descriptor.outgoingAudioSsrc & 0x7fffffffU;
+        _nextBroadcastTimestampMilliseconds = std::max<int64_t>(0, descriptor.initialBroadcastTimestampMilliseconds);
         generateSsrcs();
 
-        _noiseSuppressionConfiguration = std::make_shared<NoiseSuppressionConfiguration>(descriptor.initialEnableNoiseSuppression);
+        _broadcastPrefetchDepth = std::max(1, descriptor.broadcastPrefetchDepth);
+        _broadcastPartCacheKey = descriptor.broadcastPartCacheKey;
+        _broadcastDecodedSsrcs = descriptor.broadcastDecodedSsrcs;
+        _connectionModeCrossfadeMs = std::max(0, descriptor.connectionModeCrossfadeMs);
 
-        _externalAudioRecorder.reset(new ExternalAudioRecorder(&_externalAudioSamples, &_externalAudioSamplesMutex));
+        _externalAudioRecorder.reset(new ExternalAudioRecorder(_externalAudioSamples));
+
+        if (_engineContext) {
+            _engineContext->attachInstance();
+        }
     }
 
     ~GroupInstanceCustomInternal() {
+        // A shared broadcast part fetch may otherwise go on to call back
+        // into a |_requestBroadcastPart| that is gone.
+        for (auto &it : _requestedBroadcastParts) {
+            if (it.second.task) {
+                it.second.task->cancel();
+            }
+        }
+        for (auto &it : _requestedBroadcastVideoParts) {
+            if (it.second) {
+                it.second->cancel();
+            }
+        }
+
+        // Drops startup steps and packet deliveries still queued on the
+        // worker and network threads; they capture |this|.
+        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
+            _workerThreadSafery->SetNotAlive();
+        });
+        _threads->getNetworkThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
+            _networkThreadSafery->SetNotAlive();
+        });
+
+        const auto &missingPacketStats = _missingPacketBuffer.stats();
+        if (missingPacketStats.evictedPackets != 0) {
+            RTC_LOG(LS_INFO) << "MissingSsrcPacketBuffer: evicted " << missingPacketStats.evictedPackets << " packets, delivered " << missingPacketStats.deliveredPackets << ", " << missingPacketStats.bufferedPackets << " still buffered";
+        }
+
+        _directBroadcastChannels.clear();
         _incomingAudioChannels.clear();
+        _incomingAudioChannelPool.clear();
         _incomingVideoChannels.clear();
         _serverBandwidthProbingVideoSsrc.reset();
 
@@ -1346,8 +3190,10 @@ public:
         destroyOutgoingVideoChannel();
 
         _threads->getNetworkThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
-            _rtpTransport->SignalSentPacket.disconnect(this);
-            _rtpTransport->SignalRtcpPacketReceived.disconnect(this);
+            if (_rtpTransport) {
+                _rtpTransport->SignalSentPacket.disconnect(this);
+                _rtpTransport->SignalRtcpPacketReceived.disconnect(this);
+            }
         });
 
         _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
@@ -1358,22 +3204,47 @@ public:
             }
             _call.reset();
         });
+
+        if (_engineContext) {
+            _engineContext->detachInstance();
+        }
     }
 
     void start() {
         const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
 
-        webrtc::field_trial::InitFieldTrialsFromString(
-            "WebRTC-Audio-Allocation/min:32kbps,max:2048kbps/"
-            "WebRTC-Audio-OpusMinPacketLossRate/Enabled-1/"
-            "WebRTC-TaskQueuePacer/Enabled/"
-            "WebRTC-VP8ConferenceTemporalLayers/1/"
-//            "WebRTC-Audio-MinimizeResamplingOnMobile/Enabled/"
-            //"WebRTC-MutedStateKillSwitch/Enabled/"
-            //"WebRTC-VP8IosMaxNumberOfThread/max_thread:1/"
-        );
+        GroupFieldTrials::initDefaults();
 
-        _networkManager.reset(new ThreadLocalObject<GroupNetworkManager>(_threads->getNetworkThread(), [weak, threads = _threads] () mutable {
+        _sinkAudioLevelHops = ThreadHopQueue<SinkAudioLevelEvent>::Create(_threads->getMediaThread(), [weak](SinkAudioLevelEvent &event) {
+            const auto strong = weak.lock();
+            if (!strong) {
+                return;
+            }
+            if (event.isSpeechOnly) {
+                strong->updateSsrcVoiceActivity(event.channelId.networkSsrc, event.update.hasSpeech);
+            } else {
+                InternalGroupLevelValue updated;
+                updated.value.level = event.update.level;
+                updated.value.voice = event.update.hasSpeech;
+                updated.timestamp = rtc::TimeMillis();
+                strong->_audioLevels[event.channelId] = std::move(updated);
+            }
+        });
+
+        _networkManager.reset(new ThreadLocalObject<GroupNetworkManager>(_threads->getNetworkThread(), [weak, threads = _threads, certificatePool = _certificatePool, unresolvedPacketFilter = _unresolvedPacketFilter, onIncomingOpusPacket = _onIncomingOpusPacket, incomingVideoPacketTap = _incomingVideoPacketTap, reconnectCounters = _reconnectCounters, useBatchedUdpSockets = _useBatchedUdpSockets, sharedUdpSockets = _sharedUdpSockets, cpuAccount = _cpuAccount] () mutable {
+            // For the shared sockets' reads, which no task of the call starts.
+            CpuAccountScope accountScope(cpuAccount);
+            auto audioLevels = std::make_shared<SsrcAudioLevelAccumulator>(threads->getNetworkThread(), [weak, threads](std::vector<SsrcAudioLevelEvent> &&events) {
+                threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, events = std::move(events)]() {
+                    const auto strong = weak.lock();
+                    if (!strong) {
+                        return;
+                    }
+                    for (const auto &event : events) {
+                        strong->updateSsrcAudioLevel(event.ssrc, event.audioLevel, event.isSpeech);
+                    }
+                });
+            });
             return new GroupNetworkManager(
                 [=](const GroupNetworkManager::State &state) {
                     threads->getMediaThread()->PostTask(RTC_FROM_HERE, [=] {
@@ -1384,13 +3255,19 @@ public:
                         strong->setIsRtcConnected(state.isReadyToSendData);
                     });
                 },
-                [=](rtc::CopyOnWriteBuffer const &message, bool isUnresolved) {
-                    if (!isUnresolved) {
+                [=](rtc::CopyOnWriteBuffer const &message, GroupRtpPacketHeader const &header, bool isUnresolved) {
+                    if (onIncomingOpusPacket) {
+                        unresolvedPacketFilter->tapOpusPacket(message, header, onIncomingOpusPacket);
+                    }
+                    if (incomingVideoPacketTap) {
+                        incomingVideoPacketTap->tap(message, header);
+                    }
+                    if (!isUnresolved || !unresolvedPacketFilter->shouldDeliver(message, header)) {
                         return;
                     }
-                    threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, message, isUnresolved]() mutable {
+                    threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, message, header, isUnresolved]() mutable {
                         if (const auto strong = weak.lock()) {
-                            strong->receivePacket(message, isUnresolved);
+                            strong->receivePacket(message, header, isUnresolved);
                         }
                     });
                 },
@@ -1409,12 +3286,8 @@ public:
                     });
                 },
                 [=](uint32_t ssrc, uint8_t audioLevel, bool isSpeech) {
-                    threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, ssrc, audioLevel, isSpeech]() {
-                        if (const auto strong = weak.lock()) {
-                            strong->updateSsrcAudioLevel(ssrc, audioLevel, isSpeech);
-                        }
-                    });
-                }, threads);
+                    audioLevels->add(ssrc, audioLevel, isSpeech);
+                }, threads, certificatePool, useBatchedUdpSockets, sharedUdpSockets, reconnectCounters);
         }));
 
     #if USE_RNNOISE
@@ -1423,95 +3296,239 @@ public:
         if (_videoContentType != VideoContentType::Screencast) {
             PlatformInterface::SharedInstance()->configurePlatformAudio();
 
-    #if USE_RNNOISE
-            audioProcessor = std::make_unique<AudioCapturePostProcessor>([weak, threads = _threads](GroupLevelValue const &level) {
-                threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, level](){
-                    auto strong = weak.lock();
-                    if (!strong) {
-                        return;
-                    }
-                    strong->_myAudioLevel = level;
-                });
-            }, _noiseSuppressionConfiguration, &_externalAudioSamples, &_externalAudioSamplesMutex);
+    #if USE_RNNOISE
+            if (!isOutgoingAudioProcessingBypassed()) {
+                audioProcessor = std::make_unique<AudioCapturePostProcessor>(makeMyAudioLevelUpdater(), _noiseSuppressionConfiguration, _externalAudioSamples);
+            }
     #endif
         }
 
     #if not USE_RNNOISE
-          auto analyzer = new AudioCaptureAnalyzer([weak, threads = _threads](GroupLevelValue const &level) {
-            threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, level](){
-              auto strong = weak.lock();
-              if (!strong) {
-                return;
-              }
-              strong->_myAudioLevel = level;
-            });
-          });
+          // Unprocessed input gets no AudioProcessing at all, unless it
+          // starts with noise suppression on: then the suppressor is all
+          // the AudioProcessing does, the engine's own modules stay off.
+          AudioCaptureAnalyzer *analyzer = nullptr;
+          std::unique_ptr<NoiseSuppressionPostProcessor> audioProcessor = nullptr;
+          if (!isOutgoingAudioProcessingBypassed()) {
+              analyzer = new AudioCaptureAnalyzer(makeMyAudioLevelUpdater());
+          }
+          if (_videoContentType != VideoContentType::Screencast && (analyzer || _noiseSuppressionConfiguration->isEnabled())) {
+              audioProcessor = std::make_unique<NoiseSuppressionPostProcessor>(_noiseSuppressionConfiguration);
+          }
     #endif
+        if (audioProcessor) {
+            _noiseSuppressionConfiguration->setIsAvailable();
+        }
 
-      _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this
+      // The media engine and call are built on the worker thread while the
+      // network thread hooks up the RTP transport; the rest of the startup
+      // runs in finishStart() once both are done. emitJoinPayload() only
+      // needs the network manager, so it doesn't wait for either.
+      _pendingStartSteps = 2;
+
+      _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafery, [this, weak, threads = _threads
     #if not USE_RNNOISE
           , analyzer
     #endif
-    #if USE_RNNOISE
           , audioProcessor = std::move(audioProcessor)
-    #endif
           ]() mutable {
-            cricket::MediaEngineDependencies mediaDeps;
-            mediaDeps.task_queue_factory = _taskQueueFactory.get();
+    #if not USE_RNNOISE
+            bool isCreated = createMediaEngineAndCall(analyzer, std::move(audioProcessor));
+    #else
+            bool isCreated = createMediaEngineAndCall(std::move(audioProcessor));
+    #endif
+            threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, isCreated]() {
+                const auto strong = weak.lock();
+                if (!strong) {
+                    return;
+                }
+                if (!isCreated) {
+                    RTC_LOG(LS_ERROR) << "GroupInstanceCustomImpl: could not create the audio device module, the call will not start.";
+                    return;
+                }
+                strong->_startupTimings->onEngineReady();
+                strong->completeStartStep();
+            });
+      }));
+
+      _threads->getNetworkThread()->PostTask(ToQueuedTask(_networkThreadSafery, [this, weak, threads = _threads]() {
+            _rtpTransport = _networkManager->getSyncAssumingSameThread()->getRtpTransport();
+            if (_latencyTrace) {
+                _networkManager->getSyncAssumingSameThread()->setLatencyTrace(_latencyTrace);
+            }
+            _rtpTransport->SignalSentPacket.connect(this, &GroupInstanceCustomInternal::OnSentPacket_w);
+            _rtpTransport->SignalRtcpPacketReceived.connect(this, &GroupInstanceCustomInternal::OnRtcpPacketReceived_n);
+
+            threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak]() {
+                if (const auto strong = weak.lock()) {
+                    strong->completeStartStep();
+                }
+            });
+      }));
+
+        _uniqueRandomIdGenerator.reset(new rtc::UniqueRandomIdGenerator());
+    }
+
+    // Outgoing audio goes to the encoder as captured: no AEC, NS or AGC, and
+    // no AudioProcessing pass over it at all.
+    bool isOutgoingAudioProcessingBypassed() const {
+        return _disableOutgoingAudioProcessing || _sharedAudioEncoder != nullptr || _outgoingAudioBridge != nullptr || _outgoingOpusSource != nullptr;
+    }
+
+    // Sets |_myAudioLevel| from any thread.
+    std::function<void(GroupLevelValue const &)> makeMyAudioLevelUpdater() {
+        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
+        return [weak, threads = _threads](GroupLevelValue const &level) {
+            threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, level](){
+                auto strong = weak.lock();
+                if (!strong) {
+                    return;
+                }
+                strong->_myAudioLevel = level;
+            });
+        };
+    }
+
+    // Worker thread.
+    #if not USE_RNNOISE
+    bool createMediaEngineAndCall(AudioCaptureAnalyzer *analyzer, std::unique_ptr<webrtc::CustomProcessing> audioProcessor) {
+    #else
+    bool createMediaEngineAndCall(std::unique_ptr<webrtc::CustomProcessing> audioProcessor) {
+    #endif
+        cricket::MediaEngineDependencies mediaDeps;
+        mediaDeps.task_queue_factory = taskQueueFactory();
+        mediaDeps.trials = &_fieldTrials;
+        if (_engineContext) {
+            mediaDeps.audio_encoder_factory = _engineContext->audioEncoderFactory();
+            mediaDeps.audio_decoder_factory = _engineContext->audioDecoderFactory();
+        } else {
             mediaDeps.audio_encoder_factory = webrtc::CreateAudioEncoderFactory<webrtc::AudioEncoderOpus, webrtc::AudioEncoderL16>();
             mediaDeps.audio_decoder_factory = webrtc::CreateAudioDecoderFactory<webrtc::AudioDecoderOpus, webrtc::AudioDecoderL16>();
-
-            mediaDeps.video_encoder_factory = PlatformInterface::SharedInstance()->makeVideoEncoderFactory();
-            mediaDeps.video_decoder_factory = PlatformInterface::SharedInstance()->makeVideoDecoderFactory();
+        }
+        auto videoEncoderFactory = std::make_unique<LazyVideoEncoderFactory>([engineContext = _engineContext, config = _videoEncoderConfig]() {
+            auto factory = engineContext ? engineContext->createVideoEncoderFactory() : PlatformInterface::SharedInstance()->makeVideoEncoderFactory();
+            return makeGroupVideoEncoderFactory(std::move(factory), config);
+        });
+        _videoEncoderFactory = videoEncoderFactory.get();
+        mediaDeps.video_encoder_factory = std::move(videoEncoderFactory);
+        mediaDeps.video_decoder_factory = std::make_unique<LazyVideoDecoderFactory>([engineContext = _engineContext, config = _videoDecoderConfig]() {
+            auto factory = engineContext ? engineContext->createVideoDecoderFactory() : PlatformInterface::SharedInstance()->makeVideoDecoderFactory();
+            return makeGroupVideoDecoderFactory(std::move(factory), config);
+        });
 
     #if not USE_RNNOISE
+        if (analyzer || audioProcessor) {
             webrtc::AudioProcessingBuilder builder;
-            builder.SetCaptureAnalyzer(std::unique_ptr<AudioCaptureAnalyzer>(analyzer));
+            if (analyzer) {
+                builder.SetCaptureAnalyzer(std::unique_ptr<AudioCaptureAnalyzer>(analyzer));
+            }
+            builder.SetCapturePostProcessing(std::move(audioProcessor));
+            mediaDeps.audio_processing = builder.Create();
+        }
+    #else
+        if (audioProcessor) {
+            webrtc::AudioProcessingBuilder builder;
+            builder.SetCapturePostProcessing(std::move(audioProcessor));
             mediaDeps.audio_processing = builder.Create();
+        }
     #endif
 
-            _audioDeviceModule = createAudioDeviceModule();
-            if (!_audioDeviceModule) {
-                return;
+        _audioDeviceModule = createAudioDeviceModule();
+        if (!_audioDeviceModule) {
+            return false;
+        }
+        mediaDeps.adm = _audioDeviceModule;
+        if (isOutgoingAudioProcessingBypassed() && _audioLevelsUpdated) {
+            // Only levels are asked for, so they are only measured then.
+            mediaDeps.adm = new rtc::RefCountedObject<CaptureLevelAudioDeviceModule>(_audioDeviceModule, makeMyAudioLevelUpdater());
+        }
+        if (_outgoingVoiceGate.enabled) {
+            // Outside the level measurement, which keeps seeing everything.
+            mediaDeps.adm = new rtc::RefCountedObject<VoiceGateAudioDeviceModule>(mediaDeps.adm, _outgoingVoiceGate, makeMyAudioLevelUpdater());
+        }
+        if (!_useDummyChannel) {
+            mediaDeps.adm = new rtc::RefCountedObject<PersistentPlayoutAudioDeviceModule>(mediaDeps.adm);
+        }
+        if (_disablePlayoutMixing) {
+            mediaDeps.audio_mixer = new rtc::RefCountedObject<DecodeOnlyAudioMixer>(_onAudioFrame != nullptr || _enableIncomingVad);
+        } else if (_directBroadcastAudio) {
+            // Kept, so direct broadcast sources can be added to it.
+            if (_audioMixer) {
+                _playoutMixer = _audioMixer;
+            } else {
+                _playoutMixer = webrtc::AudioMixerImpl::Create();
             }
-            mediaDeps.adm = _audioDeviceModule;
-
-            _availableVideoFormats = filterSupportedVideoFormats(mediaDeps.video_encoder_factory->GetSupportedFormats());
+            mediaDeps.audio_mixer = _playoutMixer;
+        } else if (_audioMixer) {
+            mediaDeps.audio_mixer = _audioMixer;
+        } else {
+            mediaDeps.audio_mixer = webrtc::AudioMixerImpl::Create();
+        }
+        mediaDeps.audio_mixer = new rtc::RefCountedObject<ExpandCountingAudioMixer>(mediaDeps.audio_mixer);
+        if (_parallelAudioDecodingDeadlineUs > 0) {
+            // Outside the expansion counting, so that it still sees the
+            // frames on the mixing thread.
+            mediaDeps.audio_mixer = new rtc::RefCountedObject<ParallelDecodingAudioMixer>(mediaDeps.audio_mixer, _parallelAudioDecodingDeadlineUs);
+        }
 
-            std::unique_ptr<cricket::MediaEngineInterface> mediaEngine = cricket::CreateMediaEngine(std::move(mediaDeps));
+        mediaDeps.audio_encoder_factory = makeGroupAudioEncoderFactory(std::move(mediaDeps.audio_encoder_factory), _outgoingAudioProfile);
+        if (_sharedAudioEncoder) {
+            mediaDeps.audio_encoder_factory = _sharedAudioEncoder->wrapEncoderFactory(std::move(mediaDeps.audio_encoder_factory));
+        }
+        if (_sharedAudioDecoder) {
+            mediaDeps.audio_decoder_factory = _sharedAudioDecoder->wrapDecoderFactory(std::move(mediaDeps.audio_decoder_factory));
+        }
+        if (_outgoingAudioBridge) {
+            mediaDeps.audio_encoder_factory = _outgoingAudioBridge->wrapEncoderFactory(std::move(mediaDeps.audio_encoder_factory));
+        }
+        if (_outgoingOpusSource) {
+            mediaDeps.audio_encoder_factory = makeOpusPacketSourceEncoderFactory(std::move(mediaDeps.audio_encoder_factory), _outgoingOpusSource);
+        }
+        std::unique_ptr<cricket::MediaEngineInterface> mediaEngine = cricket::CreateMediaEngine(std::move(mediaDeps));
 
-            _channelManager = cricket::ChannelManager::Create(
-                std::move(mediaEngine),
-                std::make_unique<cricket::RtpDataEngine>(),
-                true,
-                _threads->getWorkerThread(),
-                _threads->getNetworkThread()
-            );
-        });
+        _channelManager = cricket::ChannelManager::Create(
+            std::move(mediaEngine),
+            std::make_unique<cricket::RtpDataEngine>(),
+            true,
+            _threads->getWorkerThread(),
+            _threads->getNetworkThread()
+        );
 
-        setAudioInputDevice(_initialInputDeviceId);
-        setAudioOutputDevice(_initialOutputDeviceId);
+#ifndef WEBRTC_IOS
+        SetAudioInputDeviceById(_audioDeviceModule.get(), _initialInputDeviceId);
+        SetAudioOutputDeviceById(_audioDeviceModule.get(), _initialOutputDeviceId);
+#endif // WEBRTC_IOS
 
-        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
-            webrtc::Call::Config callConfig(_eventLog.get(), _threads->getNetworkThread());
-            callConfig.task_queue_factory = _taskQueueFactory.get();
-            callConfig.trials = &_fieldTrials;
-            callConfig.audio_state = _channelManager->media_engine()->voice().GetAudioState();
-            _call.reset(webrtc::Call::Create(callConfig, _threads->getSharedModuleThread()));
-        });
+        webrtc::Call::Config callConfig(_eventLog.get(), _threads->getNetworkThread());
+        callConfig.task_queue_factory = taskQueueFactory();
+        callConfig.trials = &_fieldTrials;
+        callConfig.audio_state = _channelManager->media_engine()->voice().GetAudioState();
+        _netEqFactory = std::make_unique<GroupNetEqFactory>(_incomingAudioProfile.maxDelayMs);
+        callConfig.neteq_factory = _netEqFactory.get();
+        _call.reset(webrtc::Call::Create(callConfig, _threads->getSharedModuleThread()));
 
-        _uniqueRandomIdGenerator.reset(new rtc::UniqueRandomIdGenerator());
+        return true;
+    }
 
-        _threads->getNetworkThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
-            _rtpTransport = _networkManager->getSyncAssumingSameThread()->getRtpTransport();
-            _rtpTransport->SignalSentPacket.connect(this, &GroupInstanceCustomInternal::OnSentPacket_w);
-            _rtpTransport->SignalRtcpPacketReceived.connect(this, &GroupInstanceCustomInternal::OnRtcpPacketReceived_n);
-        });
+    void completeStartStep() {
+        assert(_pendingStartSteps > 0);
+        _pendingStartSteps--;
+        if (_pendingStartSteps == 0) {
+            finishStart();
+        }
+    }
 
-        _videoBitrateAllocatorFactory = webrtc::CreateBuiltinVideoBitrateAllocatorFactory();
+    void finishStart() {
+        _isMediaEngineReady = true;
+        if (_isVideoRequested || _videoContentType != VideoContentType::None) {
+            ensureVideoInitialized();
+        }
 
         if (_audioLevelsUpdated) {
-            beginLevelsTimer(100);
+            beginLevelsTimer(_audioLevelsUpdateIntervalMs);
+        }
+        if (_statsUpdated) {
+            beginStatsTimer(_statsUpdateIntervalMs);
         }
 
         if (_getVideoSource) {
@@ -1522,6 +3539,10 @@ public:
             addIncomingAudioChannel(ChannelId(1), true);
         }
 
+        if (_videoContentType != VideoContentType::Screencast) {
+            refillIncomingAudioChannelPool();
+        }
+
         if (_videoContentType == VideoContentType::Screencast) {
             setIsMuted(false);
         }
@@ -1532,9 +3553,64 @@ public:
 
         beginNetworkStatusTimer(0);
         //beginAudioChannelCleanupTimer(0);
+        if (_ssrcStateIdleTimeoutMs > 0) {
+            beginSsrcStateExpiryTimer(kSsrcStateExpiryTickMs);
+        }
 
         adjustBitratePreferences(true);
 
+        beginOverloadTimer(0);
+
+        _isStarted = true;
+        RTC_LOG(LS_INFO) << "GroupInstanceCustomImpl: started in " << _startupTimings->engineReadyMs() << " ms, running " << _tasksWhenStarted.size() << " queued calls";
+
+        auto tasks = std::move(_tasksWhenStarted);
+        _tasksWhenStarted.clear();
+        for (auto &task : tasks) {
+            task();
+        }
+
+        if (_startCompleted) {
+            _startCompleted();
+        }
+    }
+
+    // Runs |task| now if the instance has started, otherwise right after
+    // finishStart(), in the order the tasks were queued.
+    void runWhenStarted(std::function<void()> &&task) {
+        if (_isStarted) {
+            task();
+        } else {
+            _tasksWhenStarted.push_back(std::move(task));
+        }
+    }
+
+    // Video is set up once something first asks for it, as most calls are
+    // audio-only. Until the media engine is ready, it is only noted.
+    void ensureVideoInitialized() {
+        if (_isVideoInitialized || _audioOnly) {
+            return;
+        }
+        if (!_isMediaEngineReady) {
+            _isVideoRequested = true;
+            return;
+        }
+        _isVideoInitialized = true;
+
+        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
+            _videoFormatTables = getVideoFormatTables(_videoEncoderFactory->GetSupportedFormats());
+        });
+        if (_incomingVideoPacketTap) {
+            _incomingVideoPacketTap->setPayloadTypes(_videoFormatTables->payloadTypes);
+        }
+        _videoBitrateAllocatorFactory = webrtc::CreateBuiltinVideoBitrateAllocatorFactory();
+
+        // What a join response set up without the formats.
+        configureVideoParams();
+        if (!_serverBandwidthProbingVideoSsrc && _sharedVideoInformation && _sharedVideoInformation->serverVideoBandwidthProbingSsrc) {
+            setServerBandwidthProbingChannelSsrc(_sharedVideoInformation->serverVideoBandwidthProbingSsrc);
+        }
+
         beginRemoteConstraintsUpdateTimer(5000);
     }
 
@@ -1556,6 +3632,7 @@ public:
             || _videoContentType == VideoContentType::None) {
             return;
         }
+        ensureVideoInitialized();
         configureVideoParams();
 
         if (!_selectedPayloadType) {
@@ -1643,24 +3720,24 @@ public:
         }
 
         if (_videoContentType == VideoContentType::Screencast) {
-            _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
-                webrtc::RtpParameters rtpParameters = _outgoingVideoChannel->media_channel()->GetRtpSendParameters(_outgoingVideoSsrcs.simulcastLayers[0].ssrc);
+            _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafery, [channel = _outgoingVideoChannel, ssrc = _outgoingVideoSsrcs.simulcastLayers[0].ssrc, outgoingVideoConstraint = _outgoingVideoConstraint]() {
+                webrtc::RtpParameters rtpParameters = channel->media_channel()->GetRtpSendParameters(ssrc);
                 if (rtpParameters.encodings.size() == 3) {
                     for (int i = 0; i < (int)rtpParameters.encodings.size(); i++) {
                         if (i == 0) {
                             rtpParameters.encodings[i].min_bitrate_bps = 50000;
                             rtpParameters.encodings[i].max_bitrate_bps = 100000;
                             rtpParameters.encodings[i].scale_resolution_down_by = 4.0;
-                            rtpParameters.encodings[i].active = _outgoingVideoConstraint >= 180;
+                            rtpParameters.encodings[i].active = outgoingVideoConstraint >= 180;
                         } else if (i == 1) {
                             rtpParameters.encodings[i].max_bitrate_bps = 150000;
                             rtpParameters.encodings[i].max_bitrate_bps = 200000;
                             rtpParameters.encodings[i].scale_resolution_down_by = 2.0;
-                            rtpParameters.encodings[i].active = _outgoingVideoConstraint >= 360;
+                            rtpParameters.encodings[i].active = outgoingVideoConstraint >= 360;
                         } else if (i == 2) {
                             rtpParameters.encodings[i].min_bitrate_bps = 300000;
                             rtpParameters.encodings[i].max_bitrate_bps = 800000 + 100000;
-                            rtpParameters.encodings[i].active = _outgoingVideoConstraint >= 720;
+                            rtpParameters.encodings[i].active = outgoingVideoConstraint >= 720;
                         }
                     }
                 } else if (rtpParameters.encodings.size() == 2) {
@@ -1678,27 +3755,27 @@ public:
                     rtpParameters.encodings[0].max_bitrate_bps = (800000 + 100000) * 2;
                 }
 
-                _outgoingVideoChannel->media_channel()->SetRtpSendParameters(_outgoingVideoSsrcs.simulcastLayers[0].ssrc, rtpParameters);
-            });
+                channel->media_channel()->SetRtpSendParameters(ssrc, rtpParameters);
+            }));
         } else {
-            _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
-                webrtc::RtpParameters rtpParameters = _outgoingVideoChannel->media_channel()->GetRtpSendParameters(_outgoingVideoSsrcs.simulcastLayers[0].ssrc);
+            _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafery, [channel = _outgoingVideoChannel, ssrc = _outgoingVideoSsrcs.simulcastLayers[0].ssrc, outgoingVideoConstraint = _outgoingVideoConstraint]() {
+                webrtc::RtpParameters rtpParameters = channel->media_channel()->GetRtpSendParameters(ssrc);
                 if (rtpParameters.encodings.size() == 3) {
                     for (int i = 0; i < (int)rtpParameters.encodings.size(); i++) {
                         if (i == 0) {
                             rtpParameters.encodings[i].min_bitrate_bps = 50000;
                             rtpParameters.encodings[i].max_bitrate_bps = 60000;
                             rtpParameters.encodings[i].scale_resolution_down_by = 4.0;
-                            rtpParameters.encodings[i].active = _outgoingVideoConstraint >= 180;
+                            rtpParameters.encodings[i].active = outgoingVideoConstraint >= 180;
                         } else if (i == 1) {
                             rtpParameters.encodings[i].max_bitrate_bps = 100000;
                             rtpParameters.encodings[i].max_bitrate_bps = 110000;
                             rtpParameters.encodings[i].scale_resolution_down_by = 2.0;
-                            rtpParameters.encodings[i].active = _outgoingVideoConstraint >= 360;
+                            rtpParameters.encodings[i].active = outgoingVideoConstraint >= 360;
                         } else if (i == 2) {
                             rtpParameters.encodings[i].min_bitrate_bps = 300000;
                             rtpParameters.encodings[i].max_bitrate_bps = 800000 + 100000;
-                            rtpParameters.encodings[i].active = _outgoingVideoConstraint >= 720;
+                            rtpParameters.encodings[i].active = outgoingVideoConstraint >= 720;
                         }
                     }
                 } else if (rtpParameters.encodings.size() == 2) {
@@ -1716,8 +3793,8 @@ public:
                     rtpParameters.encodings[0].max_bitrate_bps = (800000 + 100000) * 2;
                 }
 
-                _outgoingVideoChannel->media_channel()->SetRtpSendParameters(_outgoingVideoSsrcs.simulcastLayers[0].ssrc, rtpParameters);
-            });
+                channel->media_channel()->SetRtpSendParameters(ssrc, rtpParameters);
+            }));
         }
     }
 
@@ -1758,7 +3835,7 @@ public:
         }
 
         cricket::AudioOptions audioOptions;
-        if (_disableOutgoingAudioProcessing || _videoContentType == VideoContentType::Screencast) {
+        if (isOutgoingAudioProcessingBypassed() || _videoContentType == VideoContentType::Screencast) {
             audioOptions.echo_cancellation = false;
             audioOptions.noise_suppression = false;
             audioOptions.auto_gain_control = false;
@@ -1779,26 +3856,35 @@ public:
 
         _outgoingAudioChannel = _channelManager->CreateVoiceChannel(_call.get(), cricket::MediaConfig(), _rtpTransport, _threads->getWorkerThread(), "0", false, GroupNetworkManager::getDefaulCryptoOptions(), _uniqueRandomIdGenerator.get(), audioOptions);
 
-        const uint8_t opusMinBitrateKbps = _outgoingAudioBitrateKbit;
-        const uint8_t opusMaxBitrateKbps = _outgoingAudioBitrateKbit;
-        const uint8_t opusStartBitrateKbps = _outgoingAudioBitrateKbit;
-        const uint8_t opusPTimeMs = 120;
-
-        cricket::AudioCodec opusCodec(111, "opus", 48000, _outgoingAudioBitrateKbit, 2);
-        opusCodec.AddFeedbackParam(cricket::FeedbackParam(cricket::kRtcpFbParamTransportCc));
-        opusCodec.SetParam(cricket::kCodecParamMinBitrate, opusMinBitrateKbps);
-        opusCodec.SetParam(cricket::kCodecParamStartBitrate, opusStartBitrateKbps);
-        opusCodec.SetParam(cricket::kCodecParamMaxBitrate, opusMaxBitrateKbps);
-        opusCodec.SetParam(cricket::kCodecParamUseInbandFec, 0);
-        opusCodec.SetParam(cricket::kCodecParamMaxAverageBitrate, 510000);
-        opusCodec.SetParam(cricket::kCodecParamUseDtx, 0);
+        const auto &profile = _outgoingAudioProfile;
+
+        // The bitrate range is set on the encoding below; a codec bitrate
+        // would pin the stream to it.
+        cricket::AudioCodec opusCodec(111, "opus", 48000, 0, 2);
+        if (!_constantBitrateAudio) {
+            opusCodec.AddFeedbackParam(cricket::FeedbackParam(cricket::kRtcpFbParamTransportCc));
+        }
+        opusCodec.SetParam(cricket::kCodecParamMinBitrate, profile.minBitrateKbit);
+        opusCodec.SetParam(cricket::kCodecParamStartBitrate, profile.startBitrateKbit);
+        opusCodec.SetParam(cricket::kCodecParamMaxBitrate, profile.maxBitrateKbit);
+        opusCodec.SetParam(cricket::kCodecParamUseInbandFec, profile.fec ? 1 : 0);
+        opusCodec.SetParam(cricket::kCodecParamMaxAverageBitrate, profile.maxBitrateKbit * 1000);
+        opusCodec.SetParam(cricket::kCodecParamUseDtx, profile.dtx ? 1 : 0);
+        opusCodec.SetParam(cricket::kCodecParamStereo, profile.stereo ? 1 : 0);
         opusCodec.SetParam(cricket::kCodecParamMinPTime, 10);
-        opusCodec.SetParam(cricket::kCodecParamPTime, opusPTimeMs);
+        opusCodec.SetParam(cricket::kCodecParamPTime, profile.ptimeMs);
+        if (_constantBitrateAudio) {
+            opusCodec.SetParam("cbr", 1);
+        }
 
         auto outgoingAudioDescription = std::make_unique<cricket::AudioContentDescription>();
         outgoingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kAudioLevelUri, 1));
         outgoingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kAbsSendTimeUri, 2));
-        outgoingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kTransportSequenceNumberUri, 3));
+        if (!_constantBitrateAudio) {
+            // Without it the send stream stays out of bandwidth estimation
+            // and no transport feedback comes back for it.
+            outgoingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kTransportSequenceNumberUri, 3));
+        }
         outgoingAudioDescription->set_rtcp_mux(true);
         outgoingAudioDescription->set_rtcp_reduced_size(true);
         outgoingAudioDescription->set_direction(webrtc::RtpTransceiverDirection::kSendOnly);
@@ -1809,7 +3895,9 @@ public:
         auto incomingAudioDescription = std::make_unique<cricket::AudioContentDescription>();
         incomingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kAudioLevelUri, 1));
         incomingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kAbsSendTimeUri, 2));
-        incomingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kTransportSequenceNumberUri, 3));
+        if (!_constantBitrateAudio) {
+            incomingAudioDescription->AddRtpHeaderExtension(webrtc::RtpExtension(webrtc::RtpExtension::kTransportSequenceNumberUri, 3));
+        }
         incomingAudioDescription->set_rtcp_mux(true);
         incomingAudioDescription->set_rtcp_reduced_size(true);
         incomingAudioDescription->set_direction(webrtc::RtpTransceiverDirection::kRecvOnly);
@@ -1820,6 +3908,15 @@ public:
         _outgoingAudioChannel->SetRemoteContent(incomingAudioDescription.get(), webrtc::SdpType::kAnswer, nullptr);
         _outgoingAudioChannel->SetPayloadTypeDemuxingEnabled(false);
 
+        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this, &profile]() {
+            webrtc::RtpParameters rtpParameters = _outgoingAudioChannel->media_channel()->GetRtpSendParameters(_outgoingAudioSsrc);
+            if (!rtpParameters.encodings.empty()) {
+                rtpParameters.encodings[0].min_bitrate_bps = profile.minBitrateKbit * 1000;
+                rtpParameters.encodings[0].max_bitrate_bps = profile.maxBitrateKbit * 1000;
+                _outgoingAudioChannel->media_channel()->SetRtpSendParameters(_outgoingAudioSsrc, rtpParameters);
+            }
+        });
+
         //_outgoingAudioChannel->SignalSentPacket().connect(this, &GroupInstanceCustomInternal::OnSentPacket_w);
 
         _outgoingAudioChannel->Enable(true);
@@ -1832,10 +3929,26 @@ public:
     void stop() {
     }
 
+    void updateSsrcVoiceActivity(uint32_t ssrc, bool isSpeech) {
+        auto it = _audioLevels.find(ChannelId(ssrc));
+        if (it != _audioLevels.end() && isSpeech) {
+            it->second.value.voice = true;
+        }
+    }
+
     void updateSsrcAudioLevel(uint32_t ssrc, uint8_t audioLevel, bool isSpeech) {
+        _startupTimings->onRtpPacket();
+
         float mappedLevel = ((float)audioLevel) / (float)(0x7f);
         mappedLevel = (fabs(1.0f - mappedLevel)) * 1.0f;
 
+        _incomingAudioLoudness.update(ssrc, mappedLevel, rtc::TimeMillis());
+        touchSsrcState(ssrc);
+
+        if (_enableIncomingVad) {
+            isSpeech = false;
+        }
+
         auto it = _audioLevels.find(ChannelId(ssrc));
         if (it != _audioLevels.end()) {
             it->second.value.level = fmax(it->second.value.level, mappedLevel);
@@ -1857,58 +3970,233 @@ public:
         }
     }
 
-    void beginLevelsTimer(int timeoutMs) {
-        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
-        _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak]() {
-            auto strong = weak.lock();
-            if (!strong) {
-                return;
+    // Gives every update its dense index and, for delta updates, drops the
+    // ones whose value didn't change since they were last reported.
+    void indexLevelsUpdate(GroupLevelsUpdate &levelsUpdate) {
+        _levelsTick++;
+        levelsUpdate.isDelta = _audioLevelsDeltaUpdates;
+
+        size_t keptCount = 0;
+        for (auto &update : levelsUpdate.updates) {
+            auto reported = _reportedLevels.find(update.ssrc);
+            bool isChanged = true;
+            if (reported == _reportedLevels.end()) {
+                ReportedLevel newReported;
+                if (update.ssrc != 0) {
+                    if (!_freeLevelIndices.empty()) {
+                        newReported.index = _freeLevelIndices.back();
+                        _freeLevelIndices.pop_back();
+                    } else {
+                        newReported.index = _nextLevelIndex++;
+                    }
+                }
+                reported = _reportedLevels.insert(std::make_pair(update.ssrc, newReported)).first;
+            } else {
+                auto const &previous = reported->second.value;
+                isChanged = std::fabs(previous.level - update.value.level) > 0.001f || previous.voice != update.value.voice || previous.isMuted != update.value.isMuted;
+            }
+            update.index = reported->second.index;
+            reported->second.value = update.value;
+            reported->second.tick = _levelsTick;
+
+            if (isChanged || !_audioLevelsDeltaUpdates) {
+                levelsUpdate.updates[keptCount++] = update;
+            }
+        }
+        levelsUpdate.updates.resize(keptCount);
+
+        for (auto it = _reportedLevels.begin(); it != _reportedLevels.end(); ) {
+            if (it->second.tick == _levelsTick) {
+                it++;
+                continue;
+            }
+            if (_audioLevelsDeltaUpdates) {
+                GroupLevelUpdate update;
+                update.ssrc = it->first;
+                update.index = it->second.index;
+                levelsUpdate.updates.push_back(update);
+            }
+            _freeLevelIndices.push_back(it->second.index);
+            _reportedLevels.erase(it++);
+        }
+    }
+
+    void beginStatsTimer(int timeoutMs) {
+        _statsTimer.start(GroupTimerWheel::forThread(_threads->getMediaThread()), timeoutMs, _statsUpdateIntervalMs, [this]() {
+            _statsUpdated(collectStats());
+        });
+    }
+
+    CallStatsSnapshot collectStats() {
+        CallStatsSnapshotBuilder builder(rtc::TimeMillis());
+        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [&]() {
+            builder.addCall(_call.get());
+            builder.addVoiceChannel(_outgoingAudioChannel);
+            builder.addVideoChannel(_outgoingVideoChannel);
+            for (const auto &it : _incomingAudioChannels) {
+                it.second->collectStats(builder);
+            }
+            for (const auto &it : _incomingVideoChannels) {
+                it.second->collectStats(builder);
             }
+        });
+        return builder.finish();
+    }
+
+    GroupInstanceCustomImpl::MediaStats getMediaStats() {
+        GroupInstanceCustomImpl::MediaStats stats;
+        if (!_isStarted) {
+            return stats;
+        }
+        _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [&]() {
+            const auto callStats = _call->GetStats();
+            stats.sendBandwidthBps = callStats.send_bandwidth_bps;
+            stats.receiveBandwidthBps = callStats.recv_bandwidth_bps;
+            stats.pacerDelayMs = callStats.pacer_delay_ms;
+            stats.rttMs = callStats.rtt_ms;
+
+            cricket::VoiceMediaInfo info;
+            if (_outgoingAudioChannel && _outgoingAudioChannel->media_channel()->GetStats(&info, false)) {
+                for (const auto &sender : info.senders) {
+                    stats.outgoingAudioBytesSent += sender.payload_bytes_sent + sender.header_and_padding_bytes_sent;
+                    stats.outgoingAudioPacketsSent += sender.packets_sent;
+                    stats.outgoingAudioPacketsLost += sender.packets_lost;
+                    stats.outgoingAudioFractionLost = std::max(stats.outgoingAudioFractionLost, sender.fraction_lost);
+                }
+            }
+
+            const auto count = _incomingAudioChannels.size();
+            stats.incomingAudioSsrcs.reserve(count);
+            stats.incomingAudioPacketsReceived.reserve(count);
+            stats.incomingAudioPacketsLost.reserve(count);
+            stats.incomingAudioJitterMs.reserve(count);
+            stats.incomingAudioJitterBufferDelayMs.reserve(count);
+            stats.incomingAudioExpandRate.reserve(count);
+            stats.incomingAudioSpeechExpandRate.reserve(count);
+            stats.incomingAudioConcealedSamples.reserve(count);
+            stats.incomingAudioConcealmentEvents.reserve(count);
+            stats.incomingAudioTotalSamples.reserve(count);
+            for (const auto &it : _incomingAudioChannels) {
+                it.second->collectStats(stats);
+            }
+        });
+        return stats;
+    }
+
+    rtc::scoped_refptr<rtc::RTCCertificate> getLocalCertificate() const {
+        rtc::scoped_refptr<rtc::RTCCertificate> certificate;
+        if (!_networkManager) {
+            return certificate;
+        }
+        _threads->getNetworkThread()->Invoke<void>(RTC_FROM_HERE, [&] {
+            certificate = _networkManager->getSyncAssumingSameThread()->getLocalCertificate();
+        });
+        return certificate;
+    }
+
+    GroupInstanceCustomImpl::MigrationState getMigrationState() const {
+        GroupInstanceCustomImpl::MigrationState state;
+        state.outgoingAudioSsrc = _outgoingAudioSsrc;
+        for (const auto &it : _channelBySsrc) {
+            if (it.second.type == ChannelSsrcInfo::Type::Audio) {
+                state.incomingAudioSsrcs.push_back(it.first);
+            }
+        }
+        std::sort(state.incomingAudioSsrcs.begin(), state.incomingAudioSsrcs.end());
+        state.volumes.assign(_volumeBySsrc.begin(), _volumeBySsrc.end());
+        std::sort(state.volumes.begin(), state.volumes.end());
+        if (_connectionMode == GroupConnectionMode::GroupConnectionModeBroadcast) {
+            state.nextBroadcastTimestampMilliseconds = _nextBroadcastTimestampMilliseconds;
+        }
+        state.joinResponsePayload = _lastJoinResponsePayload;
+        return state;
+    }
+
+    GroupInstanceCustomImpl::MemoryUsage getMemoryUsage() {
+        GroupInstanceCustomImpl::MemoryUsage usage;
+        for (const auto &part : _sourceBroadcastParts) {
+            // Shared PCM counts in full for every call holding it.
+            usage.broadcastPartBytes += sizeof(PendingBroadcastPart) + (part->decoded ? part->decoded->pcm.capacity() * sizeof(int16_t) : 0);
+        }
+        for (const auto &it : _reorderedBroadcastParts) {
+            usage.broadcastPartBytes += sizeof(BroadcastPart) + it.second.oggData.capacity();
+        }
+        usage.missingSsrcPacketBytes = _missingPacketBuffer.memoryBytes();
+        usage.arenaBytes = _arena.reservedBytes();
+        usage.ssrcTableBytes = hashTableBytes(_audioLevels) + hashTableBytes(_reportedLevels) + hashTableBytes(_levelsReportedSsrcs) + hashTableBytes(_channelBySsrc) + hashTableBytes(_volumeBySsrc) + hashTableBytes(_broadcastSeqBySsrc);
+        usage.audioLevelEntries = _audioLevels.size();
+        usage.reportedLevelEntries = _reportedLevels.size();
+        usage.channelEntries = _channelBySsrc.size();
+        usage.volumeEntries = _volumeBySsrc.size();
+        usage.broadcastSequenceEntries = _broadcastSeqBySsrc.size();
+        usage.incomingAudioChannels = (int)_incomingAudioChannels.size();
+        usage.pooledIncomingAudioChannels = (int)_incomingAudioChannelPool.size();
+        usage.directBroadcastChannels = (int)_directBroadcastChannels.size();
+        usage.incomingVideoChannels = (int)_incomingVideoChannels.size();
+        if (_isStarted && !_incomingAudioChannels.empty()) {
+            GroupInstanceCustomImpl::MediaStats stats;
+            _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [&]() {
+                for (const auto &it : _incomingAudioChannels) {
+                    it.second->collectStats(stats);
+                }
+            });
+            for (const auto delayMs : stats.incomingAudioJitterBufferDelayMs) {
+                usage.incomingAudioBufferedMs += delayMs;
+            }
+        }
+        return usage;
+    }
 
+    void beginLevelsTimer(int timeoutMs) {
+        _levelsTimer.start(GroupTimerWheel::forThread(_threads->getMediaThread()), timeoutMs, _audioLevelsUpdateIntervalMs, [this]() {
+            TraceScope trace("media", "levelsTimer");
             int64_t timestamp = rtc::TimeMillis();
             int64_t maxSampleTimeout = 400;
 
+            _packetDeliveryCounters->updateRates(timestamp);
+
             GroupLevelsUpdate levelsUpdate;
-            levelsUpdate.updates.reserve(strong->_audioLevels.size() + 1);
-            for (auto &it : strong->_audioLevels) {
-                if (it.second.value.level > 0.001f && it.second.timestamp > timestamp - maxSampleTimeout) {
-                    uint32_t effectiveSsrc = it.first.actualSsrc;
-                    if (std::find_if(levelsUpdate.updates.begin(), levelsUpdate.updates.end(), [&](GroupLevelUpdate const &item) {
-                        return item.ssrc == effectiveSsrc;
-                    }) != levelsUpdate.updates.end()) {
-                        continue;
-                    }
-                    levelsUpdate.updates.push_back(GroupLevelUpdate{
-                        effectiveSsrc,
-                        it.second.value,
-                        });
-                    if (it.second.value.level > 0.001f) {
-                        auto audioChannel = strong->_incomingAudioChannels.find(it.first);
-                        if (audioChannel != strong->_incomingAudioChannels.end()) {
+            levelsUpdate.updates.reserve(_audioLevels.size() + 1);
+            _levelsReportedSsrcs.clear();
+            for (auto it = _audioLevels.begin(); it != _audioLevels.end(); ) {
+                if (it->second.timestamp < timestamp - kAudioLevelForgetTimeoutMs) {
+                    _audioLevels.erase(it++);
+                    continue;
+                }
+                if (it->second.value.level > 0.001f && it->second.timestamp > timestamp - maxSampleTimeout) {
+                    uint32_t effectiveSsrc = it->first.actualSsrc;
+                    if (_levelsReportedSsrcs.insert(effectiveSsrc).second) {
+                        levelsUpdate.updates.push_back(GroupLevelUpdate{
+                            effectiveSsrc,
+                            it->second.value,
+                            });
+
+                        auto audioChannel = _incomingAudioChannels.find(it->first);
+                        if (audioChannel != _incomingAudioChannels.end()) {
                             audioChannel->second->updateActivity();
                         }
-                    }
 
-                    it.second.value.level *= 0.5f;
-                    it.second.value.voice = false;
+                        it->second.value.level *= 0.5f;
+                        it->second.value.voice = false;
+                    }
                 }
+                it++;
             }
 
-            auto myAudioLevel = strong->_myAudioLevel;
-            myAudioLevel.isMuted = strong->_isMuted;
+            auto myAudioLevel = _myAudioLevel;
+            myAudioLevel.isMuted = _isMuted;
             levelsUpdate.updates.push_back(GroupLevelUpdate{ 0, myAudioLevel });
 
-            if (strong->_audioLevelsUpdated) {
-                strong->_audioLevelsUpdated(levelsUpdate);
+            if (_audioLevelsUpdated) {
+                indexLevelsUpdate(levelsUpdate);
+                _audioLevelsUpdated(levelsUpdate);
             }
 
             bool isSpeech = myAudioLevel.voice && !myAudioLevel.isMuted;
-            strong->_networkManager->perform(RTC_FROM_HERE, [isSpeech = isSpeech](GroupNetworkManager *networkManager) {
+            _networkManager->perform(RTC_FROM_HERE, [isSpeech = isSpeech](GroupNetworkManager *networkManager) {
                 networkManager->setOutgoingVoiceActivity(isSpeech);
             });
-
-            strong->beginLevelsTimer(100);
-        }, timeoutMs);
+        });
     }
 
     void beginAudioChannelCleanupTimer(int delayMs) {
@@ -1927,7 +4215,7 @@ public:
                     continue;
                 }
                 auto activity = it.second->getActivity();
-                if (activity < timestamp - 1000) {
+                if (activity < timestamp - strong->_incomingAudioChannelIdleTimeoutMs) {
                     removeChannels.push_back(it.first);
                 }
             }
@@ -1940,34 +4228,135 @@ public:
         }, delayMs);
     }
 
-    void beginRemoteConstraintsUpdateTimer(int delayMs) {
-        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
-        _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak]() {
-            auto strong = weak.lock();
-            if (!strong) {
-                return;
+    void touchSsrcState(uint32_t ssrc) {
+        if (_ssrcStateIdleTimeoutMs > 0) {
+            _ssrcStateExpiry.touch(ssrc, rtc::TimeMillis());
+        }
+    }
+
+    void beginSsrcStateExpiryTimer(int delayMs) {
+        _ssrcStateExpiryTimer.start(GroupTimerWheel::forThread(_threads->getMediaThread()), delayMs, kSsrcStateExpiryTickMs, [this]() {
+            for (const auto ssrc : _ssrcStateExpiry.advance(rtc::TimeMillis())) {
+                expireSsrcState(ssrc);
             }
+        });
+    }
+
+    // Drops what is kept per SSRC of a participant no longer heard from,
+    // as long as it doesn't have a channel; one that does is only counted
+    // as idle again, its channel goes when another speaker needs it.
+    void expireSsrcState(uint32_t ssrc) {
+        const auto broadcastChannelId = ChannelId(ssrc + 1000, ssrc);
+        if (_incomingAudioChannels.find(ChannelId(ssrc)) != _incomingAudioChannels.end() ||
+            _incomingAudioChannels.find(broadcastChannelId) != _incomingAudioChannels.end() ||
+            _directBroadcastChannels.find(ssrc) != _directBroadcastChannels.end()) {
+            touchSsrcState(ssrc);
+            return;
+        }
+        _audioLevels.erase(ChannelId(ssrc));
+        _audioLevels.erase(broadcastChannelId);
+        _broadcastSeqBySsrc.erase(broadcastChannelId.networkSsrc);
+        _volumeBySsrc.erase(ssrc);
+    }
 
-            strong->maybeUpdateRemoteVideoConstraints();
+    void beginRemoteConstraintsUpdateTimer(int delayMs) {
+        _remoteConstraintsUpdateTimer.start(GroupTimerWheel::forThread(_threads->getMediaThread()), delayMs, 5000, [this]() {
+            maybeUpdateRemoteVideoConstraints();
+        });
+    }
 
-            strong->beginRemoteConstraintsUpdateTimer(5000);
-        }, delayMs);
+    void beginOverloadTimer(int delayMs) {
+        _overloadTimer.start(GroupTimerWheel::forThread(_threads->getMediaThread()), delayMs, 500, [this]() {
+            updateOverloadLevel();
+        });
     }
 
-    void beginNetworkStatusTimer(int delayMs) {
-        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
-        _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak]() {
-            auto strong = weak.lock();
-            if (!strong) {
-                return;
+    // Applies the OverloadController's level to the call when it changes;
+    // the lower Opus complexity applies to encoders as they are made.
+    void updateOverloadLevel() {
+        using Level = OverloadController::Level;
+        const auto level = OverloadController::level();
+        if (level == _overloadLevel) {
+            return;
+        }
+        const auto previous = std::exchange(_overloadLevel, level);
+        RTC_LOG(LS_INFO) << "GroupInstanceCustomImpl: overload level " << static_cast<int>(previous) << " -> " << static_cast<int>(level);
+        const auto config = OverloadController::config();
+        _overloadMaxDecodedIncomingAudioStreams = config.maxDecodedIncomingAudioStreams;
+        _overloadJitterBufferMinDelayMs = config.jitterBufferMinDelayMs;
+
+        WorkerThreadBatch batch;
+        if (level >= Level::FewerAudioStreams) {
+            shedIncomingAudioChannels(&batch);
+        }
+        if ((previous >= Level::WiderJitterBuffers) != (level >= Level::WiderJitterBuffers)) {
+            for (const auto &it : _incomingAudioChannels) {
+                if (it.first.networkSsrc != 1) {
+                    it.second->setBaseMinimumDelay(incomingAudioBaseMinimumDelayMs(), &batch);
+                }
             }
+        }
+        batch.commit(_threads->getWorkerThread());
 
-            if (strong->_connectionMode == GroupConnectionMode::GroupConnectionModeBroadcast || strong->_broadcastEnabledUntilRtcIsConnectedAtTimestamp) {
-                strong->updateBroadcastNetworkStatus();
+        if ((previous >= Level::LowerVideoQuality) != (level >= Level::LowerVideoQuality)) {
+            bool isChanged = false;
+            for (const auto &it : _incomingVideoChannels) {
+                isChanged = it.second->setOverloadMaxQuality(overloadMaxVideoQuality()) || isChanged;
             }
+            if (isChanged) {
+                scheduleRemoteVideoConstraintsUpdate(level < Level::LowerVideoQuality);
+            }
+        }
+    }
 
-            strong->beginNetworkStatusTimer(500);
-        }, delayMs);
+    int maxDecodedIncomingAudioStreams() const {
+        if (_overloadLevel >= OverloadController::Level::FewerAudioStreams) {
+            return std::min(_maxDecodedIncomingAudioStreams, _overloadMaxDecodedIncomingAudioStreams);
+        }
+        return _maxDecodedIncomingAudioStreams;
+    }
+
+    int incomingAudioBaseMinimumDelayMs() const {
+        return _overloadLevel >= OverloadController::Level::WiderJitterBuffers ? _overloadJitterBufferMinDelayMs : 0;
+    }
+
+    VideoChannelDescription::Quality overloadMaxVideoQuality() const {
+        return _overloadLevel >= OverloadController::Level::LowerVideoQuality
+            ? VideoChannelDescription::Quality::Thumbnail
+            : VideoChannelDescription::Quality::Full;
+    }
+
+    // Lets the quietest decoded incoming audio streams go until no more
+    // than maxDecodedIncomingAudioStreams() are left; they come back as
+    // others fall idle, like any stream over the limit.
+    void shedIncomingAudioChannels(WorkerThreadBatch *batch) {
+        const auto timestamp = rtc::TimeMillis();
+        while (decodedIncomingAudioStreamCount() > maxDecodedIncomingAudioStreams()) {
+            float minScore = std::numeric_limits<float>::max();
+            ChannelId minScoreChannelId(0, 0);
+            for (const auto &it : _incomingAudioChannels) {
+                if (it.first.networkSsrc == 1) {
+                    continue;
+                }
+                const float score = _incomingAudioLoudness.score(it.first.networkSsrc, timestamp);
+                if (minScoreChannelId.networkSsrc == 0 || score < minScore) {
+                    minScore = score;
+                    minScoreChannelId = it.first;
+                }
+            }
+            if (minScoreChannelId.networkSsrc == 0) {
+                break;
+            }
+            removeIncomingAudioChannel(minScoreChannelId, batch);
+        }
+    }
+
+    void beginNetworkStatusTimer(int delayMs) {
+        _networkStatusTimer.start(GroupTimerWheel::forThread(_threads->getMediaThread()), delayMs, 500, [this]() {
+            if (_connectionMode == GroupConnectionMode::GroupConnectionModeBroadcast || _broadcastEnabledUntilRtcIsConnectedAtTimestamp) {
+                updateBroadcastNetworkStatus();
+            }
+        });
     }
 
     void updateBroadcastNetworkStatus() {
@@ -1978,62 +4367,189 @@ public:
             isBroadcastConnected = false;
         }
 
-        if (_broadcastEnabledUntilRtcIsConnectedAtTimestamp) {
-            auto timestamp = rtc::TimeMillis();
-            if (std::abs(timestamp - _broadcastEnabledUntilRtcIsConnectedAtTimestamp.value()) > 3000) {
-                _broadcastEnabledUntilRtcIsConnectedAtTimestamp = absl::nullopt;
-                if (_currentRequestedBroadcastPart) {
-                    if (_currentRequestedBroadcastPart->task) {
-                        _currentRequestedBroadcastPart->task->cancel();
-                    }
-                    _currentRequestedBroadcastPart.reset();
-                }
+        // Given up on once the new mode is late to connect; once it has,
+        // the crossfade ends it instead.
+        if (_broadcastEnabledUntilRtcIsConnectedAtTimestamp && !_isRtcConnected) {
+            if (std::abs(timestamp - _broadcastEnabledUntilRtcIsConnectedAtTimestamp.value()) > kConnectionModeTransitionTimeoutMs) {
+                endBroadcastTransition();
                 isBroadcastConnected = false;
             }
         }
+        if (_rtcEnabledUntilBroadcastIsConnectedAtTimestamp && !isBroadcastConnected) {
+            if (std::abs(timestamp - _rtcEnabledUntilBroadcastIsConnectedAtTimestamp.value()) > kConnectionModeTransitionTimeoutMs) {
+                endRtcTransition();
+            }
+        }
 
         if (isBroadcastConnected != _isBroadcastConnected) {
             _isBroadcastConnected = isBroadcastConnected;
             updateIsConnected();
         }
+        updateBroadcastMix(true);
     }
 
-    absl::optional<DecodedBroadcastPart> getNextBroadcastPart() {
-        while (true) {
-            if (_sourceBroadcastParts.size() != 0) {
-                auto readChannels = _sourceBroadcastParts[0]->get10msPerChannel();
-                if (readChannels.size() == 0 || readChannels[0].pcmData.size() == 0) {
-                    _sourceBroadcastParts.erase(_sourceBroadcastParts.begin());
-                } else {
-                    std::vector<DecodedBroadcastPart::DecodedBroadcastPartChannel> channels;
+    // Stops the broadcast kept playing after switching to RTC.
+    void endBroadcastTransition() {
+        _broadcastEnabledUntilRtcIsConnectedAtTimestamp = absl::nullopt;
+        cancelBroadcastPartRequests();
+        _sourceBroadcastParts.clear();
+        _directBroadcastChannels.clear();
+        updateBroadcastStats();
+    }
 
-                    int numSamples = (int)readChannels[0].pcmData.size();
+    // Stops RTC kept connected after switching to broadcast.
+    void endRtcTransition() {
+        _rtcEnabledUntilBroadcastIsConnectedAtTimestamp = absl::nullopt;
+        _networkManager->perform(RTC_FROM_HERE, [](GroupNetworkManager *networkManager) {
+            networkManager->stop();
+        });
+        updateIsConnected();
+    }
 
-                    for (auto &readChannel : readChannels) {
-                        DecodedBroadcastPart::DecodedBroadcastPartChannel channel;
-                        channel.ssrc = readChannel.ssrc;
-                        channel.pcmData = std::move(readChannel.pcmData);
-                        channels.push_back(channel);
-                    }
+    // Gain of broadcast or of RTC audio at the current mix; equal power, so
+    // the loudness holds through the crossfade.
+    double broadcastMixGain(bool isBroadcast) const {
+        if (_broadcastMix <= 0.0) {
+            return isBroadcast ? 0.0 : 1.0;
+        } else if (_broadcastMix >= 1.0) {
+            return isBroadcast ? 1.0 : 0.0;
+        }
+        const double angle = _broadcastMix * M_PI / 2.0;
+        return isBroadcast ? std::sin(angle) : std::cos(angle);
+    }
+
+    double mixedVolume(uint32_t ssrc, bool isBroadcast) const {
+        double volume = 1.0;
+        auto it = _volumeBySsrc.find(ssrc);
+        if (it != _volumeBySsrc.end()) {
+            volume = it->second;
+        }
+        return volume * broadcastMixGain(isBroadcast);
+    }
+
+    // Heads the mix for the connection mode: RTC or broadcast, whichever
+    // is current, unless it isn't connected yet and the other was kept.
+    void updateBroadcastMix(bool fade) {
+        double target = 0.0;
+        if (_connectionMode == GroupConnectionMode::GroupConnectionModeBroadcast) {
+            target = (_rtcEnabledUntilBroadcastIsConnectedAtTimestamp && !_isBroadcastConnected) ? 0.0 : 1.0;
+        } else if (_broadcastEnabledUntilRtcIsConnectedAtTimestamp) {
+            target = _isRtcConnected ? 0.0 : 1.0;
+        }
+        _broadcastMixTarget = target;
+
+        if (_broadcastMix == target) {
+            _broadcastMixTimer.stop();
+            onBroadcastMixReached();
+        } else if (!fade || _connectionModeCrossfadeMs <= 0) {
+            _broadcastMixTimer.stop();
+            _broadcastMix = target;
+            applyBroadcastMix();
+            onBroadcastMixReached();
+        } else if (!_broadcastMixTimer.isActive()) {
+            _broadcastMixTimer.start(GroupTimerWheel::forThread(_threads->getMediaThread()), 0, kBroadcastMixStepMs, [this]() {
+                stepBroadcastMix();
+            });
+        }
+    }
 
-                    absl::optional<DecodedBroadcastPart> decodedPart;
-                    decodedPart.emplace(numSamples, std::move(channels));
+    void stepBroadcastMix() {
+        const double step = (double)kBroadcastMixStepMs / (double)_connectionModeCrossfadeMs;
+        if (_broadcastMix < _broadcastMixTarget) {
+            _broadcastMix = std::min(_broadcastMixTarget, _broadcastMix + step);
+        } else {
+            _broadcastMix = std::max(_broadcastMixTarget, _broadcastMix - step);
+        }
+        applyBroadcastMix();
 
-                    return decodedPart;
-                }
-            } else {
+        if (_broadcastMix == _broadcastMixTarget) {
+            _broadcastMixTimer.stop();
+            onBroadcastMixReached();
+        }
+    }
+
+    // Sets the volume of every incoming channel for the current mix.
+    void applyBroadcastMix() {
+        WorkerThreadBatch batch;
+        for (const auto &it : _incomingAudioChannels) {
+            setIncomingChannelVolume(it.first, it.second.get(), mixedVolume(it.first.actualSsrc, it.first.actualSsrc != it.first.networkSsrc), &batch);
+        }
+        batch.commit(_threads->getWorkerThread());
+
+        for (const auto &it : _directBroadcastChannels) {
+            it.second->setVolume(mixedVolume(it.first, true));
+        }
+    }
+
+    // Once the mode switched from is faded out, it is stopped.
+    void onBroadcastMixReached() {
+        if (_broadcastMix == 0.0 && _broadcastEnabledUntilRtcIsConnectedAtTimestamp && _isRtcConnected) {
+            endBroadcastTransition();
+            updateIsConnected();
+        } else if (_broadcastMix == 1.0 && _rtcEnabledUntilBroadcastIsConnectedAtTimestamp) {
+            endRtcTransition();
+        }
+    }
+
+    absl::optional<DecodedBroadcastFrame> getNextBroadcastPart() {
+        while (!_sourceBroadcastParts.empty()) {
+            auto &part = *_sourceBroadcastParts.front();
+            if (!part.isDecoded) {
+                // Later parts may be decoded already, but play in order.
                 return absl::nullopt;
             }
+            if (part.nextFrame >= part.decoded->frameCount()) {
+                _sourceBroadcastParts.pop_front();
+                continue;
+            }
+
+            DecodedBroadcastFrame frame;
+            frame.part = part.decoded.get();
+            frame.frame = part.nextFrame++;
+            frame.partTimestampMilliseconds = part.timestampMilliseconds;
+            frame.numSamples = part.decoded->frameSamples[frame.frame];
+            return frame;
         }
 
         return absl::nullopt;
     }
 
-    void commitBroadcastPackets() {
+    int broadcastQueueMilliseconds() const {
         int numMillisecondsInQueue = 0;
         for (const auto &part : _sourceBroadcastParts) {
-            numMillisecondsInQueue += part->getRemainingMilliseconds();
+            numMillisecondsInQueue += part->remainingMilliseconds();
         }
+        return numMillisecondsInQueue;
+    }
+
+    void decodeBroadcastPart(int64_t timestampMilliseconds, std::vector<uint8_t> &&oggData) {
+        if (_sourceBroadcastParts.size() >= kMaxBroadcastPartsAhead) {
+            RTC_LOG(LS_WARNING) << "Broadcast decode-ahead queue is full, dropping the oldest part";
+            _sourceBroadcastParts.pop_front();
+        }
+
+        auto part = std::make_shared<PendingBroadcastPart>();
+        part->timestampMilliseconds = timestampMilliseconds;
+        _sourceBroadcastParts.push_back(part);
+
+        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
+        BroadcastPartCache::decode(_broadcastPartCacheKey, timestampMilliseconds, _broadcastDecodedSsrcs, std::move(oggData), [weak, threads = _threads, part](BroadcastPartCache::DecodedPart decoded) mutable {
+            threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, part = std::move(part), decoded = std::move(decoded)]() mutable {
+                const auto strong = weak.lock();
+                if (!strong) {
+                    return;
+                }
+                part->decoded = std::move(decoded);
+                part->isDecoded = true;
+                HotPathCounters::onBroadcastPartDecoded();
+                strong->updateBroadcastStats();
+            });
+        });
+    }
+
+    void commitBroadcastPackets() {
+        TraceScope trace("broadcast", "commitBroadcastPackets");
+        int numMillisecondsInQueue = broadcastQueueMilliseconds();
 
         int commitMilliseconds = 20;
         if (numMillisecondsInQueue > 1000) {
@@ -2041,30 +4557,43 @@ public:
         }
 
         std::set<ChannelId> channelsWithActivity;
+        // Delivered to the call in one task once the whole cycle is built.
+        std::vector<rtc::CopyOnWriteBuffer> packetsToDeliver;
 
         for (int msIndex = 0; msIndex < commitMilliseconds; msIndex += 10) {
             auto packetData = getNextBroadcastPart();
             if (!packetData) {
                 break;
             }
+            if (packetData->frame == 0) {
+                onBroadcastPartPlaybackStarted(packetData->partTimestampMilliseconds, rtc::TimeMillis() + msIndex);
+            }
 
-            for (const auto &decodedChannel : packetData->channels) {
-                if (decodedChannel.ssrc == _outgoingAudioSsrc) {
+            size_t numSamples = (size_t)packetData->numSamples;
+            for (size_t channel = 0; channel < packetData->channelCount(); channel++) {
+                uint32_t ssrc = packetData->ssrc(channel);
+                const int16_t *pcm = packetData->pcm(channel);
+                if (ssrc == _outgoingAudioSsrc) {
                     continue;
                 }
 
-                ChannelId channelSsrc = ChannelId(decodedChannel.ssrc + 1000, decodedChannel.ssrc);
+                ChannelId channelSsrc = ChannelId(ssrc + 1000, ssrc);
+                if (_directBroadcastAudio) {
+                    deliverDirectBroadcastAudio(channelSsrc, pcm, numSamples, packetData->numSamples * 100);
+                    continue;
+                }
                 if (_incomingAudioChannels.find(channelSsrc) == _incomingAudioChannels.end()) {
                     addIncomingAudioChannel(channelSsrc, true);
                 }
 
-                webrtc::RtpPacket packet(nullptr, 12 + decodedChannel.pcmData.size() * 2);
+                webrtc::RtpPacket packet(nullptr, 12 + numSamples * 2);
 
                 packet.SetMarker(false);
                 packet.SetPayloadType(112);
 
                 uint16_t packetSeq = 0;
 
+                touchSsrcState(ssrc);
                 auto it = _broadcastSeqBySsrc.find(channelSsrc.networkSsrc);
                 if (it == _broadcastSeqBySsrc.end()) {
                     packetSeq = 1000;
@@ -2080,19 +4609,10 @@ public:
 
                 packet.SetSsrc(channelSsrc.networkSsrc);
 
-                uint8_t *payload = packet.SetPayloadSize(decodedChannel.pcmData.size() * 2);
-                memcpy(payload, decodedChannel.pcmData.data(), decodedChannel.pcmData.size() * 2);
-
-                for (int i = 0; i < decodedChannel.pcmData.size() * 2; i += 2) {
-                    auto temp = payload[i];
-                    payload[i] = payload[i + 1];
-                    payload[i + 1] = temp;
-                }
+                uint8_t *payload = packet.SetPayloadSize(numSamples * 2);
+                AudioByteSwapS16(pcm, numSamples, payload);
 
-                auto buffer = packet.Buffer();
-                _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this, buffer]() {
-                    _call->Receiver()->DeliverPacket(webrtc::MediaType::AUDIO, buffer, -1);
-                });
+                packetsToDeliver.push_back(packet.Buffer());
 
                 channelsWithActivity.insert(ChannelId(channelSsrc));
             }
@@ -2106,29 +4626,317 @@ public:
 
             _broadcastTimestamp += packetData->numSamples;
         }
+
+        if (_directBroadcastAudio) {
+            removeIdleDirectBroadcastChannels();
+        }
+
+        updateBroadcastStats();
+
+        if (!packetsToDeliver.empty()) {
+            _packetDeliveryCounters->onThreadHop(packetsToDeliver.size());
+            _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafery, [this, packets = std::move(packetsToDeliver)] {
+                if (!_call) {
+                    return;
+                }
+                for (const auto &packet : packets) {
+                    _call->Receiver()->DeliverPacket(webrtc::MediaType::AUDIO, packet, -1);
+                }
+            }));
+        }
+    }
+
+    void deliverDirectBroadcastAudio(ChannelId channelId, const int16_t *samples, size_t numSamples, int sampleRate) {
+        touchSsrcState(channelId.actualSsrc);
+        auto it = _directBroadcastChannels.find(channelId.actualSsrc);
+        if (it == _directBroadcastChannels.end()) {
+            std::function<void(AudioSinkImpl::Update)> onLevel;
+            if (_audioLevelsUpdated) {
+                // Called synchronously from push(), on the media thread.
+                onLevel = [this, channelId](AudioSinkImpl::Update update) {
+                    InternalGroupLevelValue updated;
+                    updated.value.level = update.level;
+                    updated.value.voice = update.hasSpeech;
+                    updated.timestamp = rtc::TimeMillis();
+                    _audioLevels[channelId] = std::move(updated);
+                };
+            }
+            if (_directBroadcastChannels.empty() && !_useDummyChannel) {
+                ensurePlayout();
+            }
+            auto channel = std::make_unique<DirectBroadcastAudioChannel>(channelId, _playoutMixer, std::move(onLevel), _onAudioFrame, _enableIncomingVad);
+            const double volume = mixedVolume(channelId.actualSsrc, true);
+            if (volume != 1.0) {
+                channel->setVolume(volume);
+            }
+            it = _directBroadcastChannels.insert(std::make_pair(channelId.actualSsrc, std::move(channel))).first;
+        }
+        it->second->push(samples, numSamples, sampleRate);
+    }
+
+    // Direct broadcast audio reaches the mixer without an incoming stream,
+    // so nothing else starts playout for it when there is no dummy channel.
+    void ensurePlayout() {
+        _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafery, [this] {
+            if (!_audioDeviceModule || _audioDeviceModule->Playing()) {
+                return;
+            }
+            if (_audioDeviceModule->InitPlayout() == 0) {
+                _audioDeviceModule->StartPlayout();
+            }
+        }));
+    }
+
+    void removeIdleDirectBroadcastChannels() {
+        auto timestamp = rtc::TimeMillis();
+        for (auto it = _directBroadcastChannels.begin(); it != _directBroadcastChannels.end(); ) {
+            if (it->second->getActivity() < timestamp - kDirectBroadcastChannelTimeoutMs) {
+                _directBroadcastChannels.erase(it++);
+            } else {
+                ++it;
+            }
+        }
     }
 
+    // Keeps a request in flight for each of the next |_broadcastPrefetchDepth|
+    // parts that hasn't been received yet, cancelling ones outside that window.
     void requestNextBroadcastPart() {
+        int64_t firstTimestamp = _nextBroadcastTimestampMilliseconds;
+        int64_t endTimestamp = firstTimestamp + _broadcastPrefetchDepth * _broadcastPartDurationMilliseconds;
+
+        for (auto it = _requestedBroadcastParts.begin(); it != _requestedBroadcastParts.end(); ) {
+            if (it->first < firstTimestamp || it->first >= endTimestamp) {
+                if (it->second.task) {
+                    it->second.task->cancel();
+                }
+                it = _requestedBroadcastParts.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
+        for (int64_t requestedPartId = firstTimestamp; requestedPartId < endTimestamp; requestedPartId += _broadcastPartDurationMilliseconds) {
+            if (_requestedBroadcastParts.find(requestedPartId) != _requestedBroadcastParts.end() || _reorderedBroadcastParts.find(requestedPartId) != _reorderedBroadcastParts.end()) {
+                continue;
+            }
+            auto task = BroadcastPartCache::request(_broadcastPartCacheKey, requestedPartId, _broadcastPartDurationMilliseconds, _requestBroadcastPart, [weak, threads = _threads, requestedPartId](BroadcastPart &&part) {
+                threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, part = std::move(part), requestedPartId]() mutable {
+                    auto strong = weak.lock();
+                    if (!strong) {
+                        return;
+                    }
+                    if (strong->_requestedBroadcastParts.erase(requestedPartId) != 0) {
+                        strong->onReceivedBroadcastPart(requestedPartId, std::move(part));
+                    }
+                });
+            });
+            _requestedBroadcastParts.emplace(requestedPartId, RequestedBroadcastPart(requestedPartId, task));
+        }
+        requestBroadcastVideoParts(firstTimestamp, endTimestamp);
+        updateBroadcastStats();
+    }
+
+    bool hasBroadcastVideoOutput(std::string const &endpointId) const {
+        const auto it = _pendingVideoSinks.find(VideoChannelId(endpointId));
+        if (it == _pendingVideoSinks.end()) {
+            return false;
+        }
+        for (const auto &output : it->second) {
+            if (!output.sink.expired()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The video parts of the same window, for the requested participants
+    // with an output attached; nothing is fetched or decoded for the others,
+    // and those dropping out of either have their fetches cancelled.
+    void requestBroadcastVideoParts(int64_t firstTimestamp, int64_t endTimestamp) {
+        std::vector<VideoChannelDescription const *> channels;
+        if (_requestVideoBroadcastPart) {
+            for (const auto &description : _broadcastVideoChannels) {
+                if (hasBroadcastVideoOutput(description.endpointId)) {
+                    channels.push_back(&description);
+                }
+            }
+        }
+        const auto isWanted = [&](BroadcastVideoPartId const &id) {
+            if (id.first < firstTimestamp || id.first >= endTimestamp) {
+                return false;
+            }
+            return std::find_if(channels.begin(), channels.end(), [&](VideoChannelDescription const *description) {
+                return description->endpointId == id.second;
+            }) != channels.end();
+        };
+        for (auto it = _requestedBroadcastVideoParts.begin(); it != _requestedBroadcastVideoParts.end(); ) {
+            if (!isWanted(it->first)) {
+                if (it->second) {
+                    it->second->cancel();
+                }
+                it = _requestedBroadcastVideoParts.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = _fetchedBroadcastVideoParts.begin(); it != _fetchedBroadcastVideoParts.end(); ) {
+            it = it->first < firstTimestamp ? _fetchedBroadcastVideoParts.erase(it) : std::next(it);
+        }
+
+        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
+        for (int64_t timestamp = firstTimestamp; timestamp < endTimestamp; timestamp += _broadcastPartDurationMilliseconds) {
+            for (const auto description : channels) {
+                const auto id = BroadcastVideoPartId(timestamp, description->endpointId);
+                if (_requestedBroadcastVideoParts.find(id) != _requestedBroadcastVideoParts.end() || _fetchedBroadcastVideoParts.find(id) != _fetchedBroadcastVideoParts.end()) {
+                    continue;
+                }
+                auto task = _requestVideoBroadcastPart(timestamp, _broadcastPartDurationMilliseconds, (int32_t)description->audioSsrc, description->maxQuality, [weak, threads = _threads, id](BroadcastPart &&part) {
+                    threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, part = std::move(part), id]() mutable {
+                        auto strong = weak.lock();
+                        if (!strong) {
+                            return;
+                        }
+                        if (strong->_requestedBroadcastVideoParts.erase(id) != 0) {
+                            strong->onReceivedBroadcastVideoPart(id, std::move(part));
+                        }
+                    });
+                });
+                _requestedBroadcastVideoParts.emplace(id, std::move(task));
+            }
+        }
+    }
+
+    // A part that isn't ready is asked for again with the next request of
+    // audio parts, while its timestamp is still ahead.
+    void onReceivedBroadcastVideoPart(BroadcastVideoPartId const &id, BroadcastPart &&part) {
+        if (part.status != BroadcastPart::Status::Success) {
+            return;
+        }
+        _fetchedBroadcastVideoParts.insert(id);
+
         const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
-        auto requestedPartId = _nextBroadcastTimestampMilliseconds;
-        auto task = _requestBroadcastPart(requestedPartId, _broadcastPartDurationMilliseconds, [weak, threads = _threads, requestedPartId](BroadcastPart &&part) {
-            threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, part = std::move(part), requestedPartId]() mutable {
+        BroadcastPartDecoder::decodeVideo(std::move(part.oggData), { id.second }, [weak, threads = _threads, timestamp = id.first](std::vector<VideoStreamingPart::Frame> &&frames) {
+            threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, timestamp, frames = std::move(frames)]() mutable {
                 auto strong = weak.lock();
                 if (!strong) {
                     return;
                 }
-                if (strong->_currentRequestedBroadcastPart && strong->_currentRequestedBroadcastPart->timestamp == requestedPartId) {
-                    strong->onReceivedNextBroadcastPart(std::move(part));
-                }
+                strong->onDecodedBroadcastVideoPart(timestamp, std::move(frames));
             });
         });
-        if (_currentRequestedBroadcastPart) {
-            if (_currentRequestedBroadcastPart->task) {
-                _currentRequestedBroadcastPart->task->cancel();
+    }
+
+    void onDecodedBroadcastVideoPart(int64_t timestamp, std::vector<VideoStreamingPart::Frame> &&frames) {
+        if (frames.empty()) {
+            return;
+        }
+        const auto started = _broadcastPartPlaybackStarts.find(timestamp);
+        if (started != _broadcastPartPlaybackStarts.end()) {
+            scheduleBroadcastVideoFrames(started->second, std::move(frames));
+            return;
+        }
+        if (timestamp < _playingBroadcastPartTimestamp) {
+            // Its audio has played already.
+            return;
+        }
+        auto &pending = _decodedBroadcastVideoParts[timestamp];
+        pending.insert(pending.end(), std::make_move_iterator(frames.begin()), std::make_move_iterator(frames.end()));
+    }
+
+    // The audio of the part at |timestamp| starts playing at |startMs|; its
+    // video is shown along with it.
+    void onBroadcastPartPlaybackStarted(int64_t timestamp, int64_t startMs) {
+        _playingBroadcastPartTimestamp = timestamp;
+        _broadcastPartPlaybackStarts[timestamp] = startMs;
+        for (auto it = _broadcastPartPlaybackStarts.begin(); it != _broadcastPartPlaybackStarts.end(); ) {
+            // Video decoded late may still catch the end of its part.
+            it = it->first < timestamp - _broadcastPartDurationMilliseconds ? _broadcastPartPlaybackStarts.erase(it) : std::next(it);
+        }
+        for (auto it = _decodedBroadcastVideoParts.begin(); it != _decodedBroadcastVideoParts.end(); ) {
+            if (it->first < timestamp) {
+                it = _decodedBroadcastVideoParts.erase(it);
+            } else if (it->first == timestamp) {
+                scheduleBroadcastVideoFrames(startMs, std::move(it->second));
+                it = _decodedBroadcastVideoParts.erase(it);
+            } else {
+                break;
+            }
+        }
+    }
+
+    void scheduleBroadcastVideoFrames(int64_t startMs, std::vector<VideoStreamingPart::Frame> &&frames) {
+        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
+        const int64_t now = rtc::TimeMillis();
+        for (size_t i = 0; i < frames.size(); i++) {
+            const int64_t delayMs = startMs + frames[i].offsetMilliseconds - now;
+            // Of the frames already due, only the last of an endpoint is
+            // still worth showing.
+            if (delayMs < 0 && i + 1 < frames.size() && frames[i + 1].endpointId == frames[i].endpointId && startMs + frames[i + 1].offsetMilliseconds <= now) {
+                continue;
+            }
+            _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak, frame = std::move(frames[i])]() {
+                auto strong = weak.lock();
+                if (!strong) {
+                    return;
+                }
+                strong->deliverBroadcastVideoFrame(frame);
+            }, (int)std::max<int64_t>(0, delayMs));
+        }
+    }
+
+    void deliverBroadcastVideoFrame(VideoStreamingPart::Frame const &frame) {
+        if (_connectionMode != GroupConnectionMode::GroupConnectionModeBroadcast && !_broadcastEnabledUntilRtcIsConnectedAtTimestamp) {
+            return;
+        }
+        const auto it = _pendingVideoSinks.find(VideoChannelId(frame.endpointId));
+        if (it == _pendingVideoSinks.end()) {
+            return;
+        }
+        webrtc::VideoRotation rotation = webrtc::kVideoRotation_0;
+        switch (frame.rotation) {
+            case 90:
+                rotation = webrtc::kVideoRotation_90;
+                break;
+            case 180:
+                rotation = webrtc::kVideoRotation_180;
+                break;
+            case 270:
+                rotation = webrtc::kVideoRotation_270;
+                break;
+            default:
+                break;
+        }
+        const auto videoFrame = webrtc::VideoFrame::Builder()
+            .set_video_frame_buffer(frame.buffer)
+            .set_rotation(rotation)
+            .set_timestamp_us(rtc::TimeMicros())
+            .build();
+        for (const auto &output : it->second) {
+            if (const auto sink = output.sink.lock()) {
+                sink->OnFrame(videoFrame);
+            }
+        }
+    }
+
+    void cancelBroadcastPartRequests() {
+        for (auto &it : _requestedBroadcastParts) {
+            if (it.second.task) {
+                it.second.task->cancel();
             }
-            _currentRequestedBroadcastPart.reset();
         }
-        _currentRequestedBroadcastPart.emplace(requestedPartId, task);
+        _requestedBroadcastParts.clear();
+        _reorderedBroadcastParts.clear();
+        for (auto &it : _requestedBroadcastVideoParts) {
+            if (it.second) {
+                it.second->cancel();
+            }
+        }
+        _requestedBroadcastVideoParts.clear();
+        _fetchedBroadcastVideoParts.clear();
+        _decodedBroadcastVideoParts.clear();
+        _broadcastPartPlaybackStarts.clear();
+        updateBroadcastStats();
     }
 
     void requestNextBroadcastPartWithDelay(int timeoutMs) {
@@ -2143,13 +4951,57 @@ public:
         }, timeoutMs);
     }
 
-    void onReceivedNextBroadcastPart(BroadcastPart &&part) {
-        _currentRequestedBroadcastPart.reset();
-
+    void onReceivedBroadcastPart(int64_t requestedPartId, BroadcastPart &&part) {
         if (_connectionMode != GroupConnectionMode::GroupConnectionModeBroadcast && !_broadcastEnabledUntilRtcIsConnectedAtTimestamp) {
             return;
         }
 
+        if (part.status == BroadcastPart::Status::Success) {
+            HotPathCounters::onBroadcastPartFetched();
+        }
+
+        if (requestedPartId != _nextBroadcastTimestampMilliseconds) {
+            // Prefetched ahead of playback: kept until the parts before it
+            // have arrived. Anything else is re-requested once it is due.
+            if (part.status == BroadcastPart::Status::Success && requestedPartId > _nextBroadcastTimestampMilliseconds) {
+                _lastBroadcastPartReceivedTimestamp = rtc::TimeMillis();
+                _reorderedBroadcastParts.emplace(requestedPartId, std::move(part));
+                updateBroadcastStats();
+            } else if (part.status == BroadcastPart::Status::Success) {
+                HotPathCounters::onBroadcastPartLate();
+            }
+            return;
+        }
+
+        int64_t responseTimestampMilliseconds = onReceivedNextBroadcastPart(std::move(part));
+
+        // Parts prefetched right behind it can follow straight away.
+        while (!_reorderedBroadcastParts.empty()) {
+            auto it = _reorderedBroadcastParts.begin();
+            if (it->first < _nextBroadcastTimestampMilliseconds) {
+                HotPathCounters::onBroadcastPartLate();
+                _reorderedBroadcastParts.erase(it);
+            } else if (it->first == _nextBroadcastTimestampMilliseconds) {
+                auto nextPart = std::move(it->second);
+                _reorderedBroadcastParts.erase(it);
+                responseTimestampMilliseconds = onReceivedNextBroadcastPart(std::move(nextPart));
+            } else {
+                break;
+            }
+        }
+        updateBroadcastStats();
+
+        int64_t nextDelay = _nextBroadcastTimestampMilliseconds - responseTimestampMilliseconds;
+        int clippedDelay = std::max((int)nextDelay, 100);
+
+        //RTC_LOG(LS_INFO) << "requestNextBroadcastPartWithDelay(" << clippedDelay << ") (from " << nextDelay << ")";
+
+        requestNextBroadcastPartWithDelay(clippedDelay);
+    }
+
+    // Handles the part at |_nextBroadcastTimestampMilliseconds| and moves on
+    // to the one after it; returns the part's response timestamp.
+    int64_t onReceivedNextBroadcastPart(BroadcastPart &&part) {
         int64_t responseTimestampMilliseconds = (int64_t)(part.responseTimestamp * 1000.0);
 
         int64_t responseTimestampBoundary = (responseTimestampMilliseconds / _broadcastPartDurationMilliseconds) * _broadcastPartDurationMilliseconds;
@@ -2164,7 +5016,7 @@ public:
                 } else {
                     _nextBroadcastTimestampMilliseconds = part.timestampMilliseconds + _broadcastPartDurationMilliseconds;
                 }
-                _sourceBroadcastParts.emplace_back(new StreamingPart(std::move(part.oggData)));
+                decodeBroadcastPart(part.timestampMilliseconds, std::move(part.oggData));
                 break;
             }
             case BroadcastPart::Status::NotReady: {
@@ -2172,6 +5024,8 @@ public:
                 break;
             }
             case BroadcastPart::Status::ResyncNeeded: {
+                // Requested after the server stopped having it.
+                HotPathCounters::onBroadcastPartLate();
                 _nextBroadcastTimestampMilliseconds = responseTimestampBoundary;
                 break;
             }
@@ -2181,34 +5035,32 @@ public:
             }
         }
 
-        int64_t nextDelay = _nextBroadcastTimestampMilliseconds - responseTimestampMilliseconds;
-        int clippedDelay = std::max((int)nextDelay, 100);
-
-        //RTC_LOG(LS_INFO) << "requestNextBroadcastPartWithDelay(" << clippedDelay << ") (from " << nextDelay << ")";
-
-        requestNextBroadcastPartWithDelay(clippedDelay);
+        return responseTimestampMilliseconds;
     }
 
-    void beginBroadcastPartsDecodeTimer(int timeoutMs) {
-        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
-        _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak]() {
-            auto strong = weak.lock();
-            if (!strong) {
-                return;
+    void updateBroadcastStats() {
+        int decodingParts = 0;
+        for (const auto &part : _sourceBroadcastParts) {
+            if (!part->isDecoded) {
+                decodingParts++;
             }
+        }
+        _broadcastCounters->update(broadcastQueueMilliseconds(), decodingParts, (int)_requestedBroadcastParts.size(), (int)_reorderedBroadcastParts.size());
+    }
 
-            if (strong->_connectionMode != GroupConnectionMode::GroupConnectionModeBroadcast && !strong->_broadcastEnabledUntilRtcIsConnectedAtTimestamp) {
+    void beginBroadcastPartsDecodeTimer(int timeoutMs) {
+        _broadcastPartsDecodeTimer.start(GroupTimerWheel::forThread(_threads->getMediaThread()), timeoutMs, 20, [this]() {
+            if (_connectionMode != GroupConnectionMode::GroupConnectionModeBroadcast && !_broadcastEnabledUntilRtcIsConnectedAtTimestamp) {
+                _broadcastPartsDecodeTimer.stop();
                 return;
             }
 
-            strong->commitBroadcastPackets();
-
-            strong->beginBroadcastPartsDecodeTimer(20);
-        }, timeoutMs);
+            commitBroadcastPackets();
+        });
     }
 
     void configureVideoParams() {
-        if (!_sharedVideoInformation) {
+        if (!_sharedVideoInformation || !_isVideoInitialized) {
             return;
         }
         if (_selectedPayloadType) {
@@ -2216,7 +5068,7 @@ public:
             return;
         }
 
-        _availablePayloadTypes = assignPayloadTypes(_availableVideoFormats);
+        _availablePayloadTypes = _videoFormatTables->payloadTypes;
         if (_availablePayloadTypes.empty()) {
             return;
         }
@@ -2337,6 +5189,7 @@ public:
 
     void OnRtcpPacketReceived_n(rtc::CopyOnWriteBuffer *buffer, int64_t packet_time_us) {
         rtc::CopyOnWriteBuffer packet = *buffer;
+        _packetDeliveryCounters->onThreadHop(1);
         _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafery, [this, packet, packet_time_us] {
             if (_call) {
                 _call->Receiver()->DeliverPacket(webrtc::MediaType::ANY, packet, packet_time_us);
@@ -2353,16 +5206,16 @@ public:
                 preferences.start_bitrate_bps = std::max(preferences.min_bitrate_bps, 400 * 1000);
             }
             if (_videoContentType == VideoContentType::Screencast) {
-                preferences.max_bitrate_bps = std::max(preferences.min_bitrate_bps, (1020 + 32) * 1000);
+                preferences.max_bitrate_bps = std::max(preferences.min_bitrate_bps, (1020 + _outgoingAudioProfile.maxBitrateKbit) * 1000);
             } else {
-                preferences.max_bitrate_bps = std::max(preferences.min_bitrate_bps, (1020 + 32) * 1000);
+                preferences.max_bitrate_bps = std::max(preferences.min_bitrate_bps, (1020 + _outgoingAudioProfile.maxBitrateKbit) * 1000);
             }
         } else {
-            preferences.min_bitrate_bps = 32000;
+            preferences.min_bitrate_bps = _outgoingAudioProfile.minBitrateKbit * 1000;
             if (resetStartBitrate) {
-                preferences.start_bitrate_bps = 32000;
+                preferences.start_bitrate_bps = _outgoingAudioProfile.startBitrateKbit * 1000;
             }
-            preferences.max_bitrate_bps = 32000;
+            preferences.max_bitrate_bps = _outgoingAudioProfile.maxBitrateKbit * 1000;
         }
 
         settings.min_bitrate_bps = preferences.min_bitrate_bps;
@@ -2370,9 +5223,9 @@ public:
         settings.max_bitrate_bps = preferences.max_bitrate_bps;
 
         _call->GetTransportControllerSend()->SetSdpBitrateParameters(preferences);
-		_threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [&]() {
-			_call->SetClientBitratePreferences(settings);
-		});
+        _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafery, [this, settings]() {
+            _call->SetClientBitratePreferences(settings);
+        }));
     }
 
     void setIsRtcConnected(bool isConnected) {
@@ -2381,19 +5234,16 @@ public:
         }
         _isRtcConnected = isConnected;
 
-        RTC_LOG(LS_INFO) << formatTimestampMillis(rtc::TimeMillis()) << ": " << "setIsRtcConnected: " << _isRtcConnected;
+        RTC_LOG(LS_INFO) << "setIsRtcConnected: " << _isRtcConnected;
 
-        if (_broadcastEnabledUntilRtcIsConnectedAtTimestamp) {
-            _broadcastEnabledUntilRtcIsConnectedAtTimestamp = absl::nullopt;
-            if (_currentRequestedBroadcastPart) {
-                if (_currentRequestedBroadcastPart->task) {
-                    _currentRequestedBroadcastPart->task->cancel();
-                }
-                _currentRequestedBroadcastPart.reset();
-            }
+        if (!isConnected && _rtcEnabledUntilBroadcastIsConnectedAtTimestamp) {
+            // Nothing left to keep for broadcast to take over from.
+            endRtcTransition();
         }
 
         updateIsConnected();
+        // A broadcast kept playing is faded out, and stopped after.
+        updateBroadcastMix(true);
     }
 
     void updateIsConnected() {
@@ -2418,6 +5268,9 @@ public:
             }
             case GroupConnectionMode::GroupConnectionModeBroadcast: {
                 isEffectivelyConnected = _isBroadcastConnected;
+                if (_rtcEnabledUntilBroadcastIsConnectedAtTimestamp && _isRtcConnected) {
+                    isEffectivelyConnected = true;
+                }
                 break;
             }
         }
@@ -2432,6 +5285,19 @@ public:
             if (_networkStateUpdated) {
                 _networkStateUpdated(_effectiveNetworkState);
             }
+            if (_effectiveNetworkState.isConnected) {
+                for (auto &completion : std::exchange(_connectedCompletions, {})) {
+                    completion();
+                }
+            }
+        }
+    }
+
+    void whenConnected(std::function<void()> completion) {
+        if (_effectiveNetworkState.isConnected) {
+            completion();
+        } else {
+            _connectedCompletions.push_back(std::move(completion));
         }
     }
 
@@ -2446,7 +5312,9 @@ public:
         }
     }
 
-    void receivePacket(rtc::CopyOnWriteBuffer const &packet, bool isUnresolved) {
+    // |header| is as the network thread parsed it.
+    void receivePacket(rtc::CopyOnWriteBuffer const &packet, GroupRtpPacketHeader const &header, bool isUnresolved) {
+      TraceScope trace("media", "receivePacket");
       if (packet.size() >= 4) {
             if (packet.data()[0] == 0x13 && packet.data()[1] == 0x88 && packet.data()[2] == 0x13 && packet.data()[3] == 0x88) {
                 // SCTP packet header (source port 5000, destination port 5000)
@@ -2454,20 +5322,15 @@ public:
             }
         }
 
-        webrtc::RtpUtility::RtpHeaderParser rtpParser(packet.data(), packet.size());
-
-        webrtc::RTPHeader header;
-        if (rtpParser.RTCP()) {
-            if (!rtpParser.ParseRtcp(&header)) {
-                RTC_LOG(LS_INFO) << "Could not parse rtcp header";
-                return;
-            }
-
-            _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this, packet]() {
-                _call->Receiver()->DeliverPacket(webrtc::MediaType::ANY, packet, -1);
-            });
+        if (header.type == GroupRtpPacketHeader::Type::Rtcp) {
+            _packetDeliveryCounters->onThreadHop(1);
+            _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafery, [this, packet] {
+                if (_call) {
+                    _call->Receiver()->DeliverPacket(webrtc::MediaType::ANY, packet, -1);
+                }
+            }));
         } else {
-            if (!rtpParser.Parse(&header)) {
+            if (!header.isRtp()) {
                 // Probably a data channel message
                 return;
             }
@@ -2476,10 +5339,12 @@ public:
                 return;
             }
 
+            _startupTimings->onRtpPacket();
+
             auto ssrcInfo = _channelBySsrc.find(header.ssrc);
             if (ssrcInfo == _channelBySsrc.end()) {
                 // opus
-                if (header.payloadType == 111) {
+                if (header.payloadType == 111 && !_disableIncomingChannels) {
                     maybeRequestUnknownSsrc(header.ssrc);
                     _missingPacketBuffer.add(header.ssrc, packet);
                 }
@@ -2505,60 +5370,75 @@ public:
     }
 
     void receiveRtcpPacket(rtc::CopyOnWriteBuffer const &packet, int64_t timestamp) {
-        _threads->getWorkerThread()->PostTask(RTC_FROM_HERE, [this, packet, timestamp]() {
-            _call->Receiver()->DeliverPacket(webrtc::MediaType::ANY, packet, timestamp);
-        });
+        _packetDeliveryCounters->onThreadHop(1);
+        _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafery, [this, packet, timestamp] {
+            if (_call) {
+                _call->Receiver()->DeliverPacket(webrtc::MediaType::ANY, packet, timestamp);
+            }
+        }));
     }
 
-    void receiveDataChannelMessage(std::string const &message) {
-        std::string parsingError;
-        auto json = json11::Json::parse(message, parsingError);
-        if (json.type() != json11::Json::OBJECT) {
-            RTC_LOG(LS_WARNING) << "receiveDataChannelMessage: error parsing message: " << parsingError;
-            return;
-        }
-
-        if (json.is_object()) {
-            const auto colibriClass = json.object_items().find("colibriClass");
-            if (colibriClass != json.object_items().end() && colibriClass->second.is_string()) {
-                const auto messageType = colibriClass->second.string_value();
-                if (messageType == "SenderVideoConstraints") {
-                    const auto videoConstraints = json.object_items().find("videoConstraints");
-                    if (videoConstraints != json.object_items().end() && videoConstraints->second.is_object()) {
-                        const auto idealHeight = videoConstraints->second.object_items().find("idealHeight");
-                        if (idealHeight != videoConstraints->second.object_items().end() && idealHeight->second.is_number()) {
-                            int outgoingVideoConstraint = idealHeight->second.int_value();
-                            if (_outgoingVideoConstraint != outgoingVideoConstraint) {
-                                if (_outgoingVideoConstraint > outgoingVideoConstraint) {
-                                    _pendingOutgoingVideoConstraint = outgoingVideoConstraint;
-
-                                    int requestId = _pendingOutgoingVideoConstraintRequestId;
-                                    _pendingOutgoingVideoConstraintRequestId += 1;
-
-                                    const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
-                                    _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak, requestId]() {
-                                        auto strong = weak.lock();
-                                        if (!strong) {
-                                            return;
-                                        }
-                                        if (strong->_pendingOutgoingVideoConstraint != -1 && strong->_pendingOutgoingVideoConstraintRequestId == requestId) {
-                                            if (strong->_outgoingVideoConstraint != strong->_pendingOutgoingVideoConstraint) {
-                                                strong->_outgoingVideoConstraint = strong->_pendingOutgoingVideoConstraint;
-                                                strong->adjustVideoSendParams();
-                                            }
-                                            strong->_pendingOutgoingVideoConstraint = -1;
-                                        }
-                                    }, 2000);
-                                } else {
-                                    _pendingOutgoingVideoConstraint = -1;
-                                    _pendingOutgoingVideoConstraintRequestId += 1;
-                                    _outgoingVideoConstraint = outgoingVideoConstraint;
-                                    adjustVideoSendParams();
-                                }
-                            }
+    void receiveDataChannelMessage(std::string const &message) {
+        // Only the class and one nested number are needed, so the message
+        // is walked in place rather than parsed into a document; members
+        // may come in any order.
+        JsonReader reader(message);
+        absl::string_view messageType;
+        absl::optional<int32_t> idealHeight;
+        const auto isObject = (reader.type() == JsonReader::Type::Object);
+        if (isObject) {
+            reader.readObject([&](absl::string_view key) {
+                if (key == "colibriClass" && reader.type() == JsonReader::Type::String) {
+                    reader.readString(messageType);
+                } else if (key == "videoConstraints" && reader.type() == JsonReader::Type::Object) {
+                    reader.readObject([&](absl::string_view key) {
+                        int32_t value = 0;
+                        if (key == "idealHeight" && reader.type() == JsonReader::Type::Number && reader.readInt(value)) {
+                            idealHeight = value;
+                        } else {
+                            reader.skipValue();
+                        }
+                    });
+                } else {
+                    reader.skipValue();
+                }
+            });
+        }
+        if (!isObject || !reader.finish()) {
+            RTC_LOG(LS_WARNING) << "receiveDataChannelMessage: error parsing message";
+            return;
+        }
+
+        if (messageType != "SenderVideoConstraints" || !idealHeight) {
+            return;
+        }
+        int outgoingVideoConstraint = idealHeight.value();
+        if (_outgoingVideoConstraint != outgoingVideoConstraint) {
+            if (_outgoingVideoConstraint > outgoingVideoConstraint) {
+                _pendingOutgoingVideoConstraint = outgoingVideoConstraint;
+
+                int requestId = _pendingOutgoingVideoConstraintRequestId;
+                _pendingOutgoingVideoConstraintRequestId += 1;
+
+                const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
+                _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak, requestId]() {
+                    auto strong = weak.lock();
+                    if (!strong) {
+                        return;
+                    }
+                    if (strong->_pendingOutgoingVideoConstraint != -1 && strong->_pendingOutgoingVideoConstraintRequestId == requestId) {
+                        if (strong->_outgoingVideoConstraint != strong->_pendingOutgoingVideoConstraint) {
+                            strong->_outgoingVideoConstraint = strong->_pendingOutgoingVideoConstraint;
+                            strong->adjustVideoSendParams();
                         }
+                        strong->_pendingOutgoingVideoConstraint = -1;
                     }
-                }
+                }, 2000);
+            } else {
+                _pendingOutgoingVideoConstraint = -1;
+                _pendingOutgoingVideoConstraintRequestId += 1;
+                _outgoingVideoConstraint = outgoingVideoConstraint;
+                adjustVideoSendParams();
             }
         }
     }
@@ -2571,33 +5451,81 @@ public:
             return;
         }
 
-        for (const auto &it : _requestedMediaChannelDescriptions) {
-            if (std::find(it.second.ssrcs.begin(), it.second.ssrcs.end(), ssrc) != it.second.ssrcs.end()) {
-                return;
-            }
+        // Pending or in flight already.
+        if (!_requestedUnknownSsrcs.insert(ssrc).second) {
+            return;
         }
+        _pendingUnknownSsrcs.push_back(ssrc);
+        scheduleUnknownSsrcsRequest();
+    }
 
-        int requestId = _nextMediaChannelDescriptionsRequestId;
-        _nextMediaChannelDescriptionsRequestId += 1;
-
-        std::vector<uint32_t> requestSsrcs = { ssrc };
+    void scheduleUnknownSsrcsRequest() {
+        if (_isUnknownSsrcsRequestScheduled || _pendingUnknownSsrcs.empty()) {
+            return;
+        }
+        // A response arriving sends what gathered meanwhile.
+        if (_requestedMediaChannelDescriptions.size() >= kMaxMediaChannelDescriptionsRequestsInFlight) {
+            return;
+        }
+        _isUnknownSsrcsRequestScheduled = true;
 
         const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
-        auto task = _requestMediaChannelDescriptions(requestSsrcs, [weak, threads = _threads, requestId](std::vector<MediaChannelDescription> &&descriptions) {
-            threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, requestId, descriptions = std::move(descriptions)]() mutable {
-                auto strong = weak.lock();
-                if (!strong) {
-                    return;
+        _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak]() {
+            auto strong = weak.lock();
+            if (!strong) {
+                return;
+            }
+            strong->_isUnknownSsrcsRequestScheduled = false;
+            strong->requestUnknownSsrcs();
+        }, kUnknownSsrcsRequestDelayMs);
+    }
+
+    void requestUnknownSsrcs() {
+        while (!_pendingUnknownSsrcs.empty() && _requestedMediaChannelDescriptions.size() < kMaxMediaChannelDescriptionsRequestsInFlight) {
+            std::vector<uint32_t> requestSsrcs;
+            while (!_pendingUnknownSsrcs.empty() && requestSsrcs.size() < kMaxUnknownSsrcsPerRequest) {
+                const auto ssrc = _pendingUnknownSsrcs.front();
+                _pendingUnknownSsrcs.pop_front();
+                // Known by now, as from a participant update.
+                if (_channelBySsrc.find(ssrc) != _channelBySsrc.end()) {
+                    _requestedUnknownSsrcs.erase(ssrc);
+                    continue;
                 }
+                requestSsrcs.push_back(ssrc);
+            }
+            if (requestSsrcs.empty()) {
+                continue;
+            }
+
+            int requestId = _nextMediaChannelDescriptionsRequestId;
+            _nextMediaChannelDescriptionsRequestId += 1;
+
+            const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
+            auto task = _requestMediaChannelDescriptions(requestSsrcs, [weak, threads = _threads, requestId](std::vector<MediaChannelDescription> &&descriptions) {
+                threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, requestId, descriptions = std::move(descriptions)]() mutable {
+                    auto strong = weak.lock();
+                    if (!strong) {
+                        return;
+                    }
 
-                strong->processMediaChannelDescriptionsResponse(requestId, descriptions);
+                    strong->processMediaChannelDescriptionsResponse(requestId, descriptions);
+                });
             });
-        });
-        _requestedMediaChannelDescriptions.insert(std::make_pair(requestId, RequestedMediaChannelDescriptions(task, std::move(requestSsrcs))));
+            _requestedMediaChannelDescriptions.insert(std::make_pair(requestId, RequestedMediaChannelDescriptions(task, std::move(requestSsrcs))));
+        }
     }
 
     void processMediaChannelDescriptionsResponse(int requestId, std::vector<MediaChannelDescription> const &descriptions) {
-        _requestedMediaChannelDescriptions.erase(requestId);
+        const auto request = _requestedMediaChannelDescriptions.find(requestId);
+        if (request != _requestedMediaChannelDescriptions.end()) {
+            // Those the response leaves out are asked for again should
+            // their packets keep coming.
+            for (const auto ssrc : request->second.ssrcs) {
+                _requestedUnknownSsrcs.erase(ssrc);
+            }
+            _requestedMediaChannelDescriptions.erase(request);
+        }
+        scheduleUnknownSsrcsRequest();
 
         if (_disableIncomingChannels) {
             return;
@@ -2622,9 +5550,11 @@ public:
     }
 
     void maybeDeliverBufferedPackets(uint32_t ssrc) {
+        // The packets are released either way, so they don't hold ring slots
+        // that should go to SSRCs that are still unknown.
+        auto packets = _missingPacketBuffer.get(ssrc);
         // TODO: Re-enable after implementing custom transport
-        /*auto packets = _missingPacketBuffer.get(ssrc);
-        if (packets.size() != 0) {
+        /*if (packets.size() != 0) {
             auto it = _ssrcMapping.find(ssrc);
             if (it != _ssrcMapping.end()) {
                 for (const auto &packet : packets) {
@@ -2636,55 +5566,95 @@ public:
         }*/
     }
 
-    void maybeUpdateRemoteVideoConstraints() {
-        if (!_isDataChannelOpen) {
+    // Output changes come in bursts, as when a layout replaces all of its
+    // sinks, so the constraints they lead to are sent once they settle.
+    // Lowering the quality waits longer, so that a sink being swapped for
+    // another doesn't make the server switch layers back and forth.
+    void scheduleRemoteVideoConstraintsUpdate(bool isUpgrade) {
+        const int delayMs = isUpgrade ? 100 : 2000;
+        const int64_t dueMs = rtc::TimeMillis() + delayMs;
+        if (_remoteConstraintsUpdateDueMs != 0 && _remoteConstraintsUpdateDueMs <= dueMs) {
             return;
         }
+        _remoteConstraintsUpdateDueMs = dueMs;
+
+        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
+        _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak, dueMs]() {
+            auto strong = weak.lock();
+            if (!strong || strong->_remoteConstraintsUpdateDueMs != dueMs) {
+                return;
+            }
+            strong->_remoteConstraintsUpdateDueMs = 0;
+            strong->maybeUpdateRemoteVideoConstraints(true);
+        }, delayMs);
+    }
 
-        std::string pinnedEndpoint;
+    // With |onlyIfChanged|, constraints equal to the last ones sent are
+    // left to the periodic update.
+    void maybeUpdateRemoteVideoConstraints(bool onlyIfChanged = false) {
+        if (!_isDataChannelOpen) {
+            return;
+        }
 
-        json11::Json::object json;
-        json.insert(std::make_pair("colibriClass", json11::Json("ReceiverVideoConstraints")));
+        std::string result;
+        result.reserve(128 + 64 * _incomingVideoChannels.size());
+        JsonWriter json(result);
+        json.beginObject();
+        json.key("colibriClass");
+        json.stringValue("ReceiverVideoConstraints");
 
-        json11::Json::object defaultConstraints;
-        defaultConstraints.insert(std::make_pair("maxHeight", json11::Json(0)));
-        json.insert(std::make_pair("defaultConstraints", json11::Json(std::move(defaultConstraints))));
+        if (_audioOnly) {
+            // Not even the endpoints the SFU would pick itself.
+            json.key("lastN");
+            json.intValue(0);
+        }
 
-        json11::Json::array onStageEndpoints;
-        json11::Json::object constraints;
+        json.key("defaultConstraints");
+        json.beginObject();
+        json.key("maxHeight");
+        json.intValue(0);
+        json.endObject();
 
+        json.key("constraints");
+        json.beginObject();
         for (const auto &incomingVideoChannel : _incomingVideoChannels) {
-            json11::Json::object selectedConstraint;
+            json.key(incomingVideoChannel.first.endpointId);
+            json.beginObject();
 
             switch (incomingVideoChannel.second->requestedMinQuality()) {
                 case VideoChannelDescription::Quality::Full: {
-                    selectedConstraint.insert(std::make_pair("minHeight", json11::Json(720)));
+                    json.key("minHeight");
+                    json.intValue(720);
                     break;
                 }
                 case VideoChannelDescription::Quality::Medium: {
-                    selectedConstraint.insert(std::make_pair("minHeight", json11::Json(360)));
+                    json.key("minHeight");
+                    json.intValue(360);
                     break;
                 }
                 case VideoChannelDescription::Quality::Thumbnail: {
-                    selectedConstraint.insert(std::make_pair("minHeight", json11::Json(180)));
+                    json.key("minHeight");
+                    json.intValue(180);
                     break;
                 }
                 default: {
                     break;
                 }
             }
-            switch (incomingVideoChannel.second->requestedMaxQuality()) {
+            switch (incomingVideoChannel.second->maxQuality()) {
                 case VideoChannelDescription::Quality::Full: {
-                    onStageEndpoints.push_back(json11::Json(incomingVideoChannel.first.endpointId));
-                    selectedConstraint.insert(std::make_pair("maxHeight", json11::Json(720)));
+                    json.key("maxHeight");
+                    json.intValue(720);
                     break;
                 }
                 case VideoChannelDescription::Quality::Medium: {
-                    selectedConstraint.insert(std::make_pair("maxHeight", json11::Json(360)));
+                    json.key("maxHeight");
+                    json.intValue(360);
                     break;
                 }
                 case VideoChannelDescription::Quality::Thumbnail: {
-                    selectedConstraint.insert(std::make_pair("maxHeight", json11::Json(180)));
+                    json.key("maxHeight");
+                    json.intValue(180);
                     break;
                 }
                 default: {
@@ -2692,15 +5662,28 @@ public:
                 }
             }
 
-            constraints.insert(std::make_pair(incomingVideoChannel.first.endpointId, json11::Json(std::move(selectedConstraint))));
+            json.endObject();
+        }
+        json.endObject();
+
+        json.key("onStageEndpoints");
+        json.beginArray();
+        for (const auto &incomingVideoChannel : _incomingVideoChannels) {
+            if (incomingVideoChannel.second->maxQuality() == VideoChannelDescription::Quality::Full) {
+                json.stringValue(incomingVideoChannel.first.endpointId);
+            }
         }
+        json.endArray();
+        json.endObject();
 
-        json.insert(std::make_pair("onStageEndpoints", json11::Json(std::move(onStageEndpoints))));
-        json.insert(std::make_pair("constraints", json11::Json(std::move(constraints))));
+        if (onlyIfChanged && result == _lastRemoteVideoConstraints) {
+            return;
+        }
+        _lastRemoteVideoConstraints = result;
 
-        std::string result = json11::Json(std::move(json)).dump();
         _networkManager->perform(RTC_FROM_HERE, [result = std::move(result)](GroupNetworkManager *networkManager) {
-            networkManager->sendDataChannelMessage(result);
+            // Bursts of updates go out as the latest one.
+            networkManager->sendDataChannelMessage(result, "ReceiverVideoConstraints");
         });
     }
 
@@ -2715,20 +5698,45 @@ public:
     void onConnectionModeUpdated(GroupConnectionMode previousMode, bool keepBroadcastIfWasEnabled) {
         RTC_CHECK(_connectionMode != previousMode || _connectionMode == GroupConnectionMode::GroupConnectionModeNone);
 
+        // RTC kept connected from before a switch to broadcast that hasn't
+        // taken over yet: back to RTC, it just carries on.
+        bool isRtcRunning = false;
+        if (_rtcEnabledUntilBroadcastIsConnectedAtTimestamp) {
+            if (_connectionMode == GroupConnectionMode::GroupConnectionModeRtc) {
+                _rtcEnabledUntilBroadcastIsConnectedAtTimestamp = absl::nullopt;
+                isRtcRunning = true;
+            } else {
+                endRtcTransition();
+            }
+        }
+        // Likewise the broadcast kept playing from before a switch to RTC.
+        bool isBroadcastRunning = false;
+        if (_broadcastEnabledUntilRtcIsConnectedAtTimestamp) {
+            if (_connectionMode == GroupConnectionMode::GroupConnectionModeBroadcast) {
+                _broadcastEnabledUntilRtcIsConnectedAtTimestamp = absl::nullopt;
+                isBroadcastRunning = true;
+            } else if (!keepBroadcastIfWasEnabled) {
+                endBroadcastTransition();
+            }
+        }
+
         if (previousMode == GroupConnectionMode::GroupConnectionModeRtc) {
-            _networkManager->perform(RTC_FROM_HERE, [](GroupNetworkManager *networkManager) {
-                networkManager->stop();
-            });
+            if (keepBroadcastIfWasEnabled && _isRtcConnected && _connectionMode == GroupConnectionMode::GroupConnectionModeBroadcast) {
+                // Keeps playing until broadcast has something to play, so
+                // falling back to broadcast leaves no gap.
+                _rtcEnabledUntilBroadcastIsConnectedAtTimestamp = rtc::TimeMillis();
+            } else {
+                _networkManager->perform(RTC_FROM_HERE, [](GroupNetworkManager *networkManager) {
+                    networkManager->stop();
+                });
+            }
         } else if (previousMode == GroupConnectionMode::GroupConnectionModeBroadcast) {
             if (keepBroadcastIfWasEnabled) {
                 _broadcastEnabledUntilRtcIsConnectedAtTimestamp = rtc::TimeMillis();
             } else {
-                if (_currentRequestedBroadcastPart) {
-                    if (_currentRequestedBroadcastPart->task) {
-                        _currentRequestedBroadcastPart->task->cancel();
-                    }
-                    _currentRequestedBroadcastPart.reset();
-                }
+                cancelBroadcastPartRequests();
+                _sourceBroadcastParts.clear();
+                _directBroadcastChannels.clear();
             }
         }
 
@@ -2750,18 +5758,22 @@ public:
                 break;
             }
             case GroupConnectionMode::GroupConnectionModeRtc: {
-                _networkManager->perform(RTC_FROM_HERE, [](GroupNetworkManager *networkManager) {
-                    networkManager->start();
-                });
+                if (!isRtcRunning) {
+                    _networkManager->perform(RTC_FROM_HERE, [](GroupNetworkManager *networkManager) {
+                        networkManager->start();
+                    });
+                }
                 break;
             }
             case GroupConnectionMode::GroupConnectionModeBroadcast: {
-                _broadcastTimestamp = 100001;
+                if (!isBroadcastRunning) {
+                    _broadcastTimestamp = 100001;
 
-                _isBroadcastConnected = false;
+                    _isBroadcastConnected = false;
 
-                beginBroadcastPartsDecodeTimer(0);
-                requestNextBroadcastPart();
+                    beginBroadcastPartsDecodeTimer(0);
+                    requestNextBroadcastPart();
+                }
 
                 break;
             }
@@ -2772,14 +5784,23 @@ public:
         }
 
         updateIsConnected();
+        updateBroadcastMix(keepBroadcastIfWasEnabled);
     }
 
     void generateSsrcs() {
-        auto generator = std::mt19937(std::random_device()());
-        auto distribution = std::uniform_int_distribution<uint32_t>();
-        do {
-            _outgoingAudioSsrc = distribution(generator) & 0x7fffffffU;
-        } while (!_outgoingAudioSsrc);
+        if (_migratedOutgoingAudioSsrc) {
+            // Only the first join keeps it; a rejoin after leaving draws anew.
+            _outgoingAudioSsrc = _migratedOutgoingAudioSsrc;
+            _migratedOutgoingAudioSsrc = 0;
+        } else {
+            auto generator = std::mt19937(std::random_device()());
+            auto distribution = std::uniform_int_distribution<uint32_t>();
+            do {
+                _outgoingAudioSsrc = distribution(generator) & 0x7fffffffU;
+            } while (!_outgoingAudioSsrc);
+        }
+        _unresolvedPacketFilter->setOutgoingAudioSsrc(_outgoingAudioSsrc);
+        _ssrcsRevision++;
 
         uint32_t outgoingVideoSsrcBase = _outgoingAudioSsrc + 1;
         int numVideoSimulcastLayers = 3;
@@ -2819,7 +5840,18 @@ public:
     }
 
     void emitJoinPayload(std::function<void(GroupJoinPayload const &)> completion) {
-        _networkManager->perform(RTC_FROM_HERE, [outgoingAudioSsrc = _outgoingAudioSsrc, /*videoPayloadTypes = _videoPayloadTypes, videoExtensionMap = _videoExtensionMap, */videoSourceGroups = _videoSourceGroups, videoContentType = _videoContentType, completion](GroupNetworkManager *networkManager) {
+        _networkManager->perform(RTC_FROM_HERE, [outgoingAudioSsrc = _outgoingAudioSsrc, /*videoPayloadTypes = _videoPayloadTypes, videoExtensionMap = _videoExtensionMap, */videoSourceGroups = _videoSourceGroups, videoContentType = _videoContentType, startupTimings = _startupTimings, ssrcsRevision = _ssrcsRevision, cache = _joinPayloadCache, completion](GroupNetworkManager *networkManager) {
+            auto localIceParameters = networkManager->getLocalIceParameters();
+            auto localCertificate = networkManager->getLocalCertificate();
+            if (cache->ssrcsRevision == ssrcsRevision
+                && cache->iceParameters.ufrag == localIceParameters.ufrag
+                && cache->iceParameters.pwd == localIceParameters.pwd
+                && cache->certificate == localCertificate) {
+                startupTimings->onJoinPayload();
+                completion(cache->payload);
+                return;
+            }
+
             GroupJoinInternalPayload payload;
 
             payload.audioSsrc = outgoingAudioSsrc;
@@ -2832,7 +5864,6 @@ public:
 
             GroupJoinTransportDescription transportDescription;
 
-            auto localIceParameters = networkManager->getLocalIceParameters();
             transportDescription.ufrag = localIceParameters.ufrag;
             transportDescription.pwd = localIceParameters.pwd;
 
@@ -2850,6 +5881,13 @@ public:
             GroupJoinPayload result;
             result.audioSsrc = payload.audioSsrc;
             result.json = payload.serialize();
+
+            cache->ssrcsRevision = ssrcsRevision;
+            cache->iceParameters = std::move(localIceParameters);
+            cache->certificate = std::move(localCertificate);
+            cache->payload = result;
+
+            startupTimings->onJoinPayload();
             completion(result);
         });
     }
@@ -2861,6 +5899,9 @@ public:
         }
 
         _getVideoSource = std::move(getVideoSource);
+        if (_getVideoSource) {
+            ensureVideoInitialized();
+        }
 		updateVideoSend();
         if (resetBitrate) {
             adjustBitratePreferences(true);
@@ -2892,34 +5933,31 @@ public:
         if (samples.size() % 2 != 0) {
             return;
         }
-        _externalAudioSamplesMutex.Lock();
-
-        size_t previousSize = _externalAudioSamples.size();
-        _externalAudioSamples.resize(_externalAudioSamples.size() + samples.size() / 2);
-        webrtc::S16ToFloatS16((const int16_t *)samples.data(), samples.size() / 2, _externalAudioSamples.data() + previousSize);
-
-        if (_externalAudioSamples.size() > 2 * 48000) {
-            _externalAudioSamples.erase(_externalAudioSamples.begin(), _externalAudioSamples.begin() + (_externalAudioSamples.size() - 2 * 48000));
-        }
-
-        _externalAudioSamplesMutex.Unlock();
+        _externalAudioSamples->write((const int16_t *)samples.data(), samples.size() / 2);
     }
 
     void setJoinResponsePayload(std::string const &payload) {
-        RTC_LOG(LS_INFO) << formatTimestampMillis(rtc::TimeMillis()) << ": " << "setJoinResponsePayload";
+        RTC_LOG(LS_INFO) << "setJoinResponsePayload";
 
         auto parsedPayload = GroupJoinResponsePayload::parse(payload);
         if (!parsedPayload) {
             RTC_LOG(LS_ERROR) << "Could not parse json response payload";
             return;
         }
+        _lastJoinResponsePayload = payload;
 
+        // Reconnects repeat nearly the same payload, so the probing channel
+        // is only rebuilt when the video setup changed, and the network
+        // manager applies only the transport differences.
+        const auto videoInformationChanged = !(_sharedVideoInformation == parsedPayload->videoInformation);
         _sharedVideoInformation = parsedPayload->videoInformation;
 
-        _serverBandwidthProbingVideoSsrc.reset();
+        if (videoInformationChanged || !_serverBandwidthProbingVideoSsrc) {
+            _serverBandwidthProbingVideoSsrc.reset();
 
-        if (parsedPayload->videoInformation && parsedPayload->videoInformation->serverVideoBandwidthProbingSsrc) {
-            setServerBandwidthProbingChannelSsrc(parsedPayload->videoInformation->serverVideoBandwidthProbingSsrc);
+            if (parsedPayload->videoInformation && parsedPayload->videoInformation->serverVideoBandwidthProbingSsrc) {
+                setServerBandwidthProbingChannelSsrc(parsedPayload->videoInformation->serverVideoBandwidthProbingSsrc);
+            }
         }
 
         _networkManager->perform(RTC_FROM_HERE, [parsedTransport = parsedPayload->transport](GroupNetworkManager *networkManager) {
@@ -2986,13 +6024,14 @@ public:
             _call.get(),
             _rtpTransport,
             _uniqueRandomIdGenerator.get(),
-            _availableVideoFormats,
+            *_videoFormatTables,
             _sharedVideoInformation.value(),
             123456,
             VideoChannelDescription::Quality::Thumbnail,
             VideoChannelDescription::Quality::Thumbnail,
             videoInformation,
-            _threads
+            _threads,
+            nullptr
         ));
 
         ChannelSsrcInfo mapping;
@@ -3002,27 +6041,34 @@ public:
     }
 
     void removeSsrcs(std::vector<uint32_t> ssrcs) {
-        /*bool updatedIncomingVideoChannels = false;
+        GroupInstanceCustomImpl::ParticipantsUpdate update;
+        update.removedSsrcs = std::move(ssrcs);
+        updateParticipants(update);
+    }
 
-        for (auto ssrc : ssrcs) {
-            auto it = _ssrcMapping.find(ssrc);
-            if (it != _ssrcMapping.end()) {
-                auto mainSsrc = it->second.ssrc;
-                auto audioChannel = _incomingAudioChannels.find(ChannelId(mainSsrc));
-                if (audioChannel != _incomingAudioChannels.end()) {
-                    _incomingAudioChannels.erase(audioChannel);
-                }
-                auto videoChannel = _incomingVideoChannels.find(mainSsrc);
-                if (videoChannel != _incomingVideoChannels.end()) {
-                    _incomingVideoChannels.erase(videoChannel);
-                    updatedIncomingVideoChannels = true;
-                }
+    // Applies the whole update in this media thread task, with the worker
+    // thread work of all the channels in one round trip.
+    void updateParticipants(GroupInstanceCustomImpl::ParticipantsUpdate const &update) {
+        WorkerThreadBatch batch;
+
+        for (auto ssrc : update.removedSsrcs) {
+            removeIncomingAudioChannel(ChannelId(ssrc), &batch);
+            removeIncomingAudioChannel(ChannelId(ssrc + 1000, ssrc), &batch);
+        }
+        for (const auto &it : update.volumes) {
+            setVolume(it.first, it.second, &batch);
+        }
+        if (!_disableIncomingChannels) {
+            for (auto ssrc : update.addedSsrcs) {
+                addIncomingAudioChannel(ChannelId(ssrc), false, &batch);
             }
         }
 
-        if (updatedIncomingVideoChannels) {
-            updateIncomingVideoSources();
-        }*/
+        batch.commit(_threads->getWorkerThread());
+
+        if (!update.removedSsrcs.empty() || !update.addedSsrcs.empty()) {
+            adjustBitratePreferences(false);
+        }
     }
 
     void removeIncomingVideoSource(uint32_t ssrc) {
@@ -3048,61 +6094,100 @@ public:
 
     void onUpdatedIsMuted() {
         if (_outgoingAudioChannel) {
-            _threads->getWorkerThread()->Invoke<void>(RTC_FROM_HERE, [this]() {
-                _outgoingAudioChannel->media_channel()->SetAudioSend(_outgoingAudioSsrc, !_isMuted, nullptr, &_audioSource);
-                _outgoingAudioChannel->Enable(!_isMuted);
-            });
+            _threads->getWorkerThread()->PostTask(ToQueuedTask(_workerThreadSafery, [this, channel = _outgoingAudioChannel, isMuted = _isMuted]() {
+                channel->media_channel()->SetAudioSend(_outgoingAudioSsrc, !isMuted, nullptr, &_audioSource);
+                channel->Enable(!isMuted);
+            }));
         }
     }
 
     void setIsNoiseSuppressionEnabled(bool isNoiseSuppressionEnabled) {
-        _noiseSuppressionConfiguration->isEnabled = isNoiseSuppressionEnabled;
+        _noiseSuppressionConfiguration->setIsEnabled(isNoiseSuppressionEnabled);
     }
 
-    void addIncomingVideoOutput(std::string const &endpointId, std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink) {
+    void addIncomingVideoOutput(std::string const &endpointId, IncomingVideoOutput const &output) {
         if (_sharedVideoInformation && endpointId == _sharedVideoInformation->endpointId) {
             if (_videoCapture) {
-                _videoCaptureSink->addSink(sink);
+                _videoCaptureSink->addSink(output.sink);
                 _videoCapture->setOutput(_videoCaptureSink);
             }
         } else {
             auto it = _incomingVideoChannels.find(VideoChannelId(endpointId));
             if (it != _incomingVideoChannels.end()) {
-                it->second->addSink(sink);
+                it->second->addOutput(output);
+                updateIncomingVideoOutputs(endpointId);
             } else {
-                _pendingVideoSinks[VideoChannelId(endpointId)].push_back(sink);
+                auto &pending = _pendingVideoSinks[VideoChannelId(endpointId)];
+                for (auto &current : pending) {
+                    if (!current.sink.owner_before(output.sink) && !output.sink.owner_before(current.sink)) {
+                        current.wants = output.wants;
+                        return;
+                    }
+                }
+                pending.push_back(output);
             }
         }
     }
 
-    void addIncomingAudioChannel(ChannelId ssrc, bool isRawPcm = false) {
+    void updateIncomingVideoOutputs(std::string const &endpointId) {
+        auto it = _incomingVideoChannels.find(VideoChannelId(endpointId));
+        if (it == _incomingVideoChannels.end()) {
+            return;
+        }
+        const auto previousQuality = it->second->maxQuality();
+        if (it->second->updateOutputs()) {
+            scheduleRemoteVideoConstraintsUpdate(it->second->maxQuality() > previousQuality);
+        }
+    }
+
+    // With a |batch|, the worker thread work is left to it and bitrate
+    // preferences to the caller.
+    void addIncomingAudioChannel(ChannelId ssrc, bool isRawPcm = false, WorkerThreadBatch *batch = nullptr) {
         if (_incomingAudioChannels.find(ssrc) != _incomingAudioChannels.end()) {
             return;
         }
+        TraceScope trace("media", "addIncomingAudioChannel");
 
-        if (_incomingAudioChannels.size() > 5) {
+        if (ssrc.networkSsrc != 1 && decodedIncomingAudioStreamCount() >= maxDecodedIncomingAudioStreams()) {
             auto timestamp = rtc::TimeMillis();
 
             int64_t minActivity = INT64_MAX;
             ChannelId minActivityChannelId(0, 0);
 
+            float minScore = std::numeric_limits<float>::max();
+            ChannelId minScoreChannelId(0, 0);
+
             for (const auto &it : _incomingAudioChannels) {
                 if (it.first.networkSsrc == 1) {
                     continue;
                 }
                 auto activity = it.second->getActivity();
-                if (activity < minActivity && activity < timestamp - 1000) {
+                if (activity < minActivity && activity < timestamp - _incomingAudioChannelIdleTimeoutMs) {
                     minActivity = activity;
                     minActivityChannelId = it.first;
                 }
+                // Newly bound streams are kept for a while, so two speakers
+                // of similar loudness don't keep displacing each other.
+                if (it.second->getBindTimestamp() < timestamp - _incomingAudioChannelIdleTimeoutMs) {
+                    float score = _incomingAudioLoudness.score(it.first.networkSsrc, timestamp);
+                    if (score < minScore) {
+                        minScore = score;
+                        minScoreChannelId = it.first;
+                    }
+                }
             }
 
             if (minActivityChannelId.networkSsrc != 0) {
-                removeIncomingAudioChannel(minActivityChannelId);
+                removeIncomingAudioChannel(minActivityChannelId, batch);
+            } else if (minScoreChannelId.networkSsrc != 0) {
+                const float switchMargin = 0.1f;
+                if (_incomingAudioLoudness.score(ssrc.networkSsrc, timestamp) > minScore + switchMargin) {
+                    removeIncomingAudioChannel(minScoreChannelId, batch);
+                }
             }
 
-            if (_incomingAudioChannels.size() > 5) {
-                // Wait until there is a channel that hasn't been active in 1 second
+            if (decodedIncomingAudioStreamCount() >= maxDecodedIncomingAudioStreams()) {
+                // Wait until there is a channel that is idle or clearly quieter
                 return;
             }
         }
@@ -3112,37 +6197,49 @@ public:
         std::function<void(AudioSinkImpl::Update)> onAudioSinkUpdate;
         if (ssrc.actualSsrc != ssrc.networkSsrc) {
             if (_audioLevelsUpdated) {
-                onAudioSinkUpdate = [weak, ssrc = ssrc, threads = _threads](AudioSinkImpl::Update update) {
-                    threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, ssrc, update]() {
-                        auto strong = weak.lock();
-                        if (!strong) {
-                            return;
-                        }
-                        InternalGroupLevelValue updated;
-                        updated.value.level = update.level;
-                        updated.value.voice = update.hasSpeech;
-                        updated.timestamp = rtc::TimeMillis();
-                        strong->_audioLevels.insert(std::make_pair(ChannelId(ssrc), std::move(updated)));
-                    });
+                onAudioSinkUpdate = [ssrc = ssrc, hops = _sinkAudioLevelHops](AudioSinkImpl::Update update) {
+                    hops->push(SinkAudioLevelEvent{ ChannelId(ssrc), update, false });
                 };
             }
-        }
-
-        std::unique_ptr<IncomingAudioChannel> channel(new IncomingAudioChannel(
-          _channelManager.get(),
-            _call.get(),
-            _rtpTransport,
-            _uniqueRandomIdGenerator.get(),
-            isRawPcm,
-            ssrc,
-            std::move(onAudioSinkUpdate),
-            _onAudioFrame,
-            _threads
-        ));
-
-        auto volume = _volumeBySsrc.find(ssrc.actualSsrc);
-        if (volume != _volumeBySsrc.end()) {
-            channel->setVolume(volume->second);
+        } else if (_audioLevelsUpdated && _enableIncomingVad && ssrc.networkSsrc != 1) {
+            // Levels keep coming from the RTP audio level extension; only
+            // the speech flag is taken from the native VAD.
+            onAudioSinkUpdate = [ssrc = ssrc, hops = _sinkAudioLevelHops](AudioSinkImpl::Update update) {
+                hops->push(SinkAudioLevelEvent{ ssrc, update, true });
+            };
+        }
+
+        std::unique_ptr<IncomingAudioChannel> channel;
+        if (!isRawPcm && !_incomingAudioChannelPool.empty()) {
+            channel = std::move(_incomingAudioChannelPool.back());
+            _incomingAudioChannelPool.pop_back();
+            channel->bind(ssrc, std::move(onAudioSinkUpdate), _onAudioFrame, _enableIncomingVad, batch);
+            scheduleIncomingAudioChannelPoolRefill();
+        } else {
+            channel.reset(new IncomingAudioChannel(
+              _channelManager.get(),
+                _call.get(),
+                _rtpTransport,
+                _uniqueRandomIdGenerator.get(),
+                isRawPcm,
+                ssrc,
+                std::move(onAudioSinkUpdate),
+                _onAudioFrame,
+                _enableIncomingVad,
+                _incomingAudioProfile,
+                _threads
+            ));
+        }
+
+        const double volume = mixedVolume(ssrc.actualSsrc, ssrc.actualSsrc != ssrc.networkSsrc);
+        if (_audioMixer) {
+            // The gain of an SSRC seen before may be stale.
+            _audioMixer->setGain(ssrc.networkSsrc, volume);
+        } else if (volume != 1.0) {
+            channel->setVolume(volume, batch);
+        }
+        if (ssrc.networkSsrc != 1 && incomingAudioBaseMinimumDelayMs() > 0) {
+            channel->setBaseMinimumDelay(incomingAudioBaseMinimumDelayMs(), batch);
         }
 
         _incomingAudioChannels.insert(std::make_pair(ssrc, std::move(channel)));
@@ -3163,12 +6260,66 @@ public:
 
         maybeDeliverBufferedPackets(ssrc.networkSsrc);
 
-        adjustBitratePreferences(false);
+        if (!batch) {
+            adjustBitratePreferences(false);
+        }
+    }
+
+    webrtc::TaskQueueFactory *taskQueueFactory() const {
+        return _engineContext ? _engineContext->taskQueueFactory() : _taskQueueFactory.get();
+    }
+
+    int decodedIncomingAudioStreamCount() const {
+        int count = (int)_incomingAudioChannels.size();
+        if (_incomingAudioChannels.find(ChannelId(1)) != _incomingAudioChannels.end()) {
+            count--;
+        }
+        return count;
+    }
+
+    void refillIncomingAudioChannelPool() {
+        while ((int)_incomingAudioChannelPool.size() < _incomingAudioChannelPoolSize) {
+            _incomingAudioChannelPool.emplace_back(new IncomingAudioChannel(
+                _channelManager.get(),
+                _call.get(),
+                _rtpTransport,
+                _uniqueRandomIdGenerator.get(),
+                false,
+                std::string("audiopool") + intToString(_nextIncomingAudioChannelPoolId++),
+                _incomingAudioProfile,
+                _threads
+            ));
+        }
     }
 
-    void removeIncomingAudioChannel(ChannelId const &channelId) {
+    // Refills the pool from a separate media thread task, so the blocking
+    // channel construction stays off the path that binds a new speaker.
+    void scheduleIncomingAudioChannelPoolRefill() {
+        if (_isIncomingAudioChannelPoolRefillScheduled) {
+            return;
+        }
+        _isIncomingAudioChannelPoolRefillScheduled = true;
+
+        const auto weak = std::weak_ptr<GroupInstanceCustomInternal>(shared_from_this());
+        _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak]() {
+            auto strong = weak.lock();
+            if (!strong) {
+                return;
+            }
+            strong->_isIncomingAudioChannelPoolRefillScheduled = false;
+            strong->refillIncomingAudioChannelPool();
+        }, 100);
+    }
+
+    void removeIncomingAudioChannel(ChannelId const &channelId, WorkerThreadBatch *batch = nullptr) {
         const auto it = _incomingAudioChannels.find(channelId);
         if (it != _incomingAudioChannels.end()) {
+            if (!it->second->isRawPcm() && channelId.networkSsrc != 1 && (int)_incomingAudioChannelPool.size() < _incomingAudioChannelPoolSize) {
+                it->second->unbind(batch);
+                _incomingAudioChannelPool.push_back(std::move(it->second));
+            } else if (batch) {
+                batch->destroy(std::move(it->second));
+            }
             _incomingAudioChannels.erase(it);
         }
 
@@ -3201,25 +6352,39 @@ public:
             _call.get(),
             _rtpTransport,
             _uniqueRandomIdGenerator.get(),
-            _availableVideoFormats,
+            *_videoFormatTables,
             _sharedVideoInformation.value(),
             audioSsrc,
             minQuality,
             maxQuality,
             videoInformation,
-            _threads
+            _threads,
+            [weak, threads = _threads, endpointId = videoInformation.endpointId]() {
+                threads->getMediaThread()->PostTask(RTC_FROM_HERE, [weak, endpointId]() {
+                    auto strong = weak.lock();
+                    if (!strong) {
+                        return;
+                    }
+                    strong->updateIncomingVideoOutputs(endpointId);
+                });
+            }
         ));
+        channel->setOverloadMaxQuality(overloadMaxVideoQuality());
 
         const auto pendingSinks = _pendingVideoSinks.find(VideoChannelId(videoInformation.endpointId));
         if (pendingSinks != _pendingVideoSinks.end()) {
-            for (const auto &sink : pendingSinks->second) {
-                channel->addSink(sink);
+            for (const auto &output : pendingSinks->second) {
+                channel->addOutput(output);
             }
 
             _pendingVideoSinks.erase(pendingSinks);
         }
+        channel->updateOutputs();
 
         _incomingVideoChannels.insert(std::make_pair(VideoChannelId(videoInformation.endpointId), std::move(channel)));
+        if (_incomingVideoPacketTap) {
+            _incomingVideoPacketTap->addEndpoint(videoInformation);
+        }
 
         std::vector<uint32_t> allSsrcs;
         for (const auto &group : videoInformation.ssrcGroups) {
@@ -3245,26 +6410,54 @@ public:
         adjustBitratePreferences(false);
     }
 
-    void setVolume(uint32_t ssrc, double volume) {
+    // Applies from the next broadcast part decoded.
+    void setBroadcastDecodedSsrcs(std::vector<uint32_t> &&ssrcs) {
+        _broadcastDecodedSsrcs = std::move(ssrcs);
+    }
+
+    void setVolume(uint32_t ssrc, double volume, WorkerThreadBatch *batch = nullptr) {
         auto current = _volumeBySsrc.find(ssrc);
         if (current != _volumeBySsrc.end() && std::abs(current->second - volume) < 0.0001) {
             return;
         }
 
         _volumeBySsrc[ssrc] = volume;
+        touchSsrcState(ssrc);
 
         auto it = _incomingAudioChannels.find(ChannelId(ssrc));
         if (it != _incomingAudioChannels.end()) {
-            it->second->setVolume(volume);
+            setIncomingChannelVolume(it->first, it->second.get(), mixedVolume(ssrc, false), batch);
         }
 
         it = _incomingAudioChannels.find(ChannelId(ssrc + 1000, ssrc));
         if (it != _incomingAudioChannels.end()) {
-            it->second->setVolume(volume);
+            setIncomingChannelVolume(it->first, it->second.get(), mixedVolume(ssrc, true), batch);
+        }
+
+        auto direct = _directBroadcastChannels.find(ssrc);
+        if (direct != _directBroadcastChannels.end()) {
+            direct->second->setVolume(mixedVolume(ssrc, true));
+        }
+    }
+
+    // With a GroupAudioMixer, volumes are the gains it mixes streams with,
+    // and streams at 0 aren't decoded, rather than the receive streams'.
+    void setIncomingChannelVolume(ChannelId const &channelId, IncomingAudioChannel *channel, double volume, WorkerThreadBatch *batch) {
+        if (_audioMixer) {
+            _audioMixer->setGain(channelId.networkSsrc, volume);
+        } else {
+            channel->setVolume(volume, batch);
         }
     }
 
     void setRequestedVideoChannels(std::vector<VideoChannelDescription> &&requestedVideoChannels) {
+        if (_audioOnly) {
+            return;
+        }
+        _broadcastVideoChannels = requestedVideoChannels;
+        if (!requestedVideoChannels.empty()) {
+            ensureVideoInitialized();
+        }
         if (!_sharedVideoInformation) {
             _pendingRequestedVideo = std::move(requestedVideoChannels);
             return;
@@ -3312,6 +6505,9 @@ public:
 
         for (const auto &endpointId : removeEndpointIds) {
             _incomingVideoChannels.erase(VideoChannelId(endpointId));
+            if (_incomingVideoPacketTap) {
+                _incomingVideoPacketTap->removeEndpoint(endpointId);
+            }
         }
 
         if (updated) {
@@ -3329,7 +6525,7 @@ private:
         const auto create = [&](webrtc::AudioDeviceModule::AudioLayer layer) {
             return webrtc::AudioDeviceModule::Create(
                 layer,
-                _taskQueueFactory.get());
+                taskQueueFactory());
         };
         const auto check = [&](const rtc::scoped_refptr<webrtc::AudioDeviceModule> &result) -> rtc::scoped_refptr<WrappedAudioDeviceModule> {
             if (result && result->Init() == 0) {
@@ -3339,47 +6535,127 @@ private:
             }
         };
         if (_createAudioDeviceModule) {
-            if (const auto result = check(_createAudioDeviceModule(_taskQueueFactory.get()))) {
+            // For the ticks of a device taking the current account.
+            CpuAccountScope accountScope(_cpuAccount);
+            if (const auto result = check(_createAudioDeviceModule(taskQueueFactory()))) {
                 return result;
             }
         } else if (_videoContentType == VideoContentType::Screencast) {
             FakeAudioDeviceModule::Options options;
             options.num_channels = 1;
-            return check(FakeAudioDeviceModule::Creator(nullptr, _externalAudioRecorder, options)(_taskQueueFactory.get()));
+            return check(FakeAudioDeviceModule::Creator(nullptr, _externalAudioRecorder, options)(taskQueueFactory()));
         }
         return check(create(webrtc::AudioDeviceModule::kPlatformDefaultAudio));
     }
 
 private:
+    // First, so that the tables allocated from it are all gone when it
+    // releases its chunks.
+    GroupInstanceArena _arena;
     std::shared_ptr<Threads> _threads;
+    std::shared_ptr<ExternalAudioSampleRing> _externalAudioSamples;
+    std::shared_ptr<PacketDeliveryCounters> _packetDeliveryCounters;
+    std::shared_ptr<StartupTimings> _startupTimings;
+    std::shared_ptr<BroadcastCounters> _broadcastCounters;
+    std::shared_ptr<GroupReconnectCounters> _reconnectCounters;
+    std::shared_ptr<NoiseSuppressionConfiguration> _noiseSuppressionConfiguration;
+    std::shared_ptr<CpuAccount> _cpuAccount;
+    // Null unless the descriptor enabled it.
+    rtc::scoped_refptr<GroupAudioMixer> _audioMixer;
+    std::shared_ptr<UnresolvedPacketFilter> _unresolvedPacketFilter;
+    // Null without onIncomingVideoPacket.
+    std::shared_ptr<IncomingVideoPacketTap> _incomingVideoPacketTap;
+    // Per-frame sink level updates hopping to the media thread.
+    std::shared_ptr<ThreadHopQueue<SinkAudioLevelEvent>> _sinkAudioLevelHops;
+    std::function<void()> _startCompleted;
+    int _pendingStartSteps = 0;
+    bool _isStarted = false;
+    std::vector<std::function<void()>> _tasksWhenStarted;
     GroupConnectionMode _connectionMode = GroupConnectionMode::GroupConnectionModeNone;
 
     std::function<void(GroupNetworkState)> _networkStateUpdated;
     std::function<void(GroupLevelsUpdate const &)> _audioLevelsUpdated;
+    int _audioLevelsUpdateIntervalMs{100};
+    bool _audioLevelsDeltaUpdates{false};
+    std::function<void(CallStatsSnapshot const &)> _statsUpdated;
+    int _statsUpdateIntervalMs{5000};
+    bool _enableIncomingVad{false};
+    // Level entries of SSRCs silent for this long are dropped.
+    static constexpr int64_t kAudioLevelForgetTimeoutMs = 10000;
+    struct ReportedLevel {
+        uint32_t index = 0;
+        GroupLevelValue value;
+        int64_t tick = 0;
+    };
+    GroupInstanceHashMap<uint32_t, ReportedLevel> _reportedLevels{&_arena};
+    GroupInstanceHashSet<uint32_t> _levelsReportedSsrcs{&_arena};
+    std::vector<uint32_t> _freeLevelIndices;
+    uint32_t _nextLevelIndex = 1;
+    int64_t _levelsTick = 0;
     std::function<void(uint32_t, const AudioFrame &)> _onAudioFrame;
+    std::function<void(uint32_t, uint16_t, uint32_t, const uint8_t *, size_t)> _onIncomingOpusPacket;
     std::function<std::shared_ptr<RequestMediaChannelDescriptionTask>(std::vector<uint32_t> const &, std::function<void(std::vector<MediaChannelDescription> &&)>)> _requestMediaChannelDescriptions;
     std::function<std::shared_ptr<BroadcastPartTask>(int64_t, int64_t, std::function<void(BroadcastPart &&)>)> _requestBroadcastPart;
+    std::function<std::shared_ptr<BroadcastPartTask>(int64_t, int64_t, int32_t, VideoChannelDescription::Quality, std::function<void(BroadcastPart &&)>)> _requestVideoBroadcastPart;
     std::shared_ptr<VideoCaptureInterface> _videoCapture;
     std::shared_ptr<VideoSinkImpl> _videoCaptureSink;
     std::function<webrtc::VideoTrackSourceInterface*()> _getVideoSource;
     bool _disableIncomingChannels = false;
     bool _useDummyChannel{true};
-    int _outgoingAudioBitrateKbit{32};
+    GroupAudioEncoderProfile _outgoingAudioProfile;
+    bool _constantBitrateAudio{false};
     bool _disableOutgoingAudioProcessing{false};
+    GroupVoiceGate _outgoingVoiceGate;
+    bool _disablePlayoutMixing{false};
+    bool _directBroadcastAudio{false};
+    int _incomingAudioChannelPoolSize{2};
+    int _incomingAudioChannelIdleTimeoutMs{1000};
+    // Idle SSRCs are looked for once a tick, by a timer wheel instead of a
+    // scan of every table.
+    static constexpr int kSsrcStateExpiryTickMs = 1000;
+    int _ssrcStateIdleTimeoutMs{60000};
+    SsrcExpiryWheel _ssrcStateExpiry;
+    int _maxDecodedIncomingAudioStreams{5};
+    int _parallelAudioDecodingDeadlineUs{0};
+    OverloadController::Level _overloadLevel = OverloadController::Level::Normal;
+    // From OverloadController::config() when the level last changed.
+    int _overloadMaxDecodedIncomingAudioStreams{5};
+    int _overloadJitterBufferMinDelayMs{0};
+    GroupAudioReceiveProfile _incomingAudioProfile;
+    std::unique_ptr<webrtc::NetEqFactory> _netEqFactory;
+    IncomingAudioLoudness _incomingAudioLoudness;
     int _minOutgoingVideoBitrateKbit{100};
     VideoContentType _videoContentType{VideoContentType::None};
+    bool _audioOnly = false;
     std::vector<VideoCodecName> _videoCodecPreferences;
+    GroupVideoEncoderConfig _videoEncoderConfig;
+    GroupVideoDecoderConfig _videoDecoderConfig;
 
     int _nextMediaChannelDescriptionsRequestId = 0;
-    std::map<int, RequestedMediaChannelDescriptions> _requestedMediaChannelDescriptions;
+    GroupInstanceMap<int, RequestedMediaChannelDescriptions> _requestedMediaChannelDescriptions{&_arena};
+    // Unknown SSRCs waiting to be asked for, and all those pending or in
+    // flight.
+    std::deque<uint32_t> _pendingUnknownSsrcs;
+    GroupInstanceHashSet<uint32_t> _requestedUnknownSsrcs{&_arena};
+    bool _isUnknownSsrcsRequestScheduled = false;
 
     std::unique_ptr<ThreadLocalObject<GroupNetworkManager>> _networkManager;
 
     std::unique_ptr<webrtc::RtcEventLogNull> _eventLog;
+    std::shared_ptr<GroupEngineContext> _engineContext;
+    std::shared_ptr<GroupCertificatePool> _certificatePool;
+    bool _useBatchedUdpSockets = false;
+    std::shared_ptr<GroupSharedUdpSockets> _sharedUdpSockets;
+    std::shared_ptr<GroupSharedAudioEncoder> _sharedAudioEncoder;
+    std::shared_ptr<GroupSharedAudioDecoder> _sharedAudioDecoder;
+    std::shared_ptr<GroupAudioBridge> _outgoingAudioBridge;
+    std::shared_ptr<GroupOpusPacketSource> _outgoingOpusSource;
+    std::shared_ptr<LatencyTrace> _latencyTrace;
+    // Only set without |_engineContext|; use taskQueueFactory().
     std::unique_ptr<webrtc::TaskQueueFactory> _taskQueueFactory;
     std::unique_ptr<cricket::MediaEngineInterface> _mediaEngine;
     std::unique_ptr<webrtc::Call> _call;
-    webrtc::FieldTrialBasedConfig _fieldTrials;
+    GroupFieldTrials _fieldTrials;
     webrtc::LocalAudioSinkAdapter _audioSource;
     rtc::scoped_refptr<WrappedAudioDeviceModule> _audioDeviceModule;
     std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory*)> _createAudioDeviceModule;
@@ -3389,20 +6665,32 @@ private:
     // _outgoingAudioChannel memory is managed by _channelManager
     cricket::VoiceChannel *_outgoingAudioChannel = nullptr;
     uint32_t _outgoingAudioSsrc = 0;
+    // From GroupInstanceDescriptor::outgoingAudioSsrc, until the first
+    // generateSsrcs() takes it.
+    uint32_t _migratedOutgoingAudioSsrc = 0;
+    std::string _lastJoinResponsePayload;
 
-    std::vector<webrtc::SdpVideoFormat> _availableVideoFormats;
+    std::shared_ptr<const VideoFormatTables> _videoFormatTables = std::make_shared<VideoFormatTables>();
     std::vector<OutgoingVideoFormat> _availablePayloadTypes;
     absl::optional<OutgoingVideoFormat> _selectedPayloadType;
 
     std::vector<GroupJoinPayloadVideoPayloadType> _videoPayloadTypes;
     std::vector<std::pair<uint32_t, std::string>> _videoExtensionMap;
     std::vector<GroupJoinPayloadVideoSourceGroup> _videoSourceGroups;
+    // Bumped by generateSsrcs(), for |_joinPayloadCache|.
+    int _ssrcsRevision = 0;
+    std::shared_ptr<JoinPayloadCache> _joinPayloadCache = std::make_shared<JoinPayloadCache>();
 
     std::unique_ptr<rtc::UniqueRandomIdGenerator> _uniqueRandomIdGenerator;
     webrtc::RtpTransport *_rtpTransport = nullptr;
     std::unique_ptr<cricket::ChannelManager> _channelManager;
 
     std::unique_ptr<webrtc::VideoBitrateAllocatorFactory> _videoBitrateAllocatorFactory;
+    // Owned by the media engine; builds the codec factories when first used.
+    LazyVideoEncoderFactory *_videoEncoderFactory = nullptr;
+    bool _isMediaEngineReady = false;
+    bool _isVideoRequested = false;
+    bool _isVideoInitialized = false;
     // _outgoingVideoChannel memory is managed by _channelManager
     cricket::VideoChannel *_outgoingVideoChannel = nullptr;
     VideoSsrcs _outgoingVideoSsrcs;
@@ -3410,19 +6698,24 @@ private:
     int _pendingOutgoingVideoConstraint = -1;
     int _pendingOutgoingVideoConstraintRequestId = 0;
 
-    std::map<ChannelId, InternalGroupLevelValue> _audioLevels;
+    // The SSRC keyed tables below are looked up for every incoming packet
+    // and audio level header on the media thread, hence flat hash maps.
+    GroupInstanceHashMap<ChannelId, InternalGroupLevelValue> _audioLevels{&_arena};
     GroupLevelValue _myAudioLevel;
 
     bool _isMuted = true;
-    std::shared_ptr<NoiseSuppressionConfiguration> _noiseSuppressionConfiguration;
 
     MissingSsrcPacketBuffer _missingPacketBuffer;
-    std::map<uint32_t, ChannelSsrcInfo> _channelBySsrc;
-    std::map<uint32_t, double> _volumeBySsrc;
-    std::map<ChannelId, std::unique_ptr<IncomingAudioChannel>> _incomingAudioChannels;
-    std::map<VideoChannelId, std::unique_ptr<IncomingVideoChannel>> _incomingVideoChannels;
-
-    std::map<VideoChannelId, std::vector<std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>>>> _pendingVideoSinks;
+    GroupInstanceHashMap<uint32_t, ChannelSsrcInfo> _channelBySsrc{&_arena};
+    GroupInstanceHashMap<uint32_t, double> _volumeBySsrc{&_arena};
+    absl::flat_hash_map<ChannelId, std::unique_ptr<IncomingAudioChannel>> _incomingAudioChannels;
+    // Unbound opus channels, see _incomingAudioChannelPoolSize.
+    std::vector<std::unique_ptr<IncomingAudioChannel>> _incomingAudioChannelPool;
+    int _nextIncomingAudioChannelPoolId = 0;
+    bool _isIncomingAudioChannelPoolRefillScheduled = false;
+    GroupInstanceMap<VideoChannelId, std::unique_ptr<IncomingVideoChannel>> _incomingVideoChannels{&_arena};
+
+    GroupInstanceMap<VideoChannelId, std::vector<IncomingVideoOutput>> _pendingVideoSinks{&_arena};
     std::vector<VideoChannelDescription> _pendingRequestedVideo;
 
     std::unique_ptr<IncomingVideoChannel> _serverBandwidthProbingVideoSsrc;
@@ -3430,40 +6723,96 @@ private:
     absl::optional<GroupJoinVideoInformation> _sharedVideoInformation;
 
     int64_t _broadcastPartDurationMilliseconds = 500;
-    std::vector<std::unique_ptr<StreamingPart>> _sourceBroadcastParts;
-    std::map<uint32_t, uint16_t> _broadcastSeqBySsrc;
+    std::deque<std::shared_ptr<PendingBroadcastPart>> _sourceBroadcastParts;
+    // The playout mixer, when direct broadcast audio needs to feed it.
+    rtc::scoped_refptr<webrtc::AudioMixer> _playoutMixer;
+    absl::flat_hash_map<uint32_t, std::unique_ptr<DirectBroadcastAudioChannel>> _directBroadcastChannels;
+    GroupInstanceHashMap<uint32_t, uint16_t> _broadcastSeqBySsrc{&_arena};
     uint32_t _broadcastTimestamp = 0;
     int64_t _nextBroadcastTimestampMilliseconds = 0;
-    absl::optional<RequestedBroadcastPart> _currentRequestedBroadcastPart;
+    int _broadcastPrefetchDepth = 1;
+    std::string _broadcastPartCacheKey;
+    // Empty for every SSRC of the broadcast.
+    std::vector<uint32_t> _broadcastDecodedSsrcs;
+    // In flight, and received ahead of |_nextBroadcastTimestampMilliseconds|;
+    // both keyed by part timestamp.
+    GroupInstanceMap<int64_t, RequestedBroadcastPart> _requestedBroadcastParts{&_arena};
+    GroupInstanceMap<int64_t, BroadcastPart> _reorderedBroadcastParts{&_arena};
+    // Broadcast video, by part timestamp and endpoint: fetches in flight,
+    // parts fetched, and decoded frames waiting for the audio of their part
+    // to start playing, at |_broadcastPartPlaybackStarts|.
+    std::vector<VideoChannelDescription> _broadcastVideoChannels;
+    GroupInstanceMap<BroadcastVideoPartId, std::shared_ptr<BroadcastPartTask>> _requestedBroadcastVideoParts{&_arena};
+    GroupInstanceSet<BroadcastVideoPartId> _fetchedBroadcastVideoParts{&_arena};
+    GroupInstanceMap<int64_t, std::vector<VideoStreamingPart::Frame>> _decodedBroadcastVideoParts{&_arena};
+    GroupInstanceMap<int64_t, int64_t> _broadcastPartPlaybackStarts{&_arena};
+    int64_t _playingBroadcastPartTimestamp = 0;
     int64_t _lastBroadcastPartReceivedTimestamp = 0;
 
-    std::vector<float> _externalAudioSamples;
-    webrtc::Mutex _externalAudioSamplesMutex;
     std::shared_ptr<ExternalAudioRecorder> _externalAudioRecorder;
 
     bool _isRtcConnected = false;
     bool _isBroadcastConnected = false;
     absl::optional<int64_t> _broadcastEnabledUntilRtcIsConnectedAtTimestamp;
+    absl::optional<int64_t> _rtcEnabledUntilBroadcastIsConnectedAtTimestamp;
+    // Share of broadcast in the audio played, 0 for only RTC and 1 for only
+    // broadcast, and where the crossfade is taking it.
+    double _broadcastMix = 0.0;
+    double _broadcastMixTarget = 0.0;
+    int _connectionModeCrossfadeMs = 300;
+    GroupTimerWheel::Timer _broadcastMixTimer;
     bool _isDataChannelOpen = false;
+    std::string _lastRemoteVideoConstraints;
+    int64_t _remoteConstraintsUpdateDueMs = 0;
     GroupNetworkState _effectiveNetworkState;
+    std::vector<std::function<void()>> _connectedCompletions;
 
     rtc::scoped_refptr<webrtc::PendingTaskSafetyFlag> _workerThreadSafery;
     rtc::scoped_refptr<webrtc::PendingTaskSafetyFlag> _networkThreadSafery;
+
+    // On the media thread's timer wheel, shared with the other calls there.
+    // Last, so that they are stopped before anything their callbacks use
+    // is destroyed.
+    GroupTimerWheel::Timer _levelsTimer;
+    GroupTimerWheel::Timer _statsTimer;
+    GroupTimerWheel::Timer _ssrcStateExpiryTimer;
+    GroupTimerWheel::Timer _remoteConstraintsUpdateTimer;
+    GroupTimerWheel::Timer _networkStatusTimer;
+    GroupTimerWheel::Timer _broadcastPartsDecodeTimer;
+    GroupTimerWheel::Timer _overloadTimer;
 };
 
 GroupInstanceCustomImpl::GroupInstanceCustomImpl(GroupInstanceDescriptor &&descriptor) {
     if (descriptor.config.need_log) {
       _logSink = std::make_unique<LogSinkImpl>(descriptor.config.logPath);
     }
-    rtc::LogMessage::LogToDebug(rtc::LS_INFO);
+    const auto minLogSeverity = LogSinkImpl::Options().minSeverity;
+    rtc::LogMessage::LogToDebug(minLogSeverity);
     rtc::LogMessage::SetLogToStderr(descriptor.config.logToStdErr);
-    if (_logSink) {
-        rtc::LogMessage::AddLogToStream(_logSink.get(), rtc::LS_INFO);
+    if (_logSink && !_logSink->isShared()) {
+        rtc::LogMessage::AddLogToStream(_logSink.get(), minLogSeverity);
     }
 
     _threads = descriptor.threads;
-    _internal.reset(new ThreadLocalObject<GroupInstanceCustomInternal>(_threads->getMediaThread(), [descriptor = std::move(descriptor), threads = _threads]() mutable {
-        return new GroupInstanceCustomInternal(std::move(descriptor), threads);
+    _externalAudioSamples = std::make_shared<ExternalAudioSampleRing>();
+    _packetDeliveryCounters = std::make_shared<PacketDeliveryCounters>();
+    _startupTimings = std::make_shared<StartupTimings>();
+    _broadcastCounters = std::make_shared<BroadcastCounters>();
+    _reconnectCounters = std::make_shared<GroupReconnectCounters>();
+    _pendingVolumeUpdates = std::make_shared<PendingVolumeUpdates>();
+    _noiseSuppressionConfiguration = std::make_shared<NoiseSuppressionConfiguration>(descriptor.initialEnableNoiseSuppression);
+    _cpuAccount = std::make_shared<CpuAccount>();
+    if (descriptor.audioMixer.isEnabled && !descriptor.disablePlayoutMixing) {
+        _audioMixer = new rtc::RefCountedObject<GroupAudioMixer>(descriptor.audioMixer);
+    }
+    _engineContext = descriptor.engineContext;
+    _sharedUdpSockets = descriptor.sharedUdpSockets;
+
+    // Everything the call's tasks start on the pooled threads is charged to
+    // it from here.
+    CpuAccountScope accountScope(_cpuAccount);
+    _internal.reset(new ThreadLocalObject<GroupInstanceCustomInternal>(_threads->getMediaThread(), [descriptor = std::move(descriptor), threads = _threads, externalAudioSamples = _externalAudioSamples, packetDeliveryCounters = _packetDeliveryCounters, startupTimings = _startupTimings, broadcastCounters = _broadcastCounters, reconnectCounters = _reconnectCounters, noiseSuppressionConfiguration = _noiseSuppressionConfiguration, cpuAccount = _cpuAccount, audioMixer = _audioMixer]() mutable {
+        return new GroupInstanceCustomInternal(std::move(descriptor), threads, std::move(externalAudioSamples), std::move(packetDeliveryCounters), std::move(startupTimings), std::move(broadcastCounters), std::move(reconnectCounters), std::move(noiseSuppressionConfiguration), std::move(cpuAccount), std::move(audioMixer));
     }));
     _internal->perform(RTC_FROM_HERE, [](GroupInstanceCustomInternal *internal) {
         internal->start();
@@ -3481,98 +6830,337 @@ GroupInstanceCustomImpl::~GroupInstanceCustomImpl() {
     RTC_LOG(LS_INFO) << "Properly stop GroupInstanceCustomImpl";
 }
 
+void GroupInstanceCustomImpl::performWhenStarted(std::function<void(GroupInstanceCustomInternal *)> &&task) {
+    CpuAccountScope accountScope(_cpuAccount);
+    _internal->perform(RTC_FROM_HERE, [task = std::move(task)](GroupInstanceCustomInternal *internal) mutable {
+        internal->runWhenStarted([internal, task = std::move(task)]() {
+            task(internal);
+        });
+    });
+}
+
+void GroupInstanceCustomImpl::performWhenStarted(std::vector<GroupInstanceCustomImpl *> const &instances, std::function<void(size_t, GroupInstanceCustomInternal *)> &&task) {
+    using Reference = ThreadLocalObject<GroupInstanceCustomInternal>::Reference;
+    struct Target {
+        size_t index = 0;
+        Reference internal;
+        std::shared_ptr<CpuAccount> cpuAccount;
+    };
+    std::map<rtc::Thread *, std::vector<Target>> byThread;
+    for (size_t i = 0; i < instances.size(); i++) {
+        const auto &internal = instances[i]->_internal;
+        byThread[internal->thread()].push_back(Target{ i, internal->reference(), instances[i]->_cpuAccount });
+    }
+    const auto sharedTask = std::make_shared<std::function<void(size_t, GroupInstanceCustomInternal *)>>(std::move(task));
+    for (auto &it : byThread) {
+        // Shared by the calls, so each is charged its own part only.
+        CpuAccountScope noAccount(nullptr);
+        it.first->PostTask(RTC_FROM_HERE, [targets = std::move(it.second), sharedTask]() {
+            for (const auto &target : targets) {
+                CpuTimeScope cpuScope(target.cpuAccount);
+                const auto index = target.index;
+                const auto internal = target.internal.get();
+                internal->runWhenStarted([internal, index, sharedTask]() {
+                    (*sharedTask)(index, internal);
+                });
+            }
+        });
+    }
+}
+
 void GroupInstanceCustomImpl::stop() {
-    _internal->perform(RTC_FROM_HERE, [](GroupInstanceCustomInternal *internal) {
+    performWhenStarted([](GroupInstanceCustomInternal *internal) {
         internal->stop();
     });
 }
 
 void GroupInstanceCustomImpl::setConnectionMode(GroupConnectionMode connectionMode, bool keepBroadcastIfWasEnabled) {
-    _internal->perform(RTC_FROM_HERE, [connectionMode, keepBroadcastIfWasEnabled](GroupInstanceCustomInternal *internal) {
+    performWhenStarted([connectionMode, keepBroadcastIfWasEnabled](GroupInstanceCustomInternal *internal) {
         internal->setConnectionMode(connectionMode, keepBroadcastIfWasEnabled);
     });
 }
 
 void GroupInstanceCustomImpl::emitJoinPayload(std::function<void(GroupJoinPayload const &)> completion) {
+    CpuAccountScope accountScope(_cpuAccount);
     _internal->perform(RTC_FROM_HERE, [completion](GroupInstanceCustomInternal *internal) {
         internal->emitJoinPayload(completion);
     });
 }
 
 void GroupInstanceCustomImpl::setJoinResponsePayload(std::string const &payload) {
-    _internal->perform(RTC_FROM_HERE, [payload](GroupInstanceCustomInternal *internal) {
+    performWhenStarted([payload](GroupInstanceCustomInternal *internal) {
         internal->setJoinResponsePayload(payload);
     });
 }
 
+void GroupInstanceCustomImpl::whenConnected(std::function<void()> completion) {
+    performWhenStarted([completion = std::move(completion)](GroupInstanceCustomInternal *internal) mutable {
+        internal->whenConnected(std::move(completion));
+    });
+}
+
+void GroupInstanceCustomImpl::afterQueuedTasks(std::function<void()> completion) {
+    performWhenStarted([completion = std::move(completion)](GroupInstanceCustomInternal *) {
+        completion();
+    });
+}
+
+rtc::Thread *GroupInstanceCustomImpl::mediaThread() const {
+    return _threads->getMediaThread();
+}
+
 void GroupInstanceCustomImpl::removeSsrcs(std::vector<uint32_t> ssrcs) {
-    _internal->perform(RTC_FROM_HERE, [ssrcs = std::move(ssrcs)](GroupInstanceCustomInternal *internal) mutable {
+    performWhenStarted([ssrcs = std::move(ssrcs)](GroupInstanceCustomInternal *internal) mutable {
         internal->removeSsrcs(ssrcs);
     });
 }
 
+void GroupInstanceCustomImpl::updateParticipants(ParticipantsUpdate update) {
+    // Volumes still pending from setVolume() were set earlier, so they go
+    // first and this update's own volumes win.
+    auto volumes = _pendingVolumeUpdates->take();
+    if (!volumes.empty()) {
+        volumes.insert(volumes.end(), update.volumes.begin(), update.volumes.end());
+        update.volumes = std::move(volumes);
+    }
+    performWhenStarted([update = std::move(update)](GroupInstanceCustomInternal *internal) {
+        internal->updateParticipants(update);
+    });
+}
+
 void GroupInstanceCustomImpl::removeIncomingVideoSource(uint32_t ssrc) {
-    _internal->perform(RTC_FROM_HERE, [ssrc](GroupInstanceCustomInternal *internal) mutable {
+    performWhenStarted([ssrc](GroupInstanceCustomInternal *internal) mutable {
         internal->removeIncomingVideoSource(ssrc);
     });
 }
 
 void GroupInstanceCustomImpl::setIsMuted(bool isMuted) {
-    _internal->perform(RTC_FROM_HERE, [isMuted](GroupInstanceCustomInternal *internal) {
+    performWhenStarted([isMuted](GroupInstanceCustomInternal *internal) {
         internal->setIsMuted(isMuted);
     });
 }
 
+void GroupInstanceCustomImpl::setIsMuted(std::vector<GroupInstanceCustomImpl *> const &instances, std::vector<bool> const &isMuted) {
+    performWhenStarted(instances, [isMuted](size_t index, GroupInstanceCustomInternal *internal) {
+        internal->setIsMuted(isMuted[index]);
+    });
+}
+
 void GroupInstanceCustomImpl::setIsNoiseSuppressionEnabled(bool isNoiseSuppressionEnabled) {
+    CpuAccountScope accountScope(_cpuAccount);
     _internal->perform(RTC_FROM_HERE, [isNoiseSuppressionEnabled](GroupInstanceCustomInternal *internal) {
         internal->setIsNoiseSuppressionEnabled(isNoiseSuppressionEnabled);
     });
 }
 
 void GroupInstanceCustomImpl::setVideoCapture(std::shared_ptr<VideoCaptureInterface> videoCapture) {
-    _internal->perform(RTC_FROM_HERE, [videoCapture](GroupInstanceCustomInternal *internal) {
+    performWhenStarted([videoCapture](GroupInstanceCustomInternal *internal) {
         internal->setVideoCapture(videoCapture, false);
     });
 }
 
 void GroupInstanceCustomImpl::setVideoSource(std::function<webrtc::VideoTrackSourceInterface*()> getVideoSource) {
-  _internal->perform(RTC_FROM_HERE, [getVideoSource](GroupInstanceCustomInternal *internal) {
+  performWhenStarted([getVideoSource](GroupInstanceCustomInternal *internal) {
     internal->setVideoSource(getVideoSource, false);
   });
 }
 
 void GroupInstanceCustomImpl::setAudioOutputDevice(std::string id) {
-    _internal->perform(RTC_FROM_HERE, [id](GroupInstanceCustomInternal *internal) {
+    performWhenStarted([id](GroupInstanceCustomInternal *internal) {
         internal->setAudioOutputDevice(id);
     });
 }
 
 void GroupInstanceCustomImpl::setAudioInputDevice(std::string id) {
-    _internal->perform(RTC_FROM_HERE, [id](GroupInstanceCustomInternal *internal) {
+    performWhenStarted([id](GroupInstanceCustomInternal *internal) {
         internal->setAudioInputDevice(id);
     });
 }
 
 void GroupInstanceCustomImpl::addExternalAudioSamples(std::vector<uint8_t> &&samples) {
+    CpuAccountScope accountScope(_cpuAccount);
     _internal->perform(RTC_FROM_HERE, [samples = std::move(samples)](GroupInstanceCustomInternal *internal) mutable {
         internal->addExternalAudioSamples(std::move(samples));
     });
 }
 
+GroupInstanceCustomImpl::ExternalAudioStats GroupInstanceCustomImpl::getExternalAudioStats() const {
+    ExternalAudioStats stats;
+    stats.bufferedSamples = _externalAudioSamples->available();
+    stats.capacitySamples = ExternalAudioSampleRing::kCapacity;
+    stats.droppedSamples = _externalAudioSamples->droppedSamples();
+    return stats;
+}
+
+GroupInstanceCustomImpl::BroadcastStats GroupInstanceCustomImpl::getBroadcastStats() const {
+    BroadcastStats stats;
+    stats.queuedMilliseconds = _broadcastCounters->queuedMilliseconds();
+    stats.decodingParts = _broadcastCounters->decodingParts();
+    stats.requestedParts = _broadcastCounters->requestedParts();
+    stats.reorderedParts = _broadcastCounters->reorderedParts();
+    return stats;
+}
+
+GroupInstanceCustomImpl::ReconnectStats GroupInstanceCustomImpl::getReconnectStats() const {
+    ReconnectStats stats;
+    stats.disconnects = _reconnectCounters->disconnects();
+    stats.cachedPairReconnects = _reconnectCounters->cachedPairReconnects();
+    stats.otherPairReconnects = _reconnectCounters->otherPairReconnects();
+    stats.fastReconnectsExpired = _reconnectCounters->fastReconnectsExpired();
+    stats.bucketBoundsMs.assign(GroupReconnectCounters::kBucketBoundsMs.begin(), GroupReconnectCounters::kBucketBoundsMs.end());
+    for (size_t i = 0; i < GroupReconnectCounters::kBucketCount; i++) {
+        stats.reconnectTimeHistogram.push_back(_reconnectCounters->reconnectTimeBucket(i));
+    }
+    return stats;
+}
+
+GroupInstanceCustomImpl::MediaStats GroupInstanceCustomImpl::getMediaStats() const {
+    MediaStats stats;
+    _threads->getMediaThread()->Invoke<void>(RTC_FROM_HERE, [&] {
+        stats = _internal->getSyncAssumingSameThread()->getMediaStats();
+    });
+    return stats;
+}
+
+std::vector<GroupInstanceCustomImpl::MediaStats> GroupInstanceCustomImpl::getMediaStats(std::vector<GroupInstanceCustomImpl const *> const &instances) {
+    std::vector<MediaStats> stats(instances.size());
+    std::map<rtc::Thread *, std::vector<size_t>> byThread;
+    for (size_t i = 0; i < instances.size(); i++) {
+        byThread[instances[i]->_threads->getMediaThread()].push_back(i);
+    }
+    for (const auto &it : byThread) {
+        it.first->Invoke<void>(RTC_FROM_HERE, [&] {
+            for (const auto index : it.second) {
+                stats[index] = instances[index]->_internal->getSyncAssumingSameThread()->getMediaStats();
+            }
+        });
+    }
+    return stats;
+}
+
+GroupInstanceCustomImpl::MigrationState GroupInstanceCustomImpl::getMigrationState() const {
+    MigrationState state;
+    _threads->getMediaThread()->Invoke<void>(RTC_FROM_HERE, [&] {
+        state = _internal->getSyncAssumingSameThread()->getMigrationState();
+    });
+    return state;
+}
+
+void GroupInstanceCustomImpl::prepareScreencast(GroupInstanceDescriptor &descriptor) {
+    if (!_engineContext) {
+        _engineContext = std::make_shared<GroupEngineContext>();
+    }
+    descriptor.threads = _threads;
+    descriptor.engineContext = _engineContext;
+    descriptor.sharedUdpSockets = _sharedUdpSockets;
+    descriptor.videoContentType = VideoContentType::Screencast;
+
+    rtc::scoped_refptr<rtc::RTCCertificate> certificate;
+    _threads->getMediaThread()->Invoke<void>(RTC_FROM_HERE, [&] {
+        certificate = _internal->getSyncAssumingSameThread()->getLocalCertificate();
+    });
+    if (certificate) {
+        descriptor.certificatePool = std::make_shared<GroupCertificatePool>(std::move(certificate));
+    }
+}
+
+GroupInstanceCustomImpl::MemoryUsage GroupInstanceCustomImpl::getMemoryUsage() const {
+    MemoryUsage usage;
+    _threads->getMediaThread()->Invoke<void>(RTC_FROM_HERE, [&] {
+        usage = _internal->getSyncAssumingSameThread()->getMemoryUsage();
+    });
+    usage.externalAudioBytes = ExternalAudioSampleRing::kCapacity * sizeof(int16_t);
+    usage.totalBytes = usage.externalAudioBytes + usage.broadcastPartBytes + usage.missingSsrcPacketBytes + usage.ssrcTableBytes;
+    return usage;
+}
+
+CpuAccount::Usage GroupInstanceCustomImpl::getCpuUsage() const {
+    return _cpuAccount->usage();
+}
+
+GroupInstanceCustomImpl::NoiseSuppressionStats GroupInstanceCustomImpl::getNoiseSuppressionStats() const {
+    NoiseSuppressionStats stats;
+    stats.isEnabled = _noiseSuppressionConfiguration->isEnabled();
+    stats.isAvailable = _noiseSuppressionConfiguration->isAvailable();
+    stats.processedFrames = _noiseSuppressionConfiguration->processedFrames();
+    stats.totalProcessingTimeUs = _noiseSuppressionConfiguration->totalProcessingNs() / 1000;
+    stats.maxProcessingTimeUs = _noiseSuppressionConfiguration->maxProcessingNs() / 1000;
+    if (stats.processedFrames > 0) {
+        stats.averageProcessingTimeUs = double(_noiseSuppressionConfiguration->totalProcessingNs()) / 1000.0 / double(stats.processedFrames);
+    }
+    return stats;
+}
+
+GroupInstanceCustomImpl::AudioMixerStats GroupInstanceCustomImpl::getAudioMixerStats() const {
+    AudioMixerStats stats;
+    if (!_audioMixer) {
+        return stats;
+    }
+    const auto mixerStats = _audioMixer->stats();
+    stats.isEnabled = true;
+    stats.decodedSources = mixerStats.decodedSources;
+    stats.mixedSources = mixerStats.mixedSources;
+    stats.mixes = mixerStats.mixes;
+    stats.decodedFrames = mixerStats.decodedFrames;
+    stats.mixedFrames = mixerStats.mixedFrames;
+    stats.skippedFrames = mixerStats.skippedFrames;
+    return stats;
+}
+
+GroupInstanceCustomImpl::StartupLatency GroupInstanceCustomImpl::getStartupLatency() const {
+    StartupLatency latency;
+    latency.engineReadyMs = _startupTimings->engineReadyMs();
+    latency.joinPayloadMs = _startupTimings->joinPayloadMs();
+    latency.firstRtpMs = _startupTimings->firstRtpMs();
+    return latency;
+}
+
+GroupInstanceCustomImpl::PacketDeliveryStats GroupInstanceCustomImpl::getPacketDeliveryStats() const {
+    PacketDeliveryStats stats;
+    stats.threadHops = _packetDeliveryCounters->threadHops();
+    stats.packets = _packetDeliveryCounters->packets();
+    stats.threadHopsPerSecond = _packetDeliveryCounters->threadHopsPerSecond();
+    stats.packetsPerSecond = _packetDeliveryCounters->packetsPerSecond();
+    stats.droppedSctpPackets = _packetDeliveryCounters->droppedPackets(PacketDeliveryCounters::DropReason::Sctp);
+    stats.droppedMalformedPackets = _packetDeliveryCounters->droppedPackets(PacketDeliveryCounters::DropReason::Malformed);
+    stats.droppedOwnSsrcPackets = _packetDeliveryCounters->droppedPackets(PacketDeliveryCounters::DropReason::OwnSsrc);
+    stats.droppedNotOpusPackets = _packetDeliveryCounters->droppedPackets(PacketDeliveryCounters::DropReason::NotOpus);
+    stats.droppedIncomingDisabledPackets = _packetDeliveryCounters->droppedPackets(PacketDeliveryCounters::DropReason::IncomingDisabled);
+    return stats;
+}
+
 void GroupInstanceCustomImpl::addIncomingVideoOutput(std::string const &endpointId, std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink) {
-    _internal->perform(RTC_FROM_HERE, [endpointId, sink](GroupInstanceCustomInternal *internal) mutable {
-        internal->addIncomingVideoOutput(endpointId, sink);
+    addIncomingVideoOutput(endpointId, sink, rtc::VideoSinkWants());
+}
+
+void GroupInstanceCustomImpl::addIncomingVideoOutput(std::string const &endpointId, std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink, rtc::VideoSinkWants const &wants) {
+    IncomingVideoOutput output;
+    output.sink = sink;
+    output.wants = wants;
+    performWhenStarted([endpointId, output](GroupInstanceCustomInternal *internal) {
+        internal->addIncomingVideoOutput(endpointId, output);
     });
 }
 
 void GroupInstanceCustomImpl::setVolume(uint32_t ssrc, double volume) {
-    _internal->perform(RTC_FROM_HERE, [ssrc, volume](GroupInstanceCustomInternal *internal) {
-        internal->setVolume(ssrc, volume);
+    if (!_pendingVolumeUpdates->set(ssrc, volume)) {
+        return;
+    }
+    performWhenStarted([pendingVolumeUpdates = _pendingVolumeUpdates](GroupInstanceCustomInternal *internal) {
+        ParticipantsUpdate update;
+        update.volumes = pendingVolumeUpdates->take();
+        internal->updateParticipants(update);
+    });
+}
+
+void GroupInstanceCustomImpl::setBroadcastDecodedSsrcs(std::vector<uint32_t> ssrcs) {
+    performWhenStarted([ssrcs = std::move(ssrcs)](GroupInstanceCustomInternal *internal) mutable {
+        internal->setBroadcastDecodedSsrcs(std::move(ssrcs));
     });
 }
 
 void GroupInstanceCustomImpl::setRequestedVideoChannels(std::vector<VideoChannelDescription> &&requestedVideoChannels) {
-    _internal->perform(RTC_FROM_HERE, [requestedVideoChannels = std::move(requestedVideoChannels)](GroupInstanceCustomInternal *internal) mutable {
+    performWhenStarted([requestedVideoChannels = std::move(requestedVideoChannels)](GroupInstanceCustomInternal *internal) mutable {
         internal->setRequestedVideoChannels(std::move(requestedVideoChannels));
     });
 }
@@ -3609,7 +7197,13 @@ std::vector<GroupInstanceInterface::AudioDevice> GroupInstanceInterface::getAudi
 }
 
 void GroupInstanceCustomImpl::performWithAudioDeviceModule(std::function<void(rtc::scoped_refptr<WrappedAudioDeviceModule>)> callback) {
-  _internal->perform(RTC_FROM_HERE, [callback = std::move(callback)](GroupInstanceCustomInternal *internal) {
+  performWhenStarted([callback = std::move(callback)](GroupInstanceCustomInternal *internal) {
+    internal->performWithAudioDeviceModule(callback);
+  });
+}
+
+void GroupInstanceCustomImpl::performWithAudioDeviceModule(std::vector<GroupInstanceCustomImpl *> const &instances, std::function<void(rtc::scoped_refptr<WrappedAudioDeviceModule>)> callback) {
+  performWhenStarted(instances, [callback = std::move(callback)](size_t, GroupInstanceCustomInternal *internal) {
     internal->performWithAudioDeviceModule(callback);
   });
 }
@@ -8,17 +8,204 @@
 #include <map>
 
 #include "../Instance.h"
+#include "../CpuAccounting.h"
 #include "GroupInstanceImpl.h"
 #include "../platform/PlatformInterface.h"
 
+namespace rtc {
+class Thread;
+}
+
 namespace tgcalls {
 
 class LogSinkImpl;
 class GroupInstanceCustomInternal;
+class ExternalAudioSampleRing;
+class PacketDeliveryCounters;
+class StartupTimings;
+class BroadcastCounters;
+class GroupReconnectCounters;
+class PendingVolumeUpdates;
+class NoiseSuppressionConfiguration;
+class GroupAudioMixer;
 class Threads;
 
 class GroupInstanceCustomImpl final : public GroupInstanceInterface {
 public:
+    struct ExternalAudioStats {
+        // Samples added with addExternalAudioSamples() and not mixed in yet.
+        size_t bufferedSamples = 0;
+        size_t capacitySamples = 0;
+        // Samples dropped because the queue was full.
+        uint64_t droppedSamples = 0;
+    };
+
+    struct PacketDeliveryStats {
+        // Tasks posted to the worker thread to deliver received packets, and
+        // the packets they carried. Broadcast packets go in one task per
+        // commit cycle.
+        uint64_t threadHops = 0;
+        uint64_t packets = 0;
+        double threadHopsPerSecond = 0.0;
+        double packetsPerSecond = 0.0;
+        // Packets the demuxer couldn't route that the network thread dropped
+        // without a hop: SCTP, unparseable, echoes of our own SSRC, RTP of
+        // unknown SSRCs that isn't Opus, and any RTP of unknown SSRCs while
+        // incoming channels are disabled.
+        uint64_t droppedSctpPackets = 0;
+        uint64_t droppedMalformedPackets = 0;
+        uint64_t droppedOwnSsrcPackets = 0;
+        uint64_t droppedNotOpusPackets = 0;
+        uint64_t droppedIncomingDisabledPackets = 0;
+    };
+
+    struct BroadcastStats {
+        // Decoded audio waiting to be played, parts still being decoded,
+        // part requests in flight and parts received ahead of their turn.
+        int queuedMilliseconds = 0;
+        int decodingParts = 0;
+        int requestedParts = 0;
+        int reorderedParts = 0;
+    };
+
+    struct StartupLatency {
+        // Milliseconds from construction until the media engine and call
+        // were created, the join payload was handed out and the first RTP
+        // packet arrived; -1 until that happens.
+        int64_t engineReadyMs = -1;
+        int64_t joinPayloadMs = -1;
+        int64_t firstRtpMs = -1;
+    };
+
+    struct NoiseSuppressionStats {
+        // Whether setIsNoiseSuppressionEnabled() turned it on, and whether
+        // the call has the capture processor it runs in: calls that send a
+        // screencast don't, nor do those sending unprocessed audio that
+        // started with it off.
+        bool isEnabled = false;
+        bool isAvailable = false;
+        // 10 ms capture frames it processed and the time that took on the
+        // audio capture thread, the slowest frame's, and per frame.
+        uint64_t processedFrames = 0;
+        int64_t totalProcessingTimeUs = 0;
+        int64_t maxProcessingTimeUs = 0;
+        double averageProcessingTimeUs = 0.0;
+    };
+
+    struct AudioMixerStats {
+        // Whether the descriptor's GroupAudioMixerConfig is in use; the
+        // rest stays 0 otherwise.
+        bool isEnabled = false;
+        // Streams decoded and mixed in the last mix.
+        int decodedSources = 0;
+        int mixedSources = 0;
+        // Mixes so far, and the frames decoded, mixed and not decoded
+        // because the stream's volume was 0 in them.
+        uint64_t mixes = 0;
+        uint64_t decodedFrames = 0;
+        uint64_t mixedFrames = 0;
+        uint64_t skippedFrames = 0;
+    };
+
+    struct ReconnectStats {
+        // Times connectivity was lost, and how it came back: on the pair
+        // that worked before, or on another one. |fastReconnectsExpired|
+        // counts the losses the cached pair didn't recover from quickly.
+        uint64_t disconnects = 0;
+        uint64_t cachedPairReconnects = 0;
+        uint64_t otherPairReconnects = 0;
+        uint64_t fastReconnectsExpired = 0;
+        // Reconnect times: reconnectTimeHistogram[i] counts those up to
+        // bucketBoundsMs[i], the last entry the slower ones.
+        std::vector<int64_t> bucketBoundsMs;
+        std::vector<uint64_t> reconnectTimeHistogram;
+    };
+
+    struct MediaStats {
+        // From webrtc::Call: the congestion controller's estimates, the
+        // pacer queue delay and the RTT, -1 before one was measured.
+        int32_t sendBandwidthBps = 0;
+        int32_t receiveBandwidthBps = 0;
+        int64_t pacerDelayMs = 0;
+        int64_t rttMs = -1;
+        // Outgoing audio, as reported back by the remote side.
+        int64_t outgoingAudioBytesSent = 0;
+        int32_t outgoingAudioPacketsSent = 0;
+        int32_t outgoingAudioPacketsLost = 0;
+        float outgoingAudioFractionLost = 0.0f;
+        // One entry per received audio SSRC, at the same index in every
+        // vector. Rates are NetEq's, in the 0..1 range; the jitter buffer
+        // delay is its current one.
+        std::vector<uint32_t> incomingAudioSsrcs;
+        std::vector<int32_t> incomingAudioPacketsReceived;
+        std::vector<int32_t> incomingAudioPacketsLost;
+        std::vector<int32_t> incomingAudioJitterMs;
+        std::vector<int32_t> incomingAudioJitterBufferDelayMs;
+        std::vector<float> incomingAudioExpandRate;
+        std::vector<float> incomingAudioSpeechExpandRate;
+        std::vector<uint64_t> incomingAudioConcealedSamples;
+        std::vector<uint64_t> incomingAudioConcealmentEvents;
+        std::vector<uint64_t> incomingAudioTotalSamples;
+    };
+
+    struct MemoryUsage {
+        // Bytes held by tgcalls' own buffers and tables, from their sizes
+        // and capacities: the external audio ring, broadcast audio decoded
+        // ahead of playback plus parts received out of order, packets of
+        // SSRCs not resolved yet, and the per-SSRC hash tables.
+        size_t externalAudioBytes = 0;
+        size_t broadcastPartBytes = 0;
+        size_t missingSsrcPacketBytes = 0;
+        size_t ssrcTableBytes = 0;
+        size_t totalBytes = 0;
+        // Chunks of the instance's GroupInstanceArena, which hold the small
+        // tables above, so not added to |totalBytes|.
+        size_t arenaBytes = 0;
+        // Entries of the per-SSRC tables, which should follow the number of
+        // participants heard recently rather than grow with the call.
+        size_t audioLevelEntries = 0;
+        size_t reportedLevelEntries = 0;
+        size_t channelEntries = 0;
+        size_t volumeEntries = 0;
+        size_t broadcastSequenceEntries = 0;
+        // webrtc doesn't report what its channels hold, each with its own
+        // NetEq and decoder, so they are counted instead, with the audio
+        // buffered by all incoming audio channels' NetEqs.
+        int incomingAudioChannels = 0;
+        int pooledIncomingAudioChannels = 0;
+        int directBroadcastChannels = 0;
+        int incomingVideoChannels = 0;
+        int64_t incomingAudioBufferedMs = 0;
+    };
+
+    // What a new instance of the call, in another process or on another
+    // node, needs to take over with little disruption: it joins with the
+    // same audio SSRC, so listeners keep their channel for it, receives the
+    // same participants from the start and continues the broadcast where
+    // this one was.
+    struct MigrationState {
+        uint32_t outgoingAudioSsrc = 0;
+        // Audio SSRCs of the participants this instance knows of, with the
+        // volumes set for them.
+        std::vector<uint32_t> incomingAudioSsrcs;
+        std::vector<std::pair<uint32_t, double>> volumes;
+        // The next broadcast part to play, in broadcast mode; 0 otherwise.
+        int64_t nextBroadcastTimestampMilliseconds = 0;
+        // The last payload given to setJoinResponsePayload(): the server's
+        // transport and the payload types, which a rejoin of the same call
+        // gets again.
+        std::string joinResponsePayload;
+    };
+
+    struct ParticipantsUpdate {
+        // Audio SSRCs to start receiving right away, as if their media
+        // channel descriptions had been resolved, and ones to stop
+        // receiving. Volumes are kept for SSRCs that are removed.
+        std::vector<uint32_t> addedSsrcs;
+        std::vector<uint32_t> removedSsrcs;
+        std::vector<std::pair<uint32_t, double>> volumes;
+    };
+
     explicit GroupInstanceCustomImpl(GroupInstanceDescriptor &&descriptor);
     ~GroupInstanceCustomImpl();
 
@@ -28,7 +215,18 @@ public:
 
     void emitJoinPayload(std::function<void(GroupJoinPayload const &)> completion);
     void setJoinResponsePayload(std::string const &payload);
+    // Calls |completion| on the media thread once the call is connected, at
+    // once if it is; dropped uncalled if the call is destroyed first.
+    void whenConnected(std::function<void()> completion);
+    // Calls |completion| on the media thread once the tasks queued before it
+    // have run, e.g. to know that setJoinResponsePayload(), a device change
+    // or stop() is applied; dropped uncalled if the call never starts.
+    void afterQueuedTasks(std::function<void()> completion);
+    // Where the call's state lives; see GroupInstanceAwait.h.
+    rtc::Thread *mediaThread() const;
     void removeSsrcs(std::vector<uint32_t> ssrcs);
+    // Removals go first, then volumes, then additions.
+    void updateParticipants(ParticipantsUpdate update);
     void removeIncomingVideoSource(uint32_t ssrc);
 
     void setIsMuted(bool isMuted);
@@ -38,18 +236,74 @@ public:
     void setAudioOutputDevice(std::string id);
     void setAudioInputDevice(std::string id);
     void addExternalAudioSamples(std::vector<uint8_t> &&samples);
+    ExternalAudioStats getExternalAudioStats() const;
+    PacketDeliveryStats getPacketDeliveryStats() const;
+    StartupLatency getStartupLatency() const;
+    NoiseSuppressionStats getNoiseSuppressionStats() const;
+    AudioMixerStats getAudioMixerStats() const;
+    ReconnectStats getReconnectStats() const;
+    BroadcastStats getBroadcastStats() const;
+    // Waits for the media and worker threads; empty until the call has
+    // started.
+    MediaStats getMediaStats() const;
+    // Waits for the media and worker threads.
+    MemoryUsage getMemoryUsage() const;
+    // Waits for the media thread.
+    MigrationState getMigrationState() const;
+    // Makes |descriptor| one of a screencast instance of the same call, with
+    // what it can take over from this one instead of building it again: the
+    // threads, the engine context with its codec factories, the DTLS
+    // certificate of the current join and the shared UDP sockets. Waits for
+    // the media and network threads.
+    void prepareScreencast(GroupInstanceDescriptor &descriptor);
+    // Doesn't wait for the threads; complete only if CpuAccounting was
+    // enabled when the call started.
+    CpuAccount::Usage getCpuUsage() const;
 
     void addIncomingVideoOutput(std::string const &endpointId, std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink);
+    void addIncomingVideoOutput(std::string const &endpointId, std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink, rtc::VideoSinkWants const &wants);
     
+    // Doesn't wait for the media thread; volumes set before it gets to them
+    // are applied together, the last one of each SSRC.
     void setVolume(uint32_t ssrc, double volume);
     void setRequestedVideoChannels(std::vector<VideoChannelDescription> &&requestedVideoChannels);
+    // Broadcast parts decoded afterwards only decode these SSRCs, the rest
+    // being left out of playback and the per-SSRC taps; empty decodes all.
+    void setBroadcastDecodedSsrcs(std::vector<uint32_t> ssrcs);
 
     void performWithAudioDeviceModule(std::function<void(rtc::scoped_refptr<WrappedAudioDeviceModule>)> callback);
 
+    // The same for many calls at once, with one task per media thread among
+    // them rather than one per call; |isMuted| and the result are in the
+    // order of |instances|. getMediaStats() waits for each media thread in
+    // turn, the others don't wait.
+    static void setIsMuted(std::vector<GroupInstanceCustomImpl *> const &instances, std::vector<bool> const &isMuted);
+    static void performWithAudioDeviceModule(std::vector<GroupInstanceCustomImpl *> const &instances, std::function<void(rtc::scoped_refptr<WrappedAudioDeviceModule>)> callback);
+    static std::vector<MediaStats> getMediaStats(std::vector<GroupInstanceCustomImpl const *> const &instances);
+
   private:
+    // Runs |task| on the media thread once the instance has finished
+    // starting; see GroupInstanceCustomInternal::runWhenStarted().
+    void performWhenStarted(std::function<void(GroupInstanceCustomInternal *)> &&task);
+    // Runs |task| with the index of each of |instances| once it has started.
+    static void performWhenStarted(std::vector<GroupInstanceCustomImpl *> const &instances, std::function<void(size_t, GroupInstanceCustomInternal *)> &&task);
+
     std::shared_ptr<Threads> _threads;
     std::unique_ptr<ThreadLocalObject<GroupInstanceCustomInternal>> _internal;
     std::unique_ptr<LogSinkImpl> _logSink;
+    std::shared_ptr<ExternalAudioSampleRing> _externalAudioSamples;
+    std::shared_ptr<PacketDeliveryCounters> _packetDeliveryCounters;
+    std::shared_ptr<StartupTimings> _startupTimings;
+    std::shared_ptr<GroupReconnectCounters> _reconnectCounters;
+    std::shared_ptr<BroadcastCounters> _broadcastCounters;
+    std::shared_ptr<PendingVolumeUpdates> _pendingVolumeUpdates;
+    std::shared_ptr<NoiseSuppressionConfiguration> _noiseSuppressionConfiguration;
+    std::shared_ptr<CpuAccount> _cpuAccount;
+    rtc::scoped_refptr<GroupAudioMixer> _audioMixer;
+    // The descriptor's, for prepareScreencast(); without one, a context is
+    // created there for the screencasts to share among themselves.
+    std::shared_ptr<GroupEngineContext> _engineContext;
+    std::shared_ptr<GroupSharedUdpSockets> _sharedUdpSockets;
 
 };
 
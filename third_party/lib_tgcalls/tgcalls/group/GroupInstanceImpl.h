@@ -21,12 +21,21 @@ class VideoTrackSourceInterface;
 namespace rtc {
 template <class T>
 class scoped_refptr;
+struct VideoSinkWants;
 }
 
 namespace tgcalls {
 
 class LogSinkImpl;
 class GroupInstanceManager;
+class GroupEngineContext;
+class GroupCertificatePool;
+class GroupSharedUdpSockets;
+class GroupSharedAudioDecoder;
+class GroupSharedAudioEncoder;
+class GroupAudioBridge;
+class GroupOpusPacketSource;
+class LatencyTrace;
 struct AudioFrame;
 
 struct GroupConfig {
@@ -44,10 +53,17 @@ struct GroupLevelValue {
 struct GroupLevelUpdate {
     uint32_t ssrc = 0;
     GroupLevelValue value;
+    // Dense index of |ssrc|, stable for as long as it keeps being reported
+    // and reused afterwards. The local participant (ssrc 0) is always 0.
+    uint32_t index = 0;
 };
 
 struct GroupLevelsUpdate {
     std::vector<GroupLevelUpdate> updates;
+    // When set, |updates| only has the participants whose value changed since
+    // the previous update; ones that stopped being reported are sent once
+    // with a zero level before their index is released.
+    bool isDelta = false;
 };
 
 class BroadcastPartTask {
@@ -111,6 +127,185 @@ struct MediaChannelDescription {
     std::string videoInformation;
 };
 
+// How outgoing Opus is encoded. Applied both to the encoder and to the
+// bitrate range the call asks of congestion control.
+struct GroupAudioEncoderProfile {
+    enum class Preset {
+        // Mono speech that stops sending during silence.
+        Voice,
+        // Stereo at high bitrates, without DTX or FEC artifacts.
+        Music,
+        // As little as Opus can do for speech, for constrained uplinks.
+        LowBandwidth
+    };
+
+    // 0 takes GroupInstanceDescriptor::outgoingAudioBitrateKbit.
+    int minBitrateKbit{0};
+    int startBitrateKbit{0};
+    int maxBitrateKbit{0};
+    int ptimeMs{120};
+    bool dtx{false};
+    bool fec{false};
+    bool stereo{false};
+    // Opus complexity from 0 to 10; -1 keeps webrtc's default.
+    int complexity{-1};
+
+    static GroupAudioEncoderProfile preset(Preset preset) {
+        GroupAudioEncoderProfile result;
+        switch (preset) {
+            case Preset::Voice:
+                result.minBitrateKbit = 12;
+                result.startBitrateKbit = 16;
+                result.maxBitrateKbit = 32;
+                result.ptimeMs = 20;
+                result.dtx = true;
+                result.fec = true;
+                break;
+            case Preset::Music:
+                result.minBitrateKbit = 64;
+                result.startBitrateKbit = 128;
+                result.maxBitrateKbit = 256;
+                result.ptimeMs = 20;
+                result.stereo = true;
+                result.complexity = 10;
+                break;
+            case Preset::LowBandwidth:
+                result.minBitrateKbit = 6;
+                result.startBitrateKbit = 10;
+                result.maxBitrateKbit = 16;
+                result.ptimeMs = 60;
+                result.dtx = true;
+                result.fec = true;
+                result.complexity = 10;
+                break;
+        }
+        return result;
+    }
+};
+
+// Stops sending the recorded input while it is silent, for TTS and relay
+// bots whose input is mostly silence between utterances: the VAD of the
+// capture analysis decides, and frames only reach the encoder during speech
+// and for |hangoverMs| after it, so silence costs no encoding or packets.
+// The frames that lead up to a detection are sent with it, so onsets aren't
+// clipped.
+struct GroupVoiceGate {
+    bool enabled{false};
+    int hangoverMs{500};
+    // Reports the own level as silent once the gate closes, which also
+    // clears the voice activity sent over the data channel; otherwise the
+    // last level before it closed stays.
+    bool reportsSilence{true};
+};
+
+// How NetEq buffers every incoming audio stream: a shallow buffer that
+// catches up quickly for interactive use, or a deep one with few time
+// stretches, which cost CPU and quality, where latency doesn't matter.
+struct GroupAudioReceiveProfile {
+    enum class Preset {
+        // Low delay, sped up quickly after a delay spike.
+        Interactive,
+        // A large, steady buffer for recording: delay is traded for fewer
+        // accelerate and expand operations.
+        Recording
+    };
+
+    // NetEq's target delay stays within these; a maximum of 0 leaves it
+    // bounded by |maxPackets| only.
+    int minDelayMs{50};
+    int maxDelayMs{0};
+    // Accelerates in bigger steps when the buffer grows past its target.
+    bool fastAccelerate{true};
+    // Packets buffered before NetEq flushes them all; at least 20.
+    int maxPackets{200};
+
+    static GroupAudioReceiveProfile preset(Preset preset) {
+        GroupAudioReceiveProfile result;
+        switch (preset) {
+            case Preset::Interactive:
+                result.minDelayMs = 0;
+                result.maxDelayMs = 200;
+                result.fastAccelerate = true;
+                result.maxPackets = 50;
+                break;
+            case Preset::Recording:
+                result.minDelayMs = 400;
+                result.maxDelayMs = 0;
+                result.fastAccelerate = false;
+                result.maxPackets = 500;
+                break;
+        }
+        return result;
+    }
+};
+
+// How the incoming streams are mixed for playout; see GroupAudioMixer.
+// Left disabled, webrtc's AudioMixerImpl mixes the three loudest and volumes
+// are applied by each receive stream.
+struct GroupAudioMixerConfig {
+    bool isEnabled{false};
+    // Streams mixed at once, the loudest by the energy of their frame.
+    int maxMixedSources{3};
+    // How much louder a stream has to be to take the place of one mixed.
+    double hysteresisDb{6.0};
+    // Streams at volume 0 aren't decoded.
+    bool skipMutedSources{true};
+};
+
+// How outgoing video is encoded; the defaults leave it all to the
+// platform's encoder factory.
+struct GroupVideoEncoderConfig {
+    enum class Complexity {
+        Normal,
+        High,
+        Higher,
+        Max
+    };
+
+    // FFmpeg H.264 encoder to prefer, e.g. "h264_vaapi" or "h264_nvenc".
+    // H.264 falls back to the platform's encoder when it can't be opened,
+    // other codecs always use the platform's.
+    std::string hardwareEncoder;
+    // Device for encoders that upload frames to one, e.g.
+    // "/dev/dri/renderD128" for VAAPI; empty for the default.
+    std::string hardwareDevice;
+    // Threads a software encoder may use; 0 lets it pick from the number of
+    // cores.
+    int maxThreads{0};
+    // Software VP8 and VP9 encoding effort; above Normal trades CPU for
+    // quality.
+    Complexity complexity{Complexity::Normal};
+    // Encodes each simulcast stream on a thread of its own, at the same
+    // time as the others, rather than all of them one after another.
+    bool parallelSimulcast{false};
+
+    // Leaves the encoders themselves as the platform makes them.
+    bool isDefaultEncoder() const {
+        return hardwareEncoder.empty() && maxThreads == 0 && complexity == Complexity::Normal;
+    }
+
+    bool isDefault() const {
+        return isDefaultEncoder() && !parallelSimulcast;
+    }
+};
+
+// How incoming video is decoded; the default leaves it to the platform's
+// decoder factory.
+struct GroupVideoDecoderConfig {
+    // FFmpeg hardware device type to decode H.264, VP8 and VP9 on, e.g.
+    // "vaapi", which Intel's Quick Sync hardware is also reached through, or
+    // "cuda" for NVDEC. Codecs the device doesn't decode, and streams it
+    // fails on, use the platform's decoders.
+    std::string hardwareDeviceType;
+    // e.g. "/dev/dri/renderD128" for VAAPI or "1" for the second GPU with
+    // CUDA; empty for the default.
+    std::string hardwareDevice;
+
+    bool isDefault() const {
+        return hardwareDeviceType.empty();
+    }
+};
+
 struct MediaSsrcGroup {
     std::string semantics;
     std::vector<uint32_t> ssrcs;
@@ -129,27 +324,166 @@ struct VideoChannelDescription {
     Quality maxQuality = Quality::Thumbnail;
 };
 
+// An incoming video RTP packet: its payload without the RTP header and, for
+// a retransmission, with the original sequence number in place of its own.
+struct GroupIncomingVideoPacket {
+    VideoCodecName codec = VideoCodecName::VP8;
+    // Of the media stream, also for a retransmission.
+    uint32_t ssrc = 0;
+    uint16_t sequenceNumber = 0;
+    uint32_t timestamp = 0;
+    bool marker = false;
+    const uint8_t *payload = nullptr;
+    size_t size = 0;
+};
+
 struct GroupInstanceDescriptor {
     std::shared_ptr<Threads> threads;
     GroupConfig config;
     std::function<void(GroupNetworkState)> networkStateUpdated;
     std::function<void(GroupLevelsUpdate const &)> audioLevelsUpdated;
+    int audioLevelsUpdateIntervalMs{100};
+    bool audioLevelsDeltaUpdates{false};
+    // Runs a sparse native VAD on the decoded audio of every incoming stream
+    // and reports its result as GroupLevelValue::voice, instead of the
+    // sender's voice activity bit from the RTP audio level extension.
+    bool enableIncomingVad{false};
     std::function<void(uint32_t, const AudioFrame &)> onAudioFrame;
+    // Called on the network thread with the payload of every incoming Opus
+    // RTP packet, whether its SSRC is decoded or not; must not block.
+    std::function<void(uint32_t ssrc, uint16_t sequenceNumber, uint32_t timestamp, const uint8_t *payload, size_t size)> onIncomingOpusPacket;
+    // Called on the network thread with every incoming video RTP packet of
+    // the requested video channels, whether the video is decoded or not;
+    // must not block.
+    std::function<void(std::string const &endpointId, GroupIncomingVideoPacket const &packet)> onIncomingVideoPacket;
     std::string initialInputDeviceId;
     std::string initialOutputDeviceId;
+    // An incoming audio channel that never receives anything, created so
+    // playout runs from the start. Without it playout starts with the
+    // first incoming stream, and a send-only call saves a voice channel and
+    // its decoder.
     bool useDummyChannel{true};
     bool disableIncomingChannels{false};
+    // Joins without video: none is sent, setRequestedVideoChannels() is
+    // ignored, and the SFU is told to forward none as soon as the data
+    // channel opens, so video never costs bandwidth or decryption.
+    bool audioOnly{false};
+    // For calls that never send video, such as bots streaming at a fixed
+    // rate: the encoder is held at the profile's highest bitrate without DTX
+    // and outgoing audio leaves transport-wide congestion control out, so
+    // no transport feedback is processed and no bandwidth estimate drives
+    // it. Audio is never held back by the pacer either way. Ignored when
+    // video may be sent.
+    bool constantBitrateAudio{false};
     std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory*)> createAudioDeviceModule;
     std::shared_ptr<VideoCaptureInterface> videoCapture; // deprecated
     std::function<webrtc::VideoTrackSourceInterface*()> getVideoSource;
     std::function<std::shared_ptr<BroadcastPartTask>(int64_t, int64_t, std::function<void(BroadcastPart &&)>)> requestBroadcastPart;
+    // Fetches the video part at a timestamp of the broadcast channel
+    // |channelId|, the audioSsrc of a participant's VideoChannelDescription,
+    // at |quality|; its data is that of a VideoStreamingPart. Without it,
+    // broadcast mode has no video. Only asked for participants requested with
+    // setRequestedVideoChannels() that have an incoming video output.
+    std::function<std::shared_ptr<BroadcastPartTask>(int64_t timestampMilliseconds, int64_t durationMilliseconds, int32_t channelId, VideoChannelDescription::Quality quality, std::function<void(BroadcastPart &&)>)> requestVideoBroadcastPart;
     int outgoingAudioBitrateKbit{32};
+    GroupAudioEncoderProfile outgoingAudioProfile;
     bool disableOutgoingAudioProcessing{false};
+    // Only gates the audio device's input, not shared encoders, bridges or
+    // Opus sources.
+    GroupVoiceGate outgoingVoiceGate;
+    // Receive-only mode: incoming audio is never mixed for playout and the
+    // audio device only gets silence. Incoming streams are still decoded
+    // when |onAudioFrame| is set, so per-SSRC taps keep working.
+    bool disablePlayoutMixing{false};
+    // Broadcast mode hands decoded PCM straight to the playout mixer and the
+    // per-SSRC tap, instead of packetising it as L16 RTP for a raw-PCM
+    // receive channel per speaker.
+    bool directBroadcastAudio{false};
+    // Broadcast parts requested at once: the next one and those right after
+    // it, so a slow link doesn't leave playback waiting on every fetch.
+    int broadcastPrefetchDepth{1};
+    // Calls in this process with the same non-empty key, e.g. listeners of
+    // one chat from different accounts, fetch and decode each broadcast part
+    // once between them; see BroadcastPartCache.
+    std::string broadcastPartCacheKey;
+    // Initial GroupInstanceCustomImpl::setBroadcastDecodedSsrcs().
+    std::vector<uint32_t> broadcastDecodedSsrcs;
+    // Crossfade between RTC and broadcast audio once setConnectionMode()
+    // has switched between them, keeping the mode switched from; 0 cuts
+    // over at once.
+    int connectionModeCrossfadeMs{300};
+    // State carried over from an instance of the same call elsewhere, see
+    // GroupInstanceCustomImpl::getMigrationState(): the outgoing audio SSRC
+    // to join with instead of a random one, and the broadcast part to
+    // continue from instead of the live edge; 0 for neither.
+    uint32_t outgoingAudioSsrc{0};
+    int64_t initialBroadcastTimestampMilliseconds{0};
+    // Incoming audio channels kept created but unbound, so a new speaker can
+    // be bound to one without building a voice channel on the spot.
+    int incomingAudioChannelPoolSize{2};
+    // Silence after which an incoming audio channel may be released to make
+    // room for a new speaker.
+    int incomingAudioChannelIdleTimeoutMs{1000};
+    // Level, volume and broadcast sequence state of an SSRC heard nothing
+    // from for this long, and with no channel left, is dropped; a volume
+    // has to be set again if it comes back. 0 keeps it for the whole call.
+    int ssrcStateIdleTimeoutMs{60000};
+    // Incoming audio streams decoded at once. Once reached, a new speaker
+    // only gets a channel by displacing an idle one or, going by the RTP
+    // audio level extension, a clearly quieter one; packets of speakers
+    // without a channel never reach a decoder.
+    int maxDecodedIncomingAudioStreams{5};
+    // When non-zero, incoming streams are decoded in parallel before each
+    // playout mix, and those not decoded this many microseconds into it
+    // are concealed; see ParallelDecodingAudioMixer.
+    int parallelAudioDecodingDeadlineUs{0};
+    GroupAudioReceiveProfile incomingAudioProfile;
+    GroupAudioMixerConfig audioMixer;
     VideoContentType videoContentType{VideoContentType::None};
+    // Calls that send unprocessed audio only get a noise suppressor to
+    // toggle if this is set.
     bool initialEnableNoiseSuppression{false};
     std::vector<VideoCodecName> videoCodecPreferences;
+    GroupVideoEncoderConfig videoEncoderConfig;
+    GroupVideoDecoderConfig videoDecoderConfig;
     std::function<std::shared_ptr<RequestMediaChannelDescriptionTask>(std::vector<uint32_t> const &, std::function<void(std::vector<MediaChannelDescription> &&)>)> requestMediaChannelDescriptions;
     int minOutgoingVideoBitrateKbit{100};
+    // Shared with other group calls in the process; see GroupEngineContext.
+    std::shared_ptr<GroupEngineContext> engineContext;
+    // DTLS certificates generated ahead of time; see GroupCertificatePool.
+    std::shared_ptr<GroupCertificatePool> certificatePool;
+    // UDP sockets read and written with recvmmsg() / sendmmsg() where the
+    // platform has them; see BatchedPacketSocketFactory.
+    bool useBatchedUdpSockets{false};
+    // UDP sockets shared with other calls; see GroupSharedUdpSockets.
+    std::shared_ptr<GroupSharedUdpSockets> sharedUdpSockets;
+    // Opus encoder shared with other calls sending the same audio; see
+    // GroupSharedAudioEncoder. Outgoing audio processing is off with it.
+    std::shared_ptr<GroupSharedAudioEncoder> sharedAudioEncoder;
+    // Opus decoding shared with other calls receiving the same participants;
+    // see GroupSharedAudioDecoder.
+    std::shared_ptr<GroupSharedAudioDecoder> sharedAudioDecoder;
+    // Sends the participant of another call this bridge relays instead of
+    // encoding the captured audio; see GroupAudioBridge. Outgoing audio
+    // processing is off with it.
+    std::shared_ptr<GroupAudioBridge> outgoingAudioBridge;
+    // Sends the packets of this source instead of encoding the captured
+    // audio; see GroupOpusPacketSource. Outgoing audio processing is off
+    // with it.
+    std::shared_ptr<GroupOpusPacketSource> outgoingOpusSource;
+    // Receives the timing of outgoing and incoming audio RTP packets.
+    std::shared_ptr<LatencyTrace> latencyTrace;
+    // Called on the media thread every |statsUpdateIntervalMs| with the
+    // call's current stats, once it has started.
+    std::function<void(CallStatsSnapshot const &)> statsUpdated;
+    int statsUpdateIntervalMs{5000};
+    // Called on the media thread once the media engine and call exist.
+    // Startup is asynchronous: emitJoinPayload() can be used before this,
+    // everything else is queued until then.
+    std::function<void()> startCompleted;
+    // WebRTC field trials of this call only, as "Name/Value/Name/Value/",
+    // over the defaults; see GroupFieldTrials.
+    std::string fieldTrials;
 };
 
 template <typename T>
@@ -164,6 +498,8 @@ public:
 
     virtual void stop() = 0;
 
+    // Between RTC and broadcast, |keepBroadcastIfWasEnabled| keeps the mode
+    // switched from, whichever it is, until the new one is connected.
     virtual void setConnectionMode(GroupConnectionMode connectionMode, bool keepBroadcastIfWasEnabled) = 0;
 
     virtual void emitJoinPayload(std::function<void(GroupJoinPayload const &)> completion) = 0;
@@ -180,6 +516,10 @@ public:
     virtual void addExternalAudioSamples(std::vector<uint8_t> &&samples) = 0;
 
     virtual void addIncomingVideoOutput(std::string const &endpointId, std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink) = 0;
+    // Only max_pixel_count is used: an endpoint's video is requested at the
+    // lowest quality that satisfies all of its outputs, and not decoded at
+    // all while it has none. Adding an output again updates its wants.
+    virtual void addIncomingVideoOutput(std::string const &endpointId, std::weak_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink, rtc::VideoSinkWants const &wants) = 0;
 
     virtual void setVolume(uint32_t ssrc, double volume) = 0;
     virtual void setRequestedVideoChannels(std::vector<VideoChannelDescription> &&requestedVideoChannels) = 0;
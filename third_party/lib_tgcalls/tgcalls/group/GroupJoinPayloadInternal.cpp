@@ -1,28 +1,93 @@
 #include "GroupJoinPayloadInternal.h"
 
-#include "third-party/json11.hpp"
+#include "JsonStream.h"
+#include <algorithm>
 #include <sstream>
 
 namespace tgcalls {
 
 namespace {
 
-absl::optional<int32_t> parseInt(json11::Json::object const &object, std::string const &key) {
-    const auto value = object.find(key);
-    if (value == object.end() || !value->second.is_number()) {
-        return absl::nullopt;
+// Read a member of the expected type; one of another type is skipped and
+// counts as missing.
+bool parseInt(JsonReader &reader, int32_t &to) {
+    if (reader.type() != JsonReader::Type::Number) {
+        reader.skipValue();
+        return false;
     }
-    return value->second.int_value();
+    return reader.readInt(to);
 }
 
-absl::optional<std::string> parseString(json11::Json::object const &object, std::string const &key) {
-    const auto value = object.find(key);
-    if (value == object.end() || !value->second.is_string()) {
-        return absl::nullopt;
+bool parseString(JsonReader &reader, std::string &to) {
+    if (reader.type() != JsonReader::Type::String) {
+        reader.skipValue();
+        return false;
     }
-    return value->second.string_value();
+    return reader.readString(to);
 }
 
+template <typename T>
+struct StringField {
+    const char *key;
+    std::string T::*member;
+    bool isRequired;
+};
+
+// Reads the object at the cursor into the string |fields| of |result|,
+// skipping other members. False unless every required field was there.
+template <typename T, size_t Count>
+bool parseStringFields(JsonReader &reader, T &result, const StringField<T> (&fields)[Count]) {
+    static_assert(Count <= 32, "Too many fields.");
+
+    if (reader.type() != JsonReader::Type::Object) {
+        reader.skipValue();
+        return false;
+    }
+    uint32_t found = 0;
+    reader.readObject([&](absl::string_view key) {
+        for (size_t i = 0; i < Count; i++) {
+            if (key == fields[i].key) {
+                if (parseString(reader, result.*(fields[i].member))) {
+                    found |= (uint32_t(1) << i);
+                }
+                return;
+            }
+        }
+        reader.skipValue();
+    });
+    for (size_t i = 0; i < Count; i++) {
+        if (fields[i].isRequired && !(found & (uint32_t(1) << i))) {
+            return false;
+        }
+    }
+    return reader.ok();
+}
+
+using Fingerprint = GroupJoinTransportDescription::Fingerprint;
+using Candidate = GroupJoinTransportDescription::Candidate;
+
+const StringField<Fingerprint> kFingerprintFields[] = {
+    { "hash", &Fingerprint::hash, true },
+    { "fingerprint", &Fingerprint::fingerprint, true },
+    { "setup", &Fingerprint::setup, true },
+};
+
+const StringField<Candidate> kCandidateFields[] = {
+    { "port", &Candidate::port, true },
+    { "protocol", &Candidate::protocol, true },
+    { "network", &Candidate::network, true },
+    { "generation", &Candidate::generation, true },
+    { "id", &Candidate::id, true },
+    { "component", &Candidate::component, true },
+    { "foundation", &Candidate::foundation, true },
+    { "priority", &Candidate::priority, true },
+    { "ip", &Candidate::ip, true },
+    { "type", &Candidate::type, true },
+    { "tcptype", &Candidate::tcpType, false },
+    { "rel-addr", &Candidate::relAddr, false },
+    { "rel-port", &Candidate::relPort, false },
+};
+
 template <typename Out>
 void splitString(const std::string &s, char delim, Out result) {
     std::istringstream iss(s);
@@ -38,335 +103,289 @@ std::vector<std::string> splitString(const std::string &s, char delim) {
     return elems;
 }
 
-absl::optional<GroupJoinTransportDescription> parseTransportDescription(json11::Json::object const &object) {
+absl::optional<GroupJoinTransportDescription> parseTransportDescription(JsonReader &reader) {
     GroupJoinTransportDescription result;
 
-    if (const auto pwd = parseString(object, "pwd")) {
-        result.pwd = pwd.value();
-    } else {
-        return absl::nullopt;
-    }
-
-    if (const auto ufrag = parseString(object, "ufrag")) {
-        result.ufrag = ufrag.value();
-    } else {
-        return absl::nullopt;
-    }
-
-    const auto fingerprints = object.find("fingerprints");
-    if (fingerprints == object.end() || !fingerprints->second.is_array()) {
-        return absl::nullopt;
-    }
-    for (const auto &fingerprint : fingerprints->second.array_items()) {
-        if (!fingerprint.is_object()) {
-            return absl::nullopt;
-        }
-
-        GroupJoinTransportDescription::Fingerprint parsedFingerprint;
-
-        if (const auto hash = parseString(fingerprint.object_items(), "hash")) {
-            parsedFingerprint.hash = hash.value();
-        } else {
-            return absl::nullopt;
-        }
-
-        if (const auto fingerprintValue = parseString(fingerprint.object_items(), "fingerprint")) {
-            parsedFingerprint.fingerprint = fingerprintValue.value();
-        } else {
-            return absl::nullopt;
-        }
-
-        if (const auto setup = parseString(fingerprint.object_items(), "setup")) {
-            parsedFingerprint.setup = setup.value();
+    auto hasPwd = false;
+    auto hasUfrag = false;
+    auto hasFingerprints = false;
+    auto hasCandidates = false;
+    auto isValid = true;
+    reader.readObject([&](absl::string_view key) {
+        if (key == "pwd") {
+            hasPwd = parseString(reader, result.pwd);
+        } else if (key == "ufrag") {
+            hasUfrag = parseString(reader, result.ufrag);
+        } else if (key == "fingerprints" && reader.type() == JsonReader::Type::Array) {
+            hasFingerprints = true;
+            result.fingerprints.clear();
+            reader.readArray([&] {
+                Fingerprint parsedFingerprint;
+                if (parseStringFields(reader, parsedFingerprint, kFingerprintFields)) {
+                    result.fingerprints.push_back(std::move(parsedFingerprint));
+                } else {
+                    isValid = false;
+                }
+            });
+        } else if (key == "candidates" && reader.type() == JsonReader::Type::Array) {
+            hasCandidates = true;
+            result.candidates.clear();
+            reader.readArray([&] {
+                Candidate parsedCandidate;
+                if (parseStringFields(reader, parsedCandidate, kCandidateFields)) {
+                    result.candidates.push_back(std::move(parsedCandidate));
+                } else {
+                    isValid = false;
+                }
+            });
         } else {
-            return absl::nullopt;
+            reader.skipValue();
         }
+    });
 
-        result.fingerprints.push_back(std::move(parsedFingerprint));
-    }
-
-    const auto candidates = object.find("candidates");
-    if (candidates == object.end() || !candidates->second.is_array()) {
+    if (!reader.ok() || !isValid || !hasPwd || !hasUfrag || !hasFingerprints || !hasCandidates) {
         return absl::nullopt;
     }
-    for (const auto &candidate : candidates->second.array_items()) {
-        if (!candidate.is_object()) {
-            return absl::nullopt;
-        }
-
-        GroupJoinTransportDescription::Candidate parsedCandidate;
-
-        if (const auto port = parseString(candidate.object_items(), "port")) {
-            parsedCandidate.port = port.value();
-        } else {
-            return absl::nullopt;
-        }
-
-        if (const auto protocol = parseString(candidate.object_items(), "protocol")) {
-            parsedCandidate.protocol = protocol.value();
-        } else {
-            return absl::nullopt;
-        }
-
-        if (const auto network = parseString(candidate.object_items(), "network")) {
-            parsedCandidate.network = network.value();
-        } else {
-            return absl::nullopt;
-        }
-
-        if (const auto generation = parseString(candidate.object_items(), "generation")) {
-            parsedCandidate.generation = generation.value();
-        } else {
-            return absl::nullopt;
-        }
-
-        if (const auto id = parseString(candidate.object_items(), "id")) {
-            parsedCandidate.id = id.value();
-        } else {
-            return absl::nullopt;
-        }
-
-        if (const auto component = parseString(candidate.object_items(), "component")) {
-            parsedCandidate.component = component.value();
-        } else {
-            return absl::nullopt;
-        }
-
-        if (const auto foundation = parseString(candidate.object_items(), "foundation")) {
-            parsedCandidate.foundation = foundation.value();
-        } else {
-            return absl::nullopt;
-        }
+    return result;
+}
 
-        if (const auto priority = parseString(candidate.object_items(), "priority")) {
-            parsedCandidate.priority = priority.value();
-        } else {
-            return absl::nullopt;
-        }
+void parseFeedbackType(JsonReader &reader, std::vector<GroupJoinPayloadVideoPayloadType::FeedbackType> &to) {
+    if (reader.type() != JsonReader::Type::Object) {
+        reader.skipValue();
+        return;
+    }
 
-        if (const auto ip = parseString(candidate.object_items(), "ip")) {
-            parsedCandidate.ip = ip.value();
+    GroupJoinPayloadVideoPayloadType::FeedbackType parsedFeedbackType;
+    auto hasType = false;
+    auto hasSubtype = false;
+    reader.readObject([&](absl::string_view key) {
+        if (key == "type") {
+            hasType = parseString(reader, parsedFeedbackType.type);
+        } else if (key == "subtype") {
+            hasSubtype = parseString(reader, parsedFeedbackType.subtype);
         } else {
-            return absl::nullopt;
+            reader.skipValue();
         }
+    });
+    if (!hasType) {
+        return;
+    }
 
-        if (const auto type = parseString(candidate.object_items(), "type")) {
-            parsedCandidate.type = type.value();
+    if (!hasSubtype) {
+        auto components = splitString(parsedFeedbackType.type, ' ');
+        parsedFeedbackType.subtype.clear();
+        if (components.size() == 1) {
+            parsedFeedbackType.type = components[0];
+        } else if (components.size() == 2) {
+            parsedFeedbackType.type = components[0];
+            parsedFeedbackType.subtype = components[1];
         } else {
-            return absl::nullopt;
-        }
-
-        if (const auto tcpType = parseString(candidate.object_items(), "tcptype")) {
-            parsedCandidate.tcpType = tcpType.value();
-        }
-
-        if (const auto relAddr = parseString(candidate.object_items(), "rel-addr")) {
-            parsedCandidate.relAddr = relAddr.value();
+            return;
         }
-
-        if (const auto relPort = parseString(candidate.object_items(), "rel-port")) {
-            parsedCandidate.relPort = relPort.value();
-        }
-
-        result.candidates.push_back(std::move(parsedCandidate));
     }
 
-    return result;
+    to.push_back(std::move(parsedFeedbackType));
 }
 
-absl::optional<GroupJoinPayloadVideoPayloadType> parsePayloadType(json11::Json::object const &object) {
+absl::optional<GroupJoinPayloadVideoPayloadType> parsePayloadType(JsonReader &reader) {
     GroupJoinPayloadVideoPayloadType result;
-
-    if (const auto id = parseInt(object, "id")) {
-        result.id = (uint32_t)id.value();
-    } else {
-        return absl::nullopt;
-    }
-
-    if (const auto name = parseString(object, "name")) {
-        result.name = name.value();
-    } else {
-        return absl::nullopt;
-    }
-
-    if (const auto clockrate = parseInt(object, "clockrate")) {
-        result.clockrate = (uint32_t)clockrate.value();
-    } else {
-        result.clockrate = 0;
-    }
-
-    if (const auto channels = parseInt(object, "channels")) {
-        result.channels = (uint32_t)channels.value();
-    } else {
-        result.channels = 1;
-    }
-
-    const auto parameters = object.find("parameters");
-    if (parameters != object.end() && parameters->second.is_object()) {
-        for (const auto &parameter : parameters->second.object_items()) {
-            if (parameter.second.is_string()) {
-                result.parameters.push_back(std::make_pair(parameter.first, parameter.second.string_value()));
+    result.clockrate = 0;
+    result.channels = 1;
+
+    auto hasId = false;
+    auto hasName = false;
+    reader.readObject([&](absl::string_view key) {
+        int32_t value = 0;
+        if (key == "id") {
+            if (parseInt(reader, value)) {
+                result.id = (uint32_t)value;
+                hasId = true;
             }
-        }
-    }
-
-    const auto rtcpFbs = object.find("rtcp-fbs");
-    if (rtcpFbs != object.end() && rtcpFbs->second.is_array()) {
-        for (const auto &item : rtcpFbs->second.array_items()) {
-            if (item.is_object()) {
-                const auto type = item.object_items().find("type");
-                if (type != item.object_items().end() && type->second.is_string()) {
-                    GroupJoinPayloadVideoPayloadType::FeedbackType parsedFeedbackType;
-
-                    const auto typeString = type->second.string_value();
-
-                    const auto subtype = item.object_items().find("subtype");
-                    if (subtype != item.object_items().end() && subtype->second.is_string()) {
-                        parsedFeedbackType.type = typeString;
-                        parsedFeedbackType.subtype = subtype->second.string_value();
-                    } else {
-                        auto components = splitString(typeString, ' ');
-                        if (components.size() == 1) {
-                            parsedFeedbackType.type = components[0];
-                        } else if (components.size() == 2) {
-                            parsedFeedbackType.type = components[0];
-                            parsedFeedbackType.subtype = components[1];
-                        } else {
-                            continue;
-                        }
-                    }
-
-                    result.feedbackTypes.push_back(std::move(parsedFeedbackType));
-                }
+        } else if (key == "name") {
+            hasName = parseString(reader, result.name);
+        } else if (key == "clockrate") {
+            if (parseInt(reader, value)) {
+                result.clockrate = (uint32_t)value;
+            }
+        } else if (key == "channels") {
+            if (parseInt(reader, value)) {
+                result.channels = (uint32_t)value;
             }
+        } else if (key == "parameters" && reader.type() == JsonReader::Type::Object) {
+            reader.readObject([&](absl::string_view key) {
+                auto name = std::string(key);
+                std::string parameter;
+                if (parseString(reader, parameter)) {
+                    result.parameters.push_back(std::make_pair(std::move(name), std::move(parameter)));
+                }
+            });
+        } else if (key == "rtcp-fbs" && reader.type() == JsonReader::Type::Array) {
+            reader.readArray([&] {
+                parseFeedbackType(reader, result.feedbackTypes);
+            });
+        } else {
+            reader.skipValue();
         }
-    }
+    });
 
+    if (!hasId || !hasName) {
+        return absl::nullopt;
+    }
     return result;
 }
 
-absl::optional<GroupJoinVideoInformation> parseVideoInformation(json11::Json::object const &object) {
+GroupJoinVideoInformation parseVideoInformation(JsonReader &reader) {
     GroupJoinVideoInformation result;
 
-    const auto serverSources = object.find("server_sources");
-    if (serverSources != object.end() && serverSources->second.is_array()) {
-        for (const auto &item : serverSources->second.array_items()) {
-            if (item.is_number()) {
-                int32_t value = item.int_value();
-                uint32_t unsignedValue = *(uint32_t *)&value;
-                result.serverVideoBandwidthProbingSsrc = unsignedValue;
-            }
-        }
-    }
-
-    const auto payloadTypes = object.find("payload-types");
-    if (payloadTypes != object.end() && payloadTypes->second.is_array()) {
-        for (const auto &payloadType : payloadTypes->second.array_items()) {
-            if (payloadType.is_object()) {
-                if (const auto parsedPayloadType = parsePayloadType(payloadType.object_items())) {
+    reader.readObject([&](absl::string_view key) {
+        if (key == "server_sources" && reader.type() == JsonReader::Type::Array) {
+            reader.readArray([&] {
+                int32_t value = 0;
+                if (parseInt(reader, value)) {
+                    uint32_t unsignedValue = *(uint32_t *)&value;
+                    result.serverVideoBandwidthProbingSsrc = unsignedValue;
+                }
+            });
+        } else if (key == "payload-types" && reader.type() == JsonReader::Type::Array) {
+            reader.readArray([&] {
+                if (reader.type() != JsonReader::Type::Object) {
+                    reader.skipValue();
+                } else if (const auto parsedPayloadType = parsePayloadType(reader)) {
                     result.payloadTypes.push_back(parsedPayloadType.value());
                 }
-            }
-        }
-    }
-
-    const auto rtpHdrexts = object.find("rtp-hdrexts");
-    if (rtpHdrexts != object.end() && rtpHdrexts->second.is_array()) {
-        for (const auto &rtpHdrext : rtpHdrexts->second.array_items()) {
-            if (rtpHdrext.is_object()) {
-                const auto id = rtpHdrext.object_items().find("id");
-                if (id == rtpHdrext.object_items().end() || !id->second.is_number()) {
-                    continue;
+            });
+        } else if (key == "rtp-hdrexts" && reader.type() == JsonReader::Type::Array) {
+            reader.readArray([&] {
+                if (reader.type() != JsonReader::Type::Object) {
+                    reader.skipValue();
+                    return;
                 }
-
-                const auto uri = rtpHdrext.object_items().find("uri");
-                if (uri == rtpHdrext.object_items().end() || !uri->second.is_string()) {
-                    continue;
+                int32_t id = 0;
+                std::string uri;
+                auto hasId = false;
+                auto hasUri = false;
+                reader.readObject([&](absl::string_view key) {
+                    if (key == "id") {
+                        hasId = parseInt(reader, id);
+                    } else if (key == "uri") {
+                        hasUri = parseString(reader, uri);
+                    } else {
+                        reader.skipValue();
+                    }
+                });
+                if (hasId && hasUri) {
+                    result.extensionMap.push_back(std::make_pair(id, std::move(uri)));
                 }
-
-                result.extensionMap.push_back(std::make_pair(id->second.int_value(), uri->second.string_value()));
-            }
+            });
+        } else if (key == "endpoint") {
+            parseString(reader, result.endpointId);
+        } else {
+            reader.skipValue();
         }
-    }
-
-    const auto endpointId = object.find("endpoint");
-    if (endpointId != object.end() && endpointId->second.is_string()) {
-        result.endpointId = endpointId->second.string_value();
-    }
+    });
 
     return result;
 }
 
 }
 
+bool operator==(GroupJoinPayloadVideoPayloadType const &lhs, GroupJoinPayloadVideoPayloadType const &rhs) {
+    if (lhs.id != rhs.id || lhs.name != rhs.name || lhs.clockrate != rhs.clockrate || lhs.channels != rhs.channels || lhs.parameters != rhs.parameters) {
+        return false;
+    }
+    return std::equal(lhs.feedbackTypes.begin(), lhs.feedbackTypes.end(), rhs.feedbackTypes.begin(), rhs.feedbackTypes.end(), [](auto const &left, auto const &right) {
+        return left.type == right.type && left.subtype == right.subtype;
+    });
+}
+
+bool operator==(GroupJoinVideoInformation const &lhs, GroupJoinVideoInformation const &rhs) {
+    return lhs.serverVideoBandwidthProbingSsrc == rhs.serverVideoBandwidthProbingSsrc
+        && lhs.endpointId == rhs.endpointId
+        && lhs.payloadTypes == rhs.payloadTypes
+        && lhs.extensionMap == rhs.extensionMap;
+}
+
 std::string GroupJoinInternalPayload::serialize() {
-    json11::Json::object object;
+    std::string result;
+    JsonWriter json(result);
+    json.beginObject();
 
     int32_t signedSsrc = *(int32_t *)&audioSsrc;
 
-    object.insert(std::make_pair("ssrc", json11::Json(signedSsrc)));
-    object.insert(std::make_pair("ufrag", json11::Json(transport.ufrag)));
-    object.insert(std::make_pair("pwd", json11::Json(transport.pwd)));
+    json.key("ssrc");
+    json.intValue(signedSsrc);
+    json.key("ufrag");
+    json.stringValue(transport.ufrag);
+    json.key("pwd");
+    json.stringValue(transport.pwd);
 
-    json11::Json::array fingerprints;
+    json.key("fingerprints");
+    json.beginArray();
     for (const auto &fingerprint : transport.fingerprints) {
-        json11::Json::object fingerprintJson;
-
-        fingerprintJson.insert(std::make_pair("hash", json11::Json(fingerprint.hash)));
-        fingerprintJson.insert(std::make_pair("fingerprint", json11::Json(fingerprint.fingerprint)));
-        fingerprintJson.insert(std::make_pair("setup", json11::Json(fingerprint.setup)));
-
-        fingerprints.push_back(json11::Json(std::move(fingerprintJson)));
+        json.beginObject();
+        json.key("hash");
+        json.stringValue(fingerprint.hash);
+        json.key("fingerprint");
+        json.stringValue(fingerprint.fingerprint);
+        json.key("setup");
+        json.stringValue(fingerprint.setup);
+        json.endObject();
     }
-    object.insert(std::make_pair("fingerprints", json11::Json(std::move(fingerprints))));
+    json.endArray();
 
     if (videoInformation) {
-        json11::Json::array ssrcGroups;
+        json.key("ssrc-groups");
+        json.beginArray();
         for (const auto &ssrcGroup : videoInformation->ssrcGroups) {
-            json11::Json::object ssrcGroupJson;
+            json.beginObject();
 
-            json11::Json::array ssrcGroupSources;
+            json.key("sources");
+            json.beginArray();
             for (auto ssrc : ssrcGroup.ssrcs) {
                 int32_t signedValue = *(int32_t *)&ssrc;
-                ssrcGroupSources.push_back(json11::Json(signedValue));
+                json.intValue(signedValue);
             }
+            json.endArray();
 
-            ssrcGroupJson.insert(std::make_pair("sources", json11::Json(std::move(ssrcGroupSources))));
-            ssrcGroupJson.insert(std::make_pair("semantics", json11::Json(ssrcGroup.semantics)));
+            json.key("semantics");
+            json.stringValue(ssrcGroup.semantics);
 
-            ssrcGroups.push_back(json11::Json(std::move(ssrcGroupJson)));
+            json.endObject();
         }
-        object.insert(std::make_pair("ssrc-groups", json11::Json(std::move(ssrcGroups))));
+        json.endArray();
     }
 
-    auto json = json11::Json(std::move(object));
-    return json.dump();
+    json.endObject();
+    return result;
 }
 
 absl::optional<GroupJoinResponsePayload> GroupJoinResponsePayload::parse(std::string const &data) {
-    std::string parsingError;
-    auto json = json11::Json::parse(std::string(data.begin(), data.end()), parsingError);
-    if (json.type() != json11::Json::OBJECT) {
+    JsonReader reader(data);
+    if (reader.type() != JsonReader::Type::Object) {
         return absl::nullopt;
     }
 
     tgcalls::GroupJoinResponsePayload result;
 
-    const auto transport = json.object_items().find("transport");
-    if (transport == json.object_items().end() || !transport->second.is_object()) {
-        return absl::nullopt;
-    }
-    if (const auto parsedTransport = parseTransportDescription(transport->second.object_items())) {
-        result.transport = parsedTransport.value();
-    } else {
-        return absl::nullopt;
-    }
+    auto hasTransport = false;
+    reader.readObject([&](absl::string_view key) {
+        if (key == "transport" && reader.type() == JsonReader::Type::Object) {
+            if (auto parsedTransport = parseTransportDescription(reader)) {
+                result.transport = std::move(parsedTransport.value());
+                hasTransport = true;
+            } else {
+                hasTransport = false;
+            }
+        } else if (key == "video" && reader.type() == JsonReader::Type::Object) {
+            result.videoInformation = parseVideoInformation(reader);
+        } else {
+            reader.skipValue();
+        }
+    });
 
-    const auto video = json.object_items().find("video");
-    if (video != json.object_items().end() && video->second.is_object()) {
-        result.videoInformation = parseVideoInformation(video->second.object_items());
+    if (!reader.finish() || !hasTransport) {
+        return absl::nullopt;
     }
-
     return result;
 }
 
@@ -11,6 +11,9 @@
 
 namespace tgcalls {
 
+bool operator==(GroupJoinPayloadVideoPayloadType const &lhs, GroupJoinPayloadVideoPayloadType const &rhs);
+bool operator==(GroupJoinVideoInformation const &lhs, GroupJoinVideoInformation const &rhs);
+
 struct GroupJoinResponsePayload {
     GroupJoinTransportDescription transport;
     absl::optional<GroupJoinVideoInformation> videoInformation;
@@ -1,9 +1,15 @@
 #include "group/GroupNetworkManager.h"
 
+#include "group/BatchedUdpSocket.h"
+#include "group/GroupCertificatePool.h"
+#include "group/GroupPacketBufferPool.h"
+#include "group/GroupSharedUdpSockets.h"
+
 #include "p2p/base/basic_packet_socket_factory.h"
 #include "p2p/client/basic_port_allocator.h"
+#include "p2p/base/connection.h"
 #include "p2p/base/p2p_transport_channel.h"
-#include "p2p/base/basic_async_resolver_factory.h"
+#include "api/async_resolver_factory.h"
 #include "api/packet_socket_factory.h"
 #include "rtc_base/task_utils/to_queued_task.h"
 #include "rtc_base/rtc_certificate_generator.h"
@@ -13,12 +19,20 @@
 #include "p2p/base/dtls_transport_factory.h"
 #include "pc/dtls_srtp_transport.h"
 #include "pc/dtls_transport.h"
+#include "modules/rtp_rtcp/include/rtp_header_extension_map.h"
+#include "modules/rtp_rtcp/source/rtp_header_extensions.h"
 #include "modules/rtp_rtcp/source/rtp_utility.h"
 #include "modules/rtp_rtcp/source/byte_io.h"
 #include "platform/PlatformInterface.h"
+#include "SharedNetworkEnvironment.h"
 #include "TurnCustomizerImpl.h"
 #include "SctpDataChannelProviderInterfaceImpl.h"
+#include "HotPathLog.h"
 #include "StaticThreads.h"
+#include "HotPathCounters.h"
+#include "LatencyTrace.h"
+
+#include <algorithm>
 
 namespace tgcalls {
 
@@ -51,7 +65,7 @@ static void updateHeaderWithVoiceActivity(rtc::CopyOnWriteBuffer *packet, const
         }
 
         if (id == 15) {
-            RTC_LOG(LS_VERBOSE)
+            TGCALLS_HOT_PATH_LOG(LS_VERBOSE)
             << "RTP extension header 15 encountered. Terminate parsing.";
             return;
         }
@@ -80,51 +94,6 @@ static void updateHeaderWithVoiceActivity(rtc::CopyOnWriteBuffer *packet, const
     }
 }
 
-static void readHeaderVoiceActivity(const uint8_t* ptrRTPDataExtensionEnd, const uint8_t* ptr, bool &didRead, uint8_t &audioLevel, bool &voiceActivity) {
-    while (ptrRTPDataExtensionEnd - ptr > 0) {
-        //  0
-        //  0 1 2 3 4 5 6 7
-        // +-+-+-+-+-+-+-+-+
-        // |  ID   |  len  |
-        // +-+-+-+-+-+-+-+-+
-
-        // Note that 'len' is the header extension element length, which is the
-        // number of bytes - 1.
-        const int id = (*ptr & 0xf0) >> 4;
-        const int len = (*ptr & 0x0f);
-        ptr++;
-
-        if (id == 0) {
-            // Padding byte, skip ignoring len.
-            continue;
-        }
-
-        if (id == 15) {
-            RTC_LOG(LS_VERBOSE)
-            << "RTP extension header 15 encountered. Terminate parsing.";
-            return;
-        }
-
-        if (ptrRTPDataExtensionEnd - ptr < (len + 1)) {
-            RTC_LOG(LS_WARNING) << "Incorrect one-byte extension len: " << (len + 1)
-            << ", bytes left in buffer: "
-            << (ptrRTPDataExtensionEnd - ptr);
-            return;
-        }
-
-        if (id == 1) { // kAudioLevelUri
-            didRead = true;
-            audioLevel = ptr[0] & 0x7f;
-            voiceActivity = (ptr[0] & 0x80) != 0;
-
-            return;
-        }
-
-        ptr += (len + 1);
-    }
-}
-
-
 static void maybeUpdateRtpVoiceActivity(rtc::CopyOnWriteBuffer *packet, bool voiceActivity) {
     const uint8_t *_ptrRTPDataBegin = packet->data();
     const uint8_t *_ptrRTPDataEnd = packet->data() + packet->size();
@@ -200,85 +169,48 @@ static void maybeUpdateRtpVoiceActivity(rtc::CopyOnWriteBuffer *packet, bool voi
     }
 }
 
-static void maybeReadRtpVoiceActivity(rtc::CopyOnWriteBuffer *packet, bool &didRead, uint32_t &ssrc, uint8_t &audioLevel, bool &voiceActivity) {
-    const uint8_t *_ptrRTPDataBegin = packet->data();
-    const uint8_t *_ptrRTPDataEnd = packet->data() + packet->size();
-
-    const ptrdiff_t length = _ptrRTPDataEnd - _ptrRTPDataBegin;
-    if (length < kRtpMinParseLength) {
-        return;
-    }
-
-    // Version
-    const uint8_t V = _ptrRTPDataBegin[0] >> 6;
-    // eXtension
-    const bool X = ((_ptrRTPDataBegin[0] & 0x10) == 0) ? false : true;
-    const uint8_t CC = _ptrRTPDataBegin[0] & 0x0f;
-
-    const uint8_t PT = _ptrRTPDataBegin[1] & 0x7f;
-
-    const uint8_t* ptr = &_ptrRTPDataBegin[4];
-
-    ptr += 4;
-
-    ssrc = webrtc::ByteReader<uint32_t>::ReadBigEndian(ptr);
-    ptr += 4;
-
-    if (V != kRtpExpectedVersion) {
-        return;
-    }
-
-    const size_t CSRCocts = CC * 4;
-
-    if ((ptr + CSRCocts) > _ptrRTPDataEnd) {
-        return;
-    }
+// Opus, the only audio payload type of group calls.
+static bool isAudioRtpPacket(rtc::CopyOnWriteBuffer const *packet) {
+    return packet->size() >= 2 && (packet->data()[1] & 0x7f) == 111;
+}
 
-    if (PT != 111) {
-        return;
+static GroupRtpPacketHeader parseRtpPacketHeader(rtc::CopyOnWriteBuffer const &packet) {
+    static const webrtc::RtpHeaderExtensionMap extensionMap = [] {
+        webrtc::RtpHeaderExtensionMap map;
+        map.Register<webrtc::AudioLevel>(1);
+        return map;
+    }();
+
+    GroupRtpPacketHeader result;
+    webrtc::RtpUtility::RtpHeaderParser parser(packet.data(), packet.size());
+    if (parser.RTCP()) {
+        result.type = GroupRtpPacketHeader::Type::Rtcp;
+        return result;
     }
-
-    for (uint8_t i = 0; i < CC; ++i) {
-        ptr += 4;
+    webrtc::RTPHeader header;
+    if (!parser.Parse(&header, &extensionMap)) {
+        return result;
     }
-
-    if (X) {
-      /* RTP header extension, RFC 3550.
-       0                   1                   2                   3
-       0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-      |      defined by profile       |           length              |
-      +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-      |                        header extension                       |
-      |                             ....                              |
-      */
-      const ptrdiff_t remain = _ptrRTPDataEnd - ptr;
-      if (remain < 4) {
-          return;
-      }
-
-      uint16_t definedByProfile = webrtc::ByteReader<uint16_t>::ReadBigEndian(ptr);
-      ptr += 2;
-
-      // in 32 bit words
-      size_t XLen = webrtc::ByteReader<uint16_t>::ReadBigEndian(ptr);
-      ptr += 2;
-      XLen *= 4;  // in bytes
-
-      if (static_cast<size_t>(remain) < (4 + XLen)) {
-          return;
-      }
-      static constexpr uint16_t kRtpOneByteHeaderExtensionId = 0xBEDE;
-      if (definedByProfile == kRtpOneByteHeaderExtensionId) {
-          const uint8_t* ptrRTPDataExtensionEnd = ptr + XLen;
-          readHeaderVoiceActivity(ptrRTPDataExtensionEnd, ptr, didRead, audioLevel, voiceActivity);
-      }
+    result.type = GroupRtpPacketHeader::Type::Rtp;
+    result.payloadType = header.payloadType;
+    result.marker = header.markerBit;
+    if (header.payloadType == 111 && header.extension.hasAudioLevel) {
+        result.hasAudioLevel = true;
+        result.audioLevel = header.extension.audioLevel;
+        result.isSpeech = header.extension.voiceActivity;
     }
+    result.sequenceNumber = header.sequenceNumber;
+    result.timestamp = header.timestamp;
+    result.ssrc = header.ssrc;
+    result.headerLength = (uint16_t)header.headerLength;
+    result.paddingLength = (uint16_t)header.paddingLength;
+    return result;
 }
 
 class WrappedDtlsSrtpTransport : public webrtc::DtlsSrtpTransport {
 public:
     bool _voiceActivity = false;
+    std::shared_ptr<LatencyTrace> _latencyTrace;
 
 public:
     WrappedDtlsSrtpTransport(bool rtcp_mux_enabled) :
@@ -291,11 +223,19 @@ public:
 
     bool SendRtpPacket(rtc::CopyOnWriteBuffer *packet, const rtc::PacketOptions& options, int flags) override {
         maybeUpdateRtpVoiceActivity(packet, _voiceActivity);
-        return webrtc::DtlsSrtpTransport::SendRtpPacket(packet, options, flags);
+        if (!_latencyTrace || !isAudioRtpPacket(packet)) {
+            return webrtc::DtlsSrtpTransport::SendRtpPacket(packet, options, flags);
+        }
+        const auto sendStartUs = rtc::TimeMicros();
+        const auto result = webrtc::DtlsSrtpTransport::SendRtpPacket(packet, options, flags);
+        _latencyTrace->onAudioPacketSent(sendStartUs, rtc::TimeMicros());
+        return result;
     }
 };
 
 webrtc::CryptoOptions GroupNetworkManager::getDefaulCryptoOptions() {
+    // AEAD only: with AES-CM enabled webrtc would offer it first, and GCM is
+    // both cheaper per packet on hardware AES and needs no separate HMAC.
     auto options = webrtc::CryptoOptions();
     options.srtp.enable_aes128_sha1_80_crypto_cipher = false;
     options.srtp.enable_gcm_crypto_suites = true;
@@ -304,34 +244,49 @@ webrtc::CryptoOptions GroupNetworkManager::getDefaulCryptoOptions() {
 
 GroupNetworkManager::GroupNetworkManager(
     std::function<void(const State &)> stateUpdated,
-    std::function<void(rtc::CopyOnWriteBuffer const &, bool)> transportMessageReceived,
+    std::function<void(rtc::CopyOnWriteBuffer const &, GroupRtpPacketHeader const &, bool)> transportMessageReceived,
     std::function<void(bool)> dataChannelStateUpdated,
     std::function<void(std::string const &)> dataChannelMessageReceived,
     std::function<void(uint32_t, uint8_t, bool)> audioActivityUpdated,
-    std::shared_ptr<Threads> threads) :
+    std::shared_ptr<Threads> threads,
+    std::shared_ptr<GroupCertificatePool> certificatePool,
+    bool useBatchedUdpSockets,
+    std::shared_ptr<GroupSharedUdpSockets> sharedUdpSockets,
+    std::shared_ptr<GroupReconnectCounters> reconnectCounters) :
 _threads(std::move(threads)),
 _stateUpdated(std::move(stateUpdated)),
 _transportMessageReceived(std::move(transportMessageReceived)),
 _dataChannelStateUpdated(dataChannelStateUpdated),
 _dataChannelMessageReceived(dataChannelMessageReceived),
-_audioActivityUpdated(audioActivityUpdated) {
+_audioActivityUpdated(audioActivityUpdated),
+_certificatePool(std::move(certificatePool)),
+_reconnectCounters(std::move(reconnectCounters)) {
     assert(_threads->getNetworkThread()->IsCurrent());
 
     _localIceParameters = PeerIceParameters(rtc::CreateRandomString(cricket::ICE_UFRAG_LENGTH), rtc::CreateRandomString(cricket::ICE_PWD_LENGTH));
 
-    _localCertificate = rtc::RTCCertificateGenerator::GenerateCertificate(rtc::KeyParams(rtc::KT_ECDSA), absl::nullopt);
-
-    _networkMonitorFactory = PlatformInterface::SharedInstance()->createNetworkMonitorFactory();
+    _localCertificate = _certificatePool ? _certificatePool->takeCertificate() : rtc::RTCCertificateGenerator::GenerateCertificate(rtc::KeyParams(rtc::KT_ECDSA), absl::nullopt);
 
-    _socketFactory.reset(new rtc::BasicPacketSocketFactory(_threads->getNetworkThread()));
-    _networkManager = std::make_unique<rtc::BasicNetworkManager>(_networkMonitorFactory.get());
-    _asyncResolverFactory = std::make_unique<webrtc::BasicAsyncResolverFactory>();
+    if (sharedUdpSockets) {
+        _socketFactory = sharedUdpSockets->createSocketFactory(_threads->getNetworkThread(), _localIceParameters.ufrag, useBatchedUdpSockets);
+    } else if (useBatchedUdpSockets && BatchedPacketSocketFactory::IsSupported()) {
+        _socketFactory.reset(new BatchedPacketSocketFactory(_threads->getNetworkThread()));
+    } else {
+        _socketFactory.reset(new rtc::BasicPacketSocketFactory(_threads->getNetworkThread()));
+    }
+    _networkManager = SharedNetworkEnvironment::networkManager(_threads->getNetworkThread());
+    _asyncResolverFactory = SharedNetworkEnvironment::createAsyncResolverFactory();
 
     _dtlsSrtpTransport = std::make_unique<WrappedDtlsSrtpTransport>(true);
     _dtlsSrtpTransport->SetDtlsTransports(nullptr, nullptr);
     _dtlsSrtpTransport->SetActiveResetSrtpParams(false);
     _dtlsSrtpTransport->SignalReadyToSend.connect(this, &GroupNetworkManager::DtlsReadyToSend);
     _dtlsSrtpTransport->SignalRtpPacketReceived.connect(this, &GroupNetworkManager::RtpPacketReceived_n);
+    // Decrypted in place, then shared with the media and worker threads
+    // rather than copied, so the pooled buffer is all a packet takes.
+    _dtlsSrtpTransport->SetPacketAllocator([](const char *data, size_t size) {
+        return GroupPacketBufferPool::current().makePacket(data, size);
+    });
 
     resetDtlsSrtpTransport();
 }
@@ -451,9 +406,20 @@ void GroupNetworkManager::stop() {
     _transportChannel.reset();
     _portAllocator.reset();
 
+    // The new transports start without remote parameters.
+    _remoteIceParameters = absl::nullopt;
+    _remoteCandidates.clear();
+    _remoteFingerprint.reset();
+
+    // A new join gets new credentials; nothing to reconnect to.
+    _lastWorkingLocalCandidate = absl::nullopt;
+    _lastWorkingRemoteCandidate = absl::nullopt;
+    _isReconnecting = false;
+    _isFastReconnecting = false;
+
     _localIceParameters = PeerIceParameters(rtc::CreateRandomString(cricket::ICE_UFRAG_LENGTH), rtc::CreateRandomString(cricket::ICE_PWD_LENGTH));
 
-    _localCertificate = rtc::RTCCertificateGenerator::GenerateCertificate(rtc::KeyParams(rtc::KT_ECDSA), absl::nullopt);
+    _localCertificate = _certificatePool ? _certificatePool->takeCertificate() : rtc::RTCCertificateGenerator::GenerateCertificate(rtc::KeyParams(rtc::KT_ECDSA), absl::nullopt);
 
     resetDtlsSrtpTransport();
 }
@@ -462,6 +428,10 @@ PeerIceParameters GroupNetworkManager::getLocalIceParameters() {
     return _localIceParameters;
 }
 
+rtc::scoped_refptr<rtc::RTCCertificate> GroupNetworkManager::getLocalCertificate() const {
+    return _localCertificate;
+}
+
 std::unique_ptr<rtc::SSLFingerprint> GroupNetworkManager::getLocalFingerprint() {
     auto certificate = _localCertificate;
     if (!certificate) {
@@ -471,28 +441,52 @@ std::unique_ptr<rtc::SSLFingerprint> GroupNetworkManager::getLocalFingerprint()
 }
 
 void GroupNetworkManager::setRemoteParams(PeerIceParameters const &remoteIceParameters, std::vector<cricket::Candidate> const &iceCandidates, rtc::SSLFingerprint *fingerprint) {
-    _remoteIceParameters = remoteIceParameters;
-
-    cricket::IceParameters parameters(
-        remoteIceParameters.ufrag,
-        remoteIceParameters.pwd,
-        false
-    );
-
-    _transportChannel->SetRemoteIceParameters(parameters);
+    // Reconnects hand in nearly the same parameters again; only what
+    // changed goes to the transports, so connections to candidates that
+    // stay keep running instead of being checked from scratch.
+    const auto sameIceParameters = _remoteIceParameters
+        && _remoteIceParameters->ufrag == remoteIceParameters.ufrag
+        && _remoteIceParameters->pwd == remoteIceParameters.pwd;
+    if (!sameIceParameters) {
+        _remoteIceParameters = remoteIceParameters;
+
+        cricket::IceParameters parameters(
+            remoteIceParameters.ufrag,
+            remoteIceParameters.pwd,
+            false
+        );
+
+        _transportChannel->SetRemoteIceParameters(parameters);
+        // Candidates of the previous credentials are left to ICE to prune.
+        _remoteCandidates.clear();
+    }
 
+    const auto containsEquivalent = [](std::vector<cricket::Candidate> const &list, cricket::Candidate const &candidate) {
+        return std::find_if(list.begin(), list.end(), [&](cricket::Candidate const &other) {
+            return other.IsEquivalent(candidate);
+        }) != list.end();
+    };
+    for (const auto &candidate : _remoteCandidates) {
+        if (!containsEquivalent(iceCandidates, candidate)) {
+            _transportChannel->RemoveRemoteCandidate(candidate);
+        }
+    }
     for (const auto &candidate : iceCandidates) {
-        _transportChannel->AddRemoteCandidate(candidate);
+        if (!containsEquivalent(_remoteCandidates, candidate)) {
+            _transportChannel->AddRemoteCandidate(candidate);
+        }
     }
+    _remoteCandidates = iceCandidates;
 
-    if (fingerprint) {
+    if (fingerprint && !(_remoteFingerprint && *_remoteFingerprint == *fingerprint)) {
         _dtlsTransport->SetRemoteFingerprint(fingerprint->algorithm, fingerprint->digest.data(), fingerprint->digest.size());
+        _remoteFingerprint = std::make_unique<rtc::SSLFingerprint>(*fingerprint);
     }
 }
 
-void GroupNetworkManager::sendDataChannelMessage(std::string const &message) {
+void GroupNetworkManager::sendDataChannelMessage(std::string const &message, std::string const &coalesceKey) {
     if (_dataChannelInterface) {
-        _dataChannelInterface->sendDataChannelMessage(message);
+        _dataChannelInterface->sendDataChannelMessage(message, coalesceKey);
     }
 }
 
@@ -502,6 +496,13 @@ void GroupNetworkManager::setOutgoingVoiceActivity(bool isSpeech) {
     }
 }
 
+void GroupNetworkManager::setLatencyTrace(std::shared_ptr<LatencyTrace> latencyTrace) {
+    _latencyTrace = std::move(latencyTrace);
+    if (_dtlsSrtpTransport) {
+        ((WrappedDtlsSrtpTransport *)_dtlsSrtpTransport.get())->_latencyTrace = _latencyTrace;
+    }
+}
+
 webrtc::RtpTransport *GroupNetworkManager::getRtpTransport() {
     return _dtlsSrtpTransport.get();
 }
@@ -528,6 +529,58 @@ void GroupNetworkManager::checkConnectionTimeout() {
     }, 1000);
 }
 
+void GroupNetworkManager::beginFastReconnect() {
+    _isReconnecting = true;
+    _disconnectedTimestamp = rtc::TimeMillis();
+    if (_reconnectCounters) {
+        _reconnectCounters->onDisconnected();
+    }
+
+    // ICE would only notice the pair is back on its next scheduled check;
+    // probe it right away, and bring it back if it was already pruned.
+    _isFastReconnecting = true;
+    if (_lastWorkingRemoteCandidate) {
+        _transportChannel->AddRemoteCandidate(*_lastWorkingRemoteCandidate);
+    }
+    if (const auto session = _transportChannel->allocator_session()) {
+        // Gathers again on the networks the failure was noticed on.
+        session->RegatherOnFailedNetworks();
+    }
+    continueFastReconnect();
+}
+
+void GroupNetworkManager::continueFastReconnect() {
+    static constexpr int64_t kFastReconnectPingIntervalMs = 100;
+    static constexpr int64_t kFastReconnectWindowMs = 2000;
+
+    if (!_isFastReconnecting || !_transportChannel) {
+        return;
+    }
+    int64_t timestamp = rtc::TimeMillis();
+    if (timestamp - _disconnectedTimestamp > kFastReconnectWindowMs) {
+        // Left to ICE's own checks and regathering from here on.
+        _isFastReconnecting = false;
+        if (_reconnectCounters) {
+            _reconnectCounters->onFastReconnectExpired();
+        }
+        return;
+    }
+
+    for (const auto connection : _transportChannel->connections()) {
+        if (_lastWorkingRemoteCandidate && connection->remote_candidate().address() == _lastWorkingRemoteCandidate->address() &&
+            _lastWorkingLocalCandidate && connection->local_candidate().address() == _lastWorkingLocalCandidate->address()) {
+            connection->Ping(timestamp);
+        }
+    }
+
+    const auto weak = std::weak_ptr<GroupNetworkManager>(shared_from_this());
+    _threads->getNetworkThread()->PostDelayedTask(RTC_FROM_HERE, [weak]() {
+        if (const auto strong = weak.lock()) {
+            strong->continueFastReconnect();
+        }
+    }, kFastReconnectPingIntervalMs);
+}
+
 void GroupNetworkManager::candidateGathered(cricket::IceTransportInternal *transport, const cricket::Candidate &candidate) {
     assert(_threads->getNetworkThread()->IsCurrent());
 }
@@ -574,22 +627,24 @@ void GroupNetworkManager::transportPacketReceived(rtc::PacketTransportInternal *
     assert(_threads->getNetworkThread()->IsCurrent());
 
     _lastNetworkActivityMs = rtc::TimeMillis();
+    HotPathCounters::onPacketsReceived(1);
 }
 
 void GroupNetworkManager::RtpPacketReceived_n(rtc::CopyOnWriteBuffer *packet, int64_t packet_time_us, bool isUnresolved) {
-    bool didRead = false;
-    uint32_t ssrc = 0;
-    uint8_t audioLevel = 0;
-    bool isSpeech = false;
-    maybeReadRtpVoiceActivity(packet, didRead, ssrc, audioLevel, isSpeech);
-    if (didRead && ssrc != 0) {
+    const auto header = parseRtpPacketHeader(*packet);
+
+    if (_latencyTrace && packet_time_us > 0 && header.isRtp() && header.payloadType == 111) {
+        _latencyTrace->record(LatencyTrace::Stage::Receive, rtc::TimeMicros() - packet_time_us);
+    }
+
+    if (header.hasAudioLevel && header.ssrc != 0) {
         if (_audioActivityUpdated) {
-            _audioActivityUpdated(ssrc, audioLevel, isSpeech);
+            _audioActivityUpdated(header.ssrc, header.audioLevel, header.isSpeech);
         }
     }
 
     if (_transportMessageReceived) {
-        _transportMessageReceived(*packet, isUnresolved);
+        _transportMessageReceived(*packet, header, isUnresolved);
     }
 }
 
@@ -611,9 +666,29 @@ void GroupNetworkManager::UpdateAggregateStates_n() {
         isConnected = false;
     }
 
+    const auto selectedPair = isConnected ? _transportChannel->GetSelectedCandidatePair() : absl::nullopt;
+    bool isCachedPair = false;
+    if (selectedPair) {
+        isCachedPair = _lastWorkingRemoteCandidate && _lastWorkingLocalCandidate &&
+            selectedPair->remote_candidate().address() == _lastWorkingRemoteCandidate->address() &&
+            selectedPair->local_candidate().address() == _lastWorkingLocalCandidate->address();
+        _lastWorkingLocalCandidate = selectedPair->local_candidate();
+        _lastWorkingRemoteCandidate = selectedPair->remote_candidate();
+    }
+
     if (_isConnected != isConnected) {
         _isConnected = isConnected;
 
+        if (isConnected && _isReconnecting) {
+            _isReconnecting = false;
+            _isFastReconnecting = false;
+            if (_reconnectCounters) {
+                _reconnectCounters->onReconnected(rtc::TimeMillis() - _disconnectedTimestamp, isCachedPair);
+            }
+        } else if (!isConnected && _lastWorkingRemoteCandidate) {
+            beginFastReconnect();
+        }
+
         GroupNetworkManager::State emitState;
         emitState.isReadyToSendData = isConnected;
         _stateUpdated(emitState);
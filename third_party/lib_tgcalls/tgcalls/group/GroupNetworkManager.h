@@ -13,6 +13,8 @@
 #include "media/sctp/sctp_transport.h"
 #include "pc/sctp_data_channel.h"
 
+#include <array>
+#include <atomic>
 #include <functional>
 #include <memory>
 
@@ -34,7 +36,7 @@ class DtlsTransport;
 } // namespace cricket
 
 namespace webrtc {
-class BasicAsyncResolverFactory;
+class AsyncResolverFactory;
 class TurnCustomizer;
 class DtlsSrtpTransport;
 class RtpTransport;
@@ -45,6 +47,95 @@ namespace tgcalls {
 struct Message;
 class SctpDataChannelProviderInterfaceImpl;
 class Threads;
+class GroupCertificatePool;
+class GroupSharedUdpSockets;
+class LatencyTrace;
+
+// Recoveries of lost connectivity, recorded by GroupNetworkManager on the
+// network thread and readable from any thread.
+class GroupReconnectCounters {
+public:
+    // Upper bounds of the reconnect time buckets; the last bucket takes
+    // everything slower.
+    static constexpr std::array<int64_t, 7> kBucketBoundsMs = {{100, 250, 500, 1000, 2000, 5000, 10000}};
+    static constexpr size_t kBucketCount = kBucketBoundsMs.size() + 1;
+
+    void onDisconnected() {
+        _disconnects.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // |isCachedPair| when the connection came back on the candidate pair
+    // that was working before it was lost.
+    void onReconnected(int64_t durationMs, bool isCachedPair) {
+        size_t bucket = 0;
+        while (bucket < kBucketBoundsMs.size() && durationMs > kBucketBoundsMs[bucket]) {
+            bucket++;
+        }
+        _reconnectTimeBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        (isCachedPair ? _cachedPairReconnects : _otherPairReconnects).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The cached pair didn't answer within the fast reconnect window.
+    void onFastReconnectExpired() {
+        _fastReconnectsExpired.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t disconnects() const {
+        return _disconnects.load(std::memory_order_relaxed);
+    }
+
+    uint64_t cachedPairReconnects() const {
+        return _cachedPairReconnects.load(std::memory_order_relaxed);
+    }
+
+    uint64_t otherPairReconnects() const {
+        return _otherPairReconnects.load(std::memory_order_relaxed);
+    }
+
+    uint64_t fastReconnectsExpired() const {
+        return _fastReconnectsExpired.load(std::memory_order_relaxed);
+    }
+
+    uint64_t reconnectTimeBucket(size_t index) const {
+        return _reconnectTimeBuckets[index].load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> _disconnects{0};
+    std::atomic<uint64_t> _cachedPairReconnects{0};
+    std::atomic<uint64_t> _otherPairReconnects{0};
+    std::atomic<uint64_t> _fastReconnectsExpired{0};
+    std::array<std::atomic<uint64_t>, kBucketCount> _reconnectTimeBuckets{};
+};
+
+// The header of a received packet as the network thread parsed it, passed
+// along with the packet so that nothing downstream parses it again.
+struct GroupRtpPacketHeader {
+    enum class Type : uint8_t {
+        Unknown,
+        Rtp,
+        Rtcp
+    };
+
+    Type type = Type::Unknown;
+    // The rest is of RTP only.
+    uint8_t payloadType = 0;
+    bool marker = false;
+    // From the audio level extension, of Opus packets.
+    bool hasAudioLevel = false;
+    uint8_t audioLevel = 0;
+    bool isSpeech = false;
+    uint16_t sequenceNumber = 0;
+    uint32_t timestamp = 0;
+    uint32_t ssrc = 0;
+    // The payload follows the header and is followed by the padding.
+    uint16_t headerLength = 0;
+    uint16_t paddingLength = 0;
+
+    bool isRtp() const {
+        return type == Type::Rtp;
+    }
+};
 
 class GroupNetworkManager : public sigslot::has_slots<>, public std::enable_shared_from_this<GroupNetworkManager> {
 public:
@@ -57,11 +148,15 @@ public:
 
     GroupNetworkManager(
         std::function<void(const State &)> stateUpdated,
-        std::function<void(rtc::CopyOnWriteBuffer const &, bool)> transportMessageReceived,
+        std::function<void(rtc::CopyOnWriteBuffer const &, GroupRtpPacketHeader const &, bool)> transportMessageReceived,
         std::function<void(bool)> dataChannelStateUpdated,
         std::function<void(std::string const &)> dataChannelMessageReceived,
         std::function<void(uint32_t, uint8_t, bool)> audioActivityUpdated,
-        std::shared_ptr<Threads> threads);
+        std::shared_ptr<Threads> threads,
+        std::shared_ptr<GroupCertificatePool> certificatePool = nullptr,
+        bool useBatchedUdpSockets = false,
+        std::shared_ptr<GroupSharedUdpSockets> sharedUdpSockets = nullptr,
+        std::shared_ptr<GroupReconnectCounters> reconnectCounters = nullptr);
     ~GroupNetworkManager();
 
     void start();
@@ -69,11 +164,14 @@ public:
 
     PeerIceParameters getLocalIceParameters();
     std::unique_ptr<rtc::SSLFingerprint> getLocalFingerprint();
+    rtc::scoped_refptr<rtc::RTCCertificate> getLocalCertificate() const;
     void setRemoteParams(PeerIceParameters const &remoteIceParameters, std::vector<cricket::Candidate> const &iceCandidates, rtc::SSLFingerprint *fingerprint);
 
-    void sendDataChannelMessage(std::string const &message);
+    void sendDataChannelMessage(std::string const &message, std::string const &coalesceKey = std::string());
 
     void setOutgoingVoiceActivity(bool isSpeech);
+    // Times the sending and receiving of audio RTP packets into |latencyTrace|.
+    void setLatencyTrace(std::shared_ptr<LatencyTrace> latencyTrace);
 
     webrtc::RtpTransport *getRtpTransport();
 
@@ -81,6 +179,8 @@ private:
     void resetDtlsSrtpTransport();
     void restartDataChannel();
     void checkConnectionTimeout();
+    void beginFastReconnect();
+    void continueFastReconnect();
     void candidateGathered(cricket::IceTransportInternal *transport, const cricket::Candidate &candidate);
     void candidateGatheringState(cricket::IceTransportInternal *transport);
     void OnTransportWritableState_n(rtc::PacketTransportInternal *transport);
@@ -98,17 +198,19 @@ private:
 
     std::shared_ptr<Threads> _threads;
     std::function<void(const GroupNetworkManager::State &)> _stateUpdated;
-    std::function<void(rtc::CopyOnWriteBuffer const &, bool)> _transportMessageReceived;
+    std::function<void(rtc::CopyOnWriteBuffer const &, GroupRtpPacketHeader const &, bool)> _transportMessageReceived;
     std::function<void(bool)> _dataChannelStateUpdated;
     std::function<void(std::string const &)> _dataChannelMessageReceived;
     std::function<void(uint32_t, uint8_t, bool)> _audioActivityUpdated;
+    // Source of |_localCertificate|; generated in place when null.
+    std::shared_ptr<GroupCertificatePool> _certificatePool;
 
-    std::unique_ptr<rtc::NetworkMonitorFactory> _networkMonitorFactory;
     std::unique_ptr<rtc::BasicPacketSocketFactory> _socketFactory;
-    std::unique_ptr<rtc::BasicNetworkManager> _networkManager;
+    // Shared with the other transports on the network thread.
+    std::shared_ptr<rtc::BasicNetworkManager> _networkManager;
     std::unique_ptr<webrtc::TurnCustomizer> _turnCustomizer;
     std::unique_ptr<cricket::BasicPortAllocator> _portAllocator;
-    std::unique_ptr<webrtc::BasicAsyncResolverFactory> _asyncResolverFactory;
+    std::unique_ptr<webrtc::AsyncResolverFactory> _asyncResolverFactory;
     std::unique_ptr<cricket::P2PTransportChannel> _transportChannel;
     std::unique_ptr<cricket::DtlsTransport> _dtlsTransport;
     std::unique_ptr<webrtc::DtlsSrtpTransport> _dtlsSrtpTransport;
@@ -118,9 +220,24 @@ private:
     rtc::scoped_refptr<rtc::RTCCertificate> _localCertificate;
     PeerIceParameters _localIceParameters;
     absl::optional<PeerIceParameters> _remoteIceParameters;
+    // What setRemoteParams() last gave the current transports.
+    std::vector<cricket::Candidate> _remoteCandidates;
+    std::unique_ptr<rtc::SSLFingerprint> _remoteFingerprint;
 
     bool _isConnected = false;
     int64_t _lastNetworkActivityMs = 0;
+
+    // The candidate pair last seen carrying traffic. When connectivity is
+    // lost it is pinged right away and every kFastReconnectPingIntervalMs
+    // for a while, instead of waiting for ICE's own schedule; the ICE
+    // credentials and the DTLS session are kept throughout.
+    absl::optional<cricket::Candidate> _lastWorkingLocalCandidate;
+    absl::optional<cricket::Candidate> _lastWorkingRemoteCandidate;
+    int64_t _disconnectedTimestamp = 0;
+    bool _isReconnecting = false;
+    bool _isFastReconnecting = false;
+    std::shared_ptr<GroupReconnectCounters> _reconnectCounters;
+    std::shared_ptr<LatencyTrace> _latencyTrace;
 };
 
 } // namespace tgcalls
@@ -0,0 +1,165 @@
+#include "group/GroupOpusPacketSource.h"
+
+#include "absl/strings/match.h"
+#include "api/audio_codecs/audio_encoder.h"
+#include "rtc_base/ref_counted_object.h"
+
+namespace tgcalls {
+
+namespace {
+
+// Opus RTP timestamps are always at 48 kHz (RFC 7587).
+constexpr int kSampleRateHz = 48000;
+constexpr uint32_t kFrameTicks = kSampleRateHz / 100;
+
+class OpusPacketSourceEncoder : public webrtc::AudioEncoder {
+public:
+    OpusPacketSourceEncoder(std::shared_ptr<GroupOpusPacketSource> source, int payloadType) :
+    _source(std::move(source)),
+    _payloadType(payloadType) {
+    }
+
+    int SampleRateHz() const override {
+        return kSampleRateHz;
+    }
+
+    size_t NumChannels() const override {
+        // The capture only clocks the packets out.
+        return 1;
+    }
+
+    int RtpTimestampRateHz() const override {
+        return kSampleRateHz;
+    }
+
+    size_t Num10MsFramesInNextPacket() const override {
+        return _nextSamples != 0 ? (_nextSamples + kFrameTicks - 1) / kFrameTicks : 2;
+    }
+
+    size_t Max10MsFramesInAPacket() const override {
+        return 12;
+    }
+
+    int GetTargetBitrate() const override {
+        // Whatever the source was encoded at; this is a typical one.
+        return 32000;
+    }
+
+    void Reset() override {
+        _pendingTicks = 0;
+    }
+
+    absl::optional<std::pair<webrtc::TimeDelta, webrtc::TimeDelta>> GetFrameLengthRange() const override {
+        return std::make_pair(webrtc::TimeDelta::Millis(10), webrtc::TimeDelta::Millis(120));
+    }
+
+protected:
+    EncodedInfo EncodeImpl(uint32_t rtp_timestamp, rtc::ArrayView<const int16_t> audio, rtc::Buffer *encoded) override {
+        if (_nextSamples == 0) {
+            if (!_source->nextPacket(_next, _nextSamples) || _nextSamples == 0 || _next.empty()) {
+                _nextSamples = 0;
+                _pendingTicks = 0;
+                return EncodedInfo();
+            }
+        }
+        _pendingTicks += kFrameTicks;
+        if (_nextSamples > _pendingTicks) {
+            return EncodedInfo();
+        }
+
+        encoded->AppendData(_next.data(), _next.size());
+        EncodedInfo info;
+        info.encoded_bytes = _next.size();
+        // |_pendingTicks| ago was the end of the previous packet; the end of
+        // this frame is one frame after |rtp_timestamp|.
+        info.encoded_timestamp = rtp_timestamp + kFrameTicks - _pendingTicks;
+        info.payload_type = _payloadType;
+        info.encoder_type = CodecType::kOpus;
+        info.speech = true;
+        _pendingTicks -= _nextSamples;
+        _nextSamples = 0;
+        return info;
+    }
+
+private:
+    std::shared_ptr<GroupOpusPacketSource> _source;
+    const int _payloadType = 0;
+    // Taken from the source, sent once its duration has been captured.
+    rtc::Buffer _next;
+    uint32_t _nextSamples = 0;
+    // Capture ticks since the end of the last packet sent.
+    uint32_t _pendingTicks = 0;
+};
+
+class OpusPacketSourceEncoderFactory : public webrtc::AudioEncoderFactory {
+public:
+    OpusPacketSourceEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory, std::shared_ptr<GroupOpusPacketSource> source) :
+    _factory(std::move(factory)),
+    _source(std::move(source)) {
+    }
+
+    std::vector<webrtc::AudioCodecSpec> GetSupportedEncoders() override {
+        return _factory->GetSupportedEncoders();
+    }
+
+    absl::optional<webrtc::AudioCodecInfo> QueryAudioEncoder(const webrtc::SdpAudioFormat &format) override {
+        return _factory->QueryAudioEncoder(format);
+    }
+
+    std::unique_ptr<webrtc::AudioEncoder> MakeAudioEncoder(int payloadType, const webrtc::SdpAudioFormat &format, absl::optional<webrtc::AudioCodecPairId> codecPairId) override {
+        if (!absl::EqualsIgnoreCase(format.name, "opus")) {
+            return _factory->MakeAudioEncoder(payloadType, format, codecPairId);
+        }
+        return std::make_unique<OpusPacketSourceEncoder>(_source, payloadType);
+    }
+
+private:
+    rtc::scoped_refptr<webrtc::AudioEncoderFactory> _factory;
+    std::shared_ptr<GroupOpusPacketSource> _source;
+};
+
+} // namespace
+
+rtc::scoped_refptr<webrtc::AudioEncoderFactory> makeOpusPacketSourceEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory, std::shared_ptr<GroupOpusPacketSource> source) {
+    if (!factory || !source) {
+        return factory;
+    }
+    return new rtc::RefCountedObject<OpusPacketSourceEncoderFactory>(std::move(factory), std::move(source));
+}
+
+uint32_t opusPacketSamples(const uint8_t *data, size_t size) {
+    if (size < 1) {
+        return 0;
+    }
+    const int config = data[0] >> 3;
+    uint32_t frameSamples = 0;
+    if (config < 12) {
+        static const uint32_t kSilk[] = { 480, 960, 1920, 2880 };
+        frameSamples = kSilk[config & 3];
+    } else if (config < 16) {
+        frameSamples = (config & 1) ? 960 : 480;
+    } else {
+        static const uint32_t kCelt[] = { 120, 240, 480, 960 };
+        frameSamples = kCelt[config & 3];
+    }
+    uint32_t frames = 1;
+    switch (data[0] & 3) {
+        case 0:
+            break;
+        case 1:
+        case 2:
+            frames = 2;
+            break;
+        default:
+            if (size < 2) {
+                return 0;
+            }
+            frames = data[1] & 0x3f;
+            break;
+    }
+    const uint32_t samples = frameSamples * frames;
+    // At most 120 ms per packet.
+    return samples <= 5760 ? samples : 0;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,47 @@
+#ifndef TGCALLS_GROUP_OPUS_PACKET_SOURCE_H
+#define TGCALLS_GROUP_OPUS_PACKET_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "api/audio_codecs/audio_encoder_factory.h"
+#include "api/scoped_refptr.h"
+#include "rtc_base/buffer.h"
+
+namespace tgcalls {
+
+// Opus packets a group call sends as its own outgoing audio instead of
+// encoding what it captures, e.g. those of a file that is Opus already:
+// no decoding, processing or encoding is involved.
+//
+// The call takes the source in GroupInstanceDescriptor::outgoingOpusSource,
+// which swaps its Opus encoder for one asking the source for the next packet
+// once the previous one's duration has been captured. As with
+// GroupAudioBridge, the call still packetizes, encrypts and paces on its own
+// SSRC, and its capture only clocks the packets out: it has to run and be
+// unmuted, but what it captures is never sent. While the source has no
+// packet nothing is sent, as with DTX.
+//
+// A source feeds a single call at a time.
+class GroupOpusPacketSource {
+public:
+    virtual ~GroupOpusPacketSource() = default;
+
+    // Called on the call's encoder thread: sets |payload| to the next packet
+    // and |samples| to its duration at 48 kHz, or returns false if there is
+    // none yet. Must not block.
+    virtual bool nextPacket(rtc::Buffer &payload, uint32_t &samples) = 0;
+};
+
+// Opus encoders made by the returned factory send the packets of |source|;
+// other codecs come from |factory| as they are.
+rtc::scoped_refptr<webrtc::AudioEncoderFactory> makeOpusPacketSourceEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory, std::shared_ptr<GroupOpusPacketSource> source);
+
+// Duration of an Opus packet at 48 kHz from its TOC byte and frame count
+// (RFC 6716, section 3.1); 0 if it is malformed.
+uint32_t opusPacketSamples(const uint8_t *data, size_t size);
+
+} // namespace tgcalls
+
+#endif
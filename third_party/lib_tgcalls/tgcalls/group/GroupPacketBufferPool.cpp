@@ -0,0 +1,136 @@
+#include "group/GroupPacketBufferPool.h"
+
+#include <array>
+
+namespace tgcalls {
+
+namespace {
+
+// Audio, then video packets up to the usual MTU, then the odd larger one.
+constexpr std::array<size_t, 4> kSizeClassCapacities = { 256, 512, 1280, 2048 };
+constexpr int kMaxStoragePerSizeClass = 512;
+
+} // namespace
+
+struct GroupPacketBufferPool::SizeClass {
+    Shared *shared = nullptr;
+    size_t capacity = 0;
+    // Pushed by any thread, taken whole by the thread of the pool.
+    std::atomic<rtc::CopyOnWriteBuffer::Storage *> returned{ nullptr };
+    // Thread of the pool.
+    rtc::CopyOnWriteBuffer::Storage *available = nullptr;
+    int storageCount = 0;
+};
+
+struct GroupPacketBufferPool::Shared {
+    std::array<SizeClass, kSizeClassCapacities.size()> sizeClasses;
+    std::atomic<bool> isClosed{ false };
+    // One for the pool, one for every storage and one for every recycle()
+    // in progress.
+    std::atomic<int> references{ 1 };
+};
+
+GroupPacketBufferPool::GroupPacketBufferPool() :
+_shared(new Shared()) {
+    for (size_t i = 0; i < kSizeClassCapacities.size(); i++) {
+        _shared->sizeClasses[i].shared = _shared;
+        _shared->sizeClasses[i].capacity = kSizeClassCapacities[i];
+    }
+}
+
+GroupPacketBufferPool::~GroupPacketBufferPool() {
+    // Storage still in use is deleted when it comes back.
+    _shared->isClosed = true;
+    for (auto &sizeClass : _shared->sizeClasses) {
+        while (const auto storage = sizeClass.available) {
+            sizeClass.available = storage->next_free();
+            deleteStorage(_shared, storage);
+        }
+    }
+    drainReturned(_shared);
+    release(_shared);
+}
+
+GroupPacketBufferPool &GroupPacketBufferPool::current() {
+    static thread_local GroupPacketBufferPool pool;
+    return pool;
+}
+
+rtc::CopyOnWriteBuffer GroupPacketBufferPool::makePacket(const char *data, size_t size) {
+    SizeClass *sizeClass = nullptr;
+    for (auto &candidate : _shared->sizeClasses) {
+        if (size <= candidate.capacity) {
+            sizeClass = &candidate;
+            break;
+        }
+    }
+    if (!sizeClass) {
+        return rtc::CopyOnWriteBuffer(data, size);
+    }
+
+    if (!sizeClass->available) {
+        sizeClass->available = sizeClass->returned.exchange(nullptr, std::memory_order_acquire);
+    }
+    rtc::CopyOnWriteBuffer::Storage *storage = sizeClass->available;
+    if (storage) {
+        sizeClass->available = storage->next_free();
+        storage->set_next_free(nullptr);
+    } else if (sizeClass->storageCount < kMaxStoragePerSizeClass) {
+        storage = new rtc::CopyOnWriteBuffer::Storage(0, sizeClass->capacity);
+        storage->SetRecycler(&GroupPacketBufferPool::recycle, sizeClass);
+        sizeClass->storageCount++;
+        _shared->references++;
+    } else {
+        return rtc::CopyOnWriteBuffer(data, size);
+    }
+
+    storage->SetData(data, size);
+    return rtc::CopyOnWriteBuffer(rtc::scoped_refptr<rtc::CopyOnWriteBuffer::Storage>(storage));
+}
+
+void GroupPacketBufferPool::recycle(rtc::CopyOnWriteBuffer::Storage *storage, void *context) {
+    const auto sizeClass = static_cast<SizeClass *>(context);
+    const auto shared = sizeClass->shared;
+
+    // Keeps |shared| alive should the pool drain this storage right away.
+    shared->references++;
+    if (shared->isClosed) {
+        deleteStorage(shared, storage);
+    } else {
+        auto head = sizeClass->returned.load(std::memory_order_relaxed);
+        do {
+            storage->set_next_free(head);
+        } while (!sizeClass->returned.compare_exchange_weak(head, storage));
+
+        // The pool may have closed and drained before the push.
+        if (shared->isClosed) {
+            drainReturned(shared);
+        }
+    }
+    release(shared);
+}
+
+void GroupPacketBufferPool::drainReturned(Shared *shared) {
+    for (auto &sizeClass : shared->sizeClasses) {
+        // Sequentially consistent with the push and isClosed in recycle().
+        auto storage = sizeClass.returned.exchange(nullptr);
+        while (storage) {
+            const auto next = storage->next_free();
+            deleteStorage(shared, storage);
+            storage = next;
+        }
+    }
+}
+
+void GroupPacketBufferPool::deleteStorage(Shared *shared, rtc::CopyOnWriteBuffer::Storage *storage) {
+    delete storage;
+    release(shared);
+}
+
+void GroupPacketBufferPool::release(Shared *shared) {
+    if (shared->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete shared;
+    }
+}
+
+} // namespace tgcalls
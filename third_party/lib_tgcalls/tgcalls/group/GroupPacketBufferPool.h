@@ -0,0 +1,51 @@
+#ifndef TGCALLS_GROUP_PACKET_BUFFER_POOL_H
+#define TGCALLS_GROUP_PACKET_BUFFER_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "rtc_base/copy_on_write_buffer.h"
+
+namespace tgcalls {
+
+// Buffers for the packets GroupNetworkManager receives, so that a call in
+// steady state doesn't allocate and free one per packet.
+//
+// Storage comes in a few size classes. When the last copy of a packet is
+// dropped, on whichever thread that is, its storage is pushed back onto a
+// lock-free list of its class, and the network thread takes it from there
+// for a later packet. Each class keeps a bounded amount of storage; beyond
+// that, and for packets larger than the largest class, buffers are plain
+// allocations again.
+class GroupPacketBufferPool {
+public:
+    GroupPacketBufferPool();
+    ~GroupPacketBufferPool();
+
+    GroupPacketBufferPool(GroupPacketBufferPool const &) = delete;
+    GroupPacketBufferPool &operator=(GroupPacketBufferPool const &) = delete;
+
+    // The pool of the calling thread, shared by the calls on it. Only used
+    // on network threads.
+    static GroupPacketBufferPool &current();
+
+    // Thread of the pool.
+    rtc::CopyOnWriteBuffer makePacket(const char *data, size_t size);
+
+private:
+    struct Shared;
+    struct SizeClass;
+
+    static void recycle(rtc::CopyOnWriteBuffer::Storage *storage, void *context);
+    static void drainReturned(Shared *shared);
+    static void deleteStorage(Shared *shared, rtc::CopyOnWriteBuffer::Storage *storage);
+    static void release(Shared *shared);
+
+    // Outlives the pool while storage of it is in use elsewhere.
+    Shared *_shared = nullptr;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,411 @@
+#include "group/GroupSharedAudioDecoder.h"
+
+#include "absl/strings/match.h"
+#include "absl/types/optional.h"
+#include "api/audio_codecs/audio_decoder.h"
+#include "modules/include/module_common_types_public.h"
+#include "rtc_base/buffer.h"
+#include "rtc_base/ref_counted_object.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace tgcalls {
+
+namespace {
+
+// Packets of a stream other calls can still find it by; a jitter buffer
+// never holds more.
+constexpr size_t kIndexedPackets = 200;
+// Decoded frames kept for calls behind the one decoding; one second of
+// 20 ms frames.
+constexpr size_t kCachedFrames = 50;
+
+// Identifies a packet of a participant across calls: the payload, its RTP
+// timestamp and the format it is decoded to.
+uint64_t packetKey(const uint8_t *data, size_t size, uint32_t timestamp, int sampleRateHz, size_t channels) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    for (uint64_t value : { uint64_t(timestamp), uint64_t(size), uint64_t(sampleRateHz), uint64_t(channels) }) {
+        hash = (hash ^ value) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+class GroupSharedAudioDecoder::Shared {
+public:
+    struct Frame {
+        uint64_t packet = 0;
+        int priority = 0;
+        std::vector<int16_t> samples;
+        webrtc::AudioDecoder::SpeechType speechType = webrtc::AudioDecoder::kSpeech;
+    };
+
+    struct Stream {
+        // With |mutex| held.
+        std::mutex mutex;
+        std::unique_ptr<webrtc::AudioDecoder> decoder;
+        bool hasDecoded = false;
+        uint32_t lastTimestamp = 0;
+        std::deque<Frame> frames;
+
+        // With Shared::mutex held.
+        int views = 0;
+        std::deque<uint64_t> packets;
+    };
+
+    // The stream a view holding |current| decodes |packet| with: the one
+    // another call parsed it on first, unless other calls share |current|
+    // already. Null if no decoder could be made.
+    std::shared_ptr<Stream> bind(std::shared_ptr<Stream> current, uint64_t packet, std::function<std::unique_ptr<webrtc::AudioDecoder>()> const &makeDecoder) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = packets.find(packet);
+        auto found = it != packets.end() ? it->second.lock() : nullptr;
+        if (found && found != current && (!current || current->views == 1)) {
+            if (current) {
+                releaseLocked(*current);
+            }
+            found->views++;
+            return found;
+        }
+        if (!current) {
+            auto decoder = makeDecoder();
+            if (!decoder) {
+                return nullptr;
+            }
+            current = std::make_shared<Stream>();
+            current->decoder = std::move(decoder);
+            current->views = 1;
+            streams++;
+        }
+        if (!found) {
+            packets[packet] = current;
+            current->packets.push_back(packet);
+            while (current->packets.size() > kIndexedPackets) {
+                eraseIndexLocked(*current, current->packets.front());
+                current->packets.pop_front();
+            }
+        }
+        return current;
+    }
+
+    void release(std::shared_ptr<Stream> const &stream) {
+        if (!stream) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        releaseLocked(*stream);
+    }
+
+    std::mutex mutex;
+    std::unordered_map<uint64_t, std::weak_ptr<Stream>> packets;
+    int views = 0;
+    int streams = 0;
+
+    std::atomic<uint64_t> decodedFrames{0};
+    std::atomic<uint64_t> sharedFrames{0};
+    std::atomic<uint64_t> privateFrames{0};
+
+private:
+    void releaseLocked(Stream &stream) {
+        if (--stream.views > 0) {
+            return;
+        }
+        // Frames still queued keep the stream, but no call joins it again.
+        streams--;
+        for (const auto packet : stream.packets) {
+            eraseIndexLocked(stream, packet);
+        }
+        stream.packets.clear();
+    }
+
+    void eraseIndexLocked(Stream &stream, uint64_t packet) {
+        const auto it = packets.find(packet);
+        if (it == packets.end()) {
+            return;
+        }
+        const auto indexed = it->second.lock();
+        if (!indexed || indexed.get() == &stream) {
+            packets.erase(it);
+        }
+    }
+};
+
+namespace {
+
+using Shared = GroupSharedAudioDecoder::Shared;
+
+class SharedAudioFrame : public webrtc::AudioDecoder::EncodedAudioFrame {
+public:
+    SharedAudioFrame(
+        std::shared_ptr<Shared> shared,
+        std::shared_ptr<Shared::Stream> stream,
+        webrtc::AudioDecoder *privateDecoder,
+        std::shared_ptr<const rtc::Buffer> payload,
+        uint64_t packet,
+        uint32_t packetTimestamp,
+        uint32_t timestamp,
+        int priority,
+        size_t duration,
+        bool isDtx) :
+    _shared(std::move(shared)),
+    _stream(std::move(stream)),
+    _privateDecoder(privateDecoder),
+    _payload(std::move(payload)),
+    _packet(packet),
+    _packetTimestamp(packetTimestamp),
+    _timestamp(timestamp),
+    _priority(priority),
+    _duration(duration),
+    _isDtx(isDtx) {
+    }
+
+    size_t Duration() const override {
+        return _duration;
+    }
+
+    bool IsDtxPacket() const override {
+        return _isDtx;
+    }
+
+    absl::optional<DecodeResult> Decode(rtc::ArrayView<int16_t> decoded) const override {
+        {
+            std::lock_guard<std::mutex> lock(_stream->mutex);
+            auto &stream = *_stream;
+            for (auto it = stream.frames.rbegin(); it != stream.frames.rend(); ++it) {
+                if (it->packet != _packet || it->priority != _priority) {
+                    continue;
+                }
+                const auto count = std::min(it->samples.size(), decoded.size());
+                std::copy(it->samples.begin(), it->samples.begin() + count, decoded.begin());
+                _shared->sharedFrames++;
+                return DecodeResult{ count, it->speechType };
+            }
+            // In order only: decoding a frame the stream went past would
+            // leave the decoder out of step for every call.
+            if (!stream.hasDecoded || webrtc::IsNewerTimestamp(_timestamp, stream.lastTimestamp)) {
+                const auto result = decodeWith(stream.decoder.get(), decoded);
+                if (result) {
+                    Shared::Frame frame;
+                    frame.packet = _packet;
+                    frame.priority = _priority;
+                    frame.samples.assign(decoded.begin(), decoded.begin() + result->num_decoded_samples);
+                    frame.speechType = result->speech_type;
+                    stream.frames.push_back(std::move(frame));
+                    while (stream.frames.size() > kCachedFrames) {
+                        stream.frames.pop_front();
+                    }
+                    stream.hasDecoded = true;
+                    stream.lastTimestamp = _timestamp;
+                    _shared->decodedFrames++;
+                }
+                return result;
+            }
+        }
+        _shared->privateFrames++;
+        return decodeWith(_privateDecoder, decoded);
+    }
+
+private:
+    absl::optional<DecodeResult> decodeWith(webrtc::AudioDecoder *decoder, rtc::ArrayView<int16_t> decoded) const {
+        auto results = decoder->ParsePayload(rtc::Buffer(_payload->data(), _payload->size()), _packetTimestamp);
+        for (const auto &result : results) {
+            if (result.priority == _priority) {
+                return result.frame->Decode(decoded);
+            }
+        }
+        return absl::nullopt;
+    }
+
+    std::shared_ptr<Shared> _shared;
+    std::shared_ptr<Shared::Stream> _stream;
+    webrtc::AudioDecoder *_privateDecoder = nullptr;
+    std::shared_ptr<const rtc::Buffer> _payload;
+    const uint64_t _packet = 0;
+    const uint32_t _packetTimestamp = 0;
+    const uint32_t _timestamp = 0;
+    const int _priority = 0;
+    const size_t _duration = 0;
+    const bool _isDtx = false;
+};
+
+class SharedAudioDecoderView : public webrtc::AudioDecoder {
+public:
+    SharedAudioDecoderView(
+        std::shared_ptr<Shared> shared,
+        rtc::scoped_refptr<webrtc::AudioDecoderFactory> factory,
+        webrtc::SdpAudioFormat format,
+        std::unique_ptr<webrtc::AudioDecoder> privateDecoder) :
+    _shared(std::move(shared)),
+    _factory(std::move(factory)),
+    _format(std::move(format)),
+    _privateDecoder(std::move(privateDecoder)) {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        _shared->views++;
+    }
+
+    ~SharedAudioDecoderView() override {
+        _shared->release(_stream);
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        _shared->views--;
+    }
+
+    std::vector<ParseResult> ParsePayload(rtc::Buffer &&payload, uint32_t timestamp) override {
+        const auto packet = packetKey(payload.data(), payload.size(), timestamp, _privateDecoder->SampleRateHz(), _privateDecoder->Channels());
+        _stream = _shared->bind(std::move(_stream), packet, [this] {
+            return _factory->MakeAudioDecoder(_format, absl::nullopt);
+        });
+        if (!_stream) {
+            return _privateDecoder->ParsePayload(std::move(payload), timestamp);
+        }
+
+        // Parsed on the private decoder for the durations only; the frames
+        // decode from the shared payload.
+        auto parsed = _privateDecoder->ParsePayload(rtc::Buffer(payload.data(), payload.size()), timestamp);
+        const auto sharedPayload = std::make_shared<const rtc::Buffer>(std::move(payload));
+        std::vector<ParseResult> results;
+        results.reserve(parsed.size());
+        for (const auto &it : parsed) {
+            results.emplace_back(it.timestamp, it.priority, std::make_unique<SharedAudioFrame>(
+                _shared,
+                _stream,
+                _privateDecoder.get(),
+                sharedPayload,
+                packet,
+                timestamp,
+                it.timestamp,
+                it.priority,
+                it.frame->Duration(),
+                it.frame->IsDtxPacket()
+            ));
+        }
+        return results;
+    }
+
+    bool HasDecodePlc() const override {
+        return _privateDecoder->HasDecodePlc();
+    }
+
+    size_t DecodePlc(size_t num_frames, int16_t *decoded) override {
+        return _privateDecoder->DecodePlc(num_frames, decoded);
+    }
+
+    void GeneratePlc(size_t requested_samples_per_channel, rtc::BufferT<int16_t> *concealment_audio) override {
+        _privateDecoder->GeneratePlc(requested_samples_per_channel, concealment_audio);
+    }
+
+    void Reset() override {
+        // Resetting the shared decoder would cut into every other call.
+        _privateDecoder->Reset();
+    }
+
+    int ErrorCode() override {
+        return _privateDecoder->ErrorCode();
+    }
+
+    int PacketDuration(const uint8_t *encoded, size_t encoded_len) const override {
+        return _privateDecoder->PacketDuration(encoded, encoded_len);
+    }
+
+    int PacketDurationRedundant(const uint8_t *encoded, size_t encoded_len) const override {
+        return _privateDecoder->PacketDurationRedundant(encoded, encoded_len);
+    }
+
+    bool PacketHasFec(const uint8_t *encoded, size_t encoded_len) const override {
+        return _privateDecoder->PacketHasFec(encoded, encoded_len);
+    }
+
+    int SampleRateHz() const override {
+        return _privateDecoder->SampleRateHz();
+    }
+
+    size_t Channels() const override {
+        return _privateDecoder->Channels();
+    }
+
+protected:
+    // Only comfort noise of this call's own silence comes here; Decode()
+    // checked the output size against PacketDuration() already.
+    int DecodeInternal(const uint8_t *encoded, size_t encoded_len, int sample_rate_hz, int16_t *decoded, SpeechType *speech_type) override {
+        return _privateDecoder->Decode(encoded, encoded_len, sample_rate_hz, std::numeric_limits<size_t>::max(), decoded, speech_type);
+    }
+
+    int DecodeRedundantInternal(const uint8_t *encoded, size_t encoded_len, int sample_rate_hz, int16_t *decoded, SpeechType *speech_type) override {
+        return _privateDecoder->DecodeRedundant(encoded, encoded_len, sample_rate_hz, std::numeric_limits<size_t>::max(), decoded, speech_type);
+    }
+
+private:
+    std::shared_ptr<Shared> _shared;
+    rtc::scoped_refptr<webrtc::AudioDecoderFactory> _factory;
+    const webrtc::SdpAudioFormat _format;
+    std::unique_ptr<webrtc::AudioDecoder> _privateDecoder;
+    std::shared_ptr<Shared::Stream> _stream;
+};
+
+class SharedAudioDecoderFactory : public webrtc::AudioDecoderFactory {
+public:
+    SharedAudioDecoderFactory(rtc::scoped_refptr<webrtc::AudioDecoderFactory> factory, std::shared_ptr<Shared> shared) :
+    _factory(std::move(factory)),
+    _shared(std::move(shared)) {
+    }
+
+    std::vector<webrtc::AudioCodecSpec> GetSupportedDecoders() override {
+        return _factory->GetSupportedDecoders();
+    }
+
+    bool IsSupportedDecoder(const webrtc::SdpAudioFormat &format) override {
+        return _factory->IsSupportedDecoder(format);
+    }
+
+    std::unique_ptr<webrtc::AudioDecoder> MakeAudioDecoder(const webrtc::SdpAudioFormat &format, absl::optional<webrtc::AudioCodecPairId> codecPairId) override {
+        auto decoder = _factory->MakeAudioDecoder(format, codecPairId);
+        if (!decoder || !absl::EqualsIgnoreCase(format.name, "opus")) {
+            return decoder;
+        }
+        return std::make_unique<SharedAudioDecoderView>(_shared, _factory, format, std::move(decoder));
+    }
+
+private:
+    rtc::scoped_refptr<webrtc::AudioDecoderFactory> _factory;
+    std::shared_ptr<Shared> _shared;
+};
+
+} // namespace
+
+GroupSharedAudioDecoder::GroupSharedAudioDecoder() :
+_shared(std::make_shared<Shared>()) {
+}
+
+GroupSharedAudioDecoder::~GroupSharedAudioDecoder() = default;
+
+rtc::scoped_refptr<webrtc::AudioDecoderFactory> GroupSharedAudioDecoder::wrapDecoderFactory(rtc::scoped_refptr<webrtc::AudioDecoderFactory> factory) {
+    if (!factory) {
+        return factory;
+    }
+    return new rtc::RefCountedObject<SharedAudioDecoderFactory>(std::move(factory), _shared);
+}
+
+GroupSharedAudioDecoder::Stats GroupSharedAudioDecoder::getStats() const {
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        stats.views = _shared->views;
+        stats.streams = _shared->streams;
+    }
+    stats.decodedFrames = _shared->decodedFrames.load();
+    stats.sharedFrames = _shared->sharedFrames.load();
+    stats.privateFrames = _shared->privateFrames.load();
+    return stats;
+}
+
+} // namespace tgcalls
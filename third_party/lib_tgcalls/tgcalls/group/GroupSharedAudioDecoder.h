@@ -0,0 +1,60 @@
+#ifndef TGCALLS_GROUP_SHARED_AUDIO_DECODER_H
+#define TGCALLS_GROUP_SHARED_AUDIO_DECODER_H
+
+#include <cstdint>
+#include <memory>
+
+#include "api/audio_codecs/audio_decoder_factory.h"
+#include "api/scoped_refptr.h"
+
+namespace tgcalls {
+
+// Opus decoding shared by group calls that receive the same participants,
+// e.g. several accounts of one host in the same voice chat: each packet is
+// decoded once, however many of the calls receive it.
+//
+// Every incoming audio stream of every call gets a view instead of a decoder
+// of its own. Views are matched by the packets they are handed: a view whose
+// packet another call already parsed joins that call's stream, so the same
+// participant in two calls ends up on one shared decoder whatever its SSRC.
+// Each frame is decoded by whichever call's jitter buffer asks for it first,
+// in order; the other calls copy the samples it produced. A call asking for
+// a frame the shared decoder went past without, because the first call lost
+// it, and the comfort noise of a call's own silence, decode on a private
+// decoder of the view instead.
+//
+// Pass the same instance in GroupInstanceDescriptor::sharedAudioDecoder to
+// every call that should share.
+class GroupSharedAudioDecoder {
+public:
+    struct Stats {
+        // Incoming streams of all calls, and the shared decoders behind them.
+        int views = 0;
+        int streams = 0;
+        // Frames decoded by a shared decoder, those a call copied from
+        // another call's decoding instead of decoding them again, and those
+        // decoded on a view's own decoder.
+        uint64_t decodedFrames = 0;
+        uint64_t sharedFrames = 0;
+        uint64_t privateFrames = 0;
+    };
+
+    GroupSharedAudioDecoder();
+    ~GroupSharedAudioDecoder();
+
+    // Opus decoders made by the returned factory are views onto shared
+    // decoders, which |factory| creates; other codecs come from |factory| as
+    // they are.
+    rtc::scoped_refptr<webrtc::AudioDecoderFactory> wrapDecoderFactory(rtc::scoped_refptr<webrtc::AudioDecoderFactory> factory);
+
+    Stats getStats() const;
+
+    class Shared;
+
+private:
+    std::shared_ptr<Shared> _shared;
+};
+
+} // namespace tgcalls
+
+#endif
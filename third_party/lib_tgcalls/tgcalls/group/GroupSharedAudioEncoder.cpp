@@ -0,0 +1,275 @@
+#include "group/GroupSharedAudioEncoder.h"
+
+#include "absl/strings/match.h"
+#include "absl/types/optional.h"
+#include "api/audio_codecs/audio_encoder.h"
+#include "rtc_base/buffer.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/ref_counted_object.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+
+namespace tgcalls {
+
+namespace {
+
+// Packets kept for calls behind the one encoding; a call further behind
+// skips ahead instead.
+constexpr size_t kMaxPackets = 8;
+constexpr uint64_t kMaxLagFrames = 20;
+
+} // namespace
+
+class GroupSharedAudioEncoder::Shared {
+public:
+    struct Packet {
+        // Input frame the encoder returned the packet for, and how many
+        // frames it holds.
+        uint64_t frame = 0;
+        uint32_t frames = 1;
+        rtc::Buffer payload;
+        webrtc::AudioEncoder::EncodedInfo info;
+    };
+
+    // Called with |mutex| held.
+    void applyNetworkConditions() {
+        if (!encoder) {
+            return;
+        }
+        if (!targetBitrates.empty()) {
+            int bitrate = targetBitrates.begin()->second;
+            for (const auto &it : targetBitrates) {
+                bitrate = std::min(bitrate, it.second);
+            }
+            encoder->OnReceivedUplinkBandwidth(bitrate, absl::nullopt);
+        }
+        if (!packetLossFractions.empty()) {
+            float fraction = 0.0f;
+            for (const auto &it : packetLossFractions) {
+                fraction = std::max(fraction, it.second);
+            }
+            encoder->OnReceivedUplinkPacketLossFraction(fraction);
+        }
+    }
+
+    std::mutex mutex;
+    std::unique_ptr<webrtc::AudioEncoder> encoder;
+    absl::optional<webrtc::SdpAudioFormat> format;
+    int views = 0;
+    uint32_t timestamp = 0;
+    uint64_t fedFrames = 0;
+    std::deque<Packet> packets;
+    std::map<const void *, int> targetBitrates;
+    std::map<const void *, float> packetLossFractions;
+    Stats stats;
+};
+
+namespace {
+
+class SharedAudioEncoderView : public webrtc::AudioEncoder {
+public:
+    // With |shared->mutex| held and |shared->encoder| set.
+    explicit SharedAudioEncoderView(std::shared_ptr<GroupSharedAudioEncoder::Shared> shared) :
+    _shared(std::move(shared)),
+    _sampleRateHz(_shared->encoder->SampleRateHz()),
+    _numChannels(_shared->encoder->NumChannels()),
+    _rtpTimestampRateHz(_shared->encoder->RtpTimestampRateHz()),
+    _max10MsFramesInAPacket(_shared->encoder->Max10MsFramesInAPacket()),
+    _position(_shared->fedFrames) {
+        _shared->views++;
+    }
+
+    ~SharedAudioEncoderView() override {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        _shared->targetBitrates.erase(this);
+        _shared->packetLossFractions.erase(this);
+        if (--_shared->views == 0) {
+            // The next call may come with another profile.
+            _shared->encoder.reset();
+            _shared->format.reset();
+            _shared->packets.clear();
+        } else {
+            _shared->applyNetworkConditions();
+        }
+    }
+
+    int SampleRateHz() const override {
+        return _sampleRateHz;
+    }
+
+    size_t NumChannels() const override {
+        return _numChannels;
+    }
+
+    int RtpTimestampRateHz() const override {
+        return _rtpTimestampRateHz;
+    }
+
+    size_t Num10MsFramesInNextPacket() const override {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        return _shared->encoder->Num10MsFramesInNextPacket();
+    }
+
+    size_t Max10MsFramesInAPacket() const override {
+        return _max10MsFramesInAPacket;
+    }
+
+    int GetTargetBitrate() const override {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        return _shared->encoder->GetTargetBitrate();
+    }
+
+    void Reset() override {
+        // Resetting the shared encoder would cut every other call short.
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        _position = _shared->fedFrames;
+    }
+
+    void OnReceivedUplinkBandwidth(int target_audio_bitrate_bps, absl::optional<int64_t> bwe_period_ms) override {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        _shared->targetBitrates[this] = target_audio_bitrate_bps;
+        _shared->applyNetworkConditions();
+    }
+
+    void OnReceivedUplinkPacketLossFraction(float uplink_packet_loss_fraction) override {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        _shared->packetLossFractions[this] = uplink_packet_loss_fraction;
+        _shared->applyNetworkConditions();
+    }
+
+    void OnReceivedOverhead(size_t overhead_bytes_per_packet) override {
+        // The same for every call over the same kind of transport.
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        _shared->encoder->OnReceivedOverhead(overhead_bytes_per_packet);
+    }
+
+    absl::optional<std::pair<webrtc::TimeDelta, webrtc::TimeDelta>> GetFrameLengthRange() const override {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        return _shared->encoder->GetFrameLengthRange();
+    }
+
+protected:
+    EncodedInfo EncodeImpl(uint32_t rtp_timestamp, rtc::ArrayView<const int16_t> audio, rtc::Buffer *encoded) override {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        auto &shared = *_shared;
+        const uint32_t frameTicks = static_cast<uint32_t>(_rtpTimestampRateHz / 100);
+
+        if (_position + kMaxLagFrames < shared.fedFrames) {
+            shared.stats.skippedFrames += shared.fedFrames - _position;
+            _position = shared.fedFrames;
+        }
+        if (_position == shared.fedFrames) {
+            _scratch.Clear();
+            const auto info = shared.encoder->Encode(shared.timestamp, audio, &_scratch);
+            if (info.encoded_bytes > 0 || info.send_even_if_empty) {
+                GroupSharedAudioEncoder::Shared::Packet packet;
+                packet.frame = shared.fedFrames;
+                packet.frames = (shared.timestamp - info.encoded_timestamp) / frameTicks + 1;
+                packet.payload.SetData(_scratch.data(), _scratch.size());
+                packet.info = info;
+                shared.packets.push_back(std::move(packet));
+                while (shared.packets.size() > kMaxPackets) {
+                    shared.packets.pop_front();
+                }
+            }
+            shared.timestamp += frameTicks;
+            shared.fedFrames++;
+            shared.stats.encodedFrames++;
+        } else {
+            shared.stats.sharedFrames++;
+        }
+
+        const auto frame = _position++;
+        for (auto it = shared.packets.rbegin(); it != shared.packets.rend() && it->frame >= frame; ++it) {
+            if (it->frame != frame) {
+                continue;
+            }
+            encoded->AppendData(it->payload.data(), it->payload.size());
+            EncodedInfo info = it->info;
+            info.encoded_bytes = it->payload.size();
+            // This call's own timeline: the packet started that many
+            // frames before the one just added.
+            info.encoded_timestamp = rtp_timestamp - (it->frames - 1) * frameTicks;
+            info.redundant.clear();
+            return info;
+        }
+        return EncodedInfo();
+    }
+
+private:
+    std::shared_ptr<GroupSharedAudioEncoder::Shared> _shared;
+    const int _sampleRateHz = 0;
+    const size_t _numChannels = 0;
+    const int _rtpTimestampRateHz = 0;
+    const size_t _max10MsFramesInAPacket = 0;
+    // Next input frame of the shared encoder this call sends.
+    uint64_t _position = 0;
+    rtc::Buffer _scratch;
+};
+
+class SharedAudioEncoderFactory : public webrtc::AudioEncoderFactory {
+public:
+    SharedAudioEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory, std::shared_ptr<GroupSharedAudioEncoder::Shared> shared) :
+    _factory(std::move(factory)),
+    _shared(std::move(shared)) {
+    }
+
+    std::vector<webrtc::AudioCodecSpec> GetSupportedEncoders() override {
+        return _factory->GetSupportedEncoders();
+    }
+
+    absl::optional<webrtc::AudioCodecInfo> QueryAudioEncoder(const webrtc::SdpAudioFormat &format) override {
+        return _factory->QueryAudioEncoder(format);
+    }
+
+    std::unique_ptr<webrtc::AudioEncoder> MakeAudioEncoder(int payloadType, const webrtc::SdpAudioFormat &format, absl::optional<webrtc::AudioCodecPairId> codecPairId) override {
+        if (!absl::EqualsIgnoreCase(format.name, "opus")) {
+            return _factory->MakeAudioEncoder(payloadType, format, codecPairId);
+        }
+
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        if (!_shared->encoder) {
+            _shared->encoder = _factory->MakeAudioEncoder(payloadType, format, codecPairId);
+            if (!_shared->encoder) {
+                return nullptr;
+            }
+            _shared->format = format;
+            _shared->packets.clear();
+        } else if (*_shared->format != format) {
+            RTC_LOG(LS_WARNING) << "GroupSharedAudioEncoder: a call's Opus parameters differ from the shared encoder's, encoding separately";
+            return _factory->MakeAudioEncoder(payloadType, format, codecPairId);
+        }
+        return std::make_unique<SharedAudioEncoderView>(_shared);
+    }
+
+private:
+    rtc::scoped_refptr<webrtc::AudioEncoderFactory> _factory;
+    std::shared_ptr<GroupSharedAudioEncoder::Shared> _shared;
+};
+
+} // namespace
+
+GroupSharedAudioEncoder::GroupSharedAudioEncoder() :
+_shared(std::make_shared<Shared>()) {
+}
+
+GroupSharedAudioEncoder::~GroupSharedAudioEncoder() = default;
+
+rtc::scoped_refptr<webrtc::AudioEncoderFactory> GroupSharedAudioEncoder::wrapEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory) {
+    if (!factory) {
+        return factory;
+    }
+    return new rtc::RefCountedObject<SharedAudioEncoderFactory>(std::move(factory), _shared);
+}
+
+GroupSharedAudioEncoder::Stats GroupSharedAudioEncoder::getStats() const {
+    std::lock_guard<std::mutex> lock(_shared->mutex);
+    Stats stats = _shared->stats;
+    stats.calls = _shared->views;
+    return stats;
+}
+
+} // namespace tgcalls
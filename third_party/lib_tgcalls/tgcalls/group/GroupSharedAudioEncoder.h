@@ -0,0 +1,61 @@
+#ifndef TGCALLS_GROUP_SHARED_AUDIO_ENCODER_H
+#define TGCALLS_GROUP_SHARED_AUDIO_ENCODER_H
+
+#include <cstdint>
+#include <memory>
+
+#include "api/audio_codecs/audio_encoder_factory.h"
+#include "api/scoped_refptr.h"
+
+namespace tgcalls {
+
+// One Opus encoder whose output is sent by many group calls, for a stream
+// broadcast into all of them: encoding costs the same for one call or a
+// thousand.
+//
+// Every call's send stream gets a view onto the shared encoder instead of
+// an encoder of its own, and still packetizes, encrypts and paces on its
+// own SSRC. Each 10 ms of input is encoded once, by whichever call reaches
+// it first; the calls behind it send the packets it produced instead of
+// encoding their own input, which therefore has to be the same audio, e.g.
+// from one audio device shared by all of them. A call that falls further
+// behind than a few packets, or unmutes, skips ahead to the newest audio.
+// The encoder targets the lowest bitrate any call's congestion control
+// allows and the highest packet loss any of them sees.
+//
+// Pass the same instance in GroupInstanceDescriptor::sharedAudioEncoder to
+// every call that should share. The first call's outgoing audio profile
+// configures the encoder; calls whose profile makes a different Opus
+// format encode on their own.
+class GroupSharedAudioEncoder {
+public:
+    struct Stats {
+        // Calls sending the shared encoder's output.
+        int calls = 0;
+        // 10 ms frames encoded, and those a call sent from another call's
+        // encoding instead of encoding them again.
+        uint64_t encodedFrames = 0;
+        uint64_t sharedFrames = 0;
+        // Frames lagging calls skipped to catch up.
+        uint64_t skippedFrames = 0;
+    };
+
+    GroupSharedAudioEncoder();
+    ~GroupSharedAudioEncoder();
+
+    // Opus encoders made by the returned factory are views onto this
+    // encoder, which |factory| creates when the first view is made; other
+    // codecs come from |factory| as they are.
+    rtc::scoped_refptr<webrtc::AudioEncoderFactory> wrapEncoderFactory(rtc::scoped_refptr<webrtc::AudioEncoderFactory> factory);
+
+    Stats getStats() const;
+
+    class Shared;
+
+private:
+    std::shared_ptr<Shared> _shared;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,464 @@
+#include "group/GroupSharedUdpSockets.h"
+
+#include "group/BatchedUdpSocket.h"
+#include "CpuAccounting.h"
+#include "HotPathCounters.h"
+
+#include "p2p/base/basic_packet_socket_factory.h"
+#include "rtc_base/async_packet_socket.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/socket_address.h"
+#include "rtc_base/task_utils/pending_task_safety_flag.h"
+#include "rtc_base/task_utils/to_queued_task.h"
+#include "rtc_base/third_party/sigslot/sigslot.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace tgcalls {
+
+class SharedUdpSocket;
+
+namespace {
+
+// The ICE ufrag a STUN binding request is addressed to: the part of its
+// USERNAME before the colon. Empty for anything else.
+std::string BindingRequestUfrag(const uint8_t *data, size_t size) {
+    static constexpr uint32_t kMagicCookie = 0x2112A442;
+    static constexpr uint16_t kBindingRequest = 0x0001;
+    static constexpr uint16_t kUsernameAttribute = 0x0006;
+
+    if (size < 20) {
+        return std::string();
+    }
+    uint16_t type = (data[0] << 8) | data[1];
+    size_t length = (data[2] << 8) | data[3];
+    uint32_t cookie = (uint32_t(data[4]) << 24) | (uint32_t(data[5]) << 16) | (uint32_t(data[6]) << 8) | uint32_t(data[7]);
+    if (type != kBindingRequest || cookie != kMagicCookie || 20 + length > size) {
+        return std::string();
+    }
+
+    size_t offset = 20;
+    size_t end = 20 + length;
+    while (offset + 4 <= end) {
+        uint16_t attributeType = (data[offset] << 8) | data[offset + 1];
+        size_t attributeLength = (data[offset + 2] << 8) | data[offset + 3];
+        offset += 4;
+        if (offset + attributeLength > end) {
+            break;
+        }
+        if (attributeType == kUsernameAttribute) {
+            const char *username = reinterpret_cast<const char *>(data + offset);
+            const char *separator = std::find(username, username + attributeLength, ':');
+            return std::string(username, separator);
+        }
+        offset += (attributeLength + 3) & ~size_t(3);
+    }
+    return std::string();
+}
+
+} // namespace
+
+// Shared sockets of one network thread. Network thread only, apart from
+// the atomic counters.
+class GroupSharedUdpSockets::ThreadSockets : public sigslot::has_slots<>, public std::enable_shared_from_this<ThreadSockets> {
+public:
+    struct SharedSocket {
+        std::unique_ptr<rtc::AsyncPacketSocket> socket;
+        rtc::IPAddress localIp;
+        // Call sockets that report this socket's address as their own.
+        std::set<SharedUdpSocket *> homeUsers;
+        // Remote address -> call socket receiving its datagrams.
+        std::map<rtc::SocketAddress, SharedUdpSocket *> routes;
+    };
+
+    ThreadSockets(rtc::Thread *thread, bool useBatchedUdpSockets, std::shared_ptr<Counters> counters);
+    ~ThreadSockets();
+
+    rtc::AsyncPacketSocket *createSocket(const rtc::SocketAddress &localAddress, uint16_t minPort, uint16_t maxPort, std::string const &localUfrag, std::shared_ptr<CpuAccount> cpuAccount);
+
+    // The shared socket |user| sends to |address| from, picked and claimed
+    // on the first send. Null if no socket could be opened.
+    SharedSocket *route(SharedUdpSocket *user, const rtc::SocketAddress &address);
+    void release(SharedUdpSocket *user);
+
+private:
+    SharedSocket *openSocket(const rtc::IPAddress &localIp, uint16_t minPort, uint16_t maxPort);
+    void scheduleCleanup();
+    void cleanup();
+
+    void onReadPacket(rtc::AsyncPacketSocket *socket, const char *data, size_t size, const rtc::SocketAddress &remoteAddress, const int64_t &packetTime);
+    void onReadyToSend(rtc::AsyncPacketSocket *socket);
+
+    SharedSocket *findSocket(rtc::AsyncPacketSocket *socket);
+
+    rtc::Thread *_thread = nullptr;
+    std::shared_ptr<Counters> _counters;
+    std::unique_ptr<rtc::BasicPacketSocketFactory> _socketFactory;
+    std::vector<std::unique_ptr<SharedSocket>> _sockets;
+    bool _isCleanupScheduled = false;
+    webrtc::ScopedTaskSafety _safety;
+};
+
+// One call's UDP socket: sends go out of a shared socket, and the datagrams
+// routed to it arrive as if it had received them itself, charged to the
+// call's CpuAccount.
+class SharedUdpSocket : public rtc::AsyncPacketSocket {
+public:
+    using ThreadSockets = GroupSharedUdpSockets::ThreadSockets;
+
+    SharedUdpSocket(std::shared_ptr<ThreadSockets> owner, ThreadSockets::SharedSocket *home, std::string localUfrag, std::shared_ptr<CpuAccount> cpuAccount) :
+    _owner(std::move(owner)),
+    _home(home),
+    _localAddress(home->socket->GetLocalAddress()),
+    _localUfrag(std::move(localUfrag)),
+    _cpuAccount(std::move(cpuAccount)) {
+    }
+
+    ~SharedUdpSocket() override {
+        Close();
+    }
+
+    std::string const &localUfrag() const {
+        return _localUfrag;
+    }
+
+    ThreadSockets::SharedSocket *home() const {
+        return _home;
+    }
+
+    rtc::SocketAddress GetLocalAddress() const override {
+        return _localAddress;
+    }
+
+    rtc::SocketAddress GetRemoteAddress() const override {
+        return rtc::SocketAddress();
+    }
+
+    int Send(const void *data, size_t size, const rtc::PacketOptions &options) override {
+        _error = ENOTCONN;
+        return -1;
+    }
+
+    int SendTo(const void *data, size_t size, const rtc::SocketAddress &address, const rtc::PacketOptions &options) override {
+        if (!_home) {
+            _error = EBADF;
+            return -1;
+        }
+        auto socket = _owner->route(this, address);
+        if (!socket) {
+            _error = EADDRNOTAVAIL;
+            return -1;
+        }
+
+        rtc::SentPacket sentPacket(options.packet_id, rtc::TimeMillis(), options.info_signaled_after_sent);
+        CopySocketInformationToPacketInfo(size, *this, true, &sentPacket.info);
+        int result = socket->socket->SendTo(data, size, address, options);
+        if (result < 0) {
+            _error = socket->socket->GetError();
+        }
+        SignalSentPacket(this, sentPacket);
+        return result;
+    }
+
+    int Close() override {
+        if (_home) {
+            _home = nullptr;
+            _owner->release(this);
+        }
+        return 0;
+    }
+
+    State GetState() const override {
+        return _home ? STATE_BOUND : STATE_CLOSED;
+    }
+
+    // Options go to the home socket, so the last call to set one decides
+    // it for everybody sharing that socket.
+    int GetOption(rtc::Socket::Option option, int *value) override {
+        return _home ? _home->socket->GetOption(option, value) : -1;
+    }
+
+    int SetOption(rtc::Socket::Option option, int value) override {
+        return _home ? _home->socket->SetOption(option, value) : -1;
+    }
+
+    int GetError() const override {
+        return _error;
+    }
+
+    void SetError(int error) override {
+        _error = error;
+    }
+
+    void deliver(const char *data, size_t size, const rtc::SocketAddress &remoteAddress, int64_t packetTime) {
+        CpuTimeScope cpuScope(_cpuAccount, CpuAccount::Thread::Network);
+        SignalReadPacket(this, data, size, remoteAddress, packetTime);
+    }
+
+    void notifyReadyToSend() {
+        SignalReadyToSend(this);
+    }
+
+private:
+    std::shared_ptr<ThreadSockets> _owner;
+    ThreadSockets::SharedSocket *_home = nullptr;
+    rtc::SocketAddress _localAddress;
+    std::string _localUfrag;
+    std::shared_ptr<CpuAccount> _cpuAccount;
+    int _error = 0;
+};
+
+namespace {
+
+class SharedUdpPacketSocketFactory : public rtc::BasicPacketSocketFactory {
+public:
+    SharedUdpPacketSocketFactory(rtc::Thread *thread, std::shared_ptr<GroupSharedUdpSockets::ThreadSockets> sockets, std::string localUfrag) :
+    rtc::BasicPacketSocketFactory(thread),
+    _sockets(std::move(sockets)),
+    _localUfrag(std::move(localUfrag)),
+    _cpuAccount(CpuAccounting::current()) {
+    }
+
+    rtc::AsyncPacketSocket *CreateUdpSocket(const rtc::SocketAddress &localAddress, uint16_t minPort, uint16_t maxPort) override {
+        return _sockets->createSocket(localAddress, minPort, maxPort, _localUfrag, _cpuAccount);
+    }
+
+private:
+    std::shared_ptr<GroupSharedUdpSockets::ThreadSockets> _sockets;
+    std::string _localUfrag;
+    // Of the call creating the factory.
+    std::shared_ptr<CpuAccount> _cpuAccount;
+};
+
+} // namespace
+
+GroupSharedUdpSockets::ThreadSockets::ThreadSockets(rtc::Thread *thread, bool useBatchedUdpSockets, std::shared_ptr<Counters> counters) :
+_thread(thread),
+_counters(std::move(counters)) {
+    if (useBatchedUdpSockets && BatchedPacketSocketFactory::IsSupported()) {
+        _socketFactory.reset(new BatchedPacketSocketFactory(thread));
+    } else {
+        _socketFactory.reset(new rtc::BasicPacketSocketFactory(thread));
+    }
+}
+
+GroupSharedUdpSockets::ThreadSockets::~ThreadSockets() {
+    RTC_DCHECK(_thread->IsCurrent());
+    _counters->sockets -= static_cast<int>(_sockets.size());
+}
+
+rtc::AsyncPacketSocket *GroupSharedUdpSockets::ThreadSockets::createSocket(const rtc::SocketAddress &localAddress, uint16_t minPort, uint16_t maxPort, std::string const &localUfrag, std::shared_ptr<CpuAccount> cpuAccount) {
+    RTC_DCHECK(_thread->IsCurrent());
+
+    // The least used socket on the address with room for another call.
+    int maxCallsPerSocket = std::max(1, _counters->maxCallsPerSocket.load());
+    SharedSocket *home = nullptr;
+    for (const auto &socket : _sockets) {
+        if (socket->localIp != localAddress.ipaddr() || (int)socket->homeUsers.size() >= maxCallsPerSocket) {
+            continue;
+        }
+        if (!home || socket->homeUsers.size() < home->homeUsers.size()) {
+            home = socket.get();
+        }
+    }
+    if (!home) {
+        home = openSocket(localAddress.ipaddr(), minPort, maxPort);
+        if (!home) {
+            return nullptr;
+        }
+    }
+
+    auto user = new SharedUdpSocket(shared_from_this(), home, localUfrag, std::move(cpuAccount));
+    home->homeUsers.insert(user);
+    _counters->callSockets++;
+    return user;
+}
+
+GroupSharedUdpSockets::ThreadSockets::SharedSocket *GroupSharedUdpSockets::ThreadSockets::route(SharedUdpSocket *user, const rtc::SocketAddress &address) {
+    RTC_DCHECK(_thread->IsCurrent());
+
+    SharedSocket *home = user->home();
+    for (const auto &socket : _sockets) {
+        const auto it = socket->routes.find(address);
+        if (it != socket->routes.end() && it->second == user) {
+            return socket.get();
+        }
+    }
+
+    // The home socket where possible, so the reflexive address the server
+    // sees is the one this socket reports; else any other on the same
+    // local address that isn't talking to |address| yet.
+    SharedSocket *candidate = nullptr;
+    if (home->routes.find(address) == home->routes.end()) {
+        candidate = home;
+    } else {
+        for (const auto &socket : _sockets) {
+            if (socket->localIp == home->localIp && socket->routes.find(address) == socket->routes.end()) {
+                candidate = socket.get();
+                break;
+            }
+        }
+    }
+    if (!candidate) {
+        candidate = openSocket(home->localIp, 0, 0);
+        if (!candidate) {
+            return nullptr;
+        }
+    }
+    candidate->routes[address] = user;
+    return candidate;
+}
+
+void GroupSharedUdpSockets::ThreadSockets::release(SharedUdpSocket *user) {
+    RTC_DCHECK(_thread->IsCurrent());
+
+    for (const auto &socket : _sockets) {
+        socket->homeUsers.erase(user);
+        for (auto it = socket->routes.begin(); it != socket->routes.end();) {
+            if (it->second == user) {
+                it = socket->routes.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    _counters->callSockets--;
+    scheduleCleanup();
+}
+
+GroupSharedUdpSockets::ThreadSockets::SharedSocket *GroupSharedUdpSockets::ThreadSockets::openSocket(const rtc::IPAddress &localIp, uint16_t minPort, uint16_t maxPort) {
+    std::unique_ptr<rtc::AsyncPacketSocket> socket(_socketFactory->CreateUdpSocket(rtc::SocketAddress(localIp, 0), minPort, maxPort));
+    if (!socket) {
+        RTC_LOG(LS_ERROR) << "GroupSharedUdpSockets: failed to open a UDP socket on " << localIp.ToSensitiveString();
+        return nullptr;
+    }
+    socket->SignalReadPacket.connect(this, &ThreadSockets::onReadPacket);
+    socket->SignalReadyToSend.connect(this, &ThreadSockets::onReadyToSend);
+
+    auto shared = std::make_unique<SharedSocket>();
+    shared->socket = std::move(socket);
+    shared->localIp = localIp;
+    _sockets.push_back(std::move(shared));
+    _counters->sockets++;
+    return _sockets.back().get();
+}
+
+void GroupSharedUdpSockets::ThreadSockets::scheduleCleanup() {
+    // Unused sockets are closed from a task of their own: a call socket may
+    // be released from inside a shared socket's read callback.
+    if (_isCleanupScheduled) {
+        return;
+    }
+    _isCleanupScheduled = true;
+    _thread->PostTask(webrtc::ToQueuedTask(_safety, [this]() {
+        cleanup();
+    }));
+}
+
+void GroupSharedUdpSockets::ThreadSockets::cleanup() {
+    _isCleanupScheduled = false;
+    auto it = std::remove_if(_sockets.begin(), _sockets.end(), [](const auto &socket) {
+        return socket->homeUsers.empty() && socket->routes.empty();
+    });
+    _counters->sockets -= static_cast<int>(std::distance(it, _sockets.end()));
+    _sockets.erase(it, _sockets.end());
+}
+
+GroupSharedUdpSockets::ThreadSockets::SharedSocket *GroupSharedUdpSockets::ThreadSockets::findSocket(rtc::AsyncPacketSocket *socket) {
+    for (const auto &shared : _sockets) {
+        if (shared->socket.get() == socket) {
+            return shared.get();
+        }
+    }
+    return nullptr;
+}
+
+void GroupSharedUdpSockets::ThreadSockets::onReadPacket(rtc::AsyncPacketSocket *socket, const char *data, size_t size, const rtc::SocketAddress &remoteAddress, const int64_t &packetTime) {
+    auto shared = findSocket(socket);
+    if (!shared) {
+        return;
+    }
+    _counters->receivedPackets++;
+
+    const auto route = shared->routes.find(remoteAddress);
+    if (route != shared->routes.end()) {
+        route->second->deliver(data, size, remoteAddress, packetTime);
+        return;
+    }
+
+    const auto ufrag = BindingRequestUfrag(reinterpret_cast<const uint8_t *>(data), size);
+    if (!ufrag.empty()) {
+        for (const auto user : shared->homeUsers) {
+            if (user->localUfrag() == ufrag) {
+                shared->routes[remoteAddress] = user;
+                user->deliver(data, size, remoteAddress, packetTime);
+                return;
+            }
+        }
+    }
+    _counters->unroutedPackets++;
+    HotPathCounters::onPacketDropped(HotPathCounters::PacketDropReason::Unrouted);
+}
+
+void GroupSharedUdpSockets::ThreadSockets::onReadyToSend(rtc::AsyncPacketSocket *socket) {
+    auto shared = findSocket(socket);
+    if (!shared) {
+        return;
+    }
+    std::set<SharedUdpSocket *> users = shared->homeUsers;
+    for (const auto &route : shared->routes) {
+        users.insert(route.second);
+    }
+    for (const auto user : users) {
+        user->notifyReadyToSend();
+    }
+}
+
+GroupSharedUdpSockets::GroupSharedUdpSockets(int maxCallsPerSocket) :
+_counters(std::make_shared<Counters>()) {
+    configure(maxCallsPerSocket);
+}
+
+GroupSharedUdpSockets::~GroupSharedUdpSockets() = default;
+
+void GroupSharedUdpSockets::configure(int maxCallsPerSocket) {
+    _counters->maxCallsPerSocket = std::max(1, maxCallsPerSocket);
+}
+
+std::unique_ptr<rtc::BasicPacketSocketFactory> GroupSharedUdpSockets::createSocketFactory(rtc::Thread *thread, std::string const &localUfrag, bool useBatchedUdpSockets) {
+    RTC_DCHECK(thread->IsCurrent());
+
+    std::shared_ptr<ThreadSockets> sockets;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto &entry = _threadSockets[std::make_pair(thread, useBatchedUdpSockets)];
+        sockets = entry.lock();
+        if (!sockets) {
+            sockets = std::make_shared<ThreadSockets>(thread, useBatchedUdpSockets, _counters);
+            entry = sockets;
+        }
+        for (auto it = _threadSockets.begin(); it != _threadSockets.end();) {
+            if (it->second.expired()) {
+                it = _threadSockets.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    return std::make_unique<SharedUdpPacketSocketFactory>(thread, std::move(sockets), localUfrag);
+}
+
+GroupSharedUdpSockets::Stats GroupSharedUdpSockets::getStats() const {
+    Stats stats;
+    stats.sockets = _counters->sockets.load();
+    stats.callSockets = _counters->callSockets.load();
+    stats.receivedPackets = _counters->receivedPackets.load();
+    stats.unroutedPackets = _counters->unroutedPackets.load();
+    return stats;
+}
+
+} // namespace tgcalls
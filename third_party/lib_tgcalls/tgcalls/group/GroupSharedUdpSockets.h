@@ -0,0 +1,76 @@
+#ifndef TGCALLS_GROUP_SHARED_UDP_SOCKETS_H
+#define TGCALLS_GROUP_SHARED_UDP_SOCKETS_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace rtc {
+class BasicPacketSocketFactory;
+class Thread;
+}
+
+namespace tgcalls {
+
+// UDP sockets shared by the GroupNetworkManagers of many calls, so a host
+// running a thousand calls holds a few sockets per network thread instead
+// of one per call and interface.
+//
+// Each call gets UDP sockets that are views onto a shared one. Incoming
+// datagrams are demultiplexed by remote address, claimed by the call that
+// sent to it first; a STUN binding request from an address nobody claimed
+// yet goes to the call whose ICE ufrag it names. Two calls talking to the
+// same server address can't share a 5-tuple, so the second one sends from
+// another shared socket, created on demand. ICE and transport stats stay
+// per call, since every call still sees its own packets on its own ports.
+//
+// Pass the same instance in GroupInstanceDescriptor::sharedUdpSockets to
+// every call that should share.
+class GroupSharedUdpSockets {
+public:
+    struct Stats {
+        // Shared sockets open, and call sockets using them.
+        int sockets = 0;
+        int callSockets = 0;
+        // Datagrams received, and those dropped because no call claimed
+        // their remote address.
+        uint64_t receivedPackets = 0;
+        uint64_t unroutedPackets = 0;
+    };
+
+    explicit GroupSharedUdpSockets(int maxCallsPerSocket = 64);
+    ~GroupSharedUdpSockets();
+
+    // Applies to call sockets created afterwards.
+    void configure(int maxCallsPerSocket);
+
+    // Packet socket factory for one call, whose UDP sockets share those of
+    // the other calls on |thread|. Must be called and used on |thread|, the
+    // call's network thread. Packets read for the call are charged to the
+    // CpuAccount current when this is called.
+    std::unique_ptr<rtc::BasicPacketSocketFactory> createSocketFactory(rtc::Thread *thread, std::string const &localUfrag, bool useBatchedUdpSockets);
+
+    Stats getStats() const;
+
+    struct Counters {
+        std::atomic<int> maxCallsPerSocket{64};
+        std::atomic<int> sockets{0};
+        std::atomic<int> callSockets{0};
+        std::atomic<uint64_t> receivedPackets{0};
+        std::atomic<uint64_t> unroutedPackets{0};
+    };
+    class ThreadSockets;
+
+private:
+    mutable std::mutex _mutex;
+    std::map<std::pair<rtc::Thread *, bool>, std::weak_ptr<ThreadSockets>> _threadSockets;
+    std::shared_ptr<Counters> _counters;
+};
+
+} // namespace tgcalls
+
+#endif
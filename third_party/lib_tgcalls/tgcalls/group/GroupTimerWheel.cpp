@@ -0,0 +1,164 @@
+#include "group/GroupTimerWheel.h"
+
+#include "CpuAccounting.h"
+
+#include "api/units/time_delta.h"
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+namespace tgcalls {
+
+namespace {
+
+int64_t ticksFromMs(int64_t ms) {
+    return std::max<int64_t>(0, (ms + GroupTimerWheel::kTickMs - 1) / GroupTimerWheel::kTickMs);
+}
+
+} // namespace
+
+GroupTimerWheel::Timer::~Timer() {
+    stop();
+}
+
+void GroupTimerWheel::Timer::start(std::shared_ptr<GroupTimerWheel> wheel, int64_t delayMs, int64_t intervalMs, std::function<void()> callback) {
+    stop();
+    _wheel = std::move(wheel);
+    _callback = std::move(callback);
+    _cpuAccount = CpuAccounting::current();
+    _intervalTicks = std::max<int64_t>(1, ticksFromMs(intervalMs));
+    if (_wheel->_count++ == 0) {
+        // Shared by every call on the thread, so charged to none.
+        CpuAccountScope noAccount(nullptr);
+        _wheel->_lastTick = _wheel->currentTick();
+        _wheel->_task = webrtc::RepeatingTaskHandle::DelayedStart(_wheel->_thread, webrtc::TimeDelta::Millis(kTickMs), [wheel = _wheel.get()] {
+            wheel->advance();
+            return webrtc::TimeDelta::Millis(kTickMs);
+        });
+    }
+    _wheel->schedule(this, _wheel->_lastTick + ticksFromMs(delayMs));
+}
+
+void GroupTimerWheel::Timer::setInterval(int64_t intervalMs) {
+    _intervalTicks = std::max<int64_t>(1, ticksFromMs(intervalMs));
+}
+
+void GroupTimerWheel::Timer::stop() {
+    if (!_list) {
+        return;
+    }
+    _wheel->unlink(this);
+    if (--_wheel->_count == 0) {
+        _wheel->_task.Stop();
+    }
+}
+
+bool GroupTimerWheel::Timer::isActive() const {
+    return _list != nullptr;
+}
+
+std::shared_ptr<GroupTimerWheel> GroupTimerWheel::forThread(rtc::Thread *thread) {
+    static std::mutex mutex;
+    static std::map<rtc::Thread *, std::weak_ptr<GroupTimerWheel>> wheels;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &weak = wheels[thread];
+    auto wheel = weak.lock();
+    if (!wheel) {
+        wheel = std::make_shared<GroupTimerWheel>(thread);
+        weak = wheel;
+    }
+    return wheel;
+}
+
+GroupTimerWheel::GroupTimerWheel(rtc::Thread *thread) :
+_thread(thread),
+_slots(kSlots) {
+}
+
+GroupTimerWheel::~GroupTimerWheel() {
+    // The last timer is gone, on this thread.
+    _task.Stop();
+}
+
+void GroupTimerWheel::schedule(Timer *timer, int64_t dueTick) {
+    // Never into a slot already passed in this turn.
+    timer->_dueTick = std::max(dueTick, _lastTick + 1);
+    pushBack(_slots[timer->_dueTick % kSlots], timer);
+}
+
+void GroupTimerWheel::unlink(Timer *timer) {
+    auto &list = *timer->_list;
+    if (timer->_previous) {
+        timer->_previous->_next = timer->_next;
+    } else {
+        list.head = timer->_next;
+    }
+    if (timer->_next) {
+        timer->_next->_previous = timer->_previous;
+    } else {
+        list.tail = timer->_previous;
+    }
+    timer->_list = nullptr;
+    timer->_previous = nullptr;
+    timer->_next = nullptr;
+}
+
+void GroupTimerWheel::pushBack(List &list, Timer *timer) {
+    timer->_list = &list;
+    timer->_previous = list.tail;
+    timer->_next = nullptr;
+    if (list.tail) {
+        list.tail->_next = timer;
+    } else {
+        list.head = timer;
+    }
+    list.tail = timer;
+}
+
+void GroupTimerWheel::advance() {
+    // A callback may stop the last timers.
+    const auto self = shared_from_this();
+
+    const auto now = currentTick();
+    if (now <= _lastTick) {
+        return;
+    }
+    // After a stall, one turn visits every slot.
+    const auto first = std::max(_lastTick + 1, now - (int64_t)kSlots + 1);
+    for (auto tick = first; tick <= now; tick++) {
+        auto &slot = _slots[tick % kSlots];
+        for (auto timer = slot.head; timer; ) {
+            const auto next = timer->_next;
+            if (timer->_dueTick <= tick) {
+                unlink(timer);
+                pushBack(_firing, timer);
+            }
+            timer = next;
+        }
+    }
+    _lastTick = now;
+
+    // Rescheduled before being called, so that a callback can stop its own
+    // timer or any other, even one still waiting here.
+    while (const auto timer = _firing.head) {
+        unlink(timer);
+        auto dueTick = timer->_dueTick + timer->_intervalTicks;
+        if (dueTick <= now) {
+            // Ticks missed are not made up for.
+            dueTick = now + 1;
+        }
+        schedule(timer, dueTick);
+        CpuTimeScope scope(timer->_cpuAccount);
+        timer->_callback();
+    }
+}
+
+int64_t GroupTimerWheel::currentTick() const {
+    return rtc::TimeMillis() / kTickMs;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,105 @@
+#ifndef TGCALLS_GROUP_TIMER_WHEEL_H
+#define TGCALLS_GROUP_TIMER_WHEEL_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "rtc_base/task_utils/repeating_task.h"
+
+namespace rtc {
+class Thread;
+}
+
+namespace tgcalls {
+
+class CpuAccount;
+
+// The periodic timers of every group call on one thread, fired by a single
+// repeating task of the thread instead of a delayed task per timer and
+// tick. Timers are linked into the slot of the tick they are due at, so a
+// tick only looks at the timers in its slot, and starting, stopping and
+// firing them allocates nothing; a timer due more than a turn of the wheel
+// away waits in its slot for its turn to come.
+//
+// Everything happens on the wheel's thread. The wheel's task only runs
+// while a timer is started. A timer's callbacks are charged to the
+// CpuAccount current when it was started.
+class GroupTimerWheel : public std::enable_shared_from_this<GroupTimerWheel> {
+    struct List;
+
+public:
+    static constexpr int64_t kTickMs = 10;
+    static constexpr size_t kSlots = 512;
+
+    class Timer {
+    public:
+        Timer() = default;
+        // Stops the timer. Not to be destroyed from its own callback.
+        ~Timer();
+
+        Timer(Timer const &) = delete;
+        Timer &operator=(Timer const &) = delete;
+
+        // Calls |callback| after |delayMs|, then every |intervalMs|, rounded
+        // up to whole ticks; restarts it if it was started. Not to be
+        // called from its own callback, which setInterval() and stop() can
+        // be.
+        void start(std::shared_ptr<GroupTimerWheel> wheel, int64_t delayMs, int64_t intervalMs, std::function<void()> callback);
+        // From the next time it fires.
+        void setInterval(int64_t intervalMs);
+        void stop();
+        bool isActive() const;
+
+    private:
+        friend class GroupTimerWheel;
+
+        std::shared_ptr<GroupTimerWheel> _wheel;
+        std::function<void()> _callback;
+        std::shared_ptr<CpuAccount> _cpuAccount;
+        int64_t _intervalTicks = 1;
+        int64_t _dueTick = 0;
+        // The slot or firing list the timer is in, if started.
+        List *_list = nullptr;
+        Timer *_previous = nullptr;
+        Timer *_next = nullptr;
+    };
+
+    // The wheel of |thread|, shared by every timer started on it.
+    static std::shared_ptr<GroupTimerWheel> forThread(rtc::Thread *thread);
+
+    explicit GroupTimerWheel(rtc::Thread *thread);
+    ~GroupTimerWheel();
+
+    // Timers started.
+    size_t size() const {
+        return _count;
+    }
+
+private:
+    struct List {
+        Timer *head = nullptr;
+        Timer *tail = nullptr;
+    };
+
+    void schedule(Timer *timer, int64_t dueTick);
+    void unlink(Timer *timer);
+    static void pushBack(List &list, Timer *timer);
+
+    // Fires what is due up to now.
+    void advance();
+    int64_t currentTick() const;
+
+    rtc::Thread *_thread = nullptr;
+    std::vector<List> _slots;
+    // Due timers taken out of their slot, being fired.
+    List _firing;
+    size_t _count = 0;
+    int64_t _lastTick = -1;
+    webrtc::RepeatingTaskHandle _task;
+};
+
+} // namespace tgcalls
+
+#endif
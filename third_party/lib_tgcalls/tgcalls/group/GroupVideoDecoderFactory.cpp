@@ -0,0 +1,412 @@
+#include "GroupVideoDecoderFactory.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/strings/match.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/nv12_buffer.h"
+#include "api/video/video_frame.h"
+#include "api/video/video_frame_buffer.h"
+#include "api/video_codecs/video_decoder.h"
+#include "api/video_codecs/video_decoder_software_fallback_wrapper.h"
+#include "media/base/media_constants.h"
+#include "modules/video_coding/codecs/h264/include/h264.h"
+#include "modules/video_coding/include/video_error_codes.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/ref_counted_object.h"
+#include "rtc_base/synchronization/mutex.h"
+#include "third_party/libyuv/include/libyuv/planar_functions.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
+}
+
+namespace tgcalls {
+
+namespace {
+
+// Device frames a decoder may have out beyond those it references itself:
+// the frame each incoming video sink keeps, and those on their way to it.
+constexpr int kExtraHardwareFrames = 4;
+
+AVCodecID codecIdForName(std::string const &name) {
+    if (absl::EqualsIgnoreCase(name, cricket::kH264CodecName)) {
+        return AV_CODEC_ID_H264;
+    } else if (absl::EqualsIgnoreCase(name, cricket::kVp8CodecName)) {
+        return AV_CODEC_ID_VP8;
+    } else if (absl::EqualsIgnoreCase(name, cricket::kVp9CodecName)) {
+        return AV_CODEC_ID_VP9;
+    }
+    return AV_CODEC_ID_NONE;
+}
+
+// One device context per type and device for the process, shared by every
+// decoder, like the hardware itself; never released.
+AVBufferRef *sharedHardwareDevice(AVHWDeviceType type, std::string const &device) {
+    static std::mutex mutex;
+    static std::map<std::pair<int, std::string>, AVBufferRef *> devices;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto key = std::make_pair(static_cast<int>(type), device);
+    const auto it = devices.find(key);
+    if (it != devices.end()) {
+        return it->second;
+    }
+    AVBufferRef *context = nullptr;
+    if (av_hwdevice_ctx_create(&context, type, device.empty() ? nullptr : device.c_str(), nullptr, 0) < 0) {
+        context = nullptr;
+    }
+    // Failures are remembered as well, so that a missing device is only
+    // probed once.
+    devices[key] = context;
+    return context;
+}
+
+// A decoded frame still on the device. It is downloaded the first time a
+// sink asks for its pixels, and the device surface goes back to the
+// decoder's pool with the last reference to the buffer.
+class HardwareFrameBuffer : public webrtc::VideoFrameBuffer {
+public:
+    // Takes |frame|.
+    explicit HardwareFrameBuffer(AVFrame *frame) :
+    _frame(frame) {
+    }
+
+    ~HardwareFrameBuffer() override {
+        av_frame_free(&_frame);
+    }
+
+    Type type() const override {
+        return Type::kNative;
+    }
+
+    int width() const override {
+        return _frame->width;
+    }
+
+    int height() const override {
+        return _frame->height;
+    }
+
+    rtc::scoped_refptr<webrtc::I420BufferInterface> ToI420() override {
+        if (const auto nv12 = download()) {
+            return nv12->ToI420();
+        }
+        // Black rather than null, which callers don't expect.
+        const auto black = webrtc::I420Buffer::Create(width(), height());
+        webrtc::I420Buffer::SetBlack(black.get());
+        return black;
+    }
+
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> GetMappedFrameBuffer(rtc::ArrayView<Type> types) override {
+        if (absl::c_find(types, Type::kNV12) == types.end()) {
+            return nullptr;
+        }
+        return download();
+    }
+
+private:
+    rtc::scoped_refptr<webrtc::NV12Buffer> download() {
+        webrtc::MutexLock lock(&_mutex);
+        if (_downloaded || _downloadFailed) {
+            return _downloaded;
+        }
+        AVFrame *software = av_frame_alloc();
+        if (!software) {
+            return nullptr;
+        }
+        software->format = AV_PIX_FMT_NV12;
+        if (av_hwframe_transfer_data(software, _frame, 0) < 0 || software->format != AV_PIX_FMT_NV12) {
+            RTC_LOG(LS_WARNING) << "GroupVideoDecoderFactory: could not download a " << width() << "x" << height() << " frame as NV12";
+            av_frame_free(&software);
+            _downloadFailed = true;
+            return nullptr;
+        }
+        auto buffer = webrtc::NV12Buffer::Create(width(), height());
+        libyuv::CopyPlane(software->data[0], software->linesize[0], buffer->MutableDataY(), buffer->StrideY(), width(), height());
+        libyuv::CopyPlane(software->data[1], software->linesize[1], buffer->MutableDataUV(), buffer->StrideUV(), buffer->ChromaWidth() * 2, buffer->ChromaHeight());
+        av_frame_free(&software);
+        _downloaded = buffer;
+        return _downloaded;
+    }
+
+    AVFrame *_frame = nullptr;
+
+    webrtc::Mutex _mutex;
+    rtc::scoped_refptr<webrtc::NV12Buffer> _downloaded;
+    bool _downloadFailed = false;
+};
+
+// One stream on FFmpeg's decoder for its codec with the device's hwaccel.
+// Anything the device can't do, from a profile it doesn't support to a
+// stream that fails to decode on it, returns
+// WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE, for the wrapper to go on in
+// software.
+class FFmpegHardwareVideoDecoder : public webrtc::VideoDecoder {
+public:
+    FFmpegHardwareVideoDecoder(AVCodecID codecId, AVBufferRef *device, AVPixelFormat hardwareFormat, std::string const &deviceType) :
+    _codecId(codecId),
+    _device(device),
+    _hardwareFormat(hardwareFormat),
+    _implementationName("FFmpeg " + deviceType) {
+    }
+
+    ~FFmpegHardwareVideoDecoder() override {
+        Release();
+    }
+
+    int32_t InitDecode(const webrtc::VideoCodec *codecSettings, int32_t numberOfCores) override {
+        Release();
+
+        const AVCodec *codec = avcodec_find_decoder(_codecId);
+        if (!codec) {
+            return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+        }
+        _context = avcodec_alloc_context3(codec);
+        if (!_context) {
+            return WEBRTC_VIDEO_CODEC_MEMORY;
+        }
+        _context->opaque = this;
+        _context->get_format = getFormat;
+        _context->hw_device_ctx = av_buffer_ref(_device);
+        _context->extra_hw_frames = kExtraHardwareFrames;
+        // A frame out for every frame in: webrtc never holds input back.
+        _context->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        _context->thread_count = 1;
+        if (codecSettings && codecSettings->width > 0 && codecSettings->height > 0) {
+            _context->coded_width = codecSettings->width;
+            _context->coded_height = codecSettings->height;
+        }
+        if (!_context->hw_device_ctx || avcodec_open2(_context, codec, nullptr) < 0) {
+            RTC_LOG(LS_ERROR) << "FFmpegHardwareVideoDecoder: could not open " << codec->name << " on " << _implementationName;
+            Release();
+            return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+        }
+
+        _frame = av_frame_alloc();
+        _packet = av_packet_alloc();
+        if (!_frame || !_packet) {
+            Release();
+            return WEBRTC_VIDEO_CODEC_MEMORY;
+        }
+        return WEBRTC_VIDEO_CODEC_OK;
+    }
+
+    int32_t Decode(const webrtc::EncodedImage &inputImage, bool missingFrames, int64_t renderTimeMs) override {
+        if (!_context || !_callback) {
+            return WEBRTC_VIDEO_CODEC_UNINITIALIZED;
+        }
+        if (!inputImage.data() || inputImage.size() == 0) {
+            return WEBRTC_VIDEO_CODEC_ERR_PARAMETER;
+        }
+
+        // FFmpeg's bitstream readers may read past the end of the data.
+        _input.resize(inputImage.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+        std::copy(inputImage.data(), inputImage.data() + inputImage.size(), _input.begin());
+        std::fill(_input.begin() + inputImage.size(), _input.end(), 0);
+        _packet->data = _input.data();
+        _packet->size = static_cast<int>(inputImage.size());
+        _packet->pts = inputImage.Timestamp();
+
+        const int result = avcodec_send_packet(_context, _packet);
+        av_packet_unref(_packet);
+        if (_hasFormatFailed) {
+            return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+        }
+        if (result < 0) {
+            // Most likely a frame that references a lost one; the keyframe
+            // webrtc asks for then fixes it.
+            return WEBRTC_VIDEO_CODEC_ERROR;
+        }
+
+        while (true) {
+            const int received = avcodec_receive_frame(_context, _frame);
+            if (received == AVERROR(EAGAIN) || received == AVERROR_EOF) {
+                return WEBRTC_VIDEO_CODEC_OK;
+            } else if (received < 0) {
+                return _hasFormatFailed ? WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE : WEBRTC_VIDEO_CODEC_ERROR;
+            }
+            if (_frame->format != _hardwareFormat) {
+                av_frame_unref(_frame);
+                return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+            }
+
+            const auto timestamp = static_cast<uint32_t>(_frame->best_effort_timestamp != AV_NOPTS_VALUE ? _frame->best_effort_timestamp : _frame->pts);
+            rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer(new rtc::RefCountedObject<HardwareFrameBuffer>(av_frame_clone(_frame)));
+            av_frame_unref(_frame);
+
+            auto frame = webrtc::VideoFrame::Builder()
+                .set_video_frame_buffer(buffer)
+                .set_timestamp_rtp(timestamp)
+                .set_color_space(inputImage.ColorSpace())
+                .build();
+            _callback->Decoded(frame, absl::nullopt, absl::nullopt);
+        }
+    }
+
+    int32_t RegisterDecodeCompleteCallback(webrtc::DecodedImageCallback *callback) override {
+        _callback = callback;
+        return WEBRTC_VIDEO_CODEC_OK;
+    }
+
+    int32_t Release() override {
+        if (_context) {
+            avcodec_free_context(&_context);
+        }
+        if (_frame) {
+            av_frame_free(&_frame);
+        }
+        if (_packet) {
+            av_packet_free(&_packet);
+        }
+        _hasFormatFailed = false;
+        return WEBRTC_VIDEO_CODEC_OK;
+    }
+
+    DecoderInfo GetDecoderInfo() const override {
+        DecoderInfo info;
+        info.implementation_name = _implementationName;
+        info.is_hardware_accelerated = true;
+        return info;
+    }
+
+    const char *ImplementationName() const override {
+        return _implementationName.c_str();
+    }
+
+private:
+    // The device's format when the decoder offers it for the stream, which
+    // it doesn't for a profile the device can't decode.
+    static AVPixelFormat getFormat(AVCodecContext *context, const AVPixelFormat *formats) {
+        const auto decoder = static_cast<FFmpegHardwareVideoDecoder *>(context->opaque);
+        for (auto format = formats; *format != AV_PIX_FMT_NONE; format++) {
+            if (*format == decoder->_hardwareFormat) {
+                return *format;
+            }
+        }
+        RTC_LOG(LS_WARNING) << "FFmpegHardwareVideoDecoder: " << decoder->_implementationName << " can't decode this stream";
+        decoder->_hasFormatFailed = true;
+        return AV_PIX_FMT_NONE;
+    }
+
+    AVCodecID _codecId = AV_CODEC_ID_NONE;
+    AVBufferRef *_device = nullptr;
+    AVPixelFormat _hardwareFormat = AV_PIX_FMT_NONE;
+    std::string _implementationName;
+
+    webrtc::DecodedImageCallback *_callback = nullptr;
+    AVCodecContext *_context = nullptr;
+    AVFrame *_frame = nullptr;
+    AVPacket *_packet = nullptr;
+    std::vector<uint8_t> _input;
+    bool _hasFormatFailed = false;
+};
+
+class GroupVideoDecoderFactory : public webrtc::VideoDecoderFactory {
+public:
+    GroupVideoDecoderFactory(std::unique_ptr<webrtc::VideoDecoderFactory> factory, GroupVideoDecoderConfig const &config) :
+    _factory(std::move(factory)),
+    _config(config) {
+        const auto deviceType = av_hwdevice_find_type_by_name(_config.hardwareDeviceType.c_str());
+        if (deviceType == AV_HWDEVICE_TYPE_NONE) {
+            RTC_LOG(LS_WARNING) << "GroupVideoDecoderFactory: FFmpeg has no hardware device type " << _config.hardwareDeviceType;
+            return;
+        }
+        _device = sharedHardwareDevice(deviceType, _config.hardwareDevice);
+        if (!_device) {
+            RTC_LOG(LS_WARNING) << "GroupVideoDecoderFactory: could not open the " << _config.hardwareDeviceType << " device " << _config.hardwareDevice;
+            return;
+        }
+        for (const auto codecId : { AV_CODEC_ID_H264, AV_CODEC_ID_VP8, AV_CODEC_ID_VP9 }) {
+            const AVCodec *codec = avcodec_find_decoder(codecId);
+            if (!codec) {
+                continue;
+            }
+            for (int i = 0;; i++) {
+                const AVCodecHWConfig *hardwareConfig = avcodec_get_hw_config(codec, i);
+                if (!hardwareConfig) {
+                    break;
+                }
+                if ((hardwareConfig->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) && hardwareConfig->device_type == deviceType) {
+                    _hardwareFormats[codecId] = hardwareConfig->pix_fmt;
+                    break;
+                }
+            }
+        }
+        if (_hardwareFormats.empty()) {
+            RTC_LOG(LS_WARNING) << "GroupVideoDecoderFactory: no decoder of FFmpeg runs on " << _config.hardwareDeviceType;
+        }
+    }
+
+    std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+        auto formats = _factory->GetSupportedFormats();
+        for (const auto &it : _hardwareFormats) {
+            if (hasSoftwareDecoder(it.first)) {
+                continue;
+            }
+            switch (it.first) {
+                case AV_CODEC_ID_H264:
+                    formats.push_back(webrtc::CreateH264Format(webrtc::H264::kProfileConstrainedBaseline, webrtc::H264::kLevel3_1, "1"));
+                    break;
+                case AV_CODEC_ID_VP8:
+                    formats.push_back(webrtc::SdpVideoFormat(cricket::kVp8CodecName));
+                    break;
+                case AV_CODEC_ID_VP9:
+                    formats.push_back(webrtc::SdpVideoFormat(cricket::kVp9CodecName));
+                    break;
+                default:
+                    break;
+            }
+        }
+        return formats;
+    }
+
+    std::unique_ptr<webrtc::VideoDecoder> CreateVideoDecoder(const webrtc::SdpVideoFormat &format) override {
+        const auto codecId = codecIdForName(format.name);
+        const auto hardwareFormat = _hardwareFormats.find(codecId);
+        if (hardwareFormat == _hardwareFormats.end()) {
+            return _factory->CreateVideoDecoder(format);
+        }
+        auto hardware = std::make_unique<FFmpegHardwareVideoDecoder>(codecId, _device, hardwareFormat->second, _config.hardwareDeviceType);
+        if (!hasSoftwareDecoder(codecId)) {
+            return hardware;
+        }
+        auto software = _factory->CreateVideoDecoder(format);
+        if (!software) {
+            return hardware;
+        }
+        return webrtc::CreateVideoDecoderSoftwareFallbackWrapper(std::move(software), std::move(hardware));
+    }
+
+private:
+    bool hasSoftwareDecoder(AVCodecID codecId) const {
+        for (const auto &format : _factory->GetSupportedFormats()) {
+            if (codecIdForName(format.name) == codecId) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::unique_ptr<webrtc::VideoDecoderFactory> _factory;
+    GroupVideoDecoderConfig _config;
+    AVBufferRef *_device = nullptr;
+    std::map<AVCodecID, AVPixelFormat> _hardwareFormats;
+};
+
+} // namespace
+
+std::unique_ptr<webrtc::VideoDecoderFactory> makeGroupVideoDecoderFactory(std::unique_ptr<webrtc::VideoDecoderFactory> factory, GroupVideoDecoderConfig const &config) {
+    if (!factory || config.isDefault()) {
+        return factory;
+    }
+    return std::make_unique<GroupVideoDecoderFactory>(std::move(factory), config);
+}
+
+} // namespace tgcalls
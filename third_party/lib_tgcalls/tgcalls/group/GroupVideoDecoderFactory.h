@@ -0,0 +1,21 @@
+#ifndef TGCALLS_GROUP_VIDEO_DECODER_FACTORY_H
+#define TGCALLS_GROUP_VIDEO_DECODER_FACTORY_H
+
+#include <memory>
+
+#include "api/video_codecs/video_decoder_factory.h"
+
+#include "GroupInstanceImpl.h"
+
+namespace tgcalls {
+
+// Applies |config| to the decoders of |factory|: the codecs the FFmpeg
+// hardware device it names can decode are decoded there, with |factory|'s
+// own decoder as the fallback for when that fails. Frames stay on the device
+// until a sink asks for their pixels, and are downloaded as NV12 then. A
+// default config returns |factory| as is.
+std::unique_ptr<webrtc::VideoDecoderFactory> makeGroupVideoDecoderFactory(std::unique_ptr<webrtc::VideoDecoderFactory> factory, GroupVideoDecoderConfig const &config);
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,857 @@
+#include "GroupVideoEncoderFactory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "absl/strings/match.h"
+#include "api/task_queue/default_task_queue_factory.h"
+#include "api/video/i420_buffer.h"
+#include "api/video/video_frame.h"
+#include "api/video_codecs/video_encoder.h"
+#include "api/video_codecs/video_encoder_software_fallback_wrapper.h"
+#include "common_video/h264/h264_bitstream_parser.h"
+#include "media/base/codec.h"
+#include "media/base/media_constants.h"
+#include "media/engine/encoder_simulcast_proxy.h"
+#include "modules/include/module_common_types_public.h"
+#include "modules/video_coding/codecs/h264/include/h264.h"
+#include "modules/video_coding/codecs/interface/common_constants.h"
+#include "modules/video_coding/include/video_codec_interface.h"
+#include "modules/video_coding/include/video_error_codes.h"
+#include "rtc_base/event.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/task_queue.h"
+#include "rtc_base/time_utils.h"
+#include "libyuv.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/opt.h>
+}
+
+namespace tgcalls {
+
+namespace {
+
+// The QP thresholds webrtc's own H.264 encoder scales resolution at.
+constexpr int kLowH264QpThreshold = 24;
+constexpr int kHighH264QpThreshold = 37;
+
+// Encoders other than NVENC only take a bitrate when opened, so they are
+// reopened, which costs a keyframe, once the target is this far off, and
+// no more often than this.
+constexpr double kReopenBitrateRatio = 1.5;
+constexpr int64_t kMinReopenIntervalMs = 5000;
+
+// Frames handed to the encoder whose packets haven't come out yet.
+constexpr size_t kMaxPendingFrames = 16;
+
+// Frames of a simulcast stream queued or being encoded on its thread; one
+// more is dropped.
+constexpr int kMaxQueuedStreamFrames = 2;
+
+bool isPacketizationModeNonInterleaved(webrtc::SdpVideoFormat const &format) {
+    const auto it = format.parameters.find(cricket::kH264FmtpPacketizationMode);
+    return it != format.parameters.end() && it->second == "1";
+}
+
+webrtc::VideoCodecComplexity convertComplexity(GroupVideoEncoderConfig::Complexity complexity) {
+    switch (complexity) {
+        case GroupVideoEncoderConfig::Complexity::High:
+            return webrtc::VideoCodecComplexity::kComplexityHigh;
+        case GroupVideoEncoderConfig::Complexity::Higher:
+            return webrtc::VideoCodecComplexity::kComplexityHigher;
+        case GroupVideoEncoderConfig::Complexity::Max:
+            return webrtc::VideoCodecComplexity::kComplexityMax;
+        default:
+            return webrtc::VideoCodecComplexity::kComplexityNormal;
+    }
+}
+
+// H.264 on an FFmpeg encoder, for one stream; simulcast is left to
+// EncoderSimulcastProxy. Input goes in as I420 when the encoder takes
+// software frames, like NVENC, or is uploaded as NV12 to the device of
+// encoders that only take their own, like VAAPI.
+class FFmpegH264Encoder : public webrtc::VideoEncoder {
+public:
+    explicit FFmpegH264Encoder(GroupVideoEncoderConfig const &config) :
+    _config(config) {
+    }
+
+    ~FFmpegH264Encoder() override {
+        Release();
+    }
+
+    int InitEncode(const webrtc::VideoCodec *codecSettings, const webrtc::VideoEncoder::Settings &settings) override {
+        if (!codecSettings || codecSettings->codecType != webrtc::kVideoCodecH264 || codecSettings->width < 1 || codecSettings->height < 1) {
+            return WEBRTC_VIDEO_CODEC_ERR_PARAMETER;
+        }
+        if (codecSettings->numberOfSimulcastStreams > 1) {
+            return WEBRTC_VIDEO_CODEC_ERR_SIMULCAST_PARAMETERS_NOT_SUPPORTED;
+        }
+
+        Release();
+
+        _width = codecSettings->width;
+        _height = codecSettings->height;
+        _framerate = std::max(1, static_cast<int>(codecSettings->maxFramerate));
+        _bitrateBps = std::max(1, static_cast<int>(codecSettings->startBitrate)) * 1000;
+        _keyFrameInterval = codecSettings->H264().keyFrameInterval;
+
+        if (!open()) {
+            close();
+            return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+        }
+        return WEBRTC_VIDEO_CODEC_OK;
+    }
+
+    int32_t RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback *callback) override {
+        _callback = callback;
+        return WEBRTC_VIDEO_CODEC_OK;
+    }
+
+    int32_t Release() override {
+        close();
+        _pendingFrames.clear();
+        return WEBRTC_VIDEO_CODEC_OK;
+    }
+
+    int32_t Encode(const webrtc::VideoFrame &frame, const std::vector<webrtc::VideoFrameType> *frameTypes) override {
+        if (!_context || !_callback) {
+            return WEBRTC_VIDEO_CODEC_UNINITIALIZED;
+        }
+
+        bool isKeyFrame = false;
+        if (frameTypes) {
+            for (const auto frameType : *frameTypes) {
+                if (frameType == webrtc::VideoFrameType::kVideoFrameKey) {
+                    isKeyFrame = true;
+                }
+            }
+        }
+
+        if (needsReopen()) {
+            RTC_LOG(LS_INFO) << "FFmpegH264Encoder: reopening " << _config.hardwareEncoder << " at " << _bitrateBps << " bps";
+            close();
+            if (!open()) {
+                close();
+                return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+            }
+        }
+        if (_isFirstFrame) {
+            isKeyFrame = true;
+            _isFirstFrame = false;
+        }
+
+        rtc::scoped_refptr<webrtc::I420BufferInterface> buffer = frame.video_frame_buffer()->ToI420();
+        if (!buffer) {
+            return WEBRTC_VIDEO_CODEC_ERROR;
+        }
+        if (buffer->width() != _width || buffer->height() != _height) {
+            auto scaled = webrtc::I420Buffer::Create(_width, _height);
+            scaled->ScaleFrom(*buffer);
+            buffer = scaled;
+        }
+
+        AVFrame *input = fillInputFrame(*buffer);
+        if (!input) {
+            return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+        }
+        input->pts = _timestampUnwrapper.Unwrap(frame.timestamp());
+        input->pict_type = isKeyFrame ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+
+        PendingFrame pending;
+        pending.timestamp = frame.timestamp();
+        pending.ntpTimeMs = frame.ntp_time_ms();
+        pending.renderTimeMs = frame.render_time_ms();
+        pending.rotation = frame.rotation();
+        _pendingFrames[input->pts] = pending;
+        while (_pendingFrames.size() > kMaxPendingFrames) {
+            _pendingFrames.erase(_pendingFrames.begin());
+        }
+
+        int result = avcodec_send_frame(_context, input);
+        if (input == _hardwareFrame) {
+            av_frame_unref(_hardwareFrame);
+        }
+        if (result < 0) {
+            RTC_LOG(LS_ERROR) << "FFmpegH264Encoder: avcodec_send_frame failed: " << result;
+            return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+        }
+        return drainPackets();
+    }
+
+    void SetRates(const RateControlParameters &parameters) override {
+        if (parameters.framerate_fps >= 1.0) {
+            _framerate = static_cast<int>(parameters.framerate_fps + 0.5);
+        }
+        const auto bitrateBps = parameters.bitrate.get_sum_bps();
+        if (bitrateBps == 0) {
+            return;
+        }
+        _bitrateBps = static_cast<int>(bitrateBps);
+        if (_context) {
+            // Picked up from here by NVENC.
+            _context->bit_rate = _bitrateBps;
+            _context->rc_max_rate = _bitrateBps;
+        }
+    }
+
+    EncoderInfo GetEncoderInfo() const override {
+        EncoderInfo info;
+        info.supports_native_handle = false;
+        info.implementation_name = "FFmpeg " + _config.hardwareEncoder;
+        info.scaling_settings = VideoEncoder::ScalingSettings(kLowH264QpThreshold, kHighH264QpThreshold);
+        info.is_hardware_accelerated = true;
+        info.has_internal_source = false;
+        info.supports_simulcast = false;
+        info.preferred_pixel_formats = { webrtc::VideoFrameBuffer::Type::kI420 };
+        return info;
+    }
+
+private:
+    struct PendingFrame {
+        uint32_t timestamp = 0;
+        int64_t ntpTimeMs = 0;
+        int64_t renderTimeMs = 0;
+        webrtc::VideoRotation rotation = webrtc::kVideoRotation_0;
+    };
+
+    bool isNvenc() const {
+        return absl::StrContains(_config.hardwareEncoder, "nvenc");
+    }
+
+    bool needsReopen() const {
+        if (isNvenc() || _openedBitrateBps <= 0) {
+            return false;
+        }
+        const double ratio = static_cast<double>(std::max(_bitrateBps, _openedBitrateBps)) / std::min(_bitrateBps, _openedBitrateBps);
+        return ratio >= kReopenBitrateRatio && rtc::TimeMillis() - _openedAtMs >= kMinReopenIntervalMs;
+    }
+
+    bool open() {
+        const AVCodec *codec = avcodec_find_encoder_by_name(_config.hardwareEncoder.c_str());
+        if (!codec) {
+            RTC_LOG(LS_ERROR) << "FFmpegH264Encoder: no encoder named " << _config.hardwareEncoder;
+            return false;
+        }
+
+        _softwareFormat = AV_PIX_FMT_NONE;
+        for (auto format = codec->pix_fmts; format && *format != AV_PIX_FMT_NONE; format++) {
+            if (*format == AV_PIX_FMT_YUV420P) {
+                _softwareFormat = AV_PIX_FMT_YUV420P;
+                break;
+            } else if (*format == AV_PIX_FMT_NV12) {
+                _softwareFormat = AV_PIX_FMT_NV12;
+            }
+        }
+
+        AVHWDeviceType deviceType = AV_HWDEVICE_TYPE_NONE;
+        AVPixelFormat hardwareFormat = AV_PIX_FMT_NONE;
+        if (_softwareFormat == AV_PIX_FMT_NONE) {
+            for (int i = 0;; i++) {
+                const AVCodecHWConfig *hardwareConfig = avcodec_get_hw_config(codec, i);
+                if (!hardwareConfig) {
+                    break;
+                }
+                if (hardwareConfig->methods & AV_CODEC_HW_CONFIG_METHOD_HW_FRAMES_CTX) {
+                    deviceType = hardwareConfig->device_type;
+                    hardwareFormat = hardwareConfig->pix_fmt;
+                    break;
+                }
+            }
+            if (hardwareFormat == AV_PIX_FMT_NONE) {
+                RTC_LOG(LS_ERROR) << "FFmpegH264Encoder: " << _config.hardwareEncoder << " takes neither software nor device frames";
+                return false;
+            }
+        }
+
+        _context = avcodec_alloc_context3(codec);
+        if (!_context) {
+            return false;
+        }
+        _context->width = _width;
+        _context->height = _height;
+        _context->time_base = AVRational{ 1, cricket::kVideoCodecClockrate };
+        _context->framerate = AVRational{ _framerate, 1 };
+        _context->bit_rate = _bitrateBps;
+        _context->rc_max_rate = _bitrateBps;
+        _context->rc_buffer_size = _bitrateBps / 2;
+        // Keyframes come when webrtc asks for them.
+        _context->gop_size = _keyFrameInterval > 0 ? _keyFrameInterval : _framerate * 60;
+        _context->max_b_frames = 0;
+        _context->profile = FF_PROFILE_H264_CONSTRAINED_BASELINE;
+
+        if (hardwareFormat != AV_PIX_FMT_NONE) {
+            const char *device = _config.hardwareDevice.empty() ? nullptr : _config.hardwareDevice.c_str();
+            if (av_hwdevice_ctx_create(&_hardwareDevice, deviceType, device, nullptr, 0) < 0) {
+                RTC_LOG(LS_ERROR) << "FFmpegH264Encoder: could not open the device of " << _config.hardwareEncoder;
+                return false;
+            }
+            AVBufferRef *framesRef = av_hwframe_ctx_alloc(_hardwareDevice);
+            if (!framesRef) {
+                return false;
+            }
+            const auto frames = reinterpret_cast<AVHWFramesContext *>(framesRef->data);
+            frames->format = hardwareFormat;
+            frames->sw_format = AV_PIX_FMT_NV12;
+            frames->width = _width;
+            frames->height = _height;
+            frames->initial_pool_size = 4;
+            if (av_hwframe_ctx_init(framesRef) < 0) {
+                av_buffer_unref(&framesRef);
+                return false;
+            }
+            _context->pix_fmt = hardwareFormat;
+            _context->hw_frames_ctx = framesRef;
+        } else {
+            _context->pix_fmt = _softwareFormat;
+        }
+
+        // Low latency settings; options an encoder doesn't have are ignored.
+        AVDictionary *options = nullptr;
+        if (isNvenc()) {
+            av_dict_set(&options, "preset", "llhp", 0);
+            av_dict_set(&options, "rc", "cbr", 0);
+            av_dict_set(&options, "zerolatency", "1", 0);
+            av_dict_set(&options, "delay", "0", 0);
+            av_dict_set(&options, "forced-idr", "1", 0);
+        } else {
+            av_dict_set(&options, "async_depth", "1", 0);
+        }
+        const int result = avcodec_open2(_context, codec, &options);
+        av_dict_free(&options);
+        if (result < 0) {
+            RTC_LOG(LS_ERROR) << "FFmpegH264Encoder: could not open " << _config.hardwareEncoder << ": " << result;
+            return false;
+        }
+
+        // Uploads and I420 input are written here directly; NV12 for a
+        // software encoder is converted into it.
+        _frame = av_frame_alloc();
+        _packet = av_packet_alloc();
+        if (!_frame || !_packet) {
+            return false;
+        }
+        _frame->format = hardwareFormat != AV_PIX_FMT_NONE ? AV_PIX_FMT_NV12 : _softwareFormat;
+        _frame->width = _width;
+        _frame->height = _height;
+        if (av_frame_get_buffer(_frame, 0) < 0) {
+            return false;
+        }
+        if (hardwareFormat != AV_PIX_FMT_NONE) {
+            _hardwareFrame = av_frame_alloc();
+            if (!_hardwareFrame) {
+                return false;
+            }
+        }
+
+        RTC_LOG(LS_INFO) << "FFmpegH264Encoder: opened " << _config.hardwareEncoder << " for " << _width << "x" << _height << " at " << _bitrateBps << " bps";
+        _openedBitrateBps = _bitrateBps;
+        _openedAtMs = rtc::TimeMillis();
+        _isFirstFrame = true;
+        return true;
+    }
+
+    void close() {
+        if (_context) {
+            avcodec_free_context(&_context);
+        }
+        if (_hardwareDevice) {
+            av_buffer_unref(&_hardwareDevice);
+        }
+        if (_frame) {
+            av_frame_free(&_frame);
+        }
+        if (_hardwareFrame) {
+            av_frame_free(&_hardwareFrame);
+        }
+        if (_packet) {
+            av_packet_free(&_packet);
+        }
+        _openedBitrateBps = 0;
+    }
+
+    // Returns the frame to send, or null on failure.
+    AVFrame *fillInputFrame(webrtc::I420BufferInterface const &buffer) {
+        // The encoder may still hold the last one.
+        if (av_frame_make_writable(_frame) < 0) {
+            return nullptr;
+        }
+        if (_frame->format == AV_PIX_FMT_YUV420P) {
+            libyuv::I420Copy(
+                buffer.DataY(), buffer.StrideY(), buffer.DataU(), buffer.StrideU(), buffer.DataV(), buffer.StrideV(),
+                _frame->data[0], _frame->linesize[0], _frame->data[1], _frame->linesize[1], _frame->data[2], _frame->linesize[2],
+                _width, _height);
+        } else {
+            libyuv::I420ToNV12(
+                buffer.DataY(), buffer.StrideY(), buffer.DataU(), buffer.StrideU(), buffer.DataV(), buffer.StrideV(),
+                _frame->data[0], _frame->linesize[0], _frame->data[1], _frame->linesize[1],
+                _width, _height);
+        }
+        if (!_hardwareFrame) {
+            return _frame;
+        }
+
+        if (av_hwframe_get_buffer(_context->hw_frames_ctx, _hardwareFrame, 0) < 0) {
+            return nullptr;
+        }
+        if (av_hwframe_transfer_data(_hardwareFrame, _frame, 0) < 0) {
+            av_frame_unref(_hardwareFrame);
+            return nullptr;
+        }
+        return _hardwareFrame;
+    }
+
+    int32_t drainPackets() {
+        while (true) {
+            const int result = avcodec_receive_packet(_context, _packet);
+            if (result == AVERROR(EAGAIN) || result == AVERROR_EOF) {
+                return WEBRTC_VIDEO_CODEC_OK;
+            } else if (result < 0) {
+                RTC_LOG(LS_ERROR) << "FFmpegH264Encoder: avcodec_receive_packet failed: " << result;
+                return WEBRTC_VIDEO_CODEC_FALLBACK_SOFTWARE;
+            }
+
+            webrtc::EncodedImage image;
+            image.SetEncodedData(webrtc::EncodedImageBuffer::Create(_packet->data, _packet->size));
+            image._encodedWidth = _width;
+            image._encodedHeight = _height;
+            const auto pending = _pendingFrames.find(_packet->pts);
+            if (pending != _pendingFrames.end()) {
+                image.SetTimestamp(pending->second.timestamp);
+                image.ntp_time_ms_ = pending->second.ntpTimeMs;
+                image.capture_time_ms_ = pending->second.renderTimeMs;
+                image.rotation_ = pending->second.rotation;
+                _pendingFrames.erase(_pendingFrames.begin(), std::next(pending));
+            }
+            const bool isKeyFrame = (_packet->flags & AV_PKT_FLAG_KEY) != 0;
+            image._frameType = isKeyFrame ? webrtc::VideoFrameType::kVideoFrameKey : webrtc::VideoFrameType::kVideoFrameDelta;
+            av_packet_unref(_packet);
+
+            _bitstreamParser.ParseBitstream(rtc::ArrayView<const uint8_t>(image.data(), image.size()));
+            image.qp_ = _bitstreamParser.GetLastSliceQp().value_or(-1);
+
+            webrtc::CodecSpecificInfo codecSpecific;
+            codecSpecific.codecType = webrtc::kVideoCodecH264;
+            codecSpecific.codecSpecific.H264.packetization_mode = webrtc::H264PacketizationMode::NonInterleaved;
+            codecSpecific.codecSpecific.H264.temporal_idx = webrtc::kNoTemporalIdx;
+            codecSpecific.codecSpecific.H264.idr_frame = isKeyFrame;
+            codecSpecific.codecSpecific.H264.base_layer_sync = false;
+
+            _callback->OnEncodedImage(image, &codecSpecific);
+        }
+    }
+
+    GroupVideoEncoderConfig _config;
+    webrtc::EncodedImageCallback *_callback = nullptr;
+
+    int _width = 0;
+    int _height = 0;
+    int _framerate = 30;
+    int _bitrateBps = 0;
+    int _keyFrameInterval = 0;
+    int _openedBitrateBps = 0;
+    int64_t _openedAtMs = 0;
+    bool _isFirstFrame = true;
+
+    AVCodecContext *_context = nullptr;
+    AVBufferRef *_hardwareDevice = nullptr;
+    AVPixelFormat _softwareFormat = AV_PIX_FMT_NONE;
+    AVFrame *_frame = nullptr;
+    AVFrame *_hardwareFrame = nullptr;
+    AVPacket *_packet = nullptr;
+
+    webrtc::TimestampUnwrapper _timestampUnwrapper;
+    std::map<int64_t, PendingFrame> _pendingFrames;
+    webrtc::H264BitstreamParser _bitstreamParser;
+};
+
+class FFmpegH264EncoderFactory : public webrtc::VideoEncoderFactory {
+public:
+    explicit FFmpegH264EncoderFactory(GroupVideoEncoderConfig const &config) :
+    _config(config) {
+    }
+
+    std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+        return { webrtc::CreateH264Format(webrtc::H264::kProfileConstrainedBaseline, webrtc::H264::kLevel3_1, "1") };
+    }
+
+    std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(const webrtc::SdpVideoFormat &format) override {
+        return std::make_unique<FFmpegH264Encoder>(_config);
+    }
+
+private:
+    GroupVideoEncoderConfig _config;
+};
+
+// Caps the threads of a software encoder and sets its complexity.
+class ConfiguredVideoEncoder : public webrtc::VideoEncoder {
+public:
+    ConfiguredVideoEncoder(std::unique_ptr<webrtc::VideoEncoder> encoder, GroupVideoEncoderConfig const &config) :
+    _encoder(std::move(encoder)),
+    _config(config) {
+    }
+
+    void SetFecControllerOverride(webrtc::FecControllerOverride *fecControllerOverride) override {
+        _encoder->SetFecControllerOverride(fecControllerOverride);
+    }
+
+    int InitEncode(const webrtc::VideoCodec *codecSettings, const webrtc::VideoEncoder::Settings &settings) override {
+        if (!codecSettings) {
+            return _encoder->InitEncode(codecSettings, settings);
+        }
+        webrtc::VideoCodec codec = *codecSettings;
+        const auto complexity = convertComplexity(_config.complexity);
+        if (codec.codecType == webrtc::kVideoCodecVP8) {
+            codec.VP8()->complexity = complexity;
+        } else if (codec.codecType == webrtc::kVideoCodecVP9) {
+            codec.VP9()->complexity = complexity;
+        }
+        int numberOfCores = settings.number_of_cores;
+        if (_config.maxThreads > 0) {
+            numberOfCores = std::min(numberOfCores, _config.maxThreads);
+        }
+        return _encoder->InitEncode(&codec, webrtc::VideoEncoder::Settings(settings.capabilities, numberOfCores, settings.max_payload_size));
+    }
+
+    int32_t RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback *callback) override {
+        return _encoder->RegisterEncodeCompleteCallback(callback);
+    }
+
+    int32_t Release() override {
+        return _encoder->Release();
+    }
+
+    int32_t Encode(const webrtc::VideoFrame &frame, const std::vector<webrtc::VideoFrameType> *frameTypes) override {
+        return _encoder->Encode(frame, frameTypes);
+    }
+
+    void SetRates(const RateControlParameters &parameters) override {
+        _encoder->SetRates(parameters);
+    }
+
+    void OnPacketLossRateUpdate(float packetLossRate) override {
+        _encoder->OnPacketLossRateUpdate(packetLossRate);
+    }
+
+    void OnRttUpdate(int64_t rttMs) override {
+        _encoder->OnRttUpdate(rttMs);
+    }
+
+    void OnLossNotification(const LossNotification &lossNotification) override {
+        _encoder->OnLossNotification(lossNotification);
+    }
+
+    EncoderInfo GetEncoderInfo() const override {
+        return _encoder->GetEncoderInfo();
+    }
+
+private:
+    std::unique_ptr<webrtc::VideoEncoder> _encoder;
+    GroupVideoEncoderConfig _config;
+};
+
+class GroupVideoEncoderFactory : public webrtc::VideoEncoderFactory {
+public:
+    GroupVideoEncoderFactory(std::unique_ptr<webrtc::VideoEncoderFactory> factory, GroupVideoEncoderConfig const &config) :
+    _factory(std::move(factory)),
+    _config(config) {
+        if (!_config.hardwareEncoder.empty()) {
+            if (avcodec_find_encoder_by_name(_config.hardwareEncoder.c_str())) {
+                _hardwareFactory = std::make_unique<FFmpegH264EncoderFactory>(_config);
+            } else {
+                RTC_LOG(LS_WARNING) << "GroupVideoEncoderFactory: FFmpeg has no encoder named " << _config.hardwareEncoder;
+            }
+        }
+    }
+
+    std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+        auto formats = _factory->GetSupportedFormats();
+        if (_hardwareFactory && !hasSoftwareH264()) {
+            for (auto &format : _hardwareFactory->GetSupportedFormats()) {
+                formats.push_back(std::move(format));
+            }
+        }
+        return formats;
+    }
+
+    std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(const webrtc::SdpVideoFormat &format) override {
+        if (_hardwareFactory && absl::EqualsIgnoreCase(format.name, cricket::kH264CodecName) && isPacketizationModeNonInterleaved(format)) {
+            std::unique_ptr<webrtc::VideoEncoder> hardware = std::make_unique<webrtc::EncoderSimulcastProxy>(_hardwareFactory.get(), format);
+            if (!hasSoftwareH264()) {
+                return hardware;
+            }
+            return webrtc::CreateVideoEncoderSoftwareFallbackWrapper(createSoftwareEncoder(format), std::move(hardware));
+        }
+        return createSoftwareEncoder(format);
+    }
+
+    std::unique_ptr<webrtc::VideoEncoderFactory::EncoderSelectorInterface> GetEncoderSelector() const override {
+        return _factory->GetEncoderSelector();
+    }
+
+private:
+    bool hasSoftwareH264() const {
+        for (const auto &format : _factory->GetSupportedFormats()) {
+            if (absl::EqualsIgnoreCase(format.name, cricket::kH264CodecName)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::unique_ptr<webrtc::VideoEncoder> createSoftwareEncoder(const webrtc::SdpVideoFormat &format) {
+        auto encoder = _factory->CreateVideoEncoder(format);
+        if (!encoder) {
+            return nullptr;
+        }
+        return std::make_unique<ConfiguredVideoEncoder>(std::move(encoder), _config);
+    }
+
+    std::unique_ptr<webrtc::VideoEncoderFactory> _factory;
+    GroupVideoEncoderConfig _config;
+    std::unique_ptr<FFmpegH264EncoderFactory> _hardwareFactory;
+};
+
+// The encoder of one simulcast stream, run on a thread of its own, so that
+// the streams SimulcastEncoderAdapter splits a frame into are encoded at the
+// same time instead of one after another on the encoder thread. Encode()
+// only queues the frame, and encoded images come from the stream's thread,
+// as they do from hardware encoders. Errors are returned by the next
+// Encode(). A frame coming while the stream is kMaxQueuedStreamFrames behind
+// is dropped, and a key frame asked for with it goes to the next one.
+class ParallelStreamEncoder : public webrtc::VideoEncoder {
+public:
+    ParallelStreamEncoder(std::unique_ptr<webrtc::VideoEncoder> encoder, webrtc::TaskQueueFactory *taskQueueFactory) :
+    _encoder(std::move(encoder)),
+    _info(streamInfo(*_encoder)),
+    _queue(taskQueueFactory->CreateTaskQueue("SimulcastStream", webrtc::TaskQueueFactory::Priority::HIGH)) {
+    }
+
+    void SetFecControllerOverride(webrtc::FecControllerOverride *fecControllerOverride) override {
+        _queue.PostTask([this, fecControllerOverride] {
+            _encoder->SetFecControllerOverride(fecControllerOverride);
+        });
+    }
+
+    int InitEncode(const webrtc::VideoCodec *codecSettings, const webrtc::VideoEncoder::Settings &settings) override {
+        // Has SimulcastEncoderAdapter create one of these per stream.
+        if (codecSettings && codecSettings->numberOfSimulcastStreams > 1) {
+            return WEBRTC_VIDEO_CODEC_ERR_SIMULCAST_PARAMETERS_NOT_SUPPORTED;
+        }
+        return invoke([&] {
+            const auto result = _encoder->InitEncode(codecSettings, settings);
+            updateInfo();
+            return result;
+        });
+    }
+
+    int32_t RegisterEncodeCompleteCallback(webrtc::EncodedImageCallback *callback) override {
+        _callback = callback;
+        return invoke([&] {
+            return _encoder->RegisterEncodeCompleteCallback(callback);
+        });
+    }
+
+    int32_t Release() override {
+        const auto result = invoke([&] {
+            return _encoder->Release();
+        });
+        _lastError = WEBRTC_VIDEO_CODEC_OK;
+        _isKeyFrameRequested = false;
+        return result;
+    }
+
+    int32_t Encode(const webrtc::VideoFrame &frame, const std::vector<webrtc::VideoFrameType> *frameTypes) override {
+        const auto lastError = _lastError.exchange(WEBRTC_VIDEO_CODEC_OK);
+        if (lastError != WEBRTC_VIDEO_CODEC_OK) {
+            return lastError;
+        }
+
+        std::vector<webrtc::VideoFrameType> types;
+        if (frameTypes) {
+            types = *frameTypes;
+        }
+        const auto isKeyFrame = _isKeyFrameRequested || std::find(types.begin(), types.end(), webrtc::VideoFrameType::kVideoFrameKey) != types.end();
+        if (_queuedFrames.load() >= kMaxQueuedStreamFrames) {
+            _isKeyFrameRequested = isKeyFrame;
+            if (_callback) {
+                _callback->OnDroppedFrame(webrtc::EncodedImageCallback::DropReason::kDroppedByEncoder);
+            }
+            return WEBRTC_VIDEO_CODEC_OK;
+        }
+        _isKeyFrameRequested = false;
+        if (isKeyFrame) {
+            types.resize(std::max(types.size(), size_t(1)));
+            std::fill(types.begin(), types.end(), webrtc::VideoFrameType::kVideoFrameKey);
+        }
+
+        _queuedFrames++;
+        _queue.PostTask([this, frame, types = std::move(types)] {
+            const auto result = _encoder->Encode(frame, types.empty() ? nullptr : &types);
+            if (result != WEBRTC_VIDEO_CODEC_OK) {
+                _lastError = result;
+            }
+            updateInfo();
+            _queuedFrames--;
+        });
+        return WEBRTC_VIDEO_CODEC_OK;
+    }
+
+    void SetRates(const RateControlParameters &parameters) override {
+        _queue.PostTask([this, parameters] {
+            _encoder->SetRates(parameters);
+        });
+    }
+
+    void OnPacketLossRateUpdate(float packetLossRate) override {
+        _queue.PostTask([this, packetLossRate] {
+            _encoder->OnPacketLossRateUpdate(packetLossRate);
+        });
+    }
+
+    void OnRttUpdate(int64_t rttMs) override {
+        _queue.PostTask([this, rttMs] {
+            _encoder->OnRttUpdate(rttMs);
+        });
+    }
+
+    void OnLossNotification(const LossNotification &lossNotification) override {
+        _queue.PostTask([this, lossNotification] {
+            _encoder->OnLossNotification(lossNotification);
+        });
+    }
+
+    EncoderInfo GetEncoderInfo() const override {
+        std::unique_lock<std::mutex> lock(_infoMutex);
+        return _info;
+    }
+
+private:
+    static EncoderInfo streamInfo(webrtc::VideoEncoder const &encoder) {
+        auto info = encoder.GetEncoderInfo();
+        info.supports_simulcast = false;
+        return info;
+    }
+
+    // Stream thread. Kept for GetEncoderInfo(), which the encoder thread
+    // calls while |_encoder| may be encoding.
+    void updateInfo() {
+        auto info = streamInfo(*_encoder);
+        std::unique_lock<std::mutex> lock(_infoMutex);
+        _info = std::move(info);
+    }
+
+    template <typename Functor>
+    int32_t invoke(Functor &&functor) {
+        int32_t result = WEBRTC_VIDEO_CODEC_OK;
+        rtc::Event done;
+        _queue.PostTask([&] {
+            result = functor();
+            done.Set();
+        });
+        done.Wait(rtc::Event::kForever);
+        return result;
+    }
+
+    std::unique_ptr<webrtc::VideoEncoder> _encoder;
+    mutable std::mutex _infoMutex;
+    EncoderInfo _info;
+
+    // Encoder thread.
+    webrtc::EncodedImageCallback *_callback = nullptr;
+    bool _isKeyFrameRequested = false;
+
+    std::atomic<int> _queuedFrames{ 0 };
+    std::atomic<int32_t> _lastError{ WEBRTC_VIDEO_CODEC_OK };
+
+    // Last, so that it stops before |_encoder| is destroyed.
+    rtc::TaskQueue _queue;
+};
+
+// Encodes the simulcast streams of |factory|'s encoders in parallel, each
+// by one of them on a ParallelStreamEncoder, including codecs whose encoder
+// does simulcast itself, like libvpx's VP8, one stream after another.
+class ParallelSimulcastEncoderFactory : public webrtc::VideoEncoderFactory {
+public:
+    explicit ParallelSimulcastEncoderFactory(std::unique_ptr<webrtc::VideoEncoderFactory> factory) :
+    _factory(std::move(factory)),
+    _taskQueueFactory(webrtc::CreateDefaultTaskQueueFactory()),
+    _streamFactory(_factory.get(), _taskQueueFactory.get()) {
+    }
+
+    std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+        return _factory->GetSupportedFormats();
+    }
+
+    std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(const webrtc::SdpVideoFormat &format) override {
+        if (!isSupported(format)) {
+            return nullptr;
+        }
+        return std::make_unique<webrtc::EncoderSimulcastProxy>(&_streamFactory, format);
+    }
+
+    std::unique_ptr<webrtc::VideoEncoderFactory::EncoderSelectorInterface> GetEncoderSelector() const override {
+        return _factory->GetEncoderSelector();
+    }
+
+private:
+    class StreamFactory : public webrtc::VideoEncoderFactory {
+    public:
+        StreamFactory(webrtc::VideoEncoderFactory *factory, webrtc::TaskQueueFactory *taskQueueFactory) :
+        _factory(factory),
+        _taskQueueFactory(taskQueueFactory) {
+        }
+
+        std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+            return _factory->GetSupportedFormats();
+        }
+
+        std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(const webrtc::SdpVideoFormat &format) override {
+            auto encoder = _factory->CreateVideoEncoder(format);
+            if (!encoder) {
+                return nullptr;
+            }
+            return std::make_unique<ParallelStreamEncoder>(std::move(encoder), _taskQueueFactory);
+        }
+
+    private:
+        webrtc::VideoEncoderFactory *_factory = nullptr;
+        webrtc::TaskQueueFactory *_taskQueueFactory = nullptr;
+    };
+
+    bool isSupported(const webrtc::SdpVideoFormat &format) const {
+        for (const auto &supported : _factory->GetSupportedFormats()) {
+            if (cricket::IsSameCodec(format.name, format.parameters, supported.name, supported.parameters)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::unique_ptr<webrtc::VideoEncoderFactory> _factory;
+    std::unique_ptr<webrtc::TaskQueueFactory> _taskQueueFactory;
+    StreamFactory _streamFactory;
+};
+
+} // namespace
+
+std::unique_ptr<webrtc::VideoEncoderFactory> makeGroupVideoEncoderFactory(std::unique_ptr<webrtc::VideoEncoderFactory> factory, GroupVideoEncoderConfig const &config) {
+    if (!factory || config.isDefault()) {
+        return factory;
+    }
+    if (!config.isDefaultEncoder()) {
+        factory = std::make_unique<GroupVideoEncoderFactory>(std::move(factory), config);
+    }
+    if (config.parallelSimulcast) {
+        factory = std::make_unique<ParallelSimulcastEncoderFactory>(std::move(factory));
+    }
+    return factory;
+}
+
+} // namespace tgcalls
@@ -0,0 +1,22 @@
+#ifndef TGCALLS_GROUP_VIDEO_ENCODER_FACTORY_H
+#define TGCALLS_GROUP_VIDEO_ENCODER_FACTORY_H
+
+#include <memory>
+
+#include "api/video_codecs/video_encoder_factory.h"
+
+#include "GroupInstanceImpl.h"
+
+namespace tgcalls {
+
+// Applies |config| to the encoders of |factory|: H.264 goes to the FFmpeg
+// hardware encoder it names, with |factory|'s own H.264 encoder, if any, as
+// the fallback for when it fails, and every software encoder gets the
+// thread and complexity limits. With |parallelSimulcast|, the simulcast
+// streams of every encoder are encoded in parallel, each on its own thread.
+// A default config returns |factory| as is.
+std::unique_ptr<webrtc::VideoEncoderFactory> makeGroupVideoEncoderFactory(std::unique_ptr<webrtc::VideoEncoderFactory> factory, GroupVideoEncoderConfig const &config);
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,567 @@
+#include "group/JsonStream.h"
+
+#include <cstdlib>
+#include <limits>
+
+namespace tgcalls {
+
+namespace {
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool ReadHex4(absl::string_view string, size_t position, uint32_t &value) {
+    if (position + 4 > string.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = position; i < position + 4; i++) {
+        const auto c = string[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= uint32_t(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            value |= uint32_t(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            value |= uint32_t(c - 'A' + 10);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void AppendUtf8(std::string &to, uint32_t codePoint) {
+    if (codePoint < 0x80) {
+        to.push_back(char(codePoint));
+    } else if (codePoint < 0x800) {
+        to.push_back(char(0xC0 | (codePoint >> 6)));
+        to.push_back(char(0x80 | (codePoint & 0x3F)));
+    } else if (codePoint < 0x10000) {
+        to.push_back(char(0xE0 | (codePoint >> 12)));
+        to.push_back(char(0x80 | ((codePoint >> 6) & 0x3F)));
+        to.push_back(char(0x80 | (codePoint & 0x3F)));
+    } else {
+        to.push_back(char(0xF0 | (codePoint >> 18)));
+        to.push_back(char(0x80 | ((codePoint >> 12) & 0x3F)));
+        to.push_back(char(0x80 | ((codePoint >> 6) & 0x3F)));
+        to.push_back(char(0x80 | (codePoint & 0x3F)));
+    }
+}
+
+double ParseDouble(absl::string_view token) {
+    // strtod() needs a terminated string; numbers longer than this are
+    // rare enough to pay for an allocation.
+    char buffer[64];
+    if (token.size() < sizeof(buffer)) {
+        token.copy(buffer, token.size());
+        buffer[token.size()] = 0;
+        return strtod(buffer, nullptr);
+    }
+    return strtod(std::string(token).c_str(), nullptr);
+}
+
+} // namespace
+
+JsonReader::JsonReader(absl::string_view json) :
+_json(json) {
+}
+
+bool JsonReader::fail() {
+    _failed = true;
+    return false;
+}
+
+void JsonReader::skipWhitespace() {
+    while (_position < _json.size()) {
+        const auto c = _json[_position];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            break;
+        }
+        _position++;
+    }
+}
+
+bool JsonReader::consume(char c) {
+    if (_position < _json.size() && _json[_position] == c) {
+        _position++;
+        return true;
+    }
+    return false;
+}
+
+bool JsonReader::consumeLiteral(absl::string_view literal) {
+    if (_json.substr(_position, literal.size()) == literal) {
+        _position += literal.size();
+        return true;
+    }
+    return false;
+}
+
+JsonReader::Type JsonReader::type() {
+    if (_failed) {
+        return Type::Invalid;
+    }
+    skipWhitespace();
+    if (_position >= _json.size()) {
+        return Type::Invalid;
+    }
+    const auto c = _json[_position];
+    switch (c) {
+        case '{':
+            return Type::Object;
+        case '[':
+            return Type::Array;
+        case '"':
+            return Type::String;
+        case 't':
+        case 'f':
+            return Type::Bool;
+        case 'n':
+            return Type::Null;
+        default:
+            return (c == '-' || IsDigit(c)) ? Type::Number : Type::Invalid;
+    }
+}
+
+bool JsonReader::finish() {
+    if (_failed) {
+        return false;
+    }
+    skipWhitespace();
+    return _depth == 0 && _position == _json.size();
+}
+
+bool JsonReader::beginContainer(char open) {
+    if (_failed) {
+        return false;
+    }
+    skipWhitespace();
+    if (!consume(open) || _depth >= kMaxDepth) {
+        return fail();
+    }
+    _depth++;
+    return true;
+}
+
+bool JsonReader::nextMember(bool first, absl::string_view &key) {
+    if (_failed) {
+        return false;
+    }
+    skipWhitespace();
+    if (consume('}')) {
+        _depth--;
+        return false;
+    }
+    if (!first && !consume(',')) {
+        return fail();
+    }
+    if (!readStringInto(key, _keyScratch)) {
+        return false;
+    }
+    skipWhitespace();
+    if (!consume(':')) {
+        return fail();
+    }
+    return true;
+}
+
+bool JsonReader::nextItem(bool first) {
+    if (_failed) {
+        return false;
+    }
+    skipWhitespace();
+    if (consume(']')) {
+        _depth--;
+        return false;
+    }
+    if (!first && !consume(',')) {
+        return fail();
+    }
+    return true;
+}
+
+bool JsonReader::scanString(absl::string_view &raw, bool &hasEscapes) {
+    if (_failed) {
+        return false;
+    }
+    skipWhitespace();
+    if (!consume('"')) {
+        return fail();
+    }
+    const auto start = _position;
+    hasEscapes = false;
+    while (_position < _json.size()) {
+        const auto c = uint8_t(_json[_position]);
+        if (c == '"') {
+            raw = _json.substr(start, _position - start);
+            _position++;
+            return true;
+        } else if (c < 0x20) {
+            return fail();
+        } else if (c == '\\') {
+            hasEscapes = true;
+            _position += 2;
+        } else {
+            _position++;
+        }
+    }
+    return fail();
+}
+
+bool JsonReader::decodeString(absl::string_view raw, std::string &to) {
+    to.clear();
+    for (size_t i = 0; i < raw.size(); i++) {
+        if (raw[i] != '\\') {
+            to.push_back(raw[i]);
+            continue;
+        }
+        if (++i >= raw.size()) {
+            return fail();
+        }
+        switch (raw[i]) {
+            case '"':
+            case '\\':
+            case '/':
+                to.push_back(raw[i]);
+                break;
+            case 'b':
+                to.push_back('\b');
+                break;
+            case 'f':
+                to.push_back('\f');
+                break;
+            case 'n':
+                to.push_back('\n');
+                break;
+            case 'r':
+                to.push_back('\r');
+                break;
+            case 't':
+                to.push_back('\t');
+                break;
+            case 'u': {
+                uint32_t codePoint = 0;
+                if (!ReadHex4(raw, i + 1, codePoint)) {
+                    return fail();
+                }
+                i += 4;
+                uint32_t low = 0;
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF
+                    && i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u'
+                    && ReadHex4(raw, i + 3, low) && low >= 0xDC00 && low <= 0xDFFF) {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+                AppendUtf8(to, codePoint);
+                break;
+            }
+            default:
+                return fail();
+        }
+    }
+    return true;
+}
+
+bool JsonReader::readStringInto(absl::string_view &value, std::string &scratch) {
+    absl::string_view raw;
+    auto hasEscapes = false;
+    if (!scanString(raw, hasEscapes)) {
+        return false;
+    }
+    if (!hasEscapes) {
+        value = raw;
+        return true;
+    }
+    if (!decodeString(raw, scratch)) {
+        return false;
+    }
+    value = scratch;
+    return true;
+}
+
+bool JsonReader::readString(absl::string_view &value) {
+    return readStringInto(value, _valueScratch);
+}
+
+bool JsonReader::readString(std::string &value) {
+    absl::string_view raw;
+    auto hasEscapes = false;
+    if (!scanString(raw, hasEscapes)) {
+        return false;
+    }
+    if (!hasEscapes) {
+        value.assign(raw.data(), raw.size());
+        return true;
+    }
+    return decodeString(raw, value);
+}
+
+bool JsonReader::scanNumber(absl::string_view &token, bool &isInteger) {
+    if (_failed) {
+        return false;
+    }
+    skipWhitespace();
+    const auto start = _position;
+    const auto digitAt = [&] {
+        return _position < _json.size() && IsDigit(_json[_position]);
+    };
+    const auto skipDigits = [&] {
+        while (digitAt()) {
+            _position++;
+        }
+    };
+
+    isInteger = true;
+    consume('-');
+    if (!consume('0')) {
+        if (!digitAt()) {
+            return fail();
+        }
+        skipDigits();
+    }
+    if (consume('.')) {
+        isInteger = false;
+        if (!digitAt()) {
+            return fail();
+        }
+        skipDigits();
+    }
+    if (consume('e') || consume('E')) {
+        isInteger = false;
+        if (!consume('+')) {
+            consume('-');
+        }
+        if (!digitAt()) {
+            return fail();
+        }
+        skipDigits();
+    }
+    token = _json.substr(start, _position - start);
+    return true;
+}
+
+bool JsonReader::readNumber(double &value) {
+    absl::string_view token;
+    auto isInteger = false;
+    if (!scanNumber(token, isInteger)) {
+        return false;
+    }
+    value = ParseDouble(token);
+    return true;
+}
+
+bool JsonReader::readInt(int64_t &value) {
+    absl::string_view token;
+    auto isInteger = false;
+    if (!scanNumber(token, isInteger)) {
+        return false;
+    }
+    const auto negative = (token[0] == '-');
+    const auto digits = token.size() - (negative ? 1 : 0);
+    if (isInteger && digits <= 18) {
+        int64_t result = 0;
+        for (size_t i = negative ? 1 : 0; i < token.size(); i++) {
+            result = result * 10 + (token[i] - '0');
+        }
+        value = negative ? -result : result;
+        return true;
+    }
+    const auto parsed = ParseDouble(token);
+    if (parsed >= double(std::numeric_limits<int64_t>::max())) {
+        value = std::numeric_limits<int64_t>::max();
+    } else if (parsed <= double(std::numeric_limits<int64_t>::min())) {
+        value = std::numeric_limits<int64_t>::min();
+    } else {
+        value = int64_t(parsed);
+    }
+    return true;
+}
+
+bool JsonReader::readInt(int32_t &value) {
+    int64_t wide = 0;
+    if (!readInt(wide)) {
+        return false;
+    }
+    // SSRCs come as either signed or unsigned 32-bit numbers; both wrap to
+    // the same bits.
+    value = int32_t(uint32_t(wide));
+    return true;
+}
+
+bool JsonReader::readBool(bool &value) {
+    if (_failed) {
+        return false;
+    }
+    skipWhitespace();
+    if (consumeLiteral("true")) {
+        value = true;
+    } else if (consumeLiteral("false")) {
+        value = false;
+    } else {
+        return fail();
+    }
+    return true;
+}
+
+void JsonReader::skipValue() {
+    switch (type()) {
+        case Type::Object: {
+            readObject([this](absl::string_view) {
+                skipValue();
+            });
+            break;
+        }
+        case Type::Array: {
+            readArray([this]() {
+                skipValue();
+            });
+            break;
+        }
+        case Type::String: {
+            absl::string_view raw;
+            auto hasEscapes = false;
+            scanString(raw, hasEscapes);
+            break;
+        }
+        case Type::Number: {
+            absl::string_view token;
+            auto isInteger = false;
+            scanNumber(token, isInteger);
+            break;
+        }
+        case Type::Bool: {
+            auto value = false;
+            readBool(value);
+            break;
+        }
+        case Type::Null: {
+            if (!consumeLiteral("null")) {
+                fail();
+            }
+            break;
+        }
+        default: {
+            fail();
+            break;
+        }
+    }
+}
+
+JsonWriter::JsonWriter(std::string &out) :
+_out(out) {
+}
+
+void JsonWriter::separate() {
+    if (_needsComma) {
+        _out.push_back(',');
+    }
+}
+
+void JsonWriter::beginObject() {
+    separate();
+    _out.push_back('{');
+    _needsComma = false;
+}
+
+void JsonWriter::endObject() {
+    _out.push_back('}');
+    _needsComma = true;
+}
+
+void JsonWriter::beginArray() {
+    separate();
+    _out.push_back('[');
+    _needsComma = false;
+}
+
+void JsonWriter::endArray() {
+    _out.push_back(']');
+    _needsComma = true;
+}
+
+void JsonWriter::key(absl::string_view key) {
+    separate();
+    appendString(key);
+    _out.push_back(':');
+    _needsComma = false;
+}
+
+void JsonWriter::stringValue(absl::string_view value) {
+    separate();
+    appendString(value);
+    _needsComma = true;
+}
+
+void JsonWriter::intValue(int64_t value) {
+    separate();
+    char buffer[24];
+    auto end = buffer + sizeof(buffer);
+    auto begin = end;
+    auto magnitude = value < 0 ? uint64_t(0) - uint64_t(value) : uint64_t(value);
+    do {
+        *--begin = char('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) {
+        *--begin = '-';
+    }
+    _out.append(begin, end);
+    _needsComma = true;
+}
+
+void JsonWriter::boolValue(bool value) {
+    separate();
+    _out.append(value ? "true" : "false");
+    _needsComma = true;
+}
+
+void JsonWriter::nullValue() {
+    separate();
+    _out.append("null");
+    _needsComma = true;
+}
+
+void JsonWriter::appendString(absl::string_view value) {
+    static constexpr char kHex[] = "0123456789abcdef";
+
+    _out.push_back('"');
+    for (const auto c : value) {
+        switch (c) {
+            case '"':
+                _out.append("\\\"");
+                break;
+            case '\\':
+                _out.append("\\\\");
+                break;
+            case '\b':
+                _out.append("\\b");
+                break;
+            case '\f':
+                _out.append("\\f");
+                break;
+            case '\n':
+                _out.append("\\n");
+                break;
+            case '\r':
+                _out.append("\\r");
+                break;
+            case '\t':
+                _out.append("\\t");
+                break;
+            default:
+                if (uint8_t(c) < 0x20) {
+                    _out.append("\\u00");
+                    _out.push_back(kHex[uint8_t(c) >> 4]);
+                    _out.push_back(kHex[uint8_t(c) & 0xF]);
+                } else {
+                    _out.push_back(c);
+                }
+                break;
+        }
+    }
+    _out.push_back('"');
+}
+
+} // namespace tgcalls
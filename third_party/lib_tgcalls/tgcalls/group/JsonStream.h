@@ -0,0 +1,136 @@
+#ifndef TGCALLS_JSON_STREAM_H
+#define TGCALLS_JSON_STREAM_H
+
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace tgcalls {
+
+// Pull parser for the JSON of colibri data channel messages and join
+// payloads. Values are read straight off the input as the caller walks
+// it, without building a document, and strings without escapes are
+// handed out as views into the input.
+//
+// Objects and arrays are walked with callbacks, which must read or skip
+// exactly one value each time they are called. A key is only valid until
+// its value is read:
+//
+//     reader.readObject([&](absl::string_view key) {
+//         if (key == "idealHeight" && reader.type() == JsonReader::Type::Number) {
+//             reader.readInt(idealHeight);
+//         } else {
+//             reader.skipValue();
+//         }
+//     });
+//
+// The first error stops the reader: ok() turns false and every later read
+// fails without looking at the input.
+class JsonReader {
+public:
+    enum class Type {
+        Invalid,
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    explicit JsonReader(absl::string_view json);
+
+    // Kind of the value at the cursor, Invalid after an error.
+    Type type();
+
+    bool ok() const {
+        return !_failed;
+    }
+
+    // Whether only whitespace is left, so the input was exactly one value.
+    bool finish();
+
+    template <typename OnMember>
+    void readObject(OnMember &&onMember) {
+        if (!beginContainer('{')) {
+            return;
+        }
+        absl::string_view key;
+        for (bool first = true; nextMember(first, key); first = false) {
+            onMember(key);
+        }
+    }
+
+    template <typename OnItem>
+    void readArray(OnItem &&onItem) {
+        if (!beginContainer('[')) {
+            return;
+        }
+        for (bool first = true; nextItem(first); first = false) {
+            onItem();
+        }
+    }
+
+    // The view points into the input, or into a buffer of the reader if
+    // the string had escapes; it is valid until the next string is read.
+    bool readString(absl::string_view &value);
+    bool readString(std::string &value);
+    bool readNumber(double &value);
+    // Numbers with a fraction or an exponent are truncated.
+    bool readInt(int64_t &value);
+    bool readInt(int32_t &value);
+    bool readBool(bool &value);
+    void skipValue();
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    bool fail();
+    void skipWhitespace();
+    bool consume(char c);
+    bool consumeLiteral(absl::string_view literal);
+    bool beginContainer(char open);
+    bool nextMember(bool first, absl::string_view &key);
+    bool nextItem(bool first);
+    bool scanString(absl::string_view &raw, bool &hasEscapes);
+    bool decodeString(absl::string_view raw, std::string &to);
+    bool readStringInto(absl::string_view &value, std::string &scratch);
+    bool scanNumber(absl::string_view &token, bool &isInteger);
+
+    absl::string_view _json;
+    size_t _position = 0;
+    int _depth = 0;
+    bool _failed = false;
+    std::string _keyScratch;
+    std::string _valueScratch;
+};
+
+// Appends compact JSON to a string. Commas and colons are written as
+// needed; nesting isn't checked, the calls have to balance.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string &out);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    void key(absl::string_view key);
+    void stringValue(absl::string_view value);
+    void intValue(int64_t value);
+    void boolValue(bool value);
+    void nullValue();
+
+private:
+    void separate();
+    void appendString(absl::string_view value);
+
+    std::string &_out;
+    bool _needsComma = false;
+};
+
+} // namespace tgcalls
+
+#endif
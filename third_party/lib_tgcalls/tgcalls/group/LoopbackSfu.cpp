@@ -0,0 +1,512 @@
+#include "group/LoopbackSfu.h"
+
+#include "group/GroupNetworkManager.h"
+#include "group/JsonStream.h"
+
+#include "p2p/base/basic_packet_socket_factory.h"
+#include "p2p/client/basic_port_allocator.h"
+#include "p2p/base/p2p_transport_channel.h"
+#include "p2p/base/basic_async_resolver_factory.h"
+#include "p2p/base/dtls_transport.h"
+#include "pc/dtls_srtp_transport.h"
+#include "rtc_base/helpers.h"
+#include "rtc_base/logging.h"
+#include "rtc_base/network.h"
+#include "rtc_base/rtc_certificate_generator.h"
+#include "rtc_base/ssl_fingerprint.h"
+#include "SctpDataChannelProviderInterfaceImpl.h"
+#include "StaticThreads.h"
+#include "ThreadLocalObject.h"
+
+#include <map>
+#include <vector>
+
+namespace tgcalls {
+
+namespace {
+
+// Room SRTP needs after the payload of a forwarded packet for its tag.
+constexpr size_t kSrtpOverhead = 64;
+
+struct ParticipantJoinPayload {
+    uint32_t audioSsrc = 0;
+    std::string ufrag;
+    std::string pwd;
+    std::string fingerprintHash;
+    std::string fingerprint;
+};
+
+// The payload GroupJoinInternalPayload::serialize() writes; video source
+// groups aren't needed, every packet is forwarded as it is.
+absl::optional<ParticipantJoinPayload> parseJoinPayload(std::string const &data) {
+    ParticipantJoinPayload result;
+    auto hasSsrc = false;
+    JsonReader reader(data);
+    reader.readObject([&](absl::string_view key) {
+        if (key == "ssrc") {
+            int64_t ssrc = 0;
+            hasSsrc = reader.readInt(ssrc);
+            result.audioSsrc = (uint32_t)ssrc;
+        } else if (key == "ufrag") {
+            reader.readString(result.ufrag);
+        } else if (key == "pwd") {
+            reader.readString(result.pwd);
+        } else if (key == "fingerprints" && reader.type() == JsonReader::Type::Array) {
+            reader.readArray([&] {
+                reader.readObject([&](absl::string_view fingerprintKey) {
+                    if (fingerprintKey == "hash" && result.fingerprintHash.empty()) {
+                        reader.readString(result.fingerprintHash);
+                    } else if (fingerprintKey == "fingerprint" && result.fingerprint.empty()) {
+                        reader.readString(result.fingerprint);
+                    } else {
+                        reader.skipValue();
+                    }
+                });
+            });
+        } else {
+            reader.skipValue();
+        }
+    });
+    if (!reader.finish() || !hasSsrc || result.ufrag.empty() || result.pwd.empty() || result.fingerprint.empty()) {
+        return absl::nullopt;
+    }
+    return result;
+}
+
+} // namespace
+
+// The server side of one participant's transport.
+class LoopbackSfuEndpoint : public sigslot::has_slots<> {
+public:
+    LoopbackSfuEndpoint(
+        ParticipantJoinPayload const &payload,
+        rtc::NetworkManager *networkManager,
+        rtc::PacketSocketFactory *socketFactory,
+        webrtc::AsyncResolverFactory *asyncResolverFactory,
+        rtc::scoped_refptr<rtc::RTCCertificate> certificate,
+        std::shared_ptr<Threads> threads,
+        std::shared_ptr<LoopbackSfuCounters> counters,
+        std::function<void(std::string const &)> joinCompletion,
+        std::function<void(LoopbackSfuEndpoint *, rtc::CopyOnWriteBuffer const &)> onRtpPacket,
+        std::function<void()> onStateChanged) :
+    _audioSsrc(payload.audioSsrc),
+    _certificate(std::move(certificate)),
+    _threads(std::move(threads)),
+    _counters(std::move(counters)),
+    _joinCompletion(std::move(joinCompletion)),
+    _onRtpPacket(std::move(onRtpPacket)),
+    _onStateChanged(std::move(onStateChanged)),
+    _localIceParameters(rtc::CreateRandomString(cricket::ICE_UFRAG_LENGTH), rtc::CreateRandomString(cricket::ICE_PWD_LENGTH)) {
+        assert(_threads->getNetworkThread()->IsCurrent());
+
+        _portAllocator.reset(new cricket::BasicPortAllocator(networkManager, socketFactory));
+        _portAllocator->set_flags(cricket::PORTALLOCATOR_DISABLE_TCP | cricket::PORTALLOCATOR_DISABLE_STUN | cricket::PORTALLOCATOR_DISABLE_RELAY);
+        // Loopback addresses are left out by default.
+        _portAllocator->SetNetworkIgnoreMask(0);
+        _portAllocator->Initialize();
+        _portAllocator->SetConfiguration({}, {}, 0, webrtc::NO_PRUNE);
+
+        _transportChannel.reset(new cricket::P2PTransportChannel("transport", 1, _portAllocator.get(), asyncResolverFactory, nullptr));
+
+        cricket::IceConfig iceConfig;
+        iceConfig.continual_gathering_policy = cricket::GATHER_ONCE;
+        _transportChannel->SetIceConfig(iceConfig);
+        _transportChannel->SetIceParameters(cricket::IceParameters(_localIceParameters.ufrag, _localIceParameters.pwd, false));
+        _transportChannel->SetRemoteIceParameters(cricket::IceParameters(payload.ufrag, payload.pwd, false));
+        // Participants expect an ICE lite server and take the controlled
+        // role; they connect to our candidates, we learn theirs from the
+        // checks they send.
+        _transportChannel->SetIceRole(cricket::ICEROLE_CONTROLLING);
+        _transportChannel->SetIceTiebreaker(rtc::CreateRandomId64());
+
+        _transportChannel->SignalCandidateGathered.connect(this, &LoopbackSfuEndpoint::candidateGathered);
+        _transportChannel->SignalGatheringState.connect(this, &LoopbackSfuEndpoint::candidateGatheringState);
+        _transportChannel->SignalIceTransportStateChanged.connect(this, &LoopbackSfuEndpoint::transportStateChanged);
+
+        _dtlsTransport.reset(new cricket::DtlsTransport(_transportChannel.get(), GroupNetworkManager::getDefaulCryptoOptions(), nullptr));
+        _dtlsTransport->SignalWritableState.connect(this, &LoopbackSfuEndpoint::transportWritableState);
+        _dtlsTransport->SetLocalCertificate(_certificate);
+        _dtlsTransport->SetDtlsRole(rtc::SSLRole::SSL_CLIENT);
+        if (const auto fingerprint = rtc::SSLFingerprint::CreateUniqueFromRfc4572(payload.fingerprintHash, payload.fingerprint)) {
+            _dtlsTransport->SetRemoteFingerprint(fingerprint->algorithm, fingerprint->digest.data(), fingerprint->digest.size());
+        }
+
+        _dtlsSrtpTransport = std::make_unique<webrtc::DtlsSrtpTransport>(true);
+        _dtlsSrtpTransport->SetDtlsTransports(_dtlsTransport.get(), nullptr);
+        _dtlsSrtpTransport->SetActiveResetSrtpParams(false);
+        _dtlsSrtpTransport->SignalRtpPacketReceived.connect(this, &LoopbackSfuEndpoint::rtpPacketReceived);
+        _dtlsSrtpTransport->SignalReadyToSend.connect(this, &LoopbackSfuEndpoint::dtlsReadyToSend);
+
+        restartDataChannel();
+
+        _transportChannel->MaybeStartGathering();
+    }
+
+    ~LoopbackSfuEndpoint() {
+        assert(_threads->getNetworkThread()->IsCurrent());
+
+        _uplink.reset();
+        _downlink.reset();
+        _dtlsSrtpTransport.reset();
+        _dataChannelInterface.reset();
+        _dtlsTransport.reset();
+        _transportChannel.reset();
+        _portAllocator.reset();
+    }
+
+    uint32_t audioSsrc() const {
+        return _audioSsrc;
+    }
+
+    bool isConnected() const {
+        return _isConnected;
+    }
+
+    void setImpairment(NetworkImpairment const &uplink, NetworkImpairment const &downlink) {
+        _uplink = !uplink.isEnabled() ? nullptr : std::make_unique<ImpairedLink>(uplink, _audioSsrc, _threads->getNetworkThread(), [this](rtc::CopyOnWriteBuffer const &packet) {
+            _onRtpPacket(this, packet);
+        });
+        _downlink = !downlink.isEnabled() ? nullptr : std::make_unique<ImpairedLink>(downlink, ~_audioSsrc, _threads->getNetworkThread(), [this](rtc::CopyOnWriteBuffer const &packet) {
+            sendRtpPacketNow(packet);
+        });
+    }
+
+    void sendRtpPacket(rtc::CopyOnWriteBuffer const &packet) {
+        if (!_isConnected) {
+            return;
+        }
+        if (_downlink) {
+            int64_t delayUs = 0;
+            _counters->onImpaired(_downlink->send(packet, &delayUs), delayUs);
+            return;
+        }
+        sendRtpPacketNow(packet);
+    }
+
+    void sendDataChannelMessage(std::string const &message) {
+        if (_dataChannelInterface) {
+            _dataChannelInterface->sendDataChannelMessage(message);
+        }
+    }
+
+private:
+    void sendRtpPacketNow(rtc::CopyOnWriteBuffer const &packet) {
+        if (!_isConnected) {
+            return;
+        }
+        rtc::CopyOnWriteBuffer copy(packet.data(), packet.size(), packet.size() + kSrtpOverhead);
+        _dtlsSrtpTransport->SendRtpPacket(&copy, rtc::PacketOptions(), 0);
+    }
+
+    void restartDataChannel() {
+        _dataChannelInterface.reset(new SctpDataChannelProviderInterfaceImpl(
+            _dtlsTransport.get(),
+            false,
+            [](bool) {},
+            [this] {
+                _threads->getNetworkThread()->PostTask(RTC_FROM_HERE, [this, alive = std::weak_ptr<bool>(_alive)] {
+                    if (alive.lock()) {
+                        restartDataChannel();
+                    }
+                });
+            },
+            [counters = _counters](std::string const &) {
+                counters->onDataChannelMessage();
+            },
+            _threads
+        ));
+        _dataChannelInterface->updateIsConnected(_isConnected);
+    }
+
+    void candidateGathered(cricket::IceTransportInternal *, const cricket::Candidate &candidate) {
+        _candidates.push_back(candidate);
+    }
+
+    void candidateGatheringState(cricket::IceTransportInternal *transport) {
+        if (transport->gathering_state() != cricket::kIceGatheringComplete || !_joinCompletion) {
+            return;
+        }
+        auto completion = std::move(_joinCompletion);
+        _joinCompletion = nullptr;
+        completion(serializeJoinResponse());
+    }
+
+    std::string serializeJoinResponse() const {
+        std::string result;
+        JsonWriter json(result);
+        json.beginObject();
+        json.key("transport");
+        json.beginObject();
+        json.key("ufrag");
+        json.stringValue(_localIceParameters.ufrag);
+        json.key("pwd");
+        json.stringValue(_localIceParameters.pwd);
+
+        json.key("fingerprints");
+        json.beginArray();
+        if (const auto fingerprint = rtc::SSLFingerprint::CreateFromCertificate(*_certificate)) {
+            json.beginObject();
+            json.key("hash");
+            json.stringValue(fingerprint->algorithm);
+            json.key("fingerprint");
+            json.stringValue(fingerprint->GetRfc4572Fingerprint());
+            json.key("setup");
+            json.stringValue("active");
+            json.endObject();
+        }
+        json.endArray();
+
+        json.key("candidates");
+        json.beginArray();
+        for (const auto &candidate : _candidates) {
+            json.beginObject();
+            json.key("port");
+            json.stringValue(std::to_string(candidate.address().port()));
+            json.key("protocol");
+            json.stringValue(candidate.protocol());
+            json.key("network");
+            json.stringValue(std::to_string(candidate.network_id()));
+            json.key("generation");
+            json.stringValue(std::to_string(candidate.generation()));
+            json.key("id");
+            json.stringValue(candidate.id());
+            json.key("component");
+            json.stringValue(std::to_string(candidate.component()));
+            json.key("foundation");
+            json.stringValue(candidate.foundation());
+            json.key("priority");
+            json.stringValue(std::to_string(candidate.priority()));
+            json.key("ip");
+            json.stringValue(candidate.address().ipaddr().ToString());
+            json.key("type");
+            json.stringValue(candidate.type());
+            json.endObject();
+        }
+        json.endArray();
+
+        json.endObject();
+        json.endObject();
+        return result;
+    }
+
+    void transportStateChanged(cricket::IceTransportInternal *) {
+        updateState();
+    }
+
+    void transportWritableState(rtc::PacketTransportInternal *) {
+        updateState();
+    }
+
+    void dtlsReadyToSend(bool) {
+        updateState();
+    }
+
+    void updateState() {
+        auto isConnected = false;
+        switch (_transportChannel->GetIceTransportState()) {
+            case webrtc::IceTransportState::kConnected:
+            case webrtc::IceTransportState::kCompleted:
+                isConnected = _dtlsSrtpTransport->IsWritable(false);
+                break;
+            default:
+                break;
+        }
+        if (_isConnected == isConnected) {
+            return;
+        }
+        _isConnected = isConnected;
+        if (_dataChannelInterface) {
+            _dataChannelInterface->updateIsConnected(isConnected);
+        }
+        _onStateChanged();
+    }
+
+    void rtpPacketReceived(rtc::CopyOnWriteBuffer *packet, int64_t, bool) {
+        _counters->onReceived(packet->size());
+        if (_uplink) {
+            int64_t delayUs = 0;
+            _counters->onImpaired(_uplink->send(*packet, &delayUs), delayUs);
+            return;
+        }
+        _onRtpPacket(this, *packet);
+    }
+
+    const uint32_t _audioSsrc;
+    const rtc::scoped_refptr<rtc::RTCCertificate> _certificate;
+    const std::shared_ptr<Threads> _threads;
+    const std::shared_ptr<LoopbackSfuCounters> _counters;
+    std::function<void(std::string const &)> _joinCompletion;
+    const std::function<void(LoopbackSfuEndpoint *, rtc::CopyOnWriteBuffer const &)> _onRtpPacket;
+    const std::function<void()> _onStateChanged;
+    const PeerIceParameters _localIceParameters;
+    // Lets tasks posted by the endpoint notice it is gone.
+    const std::shared_ptr<bool> _alive = std::make_shared<bool>(true);
+
+    std::unique_ptr<cricket::BasicPortAllocator> _portAllocator;
+    std::unique_ptr<cricket::P2PTransportChannel> _transportChannel;
+    std::unique_ptr<cricket::DtlsTransport> _dtlsTransport;
+    std::unique_ptr<webrtc::DtlsSrtpTransport> _dtlsSrtpTransport;
+    std::unique_ptr<SctpDataChannelProviderInterfaceImpl> _dataChannelInterface;
+    std::unique_ptr<ImpairedLink> _uplink;
+    std::unique_ptr<ImpairedLink> _downlink;
+    std::vector<cricket::Candidate> _candidates;
+    bool _isConnected = false;
+};
+
+class LoopbackSfuInternal {
+public:
+    LoopbackSfuInternal(std::shared_ptr<Threads> threads, std::shared_ptr<LoopbackSfuCounters> counters) :
+    _threads(std::move(threads)),
+    _counters(std::move(counters)) {
+        assert(_threads->getNetworkThread()->IsCurrent());
+
+        _socketFactory.reset(new rtc::BasicPacketSocketFactory(_threads->getNetworkThread()));
+        _networkManager = std::make_unique<rtc::BasicNetworkManager>();
+        _asyncResolverFactory = std::make_unique<webrtc::BasicAsyncResolverFactory>();
+        // One certificate for every endpoint, like a real server has.
+        _certificate = rtc::RTCCertificateGenerator::GenerateCertificate(rtc::KeyParams(rtc::KT_ECDSA), absl::nullopt);
+    }
+
+    ~LoopbackSfuInternal() {
+        assert(_threads->getNetworkThread()->IsCurrent());
+
+        _endpoints.clear();
+        _asyncResolverFactory.reset();
+        _networkManager.reset();
+        _socketFactory.reset();
+    }
+
+    void join(std::string const &joinPayload, std::function<void(std::string const &)> completion) {
+        const auto payload = parseJoinPayload(joinPayload);
+        if (!payload) {
+            RTC_LOG(LS_ERROR) << "LoopbackSfu: could not parse join payload";
+            completion(std::string());
+            return;
+        }
+        _endpoints.erase(payload->audioSsrc);
+        _endpoints.emplace(payload->audioSsrc, std::make_unique<LoopbackSfuEndpoint>(
+            payload.value(),
+            _networkManager.get(),
+            _socketFactory.get(),
+            _asyncResolverFactory.get(),
+            _certificate,
+            _threads,
+            _counters,
+            std::move(completion),
+            [this](LoopbackSfuEndpoint *from, rtc::CopyOnWriteBuffer const &packet) {
+                forwardRtpPacket(from, packet);
+            },
+            [this] {
+                updateCounters();
+            }));
+        _endpoints[payload->audioSsrc]->setImpairment(_uplinkImpairment, _downlinkImpairment);
+        updateCounters();
+    }
+
+    void leave(uint32_t audioSsrc) {
+        _endpoints.erase(audioSsrc);
+        updateCounters();
+    }
+
+    void sendDataChannelMessage(std::string const &message) {
+        for (const auto &it : _endpoints) {
+            it.second->sendDataChannelMessage(message);
+        }
+    }
+
+    void setImpairment(NetworkImpairment const &uplink, NetworkImpairment const &downlink) {
+        _uplinkImpairment = uplink;
+        _downlinkImpairment = downlink;
+        for (const auto &it : _endpoints) {
+            it.second->setImpairment(uplink, downlink);
+        }
+    }
+
+private:
+    void forwardRtpPacket(LoopbackSfuEndpoint *from, rtc::CopyOnWriteBuffer const &packet) {
+        uint64_t forwarded = 0;
+        for (const auto &it : _endpoints) {
+            if (it.second.get() != from && it.second->isConnected()) {
+                it.second->sendRtpPacket(packet);
+                forwarded++;
+            }
+        }
+        _counters->onForwarded(forwarded);
+    }
+
+    void updateCounters() {
+        int connectedEndpoints = 0;
+        for (const auto &it : _endpoints) {
+            if (it.second->isConnected()) {
+                connectedEndpoints++;
+            }
+        }
+        _counters->setEndpoints((int)_endpoints.size(), connectedEndpoints);
+    }
+
+    const std::shared_ptr<Threads> _threads;
+    const std::shared_ptr<LoopbackSfuCounters> _counters;
+    std::unique_ptr<rtc::BasicPacketSocketFactory> _socketFactory;
+    std::unique_ptr<rtc::BasicNetworkManager> _networkManager;
+    std::unique_ptr<webrtc::BasicAsyncResolverFactory> _asyncResolverFactory;
+    rtc::scoped_refptr<rtc::RTCCertificate> _certificate;
+    std::map<uint32_t, std::unique_ptr<LoopbackSfuEndpoint>> _endpoints;
+    NetworkImpairment _uplinkImpairment;
+    NetworkImpairment _downlinkImpairment;
+};
+
+LoopbackSfu::LoopbackSfu(std::shared_ptr<Threads> threads) :
+_threads(std::move(threads)),
+_counters(std::make_shared<LoopbackSfuCounters>()) {
+    _internal.reset(new ThreadLocalObject<LoopbackSfuInternal>(_threads->getNetworkThread(), [threads = _threads, counters = _counters] {
+        return new LoopbackSfuInternal(threads, counters);
+    }));
+}
+
+LoopbackSfu::~LoopbackSfu() {
+    _internal.reset();
+
+    // Wait until the endpoints are destroyed.
+    _threads->getNetworkThread()->Invoke<void>(RTC_FROM_HERE, [] {});
+}
+
+void LoopbackSfu::join(std::string const &joinPayload, std::function<void(std::string const &)> completion) {
+    _internal->perform(RTC_FROM_HERE, [joinPayload, completion = std::move(completion)](LoopbackSfuInternal *internal) mutable {
+        internal->join(joinPayload, std::move(completion));
+    });
+}
+
+void LoopbackSfu::leave(uint32_t audioSsrc) {
+    _internal->perform(RTC_FROM_HERE, [audioSsrc](LoopbackSfuInternal *internal) {
+        internal->leave(audioSsrc);
+    });
+}
+
+void LoopbackSfu::sendDataChannelMessage(std::string const &message) {
+    _internal->perform(RTC_FROM_HERE, [message](LoopbackSfuInternal *internal) {
+        internal->sendDataChannelMessage(message);
+    });
+}
+
+void LoopbackSfu::setImpairment(NetworkImpairment const &uplink, NetworkImpairment const &downlink) {
+    _internal->perform(RTC_FROM_HERE, [uplink, downlink](LoopbackSfuInternal *internal) {
+        internal->setImpairment(uplink, downlink);
+    });
+}
+
+LoopbackSfu::Stats LoopbackSfu::getStats() const {
+    Stats stats;
+    stats.endpoints = _counters->endpoints();
+    stats.connectedEndpoints = _counters->connectedEndpoints();
+    stats.receivedPackets = _counters->receivedPackets();
+    stats.receivedBytes = _counters->receivedBytes();
+    stats.forwardedPackets = _counters->forwardedPackets();
+    stats.dataChannelMessages = _counters->dataChannelMessages();
+    stats.impairedPackets = _counters->impairedPackets();
+    stats.meanImpairmentDelayMs = stats.impairedPackets > 0 ? (double)_counters->impairmentDelayUs() / stats.impairedPackets / 1000.0 : 0.0;
+    stats.impairmentLostPackets = _counters->impairmentLostPackets();
+    stats.impairmentQueueDroppedPackets = _counters->impairmentQueueDroppedPackets();
+    return stats;
+}
+
+} // namespace tgcalls
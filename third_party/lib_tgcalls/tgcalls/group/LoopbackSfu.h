@@ -0,0 +1,155 @@
+#ifndef TGCALLS_LOOPBACK_SFU_H
+#define TGCALLS_LOOPBACK_SFU_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "group/NetworkImpairment.h"
+
+namespace tgcalls {
+
+class Threads;
+class LoopbackSfuInternal;
+template <typename T>
+class ThreadLocalObject;
+
+// Counters of a LoopbackSfu, updated on its network thread and readable
+// from any thread.
+class LoopbackSfuCounters {
+public:
+    void onReceived(size_t bytes) {
+        _receivedPackets.fetch_add(1, std::memory_order_relaxed);
+        _receivedBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    void onForwarded(uint64_t packets) {
+        _forwardedPackets.fetch_add(packets, std::memory_order_relaxed);
+    }
+    void onDataChannelMessage() {
+        _dataChannelMessages.fetch_add(1, std::memory_order_relaxed);
+    }
+    void onImpaired(ImpairedLink::Fate fate, int64_t delayUs) {
+        switch (fate) {
+            case ImpairedLink::Fate::Delivered:
+                _impairedPackets.fetch_add(1, std::memory_order_relaxed);
+                _impairmentDelayUs.fetch_add((uint64_t)delayUs, std::memory_order_relaxed);
+                break;
+            case ImpairedLink::Fate::Lost:
+                _impairmentLostPackets.fetch_add(1, std::memory_order_relaxed);
+                break;
+            case ImpairedLink::Fate::QueueFull:
+                _impairmentQueueDroppedPackets.fetch_add(1, std::memory_order_relaxed);
+                break;
+        }
+    }
+    void setEndpoints(int endpoints, int connectedEndpoints) {
+        _endpoints.store(endpoints, std::memory_order_relaxed);
+        _connectedEndpoints.store(connectedEndpoints, std::memory_order_relaxed);
+    }
+
+    uint64_t receivedPackets() const {
+        return _receivedPackets.load(std::memory_order_relaxed);
+    }
+    uint64_t receivedBytes() const {
+        return _receivedBytes.load(std::memory_order_relaxed);
+    }
+    uint64_t forwardedPackets() const {
+        return _forwardedPackets.load(std::memory_order_relaxed);
+    }
+    uint64_t dataChannelMessages() const {
+        return _dataChannelMessages.load(std::memory_order_relaxed);
+    }
+    uint64_t impairedPackets() const {
+        return _impairedPackets.load(std::memory_order_relaxed);
+    }
+    uint64_t impairmentDelayUs() const {
+        return _impairmentDelayUs.load(std::memory_order_relaxed);
+    }
+    uint64_t impairmentLostPackets() const {
+        return _impairmentLostPackets.load(std::memory_order_relaxed);
+    }
+    uint64_t impairmentQueueDroppedPackets() const {
+        return _impairmentQueueDroppedPackets.load(std::memory_order_relaxed);
+    }
+    int endpoints() const {
+        return _endpoints.load(std::memory_order_relaxed);
+    }
+    int connectedEndpoints() const {
+        return _connectedEndpoints.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> _receivedPackets{0};
+    std::atomic<uint64_t> _receivedBytes{0};
+    std::atomic<uint64_t> _forwardedPackets{0};
+    std::atomic<uint64_t> _dataChannelMessages{0};
+    std::atomic<uint64_t> _impairedPackets{0};
+    std::atomic<uint64_t> _impairmentDelayUs{0};
+    std::atomic<uint64_t> _impairmentLostPackets{0};
+    std::atomic<uint64_t> _impairmentQueueDroppedPackets{0};
+    std::atomic<int> _endpoints{0};
+    std::atomic<int> _connectedEndpoints{0};
+};
+
+// An in-process stand-in for the group call server, for benchmarks and
+// tests that shouldn't depend on Telegram's servers.
+//
+// Each participant joins with the payload its group call emitted and gets
+// back a join response to hand to setJoinResponsePayload(). The server
+// side of the transport is what GroupNetworkManager expects: ICE with the
+// server controlling, DTLS with the server as client, SRTP and the colibri
+// data channel. Every RTP packet received is forwarded to every other
+// connected participant, audio and video alike; there is no RTCP, bandwidth
+// estimation or video layer selection. Candidates include loopback
+// addresses, so calls on the same host connect without any network.
+//
+// setImpairment() puts a bad network between the participants and the
+// server, to measure what loss, jitter and capped links cost the calls.
+class LoopbackSfu {
+public:
+    struct Stats {
+        int endpoints = 0;
+        int connectedEndpoints = 0;
+        uint64_t receivedPackets = 0;
+        uint64_t receivedBytes = 0;
+        uint64_t forwardedPackets = 0;
+        uint64_t dataChannelMessages = 0;
+        // RTP packets through the impairments in either direction: delivered,
+        // with their mean added delay, lost, and dropped by a full queue.
+        uint64_t impairedPackets = 0;
+        double meanImpairmentDelayMs = 0.0;
+        uint64_t impairmentLostPackets = 0;
+        uint64_t impairmentQueueDroppedPackets = 0;
+    };
+
+    // Runs on the network thread of |threads|.
+    explicit LoopbackSfu(std::shared_ptr<Threads> threads);
+    ~LoopbackSfu();
+
+    // |completion| is called on the network thread with the join response,
+    // once the server's candidates are gathered, or with an empty string if
+    // |joinPayload| can't be parsed. Joining again with the same audio SSRC
+    // replaces the previous endpoint.
+    void join(std::string const &joinPayload, std::function<void(std::string const &)> completion);
+    void leave(uint32_t audioSsrc);
+    // Sends |message| on the data channel of every connected participant,
+    // e.g. a colibri DominantSpeakerEndpointChangeEvent.
+    void sendDataChannelMessage(std::string const &message);
+    // Impairs the RTP packets participants send to the server, and those it
+    // forwards to them, from now on; each participant has links of its own.
+    // ICE, DTLS and the data channel go through unimpaired.
+    void setImpairment(NetworkImpairment const &uplink, NetworkImpairment const &downlink);
+
+    Stats getStats() const;
+
+private:
+    std::shared_ptr<Threads> _threads;
+    std::shared_ptr<LoopbackSfuCounters> _counters;
+    std::unique_ptr<ThreadLocalObject<LoopbackSfuInternal>> _internal;
+};
+
+} // namespace tgcalls
+
+#endif
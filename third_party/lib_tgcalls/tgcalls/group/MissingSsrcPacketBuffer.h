@@ -0,0 +1,137 @@
+#ifndef TGCALLS_MISSING_SSRC_PACKET_BUFFER_H
+#define TGCALLS_MISSING_SSRC_PACKET_BUFFER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "rtc_base/copy_on_write_buffer.h"
+
+namespace tgcalls {
+
+// Packets of SSRCs that aren't mapped to a channel yet, kept until the
+// mapping arrives. Slots form a fixed-capacity ring, so the oldest packet is
+// overwritten once it's full; each SSRC threads its packets through the slots
+// as a list, so both add() and get() are O(1) per packet.
+class MissingSsrcPacketBuffer {
+public:
+    struct Stats {
+        size_t bufferedPackets = 0;
+        uint64_t evictedPackets = 0;
+        uint64_t deliveredPackets = 0;
+    };
+
+    MissingSsrcPacketBuffer(int limit) :
+    _slots(std::max(limit, 1)) {
+    }
+
+    ~MissingSsrcPacketBuffer() {
+    }
+
+    void add(uint32_t ssrc, rtc::CopyOnWriteBuffer const &packet) {
+        int index = _nextSlot;
+        _nextSlot = (_nextSlot + 1) % (int)_slots.size();
+
+        Slot &slot = _slots[index];
+        if (slot.isUsed) {
+            unlink(index);
+            _stats.evictedPackets++;
+        }
+
+        slot.isUsed = true;
+        slot.ssrc = ssrc;
+        slot.packet = packet;
+        slot.next = -1;
+
+        SlotList &list = _lists[ssrc];
+        slot.previous = list.tail;
+        if (list.tail != -1) {
+            _slots[list.tail].next = index;
+        } else {
+            list.head = index;
+        }
+        list.tail = index;
+        _stats.bufferedPackets++;
+    }
+
+    std::vector<rtc::CopyOnWriteBuffer> get(uint32_t ssrc) {
+        std::vector<rtc::CopyOnWriteBuffer> result;
+        auto it = _lists.find(ssrc);
+        if (it == _lists.end()) {
+            return result;
+        }
+        for (int index = it->second.head; index != -1; ) {
+            Slot &slot = _slots[index];
+            result.push_back(std::move(slot.packet));
+            slot.packet = rtc::CopyOnWriteBuffer();
+            slot.isUsed = false;
+            index = slot.next;
+        }
+        _lists.erase(it);
+        _stats.bufferedPackets -= result.size();
+        _stats.deliveredPackets += result.size();
+        return result;
+    }
+
+    Stats const &stats() const {
+        return _stats;
+    }
+
+    // The slots, the buffered packets' storage and the per-SSRC lists.
+    size_t memoryBytes() const {
+        size_t bytes = _slots.capacity() * sizeof(Slot);
+        for (const auto &slot : _slots) {
+            if (slot.isUsed) {
+                bytes += slot.packet.capacity();
+            }
+        }
+        bytes += _lists.capacity() * (sizeof(std::pair<uint32_t, SlotList>) + 1);
+        return bytes;
+    }
+
+private:
+    struct Slot {
+        bool isUsed = false;
+        uint32_t ssrc = 0;
+        rtc::CopyOnWriteBuffer packet;
+        int previous = -1;
+        int next = -1;
+    };
+
+    struct SlotList {
+        int head = -1;
+        int tail = -1;
+    };
+
+    void unlink(int index) {
+        Slot &slot = _slots[index];
+        auto it = _lists.find(slot.ssrc);
+        if (slot.previous != -1) {
+            _slots[slot.previous].next = slot.next;
+        } else {
+            it->second.head = slot.next;
+        }
+        if (slot.next != -1) {
+            _slots[slot.next].previous = slot.previous;
+        } else {
+            it->second.tail = slot.previous;
+        }
+        if (it->second.head == -1) {
+            _lists.erase(it);
+        }
+        slot.packet = rtc::CopyOnWriteBuffer();
+        slot.isUsed = false;
+        _stats.bufferedPackets--;
+    }
+
+    std::vector<Slot> _slots;
+    int _nextSlot = 0;
+    absl::flat_hash_map<uint32_t, SlotList> _lists;
+    Stats _stats;
+
+};
+
+} // namespace tgcalls
+
+#endif
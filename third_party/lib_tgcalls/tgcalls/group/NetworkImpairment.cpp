@@ -0,0 +1,98 @@
+#include "group/NetworkImpairment.h"
+
+#include "rtc_base/thread.h"
+#include "rtc_base/time_utils.h"
+
+#include <algorithm>
+
+namespace tgcalls {
+
+ImpairedLink::ImpairedLink(NetworkImpairment const &impairment, uint32_t stream, rtc::Thread *thread, std::function<void(rtc::CopyOnWriteBuffer const &)> deliver) :
+_impairment(impairment),
+_thread(thread),
+_deliver(std::move(deliver)),
+_random(impairment.seed * 2654435761u ^ stream) {
+    const double loss = std::min(std::max(_impairment.lossPercent / 100.0, 0.0), 0.99);
+    const double burstLength = std::max(_impairment.averageBurstLossLength, 1.0);
+    // Leaves a burst with 1 / |burstLength| per packet, and enters one often
+    // enough for |loss| of the packets to fall in bursts.
+    _burstContinueProbability = 1.0 - 1.0 / burstLength;
+    _burstStartProbability = std::min(1.0, loss / (1.0 - loss) / burstLength);
+}
+
+ImpairedLink::~ImpairedLink() = default;
+
+ImpairedLink::Fate ImpairedLink::send(rtc::CopyOnWriteBuffer const &packet, int64_t *delayUs) {
+    const int64_t nowUs = rtc::TimeMicros();
+
+    int64_t departureUs = nowUs;
+    if (_impairment.bandwidthKbps > 0) {
+        while (!_linkQueue.empty() && _linkQueue.front() <= nowUs) {
+            _linkQueue.pop_front();
+        }
+        if (_impairment.queueLengthPackets > 0 && _linkQueue.size() >= (size_t)_impairment.queueLengthPackets) {
+            return Fate::QueueFull;
+        }
+        const int64_t startUs = _linkQueue.empty() ? nowUs : _linkQueue.back();
+        departureUs = startUs + (int64_t)packet.size() * 8 * 1000 / _impairment.bandwidthKbps;
+        _linkQueue.push_back(departureUs);
+    }
+
+    // Lost past the link, having taken its share of it.
+    if (isLost()) {
+        return Fate::Lost;
+    }
+
+    int64_t arrivalUs = departureUs + (int64_t)_impairment.delayMs * 1000;
+    if (_impairment.jitterMs > 0) {
+        std::normal_distribution<double> jitter(0.0, _impairment.jitterMs * 1000.0);
+        arrivalUs = std::max(departureUs, arrivalUs + (int64_t)jitter(_random));
+    }
+    if (!_impairment.allowReordering) {
+        arrivalUs = std::max(arrivalUs, _lastArrivalUs);
+    }
+    _lastArrivalUs = std::max(_lastArrivalUs, arrivalUs);
+    *delayUs = arrivalUs - nowUs;
+
+    if (arrivalUs <= nowUs && _inFlight.empty()) {
+        _deliver(packet);
+        return Fate::Delivered;
+    }
+    _inFlight.emplace(arrivalUs, packet);
+    schedule(arrivalUs);
+    return Fate::Delivered;
+}
+
+bool ImpairedLink::isLost() {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    _isBursting = uniform(_random) < (_isBursting ? _burstContinueProbability : _burstStartProbability);
+    return _isBursting;
+}
+
+void ImpairedLink::schedule(int64_t atUs) {
+    if (_scheduledAtUs != 0 && _scheduledAtUs <= atUs) {
+        return;
+    }
+    _scheduledAtUs = atUs;
+    const int64_t delayMs = std::max<int64_t>(0, (atUs - rtc::TimeMicros() + 999) / 1000);
+    _thread->PostDelayedTask(RTC_FROM_HERE, [this, alive = std::weak_ptr<bool>(_alive)] {
+        if (alive.lock()) {
+            deliverDue();
+        }
+    }, (uint32_t)delayMs);
+}
+
+void ImpairedLink::deliverDue() {
+    _scheduledAtUs = 0;
+    const int64_t nowUs = rtc::TimeMicros();
+    while (!_inFlight.empty() && _inFlight.begin()->first <= nowUs) {
+        const auto packet = std::move(_inFlight.begin()->second);
+        _inFlight.erase(_inFlight.begin());
+        _deliver(packet);
+    }
+    if (!_inFlight.empty()) {
+        schedule(_inFlight.begin()->first);
+    }
+}
+
+} // namespace tgcalls
@@ -0,0 +1,97 @@
+#ifndef TGCALLS_NETWORK_IMPAIRMENT_H
+#define TGCALLS_NETWORK_IMPAIRMENT_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <random>
+
+#include "rtc_base/copy_on_write_buffer.h"
+
+namespace rtc {
+class Thread;
+}
+
+namespace tgcalls {
+
+// A bad network for one direction of a LoopbackSfu endpoint, after WebRTC's
+// SimulatedNetwork: a capped link with a bounded queue, then random loss and
+// delay. Everything off by default.
+struct NetworkImpairment {
+    // Share of the packets lost, 0 to 100.
+    double lossPercent = 0.0;
+    // Mean number of packets in a row lost; above 1 losses come in bursts,
+    // with the same overall share.
+    double averageBurstLossLength = 1.0;
+    int delayMs = 0;
+    // Standard deviation of a normally distributed delay added to |delayMs|.
+    int jitterMs = 0;
+    // Lets a packet with less jitter arrive before one sent earlier;
+    // otherwise it waits for that one.
+    bool allowReordering = false;
+    // Packets go over the link one after another at this rate; 0 for no cap.
+    int bandwidthKbps = 0;
+    // Packets that would wait for the capped link behind this many are
+    // dropped; 0 for no limit.
+    int queueLengthPackets = 0;
+    // Runs with the same seed lose and delay the same packets.
+    uint32_t seed = 1;
+
+    bool isEnabled() const {
+        return lossPercent > 0.0 || delayMs > 0 || jitterMs > 0 || bandwidthKbps > 0;
+    }
+};
+
+// Passes packets through a NetworkImpairment on |thread|, which it must be
+// used and destroyed on. Delayed packets are delivered from tasks posted
+// there; destroying the link drops them.
+class ImpairedLink {
+public:
+    enum class Fate {
+        Delivered,
+        Lost,
+        QueueFull
+    };
+
+    // |stream| tells the links of one impairment apart, so that they don't
+    // all lose the same packets.
+    ImpairedLink(NetworkImpairment const &impairment, uint32_t stream, rtc::Thread *thread, std::function<void(rtc::CopyOnWriteBuffer const &)> deliver);
+    ~ImpairedLink();
+
+    // Delivers |packet| now or later, or drops it. |*delayUs| gets the delay
+    // of a packet that will be delivered.
+    Fate send(rtc::CopyOnWriteBuffer const &packet, int64_t *delayUs);
+
+private:
+    bool isLost();
+    void schedule(int64_t atUs);
+    void deliverDue();
+
+    const NetworkImpairment _impairment;
+    rtc::Thread *const _thread;
+    const std::function<void(rtc::CopyOnWriteBuffer const &)> _deliver;
+    // Lets the delayed tasks notice the link is gone.
+    const std::shared_ptr<bool> _alive = std::make_shared<bool>(true);
+
+    std::mt19937 _random;
+    // Gilbert-Elliott loss: from a good state a loss starts a burst with
+    // |_burstStartProbability|, and a burst goes on with
+    // |_burstContinueProbability|.
+    double _burstStartProbability = 0.0;
+    double _burstContinueProbability = 0.0;
+    bool _isBursting = false;
+
+    // When the packets on the capped link finish going over it.
+    std::deque<int64_t> _linkQueue;
+    // Packets in flight by arrival time, in sending order for equal times.
+    std::multimap<int64_t, rtc::CopyOnWriteBuffer> _inFlight;
+    int64_t _lastArrivalUs = 0;
+    // Earliest time a posted task delivers at, 0 when none is posted.
+    int64_t _scheduledAtUs = 0;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,253 @@
+#include "group/ParallelDecodingAudioMixer.h"
+
+#include "ThreadScheduling.h"
+
+#include "api/audio/audio_frame.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace tgcalls {
+
+namespace {
+
+// Decoding threads shared by every call. A few are enough: the mixing
+// thread decodes as well, and each stream takes well under a millisecond.
+class DecodePool {
+public:
+    static DecodePool &shared() {
+        // Leaked, like the audio pump: calls may be torn down at exit.
+        static DecodePool *pool = new DecodePool(std::min(4u, std::max(1u, std::thread::hardware_concurrency() / 2)));
+        return *pool;
+    }
+
+    size_t threadCount() const {
+        return _threadCount;
+    }
+
+    void post(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.push_back(std::move(task));
+        }
+        _wakeUp.notify_one();
+    }
+
+private:
+    explicit DecodePool(size_t threadCount) :
+    _threadCount(threadCount) {
+        for (size_t i = 0; i < threadCount; i++) {
+            std::thread([this] {
+                run();
+            }).detach();
+        }
+    }
+
+    void run() {
+        // Working to the audio pump's deadlines.
+        ThreadScheduling::applyToCurrentThread(ThreadRole::AudioPump);
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wakeUp.wait(lock, [this] { return !_tasks.empty(); });
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    const size_t _threadCount;
+    std::mutex _mutex;
+    std::condition_variable _wakeUp;
+    std::deque<std::function<void()>> _tasks;
+};
+
+} // namespace
+
+class ParallelDecodingAudioMixer::PrefetchedSource : public webrtc::AudioMixer::Source {
+public:
+    enum class State {
+        Idle,
+        Queued,
+        Decoding,
+        // |frame| holds the next frame.
+        Ready
+    };
+
+    PrefetchedSource(Source *source, Shared *shared) :
+    _source(source),
+    _shared(shared) {
+    }
+
+    AudioFrameInfo GetAudioFrameWithInfo(int sampleRateHz, webrtc::AudioFrame *audioFrame) override;
+
+    int Ssrc() const override {
+        return _source->Ssrc();
+    }
+
+    int PreferredSampleRate() const override {
+        return _source->PreferredSampleRate();
+    }
+
+    Source *source() const {
+        return _source;
+    }
+
+    // Guarded by Shared::mutex, except |frame| while decoding.
+    State state = State::Idle;
+    bool isRemoved = false;
+    // Asked by the wrapped mixer last time; 0 before the first mix.
+    int sampleRateHz = 0;
+    size_t channels = 1;
+    webrtc::AudioFrame frame;
+    AudioFrameInfo info = AudioFrameInfo::kError;
+
+private:
+    Source *_source = nullptr;
+    Shared *_shared = nullptr;
+};
+
+struct ParallelDecodingAudioMixer::Shared {
+    std::mutex mutex;
+    std::condition_variable decoded;
+    std::map<Source *, std::unique_ptr<PrefetchedSource>> sources;
+    std::deque<PrefetchedSource *> queue;
+    int decoding = 0;
+
+    // Decodes the queued sources until none are left.
+    void decodeQueued(std::unique_lock<std::mutex> &lock) {
+        while (!queue.empty()) {
+            const auto source = queue.front();
+            queue.pop_front();
+            source->state = PrefetchedSource::State::Decoding;
+            decoding++;
+            const int sampleRateHz = source->sampleRateHz;
+
+            lock.unlock();
+            const auto info = source->source()->GetAudioFrameWithInfo(sampleRateHz, &source->frame);
+            lock.lock();
+
+            source->info = info;
+            source->channels = source->frame.num_channels_;
+            source->state = PrefetchedSource::State::Ready;
+            decoding--;
+            decoded.notify_all();
+        }
+    }
+};
+
+webrtc::AudioMixer::Source::AudioFrameInfo ParallelDecodingAudioMixer::PrefetchedSource::GetAudioFrameWithInfo(int sampleRateHz, webrtc::AudioFrame *audioFrame) {
+    std::unique_lock<std::mutex> lock(_shared->mutex);
+    if (state == State::Decoding) {
+        // Late: concealed now, and what it is decoding goes into the next
+        // mix.
+        audioFrame->UpdateFrame(0, nullptr, sampleRateHz / 100, sampleRateHz, webrtc::AudioFrame::kPLC, webrtc::AudioFrame::kVadUnknown, channels);
+        return AudioFrameInfo::kMuted;
+    }
+    if (state == State::Ready) {
+        state = State::Idle;
+        if (this->sampleRateHz == sampleRateHz) {
+            audioFrame->CopyFrom(frame);
+            return info;
+        }
+    }
+
+    this->sampleRateHz = sampleRateHz;
+    lock.unlock();
+    const auto result = _source->GetAudioFrameWithInfo(sampleRateHz, audioFrame);
+    lock.lock();
+    channels = audioFrame->num_channels_;
+    return result;
+}
+
+ParallelDecodingAudioMixer::ParallelDecodingAudioMixer(rtc::scoped_refptr<webrtc::AudioMixer> mixer, int deadlineUs) :
+_mixer(std::move(mixer)),
+_deadlineUs(std::max(0, deadlineUs)),
+_shared(std::make_shared<Shared>()) {
+}
+
+ParallelDecodingAudioMixer::~ParallelDecodingAudioMixer() {
+    std::unique_lock<std::mutex> lock(_shared->mutex);
+    _shared->decoded.wait(lock, [this] {
+        return _shared->decoding == 0;
+    });
+}
+
+bool ParallelDecodingAudioMixer::AddSource(Source *audioSource) {
+    auto source = std::make_unique<PrefetchedSource>(audioSource, _shared.get());
+    {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        if (_shared->sources.find(audioSource) != _shared->sources.end()) {
+            return false;
+        }
+    }
+    // Never under |mutex|, which the wrapped mixer's Mix() takes through
+    // the sources while holding its own lock.
+    if (!_mixer->AddSource(source.get())) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(_shared->mutex);
+    _shared->sources.emplace(audioSource, std::move(source));
+    return true;
+}
+
+void ParallelDecodingAudioMixer::RemoveSource(Source *audioSource) {
+    PrefetchedSource *source = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(_shared->mutex);
+        const auto it = _shared->sources.find(audioSource);
+        if (it == _shared->sources.end()) {
+            return;
+        }
+        source = it->second.get();
+        source->isRemoved = true;
+    }
+    _mixer->RemoveSource(source);
+
+    std::unique_lock<std::mutex> lock(_shared->mutex);
+    _shared->decoded.wait(lock, [source] {
+        return source->state != PrefetchedSource::State::Queued && source->state != PrefetchedSource::State::Decoding;
+    });
+    _shared->sources.erase(audioSource);
+}
+
+void ParallelDecodingAudioMixer::Mix(size_t numberOfChannels, webrtc::AudioFrame *audioFrameForMixing) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(_deadlineUs);
+    {
+        std::unique_lock<std::mutex> lock(_shared->mutex);
+        if (_shared->sources.size() >= kMinParallelSources) {
+            for (const auto &it : _shared->sources) {
+                const auto source = it.second.get();
+                if (source->state == PrefetchedSource::State::Idle && source->sampleRateHz != 0 && !source->isRemoved) {
+                    source->state = PrefetchedSource::State::Queued;
+                    _shared->queue.push_back(source);
+                }
+            }
+            // This thread decodes as well, so one queued source is left to it.
+            auto &pool = DecodePool::shared();
+            const size_t queued = _shared->queue.size();
+            const size_t helpers = queued > 1 ? std::min(queued - 1, pool.threadCount()) : 0;
+            for (size_t i = 0; i < helpers; i++) {
+                pool.post([shared = _shared] {
+                    std::unique_lock<std::mutex> lock(shared->mutex);
+                    shared->decodeQueued(lock);
+                });
+            }
+            _shared->decodeQueued(lock);
+            _shared->decoded.wait_until(lock, deadline, [this] {
+                return _shared->decoding == 0;
+            });
+        }
+    }
+    _mixer->Mix(numberOfChannels, audioFrameForMixing);
+}
+
+} // namespace tgcalls
@@ -0,0 +1,47 @@
+#ifndef TGCALLS_PARALLEL_DECODING_AUDIO_MIXER_H
+#define TGCALLS_PARALLEL_DECODING_AUDIO_MIXER_H
+
+#include "api/audio/audio_mixer.h"
+#include "api/scoped_refptr.h"
+
+#include <memory>
+
+namespace tgcalls {
+
+// Decodes the incoming streams of a playout mix in parallel before mixing.
+//
+// Each Mix() first has every source decode its next frame, at the rate the
+// wrapped mixer asked of it last time, on a small process-wide pool and on
+// the mixing thread itself; the wrapped mixer then mixes those frames. A
+// stream still decoding |deadlineUs| after the mix started is concealed
+// with a muted frame marked as PLC, and the frame it is decoding goes into
+// the next mix instead. Sources are decoded on the mixing thread as before
+// the first time, when the rate asked changes, and while there are fewer
+// than kMinParallelSources of them.
+//
+// The audio sinks of incoming streams are called on the pool's threads
+// then, each stream's from one at a time.
+class ParallelDecodingAudioMixer : public webrtc::AudioMixer {
+public:
+    static constexpr size_t kMinParallelSources = 4;
+
+    ParallelDecodingAudioMixer(rtc::scoped_refptr<webrtc::AudioMixer> mixer, int deadlineUs);
+    ~ParallelDecodingAudioMixer() override;
+
+    bool AddSource(Source *audioSource) override;
+    void RemoveSource(Source *audioSource) override;
+    void Mix(size_t numberOfChannels, webrtc::AudioFrame *audioFrameForMixing) override;
+
+private:
+    class PrefetchedSource;
+    struct Shared;
+
+    rtc::scoped_refptr<webrtc::AudioMixer> _mixer;
+    int _deadlineUs = 0;
+    // With the pool's tasks, which may outlive a Mix() given up on.
+    std::shared_ptr<Shared> _shared;
+};
+
+} // namespace tgcalls
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef TGCALLS_SSRC_EXPIRY_WHEEL_H
+#define TGCALLS_SSRC_EXPIRY_WHEEL_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+
+namespace tgcalls {
+
+// Finds the SSRCs that saw no activity for a while, without scanning all of
+// them. Each tracked SSRC sits in one slot of a timer wheel, the one of the
+// tick it may expire at; touch() only records the activity, and an SSRC
+// found active when its slot comes up is moved to the slot of its new
+// deadline. So touch() is O(1) and each SSRC is looked at about once per
+// timeout, however many packets it has.
+class SsrcExpiryWheel {
+public:
+    SsrcExpiryWheel(int64_t timeoutMs, int64_t tickMs) :
+    _timeoutMs(std::max<int64_t>(timeoutMs, 1)),
+    _tickMs(std::max<int64_t>(tickMs, 1)),
+    _slots(_timeoutMs / _tickMs + 2) {
+    }
+
+    void touch(uint32_t ssrc, int64_t timestamp) {
+        auto it = _entries.find(ssrc);
+        if (it != _entries.end()) {
+            it->second.lastActivity = std::max(it->second.lastActivity, timestamp);
+            return;
+        }
+        it = _entries.emplace(ssrc, Entry()).first;
+        it->second.lastActivity = timestamp;
+        schedule(ssrc, it->second);
+    }
+
+    void forget(uint32_t ssrc) {
+        // Left in its slot; advance() skips SSRCs it doesn't know.
+        _entries.erase(ssrc);
+    }
+
+    // Returns the SSRCs idle for the timeout as of |timestamp|, which are
+    // forgotten.
+    std::vector<uint32_t> advance(int64_t timestamp) {
+        std::vector<uint32_t> expired;
+        const int64_t tick = timestamp / _tickMs;
+        if (_currentTick < 0) {
+            _currentTick = tick;
+        }
+        // After a long stall every slot is due, but once is enough.
+        const int64_t firstTick = std::max(_currentTick, tick - (int64_t)_slots.size() + 1);
+        for (int64_t current = firstTick; current <= tick; current++) {
+            auto due = std::move(_slots[current % _slots.size()]);
+            _slots[current % _slots.size()].clear();
+            for (const auto ssrc : due) {
+                // Also skips what an SSRC forgotten and touched again left
+                // in the slot of its old deadline.
+                auto it = _entries.find(ssrc);
+                if (it == _entries.end() || it->second.deadlineTick > current || (current - it->second.deadlineTick) % (int64_t)_slots.size() != 0) {
+                    continue;
+                }
+                if (it->second.lastActivity + _timeoutMs <= timestamp) {
+                    expired.push_back(ssrc);
+                    _entries.erase(it);
+                } else {
+                    schedule(ssrc, it->second);
+                }
+            }
+        }
+        _currentTick = tick + 1;
+        return expired;
+    }
+
+    size_t size() const {
+        return _entries.size();
+    }
+
+private:
+    struct Entry {
+        int64_t lastActivity = 0;
+        int64_t deadlineTick = 0;
+    };
+
+    void schedule(uint32_t ssrc, Entry &entry) {
+        // Rounded up, so it's never due before its deadline.
+        int64_t tick = (entry.lastActivity + _timeoutMs + _tickMs - 1) / _tickMs;
+        if (_currentTick >= 0) {
+            tick = std::max(tick, _currentTick);
+        }
+        entry.deadlineTick = tick;
+        _slots[tick % _slots.size()].push_back(ssrc);
+    }
+
+    int64_t _timeoutMs = 0;
+    int64_t _tickMs = 0;
+    std::vector<std::vector<uint32_t>> _slots;
+    int64_t _currentTick = -1;
+    absl::flat_hash_map<uint32_t, Entry> _entries;
+
+};
+
+} // namespace tgcalls
+
+#endif
@@ -1,5 +1,9 @@
 #include "StreamingPart.h"
 
+#include "AudioDsp.h"
+
+#include "absl/strings/match.h"
+#include "modules/audio_coding/codecs/opus/opus_interface.h"
 #include "rtc_base/logging.h"
 #include "rtc_base/third_party/base64/base64.h"
 
@@ -9,9 +13,12 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 }
 
+#include <algorithm>
+#include <array>
 #include <string>
 #include <set>
 #include <map>
+#include <memory>
 #include <stdint.h>
 
 namespace tgcalls {
@@ -76,10 +83,741 @@ static std::vector<ChannelUpdate> parseChannelUpdates(std::string const &data, i
     return result;
 }
 
+static uint16_t readUInt16LE(const uint8_t *data) {
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+static uint32_t readUInt32LE(const uint8_t *data) {
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static int64_t readInt64LE(const uint8_t *data) {
+    return (int64_t)((uint64_t)readUInt32LE(data) | ((uint64_t)readUInt32LE(data + 4) << 32));
+}
+
+// The frames of one elementary stream of an Opus packet (RFC 6716, section
+// 3.2), pointing into the packet.
+struct OpusStreamFrames {
+    static constexpr int kMaxFrames = 48;
+
+    uint8_t toc = 0;
+    int count = 0;
+    std::array<const uint8_t *, kMaxFrames> frames = {};
+    std::array<int, kMaxFrames> sizes = {};
+    // Bytes of the packet the stream takes, padding included.
+    size_t packetBytes = 0;
+};
+
+static int parseOpusFrameSize(const uint8_t *data, size_t length, int &size) {
+    if (length < 1) {
+        return -1;
+    }
+    if (data[0] < 252) {
+        size = data[0];
+        return 1;
+    }
+    if (length < 2) {
+        return -1;
+    }
+    size = 4 * data[1] + data[0];
+    return 2;
+}
+
+// Splits the stream at the start of |data|. Every stream of a multistream
+// packet but the last uses self-delimiting framing (RFC 6716, appendix B),
+// which adds the size of the last frame.
+static bool parseOpusStream(const uint8_t *data, size_t length, bool isSelfDelimited, OpusStreamFrames &result) {
+    const uint8_t *start = data;
+    if (length < 1) {
+        return false;
+    }
+    result.toc = *data++;
+    length--;
+
+    int lastSize = (int)length;
+    int padding = 0;
+    bool isCbr = false;
+    switch (result.toc & 0x3) {
+        case 0: {
+            result.count = 1;
+            break;
+        }
+        case 1: {
+            result.count = 2;
+            isCbr = true;
+            if (!isSelfDelimited) {
+                if (length & 1) {
+                    return false;
+                }
+                lastSize = (int)length / 2;
+                result.sizes[0] = lastSize;
+            }
+            break;
+        }
+        case 2: {
+            result.count = 2;
+            int bytes = parseOpusFrameSize(data, length, result.sizes[0]);
+            if (bytes < 0) {
+                return false;
+            }
+            length -= bytes;
+            if (result.sizes[0] > (int)length) {
+                return false;
+            }
+            data += bytes;
+            lastSize = (int)length - result.sizes[0];
+            break;
+        }
+        default: {
+            if (length < 1) {
+                return false;
+            }
+            uint8_t countByte = *data++;
+            length--;
+            result.count = countByte & 0x3f;
+            if (result.count <= 0 || result.count > OpusStreamFrames::kMaxFrames) {
+                return false;
+            }
+            if (countByte & 0x40) {
+                uint8_t paddingByte = 0;
+                do {
+                    if (length < 1) {
+                        return false;
+                    }
+                    paddingByte = *data++;
+                    length--;
+                    int paddingBytes = paddingByte == 255 ? 254 : paddingByte;
+                    if ((size_t)paddingBytes > length) {
+                        return false;
+                    }
+                    length -= paddingBytes;
+                    padding += paddingBytes;
+                } while (paddingByte == 255);
+            }
+            isCbr = !(countByte & 0x80);
+            if (!isCbr) {
+                lastSize = (int)length;
+                for (int i = 0; i < result.count - 1; i++) {
+                    int bytes = parseOpusFrameSize(data, length, result.sizes[i]);
+                    if (bytes < 0) {
+                        return false;
+                    }
+                    length -= bytes;
+                    if (result.sizes[i] > (int)length) {
+                        return false;
+                    }
+                    data += bytes;
+                    lastSize -= bytes + result.sizes[i];
+                }
+                if (lastSize < 0) {
+                    return false;
+                }
+            } else if (!isSelfDelimited) {
+                lastSize = (int)length / result.count;
+                if (lastSize * result.count != (int)length) {
+                    return false;
+                }
+                for (int i = 0; i < result.count - 1; i++) {
+                    result.sizes[i] = lastSize;
+                }
+            }
+            break;
+        }
+    }
+
+    if (isSelfDelimited) {
+        int &size = result.sizes[result.count - 1];
+        int bytes = parseOpusFrameSize(data, length, size);
+        if (bytes < 0) {
+            return false;
+        }
+        length -= bytes;
+        if (size > (int)length) {
+            return false;
+        }
+        data += bytes;
+        if (isCbr) {
+            if ((size_t)size * result.count > length) {
+                return false;
+            }
+            for (int i = 0; i < result.count - 1; i++) {
+                result.sizes[i] = size;
+            }
+        } else if (bytes + size > lastSize) {
+            return false;
+        }
+    } else {
+        if (lastSize > 1275) {
+            return false;
+        }
+        result.sizes[result.count - 1] = lastSize;
+    }
+
+    for (int i = 0; i < result.count; i++) {
+        result.frames[i] = data;
+        data += result.sizes[i];
+    }
+    result.packetBytes = (size_t)(data - start) + padding;
+    return true;
+}
+
+// Samples per frame at 48 kHz of a packet with |toc|.
+static int opusSamplesPerFrame(uint8_t toc) {
+    if (toc & 0x80) {
+        return (48000 << ((toc >> 3) & 0x3)) / 400;
+    } else if ((toc & 0x60) == 0x60) {
+        return (toc & 0x08) ? 960 : 480;
+    } else {
+        int size = (toc >> 3) & 0x3;
+        return size == 3 ? 2880 : (48000 << size) / 100;
+    }
+}
+
+// Rebuilds a self-delimited stream as a standalone packet: code 0 for one
+// frame, code 3 with explicit sizes for more.
+static void writeStandaloneOpusPacket(OpusStreamFrames const &stream, std::vector<uint8_t> &packet) {
+    packet.clear();
+    if (stream.count == 1) {
+        packet.push_back(stream.toc & 0xfc);
+    } else {
+        packet.push_back((stream.toc & 0xfc) | 0x3);
+        packet.push_back((uint8_t)(0x80 | stream.count));
+        for (int i = 0; i < stream.count - 1; i++) {
+            int size = stream.sizes[i];
+            if (size < 252) {
+                packet.push_back((uint8_t)size);
+            } else {
+                uint8_t first = (uint8_t)(252 + (size & 0x3));
+                packet.push_back(first);
+                packet.push_back((uint8_t)((size - first) >> 2));
+            }
+        }
+    }
+    for (int i = 0; i < stream.count; i++) {
+        packet.insert(packet.end(), stream.frames[i], stream.frames[i] + stream.sizes[i]);
+    }
+}
+
+// Walks the packets of the first logical stream of an Ogg file in place.
+// Packets are returned as pointers into the file data; only the rare packet
+// that spans pages is gathered into a buffer. Page CRCs are not checked,
+// the parts come over a reliable transport.
+class OggPacketReader {
+public:
+    static constexpr size_t kPageHeaderSize = 27;
+
+    OggPacketReader(const uint8_t *data, size_t size) :
+    _data(data),
+    _size(size) {
+    }
+
+    // False at the end of the stream or on a malformed page. The packet stays
+    // valid until the next call.
+    bool next(const uint8_t *&packet, size_t &packetSize) {
+        while (true) {
+            if (_segmentIndex >= _segmentCount) {
+                if (!readPage()) {
+                    return false;
+                }
+                continue;
+            }
+
+            const uint8_t *start = _data + _bodyOffset;
+            size_t length = 0;
+            bool isComplete = false;
+            while (_segmentIndex < _segmentCount) {
+                uint8_t lacing = _data[_segmentTableOffset + _segmentIndex];
+                _segmentIndex++;
+                length += lacing;
+                if (lacing < 255) {
+                    isComplete = true;
+                    break;
+                }
+            }
+            _bodyOffset += length;
+
+            if (_skipContinuedPacket) {
+                // The tail of a packet whose head was on a page we never saw.
+                _skipContinuedPacket = !isComplete;
+                continue;
+            }
+            if (!isComplete) {
+                _continuedPacket.insert(_continuedPacket.end(), start, start + length);
+                continue;
+            }
+            if (_continuedPacket.empty()) {
+                packet = start;
+                packetSize = length;
+                return true;
+            }
+            _continuedPacket.insert(_continuedPacket.end(), start, start + length);
+            _packet.swap(_continuedPacket);
+            _continuedPacket.clear();
+            packet = _packet.data();
+            packetSize = _packet.size();
+            return true;
+        }
+    }
+
+    // Granule position of the stream's last page that ends a packet, found
+    // from the page headers alone; -1 if there is none.
+    int64_t findLastGranulePosition() const {
+        int64_t result = -1;
+        size_t offset = 0;
+        size_t bodySize = 0;
+        while (parsePageHeader(offset, bodySize)) {
+            int64_t granulePosition = readInt64LE(_data + offset + 6);
+            if (readUInt32LE(_data + offset + 14) == _serial && granulePosition != -1) {
+                result = granulePosition;
+            }
+            offset += kPageHeaderSize + _data[offset + 26] + bodySize;
+        }
+        return result;
+    }
+
+private:
+    bool parsePageHeader(size_t offset, size_t &bodySize) const {
+        if (offset + kPageHeaderSize > _size || memcmp(_data + offset, "OggS", 4) != 0 || _data[offset + 4] != 0) {
+            return false;
+        }
+        size_t segmentCount = _data[offset + 26];
+        if (offset + kPageHeaderSize + segmentCount > _size) {
+            return false;
+        }
+        bodySize = 0;
+        for (size_t i = 0; i < segmentCount; i++) {
+            bodySize += _data[offset + kPageHeaderSize + i];
+        }
+        return offset + kPageHeaderSize + segmentCount + bodySize <= _size;
+    }
+
+    bool readPage() {
+        while (true) {
+            size_t bodySize = 0;
+            if (!parsePageHeader(_pageOffset, bodySize)) {
+                return false;
+            }
+            uint8_t headerType = _data[_pageOffset + 5];
+            uint32_t serial = readUInt32LE(_data + _pageOffset + 14);
+            size_t segmentCount = _data[_pageOffset + 26];
+
+            size_t pageOffset = _pageOffset;
+            _pageOffset += kPageHeaderSize + segmentCount + bodySize;
+
+            if (!_hasSerial) {
+                _serial = serial;
+                _hasSerial = true;
+            } else if (serial != _serial) {
+                continue;
+            }
+
+            bool isContinued = (headerType & 0x01) != 0;
+            if (!isContinued && !_continuedPacket.empty()) {
+                _continuedPacket.clear();
+            }
+            _skipContinuedPacket = isContinued && _continuedPacket.empty();
+
+            _segmentTableOffset = pageOffset + kPageHeaderSize;
+            _segmentCount = segmentCount;
+            _segmentIndex = 0;
+            _bodyOffset = _segmentTableOffset + segmentCount;
+            return true;
+        }
+    }
+
+private:
+    const uint8_t *_data = nullptr;
+    size_t _size = 0;
+
+    bool _hasSerial = false;
+    uint32_t _serial = 0;
+
+    size_t _pageOffset = 0;
+    size_t _segmentTableOffset = 0;
+    size_t _segmentCount = 0;
+    size_t _segmentIndex = 0;
+    size_t _bodyOffset = 0;
+
+    bool _skipContinuedPacket = false;
+    std::vector<uint8_t> _continuedPacket;
+    std::vector<uint8_t> _packet;
+};
+
+// Channel layout an Opus multistream decoder is created for.
+struct OpusDecoderLayout {
+    int channelCount = 0;
+    int streams = 0;
+    int coupledStreams = 0;
+    std::array<uint8_t, 8> mapping = {};
+
+    bool operator==(OpusDecoderLayout const &other) const {
+        return channelCount == other.channelCount && streams == other.streams && coupledStreams == other.coupledStreams && mapping == other.mapping;
+    }
+};
+
+// Idle decoders of the parts decoded on the current thread, so consecutive
+// parts of a stream reset a decoder instead of allocating a new one. Room for
+// the single stream decoders of a part decoded selectively, too.
+class OpusDecoderCache {
+public:
+    static constexpr size_t kMaxIdleDecoders = 8;
+
+    ~OpusDecoderCache() {
+        for (auto &it : _decoders) {
+            WebRtcOpus_DecoderFree(it.second);
+        }
+    }
+
+    static OpusDecoderCache &current() {
+        static thread_local OpusDecoderCache cache;
+        return cache;
+    }
+
+    OpusDecInst *acquire(OpusDecoderLayout const &layout) {
+        for (auto it = _decoders.begin(); it != _decoders.end(); it++) {
+            if (it->first == layout) {
+                OpusDecInst *decoder = it->second;
+                _decoders.erase(it);
+                WebRtcOpus_DecoderInit(decoder);
+                return decoder;
+            }
+        }
+        OpusDecInst *decoder = nullptr;
+        if (WebRtcOpus_MultistreamDecoderCreate(&decoder, layout.channelCount, layout.streams, layout.coupledStreams, layout.mapping.data()) != 0) {
+            return nullptr;
+        }
+        return decoder;
+    }
+
+    void release(OpusDecoderLayout const &layout, OpusDecInst *decoder) {
+        if (_decoders.size() >= kMaxIdleDecoders) {
+            WebRtcOpus_DecoderFree(_decoders.front().second);
+            _decoders.erase(_decoders.begin());
+        }
+        _decoders.emplace_back(layout, decoder);
+    }
+
+private:
+    std::vector<std::pair<OpusDecoderLayout, OpusDecInst *>> _decoders;
+};
+
+// Decodes an Ogg Opus part (RFC 7845) straight from its buffer with the
+// webrtc Opus decoder, without libavformat probing or buffered reads.
+class OggOpusPartReader {
+public:
+    // 120 ms, the longest Opus packet, at 48 kHz.
+    static constexpr int kMaxPacketSamples = 5760;
+
+    OggOpusPartReader(std::vector<uint8_t> const &fileData) :
+    _reader(fileData.data(), fileData.size()) {
+    }
+
+    ~OggOpusPartReader() {
+        if (_decoder) {
+            OpusDecoderCache::current().release(_layout, _decoder);
+        }
+        for (auto &stream : _streams) {
+            if (stream.decoder) {
+                OpusDecoderCache::current().release(stream.layout, stream.decoder);
+            }
+        }
+    }
+
+    // False if the part isn't Ogg Opus or its headers are malformed.
+    bool open() {
+        const uint8_t *packet = nullptr;
+        size_t packetSize = 0;
+        if (!_reader.next(packet, packetSize) || !parseOpusHead(packet, packetSize)) {
+            return false;
+        }
+        if (!_reader.next(packet, packetSize) || !parseOpusTags(packet, packetSize)) {
+            return false;
+        }
+
+        int64_t lastGranulePosition = _reader.findLastGranulePosition();
+        _remainingSamples = std::max((int64_t)0, lastGranulePosition - _preSkipSamples);
+        _durationInMilliseconds = (int)(_remainingSamples * 1000 / 48000);
+        return true;
+    }
+
+    int getDurationInMilliseconds() const {
+        return _durationInMilliseconds;
+    }
+
+    int getChannelCount() const {
+        return _channelCount;
+    }
+
+    std::vector<ChannelUpdate> const &getChannelUpdates() const {
+        return _channelUpdates;
+    }
+
+    // Decodes only the elementary streams carrying the channels set in
+    // |channelMask|, leaving the others silent. Must be called before the
+    // first packet is decoded.
+    void setDecodedChannels(uint32_t channelMask) {
+        std::vector<bool> isStreamDecoded(_layout.streams, false);
+        for (int channel = 0; channel < _channelCount; channel++) {
+            int coded = _layout.mapping[channel];
+            if (!(channelMask & (1u << channel)) || coded == 255) {
+                continue;
+            }
+            int stream = coded < 2 * _layout.coupledStreams ? coded / 2 : coded - _layout.coupledStreams;
+            if (stream < _layout.streams) {
+                isStreamDecoded[stream] = true;
+            }
+        }
+        if (std::find(isStreamDecoded.begin(), isStreamDecoded.end(), false) == isStreamDecoded.end()) {
+            return;
+        }
+
+        if (_decoder) {
+            OpusDecoderCache::current().release(_layout, _decoder);
+            _decoder = nullptr;
+        }
+        _streams.resize(_layout.streams);
+        for (int i = 0; i < _layout.streams; i++) {
+            if (!isStreamDecoded[i]) {
+                continue;
+            }
+            auto &stream = _streams[i];
+            stream.layout.channelCount = i < _layout.coupledStreams ? 2 : 1;
+            stream.layout.streams = 1;
+            stream.layout.coupledStreams = stream.layout.channelCount - 1;
+            stream.layout.mapping[0] = 0;
+            stream.layout.mapping[1] = 1;
+            stream.decoder = OpusDecoderCache::current().acquire(stream.layout);
+        }
+        _channelSources.clear();
+        for (int channel = 0; channel < _channelCount; channel++) {
+            int coded = _layout.mapping[channel];
+            if (!(channelMask & (1u << channel)) || coded == 255) {
+                continue;
+            }
+            ChannelSource source;
+            source.channel = channel;
+            source.stream = coded < 2 * _layout.coupledStreams ? coded / 2 : coded - _layout.coupledStreams;
+            source.streamChannel = coded < 2 * _layout.coupledStreams ? coded % 2 : 0;
+            if (source.stream < _layout.streams && _streams[source.stream].decoder) {
+                _channelSources.push_back(source);
+            }
+        }
+    }
+
+    // Decodes the next packet into |pcm| as interleaved s16. Sets the range
+    // of frames to play, after pre-skip and end trimming; false at the end.
+    bool decodeNextPacket(std::vector<int16_t> &pcm, int &sampleOffset, int &sampleSize) {
+        while (_remainingSamples > 0) {
+            const uint8_t *packet = nullptr;
+            size_t packetSize = 0;
+            if (!_reader.next(packet, packetSize)) {
+                return false;
+            }
+            if (packetSize == 0) {
+                continue;
+            }
+
+            if (pcm.size() < (size_t)(kMaxPacketSamples * _channelCount)) {
+                pcm.resize(kMaxPacketSamples * _channelCount);
+            }
+            int decodedSamples = 0;
+            if (_decoder) {
+                int16_t audioType = 0;
+                decodedSamples = WebRtcOpus_Decode(_decoder, packet, packetSize, pcm.data(), &audioType);
+            } else {
+                decodedSamples = decodeSelectedStreams(packet, packetSize, pcm.data());
+            }
+            if (decodedSamples <= 0) {
+                return false;
+            }
+
+            int skipSamples = std::min(decodedSamples, _remainingPreSkipSamples);
+            _remainingPreSkipSamples -= skipSamples;
+            int playSamples = (int)std::min((int64_t)(decodedSamples - skipSamples), _remainingSamples);
+            _remainingSamples -= playSamples;
+            if (playSamples == 0) {
+                continue;
+            }
+
+            sampleOffset = skipSamples;
+            sampleSize = skipSamples + playSamples;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct StreamDecoder {
+        OpusDecoderLayout layout;
+        // Null for a stream that is skipped.
+        OpusDecInst *decoder = nullptr;
+    };
+
+    struct ChannelSource {
+        int channel = 0;
+        int stream = 0;
+        int streamChannel = 0;
+    };
+
+    // Splits a multistream packet and decodes only the streams set up by
+    // setDecodedChannels(), returning the samples per channel written to
+    // |pcm| or 0 if the packet is malformed.
+    int decodeSelectedStreams(const uint8_t *packet, size_t packetSize, int16_t *pcm) {
+        int samples = -1;
+        for (int i = 0; i < _layout.streams; i++) {
+            const bool isLast = i == _layout.streams - 1;
+            OpusStreamFrames frames;
+            if (!parseOpusStream(packet, packetSize, !isLast, frames)) {
+                return 0;
+            }
+            int streamSamples = frames.count * opusSamplesPerFrame(frames.toc);
+            if (samples < 0) {
+                samples = streamSamples;
+                if (samples > kMaxPacketSamples) {
+                    return 0;
+                }
+                std::fill(pcm, pcm + samples * _channelCount, 0);
+            } else if (streamSamples != samples) {
+                return 0;
+            }
+
+            auto &stream = _streams[i];
+            if (stream.decoder) {
+                const uint8_t *streamPacket = packet;
+                size_t streamPacketSize = packetSize;
+                if (!isLast) {
+                    writeStandaloneOpusPacket(frames, _streamPacket);
+                    streamPacket = _streamPacket.data();
+                    streamPacketSize = _streamPacket.size();
+                }
+                _streamPcm.resize(kMaxPacketSamples * 2);
+                int16_t audioType = 0;
+                int decoded = WebRtcOpus_Decode(stream.decoder, streamPacket, streamPacketSize, _streamPcm.data(), &audioType);
+                if (decoded != samples) {
+                    return 0;
+                }
+                for (const auto &source : _channelSources) {
+                    if (source.stream != i) {
+                        continue;
+                    }
+                    const int16_t *from = _streamPcm.data() + source.streamChannel;
+                    int16_t *to = pcm + source.channel;
+                    for (int sample = 0; sample < samples; sample++) {
+                        to[sample * _channelCount] = from[sample * stream.layout.channelCount];
+                    }
+                }
+            }
+
+            packet += frames.packetBytes;
+            packetSize -= frames.packetBytes;
+        }
+        return std::max(samples, 0);
+    }
+
+    bool parseOpusHead(const uint8_t *packet, size_t packetSize) {
+        if (packetSize < 19 || memcmp(packet, "OpusHead", 8) != 0 || (packet[8] & 0xf0) != 0) {
+            return false;
+        }
+        int channelCount = packet[9];
+        _preSkipSamples = readUInt16LE(packet + 10);
+        _remainingPreSkipSamples = _preSkipSamples;
+        uint8_t mappingFamily = packet[18];
+
+        if (channelCount < 1 || channelCount > 8) {
+            return false;
+        }
+        _layout.channelCount = channelCount;
+        if (mappingFamily == 0) {
+            if (channelCount > 2) {
+                return false;
+            }
+            _layout.streams = 1;
+            _layout.coupledStreams = channelCount - 1;
+            _layout.mapping[0] = 0;
+            _layout.mapping[1] = 1;
+        } else {
+            if (packetSize < 21 + (size_t)channelCount) {
+                return false;
+            }
+            _layout.streams = packet[19];
+            _layout.coupledStreams = packet[20];
+            memcpy(_layout.mapping.data(), packet + 21, channelCount);
+        }
+
+        _decoder = OpusDecoderCache::current().acquire(_layout);
+        if (!_decoder) {
+            return false;
+        }
+        _channelCount = channelCount;
+        return true;
+    }
+
+    bool parseOpusTags(const uint8_t *packet, size_t packetSize) {
+        if (packetSize < 16 || memcmp(packet, "OpusTags", 8) != 0) {
+            return false;
+        }
+        size_t offset = 8;
+        size_t vendorLength = readUInt32LE(packet + offset);
+        offset += 4;
+        if (vendorLength > packetSize - offset - 4) {
+            return false;
+        }
+        offset += vendorLength;
+        uint32_t commentCount = readUInt32LE(packet + offset);
+        offset += 4;
+
+        static const absl::string_view metaKey = "TG_META=";
+        for (uint32_t i = 0; i < commentCount; i++) {
+            if (packetSize - offset < 4) {
+                return false;
+            }
+            size_t commentLength = readUInt32LE(packet + offset);
+            offset += 4;
+            if (commentLength > packetSize - offset) {
+                return false;
+            }
+            absl::string_view comment((const char *)packet + offset, commentLength);
+            offset += commentLength;
+
+            if (absl::StartsWithIgnoreCase(comment, metaKey)) {
+                std::string result;
+                size_t data_used = 0;
+                std::string sourceBase64(comment.substr(metaKey.size()));
+                rtc::Base64::Decode(sourceBase64, rtc::Base64::DO_LAX, &result, &data_used);
+
+                if (result.size() != 0) {
+                    int metaOffset = 0;
+                    _channelUpdates = parseChannelUpdates(result, metaOffset);
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    OggPacketReader _reader;
+    OpusDecoderLayout _layout;
+    // The whole multistream decoder, or null when only some streams are
+    // decoded, each with its own entry of |_streams|.
+    OpusDecInst *_decoder = nullptr;
+    std::vector<StreamDecoder> _streams;
+    std::vector<ChannelSource> _channelSources;
+    std::vector<uint8_t> _streamPacket;
+    std::vector<int16_t> _streamPcm;
+
+    int _channelCount = 0;
+    int _preSkipSamples = 0;
+    int _remainingPreSkipSamples = 0;
+    int64_t _remainingSamples = 0;
+    int _durationInMilliseconds = 0;
+
+    std::vector<ChannelUpdate> _channelUpdates;
+};
+
 class AVIOContextImpl {
 public:
-    AVIOContextImpl(std::vector<uint8_t> &&fileData) :
-    _fileData(std::move(fileData)) {
+    AVIOContextImpl(std::vector<uint8_t> const &fileData) :
+    _fileData(fileData) {
         _buffer.resize(4 * 1024);
         _context = avio_alloc_context(_buffer.data(), (int)_buffer.size(), 0, this, &AVIOContextImpl::read, NULL, &AVIOContextImpl::seek);
     }
@@ -126,7 +864,7 @@ public:
     }
 
 private:
-    std::vector<uint8_t> _fileData;
+    std::vector<uint8_t> const &_fileData;
     int _fileReadPosition = 0;
 
     std::vector<uint8_t> _buffer;
@@ -140,10 +878,57 @@ struct ReadPcmResult {
     int numChannels = 0;
 };
 
+// Converts a decoded frame to interleaved s16 with the kernels of its
+// channel count.
+using FrameConverter = void (*)(const AVFrame *frame, AudioChannelKernels const &kernels, int16_t *out);
+
+// The converter for frames of |format|, picked once per stream; null for
+// formats that aren't decoded.
+static FrameConverter frameConverterForFormat(AVSampleFormat format) {
+    switch (format) {
+        case AV_SAMPLE_FMT_S16: {
+            return [](const AVFrame *frame, AudioChannelKernels const &, int16_t *out) {
+                memcpy(out, frame->data[0], frame->nb_samples * 2 * frame->channels);
+            };
+        }
+        case AV_SAMPLE_FMT_S16P: {
+            return [](const AVFrame *frame, AudioChannelKernels const &kernels, int16_t *out) {
+                kernels.interleaveS16((const int16_t *const *)frame->data, frame->channels, frame->nb_samples, out);
+            };
+        }
+        case AV_SAMPLE_FMT_FLT: {
+            return [](const AVFrame *frame, AudioChannelKernels const &, int16_t *out) {
+                AudioFloatToS16((const float *)frame->data[0], frame->nb_samples * frame->channels, out);
+            };
+        }
+        case AV_SAMPLE_FMT_FLTP: {
+            return [](const AVFrame *frame, AudioChannelKernels const &kernels, int16_t *out) {
+                kernels.interleaveFloat((const float *const *)frame->data, frame->channels, frame->nb_samples, out);
+            };
+        }
+        default: {
+            return nullptr;
+        }
+    }
+}
+
 class StreamingPartInternal {
 public:
     StreamingPartInternal(std::vector<uint8_t> &&fileData) :
-    _avIoContext(std::move(fileData)) {
+    _fileData(std::move(fileData)),
+    _oggOpusReader(std::make_unique<OggOpusPartReader>(_fileData)) {
+        if (_oggOpusReader->open()) {
+            _durationInMilliseconds = _oggOpusReader->getDurationInMilliseconds();
+            _channelCount = _oggOpusReader->getChannelCount();
+            _channelKernels = &AudioKernelsForChannels(_channelCount);
+            _channelUpdates = _oggOpusReader->getChannelUpdates();
+            return;
+        }
+        _oggOpusReader.reset();
+
+        // Not Ogg Opus: let libavformat demux it.
+        _avIoContext = std::make_unique<AVIOContextImpl>(_fileData);
+
         int ret = 0;
 
         _frame = av_frame_alloc();
@@ -160,7 +945,7 @@ public:
             return;
         }
 
-        _inputFormatContext->pb = _avIoContext.getContext();
+        _inputFormatContext->pb = _avIoContext->getContext();
 
         if ((ret = avformat_open_input(&_inputFormatContext, "", inputFormat, nullptr)) < 0) {
             _didReadToEnd = true;
@@ -221,9 +1006,13 @@ public:
                     _codecContext->pkt_timebase = audioStream->time_base;
 
                     _channelCount = _codecContext->channels;
+                    _channelKernels = &AudioKernelsForChannels(_channelCount);
 
                     ret = avcodec_open2(_codecContext, codec, nullptr);
-                    if (ret < 0) {
+                    if (ret >= 0) {
+                        _convertFrame = frameConverterForFormat(_codecContext->sample_fmt);
+                    }
+                    if (ret < 0 || !_convertFrame) {
                         _didReadToEnd = true;
 
                         avcodec_free_context(&_codecContext);
@@ -284,15 +1073,23 @@ public:
         return _channelCount;
     }
 
+    AudioChannelKernels const &getChannelKernels() const {
+        return *_channelKernels;
+    }
+
     std::vector<ChannelUpdate> const &getChannelUpdates() {
         return _channelUpdates;
     }
 
-private:
-    static int16_t sampleFloatToInt16(float sample) {
-      return av_clip_int16 (static_cast<int32_t>(lrint(sample*32767)));
+    // Channels outside |channelMask| may come out silent. Only Ogg Opus parts
+    // skip decoding them; libavcodec decodes every channel.
+    void setDecodedChannels(uint32_t channelMask) {
+        if (_oggOpusReader) {
+            _oggOpusReader->setDecodedChannels(channelMask);
+        }
     }
 
+private:
     void fillPcmBuffer() {
         _pcmBufferSampleSize = 0;
         _pcmBufferSampleOffset = 0;
@@ -300,6 +1097,14 @@ private:
         if (_didReadToEnd) {
             return;
         }
+        if (_oggOpusReader) {
+            if (!_oggOpusReader->decodeNextPacket(_pcmBuffer, _pcmBufferSampleOffset, _pcmBufferSampleSize)) {
+                _didReadToEnd = true;
+                _pcmBufferSampleOffset = 0;
+                _pcmBufferSampleSize = 0;
+            }
+            return;
+        }
         if (!_inputFormatContext) {
             _didReadToEnd = true;
             return;
@@ -323,12 +1128,6 @@ private:
             return;
           }
 
-          int bytesPerSample = av_get_bytes_per_sample(_codecContext->sample_fmt);
-          if (bytesPerSample != 2 && bytesPerSample != 4) {
-            _didReadToEnd = true;
-            return;
-          }
-
           ret = avcodec_receive_frame(_codecContext, _frame);
         } while (ret == AVERROR(EAGAIN));
 
@@ -345,59 +1144,28 @@ private:
             _pcmBuffer.resize(_frame->nb_samples * _frame->channels);
         }
 
-        switch (_codecContext->sample_fmt) {
-        case AV_SAMPLE_FMT_S16: {
-            memcpy(_pcmBuffer.data(), _frame->data[0], _frame->nb_samples * 2 * _frame->channels);
-        } break;
-
-        case AV_SAMPLE_FMT_S16P: {
-            int16_t *to = _pcmBuffer.data();
-            for (int sample = 0; sample < _frame->nb_samples; ++sample) {
-                for (int channel = 0; channel < _frame->channels; ++channel) {
-                    int16_t *shortChannel = (int16_t*)_frame->data[channel];
-                    *to++ = shortChannel[sample];
-                }
-            }
-        } break;
-
-        case AV_SAMPLE_FMT_FLT: {
-			float *floatData = (float *)&_frame->data[0];
-			for (int i = 0; i < _frame->nb_samples * _frame->channels; i++) {
-				_pcmBuffer[i] = sampleFloatToInt16(floatData[i]);
-			}
-        } break;
-
-        case AV_SAMPLE_FMT_FLTP: {
-			int16_t *to = _pcmBuffer.data();
-			for (int sample = 0; sample < _frame->nb_samples; ++sample) {
-				for (int channel = 0; channel < _frame->channels; ++channel) {
-					float *floatChannel = (float*)_frame->data[channel];
-					*to++ = sampleFloatToInt16(floatChannel[sample]);
-				}
-			}
-        } break;
-
-        default: {
-            RTC_FATAL() << "Unexpected sample_fmt";
-        } break;
-        }
+        _convertFrame(_frame, *_channelKernels, _pcmBuffer.data());
 
         _pcmBufferSampleSize = _frame->nb_samples;
         _pcmBufferSampleOffset = 0;
     }
 
 private:
-    AVIOContextImpl _avIoContext;
+    std::vector<uint8_t> _fileData;
+    std::unique_ptr<OggOpusPartReader> _oggOpusReader;
+    std::unique_ptr<AVIOContextImpl> _avIoContext;
 
     AVFormatContext *_inputFormatContext = nullptr;
     AVPacket _packet;
     AVCodecContext *_codecContext = nullptr;
     AVFrame *_frame = nullptr;
+    FrameConverter _convertFrame = nullptr;
 
     bool _didReadToEnd = false;
 
     int _durationInMilliseconds = 0;
     int _channelCount = 0;
+    AudioChannelKernels const *_channelKernels = &AudioKernelsForChannels(0);
 
     std::vector<ChannelUpdate> _channelUpdates;
 
@@ -407,17 +1175,8 @@ private:
 };
 
 class StreamingPartState {
-    struct ChannelMapping {
-        uint32_t ssrc = 0;
-        int channelIndex = 0;
-
-        ChannelMapping(uint32_t ssrc_, int channelIndex_) :
-            ssrc(ssrc_), channelIndex(channelIndex_) {
-        }
-    };
-
 public:
-    StreamingPartState(std::vector<uint8_t> &&data) :
+    StreamingPartState(std::vector<uint8_t> &&data, std::vector<uint32_t> const &decodedSsrcs) :
     _parsedPart(std::move(data)) {
         if (_parsedPart.getChannelUpdates().size() == 0) {
             _didReadToEnd = true;
@@ -425,11 +1184,34 @@ public:
         }
 
         _remainingMilliseconds = _parsedPart.getDurationInMilliseconds();
-        _pcm10ms.resize(480 * _parsedPart.getChannelCount());
+        _pcm10ms.resize(StreamingPart::kSamplesPer10ms * _parsedPart.getChannelCount());
+
+        _channelUpdates = _parsedPart.getChannelUpdates();
+        std::stable_sort(_channelUpdates.begin(), _channelUpdates.end(), [](ChannelUpdate const &lhs, ChannelUpdate const &rhs) {
+            return lhs.frameIndex < rhs.frameIndex;
+        });
 
-        for (const auto &it : _parsedPart.getChannelUpdates()) {
-            _allSsrcs.insert(it.ssrc);
+        for (const auto &it : _channelUpdates) {
+            _ssrcs.push_back(it.ssrc);
+        }
+        std::sort(_ssrcs.begin(), _ssrcs.end());
+        _ssrcs.erase(std::unique(_ssrcs.begin(), _ssrcs.end()), _ssrcs.end());
+
+        if (!decodedSsrcs.empty()) {
+            _ssrcs.erase(std::remove_if(_ssrcs.begin(), _ssrcs.end(), [&decodedSsrcs](uint32_t ssrc) {
+                return std::find(decodedSsrcs.begin(), decodedSsrcs.end(), ssrc) == decodedSsrcs.end();
+            }), _ssrcs.end());
+
+            // Every channel any of them is mapped to during the part.
+            uint32_t channelMask = 0;
+            for (const auto &update : _channelUpdates) {
+                if (update.id >= 0 && update.id < 32 && std::binary_search(_ssrcs.begin(), _ssrcs.end(), update.ssrc)) {
+                    channelMask |= 1u << update.id;
+                }
+            }
+            _parsedPart.setDecodedChannels(channelMask);
         }
+        _channelIndexBySsrcIndex.resize(_ssrcs.size(), -1);
     }
 
     ~StreamingPartState() {
@@ -439,12 +1221,19 @@ public:
         return _remainingMilliseconds;
     }
 
-    std::vector<StreamingPart::StreamingPartChannel> get10msPerChannel() {
+    std::vector<uint32_t> const &getSsrcs() const {
+        return _ssrcs;
+    }
+
+    int read10msPerChannel(int16_t *planes) {
         if (_didReadToEnd) {
-            return {};
+            return 0;
         }
 
-        for (const auto &update : _parsedPart.getChannelUpdates()) {
+        // Updates are sorted by frame, so only the ones of this frame are
+        // looked at; SSRC lookups only happen when the mapping changes.
+        while (_nextChannelUpdate < _channelUpdates.size() && _channelUpdates[_nextChannelUpdate].frameIndex <= _frameIndex) {
+            const auto &update = _channelUpdates[_nextChannelUpdate++];
             if (update.frameIndex == _frameIndex) {
                 updateCurrentMapping(update.ssrc, update.id);
             }
@@ -453,28 +1242,17 @@ public:
         auto readResult = _parsedPart.readPcm(_pcm10ms);
         if (readResult.numSamples <= 0) {
             _didReadToEnd = true;
-            return {};
-        }
-
-        std::vector<StreamingPart::StreamingPartChannel> resultChannels;
-        for (const auto ssrc : _allSsrcs) {
-            StreamingPart::StreamingPartChannel emptyPart;
-            emptyPart.ssrc = ssrc;
-            resultChannels.push_back(emptyPart);
+            return 0;
         }
 
-        for (auto &channel : resultChannels) {
-            auto mappedChannelIndex = getCurrentMappedChannelIndex(channel.ssrc);
-
-            if (mappedChannelIndex) {
-                int sourceChannelIndex = mappedChannelIndex.value();
-                for (int j = 0; j < readResult.numSamples; j++) {
-                    channel.pcmData.push_back(_pcm10ms[sourceChannelIndex + j * readResult.numChannels]);
-                }
+        const auto &kernels = _parsedPart.getChannelKernels();
+        for (size_t i = 0; i < _ssrcs.size(); i++) {
+            int16_t *plane = planes + i * StreamingPart::kSamplesPer10ms;
+            int channelIndex = _channelIndexBySsrcIndex[i];
+            if (channelIndex >= 0 && channelIndex < readResult.numChannels) {
+                kernels.extractChannel(_pcm10ms.data(), readResult.numChannels, channelIndex, readResult.numSamples, plane);
             } else {
-                for (int j = 0; j < readResult.numSamples; j++) {
-                    channel.pcmData.push_back(0);
-                }
+                std::fill(plane, plane + readResult.numSamples, 0);
             }
         }
 
@@ -484,46 +1262,69 @@ public:
         }
         _frameIndex++;
 
-        return resultChannels;
+        return readResult.numSamples;
     }
 
-private:
-    absl::optional<int> getCurrentMappedChannelIndex(uint32_t ssrc) {
-        for (const auto &it : _currentChannelMapping) {
-            if (it.ssrc == ssrc) {
-                return it.channelIndex;
-            }
+    std::vector<StreamingPart::StreamingPartChannel> get10msPerChannel() {
+        if (_didReadToEnd) {
+            return {};
         }
-        return absl::nullopt;
+
+        std::vector<int16_t> planes(_ssrcs.size() * StreamingPart::kSamplesPer10ms);
+        int numSamples = read10msPerChannel(planes.data());
+        if (numSamples <= 0) {
+            return {};
+        }
+
+        std::vector<StreamingPart::StreamingPartChannel> resultChannels(_ssrcs.size());
+        for (size_t i = 0; i < _ssrcs.size(); i++) {
+            const int16_t *plane = planes.data() + i * StreamingPart::kSamplesPer10ms;
+            resultChannels[i].ssrc = _ssrcs[i];
+            resultChannels[i].pcmData.assign(plane, plane + numSamples);
+        }
+        return resultChannels;
     }
 
+private:
+    // Keeps every SSRC and every channel in at most one mapping. A channel
+    // taken over by an SSRC that isn't decoded is unmapped all the same.
     void updateCurrentMapping(uint32_t ssrc, int channelIndex) {
-        for (int i = (int)_currentChannelMapping.size() - 1; i >= 0; i--) {
-            const auto &entry = _currentChannelMapping[i];
-            if (entry.ssrc == ssrc && entry.channelIndex == channelIndex) {
-                return;
-            } else if (entry.ssrc == ssrc || entry.channelIndex == channelIndex) {
-                _currentChannelMapping.erase(_currentChannelMapping.begin() + i);
+        auto it = std::lower_bound(_ssrcs.begin(), _ssrcs.end(), ssrc);
+        const bool isKnown = it != _ssrcs.end() && *it == ssrc;
+        size_t ssrcIndex = it - _ssrcs.begin();
+        if (isKnown && _channelIndexBySsrcIndex[ssrcIndex] == channelIndex) {
+            return;
+        }
+        for (auto &mappedChannelIndex : _channelIndexBySsrcIndex) {
+            if (mappedChannelIndex == channelIndex) {
+                mappedChannelIndex = -1;
             }
         }
-        _currentChannelMapping.emplace_back(ssrc, channelIndex);
+        if (isKnown) {
+            _channelIndexBySsrcIndex[ssrcIndex] = channelIndex;
+        }
     }
 
 private:
     StreamingPartInternal _parsedPart;
-    std::set<uint32_t> _allSsrcs;
+
+    std::vector<ChannelUpdate> _channelUpdates;
+    size_t _nextChannelUpdate = 0;
+
+    // Sorted; indexes |_channelIndexBySsrcIndex|, -1 for an unmapped SSRC.
+    std::vector<uint32_t> _ssrcs;
+    std::vector<int> _channelIndexBySsrcIndex;
 
     std::vector<int16_t> _pcm10ms;
-    std::vector<ChannelMapping> _currentChannelMapping;
     int _frameIndex = 0;
     int _remainingMilliseconds = 0;
 
     bool _didReadToEnd = false;
 };
 
-StreamingPart::StreamingPart(std::vector<uint8_t> &&data) {
+StreamingPart::StreamingPart(std::vector<uint8_t> &&data, std::vector<uint32_t> const &decodedSsrcs) {
     if (!data.empty()) {
-        _state = new StreamingPartState(std::move(data));
+        _state = new StreamingPartState(std::move(data), decodedSsrcs);
     }
 }
 
@@ -543,4 +1344,13 @@ std::vector<StreamingPart::StreamingPartChannel> StreamingPart::get10msPerChanne
         : std::vector<StreamingPart::StreamingPartChannel>();
 }
 
+std::vector<uint32_t> const &StreamingPart::getSsrcs() const {
+    static const std::vector<uint32_t> empty;
+    return _state ? _state->getSsrcs() : empty;
+}
+
+int StreamingPart::read10msPerChannel(int16_t *planes) {
+    return _state ? _state->read10msPerChannel(planes) : 0;
+}
+
 }
@@ -16,7 +16,9 @@ public:
         std::vector<int16_t> pcmData;
     };
     
-    explicit StreamingPart(std::vector<uint8_t> &&data);
+    // With |decodedSsrcs| set, only those of the part's SSRCs are read, and
+    // the Opus streams carrying none of them aren't decoded at all.
+    explicit StreamingPart(std::vector<uint8_t> &&data, std::vector<uint32_t> const &decodedSsrcs = {});
     ~StreamingPart();
     
     StreamingPart(const StreamingPart&) = delete;
@@ -27,8 +29,19 @@ public:
     StreamingPart& operator=(const StreamingPart&) = delete;
     StreamingPart& operator=(StreamingPart&&) = delete;
     
+    // Samples per channel of a full 10 ms frame, at 48 kHz.
+    static constexpr int kSamplesPer10ms = 480;
+
     int getRemainingMilliseconds() const;
     std::vector<StreamingPartChannel> get10msPerChannel();
+
+    // SSRCs of the part, in the order their channels are written by
+    // read10msPerChannel(); fixed for the whole part.
+    std::vector<uint32_t> const &getSsrcs() const;
+    // Writes the next 10 ms as one plane of kSamplesPer10ms samples per SSRC
+    // into |planes|, silence for SSRCs not mapped to a channel, and returns
+    // the samples written per plane; 0 at the end. Doesn't allocate.
+    int read10msPerChannel(int16_t *planes);
     
 private:
     StreamingPartState *_state = nullptr;
@@ -0,0 +1,349 @@
+#include "VideoStreamingPart.h"
+
+#include "absl/types/optional.h"
+#include "api/video/i420_buffer.h"
+#include "rtc_base/logging.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+namespace tgcalls {
+
+namespace {
+
+// Of the header that precedes the container.
+constexpr uint32_t kVideoPartSignature = 0xa12e810d;
+
+struct VideoStreamEvent {
+    int32_t offsetMilliseconds = 0;
+    std::string endpointId;
+    int32_t rotation = 0;
+    int32_t extra = 0;
+};
+
+struct VideoStreamInfo {
+    std::string container;
+    int32_t activeMask = 0;
+    std::vector<VideoStreamEvent> events;
+};
+
+absl::optional<int32_t> readInt32(std::vector<uint8_t> const &data, size_t &offset) {
+    if (offset + 4 > data.size()) {
+        return absl::nullopt;
+    }
+    int32_t value = 0;
+    memcpy(&value, data.data() + offset, 4);
+    offset += 4;
+    return value;
+}
+
+// A TL string: a length byte, or 254 and three length bytes, then the
+// bytes, padded to a multiple of four.
+absl::optional<std::string> readSerializedString(std::vector<uint8_t> const &data, size_t &offset) {
+    if (offset + 1 > data.size()) {
+        return absl::nullopt;
+    }
+    size_t length = data[offset];
+    size_t headerLength = 1;
+    if (length == 254) {
+        if (offset + 4 > data.size()) {
+            return absl::nullopt;
+        }
+        length = (size_t)data[offset + 1] | ((size_t)data[offset + 2] << 8) | ((size_t)data[offset + 3] << 16);
+        headerLength = 4;
+    }
+    if (offset + headerLength + length > data.size()) {
+        return absl::nullopt;
+    }
+    std::string result(data.begin() + offset + headerLength, data.begin() + offset + headerLength + length);
+    size_t paddedLength = headerLength + length;
+    paddedLength = (paddedLength + 3) & ~(size_t)3;
+    offset = std::min(data.size(), offset + paddedLength);
+    return result;
+}
+
+// Parses the header and drops it from |data|, leaving the container.
+absl::optional<VideoStreamInfo> consumeVideoStreamInfo(std::vector<uint8_t> &data) {
+    size_t offset = 0;
+    const auto signature = readInt32(data, offset);
+    if (!signature || (uint32_t)signature.value() != kVideoPartSignature) {
+        return absl::nullopt;
+    }
+
+    VideoStreamInfo info;
+    const auto container = readSerializedString(data, offset);
+    const auto activeMask = readInt32(data, offset);
+    const auto eventCount = readInt32(data, offset);
+    if (!container || !activeMask || !eventCount || eventCount.value() < 0) {
+        return absl::nullopt;
+    }
+    info.container = container.value();
+    info.activeMask = activeMask.value();
+    for (int32_t i = 0; i < eventCount.value(); i++) {
+        VideoStreamEvent event;
+        const auto eventOffset = readInt32(data, offset);
+        const auto endpointId = readSerializedString(data, offset);
+        const auto rotation = readInt32(data, offset);
+        const auto extra = readInt32(data, offset);
+        if (!eventOffset || !endpointId || !rotation || !extra) {
+            return absl::nullopt;
+        }
+        event.offsetMilliseconds = eventOffset.value();
+        event.endpointId = endpointId.value();
+        event.rotation = rotation.value();
+        event.extra = extra.value();
+        info.events.push_back(std::move(event));
+    }
+    std::sort(info.events.begin(), info.events.end(), [](VideoStreamEvent const &lhs, VideoStreamEvent const &rhs) {
+        return lhs.offsetMilliseconds < rhs.offsetMilliseconds;
+    });
+
+    data.erase(data.begin(), data.begin() + offset);
+    return info;
+}
+
+// The event in effect at |offsetMilliseconds|; null before the first one.
+VideoStreamEvent const *eventAt(VideoStreamInfo const &info, int offsetMilliseconds) {
+    VideoStreamEvent const *result = nullptr;
+    for (const auto &event : info.events) {
+        if (event.offsetMilliseconds > offsetMilliseconds) {
+            break;
+        }
+        result = &event;
+    }
+    return result;
+}
+
+class VideoAVIOContext {
+public:
+    explicit VideoAVIOContext(std::vector<uint8_t> const &fileData) :
+    _fileData(fileData) {
+        _buffer = static_cast<uint8_t *>(av_malloc(kBufferSize));
+        _context = avio_alloc_context(_buffer, kBufferSize, 0, this, &VideoAVIOContext::read, nullptr, &VideoAVIOContext::seek);
+    }
+
+    ~VideoAVIOContext() {
+        if (_context) {
+            // The context may have swapped its buffer for another.
+            av_freep(&_context->buffer);
+            avio_context_free(&_context);
+        } else {
+            av_free(_buffer);
+        }
+    }
+
+    AVIOContext *getContext() {
+        return _context;
+    }
+
+private:
+    static constexpr int kBufferSize = 4 * 1024;
+
+    static int read(void *opaque, unsigned char *buffer, int bufferSize) {
+        const auto instance = static_cast<VideoAVIOContext *>(opaque);
+        const auto remaining = (int64_t)instance->_fileData.size() - instance->_position;
+        const int bytesToRead = (int)std::max<int64_t>(0, std::min<int64_t>(bufferSize, remaining));
+        if (bytesToRead == 0) {
+            return AVERROR_EOF;
+        }
+        memcpy(buffer, instance->_fileData.data() + instance->_position, bytesToRead);
+        instance->_position += bytesToRead;
+        return bytesToRead;
+    }
+
+    static int64_t seek(void *opaque, int64_t offset, int whence) {
+        const auto instance = static_cast<VideoAVIOContext *>(opaque);
+        const auto size = (int64_t)instance->_fileData.size();
+        switch (whence & ~AVSEEK_FORCE) {
+            case AVSEEK_SIZE:
+                return size;
+            case SEEK_SET:
+                break;
+            case SEEK_CUR:
+                offset += instance->_position;
+                break;
+            case SEEK_END:
+                offset += size;
+                break;
+            default:
+                return -1;
+        }
+        instance->_position = std::max<int64_t>(0, std::min(offset, size));
+        return instance->_position;
+    }
+
+    std::vector<uint8_t> const &_fileData;
+    int64_t _position = 0;
+    uint8_t *_buffer = nullptr;
+    AVIOContext *_context = nullptr;
+};
+
+class VideoPartDecoder {
+public:
+    VideoPartDecoder(std::vector<uint8_t> const &data, VideoStreamInfo const &info, std::vector<std::string> const &endpointIds) :
+    _avIoContext(data),
+    _info(info),
+    _endpointIds(endpointIds) {
+    }
+
+    ~VideoPartDecoder() {
+        if (_frame) {
+            av_frame_free(&_frame);
+        }
+        if (_packet) {
+            av_packet_free(&_packet);
+        }
+        if (_codecContext) {
+            avcodec_free_context(&_codecContext);
+        }
+        if (_formatContext) {
+            avformat_close_input(&_formatContext);
+        }
+    }
+
+    std::vector<VideoStreamingPart::Frame> decode() {
+        if (!open()) {
+            return {};
+        }
+        while (av_read_frame(_formatContext, _packet) >= 0) {
+            if (_packet->stream_index == _streamIndex) {
+                if (avcodec_send_packet(_codecContext, _packet) >= 0) {
+                    receiveFrames();
+                }
+            }
+            av_packet_unref(_packet);
+        }
+        // Drains the frames held back for reordering.
+        if (avcodec_send_packet(_codecContext, nullptr) >= 0) {
+            receiveFrames();
+        }
+        return std::move(_frames);
+    }
+
+private:
+    bool open() {
+        if (!_avIoContext.getContext()) {
+            return false;
+        }
+        const AVInputFormat *inputFormat = av_find_input_format(_info.container.c_str());
+        if (!inputFormat) {
+            RTC_LOG(LS_WARNING) << "VideoStreamingPart: unknown container " << _info.container;
+            return false;
+        }
+        _formatContext = avformat_alloc_context();
+        if (!_formatContext) {
+            return false;
+        }
+        _formatContext->pb = _avIoContext.getContext();
+        if (avformat_open_input(&_formatContext, "", const_cast<AVInputFormat *>(inputFormat), nullptr) < 0) {
+            // Freed by avformat_open_input().
+            _formatContext = nullptr;
+            return false;
+        }
+        if (avformat_find_stream_info(_formatContext, nullptr) < 0) {
+            return false;
+        }
+
+        _streamIndex = av_find_best_stream(_formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        if (_streamIndex < 0) {
+            return false;
+        }
+        AVStream *stream = _formatContext->streams[_streamIndex];
+        _timeBase = stream->time_base;
+
+        const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+        if (!codec) {
+            RTC_LOG(LS_WARNING) << "VideoStreamingPart: no decoder for " << avcodec_get_name(stream->codecpar->codec_id);
+            return false;
+        }
+        _codecContext = avcodec_alloc_context3(codec);
+        if (!_codecContext || avcodec_parameters_to_context(_codecContext, stream->codecpar) < 0) {
+            return false;
+        }
+        _codecContext->pkt_timebase = _timeBase;
+        // The decoder thread pool runs parts in parallel already.
+        _codecContext->thread_count = 1;
+        if (avcodec_open2(_codecContext, codec, nullptr) < 0) {
+            return false;
+        }
+
+        _frame = av_frame_alloc();
+        _packet = av_packet_alloc();
+        return _frame && _packet;
+    }
+
+    void receiveFrames() {
+        while (avcodec_receive_frame(_codecContext, _frame) >= 0) {
+            addFrame();
+            av_frame_unref(_frame);
+        }
+    }
+
+    void addFrame() {
+        const int64_t pts = _frame->best_effort_timestamp != AV_NOPTS_VALUE ? _frame->best_effort_timestamp : _frame->pts;
+        if (pts == AV_NOPTS_VALUE) {
+            return;
+        }
+        const int offsetMilliseconds = (int)av_rescale_q(pts, _timeBase, AVRational{ 1, 1000 });
+        const auto event = eventAt(_info, offsetMilliseconds);
+        if (!event || event->endpointId.empty()) {
+            return;
+        }
+        if (!_endpointIds.empty() && std::find(_endpointIds.begin(), _endpointIds.end(), event->endpointId) == _endpointIds.end()) {
+            return;
+        }
+        if (_frame->format != AV_PIX_FMT_YUV420P && _frame->format != AV_PIX_FMT_YUVJ420P) {
+            if (!_didWarnFormat) {
+                _didWarnFormat = true;
+                RTC_LOG(LS_WARNING) << "VideoStreamingPart: frames of pixel format " << _frame->format << " aren't supported";
+            }
+            return;
+        }
+
+        VideoStreamingPart::Frame frame;
+        frame.endpointId = event->endpointId;
+        frame.offsetMilliseconds = offsetMilliseconds;
+        frame.rotation = event->rotation;
+        frame.buffer = webrtc::I420Buffer::Copy(
+            _frame->width, _frame->height,
+            _frame->data[0], _frame->linesize[0],
+            _frame->data[1], _frame->linesize[1],
+            _frame->data[2], _frame->linesize[2]);
+        _frames.push_back(std::move(frame));
+    }
+
+    VideoAVIOContext _avIoContext;
+    VideoStreamInfo const &_info;
+    std::vector<std::string> const &_endpointIds;
+
+    AVFormatContext *_formatContext = nullptr;
+    AVCodecContext *_codecContext = nullptr;
+    AVFrame *_frame = nullptr;
+    AVPacket *_packet = nullptr;
+    int _streamIndex = -1;
+    AVRational _timeBase = AVRational{ 1, 1000 };
+    bool _didWarnFormat = false;
+
+    std::vector<VideoStreamingPart::Frame> _frames;
+};
+
+} // namespace
+
+std::vector<VideoStreamingPart::Frame> VideoStreamingPart::decode(std::vector<uint8_t> &&data, std::vector<std::string> const &endpointIds) {
+    const auto info = consumeVideoStreamInfo(data);
+    if (!info) {
+        RTC_LOG(LS_WARNING) << "VideoStreamingPart: could not parse the part header";
+        return {};
+    }
+    VideoPartDecoder decoder(data, info.value(), endpointIds);
+    return decoder.decode();
+}
+
+} // namespace tgcalls
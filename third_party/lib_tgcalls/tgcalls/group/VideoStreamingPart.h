@@ -0,0 +1,36 @@
+#ifndef TGCALLS_VIDEO_STREAMING_PART_H
+#define TGCALLS_VIDEO_STREAMING_PART_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "api/scoped_refptr.h"
+#include "api/video/video_frame_buffer.h"
+
+namespace tgcalls {
+
+// A video part of a group call's broadcast: a header naming whose video
+// starts at which offset, followed by a short MP4 carrying one video
+// stream, switched between participants at those offsets.
+class VideoStreamingPart {
+public:
+    struct Frame {
+        std::string endpointId;
+        // From the start of the part.
+        int offsetMilliseconds = 0;
+        // In degrees, as the sender's camera was turned.
+        int rotation = 0;
+        rtc::scoped_refptr<webrtc::I420BufferInterface> buffer;
+    };
+
+    // Demuxes |data| and decodes the frames of the participants in
+    // |endpointIds|, all of them when it is empty; frames of the others
+    // aren't converted. A part that can't be parsed gives no frames. Runs
+    // on the calling thread; see BroadcastPartDecoder::decodeVideo().
+    static std::vector<Frame> decode(std::vector<uint8_t> &&data, std::vector<std::string> const &endpointIds);
+};
+
+} // namespace tgcalls
+
+#endif
@@ -288,7 +288,7 @@ public:
         return _impl;
     }
 
-private:
+protected:
     rtc::scoped_refptr<webrtc::AudioDeviceModule> _impl;
 };
 
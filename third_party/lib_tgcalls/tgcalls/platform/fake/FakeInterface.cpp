@@ -1,17 +1,45 @@
 #include "FakeInterface.h"
 
-#include "api/video_codecs/builtin_video_encoder_factory.h"
-#include "api/video_codecs/builtin_video_decoder_factory.h"
-#include "api/video_track_source_proxy.h"
+#include "api/video_codecs/video_decoder.h"
+#include "api/video_codecs/video_decoder_factory.h"
+#include "api/video_codecs/video_encoder.h"
+#include "api/video_codecs/video_encoder_factory.h"
 
 namespace tgcalls {
 
+namespace {
+
+// Factories with no codecs, so that none of the video codecs get linked in.
+class NoVideoEncoderFactory : public webrtc::VideoEncoderFactory {
+ public:
+  std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+    return {};
+  }
+
+  std::unique_ptr<webrtc::VideoEncoder> CreateVideoEncoder(const webrtc::SdpVideoFormat &format) override {
+    return nullptr;
+  }
+};
+
+class NoVideoDecoderFactory : public webrtc::VideoDecoderFactory {
+ public:
+  std::vector<webrtc::SdpVideoFormat> GetSupportedFormats() const override {
+    return {};
+  }
+
+  std::unique_ptr<webrtc::VideoDecoder> CreateVideoDecoder(const webrtc::SdpVideoFormat &format) override {
+    return nullptr;
+  }
+};
+
+}  // namespace
+
 std::unique_ptr<webrtc::VideoEncoderFactory> FakeInterface::makeVideoEncoderFactory() {
-  return webrtc::CreateBuiltinVideoEncoderFactory();
+  return std::make_unique<NoVideoEncoderFactory>();
 }
 
 std::unique_ptr<webrtc::VideoDecoderFactory> FakeInterface::makeVideoDecoderFactory() {
-  return webrtc::CreateBuiltinVideoDecoderFactory();
+  return std::make_unique<NoVideoDecoderFactory>();
 }
 
 rtc::scoped_refptr<webrtc::VideoTrackSourceInterface> FakeInterface::makeVideoSource(rtc::Thread *signalingThread,
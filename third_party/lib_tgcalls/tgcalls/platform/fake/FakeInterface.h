@@ -5,6 +5,8 @@
 
 namespace tgcalls {
 
+// The platform of audio-only server builds: no video codecs, sources or
+// capturers.
 class FakeInterface : public PlatformInterface {
  public:
   std::unique_ptr<webrtc::VideoEncoderFactory> makeVideoEncoderFactory() override;
@@ -17,12 +17,14 @@ namespace {
 constexpr auto kPreferredWidth = 640;
 constexpr auto kPreferredHeight = 480;
 constexpr auto kPreferredFps = 30;
+constexpr auto kMaxCroppedBuffers = 8;
 
 } // namespace
 
 VideoCameraCapturer::VideoCameraCapturer(
 	std::shared_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> sink)
-: _sink(sink) {
+: _sink(sink)
+, _croppedPool(false, kMaxCroppedBuffers) {
 }
 
 VideoCameraCapturer::~VideoCameraCapturer() {
@@ -188,8 +190,11 @@ void VideoCameraCapturer::OnFrame(const webrtc::VideoFrame &frame) {
 	height &= ~int(1);
 	const auto left = (originalWidth - width) / 2;
 	const auto top = (originalHeight - height) / 2;
-	rtc::scoped_refptr<webrtc::I420Buffer> croppedBuffer =
-		webrtc::I420Buffer::Create(width, height);
+	const auto croppedBuffer = _croppedPool.CreateI420Buffer(width, height);
+	if (!croppedBuffer) {
+		// Every pooled buffer is still queued for encoding.
+		return;
+	}
 	croppedBuffer->CropAndScaleFrom(
 		*frame.video_frame_buffer()->ToI420(),
 		left,
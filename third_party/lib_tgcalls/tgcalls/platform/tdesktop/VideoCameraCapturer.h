@@ -4,6 +4,7 @@
 #include "api/scoped_refptr.h"
 #include "api/video/video_frame.h"
 #include "api/video/video_source_interface.h"
+#include "common_video/include/video_frame_buffer_pool.h"
 #include "media/base/video_adapter.h"
 #include "modules/video_capture/video_capture.h"
 
@@ -42,6 +43,9 @@ private:
 	std::shared_ptr<rtc::VideoSinkInterface<webrtc::VideoFrame>> _sink;
 	rtc::scoped_refptr<webrtc::VideoCaptureModule> _module;
 	webrtc::VideoCaptureCapability _capability;
+	// Buffers for frames cropped to |_aspectRatio|, reused once the
+	// encoder is done with them.
+	webrtc::VideoFrameBufferPool _croppedPool;
 
 	VideoState _state = VideoState::Inactive;
 	std::string _requestedDeviceId;
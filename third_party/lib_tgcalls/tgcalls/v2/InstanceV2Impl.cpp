@@ -37,6 +37,7 @@
 #include "pc/used_ids.h"
 
 #include "AudioFrame.h"
+#include "CallStatsSnapshotBuilder.h"
 #include "ThreadLocalObject.h"
 #include "Manager.h"
 #include "NetworkManager.h"
@@ -624,6 +625,10 @@ public:
         }
     }
 
+    void collectStats(CallStatsSnapshotBuilder &builder) {
+        builder.addVoiceChannel(_outgoingAudioChannel);
+    }
+
 private:
     void OnSentPacket_w(const rtc::SentPacket& sent_packet) {
         _call->OnSentPacket(sent_packet);
@@ -721,6 +726,10 @@ public:
         return _activityTimestamp;
     }
 
+    void collectStats(CallStatsSnapshotBuilder &builder) {
+        builder.addVoiceChannel(_audioChannel);
+    }
+
 private:
     void OnSentPacket_w(const rtc::SentPacket& sent_packet) {
         _call->OnSentPacket(sent_packet);
@@ -971,6 +980,10 @@ public:
         return _videoRotation;
     }
 
+    void collectStats(CallStatsSnapshotBuilder &builder) {
+        builder.addVideoChannel(_outgoingVideoChannel);
+    }
+
 private:
     void OnSentPacket_w(const rtc::SentPacket& sent_packet) {
         _call->OnSentPacket(sent_packet);
@@ -1121,6 +1134,10 @@ public:
         _videoSink->addSink(impl);
     }
 
+    void collectStats(CallStatsSnapshotBuilder &builder) {
+        builder.addVideoChannel(_videoChannel);
+    }
+
 private:
     void OnSentPacket_w(const rtc::SentPacket& sent_packet) {
         _call->OnSentPacket(sent_packet);
@@ -1153,6 +1170,8 @@ public:
     _remotePrefferedAspectRatioUpdated(descriptor.remotePrefferedAspectRatioUpdated),
     _signalingDataEmitted(descriptor.signalingDataEmitted),
     _createAudioDeviceModule(descriptor.createAudioDeviceModule),
+    _statsUpdated(descriptor.statsUpdated),
+    _statsUpdateIntervalMs(std::max(100, descriptor.statsUpdateIntervalMs)),
     _eventLog(std::make_unique<webrtc::RtcEventLogNull>()),
     _taskQueueFactory(webrtc::CreateDefaultTaskQueueFactory()),
     _videoCapture(descriptor.videoCapture) {
@@ -1290,12 +1309,52 @@ public:
         beginSignaling();
 
         adjustBitratePreferences(true);
+
+        if (_statsUpdated) {
+            beginStatsTimer(_statsUpdateIntervalMs);
+        }
+    }
+
+    void beginStatsTimer(int timeoutMs) {
+        const auto weak = std::weak_ptr<InstanceV2ImplInternal>(shared_from_this());
+        _threads->getMediaThread()->PostDelayedTask(RTC_FROM_HERE, [weak]() {
+            auto strong = weak.lock();
+            if (!strong) {
+                return;
+            }
+            strong->_statsUpdated(strong->collectStats());
+            strong->beginStatsTimer(strong->_statsUpdateIntervalMs);
+        }, timeoutMs);
+    }
+
+    // The media thread is the channels' worker thread here, so no hop is
+    // needed to read their stats.
+    CallStatsSnapshot collectStats() {
+        CallStatsSnapshotBuilder builder(rtc::TimeMillis());
+        builder.addCall(_call.get());
+        if (_outgoingAudioChannel) {
+            _outgoingAudioChannel->collectStats(builder);
+        }
+        if (_outgoingVideoChannel) {
+            _outgoingVideoChannel->collectStats(builder);
+        }
+        if (_incomingAudioChannel) {
+            _incomingAudioChannel->collectStats(builder);
+        }
+        if (_incomingVideoChannel) {
+            _incomingVideoChannel->collectStats(builder);
+        }
+        return builder.finish();
     }
 
     void sendSignalingMessage(signaling::Message const &message) {
-        auto data = message.serialize();
+        auto data = message.serialize(_signalingEncoding);
 
-        RTC_LOG(LS_INFO) << "sendSignalingMessage: " << std::string(data.begin(), data.end());
+        if (_signalingEncoding == signaling::Encoding::Json) {
+            RTC_LOG(LS_INFO) << "sendSignalingMessage: " << std::string(data.begin(), data.end());
+        } else {
+            RTC_LOG(LS_INFO) << "sendSignalingMessage: " << data.size() << " bytes";
+        }
 
         if (_signalingEncryption) {
             if (const auto encryptedData = _signalingEncryption->encryptOutgoing(data)) {
@@ -1397,6 +1456,7 @@ public:
 
                 data.ufrag = ufrag;
                 data.pwd = pwd;
+                data.supportsBinaryEncoding = true;
 
                 signaling::DtlsFingerprint dtlsFingerprint;
                 dtlsFingerprint.hash = hash;
@@ -1431,7 +1491,11 @@ public:
     }
 
     void processSignalingData(const std::vector<uint8_t> &data) {
-        RTC_LOG(LS_INFO) << "processSignalingData: " << std::string(data.begin(), data.end());
+        if (!data.empty() && data[0] == '{') {
+            RTC_LOG(LS_INFO) << "processSignalingData: " << std::string(data.begin(), data.end());
+        } else {
+            RTC_LOG(LS_INFO) << "processSignalingData: " << data.size() << " bytes";
+        }
 
         const auto message = signaling::Message::parse(data);
         if (!message) {
@@ -1439,6 +1503,12 @@ public:
         }
         const auto messageData = &message->data;
         if (const auto initialSetup = absl::get_if<signaling::InitialSetupMessage>(messageData)) {
+            // Everything sent from now on, the answer's own initial setup
+            // included, can use the encoding both sides understand.
+            if (initialSetup->supportsBinaryEncoding) {
+                _signalingEncoding = signaling::Encoding::Binary;
+            }
+
             PeerIceParameters remoteIceParameters;
             remoteIceParameters.ufrag = initialSetup->ufrag;
             remoteIceParameters.pwd = initialSetup->pwd;
@@ -1822,8 +1892,11 @@ private:
     std::function<void(float)> _remotePrefferedAspectRatioUpdated;
     std::function<void(const std::vector<uint8_t> &)> _signalingDataEmitted;
     std::function<rtc::scoped_refptr<webrtc::AudioDeviceModule>(webrtc::TaskQueueFactory*)> _createAudioDeviceModule;
+    std::function<void(CallStatsSnapshot const &)> _statsUpdated;
+    int _statsUpdateIntervalMs = 5000;
 
     std::unique_ptr<SignalingEncryption> _signalingEncryption;
+    signaling::Encoding _signalingEncoding = signaling::Encoding::Json;
 
     bool _handshakeCompleted = false;
     std::vector<cricket::Candidate> _pendingIceCandidates;
@@ -1866,13 +1939,15 @@ private:
 };
 
 InstanceV2Impl::InstanceV2Impl(Descriptor &&descriptor) {
-    if (descriptor.config.logPath.data.size() != 0) {
+    const auto logOptions = LogSinkImpl::Options();
+    if (descriptor.config.logPath.data.size() != 0 || !logOptions.sharedLogPath.empty()) {
         _logSink = std::make_unique<LogSinkImpl>(descriptor.config.logPath);
     }
-    rtc::LogMessage::LogToDebug(rtc::LS_INFO);
+    const auto minLogSeverity = logOptions.minSeverity;
+    rtc::LogMessage::LogToDebug(minLogSeverity);
     rtc::LogMessage::SetLogToStderr(false);
-    if (_logSink) {
-        rtc::LogMessage::AddLogToStream(_logSink.get(), rtc::LS_INFO);
+    if (_logSink && !_logSink->isShared()) {
+        rtc::LogMessage::AddLogToStream(_logSink.get(), minLogSeverity);
     }
 
     _threads = StaticThreads::getThreads();
@@ -3,7 +3,7 @@
 #include "p2p/base/basic_packet_socket_factory.h"
 #include "p2p/client/basic_port_allocator.h"
 #include "p2p/base/p2p_transport_channel.h"
-#include "p2p/base/basic_async_resolver_factory.h"
+#include "api/async_resolver_factory.h"
 #include "api/packet_socket_factory.h"
 #include "rtc_base/task_utils/to_queued_task.h"
 #include "rtc_base/rtc_certificate_generator.h"
@@ -14,8 +14,10 @@
 #include "pc/dtls_srtp_transport.h"
 #include "pc/dtls_transport.h"
 #include "TurnCustomizerImpl.h"
+#include "TurnNonceCache.h"
 #include "SctpDataChannelProviderInterfaceImpl.h"
 #include "StaticThreads.h"
+#include "SharedNetworkEnvironment.h"
 
 namespace tgcalls {
 
@@ -46,8 +48,8 @@ _dataChannelMessageReceived(configuration.dataChannelMessageReceived) {
     _localCertificate = rtc::RTCCertificateGenerator::GenerateCertificate(rtc::KeyParams(rtc::KT_ECDSA), absl::nullopt);
     
     _socketFactory.reset(new rtc::BasicPacketSocketFactory(_threads->getNetworkThread()));
-    _networkManager = std::make_unique<rtc::BasicNetworkManager>();
-    _asyncResolverFactory = std::make_unique<webrtc::BasicAsyncResolverFactory>();
+    _networkManager = SharedNetworkEnvironment::networkManager(_threads->getNetworkThread());
+    _asyncResolverFactory = SharedNetworkEnvironment::createAsyncResolverFactory();
     
     _dtlsSrtpTransport = std::make_unique<webrtc::DtlsSrtpTransport>(true);
     _dtlsSrtpTransport->SetDtlsTransports(nullptr, nullptr);
@@ -79,7 +81,7 @@ void NativeNetworkingImpl::resetDtlsSrtpTransport() {
         _turnCustomizer.reset(new TurnCustomizerImpl());
     }
 
-    _portAllocator.reset(new cricket::BasicPortAllocator(_networkManager.get(), _socketFactory.get(), _turnCustomizer.get(), nullptr));
+    _portAllocator.reset(new cricket::BasicPortAllocator(_networkManager.get(), _socketFactory.get(), _turnCustomizer.get(), TurnNonceCache::relayPortFactory()));
 
     uint32_t flags = _portAllocator->flags();
 
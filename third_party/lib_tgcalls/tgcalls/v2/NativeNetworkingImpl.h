@@ -35,7 +35,7 @@ class DtlsTransport;
 } // namespace cricket
 
 namespace webrtc {
-class BasicAsyncResolverFactory;
+class AsyncResolverFactory;
 class TurnCustomizer;
 class DtlsSrtpTransport;
 class RtpTransport;
@@ -119,10 +119,11 @@ private:
     std::function<void(std::string const &)> _dataChannelMessageReceived;
 
     std::unique_ptr<rtc::BasicPacketSocketFactory> _socketFactory;
-    std::unique_ptr<rtc::BasicNetworkManager> _networkManager;
+    // Shared with the other transports on the network thread.
+    std::shared_ptr<rtc::BasicNetworkManager> _networkManager;
     std::unique_ptr<webrtc::TurnCustomizer> _turnCustomizer;
     std::unique_ptr<cricket::BasicPortAllocator> _portAllocator;
-    std::unique_ptr<webrtc::BasicAsyncResolverFactory> _asyncResolverFactory;
+    std::unique_ptr<webrtc::AsyncResolverFactory> _asyncResolverFactory;
     std::unique_ptr<cricket::P2PTransportChannel> _transportChannel;
     std::unique_ptr<cricket::DtlsTransport> _dtlsTransport;
     std::unique_ptr<webrtc::DtlsSrtpTransport> _dtlsSrtpTransport;
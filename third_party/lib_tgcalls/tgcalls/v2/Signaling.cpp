@@ -325,6 +325,10 @@ std::vector<uint8_t> InitialSetupMessage_serialize(const InitialSetupMessage * c
         object.insert(std::make_pair("video", json11::Json(MediaContent_serialize(video.value()))));
     }
 
+    if (message->supportsBinaryEncoding) {
+        object.insert(std::make_pair("supportsBinary", json11::Json(true)));
+    }
+
     auto json = json11::Json(std::move(object));
     std::string result = json.dump();
     return std::vector<uint8_t>(result.begin(), result.end());
@@ -398,6 +402,11 @@ absl::optional<InitialSetupMessage> InitialSetupMessage_parse(json11::Json::obje
         }
     }
 
+    const auto supportsBinary = object.find("supportsBinary");
+    if (supportsBinary != object.end() && supportsBinary->second.is_bool()) {
+        message.supportsBinaryEncoding = supportsBinary->second.bool_value();
+    }
+
     return message;
 }
 
@@ -592,7 +601,422 @@ absl::optional<MediaStateMessage> MediaStateMessage_parse(json11::Json::object c
     return message;
 }
 
-std::vector<uint8_t> Message::serialize() const {
+namespace {
+
+// Binary messages start with a zero byte, which JSON can't, then the format
+// version and the message type. Fields are appended in later versions and
+// never reordered, so readers ignore what follows the fields they know.
+constexpr uint8_t kBinaryMarker = 0;
+constexpr uint8_t kBinaryVersion = 1;
+
+enum class BinaryMessageType : uint8_t {
+    InitialSetup = 1,
+    Candidates = 2,
+    MediaState = 3
+};
+
+enum InitialSetupBinaryFlags : uint8_t {
+    kHasAudio = 1,
+    kHasVideo = 2,
+    kSupportsBinary = 4
+};
+
+enum MediaStateBinaryFlags : uint8_t {
+    kIsMuted = 1,
+    kIsBatteryLow = 2
+};
+
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::vector<uint8_t> &to) :
+    _to(to) {
+    }
+
+    void writeByte(uint8_t value) {
+        _to.push_back(value);
+    }
+
+    void writeVarint(uint64_t value) {
+        while (value >= 0x80) {
+            _to.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        _to.push_back((uint8_t)value);
+    }
+
+    void writeString(std::string const &value) {
+        writeVarint(value.size());
+        _to.insert(_to.end(), value.begin(), value.end());
+    }
+
+private:
+    std::vector<uint8_t> &_to;
+};
+
+class BinaryReader {
+public:
+    BinaryReader(const uint8_t *data, size_t size) :
+    _data(data),
+    _size(size) {
+    }
+
+    bool readByte(uint8_t &value) {
+        if (_position >= _size) {
+            return false;
+        }
+        value = _data[_position++];
+        return true;
+    }
+
+    bool readVarint(uint64_t &value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = 0;
+            if (!readByte(byte)) {
+                return false;
+            }
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readUInt32(uint32_t &value) {
+        uint64_t varint = 0;
+        if (!readVarint(varint) || varint > UINT32_MAX) {
+            return false;
+        }
+        value = (uint32_t)varint;
+        return true;
+    }
+
+    bool readInt(int &value) {
+        uint64_t varint = 0;
+        if (!readVarint(varint) || varint > INT32_MAX) {
+            return false;
+        }
+        value = (int)varint;
+        return true;
+    }
+
+    bool readString(std::string &value) {
+        uint64_t length = 0;
+        if (!readVarint(length) || length > _size - _position) {
+            return false;
+        }
+        value.assign((const char *)_data + _position, (size_t)length);
+        _position += (size_t)length;
+        return true;
+    }
+
+    // Every item takes at least a byte, so a corrupt count fails here
+    // instead of making the caller reserve for it.
+    bool readCount(size_t &count) {
+        uint64_t varint = 0;
+        if (!readVarint(varint) || varint > _size - _position) {
+            return false;
+        }
+        count = (size_t)varint;
+        return true;
+    }
+
+private:
+    const uint8_t *_data = nullptr;
+    size_t _size = 0;
+    size_t _position = 0;
+};
+
+void MediaContent_writeBinary(BinaryWriter &writer, MediaContent const &mediaContent) {
+    writer.writeVarint(mediaContent.ssrc);
+
+    writer.writeVarint(mediaContent.ssrcGroups.size());
+    for (const auto &group : mediaContent.ssrcGroups) {
+        writer.writeString(group.semantics);
+        writer.writeVarint(group.ssrcs.size());
+        for (auto ssrc : group.ssrcs) {
+            writer.writeVarint(ssrc);
+        }
+    }
+
+    writer.writeVarint(mediaContent.payloadTypes.size());
+    for (const auto &payloadType : mediaContent.payloadTypes) {
+        writer.writeVarint(payloadType.id);
+        writer.writeString(payloadType.name);
+        writer.writeVarint(payloadType.clockrate);
+        writer.writeVarint(payloadType.channels);
+        writer.writeVarint(payloadType.feedbackTypes.size());
+        for (const auto &feedbackType : payloadType.feedbackTypes) {
+            writer.writeString(feedbackType.type);
+            writer.writeString(feedbackType.subtype);
+        }
+        writer.writeVarint(payloadType.parameters.size());
+        for (const auto &parameter : payloadType.parameters) {
+            writer.writeString(parameter.first);
+            writer.writeString(parameter.second);
+        }
+    }
+
+    writer.writeVarint(mediaContent.rtpExtensions.size());
+    for (const auto &rtpExtension : mediaContent.rtpExtensions) {
+        writer.writeVarint((uint32_t)rtpExtension.id);
+        writer.writeString(rtpExtension.uri);
+    }
+}
+
+absl::optional<MediaContent> MediaContent_readBinary(BinaryReader &reader) {
+    MediaContent result;
+    if (!reader.readUInt32(result.ssrc)) {
+        return absl::nullopt;
+    }
+
+    size_t count = 0;
+    if (!reader.readCount(count)) {
+        return absl::nullopt;
+    }
+    result.ssrcGroups.resize(count);
+    for (auto &group : result.ssrcGroups) {
+        size_t ssrcCount = 0;
+        if (!reader.readString(group.semantics) || !reader.readCount(ssrcCount)) {
+            return absl::nullopt;
+        }
+        group.ssrcs.resize(ssrcCount);
+        for (auto &ssrc : group.ssrcs) {
+            if (!reader.readUInt32(ssrc)) {
+                return absl::nullopt;
+            }
+        }
+    }
+
+    if (!reader.readCount(count)) {
+        return absl::nullopt;
+    }
+    result.payloadTypes.resize(count);
+    for (auto &payloadType : result.payloadTypes) {
+        size_t feedbackTypeCount = 0;
+        if (!reader.readUInt32(payloadType.id) || !reader.readString(payloadType.name) || !reader.readUInt32(payloadType.clockrate) || !reader.readUInt32(payloadType.channels) || !reader.readCount(feedbackTypeCount)) {
+            return absl::nullopt;
+        }
+        payloadType.feedbackTypes.resize(feedbackTypeCount);
+        for (auto &feedbackType : payloadType.feedbackTypes) {
+            if (!reader.readString(feedbackType.type) || !reader.readString(feedbackType.subtype)) {
+                return absl::nullopt;
+            }
+        }
+        size_t parameterCount = 0;
+        if (!reader.readCount(parameterCount)) {
+            return absl::nullopt;
+        }
+        payloadType.parameters.resize(parameterCount);
+        for (auto &parameter : payloadType.parameters) {
+            if (!reader.readString(parameter.first) || !reader.readString(parameter.second)) {
+                return absl::nullopt;
+            }
+        }
+    }
+
+    if (!reader.readCount(count)) {
+        return absl::nullopt;
+    }
+    result.rtpExtensions.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        int id = 0;
+        std::string uri;
+        if (!reader.readInt(id) || !reader.readString(uri)) {
+            return absl::nullopt;
+        }
+        result.rtpExtensions.emplace_back(uri, id);
+    }
+
+    return result;
+}
+
+void InitialSetupMessage_writeBinary(BinaryWriter &writer, InitialSetupMessage const &message) {
+    writer.writeString(message.ufrag);
+    writer.writeString(message.pwd);
+
+    writer.writeVarint(message.fingerprints.size());
+    for (const auto &fingerprint : message.fingerprints) {
+        writer.writeString(fingerprint.hash);
+        writer.writeString(fingerprint.setup);
+        writer.writeString(fingerprint.fingerprint);
+    }
+
+    uint8_t flags = 0;
+    if (message.audio) {
+        flags |= kHasAudio;
+    }
+    if (message.video) {
+        flags |= kHasVideo;
+    }
+    if (message.supportsBinaryEncoding) {
+        flags |= kSupportsBinary;
+    }
+    writer.writeByte(flags);
+
+    if (message.audio) {
+        MediaContent_writeBinary(writer, message.audio.value());
+    }
+    if (message.video) {
+        MediaContent_writeBinary(writer, message.video.value());
+    }
+}
+
+absl::optional<InitialSetupMessage> InitialSetupMessage_readBinary(BinaryReader &reader) {
+    InitialSetupMessage message;
+    size_t count = 0;
+    if (!reader.readString(message.ufrag) || !reader.readString(message.pwd) || !reader.readCount(count)) {
+        return absl::nullopt;
+    }
+    message.fingerprints.resize(count);
+    for (auto &fingerprint : message.fingerprints) {
+        if (!reader.readString(fingerprint.hash) || !reader.readString(fingerprint.setup) || !reader.readString(fingerprint.fingerprint)) {
+            return absl::nullopt;
+        }
+    }
+
+    uint8_t flags = 0;
+    if (!reader.readByte(flags)) {
+        return absl::nullopt;
+    }
+    message.supportsBinaryEncoding = (flags & kSupportsBinary) != 0;
+
+    if (flags & kHasAudio) {
+        message.audio = MediaContent_readBinary(reader);
+        if (!message.audio) {
+            return absl::nullopt;
+        }
+    }
+    if (flags & kHasVideo) {
+        message.video = MediaContent_readBinary(reader);
+        if (!message.video) {
+            return absl::nullopt;
+        }
+    }
+
+    return message;
+}
+
+void CandidatesMessage_writeBinary(BinaryWriter &writer, CandidatesMessage const &message) {
+    writer.writeVarint(message.iceCandidates.size());
+    for (const auto &candidate : message.iceCandidates) {
+        writer.writeString(candidate.sdpString);
+    }
+}
+
+absl::optional<CandidatesMessage> CandidatesMessage_readBinary(BinaryReader &reader) {
+    CandidatesMessage message;
+    size_t count = 0;
+    if (!reader.readCount(count)) {
+        return absl::nullopt;
+    }
+    message.iceCandidates.resize(count);
+    for (auto &candidate : message.iceCandidates) {
+        if (!reader.readString(candidate.sdpString)) {
+            return absl::nullopt;
+        }
+    }
+    return message;
+}
+
+void MediaStateMessage_writeBinary(BinaryWriter &writer, MediaStateMessage const &message) {
+    uint8_t flags = 0;
+    if (message.isMuted) {
+        flags |= kIsMuted;
+    }
+    if (message.isBatteryLow) {
+        flags |= kIsBatteryLow;
+    }
+    writer.writeByte(flags);
+    writer.writeByte((uint8_t)message.videoState);
+    writer.writeByte((uint8_t)message.videoRotation);
+}
+
+absl::optional<MediaStateMessage> MediaStateMessage_readBinary(BinaryReader &reader) {
+    uint8_t flags = 0;
+    uint8_t videoState = 0;
+    uint8_t videoRotation = 0;
+    if (!reader.readByte(flags) || !reader.readByte(videoState) || !reader.readByte(videoRotation)) {
+        return absl::nullopt;
+    }
+
+    // Values this version doesn't know fall back like unknown JSON ones.
+    MediaStateMessage message;
+    message.isMuted = (flags & kIsMuted) != 0;
+    message.isBatteryLow = (flags & kIsBatteryLow) != 0;
+    if (videoState <= (uint8_t)MediaStateMessage::VideoState::Active) {
+        message.videoState = (MediaStateMessage::VideoState)videoState;
+    }
+    if (videoRotation <= (uint8_t)MediaStateMessage::VideoRotation::Rotation270) {
+        message.videoRotation = (MediaStateMessage::VideoRotation)videoRotation;
+    }
+    return message;
+}
+
+std::vector<uint8_t> Message_serializeBinary(Message const &message) {
+    std::vector<uint8_t> result;
+    BinaryWriter writer(result);
+    writer.writeByte(kBinaryMarker);
+    writer.writeByte(kBinaryVersion);
+
+    if (const auto initialSetup = absl::get_if<InitialSetupMessage>(&message.data)) {
+        writer.writeByte((uint8_t)BinaryMessageType::InitialSetup);
+        InitialSetupMessage_writeBinary(writer, *initialSetup);
+    } else if (const auto candidates = absl::get_if<CandidatesMessage>(&message.data)) {
+        writer.writeByte((uint8_t)BinaryMessageType::Candidates);
+        CandidatesMessage_writeBinary(writer, *candidates);
+    } else if (const auto mediaState = absl::get_if<MediaStateMessage>(&message.data)) {
+        writer.writeByte((uint8_t)BinaryMessageType::MediaState);
+        MediaStateMessage_writeBinary(writer, *mediaState);
+    } else {
+        return {};
+    }
+    return result;
+}
+
+template <typename T>
+absl::optional<Message> Message_wrap(absl::optional<T> &&parsed) {
+    if (!parsed) {
+        return absl::nullopt;
+    }
+    Message message;
+    message.data = std::move(parsed.value());
+    return message;
+}
+
+absl::optional<Message> Message_parseBinary(const std::vector<uint8_t> &data) {
+    BinaryReader reader(data.data(), data.size());
+    uint8_t marker = 0;
+    uint8_t version = 0;
+    uint8_t type = 0;
+    if (!reader.readByte(marker) || marker != kBinaryMarker || !reader.readByte(version) || version < 1 || !reader.readByte(type)) {
+        return absl::nullopt;
+    }
+
+    switch ((BinaryMessageType)type) {
+        case BinaryMessageType::InitialSetup: {
+            return Message_wrap(InitialSetupMessage_readBinary(reader));
+        }
+        case BinaryMessageType::Candidates: {
+            return Message_wrap(CandidatesMessage_readBinary(reader));
+        }
+        case BinaryMessageType::MediaState: {
+            return Message_wrap(MediaStateMessage_readBinary(reader));
+        }
+        default: {
+            return absl::nullopt;
+        }
+    }
+}
+
+} // namespace
+
+std::vector<uint8_t> Message::serialize(Encoding encoding) const {
+    if (encoding == Encoding::Binary) {
+        return Message_serializeBinary(*this);
+    }
+
     if (const auto initialSetup = absl::get_if<InitialSetupMessage>(&data)) {
         return InitialSetupMessage_serialize(initialSetup);
     } else if (const auto candidates = absl::get_if<CandidatesMessage>(&data)) {
@@ -605,6 +1029,10 @@ std::vector<uint8_t> Message::serialize() const {
 }
 
 absl::optional<Message> Message::parse(const std::vector<uint8_t> &data) {
+    if (!data.empty() && data[0] == kBinaryMarker) {
+        return Message_parseBinary(data);
+    }
+
     std::string parsingError;
     auto json = json11::Json::parse(std::string(data.begin(), data.end()), parsingError);
     if (json.type() != json11::Json::OBJECT) {
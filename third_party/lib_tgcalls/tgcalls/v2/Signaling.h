@@ -59,6 +59,9 @@ struct InitialSetupMessage {
     std::vector<DtlsFingerprint> fingerprints;
     absl::optional<MediaContent> audio;
     absl::optional<MediaContent> video;
+    // Whether the sender parses Encoding::Binary. Older peers leave it out,
+    // and keep being sent JSON.
+    bool supportsBinaryEncoding = false;
 };
 
 struct CandidatesMessage {
@@ -86,13 +89,20 @@ struct MediaStateMessage {
 
 };
 
+enum class Encoding {
+    Json,
+    // Versioned, length-prefixed fields instead of JSON keys.
+    Binary
+};
+
 struct Message {
     absl::variant<
         InitialSetupMessage,
         CandidatesMessage,
         MediaStateMessage> data;
 
-    std::vector<uint8_t> serialize() const;
+    std::vector<uint8_t> serialize(Encoding encoding = Encoding::Json) const;
+    // Takes either encoding, telling them apart by the first byte.
     static absl::optional<Message> parse(const std::vector<uint8_t> &data);
 };
 
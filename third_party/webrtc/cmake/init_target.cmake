@@ -38,6 +38,10 @@ function(init_target target_name) # init_target(my_target folder_name)
         HAVE_SCTP
         ABSL_ALLOCATOR_NOTHROW=1
     )
+    # Defined by the extension's release_perf.cmake, when built with it.
+    if (COMMAND init_release_perf)
+        init_release_perf(${target_name})
+    endif()
     if (WIN32)
         target_compile_definitions(${target_name}
         PRIVATE
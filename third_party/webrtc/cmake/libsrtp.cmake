@@ -4,6 +4,13 @@ add_library(tg_owt::libsrtp ALIAS libsrtp)
 
 link_openssl(libsrtp)
 
+# AES-ICM, AES-GCM and HMAC-SHA1 through OpenSSL's EVP, so they run on
+# AES-NI / PCLMULQDQ and ARMv8 crypto extensions where the CPU has them.
+target_compile_definitions(libsrtp
+PRIVATE
+    OPENSSL
+)
+
 set(libsrtp_loc ${third_party_loc}/libsrtp)
 
 nice_target_sources(libsrtp ${libsrtp_loc}
@@ -0,0 +1,29 @@
+# WebRTC's AVX2 kernels: the sinc resampler, the FIR filter and the AEC3 and
+# AGC2 vector math. Built on their own with -mavx2 -mfma, so that the rest of
+# tg_owt keeps the baseline flags and runs anywhere; WebRTC picks them at
+# runtime through GetCPUInfo(kAVX2), which WEBRTC_ENABLE_AVX2 turns on.
+#
+# tg_owt links tg_owt::libwebrtcavx2 on x86, next to its other object
+# libraries, and leaves these sources out of its own list.
+
+add_library(libwebrtcavx2 OBJECT EXCLUDE_FROM_ALL)
+init_feature_target(libwebrtcavx2 avx2)
+add_library(tg_owt::libwebrtcavx2 ALIAS libwebrtcavx2)
+
+target_link_libraries(libwebrtcavx2
+PRIVATE
+    tg_owt::libwebrtcbuild
+)
+
+nice_target_sources(libwebrtcavx2 ${webrtc_loc}
+PRIVATE
+    common_audio/fir_filter_avx2.cc
+    common_audio/fir_filter_avx2.h
+    common_audio/resampler/sinc_resampler_avx2.cc
+    modules/audio_processing/aec3/adaptive_fir_filter_avx2.cc
+    modules/audio_processing/aec3/adaptive_fir_filter_erl_avx2.cc
+    modules/audio_processing/aec3/fft_data_avx2.cc
+    modules/audio_processing/aec3/matched_filter_avx2.cc
+    modules/audio_processing/aec3/vector_math_avx2.cc
+    modules/audio_processing/agc2/rnn_vad/vector_math_avx2.cc
+)
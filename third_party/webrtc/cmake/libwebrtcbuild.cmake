@@ -27,6 +27,14 @@ INTERFACE
     BWE_TEST_LOGGING_COMPILE_TIME_ENABLE=0
 )
 
+# The AVX2 kernels of libwebrtcavx2, picked at runtime.
+if (is_x86 OR is_x64)
+    target_compile_definitions(libwebrtcbuild
+    INTERFACE
+        WEBRTC_ENABLE_AVX2
+    )
+endif()
+
 if (TG_OWT_USE_PIPEWIRE)
     target_compile_definitions(libwebrtcbuild
     INTERFACE
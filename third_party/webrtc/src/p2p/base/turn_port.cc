@@ -1445,6 +1445,14 @@ void TurnAllocateRequest::OnErrorResponse(StunMessage* response) {
     case STUN_ERROR_TRY_ALTERNATE:
       OnTryAlternate(response, error_code);
       break;
+    case STUN_ERROR_STALE_NONCE:
+      // RFC 5766, Section 6.4: retry with the nonce of the response.
+      if (port_->UpdateNonce(response)) {
+        port_->SendRequest(new TurnAllocateRequest(port_), 0);
+      } else {
+        port_->OnAllocateError(error_code, "");
+      }
+      break;
     case STUN_ERROR_ALLOCATION_MISMATCH:
       // We must handle this error async because trying to delete the socket in
       // OnErrorResponse will cause a deadlock on the socket.
@@ -286,6 +286,16 @@ class TurnPort : public Port {
            webrtc::TurnCustomizer* customizer,
            rtc::SSLCertificateVerifier* tls_cert_verifier = nullptr);
 
+  // Protected so that subclasses can start with credentials from an earlier
+  // allocation instead of waiting for the server's challenge.
+  void set_nonce(const std::string& nonce) { nonce_ = nonce; }
+  void set_realm(const std::string& realm) {
+    if (realm != realm_) {
+      realm_ = realm;
+      UpdateHash();
+    }
+  }
+
   // NOTE: This method needs to be accessible for StacPort
   // return true if entry was created (i.e channel_number consumed).
   bool CreateOrRefreshEntry(const rtc::SocketAddress& addr, int channel_number);
@@ -314,14 +324,6 @@ class TurnPort : public Port {
 
   bool CreateTurnClientSocket();
 
-  void set_nonce(const std::string& nonce) { nonce_ = nonce; }
-  void set_realm(const std::string& realm) {
-    if (realm != realm_) {
-      realm_ = realm;
-      UpdateHash();
-    }
-  }
-
   void OnRefreshError();
   void HandleRefreshError();
   bool SetAlternateServer(const rtc::SocketAddress& address);
@@ -14,6 +14,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <functional>
 #include <string>
 
 #include "absl/types/optional.h"
@@ -65,6 +66,14 @@ class RtpTransport : public RtpTransportInternal {
   }
   void SetRtcpPacketTransport(rtc::PacketTransportInternal* rtcp);
 
+  // Makes the buffers for received packets, e.g. from a pool, instead of
+  // allocating a new one for each.
+  using PacketAllocator =
+      std::function<rtc::CopyOnWriteBuffer(const char* data, size_t len)>;
+  void SetPacketAllocator(PacketAllocator allocator) {
+    packet_allocator_ = std::move(allocator);
+  }
+
   bool IsReadyToSend() const override { return ready_to_send_; }
 
   bool IsWritable(bool rtcp) const override;
@@ -135,6 +144,8 @@ class RtpTransport : public RtpTransportInternal {
 
   RtpDemuxer rtp_demuxer_;
 
+  PacketAllocator packet_allocator_;
+
   // Used for identifying the MID for RtpDemuxer.
   RtpHeaderExtensionMap header_extension_map_;
 };
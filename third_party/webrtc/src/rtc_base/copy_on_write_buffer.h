@@ -23,12 +23,54 @@
 #include "rtc_base/buffer.h"
 #include "rtc_base/checks.h"
 #include "rtc_base/ref_counted_object.h"
+#include "rtc_base/ref_counter.h"
 #include "rtc_base/system/rtc_export.h"
 
 namespace rtc {
 
 class RTC_EXPORT CopyOnWriteBuffer {
  public:
+  // The reference counted storage shared by copies of a buffer. A pool can
+  // set a recycler, which gets the storage back when the last copy is gone
+  // instead of it being deleted, to reuse it for a later buffer.
+  class Storage final : public Buffer {
+   public:
+    using Recycler = void (*)(Storage* storage, void* context);
+
+    using Buffer::Buffer;
+    Storage() = default;
+    Storage(const Storage&) = delete;
+    Storage& operator=(const Storage&) = delete;
+
+    void AddRef() const { ref_count_.IncRef(); }
+    void Release() const {
+      if (ref_count_.DecRef() == RefCountReleaseStatus::kDroppedLastRef) {
+        Storage* storage = const_cast<Storage*>(this);
+        if (recycler_) {
+          recycler_(storage, recycler_context_);
+        } else {
+          delete storage;
+        }
+      }
+    }
+    bool HasOneRef() const { return ref_count_.HasOneRef(); }
+
+    void SetRecycler(Recycler recycler, void* context) {
+      recycler_ = recycler;
+      recycler_context_ = context;
+    }
+
+    // Links the storage into a recycler's free list while it is unused.
+    Storage* next_free() const { return next_free_; }
+    void set_next_free(Storage* storage) { next_free_ = storage; }
+
+   private:
+    mutable webrtc::webrtc_impl::RefCounter ref_count_{0};
+    Recycler recycler_ = nullptr;
+    void* recycler_context_ = nullptr;
+    Storage* next_free_ = nullptr;
+  };
+
   // An empty buffer.
   CopyOnWriteBuffer();
   // Share the data with an existing buffer.
@@ -43,6 +85,9 @@ class RTC_EXPORT CopyOnWriteBuffer {
   explicit CopyOnWriteBuffer(size_t size);
   CopyOnWriteBuffer(size_t size, size_t capacity);
 
+  // Share the contents of |storage|, which must have a non-zero capacity.
+  explicit CopyOnWriteBuffer(scoped_refptr<Storage> storage);
+
   // Construct a buffer and copy the specified number of bytes into it. The
   // source array may be (const) uint8_t*, int8_t*, or char*.
   template <typename T,
@@ -257,7 +302,7 @@ class RTC_EXPORT CopyOnWriteBuffer {
   }
 
  private:
-  using RefCountedBuffer = FinalRefCountedObject<Buffer>;
+  using RefCountedBuffer = Storage;
   // Create a copy of the underlying data if it is referenced from other Buffer
   // objects or there is not enough capacity.
   void UnshareAndEnsureCapacity(size_t new_capacity);